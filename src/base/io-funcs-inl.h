@@ -73,13 +73,7 @@ template<class T> inline void ReadBasicType(std::istream &is,
     }
     is.read(reinterpret_cast<char *>(t), sizeof(*t));
   } else {
-    if (sizeof(*t) == 1) {
-      int16 i;
-      is >> i;
-      *t = i;
-    } else {
-      is >> *t;
-    }
+    ReadTextNumber(is, t);
   }
   if (is.fail()) {
     KALDI_ERR << "Read failure in ReadBasicType, file position is "
@@ -87,6 +81,27 @@ template<class T> inline void ReadBasicType(std::istream &is,
   }
 }
 
+template<class T> inline bool ReadTextNumber(std::istream &is, T *t) {
+  KALDI_ASSERT_IS_INTEGER_TYPE(T);
+  if (std::numeric_limits<T>::is_signed) {
+    int64 i;
+    if (!ReadTextNumber(is, &i)) return false;
+    if (static_cast<int64>(static_cast<T>(i)) == i) {
+      *t = static_cast<T>(i);
+      return true;
+    }
+  } else {
+    uint64 i;
+    if (!ReadTextNumber(is, &i)) return false;
+    if (static_cast<uint64>(static_cast<T>(i)) == i) {
+      *t = static_cast<T>(i);
+      return true;
+    }
+  }
+  is.setstate(std::ios::failbit);  // out of range for this type.
+  return false;
+}
+
 
 template<class T> inline void WriteIntegerVector(std::ostream &os, bool binary,
                                                  const std::vector<T> &v) {
@@ -154,19 +169,12 @@ template<class T> inline void ReadIntegerVector(std::istream &is,
     is.get();  // consume the '['.
     is >> std::ws;  // consume whitespace.
     while (is.peek() != static_cast<int>(']')) {
-      if (sizeof(T) == 1) {  // read/write chars as numbers.
-        int16 next_t;
-        is >> next_t >> std::ws;
-        if (is.fail()) goto bad;
-        else
-            tmp_v.push_back((T)next_t);
-      } else {
-        T next_t;
-        is >> next_t >> std::ws;
-        if (is.fail()) goto bad;
-        else
-            tmp_v.push_back(next_t);
-      }
+      T next_t;  // chars are read as numbers, as they are written.
+      ReadTextNumber(is, &next_t);
+      is >> std::ws;
+      if (is.fail()) goto bad;
+      else
+          tmp_v.push_back(next_t);
     }
     is.get();  // get the final ']'.
     *v = tmp_v;  // could use std::swap to use less temporary memory, but this
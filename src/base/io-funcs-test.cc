@@ -121,7 +121,50 @@ void UnitTestIo(bool binary) {
   }
 }
 
-
+// Checks that ReadTextNumber() gives the same as operator >>.
+void UnitTestReadTextNumber() {
+  for (int32 i = 0; i < 100; i++) {
+    std::ostringstream os;
+    os.precision(rand() % 10 + 1);
+    float f = RandGauss() * Exp(RandUniform() * 40.0 - 20.0);
+    double d = RandGauss() * Exp(RandUniform() * 200.0 - 100.0);
+    int32 i32 = rand() - RAND_MAX / 2;
+    int64 i64 = static_cast<int64>(rand()) * rand() * (rand() % 2 == 0 ? 1 : -1);
+    os << " " << f << "\t" << d << " \n " << i32 << " " << i64 << "]";
+    std::istringstream is1(os.str()), is2(os.str());
+    float f1, f2;
+    double d1, d2;
+    int32 i32_1, i32_2;
+    int64 i64_1, i64_2;
+    KALDI_ASSERT(ReadTextNumber(is1, &f1) && ReadTextNumber(is1, &d1) &&
+                 ReadTextNumber(is1, &i32_1) && ReadTextNumber(is1, &i64_1));
+    is2 >> f2 >> d2 >> i32_2 >> i64_2;
+    KALDI_ASSERT(f1 == f2 && d1 == d2 && i32_1 == i32_2 && i64_1 == i64_2);
+    KALDI_ASSERT(is1.peek() == ']' && is2.peek() == ']');
+  }
+  {  // failures.
+    int32 i;
+    uint16 u;
+    float f;
+    std::istringstream is1("abc"), is2("3000000000"), is3("-3"), is4("1e60"),
+        is5("  "), is6("1.5");
+    KALDI_ASSERT(!ReadTextNumber(is1, &f) && is1.fail());
+    KALDI_ASSERT(!ReadTextNumber(is2, &i) && is2.fail());
+    KALDI_ASSERT(!ReadTextNumber(is3, &u) && is3.fail());
+    KALDI_ASSERT(!ReadTextNumber(is4, &f) && is4.fail());
+    KALDI_ASSERT(!ReadTextNumber(is5, &f) && is5.fail());
+    KALDI_ASSERT(!ReadTextNumber(is6, &i) && is6.fail());
+  }
+  {  // inf and nan, and denormals, which are read.
+    float f;
+    std::istringstream is("inf -inf nan 1e-40");
+    KALDI_ASSERT(ReadTextNumber(is, &f) && f > 0 && KALDI_ISINF(f));
+    KALDI_ASSERT(ReadTextNumber(is, &f) && f < 0 && KALDI_ISINF(f));
+    KALDI_ASSERT(ReadTextNumber(is, &f) && KALDI_ISNAN(f));
+    KALDI_ASSERT(ReadTextNumber(is, &f) && f > 0.0 && f < 1.0e-38);
+    KALDI_ASSERT(is.eof() && !is.fail());
+  }
+}
 
 }  // end namespace kaldi.
 
@@ -131,6 +174,7 @@ int main() {
     UnitTestIo(false);
     UnitTestIo(true);
   }
+  UnitTestReadTextNumber();
   KALDI_ASSERT(1);  // just wanted to check that KALDI_ASSERT does not fail for 1.
   return 0;
 }
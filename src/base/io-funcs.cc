@@ -17,6 +17,8 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cerrno>
+#include <cstdlib>
 #include "base/io-funcs.h"
 #include "base/kaldi-math.h"
 
@@ -86,7 +88,7 @@ void ReadBasicType<float>(std::istream &is, bool binary, float *f) {
                 << ", at file position " << is.tellg();
     }
   } else {
-    is >> *f;
+    ReadTextNumber(is, f);
   }
   if (is.fail()) {
     KALDI_ERR << "ReadBasicType: failed to read, at file position "
@@ -111,7 +113,7 @@ void ReadBasicType<double>(std::istream &is, bool binary, double *d) {
                 << ", at file position " << is.tellg();
     }
   } else {
-    is >> *d;
+    ReadTextNumber(is, d);
   }
   if (is.fail()) {
     KALDI_ERR << "ReadBasicType: failed to read, at file position "
@@ -119,6 +121,199 @@ void ReadBasicType<double>(std::istream &is, bool binary, double *d) {
   }
 }
 
+// Skips whitespace, then copies the characters that could be part of a number
+// (alphanumeric characters, '+', '-' and '.') from the stream buffer to "buf",
+// which has space for "size" chars, and null-terminates it.  Returns false,
+// setting the failbit of the stream, if there were no such characters or too
+// many of them.
+static bool ScanTextNumber(std::istream &is, char *buf, size_t size) {
+  if (!is.good()) {
+    is.setstate(std::ios::failbit);
+    return false;
+  }
+  std::streambuf *sb = is.rdbuf();
+  const int eof = std::char_traits<char>::eof();
+  int c = sb->sgetc();
+  while (c == ' ' || (c >= '\t' && c <= '\r')) c = sb->snextc();
+  size_t n = 0;
+  while ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+         (c >= 'A' && c <= 'Z') || c == '-' || c == '+' || c == '.') {
+    if (n + 1 == size) {
+      is.setstate(std::ios::failbit);
+      return false;
+    }
+    buf[n++] = static_cast<char>(c);
+    c = sb->snextc();
+  }
+  buf[n] = '\0';
+  if (c == eof) is.setstate(std::ios::eofbit);
+  if (n == 0) {
+    is.setstate(std::ios::failbit);
+    return false;
+  }
+  return true;
+}
+
+// Parses an optionally signed decimal integer that makes up all of "buf".
+// Returns false if it is not one, or its magnitude does not fit in 64 bits.
+static bool ParseDecimalInteger(const char *buf, bool *negative,
+                                uint64 *magnitude) {
+  *negative = (*buf == '-');
+  if (*buf == '-' || *buf == '+') buf++;
+  if (*buf == '\0') return false;
+  const uint64 max = ~static_cast<uint64>(0);
+  uint64 m = 0;
+  for (; *buf != '\0'; buf++) {
+    if (*buf < '0' || *buf > '9') return false;
+    uint64 digit = *buf - '0';
+    if (m >= max / 10 && (m > max / 10 || digit > max % 10))
+      return false;  // overflow.
+    m = m * 10 + digit;
+  }
+  *magnitude = m;
+  return true;
+}
+
+// Converts a decimal number such as "-1.25e-05" in "buf" to floating point
+// without strtod, in the common case where this is exact: if the significand
+// is small enough to be represented exactly and so is the power of ten, one
+// multiplication or division gives the correctly rounded result.  Returns
+// false if the number is not of this form.
+template<class Real>
+static bool FastConvertToReal(const char *buf, Real *out) {
+  // Powers of ten that are exactly representable in double; in float, only
+  // up to 1.0e+10 are.
+  static const double kPowersOfTen[] = {
+    1.0e+00, 1.0e+01, 1.0e+02, 1.0e+03, 1.0e+04, 1.0e+05, 1.0e+06, 1.0e+07,
+    1.0e+08, 1.0e+09, 1.0e+10, 1.0e+11, 1.0e+12, 1.0e+13, 1.0e+14, 1.0e+15,
+    1.0e+16, 1.0e+17, 1.0e+18, 1.0e+19, 1.0e+20, 1.0e+21, 1.0e+22 };
+  const int max_exponent = (sizeof(Real) == 4 ? 10 : 22);
+  const uint64 max_significand = (static_cast<uint64>(1) <<
+                                  std::numeric_limits<Real>::digits);
+  bool negative = (*buf == '-');
+  if (*buf == '-' || *buf == '+') buf++;
+  uint64 m = 0;
+  int exponent = 0, num_digits = 0;
+  for (; *buf >= '0' && *buf <= '9'; buf++, num_digits++) {
+    if (m > max_significand / 10) return false;
+    m = m * 10 + (*buf - '0');
+  }
+  if (*buf == '.') {
+    for (buf++; *buf >= '0' && *buf <= '9'; buf++, num_digits++) {
+      if (m > max_significand / 10) return false;
+      m = m * 10 + (*buf - '0');
+      exponent--;
+    }
+  }
+  if (num_digits == 0 || m > max_significand) return false;
+  if (*buf == 'e' || *buf == 'E') {
+    bool exponent_negative;
+    uint64 e;
+    if (!ParseDecimalInteger(buf + 1, &exponent_negative, &e) || e > 1000)
+      return false;
+    exponent += (exponent_negative ? -static_cast<int>(e) : static_cast<int>(e));
+  } else if (*buf != '\0') {
+    return false;
+  }
+  if (exponent < -max_exponent || exponent > max_exponent) return false;
+  Real r = static_cast<Real>(m);
+  if (exponent < 0) r /= static_cast<Real>(kPowersOfTen[-exponent]);
+  else r *= static_cast<Real>(kPowersOfTen[exponent]);
+  *out = (negative ? -r : r);
+  return true;
+}
+
+bool ReadTextNumber(std::istream &is, double *d) {
+  char buf[64], *end;
+  if (!ScanTextNumber(is, buf, sizeof(buf))) return false;
+  if (FastConvertToReal(buf, d)) return true;
+  errno = 0;
+  double x = KALDI_STRTOD(buf, &end);
+  // ERANGE with a small value is underflow, which we accept.
+  if (*end != '\0' || end == buf ||
+      (errno == ERANGE && (x > 1.0 || x < -1.0))) {
+    is.setstate(std::ios::failbit);
+    return false;
+  }
+  *d = x;
+  return true;
+}
+
+bool ReadTextNumber(std::istream &is, float *f) {
+  char buf[64], *end;
+  if (!ScanTextNumber(is, buf, sizeof(buf))) return false;
+  if (FastConvertToReal(buf, f)) return true;
+  errno = 0;
+  float x = KALDI_STRTOF(buf, &end);
+  if (*end != '\0' || end == buf ||
+      (errno == ERANGE && (x > 1.0 || x < -1.0))) {
+    is.setstate(std::ios::failbit);
+    return false;
+  }
+  *f = x;
+  return true;
+}
+
+// Reads an optionally signed decimal integer from the stream buffer, after
+// skipping whitespace, as ScanTextNumber() would but without copying it.
+// Returns false, setting the failbit of the stream, if it is not followed by a
+// character that cannot be part of a number, or does not fit in 64 bits.
+static bool ReadTextInteger(std::istream &is, bool *negative,
+                            uint64 *magnitude) {
+  if (!is.good()) {
+    is.setstate(std::ios::failbit);
+    return false;
+  }
+  std::streambuf *sb = is.rdbuf();
+  const int eof = std::char_traits<char>::eof();
+  int c = sb->sgetc();
+  while (c == ' ' || (c >= '\t' && c <= '\r')) c = sb->snextc();
+  *negative = (c == '-');
+  if (c == '-' || c == '+') c = sb->snextc();
+  const uint64 max = ~static_cast<uint64>(0);
+  uint64 m = 0;
+  int num_digits = 0;
+  for (; c >= '0' && c <= '9'; c = sb->snextc(), num_digits++) {
+    uint64 digit = c - '0';
+    if (m >= max / 10 && (m > max / 10 || digit > max % 10))
+      num_digits = -1000;  // overflow.
+    m = m * 10 + digit;
+  }
+  if (c == eof) is.setstate(std::ios::eofbit);
+  if (num_digits <= 0 || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+      c == '.' || c == '-' || c == '+') {
+    is.setstate(std::ios::failbit);
+    return false;
+  }
+  *magnitude = m;
+  return true;
+}
+
+bool ReadTextNumber(std::istream &is, int64 *i) {
+  bool negative;
+  uint64 m;
+  if (!ReadTextInteger(is, &negative, &m)) return false;
+  if (m > static_cast<uint64>(std::numeric_limits<int64>::max()) +
+      (negative ? 1 : 0)) {
+    is.setstate(std::ios::failbit);
+    return false;
+  }
+  *i = (negative ? static_cast<int64>(0 - m) : static_cast<int64>(m));
+  return true;
+}
+
+bool ReadTextNumber(std::istream &is, uint64 *i) {
+  bool negative;
+  uint64 m;
+  if (!ReadTextInteger(is, &negative, &m)) return false;
+  if (negative && m != 0) {
+    is.setstate(std::ios::failbit);
+    return false;
+  }
+  *i = m;
+  return true;
+}
+
 void CheckToken(const char *token) {
   KALDI_ASSERT(*token != '\0');  // check it's nonempty.
   while (*token != '\0') {
@@ -182,7 +377,6 @@ int PeekToken(std::istream &is, bool binary) {
 
 
 void ExpectToken(std::istream &is, bool binary, const char *token) {
-  int pos_at_start = is.tellg();
   KALDI_ASSERT(token != NULL);
   CheckToken(token);  // make sure it's valid (can be read back)
   if (!binary) is >> std::ws;  // consume whitespace.
@@ -190,8 +384,11 @@ void ExpectToken(std::istream &is, bool binary, const char *token) {
   is >> str;
   is.get();  // consume the space.
   if (is.fail()) {
-    KALDI_ERR << "Failed to read token [started at file position "
-              << pos_at_start << "], expected " << token;
+    // We only ask for the file position here: on a file stream, tellg() is a
+    // system call, which used to dominate the time taken to read models.
+    is.clear();
+    KALDI_ERR << "Failed to read token [ending at file position "
+              << is.tellg() << "], expected " << token;
   }
   if (strcmp(str.c_str(), token) != 0) {
     KALDI_ERR << "Expected token \"" << token << "\", got instead \""
@@ -203,4 +400,22 @@ void ExpectToken(std::istream &is, bool binary, const std::string &token) {
   ExpectToken(is, binary, token.c_str());
 }
 
+// The slots in the streams' storage (see std::ios_base::iword()) that hold
+// the state set by SetAlignedWrite(): whether it is on, and the offset.
+static const int kAlignedWriteIndex = std::ios_base::xalloc(),
+    kAlignedWriteOffsetIndex = std::ios_base::xalloc();
+
+void SetAlignedWrite(std::ostream &os, bool aligned, int64 offset) {
+  os.iword(kAlignedWriteIndex) = (aligned ? 1 : 0);
+  os.iword(kAlignedWriteOffsetIndex) = offset;
+}
+
+int32 AlignedWritePadding(std::ostream &os, int32 header_bytes) {
+  if (os.iword(kAlignedWriteIndex) == 0) return -1;
+  int64 pos = os.tellp();
+  if (pos < 0) pos = 0;  // We don't know where we are; no alignment.
+  pos += os.iword(kAlignedWriteOffsetIndex) + header_bytes;
+  return (kBinaryAlignment - pos % kBinaryAlignment) % kBinaryAlignment;
+}
+
 }  // end namespace kaldi
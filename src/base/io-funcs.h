@@ -174,6 +174,19 @@ inline void ReadBasicType(std::istream &is, bool binary, T *t, bool add) {
   }
 }
 
+/// ReadTextNumber reads a number in text form, after skipping any whitespace,
+/// as "is >> *t" would; it returns false, and sets the failbit of the stream,
+/// if it could not read a number of the right type.  It is much faster than
+/// operator >> (which goes through the locale's num_get facet), as it takes
+/// the characters straight from the stream buffer and converts them with
+/// strtod or strtoll.  The text-mode ReadBasicType uses it.
+bool ReadTextNumber(std::istream &is, float *f);
+bool ReadTextNumber(std::istream &is, double *d);
+bool ReadTextNumber(std::istream &is, int64 *i);
+bool ReadTextNumber(std::istream &is, uint64 *i);
+/// This version is for the other integer types.
+template<class T> inline bool ReadTextNumber(std::istream &is, T *t);
+
 /// Function for writing STL vectors of integer types.
 template<class T> inline void WriteIntegerVector(std::ostream &os, bool binary,
                                                  const std::vector<T> &v);
@@ -211,6 +224,29 @@ void ExpectToken(std::istream &is, bool binary, const std::string & token);
 void ExpectPretty(std::istream &is, bool binary, const char *token);
 void ExpectPretty(std::istream &is, bool binary, const std::string & token);
 
+/// The alignment, in bytes, of the data of objects written in "aligned" mode;
+/// see SetAlignedWrite().
+const int32 kBinaryAlignment = 64;
+
+/// SetAlignedWrite turns "aligned" binary writing on or off for a stream
+/// (it is off by default; the "align" wspecifier option turns it on for
+/// archives).  In this mode, objects whose binary format allows it (currently
+/// Matrix) pad their header so that their data starts at a multiple of
+/// kBinaryAlignment bytes from the start of the file, and pad their rows to a
+/// multiple of kBinaryAlignment bytes, so that a program that maps the file
+/// into memory can use the data where it is.  The position in the file is
+/// taken to be "offset" plus os.tellp(); "offset" is for streams that hold a
+/// piece of the file, like the std::ostringstream that an object is
+/// serialized into before it is written.  If tellp() fails (e.g. for pipes),
+/// the data will not be aligned, but it can still be read.
+void SetAlignedWrite(std::ostream &os, bool aligned, int64 offset = 0);
+
+/// If aligned writing is on for this stream, returns the number of bytes of
+/// padding that an object should write, after writing "header_bytes" more
+/// bytes of header, so that the next byte is aligned; returns -1 if aligned
+/// writing is off.
+int32 AlignedWritePadding(std::ostream &os, int32 header_bytes);
+
 /// @} end "addtogroup io_funcs_basic"
 
 
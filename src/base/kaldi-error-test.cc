@@ -18,6 +18,7 @@
 // limitations under the License.
 
 
+#include <pthread.h>
 #include "base/kaldi-common.h"
 
 // testing that we get the stack trace.
@@ -38,16 +39,85 @@ void UnitTestError() {
   }
 }
 
+void *LogFromThread(void *arg) {
+  ScopedLogTag tag(*static_cast<std::string*>(arg));
+  KALDI_ASSERT(GetLogTag() == *static_cast<std::string*>(arg));
+  for (int32 i = 0; i < 100; i++)
+    KALDI_LOG << "Ignore this message " << i;
+  return NULL;
+}
+
+void UnitTestLogTagAndAsync() {
+  KALDI_ASSERT(GetLogTag() == "");
+  {
+    ScopedLogTag tag("utt1");
+    KALDI_ASSERT(GetLogTag() == "utt1");
+    {
+      ScopedLogTag tag2("utt2");
+      KALDI_ASSERT(GetLogTag() == "utt2");
+    }
+    KALDI_ASSERT(GetLogTag() == "utt1");
+  }
+  KALDI_ASSERT(GetLogTag() == "");
+
+  SetLogAsync(true);
+  std::string tags[4] = { "a", "b", "c", "d" };
+  pthread_t threads[4];
+  for (int32 i = 0; i < 4; i++)
+    KALDI_ASSERT(pthread_create(&threads[i], NULL, LogFromThread,
+                                &(tags[i])) == 0);
+  for (int32 i = 0; i < 4; i++)
+    pthread_join(threads[i], NULL);
+  FlushLog();
+  SetLogAsync(false);
+  KALDI_LOG << "Ignore this message too.";
+}
+
+void *LogUntilExit(void *arg) {
+  KALDI_LOG << "Ignore this message.";
+  *static_cast<volatile bool*>(arg) = true;
+  while (true) FlushLog();  // Uses the writer without printing anything.
+  return NULL;
+}
+
+// Leaves a detached thread logging while the program exits, as the thread
+// pool's threads may do; the async writer must survive that.
+void UnitTestAsyncLogAtExit() {
+  static volatile bool started = false;
+  SetLogAsync(true);
+  pthread_t thread;
+  KALDI_ASSERT(pthread_create(&thread, NULL, LogUntilExit,
+                              const_cast<bool*>(&started)) == 0);
+  pthread_detach(thread);
+  while (!started) { }  // So that it is still logging when we exit.
+}
+
+void UnitTestVlog() {
+  // The message should not even be evaluated if the level is too high.
+  int32 num_evaluated = 0;
+  SetVerboseLevel(1);
+  KALDI_VLOG(2) << "Ignore this message " << (num_evaluated++);
+  KALDI_ASSERT(num_evaluated == 0);
+  if (num_evaluated == 0)
+    KALDI_VLOG(1) << "Ignore this message " << (num_evaluated++);
+  else
+    KALDI_ASSERT(0);  // checks that the "else" binds to the right "if".
+  KALDI_ASSERT(num_evaluated == 1);
+  SetVerboseLevel(0);
+}
 
 }  // end namespace kaldi.
 
 int main() {
   kaldi::g_program_name = "/foo/bar/kaldi-error-test";
+  kaldi::UnitTestLogTagAndAsync();
+  kaldi::UnitTestVlog();
   try {
     kaldi::UnitTestError();
     KALDI_ASSERT(0);  // should not happen.
   } catch (std::runtime_error &r) {
     std::cout << "UnitTestError: the error we generated was: " << r.what();
   }
+  kaldi::UnitTestAsyncLogAtExit();
 }
 
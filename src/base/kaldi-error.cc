@@ -28,6 +28,8 @@
 #endif  // HAVE_CXXABI_H
 #endif  // HAVE_EXECINFO_H
 
+#include <pthread.h>
+#include <cstdlib>
 #include "base/kaldi-common.h"
 #include "base/kaldi-error.h"
 
@@ -43,6 +45,174 @@ const char *GetProgramName() {
   else return g_program_name;
 }
 
+namespace {
+
+pthread_once_t g_log_tag_once = PTHREAD_ONCE_INIT;
+pthread_key_t g_log_tag_key;
+
+void DeleteLogTag(void *tag) { delete static_cast<std::string*>(tag); }
+
+void CreateLogTagKey() { pthread_key_create(&g_log_tag_key, DeleteLogTag); }
+
+// Writes log messages to stderr from a background thread.  Messages are
+// appended to pending_; the thread swaps it with an empty buffer and writes
+// the whole buffer, so the mutex is held only briefly by either side.
+class AsyncLogWriter {
+ public:
+  AsyncLogWriter(): busy_(false), stop_(false) {
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&pending_cond_, NULL);
+    pthread_cond_init(&written_cond_, NULL);
+    if (pthread_create(&thread_, NULL, Run, this) != 0) {
+      fprintf(stderr, "Could not create thread for logging\n");
+      abort();
+    }
+  }
+
+  void Write(const std::string &msg) {
+    pthread_mutex_lock(&mutex_);
+    // If stderr can't keep up, wait rather than queue without limit.
+    while (pending_.size() > kMaxPending)
+      pthread_cond_wait(&written_cond_, &mutex_);
+    pending_ += msg;
+    pending_ += '\n';
+    pthread_cond_signal(&pending_cond_);
+    pthread_mutex_unlock(&mutex_);
+  }
+
+  void Flush() {
+    pthread_mutex_lock(&mutex_);
+    while (!pending_.empty() || busy_)
+      pthread_cond_wait(&written_cond_, &mutex_);
+    pthread_mutex_unlock(&mutex_);
+  }
+
+  // Writes everything that is queued and stops the thread.
+  ~AsyncLogWriter() {
+    pthread_mutex_lock(&mutex_);
+    stop_ = true;
+    pthread_cond_signal(&pending_cond_);
+    pthread_mutex_unlock(&mutex_);
+    pthread_join(thread_, NULL);
+    pthread_cond_destroy(&written_cond_);
+    pthread_cond_destroy(&pending_cond_);
+    pthread_mutex_destroy(&mutex_);
+  }
+
+ private:
+  static void *Run(void *arg) {
+    AsyncLogWriter *self = static_cast<AsyncLogWriter*>(arg);
+    std::string buffer;
+    pthread_mutex_lock(&self->mutex_);
+    while (true) {
+      while (self->pending_.empty() && !self->stop_)
+        pthread_cond_wait(&self->pending_cond_, &self->mutex_);
+      if (self->pending_.empty()) break;  // stop_ was set.
+      buffer.swap(self->pending_);
+      self->busy_ = true;
+      pthread_mutex_unlock(&self->mutex_);
+      fwrite(buffer.data(), 1, buffer.size(), stderr);
+      fflush(stderr);
+      buffer.clear();
+      pthread_mutex_lock(&self->mutex_);
+      self->busy_ = false;
+      pthread_cond_broadcast(&self->written_cond_);
+    }
+    pthread_mutex_unlock(&self->mutex_);
+    return NULL;
+  }
+
+  static const size_t kMaxPending = 1 << 20;
+  pthread_t thread_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t pending_cond_;  // signaled when a message is queued.
+  pthread_cond_t written_cond_;  // signaled when a buffer has been written.
+  std::string pending_;
+  bool busy_;  // true while the thread is writing a buffer.
+  bool stop_;
+};
+
+// Threads that log read this without a lock, so it is set and read with a
+// memory barrier: they see either NULL or a fully constructed writer.
+AsyncLogWriter * volatile g_async_log_writer = NULL;
+
+AsyncLogWriter *GetAsyncLogWriter() {
+  AsyncLogWriter *writer = g_async_log_writer;
+  __sync_synchronize();
+  return writer;
+}
+
+// Called at exit.  Threads of the thread pool are never joined and may still
+// be logging, so we don't delete the writer: we make new messages go straight
+// to stderr, write out the ones that are queued, and leave the writer
+// allocated.
+void StopAsyncLog() {
+  AsyncLogWriter *writer = GetAsyncLogWriter();
+  if (writer != NULL &&
+      __sync_bool_compare_and_swap(&g_async_log_writer, writer,
+                                   static_cast<AsyncLogWriter*>(NULL)))
+    writer->Flush();
+}
+
+}  // end anonymous namespace
+
+void SetLogTag(const std::string &tag) {
+  pthread_once(&g_log_tag_once, CreateLogTagKey);
+  std::string *ptr = static_cast<std::string*>(
+      pthread_getspecific(g_log_tag_key));
+  if (ptr == NULL) {
+    if (tag.empty()) return;
+    ptr = new std::string();
+    pthread_setspecific(g_log_tag_key, ptr);
+  }
+  *ptr = tag;
+}
+
+const std::string &GetLogTag() {
+  // Never destroyed, as threads may still log while the program exits.
+  static const std::string *empty = new std::string();
+  pthread_once(&g_log_tag_once, CreateLogTagKey);
+  std::string *ptr = static_cast<std::string*>(
+      pthread_getspecific(g_log_tag_key));
+  return (ptr == NULL ? *empty : *ptr);
+}
+
+void SetLogAsync(bool async) {
+  static bool registered = false;
+  AsyncLogWriter *writer = GetAsyncLogWriter();
+  if (async && writer == NULL) {
+    writer = new AsyncLogWriter();
+    __sync_synchronize();
+    g_async_log_writer = writer;
+    if (!registered) atexit(StopAsyncLog);
+    registered = true;
+  } else if (!async && writer != NULL) {
+    g_async_log_writer = NULL;
+    __sync_synchronize();
+    delete writer;
+  }
+}
+
+void FlushLog() {
+  AsyncLogWriter *writer = GetAsyncLogWriter();
+  if (writer != NULL)
+    writer->Flush();
+}
+
+void KaldiWriteLogMessage(const std::string &msg) {
+  AsyncLogWriter *writer = GetAsyncLogWriter();
+  if (writer != NULL)
+    writer->Write(msg);
+  else
+    fprintf(stderr, "%s\n", msg.c_str());
+}
+
+// Writes the log tag of the current thread, if any, e.g. "[utt1] ".
+static void WriteLogTag(std::ostream &os) {
+  const std::string &tag = GetLogTag();
+  if (!tag.empty()) os << '[' << tag << "] ";
+}
+
 // Given a filename like "/a/b/c/d/e/f.cc",  GetShortFileName
 // returns "e/f.cc".  Does not currently work if backslash is
 // the filename separator.
@@ -128,6 +298,7 @@ std::string KaldiGetStackTrace() {
 
 void KaldiAssertFailure_(const char *func, const char *file,
                          int32 line, const char *cond_str) {
+  FlushLog();
   std::cerr << "KALDI_ASSERT: at " << GetProgramName() << func << ':'
             << GetShortFileName(file)
             << ':' << line << ", failed: " << cond_str << '\n';
@@ -143,6 +314,7 @@ KaldiWarnMessage::KaldiWarnMessage(const char *func, const char *file,
                                    int32 line) {
   this->stream() << "WARNING (" << GetProgramName() << func << "():"
                  << GetShortFileName(file) << ':' << line << ") ";
+  WriteLogTag(this->stream());
 }
 
 
@@ -150,6 +322,7 @@ KaldiLogMessage::KaldiLogMessage(const char *func, const char *file,
                                  int32 line) {
   this->stream() << "LOG (" << GetProgramName() << func << "():"
                  << GetShortFileName(file) << ':' << line << ") ";
+  WriteLogTag(this->stream());
 }
 
 
@@ -157,16 +330,19 @@ KaldiVlogMessage::KaldiVlogMessage(const char *func, const char *file,
                                    int32 line, int32 verbose) {
   this->stream() << "VLOG[" << verbose << "] (" << GetProgramName() << func
                  << "():" << GetShortFileName(file) << ':' << line << ") ";
+  WriteLogTag(this->stream());
 }
 
 KaldiErrorMessage::KaldiErrorMessage(const char *func, const char *file,
                                      int32 line) {
   this->stream() << "ERROR (" << GetProgramName() << func << "():"
                  << GetShortFileName(file) << ':' << line << ") ";
+  WriteLogTag(this->stream());
 }
 
 KaldiErrorMessage::~KaldiErrorMessage() {
-  // (1) Print the message to stderr.
+  // (1) Print the message to stderr, after any queued log messages.
+  FlushLog();
   std::cerr << ss.str() << '\n';
   // (2) Throw an exception with the message, plus traceback info if available.
   if (!std::uncaught_exception()) {
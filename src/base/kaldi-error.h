@@ -54,6 +54,45 @@ inline int32 GetVerboseLevel() { return g_kaldi_verbose_level; }
 /// automatically from ParseOptions.
 inline void SetVerboseLevel(int32 i) { g_kaldi_verbose_level = i; }
 
+/// Sets a tag, e.g. the utterance-id, that is printed in all log, warning and
+/// error messages from the current thread until it is changed; this makes the
+/// interleaved output of multi-threaded programs readable.  The empty string
+/// means no tag.
+void SetLogTag(const std::string &tag);
+
+/// Returns the current thread's log tag, or "" if there is none.
+const std::string &GetLogTag();
+
+/// Sets the current thread's log tag for the lifetime of this object, and
+/// then restores the previous one.
+class ScopedLogTag {
+ public:
+  explicit ScopedLogTag(const std::string &tag): old_tag_(GetLogTag()) {
+    SetLogTag(tag);
+  }
+  ~ScopedLogTag() { SetLogTag(old_tag_); }
+ private:
+  std::string old_tag_;
+};
+
+/// If "async" is true, log and warning messages are queued and written to
+/// stderr by a background thread, so that threads that log don't wait for
+/// stderr or for each other (the queue is only locked for long enough to
+/// append the message).  The queue is flushed before any error or assertion
+/// failure is printed, and at exit; threads still logging after that (e.g.
+/// ones that were never joined) write to stderr directly.  This should be
+/// called when no other threads are logging, normally at the start of the
+/// program.
+void SetLogAsync(bool async);
+
+/// Waits until all queued log messages have been written, if SetLogAsync(true)
+/// was called; otherwise does nothing.
+void FlushLog();
+
+/// Writes a complete log message (without the newline) to stderr, or queues it
+/// if SetLogAsync(true) was called.
+void KaldiWriteLogMessage(const std::string &msg);
+
 // Class KaldiLogMessage is invoked from the  KALDI_WARN, KALDI_VLOG and
 // KALDI_LOG macros. It prints the message to stderr.  Note: we avoid
 // using cerr, due to problems with thread safety.  fprintf is guaranteed
@@ -64,7 +103,7 @@ class KaldiWarnMessage {
  public:
   inline std::ostream &stream() { return ss; }
   KaldiWarnMessage(const char *func, const char *file, int32 line);
-  ~KaldiWarnMessage()  { fprintf(stderr, "%s\n", ss.str().c_str()); }
+  ~KaldiWarnMessage()  { KaldiWriteLogMessage(ss.str()); }
  private:
   std::ostringstream ss;
 };
@@ -74,7 +113,7 @@ class KaldiLogMessage {
  public:
   inline std::ostream &stream() { return ss; }
   KaldiLogMessage(const char *func, const char *file, int32 line);
-  ~KaldiLogMessage() { fprintf(stderr, "%s\n", ss.str().c_str()); }
+  ~KaldiLogMessage() { KaldiWriteLogMessage(ss.str()); }
  private:
   std::ostringstream ss;
 };
@@ -85,11 +124,19 @@ class KaldiVlogMessage {
   KaldiVlogMessage(const char *func, const char *file, int32 line,
                    int32 verbose_level);
   inline std::ostream &stream() { return ss; }
-  ~KaldiVlogMessage() { fprintf(stderr, "%s\n", ss.str().c_str()); }
+  ~KaldiVlogMessage() { KaldiWriteLogMessage(ss.str()); }
  private:
   std::ostringstream ss;
 };
 
+// LogVoidify is used in KALDI_VLOG to turn the stream expression into void,
+// so it can be one arm of a ?: expression.  operator & binds less tightly
+// than << but more tightly than ?:.
+class LogVoidify {
+ public:
+  void operator & (std::ostream &) { }
+};
+
 
 // class KaldiErrorMessage is invoked from the KALDI_ERROR macro.
 // The destructor throws an exception.
@@ -128,8 +175,21 @@ class KaldiErrorMessage {
 #define KALDI_WARN kaldi::KaldiWarnMessage(__func__, __FILE__, __LINE__).stream() 
 #define KALDI_LOG kaldi::KaldiLogMessage(__func__, __FILE__, __LINE__).stream()
 
-#define KALDI_VLOG(v) if (v <= kaldi::g_kaldi_verbose_level)     \
-           kaldi::KaldiVlogMessage(__func__, __FILE__, __LINE__, v).stream()
+// KALDI_VLOG(v) messages with v greater than KALDI_MAX_VLOG_LEVEL are
+// compiled out entirely (the test is on constants, so the compiler removes
+// it); e.g. compile with -DKALDI_MAX_VLOG_LEVEL=1 so that the more verbose
+// logging in inner loops costs nothing.
+#ifndef KALDI_MAX_VLOG_LEVEL
+#define KALDI_MAX_VLOG_LEVEL 1000
+#endif
+
+// The macro is a single expression, rather than an if-statement, so that
+// it can't take an "else" that follows it, e.g. in "if (c) KALDI_VLOG(1) <<
+// ...; else ...", and gives no -Wdangling-else warnings.
+#define KALDI_VLOG(v) \
+  ((v) > KALDI_MAX_VLOG_LEVEL || (v) > kaldi::g_kaldi_verbose_level) ? \
+  (void) 0 : kaldi::LogVoidify() & \
+  kaldi::KaldiVlogMessage(__func__, __FILE__, __LINE__, v).stream()
 
 inline bool IsKaldiError(const std::string &str) {
   return(!strncmp(str.c_str(), "ERROR ", 6));
@@ -136,6 +136,81 @@ void UnitTestRand() {
   }
 }
 
+void UnitTestRandomGenerator() {
+  using namespace kaldi;
+  {  // the same seed and stream give the same sequence; others differ.
+    RandomGenerator a(5, 2), b(5, 2), c(5, 3), d(6, 2);
+    bool c_differs = false, d_differs = false;
+    for (int32 i = 0; i < 100; i++) {
+      uint64 x = a.RandUint64();
+      KALDI_ASSERT(x == b.RandUint64());
+      if (x != c.RandUint64()) c_differs = true;
+      if (x != d.RandUint64()) d_differs = true;
+    }
+    KALDI_ASSERT(c_differs && d_differs);
+    a.Seed(5, 2);
+    b.Seed(5, 2);
+    float data[7];
+    a.RandGauss(data, 7);
+    for (int32 i = 0; i < 7; i++)
+      KALDI_ASSERT(data[i] == b.RandGauss());
+  }
+  RandomGenerator rng(RandInt(0, 1000));
+  int32 n = 100000;
+  {  // uniform: range, mean and variance.
+    std::vector<float> f(n);
+    std::vector<double> d(n);
+    rng.RandUniform(&(f[0]), n);
+    rng.RandUniform(&(d[0]), n);
+    double fsum = 0.0, fsumsq = 0.0, dsum = 0.0;
+    for (int32 i = 0; i < n; i++) {
+      KALDI_ASSERT(f[i] > 0.0 && f[i] < 1.0 && d[i] > 0.0 && d[i] < 1.0);
+      fsum += f[i];
+      fsumsq += f[i] * f[i];
+      dsum += d[i];
+    }
+    KALDI_ASSERT(std::abs(fsum / n - 0.5) < 0.01 &&
+                 std::abs(dsum / n - 0.5) < 0.01);
+    KALDI_ASSERT(std::abs(fsumsq / n - (fsum / n) * (fsum / n) - 1.0 / 12.0)
+                 < 0.01);
+  }
+  {  // Gaussian: mean and variance, for odd and even sizes.
+    std::vector<float> f(n + 1);
+    std::vector<double> d(n);
+    rng.RandGauss(&(f[0]), n + 1);
+    rng.RandGauss(&(d[0]), n);
+    double fsum = 0.0, fsumsq = 0.0, dsum = 0.0, dsumsq = 0.0, ssum = 0.0;
+    for (int32 i = 0; i < n; i++) {
+      fsum += f[i];
+      fsumsq += f[i] * f[i];
+      dsum += d[i];
+      dsumsq += d[i] * d[i];
+      float s = rng.RandGauss();
+      ssum += s * s;
+    }
+    KALDI_ASSERT(std::abs(fsum / n) < 0.02 && std::abs(dsum / n) < 0.02);
+    KALDI_ASSERT(std::abs(fsumsq / n - 1.0) < 0.03 &&
+                 std::abs(dsumsq / n - 1.0) < 0.03 &&
+                 std::abs(ssum / n - 1.0) < 0.03);
+  }
+  {  // RandInt().
+    std::vector<int32> counts(5, 0);
+    for (int32 i = 0; i < 10000; i++) {
+      int32 r = rng.RandInt(-2, 2);
+      KALDI_ASSERT(r >= -2 && r <= 2);
+      counts[r + 2]++;
+    }
+    for (int32 i = 0; i < 5; i++)
+      KALDI_ASSERT(counts[i] > 1600 && counts[i] < 2400);
+    KALDI_ASSERT(rng.RandInt(7, 7) == 7);
+  }
+  {  // RandPrune().
+    BaseFloat f = RandPrune(-0.5, 1.0, &rng);
+    KALDI_ASSERT(f == 0.0 || f == -1.0);
+    KALDI_ASSERT(RandPrune(1.1, 1.0, &rng) == 1.1);
+  }
+}
+
 void UnitTestLogAddSub() {
   using namespace kaldi;
   for (int i = 0; i < 100; i++) {
@@ -155,6 +230,23 @@ void UnitTestLogAddSub() {
   }
 }
 
+void UnitTestLogAddFast() {
+  using namespace kaldi;
+  for (int i = 0; i < 10000; i++) {
+    double x = 40.0 * (RandUniform() - 0.5), y = 40.0 * (RandUniform() - 0.5);
+    if (i % 100 == 0) y = x;
+    double exact = LogAdd(x, y);
+    KALDI_ASSERT(std::abs(LogAddFast(x, y) - exact) < 1.0e-06);
+    KALDI_ASSERT(std::abs(LogAddFast(static_cast<float>(x),
+                                     static_cast<float>(y)) - exact) < 1.0e-05);
+  }
+  KALDI_ASSERT(LogAddFast(kLogZeroDouble, kLogZeroDouble) == kLogZeroDouble);
+  KALDI_ASSERT(LogAddFast(kLogZeroFloat, 1.0f) == 1.0f);
+  g_kaldi_fast_math = true;
+  KALDI_ASSERT(LogAdd(0.5, 1.5) == LogAddFast(0.5, 1.5));
+  g_kaldi_fast_math = false;
+}
+
 void UnitTestDefines() {  // Yes, we even unit-test the preprocessor statements.
   KALDI_ASSERT(exp(kLogZeroFloat) == 0.0);
   KALDI_ASSERT(exp(kLogZeroDouble) == 0.0);
@@ -251,7 +343,9 @@ int main() {
   UnitTestFactorize();
   UnitTestDefines();
   UnitTestLogAddSub();
+  UnitTestLogAddFast();
   UnitTestRand();
+  UnitTestRandomGenerator();
   UnitTestAssertFunc();
   UnitTestRoundUpToNearestPowerOfTwo();
 }
@@ -22,6 +22,20 @@
 #include "base/kaldi-math.h"
 
 namespace kaldi {
+
+bool g_kaldi_fast_math = false;
+
+float g_log_add_table[kLogAddTableRange * kLogAddTableScale + 1];
+
+// Sets up g_log_add_table, before main() starts.
+static struct LogAddTableInitializer {
+  LogAddTableInitializer() {
+    for (int32 i = 0; i <= kLogAddTableRange * kLogAddTableScale; i++)
+      g_log_add_table[i] = Log1p(Exp(-static_cast<double>(i) /
+                                     kLogAddTableScale));
+  }
+} log_add_table_initializer;
+
 // These routines are tested in matrix/matrix-test.cc
 
 int32 RoundUpToNearestPowerOfTwo(int32 n) {
@@ -101,6 +115,77 @@ int32 RandPoisson(float lambda) {
   return k-1;
 }
 
+// splitmix64, which is the recommended way to initialize the xoshiro state.
+static inline uint64 SplitMix64(uint64 *x) {
+  uint64 z = (*x += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+void RandomGenerator::Seed(uint64 seed, uint64 stream) {
+  uint64 x = seed;
+  x = SplitMix64(&x) ^ stream;
+  for (int32 i = 0; i < 4; i++)
+    s_[i] = SplitMix64(&x);
+  have_gauss_ = false;
+  gauss_ = 0.0;
+}
+
+int32 RandomGenerator::RandInt(int32 min_val, int32 max_val) {
+  KALDI_ASSERT(max_val >= min_val);
+  uint64 range = static_cast<uint64>(static_cast<int64>(max_val) - min_val) + 1;
+  // The bias from the modulus is at most range / 2^64.
+  return static_cast<int32>(min_val + static_cast<int64>(RandUint64() % range));
+}
+
+// Box-Muller transform of two uniform random numbers, as in ::RandGauss().
+template<class Real>
+static inline void GaussPair(RandomGenerator *rng, Real *a, Real *b) {
+  Real r = std::sqrt(-2.0f * std::log(rng->RandUniform())),
+      theta = static_cast<Real>(2.0 * M_PI) * rng->RandUniform();
+  *a = r * std::cos(theta);
+  *b = r * std::sin(theta);
+}
+
+float RandomGenerator::RandGauss() {
+  if (have_gauss_) {
+    have_gauss_ = false;
+    return gauss_;
+  }
+  float ans;
+  GaussPair(this, &ans, &gauss_);
+  have_gauss_ = true;
+  return ans;
+}
+
+void RandomGenerator::RandGauss(float *data, size_t dim) {
+  size_t i = 0;
+  for (; i + 1 < dim; i += 2)
+    GaussPair(this, data + i, data + i + 1);
+  if (i < dim)
+    data[i] = RandGauss();
+}
+
+void RandomGenerator::RandGauss(double *data, size_t dim) {
+  size_t i = 0;
+  for (; i + 1 < dim; i += 2)
+    GaussPair(this, data + i, data + i + 1);
+  if (i < dim)
+    data[i] = RandGauss();
+}
+
+void RandomGenerator::RandUniform(float *data, size_t dim) {
+  for (size_t i = 0; i < dim; i++)
+    data[i] = RandUniform();
+}
+
+void RandomGenerator::RandUniform(double *data, size_t dim) {
+  for (size_t i = 0; i < dim; i++)  // 52 random bits; strictly inside (0, 1).
+    data[i] = (static_cast<double>(RandUint64() >> 12) + 0.5) *
+        (1.0 / 4503599627370496.0);  // 2^-52.
+}
+
 
 }  // end namespace kaldi
 
@@ -120,11 +120,131 @@ inline Float RandPrune(Float post, BaseFloat prune_thresh) {
       (RandUniform() <= fabs(post)/prune_thresh ? prune_thresh : 0.0);
 }
 
+/// A fast pseudo-random number generator (xoshiro256+) that keeps its own
+/// state.  Use it instead of the functions above where rand() is too slow or
+/// where several threads need random numbers: rand() has global state (which
+/// glibc protects with a lock), so threads that call it serialize, and the
+/// numbers each thread gets depend on the timing.  A generator is determined
+/// by a seed and a stream index (e.g. a thread or utterance index), so results
+/// can be made reproducible regardless of the number of threads.  An object
+/// must not be used by more than one thread at a time.
+class RandomGenerator {
+ public:
+  explicit RandomGenerator(uint64 seed = 0, uint64 stream = 0) {
+    Seed(seed, stream);
+  }
+
+  /// Resets the state; different (seed, stream) pairs give unrelated
+  /// sequences.
+  void Seed(uint64 seed, uint64 stream = 0);
+
+  /// Returns 64 random bits.
+  inline uint64 RandUint64() {
+    uint64 ans = s_[0] + s_[3], t = s_[1] << 17;
+    s_[2] ^= s_[0];
+    s_[3] ^= s_[1];
+    s_[1] ^= s_[2];
+    s_[0] ^= s_[3];
+    s_[2] ^= t;
+    s_[3] = (s_[3] << 45) | (s_[3] >> 19);
+    return ans;
+  }
+
+  /// Returns a random integer between min and max inclusive.
+  int32 RandInt(int32 min, int32 max);
+
+  /// Returns a random number strictly between 0 and 1.
+  inline float RandUniform() {
+    return (static_cast<float>(RandUint64() >> 41) + 0.5f) *
+        (1.0f / 8388608.0f);  // 2^-23.
+  }
+
+  /// Returns a Gaussian random number with zero mean and unit variance.
+  float RandGauss();
+
+  /// Sets data[0 .. dim-1] to Gaussian random numbers.  This is what
+  /// VectorBase::SetRandn(RandomGenerator*) uses.
+  void RandGauss(float *data, size_t dim);
+  void RandGauss(double *data, size_t dim);
+
+  /// Sets data[0 .. dim-1] to random numbers strictly between 0 and 1.
+  void RandUniform(float *data, size_t dim);
+  void RandUniform(double *data, size_t dim);
+
+ private:
+  uint64 s_[4];
+  // The Box-Muller transform gives Gaussians in pairs; RandGauss() keeps the
+  // second one for the next call.
+  bool have_gauss_;
+  float gauss_;
+};
+
+/// As RandPrune(), but taking the random numbers from "rng".
+template<class Float>
+inline Float RandPrune(Float post, BaseFloat prune_thresh,
+                       RandomGenerator *rng) {
+  KALDI_ASSERT(prune_thresh >= 0.0);
+  if (post == 0.0 || std::abs(post) >= prune_thresh)
+    return post;
+  return (post >= 0 ? 1.0 : -1.0) *
+      (rng->RandUniform() <= fabs(post)/prune_thresh ? prune_thresh : 0.0);
+}
+
 static const double kMinLogDiffDouble = std::log(DBL_EPSILON);  // negative!
 static const float kMinLogDiffFloat = std::log(FLT_EPSILON);  // negative!
 
+/// If true, LogAdd() uses LogAddFast(), and LogSumExp() and ApplySoftMax() of
+/// single-precision vectors and matrices use a vectorized approximation of
+/// exp() (see matrix/fast-exp.h); both have errors of around 1e-6 or less.  It
+/// is false by default, and it is set by the standard --fast-math option that
+/// ParseOptions registers.
+extern bool g_kaldi_fast_math;
+
+/// LogAddFast() uses a table of log(1 + exp(-d)) for 0 <= d < kLogAddTableRange,
+/// with kLogAddTableScale entries per unit of d; it is set up in kaldi-math.cc.
+static const int32 kLogAddTableRange = 16;  // > -kMinLogDiffFloat.
+static const int32 kLogAddTableScale = 256;
+extern float g_log_add_table[kLogAddTableRange * kLogAddTableScale + 1];
+
+/// A faster version of LogAdd(), that looks up log(1 + exp(-|x - y|)) in a table
+/// with linear interpolation instead of calling exp() and log1p().  The
+/// absolute error is below 1e-6.  Note: the table is set up by a static
+/// initializer, so this should not be called before main() starts.
+inline double LogAddFast(double x, double y) {
+  double diff;
+  if (x < y) {
+    diff = y - x;
+    x = y;
+  } else {
+    diff = x - y;
+  }
+  // diff is positive (or NaN, if both were -inf).  x is now the larger one.
+  if (!(diff < kLogAddTableRange))
+    return x;
+  double pos = diff * kLogAddTableScale;
+  int32 i = static_cast<int32>(pos);
+  const float *table = g_log_add_table + i;
+  return x + table[0] + (pos - i) * (table[1] - table[0]);
+}
+
+inline float LogAddFast(float x, float y) {
+  float diff;
+  if (x < y) {
+    diff = y - x;
+    x = y;
+  } else {
+    diff = x - y;
+  }
+  if (!(diff < kLogAddTableRange))
+    return x;
+  float pos = diff * kLogAddTableScale;
+  int32 i = static_cast<int32>(pos);
+  const float *table = g_log_add_table + i;
+  return x + table[0] + (pos - i) * (table[1] - table[0]);
+}
 
 inline double LogAdd(double x, double y) {
+  if (g_kaldi_fast_math) return LogAddFast(x, y);
   double diff;
   if (x < y) {
     diff = x - y;
@@ -149,6 +269,7 @@ inline double LogAdd(double x, double y) {
 
 
 inline float LogAdd(float x, float y) {
+  if (g_kaldi_fast_math) return LogAddFast(x, y);
   float diff;
   if (x < y) {
     diff = x - y;
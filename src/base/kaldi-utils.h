@@ -134,6 +134,12 @@ template<> class KaldiCompileTimeAssert<true> {
 #endif
 
 #define KALDI_STRTOD(cur_cstr, end_cstr) strtod(cur_cstr, end_cstr)
+#if defined(_MSC_VER) && _MSC_VER < 1800
+#  define KALDI_STRTOF(cur_cstr, end_cstr) \
+  static_cast<float>(strtod(cur_cstr, end_cstr))
+#else
+#  define KALDI_STRTOF(cur_cstr, end_cstr) strtof(cur_cstr, end_cstr)
+#endif
 
 #endif  // KALDI_BASE_KALDI_UTILS_H_
 
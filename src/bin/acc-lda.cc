@@ -98,16 +98,18 @@ int main(int argc, char *argv[]) {
 
       Posterior pdf_post;
       ConvertPosteriorToPdfs(trans_model, post, &pdf_post);
-      for (int32 i = 0; i < feats.NumRows(); i++) {
-        SubVector<BaseFloat> feat(feats, i);
-        for (size_t j = 0; j < pdf_post[i].size(); j++) {
-          int32 pdf_id = pdf_post[i][j].first;
-          BaseFloat weight = RandPrune(pdf_post[i][j].second, rand_prune);
-          if (weight != 0.0) {
-            lda.Accumulate(feat, pdf_id, weight);
+      if (rand_prune != 0.0) {
+        for (size_t i = 0; i < pdf_post.size(); i++) {
+          Posterior::value_type pruned;
+          for (size_t j = 0; j < pdf_post[i].size(); j++) {
+            BaseFloat weight = RandPrune(pdf_post[i][j].second, rand_prune);
+            if (weight != 0.0)
+              pruned.push_back(std::make_pair(pdf_post[i][j].first, weight));
           }
+          pdf_post[i].swap(pruned);
         }
       }
+      lda.Accumulate(feats, pdf_post);
       num_done++;
       if (num_done % 100 == 0)
         KALDI_LOG << "Done " << num_done << " utterances.";
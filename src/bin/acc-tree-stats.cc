@@ -24,6 +24,65 @@
 #include "tree/build-tree-utils.h"
 #include "hmm/transition-model.h"
 #include "hmm/tree-accu.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+// Accumulates the tree stats for a batch of utterances, for use with class
+// TaskSequencer.  The stats are first accumulated in a map that belongs to
+// this object, in operator() (possibly in parallel with other batches), and
+// the destructor adds them to the total stats, so the multi-threaded part
+// needs no locking and the result does not depend on the number of threads.
+class AccumulateTreeStatsClass {
+ public:
+  AccumulateTreeStatsClass(const TransitionModel &trans_model,
+                           BaseFloat var_floor, int32 N, int32 P,
+                           const std::vector<int32> &ci_phones,
+                           const std::vector<int32> *phone_map,
+                           std::map<EventType, GaussClusterable*> *tree_stats):
+      trans_model_(trans_model), var_floor_(var_floor), N_(N), P_(P),
+      ci_phones_(ci_phones), phone_map_(phone_map), tree_stats_(tree_stats) { }
+
+  void AddUtterance(const std::vector<int32> &alignment,
+                    const Matrix<BaseFloat> &features) {
+    alignments_.push_back(alignment);
+    features_.resize(features_.size() + 1);
+    features_.back().Resize(features.NumRows(), features.NumCols(), kUndefined);
+    features_.back().CopyFromMat(features);
+  }
+  size_t NumUtterances() const { return features_.size(); }
+
+  void operator () () {
+    for (size_t i = 0; i < features_.size(); i++)
+      AccumulateTreeStats(trans_model_, var_floor_, N_, P_, ci_phones_,
+                          alignments_[i], features_[i], phone_map_, &stats_);
+  }
+
+  ~AccumulateTreeStatsClass() {
+    for (std::map<EventType, GaussClusterable*>::iterator iter = stats_.begin();
+         iter != stats_.end(); ++iter) {
+      std::pair<std::map<EventType, GaussClusterable*>::iterator, bool> ans =
+          tree_stats_->insert(*iter);
+      if (!ans.second) {  // already present: add and delete ours.
+        ans.first->second->Add(*(iter->second));
+        delete iter->second;
+      }
+    }
+  }
+ private:
+  const TransitionModel &trans_model_;
+  BaseFloat var_floor_;
+  int32 N_;
+  int32 P_;
+  const std::vector<int32> &ci_phones_;
+  const std::vector<int32> *phone_map_;
+  std::map<EventType, GaussClusterable*> *tree_stats_;
+  std::vector<std::vector<int32> > alignments_;
+  std::vector<Matrix<BaseFloat> > features_;
+  std::map<EventType, GaussClusterable*> stats_;
+};
+
+}  // end namespace kaldi
 
 /** @brief Accumulate tree statistics for decision tree training. The
 program reads in a feature archive, and the corresponding alignments,
@@ -47,6 +106,8 @@ int main(int argc, char *argv[]) {
     std::string phone_map_rxfilename;
     int N = 3;
     int P = 1;
+    int32 batch_size = 10;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
     po.Register("binary", &binary, "Write output in binary mode");
     po.Register("var-floor", &var_floor, "Variance floor for tree clustering.");
     po.Register("ci-phones", &ci_phones_str, "Colon-separated list of integer "
@@ -58,7 +119,10 @@ int main(int argc, char *argv[]) {
     po.Register("phone-map", &phone_map_rxfilename,
                 "File name containing old->new phone mapping (each line is: "
                 "old-integer-id new-integer-id)");
-    
+    po.Register("batch-size", &batch_size, "Number of utterances accumulated "
+                "together in each task (with --num-threads > 1).");
+    sequencer_config.Register(&po);
+
     po.Read(argc, argv);
 
     if (po.NumArgs() < 3 || po.NumArgs() > 4) {
@@ -66,6 +130,9 @@ int main(int argc, char *argv[]) {
       exit(1);
     }
 
+    if (batch_size <= 0)
+      KALDI_ERR << "--batch-size must be positive, got " << batch_size;
+
     std::string model_filename = po.GetArg(1),
         feature_rspecifier = po.GetArg(2),
         alignment_rspecifier = po.GetArg(3),
@@ -103,35 +170,48 @@ int main(int argc, char *argv[]) {
 
     int num_done = 0, num_no_alignment = 0, num_other_error = 0;
 
-    for (; !feature_reader.Done(); feature_reader.Next()) {
-      std::string key = feature_reader.Key();
-      if (!alignment_reader.HasKey(key)) {
-        num_no_alignment++;
-      } else {
-        const Matrix<BaseFloat> &mat = feature_reader.Value();
-        const std::vector<int32> &alignment = alignment_reader.Value(key);
-
-        if (alignment.size() != mat.NumRows()) {
-          KALDI_WARN << "Alignments has wrong size "<< (alignment.size())<<" vs. "<< (mat.NumRows());
-          num_other_error++;
-          continue;
+    {
+      TaskSequencer<AccumulateTreeStatsClass> sequencer(sequencer_config);
+      AccumulateTreeStatsClass *task = NULL;
+      for (; !feature_reader.Done(); feature_reader.Next()) {
+        std::string key = feature_reader.Key();
+        if (!alignment_reader.HasKey(key)) {
+          num_no_alignment++;
+        } else {
+          const Matrix<BaseFloat> &mat = feature_reader.Value();
+          const std::vector<int32> &alignment = alignment_reader.Value(key);
+
+          if (alignment.size() != mat.NumRows()) {
+            KALDI_WARN << "Alignments has wrong size "<< (alignment.size())<<" vs. "<< (mat.NumRows());
+            num_other_error++;
+            continue;
+          }
+
+          ////// This is the important part of this program.  ////////
+          const std::vector<int32> *phone_map_ptr =
+              (phone_map_rxfilename != "" ? &phone_map : NULL);
+          if (sequencer_config.num_threads == 1) {
+            // Avoid the copying and merging when there is nothing to gain.
+            AccumulateTreeStats(trans_model, var_floor, N, P, ci_phones,
+                                alignment, mat, phone_map_ptr, &tree_stats);
+          } else {
+            if (task == NULL)
+              task = new AccumulateTreeStatsClass(trans_model, var_floor, N, P,
+                                                  ci_phones, phone_map_ptr,
+                                                  &tree_stats);
+            task->AddUtterance(alignment, mat);
+            if (task->NumUtterances() == static_cast<size_t>(batch_size)) {
+              sequencer.Run(task);  // takes ownership of "task".
+              task = NULL;
+            }
+          }
+          num_done++;
+          if (num_done % 1000 == 0)
+            KALDI_LOG << "Processed " << num_done << " utterances.";
         }
-
-        ////// This is the important part of this program.  ////////
-        AccumulateTreeStats(trans_model,
-                            var_floor,
-                            N,
-                            P,
-                            ci_phones,
-                            alignment,
-                            mat,
-                            (phone_map_rxfilename != "" ? &phone_map : NULL),
-                            &tree_stats);
-        num_done++;
-        if (num_done % 1000 == 0)
-          KALDI_LOG << "Processed " << num_done << " utterances.";
       }
-    }
+      if (task != NULL) sequencer.Run(task);
+    }  // the sequencer's destructor waits for the tasks to finish.
 
     BuildTreeStatsType stats;  // vectorized form.
 
@@ -52,13 +52,12 @@ int main(int argc, char *argv[]) {
 
     int32 num_done = 0;
     SequentialInt32VectorReader alignment_reader(alignments_rspecifier);
-    PosteriorWriter posterior_writer(posteriors_wspecifier);
+    CompactPosteriorWriter posterior_writer(posteriors_wspecifier);
 
+    CompactPosterior post;  // reused, to avoid reallocation.
     for (; !alignment_reader.Done(); alignment_reader.Next()) {
       num_done++;
       const std::vector<int32> &alignment = alignment_reader.Value();
-      // Posterior is vector<vector<pair<int32, BaseFloat> > >
-      Posterior post;
       AlignmentToPosterior(alignment, &post);
       posterior_writer.Write(alignment_reader.Key(), post);
     }
@@ -0,0 +1,88 @@
+// bin/arpa-to-compact-lm.cc
+
+// Copyright 2026  agent
+// (based on bin/vector-scale.cc; see that file for its authors)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "lm/compact-ngram-lm.h"
+
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Converts an ARPA-format language model to the compact, memory-mapped\n"
+        "format that lattice-lmrescore and the biglm decoders can use in place\n"
+        "of an FST, for LMs that are too large to convert to G.fst.  Costs are\n"
+        "quantized to 16 bits per order.  The word list is needed to map words\n"
+        "to the integer ids used in the decoding graph; n-grams with words not\n"
+        "in it are skipped.  The output must be a file, and is specific to the\n"
+        "machine's byte order.\n"
+        "\n"
+        "Usage:  arpa-to-compact-lm [options] words.txt arpa-in compact-lm-out\n"
+        "E.g.:   gunzip -c lm.arpa.gz | \\\n"
+        "    arpa-to-compact-lm data/lang/words.txt - data/lang/lm.compact\n";
+
+    ParseOptions po(usage);
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 3) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string word_syms_filename = po.GetArg(1),
+        arpa_rxfilename = po.GetArg(2),
+        lm_wxfilename = po.GetArg(3);
+
+    if (ClassifyWxfilename(lm_wxfilename) != kFileOutput)
+      KALDI_ERR << "The output of arpa-to-compact-lm must be a file, not "
+                << PrintableWxfilename(lm_wxfilename);
+
+    fst::SymbolTable *word_syms =
+        fst::SymbolTable::ReadText(word_syms_filename);
+    if (word_syms == NULL)
+      KALDI_ERR << "Could not read symbol table from file "
+                << word_syms_filename;
+
+    {
+      Input ki(arpa_rxfilename);
+      bool binary = true, write_header = false;
+      Output ko(lm_wxfilename, binary, write_header);
+      if (!BuildCompactNgramLm(ki.Stream(), *word_syms, ko.Stream()))
+        KALDI_ERR << "Error converting ARPA file "
+                  << PrintableRxfilename(arpa_rxfilename);
+      ko.Close();
+    }
+    delete word_syms;
+
+    CompactNgramLm lm;  // Check that we can read it back.
+    if (!lm.Open(lm_wxfilename))
+      KALDI_ERR << "Error reading back compact LM from " << lm_wxfilename;
+    KALDI_LOG << "Wrote compact LM of order " << lm.Order() << " to "
+              << lm_wxfilename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -27,6 +27,7 @@
 #include "tree/context-dep.h"
 #include "tree/clusterable-classes.h"
 #include "util/text-utils.h"
+#include "thread/kaldi-thread.h"
 
 namespace kaldi {
 void GetSeenPhones(BuildTreeStatsType &stats, int P, std::vector<int32> *phones_out) {
@@ -85,6 +86,9 @@ int main(int argc, char *argv[]) {
                 "leaves in second-level decision tree.");
     po.Register("cluster-leaves", &cluster_leaves, "If true, do a post-clustering"
                 " of the leaves of the final decision tree.");
+    g_num_threads = 1;  // Unless the user asks for more.
+    po.Register("num-threads", &g_num_threads, "Number of threads to use in "
+                "the search for the best splits");
     
     po.Read(argc, argv);
 
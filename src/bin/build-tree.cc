@@ -26,6 +26,7 @@
 #include "tree/build-tree-utils.h"
 #include "tree/clusterable-classes.h"
 #include "util/text-utils.h"
+#include "thread/kaldi-thread.h"
 
 int main(int argc, char *argv[]) {
   using namespace kaldi;
@@ -61,6 +62,9 @@ int main(int argc, char *argv[]) {
                 "threshold for clustering after tree-building.  0 means "
                 "no clustering; -1 means use as a clustering threshold the "
                 "likelihood change of the final split.");
+    g_num_threads = 1;  // Unless the user asks for more.
+    po.Register("num-threads", &g_num_threads, "Number of threads to use in "
+                "the search for the best splits");
 
     po.Read(argc, argv);
 
@@ -0,0 +1,152 @@
+// bin/compile-graph.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "hmm/transition-model.h"
+#include "hmm/hmm-utils.h"
+#include "tree/context-dep.h"
+#include "util/common-utils.h"
+#include "fst/fstlib.h"
+#include "fstext/fstext-lib.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+    using kaldi::int32;
+
+    const char *usage =
+        "Creates the decoding graph HCLG from the tree, the model, the lexicon\n"
+        "L_disambig.fst and the grammar G.fst, doing in memory the same\n"
+        "sequence of operations as utils/mkgraph.sh (fsttablecompose,\n"
+        "fstdeterminizestar --use-log=true, fstminimizeencoded,\n"
+        "fstcomposecontext, make-h-transducer, fstrmsymbols, fstrmepslocal\n"
+        "and add-self-loops), without writing the intermediate FSTs.\n"
+        "\n"
+        "Usage:   compile-graph [options] <tree-in> <model-in> <L-disambig-fst-in> "
+        "<G-fst-in> <HCLG-fst-out>\n"
+        "e.g.: \n"
+        " compile-graph --read-disambig-syms=data/lang/phones/disambig.int \\\n"
+        "   --self-loop-scale=0.1 tree final.mdl data/lang/L_disambig.fst \\\n"
+        "   data/lang/G.fst HCLG.fst\n";
+
+    ParseOptions po(usage);
+    HTransducerConfig hcfg;
+    std::string disambig_rxfilename;
+    int32 N = 3, P = 1;
+    BaseFloat self_loop_scale = 1.0;
+    bool reorder = true;
+    int32 num_threads = 1;
+    hcfg.Register(&po);
+    po.Register("read-disambig-syms", &disambig_rxfilename,
+                "List of disambiguation symbols on the input of L_disambig.fst");
+    po.Register("context-size", &N, "Size of phone context window");
+    po.Register("central-position", &P,
+                "Designated central position in context window");
+    po.Register("self-loop-scale", &self_loop_scale,
+                "Scale for self-loop probabilities relative to LM.");
+    po.Register("reorder", &reorder,
+                "If true, reorder symbols for more decoding efficiency");
+    po.Register("num-threads", &num_threads, "Number of threads used in the "
+                "compositions and determinizations (the output may be "
+                "numbered differently for different values, but is "
+                "equivalent).");
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 5) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string tree_rxfilename = po.GetArg(1),
+        model_rxfilename = po.GetArg(2),
+        lex_rxfilename = po.GetArg(3),
+        grammar_rxfilename = po.GetArg(4),
+        hclg_wxfilename = po.GetArg(5);
+
+    ContextDependency ctx_dep;
+    ReadKaldiObject(tree_rxfilename, &ctx_dep);
+    TransitionModel trans_model;
+    ReadKaldiObject(model_rxfilename, &trans_model);
+
+    std::vector<int32> disambig_in;
+    if (disambig_rxfilename != "")
+      if (!ReadIntegerVectorSimple(disambig_rxfilename, &disambig_in))
+        KALDI_ERR << "Could not read disambiguation symbols from "
+                  << PrintableRxfilename(disambig_rxfilename);
+    if (disambig_in.empty()) {
+      KALDI_WARN << "Disambiguation symbols list is empty; this likely "
+                 << "indicates an error in data preparation.";
+    }
+
+    TableComposeOptions compose_opts;  // Match on the left, as fsttablecompose.
+
+    // LG = min(det(L o G)).  Each FST is deleted as soon as it has been used,
+    // so at most two of the big ones are in memory at a time.
+    VectorFst<StdArc> *lg_fst = new VectorFst<StdArc>;
+    {
+      VectorFst<StdArc> *lex_fst = ReadFstKaldi(lex_rxfilename);
+      VectorFst<StdArc> *grammar_fst = ReadFstKaldi(grammar_rxfilename);
+      ArcSort(lex_fst, OLabelCompare<StdArc>());
+      TableComposeParallel(*lex_fst, *grammar_fst, lg_fst, compose_opts,
+                           num_threads);
+      delete lex_fst;
+      delete grammar_fst;
+    }
+    DeterminizeStarInLog(lg_fst, kDelta, NULL, -1, num_threads);
+    MinimizeEncoded(lg_fst);
+    KALDI_LOG << "LG has " << lg_fst->NumStates() << " states.";
+
+    // CLG.
+    std::vector<std::vector<int32> > ilabels;
+    VectorFst<StdArc> *clg_fst = new VectorFst<StdArc>;
+    ComposeContext(disambig_in, N, P, lg_fst, clg_fst, &ilabels);
+    delete lg_fst;
+    KALDI_LOG << "CLG has " << clg_fst->NumStates() << " states.";
+
+    // HCLGa = min(rmepslocal(rmsymbols(det(Ha o CLG)))).
+    VectorFst<StdArc> *hclg_fst = new VectorFst<StdArc>;
+    std::vector<int32> disambig_tids;
+    {
+      VectorFst<StdArc> *h_fst = GetHTransducer(ilabels, ctx_dep, trans_model,
+                                                hcfg, &disambig_tids);
+      ArcSort(h_fst, OLabelCompare<StdArc>());
+      TableComposeParallel(*h_fst, *clg_fst, hclg_fst, compose_opts,
+                           num_threads);
+      delete h_fst;
+      delete clg_fst;
+    }
+    DeterminizeStarInLog(hclg_fst, kDelta, NULL, -1, num_threads);
+    RemoveSomeInputSymbols(disambig_tids, hclg_fst);
+    RemoveEpsLocalSpecial(hclg_fst);
+    MinimizeEncoded(hclg_fst);
+
+    // HCLG.  The disambiguation symbols have already been removed.
+    std::vector<int32> disambig_none;
+    AddSelfLoops(trans_model, disambig_none, self_loop_scale, reorder,
+                 hclg_fst);
+    KALDI_LOG << "HCLG has " << hclg_fst->NumStates() << " states.";
+
+    WriteFstKaldi(*hclg_fst, hclg_wxfilename);
+    delete hclg_fst;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -23,6 +23,7 @@
 #include "util/parse-options.h"
 #include "tree/context-dep.h"
 #include "util/edit-distance.h"
+#include "thread/kaldi-task-sequence.h"
 
 
 namespace kaldi {
@@ -57,6 +58,112 @@ void PrintAlignmentStats(const std::vector<T> &ref,
   }
 }
 
+
+// The counts that go into the output of this program.
+struct WerStats {
+  int32 num_words, word_errs, num_sent, sent_errs, num_ins, num_del, num_sub;
+  WerStats(): num_words(0), word_errs(0), num_sent(0), sent_errs(0),
+              num_ins(0), num_del(0), num_sub(0) { }
+};
+
+// Scores a batch of utterances, for use with class TaskSequencer: the
+// alignments are done in operator(), possibly in parallel with other
+// batches, and the destructor adds to the totals and writes the detailed
+// stats (if wanted), in the same order as the utterances were read.
+template<typename T>
+class ScoreUtterancesClass {
+ public:
+  // The "stats_output" may be NULL if detailed stats are not wanted.
+  ScoreUtterancesClass(T eps, WerStats *stats, std::ostream *stats_output):
+      eps_(eps), stats_(stats), stats_output_(stats_output) { }
+
+  void AddUtterance(const std::vector<T> &ref, const std::vector<T> &hyp) {
+    refs_.push_back(ref);
+    hyps_.push_back(hyp);
+  }
+  size_t NumUtterances() const { return refs_.size(); }
+
+  void operator () () {
+    for (size_t i = 0; i < refs_.size(); i++) {
+      const std::vector<T> &ref = refs_[i], &hyp = hyps_[i];
+      batch_stats_.num_words += ref.size();
+      int32 ins, del, sub;
+      batch_stats_.word_errs += LevenshteinEditDistance(ref, hyp,
+                                                        &ins, &del, &sub);
+      batch_stats_.num_ins += ins;
+      batch_stats_.num_del += del;
+      batch_stats_.num_sub += sub;
+      if (stats_output_ != NULL)
+        PrintAlignmentStats(ref, hyp, eps_, detailed_stats_);
+      batch_stats_.num_sent++;
+      batch_stats_.sent_errs += (ref != hyp);
+    }
+  }
+
+  ~ScoreUtterancesClass() {
+    stats_->num_words += batch_stats_.num_words;
+    stats_->word_errs += batch_stats_.word_errs;
+    stats_->num_sent += batch_stats_.num_sent;
+    stats_->sent_errs += batch_stats_.sent_errs;
+    stats_->num_ins += batch_stats_.num_ins;
+    stats_->num_del += batch_stats_.num_del;
+    stats_->num_sub += batch_stats_.num_sub;
+    if (stats_output_ != NULL)
+      *stats_output_ << detailed_stats_.str();
+  }
+ private:
+  T eps_;
+  WerStats *stats_;
+  std::ostream *stats_output_;
+  std::vector<std::vector<T> > refs_;
+  std::vector<std::vector<T> > hyps_;
+  WerStats batch_stats_;
+  std::ostringstream detailed_stats_;
+};
+
+// Scores the utterances of "ref_reader" against those in "hyp_reader", in
+// batches of "batch_size" utterances that are given to "sequencer_config"
+// number of threads.  Returns the number of utterances absent from
+// "hyp_reader".
+template<typename T, typename SequentialReader, typename RandomAccessReader>
+int32 ScoreAllUtterances(const std::string &ref_rspecifier,
+                         const std::string &hyp_rspecifier,
+                         const std::string &mode, T eps, int32 batch_size,
+                         const TaskSequencerConfig &sequencer_config,
+                         std::ostream *stats_output, WerStats *stats) {
+  SequentialReader ref_reader(ref_rspecifier);
+  RandomAccessReader hyp_reader(hyp_rspecifier);
+  int32 num_absent_sents = 0;
+  TaskSequencer<ScoreUtterancesClass<T> > sequencer(sequencer_config);
+  ScoreUtterancesClass<T> *task = NULL;
+  const std::vector<T> empty_sent;
+
+  for (; !ref_reader.Done(); ref_reader.Next()) {
+    std::string key = ref_reader.Key();
+    const std::vector<T> &ref_sent = ref_reader.Value();
+    bool has_hyp = hyp_reader.HasKey(key);
+    if (!has_hyp) {
+      if (mode == "strict")
+        KALDI_ERR << "No hypothesis for key " << key << " and strict "
+            "mode specifier.";
+      num_absent_sents++;
+      if (mode == "present")  // do not score this one.
+        continue;
+    }
+    if (task == NULL)
+      task = new ScoreUtterancesClass<T>(eps, stats, stats_output);
+    task->AddUtterance(ref_sent, (has_hyp ? hyp_reader.Value(key) :
+                                  empty_sent));
+    if (task->NumUtterances() == static_cast<size_t>(batch_size)) {
+      sequencer.Run(task);  // takes ownership of "task".
+      task = NULL;
+    }
+  }
+  if (task != NULL) sequencer.Run(task);
+  sequencer.Wait();
+  return num_absent_sents;
+}
+
 }
 
 
@@ -81,6 +188,8 @@ int main(int argc, char *argv[]) {
 
     std::string mode = "strict";
     bool text_input = false;  //  if this is true, we expect symbols as strings,
+    int32 batch_size = 100;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
 
     po.Register("mode", &mode,
                 "Scoring mode: \"present\"|\"all\"|\"strict\":\n"
@@ -88,6 +197,9 @@ int main(int argc, char *argv[]) {
                 "  \"all\" means treat absent transcriptions as empty\n"
                 "  \"strict\" means die if all in ref not also in hyp");
     po.Register("text", &text_input, "Expect strings, not integers, as input.");
+    po.Register("batch-size", &batch_size, "Number of utterances scored "
+                "together in each task (with --num-threads > 1).");
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -108,79 +220,33 @@ int main(int argc, char *argv[]) {
       KALDI_ERR << "--mode option invalid: expected \"present\"|\"all\"|\"strict\", got "
                 << mode;
     }
+    if (batch_size <= 0)
+      KALDI_ERR << "--batch-size must be positive, got " << batch_size;
 
 
 
-    int32 num_words = 0, word_errs = 0, num_sent = 0, sent_errs = 0,
-        num_ins = 0, num_del = 0, num_sub = 0, num_absent_sents = 0;
-
+    WerStats stats;
+    int32 num_absent_sents;
+    std::ostream *stats_stream = (detailed_stats ? &(stats_output.Stream()) :
+                                  NULL);
     if (!text_input) {
-      SequentialInt32VectorReader ref_reader(ref_rspecifier);
-      RandomAccessInt32VectorReader hyp_reader(hyp_rspecifier);
-
-      for (; !ref_reader.Done(); ref_reader.Next()) {
-        std::string key = ref_reader.Key();
-        const std::vector<int32> &ref_sent = ref_reader.Value();
-        std::vector<int32> hyp_sent;
-        if (!hyp_reader.HasKey(key)) {
-          if (mode == "strict")
-            KALDI_ERR << "No hypothesis for key " << key << " and strict "
-                "mode specifier.";
-          num_absent_sents++;
-          if (mode == "present")  // do not score this one.
-            continue;
-        } else {
-          hyp_sent = hyp_reader.Value(key);
-        }
-        num_words += ref_sent.size();
-        int32 ins, del, sub;
-        word_errs += LevenshteinEditDistance(ref_sent, hyp_sent,
-                                             &ins, &del, &sub);
-        num_ins += ins;
-        num_del += del;
-        num_sub += sub;
-
-        if (detailed_stats) {
-          const int32 eps = -1;
-          PrintAlignmentStats(ref_sent, hyp_sent, eps, stats_output.Stream());
-        }
-        num_sent++;
-        sent_errs += (ref_sent != hyp_sent);
-      }
+      const int32 eps = -1;
+      num_absent_sents = ScoreAllUtterances<int32, SequentialInt32VectorReader,
+                                            RandomAccessInt32VectorReader>(
+          ref_rspecifier, hyp_rspecifier, mode, eps, batch_size,
+          sequencer_config, stats_stream, &stats);
     } else {
-      SequentialTokenVectorReader ref_reader(ref_rspecifier);
-      RandomAccessTokenVectorReader hyp_reader(hyp_rspecifier);
-
-      for (; !ref_reader.Done(); ref_reader.Next()) {
-        std::string key = ref_reader.Key();
-        const std::vector<std::string> &ref_sent = ref_reader.Value();
-        std::vector<std::string> hyp_sent;
-        if (!hyp_reader.HasKey(key)) {
-          if (mode == "strict")
-            KALDI_ERR << "No hypothesis for key " << key << " and strict "
-                "mode specifier.";
-          num_absent_sents++;
-          if (mode == "present")  // do not score this one.
-            continue;
-        } else {
-          hyp_sent = hyp_reader.Value(key);
-        }
-        num_words += ref_sent.size();
-        int32 ins, del, sub;
-        word_errs += LevenshteinEditDistance(ref_sent, hyp_sent,
-                                             &ins, &del, &sub);
-        num_ins += ins;
-        num_del += del;
-        num_sub += sub;
-
-        if (detailed_stats) {
-          const std::string eps = "";
-          PrintAlignmentStats(ref_sent, hyp_sent, eps, stats_output.Stream());
-        }
-        num_sent++;
-        sent_errs += (ref_sent != hyp_sent);
-      }
+      const std::string eps = "";
+      num_absent_sents = ScoreAllUtterances<std::string,
+                                            SequentialTokenVectorReader,
+                                            RandomAccessTokenVectorReader>(
+          ref_rspecifier, hyp_rspecifier, mode, eps, batch_size,
+          sequencer_config, stats_stream, &stats);
     }
+    int32 num_words = stats.num_words, word_errs = stats.word_errs,
+        num_sent = stats.num_sent, sent_errs = stats.sent_errs,
+        num_ins = stats.num_ins, num_del = stats.num_del,
+        num_sub = stats.num_sub;
 
     BaseFloat percent_wer = 100.0 * static_cast<BaseFloat>(word_errs)
         / static_cast<BaseFloat>(num_words);
@@ -46,6 +46,7 @@ int main(int argc, char *argv[]) {
     bool binary = true;
     BaseFloat acoustic_scale = 0.1;
     bool allow_partial = true;
+    bool compressed_loglikes = false;
     std::string word_syms_filename;
     FasterDecoderOptions decoder_opts;
     decoder_opts.Register(&po, true);  // true == include obscure settings.
@@ -53,6 +54,11 @@ int main(int argc, char *argv[]) {
     po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for acoustic likelihoods");
     po.Register("allow-partial", &allow_partial, "Produce output even when final state was not reached");
     po.Register("word-symbol-table", &word_syms_filename, "Symbol table for words [for debug output]");
+    po.Register("compressed-loglikes", &compressed_loglikes, "If true, keep "
+                "the log-likelihoods in memory in row-compressed form (about "
+                "1 byte per element) and uncompress them as the decoder needs "
+                "them; best with input written by nnet-forward --compress=true. "
+                "Other matrices are compressed on reading, which is lossy.");
 
     po.Read(argc, argv);
 
@@ -81,7 +87,10 @@ int main(int argc, char *argv[]) {
         KALDI_ERR << "Could not read symbol table from file "<<word_syms_filename;
     }
 
-    SequentialBaseFloatMatrixReader loglikes_reader(loglikes_rspecifier);
+    SequentialBaseFloatMatrixReader loglikes_reader;
+    SequentialRowCompressedMatrixReader compressed_loglikes_reader;
+    if (compressed_loglikes) compressed_loglikes_reader.Open(loglikes_rspecifier);
+    else loglikes_reader.Open(loglikes_rspecifier);
 
     // It's important that we initialize decode_fst after loglikes_reader, as it
     // can prevent crashes on systems installed without enough virtual memory.
@@ -97,18 +106,31 @@ int main(int argc, char *argv[]) {
 
     Timer timer;
 
-    for (; !loglikes_reader.Done(); loglikes_reader.Next()) {
-      std::string key = loglikes_reader.Key();
-      const Matrix<BaseFloat> &loglikes (loglikes_reader.Value());
-
-      if (loglikes.NumRows() == 0) {
+    for (; compressed_loglikes ? !compressed_loglikes_reader.Done() :
+             !loglikes_reader.Done();
+         compressed_loglikes ? compressed_loglikes_reader.Next() :
+             loglikes_reader.Next()) {
+      std::string key = (compressed_loglikes ? compressed_loglikes_reader.Key() :
+                         loglikes_reader.Key());
+      int32 num_frames = (compressed_loglikes ?
+                          compressed_loglikes_reader.Value().NumRows() :
+                          loglikes_reader.Value().NumRows());
+
+      if (num_frames == 0) {
         KALDI_WARN << "Zero-length utterance: " << key;
         num_fail++;
         continue;
       }
 
-      DecodableMatrixScaledMapped decodable(trans_model, loglikes, acoustic_scale);
-      decoder.Decode(&decodable);
+      if (compressed_loglikes) {
+        DecodableRowCompressedMatrixScaledMapped decodable(
+            trans_model, compressed_loglikes_reader.Value(), acoustic_scale);
+        decoder.Decode(&decodable);
+      } else {
+        DecodableMatrixScaledMapped decodable(
+            trans_model, loglikes_reader.Value(), acoustic_scale);
+        decoder.Decode(&decodable);
+      }
 
       VectorFst<LatticeArc> decoded;  // linear FST.
 
@@ -121,7 +143,7 @@ int main(int argc, char *argv[]) {
         std::vector<int32> alignment;
         std::vector<int32> words;
         LatticeWeight weight;
-        frame_count += loglikes.NumRows();
+        frame_count += num_frames;
 
         GetLinearSymbolSequence(decoded, &alignment, &words, &weight);
 
@@ -141,13 +163,13 @@ int main(int argc, char *argv[]) {
         BaseFloat like = -weight.Value1() -weight.Value2();
         tot_like += like;
         KALDI_LOG << "Log-like per frame for utterance " << key << " is "
-                  << (like / loglikes.NumRows()) << " over "
-                  << loglikes.NumRows() << " frames.";
+                  << (like / num_frames) << " over "
+                  << num_frames << " frames.";
 
       } else {
         num_fail++;
         KALDI_WARN << "Did not successfully decode utterance " << key
-                   << ", len = " << loglikes.NumRows();
+                   << ", len = " << num_frames;
       }
     }
 
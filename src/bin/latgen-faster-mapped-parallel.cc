@@ -67,6 +67,10 @@ int main(int argc, char *argv[]) {
       exit(1);
     }
 
+    // With many decoding threads, queue log messages rather than having the
+    // threads wait for stderr.
+    if (sequencer_config.num_threads > 1) SetLogAsync(true);
+
     std::string model_in_filename = po.GetArg(1),
         fst_in_str = po.GetArg(2),
         feature_rspecifier = po.GetArg(3),
@@ -100,12 +104,17 @@ int main(int argc, char *argv[]) {
     int num_success = 0, num_fail = 0;
     VectorFst<StdArc> *decode_fst = NULL; // only used if there is a single
                                           // decoding graph.
+    NumaReplicated<fst::Fst<StdArc> > *graph = NULL;  // likewise.
     
     TaskSequencer<DecodeUtteranceLatticeFasterClass> sequencer(sequencer_config);
     if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) {
       SequentialBaseFloatMatrixReader loglike_reader(feature_rspecifier);
       // Input FST is just one FST, not a table of FSTs.
       decode_fst = fst::ReadFstKaldi(fst_in_str);
+      // With --numa-policy, each NUMA node gets its own copy of the graph.
+      graph = new NumaReplicated<fst::Fst<StdArc> >(*decode_fst,
+                                                    g_numa_policy != "none",
+                                                    fst::CopyDecodingGraph);
 
       {
         for (; !loglike_reader.Done(); loglike_reader.Next()) {
@@ -120,16 +129,16 @@ int main(int argc, char *argv[]) {
             continue;
           }
       
-          LatticeFasterDecoder *decoder = new LatticeFasterDecoder(*decode_fst,
-                                                                   config);
           DecodableMatrixScaledMapped *decodable = 
               new DecodableMatrixScaledMapped(trans_model, acoustic_scale, loglikes);
+          // The decoder is created by the task, in the decoding thread.
           DecodeUtteranceLatticeFasterClass *task =
               new DecodeUtteranceLatticeFasterClass(
-                  decoder, decodable, trans_model, word_syms, utt,
+                  NULL, decodable, trans_model, word_syms, utt,
                   acoustic_scale, determinize, allow_partial, &alignment_writer,
                   &words_writer, &compact_lattice_writer, &lattice_writer,
-                  &tot_like, &frame_count, &num_success, &num_fail, NULL);
+                  &tot_like, &frame_count, &num_success, &num_fail, NULL,
+                  graph, &config);
 
           sequencer.Run(task); // takes ownership of "task",
           // and will delete it when done.
@@ -170,6 +179,7 @@ int main(int argc, char *argv[]) {
     }
     sequencer.Wait();
 
+    delete graph;
     if (decode_fst != NULL) delete decode_fst;
       
     double elapsed = timer.Elapsed();
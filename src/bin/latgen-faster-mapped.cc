@@ -46,6 +46,7 @@ int main(int argc, char *argv[]) {
     ParseOptions po(usage);
     Timer timer;
     bool allow_partial = false;
+    bool compressed_loglikes = false;
     BaseFloat acoustic_scale = 0.1;
     LatticeFasterDecoderConfig config;
     
@@ -55,6 +56,11 @@ int main(int argc, char *argv[]) {
 
     po.Register("word-symbol-table", &word_syms_filename, "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial, "If true, produce output even if end state was not reached.");
+    po.Register("compressed-loglikes", &compressed_loglikes, "If true, keep "
+                "the log-likelihoods in memory in row-compressed form (about "
+                "1 byte per element) and uncompress them as the decoder needs "
+                "them; best with input written by nnet-forward --compress=true. "
+                "Other matrices are compressed on reading, which is lossy.");
     
     po.Read(argc, argv);
 
@@ -96,66 +102,111 @@ int main(int argc, char *argv[]) {
     int num_success = 0, num_fail = 0;
 
     if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) {
-      SequentialBaseFloatMatrixReader loglike_reader(feature_rspecifier);
+      SequentialBaseFloatMatrixReader loglike_reader;
+      SequentialRowCompressedMatrixReader compressed_loglike_reader;
+      if (compressed_loglikes) compressed_loglike_reader.Open(feature_rspecifier);
+      else loglike_reader.Open(feature_rspecifier);
       // Input FST is just one FST, not a table of FSTs.
       VectorFst<StdArc> *decode_fst = fst::ReadFstKaldi(fst_in_str);
 
       {
         LatticeFasterDecoder decoder(*decode_fst, config);
     
-        for (; !loglike_reader.Done(); loglike_reader.Next()) {
-          std::string utt = loglike_reader.Key();
-          Matrix<BaseFloat> loglikes (loglike_reader.Value());
-          loglike_reader.FreeCurrent();
-          if (loglikes.NumRows() == 0) {
+        for (; compressed_loglikes ? !compressed_loglike_reader.Done() :
+                 !loglike_reader.Done();
+             compressed_loglikes ? compressed_loglike_reader.Next() :
+                 loglike_reader.Next()) {
+          std::string utt;
+          DecodableInterface *decodable;
+          int32 num_frames;
+          if (compressed_loglikes) {
+            utt = compressed_loglike_reader.Key();
+            RowCompressedMatrix *loglikes =
+                new RowCompressedMatrix(compressed_loglike_reader.Value());
+            compressed_loglike_reader.FreeCurrent();
+            num_frames = loglikes->NumRows();
+            if (num_frames == 0) {
+              delete loglikes;
+              decodable = NULL;
+            } else {
+              decodable = new DecodableRowCompressedMatrixScaledMapped(
+                  trans_model, acoustic_scale, loglikes);  // takes ownership.
+            }
+          } else {
+            utt = loglike_reader.Key();
+            Matrix<BaseFloat> *loglikes =
+                new Matrix<BaseFloat>(loglike_reader.Value());
+            loglike_reader.FreeCurrent();
+            num_frames = loglikes->NumRows();
+            if (num_frames == 0) {
+              delete loglikes;
+              decodable = NULL;
+            } else {
+              decodable = new DecodableMatrixScaledMapped(
+                  trans_model, acoustic_scale, loglikes);  // takes ownership.
+            }
+          }
+          if (decodable == NULL) {
             KALDI_WARN << "Zero-length utterance: " << utt;
             num_fail++;
             continue;
           }
-      
-          DecodableMatrixScaledMapped decodable(trans_model, loglikes, acoustic_scale);
 
           double like;
           if (DecodeUtteranceLatticeFaster(
-                  decoder, decodable, trans_model, word_syms, utt,
+                  decoder, *decodable, trans_model, word_syms, utt,
                   acoustic_scale, determinize, allow_partial, &alignment_writer,
                   &words_writer, &compact_lattice_writer, &lattice_writer,
                   &like)) {
             tot_like += like;
-            frame_count += loglikes.NumRows();
+            frame_count += num_frames;
             num_success++;
           } else num_fail++;
+          delete decodable;
         }
       }
       delete decode_fst; // delete this only after decoder goes out of scope.
     } else { // We have different FSTs for different utterances.
       SequentialTableReader<fst::VectorFstHolder> fst_reader(fst_in_str);
-      RandomAccessBaseFloatMatrixReader loglike_reader(feature_rspecifier);          
+      RandomAccessBaseFloatMatrixReader loglike_reader;
+      RandomAccessRowCompressedMatrixReader compressed_loglike_reader;
+      if (compressed_loglikes) compressed_loglike_reader.Open(feature_rspecifier);
+      else loglike_reader.Open(feature_rspecifier);
       for (; !fst_reader.Done(); fst_reader.Next()) {
         std::string utt = fst_reader.Key();
-        if (!loglike_reader.HasKey(utt)) {
+        if (compressed_loglikes ? !compressed_loglike_reader.HasKey(utt) :
+            !loglike_reader.HasKey(utt)) {
           KALDI_WARN << "Not decoding utterance " << utt
                      << " because no loglikes available.";
           num_fail++;
           continue;
         }
-        const Matrix<BaseFloat> &loglikes = loglike_reader.Value(utt);
-        if (loglikes.NumRows() == 0) {
+        int32 num_frames = (compressed_loglikes ?
+                            compressed_loglike_reader.Value(utt).NumRows() :
+                            loglike_reader.Value(utt).NumRows());
+        if (num_frames == 0) {
           KALDI_WARN << "Zero-length utterance: " << utt;
           num_fail++;
           continue;
         }
         LatticeFasterDecoder decoder(fst_reader.Value(), config);
-        DecodableMatrixScaledMapped decodable(trans_model, loglikes, acoustic_scale);
+        DecodableInterface *decodable;
+        if (compressed_loglikes)
+          decodable = new DecodableRowCompressedMatrixScaledMapped(
+              trans_model, compressed_loglike_reader.Value(utt), acoustic_scale);
+        else
+          decodable = new DecodableMatrixScaledMapped(
+              trans_model, loglike_reader.Value(utt), acoustic_scale);
         double like;
         if (DecodeUtteranceLatticeFaster(
-                decoder, decodable, trans_model, word_syms, utt, acoustic_scale,
+                decoder, *decodable, trans_model, word_syms, utt, acoustic_scale,
                 determinize, allow_partial, &alignment_writer, &words_writer,
                 &compact_lattice_writer, &lattice_writer, &like)) {
           tot_like += like;
-          frame_count += loglikes.NumRows();
+          frame_count += num_frames;
           num_success++;
         } else num_fail++;
+        delete decodable;
       }
     }
       
@@ -57,12 +57,12 @@ int main(int argc, char *argv[]) {
     }
 
     int32 num_done = 0;
-    SequentialPosteriorReader posterior_reader(posteriors_rspecifier);
-    PosteriorWriter posterior_writer(posteriors_wspecifier);
-    
+    SequentialCompactPosteriorReader posterior_reader(posteriors_rspecifier);
+    CompactPosteriorWriter posterior_writer(posteriors_wspecifier);
+
+    CompactPosterior pdf_posterior;  // reused, to avoid reallocation.
     for (; !posterior_reader.Done(); posterior_reader.Next()) {
-      const kaldi::Posterior &posterior = posterior_reader.Value();
-      kaldi::Posterior pdf_posterior;
+      const CompactPosterior &posterior = posterior_reader.Value();
       ConvertPosteriorToPdfs(trans_model, posterior, &pdf_posterior);
       posterior_writer.Write(posterior_reader.Key(), pdf_posterior);
       num_done++;
@@ -60,13 +60,12 @@ int main(int argc, char *argv[]) {
       ReadBuildTreeStats(ki.Stream(), binary_in, example, &stats_array);
       for (BuildTreeStatsType::iterator iter = stats_array.begin();
            iter != stats_array.end(); ++iter) {
-        EventType e = iter->first;
         Clusterable *c = iter->second;
-        std::map<EventType, Clusterable*>::iterator map_iter = tree_stats.find(e);
-        if (map_iter == tree_stats.end()) { // Not already present.
-          tree_stats[e] = c;
-        } else {
-          map_iter->second->Add(*c);
+        // insert() does nothing if the event is already present.
+        std::pair<std::map<EventType, Clusterable*>::iterator, bool> ans =
+            tree_stats.insert(*iter);
+        if (!ans.second) {
+          ans.first->second->Add(*c);
           delete c;
         }
       }
@@ -75,14 +75,12 @@ int main(int argc, char *argv[]) {
     ReadKaldiObject(model_rxfilename, &trans_model);
 
     int32 num_posteriors = 0;
-    SequentialPosteriorReader posterior_reader(posteriors_rspecifier);
-    PosteriorWriter posterior_writer(posteriors_wspecifier);
+    SequentialCompactPosteriorReader posterior_reader(posteriors_rspecifier);
+    CompactPosteriorWriter posterior_writer(posteriors_wspecifier);
 
     for (; !posterior_reader.Done(); posterior_reader.Next()) {
       num_posteriors++;
-      // Posterior is vector<vector<pair<int32, BaseFloat> > >
-      Posterior post = posterior_reader.Value();
-      // Posterior is vector<vector<pair<int32, BaseFloat> > >
+      CompactPosterior post = posterior_reader.Value();
       if (distribute)
         WeightSilencePostDistributed(trans_model, silence_set,
                                      silence_weight, &post);
@@ -27,6 +27,7 @@
 #include "cudamatrix/cu-block-matrix.h"
 #include "cudamatrix/cu-matrix.h"
 #include "cudamatrix/cu-device.h"
+#include "util/stl-utils.h"
 
 namespace kaldi {
 
@@ -228,7 +229,12 @@ void CuBlockMatrix<Real>::AddMatMat(
                && A_num_cols == B_num_rows);
   if (NumBlocks() == 0) return; // empty matrix.
 #if HAVE_CUDA == 1
-  if (CuDevice::Instantiate().Enabled()) {
+  // The kernel below reads its inputs straight from global memory, which is
+  // slow unless the blocks are very small; for blocks that are at least as
+  // wide as a tile of the AddMatMatBatched() kernel, and of the same size, we
+  // use AddMatMatBatched() (which uses cuBLAS for large blocks).
+  if (CuDevice::Instantiate().Enabled() &&
+      !(MaxBlockCols() >= CU2DBLOCK && HasUniformBlocks())) {
     Timer tim;
 
     // (x,y,z) dimensions are (block-id, row-of-block, col-of-block)
@@ -255,26 +261,40 @@ void CuBlockMatrix<Real>::AddMatMat(
   } else
 #endif
   {
+    std::vector<CuSubMatrix<Real>*> this_blocks(NumBlocks()),
+        A_parts(NumBlocks()), B_parts(NumBlocks());
     int32 row_offset = 0, col_offset = 0;    
     for (MatrixIndexT b = 0; b < NumBlocks(); b++) {
-      CuSubMatrix<Real> this_block = Block(b);
-      MatrixIndexT this_num_rows = this_block.NumRows(),
-          this_num_cols = this_block.NumCols();
-      CuSubMatrix<Real> A_part = (transA == kNoTrans ?
-                                  A.Range(row_offset, this_num_rows,
+      CuSubMatrix<Real> *this_block = new CuSubMatrix<Real>(Block(b));
+      MatrixIndexT this_num_rows = this_block->NumRows(),
+          this_num_cols = this_block->NumCols();
+      this_blocks[b] = this_block;
+      A_parts[b] = (transA == kNoTrans ?
+                    new CuSubMatrix<Real>(A, row_offset, this_num_rows,
                                           0, A.NumCols()) :
-                                  A.Range(0, A.NumRows(),
-                                          row_offset, this_num_rows)),
-          B_part = (transB == kNoTrans ?
-                    B.Range(0, B.NumRows(),
-                            col_offset, this_num_cols) :
-                    B.Range(col_offset, this_num_cols,
-                            0, B.NumCols()));
-      this_block.AddMatMat(alpha, A_part, transA, B_part, transB, beta);
+                    new CuSubMatrix<Real>(A, 0, A.NumRows(),
+                                          row_offset, this_num_rows));
+      B_parts[b] = (transB == kNoTrans ?
+                    new CuSubMatrix<Real>(B, 0, B.NumRows(),
+                                          col_offset, this_num_cols) :
+                    new CuSubMatrix<Real>(B, col_offset, this_num_cols,
+                                          0, B.NumCols()));
       row_offset += this_num_rows;
       col_offset += this_num_cols;
     }
     KALDI_ASSERT(row_offset == NumRows() && col_offset == NumCols());
+    AddMatMatBatched(static_cast<Real>(alpha),
+                     std::vector<CuMatrixBase<Real>*>(this_blocks.begin(),
+                                                      this_blocks.end()),
+                     std::vector<const CuMatrixBase<Real>*>(A_parts.begin(),
+                                                            A_parts.end()),
+                     transA,
+                     std::vector<const CuMatrixBase<Real>*>(B_parts.begin(),
+                                                            B_parts.end()),
+                     transB, static_cast<Real>(beta));
+    DeletePointers(&this_blocks);
+    DeletePointers(&A_parts);
+    DeletePointers(&B_parts);
   }
 }
 
@@ -291,6 +311,15 @@ MatrixIndexT CuBlockMatrix<Real>::MaxBlockRows() const {
   return data_.NumRows();
 }
 
+template<class Real>
+bool CuBlockMatrix<Real>::HasUniformBlocks() const {
+  for (size_t i = 1; i < block_data_.size(); i++)
+    if (block_data_[i].num_rows != block_data_[0].num_rows ||
+        block_data_[i].num_cols != block_data_[0].num_cols)
+      return false;
+  return true;
+}
+
 template<class Real>
 void CuBlockMatrix<Real>::CopyFromMat(const CuMatrix<Real> &M) {
   KALDI_ASSERT(NumRows() == M.NumRows() && NumCols() == M.NumCols());
@@ -79,6 +79,9 @@ class CuBlockMatrix {
 
   // Returns max num-rows of any block
   MatrixIndexT MaxBlockRows() const;
+
+  // Returns true if all the blocks have the same dimensions.
+  bool HasUniformBlocks() const;
     
   const CuSubMatrix<Real> Block(MatrixIndexT b) const;
 
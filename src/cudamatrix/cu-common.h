@@ -72,6 +72,8 @@ template<typename Real> class CuSpMatrix;
 template<typename Real> class CuTpMatrix;
 
 template<typename Real> class CuBlockMatrix; // this has no non-CU counterpart.
+template<typename Real> class CuLevelledGraph; // nor does this.
+class CuViterbiDecoder;
 
 
 }
@@ -32,17 +32,51 @@
 #include <algorithm>
 #include <dlfcn.h>
 #include <unistd.h> // for sleep
+#include <stdint.h> // for intptr_t
 
 #include "cudamatrix/cu-common.h"
 #include "cudamatrix/cu-device.h"
 #include "base/kaldi-error.h"
 #include "util/common-utils.h"
+#include "util/kaldi-profile.h"
 
 namespace kaldi {
 
 
-/** 
- * SelectGpuId(use_gpu) 
+/// The state we keep for each GPU in use.  The mutex guards the allocator and
+/// the profile, as several threads may be bound to the same device.
+struct CuDeviceContext {
+  int32 gpu_id;
+  cudaDeviceProp properties;
+  int64 free_memory_at_startup;
+  CuAllocator *allocator;
+  cudaStream_t copy_stream;
+  std::map<std::string, double> profile_map;
+  int32 trace_track;  // The row of the profiling timeline for this GPU.
+  pthread_mutex_t mutex;
+
+  // Defined below, after class CuAllocator.
+  CuDeviceContext(int32 gpu_id, CuDevice *device, bool cache_memory);
+  ~CuDeviceContext();
+};
+
+namespace {
+// Locks a CuDeviceContext's mutex for the lifetime of this object.
+class ContextLock {
+ public:
+  explicit ContextLock(CuDeviceContext *context): mutex_(&context->mutex) {
+    if (pthread_mutex_lock(mutex_) != 0)
+      KALDI_ERR << "Error locking mutex";
+  }
+  ~ContextLock() { pthread_mutex_unlock(mutex_); }
+ private:
+  pthread_mutex_t *mutex_;
+};
+}  // namespace
+
+
+/**
+ * SelectGpuId(use_gpu)  
  *
  * There are 3 'use_gpu' modes for GPU selection:
  * "yes"      -- Select GPU automatically (or get one by exclusive mode) 
@@ -68,7 +102,7 @@ void CuDevice::SelectGpuId(std::string use_gpu) {
  
   // Make sure this function is not called twice!
   if (Enabled()) {
-    KALDI_ERR << "There is already an active GPU " << active_gpu_id_ 
+    KALDI_ERR << "There is already an active GPU " << ActiveGpuId()
               << ", cannot change it on the fly!";
   }
   // Allow the GPU to stay disabled
@@ -147,6 +181,38 @@ void CuDevice::SelectGpuId(std::string use_gpu) {
 }
 
 
+void CuDevice::SelectGpuIds(const std::vector<int32> &gpu_ids_in) {
+  if (Enabled()) {
+    KALDI_ERR << "There is already an active GPU " << ActiveGpuId()
+              << ", cannot change it on the fly!";
+  }
+  int32 n_gpu = 0;
+  cudaGetDeviceCount(&n_gpu);
+  if (n_gpu == 0)
+    KALDI_ERR << "No CUDA GPU detected!";
+  std::vector<int32> gpu_ids(gpu_ids_in);
+  if (gpu_ids.empty())
+    for (int32 n = 0; n < n_gpu; n++)
+      gpu_ids.push_back(n);
+  for (size_t i = 0; i < gpu_ids.size(); i++) {
+    int32 gpu_id = gpu_ids[i];
+    if (gpu_id < 0 || gpu_id >= n_gpu)
+      KALDI_ERR << "Invalid GPU id " << gpu_id << ": we have " << n_gpu
+                << " GPUs.";
+    if (std::count(gpu_ids.begin(), gpu_ids.begin() + i, gpu_id) != 0)
+      KALDI_ERR << "GPU id " << gpu_id << " listed twice.";
+    cudaError_t e = cudaSetDevice(gpu_id);
+    if (e == cudaSuccess)
+      e = cudaThreadSynchronize(); //<< CUDA context gets created here.
+    if (e != cudaSuccess)
+      KALDI_ERR << "Failed to create CUDA context on GPU " << gpu_id << ": "
+                << cudaGetErrorString(e);
+    FinalizeActiveGpu();
+  }
+  BindThread(0);
+}
+
+
 void CuDevice::FinalizeActiveGpu() {
   // The device at this point should have active GPU, so we can query its name
   // and memory stats and notify user which GPU is finally used.
@@ -159,20 +225,32 @@ void CuDevice::FinalizeActiveGpu() {
     if(e != cudaSuccess) {
       KALDI_ERR << "Failed to get device-id of active device.";
     }
-    // Remember the id of active GPU 
-    active_gpu_id_ = act_gpu_id; //CuDevice::Enabled() is true from now on
+    // Set up the context for this GPU; CuDevice::Enabled() is true from now
+    // on.
+    CuDeviceContext *context = new CuDeviceContext(act_gpu_id, this,
+                                                   cache_memory_);
+    contexts_.push_back(context);
+    BindThread(contexts_.size() - 1);
     // Initialize the CUBLAS
     CU_SAFE_CALL(cublasInit());
+    // The stream for asynchronous copies; it is non-blocking so that copies
+    // on it do not wait for the kernels on the default stream.
+    CU_SAFE_CALL(cudaStreamCreateWithFlags(&context->copy_stream,
+                                           cudaStreamNonBlocking));
 
     // Notify user which GPU is finally used
     char name[128];
     DeviceGetName(name,128,act_gpu_id);
 
-    CU_SAFE_CALL(cudaGetDeviceProperties(&properties_, act_gpu_id));
-    
+    CU_SAFE_CALL(cudaGetDeviceProperties(&context->properties, act_gpu_id));
+    std::ostringstream track_name;
+    track_name << "GPU " << act_gpu_id;
+    context->trace_track = Profiler::TrackId(track_name.str());
+
     KALDI_LOG << "The active GPU is [" << act_gpu_id << "]: " << name << "\t"
-              << GetFreeMemory(&free_memory_at_startup_, NULL) << " version "
-              << properties_.major << "." << properties_.minor;
+              << GetFreeMemory(&context->free_memory_at_startup, NULL)
+              << " version " << context->properties.major << "."
+              << context->properties.minor;
 
     if (verbose_) PrintMemoryUsage();
   }
@@ -180,9 +258,53 @@ void CuDevice::FinalizeActiveGpu() {
 }
 
 
+void CuDevice::BindThread(int32 device) {
+  KALDI_ASSERT(device >= 0 && device < NumDevices());
+  CU_SAFE_CALL(cudaSetDevice(contexts_[device]->gpu_id));
+  intptr_t value = device + 1;  // zero means "not bound".
+  if (pthread_setspecific(thread_device_key_,
+                          reinterpret_cast<void*>(value)) != 0)
+    KALDI_ERR << "Error setting thread-specific data";
+}
+
+
+int32 CuDevice::ThreadDevice() const {
+  KALDI_ASSERT(Enabled());
+  intptr_t value = reinterpret_cast<intptr_t>(
+      pthread_getspecific(thread_device_key_));
+  return (value == 0 ? 0 : value - 1);
+}
+
+
+CuDeviceContext &CuDevice::Context() const {
+  KALDI_ASSERT(Enabled());
+  intptr_t value = reinterpret_cast<intptr_t>(
+      pthread_getspecific(thread_device_key_));
+  if (value == 0) {
+    // A thread that was never bound uses device 0; we have to make it current
+    // for this thread, as the CUDA runtime starts each thread on GPU 0.
+    const_cast<CuDevice*>(this)->BindThread(0);
+    value = 1;
+  }
+  return *(contexts_[value - 1]);
+}
+
+
+int32 CuDevice::ActiveGpuId() {
+  return (Enabled() ? Context().gpu_id : -1);
+}
+
+
+cudaStream_t CuDevice::CopyStream() const {
+  return Context().copy_stream;
+}
+
+
 bool CuDevice::DoublePrecisionSupported() {
   if (!Enabled()) return true;
-  return properties_.major > 1 || (properties_.major == 1 && properties_.minor >= 3);
+  const cudaDeviceProp &properties = Context().properties;
+  return properties.major > 1 ||
+      (properties.major == 1 && properties.minor >= 3);
   // Double precision is supported from version 1.3
 }
 
@@ -299,37 +421,33 @@ bool CuDevice::SelectGpuIdAuto() {
 }
 
 
-void CuDevice::AccuProfile(const std::string &key, double time) { 
-  if (profile_map_.find(key) == profile_map_.end()) {
-    profile_map_[key] = 0.0;
+void CuDevice::AccuProfile(const std::string &key, double time) {
+  CuDeviceContext &context = Context();
+  if (Profiler::TraceEnabled()) {
+    // The cudamatrix functions synchronize with the GPU before they call this,
+    // so the call ended now, and took "time".
+    double now = Profiler::Now();
+    Profiler::AddTraceEvent(Profiler::RegionId(key.c_str()), now - time, now,
+                            "", context.trace_track);
   }
-  profile_map_[key] += time;
+  ContextLock lock(&context);
+  context.profile_map[key] += time;
 }
 
 void CuDevice::PrintMemoryUsage() const {
   if (Enabled()) {
     int64 free_memory_now;
     GetFreeMemory(&free_memory_now, NULL);
-    KALDI_LOG << "Memory used: " << (free_memory_at_startup_ - free_memory_now) << " bytes.";
+    KALDI_LOG << "Memory used: "
+              << (Context().free_memory_at_startup - free_memory_now)
+              << " bytes.";
   }
 }
 
-void CuDevice::PrintProfile() {
-  if (verbose_ && Enabled()) { 
-    std::ostringstream os;
-    os << "-----\n[cudevice profile]\n";
-    std::map<std::string, double>::iterator it;
-    std::vector<std::pair<double, std::string> > pairs;
-    for(it = profile_map_.begin(); it != profile_map_.end(); ++it)
-      pairs.push_back(std::make_pair(it->second, it->first));
-    std::sort(pairs.begin(), pairs.end());
-    size_t max_print = 15, start_pos = (pairs.size() <= max_print ?
-                                        0 : pairs.size() - max_print);
-    for (size_t i = start_pos; i < pairs.size(); i++) 
-      os << pairs[i].second << "\t" << pairs[i].first << "s\n";
-    os << "-----";
-    KALDI_LOG << os.str();
-    PrintMemoryUsage();
+void CuDevice::ResetProfile() {
+  for (size_t i = 0; i < contexts_.size(); i++) {
+    ContextLock lock(contexts_[i]);
+    contexts_[i]->profile_map.clear();
   }
 }
 
@@ -410,23 +528,31 @@ void CuDevice::DeviceGetName(char* name, int32 len, int32 dev) {
 
 struct CuAllocatorOptions {
   bool cache_memory; // Enable GPU memory caching, (false = disable).
-  int32 count; // Number of times we free and delete a particular size before we
-               // start to cache it.
-  int32 cleanup_interval_bytes;
+  size_t region_bytes; // The (minimum) size of the regions of device memory
+                       // we get from cudaMalloc and divide up.
   CuAllocatorOptions()
-   : cache_memory(true), count(1), cleanup_interval_bytes(1000000) { }
+   : cache_memory(true), region_bytes(64 << 20) { }
 };
 
 
 /// We define class CuAllocator inside the .cc file, because we don't want to
-/// expose it in the header.  Its purpose is to hang on to memory that we have
-/// freed, so that we don't waste time in cudaMalloc and cudaMallocPitch().
-/// For some reason, they are sometimes very slow.
+/// expose it in the header.  Its purpose is to avoid the time taken in
+/// cudaMalloc and cudaMallocPitch() (which are sometimes very slow), and the
+/// synchronization that cudaFree() implies.  It gets large regions of memory
+/// from cudaMalloc, and divides them into blocks.  Each region is a sequence of
+/// contiguous blocks, each either in use or free; when a block is freed it is
+/// merged with any free neighbours, so the memory does not get fragmented into
+/// many small pieces when the sizes requested vary (e.g. with varying
+/// minibatch sizes).  The free blocks are kept in bins by size class (powers of
+/// two), and we allocate from the smallest free block that is large enough,
+/// splitting it if necessary.  Pitched allocations are done by rounding the
+/// row size up to a multiple of kAlignment.
 class CuAllocator {
  public:
   CuAllocator(const CuAllocatorOptions &opts, CuDevice *device):
-      device_(device), opts_(opts),
-      cleanup_countdown_bytes_(opts.cleanup_interval_bytes) { }
+      device_(device), opts_(opts), bins_(kNumBins),
+      region_bytes_(0), used_bytes_(0), peak_used_bytes_(0),
+      num_mallocs_(0), num_cuda_mallocs_(0) { }
   
   inline void *Malloc(size_t size);
   
@@ -436,339 +562,381 @@ class CuAllocator {
 
   inline void DisableCaching();
 
+  /// Prints statistics about the memory use (called from PrintProfile()).
+  void PrintStats() const;
+
   ~CuAllocator();
  private:
-  inline void *MallocInternal(size_t row_bytes, size_t num_rows, size_t *pitch);
-  
-  // struct MemInfoForSize stores information associated with a particular size
-  // of allocated memory.  The row_bytes and num_rows refer to the arguments of
-  // a cudaMallocPitch call; for regular, non-pitch allocations with cudaMalloc,
-  // we make "row_bytes" zero and the size in bytes is "num_rows"... there is a
-  // reason why we do it this way round (make num_rows contain the size in
-  // bytes); it relates to the ordering of the map, and the behavior when
-  // we didn't find the exact size and want to find larger match.
-
-  
-  struct MemInfoForSize {
-    size_t row_bytes; // or zero, if a regular CudaMalloc, not
-                      // CudaMallocPitch.
-    size_t num_rows; // or the number of rows, if it's a regular CudaMalloc
-                     // call, not CudaMallocPitch.
-    size_t pitch; // If CudaMallocPitch, the pitch returned by CudaMallocPitch;
-                  // this code assumes (and checks) that it's a deterministic
-                  // function of row_bytes and num_rows.
-    size_t countdown; // number that have been freed and not cached.
-    size_t currently_used; // number that are "in the wild".. kept for
-                           // diagnostics and error detection.
-    std::vector<void*> freed; // freed and cached...
-      
-    MemInfoForSize(size_t row_bytes,
-                   size_t num_rows,
-                   int32 count):
-        row_bytes(row_bytes),
-        num_rows(num_rows),
-        pitch(0),
-        countdown(count),
-        currently_used(0) { }
+  // All block sizes and offsets are multiples of this, and so is the pitch of
+  // pitched allocations (cudaMallocPitch gives a pitch that is a multiple of
+  // 256 or 512 bytes, depending on the device).
+  static const size_t kAlignment = 256;
+  static const int32 kNumBins = 64;
+
+  // A Block is a contiguous piece of a region; the blocks of a region are in a
+  // doubly linked list in order of address.
+  struct Block {
+    char *data;
+    size_t size;
+    bool free;
+    Block *prev;  // The previous block in the region, or NULL.
+    Block *next;  // The next block in the region, or NULL.
   };
 
+  // The free blocks of size s are in bins_[Bin(s)], ordered by size and then
+  // address.
+  typedef std::set<std::pair<size_t, Block*> > BinType;
 
-  // FindMemInfo returns the MemInfoForSize object for this (row_bytes,
-  // num_rows) combination if it exists; otherwise...
-  // if there is a MemInfoForSize object with the same row_bytes and larger (but
-  // not more than twice larger) num_rows that has freed memory waiting, it
-  // returns that; otherwise, it returns a new MemInfoForSize object for the
-  // requested size).
-  
-  inline MemInfoForSize *FindMemInfo(size_t row_bytes,
-                                     size_t num_rows) {
-    if (row_bytes >= size_to_list_.size())
-      size_to_list_.resize(row_bytes + 1, NULL);
-    
-    // note: we set row_bytes to 0 for regular, linear allocation.
-    KALDI_ASSERT(num_rows != 0);
-
-    if (size_to_list_[row_bytes] == NULL)
-      size_to_list_[row_bytes] = new std::map<size_t, MemInfoForSize*>;
-
-
-    std::map<size_t, MemInfoForSize*> &size_to_list = *(size_to_list_[row_bytes]);
-
-    typedef std::map<size_t, MemInfoForSize* >::iterator IterType;
-
-    // get an iterator to the requested object or the next-larger one.
-    // Here, upper_bound(num_rows - 1) returns an object strictly greater
-    // than num_rows - 1, which could be num_rows itself.  We need to
-    // treat num_rows == 0 as a special case because of size_t being
-    // unsigned.
-    IterType iter = (num_rows == 0 ? size_to_list.begin() :
-                     size_to_list.upper_bound(num_rows - 1));
-    
-    if (iter != size_to_list.end() && iter->first == num_rows) {
-      // Found a MemInfoForSize object
-      // with the requested size -> return it.
-      KALDI_ASSERT(iter->second->row_bytes == row_bytes &&
-                   iter->second->num_rows == num_rows);
-      return iter->second;
-    } else if (iter != size_to_list.end() &&
-               iter->second->num_rows <= 2 * num_rows &&
-               !iter->second->freed.empty()) {
-      // Return the non-matching one with freed memory, which is larger than
-      // this one but not more than twice larger.
-      KALDI_ASSERT(iter->second->row_bytes == row_bytes &&
-                   iter->second->num_rows > num_rows); // confirm expectations.
-      return iter->second;
-    } else {
-      // There was no such object, and the next-larger object either did not
-      // exist, had more than twice the num-rows requested, or had no free
-      // memory -> create an object with the requested size.
-      return (size_to_list[num_rows] =  new MemInfoForSize(row_bytes, num_rows,
-                                                           opts_.count));
-    }
+  static int32 Bin(size_t size) {
+    int32 bin = 0;
+    while (size >>= 1) bin++;
+    return bin;
+  }
+
+  static size_t RoundUp(size_t size) {
+    return (size + kAlignment - 1) / kAlignment * kAlignment;
+  }
+
+  void AddToBin(Block *block) {
+    bins_[Bin(block->size)].insert(std::make_pair(block->size, block));
+  }
+
+  void RemoveFromBin(Block *block) {
+    bins_[Bin(block->size)].erase(std::make_pair(block->size, block));
   }
-                 
-  void PossiblyCleanup(size_t num_bytes);
 
-  // A periodic housekeeping task..
-  void Cleanup();
+  // Returns the smallest free block of at least "size" bytes, removed from its
+  // bin, or NULL if there is none.
+  Block *FindFreeBlock(size_t size);
 
-  // Frees all memory in the "freed" vectors; memory that the
-  // user freed but we held on to.  If destroy == true, also
-  // clean up all memory held in the size_to_list_ object (i.e.
-  // allocated maps and MemInfoForSize objects).
-  void ReleaseAllCachedMemory(bool destroy = false);
+  // Gets a new region of at least "size" bytes from cudaMalloc and returns
+  // it as a single block (not added to a bin).
+  Block *NewRegion(size_t size);
+
+  // The allocation, for an already-rounded size.
+  void *MallocInternal(size_t size);
+
+  // Frees (with cudaFree) the regions that are entirely free.
+  void ReleaseAllCachedMemory();
+
+  // Returns the number of bytes in free blocks, and sets *fragmented to the
+  // number of those bytes that are not in the largest free block of their
+  // region (i.e. that could not be used for an allocation as large as the
+  // largest one possible in that region).
+  size_t FreeBytes(size_t *fragmented) const;
 
   CuDevice *device_; // device this is attached to...
   CuAllocatorOptions opts_;
 
+  std::vector<BinType> bins_;
 
-  unordered_map<void*, MemInfoForSize*> addr_to_list_;
+  // The blocks in use, indexed by address.
+  unordered_map<void*, Block*> used_blocks_;
 
-  // size_to_list_ is indexed first by row_bytes (which is zero for linear
-  // mallocs) and then by num_rows (which for linear mallocs, is the actual size
-  // in bytes).
-  std::vector<std::map<size_t, MemInfoForSize*>* > size_to_list_;
-  
-  int32 cleanup_countdown_bytes_; // countdown in bytes, until the next time we check
-                                  // whether we should do cleanup
+  // The first block of each region.
+  std::vector<Block*> regions_;
+
+  // Statistics.
+  size_t region_bytes_;  // The total size of the regions.
+  size_t used_bytes_;  // The total size of the blocks in use.
+  size_t peak_used_bytes_;  // The maximum that used_bytes_ has reached.
+  int64 num_mallocs_;  // The number of calls to Malloc() and MallocPitch().
+  int64 num_cuda_mallocs_;  // The number of calls to cudaMalloc().
 };
 
 
-void* CuAllocator::Malloc(size_t size) {
-  KALDI_ASSERT(size > 0);
-  return MallocInternal(0, size, NULL);
+CuAllocator::Block *CuAllocator::FindFreeBlock(size_t size) {
+  for (int32 bin = Bin(size); bin < kNumBins; bin++) {
+    BinType::iterator iter =
+        bins_[bin].lower_bound(std::make_pair(size, static_cast<Block*>(NULL)));
+    if (iter != bins_[bin].end()) {
+      Block *block = iter->second;
+      bins_[bin].erase(iter);
+      return block;
+    }
+  }
+  return NULL;
 }
 
-void* CuAllocator::MallocPitch(size_t num_rows, size_t row_bytes,
-                               size_t *pitch) {
-  KALDI_ASSERT(num_rows > 0 && row_bytes > 0 && pitch != NULL);
-  return MallocInternal(num_rows, row_bytes, pitch);
+CuAllocator::Block *CuAllocator::NewRegion(size_t size) {
+  size_t region_size = std::max(size, RoundUp(opts_.region_bytes));
+  void *data;
+  cudaError_t ret = cudaMalloc(&data, region_size);
+  if (ret != cudaSuccess && region_size > size) {
+    // Try to get just what we need.
+    cudaGetLastError(); // reset the error state
+    region_size = size;
+    ret = cudaMalloc(&data, region_size);
+  }
+  if (ret != cudaSuccess) {
+    KALDI_WARN << "Allocation of memory block of " << region_size << " bytes "
+               << "failed, releasing cached memory and retrying.";
+    cudaGetLastError(); // reset the error state
+    ReleaseAllCachedMemory();
+    ret = cudaMalloc(&data, region_size);
+    if (ret != cudaSuccess) {
+      KALDI_WARN << "Allocation failed for the second time.    Printing "
+                 << "device memory usage and exiting";
+      device_->PrintMemoryUsage();
+      PrintStats();
+      KALDI_ERR << "Memory allocation failure";
+    }
+  }
+  num_cuda_mallocs_++;
+  region_bytes_ += region_size;
+  Block *block = new Block;
+  block->data = static_cast<char*>(data);
+  block->size = region_size;
+  block->free = true;
+  block->prev = NULL;
+  block->next = NULL;
+  regions_.push_back(block);
+  return block;
 }
 
-void* CuAllocator::MallocInternal(size_t row_bytes,
-                                  size_t num_rows,
-                                  size_t *pitch_out) {
-  // we share the code for standard cudaMalloc and cudaMallocPitch
-  // because most of it is the same.  for cudaMalloc, we'll have
-  // row_bytes == 0, and num_rows is just the size to be allocated.
-  KALDI_ASSERT(num_rows != 0 && (row_bytes != 0) == (pitch_out != NULL));
-  
-  MemInfoForSize *info = FindMemInfo(row_bytes, num_rows);
-  if (!info->freed.empty()) { // We can satisfy the request with cached,
-                              // previously-allocated memory.
-    void *ans = info->freed.back();
-    info->freed.pop_back();
-    info->currently_used++;
-    addr_to_list_[ans] = info;
-    if (pitch_out) *pitch_out = info->pitch;
-    return ans;
-  } else {
-    PossiblyCleanup(row_bytes == 0 ? num_rows : row_bytes * num_rows);
+void* CuAllocator::MallocInternal(size_t size) {
+  num_mallocs_++;
+  if (!opts_.cache_memory) {
     void *ans;
-    if (row_bytes == 0) { // Simple malloc request, not "MallocPitch".
-      size_t size = num_rows;
-      int32 ret = cudaMalloc(&ans, size);
-      if (ret != 0) {
-        KALDI_WARN << "Allocation of memory block of " << size << " bytes "
-                   << "failed, releasing cached memory and retrying.";
-        cudaGetLastError(); // reset the error state
-        ReleaseAllCachedMemory();
-        ret = cudaMalloc(&ans, size);
-        if (ret != 0) {
-          KALDI_WARN << "Allocation failed for the second time.    Printing "
-                    << "device memory usage and exiting";
-          device_->PrintMemoryUsage();
-          KALDI_ERR << "Memory allocation failure";
-        }
-      }
-    } else {
-      size_t pitch;
-      int32 ret = cudaMallocPitch(&ans, &pitch, row_bytes, num_rows);
-      if (ret != 0) { // allocation failed...
-        KALDI_WARN << "Allocation of " << num_rows << " rows, each of size "
-                   << row_bytes << " bytes failed,  releasing cached "
-                   << "memory and retrying.";
-        cudaGetLastError(); // reset the error state
-        ReleaseAllCachedMemory();
-        ret = cudaMallocPitch(&ans, &pitch, row_bytes, num_rows);
-        if (ret != 0) {
-          KALDI_WARN << "Allocation failed for the second time.    Printing "
-                    << "device memory usage and exiting";
-          device_->PrintMemoryUsage();
-          KALDI_ERR << "Memory allocation failure";
-        }
-      }
-      KALDI_ASSERT(pitch > 0);
-      if (info->pitch == 0) { // First allocation; have not set info->pitch yet.
-        info->pitch = pitch;
-      } else if (pitch != info->pitch) {
-        KALDI_ERR << "Pitch differs between multiple calls with the same "
-                  << "parameters: " << pitch << " vs. " << info->pitch;
-      }
-      *pitch_out = info->pitch;
-    }
-    addr_to_list_[ans] = info;
-    info->currently_used++;
+    num_cuda_mallocs_++;
+    CU_SAFE_CALL(cudaMalloc(&ans, size));
     return ans;
   }
+  Block *block = FindFreeBlock(size);
+  if (block == NULL)
+    block = NewRegion(size);
+  KALDI_ASSERT(block->free && block->size >= size);
+  if (block->size > size) {
+    // Split the block, and put the remainder back in a bin.
+    Block *rest = new Block;
+    rest->data = block->data + size;
+    rest->size = block->size - size;
+    rest->free = true;
+    rest->prev = block;
+    rest->next = block->next;
+    if (block->next != NULL) block->next->prev = rest;
+    block->next = rest;
+    block->size = size;
+    AddToBin(rest);
+  }
+  block->free = false;
+  used_blocks_[block->data] = block;
+  used_bytes_ += size;
+  peak_used_bytes_ = std::max(peak_used_bytes_, used_bytes_);
+  return block->data;
+}
+
+void* CuAllocator::Malloc(size_t size) {
+  KALDI_ASSERT(size > 0);
+  return MallocInternal(RoundUp(size));
+}
+
+void* CuAllocator::MallocPitch(size_t row_bytes, size_t num_rows,
+                               size_t *pitch) {
+  KALDI_ASSERT(num_rows > 0 && row_bytes > 0 && pitch != NULL);
+  *pitch = RoundUp(row_bytes);
+  return MallocInternal(*pitch * num_rows);
 }
 
 void CuAllocator::Free(void *addr) {
-  unordered_map<void*, MemInfoForSize*>::iterator iter
-      = addr_to_list_.find(addr);
-  if (iter == addr_to_list_.end()) {
+  if (!opts_.cache_memory) {
+    CU_SAFE_CALL(cudaFree(addr));
+    return;
+  }
+  unordered_map<void*, Block*>::iterator iter = used_blocks_.find(addr);
+  if (iter == used_blocks_.end()) {
     KALDI_ERR << "Attempt to free address " << addr << " that was not allocated "
               << "by CuDevice::Malloc() (or was previously freed);";
   }
-  MemInfoForSize *info = iter->second;
-  addr_to_list_.erase(addr); // Erase this element in the addr_to_list_ map.
-  info->currently_used--;
-  if (info->countdown == 0 && opts_.cache_memory) { 
-                              // We have freed [i.e. actually freed with
-                              // CudaFree()] enough of these that we think
-                              // we're wasting too much time this way and
-                              // need to start caching them.
-    info->freed.push_back(addr);
-  } else { // Actually free the address, and decrease "countdown".
-    info->countdown--;
-    CU_SAFE_CALL(cudaFree(addr)); // This is how we free, even if allocated with
-                                  // cudaMallocPitch().
+  Block *block = iter->second;
+  used_blocks_.erase(iter);
+  used_bytes_ -= block->size;
+  block->free = true;
+  // Merge with the neighbouring blocks if they are free.
+  Block *next = block->next;
+  if (next != NULL && next->free) {
+    RemoveFromBin(next);
+    block->size += next->size;
+    block->next = next->next;
+    if (next->next != NULL) next->next->prev = block;
+    delete next;
+  }
+  Block *prev = block->prev;
+  if (prev != NULL && prev->free) {
+    RemoveFromBin(prev);
+    prev->size += block->size;
+    prev->next = block->next;
+    if (block->next != NULL) block->next->prev = prev;
+    delete block;
+    block = prev;
   }
+  AddToBin(block);
 }
 
 
 inline void CuAllocator::DisableCaching() {
   KALDI_LOG << "Disabling caching of GPU memory.";
-  KALDI_ASSERT(size_to_list_.empty()); // No memory allocated yet!
+  KALDI_ASSERT(regions_.empty()); // No memory allocated yet!
   opts_.cache_memory = false;
 }
 
-void CuAllocator::ReleaseAllCachedMemory(bool destroy) {
+void CuAllocator::ReleaseAllCachedMemory() {
   KALDI_VLOG(2) << "Releasing all cached memory.";
-  for (size_t i = 0; i < size_to_list_.size(); i++) {
-    if (size_to_list_[i] == NULL)
-      continue;
-    typedef std::map<size_t, MemInfoForSize*>::iterator  IterType;
-    for (IterType iter = size_to_list_[i]->begin();
-         iter != size_to_list_[i]->end(); ++iter) {
-      MemInfoForSize *info = iter->second;
-      if (destroy && !info->freed.empty()) {
-        // When called from the destructor at program end, if verbose level is
-        // high, say the sizes we had.
-        if (info->row_bytes == 0) {
-          KALDI_VLOG(3) << "Releasing " << info->freed.size() << " blocks of "
-                        << info->num_rows << " bytes.";
-        } else {
-          KALDI_VLOG(3) << "Releasing " << info->freed.size()
-                        << " 2-d blocks of " << info->num_rows << " rows of "
-                        << info->row_bytes << " bytes each.";
-        }
-      }
-      if (!destroy) {
-        // We only do this freeing part when we're *not* called from the
-        // destuctor (destroy = false).  This leads to a crash when called from
-        // the destructor, with cudaFree returning "unload of CUDA runtime
-        // failed".  Presumably this has to do with the destruction order of
-        // C++, which we can't really control.
-        while (!info->freed.empty()) {
-          CU_SAFE_CALL(cudaFree(info->freed.back()));
-          info->freed.pop_back();
-        }
-      }
-      if (destroy)
-        delete info;
-    }
-    if (destroy) {
-      delete size_to_list_[i];
-      size_to_list_[i] = NULL;
+  std::vector<Block*> regions;
+  for (size_t i = 0; i < regions_.size(); i++) {
+    Block *block = regions_[i];
+    if (block->free && block->next == NULL) {  // The whole region is free.
+      RemoveFromBin(block);
+      region_bytes_ -= block->size;
+      CU_SAFE_CALL(cudaFree(block->data));
+      delete block;
+    } else {
+      regions.push_back(block);
     }
   }
+  regions_.swap(regions);
 }
 
-void CuAllocator::Cleanup() {
-  // TODO: implement this or remove it (and also PossiblyCleanup).
-  // Actually we may never implement this, as just calling
-  // ReleaseAllCachedMemory whenever an allocation fails is probably
-  // sufficient.
-}
-void CuAllocator::PossiblyCleanup(size_t num_bytes) {
-  if (static_cast<size_t>(cleanup_countdown_bytes_) <= num_bytes) {
-    Cleanup();
-    cleanup_countdown_bytes_ = opts_.cleanup_interval_bytes;
-  } else {
-    cleanup_countdown_bytes_ -= static_cast<int32>(num_bytes);
+size_t CuAllocator::FreeBytes(size_t *fragmented) const {
+  size_t ans = 0;
+  *fragmented = 0;
+  for (size_t i = 0; i < regions_.size(); i++) {
+    size_t region_free = 0, largest = 0;
+    for (const Block *block = regions_[i]; block != NULL; block = block->next) {
+      if (block->free) {
+        region_free += block->size;
+        largest = std::max(largest, block->size);
+      }
+    }
+    ans += region_free;
+    *fragmented += region_free - largest;
   }
+  return ans;
+}
+
+void CuAllocator::PrintStats() const {
+  if (!opts_.cache_memory) return;
+  size_t fragmented, free_bytes = FreeBytes(&fragmented);
+  KALDI_LOG << "GPU memory allocator: " << used_bytes_ << " bytes in use (peak "
+            << peak_used_bytes_ << "), " << region_bytes_ << " bytes in "
+            << regions_.size() << " regions, " << free_bytes << " free of "
+            << "which " << fragmented << " fragmented; "
+            << num_mallocs_ << " allocations, " << num_cuda_mallocs_
+            << " calls to cudaMalloc.";
 }
 
 CuAllocator::~CuAllocator() {
   // Check that nothing was allocated by the user and not freed.
-  std::set<MemInfoForSize*> unfreed_set;
-  typedef unordered_map<void*, MemInfoForSize *>::iterator IterType;
-  for (IterType iter = addr_to_list_.begin(); iter != addr_to_list_.end();
-       ++iter)
-    unfreed_set.insert(iter->second);
-  for (std::set<MemInfoForSize*>::iterator iter = unfreed_set.begin();
-       iter != unfreed_set.end(); ++iter) {
-    MemInfoForSize *info = *iter;
-    KALDI_ASSERT(info->currently_used > 0); // Or should not be in this set
-                                            // (code error or memory corruption)
-    if (info->num_rows == 0) {
-      KALDI_WARN << info->currently_used << " memory chunks of size "
-                 << info->row_bytes << " were allocated and not freed.";
-    } else {
-      KALDI_WARN << info->currently_used << " memory chunks of size "
-                 << info->row_bytes << " per row, and " << info->num_rows
-                 << " rows, were allocated and not freed.";
+  if (!used_blocks_.empty()) {
+    KALDI_WARN << used_blocks_.size() << " memory chunks, totalling "
+               << used_bytes_ << " bytes, were allocated and not freed.";
+  }
+  // We don't call cudaFree() on the regions here, as this leads to a crash
+  // when called at program end, with cudaFree returning "unload of CUDA
+  // runtime failed".  Presumably this has to do with the destruction order of
+  // C++, which we can't really control.
+  for (size_t i = 0; i < regions_.size(); i++) {
+    Block *block = regions_[i];
+    while (block != NULL) {
+      Block *next = block->next;
+      delete block;
+      block = next;
     }
   }
-  
-  bool destroy = true;
-  ReleaseAllCachedMemory(destroy);
 }
 
-void CuDevice::Free(void *ptr) { allocator_->Free(ptr); }
+CuDeviceContext::CuDeviceContext(int32 gpu_id, CuDevice *device,
+                                 bool cache_memory):
+    gpu_id(gpu_id), free_memory_at_startup(0),
+    allocator(new CuAllocator(CuAllocatorOptions(), device)), copy_stream(0),
+    trace_track(0) {
+  if (!cache_memory) allocator->DisableCaching();
+  if (pthread_mutex_init(&mutex, NULL) != 0)
+    KALDI_ERR << "Error initializing mutex";
+}
+
+CuDeviceContext::~CuDeviceContext() {
+  delete allocator;
+  if (copy_stream != 0)
+    CU_SAFE_CALL(cudaStreamDestroy(copy_stream));
+  pthread_mutex_destroy(&mutex);
+}
+
+void CuDevice::PrintProfile() {
+  if (verbose_ && Enabled()) {
+    int32 thread_device = ThreadDevice();
+    for (int32 device = 0; device < NumDevices(); device++) {
+      CuDeviceContext *context = contexts_[device];
+      // PrintMemoryUsage() works on the current device.
+      BindThread(device);
+      std::ostringstream os;
+      os << "-----\n[cudevice profile";
+      if (NumDevices() > 1) os << ", GPU " << context->gpu_id;
+      os << "]\n";
+      std::vector<std::pair<double, std::string> > pairs;
+      {
+        ContextLock lock(context);
+        std::map<std::string, double>::iterator it;
+        for(it = context->profile_map.begin();
+            it != context->profile_map.end(); ++it)
+          pairs.push_back(std::make_pair(it->second, it->first));
+      }
+      std::sort(pairs.begin(), pairs.end());
+      size_t max_print = 15, start_pos = (pairs.size() <= max_print ?
+                                          0 : pairs.size() - max_print);
+      for (size_t i = start_pos; i < pairs.size(); i++)
+        os << pairs[i].second << "\t" << pairs[i].first << "s\n";
+      os << "-----";
+      KALDI_LOG << os.str();
+      PrintMemoryUsage();
+      ContextLock lock(context);
+      context->allocator->PrintStats();
+    }
+    BindThread(thread_device);
+  }
+}
+
+void CuDevice::Free(void *ptr) {
+  CuDeviceContext &context = Context();
+  ContextLock lock(&context);
+  context.allocator->Free(ptr);
+}
 
 void* CuDevice::MallocPitch(size_t row_bytes, size_t num_rows, size_t *pitch) {
-  return allocator_->MallocPitch(row_bytes, num_rows, pitch);
+  CuDeviceContext &context = Context();
+  ContextLock lock(&context);
+  return context.allocator->MallocPitch(row_bytes, num_rows, pitch);
 }
 
 void* CuDevice::Malloc(size_t size) {
-  return allocator_->Malloc(size);
+  CuDeviceContext &context = Context();
+  ContextLock lock(&context);
+  return context.allocator->Malloc(size);
 }
 
 void CuDevice::DisableCaching() {
-  allocator_->DisableCaching();
+  // If no GPU has been selected yet, this applies to the ones selected later.
+  cache_memory_ = false;
+  for (size_t i = 0; i < contexts_.size(); i++) {
+    ContextLock lock(contexts_[i]);
+    contexts_[i]->allocator->DisableCaching();
+  }
 }
 
-CuDevice::CuDevice(): active_gpu_id_(-1), verbose_(true),
-                      allocator_(new CuAllocator(CuAllocatorOptions(), this))
-  { }
+CuDevice::CuDevice(): verbose_(true), cache_memory_(true) {
+  if (pthread_key_create(&thread_device_key_, NULL) != 0)
+    KALDI_ERR << "Error creating thread-specific data key";
+}
 
 
 CuDevice::~CuDevice() {
-  if (allocator_ != NULL)
-    delete allocator_;
-  if (Enabled())
+  bool enabled = Enabled();
+  for (size_t i = 0; i < contexts_.size(); i++) {
+    cudaSetDevice(contexts_[i]->gpu_id);
+    delete contexts_[i];
+  }
+  contexts_.clear();
+  if (enabled)
     CU_SAFE_CALL(cublasShutdown());
 }
   
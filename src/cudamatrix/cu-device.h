@@ -26,7 +26,9 @@
 
 #include <map>
 #include <string>
+#include <vector>
 #include <iostream>
+#include <pthread.h>
 #include <cuda.h>
 #include <cuda_runtime_api.h>
 #include "base/kaldi-common.h"
@@ -34,10 +36,16 @@
 namespace kaldi {
 
 class CuAllocator; // Forward declaration.
+struct CuDeviceContext; // Forward declaration; defined in cu-device.cc.
 
 /**
  * Singleton object which represents CUDA device
- * responsible for CUBLAS initilalisation, collects profiling info
+ * responsible for CUBLAS initilalisation, collects profiling info.
+ *
+ * A process may use several GPUs (see SelectGpuIds()).  Each of them has its
+ * own memory allocator, copy stream and profiling statistics, and each thread
+ * works on one of them at a time (see BindThread()); all the functions below
+ * refer to the device of the calling thread unless stated otherwise.
  */
 class CuDevice {
  // Singleton object (there should only be one instantiated per program)
@@ -65,15 +73,42 @@ class CuDevice {
   ///  (more comments in cu-device.cc)
   void SelectGpuId(std::string use_gpu);
 
+  /// Selects several GPUs for computation, for programs that run threads on
+  /// more than one GPU; an empty list means all the GPUs there are.  They are
+  /// numbered 0, 1, ... in the order given, for BindThread().  Dies if any of
+  /// them cannot be used.  Call this instead of SelectGpuId(), at the start of
+  /// the program before any threads are started.  The calling thread is bound
+  /// to device 0.
+  void SelectGpuIds(const std::vector<int32> &gpu_ids);
+
+  /// Returns the number of GPUs selected (zero if we are running on CPU).
+  int32 NumDevices() const { return contexts_.size(); }
+
+  /// Makes the calling thread use device "device" (0 <= device <
+  /// NumDevices()) from now on, for memory allocation and profiling as well as
+  /// for the CUDA and CUBLAS calls.  Threads that never call this use device
+  /// 0.  Memory must be freed by a thread bound to the device it came from.
+  void BindThread(int32 device);
+
+  /// Returns the device the calling thread is bound to (see BindThread()).
+  /// Should only be called if Enabled() == true.
+  int32 ThreadDevice() const;
+
   /// Check if the CUDA GPU is selected for use
   bool Enabled() const {
-    return (active_gpu_id_ > -1); 
+    return !contexts_.empty();
   }
 
-  /// Get the active GPU id
-  int32 ActiveGpuId() {
-    return active_gpu_id_;
-  }
+  /// Get the id of the GPU the calling thread uses, or -1 if we are running
+  /// on CPU.
+  int32 ActiveGpuId();
+
+  /// Returns a CUDA stream that is intended for host-to-device copies that
+  /// should overlap with computation (see class CuMatrixUploader).  All other
+  /// operations use the default stream; the copy stream does not synchronize
+  /// implicitly with it, so the code that uses it must order operations
+  /// using events.  Should only be called if Enabled() == true.
+  cudaStream_t CopyStream() const;
 
   /// Returns true if either we have no GPU, or we have a GPU
   /// and it supports double precision.
@@ -83,13 +118,13 @@ class CuDevice {
 
   /// Sum the IO time
   void AccuProfile(const std::string &key, double time);
+  /// Prints the profile of every device in use.
   void PrintProfile(); 
 
   void PrintMemoryUsage() const;
   
-  void ResetProfile() { 
-    profile_map_.clear(); 
-  }
+  /// Clears the profile of every device in use.
+  void ResetProfile();
   
   /// Get the actual GPU memory use stats
   std::string GetFreeMemory(int64* free = NULL, int64* total = NULL) const;
@@ -116,6 +151,9 @@ class CuDevice {
   /// Try to get CUDA context on manually selected GPU.  Return true on success.
   bool SelectGpuIdManual(int32 gpu_id);
 
+  /// Sets up a device context (CUBLAS, allocator, copy stream) for the
+  /// current CUDA device, which must already have a CUDA context, and binds
+  /// the calling thread to it.
   void FinalizeActiveGpu();
   
   /// Should only be called if Enabled() == true. 
@@ -124,22 +162,22 @@ class CuDevice {
   /// Should only be called if Enabled() == true. 
   int32 MinorDeviceVersion();
 
-  std::map<std::string, double> profile_map_;
-  
-  /// active_gpu_id_ values:
-  /// -3 default (default, the SelectGpuId was not called, we did not want to use GPU)
-  /// -2 SelectGpuId was called, but no GPU was present
-  /// -1 SelectGpuId was called, but the GPU was manually disabled
-  /// 0..N Normal GPU IDs
-  int32 active_gpu_id_; 
-  
-  int64 free_memory_at_startup_;
-  
-  cudaDeviceProp properties_;
+  /// Returns the context of the device the calling thread uses, binding the
+  /// thread to device 0 if it was not bound.  Should only be called if
+  /// Enabled() == true.
+  CuDeviceContext &Context() const;
+
+  /// One for each GPU in use; empty if we are running on CPU.  This only
+  /// changes in SelectGpuId() and SelectGpuIds(), before any threads start.
+  std::vector<CuDeviceContext*> contexts_;
+
+  /// For each thread, one plus the index into contexts_ of the device it is
+  /// bound to (zero if it has not been bound yet).
+  pthread_key_t thread_device_key_;
 
   bool verbose_;
 
-  CuAllocator *allocator_;
+  bool cache_memory_;  // false if DisableCaching() was called.
   
 }; // class CuDevice
 
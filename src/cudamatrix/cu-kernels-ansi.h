@@ -36,6 +36,8 @@ extern "C" {
  * int32 CUDA kernel calls (no template wrapper)
  */
 void cudaI32_set_const(dim3 Gr, dim3 Bl, int32_cuda *mat, int32_cuda value, MatrixDim d);
+void cudaI32_viterbi_assign_tokens(int Gr, int Bl, const int32_cuda *new_states, int32_cuda num_new, int32_cuda tok_begin, int32_cuda *token_map, int32_cuda *tok_state);
+void cudaI32_viterbi_clear_token_map(int Gr, int Bl, const int32_cuda *tok_state, int32_cuda tok_begin, int32_cuda tok_end, int32_cuda *token_map);
 
 
 
@@ -63,6 +65,7 @@ void cudaF_apply_floor(dim3 Gr, dim3 Bl, float* mat, float floor_val, MatrixDim
 void cudaF_copy_cols(dim3 Gr, dim3 Bl, float* dst, const float* src, const MatrixIndexT_cuda* reorder, MatrixDim dst_dim, int src_stride);
 void cudaF_copy_rows(dim3 Gr, dim3 Bl, float* dst, const float* src, const MatrixIndexT_cuda* reorder, MatrixDim dst_dim, int src_stride);
 void cudaF_apply_ceiling(dim3 Gr, dim3 Bl, float* mat, float ceiling_val, MatrixDim d);
+void cudaF_uncompress_matrix(dim3 Gr, dim3 Bl, float* mat, MatrixDim d, const unsigned short* col_headers, const unsigned char* byte_data, float min_value, float range);
 void cudaF_set_diag(int Gr, int Bl, float* mat, float value, MatrixDim d);
 void cudaF_set_diag_packed(int Gr, int Bl, float* mat, float value, int dim);
 void cudaF_add_diag_packed(int Gr, int Bl, float* mat, float value, int dim);
@@ -79,6 +82,9 @@ void cudaF_mul_cols_vec(dim3 Gr, dim3 Bl, float *mat, const float *scale, Matrix
 void cudaF_mul_rows_vec(dim3 Gr, dim3 Bl, float *mat, const float *scale, MatrixDim d);
 void cudaF_mul_rows_group_mat(dim3 Gr, dim3 Bl, float *y, const float *x, MatrixDim d, int src_stride, int group_size);
 void cudaF_calc_pnorm_deriv(dim3 Gr, dim3 Bl, float *y, const float *x1, const float *x2,  MatrixDim d, int src_stride, int group_size, float power);
+void cudaF_diff_group_pnorm(dim3 Gr, dim3 Bl, float *id, const float *iv, const float *ov, const float *od, MatrixDim d, int iv_stride, int ov_stride, int od_stride, int group_size, float power);
+void cudaF_group_max(dim3 Gr, dim3 Bl, float *y, const float *x, MatrixDim d, int src_stride, int group_size);
+void cudaF_diff_group_max(dim3 Gr, dim3 Bl, float *id, const float *iv, const float *ov, const float *od, MatrixDim d, int iv_stride, int ov_stride, int od_stride, int group_size);
 void cudaF_div_rows_vec(dim3 Gr, dim3 Bl, float *mat, const float *vec_div, MatrixDim d);
 void cudaF_add_mat(dim3 Gr, dim3 Bl, float alpha, const float *src, float *dst, MatrixDim d, int src_stride, int A_trans);
 void cudaF_add_mat_mat_div_mat(dim3 Gr, dim3 Bl, const float *A, const float *B, const float *C, float *dst, MatrixDim d);
@@ -126,6 +132,11 @@ void cudaF_block_add_mat_mat(dim3 Gr, dim3 Bl, CuBlockMatrixData *B_cu_data, int
                              const float *C_data, int C_num_cols, int C_row_stride, int C_col_stride,
                              const float *D_data, int D_row_stride, int D_col_stride,
                              float alpha, float beta);
+void cudaF_add_mat_mat_batched(dim3 Gr, dim3 Bl, float alpha,
+                               float * const *A, int A_row_stride, int A_col_stride,
+                               float * const *B, int B_row_stride, int B_col_stride,
+                               float beta, float * const *C, int C_stride,
+                               int num_rows, int num_cols, int inner_dim);
 /*
  * cu::
  */
@@ -137,17 +148,35 @@ void cudaF_group_pnorm(dim3 Gr, dim3 Bl, float *y, const float *x, MatrixDim d,
 void cudaF_sigmoid(dim3 Gr, dim3 Bl, float *y, const float *x, MatrixDim d, int src_stride);
 void cudaF_diff_sigmoid(dim3 Gr, dim3 Bl, float *eout, const float *e, const float *y, MatrixDim d, int src_stride);
 void cudaF_tanh(dim3 Gr, dim3 Bl, float *y, const float *x, MatrixDim d, int src_stride);
+void cudaF_sigmoid_with_bias(dim3 Gr, dim3 Bl, float *y, const float *x, const float *bias, MatrixDim d, int src_stride);
+void cudaF_tanh_with_bias(dim3 Gr, dim3 Bl, float *y, const float *x, const float *bias, MatrixDim d, int src_stride);
 void cudaF_diff_tanh(dim3 Gr, dim3 Bl, float *eout, const float *e, const float *y, MatrixDim d);
 
 void cudaF_regularize_l1(dim3 Gr, dim3 Bl, float *wei, float *grad, float l1, float lr, MatrixDim d);
 void cudaF_find_row_max_id(dim3 Gr, dim3 Bl, const float *mat, float *vec_val, int32_cuda *vec_id, int32_cuda voff, MatrixDim d);
 void cudaF_diff_xent(dim3 Gr, dim3 Bl, const int32_cuda *vec_tgt, float *mat_net_out, float *vec_log_post, MatrixDim d);
+void cudaF_diff_xent_sparse(dim3 Gr, dim3 Bl, const MatrixElement<float> *tgt, int num_tgt, float *mat_net_out, float *vec_log_post, MatrixDim d);
 void cudaF_copy_rows_from_vec(dim3 Gr, dim3 Bl, float *mat_out, MatrixDim d_out, const float *v_in);
 
+void cudaF_levelled_graph_forward(int Gr, int Bl, const int32_cuda *in_offsets, const int32_cuda *in_arcs, const int32_cuda *arc_src, const float *arc_like, const float *arc_acc, int32_cuda state_begin, int32_cuda state_end, float *alpha, float *alpha_acc);
+void cudaF_levelled_graph_backward(int Gr, int Bl, const int32_cuda *out_offsets, const int32_cuda *out_arcs, const int32_cuda *arc_dest, const float *arc_like, const float *arc_acc, const float *final_like, int32_cuda state_begin, int32_cuda state_end, float *beta, float *beta_acc);
+void cudaF_levelled_graph_arc_post(int Gr, int Bl, const int32_cuda *arc_src, const int32_cuda *arc_dest, const float *arc_like, const float *arc_acc, const float *alpha, const float *beta, const float *alpha_acc, const float *beta_acc, float tot_like, float tot_acc, int32_cuda num_arcs, float *arc_post);
+void cudaF_matrix_add_arc_post(int Gr, int Bl, float *data, MatrixDim dim, float alpha, const Int32Pair *elements, const int32_cuda *element_offsets, const int32_cuda *element_arcs, int32_cuda num_elements, const float *arc_post);
+void cudaF_viterbi_expand_emitting(int Gr, int Bl, const int32_cuda *offsets, const int32_cuda *eps_offsets, const int32_cuda *arc_dest, const int32_cuda *arc_col, const float *arc_cost, const float *loglikes, const int32_cuda *tok_state, const float *tok_cost, int32_cuda tok_begin, int32_cuda tok_end, float cutoff, float beam, unsigned long long *state_best, int32_cuda *new_states, int32_cuda *counters);
+void cudaF_viterbi_expand_nonemitting(int Gr, int Bl, const int32_cuda *offsets, const int32_cuda *eps_offsets, const int32_cuda *arc_dest, const float *arc_cost, float beam, int32_cuda num_states, unsigned long long *state_best, int32_cuda *new_states, int32_cuda *counters);
+void cudaF_viterbi_set_backpointers(int Gr, int Bl, const int32_cuda *arc_src, const int32_cuda *arc_col, const int32_cuda *new_states, int32_cuda num_new, int32_cuda tok_begin, const int32_cuda *prev_token_map, const int32_cuda *cur_token_map, unsigned long long *state_best, float *tok_cost, int32_cuda *tok_arc, int32_cuda *tok_prev);
+void cudaF_cholesky_packed_batch(int Gr, int Bl, float **data, int32_cuda dim, int32_cuda num_mats, int32_cuda *failed);
+void cudaF_invert_pos_def_packed_batch(int Gr, int Bl, float **data, int32_cuda dim, int32_cuda num_mats, int32_cuda *failed);
+void cudaF_solve_cholesky_packed_batch(int Gr, int Bl, float **chol, float **vec, int32_cuda dim, int32_cuda num_mats);
+
 void cudaF_randomize(dim3 Gr, dim3 Bl, float *y, const float *x, const int32_cuda *copy_from, MatrixDim d_out, MatrixDim d_in);
 void cudaF_splice(dim3 Gr, dim3 Bl, float *y, const float *x, const int32_cuda *off, MatrixDim d_out, MatrixDim d_in);
 void cudaF_one(int Gr, int Bl, float* x, int dim);
 void cudaF_copy(dim3 Gr, dim3 Bl, float *y, const float *x, const int32_cuda *copy_from, MatrixDim d_out, MatrixDim d_in);
+void cudaF_max_pool(dim3 Gr, dim3 Bl, float *y, MatrixDim d_out, const float *x, int x_stride, const int32_cuda *pool_blocks, int pool_size, int block_dim);
+void cudaF_average_pool(dim3 Gr, dim3 Bl, float *y, MatrixDim d_out, const float *x, int x_stride, const int32_cuda *pool_blocks, int pool_size, int block_dim);
+void cudaF_max_pool_backward(dim3 Gr, dim3 Bl, float *in_diff, MatrixDim d, const float *in, int in_stride, const float *out, int out_stride, const float *out_diff, int out_diff_stride, const int32_cuda *out_blocks, const Int32Pair *in_ranges, const float *scale, int block_dim);
+void cudaF_average_pool_backward(dim3 Gr, dim3 Bl, float *in_diff, MatrixDim d, const float *out_diff, int out_diff_stride, const int32_cuda *out_blocks, const Int32Pair *in_ranges, const float *scale, int block_dim);
 void cudaF_copy_from_sp(dim3 Gr, dim3 Bl, const float* x, float* y, MatrixDim d_out);
 void cudaF_take_lower(dim3 Gr, dim3 Bl, const float* x, float* y, MatrixDim d_in);
 void cudaF_take_upper(dim3 Gr, dim3 Bl, const float* x, float* y, MatrixDim d_in);
@@ -160,6 +189,10 @@ void cudaF_sy_add_tr2(dim3 Gr, dim3 Bl, float alpha, float beta, const float* T,
 void cudaF_sum_column_ranges(dim3 Gr, dim3 Bl, float *data, MatrixDim dim,
                              const float *src_data, MatrixDim src_dim,
                              const Int32Pair *indices);  
+void cudaF_log_sum_exp_column_ranges(dim3 Gr, dim3 Bl, float *data,
+                                     MatrixDim dim, const float *src_data,
+                                     MatrixDim src_dim,
+                                     const Int32Pair *indices);
 void cudaF_matrix_lookup(dim3 Gr, dim3 Bl, const float *data, MatrixDim dim,
                          const Int32Pair *indices, int indices_size,
                          float *output);
@@ -192,6 +225,7 @@ void cudaD_apply_floor(dim3 Gr, dim3 Bl, double* mat, double floor_val, MatrixDi
 void cudaD_copy_cols(dim3 Gr, dim3 Bl, double* dst, const double* src, const MatrixIndexT_cuda* reorder, MatrixDim dst_dim, int src_stride);
 void cudaD_copy_rows(dim3 Gr, dim3 Bl, double* dst, const double* src, const MatrixIndexT_cuda* reorder, MatrixDim dst_dim, int src_stride);
 void cudaD_apply_ceiling(dim3 Gr, dim3 Bl, double* mat, double ceiling_val, MatrixDim d);
+void cudaD_uncompress_matrix(dim3 Gr, dim3 Bl, double* mat, MatrixDim d, const unsigned short* col_headers, const unsigned char* byte_data, float min_value, float range);
 void cudaD_set_diag(int Gr, int Bl, double* mat, double value, MatrixDim d);
 void cudaD_set_diag_packed(int Gr, int Bl, double* mat, double value, int dim);
 void cudaD_add_diag_packed(int Gr, int Bl, double* mat, double value, int dim);
@@ -208,6 +242,9 @@ void cudaD_mul_cols_vec(dim3 Gr, dim3 Bl, double *mat, const double *scale, Matr
 void cudaD_mul_rows_vec(dim3 Gr, dim3 Bl, double *mat, const double *scale, MatrixDim d);
 void cudaD_mul_rows_group_mat(dim3 Gr, dim3 Bl, double *y, const double *x, MatrixDim d, int src_stride, int group_size);
 void cudaD_calc_pnorm_deriv(dim3 Gr, dim3 Bl, double *y, const double *x1, const double *x2,  MatrixDim d, int src_stride, int group_size, double power);
+void cudaD_diff_group_pnorm(dim3 Gr, dim3 Bl, double *id, const double *iv, const double *ov, const double *od, MatrixDim d, int iv_stride, int ov_stride, int od_stride, int group_size, double power);
+void cudaD_group_max(dim3 Gr, dim3 Bl, double *y, const double *x, MatrixDim d, int src_stride, int group_size);
+void cudaD_diff_group_max(dim3 Gr, dim3 Bl, double *id, const double *iv, const double *ov, const double *od, MatrixDim d, int iv_stride, int ov_stride, int od_stride, int group_size);
 void cudaD_div_rows_vec(dim3 Gr, dim3 Bl, double *mat, const double *vec_div, MatrixDim d);
 void cudaD_add_mat(dim3 Gr, dim3 Bl, double alpha, const double *src, double *dst, MatrixDim d, int src_stride, int A_trans);
 void cudaD_add_mat_mat_div_mat(dim3 Gr, dim3 Bl, const double *A, const double *B, const double *C, double *dst, MatrixDim d);
@@ -255,6 +292,11 @@ void cudaD_block_add_mat_mat(dim3 Gr, dim3 Bl, CuBlockMatrixData *B_cu_data, int
                              const double *C_data, int C_num_cols, int C_row_stride, int C_col_stride,
                              const double *D_data, int D_row_stride, int D_col_stride,
                              double alpha, double beta);  
+void cudaD_add_mat_mat_batched(dim3 Gr, dim3 Bl, double alpha,
+                               double * const *A, int A_row_stride, int A_col_stride,
+                               double * const *B, int B_row_stride, int B_col_stride,
+                               double beta, double * const *C, int C_stride,
+                               int num_rows, int num_cols, int inner_dim);
 
 
 /*
@@ -268,17 +310,35 @@ void cudaD_group_pnorm(dim3 Gr, dim3 Bl, double *y, const double *x, MatrixDim d
 void cudaD_sigmoid(dim3 Gr, dim3 Bl, double *y, const double *x, MatrixDim d, int src_stride);
 void cudaD_diff_sigmoid(dim3 Gr, dim3 Bl, double *eout, const double *e, const double *y, MatrixDim d, int src_stride);
 void cudaD_tanh(dim3 Gr, dim3 Bl, double *y, const double *x, MatrixDim d, int src_stride);
+void cudaD_sigmoid_with_bias(dim3 Gr, dim3 Bl, double *y, const double *x, const double *bias, MatrixDim d, int src_stride);
+void cudaD_tanh_with_bias(dim3 Gr, dim3 Bl, double *y, const double *x, const double *bias, MatrixDim d, int src_stride);
 void cudaD_diff_tanh(dim3 Gr, dim3 Bl, double *eout, const double *e, const double *y, MatrixDim d);
 
 void cudaD_regularize_l1(dim3 Gr, dim3 Bl, double *wei, double *grad, double l1, double lr, MatrixDim d);
 void cudaD_find_row_max_id(dim3 Gr, dim3 Bl, const double *mat, double *vec_val, int32_cuda *vec_id, int32_cuda voff, MatrixDim d);
 void cudaD_diff_xent(dim3 Gr, dim3 Bl, const int32_cuda *vec_tgt, double *mat_net_out, double *vec_log_post, MatrixDim d);
+void cudaD_diff_xent_sparse(dim3 Gr, dim3 Bl, const MatrixElement<double> *tgt, int num_tgt, double *mat_net_out, double *vec_log_post, MatrixDim d);
 void cudaD_copy_rows_from_vec(dim3 Gr, dim3 Bl, double *mat_out, MatrixDim d_out, const double *v_in);
 
+void cudaD_levelled_graph_forward(int Gr, int Bl, const int32_cuda *in_offsets, const int32_cuda *in_arcs, const int32_cuda *arc_src, const double *arc_like, const double *arc_acc, int32_cuda state_begin, int32_cuda state_end, double *alpha, double *alpha_acc);
+void cudaD_levelled_graph_backward(int Gr, int Bl, const int32_cuda *out_offsets, const int32_cuda *out_arcs, const int32_cuda *arc_dest, const double *arc_like, const double *arc_acc, const double *final_like, int32_cuda state_begin, int32_cuda state_end, double *beta, double *beta_acc);
+void cudaD_levelled_graph_arc_post(int Gr, int Bl, const int32_cuda *arc_src, const int32_cuda *arc_dest, const double *arc_like, const double *arc_acc, const double *alpha, const double *beta, const double *alpha_acc, const double *beta_acc, double tot_like, double tot_acc, int32_cuda num_arcs, double *arc_post);
+void cudaD_matrix_add_arc_post(int Gr, int Bl, double *data, MatrixDim dim, double alpha, const Int32Pair *elements, const int32_cuda *element_offsets, const int32_cuda *element_arcs, int32_cuda num_elements, const double *arc_post);
+void cudaD_viterbi_expand_emitting(int Gr, int Bl, const int32_cuda *offsets, const int32_cuda *eps_offsets, const int32_cuda *arc_dest, const int32_cuda *arc_col, const double *arc_cost, const double *loglikes, const int32_cuda *tok_state, const double *tok_cost, int32_cuda tok_begin, int32_cuda tok_end, double cutoff, double beam, unsigned long long *state_best, int32_cuda *new_states, int32_cuda *counters);
+void cudaD_viterbi_expand_nonemitting(int Gr, int Bl, const int32_cuda *offsets, const int32_cuda *eps_offsets, const int32_cuda *arc_dest, const double *arc_cost, double beam, int32_cuda num_states, unsigned long long *state_best, int32_cuda *new_states, int32_cuda *counters);
+void cudaD_viterbi_set_backpointers(int Gr, int Bl, const int32_cuda *arc_src, const int32_cuda *arc_col, const int32_cuda *new_states, int32_cuda num_new, int32_cuda tok_begin, const int32_cuda *prev_token_map, const int32_cuda *cur_token_map, unsigned long long *state_best, double *tok_cost, int32_cuda *tok_arc, int32_cuda *tok_prev);
+void cudaD_cholesky_packed_batch(int Gr, int Bl, double **data, int32_cuda dim, int32_cuda num_mats, int32_cuda *failed);
+void cudaD_invert_pos_def_packed_batch(int Gr, int Bl, double **data, int32_cuda dim, int32_cuda num_mats, int32_cuda *failed);
+void cudaD_solve_cholesky_packed_batch(int Gr, int Bl, double **chol, double **vec, int32_cuda dim, int32_cuda num_mats);
+
 void cudaD_randomize(dim3 Gr, dim3 Bl, double *y, const double *x, const int32_cuda *copy_from, MatrixDim d_out, MatrixDim d_in);
 void cudaD_splice(dim3 Gr, dim3 Bl, double *y, const double *x, const int32_cuda *off, MatrixDim d_out, MatrixDim d_in);
 void cudaD_one(int Gr, int Bl, double* x, int dim);
 void cudaD_copy(dim3 Gr, dim3 Bl, double *y, const double *x, const int32_cuda *copy_from, MatrixDim d_out, MatrixDim d_in);
+void cudaD_max_pool(dim3 Gr, dim3 Bl, double *y, MatrixDim d_out, const double *x, int x_stride, const int32_cuda *pool_blocks, int pool_size, int block_dim);
+void cudaD_average_pool(dim3 Gr, dim3 Bl, double *y, MatrixDim d_out, const double *x, int x_stride, const int32_cuda *pool_blocks, int pool_size, int block_dim);
+void cudaD_max_pool_backward(dim3 Gr, dim3 Bl, double *in_diff, MatrixDim d, const double *in, int in_stride, const double *out, int out_stride, const double *out_diff, int out_diff_stride, const int32_cuda *out_blocks, const Int32Pair *in_ranges, const double *scale, int block_dim);
+void cudaD_average_pool_backward(dim3 Gr, dim3 Bl, double *in_diff, MatrixDim d, const double *out_diff, int out_diff_stride, const int32_cuda *out_blocks, const Int32Pair *in_ranges, const double *scale, int block_dim);
 void cudaD_copy_from_sp(dim3 Gr, dim3 Bl, const double* x, double* y, MatrixDim d_out);
 void cudaD_take_lower(dim3 Gr, dim3 Bl, const double* x, double* y, MatrixDim d_in);
 void cudaD_take_upper(dim3 Gr, dim3 Bl, const double* x, double* y, MatrixDim d_in);
@@ -304,6 +364,10 @@ void cudaD_sy_add_tr2(dim3 Gr, dim3 Bl, double alpha, double beta, const double*
 void cudaD_sum_column_ranges(dim3 Gr, dim3 Bl, double *data, MatrixDim dim,
                              const double *src_data, MatrixDim src_dim,
                              const Int32Pair *indices);
+void cudaD_log_sum_exp_column_ranges(dim3 Gr, dim3 Bl, double *data,
+                                     MatrixDim dim, const double *src_data,
+                                     MatrixDim src_dim,
+                                     const Int32Pair *indices);
 void cudaD_matrix_lookup(dim3 Gr, dim3 Bl, const double *data, MatrixDim dim,
                          const Int32Pair *indices, int indices_size,
                          double *output);
@@ -475,6 +475,63 @@ static void _calc_pnorm_deriv(Real *deriv, const Real *vec, const Real *norm,
   }
 }
 
+/// Backprop through the group p-norm in one pass: "id" is the derivative we
+/// output (with the dimension "d" of the input), "iv" the input, "ov" the
+/// p-norm output and "od" the derivative w.r.t. the output.  One thread per
+/// element of the input.
+template<typename Real>
+__global__
+static void _diff_group_pnorm(Real *id, const Real *iv, const Real *ov,
+                              const Real *od, MatrixDim d, int iv_stride,
+                              int ov_stride, int od_stride, int group_size,
+                              Real power) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;
+  int j = blockIdx.y * blockDim.y + threadIdx.y;
+  if (j < d.rows && i < d.cols) {
+    int g = i / group_size;
+    Real x = iv[i + j * iv_stride], norm = ov[g + j * ov_stride],
+        deriv = od[g + j * od_stride], ans;
+    if (norm == 0 || deriv == 0) ans = 0;
+    else if (power == Real(2)) ans = deriv * x / norm;
+    else if (power == Real(1)) ans = (x == 0 ? 0 : (x > 0 ? deriv : -deriv));
+    else ans = deriv * (x >= 0 ? 1 : -1) * pow(std::abs(x), power - 1) *
+             pow(norm, 1 - power);
+    id[i + j * d.stride] = ans;
+  }
+}
+
+/// y is the output of the group max, with dimension d; one thread per element.
+template<typename Real>
+__global__
+static void _group_max(Real *y, const Real *x, MatrixDim d, int src_stride,
+                       int group_size) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;
+  int j = blockIdx.y * blockDim.y + threadIdx.y;
+  if (j < d.rows && i < d.cols) {
+    const Real *src = x + i * group_size + j * src_stride;
+    Real max = src[0];
+    for (int k = 1; k < group_size; k++)
+      max = (src[k] > max ? src[k] : max);
+    y[i + j * d.stride] = max;
+  }
+}
+
+/// Backprop through the group max in one pass; the arguments are as for
+/// _diff_group_pnorm.
+template<typename Real>
+__global__
+static void _diff_group_max(Real *id, const Real *iv, const Real *ov,
+                            const Real *od, MatrixDim d, int iv_stride,
+                            int ov_stride, int od_stride, int group_size) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;
+  int j = blockIdx.y * blockDim.y + threadIdx.y;
+  if (j < d.rows && i < d.cols) {
+    int g = i / group_size;
+    id[i + j * d.stride] = (iv[i + j * iv_stride] == ov[g + j * ov_stride] ?
+                            od[g + j * od_stride] : Real(0));
+  }
+}
+
 /// Set each element to y = (x == orig ? changed : x).
 template<typename Real>
 __global__
@@ -1249,6 +1306,41 @@ static void _apply_ceiling(Real* mat, Real ceiling_val, MatrixDim d) {
 }
 
 
+// Uncompresses the data of a CompressedMatrix (see that class for the format):
+// "col_headers" has 4 unsigned shorts per column (the 0th, 25th, 75th and
+// 100th percentiles, in terms of "min_value" and "range"), and "byte_data" has
+// d.rows bytes per column.  Caution: here i/block{idx,dim}.x is the *row*
+// index and j/block{idx,dim}.y is the col index, so that the reads of the
+// byte data, which is in column order, are coalesced.
+template<typename Real>
+__global__
+static void _uncompress_matrix(Real* mat, MatrixDim d,
+                               const unsigned short* col_headers,
+                               const unsigned char* byte_data,
+                               float min_value, float range) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;  // row index
+  int j = blockIdx.y * blockDim.y + threadIdx.y;  // col index
+
+  if (i < d.rows && j < d.cols) {
+    const unsigned short *h = col_headers + 4 * j;
+    float increment = range * (1.0f / 65535.0f),
+        p0 = min_value + increment * h[0],
+        p25 = min_value + increment * h[1],
+        p75 = min_value + increment * h[2],
+        p100 = min_value + increment * h[3];
+    int value = byte_data[j * d.rows + i];
+    float f;
+    if (value <= 64)
+      f = p0 + (p25 - p0) * value * (1.0f / 64.0f);
+    else if (value <= 192)
+      f = p25 + (p75 - p25) * (value - 64) * (1.0f / 128.0f);
+    else
+      f = p75 + (p100 - p75) * (value - 192) * (1.0f / 63.0f);
+    mat[i * d.stride + j] = f;
+  }
+}
+
+
 template<typename Real>
 __global__
 static void _add_row_sum_mat(const Real* mat, Real* vec_sum, MatrixDim d) {
@@ -1426,6 +1518,47 @@ static void _block_add_mat_mat(CuBlockMatrixData *B_cu_data, int num_blocks,
 }
 
 
+// For each matrix index b = blockIdx.z, does C[b] = alpha * A[b] * B[b] +
+// beta * C[b], where all the products have the same dimensions and strides.
+// As in _block_add_mat_mat, transposition of A and B is handled by swapping
+// their row and column strides.  Each thread block computes a
+// CU2DBLOCK x CU2DBLOCK tile of C[b], going over the inner dimension in tiles
+// of A[b] and B[b] that are staged in shared memory.
+template<typename Real>
+__global__
+static void _add_mat_mat_batched(Real alpha,
+                                 Real * const *A, int A_row_stride, int A_col_stride,
+                                 Real * const *B, int B_row_stride, int B_col_stride,
+                                 Real beta, Real * const *C, int C_stride,
+                                 int num_rows, int num_cols, int inner_dim) {
+  __shared__ Real A_tile[CU2DBLOCK][CU2DBLOCK];
+  __shared__ Real B_tile[CU2DBLOCK][CU2DBLOCK + 1];  // +1 avoids bank conflicts.
+  int b = blockIdx.z;
+  int tx = threadIdx.x, ty = threadIdx.y;
+  int i = blockIdx.y * CU2DBLOCK + ty,  // row-index into C[b]
+      j = blockIdx.x * CU2DBLOCK + tx;  // col-index into C[b]
+  const Real *A_data = A[b], *B_data = B[b];
+
+  Real sum = 0;
+  for (int k0 = 0; k0 < inner_dim; k0 += CU2DBLOCK) {
+    int A_k = k0 + tx, B_k = k0 + ty;
+    A_tile[ty][tx] = (i < num_rows && A_k < inner_dim ?
+                      A_data[i * A_row_stride + A_k * A_col_stride] : Real(0));
+    B_tile[ty][tx] = (B_k < inner_dim && j < num_cols ?
+                      B_data[B_k * B_row_stride + j * B_col_stride] : Real(0));
+    __syncthreads();
+    for (int k = 0; k < CU2DBLOCK; k++)
+      sum += A_tile[ty][k] * B_tile[k][tx];
+    __syncthreads();
+  }
+  if (i < num_rows && j < num_cols) {
+    Real *C_elem = C[b] + i * C_stride + j;
+    // with beta == 0, C[b] may be uninitialized (e.g. NaN's), as for cuBLAS.
+    *C_elem = alpha * sum + (beta == Real(0) ? Real(0) : beta * *C_elem);
+  }
+}
+
+
 template<typename Real>
 __global__
 static void _blockadd_mat_blockmat_trans(Real *data, MatrixDim dim, const Real *A_data, int A_num_rows, int A_num_cols,
@@ -1482,6 +1615,34 @@ static void _sum_column_ranges(Real *data, MatrixDim dim,
   data[dst_index] = sum;
 }
 
+// As _sum_column_ranges, but computes the log of the sum of the exponentials,
+// with -infinity for an empty range.
+template<typename Real>
+__global__
+static void _log_sum_exp_column_ranges(Real *data, MatrixDim dim,
+                                       const Real *src_data,
+                                       MatrixDim src_dim,
+                                       const Int32Pair *indices) {
+  int row = blockIdx.x * blockDim.x + threadIdx.x;
+  int col = blockIdx.y * blockDim.y + threadIdx.y;
+  if (row >= dim.rows || col >= dim.cols)
+    return;
+  int dst_index = row * dim.stride + col,
+    src_start_index = row * src_dim.stride + indices[col].first,
+      src_end_index = row * src_dim.stride + indices[col].second;
+  Real max = log(0.0);
+  for (int index = src_start_index; index < src_end_index; index++)
+    max = fmax(max, src_data[index]);
+  if (max == log(0.0)) {
+    data[dst_index] = max;
+    return;
+  }
+  Real sum = 0.0;
+  for (int index = src_start_index; index < src_end_index; index++)
+    sum += exp(src_data[index] - max);
+  data[dst_index] = max + log(sum);
+}
+
 template<typename Real>
 __global__
 static void _soft_hinge(Real*y, const Real*x, MatrixDim d, int src_stride) {
@@ -1586,6 +1747,40 @@ static void _tanh(Real*y, const Real*x, MatrixDim d, int src_stride) {
 }
 
 
+// y = sigmoid(x + bias), with bias added to each row (y may equal x).
+template<typename Real>
+__global__
+static void _sigmoid_with_bias(Real*y, const Real*x, const Real*bias, MatrixDim d, int src_stride) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;
+  int j = blockIdx.y * blockDim.y + threadIdx.y;
+  int dst_index = i + j*d.stride, src_index = i + j*src_stride;
+  if(i < d.cols && j < d.rows) {
+    Real res = 1.0 / (1.0 + exp(-(x[src_index] + bias[i])));
+    y[dst_index] = res;
+  }
+}
+
+
+// y = tanh(x + bias), with bias added to each row (y may equal x).
+template<typename Real>
+__global__
+static void _tanh_with_bias(Real*y, const Real*x, const Real*bias, MatrixDim d, int src_stride) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;
+  int j = blockIdx.y * blockDim.y + threadIdx.y;
+  int dst_index = i + j*d.stride, src_index = i + j * src_stride;
+  if(i < d.cols && j < d.rows) {
+    Real exp_2x = exp(2.0*(x[src_index] + bias[i]));
+    Real res;
+    if(isinf(exp_2x)) {
+      res = 1.0;
+    } else {
+      res = (exp_2x - 1.0) / (exp_2x + 1.0);
+    }
+    y[dst_index] = res;
+  }
+}
+
+
 template<typename Real>
 __global__
 static void _diff_tanh(Real*eout, const Real*e, const Real*y, MatrixDim d) {
@@ -1783,6 +1978,84 @@ static void _copy(Real* y, const Real* x, const int32_cuda* copy_from, MatrixDim
   }
 }
 
+// The pooling kernels: x is the column-index and y the row-index; the
+// columns are divided into blocks of block_dim, see cu::MaxPool().
+template<typename Real>
+__global__
+static void _max_pool(Real* y, MatrixDim d_out, const Real* x, int x_stride,
+                      const int32_cuda* pool_blocks, int pool_size,
+                      int block_dim) {
+  int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x;
+  int32_cuda j = blockIdx.y * blockDim.y + threadIdx.y;
+  if (i < d_out.cols && j < d_out.rows) {
+    const int32_cuda *blocks = pool_blocks + (i / block_dim) * pool_size;
+    const Real *x_row = x + j * x_stride + i % block_dim;
+    Real ans = x_row[blocks[0] * block_dim];
+    for (int32_cuda k = 1; k < pool_size; k++) {
+      Real val = x_row[blocks[k] * block_dim];
+      if (val > ans) ans = val;
+    }
+    y[i + j * d_out.stride] = ans;
+  }
+}
+
+template<typename Real>
+__global__
+static void _average_pool(Real* y, MatrixDim d_out, const Real* x,
+                          int x_stride, const int32_cuda* pool_blocks,
+                          int pool_size, int block_dim) {
+  int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x;
+  int32_cuda j = blockIdx.y * blockDim.y + threadIdx.y;
+  if (i < d_out.cols && j < d_out.rows) {
+    const int32_cuda *blocks = pool_blocks + (i / block_dim) * pool_size;
+    const Real *x_row = x + j * x_stride + i % block_dim;
+    Real sum = 0.0;
+    for (int32_cuda k = 0; k < pool_size; k++)
+      sum += x_row[blocks[k] * block_dim];
+    y[i + j * d_out.stride] = sum / pool_size;
+  }
+}
+
+template<typename Real>
+__global__
+static void _max_pool_backward(Real* in_diff, MatrixDim d, const Real* in,
+                               int in_stride, const Real* out, int out_stride,
+                               const Real* out_diff, int out_diff_stride,
+                               const int32_cuda* out_blocks,
+                               const Int32Pair* in_ranges, const Real* scale,
+                               int block_dim) {
+  int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x;
+  int32_cuda j = blockIdx.y * blockDim.y + threadIdx.y;
+  if (i < d.cols && j < d.rows) {
+    int32_cuda p = i / block_dim, b = i % block_dim;
+    Real val = in[i + j * in_stride], sum = 0.0;
+    for (int32_cuda k = in_ranges[p].first; k < in_ranges[p].second; k++) {
+      int32_cuda c = out_blocks[k] * block_dim + b;
+      if (out[c + j * out_stride] == val)
+        sum += out_diff[c + j * out_diff_stride];
+    }
+    in_diff[i + j * d.stride] = sum * scale[p];
+  }
+}
+
+template<typename Real>
+__global__
+static void _average_pool_backward(Real* in_diff, MatrixDim d,
+                                   const Real* out_diff, int out_diff_stride,
+                                   const int32_cuda* out_blocks,
+                                   const Int32Pair* in_ranges,
+                                   const Real* scale, int block_dim) {
+  int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x;
+  int32_cuda j = blockIdx.y * blockDim.y + threadIdx.y;
+  if (i < d.cols && j < d.rows) {
+    int32_cuda p = i / block_dim, b = i % block_dim;
+    Real sum = 0.0;
+    for (int32_cuda k = in_ranges[p].first; k < in_ranges[p].second; k++)
+      sum += out_diff[out_blocks[k] * block_dim + b + j * out_diff_stride];
+    in_diff[i + j * d.stride] = sum * scale[p];
+  }
+}
+
 template<typename Real>
 __global__
 static void _one(Real* x, int dim) {
@@ -1805,6 +2078,381 @@ static void _randomize(Real* y, const Real* x, const int32_cuda* copy_from, Matr
 }
 
 
+// log(exp(x) + exp(y)), with -infinity for log(0).
+template<typename Real>
+__device__
+static Real _log_add(Real x, Real y) {
+  if (x < y) { Real tmp = x; x = y; y = tmp; }
+  Real diff = y - x, min_log_diff = (sizeof(Real) == sizeof(float) ?
+                                     log(FLT_EPSILON) : log(DBL_EPSILON));
+  // the test is written so that it also catches diff == NaN, which happens
+  // when x and y are both -infinity.
+  if (!(diff >= min_log_diff)) return x;
+  return x + log1p(exp(diff));
+}
+
+// Computes alpha (and alpha_acc if non-NULL) for the states state_begin ...
+// state_end - 1 of a levelled graph; see GraphForwardBackward() in cu-math.h.
+template<typename Real>
+__global__
+static void _levelled_graph_forward(const int32_cuda *in_offsets,
+                                    const int32_cuda *in_arcs,
+                                    const int32_cuda *arc_src,
+                                    const Real *arc_like, const Real *arc_acc,
+                                    int32_cuda state_begin,
+                                    int32_cuda state_end,
+                                    Real *alpha, Real *alpha_acc) {
+  int32_cuda s = state_begin + blockIdx.x * blockDim.x + threadIdx.x;
+  if (s >= state_end) return;
+  int32_cuda begin = in_offsets[s], end = in_offsets[s+1];
+  Real this_alpha = (s == 0 ? 0.0 : log(0.0));
+  for (int32_cuda i = begin; i < end; i++) {
+    int32_cuda a = in_arcs[i];
+    this_alpha = _log_add(this_alpha, alpha[arc_src[a]] + arc_like[a]);
+  }
+  alpha[s] = this_alpha;
+  if (alpha_acc != NULL) {
+    Real this_acc = 0.0;
+    for (int32_cuda i = begin; i < end; i++) {
+      int32_cuda a = in_arcs[i], src = arc_src[a];
+      Real scale = exp(alpha[src] + arc_like[a] - this_alpha);
+      if (scale == scale)  // i.e. not NaN, which we'd get if unreachable.
+        this_acc += scale * (alpha_acc[src] + arc_acc[a]);
+    }
+    alpha_acc[s] = this_acc;
+  }
+}
+
+// Computes beta (and beta_acc if non-NULL) for the states state_begin ...
+// state_end - 1 of a levelled graph.
+template<typename Real>
+__global__
+static void _levelled_graph_backward(const int32_cuda *out_offsets,
+                                     const int32_cuda *out_arcs,
+                                     const int32_cuda *arc_dest,
+                                     const Real *arc_like, const Real *arc_acc,
+                                     const Real *final_like,
+                                     int32_cuda state_begin,
+                                     int32_cuda state_end,
+                                     Real *beta, Real *beta_acc) {
+  int32_cuda s = state_begin + blockIdx.x * blockDim.x + threadIdx.x;
+  if (s >= state_end) return;
+  int32_cuda begin = out_offsets[s], end = out_offsets[s+1];
+  Real this_beta = final_like[s];
+  for (int32_cuda i = begin; i < end; i++) {
+    int32_cuda a = out_arcs[i];
+    this_beta = _log_add(this_beta, beta[arc_dest[a]] + arc_like[a]);
+  }
+  beta[s] = this_beta;
+  if (beta_acc != NULL) {
+    Real this_acc = 0.0;
+    for (int32_cuda i = begin; i < end; i++) {
+      int32_cuda a = out_arcs[i], dest = arc_dest[a];
+      Real scale = exp(beta[dest] + arc_like[a] - this_beta);
+      if (scale == scale)  // i.e. not NaN, which we'd get for dead ends.
+        this_acc += scale * (beta_acc[dest] + arc_acc[a]);
+    }
+    beta_acc[s] = this_acc;
+  }
+}
+
+template<typename Real>
+__global__
+static void _levelled_graph_arc_post(const int32_cuda *arc_src,
+                                     const int32_cuda *arc_dest,
+                                     const Real *arc_like, const Real *arc_acc,
+                                     const Real *alpha, const Real *beta,
+                                     const Real *alpha_acc,
+                                     const Real *beta_acc,
+                                     Real tot_like, Real tot_acc,
+                                     int32_cuda num_arcs, Real *arc_post) {
+  int32_cuda a = blockIdx.x * blockDim.x + threadIdx.x;
+  if (a >= num_arcs) return;
+  int32_cuda src = arc_src[a], dest = arc_dest[a];
+  Real post = exp(alpha[src] + arc_like[a] + beta[dest] - tot_like);
+  if (arc_acc != NULL)
+    post *= alpha_acc[src] + arc_acc[a] + beta_acc[dest] - tot_acc;
+  arc_post[a] = post;
+}
+
+// Each thread handles one matrix element, so no two threads write to the same
+// location.
+template<typename Real>
+__global__
+static void _matrix_add_arc_post(Real *data, MatrixDim dim, Real alpha,
+                                 const Int32Pair *elements,
+                                 const int32_cuda *element_offsets,
+                                 const int32_cuda *element_arcs,
+                                 int32_cuda num_elements,
+                                 const Real *arc_post) {
+  int32_cuda e = blockIdx.x * blockDim.x + threadIdx.x;
+  if (e >= num_elements) return;
+  Real sum = 0.0;
+  for (int32_cuda i = element_offsets[e]; i < element_offsets[e+1]; i++)
+    sum += arc_post[element_arcs[i]];
+  data[elements[e].first * dim.stride + elements[e].second] += alpha * sum;
+}
+
+// The Viterbi decoder in cu-viterbi-decoder.h keeps the best (cost, arc) of
+// each state in one 64-bit word, with the arc in the low 32 bits and the cost
+// in the high 32 bits, as a float whose bits have been mapped to an unsigned
+// integer in a way that preserves the order; so a single atomic operation
+// updates both, and ties go to the lower-numbered arc.
+__device__
+static inline uint32_cuda _float_to_ordered(float f) {
+  uint32_cuda b = __float_as_uint(f);
+  return (b & 0x80000000u) ? ~b : (b | 0x80000000u);
+}
+
+__device__
+static inline float _ordered_to_float(uint32_cuda o) {
+  return __uint_as_float((o & 0x80000000u) ? (o & 0x7fffffffu) : ~o);
+}
+
+// Sets *addr to min(*addr, val) and returns the old value.  64-bit atomics
+// need compute capability 1.2; the decoder can't run on older devices.
+__device__
+static inline unsigned long long _atomic_min_u64(unsigned long long *addr,
+                                                 unsigned long long val) {
+#if __CUDA_ARCH__ >= 120
+  unsigned long long old = *addr, assumed;
+  while (val < old) {
+    assumed = old;
+    old = atomicCAS(addr, assumed, val);
+    if (old == assumed) break;
+  }
+  return old;
+#else
+  __trap();
+  return 0;
+#endif
+}
+
+// Offers "cost" via arc "arc" to state "dest" of the frame being built.  The
+// first time a state is reached it is appended to new_states.
+__device__
+static inline void _viterbi_relax(unsigned long long *state_best,
+                                  int32_cuda dest, float cost, int32_cuda arc,
+                                  int32_cuda *new_states, int32_cuda *counters) {
+  uint32_cuda ordered_cost = _float_to_ordered(cost);
+  unsigned long long packed =
+      (static_cast<unsigned long long>(ordered_cost) << 32) |
+      static_cast<uint32_cuda>(arc);
+  unsigned long long old = _atomic_min_u64(state_best + dest, packed);
+  if (packed < old) {
+    if (old == ~0ULL)
+      new_states[atomicAdd(counters, 1)] = dest;
+    counters[1] = 1;
+    atomicMin(reinterpret_cast<uint32_cuda*>(counters + 2), ordered_cost);
+  }
+}
+
+// Each thread expands the emitting arcs of one token of the previous frame.
+template<typename Real>
+__global__
+static void _viterbi_expand_emitting(const int32_cuda *offsets,
+                                     const int32_cuda *eps_offsets,
+                                     const int32_cuda *arc_dest,
+                                     const int32_cuda *arc_col,
+                                     const Real *arc_cost, const Real *loglikes,
+                                     const int32_cuda *tok_state,
+                                     const Real *tok_cost,
+                                     int32_cuda tok_begin, int32_cuda tok_end,
+                                     Real cutoff, Real beam,
+                                     unsigned long long *state_best,
+                                     int32_cuda *new_states,
+                                     int32_cuda *counters) {
+  int32_cuda t = tok_begin + blockIdx.x * blockDim.x + threadIdx.x;
+  if (t >= tok_end) return;
+  Real cost = tok_cost[t];
+  if (!(cost < cutoff)) return;
+  int32_cuda s = tok_state[t];
+  for (int32_cuda a = offsets[s]; a < eps_offsets[s]; a++) {
+    Real new_cost = cost + arc_cost[a] - loglikes[arc_col[a]];
+    // counters[2] is the best cost so far in the frame being built; it is
+    // fine if we read a stale value.
+    if (new_cost < _ordered_to_float(counters[2]) + beam)
+      _viterbi_relax(state_best, arc_dest[a], new_cost, a, new_states,
+                     counters);
+  }
+}
+
+// Each thread expands the non-emitting arcs of one state of the frame being
+// built.  This is called repeatedly until counters[1] stays zero.
+template<typename Real>
+__global__
+static void _viterbi_expand_nonemitting(const int32_cuda *offsets,
+                                        const int32_cuda *eps_offsets,
+                                        const int32_cuda *arc_dest,
+                                        const Real *arc_cost, Real beam,
+                                        int32_cuda num_states,
+                                        unsigned long long *state_best,
+                                        int32_cuda *new_states,
+                                        int32_cuda *counters) {
+  int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i >= num_states) return;
+  int32_cuda s = new_states[i];
+  Real cost = _ordered_to_float(state_best[s] >> 32);
+  if (!(cost < _ordered_to_float(counters[2]) + beam)) return;
+  for (int32_cuda a = eps_offsets[s]; a < offsets[s+1]; a++)
+    _viterbi_relax(state_best, arc_dest[a], cost + arc_cost[a], a, new_states,
+                   counters);
+}
+
+__global__
+static void _viterbi_assign_tokens(const int32_cuda *new_states,
+                                   int32_cuda num_new, int32_cuda tok_begin,
+                                   int32_cuda *token_map,
+                                   int32_cuda *tok_state) {
+  int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i >= num_new) return;
+  int32_cuda s = new_states[i];
+  token_map[s] = tok_begin + i;
+  tok_state[tok_begin + i] = s;
+}
+
+// Sets the cost and back-pointer of each new token, and resets state_best.
+// The back-pointer of a token reached by an emitting arc is in the previous
+// frame, and by a non-emitting arc in the same frame.
+template<typename Real>
+__global__
+static void _viterbi_set_backpointers(const int32_cuda *arc_src,
+                                      const int32_cuda *arc_col,
+                                      const int32_cuda *new_states,
+                                      int32_cuda num_new, int32_cuda tok_begin,
+                                      const int32_cuda *prev_token_map,
+                                      const int32_cuda *cur_token_map,
+                                      unsigned long long *state_best,
+                                      Real *tok_cost, int32_cuda *tok_arc,
+                                      int32_cuda *tok_prev) {
+  int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i >= num_new) return;
+  int32_cuda s = new_states[i], t = tok_begin + i;
+  unsigned long long packed = state_best[s];
+  int32_cuda a = static_cast<int32_cuda>(
+      static_cast<uint32_cuda>(packed & 0xffffffffULL));
+  tok_cost[t] = _ordered_to_float(packed >> 32);
+  tok_arc[t] = a;
+  if (a < 0)
+    tok_prev[t] = -1;
+  else if (arc_col[a] >= 0)
+    tok_prev[t] = prev_token_map[arc_src[a]];
+  else
+    tok_prev[t] = cur_token_map[arc_src[a]];
+  state_best[s] = ~0ULL;
+}
+
+__global__
+static void _viterbi_clear_token_map(const int32_cuda *tok_state,
+                                     int32_cuda tok_begin, int32_cuda tok_end,
+                                     int32_cuda *token_map) {
+  int32_cuda t = tok_begin + blockIdx.x * blockDim.x + threadIdx.x;
+  if (t < tok_end) token_map[tok_state[t]] = -1;
+}
+
+
+// Batched operations on small positive definite matrices (see
+// CuInvertPosDefBatch() etc. in cu-sp-matrix.h).  Thread i processes the
+// matrix stored in packed lower-triangular format (as SpMatrix and TpMatrix
+// store it) at data[i]; all the matrices have dimension "dim".
+
+// Replaces A with its Cholesky factor; returns false if not positive definite.
+template<typename Real>
+__device__
+static bool _packed_cholesky(Real *A, int32_cuda dim) {
+  for (int32_cuda r = 0; r < dim; r++) {
+    Real *row_r = A + (r * (r + 1)) / 2;
+    for (int32_cuda c = 0; c <= r; c++) {
+      const Real *row_c = A + (c * (c + 1)) / 2;
+      Real s = row_r[c];
+      for (int32_cuda k = 0; k < c; k++) s -= row_r[k] * row_c[k];
+      if (c < r) row_r[c] = s / row_c[c];
+      else if (s > 0.0) row_r[r] = sqrt(s);
+      else return false;
+    }
+  }
+  return true;
+}
+
+// Given the Cholesky factor L, replaces it with (L L^T)^{-1}, in the same way
+// as InterleavedInvertCholesky() in matrix/sp-matrix-batch.cc.
+template<typename Real>
+__device__
+static void _packed_invert_cholesky(Real *A, int32_cuda dim) {
+  for (int32_cuda j = dim - 1; j >= 0; j--) {
+    Real *jj = A + (j * (j + 1)) / 2 + j;
+    *jj = 1.0 / *jj;
+    Real neg_inv_diag = -*jj;
+    for (int32_cuda i = dim - 1; i > j; i--) {
+      const Real *row_i = A + (i * (i + 1)) / 2;
+      Real s = 0.0;
+      for (int32_cuda k = j + 1; k <= i; k++)
+        s += row_i[k] * A[(k * (k + 1)) / 2 + j];
+      A[(i * (i + 1)) / 2 + j] = s * neg_inv_diag;
+    }
+  }
+  for (int32_cuda i = 0; i < dim; i++) {
+    for (int32_cuda j = 0; j <= i; j++) {
+      Real s = 0.0;
+      for (int32_cuda k = i; k < dim; k++) {
+        const Real *row_k = A + (k * (k + 1)) / 2;
+        s += row_k[i] * row_k[j];
+      }
+      A[(i * (i + 1)) / 2 + j] = s;
+    }
+  }
+}
+
+template<typename Real>
+__global__
+static void _cholesky_packed_batch(Real **data, int32_cuda dim,
+                                   int32_cuda num_mats, int32_cuda *failed) {
+  int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < num_mats)
+    failed[i] = (_packed_cholesky(data[i], dim) ? 0 : 1);
+}
+
+template<typename Real>
+__global__
+static void _invert_pos_def_packed_batch(Real **data, int32_cuda dim,
+                                         int32_cuda num_mats,
+                                         int32_cuda *failed) {
+  int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < num_mats) {
+    if (_packed_cholesky(data[i], dim)) {
+      failed[i] = 0;
+      _packed_invert_cholesky(data[i], dim);
+    } else {
+      failed[i] = 1;
+    }
+  }
+}
+
+// Solves L L^T x = b given the Cholesky factors chol[i]; vec[i] contains b on
+// input and x on output.
+template<typename Real>
+__global__
+static void _solve_cholesky_packed_batch(Real **chol, Real **vec,
+                                         int32_cuda dim, int32_cuda num_mats) {
+  int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i >= num_mats) return;
+  const Real *L = chol[i];
+  Real *v = vec[i];
+  for (int32_cuda r = 0; r < dim; r++) {
+    const Real *row_r = L + (r * (r + 1)) / 2;
+    Real s = v[r];
+    for (int32_cuda k = 0; k < r; k++) s -= row_r[k] * v[k];
+    v[r] = s / row_r[r];
+  }
+  for (int32_cuda r = dim - 1; r >= 0; r--) {
+    Real s = v[r];
+    for (int32_cuda k = r + 1; k < dim; k++)
+      s -= L[(k * (k + 1)) / 2 + r] * v[k];
+    v[r] = s / L[(r * (r + 1)) / 2 + r];
+  }
+}
+
+
 template<typename Real>
 __global__
 static void _regularize_l1(Real* wei, Real* grad, Real l1, Real lr, MatrixDim d) {
@@ -1879,6 +2527,21 @@ static void _diff_xent(const int32_cuda* vec_tgt, Real* mat_net_out, Real* vec_l
   }
 }
 
+template<typename Real>
+__global__
+static void _diff_xent_sparse(const MatrixElement<Real>* tgt, int num_tgt,
+                              Real* mat_net_out, Real* vec_log_post,
+                              MatrixDim d) {
+  int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < num_tgt) {
+    int32_cuda index = tgt[i].column + tgt[i].row * d.stride;
+    Real weight = tgt[i].weight, value = mat_net_out[index];
+    if (value < 1e-20) value = 1e-20;
+    vec_log_post[i] = weight * log(value);
+    mat_net_out[index] -= weight;
+  }
+}
+
 
 
 template<typename Real>
@@ -1904,6 +2567,14 @@ void cudaI32_set_const(dim3 Gr, dim3 Bl, int32_cuda* mat, int32_cuda value, Matr
   _set_const<<<Gr,Bl>>>(mat,value,d); 
 }
 
+void cudaI32_viterbi_assign_tokens(int Gr, int Bl, const int32_cuda *new_states, int32_cuda num_new, int32_cuda tok_begin, int32_cuda *token_map, int32_cuda *tok_state) {
+  _viterbi_assign_tokens<<<Gr,Bl>>>(new_states, num_new, tok_begin, token_map, tok_state);
+}
+
+void cudaI32_viterbi_clear_token_map(int Gr, int Bl, const int32_cuda *tok_state, int32_cuda tok_begin, int32_cuda tok_end, int32_cuda *token_map) {
+  _viterbi_clear_token_map<<<Gr,Bl>>>(tok_state, tok_begin, tok_end, token_map);
+}
+
 
 
 /*
@@ -1974,6 +2645,10 @@ void cudaF_apply_ceiling(dim3 Gr, dim3 Bl, float* mat, float ceiling_val, Matrix
   _apply_ceiling<<<Gr,Bl>>>(mat, ceiling_val, d);
 }
 
+void cudaF_uncompress_matrix(dim3 Gr, dim3 Bl, float* mat, MatrixDim d, const unsigned short* col_headers, const unsigned char* byte_data, float min_value, float range) {
+  _uncompress_matrix<<<Gr,Bl>>>(mat, d, col_headers, byte_data, min_value, range);
+}
+
 void cudaF_set_diag(int Gr, int Bl, float* mat, float value, MatrixDim d) {
   _set_diag<<<Gr,Bl>>>(mat,value,d);
 }
@@ -2037,6 +2712,27 @@ void cudaF_calc_pnorm_deriv(dim3 Gr, dim3 Bl, float *y, const float *x1,
   _calc_pnorm_deriv<<<Gr,Bl>>>(y, x1, x2, d, src_stride, group_size, power);
 }
 
+void cudaF_diff_group_pnorm(dim3 Gr, dim3 Bl, float *id, const float *iv,
+                             const float *ov, const float *od, MatrixDim d,
+                             int iv_stride, int ov_stride, int od_stride,
+                             int group_size, float power) {
+  _diff_group_pnorm<<<Gr,Bl>>>(id, iv, ov, od, d, iv_stride, ov_stride,
+                               od_stride, group_size, power);
+}
+
+void cudaF_group_max(dim3 Gr, dim3 Bl, float *y, const float *x, MatrixDim d,
+                      int src_stride, int group_size) {
+  _group_max<<<Gr,Bl>>>(y, x, d, src_stride, group_size);
+}
+
+void cudaF_diff_group_max(dim3 Gr, dim3 Bl, float *id, const float *iv,
+                           const float *ov, const float *od, MatrixDim d,
+                           int iv_stride, int ov_stride, int od_stride,
+                           int group_size) {
+  _diff_group_max<<<Gr,Bl>>>(id, iv, ov, od, d, iv_stride, ov_stride,
+                             od_stride, group_size);
+}
+
 void cudaF_div_rows_vec(dim3 Gr, dim3 Bl, float* mat, const float* vec_div, MatrixDim d) {
   _div_rows_vec<<<Gr,Bl>>>(mat, vec_div, d);
 }
@@ -2206,6 +2902,16 @@ void cudaF_block_add_mat_mat(dim3 Gr, dim3 Bl, CuBlockMatrixData *B_cu_data, int
                                 D_col_stride, alpha, beta);
 }
 
+void cudaF_add_mat_mat_batched(dim3 Gr, dim3 Bl, float alpha,
+                               float * const *A, int A_row_stride, int A_col_stride,
+                               float * const *B, int B_row_stride, int B_col_stride,
+                               float beta, float * const *C, int C_stride,
+                               int num_rows, int num_cols, int inner_dim) {
+  _add_mat_mat_batched<<<Gr,Bl>>>(alpha, A, A_row_stride, A_col_stride,
+                                  B, B_row_stride, B_col_stride, beta, C,
+                                  C_stride, num_rows, num_cols, inner_dim);
+}
+
 /*
  * cu::
  */
@@ -2229,6 +2935,14 @@ void cudaF_tanh (dim3 Gr, dim3 Bl, float* y, const float* x, MatrixDim d, int sr
   _tanh<<<Gr,Bl>>>(y, x, d, src_stride); 
 }
 
+void cudaF_sigmoid_with_bias (dim3 Gr, dim3 Bl, float* y, const float* x, const float* bias, MatrixDim d, int src_stride) {
+  _sigmoid_with_bias<<<Gr,Bl>>>(y, x, bias, d, src_stride);
+}
+
+void cudaF_tanh_with_bias (dim3 Gr, dim3 Bl, float* y, const float* x, const float* bias, MatrixDim d, int src_stride) {
+  _tanh_with_bias<<<Gr,Bl>>>(y, x, bias, d, src_stride);
+}
+
 void cudaF_diff_tanh (dim3 Gr, dim3 Bl, float* eout, const float* e, const float* y, MatrixDim d) {
   _diff_tanh<<<Gr,Bl>>>(eout, e, y, d);
 }
@@ -2273,12 +2987,65 @@ void cudaF_copy_from_sp(dim3 Gr, dim3 Bl, const float* x, float* y, MatrixDim di
 void cudaF_copy(dim3 Gr, dim3 Bl, float* y, const float* x, const int32_cuda* copy_from, MatrixDim d_out, MatrixDim d_in) {
   _copy<<<Gr,Bl>>>(y,x,copy_from,d_out,d_in); 
 }
+
+void cudaF_max_pool(dim3 Gr, dim3 Bl, float* y, MatrixDim d_out, const float* x, int x_stride, const int32_cuda* pool_blocks, int pool_size, int block_dim) {
+  _max_pool<<<Gr,Bl>>>(y,d_out,x,x_stride,pool_blocks,pool_size,block_dim);
+}
+
+void cudaF_average_pool(dim3 Gr, dim3 Bl, float* y, MatrixDim d_out, const float* x, int x_stride, const int32_cuda* pool_blocks, int pool_size, int block_dim) {
+  _average_pool<<<Gr,Bl>>>(y,d_out,x,x_stride,pool_blocks,pool_size,block_dim);
+}
+
+void cudaF_max_pool_backward(dim3 Gr, dim3 Bl, float* in_diff, MatrixDim d, const float* in, int in_stride, const float* out, int out_stride, const float* out_diff, int out_diff_stride, const int32_cuda* out_blocks, const Int32Pair* in_ranges, const float* scale, int block_dim) {
+  _max_pool_backward<<<Gr,Bl>>>(in_diff,d,in,in_stride,out,out_stride,out_diff,out_diff_stride,out_blocks,in_ranges,scale,block_dim);
+}
+
+void cudaF_average_pool_backward(dim3 Gr, dim3 Bl, float* in_diff, MatrixDim d, const float* out_diff, int out_diff_stride, const int32_cuda* out_blocks, const Int32Pair* in_ranges, const float* scale, int block_dim) {
+  _average_pool_backward<<<Gr,Bl>>>(in_diff,d,out_diff,out_diff_stride,out_blocks,in_ranges,scale,block_dim);
+}
   
 void cudaF_randomize(dim3 Gr, dim3 Bl, float* y, const float* x, const int32_cuda* copy_from, MatrixDim d_out, MatrixDim d_in) { 
   _randomize<<<Gr,Bl>>>(y,x,copy_from,d_out,d_in); 
 }
 
 
+void cudaF_levelled_graph_forward(int Gr, int Bl, const int32_cuda *in_offsets, const int32_cuda *in_arcs, const int32_cuda *arc_src, const float *arc_like, const float *arc_acc, int32_cuda state_begin, int32_cuda state_end, float *alpha, float *alpha_acc) {
+  _levelled_graph_forward<<<Gr,Bl>>>(in_offsets, in_arcs, arc_src, arc_like, arc_acc, state_begin, state_end, alpha, alpha_acc);
+}
+
+void cudaF_levelled_graph_backward(int Gr, int Bl, const int32_cuda *out_offsets, const int32_cuda *out_arcs, const int32_cuda *arc_dest, const float *arc_like, const float *arc_acc, const float *final_like, int32_cuda state_begin, int32_cuda state_end, float *beta, float *beta_acc) {
+  _levelled_graph_backward<<<Gr,Bl>>>(out_offsets, out_arcs, arc_dest, arc_like, arc_acc, final_like, state_begin, state_end, beta, beta_acc);
+}
+
+void cudaF_levelled_graph_arc_post(int Gr, int Bl, const int32_cuda *arc_src, const int32_cuda *arc_dest, const float *arc_like, const float *arc_acc, const float *alpha, const float *beta, const float *alpha_acc, const float *beta_acc, float tot_like, float tot_acc, int32_cuda num_arcs, float *arc_post) {
+  _levelled_graph_arc_post<<<Gr,Bl>>>(arc_src, arc_dest, arc_like, arc_acc, alpha, beta, alpha_acc, beta_acc, tot_like, tot_acc, num_arcs, arc_post);
+}
+
+void cudaF_matrix_add_arc_post(int Gr, int Bl, float *data, MatrixDim dim, float alpha, const Int32Pair *elements, const int32_cuda *element_offsets, const int32_cuda *element_arcs, int32_cuda num_elements, const float *arc_post) {
+  _matrix_add_arc_post<<<Gr,Bl>>>(data, dim, alpha, elements, element_offsets, element_arcs, num_elements, arc_post);
+}
+
+void cudaF_viterbi_expand_emitting(int Gr, int Bl, const int32_cuda *offsets, const int32_cuda *eps_offsets, const int32_cuda *arc_dest, const int32_cuda *arc_col, const float *arc_cost, const float *loglikes, const int32_cuda *tok_state, const float *tok_cost, int32_cuda tok_begin, int32_cuda tok_end, float cutoff, float beam, unsigned long long *state_best, int32_cuda *new_states, int32_cuda *counters) {
+  _viterbi_expand_emitting<<<Gr,Bl>>>(offsets, eps_offsets, arc_dest, arc_col, arc_cost, loglikes, tok_state, tok_cost, tok_begin, tok_end, cutoff, beam, state_best, new_states, counters);
+}
+
+void cudaF_viterbi_expand_nonemitting(int Gr, int Bl, const int32_cuda *offsets, const int32_cuda *eps_offsets, const int32_cuda *arc_dest, const float *arc_cost, float beam, int32_cuda num_states, unsigned long long *state_best, int32_cuda *new_states, int32_cuda *counters) {
+  _viterbi_expand_nonemitting<<<Gr,Bl>>>(offsets, eps_offsets, arc_dest, arc_cost, beam, num_states, state_best, new_states, counters);
+}
+
+void cudaF_viterbi_set_backpointers(int Gr, int Bl, const int32_cuda *arc_src, const int32_cuda *arc_col, const int32_cuda *new_states, int32_cuda num_new, int32_cuda tok_begin, const int32_cuda *prev_token_map, const int32_cuda *cur_token_map, unsigned long long *state_best, float *tok_cost, int32_cuda *tok_arc, int32_cuda *tok_prev) {
+  _viterbi_set_backpointers<<<Gr,Bl>>>(arc_src, arc_col, new_states, num_new, tok_begin, prev_token_map, cur_token_map, state_best, tok_cost, tok_arc, tok_prev);
+}
+void cudaF_cholesky_packed_batch(int Gr, int Bl, float **data, int32_cuda dim, int32_cuda num_mats, int32_cuda *failed) {
+  _cholesky_packed_batch<<<Gr,Bl>>>(data, dim, num_mats, failed);
+}
+void cudaF_invert_pos_def_packed_batch(int Gr, int Bl, float **data, int32_cuda dim, int32_cuda num_mats, int32_cuda *failed) {
+  _invert_pos_def_packed_batch<<<Gr,Bl>>>(data, dim, num_mats, failed);
+}
+void cudaF_solve_cholesky_packed_batch(int Gr, int Bl, float **chol, float **vec, int32_cuda dim, int32_cuda num_mats) {
+  _solve_cholesky_packed_batch<<<Gr,Bl>>>(chol, vec, dim, num_mats);
+}
+
 void cudaF_regularize_l1(dim3 Gr, dim3 Bl, float* wei, float* grad, float l1, float lr, MatrixDim d) {
   _regularize_l1<<<Gr,Bl>>>(wei,grad,l1,lr,d); 
 }
@@ -2291,6 +3058,10 @@ void cudaF_diff_xent(dim3 Gr, dim3 Bl, const int32_cuda* vec_tgt, float* mat_net
   _diff_xent<<<Gr,Bl>>>(vec_tgt,mat_net_out,vec_log_post,d);
 }
 
+void cudaF_diff_xent_sparse(dim3 Gr, dim3 Bl, const MatrixElement<float>* tgt, int num_tgt, float* mat_net_out, float* vec_log_post, MatrixDim d) {
+  _diff_xent_sparse<<<Gr,Bl>>>(tgt,num_tgt,mat_net_out,vec_log_post,d);
+}
+
 void cudaF_copy_rows_from_vec(dim3 Gr, dim3 Bl, float *mat_out, MatrixDim d_out, const float *v_in) {
   _copy_rows_from_vec<<<Gr,Bl>>>(mat_out, d_out, v_in);
 }
@@ -2313,6 +3084,13 @@ void cudaF_sum_column_ranges(dim3 Gr, dim3 Bl, float *data, MatrixDim dim,
   _sum_column_ranges<<<Gr,Bl>>>(data, dim, src_data, src_dim, indices);
 }
 
+void cudaF_log_sum_exp_column_ranges(dim3 Gr, dim3 Bl, float *data,
+                                     MatrixDim dim, const float *src_data,
+                                     MatrixDim src_dim,
+                                     const Int32Pair *indices) {
+  _log_sum_exp_column_ranges<<<Gr,Bl>>>(data, dim, src_data, src_dim, indices);
+}
+
 void cudaF_matrix_lookup(dim3 Gr, dim3 Bl, const float *data, MatrixDim dim,
                          const Int32Pair *indices, int indices_size,
                          float *output) {
@@ -2392,6 +3170,10 @@ void cudaD_apply_ceiling(dim3 Gr, dim3 Bl, double* mat, double ceiling_val, Matr
   _apply_ceiling<<<Gr,Bl>>>(mat, ceiling_val, d);
 }
 
+void cudaD_uncompress_matrix(dim3 Gr, dim3 Bl, double* mat, MatrixDim d, const unsigned short* col_headers, const unsigned char* byte_data, float min_value, float range) {
+  _uncompress_matrix<<<Gr,Bl>>>(mat, d, col_headers, byte_data, min_value, range);
+}
+
 void cudaD_set_diag(int Gr, int Bl, double* mat, double value, MatrixDim d) {
   _set_diag<<<Gr,Bl>>>(mat,value,d);
 }
@@ -2455,6 +3237,27 @@ void cudaD_calc_pnorm_deriv(dim3 Gr, dim3 Bl, double*y, const double* x1,
   _calc_pnorm_deriv<<<Gr,Bl>>>(y, x1, x2, d, src_stride, group_size, power);
 }
 
+void cudaD_diff_group_pnorm(dim3 Gr, dim3 Bl, double *id, const double *iv,
+                             const double *ov, const double *od, MatrixDim d,
+                             int iv_stride, int ov_stride, int od_stride,
+                             int group_size, double power) {
+  _diff_group_pnorm<<<Gr,Bl>>>(id, iv, ov, od, d, iv_stride, ov_stride,
+                               od_stride, group_size, power);
+}
+
+void cudaD_group_max(dim3 Gr, dim3 Bl, double *y, const double *x, MatrixDim d,
+                      int src_stride, int group_size) {
+  _group_max<<<Gr,Bl>>>(y, x, d, src_stride, group_size);
+}
+
+void cudaD_diff_group_max(dim3 Gr, dim3 Bl, double *id, const double *iv,
+                           const double *ov, const double *od, MatrixDim d,
+                           int iv_stride, int ov_stride, int od_stride,
+                           int group_size) {
+  _diff_group_max<<<Gr,Bl>>>(id, iv, ov, od, d, iv_stride, ov_stride,
+                             od_stride, group_size);
+}
+
 void cudaD_div_rows_vec(dim3 Gr, dim3 Bl, double* mat, const double* vec_div, MatrixDim d) {
   _div_rows_vec<<<Gr,Bl>>>(mat, vec_div, d);
 }
@@ -2625,6 +3428,16 @@ void cudaD_block_add_mat_mat(dim3 Gr, dim3 Bl, CuBlockMatrixData *B_cu_data, int
                                 D_col_stride, alpha, beta);
 }
 
+void cudaD_add_mat_mat_batched(dim3 Gr, dim3 Bl, double alpha,
+                               double * const *A, int A_row_stride, int A_col_stride,
+                               double * const *B, int B_row_stride, int B_col_stride,
+                               double beta, double * const *C, int C_stride,
+                               int num_rows, int num_cols, int inner_dim) {
+  _add_mat_mat_batched<<<Gr,Bl>>>(alpha, A, A_row_stride, A_col_stride,
+                                  B, B_row_stride, B_col_stride, beta, C,
+                                  C_stride, num_rows, num_cols, inner_dim);
+}
+
 /*
  * cu::
  */
@@ -2649,6 +3462,14 @@ void cudaD_tanh (dim3 Gr, dim3 Bl, double* y, const double* x, MatrixDim d, int
   _tanh<<<Gr,Bl>>>(y, x, d, src_stride); 
 }
 
+void cudaD_sigmoid_with_bias (dim3 Gr, dim3 Bl, double* y, const double* x, const double* bias, MatrixDim d, int src_stride) {
+  _sigmoid_with_bias<<<Gr,Bl>>>(y, x, bias, d, src_stride);
+}
+
+void cudaD_tanh_with_bias (dim3 Gr, dim3 Bl, double* y, const double* x, const double* bias, MatrixDim d, int src_stride) {
+  _tanh_with_bias<<<Gr,Bl>>>(y, x, bias, d, src_stride);
+}
+
 void cudaD_diff_tanh (dim3 Gr, dim3 Bl, double* eout, const double* e, const double* y, MatrixDim d) {
   _diff_tanh<<<Gr,Bl>>>(eout, e, y, d);
 }
@@ -2693,11 +3514,64 @@ void cudaD_copy_from_sp(dim3 Gr, dim3 Bl, const double* x, double* y, MatrixDim
 void cudaD_copy(dim3 Gr, dim3 Bl, double* y, const double* x, const int32_cuda* copy_from, MatrixDim d_out, MatrixDim d_in) {
   _copy<<<Gr,Bl>>>(y,x,copy_from,d_out,d_in); 
 }
+
+void cudaD_max_pool(dim3 Gr, dim3 Bl, double* y, MatrixDim d_out, const double* x, int x_stride, const int32_cuda* pool_blocks, int pool_size, int block_dim) {
+  _max_pool<<<Gr,Bl>>>(y,d_out,x,x_stride,pool_blocks,pool_size,block_dim);
+}
+
+void cudaD_average_pool(dim3 Gr, dim3 Bl, double* y, MatrixDim d_out, const double* x, int x_stride, const int32_cuda* pool_blocks, int pool_size, int block_dim) {
+  _average_pool<<<Gr,Bl>>>(y,d_out,x,x_stride,pool_blocks,pool_size,block_dim);
+}
+
+void cudaD_max_pool_backward(dim3 Gr, dim3 Bl, double* in_diff, MatrixDim d, const double* in, int in_stride, const double* out, int out_stride, const double* out_diff, int out_diff_stride, const int32_cuda* out_blocks, const Int32Pair* in_ranges, const double* scale, int block_dim) {
+  _max_pool_backward<<<Gr,Bl>>>(in_diff,d,in,in_stride,out,out_stride,out_diff,out_diff_stride,out_blocks,in_ranges,scale,block_dim);
+}
+
+void cudaD_average_pool_backward(dim3 Gr, dim3 Bl, double* in_diff, MatrixDim d, const double* out_diff, int out_diff_stride, const int32_cuda* out_blocks, const Int32Pair* in_ranges, const double* scale, int block_dim) {
+  _average_pool_backward<<<Gr,Bl>>>(in_diff,d,out_diff,out_diff_stride,out_blocks,in_ranges,scale,block_dim);
+}
   
 void cudaD_randomize(dim3 Gr, dim3 Bl, double* y, const double* x, const int32_cuda* copy_from, MatrixDim d_out, MatrixDim d_in) { 
   _randomize<<<Gr,Bl>>>(y,x,copy_from,d_out,d_in); 
 }
 
+void cudaD_levelled_graph_forward(int Gr, int Bl, const int32_cuda *in_offsets, const int32_cuda *in_arcs, const int32_cuda *arc_src, const double *arc_like, const double *arc_acc, int32_cuda state_begin, int32_cuda state_end, double *alpha, double *alpha_acc) {
+  _levelled_graph_forward<<<Gr,Bl>>>(in_offsets, in_arcs, arc_src, arc_like, arc_acc, state_begin, state_end, alpha, alpha_acc);
+}
+
+void cudaD_levelled_graph_backward(int Gr, int Bl, const int32_cuda *out_offsets, const int32_cuda *out_arcs, const int32_cuda *arc_dest, const double *arc_like, const double *arc_acc, const double *final_like, int32_cuda state_begin, int32_cuda state_end, double *beta, double *beta_acc) {
+  _levelled_graph_backward<<<Gr,Bl>>>(out_offsets, out_arcs, arc_dest, arc_like, arc_acc, final_like, state_begin, state_end, beta, beta_acc);
+}
+
+void cudaD_levelled_graph_arc_post(int Gr, int Bl, const int32_cuda *arc_src, const int32_cuda *arc_dest, const double *arc_like, const double *arc_acc, const double *alpha, const double *beta, const double *alpha_acc, const double *beta_acc, double tot_like, double tot_acc, int32_cuda num_arcs, double *arc_post) {
+  _levelled_graph_arc_post<<<Gr,Bl>>>(arc_src, arc_dest, arc_like, arc_acc, alpha, beta, alpha_acc, beta_acc, tot_like, tot_acc, num_arcs, arc_post);
+}
+
+void cudaD_matrix_add_arc_post(int Gr, int Bl, double *data, MatrixDim dim, double alpha, const Int32Pair *elements, const int32_cuda *element_offsets, const int32_cuda *element_arcs, int32_cuda num_elements, const double *arc_post) {
+  _matrix_add_arc_post<<<Gr,Bl>>>(data, dim, alpha, elements, element_offsets, element_arcs, num_elements, arc_post);
+}
+
+void cudaD_viterbi_expand_emitting(int Gr, int Bl, const int32_cuda *offsets, const int32_cuda *eps_offsets, const int32_cuda *arc_dest, const int32_cuda *arc_col, const double *arc_cost, const double *loglikes, const int32_cuda *tok_state, const double *tok_cost, int32_cuda tok_begin, int32_cuda tok_end, double cutoff, double beam, unsigned long long *state_best, int32_cuda *new_states, int32_cuda *counters) {
+  _viterbi_expand_emitting<<<Gr,Bl>>>(offsets, eps_offsets, arc_dest, arc_col, arc_cost, loglikes, tok_state, tok_cost, tok_begin, tok_end, cutoff, beam, state_best, new_states, counters);
+}
+
+void cudaD_viterbi_expand_nonemitting(int Gr, int Bl, const int32_cuda *offsets, const int32_cuda *eps_offsets, const int32_cuda *arc_dest, const double *arc_cost, double beam, int32_cuda num_states, unsigned long long *state_best, int32_cuda *new_states, int32_cuda *counters) {
+  _viterbi_expand_nonemitting<<<Gr,Bl>>>(offsets, eps_offsets, arc_dest, arc_cost, beam, num_states, state_best, new_states, counters);
+}
+
+void cudaD_viterbi_set_backpointers(int Gr, int Bl, const int32_cuda *arc_src, const int32_cuda *arc_col, const int32_cuda *new_states, int32_cuda num_new, int32_cuda tok_begin, const int32_cuda *prev_token_map, const int32_cuda *cur_token_map, unsigned long long *state_best, double *tok_cost, int32_cuda *tok_arc, int32_cuda *tok_prev) {
+  _viterbi_set_backpointers<<<Gr,Bl>>>(arc_src, arc_col, new_states, num_new, tok_begin, prev_token_map, cur_token_map, state_best, tok_cost, tok_arc, tok_prev);
+}
+void cudaD_cholesky_packed_batch(int Gr, int Bl, double **data, int32_cuda dim, int32_cuda num_mats, int32_cuda *failed) {
+  _cholesky_packed_batch<<<Gr,Bl>>>(data, dim, num_mats, failed);
+}
+void cudaD_invert_pos_def_packed_batch(int Gr, int Bl, double **data, int32_cuda dim, int32_cuda num_mats, int32_cuda *failed) {
+  _invert_pos_def_packed_batch<<<Gr,Bl>>>(data, dim, num_mats, failed);
+}
+void cudaD_solve_cholesky_packed_batch(int Gr, int Bl, double **chol, double **vec, int32_cuda dim, int32_cuda num_mats) {
+  _solve_cholesky_packed_batch<<<Gr,Bl>>>(chol, vec, dim, num_mats);
+}
+
 void cudaD_regularize_l1(dim3 Gr, dim3 Bl, double* wei, double* grad, double l1, double lr, MatrixDim d) {
   _regularize_l1<<<Gr,Bl>>>(wei,grad,l1,lr,d); 
 }
@@ -2710,6 +3584,10 @@ void cudaD_diff_xent(dim3 Gr, dim3 Bl, const int32_cuda* vec_tgt, double* mat_ne
   _diff_xent<<<Gr,Bl>>>(vec_tgt,mat_net_out,vec_log_post,d);
 }
 
+void cudaD_diff_xent_sparse(dim3 Gr, dim3 Bl, const MatrixElement<double>* tgt, int num_tgt, double* mat_net_out, double* vec_log_post, MatrixDim d) {
+  _diff_xent_sparse<<<Gr,Bl>>>(tgt,num_tgt,mat_net_out,vec_log_post,d);
+}
+
 void cudaD_copy_rows_from_vec(dim3 Gr, dim3 Bl, double *mat_out, MatrixDim d_out, const double *v_in) {
   _copy_rows_from_vec<<<Gr,Bl>>>(mat_out, d_out, v_in);
 }
@@ -2720,6 +3598,13 @@ void cudaD_sum_column_ranges(dim3 Gr, dim3 Bl, double *data, MatrixDim dim,
   _sum_column_ranges<<<Gr,Bl>>>(data, dim, src_data, src_dim, indices);
 }
 
+void cudaD_log_sum_exp_column_ranges(dim3 Gr, dim3 Bl, double *data,
+                                     MatrixDim dim, const double *src_data,
+                                     MatrixDim src_dim,
+                                     const Int32Pair *indices) {
+  _log_sum_exp_column_ranges<<<Gr,Bl>>>(data, dim, src_data, src_dim, indices);
+}
+
 void cudaD_matrix_lookup(dim3 Gr, dim3 Bl, const double *data, MatrixDim dim,
                          const Int32Pair *indices, int indices_size,
                          double *output) {
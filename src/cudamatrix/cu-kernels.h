@@ -88,6 +88,7 @@ inline void cuda_apply_pow(dim3 Gr, dim3 Bl, float* mat, float power, MatrixDim
 inline void cuda_apply_heaviside(dim3 Gr, dim3 Bl, float* mat, MatrixDim dim) { cudaF_apply_heaviside(Gr,Bl,mat,dim); }
 inline void cuda_apply_floor(dim3 Gr, dim3 Bl, float* mat, float floor_val, MatrixDim dim) { cudaF_apply_floor(Gr,Bl,mat,floor_val,dim); }
 inline void cuda_apply_ceiling(dim3 Gr, dim3 Bl, float* mat, float ceiling_val, MatrixDim dim) { cudaF_apply_ceiling(Gr,Bl,mat,ceiling_val,dim); }
+inline void cuda_uncompress_matrix(dim3 Gr, dim3 Bl, float* mat, MatrixDim d, const unsigned short* col_headers, const unsigned char* byte_data, float min_value, float range) { cudaF_uncompress_matrix(Gr,Bl,mat,d,col_headers,byte_data,min_value,range); }
 inline void cuda_copy_cols(dim3 Gr, dim3 Bl, float* dst, const float* src, const MatrixIndexT_cuda* reorder, MatrixDim dst_dim, int src_stride) {
   cudaF_copy_cols(Gr, Bl, dst, src, reorder, dst_dim, src_stride);
 }
@@ -115,6 +116,9 @@ inline void cuda_mul_cols_vec(dim3 Gr, dim3 Bl, float *mat, const float *scale,
 inline void cuda_mul_rows_vec(dim3 Gr, dim3 Bl, float *mat, const float *scale, MatrixDim d) { cudaF_mul_rows_vec(Gr,Bl,mat,scale,d); }
 inline void cuda_mul_rows_group_mat(dim3 Gr, dim3 Bl, float *y, const float *x, MatrixDim d, int src_stride, int group_size) { cudaF_mul_rows_group_mat(Gr, Bl, y, x, d, src_stride, group_size); }
 inline void cuda_calc_pnorm_deriv(dim3 Gr, dim3 Bl, float *y, const float *x1, const float *x2,  MatrixDim d, int src_stride, int group_size, float power) {cudaF_calc_pnorm_deriv(Gr, Bl, y, x1, x2, d, src_stride, group_size, power); }
+inline void cuda_diff_group_pnorm(dim3 Gr, dim3 Bl, float *id, const float *iv, const float *ov, const float *od, MatrixDim d, int iv_stride, int ov_stride, int od_stride, int group_size, float power) { cudaF_diff_group_pnorm(Gr, Bl, id, iv, ov, od, d, iv_stride, ov_stride, od_stride, group_size, power); }
+inline void cuda_group_max(dim3 Gr, dim3 Bl, float *y, const float *x, MatrixDim d, int src_stride, int group_size) { cudaF_group_max(Gr, Bl, y, x, d, src_stride, group_size); }
+inline void cuda_diff_group_max(dim3 Gr, dim3 Bl, float *id, const float *iv, const float *ov, const float *od, MatrixDim d, int iv_stride, int ov_stride, int od_stride, int group_size) { cudaF_diff_group_max(Gr, Bl, id, iv, ov, od, d, iv_stride, ov_stride, od_stride, group_size); }
 inline void cuda_add_mat(dim3 Gr, dim3 Bl, float alpha, const float *src, float *dst, MatrixDim d, int src_stride, int A_trans) { cudaF_add_mat(Gr,Bl,alpha,src,dst,d,src_stride, A_trans); }
 inline void cuda_add_mat_mat_div_mat(dim3 Gr, dim3 Bl, const float *A, const float *B, const float *C, float *dst, MatrixDim d) { cudaF_add_mat_mat_div_mat(Gr,Bl,A,B,C,dst,d); }
 inline void cuda_add_vec_to_cols(dim3 Gr, dim3 Bl, float alpha, const float *col, float beta, float *dst, MatrixDim d) { cudaF_add_vec_to_cols(Gr,Bl,alpha,col,beta,dst,d); }
@@ -177,6 +181,15 @@ inline void cuda_block_add_mat_mat(dim3 Gr, dim3 Bl, CuBlockMatrixData *B_cu_dat
                           C_row_stride, C_col_stride, D_data, D_row_stride,
                           D_col_stride, alpha, beta);
 }
+inline void cuda_add_mat_mat_batched(dim3 Gr, dim3 Bl, float alpha,
+                                     float * const *A, int A_row_stride, int A_col_stride,
+                                     float * const *B, int B_row_stride, int B_col_stride,
+                                     float beta, float * const *C, int C_stride,
+                                     int num_rows, int num_cols, int inner_dim) {
+  cudaF_add_mat_mat_batched(Gr, Bl, alpha, A, A_row_stride, A_col_stride,
+                            B, B_row_stride, B_col_stride, beta, C, C_stride,
+                            num_rows, num_cols, inner_dim);
+}
 
 
 
@@ -188,6 +201,8 @@ inline void cuda_group_pnorm(dim3 Gr, dim3 Bl, float *y, const float *x, MatrixD
 inline void cuda_sigmoid(dim3 Gr, dim3 Bl, float *y, const float *x, MatrixDim d, int src_stride) { cudaF_sigmoid(Gr,Bl,y,x,d,src_stride); }
 inline void cuda_diff_sigmoid(dim3 Gr, dim3 Bl, float *eout, const float *e, const float *y, MatrixDim d, int src_stride) { cudaF_diff_sigmoid(Gr,Bl,eout,e,y,d,src_stride); }
 inline void cuda_tanh(dim3 Gr, dim3 Bl, float *y, const float *x, MatrixDim d, int src_stride) { cudaF_tanh(Gr,Bl,y,x,d,src_stride); }
+inline void cuda_sigmoid_with_bias(dim3 Gr, dim3 Bl, float *y, const float *x, const float *bias, MatrixDim d, int src_stride) { cudaF_sigmoid_with_bias(Gr,Bl,y,x,bias,d,src_stride); }
+inline void cuda_tanh_with_bias(dim3 Gr, dim3 Bl, float *y, const float *x, const float *bias, MatrixDim d, int src_stride) { cudaF_tanh_with_bias(Gr,Bl,y,x,bias,d,src_stride); }
 inline void cuda_diff_tanh(dim3 Gr, dim3 Bl, float *eout, const float *e, const float *y, MatrixDim d) { cudaF_diff_tanh(Gr,Bl,eout,e,y,d); }
 inline void cuda_softmax(size_t Gr, size_t Bl, float *y, const float *x, MatrixDim d) { cudaF_softmax(Gr,Bl,y,x,d); }
 /*
@@ -200,16 +215,52 @@ inline void cuda_softmax_part(dim3 Gr, dim3 Bl, const float *X, const int32_cuda
 inline void cuda_regularize_l1(dim3 Gr, dim3 Bl, float *wei, float *grad, float l1, float lr, MatrixDim d) { cudaF_regularize_l1(Gr,Bl,wei,grad,l1,lr,d); }
 inline void cuda_find_row_max_id(dim3 Gr, dim3 Bl, const float *mat, float *vec_val, int32_cuda *vec_id, int32_cuda voff, MatrixDim d) { cudaF_find_row_max_id(Gr,Bl,mat,vec_val,vec_id,voff,d); }
 inline void cuda_diff_xent(dim3 Gr, dim3 Bl, const int32_cuda *vec_tgt, float *mat_net_out, float *vec_log_post, MatrixDim d) { cudaF_diff_xent(Gr,Bl,vec_tgt,mat_net_out,vec_log_post,d); }
+inline void cuda_diff_xent_sparse(dim3 Gr, dim3 Bl, const MatrixElement<float> *tgt, int num_tgt, float *mat_net_out, float *vec_log_post, MatrixDim d) { cudaF_diff_xent_sparse(Gr,Bl,tgt,num_tgt,mat_net_out,vec_log_post,d); }
 inline void cuda_copy_rows_from_vec(dim3 Gr, dim3 Bl, float *mat_out, MatrixDim d_out, const float *v_in) {
   cudaF_copy_rows_from_vec(Gr, Bl, mat_out, d_out, v_in);
 }
 
 
+inline void cuda_levelled_graph_forward(int Gr, int Bl, const int32_cuda *in_offsets, const int32_cuda *in_arcs, const int32_cuda *arc_src, const float *arc_like, const float *arc_acc, int32_cuda state_begin, int32_cuda state_end, float *alpha, float *alpha_acc) {
+  cudaF_levelled_graph_forward(Gr, Bl, in_offsets, in_arcs, arc_src, arc_like, arc_acc, state_begin, state_end, alpha, alpha_acc);
+}
+inline void cuda_levelled_graph_backward(int Gr, int Bl, const int32_cuda *out_offsets, const int32_cuda *out_arcs, const int32_cuda *arc_dest, const float *arc_like, const float *arc_acc, const float *final_like, int32_cuda state_begin, int32_cuda state_end, float *beta, float *beta_acc) {
+  cudaF_levelled_graph_backward(Gr, Bl, out_offsets, out_arcs, arc_dest, arc_like, arc_acc, final_like, state_begin, state_end, beta, beta_acc);
+}
+inline void cuda_levelled_graph_arc_post(int Gr, int Bl, const int32_cuda *arc_src, const int32_cuda *arc_dest, const float *arc_like, const float *arc_acc, const float *alpha, const float *beta, const float *alpha_acc, const float *beta_acc, float tot_like, float tot_acc, int32_cuda num_arcs, float *arc_post) {
+  cudaF_levelled_graph_arc_post(Gr, Bl, arc_src, arc_dest, arc_like, arc_acc, alpha, beta, alpha_acc, beta_acc, tot_like, tot_acc, num_arcs, arc_post);
+}
+inline void cuda_matrix_add_arc_post(int Gr, int Bl, float *data, MatrixDim dim, float alpha, const Int32Pair *elements, const int32_cuda *element_offsets, const int32_cuda *element_arcs, int32_cuda num_elements, const float *arc_post) {
+  cudaF_matrix_add_arc_post(Gr, Bl, data, dim, alpha, elements, element_offsets, element_arcs, num_elements, arc_post);
+}
+inline void cuda_viterbi_expand_emitting(int Gr, int Bl, const int32_cuda *offsets, const int32_cuda *eps_offsets, const int32_cuda *arc_dest, const int32_cuda *arc_col, const float *arc_cost, const float *loglikes, const int32_cuda *tok_state, const float *tok_cost, int32_cuda tok_begin, int32_cuda tok_end, float cutoff, float beam, unsigned long long *state_best, int32_cuda *new_states, int32_cuda *counters) {
+  cudaF_viterbi_expand_emitting(Gr, Bl, offsets, eps_offsets, arc_dest, arc_col, arc_cost, loglikes, tok_state, tok_cost, tok_begin, tok_end, cutoff, beam, state_best, new_states, counters);
+}
+inline void cuda_viterbi_expand_nonemitting(int Gr, int Bl, const int32_cuda *offsets, const int32_cuda *eps_offsets, const int32_cuda *arc_dest, const float *arc_cost, float beam, int32_cuda num_states, unsigned long long *state_best, int32_cuda *new_states, int32_cuda *counters) {
+  cudaF_viterbi_expand_nonemitting(Gr, Bl, offsets, eps_offsets, arc_dest, arc_cost, beam, num_states, state_best, new_states, counters);
+}
+inline void cuda_viterbi_set_backpointers(int Gr, int Bl, const int32_cuda *arc_src, const int32_cuda *arc_col, const int32_cuda *new_states, int32_cuda num_new, int32_cuda tok_begin, const int32_cuda *prev_token_map, const int32_cuda *cur_token_map, unsigned long long *state_best, float *tok_cost, int32_cuda *tok_arc, int32_cuda *tok_prev) {
+  cudaF_viterbi_set_backpointers(Gr, Bl, arc_src, arc_col, new_states, num_new, tok_begin, prev_token_map, cur_token_map, state_best, tok_cost, tok_arc, tok_prev);
+}
+inline void cuda_cholesky_packed_batch(int Gr, int Bl, float **data, int32_cuda dim, int32_cuda num_mats, int32_cuda *failed) {
+  cudaF_cholesky_packed_batch(Gr, Bl, data, dim, num_mats, failed);
+}
+inline void cuda_invert_pos_def_packed_batch(int Gr, int Bl, float **data, int32_cuda dim, int32_cuda num_mats, int32_cuda *failed) {
+  cudaF_invert_pos_def_packed_batch(Gr, Bl, data, dim, num_mats, failed);
+}
+inline void cuda_solve_cholesky_packed_batch(int Gr, int Bl, float **chol, float **vec, int32_cuda dim, int32_cuda num_mats) {
+  cudaF_solve_cholesky_packed_batch(Gr, Bl, chol, vec, dim, num_mats);
+}
+
 inline void cuda_randomize(dim3 Gr, dim3 Bl, float *y, const float *x, const int32_cuda *copy_from, MatrixDim d_out, MatrixDim d_in) { cudaF_randomize(Gr,Bl,y,x,copy_from,d_out,d_in); }
 
 inline void cuda_splice(dim3 Gr, dim3 Bl, float *y, const float *x, const int32_cuda *off, MatrixDim d_out, MatrixDim d_in) { cudaF_splice(Gr,Bl,y,x,off,d_out,d_in); }
 inline void cuda_one(int Gr,int Bl,float* x,int dim) { cudaF_one(Gr,Bl,x,dim); }
 inline void cuda_copy(dim3 Gr, dim3 Bl, float *y, const float *x, const int32_cuda *copy_from, MatrixDim d_out, MatrixDim d_in) { cudaF_copy(Gr,Bl,y,x,copy_from,d_out,d_in); }
+inline void cuda_max_pool(dim3 Gr, dim3 Bl, float *y, MatrixDim d_out, const float *x, int x_stride, const int32_cuda *pool_blocks, int pool_size, int block_dim) { cudaF_max_pool(Gr,Bl,y,d_out,x,x_stride,pool_blocks,pool_size,block_dim); }
+inline void cuda_average_pool(dim3 Gr, dim3 Bl, float *y, MatrixDim d_out, const float *x, int x_stride, const int32_cuda *pool_blocks, int pool_size, int block_dim) { cudaF_average_pool(Gr,Bl,y,d_out,x,x_stride,pool_blocks,pool_size,block_dim); }
+inline void cuda_max_pool_backward(dim3 Gr, dim3 Bl, float *in_diff, MatrixDim d, const float *in, int in_stride, const float *out, int out_stride, const float *out_diff, int out_diff_stride, const int32_cuda *out_blocks, const Int32Pair *in_ranges, const float *scale, int block_dim) { cudaF_max_pool_backward(Gr,Bl,in_diff,d,in,in_stride,out,out_stride,out_diff,out_diff_stride,out_blocks,in_ranges,scale,block_dim); }
+inline void cuda_average_pool_backward(dim3 Gr, dim3 Bl, float *in_diff, MatrixDim d, const float *out_diff, int out_diff_stride, const int32_cuda *out_blocks, const Int32Pair *in_ranges, const float *scale, int block_dim) { cudaF_average_pool_backward(Gr,Bl,in_diff,d,out_diff,out_diff_stride,out_blocks,in_ranges,scale,block_dim); }
 inline void cuda_copy_from_sp(dim3 Gr, dim3 Bl, const float* x, float* y, MatrixDim d_out) { cudaF_copy_from_sp(Gr,Bl,x,y,d_out); }
 inline void cuda_take_lower(dim3 Gr, dim3 Bl, const float* x, float* y, MatrixDim d_in) { cudaF_take_lower(Gr,Bl,x,y,d_in); }
 inline void cuda_take_upper(dim3 Gr, dim3 Bl, const float* x, float* y, MatrixDim d_in) { cudaF_take_upper(Gr,Bl,x,y,d_in); }
@@ -221,6 +272,14 @@ inline void cuda_sum_column_ranges(dim3 Gr, dim3 Bl, float *data, MatrixDim dim,
                                    const Int32Pair *indices) {
   cudaF_sum_column_ranges(Gr, Bl, data, dim, src_data, src_dim, indices);
 }
+inline void cuda_log_sum_exp_column_ranges(dim3 Gr, dim3 Bl, float *data,
+                                           MatrixDim dim,
+                                           const float *src_data,
+                                           MatrixDim src_dim,
+                                           const Int32Pair *indices) {
+  cudaF_log_sum_exp_column_ranges(Gr, Bl, data, dim, src_data, src_dim,
+                                  indices);
+}
 inline void cuda_matrix_lookup(dim3 Gr, dim3 Bl, const float *data,
                                MatrixDim dim, const Int32Pair *indices,
                                int indices_size, float *output) {
@@ -257,6 +316,7 @@ inline void cuda_apply_pow(dim3 Gr, dim3 Bl, double* mat, double power, MatrixDi
 inline void cuda_apply_heaviside(dim3 Gr, dim3 Bl, double* mat, MatrixDim dim) { cudaD_apply_heaviside(Gr,Bl,mat,dim); }
 inline void cuda_apply_floor(dim3 Gr, dim3 Bl, double* mat, double floor_val, MatrixDim dim) { cudaD_apply_floor(Gr,Bl,mat,floor_val,dim); }
 inline void cuda_apply_ceiling(dim3 Gr, dim3 Bl, double* mat, double ceiling_val, MatrixDim dim) { cudaD_apply_ceiling(Gr,Bl,mat,ceiling_val,dim); }
+inline void cuda_uncompress_matrix(dim3 Gr, dim3 Bl, double* mat, MatrixDim d, const unsigned short* col_headers, const unsigned char* byte_data, float min_value, float range) { cudaD_uncompress_matrix(Gr,Bl,mat,d,col_headers,byte_data,min_value,range); }
 inline void cuda_copy_cols(dim3 Gr, dim3 Bl, double* dst, const double* src, const MatrixIndexT_cuda* reorder, MatrixDim dst_dim, int src_stride) {
   cudaD_copy_cols(Gr, Bl, dst, src, reorder, dst_dim, src_stride);
 }
@@ -284,6 +344,9 @@ inline void cuda_mul_cols_vec(dim3 Gr, dim3 Bl, double *mat, const double *scale
 inline void cuda_mul_rows_vec(dim3 Gr, dim3 Bl, double *mat, const double *scale, MatrixDim d) { cudaD_mul_rows_vec(Gr,Bl,mat,scale,d); }
 inline void cuda_mul_rows_group_mat(dim3 Gr, dim3 Bl, double *y, const double *x, MatrixDim d, int src_stride, int group_size) { cudaD_mul_rows_group_mat(Gr, Bl, y, x, d, src_stride, group_size); }
 inline void cuda_calc_pnorm_deriv(dim3 Gr, dim3 Bl, double *y, const double *x1, const double *x2,  MatrixDim d, int src_stride, int group_size, double power) {cudaD_calc_pnorm_deriv(Gr, Bl, y, x1, x2, d, src_stride, group_size, power); }
+inline void cuda_diff_group_pnorm(dim3 Gr, dim3 Bl, double *id, const double *iv, const double *ov, const double *od, MatrixDim d, int iv_stride, int ov_stride, int od_stride, int group_size, double power) { cudaD_diff_group_pnorm(Gr, Bl, id, iv, ov, od, d, iv_stride, ov_stride, od_stride, group_size, power); }
+inline void cuda_group_max(dim3 Gr, dim3 Bl, double *y, const double *x, MatrixDim d, int src_stride, int group_size) { cudaD_group_max(Gr, Bl, y, x, d, src_stride, group_size); }
+inline void cuda_diff_group_max(dim3 Gr, dim3 Bl, double *id, const double *iv, const double *ov, const double *od, MatrixDim d, int iv_stride, int ov_stride, int od_stride, int group_size) { cudaD_diff_group_max(Gr, Bl, id, iv, ov, od, d, iv_stride, ov_stride, od_stride, group_size); }
 inline void cuda_add_mat(dim3 Gr, dim3 Bl, double alpha, const double *src, double *dst, MatrixDim d, int src_stride, int A_trans) { cudaD_add_mat(Gr,Bl,alpha,src,dst,d,src_stride, A_trans); }
 inline void cuda_add_mat_mat_div_mat(dim3 Gr, dim3 Bl, const double *A, const double *B, const double *C, double *dst, MatrixDim d) { cudaD_add_mat_mat_div_mat(Gr,Bl,A,B,C,dst,d); }
 inline void cuda_add_vec_to_cols(dim3 Gr, dim3 Bl, double alpha, const double *col, double beta, double *dst, MatrixDim d) { cudaD_add_vec_to_cols(Gr,Bl,alpha,col,beta,dst,d); }
@@ -346,6 +409,15 @@ inline void cuda_block_add_mat_mat(dim3 Gr, dim3 Bl, CuBlockMatrixData *B_cu_dat
                           C_row_stride, C_col_stride, D_data, D_row_stride,
                           D_col_stride, alpha, beta);
 }
+inline void cuda_add_mat_mat_batched(dim3 Gr, dim3 Bl, double alpha,
+                                     double * const *A, int A_row_stride, int A_col_stride,
+                                     double * const *B, int B_row_stride, int B_col_stride,
+                                     double beta, double * const *C, int C_stride,
+                                     int num_rows, int num_cols, int inner_dim) {
+  cudaD_add_mat_mat_batched(Gr, Bl, alpha, A, A_row_stride, A_col_stride,
+                            B, B_row_stride, B_col_stride, beta, C, C_stride,
+                            num_rows, num_cols, inner_dim);
+}
 
 /*
  * cu::
@@ -355,6 +427,8 @@ inline void cuda_group_pnorm(dim3 Gr, dim3 Bl, double *y, const double *x, Matri
 inline void cuda_sigmoid(dim3 Gr, dim3 Bl, double *y, const double *x, MatrixDim d, int src_stride) { cudaD_sigmoid(Gr,Bl,y,x,d,src_stride); }
 inline void cuda_diff_sigmoid(dim3 Gr, dim3 Bl, double *eout, const double *e, const double *y, MatrixDim d, int src_stride) { cudaD_diff_sigmoid(Gr,Bl,eout,e,y,d,src_stride); }
 inline void cuda_tanh(dim3 Gr, dim3 Bl, double *y, const double *x, MatrixDim d, int src_stride) { cudaD_tanh(Gr,Bl,y,x,d,src_stride); }
+inline void cuda_sigmoid_with_bias(dim3 Gr, dim3 Bl, double *y, const double *x, const double *bias, MatrixDim d, int src_stride) { cudaD_sigmoid_with_bias(Gr,Bl,y,x,bias,d,src_stride); }
+inline void cuda_tanh_with_bias(dim3 Gr, dim3 Bl, double *y, const double *x, const double *bias, MatrixDim d, int src_stride) { cudaD_tanh_with_bias(Gr,Bl,y,x,bias,d,src_stride); }
 inline void cuda_diff_tanh(dim3 Gr, dim3 Bl, double *eout, const double *e, const double *y, MatrixDim d) { cudaD_diff_tanh(Gr,Bl,eout,e,y,d); }
 inline void cuda_softmax(size_t Gr, size_t Bl, double *y, const double *x, MatrixDim d) { cudaD_softmax(Gr,Bl,y,x,d); }
 inline void cuda_softmax_reduce(size_t Gr, size_t Bl, double *y, const double *x, MatrixDim d, int src_stride) { cudaD_softmax_reduce(Gr,Bl,y,x,d,src_stride); }
@@ -365,14 +439,52 @@ inline void cuda_find_row_max_id(dim3 Gr, dim3 Bl, const double *mat, double *ve
 inline void cuda_diff_xent(dim3 Gr, dim3 Bl, const int32_cuda *vec_tgt, double *mat_net_out, double *vec_log_post, MatrixDim d) {
   cudaD_diff_xent(Gr,Bl,vec_tgt,mat_net_out,vec_log_post,d);
 }
+inline void cuda_diff_xent_sparse(dim3 Gr, dim3 Bl, const MatrixElement<double> *tgt, int num_tgt, double *mat_net_out, double *vec_log_post, MatrixDim d) {
+  cudaD_diff_xent_sparse(Gr,Bl,tgt,num_tgt,mat_net_out,vec_log_post,d);
+}
 inline void cuda_copy_rows_from_vec(dim3 Gr, dim3 Bl, double *mat_out, MatrixDim d_out, const double *v_in) {
   cudaD_copy_rows_from_vec(Gr, Bl, mat_out, d_out, v_in);
 }
 
+inline void cuda_levelled_graph_forward(int Gr, int Bl, const int32_cuda *in_offsets, const int32_cuda *in_arcs, const int32_cuda *arc_src, const double *arc_like, const double *arc_acc, int32_cuda state_begin, int32_cuda state_end, double *alpha, double *alpha_acc) {
+  cudaD_levelled_graph_forward(Gr, Bl, in_offsets, in_arcs, arc_src, arc_like, arc_acc, state_begin, state_end, alpha, alpha_acc);
+}
+inline void cuda_levelled_graph_backward(int Gr, int Bl, const int32_cuda *out_offsets, const int32_cuda *out_arcs, const int32_cuda *arc_dest, const double *arc_like, const double *arc_acc, const double *final_like, int32_cuda state_begin, int32_cuda state_end, double *beta, double *beta_acc) {
+  cudaD_levelled_graph_backward(Gr, Bl, out_offsets, out_arcs, arc_dest, arc_like, arc_acc, final_like, state_begin, state_end, beta, beta_acc);
+}
+inline void cuda_levelled_graph_arc_post(int Gr, int Bl, const int32_cuda *arc_src, const int32_cuda *arc_dest, const double *arc_like, const double *arc_acc, const double *alpha, const double *beta, const double *alpha_acc, const double *beta_acc, double tot_like, double tot_acc, int32_cuda num_arcs, double *arc_post) {
+  cudaD_levelled_graph_arc_post(Gr, Bl, arc_src, arc_dest, arc_like, arc_acc, alpha, beta, alpha_acc, beta_acc, tot_like, tot_acc, num_arcs, arc_post);
+}
+inline void cuda_matrix_add_arc_post(int Gr, int Bl, double *data, MatrixDim dim, double alpha, const Int32Pair *elements, const int32_cuda *element_offsets, const int32_cuda *element_arcs, int32_cuda num_elements, const double *arc_post) {
+  cudaD_matrix_add_arc_post(Gr, Bl, data, dim, alpha, elements, element_offsets, element_arcs, num_elements, arc_post);
+}
+inline void cuda_viterbi_expand_emitting(int Gr, int Bl, const int32_cuda *offsets, const int32_cuda *eps_offsets, const int32_cuda *arc_dest, const int32_cuda *arc_col, const double *arc_cost, const double *loglikes, const int32_cuda *tok_state, const double *tok_cost, int32_cuda tok_begin, int32_cuda tok_end, double cutoff, double beam, unsigned long long *state_best, int32_cuda *new_states, int32_cuda *counters) {
+  cudaD_viterbi_expand_emitting(Gr, Bl, offsets, eps_offsets, arc_dest, arc_col, arc_cost, loglikes, tok_state, tok_cost, tok_begin, tok_end, cutoff, beam, state_best, new_states, counters);
+}
+inline void cuda_viterbi_expand_nonemitting(int Gr, int Bl, const int32_cuda *offsets, const int32_cuda *eps_offsets, const int32_cuda *arc_dest, const double *arc_cost, double beam, int32_cuda num_states, unsigned long long *state_best, int32_cuda *new_states, int32_cuda *counters) {
+  cudaD_viterbi_expand_nonemitting(Gr, Bl, offsets, eps_offsets, arc_dest, arc_cost, beam, num_states, state_best, new_states, counters);
+}
+inline void cuda_viterbi_set_backpointers(int Gr, int Bl, const int32_cuda *arc_src, const int32_cuda *arc_col, const int32_cuda *new_states, int32_cuda num_new, int32_cuda tok_begin, const int32_cuda *prev_token_map, const int32_cuda *cur_token_map, unsigned long long *state_best, double *tok_cost, int32_cuda *tok_arc, int32_cuda *tok_prev) {
+  cudaD_viterbi_set_backpointers(Gr, Bl, arc_src, arc_col, new_states, num_new, tok_begin, prev_token_map, cur_token_map, state_best, tok_cost, tok_arc, tok_prev);
+}
+inline void cuda_cholesky_packed_batch(int Gr, int Bl, double **data, int32_cuda dim, int32_cuda num_mats, int32_cuda *failed) {
+  cudaD_cholesky_packed_batch(Gr, Bl, data, dim, num_mats, failed);
+}
+inline void cuda_invert_pos_def_packed_batch(int Gr, int Bl, double **data, int32_cuda dim, int32_cuda num_mats, int32_cuda *failed) {
+  cudaD_invert_pos_def_packed_batch(Gr, Bl, data, dim, num_mats, failed);
+}
+inline void cuda_solve_cholesky_packed_batch(int Gr, int Bl, double **chol, double **vec, int32_cuda dim, int32_cuda num_mats) {
+  cudaD_solve_cholesky_packed_batch(Gr, Bl, chol, vec, dim, num_mats);
+}
+
 inline void cuda_randomize(dim3 Gr, dim3 Bl, double *y, const double *x, const int32_cuda *copy_from, MatrixDim d_out, MatrixDim d_in) { cudaD_randomize(Gr,Bl,y,x,copy_from,d_out,d_in); }
 inline void cuda_splice(dim3 Gr, dim3 Bl, double *y, const double *x, const int32_cuda *off, MatrixDim d_out, MatrixDim d_in) { cudaD_splice(Gr,Bl,y,x,off,d_out,d_in); }
 inline void cuda_one(int Gr,int Bl,double* x,int dim) { cudaD_one(Gr,Bl,x,dim); }
 inline void cuda_copy(dim3 Gr, dim3 Bl, double *y, const double *x, const int32_cuda *copy_from, MatrixDim d_out, MatrixDim d_in) { cudaD_copy(Gr,Bl,y,x,copy_from,d_out,d_in); }
+inline void cuda_max_pool(dim3 Gr, dim3 Bl, double *y, MatrixDim d_out, const double *x, int x_stride, const int32_cuda *pool_blocks, int pool_size, int block_dim) { cudaD_max_pool(Gr,Bl,y,d_out,x,x_stride,pool_blocks,pool_size,block_dim); }
+inline void cuda_average_pool(dim3 Gr, dim3 Bl, double *y, MatrixDim d_out, const double *x, int x_stride, const int32_cuda *pool_blocks, int pool_size, int block_dim) { cudaD_average_pool(Gr,Bl,y,d_out,x,x_stride,pool_blocks,pool_size,block_dim); }
+inline void cuda_max_pool_backward(dim3 Gr, dim3 Bl, double *in_diff, MatrixDim d, const double *in, int in_stride, const double *out, int out_stride, const double *out_diff, int out_diff_stride, const int32_cuda *out_blocks, const Int32Pair *in_ranges, const double *scale, int block_dim) { cudaD_max_pool_backward(Gr,Bl,in_diff,d,in,in_stride,out,out_stride,out_diff,out_diff_stride,out_blocks,in_ranges,scale,block_dim); }
+inline void cuda_average_pool_backward(dim3 Gr, dim3 Bl, double *in_diff, MatrixDim d, const double *out_diff, int out_diff_stride, const int32_cuda *out_blocks, const Int32Pair *in_ranges, const double *scale, int block_dim) { cudaD_average_pool_backward(Gr,Bl,in_diff,d,out_diff,out_diff_stride,out_blocks,in_ranges,scale,block_dim); }
 inline void cuda_copy_from_sp(dim3 Gr, dim3 Bl, const double* x, double* y, MatrixDim d_out) { cudaD_copy_from_sp(Gr,Bl,x,y,d_out); }
 inline void cuda_take_lower(dim3 Gr, dim3 Bl, const double* x, double* y, MatrixDim d_in) { cudaD_take_lower(Gr,Bl,x,y,d_in); }
 inline void cuda_take_upper(dim3 Gr, dim3 Bl, const double* x, double* y, MatrixDim d_in) { cudaD_take_upper(Gr,Bl,x,y,d_in); }
@@ -383,6 +495,14 @@ inline void cuda_sum_column_ranges(dim3 Gr, dim3 Bl, double *data, MatrixDim dim
                                    const double *src_data, MatrixDim src_dim, const Int32Pair *indices) {
   cudaD_sum_column_ranges(Gr, Bl, data, dim, src_data, src_dim, indices);
 }
+inline void cuda_log_sum_exp_column_ranges(dim3 Gr, dim3 Bl, double *data,
+                                           MatrixDim dim,
+                                           const double *src_data,
+                                           MatrixDim src_dim,
+                                           const Int32Pair *indices) {
+  cudaD_log_sum_exp_column_ranges(Gr, Bl, data, dim, src_data, src_dim,
+                                  indices);
+}
 inline void cuda_matrix_lookup(dim3 Gr, dim3 Bl, const double *data,
                                MatrixDim dim, const Int32Pair *indices,
                                int indices_size, double *output) {
@@ -0,0 +1,189 @@
+// cudamatrix/cu-levelled-graph-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "cudamatrix/cu-levelled-graph.h"
+#include "cudamatrix/cu-device.h"
+
+namespace kaldi {
+
+// Makes a random acyclic graph with states numbered topologically; every state
+// but the start state has at least one arc entering it.
+template<typename Real>
+static void GetRandomGraph(int32 *num_states,
+                           std::vector<typename CuLevelledGraph<Real>::Arc> *arcs,
+                           std::vector<Real> *final_like,
+                           int32 num_rows, int32 num_cols) {
+  *num_states = 1 + rand() % 30;
+  arcs->clear();
+  final_like->resize(*num_states);
+  for (int32 s = 0; s < *num_states; s++)
+    (*final_like)[s] = (rand() % 3 == 0 || s + 1 == *num_states ?
+                        RandGauss() : -std::numeric_limits<Real>::infinity());
+  for (int32 dest = 1; dest < *num_states; dest++) {
+    int32 num_in = 1 + rand() % 3;
+    for (int32 i = 0; i < num_in; i++) {
+      typename CuLevelledGraph<Real>::Arc arc;
+      arc.src = rand() % dest;
+      arc.dest = dest;
+      arc.like = RandGauss();
+      if (rand() % 4 != 0) {
+        arc.row = rand() % num_rows;
+        arc.col = rand() % num_cols;
+      } else {
+        arc.row = -1;
+        arc.col = -1;
+      }
+      arcs->push_back(arc);
+    }
+  }
+}
+
+// Simple forward-backward on the graph as given; if arc_acc is non-NULL it
+// does the MPE-type computation as in CuLevelledGraph::ForwardBackwardAcc().
+// Returns the total log-likelihood.
+template<typename Real>
+static double ReferenceForwardBackward(
+    int32 num_states,
+    const std::vector<typename CuLevelledGraph<Real>::Arc> &arcs,
+    const std::vector<Real> &final_like,
+    const Vector<double> *arc_acc,
+    Vector<double> *arc_post,
+    double *tot_acc) {
+  int32 num_arcs = arcs.size();
+  double inf = std::numeric_limits<double>::infinity();
+  Vector<double> alpha(num_states), beta(num_states),
+      alpha_acc(num_states), beta_acc(num_states);
+  alpha.Set(-inf);
+  alpha(0) = 0.0;
+  // The arcs are in order of destination state.
+  for (int32 a = 0; a < num_arcs; a++)
+    alpha(arcs[a].dest) = LogAdd(alpha(arcs[a].dest),
+                                 alpha(arcs[a].src) + arcs[a].like);
+  for (int32 s = 0; s < num_states; s++)
+    beta(s) = final_like[s];
+  for (int32 a = num_arcs - 1; a >= 0; a--)
+    beta(arcs[a].src) = LogAdd(beta(arcs[a].src),
+                               beta(arcs[a].dest) + arcs[a].like);
+  if (arc_acc != NULL) {
+    for (int32 a = 0; a < num_arcs; a++) {
+      int32 src = arcs[a].src, dest = arcs[a].dest;
+      if (alpha(src) != -inf)
+        alpha_acc(dest) += Exp(alpha(src) + arcs[a].like - alpha(dest)) *
+            (alpha_acc(src) + (*arc_acc)(a));
+    }
+    for (int32 a = num_arcs - 1; a >= 0; a--) {
+      int32 src = arcs[a].src, dest = arcs[a].dest;
+      if (beta(dest) != -inf)
+        beta_acc(src) += Exp(beta(dest) + arcs[a].like - beta(src)) *
+            (beta_acc(dest) + (*arc_acc)(a));
+    }
+    *tot_acc = beta_acc(0);
+  }
+  double tot_like = beta(0);
+  arc_post->Resize(num_arcs);
+  for (int32 a = 0; a < num_arcs; a++) {
+    int32 src = arcs[a].src, dest = arcs[a].dest;
+    (*arc_post)(a) = Exp(alpha(src) + arcs[a].like + beta(dest) - tot_like);
+    if (arc_acc != NULL)
+      (*arc_post)(a) *= alpha_acc(src) + (*arc_acc)(a) + beta_acc(dest) -
+          *tot_acc;
+  }
+  return tot_like;
+}
+
+template<typename Real>
+static void UnitTestCuLevelledGraph() {
+  for (int32 i = 0; i < 20; i++) {
+    int32 num_states, num_rows = 1 + rand() % 5, num_cols = 1 + rand() % 5;
+    std::vector<typename CuLevelledGraph<Real>::Arc> arcs;
+    std::vector<Real> final_like;
+    GetRandomGraph(&num_states, &arcs, &final_like, num_rows, num_cols);
+    int32 num_arcs = arcs.size();
+    CuLevelledGraph<Real> graph(num_states, arcs, final_like);
+    KALDI_ASSERT(graph.NumStates() == num_states &&
+                 graph.NumArcs() == num_arcs);
+
+    Vector<double> ref_post;
+    double ref_like = ReferenceForwardBackward(num_states, arcs, final_like,
+                                               NULL, &ref_post, NULL);
+    CuVector<Real> arc_post;
+    Real tot_like = graph.ForwardBackward(&arc_post);
+    KALDI_ASSERT(ApproxEqual(tot_like, ref_like));
+    Vector<double> post(arc_post);
+    KALDI_ASSERT(post.ApproxEqual(ref_post, 0.001));
+
+    Vector<double> acc(num_arcs);
+    acc.SetRandn();
+    double ref_acc;
+    ReferenceForwardBackward(num_states, arcs, final_like, &acc, &ref_post,
+                             &ref_acc);
+    CuVector<Real> cu_acc(acc);
+    Real tot_acc = graph.ForwardBackwardAcc(cu_acc, &arc_post, &tot_like);
+    KALDI_ASSERT(ApproxEqual(tot_like, ref_like));
+    KALDI_ASSERT(fabs(tot_acc - ref_acc) < 0.001 * (1.0 + fabs(ref_acc)));
+    post.CopyFromVec(arc_post);
+    KALDI_ASSERT(post.ApproxEqual(ref_post, 0.001) ||
+                 ref_post.Norm(2.0) < 1.0e-05);
+
+    Matrix<Real> mat(num_rows, num_cols);
+    mat.SetRandn();
+    CuMatrix<Real> cu_mat(mat);
+    Real alpha = 0.5;
+    graph.AddArcPostToMatrix(arc_post, alpha, &cu_mat);
+    for (int32 a = 0; a < num_arcs; a++)
+      if (arcs[a].row >= 0)
+        mat(arcs[a].row, arcs[a].col) += alpha * post(a);
+    Matrix<Real> mat2(cu_mat);
+    KALDI_ASSERT(mat.ApproxEqual(mat2, 0.001));
+  }
+}
+
+}  // namespace kaldi
+
+
+int main() {
+  using namespace kaldi;
+  for (int32 loop = 0; loop < 2; loop++) {
+#if HAVE_CUDA == 1
+    if (loop == 0)
+      CuDevice::Instantiate().SelectGpuId("no");
+    else
+      CuDevice::Instantiate().SelectGpuId("optional");
+#endif
+    UnitTestCuLevelledGraph<float>();
+#if HAVE_CUDA == 1
+    if (CuDevice::Instantiate().DoublePrecisionSupported())
+      UnitTestCuLevelledGraph<double>();
+#else
+    UnitTestCuLevelledGraph<double>();
+#endif
+    if (loop == 0)
+      KALDI_LOG << "Tests without GPU use succeeded.";
+    else
+      KALDI_LOG << "Tests with GPU use (if available) succeeded.";
+#if HAVE_CUDA != 1
+    break;
+#endif
+  }
+  return 0;
+}
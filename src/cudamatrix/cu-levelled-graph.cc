@@ -0,0 +1,332 @@
+// cudamatrix/cu-levelled-graph.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#if HAVE_CUDA == 1
+#include <cuda_runtime_api.h>
+#endif
+
+#include <algorithm>
+#include <utility>
+#include "util/timer.h"
+#include "cudamatrix/cu-levelled-graph.h"
+#include "cudamatrix/cu-device.h"
+#include "cudamatrix/cu-kernels.h"
+
+namespace kaldi {
+
+template<typename Real>
+CuLevelledGraph<Real>::CuLevelledGraph(int32 num_states,
+                                       const std::vector<Arc> &arcs,
+                                       const std::vector<Real> &final_like):
+    max_row_(-1), max_col_(-1) {
+  KALDI_ASSERT(num_states > 0 && final_like.size() == num_states);
+  int32 num_arcs = arcs.size();
+  // Work out the level of each state; this relies on the topological order.
+  std::vector<int32> level(num_states, 0);
+  int32 max_level = 0;
+  for (int32 a = 0; a < num_arcs; a++) {
+    int32 src = arcs[a].src, dest = arcs[a].dest;
+    KALDI_ASSERT(src >= 0 && src < dest && dest < num_states &&
+                 "CuLevelledGraph: states are not topologically sorted.");
+  }
+  // We need the arcs in order of source state to propagate the levels.
+  std::vector<std::pair<int32, int32> > src_and_arc(num_arcs);
+  for (int32 a = 0; a < num_arcs; a++)
+    src_and_arc[a] = std::make_pair(arcs[a].src, a);
+  std::sort(src_and_arc.begin(), src_and_arc.end());
+  for (int32 i = 0; i < num_arcs; i++) {
+    const Arc &arc = arcs[src_and_arc[i].second];
+    level[arc.dest] = std::max(level[arc.dest], level[arc.src] + 1);
+    max_level = std::max(max_level, level[arc.dest]);
+  }
+  // Renumber the states in order of level (keeping 0 as the start state).
+  std::vector<int32> level_count(max_level + 1, 0);
+  for (int32 s = 0; s < num_states; s++)
+    level_count[level[s]]++;
+  level_offsets_.resize(max_level + 2);
+  level_offsets_[0] = 0;
+  for (int32 l = 0; l <= max_level; l++)
+    level_offsets_[l + 1] = level_offsets_[l] + level_count[l];
+  std::vector<int32> new_state(num_states), next_index(level_offsets_);
+  for (int32 s = 0; s < num_states; s++)
+    new_state[s] = next_index[level[s]]++;
+  KALDI_ASSERT(new_state[0] == 0);
+
+  std::vector<int32> arc_src(num_arcs), arc_dest(num_arcs);
+  Vector<Real> arc_like(num_arcs), new_final_like(num_states);
+  std::vector<int32> in_offsets(num_states + 1, 0),
+      out_offsets(num_states + 1, 0);
+  for (int32 a = 0; a < num_arcs; a++) {
+    arc_src[a] = new_state[arcs[a].src];
+    arc_dest[a] = new_state[arcs[a].dest];
+    arc_like(a) = arcs[a].like;
+    in_offsets[arc_dest[a] + 1]++;
+    out_offsets[arc_src[a] + 1]++;
+  }
+  for (int32 s = 0; s < num_states; s++) {
+    new_final_like(new_state[s]) = final_like[s];
+    in_offsets[s + 1] += in_offsets[s];
+    out_offsets[s + 1] += out_offsets[s];
+  }
+  std::vector<int32> in_arcs(num_arcs), out_arcs(num_arcs),
+      in_next(in_offsets), out_next(out_offsets);
+  for (int32 a = 0; a < num_arcs; a++) {
+    in_arcs[in_next[arc_dest[a]]++] = a;
+    out_arcs[out_next[arc_src[a]]++] = a;
+  }
+
+  // Group the arcs by the matrix element they contribute to.
+  std::vector<std::pair<std::pair<int32, int32>, int32> > element_and_arc;
+  for (int32 a = 0; a < num_arcs; a++) {
+    if (arcs[a].row >= 0) {
+      KALDI_ASSERT(arcs[a].col >= 0);
+      element_and_arc.push_back(
+          std::make_pair(std::make_pair(arcs[a].row, arcs[a].col), a));
+      max_row_ = std::max(max_row_, arcs[a].row);
+      max_col_ = std::max(max_col_, arcs[a].col);
+    }
+  }
+  std::sort(element_and_arc.begin(), element_and_arc.end());
+  std::vector<Int32Pair> elements;
+  std::vector<int32> element_offsets, element_arcs(element_and_arc.size());
+  for (size_t i = 0; i < element_and_arc.size(); i++) {
+    if (i == 0 || element_and_arc[i].first != element_and_arc[i-1].first) {
+      Int32Pair element;
+      element.first = element_and_arc[i].first.first;
+      element.second = element_and_arc[i].first.second;
+      elements.push_back(element);
+      element_offsets.push_back(i);
+    }
+    element_arcs[i] = element_and_arc[i].second;
+  }
+  element_offsets.push_back(element_and_arc.size());
+
+  arc_src_.CopyFromVec(arc_src);
+  arc_dest_.CopyFromVec(arc_dest);
+  arc_like_ = arc_like;
+  final_like_ = new_final_like;
+  in_offsets_.CopyFromVec(in_offsets);
+  in_arcs_.CopyFromVec(in_arcs);
+  out_offsets_.CopyFromVec(out_offsets);
+  out_arcs_.CopyFromVec(out_arcs);
+  elements_.CopyFromVec(elements);
+  element_offsets_.CopyFromVec(element_offsets);
+  element_arcs_.CopyFromVec(element_arcs);
+}
+
+
+// The following functions are the CPU versions of the kernels
+// _levelled_graph_forward, _levelled_graph_backward and
+// _levelled_graph_arc_post in cu-kernels.cu, for a single state or arc.
+template<typename Real>
+static void LevelledGraphForwardCpu(const int32 *in_offsets,
+                                    const int32 *in_arcs,
+                                    const int32 *arc_src,
+                                    const Real *arc_like, const Real *arc_acc,
+                                    int32 s, Real *alpha, Real *alpha_acc) {
+  int32 begin = in_offsets[s], end = in_offsets[s+1];
+  Real this_alpha = (s == 0 ? 0.0 : -std::numeric_limits<Real>::infinity());
+  for (int32 i = begin; i < end; i++) {
+    int32 a = in_arcs[i];
+    this_alpha = LogAdd(this_alpha, alpha[arc_src[a]] + arc_like[a]);
+  }
+  alpha[s] = this_alpha;
+  if (alpha_acc != NULL) {
+    Real this_acc = 0.0;
+    for (int32 i = begin; i < end; i++) {
+      int32 a = in_arcs[i], src = arc_src[a];
+      Real scale = Exp(alpha[src] + arc_like[a] - this_alpha);
+      if (!KALDI_ISNAN(scale))  // we'd get NaN if unreachable.
+        this_acc += scale * (alpha_acc[src] + arc_acc[a]);
+    }
+    alpha_acc[s] = this_acc;
+  }
+}
+
+template<typename Real>
+static void LevelledGraphBackwardCpu(const int32 *out_offsets,
+                                     const int32 *out_arcs,
+                                     const int32 *arc_dest,
+                                     const Real *arc_like, const Real *arc_acc,
+                                     const Real *final_like,
+                                     int32 s, Real *beta, Real *beta_acc) {
+  int32 begin = out_offsets[s], end = out_offsets[s+1];
+  Real this_beta = final_like[s];
+  for (int32 i = begin; i < end; i++) {
+    int32 a = out_arcs[i];
+    this_beta = LogAdd(this_beta, beta[arc_dest[a]] + arc_like[a]);
+  }
+  beta[s] = this_beta;
+  if (beta_acc != NULL) {
+    Real this_acc = 0.0;
+    for (int32 i = begin; i < end; i++) {
+      int32 a = out_arcs[i], dest = arc_dest[a];
+      Real scale = Exp(beta[dest] + arc_like[a] - this_beta);
+      if (!KALDI_ISNAN(scale))  // we'd get NaN for dead ends.
+        this_acc += scale * (beta_acc[dest] + arc_acc[a]);
+    }
+    beta_acc[s] = this_acc;
+  }
+}
+
+
+template<typename Real>
+Real CuLevelledGraph<Real>::ForwardBackwardInternal(
+    const CuVectorBase<Real> *arc_acc,
+    CuVector<Real> *arc_post,
+    Real *tot_acc) const {
+  int32 num_states = NumStates(), num_arcs = NumArcs();
+  KALDI_ASSERT(arc_acc == NULL || arc_acc->Dim() == num_arcs);
+  CuVector<Real> alpha(num_states, kUndefined), beta(num_states, kUndefined),
+      alpha_acc, beta_acc;
+  if (arc_acc != NULL) {
+    alpha_acc.Resize(num_states, kUndefined);
+    beta_acc.Resize(num_states, kUndefined);
+  }
+  const Real *arc_acc_data = (arc_acc != NULL ? arc_acc->Data() : NULL);
+  Real *alpha_acc_data = (arc_acc != NULL ? alpha_acc.Data() : NULL),
+      *beta_acc_data = (arc_acc != NULL ? beta_acc.Data() : NULL);
+  arc_post->Resize(num_arcs, kUndefined);
+  Real tot_like;
+
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    int32 num_levels = NumLevels();
+    for (int32 l = 0; l < num_levels; l++) {
+      int32 begin = level_offsets_[l], end = level_offsets_[l+1];
+      cuda_levelled_graph_forward(n_blocks(end - begin, CU1DBLOCK), CU1DBLOCK,
+                                  in_offsets_.Data(), in_arcs_.Data(),
+                                  arc_src_.Data(), arc_like_.Data(),
+                                  arc_acc_data, begin, end, alpha.Data(),
+                                  alpha_acc_data);
+    }
+    for (int32 l = num_levels - 1; l >= 0; l--) {
+      int32 begin = level_offsets_[l], end = level_offsets_[l+1];
+      cuda_levelled_graph_backward(n_blocks(end - begin, CU1DBLOCK), CU1DBLOCK,
+                                   out_offsets_.Data(), out_arcs_.Data(),
+                                   arc_dest_.Data(), arc_like_.Data(),
+                                   arc_acc_data, final_like_.Data(), begin, end,
+                                   beta.Data(), beta_acc_data);
+    }
+    CU_SAFE_CALL(cudaGetLastError());
+    tot_like = beta(0);
+    Real this_tot_acc = (arc_acc != NULL ? beta_acc(0) : 0.0);
+    cuda_levelled_graph_arc_post(n_blocks(num_arcs, CU1DBLOCK), CU1DBLOCK,
+                                 arc_src_.Data(), arc_dest_.Data(),
+                                 arc_like_.Data(), arc_acc_data,
+                                 alpha.Data(), beta.Data(), alpha_acc_data,
+                                 beta_acc_data, tot_like, this_tot_acc,
+                                 num_arcs, arc_post->Data());
+    CU_SAFE_CALL(cudaGetLastError());
+    if (tot_acc != NULL) *tot_acc = this_tot_acc;
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    for (int32 s = 0; s < num_states; s++)
+      LevelledGraphForwardCpu(in_offsets_.Data(), in_arcs_.Data(),
+                              arc_src_.Data(), arc_like_.Data(), arc_acc_data,
+                              s, alpha.Data(), alpha_acc_data);
+    for (int32 s = num_states - 1; s >= 0; s--)
+      LevelledGraphBackwardCpu(out_offsets_.Data(), out_arcs_.Data(),
+                               arc_dest_.Data(), arc_like_.Data(), arc_acc_data,
+                               final_like_.Data(), s, beta.Data(),
+                               beta_acc_data);
+    tot_like = beta(0);
+    Real this_tot_acc = (arc_acc != NULL ? beta_acc(0) : 0.0);
+    const int32 *arc_src = arc_src_.Data(), *arc_dest = arc_dest_.Data();
+    const Real *arc_like = arc_like_.Data(), *alpha_data = alpha.Data(),
+        *beta_data = beta.Data();
+    Real *arc_post_data = arc_post->Data();
+    for (int32 a = 0; a < num_arcs; a++) {
+      int32 src = arc_src[a], dest = arc_dest[a];
+      Real post = Exp(alpha_data[src] + arc_like[a] + beta_data[dest] -
+                      tot_like);
+      if (arc_acc != NULL)
+        post *= alpha_acc_data[src] + arc_acc_data[a] + beta_acc_data[dest] -
+            this_tot_acc;
+      arc_post_data[a] = post;
+    }
+    if (tot_acc != NULL) *tot_acc = this_tot_acc;
+  }
+  if (KALDI_ISINF(tot_like) || KALDI_ISNAN(tot_like)) {
+    KALDI_WARN << "Total log-likelihood of graph is " << tot_like
+               << ", setting posteriors to zero.";
+    arc_post->SetZero();
+  }
+  return tot_like;
+}
+
+template<typename Real>
+Real CuLevelledGraph<Real>::ForwardBackward(CuVector<Real> *arc_post) const {
+  return ForwardBackwardInternal(NULL, arc_post, NULL);
+}
+
+template<typename Real>
+Real CuLevelledGraph<Real>::ForwardBackwardAcc(
+    const CuVectorBase<Real> &arc_acc,
+    CuVector<Real> *arc_post,
+    Real *tot_like) const {
+  Real tot_acc;
+  Real this_tot_like = ForwardBackwardInternal(&arc_acc, arc_post, &tot_acc);
+  if (tot_like != NULL) *tot_like = this_tot_like;
+  return tot_acc;
+}
+
+template<typename Real>
+void CuLevelledGraph<Real>::AddArcPostToMatrix(
+    const CuVectorBase<Real> &arc_post,
+    Real alpha,
+    CuMatrixBase<Real> *mat) const {
+  KALDI_ASSERT(arc_post.Dim() == NumArcs() && max_row_ < mat->NumRows() &&
+               max_col_ < mat->NumCols());
+  int32 num_elements = elements_.Dim();
+  if (num_elements == 0) return;
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    cuda_matrix_add_arc_post(n_blocks(num_elements, CU1DBLOCK), CU1DBLOCK,
+                             mat->data_, mat->Dim(), alpha, elements_.Data(),
+                             element_offsets_.Data(), element_arcs_.Data(),
+                             num_elements, arc_post.Data());
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    const Int32Pair *elements = elements_.Data();
+    const int32 *element_offsets = element_offsets_.Data(),
+        *element_arcs = element_arcs_.Data();
+    const Real *arc_post_data = arc_post.Data();
+    MatrixBase<Real> &mat2 = mat->Mat();
+    for (int32 e = 0; e < num_elements; e++) {
+      Real sum = 0.0;
+      for (int32 i = element_offsets[e]; i < element_offsets[e+1]; i++)
+        sum += arc_post_data[element_arcs[i]];
+      mat2(elements[e].first, elements[e].second) += alpha * sum;
+    }
+  }
+}
+
+template class CuLevelledGraph<float>;
+template class CuLevelledGraph<double>;
+
+}  // namespace kaldi
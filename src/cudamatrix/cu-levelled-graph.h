@@ -0,0 +1,131 @@
+// cudamatrix/cu-levelled-graph.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_CUDAMATRIX_CU_LEVELLED_GRAPH_H_
+#define KALDI_CUDAMATRIX_CU_LEVELLED_GRAPH_H_
+
+#include <vector>
+#include "cudamatrix/cu-common.h"
+#include "cudamatrix/cu-array.h"
+#include "cudamatrix/cu-vector.h"
+#include "cudamatrix/cu-matrix.h"
+
+namespace kaldi {
+
+
+/**
+   The class CuLevelledGraph holds an acyclic weighted graph, such as a
+   lattice, in a form that lets us do forward-backward on the GPU; it is used by
+   the functions in ../lat/cu-lattice-functions.h.  It has no knowledge of
+   lattices or transition-ids: each arc just has a log-likelihood and,
+   optionally, the (row, column) of a matrix element (e.g. a (frame, pdf-id)
+   pair) that its posterior should be added to.
+
+   Each state is assigned a "level", which is the length of the longest path
+   to it from the start state, and the states are renumbered in order of level.
+   As every arc goes from a lower to a higher level, all the states of a level
+   can be processed at once, so the forward and backward passes need one
+   kernel launch per level, each with one thread per state.  Each thread sums
+   over the arcs entering (or leaving) its state, so we need no atomic
+   operations; likewise when adding the posteriors to a matrix, there is one
+   thread per matrix element.
+
+   Without a GPU, the same algorithm runs on the CPU.
+ */
+template<typename Real>
+class CuLevelledGraph {
+ public:
+  struct Arc {
+    int32 src;   // source state
+    int32 dest;  // destination state
+    Real like;   // log-likelihood of the arc
+    int32 row;   // the (row, col) of the matrix element that the posterior
+    int32 col;   // of this arc goes to in AddArcPostToMatrix(); -1 if none.
+  };
+
+  /// The states must be numbered 0 ... num_states - 1 so that every arc goes
+  /// from a lower to a higher numbered state (i.e. topologically sorted), with
+  /// 0 as the start state.  "final_like" gives the final log-likelihood of each
+  /// state, which is -infinity for non-final states.  The arcs are numbered as
+  /// they appear in "arcs".
+  CuLevelledGraph(int32 num_states,
+                  const std::vector<Arc> &arcs,
+                  const std::vector<Real> &final_like);
+
+  int32 NumStates() const { return level_offsets_.back(); }
+
+  int32 NumArcs() const { return arc_src_.Dim(); }
+
+  int32 NumLevels() const { return level_offsets_.size() - 1; }
+
+  /// Does forward-backward, and sets "arc_post" to the posterior of each arc.
+  /// Returns the total log-likelihood of the graph.
+  Real ForwardBackward(CuVector<Real> *arc_post) const;
+
+  /// Does the forward-backward of MPE-type training (as in
+  /// LatticeForwardBackwardMpeVariants()), given the "accuracy" of each arc.
+  /// Sets each element of "arc_post" to the posterior of the arc times the
+  /// difference between the average accuracy of the paths through it and the
+  /// overall average accuracy.  Returns the average accuracy; if "tot_like" is
+  /// non-NULL, sets it to the total log-likelihood.
+  Real ForwardBackwardAcc(const CuVectorBase<Real> &arc_acc,
+                          CuVector<Real> *arc_post,
+                          Real *tot_like = NULL) const;
+
+  /// For each arc that had a (row, col) specified, adds alpha times its
+  /// arc_post to (*mat)(row, col).
+  void AddArcPostToMatrix(const CuVectorBase<Real> &arc_post,
+                          Real alpha,
+                          CuMatrixBase<Real> *mat) const;
+
+ private:
+  // Does the work of ForwardBackward() and ForwardBackwardAcc(); arc_acc
+  // and tot_acc are NULL in the former case.
+  Real ForwardBackwardInternal(const CuVectorBase<Real> *arc_acc,
+                               CuVector<Real> *arc_post,
+                               Real *tot_acc) const;
+
+  std::vector<int32> level_offsets_;  // the states of level l are
+                                      // level_offsets_[l] ... level_offsets_[l+1]-1.
+  // The following are on the GPU if we have one; the state indexes are after
+  // renumbering.
+  CuArray<int32> arc_src_;
+  CuArray<int32> arc_dest_;
+  CuVector<Real> arc_like_;
+  CuVector<Real> final_like_;
+  CuArray<int32> in_offsets_;  // the arcs entering state s are
+  CuArray<int32> in_arcs_;     // in_arcs_[in_offsets_[s] ... in_offsets_[s+1]-1].
+  CuArray<int32> out_offsets_; // likewise for the arcs leaving each state.
+  CuArray<int32> out_arcs_;
+  // The matrix elements that arcs contribute to, each as (row, col); the arcs
+  // contributing to element e are
+  // element_arcs_[element_offsets_[e] ... element_offsets_[e+1]-1].
+  CuArray<Int32Pair> elements_;
+  CuArray<int32> element_offsets_;
+  CuArray<int32> element_arcs_;
+  int32 max_row_;  // the largest row and column of any element, for checking.
+  int32 max_col_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CuLevelledGraph);
+};
+
+
+}  // namespace kaldi
+
+#endif  // KALDI_CUDAMATRIX_CU_LEVELLED_GRAPH_H_
@@ -135,6 +135,127 @@ static void UnitTestCuMathSplice() {
   }
 }
 
+template<typename Real>
+static void UnitTestCuMathPool() {
+  int32 num_rows = 1 + rand() % 50, block_dim = 1 + rand() % 10,
+      num_in_blocks = 2 + rand() % 10, pool_size = 1 + rand() % num_in_blocks,
+      num_pools = 1 + rand() % 8;
+  // random (possibly overlapping) pools.
+  std::vector<int32> pool_blocks;
+  std::vector<std::vector<int32> > pools_of_block(num_in_blocks);
+  for (int32 q = 0; q < num_pools; q++) {
+    std::vector<int32> blocks(num_in_blocks);
+    for (int32 p = 0; p < num_in_blocks; p++) blocks[p] = p;
+    std::random_shuffle(blocks.begin(), blocks.end());
+    for (int32 k = 0; k < pool_size; k++) {
+      pool_blocks.push_back(blocks[k]);
+      pools_of_block[blocks[k]].push_back(q);
+    }
+  }
+  std::vector<int32> out_blocks;
+  std::vector<Int32Pair> in_ranges(num_in_blocks);
+  Vector<Real> scale(num_in_blocks);
+  for (int32 p = 0; p < num_in_blocks; p++) {
+    in_ranges[p].first = out_blocks.size();
+    out_blocks.insert(out_blocks.end(), pools_of_block[p].begin(),
+                      pools_of_block[p].end());
+    in_ranges[p].second = out_blocks.size();
+    scale(p) = RandUniform();
+  }
+  CuArray<int32> cu_pool_blocks(pool_blocks), cu_out_blocks(out_blocks);
+  CuArray<Int32Pair> cu_in_ranges(in_ranges);
+  CuVector<Real> cu_scale(scale);
+
+  Matrix<Real> in(num_rows, num_in_blocks * block_dim),
+      out_diff(num_rows, num_pools * block_dim);
+  in.SetRandn();
+  out_diff.SetRandn();
+  // make some ties, which all get the derivative of the max.
+  in(0, 0) = in(0, block_dim * (num_in_blocks - 1));
+  CuMatrix<Real> cu_in(in), cu_out_diff(out_diff),
+      cu_max(num_rows, num_pools * block_dim),
+      cu_avg(num_rows, num_pools * block_dim),
+      cu_max_diff(num_rows, in.NumCols()), cu_avg_diff(num_rows, in.NumCols());
+  cu::MaxPool(cu_in, cu_pool_blocks, block_dim, &cu_max);
+  cu::AveragePool(cu_in, cu_pool_blocks, block_dim, &cu_avg);
+  cu::MaxPoolBackward(cu_in, cu_max, cu_out_diff, cu_out_blocks, cu_in_ranges,
+                      cu_scale, block_dim, &cu_max_diff);
+  cu::AveragePoolBackward(cu_out_diff, cu_out_blocks, cu_in_ranges, cu_scale,
+                          block_dim, &cu_avg_diff);
+
+  Matrix<Real> max(num_rows, num_pools * block_dim),
+      avg(num_rows, num_pools * block_dim), max_diff(num_rows, in.NumCols()),
+      avg_diff(num_rows, in.NumCols());
+  for (int32 r = 0; r < num_rows; r++) {
+    for (int32 q = 0; q < num_pools; q++) {
+      for (int32 b = 0; b < block_dim; b++) {
+        Real m = -1.0e20, sum = 0.0;
+        for (int32 k = 0; k < pool_size; k++) {
+          Real x = in(r, pool_blocks[q * pool_size + k] * block_dim + b);
+          m = std::max(m, x);
+          sum += x;
+        }
+        max(r, q * block_dim + b) = m;
+        avg(r, q * block_dim + b) = sum / pool_size;
+        for (int32 k = 0; k < pool_size; k++) {
+          int32 p = pool_blocks[q * pool_size + k], c = p * block_dim + b;
+          if (in(r, c) == m)
+            max_diff(r, c) += scale(p) * out_diff(r, q * block_dim + b);
+          avg_diff(r, c) += scale(p) * out_diff(r, q * block_dim + b);
+        }
+      }
+    }
+  }
+  Matrix<Real> max2(cu_max), avg2(cu_avg), max_diff2(cu_max_diff),
+      avg_diff2(cu_avg_diff);
+  AssertEqual(max, max2);
+  AssertEqual(avg, avg2);
+  AssertEqual(max_diff, max_diff2);
+  AssertEqual(avg_diff, avg_diff2);
+}
+
+template<typename Real>
+static void UnitTestCuMathRandomizedSvd() {
+  for (int32 i = 0; i < 3; i++) {
+    int32 rows = 20 + rand() % 100, cols = 20 + rand() % 100,
+        k = 1 + rand() % 10;
+    // Make a matrix with quickly decaying singular values, so the randomized
+    // SVD should be close to exact.
+    Matrix<Real> A(rows, cols), B(cols, cols);
+    A.SetRandn();
+    B.SetRandn();
+    for (int32 c = 0; c < cols; c++)
+      B.Row(c).Scale(std::pow(0.7, c));
+    Matrix<Real> M(rows, cols);
+    M.AddMatMat(1.0, A, kNoTrans, B, kNoTrans, 0.0);
+
+    int32 rc_min = std::min(rows, cols);
+    Matrix<Real> M2(M);
+    if (rows < cols) M2.Transpose();
+    Vector<Real> s_full(rc_min);
+    M2.Svd(&s_full);
+    SortSvd(&s_full, static_cast<Matrix<Real>*>(NULL));
+
+    CuMatrix<Real> cu_M(M), cu_U(rows, k), cu_Vt(k, cols);
+    Vector<Real> s(k);
+    cu::RandomizedSvd(cu_M, &s, &cu_U, &cu_Vt);
+    SubVector<Real> s_ref(s_full, 0, k);
+    AssertEqual(s, s_ref, 0.01);
+
+    Matrix<Real> U(cu_U), Vt(cu_Vt), UtU(k, k), VtV(k, k);
+    UtU.AddMatMat(1.0, U, kTrans, U, kNoTrans, 0.0);
+    VtV.AddMatMat(1.0, Vt, kNoTrans, Vt, kTrans, 0.0);
+    KALDI_ASSERT(UtU.IsUnit(0.001) && VtV.IsUnit(0.001));
+    // U diag(s) Vt should be as good an approximation to M as the exact
+    // rank-k SVD.
+    U.MulColsVec(s);
+    M.AddMatMat(-1.0, U, kNoTrans, Vt, kNoTrans, 1.0);
+    Real err = M.FrobeniusNorm(),
+        best_err = s_full.Range(k, rc_min - k).Norm(2.0);
+    KALDI_ASSERT(err <= 1.01 * best_err + 0.001 * s_full(0));
+  }
+}
+
 template<typename Real> void CudaMathUnitTest() {
   #if HAVE_CUDA == 1  
     if (CuDevice::Instantiate().DoublePrecisionSupported())
@@ -142,6 +263,8 @@ template<typename Real> void CudaMathUnitTest() {
   UnitTestCuMathRandomize<Real>();
   UnitTestCuMathSplice<Real>();
   UnitTestCuMathCopy<Real>();
+  UnitTestCuMathPool<Real>();
+  UnitTestCuMathRandomizedSvd<Real>();
 }
 
 
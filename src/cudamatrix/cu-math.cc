@@ -19,8 +19,10 @@
 // limitations under the License.
 
 #include "util/timer.h"
+#include "matrix/matrix-functions.h"
 #include "cudamatrix/cu-common.h"
 #include "cudamatrix/cu-matrix.h"
+#include "cudamatrix/cu-vector.h"
 #include "cudamatrix/cu-device.h"
 #include "cudamatrix/cu-kernels.h"
 
@@ -200,6 +202,281 @@ void Copy(const CuMatrix<Real> &src, const CuArray<int32> &copy_from_indices, Cu
   }
 }
 
+template<typename Real>
+void MaxPool(const CuMatrixBase<Real> &in, const CuArray<int32> &pool_blocks,
+             int32 block_dim, CuMatrixBase<Real> *out) {
+  KALDI_ASSERT(in.NumRows() == out->NumRows() && block_dim > 0 &&
+               out->NumCols() % block_dim == 0 &&
+               in.NumCols() % block_dim == 0);
+  int32 num_pools = out->NumCols() / block_dim;
+  KALDI_ASSERT(num_pools > 0 && pool_blocks.Dim() % num_pools == 0);
+  int32 pool_size = pool_blocks.Dim() / num_pools;
+  if (out->NumRows() == 0) return;
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    dim3 dimGrid(n_blocks(out->NumCols(), CU2DBLOCK),
+                 n_blocks(out->NumRows(), CU2DBLOCK));
+    cuda_max_pool(dimGrid, dimBlock, out->Data(), out->Dim(), in.Data(),
+                  in.Stride(), pool_blocks.Data(), pool_size, block_dim);
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    const MatrixBase<Real> &in_mat = in.Mat();
+    MatrixBase<Real> &out_mat = out->Mat();
+    const int32 *blocks = pool_blocks.Data();
+    // The innermost loops are over the elements of a block, which are
+    // contiguous, so the compiler can vectorize them.
+    for (MatrixIndexT r = 0; r < out_mat.NumRows(); r++) {
+      const Real *in_row = in_mat.RowData(r);
+      Real *out_row = out_mat.RowData(r);
+      for (int32 q = 0; q < num_pools; q++) {
+        const int32 *this_blocks = blocks + q * pool_size;
+        Real *y = out_row + q * block_dim;
+        const Real *x = in_row + this_blocks[0] * block_dim;
+        for (int32 b = 0; b < block_dim; b++)
+          y[b] = x[b];
+        for (int32 k = 1; k < pool_size; k++) {
+          x = in_row + this_blocks[k] * block_dim;
+          for (int32 b = 0; b < block_dim; b++)
+            y[b] = (x[b] > y[b] ? x[b] : y[b]);
+        }
+      }
+    }
+  }
+}
+
+template<typename Real>
+void AveragePool(const CuMatrixBase<Real> &in,
+                 const CuArray<int32> &pool_blocks,
+                 int32 block_dim, CuMatrixBase<Real> *out) {
+  KALDI_ASSERT(in.NumRows() == out->NumRows() && block_dim > 0 &&
+               out->NumCols() % block_dim == 0 &&
+               in.NumCols() % block_dim == 0);
+  int32 num_pools = out->NumCols() / block_dim;
+  KALDI_ASSERT(num_pools > 0 && pool_blocks.Dim() % num_pools == 0);
+  int32 pool_size = pool_blocks.Dim() / num_pools;
+  if (out->NumRows() == 0) return;
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    dim3 dimGrid(n_blocks(out->NumCols(), CU2DBLOCK),
+                 n_blocks(out->NumRows(), CU2DBLOCK));
+    cuda_average_pool(dimGrid, dimBlock, out->Data(), out->Dim(), in.Data(),
+                      in.Stride(), pool_blocks.Data(), pool_size, block_dim);
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    const MatrixBase<Real> &in_mat = in.Mat();
+    MatrixBase<Real> &out_mat = out->Mat();
+    const int32 *blocks = pool_blocks.Data();
+    Real scale = 1.0 / pool_size;
+    for (MatrixIndexT r = 0; r < out_mat.NumRows(); r++) {
+      const Real *in_row = in_mat.RowData(r);
+      Real *out_row = out_mat.RowData(r);
+      for (int32 q = 0; q < num_pools; q++) {
+        const int32 *this_blocks = blocks + q * pool_size;
+        Real *y = out_row + q * block_dim;
+        const Real *x = in_row + this_blocks[0] * block_dim;
+        for (int32 b = 0; b < block_dim; b++)
+          y[b] = x[b];
+        for (int32 k = 1; k < pool_size; k++) {
+          x = in_row + this_blocks[k] * block_dim;
+          for (int32 b = 0; b < block_dim; b++)
+            y[b] += x[b];
+        }
+        for (int32 b = 0; b < block_dim; b++)
+          y[b] *= scale;
+      }
+    }
+  }
+}
+
+template<typename Real>
+void MaxPoolBackward(const CuMatrixBase<Real> &in,
+                     const CuMatrixBase<Real> &out,
+                     const CuMatrixBase<Real> &out_diff,
+                     const CuArray<int32> &out_blocks,
+                     const CuArray<Int32Pair> &in_ranges,
+                     const CuVectorBase<Real> &scale,
+                     int32 block_dim, CuMatrixBase<Real> *in_diff) {
+  KALDI_ASSERT(SameDim(in, *in_diff) && SameDim(out, out_diff) &&
+               in.NumRows() == out.NumRows() && block_dim > 0 &&
+               in.NumCols() == in_ranges.Dim() * block_dim &&
+               scale.Dim() == in_ranges.Dim());
+  if (in.NumRows() == 0) return;
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    dim3 dimGrid(n_blocks(in_diff->NumCols(), CU2DBLOCK),
+                 n_blocks(in_diff->NumRows(), CU2DBLOCK));
+    cuda_max_pool_backward(dimGrid, dimBlock, in_diff->Data(), in_diff->Dim(),
+                           in.Data(), in.Stride(), out.Data(), out.Stride(),
+                           out_diff.Data(), out_diff.Stride(),
+                           out_blocks.Data(), in_ranges.Data(), scale.Data(),
+                           block_dim);
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    const MatrixBase<Real> &in_mat = in.Mat(), &out_mat = out.Mat(),
+        &out_diff_mat = out_diff.Mat();
+    MatrixBase<Real> &in_diff_mat = in_diff->Mat();
+    const int32 *blocks = out_blocks.Data();
+    const Int32Pair *ranges = in_ranges.Data();
+    const VectorBase<Real> &scale_vec = scale.Vec();
+    int32 num_in_blocks = in_ranges.Dim();
+    for (MatrixIndexT r = 0; r < in_mat.NumRows(); r++) {
+      const Real *in_row = in_mat.RowData(r), *out_row = out_mat.RowData(r),
+          *out_diff_row = out_diff_mat.RowData(r);
+      Real *in_diff_row = in_diff_mat.RowData(r);
+      for (int32 p = 0; p < num_in_blocks; p++) {
+        const Real *x = in_row + p * block_dim;
+        Real *d = in_diff_row + p * block_dim;
+        for (int32 b = 0; b < block_dim; b++)
+          d[b] = 0.0;
+        for (int32 j = ranges[p].first; j < ranges[p].second; j++) {
+          const Real *y = out_row + blocks[j] * block_dim,
+              *e = out_diff_row + blocks[j] * block_dim;
+          for (int32 b = 0; b < block_dim; b++)
+            d[b] += (x[b] == y[b] ? e[b] : 0.0);
+        }
+        Real s = scale_vec(p);
+        for (int32 b = 0; b < block_dim; b++)
+          d[b] *= s;
+      }
+    }
+  }
+}
+
+template<typename Real>
+void AveragePoolBackward(const CuMatrixBase<Real> &out_diff,
+                         const CuArray<int32> &out_blocks,
+                         const CuArray<Int32Pair> &in_ranges,
+                         const CuVectorBase<Real> &scale,
+                         int32 block_dim, CuMatrixBase<Real> *in_diff) {
+  KALDI_ASSERT(in_diff->NumRows() == out_diff.NumRows() && block_dim > 0 &&
+               in_diff->NumCols() == in_ranges.Dim() * block_dim &&
+               scale.Dim() == in_ranges.Dim());
+  if (in_diff->NumRows() == 0) return;
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    dim3 dimGrid(n_blocks(in_diff->NumCols(), CU2DBLOCK),
+                 n_blocks(in_diff->NumRows(), CU2DBLOCK));
+    cuda_average_pool_backward(dimGrid, dimBlock, in_diff->Data(),
+                               in_diff->Dim(), out_diff.Data(),
+                               out_diff.Stride(), out_blocks.Data(),
+                               in_ranges.Data(), scale.Data(), block_dim);
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    const MatrixBase<Real> &out_diff_mat = out_diff.Mat();
+    MatrixBase<Real> &in_diff_mat = in_diff->Mat();
+    const int32 *blocks = out_blocks.Data();
+    const Int32Pair *ranges = in_ranges.Data();
+    const VectorBase<Real> &scale_vec = scale.Vec();
+    int32 num_in_blocks = in_ranges.Dim();
+    for (MatrixIndexT r = 0; r < in_diff_mat.NumRows(); r++) {
+      const Real *out_diff_row = out_diff_mat.RowData(r);
+      Real *in_diff_row = in_diff_mat.RowData(r);
+      for (int32 p = 0; p < num_in_blocks; p++) {
+        Real *d = in_diff_row + p * block_dim;
+        for (int32 b = 0; b < block_dim; b++)
+          d[b] = 0.0;
+        for (int32 j = ranges[p].first; j < ranges[p].second; j++) {
+          const Real *e = out_diff_row + blocks[j] * block_dim;
+          for (int32 b = 0; b < block_dim; b++)
+            d[b] += e[b];
+        }
+        Real s = scale_vec(p);
+        for (int32 b = 0; b < block_dim; b++)
+          d[b] *= s;
+      }
+    }
+  }
+}
+
+// Makes the rows of *Y orthonormal (spanning the same space, if *Y has full
+// row rank), by "shifted Cholesky QR 3": the first pass, with a small multiple
+// of the unit matrix added to the Gram matrix Y Y^T, makes the rows well
+// enough conditioned for the next two to be accurate.
+template<typename Real>
+static void OrthonormalizeRows(CuMatrixBase<Real> *Y) {
+  MatrixIndexT num_rows = Y->NumRows();
+  KALDI_ASSERT(num_rows <= Y->NumCols());
+  CuMatrix<Real> G(num_rows, num_rows), C_inv(num_rows, num_rows),
+      Y_copy(num_rows, Y->NumCols(), kUndefined);
+  for (int32 pass = 0; pass < 3; pass++) {
+    G.SymAddMat2(1.0, *Y, kNoTrans, 0.0);  // G = Y Y^T (lower triangle).
+    // The shift also keeps G positive definite if *Y is rank deficient.
+    Real shift = 100.0 * std::numeric_limits<Real>::epsilon() *
+        std::max<Real>(G.Trace(), 1.0e-20);
+    G.AddToDiag(shift);
+    G.Cholesky(&C_inv);  // G = C C^T, and C_inv = C^{-1}.
+    Y_copy.CopyFromMat(*Y);
+    Y->AddMatMat(1.0, C_inv, kNoTrans, Y_copy, kNoTrans, 0.0);
+  }
+}
+
+template<typename Real>
+void RandomizedSvd(const CuMatrixBase<Real> &M,
+                   VectorBase<Real> *s,
+                   CuMatrixBase<Real> *U,
+                   CuMatrixBase<Real> *Vt,
+                   MatrixIndexT oversample,
+                   int32 num_power_iters) {
+  MatrixIndexT rows = M.NumRows(), cols = M.NumCols(), k = s->Dim(),
+      l = std::min(k + oversample, std::min(rows, cols));
+  KALDI_ASSERT(k > 0 && k <= l && oversample >= 0 && num_power_iters >= 0);
+  KALDI_ASSERT(U->NumRows() == rows && U->NumCols() == k &&
+               Vt->NumRows() == k && Vt->NumCols() == cols);
+  if (l == std::min(rows, cols)) {
+    // The result is exact; Cholesky QR would lose precision where the
+    // singular values are small, so do this on the CPU.
+    Matrix<Real> M_cpu(M), U_cpu(rows, k, kUndefined),
+        Vt_cpu(k, cols, kUndefined);
+    kaldi::RandomizedSvd(M_cpu, s, &U_cpu, &Vt_cpu, oversample,
+                         num_power_iters);
+    U->CopyFromMat(U_cpu);
+    Vt->CopyFromMat(Vt_cpu);
+    return;
+  }
+  // This follows the CPU version, see RandomizedSvd() in
+  // matrix/matrix-functions.cc.
+  CuMatrix<Real> Q(l, rows, kUndefined), Z(l, cols, kUndefined);
+  Z.SetRandn();
+  for (int32 i = 0; i <= num_power_iters; i++) {
+    Q.AddMatMat(1.0, Z, kNoTrans, M, kTrans, 0.0);  // Q = Z M^T.
+    OrthonormalizeRows(&Q);
+    Z.AddMatMat(1.0, Q, kNoTrans, M, kNoTrans, 0.0);  // Z = Q M.
+    OrthonormalizeRows(&Z);
+  }
+  CuMatrix<Real> C(rows, l);
+  C.AddMatMat(1.0, M, kNoTrans, Z, kTrans, 0.0);  // C = M Z^T.
+  Matrix<Real> C_cpu(rows, l, kUndefined), W(rows, l), Yt(l, l);
+  C.CopyToMat(&C_cpu);
+  Vector<Real> s_tmp(l);
+  C_cpu.DestructiveSvd(&s_tmp, &W, &Yt);  // C = W diag(s) Y^T.
+  SortSvd(&s_tmp, &W, &Yt);
+  s->CopyFromVec(s_tmp.Range(0, k));
+  U->CopyFromMat(SubMatrix<Real>(W, 0, rows, 0, k));
+  CuMatrix<Real> Yt_k(SubMatrix<Real>(Yt, 0, k, 0, l));
+  Vt->AddMatMat(1.0, Yt_k, kNoTrans, Z, kNoTrans, 0.0);  // Vt = Y_k^T Z.
+}
+
+
 // instantiate the templates.
 template
 void RegularizeL1(CuMatrixBase<float> *weight, CuMatrixBase<float> *grad, float l1, float lr);
@@ -224,7 +501,63 @@ void Randomize(const CuMatrixBase<double> &src,
                const CuArray<int32> &copy_from_idx,
                CuMatrixBase<double> *tgt);
 
+template
+void MaxPool(const CuMatrixBase<float> &in, const CuArray<int32> &pool_blocks,
+             int32 block_dim, CuMatrixBase<float> *out);
+template
+void AveragePool(const CuMatrixBase<float> &in,
+                 const CuArray<int32> &pool_blocks,
+                 int32 block_dim, CuMatrixBase<float> *out);
+template
+void MaxPoolBackward(const CuMatrixBase<float> &in,
+                     const CuMatrixBase<float> &out,
+                     const CuMatrixBase<float> &out_diff,
+                     const CuArray<int32> &out_blocks,
+                     const CuArray<Int32Pair> &in_ranges,
+                     const CuVectorBase<float> &scale,
+                     int32 block_dim, CuMatrixBase<float> *in_diff);
+template
+void AveragePoolBackward(const CuMatrixBase<float> &out_diff,
+                         const CuArray<int32> &out_blocks,
+                         const CuArray<Int32Pair> &in_ranges,
+                         const CuVectorBase<float> &scale,
+                         int32 block_dim, CuMatrixBase<float> *in_diff);
+template
+void MaxPool(const CuMatrixBase<double> &in, const CuArray<int32> &pool_blocks,
+             int32 block_dim, CuMatrixBase<double> *out);
+template
+void AveragePool(const CuMatrixBase<double> &in,
+                 const CuArray<int32> &pool_blocks,
+                 int32 block_dim, CuMatrixBase<double> *out);
+template
+void MaxPoolBackward(const CuMatrixBase<double> &in,
+                     const CuMatrixBase<double> &out,
+                     const CuMatrixBase<double> &out_diff,
+                     const CuArray<int32> &out_blocks,
+                     const CuArray<Int32Pair> &in_ranges,
+                     const CuVectorBase<double> &scale,
+                     int32 block_dim, CuMatrixBase<double> *in_diff);
+template
+void AveragePoolBackward(const CuMatrixBase<double> &out_diff,
+                         const CuArray<int32> &out_blocks,
+                         const CuArray<Int32Pair> &in_ranges,
+                         const CuVectorBase<double> &scale,
+                         int32 block_dim, CuMatrixBase<double> *in_diff);
 
+template
+void RandomizedSvd(const CuMatrixBase<float> &M,
+                   VectorBase<float> *s,
+                   CuMatrixBase<float> *U,
+                   CuMatrixBase<float> *Vt,
+                   MatrixIndexT oversample,
+                   int32 num_power_iters);
+template
+void RandomizedSvd(const CuMatrixBase<double> &M,
+                   VectorBase<double> *s,
+                   CuMatrixBase<double> *U,
+                   CuMatrixBase<double> *Vt,
+                   MatrixIndexT oversample,
+                   int32 num_power_iters);
 
 } //namespace cu
 
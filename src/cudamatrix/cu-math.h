@@ -73,6 +73,61 @@ void Copy(const CuMatrix<Real> &src,
           const CuArray<int32> &copy_from_indices,
           CuMatrix<Real> *tgt);
 
+/// Max-pooling over blocks of columns, as done by the nnet1 pooling
+/// components.  The columns of 'in' and 'out' are divided into blocks of
+/// 'block_dim' columns.  Output block q is the element-wise maximum of the
+/// pool_size input blocks pool_blocks[q * pool_size + k], k = 0 .. pool_size-1,
+/// where pool_size = pool_blocks.Dim() / (out->NumCols() / block_dim).
+template<typename Real>
+void MaxPool(const CuMatrixBase<Real> &in, const CuArray<int32> &pool_blocks,
+             int32 block_dim, CuMatrixBase<Real> *out);
+
+/// As MaxPool(), but output block q is the element-wise average of the
+/// input blocks of the pool.
+template<typename Real>
+void AveragePool(const CuMatrixBase<Real> &in,
+                 const CuArray<int32> &pool_blocks,
+                 int32 block_dim, CuMatrixBase<Real> *out);
+
+/// Back-propagation through MaxPool().  The output blocks whose pools
+/// contain input block p are out_blocks[j] for j in
+/// [in_ranges[p].first, in_ranges[p].second).  Each element of input block p
+/// gets the sum of the derivatives of the corresponding elements of those
+/// output blocks for which it equals the maximum (ties all get the
+/// derivative), times scale(p).
+template<typename Real>
+void MaxPoolBackward(const CuMatrixBase<Real> &in,
+                     const CuMatrixBase<Real> &out,
+                     const CuMatrixBase<Real> &out_diff,
+                     const CuArray<int32> &out_blocks,
+                     const CuArray<Int32Pair> &in_ranges,
+                     const CuVectorBase<Real> &scale,
+                     int32 block_dim, CuMatrixBase<Real> *in_diff);
+
+/// Back-propagation through AveragePool(): as MaxPoolBackward() but with no
+/// masking; scale(p) should include the 1 / pool_size of the average.
+template<typename Real>
+void AveragePoolBackward(const CuMatrixBase<Real> &out_diff,
+                         const CuArray<int32> &out_blocks,
+                         const CuArray<Int32Pair> &in_ranges,
+                         const CuVectorBase<Real> &scale,
+                         int32 block_dim, CuMatrixBase<Real> *in_diff);
+
+/// Version of RandomizedSvd() (see matrix/matrix-functions.h) for CUDA
+/// matrices: M ~= U diag(s) Vt, keeping the top k = s->Dim() singular values.
+/// All the products with M are done on the GPU; instead of Gram-Schmidt, the
+/// bases are orthonormalized with shifted Cholesky QR, which is also just
+/// matrix-matrix products plus a Cholesky of a small matrix.  Only the SVD of
+/// a (#rows of M) by (k + oversample) matrix is done on the CPU.  If
+/// k + oversample >= min(#rows, #cols), which gives an exact SVD, it's all done
+/// on the CPU.
+template<typename Real>
+void RandomizedSvd(const CuMatrixBase<Real> &M,
+                   VectorBase<Real> *s,
+                   CuMatrixBase<Real> *U,
+                   CuMatrixBase<Real> *Vt,
+                   MatrixIndexT oversample = 10,
+                   int32 num_power_iters = 2);
 
 } // namespace cu
 } // namespace kaldi
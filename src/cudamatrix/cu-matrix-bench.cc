@@ -0,0 +1,92 @@
+// cudamatrix/cu-matrix-bench.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include "cudamatrix/cu-matrix.h"
+#include "cudamatrix/cu-device.h"
+#include "cudamatrix/cu-common.h"
+#include "util/kaldi-bench.h"
+
+namespace kaldi {
+
+static bool UsingGpu() {
+#if HAVE_CUDA == 1
+  return CuDevice::Instantiate().Enabled();
+#else
+  return false;
+#endif
+}
+
+template<typename Real>
+struct AddMatMatBench {
+  AddMatMatBench(int32 m, int32 n, int32 k, MatrixTransposeType trans_b):
+      a_(m, k), b_(trans_b == kNoTrans ? k : n, trans_b == kNoTrans ? n : k),
+      c_(m, n), trans_b_(trans_b) {
+    a_.SetRandn();
+    b_.SetRandn();
+  }
+  void operator() () {
+    c_.AddMatMat(1.0, a_, kNoTrans, b_, trans_b_, 0.0);
+#if HAVE_CUDA == 1
+    // Wait for the kernel, or we'd only be timing the launch.
+    if (UsingGpu())
+      CU_SAFE_CALL(cudaThreadSynchronize());
+#endif
+  }
+  CuMatrix<Real> a_, b_, c_;
+  MatrixTransposeType trans_b_;
+};
+
+// Times C = A B (or A B^T) where A is m by k and C is m by n.  The shapes in
+// main() are those of the neural-net training and decoding: minibatches of
+// 256 or 512 frames, 1024-dim hidden layers and a few thousand outputs.
+template<typename Real>
+void CuMatrixAddMatMatBench(int32 m, int32 n, int32 k,
+                            MatrixTransposeType trans_b) {
+  AddMatMatBench<Real> bench(m, n, k, trans_b);
+  std::ostringstream params;
+  params << "type=" << (sizeof(Real) == 8 ? "double" : "float")
+         << " m=" << m << " n=" << n << " k=" << k
+         << " trans_b=" << (trans_b == kNoTrans ? "false" : "true")
+         << " gpu=" << (UsingGpu() ? "true" : "false");
+  PrintBenchmarkResult("CuMatrix::AddMatMat", params.str(),
+                       TimeBenchmark(bench), 2.0 * m * n * k, "flops");
+}
+
+template<typename Real>
+void CuMatrixBench() {
+  CuMatrixAddMatMatBench<Real>(256, 1024, 440, kTrans);
+  CuMatrixAddMatMatBench<Real>(256, 1024, 1024, kTrans);
+  CuMatrixAddMatMatBench<Real>(256, 1024, 1024, kNoTrans);
+  CuMatrixAddMatMatBench<Real>(512, 4000, 1024, kTrans);
+  CuMatrixAddMatMatBench<Real>(1024, 1024, 1024, kNoTrans);
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  srand(0);
+#if HAVE_CUDA == 1
+  CuDevice::Instantiate().SelectGpuId("optional");
+#endif
+  CuMatrixBench<float>();
+  CuMatrixBench<double>();
+  return 0;
+}
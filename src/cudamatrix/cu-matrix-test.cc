@@ -193,6 +193,69 @@ static void UnitTestCuMatrixSigmoid() {
   }
 }
 
+template<typename Real> 
+static void UnitTestCuMatrixSigmoidWithBias() {
+  for (int32 i = 0; i < 2; i++) {
+    int32 M = 100 + rand() % 200, N = 100 + rand() % 200;
+    Matrix<Real> H(M, N);
+    H.SetRandn();
+    Vector<Real> b(N);
+    b.SetRandn();
+    CuMatrix<Real> D(H), E(M, N), F(H);
+    CuVector<Real> cu_b(b);
+
+    E.SigmoidWithBias(D, cu_b);
+    F.TanhWithBias(F, cu_b);  // in-place.
+    H.AddVecToRows(1.0, b);
+    Matrix<Real> H_sigmoid(M, N), H_tanh(M, N);
+    H_sigmoid.Sigmoid(H);
+    H_tanh.Tanh(H);
+
+    Matrix<Real> E2(E), F2(F);
+    AssertEqual(H_sigmoid, E2);
+    AssertEqual(H_tanh, F2);
+  }
+}
+
+template<typename Real> 
+static void UnitTestCuMatrixUploader() {
+  CuMatrixUploader<Real> uploader;
+  std::vector<Matrix<Real> > mats(5);
+  std::vector<CuMatrix<Real> > cu_mats(5);
+  for (int32 i = 0; i < 5; i++) {
+    mats[i].Resize(1 + rand() % 100, 1 + rand() % 100);
+    mats[i].SetRandn();
+    uploader.Upload(mats[i], &(cu_mats[i]));
+  }
+  for (int32 i = 0; i < 5; i++) {
+    Matrix<Real> mat(cu_mats[i]);
+    AssertEqual(mat, mats[i]);
+  }
+  // Operations that follow the upload are ordered after it.
+  CuMatrix<Real> cu_mat;
+  uploader.Upload(mats[0], &cu_mat);
+  cu_mat.Scale(2.0);
+  uploader.WaitForCompletion();
+  Matrix<Real> mat(cu_mat);
+  mat.Scale(0.5);
+  AssertEqual(mat, mats[0]);
+}
+
+template<typename Real> 
+static void UnitTestCuMatrixCopyFromCompressed() {
+  for (int32 i = 0; i < 5; i++) {
+    int32 num_rows = 1 + rand() % 100, num_cols = 1 + rand() % 50;
+    Matrix<Real> mat(num_rows, num_cols);
+    mat.SetRandn();
+    CompressedMatrix cmat(mat);
+    Matrix<Real> mat2(cmat);  // uncompressed on the CPU.
+    CuMatrix<Real> cu_mat(num_rows, num_cols);
+    cu_mat.CopyFromMat(cmat);
+    Matrix<Real> mat3(cu_mat);
+    AssertEqual(mat2, mat3);
+  }
+}
+
 template<typename Real> 
 static void UnitTestCuMatrixScale() {
   int32 M = 100 + rand() % 200, N = 100 + rand() % 200;
@@ -436,6 +499,39 @@ static void UnitTestCuMatrixSumColumnRanges() {
 }
 
 
+template<typename Real>
+static void UnitTestCuMatrixLogSumExpColumnRanges() {
+  for (MatrixIndexT p = 0; p < 2; p++) {
+    MatrixIndexT num_cols1 = 10 + rand() % 10,
+        num_cols2 = 10 + rand() % 10,
+        num_rows = 10 + rand() % 10;
+    Matrix<Real> src(num_rows, num_cols1);
+    Matrix<Real> dst(num_rows, num_cols2);
+    std::vector<Int32Pair> indices(num_cols2);
+    for (MatrixIndexT i = 0; i < num_cols2; i++) {
+      indices[i].first = rand() % num_cols1;
+      int32 headroom = num_cols1 - indices[i].first,
+        size = (rand() % headroom) + 1;
+      indices[i].second = indices[i].first + size;
+    }
+    src.SetRandn();
+    src.Scale(100.0);  // so that a naive log(sum(exp)) would overflow.
+    for (MatrixIndexT i = 0; i < num_rows; i++) {
+      for (MatrixIndexT j = 0; j < num_cols2; j++) {
+        int32 start = indices[j].first, end = indices[j].second;
+        Vector<Real> range(src.Row(i).Range(start, end - start));
+        dst(i, j) = range.LogSumExp();
+      }
+    }
+    CuMatrix<Real> cu_src(src);
+    CuMatrix<Real> cu_dst(num_rows, num_cols2, kUndefined);
+    CuArray<Int32Pair> indices_tmp(indices);
+    cu_dst.LogSumExpColumnRanges(cu_src, indices_tmp);
+    Matrix<Real> dst2(cu_dst);
+    AssertEqual(dst, dst2);
+  }
+}
+
   
 template<typename Real>
 static void UnitTestCuMatrixCopyCols() {
@@ -666,6 +762,58 @@ static void UnitTestCuMatrixGroupPnormDeriv() {
   AssertEqual(Hr,Hr2);
 }
 
+template<typename Real> 
+static void UnitTestCuMatrixDiffGroupPnorm() {
+  for (int32 p = 0; p < 4; p++) {
+    int32 dimM = 10 + rand() % 100, dimNs = 10 + rand() % 100;
+    int32 group_size = 1 + rand() % 10;
+    // Test the special cases p = 1 and p = 2 as well as the general case.
+    BaseFloat power = (p == 0 ? 1.0 : (p == 1 ? 2.0 : 1.1 + 0.1 * (rand() % 10)));
+    int32 dimN = group_size * dimNs;
+    CuMatrix<Real> in_value(dimM, dimN), out_value(dimM, dimNs),
+        out_deriv(dimM, dimNs);
+    in_value.SetRandn();
+    if (rand() % 2 == 0)
+      in_value.ApplyFloor(0.0);  // puts some zeros in the matrix.
+    out_value.GroupPnorm(in_value, power);
+    out_deriv.SetRandn();
+
+    // Compare with the two-step computation.
+    CuMatrix<Real> in_deriv(dimM, dimN), in_deriv2(dimM, dimN);
+    in_deriv.DiffGroupPnorm(in_value, out_value, out_deriv, power);
+    in_deriv2.GroupPnormDeriv(in_value, out_value, power);
+    in_deriv2.MulRowsGroupMat(out_deriv);
+    AssertEqual(in_deriv, in_deriv2);
+  }
+}
+
+template<typename Real> 
+static void UnitTestCuMatrixGroupMax() {
+  int32 dimM = 10 + rand() % 100, dimNs = 10 + rand() % 100;
+  int32 group_size = 1 + rand() % 10;
+  int32 dimN = group_size * dimNs;
+  Matrix<Real> Hi(dimM, dimN);
+  Hi.SetRandn();
+  CuMatrix<Real> in_value(Hi), out_value(dimM, dimNs), out_deriv(dimM, dimNs),
+      in_deriv(dimM, dimN);
+  out_value.GroupMax(in_value);
+  out_deriv.SetRandn();
+  in_deriv.DiffGroupMax(in_value, out_value, out_deriv);
+
+  Matrix<Real> Ho(out_value), Hod(out_deriv), Hid(in_deriv);
+  for (int32 r = 0; r < dimM; r++) {
+    for (int32 j = 0; j < dimNs; j++) {
+      Real max = -1.0e20;
+      for (int32 i = 0; i < group_size; i++)
+        max = std::max(max, Hi(r, j * group_size + i));
+      AssertEqual(Ho(r, j), max);
+      for (int32 i = 0; i < group_size; i++)
+        AssertEqual(Hid(r, j * group_size + i),
+                    (Hi(r, j * group_size + i) == max ? Hod(r, j) : 0.0));
+    }
+  }
+}
+
 template<typename Real> static void UnitTestCuMatrixAddDiagVecMat() {
   for (int p = 0; p < 4; p++) {
     MatrixIndexT dimM = 100 + rand() % 255, dimN = 100 + rand() % 255;
@@ -946,6 +1094,52 @@ static void UnitTestCuMatrixAddMatMat() {
 }
 
 
+template<typename Real>
+static void UnitTestCuMatrixAddMatMatBatched() {
+  for (int32 i = 0; i < 10; i++) {
+    // Sizes that go to the batched kernel on the GPU, and larger ones.
+    int32 num_blocks = 1 + rand() % 5, dimM = 1 + rand() % (i < 5 ? 30 : 200),
+        dimN = 1 + rand() % 40, dimK = 1 + rand() % 40;
+    MatrixTransposeType transA = (rand() % 2 == 0 ? kNoTrans : kTrans),
+        transB = (rand() % 2 == 0 ? kNoTrans : kTrans);
+    Real alpha = 0.5, beta = (i % 3 == 0 ? 0.0 : 2.0);
+    // The matrices of the batch are column ranges of these.
+    CuMatrix<Real> A(transA == kNoTrans ? dimM : dimK,
+                     num_blocks * (transA == kNoTrans ? dimK : dimM)),
+        B(transB == kNoTrans ? dimK : dimN,
+          num_blocks * (transB == kNoTrans ? dimN : dimK)),
+        C(dimM, num_blocks * dimN);
+    A.SetRandn();
+    B.SetRandn();
+    C.SetRandn();
+    Matrix<Real> C_ref(C);
+    std::vector<CuSubMatrix<Real>*> A_sub, B_sub, C_sub;
+    for (int32 b = 0; b < num_blocks; b++) {
+      int32 A_cols = A.NumCols() / num_blocks, B_cols = B.NumCols() / num_blocks;
+      A_sub.push_back(new CuSubMatrix<Real>(A.ColRange(b * A_cols, A_cols)));
+      B_sub.push_back(new CuSubMatrix<Real>(B.ColRange(b * B_cols, B_cols)));
+      C_sub.push_back(new CuSubMatrix<Real>(C.ColRange(b * dimN, dimN)));
+      SubMatrix<Real> C_ref_block(C_ref, 0, dimM, b * dimN, dimN);
+      C_ref_block.AddMatMat(alpha, Matrix<Real>(*(A_sub[b])), transA,
+                            Matrix<Real>(*(B_sub[b])), transB, beta);
+    }
+    AddMatMatBatched(alpha,
+                     std::vector<CuMatrixBase<Real>*>(C_sub.begin(), C_sub.end()),
+                     std::vector<const CuMatrixBase<Real>*>(A_sub.begin(),
+                                                            A_sub.end()),
+                     transA,
+                     std::vector<const CuMatrixBase<Real>*>(B_sub.begin(),
+                                                            B_sub.end()),
+                     transB, beta);
+    Matrix<Real> C_out(C);
+    AssertEqual(C_ref, C_out);
+    DeletePointers(&A_sub);
+    DeletePointers(&B_sub);
+    DeletePointers(&C_sub);
+  }
+}
+
+
 template<typename Real> 
 static void UnitTestCuMatrixAddToDiag() {
   for (int32 i = 0; i < 10; i++) {
@@ -1539,6 +1733,36 @@ static void UnitTestCuDiffXent() {
   AssertEqual(Hlogpost,Hlogpost2);
 }
 
+template<typename Real> 
+static void UnitTestCuDiffXentSparse() {
+  int32 X = 100, Y = 111;
+  Matrix<Real> Hi(X, Y);
+  RandZeroToOneMatrix(&Hi);
+  CuMatrix<Real> Di(Hi);
+  // up to 3 distinct targets per row, some rows with none.
+  std::vector<MatrixElement<Real> > tgt;
+  for (int32 r = 0; r < X; r++) {
+    int32 num_tgt = rand() % 4, col = rand() % Y;
+    for (int32 i = 0; i < num_tgt; i++) {
+      MatrixElement<Real> e = { r, (col + 7 * i) % Y, RandUniform() };
+      tgt.push_back(e);
+    }
+  }
+  CuVector<Real> Dlogpost;
+  Di.DiffXent(tgt, &Dlogpost);
+
+  Vector<Real> Hlogpost(tgt.size());
+  for (size_t i = 0; i < tgt.size(); i++) {
+    Real &value = Hi(tgt[i].row, tgt[i].column);
+    Hlogpost(i) = tgt[i].weight * log(value);
+    value -= tgt[i].weight;
+  }
+  Matrix<Real> Hi2(Di);
+  Vector<Real> Hlogpost2(Dlogpost);
+  AssertEqual(Hi, Hi2);
+  AssertEqual(Hlogpost, Hlogpost2);
+}
+
 template<typename Real> void UnitTestCheck() {
   Matrix<Real> Hi(100,111);
   Hi.SetRandn();
@@ -1921,6 +2145,7 @@ template<typename Real> void CudaMatrixUnitTest() {
   UnitTestCuMatrixSetRandUniform<Real>();
   UnitTestCuMatrixScale<Real>();
   UnitTestCuMatrixSigmoid<Real>();
+  UnitTestCuMatrixSigmoidWithBias<Real>();
   UnitTestCuMatrixSoftHinge<Real>();
   UnitTestCuMatrixApplyPow<Real>(); 
   UnitTestCuMatrixSet<Real>();
@@ -1937,6 +2162,7 @@ template<typename Real> void CudaMatrixUnitTest() {
   UnitTestCuMatrixAddVecToCols<Real>();
   UnitTestCuMatrixAddVecToRows<Real>();
   UnitTestCuMatrixAddMatMat<Real>();
+  UnitTestCuMatrixAddMatMatBatched<Real>();
   UnitTestCuMatrixSymAddMat2<Real>();
   UnitTestCuMatrixSymInvertPosDef<Real>();
   UnitTestCuMatrixCopyFromMat<Real>();
@@ -1944,6 +2170,7 @@ template<typename Real> void CudaMatrixUnitTest() {
   UnitTestCuMatrixAddMatTp<Real>();
   UnitTestCuMatrixCopyCols<Real>();
   UnitTestCuMatrixSumColumnRanges<Real>();
+  UnitTestCuMatrixLogSumExpColumnRanges<Real>();
   UnitTestCuMatrixCopyRows<Real>();
   UnitTestCuMatrixCopyRowsFromVec<Real>();
   UnitTestCuMatrixAddTpMat<Real>();
@@ -1976,11 +2203,14 @@ template<typename Real> void CudaMatrixUnitTest() {
   UnitTestCuDiffSigmoid<Real>();
   UnitTestCuMatrixGroupPnorm<Real>();  
   UnitTestCuMatrixGroupPnormDeriv<Real>();
+  UnitTestCuMatrixDiffGroupPnorm<Real>();
+  UnitTestCuMatrixGroupMax<Real>();
   UnitTestCuMatrixMulRowsVec<Real>();
   UnitTestCuMatrixMulRowsGroupMat<Real>();
   UnitTestCuFindRowMaxId<Real>();
   UnitTestCuSoftmax<Real>();
   UnitTestCuDiffXent<Real>();
+  UnitTestCuDiffXentSparse<Real>();
   UnitTestCheck<Real>();
   UnitTestSwapCu2Cu<Real>();
   UnitTestSwapCu2M<Real>();
@@ -1990,6 +2220,8 @@ template<typename Real> void CudaMatrixUnitTest() {
   UnitTestCuDiffTanh<Real>();
   UnitTestCuVectorAddTpVec<Real>();
   UnitTestCuVectorMulTp<Real>();
+  UnitTestCuMatrixUploader<Real>();
+  UnitTestCuMatrixCopyFromCompressed<Real>();
 }
 
 
@@ -0,0 +1,131 @@
+// cudamatrix/cu-matrix-uploader.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#if HAVE_CUDA == 1
+#include <cuda_runtime_api.h>
+#endif
+
+#include <cstring>
+#include "util/timer.h"
+#include "cudamatrix/cu-common.h"
+#include "cudamatrix/cu-device.h"
+#include "cudamatrix/cu-matrix-uploader.h"
+
+namespace kaldi {
+
+template<typename Real>
+CuMatrixUploader<Real>::CuMatrixUploader() {
+#if HAVE_CUDA == 1
+  initialized_ = false;
+  next_ = 0;
+  for (int32 i = 0; i < 2; i++) {
+    buffers_[i] = NULL;
+    buffer_sizes_[i] = 0;
+  }
+#endif
+}
+
+#if HAVE_CUDA == 1
+template<typename Real>
+void CuMatrixUploader<Real>::Init() {
+  // The events are created on first use, as the GPU may not have been selected
+  // when this object was constructed.
+  for (int32 i = 0; i < 2; i++)
+    CU_SAFE_CALL(cudaEventCreateWithFlags(&(events_[i]),
+                                          cudaEventDisableTiming));
+  initialized_ = true;
+}
+#endif
+
+template<typename Real>
+void CuMatrixUploader<Real>::Upload(const MatrixBase<Real> &src,
+                                    CuMatrix<Real> *dest) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    if (!initialized_) Init();
+    int32 b = next_;
+    next_ = 1 - next_;
+    MatrixIndexT num_rows = src.NumRows(), num_cols = src.NumCols();
+    size_t size = static_cast<size_t>(num_rows) * num_cols;
+    // Wait until the previous transfer from this buffer has finished (if
+    // the event has never been recorded, this returns immediately).
+    CU_SAFE_CALL(cudaEventSynchronize(events_[b]));
+    if (buffer_sizes_[b] < size) {
+      if (buffers_[b] != NULL)
+        CU_SAFE_CALL(cudaFreeHost(buffers_[b]));
+      CU_SAFE_CALL(cudaMallocHost(reinterpret_cast<void**>(&(buffers_[b])),
+                                  size * sizeof(Real)));
+      buffer_sizes_[b] = size;
+    }
+    Real *buffer = buffers_[b];
+    for (MatrixIndexT r = 0; r < num_rows; r++)
+      memcpy(buffer + r * num_cols, src.RowData(r), num_cols * sizeof(Real));
+
+    dest->Resize(num_rows, num_cols, kUndefined);
+    if (size != 0) {
+      cudaStream_t stream = CuDevice::Instantiate().CopyStream();
+      CU_SAFE_CALL(cudaMemcpy2DAsync(dest->Data(), dest->Stride() * sizeof(Real),
+                                     buffer, num_cols * sizeof(Real),
+                                     num_cols * sizeof(Real), num_rows,
+                                     cudaMemcpyHostToDevice, stream));
+      CU_SAFE_CALL(cudaEventRecord(events_[b], stream));
+      // Later work on the default stream will wait for the transfer.
+      CU_SAFE_CALL(cudaStreamWaitEvent(0, events_[b], 0));
+    }
+    CuDevice::Instantiate().AccuProfile("CuMatrixUploader::Upload",
+                                        tim.Elapsed());
+  } else
+#endif
+  {
+    dest->Resize(src.NumRows(), src.NumCols(), kUndefined);
+    dest->CopyFromMat(src);
+  }
+}
+
+template<typename Real>
+void CuMatrixUploader<Real>::WaitForCompletion() {
+#if HAVE_CUDA == 1
+  if (initialized_) {
+    for (int32 i = 0; i < 2; i++)
+      CU_SAFE_CALL(cudaEventSynchronize(events_[i]));
+  }
+#endif
+}
+
+template<typename Real>
+CuMatrixUploader<Real>::~CuMatrixUploader() {
+#if HAVE_CUDA == 1
+  if (initialized_) {
+    WaitForCompletion();
+    for (int32 i = 0; i < 2; i++) {
+      if (buffers_[i] != NULL)
+        CU_SAFE_CALL(cudaFreeHost(buffers_[i]));
+      CU_SAFE_CALL(cudaEventDestroy(events_[i]));
+    }
+  }
+#endif
+}
+
+template class CuMatrixUploader<float>;
+template class CuMatrixUploader<double>;
+
+}  // namespace kaldi
@@ -0,0 +1,83 @@
+// cudamatrix/cu-matrix-uploader.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#ifndef KALDI_CUDAMATRIX_CU_MATRIX_UPLOADER_H_
+#define KALDI_CUDAMATRIX_CU_MATRIX_UPLOADER_H_
+
+#if HAVE_CUDA == 1
+#include <cuda_runtime_api.h>
+#endif
+
+#include "cudamatrix/cu-matrix.h"
+
+namespace kaldi {
+
+
+/**
+   CuMatrixUploader copies a sequence of matrices (e.g. minibatches of
+   features) from the host to the GPU asynchronously, so that the copies can
+   overlap with computation on the GPU and with the host's work of preparing
+   the next matrix.  The data is first copied into one of two page-locked
+   ("pinned") host buffers, which are used in turn (which is what allows the
+   transfer to be asynchronous), and the transfer is done on
+   CuDevice::CopyStream().
+
+   Upload() returns without waiting for the transfer.  Any operation on the
+   destination that is launched afterwards (on the default stream, i.e. any
+   CuMatrix operation) is ordered after the transfer, via an event, so no
+   explicit synchronization is needed, and it is safe to destroy or resize the
+   destination (the freed memory will only be reused by later operations).
+   Without a GPU, Upload() is just a copy.
+*/
+template<typename Real>
+class CuMatrixUploader {
+ public:
+  CuMatrixUploader();
+
+  /// Copies "src" to "dest", which is resized (without zeroing) to the same
+  /// size.
+  void Upload(const MatrixBase<Real> &src, CuMatrix<Real> *dest);
+
+  /// Waits for all transfers started by this object to finish.
+  void WaitForCompletion();
+
+  ~CuMatrixUploader();
+
+ private:
+#if HAVE_CUDA == 1
+  void Init();
+
+  bool initialized_;
+  // The page-locked buffers, their sizes (in elements), and for each, an
+  // event that is recorded after the last transfer from it.
+  Real *buffers_[2];
+  size_t buffer_sizes_[2];
+  cudaEvent_t events_[2];
+  // The buffer to use next.
+  int32 next_;
+#endif
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CuMatrixUploader);
+};
+
+
+}  // namespace kaldi
+
+#endif  // KALDI_CUDAMATRIX_CU_MATRIX_UPLOADER_H_
@@ -28,7 +28,11 @@
 #include <cublas.h>
 #endif
 
+#include <limits>
+
 #include "util/timer.h"
+#include "matrix/compressed-matrix.h"
+#include "matrix/matrix-allocator.h"
 #include "cudamatrix/cu-common.h"
 #include "cudamatrix/cu-vector.h"
 #include "cudamatrix/cu-device.h"
@@ -91,7 +95,7 @@ void CuMatrix<Real>::Destroy() {
   } else
 #endif
   {
-    if (this->data_ != NULL) KALDI_MEMALIGN_FREE(this->data_);
+    if (this->data_ != NULL) MatrixFree(this->data_);
   }
   this->data_ = NULL;
   this->num_rows_ = 0;
@@ -306,6 +310,41 @@ void CuMatrixBase<Real>::CopyFromMat(const MatrixBase<Real> &src,
   }
 }
 
+template<typename Real>
+void CuMatrixBase<Real>::CopyFromMat(const CompressedMatrix &M) {
+  KALDI_ASSERT(M.NumRows() == num_rows_ && M.NumCols() == num_cols_);
+  if (num_rows_ == 0) return;
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    const CompressedMatrix::GlobalHeader *h =
+        static_cast<const CompressedMatrix::GlobalHeader*>(M.data_);
+    size_t size = CompressedMatrix::DataSize(*h);
+    char *data = static_cast<char*>(CuDevice::Instantiate().Malloc(size));
+    CU_SAFE_CALL(cudaMemcpy(data, M.data_, size, cudaMemcpyHostToDevice));
+    const unsigned short *col_headers = reinterpret_cast<const unsigned short*>(
+        data + sizeof(CompressedMatrix::GlobalHeader));
+    const unsigned char *byte_data = reinterpret_cast<const unsigned char*>(
+        data + sizeof(CompressedMatrix::GlobalHeader) +
+        num_cols_ * sizeof(CompressedMatrix::PerColHeader));
+
+    // Note: the x dimension is rows here, see the kernel.
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    dim3 dimGrid(n_blocks(num_rows_, CU2DBLOCK),
+                 n_blocks(num_cols_, CU2DBLOCK));
+    cuda_uncompress_matrix(dimGrid, dimBlock, data_, Dim(), col_headers,
+                           byte_data, h->min_value, h->range);
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().Free(data);
+    CuDevice::Instantiate().AccuProfile("CuMatrixBase::CopyFromMat(from compressed)",
+                                        tim.Elapsed());
+  } else
+#endif
+  {
+    M.CopyToMat(&Mat());
+  }
+}
+
 template<typename Real>
 template<typename OtherReal>
 void CuMatrixBase<Real>::CopyFromMat(const MatrixBase<OtherReal> &src,
@@ -746,6 +785,90 @@ void CuMatrixBase<Real>::GroupPnormDeriv(const CuMatrixBase<Real> &src1,
   }
 }
 
+template<typename Real>
+void CuMatrixBase<Real>::DiffGroupPnorm(const CuMatrixBase<Real> &in_value,
+                                        const CuMatrixBase<Real> &out_value,
+                                        const CuMatrixBase<Real> &out_deriv,
+                                        Real power) {
+  KALDI_ASSERT(SameDim(*this, in_value) && SameDim(out_value, out_deriv) &&
+               out_value.NumRows() == NumRows() && out_value.NumCols() > 0);
+  int group_size = NumCols() / out_value.NumCols();
+  KALDI_ASSERT(NumCols() == out_value.NumCols() * group_size);
+#if HAVE_CUDA == 1 
+  if (CuDevice::Instantiate().Enabled()) { 
+    Timer tim;
+
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    dim3 dimGrid(n_blocks(NumCols(), CU2DBLOCK), n_blocks(NumRows(), CU2DBLOCK));
+
+    cuda_diff_group_pnorm(dimGrid, dimBlock, data_, in_value.Data(),
+                          out_value.Data(), out_deriv.Data(), Dim(),
+                          in_value.Stride(), out_value.Stride(),
+                          out_deriv.Stride(), group_size, power);
+    CU_SAFE_CALL(cudaGetLastError());
+
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    Mat().DiffGroupPnorm(in_value.Mat(), out_value.Mat(), out_deriv.Mat(),
+                         power);
+  }
+}
+
+template<typename Real>
+void CuMatrixBase<Real>::GroupMax(const CuMatrixBase<Real> &src) {
+  KALDI_ASSERT(src.NumRows() == NumRows() && NumCols() > 0);
+  int group_size = src.NumCols() / NumCols();
+  KALDI_ASSERT(src.NumCols() == NumCols() * group_size && group_size > 0);
+#if HAVE_CUDA == 1 
+  if (CuDevice::Instantiate().Enabled()) { 
+    Timer tim;
+
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    dim3 dimGrid(n_blocks(NumCols(), CU2DBLOCK), n_blocks(NumRows(), CU2DBLOCK));
+
+    cuda_group_max(dimGrid, dimBlock, data_, src.Data(), Dim(), src.Stride(),
+                   group_size);
+    CU_SAFE_CALL(cudaGetLastError());
+
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    Mat().GroupMax(src.Mat());
+  }
+}
+
+template<typename Real>
+void CuMatrixBase<Real>::DiffGroupMax(const CuMatrixBase<Real> &in_value,
+                                      const CuMatrixBase<Real> &out_value,
+                                      const CuMatrixBase<Real> &out_deriv) {
+  KALDI_ASSERT(SameDim(*this, in_value) && SameDim(out_value, out_deriv) &&
+               out_value.NumRows() == NumRows() && out_value.NumCols() > 0);
+  int group_size = NumCols() / out_value.NumCols();
+  KALDI_ASSERT(NumCols() == out_value.NumCols() * group_size);
+#if HAVE_CUDA == 1 
+  if (CuDevice::Instantiate().Enabled()) { 
+    Timer tim;
+
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    dim3 dimGrid(n_blocks(NumCols(), CU2DBLOCK), n_blocks(NumRows(), CU2DBLOCK));
+
+    cuda_diff_group_max(dimGrid, dimBlock, data_, in_value.Data(),
+                        out_value.Data(), out_deriv.Data(), Dim(),
+                        in_value.Stride(), out_value.Stride(),
+                        out_deriv.Stride(), group_size);
+    CU_SAFE_CALL(cudaGetLastError());
+
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    Mat().DiffGroupMax(in_value.Mat(), out_value.Mat(), out_deriv.Mat());
+  }
+}
+
 template<typename Real>
 void CuMatrixBase<Real>::DivRowsVec(const CuVectorBase<Real> &div) {
 #if HAVE_CUDA == 1
@@ -1205,6 +1328,59 @@ void CuMatrixBase<Real>::Tanh(const CuMatrixBase<Real> &src) {
 
 
 
+template<typename Real>
+void CuMatrixBase<Real>::SigmoidWithBias(const CuMatrixBase<Real> &src,
+                                         const CuVectorBase<Real> &bias) {
+  KALDI_ASSERT(SameDim(*this, src) && bias.Dim() == NumCols());
+#if HAVE_CUDA == 1 
+  if (CuDevice::Instantiate().Enabled()) { 
+    Timer tim;
+
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    dim3 dimGrid(n_blocks(src.NumCols(), CU2DBLOCK), n_blocks(src.NumRows(), CU2DBLOCK));
+    
+    cuda_sigmoid_with_bias(dimGrid, dimBlock, this->data_, src.data_,
+                           bias.Data(), this->Dim(), src.Stride());
+    CU_SAFE_CALL(cudaGetLastError());
+    
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    MatrixBase<Real> &mat(this->Mat());
+    mat.CopyFromMat(src.Mat());
+    mat.AddVecToRows(1.0, bias.Vec());
+    mat.Sigmoid(mat);
+  }
+}
+
+template<typename Real>
+void CuMatrixBase<Real>::TanhWithBias(const CuMatrixBase<Real> &src,
+                                      const CuVectorBase<Real> &bias) {
+  KALDI_ASSERT(SameDim(*this, src) && bias.Dim() == NumCols());
+#if HAVE_CUDA == 1 
+  if (CuDevice::Instantiate().Enabled()) { 
+    Timer tim;
+
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    dim3 dimGrid(n_blocks(src.NumCols(), CU2DBLOCK), n_blocks(src.NumRows(), CU2DBLOCK));
+
+    cuda_tanh_with_bias(dimGrid, dimBlock, this->data_, src.data_,
+                        bias.Data(), this->Dim(), src.Stride());
+    CU_SAFE_CALL(cudaGetLastError());
+    
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    MatrixBase<Real> &mat(this->Mat());
+    mat.CopyFromMat(src.Mat());
+    mat.AddVecToRows(1.0, bias.Vec());
+    mat.Tanh(mat);
+  }
+}
+
+
 template<typename Real> // Ein -> diff, Y -> value
 void CuMatrixBase<Real>::DiffTanh(const CuMatrixBase<Real> &value,
                                   const CuMatrixBase<Real> &diff) {
@@ -1317,6 +1493,44 @@ void CuMatrixBase<Real>::DiffXent(const CuArray<int32> &tgt,
 }
 
 
+template<typename Real>
+void CuMatrixBase<Real>::DiffXent(const std::vector<MatrixElement<Real> > &tgt,
+                                  CuVector<Real> *log_post_tgt) {
+  typedef typename std::vector<MatrixElement<Real> >::const_iterator Iter;
+  for (Iter iter = tgt.begin(); iter != tgt.end(); ++iter) {
+    KALDI_ASSERT(iter->row < num_rows_ && iter->row >= 0 &&
+                 iter->column < num_cols_ && iter->column >= 0);
+  }
+  log_post_tgt->Resize(tgt.size());
+  if (tgt.empty()) return;
+
+#if HAVE_CUDA == 1 
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    size_t size = tgt.size() * sizeof(MatrixElement<Real>);
+    void *addr = CuDevice::Instantiate().Malloc(size);
+    CU_SAFE_CALL(cudaMemcpy(addr, &(tgt[0]), size, cudaMemcpyHostToDevice));
+    dim3 dimBlock(CU1DBLOCK);
+    dim3 dimGrid(n_blocks(tgt.size(), CU1DBLOCK));
+    cuda_diff_xent_sparse(dimGrid, dimBlock,
+                          static_cast<MatrixElement<Real>*>(addr), tgt.size(),
+                          data_, log_post_tgt->data_, Dim());
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().Free(addr);
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    Real *log_post_data = log_post_tgt->Vec().Data();
+    for (size_t i = 0; i < tgt.size(); i++) {
+      Real &value = Mat()(tgt[i].row, tgt[i].column);
+      log_post_data[i] = tgt[i].weight * log(std::max(value, Real(1.0e-20)));
+      value -= tgt[i].weight;
+    }
+  }
+}
+
+
 template<typename Real>
 void CuMatrixBase<Real>::Cholesky(CuMatrixBase<Real> *inv_cholesky) {
   KALDI_ASSERT(this->NumRows() == this->NumCols());
@@ -1515,6 +1729,92 @@ double TraceMatMat(const CuMatrixBase<double> &A,
                    const CuMatrixBase<double> &B,
                    MatrixTransposeType trans);
 
+// Products with at most this many multiply-adds each are done by the batched
+// kernel; larger ones are efficient enough as separate cuBLAS calls.
+static const int64 kMaxBatchedKernelOps = 128 * 128 * 128;
+
+template<typename Real>
+void AddMatMatBatched(const Real alpha,
+                      const std::vector<CuMatrixBase<Real>*> &C,
+                      const std::vector<const CuMatrixBase<Real>*> &A,
+                      MatrixTransposeType transA,
+                      const std::vector<const CuMatrixBase<Real>*> &B,
+                      MatrixTransposeType transB,
+                      const Real beta) {
+  int32 size = C.size();
+  KALDI_ASSERT(A.size() == size && B.size() == size);
+  if (size == 0) return;
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    MatrixIndexT num_rows = C[0]->NumRows(), num_cols = C[0]->NumCols(),
+        inner_dim = (transA == kNoTrans ? A[0]->NumCols() : A[0]->NumRows());
+    bool uniform = true;
+    for (int32 i = 1; i < size && uniform; i++)
+      uniform = SameDimAndStride(*(C[i]), *(C[0])) &&
+          SameDimAndStride(*(A[i]), *(A[0])) &&
+          SameDimAndStride(*(B[i]), *(B[0]));
+    if (uniform && num_rows != 0 && num_cols != 0 && size <= 65535 &&
+        static_cast<int64>(num_rows) * num_cols * inner_dim <=
+        kMaxBatchedKernelOps) {
+      KALDI_ASSERT(
+          (transA == kNoTrans ? A[0]->NumRows() : A[0]->NumCols()) == num_rows &&
+          (transB == kNoTrans ? B[0]->NumRows() : B[0]->NumCols()) == inner_dim &&
+          (transB == kNoTrans ? B[0]->NumCols() : B[0]->NumRows()) == num_cols);
+      // The strides of op(A) and op(B): transposition is handled by swapping
+      // the row and column strides, as in CuBlockMatrix::AddMatMat().
+      int32 A_row_stride = A[0]->Stride(), A_col_stride = 1,
+          B_row_stride = B[0]->Stride(), B_col_stride = 1;
+      if (transA == kTrans) std::swap(A_row_stride, A_col_stride);
+      if (transB == kTrans) std::swap(B_row_stride, B_col_stride);
+      // The pointers to the A, B and C matrices, in that order.
+      std::vector<Real*> ptrs(3 * size);
+      for (int32 i = 0; i < size; i++) {
+        ptrs[i] = const_cast<Real*>(A[i]->Data());
+        ptrs[size + i] = const_cast<Real*>(B[i]->Data());
+        ptrs[2 * size + i] = C[i]->Data();
+      }
+      size_t bytes = ptrs.size() * sizeof(Real*);
+      Real **cu_ptrs = static_cast<Real**>(CuDevice::Instantiate().Malloc(bytes));
+      CU_SAFE_CALL(cudaMemcpy(cu_ptrs, &(ptrs[0]), bytes,
+                              cudaMemcpyHostToDevice));
+
+      dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+      dim3 dimGrid(n_blocks(num_cols, CU2DBLOCK), n_blocks(num_rows, CU2DBLOCK),
+                   size);
+      cuda_add_mat_mat_batched(dimGrid, dimBlock, alpha,
+                               cu_ptrs, A_row_stride, A_col_stride,
+                               cu_ptrs + size, B_row_stride, B_col_stride,
+                               beta, cu_ptrs + 2 * size, C[0]->Stride(),
+                               num_rows, num_cols, inner_dim);
+      CU_SAFE_CALL(cudaGetLastError());
+      CuDevice::Instantiate().Free(cu_ptrs);
+      CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+      return;
+    }
+  }
+#endif
+  for (int32 i = 0; i < size; i++)
+    C[i]->AddMatMat(alpha, *(A[i]), transA, *(B[i]), transB, beta);
+}
+
+template
+void AddMatMatBatched(const float alpha,
+                      const std::vector<CuMatrixBase<float>*> &C,
+                      const std::vector<const CuMatrixBase<float>*> &A,
+                      MatrixTransposeType transA,
+                      const std::vector<const CuMatrixBase<float>*> &B,
+                      MatrixTransposeType transB,
+                      const float beta);
+template
+void AddMatMatBatched(const double alpha,
+                      const std::vector<CuMatrixBase<double>*> &C,
+                      const std::vector<const CuMatrixBase<double>*> &A,
+                      MatrixTransposeType transA,
+                      const std::vector<const CuMatrixBase<double>*> &B,
+                      MatrixTransposeType transB,
+                      const double beta);
+
 
 template<typename Real>
 void CuMatrixBase<Real>::CopyRowsFromVec(const CuVectorBase<Real> &v) {
@@ -1857,6 +2157,51 @@ void CuMatrixBase<Real>::SumColumnRanges(const CuMatrixBase<Real> &src,
 
 
 
+template<typename Real>
+void CuMatrixBase<Real>::LogSumExpColumnRanges(
+    const CuMatrixBase<Real> &src, const CuArray<Int32Pair> &indices) {
+  KALDI_ASSERT(static_cast<MatrixIndexT>(indices.Dim()) == NumCols());
+  KALDI_ASSERT(NumRows() == src.NumRows());
+  if (NumRows() == 0) return;
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    // As for SumColumnRanges(), the (x,y) dims are (rows,cols).
+    dim3 dimGrid(n_blocks(NumRows(), CU2DBLOCK), n_blocks(NumCols(), CU2DBLOCK));
+    cuda_log_sum_exp_column_ranges(dimGrid, dimBlock, data_, Dim(), src.Data(),
+                                   src.Dim(), indices.Data());
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    int32 num_rows = this->num_rows_, num_cols = this->num_cols_,
+       this_stride = this->stride_, src_stride = src.stride_;
+    Real *data = this->data_;
+    const Real *src_data = src.data_;
+    const Int32Pair *indices_data = indices.Data();
+    for (int32 row = 0; row < num_rows; row++) {
+      const Real *src_row = src_data + row * src_stride;
+      for (int32 col = 0; col < num_cols; col++) {
+        int32 start_col = indices_data[col].first,
+                end_col = indices_data[col].second;
+        Real max = -std::numeric_limits<Real>::infinity(), sum = 0.0;
+        for (int32 src_col = start_col; src_col < end_col; src_col++)
+          max = std::max(max, src_row[src_col]);
+        if (max == -std::numeric_limits<Real>::infinity()) {
+          data[row * this_stride + col] = max;
+          continue;
+        }
+        for (int32 src_col = start_col; src_col < end_col; src_col++)
+          sum += Exp(src_row[src_col] - max);
+        data[row * this_stride + col] = max + Log(sum);
+      }
+    }
+  }
+}
+
+
 template<typename Real>
 void CuMatrixBase<Real>::CopyLowerToUpper() {
   KALDI_ASSERT(num_cols_ == num_rows_);
@@ -27,6 +27,7 @@
 #define KALDI_CUDAMATRIX_CU_MATRIX_H_
 
 #include <sstream>
+#include <vector>
 
 #include "cudamatrix/cu-matrixdim.h"
 #include "cudamatrix/cu-common.h"
@@ -74,6 +75,8 @@ class CuMatrixBase {
   friend class CuRand<Real>;
   friend class CuSubVector<Real>;
   friend class CuBlockMatrix<Real>;
+  friend class CuLevelledGraph<Real>;
+  friend class CuViterbiDecoder;
   friend void cu::RegularizeL1<Real>(CuMatrixBase<Real> *weight,
                                      CuMatrixBase<Real> *grad, Real l1, Real lr);
   friend void cu::Splice<Real>(const CuMatrix<Real> &src,
@@ -85,6 +88,24 @@ class CuMatrixBase {
   friend void cu::Randomize<Real>(const CuMatrixBase<Real> &src,
                                   const CuArray<int32> &copy_from_idx,
                                   CuMatrixBase<Real> *tgt);
+  friend void cu::MaxPool<Real>(const CuMatrixBase<Real> &in,
+                                const CuArray<int32> &pool_blocks,
+                                int32 block_dim, CuMatrixBase<Real> *out);
+  friend void cu::AveragePool<Real>(const CuMatrixBase<Real> &in,
+                                    const CuArray<int32> &pool_blocks,
+                                    int32 block_dim, CuMatrixBase<Real> *out);
+  friend void cu::MaxPoolBackward<Real>(const CuMatrixBase<Real> &in,
+                                        const CuMatrixBase<Real> &out,
+                                        const CuMatrixBase<Real> &out_diff,
+                                        const CuArray<int32> &out_blocks,
+                                        const CuArray<Int32Pair> &in_ranges,
+                                        const CuVectorBase<Real> &scale,
+                                        int32 block_dim,
+                                        CuMatrixBase<Real> *in_diff);
+  friend void cu::AveragePoolBackward<Real>(
+      const CuMatrixBase<Real> &out_diff, const CuArray<int32> &out_blocks,
+      const CuArray<Int32Pair> &in_ranges, const CuVectorBase<Real> &scale,
+      int32 block_dim, CuMatrixBase<Real> *in_diff);
 
   /// Copies column r from column indices[r] of src.
   /// As a special case, if indexes[i] == -1, sets column i to zero
@@ -114,6 +135,13 @@ class CuMatrixBase {
   void SumColumnRanges(const CuMatrixBase<Real> &src,
                        const CuArray<Int32Pair> &indices);
 
+  /// As SumColumnRanges(), but sets (*this)(r, c) to the log of the sum of
+  /// the exponentials, log \sum_j exp(src(r, j)), computed stably; an empty
+  /// range gives -infinity.  Used e.g. to get the log-likelihoods of GMMs
+  /// from those of their Gaussians.
+  void LogSumExpColumnRanges(const CuMatrixBase<Real> &src,
+                             const CuArray<Int32Pair> &indices);
+
 
   friend Real TraceMatMat<Real>(const CuMatrixBase<Real> &A,
                                 const CuMatrixBase<Real> &B,
@@ -150,6 +178,11 @@ class CuMatrixBase {
 
   void CopyFromMat(const MatrixBase<Real> &src,
                    MatrixTransposeType trans = kNoTrans);
+
+  /// Copies from a compressed matrix.  When using a GPU, the compressed data
+  /// is copied to the device and uncompressed there, so that only about a
+  /// quarter as much data goes over the bus as for an ordinary matrix.
+  void CopyFromMat(const CompressedMatrix &M);
   
   void CopyFromSp(const CuSpMatrix<Real> &M);
   
@@ -193,11 +226,42 @@ class CuMatrixBase {
   /// "output-elem" is whichever element of output depends on that input element.
   void GroupPnormDeriv(const CuMatrixBase<Real> &input,
                        const CuMatrixBase<Real> &output, Real power);
+
+  /// Backpropagates through GroupPnorm() in one pass: "in_value" and
+  /// "out_value" are its input and output and "out_deriv" the derivative
+  /// w.r.t. the output; sets *this (with the dimension of in_value) to the
+  /// derivative w.r.t. the input.  Equivalent to GroupPnormDeriv() followed
+  /// by MulRowsGroupMat(out_deriv).
+  void DiffGroupPnorm(const CuMatrixBase<Real> &in_value,
+                      const CuMatrixBase<Real> &out_value,
+                      const CuMatrixBase<Real> &out_deriv, Real power);
+
+  /// Apply the function y(i) = max_{j = i*G}^{(i+1)*G-1} x_j, where
+  /// G = x.NumCols() / y.NumCols() must be an integer.
+  void GroupMax(const CuMatrixBase<Real> &src);
+
+  /// Backpropagates through GroupMax() in one pass (arguments as for
+  /// DiffGroupPnorm()): the derivative goes to the input elements that equal
+  /// the max of their group; the others get zero.
+  void DiffGroupMax(const CuMatrixBase<Real> &in_value,
+                    const CuMatrixBase<Real> &out_value,
+                    const CuMatrixBase<Real> &out_deriv);
   
   /// Compute the hyperbolic tangent (tanh) function; element by element,
   /// *this = tanh(src).
   void Tanh(const CuMatrixBase<Real> &src);
 
+  /// Does *this = sigmoid(src + bias), with "bias" added to each row; this is
+  /// a single pass over the data, unlike AddVecToRows() followed by Sigmoid().
+  /// "src" may be *this.
+  void SigmoidWithBias(const CuMatrixBase<Real> &src,
+                       const CuVectorBase<Real> &bias);
+
+  /// Does *this = tanh(src + bias), with "bias" added to each row; "src" may
+  /// be *this.
+  void TanhWithBias(const CuMatrixBase<Real> &src,
+                    const CuVectorBase<Real> &bias);
+
   /// Differentiate backward through the sigmoid function.  Here, "value" is the
   /// sigmoid output.  Does, element-by-element, *this = diff * value * (1 - value).
   void DiffSigmoid(const CuMatrixBase<Real> &value,
@@ -220,6 +284,15 @@ class CuMatrixBase {
   void DiffXent(const CuArray<int32> &tgt,
                 CuVector<Real> *log_post_tgt);  
 
+  /// Version of DiffXent() for soft (e.g. posterior) targets, given as the
+  /// list of their non-zero elements { row, column, weight }; this saves
+  /// building the dense target matrix.  For each element i, let
+  /// x(i) = (*this)(row(i), column(i)); it sets
+  /// (*log_post_tgt)(i) = weight(i) * log(x(i)) and subtracts weight(i) from
+  /// x(i), all in one kernel.  No (row, column) pair may be repeated.
+  void DiffXent(const std::vector<MatrixElement<Real> > &tgt,
+                CuVector<Real> *log_post_tgt);
+
   /// This function does sets *this to the Cholesky factor of *this (i.e.  the C
   /// satisfying *this = C C^T), and sets "inv_cholesky" (if supplied) to its
   /// inverse.  *this is treated as a symmetric matrix but only the lower triangle
@@ -620,6 +693,20 @@ bool SameDimAndStride(const CuMatrixBase<Real> &M, const CuMatrixBase<Real> &N)
           && M.Stride() == N.Stride());
 }
 
+/// Does (*C[i]) = alpha op(*A[i]) op(*B[i]) + beta (*C[i]) for each i, e.g.
+/// for the blocks of a block-diagonal matrix.  On the GPU, if the products are
+/// small and all have the same dimensions and strides, they are done in a
+/// single kernel launch; otherwise, one cuBLAS call per product.  The C[i] must
+/// not overlap.
+template<typename Real>
+void AddMatMatBatched(const Real alpha,
+                      const std::vector<CuMatrixBase<Real>*> &C,
+                      const std::vector<const CuMatrixBase<Real>*> &A,
+                      MatrixTransposeType transA,
+                      const std::vector<const CuMatrixBase<Real>*> &B,
+                      MatrixTransposeType transB,
+                      const Real beta);
+
 /// I/O
 template<typename Real>
 std::ostream &operator << (std::ostream &out, const CuMatrixBase<Real> &mat);
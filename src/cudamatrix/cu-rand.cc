@@ -154,24 +154,28 @@ template<typename Real> void CuRand<Real>::BinarizeProbs(const CuMatrix<Real> &p
     // prepare the output matrix
     if (states != &probs)
       states->Resize(probs.num_rows_, probs.num_cols_, kUndefined);
-    // prepare the temporary matrix of uniform random numbers (0,1)
-    tmp_.Resize(probs.num_rows_, probs.num_cols_, kUndefined);
-    RandUniform(&tmp_);
+    KALDI_ASSERT(states->stride_ == probs.stride_);
 
-    // use the uniform random numbers to compute discrete 0/1 states
+    // draw the uniform random numbers and compute the discrete 0/1 states
+    // in one kernel.
     dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
     dim3 dimGrid(n_blocks(states->num_cols_, CU2DBLOCK), n_blocks(states->num_rows_, CU2DBLOCK));
 
-    cuda_binarize_probs(dimGrid, dimBlock, states->data_, probs.data_, tmp_.data_, states->Dim());
+    cuda_binarize_probs_rand(dimGrid, dimBlock, states->data_, probs.data_,
+                             z1_, z2_, z3_, z4_, states->Dim());
     CU_SAFE_CALL(cudaGetLastError());
   
     CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
   } else
 #endif
   {
+    if (states != &probs)
+      states->Resize(probs.num_rows_, probs.num_cols_, kUndefined);
     for(int32 r=0; r<states->num_rows_; r++) {
+      const Real *probs_row = probs.Mat().RowData(r);
+      Real *states_row = states->Mat().RowData(r);
       for(int32 c=0; c<states->num_cols_; c++) {
-        states->Mat()(r, c) = ((kaldi::RandUniform() < probs.Mat()(r, c))? 1 : 0 );
+        states_row[c] = ((cpu_rand_.RandUniform() < probs_row[c])? 1 : 0 );
       }
     }
   }
@@ -180,9 +184,31 @@ template<typename Real> void CuRand<Real>::BinarizeProbs(const CuMatrix<Real> &p
 
 
 template<typename Real> void CuRand<Real>::AddGaussNoise(CuMatrix<Real> *tgt, Real gscale) {
-  tmp_.Resize(tgt->num_rows_, tgt->num_cols_);
-  RandGaussian(&tmp_);
-  tgt->AddMat(gscale, tmp_);
+#if HAVE_CUDA == 1 
+  if (CuDevice::Instantiate().Enabled()) { 
+    Timer tim;
+    int32 tgt_size = tgt->NumRows() * tgt->Stride();
+    if (tgt_size == 0)
+      return;
+    if (tgt_size > state_size_) SeedGpu(tgt_size);
+
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    dim3 dimGrid(n_blocks(tgt->num_cols_, CU2DBLOCK), n_blocks(tgt->num_rows_, CU2DBLOCK));
+
+    cuda_add_gauss_noise(dimGrid, dimBlock, tgt->data_, gscale,
+                         z1_, z2_, z3_, z4_, tgt->Dim());
+    CU_SAFE_CALL(cudaGetLastError());
+
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    Vector<Real> noise(tgt->num_cols_, kUndefined);
+    for (int32 r = 0; r < tgt->num_rows_; r++) {
+      cpu_rand_.RandGauss(noise.Data(), noise.Dim());
+      tgt->Mat().Row(r).AddVec(gscale, noise);
+    }
+  }
 }
 
 // Instantiate the class for float and double.
@@ -33,7 +33,8 @@ template<typename Real>
 class CuRand {
  public:
 
-  CuRand(): z1_(NULL), z2_(NULL), z3_(NULL), z4_(NULL), state_size_(0) { }
+  CuRand(): z1_(NULL), z2_(NULL), z3_(NULL), z4_(NULL), state_size_(0),
+            cpu_rand_(rand()) { }
 
   ~CuRand();
   
@@ -46,9 +47,10 @@ class CuRand {
   void RandGaussian(CuMatrixBase<Real> *tgt);
   void RandGaussian(CuVectorBase<Real> *tgt);
 
-  /// align probabilities to discrete 0/1 states (use uniform samplig)
+  /// align probabilities to discrete 0/1 states (use uniform samplig);
+  /// on the GPU the sampling and the comparison are done in one kernel.
   void BinarizeProbs(const CuMatrix<Real> &probs, CuMatrix<Real> *states);
-  /// add gaussian noise to each element
+  /// add gaussian noise to each element (in one kernel on the GPU)
   void AddGaussNoise(CuMatrix<Real> *tgt, Real gscale = 1.0);
 
  private:
@@ -71,6 +73,9 @@ class CuRand {
   int32 state_size_; ///< size of the buffers
   
   CuMatrix<Real> tmp_; ///< auxiliary matrix
+
+  RandomGenerator cpu_rand_; ///< used when not running on the GPU;
+                            ///< seeded from rand(), so srand() controls it
 };
 
 
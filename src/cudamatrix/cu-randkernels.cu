@@ -135,6 +135,34 @@ static void _binarize_probs(Real* states, const Real* probs, const Real* rand, M
 }
 
 
+// As _binarize_probs, but draws the uniform random numbers itself rather
+// than reading them from a matrix filled by _rand.
+template<typename Real>
+__global__
+static void _binarize_probs_rand(Real* states, const Real* probs, uint32_cuda* z1, uint32_cuda* z2, uint32_cuda* z3, uint32_cuda* z4, MatrixDim d) {
+  int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x;
+  int32_cuda j = blockIdx.y * blockDim.y + threadIdx.y;
+  int32_cuda index = i + j*d.stride;
+  if( i < d.cols  && j < d.rows ) {
+    Real r = HybridTaus<Real>(z1[index],z2[index],z3[index],z4[index]);
+    states[index] = ((probs[index] > r)? 1.0 : 0.0);
+  }
+}
+
+
+
+template<typename Real>
+__global__
+static void _add_gauss_noise(Real* mat, Real gscale, uint32_cuda* z1, uint32_cuda* z2, uint32_cuda* z3, uint32_cuda* z4, MatrixDim d) {
+  int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x;
+  int32_cuda j = blockIdx.y * blockDim.y + threadIdx.y;
+  int32_cuda index = i + j*d.stride;
+  if( i < d.cols  && j < d.rows ) {
+    mat[index] += gscale * BoxMuller<Real>(z1[index],z2[index],z3[index],z4[index]);
+  }
+}
+
+
 
 /***********************************************************************
  * ANSI-C wrappers of CUDA kernels
@@ -159,6 +187,14 @@ void cudaF_binarize_probs(dim3 Gr, dim3 Bl, float* states, const float* probs, f
   _binarize_probs<<<Gr,Bl>>>(states,probs,rand,d); 
 }
 
+void cudaF_binarize_probs_rand(dim3 Gr, dim3 Bl, float* states, const float* probs, uint32_cuda* z1, uint32_cuda* z2, uint32_cuda* z3, uint32_cuda* z4, MatrixDim d) { 
+  _binarize_probs_rand<<<Gr,Bl>>>(states,probs,z1,z2,z3,z4,d); 
+}
+
+void cudaF_add_gauss_noise(dim3 Gr, dim3 Bl, float* mat, float gscale, uint32_cuda* z1, uint32_cuda* z2, uint32_cuda* z3, uint32_cuda* z4, MatrixDim d) { 
+  _add_gauss_noise<<<Gr,Bl>>>(mat,gscale,z1,z2,z3,z4,d); 
+}
+
 
 
 /*
@@ -180,5 +216,13 @@ void cudaD_binarize_probs(dim3 Gr, dim3 Bl, double* states, const double* probs,
   _binarize_probs<<<Gr,Bl>>>(states,probs,rand,d); 
 }
 
+void cudaD_binarize_probs_rand(dim3 Gr, dim3 Bl, double* states, const double* probs, uint32_cuda* z1, uint32_cuda* z2, uint32_cuda* z3, uint32_cuda* z4, MatrixDim d) { 
+  _binarize_probs_rand<<<Gr,Bl>>>(states,probs,z1,z2,z3,z4,d); 
+}
+
+void cudaD_add_gauss_noise(dim3 Gr, dim3 Bl, double* mat, double gscale, uint32_cuda* z1, uint32_cuda* z2, uint32_cuda* z3, uint32_cuda* z4, MatrixDim d) { 
+  _add_gauss_noise<<<Gr,Bl>>>(mat,gscale,z1,z2,z3,z4,d); 
+}
+
 
 
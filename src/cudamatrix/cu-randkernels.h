@@ -40,6 +40,8 @@ template<typename Real> inline void cuda_rand(dim3 Gr, dim3 Bl, Real *mat, uint3
 template<typename Real> inline void cuda_gauss_rand(dim3 Gr, dim3 Bl, Real *mat, uint32_cuda *z1, uint32_cuda *z2, uint32_cuda *z3, uint32_cuda *z4, MatrixDim d) { KALDI_ERR << __func__ << " Not implemented!"; }
 template<typename Real> inline void cuda_vec_gauss_rand(int Gr, int Bl, Real *v, uint32_cuda *z1, uint32_cuda *z2, uint32_cuda *z3, uint32_cuda *z4, int dim) { KALDI_ERR << __func__ << " Not implemented!"; }
 template<typename Real> inline void cuda_binarize_probs(dim3 Gr, dim3 Bl, Real *states, const Real *probs, Real *rand, MatrixDim d) { KALDI_ERR << __func__ << " Not implemented!"; }
+template<typename Real> inline void cuda_binarize_probs_rand(dim3 Gr, dim3 Bl, Real *states, const Real *probs, uint32_cuda *z1, uint32_cuda *z2, uint32_cuda *z3, uint32_cuda *z4, MatrixDim d) { KALDI_ERR << __func__ << " Not implemented!"; }
+template<typename Real> inline void cuda_add_gauss_noise(dim3 Gr, dim3 Bl, Real *mat, Real gscale, uint32_cuda *z1, uint32_cuda *z2, uint32_cuda *z3, uint32_cuda *z4, MatrixDim d) { KALDI_ERR << __func__ << " Not implemented!"; }
 
 /*********************************************************
  * float specializations
@@ -48,6 +50,8 @@ template<> inline void cuda_rand<float>(dim3 Gr, dim3 Bl, float *mat, uint32_cud
 template<> inline void cuda_gauss_rand<float>(dim3 Gr, dim3 Bl, float *mat, uint32_cuda *z1, uint32_cuda *z2, uint32_cuda *z3, uint32_cuda *z4, MatrixDim d) { cudaF_gauss_rand(Gr,Bl,mat,z1,z2,z3,z4,d); } 
 template<> inline void cuda_vec_gauss_rand<float>(int Gr, int Bl, float *v, uint32_cuda *z1, uint32_cuda *z2, uint32_cuda *z3, uint32_cuda *z4, int dim) { cudaF_vec_gauss_rand(Gr,Bl,v,z1,z2,z3,z4,dim); } 
 template<> inline void cuda_binarize_probs<float>(dim3 Gr, dim3 Bl, float *states, const float *probs, float *rand, MatrixDim d) { cudaF_binarize_probs(Gr,Bl,states,probs,rand,d); } 
+template<> inline void cuda_binarize_probs_rand<float>(dim3 Gr, dim3 Bl, float *states, const float *probs, uint32_cuda *z1, uint32_cuda *z2, uint32_cuda *z3, uint32_cuda *z4, MatrixDim d) { cudaF_binarize_probs_rand(Gr,Bl,states,probs,z1,z2,z3,z4,d); } 
+template<> inline void cuda_add_gauss_noise<float>(dim3 Gr, dim3 Bl, float *mat, float gscale, uint32_cuda *z1, uint32_cuda *z2, uint32_cuda *z3, uint32_cuda *z4, MatrixDim d) { cudaF_add_gauss_noise(Gr,Bl,mat,gscale,z1,z2,z3,z4,d); } 
 
 /*********************************************************
  * double specializations
@@ -56,6 +60,8 @@ template<> inline void cuda_rand<double>(dim3 Gr, dim3 Bl, double *mat, uint32_c
 template<> inline void cuda_gauss_rand<double>(dim3 Gr, dim3 Bl, double *mat, uint32_cuda *z1, uint32_cuda *z2, uint32_cuda *z3, uint32_cuda *z4, MatrixDim d) { cudaD_gauss_rand(Gr,Bl,mat,z1,z2,z3,z4,d); } 
 template<> inline void cuda_vec_gauss_rand<double>(int Gr, int Bl, double *v, uint32_cuda *z1, uint32_cuda *z2, uint32_cuda *z3, uint32_cuda *z4, int dim) { cudaD_vec_gauss_rand(Gr,Bl,v,z1,z2,z3,z4,dim); } 
 template<> inline void cuda_binarize_probs<double>(dim3 Gr, dim3 Bl, double *states, const double *probs, double *rand, MatrixDim d) { cudaD_binarize_probs(Gr,Bl,states,probs,rand,d); } 
+template<> inline void cuda_binarize_probs_rand<double>(dim3 Gr, dim3 Bl, double *states, const double *probs, uint32_cuda *z1, uint32_cuda *z2, uint32_cuda *z3, uint32_cuda *z4, MatrixDim d) { cudaD_binarize_probs_rand(Gr,Bl,states,probs,z1,z2,z3,z4,d); } 
+template<> inline void cuda_add_gauss_noise<double>(dim3 Gr, dim3 Bl, double *mat, double gscale, uint32_cuda *z1, uint32_cuda *z2, uint32_cuda *z3, uint32_cuda *z4, MatrixDim d) { cudaD_add_gauss_noise(Gr,Bl,mat,gscale,z1,z2,z3,z4,d); } 
 
 } // namespace
 
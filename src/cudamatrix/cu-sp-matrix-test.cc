@@ -30,6 +30,7 @@
 #include "base/kaldi-common.h"
 #include "cudamatrix/cu-device.h"
 #include "cudamatrix/cu-sp-matrix.h"
+#include "cudamatrix/cu-tp-matrix.h"
 #include "cudamatrix/cu-vector.h"
 #include "cudamatrix/cu-math.h"
 
@@ -178,6 +179,54 @@ static void UnitTestCuSpMatrixInvert() {
   }
 }
 
+template<typename Real>
+static void UnitTestCuSpMatrixBatch() {
+  int32 num_mats = 1 + rand() % 20;
+  std::vector<CuSpMatrix<Real>*> A(num_mats);
+  std::vector<SpMatrix<Real> > B(num_mats);
+  std::vector<CuTpMatrix<Real>*> L(num_mats);
+  std::vector<CuVector<Real>*> x(num_mats);
+  for (int32 i = 0; i < num_mats; i++) {
+    MatrixIndexT dim = 1 + rand() % 10;
+    CuMatrix<Real> M(dim, dim);
+    M.SetRandn();
+    A[i] = new CuSpMatrix<Real>(dim);
+    A[i]->AddMat2(1.0, M, kNoTrans, 0.0);
+    A[i]->AddToDiag(1.0);
+    B[i].Resize(dim);
+    A[i]->CopyToSp(&(B[i]));
+    L[i] = new CuTpMatrix<Real>(dim);
+    x[i] = new CuVector<Real>(dim);
+    x[i]->SetRandn();
+  }
+  std::vector<const CuSpMatrix<Real>*> A_const(A.begin(), A.end());
+  CuCholeskyBatch(A_const, L);
+  std::vector<CuVector<Real> > b(num_mats);
+  for (int32 i = 0; i < num_mats; i++)
+    b[i] = *(x[i]);
+  std::vector<CuVectorBase<Real>*> x_base(x.begin(), x.end());
+  CuSolvePosDefBatch(A_const, x_base);
+  for (int32 i = 0; i < num_mats; i++) {
+    TpMatrix<Real> chol(B[i].NumRows());
+    chol.Cholesky(B[i]);
+    TpMatrix<Real> chol2(*(L[i]));
+    Matrix<Real> chol_mat(chol), chol2_mat(chol2);
+    AssertEqual(chol_mat, chol2_mat);
+    CuVector<Real> Ax(b[i].Dim());
+    Ax.AddSpVec(1.0, *(A[i]), *(x[i]), 0.0);
+    AssertEqual(Ax, b[i]);
+  }
+  CuInvertPosDefBatch(A);
+  for (int32 i = 0; i < num_mats; i++) {
+    B[i].Invert();
+    SpMatrix<Real> inv(*(A[i]));
+    AssertEqual(inv, B[i]);
+    delete A[i];
+    delete L[i];
+    delete x[i];
+  }
+}
+
 // TODO (variani) : fails for dim = 0 
 template<typename Real>
 static void UnitTestCuSpMatrixAddVec2() {
@@ -345,6 +394,7 @@ template<typename Real> void CudaSpMatrixUnitTest() {
   UnitTestCuSpMatrixOperator<Real>();
   UnitTestCuSpMatrixApproxEqual<Real>();
   UnitTestCuSpMatrixInvert<Real>();
+  UnitTestCuSpMatrixBatch<Real>();
   UnitTestCuSpMatrixCopyFromMat<Real>();
   UnitTestCuSpMatrixAddVec2<Real>();
   UnitTestCuSpMatrixAddMat2<Real>();
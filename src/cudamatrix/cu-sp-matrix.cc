@@ -2,6 +2,7 @@
 #include <cuda_runtime_api.h>
 #include <cublas.h>
 #endif
+#include <map>
 
 #include "util/timer.h"
 #include "cudamatrix/cu-common.h"
@@ -10,8 +11,10 @@
 #include "cudamatrix/cu-kernels.h"
 #include "cudamatrix/cu-math.h"
 #include "cudamatrix/cu-sp-matrix.h"
+#include "cudamatrix/cu-tp-matrix.h"
 #include "cudamatrix/cu-matrix.h"
 #include "cudamatrix/cublas-wrappers.h"
+#include "matrix/sp-matrix-batch.h"
 
 namespace kaldi {
 
@@ -201,6 +204,182 @@ bool CuSpMatrix<Real>::IsUnit(Real tol) const {
 }
 
 
+#if HAVE_CUDA == 1
+// Puts the indexes of the nonempty matrices into groups of the same
+// dimension, for the batched functions below.
+static void GroupIndexesByDim(
+    const std::vector<MatrixIndexT> &dims,
+    std::map<MatrixIndexT, std::vector<int32> > *groups) {
+  for (size_t i = 0; i < dims.size(); i++)
+    if (dims[i] > 0) (*groups)[dims[i]].push_back(i);
+}
+
+static void CheckBatchFailed(const CuArray<int32> &cu_failed,
+                             const std::vector<int32> &indexes,
+                             const char *func) {
+  std::vector<int32> failed;
+  cu_failed.CopyToVec(&failed);
+  for (size_t i = 0; i < failed.size(); i++)
+    if (failed[i])
+      KALDI_ERR << func << ": matrix " << indexes[i] << " of the batch is "
+                << "not positive definite.";
+}
+#endif
+
+template<typename Real>
+void CuCholeskyBatch(const std::vector<const CuSpMatrix<Real>*> &A,
+                     const std::vector<CuTpMatrix<Real>*> &L) {
+  KALDI_ASSERT(A.size() == L.size());
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    std::vector<MatrixIndexT> dims(A.size());
+    for (size_t i = 0; i < A.size(); i++) {
+      dims[i] = A[i]->NumRows();
+      KALDI_ASSERT(L[i]->NumRows() == dims[i]);
+      L[i]->CopyFromPacked(*A[i]);  // Same packed layout.
+    }
+    std::map<MatrixIndexT, std::vector<int32> > groups;
+    GroupIndexesByDim(dims, &groups);
+    for (typename std::map<MatrixIndexT, std::vector<int32> >::const_iterator
+             iter = groups.begin(); iter != groups.end(); ++iter) {
+      const std::vector<int32> &indexes = iter->second;
+      std::vector<Real*> data(indexes.size());
+      for (size_t i = 0; i < indexes.size(); i++)
+        data[i] = L[indexes[i]]->Data();
+      CuArray<Real*> cu_data(data);
+      CuArray<int32> cu_failed(indexes.size());
+      int dimBlock(CU1DBLOCK);
+      int dimGrid(n_blocks(indexes.size(), CU1DBLOCK));
+      cuda_cholesky_packed_batch(dimGrid, dimBlock, cu_data.Data(),
+                                 iter->first, indexes.size(),
+                                 cu_failed.Data());
+      CU_SAFE_CALL(cudaGetLastError());
+      CheckBatchFailed(cu_failed, indexes, "CuCholeskyBatch");
+    }
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    std::vector<const SpMatrix<Real>*> mats(A.size());
+    std::vector<TpMatrix<Real>*> chol(L.size());
+    for (size_t i = 0; i < A.size(); i++) {
+      mats[i] = &(A[i]->Mat());
+      chol[i] = &(L[i]->Mat());
+    }
+    CholeskyBatch(mats, chol);
+  }
+}
+
+template<typename Real>
+void CuInvertPosDefBatch(const std::vector<CuSpMatrix<Real>*> &A) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    std::vector<MatrixIndexT> dims(A.size());
+    for (size_t i = 0; i < A.size(); i++)
+      dims[i] = A[i]->NumRows();
+    std::map<MatrixIndexT, std::vector<int32> > groups;
+    GroupIndexesByDim(dims, &groups);
+    for (typename std::map<MatrixIndexT, std::vector<int32> >::const_iterator
+             iter = groups.begin(); iter != groups.end(); ++iter) {
+      const std::vector<int32> &indexes = iter->second;
+      std::vector<Real*> data(indexes.size());
+      for (size_t i = 0; i < indexes.size(); i++)
+        data[i] = A[indexes[i]]->Data();
+      CuArray<Real*> cu_data(data);
+      CuArray<int32> cu_failed(indexes.size());
+      int dimBlock(CU1DBLOCK);
+      int dimGrid(n_blocks(indexes.size(), CU1DBLOCK));
+      cuda_invert_pos_def_packed_batch(dimGrid, dimBlock, cu_data.Data(),
+                                       iter->first, indexes.size(),
+                                       cu_failed.Data());
+      CU_SAFE_CALL(cudaGetLastError());
+      CheckBatchFailed(cu_failed, indexes, "CuInvertPosDefBatch");
+    }
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    std::vector<SpMatrix<Real>*> mats(A.size());
+    for (size_t i = 0; i < A.size(); i++)
+      mats[i] = &(A[i]->Mat());
+    InvertPosDefBatch(mats);
+  }
+}
+
+template<typename Real>
+void CuSolvePosDefBatch(const std::vector<const CuSpMatrix<Real>*> &A,
+                        const std::vector<CuVectorBase<Real>*> &x) {
+  KALDI_ASSERT(A.size() == x.size());
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    std::vector<MatrixIndexT> dims(A.size());
+    for (size_t i = 0; i < A.size(); i++) {
+      dims[i] = A[i]->NumRows();
+      KALDI_ASSERT(x[i]->Dim() == dims[i]);
+    }
+    std::map<MatrixIndexT, std::vector<int32> > groups;
+    GroupIndexesByDim(dims, &groups);
+    for (typename std::map<MatrixIndexT, std::vector<int32> >::const_iterator
+             iter = groups.begin(); iter != groups.end(); ++iter) {
+      const std::vector<int32> &indexes = iter->second;
+      MatrixIndexT dim = iter->first, size = (dim * (dim + 1)) / 2;
+      // The Cholesky factors go in one buffer, so A is not changed.
+      CuVector<Real> chol(size * indexes.size(), kUndefined);
+      std::vector<Real*> chol_data(indexes.size()), vec_data(indexes.size());
+      for (size_t i = 0; i < indexes.size(); i++) {
+        chol_data[i] = chol.Data() + i * size;
+        vec_data[i] = x[indexes[i]]->Data();
+        CU_SAFE_CALL(cudaMemcpy(chol_data[i], A[indexes[i]]->Data(),
+                                size * sizeof(Real), cudaMemcpyDeviceToDevice));
+      }
+      CuArray<Real*> cu_chol_data(chol_data), cu_vec_data(vec_data);
+      CuArray<int32> cu_failed(indexes.size());
+      int dimBlock(CU1DBLOCK);
+      int dimGrid(n_blocks(indexes.size(), CU1DBLOCK));
+      cuda_cholesky_packed_batch(dimGrid, dimBlock, cu_chol_data.Data(), dim,
+                                 indexes.size(), cu_failed.Data());
+      CU_SAFE_CALL(cudaGetLastError());
+      CheckBatchFailed(cu_failed, indexes, "CuSolvePosDefBatch");
+      cuda_solve_cholesky_packed_batch(dimGrid, dimBlock, cu_chol_data.Data(),
+                                       cu_vec_data.Data(), dim,
+                                       indexes.size());
+      CU_SAFE_CALL(cudaGetLastError());
+    }
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    std::vector<const SpMatrix<Real>*> mats(A.size());
+    std::vector<VectorBase<Real>*> vecs(x.size());
+    for (size_t i = 0; i < A.size(); i++) {
+      mats[i] = &(A[i]->Mat());
+      vecs[i] = &(x[i]->Vec());
+    }
+    SolvePosDefBatch(mats, vecs);
+  }
+}
+
+template
+void CuCholeskyBatch(const std::vector<const CuSpMatrix<float>*> &A,
+                     const std::vector<CuTpMatrix<float>*> &L);
+template
+void CuCholeskyBatch(const std::vector<const CuSpMatrix<double>*> &A,
+                     const std::vector<CuTpMatrix<double>*> &L);
+template
+void CuInvertPosDefBatch(const std::vector<CuSpMatrix<float>*> &A);
+template
+void CuInvertPosDefBatch(const std::vector<CuSpMatrix<double>*> &A);
+template
+void CuSolvePosDefBatch(const std::vector<const CuSpMatrix<float>*> &A,
+                        const std::vector<CuVectorBase<float>*> &x);
+template
+void CuSolvePosDefBatch(const std::vector<const CuSpMatrix<double>*> &A,
+                        const std::vector<CuVectorBase<double>*> &x);
+
+
 template class CuSpMatrix<float>;
 template class CuSpMatrix<double>;
 
@@ -2,6 +2,7 @@
 #define KALDI_CUDAMATRIX_CU_SP_MATRIX_H_
 
 #include <sstream>
+#include <vector>
 
 #include "cudamatrix/cu-common.h"
 #include "matrix/matrix-common.h"
@@ -17,6 +18,25 @@ namespace kaldi {
 template<typename Real, typename OtherReal>
 Real TraceSpSp(const CuSpMatrix<Real> &A, const CuSpMatrix<OtherReal> &B);
 
+/// Batched versions of CuTpMatrix::Cholesky() and CuSpMatrix::Invert(), and a
+/// linear solver, for many small positive definite matrices (see
+/// matrix/sp-matrix-batch.h, which these call when not using the GPU).  On the
+/// GPU, the matrices of each dimension are processed by one kernel with a
+/// thread per matrix.  They call KALDI_ERR if a matrix is not positive
+/// definite.
+template<typename Real>
+void CuCholeskyBatch(const std::vector<const CuSpMatrix<Real>*> &A,
+                     const std::vector<CuTpMatrix<Real>*> &L);
+
+/// Inverts each of the positive definite matrices in place.
+template<typename Real>
+void CuInvertPosDefBatch(const std::vector<CuSpMatrix<Real>*> &A);
+
+/// Solves A[i] x = b[i]: on input *x[i] is b[i], on output the solution.
+template<typename Real>
+void CuSolvePosDefBatch(const std::vector<const CuSpMatrix<Real>*> &A,
+                        const std::vector<CuVectorBase<Real>*> &x);
+
 template<typename Real>
 class CuSpMatrix : public CuPackedMatrix<Real> {
   friend class CuMatrixBase<Real>;
@@ -27,6 +47,14 @@ class CuSpMatrix : public CuPackedMatrix<Real> {
 
   template<class R, class S>
   friend R TraceSpSp(const CuSpMatrix<R> &A, const CuSpMatrix<S> &B);
+  template<class R>
+  friend void CuCholeskyBatch(const std::vector<const CuSpMatrix<R>*> &A,
+                              const std::vector<CuTpMatrix<R>*> &L);
+  template<class R>
+  friend void CuInvertPosDefBatch(const std::vector<CuSpMatrix<R>*> &A);
+  template<class R>
+  friend void CuSolvePosDefBatch(const std::vector<const CuSpMatrix<R>*> &A,
+                                 const std::vector<CuVectorBase<R>*> &x);
  public:
   
   CuSpMatrix(): CuPackedMatrix<Real>() {}
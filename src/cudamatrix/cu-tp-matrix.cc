@@ -89,6 +89,15 @@ void CuTpMatrix<Real>::CopyFromMat(const CuMatrixBase<Real> &M,
   }
 }
 
+template<typename Real>
+CuTpMatrix<Real> &CuTpMatrix<Real>::operator = (const CuTpMatrix<Real> &in) {
+  if (this != &in) {
+    this->Resize(in.NumRows(), kUndefined);
+    this->CopyFromPacked(in);
+  }
+  return *this;
+}
+
 template<class Real>
 TpMatrix<Real>::TpMatrix(const CuTpMatrix<Real> &cu) {
   this->Resize(cu.NumRows());
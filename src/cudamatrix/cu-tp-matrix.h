@@ -42,6 +42,9 @@ class CuTpMatrix : public CuPackedMatrix<Real> {
   friend class CuRand<Real>;
   friend class CuTpMatrix<float>;
   friend class CuTpMatrix<double>;
+  template<class R>
+  friend void CuCholeskyBatch(const std::vector<const CuSpMatrix<R>*> &A,
+                              const std::vector<CuTpMatrix<R>*> &L);
  public:
   CuTpMatrix() : CuPackedMatrix<Real>() {}
   explicit CuTpMatrix(MatrixIndexT r, MatrixResizeType resize_type = kSetZero)
@@ -56,6 +59,9 @@ class CuTpMatrix : public CuPackedMatrix<Real> {
   
   ~CuTpMatrix() {}
 
+  /// Deep copy; without this the implicit operator= would copy the pointer.
+  CuTpMatrix<Real> &operator = (const CuTpMatrix<Real> &in);
+
   void CopyFromMat(const CuMatrixBase<Real> &M,
                    MatrixTransposeType Trans = kNoTrans);
 
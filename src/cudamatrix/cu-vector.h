@@ -61,6 +61,21 @@ class CuVectorBase {
                                const CuArray<int32> &frame_offsets,
                                CuMatrix<Real> *tgt);
   friend class CuRand<Real>;
+  friend void cu::MaxPoolBackward<Real>(const CuMatrixBase<Real> &in,
+                                        const CuMatrixBase<Real> &out,
+                                        const CuMatrixBase<Real> &out_diff,
+                                        const CuArray<int32> &out_blocks,
+                                        const CuArray<Int32Pair> &in_ranges,
+                                        const CuVectorBase<Real> &scale,
+                                        int32 block_dim,
+                                        CuMatrixBase<Real> *in_diff);
+  friend void cu::AveragePoolBackward<Real>(
+      const CuMatrixBase<Real> &out_diff, const CuArray<int32> &out_blocks,
+      const CuArray<Int32Pair> &in_ranges, const CuVectorBase<Real> &scale,
+      int32 block_dim, CuMatrixBase<Real> *in_diff);
+  template<class R>
+  friend void CuSolvePosDefBatch(const std::vector<const CuSpMatrix<R>*> &A,
+                                 const std::vector<CuVectorBase<R>*> &x);
   
   /// Dimensions
   MatrixIndexT Dim() const { return dim_;  }   
@@ -0,0 +1,215 @@
+// cudamatrix/cu-viterbi-decoder-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "cudamatrix/cu-viterbi-decoder.h"
+#include "cudamatrix/cu-device.h"
+
+namespace kaldi {
+
+// Makes a random graph with emitting arcs anywhere and non-emitting arcs only
+// to higher-numbered states (so there are no epsilon cycles).
+static void GetRandomGraph(int32 num_cols, int32 *num_states,
+                           std::vector<CuDecodeGraph::Arc> *arcs,
+                           std::vector<BaseFloat> *final_costs) {
+  *num_states = 1 + rand() % 20;
+  arcs->clear();
+  final_costs->resize(*num_states);
+  for (int32 s = 0; s < *num_states; s++)
+    (*final_costs)[s] = (rand() % 3 == 0 ? RandUniform() :
+                         std::numeric_limits<BaseFloat>::infinity());
+  for (int32 s = 0; s < *num_states; s++) {
+    int32 num_out = rand() % 4;
+    for (int32 i = 0; i < num_out; i++) {
+      CuDecodeGraph::Arc arc;
+      arc.src = s;
+      arc.cost = RandUniform();
+      arc.olabel = rand() % 5;
+      if (rand() % 4 != 0 || s + 1 == *num_states) {
+        arc.dest = rand() % *num_states;
+        arc.col = rand() % num_cols;
+        arc.ilabel = arc.col + 1;
+      } else {
+        arc.dest = s + 1 + rand() % (*num_states - s - 1);
+        arc.col = -1;
+        arc.ilabel = 0;
+      }
+      arcs->push_back(arc);
+    }
+  }
+}
+
+// Exact Viterbi (no pruning).  Returns the best cost, preferring paths that end
+// in a final state, as CuViterbiDecoder does.
+static BaseFloat ReferenceViterbi(int32 num_states, int32 start,
+                                  const std::vector<CuDecodeGraph::Arc> &arcs,
+                                  const std::vector<BaseFloat> &final_costs,
+                                  const Matrix<BaseFloat> &loglikes,
+                                  bool *reached_final) {
+  BaseFloat inf = std::numeric_limits<BaseFloat>::infinity();
+  std::vector<BaseFloat> cur(num_states, inf), next(num_states);
+  cur[start] = 0.0;
+  for (int32 t = 0; t <= loglikes.NumRows(); t++) {
+    // Non-emitting arcs go to higher-numbered states, so one pass in order of
+    // source state is enough.
+    for (int32 s = 0; s < num_states; s++)
+      for (size_t a = 0; a < arcs.size(); a++)
+        if (arcs[a].src == s && arcs[a].col < 0)
+          cur[arcs[a].dest] = std::min(cur[arcs[a].dest],
+                                       cur[s] + arcs[a].cost);
+    if (t == loglikes.NumRows()) break;
+    std::fill(next.begin(), next.end(), inf);
+    for (size_t a = 0; a < arcs.size(); a++)
+      if (arcs[a].col >= 0)
+        next[arcs[a].dest] = std::min(next[arcs[a].dest],
+                                      cur[arcs[a].src] + arcs[a].cost -
+                                      loglikes(t, arcs[a].col));
+    cur.swap(next);
+  }
+  BaseFloat best = inf, best_final = inf;
+  for (int32 s = 0; s < num_states; s++) {
+    best = std::min(best, cur[s]);
+    best_final = std::min(best_final, cur[s] + final_costs[s]);
+  }
+  *reached_final = (best_final != inf);
+  return (*reached_final ? best_final : best);
+}
+
+// Checks that "path" is a path from the start state that consumes all the
+// frames, and that its cost is "cost".
+static void CheckPath(const CuDecodeGraph &graph,
+                      const std::vector<CuDecodeGraph::Arc> &path,
+                      const Matrix<BaseFloat> &loglikes,
+                      bool reached_final, BaseFloat cost) {
+  int32 state = graph.Start(), t = 0;
+  double path_cost = 0.0;
+  for (size_t i = 0; i < path.size(); i++) {
+    KALDI_ASSERT(path[i].src == state);
+    path_cost += path[i].cost;
+    if (path[i].col >= 0) {
+      KALDI_ASSERT(t < loglikes.NumRows());
+      path_cost -= loglikes(t, path[i].col);
+      t++;
+    }
+    state = path[i].dest;
+  }
+  KALDI_ASSERT(t == loglikes.NumRows());
+  if (reached_final)
+    path_cost += graph.FinalCost(state);
+  KALDI_ASSERT(fabs(path_cost - cost) < 0.001 * (1.0 + fabs(cost)));
+}
+
+static void UnitTestCuViterbiDecoder() {
+  for (int32 i = 0; i < 40; i++) {
+    int32 num_states, num_cols = 1 + rand() % 4;
+    std::vector<CuDecodeGraph::Arc> arcs;
+    std::vector<BaseFloat> final_costs;
+    GetRandomGraph(num_cols, &num_states, &arcs, &final_costs);
+    int32 start = rand() % num_states;
+    CuDecodeGraph graph(num_states, start, arcs, final_costs);
+    KALDI_ASSERT(graph.NumStates() == num_states &&
+                 graph.NumArcs() == arcs.size());
+
+    CuViterbiDecoderOptions opts;
+    opts.beam = 1.0e+10;  // so the search is exact.
+    CuViterbiDecoder decoder(graph, opts);
+
+    int32 num_utts = 1 + rand() % 3;
+    std::vector<Matrix<BaseFloat> > loglikes(num_utts);
+    std::vector<CuMatrix<BaseFloat> > cu_loglikes(num_utts);
+    std::vector<const CuMatrixBase<BaseFloat>*> loglike_ptrs(num_utts);
+    for (int32 u = 0; u < num_utts; u++) {
+      loglikes[u].Resize(1 + rand() % 10, num_cols);
+      loglikes[u].SetRandn();
+      loglikes[u].ApplyPow(2.0);
+      loglikes[u].Scale(-1.0);  // so the log-likelihoods are negative.
+      cu_loglikes[u] = loglikes[u];
+    }
+    for (int32 u = 0; u < num_utts; u++)
+      loglike_ptrs[u] = &(cu_loglikes[u]);
+
+    std::vector<std::vector<CuDecodeGraph::Arc> > best_paths;
+    std::vector<BaseFloat> costs;
+    std::vector<bool> reached_final;
+    decoder.DecodeBatch(loglike_ptrs, &best_paths, &costs, &reached_final);
+    for (int32 u = 0; u < num_utts; u++) {
+      bool ref_reached_final;
+      BaseFloat ref_cost = ReferenceViterbi(num_states, start, arcs,
+                                            final_costs, loglikes[u],
+                                            &ref_reached_final);
+      KALDI_ASSERT(ref_reached_final == reached_final[u]);
+      if (ref_cost == std::numeric_limits<BaseFloat>::infinity()) {
+        KALDI_ASSERT(costs[u] == ref_cost && best_paths[u].empty());
+        continue;
+      }
+      KALDI_ASSERT(fabs(costs[u] - ref_cost) < 0.001 * (1.0 + fabs(ref_cost)));
+      CheckPath(graph, best_paths[u], loglikes[u], reached_final[u], costs[u]);
+
+      // Decoding the utterance on its own gives the same result.
+      std::vector<CuDecodeGraph::Arc> path;
+      BaseFloat cost;
+      bool this_reached_final = decoder.Decode(cu_loglikes[u], &path, &cost);
+      KALDI_ASSERT(this_reached_final == reached_final[u] &&
+                   ApproxEqual(cost, costs[u]) &&
+                   path.size() == best_paths[u].size());
+    }
+
+    // With a tight beam the search still gives a valid path, which is no
+    // better than the exact one.
+    opts.beam = 0.5;
+    CuViterbiDecoder pruned_decoder(graph, opts);
+    for (int32 u = 0; u < num_utts; u++) {
+      std::vector<CuDecodeGraph::Arc> path;
+      BaseFloat cost;
+      bool this_reached_final = pruned_decoder.Decode(cu_loglikes[u], &path,
+                                                      &cost);
+      if (cost == std::numeric_limits<BaseFloat>::infinity()) continue;
+      CheckPath(graph, path, loglikes[u], this_reached_final, cost);
+      if (this_reached_final == reached_final[u])
+        KALDI_ASSERT(cost >= costs[u] - 0.001 * (1.0 + fabs(costs[u])));
+    }
+  }
+}
+
+}  // namespace kaldi
+
+
+int main() {
+  using namespace kaldi;
+  for (int32 loop = 0; loop < 2; loop++) {
+#if HAVE_CUDA == 1
+    if (loop == 0)
+      CuDevice::Instantiate().SelectGpuId("no");
+    else
+      CuDevice::Instantiate().SelectGpuId("optional");
+#endif
+    UnitTestCuViterbiDecoder();
+    if (loop == 0)
+      KALDI_LOG << "Tests without GPU use succeeded.";
+    else
+      KALDI_LOG << "Tests with GPU use (if available) succeeded.";
+#if HAVE_CUDA != 1
+    break;
+#endif
+  }
+  return 0;
+}
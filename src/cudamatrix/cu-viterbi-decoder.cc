@@ -0,0 +1,487 @@
+// cudamatrix/cu-viterbi-decoder.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#if HAVE_CUDA == 1
+#include <cuda_runtime_api.h>
+#endif
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <utility>
+#include "util/timer.h"
+#include "cudamatrix/cu-viterbi-decoder.h"
+#include "cudamatrix/cu-device.h"
+#include "cudamatrix/cu-kernels.h"
+
+namespace kaldi {
+
+CuDecodeGraph::CuDecodeGraph(int32 num_states, int32 start_state,
+                             const std::vector<Arc> &arcs,
+                             const std::vector<BaseFloat> &final_costs):
+    start_(start_state), num_cols_(0), final_costs_(final_costs) {
+  KALDI_ASSERT(num_states > 0 && start_state >= 0 &&
+               start_state < num_states && final_costs.size() == num_states);
+  int32 num_arcs = arcs.size();
+  // Sort the arcs by source state, with the emitting arcs first.
+  std::vector<std::pair<std::pair<int32, int32>, int32> > sorted_arcs(num_arcs);
+  for (int32 a = 0; a < num_arcs; a++) {
+    const Arc &arc = arcs[a];
+    KALDI_ASSERT(arc.src >= 0 && arc.src < num_states && arc.dest >= 0 &&
+                 arc.dest < num_states && arc.col >= -1);
+    sorted_arcs[a] = std::make_pair(std::make_pair(arc.src,
+                                                   arc.col < 0 ? 1 : 0), a);
+    num_cols_ = std::max(num_cols_, arc.col + 1);
+  }
+  std::sort(sorted_arcs.begin(), sorted_arcs.end());
+
+  arcs_.resize(num_arcs);
+  std::vector<int32> offsets(num_states + 1, 0), eps_offsets(num_states, 0),
+      arc_src(num_arcs), arc_dest(num_arcs), arc_col(num_arcs);
+  std::vector<BaseFloat> arc_cost(num_arcs);
+  for (int32 a = 0; a < num_arcs; a++) {
+    const Arc &arc = arcs[sorted_arcs[a].second];
+    arcs_[a] = arc;
+    arc_src[a] = arc.src;
+    arc_dest[a] = arc.dest;
+    arc_col[a] = arc.col;
+    arc_cost[a] = arc.cost;
+    offsets[arc.src + 1]++;
+    if (arc.col >= 0) eps_offsets[arc.src]++;
+  }
+  for (int32 s = 0; s < num_states; s++) {
+    eps_offsets[s] += offsets[s];  // offsets[s] is already cumulative here.
+    offsets[s + 1] += offsets[s];
+  }
+  offsets_.CopyFromVec(offsets);
+  eps_offsets_.CopyFromVec(eps_offsets);
+  if (num_arcs != 0) {
+    arc_src_.CopyFromVec(arc_src);
+    arc_dest_.CopyFromVec(arc_dest);
+    arc_col_.CopyFromVec(arc_col);
+    arc_cost_.CopyFromVec(arc_cost);
+  }
+}
+
+
+// The best (cost, arc) of each state is packed into one uint64, with the cost
+// in the high 32 bits mapped to an unsigned integer that compares in the same
+// order as the float, so that the smallest packed value is the best; see
+// _viterbi_relax() in cu-kernels.cu, which these must agree with.
+static const uint64 kNoCost = ~static_cast<uint64>(0);
+
+static inline uint32 FloatToOrdered(float f) {
+  union { float f; uint32 u; } u;
+  u.f = f;
+  return (u.u & 0x80000000u) ? ~u.u : (u.u | 0x80000000u);
+}
+
+static inline float OrderedToFloat(uint32 o) {
+  union { float f; uint32 u; } u;
+  u.u = (o & 0x80000000u) ? (o & 0x7fffffffu) : ~o;
+  return u.f;
+}
+
+static inline uint64 PackCost(BaseFloat cost, int32 arc) {
+  return (static_cast<uint64>(FloatToOrdered(cost)) << 32) |
+      static_cast<uint32>(arc);
+}
+
+// Sets all the bytes of the array to 0xff (i.e. -1 for int32, and kNoCost).
+template<typename T>
+static void SetAllOnes(CuArray<T> *array) {
+  if (array->Dim() == 0) return;
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CU_SAFE_CALL(cudaMemset(array->Data(), 0xff, array->Dim() * sizeof(T)));
+  } else
+#endif
+  {
+    memset(static_cast<void*>(array->Data()), 0xff, array->Dim() * sizeof(T));
+  }
+}
+
+template<typename T>
+static void SetElement(int32 i, const T &value, CuArray<T> *array) {
+  KALDI_ASSERT(i >= 0 && i < array->Dim());
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CU_SAFE_CALL(cudaMemcpy(array->Data() + i, &value, sizeof(T),
+                            cudaMemcpyHostToDevice));
+  } else
+#endif
+  {
+    array->Data()[i] = value;
+  }
+}
+
+// Makes sure the array has dimension at least "min_dim", keeping its first
+// "num_used" elements; it grows geometrically.
+template<typename T>
+static void GrowArray(int32 num_used, int32 min_dim, CuArray<T> *array) {
+  if (array->Dim() >= min_dim) return;
+  int32 new_dim = std::max(min_dim, 2 * array->Dim());
+  CuArray<T> tmp;
+  if (num_used > 0) tmp.CopyFromArray(*array);
+  array->Resize(new_dim, kUndefined);
+  if (num_used == 0) return;
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CU_SAFE_CALL(cudaMemcpy(array->Data(), tmp.Data(), num_used * sizeof(T),
+                            cudaMemcpyDeviceToDevice));
+  } else
+#endif
+  {
+    memcpy(array->Data(), tmp.Data(), num_used * sizeof(T));
+  }
+}
+
+
+// The CPU version of _viterbi_relax() in cu-kernels.cu; returns true if the
+// cost of "dest" was improved.
+static inline bool ViterbiRelaxCpu(int32 dest, BaseFloat cost, int32 arc,
+                                   uint64 *state_best, int32 *new_states,
+                                   int32 *counters) {
+  uint64 packed = PackCost(cost, arc), old = state_best[dest];
+  if (packed >= old) return false;
+  state_best[dest] = packed;
+  if (old == kNoCost)
+    new_states[counters[0]++] = dest;
+  counters[1] = 1;
+  uint32 ordered = FloatToOrdered(cost);
+  if (ordered < static_cast<uint32>(counters[2]))
+    counters[2] = static_cast<int32>(ordered);
+  return true;
+}
+
+
+void CuViterbiDecoder::InitSearch(Search *search) const {
+  int32 num_states = graph_.NumStates();
+  search->state_best.Resize(num_states, kUndefined);
+  SetAllOnes(&(search->state_best));
+  for (int32 i = 0; i < 2; i++) {
+    search->token_map[i].Resize(num_states, kUndefined);
+    SetAllOnes(&(search->token_map[i]));
+  }
+  search->new_states.Resize(num_states, kUndefined);
+  search->frame_offsets.assign(1, 0);
+  search->best_cost = std::numeric_limits<BaseFloat>::infinity();
+
+  // The start state, reached by no arc (arc -1), with cost zero.
+  SetElement(graph_.Start(), PackCost(0.0, -1), &(search->state_best));
+  SetElement(0, graph_.Start(), &(search->new_states));
+  std::vector<int32> counters(3);
+  counters[0] = 1;
+  counters[1] = 0;
+  counters[2] = static_cast<int32>(FloatToOrdered(0.0));
+  search->counters.CopyFromVec(counters);
+  ProcessNonemitting(search);
+  FinishFrame(search);
+}
+
+
+void CuViterbiDecoder::ProcessFrame(const CuMatrixBase<BaseFloat> &loglikes,
+                                    int32 frame, Search *search) const {
+  KALDI_ASSERT(frame + 2 == search->frame_offsets.size());
+  int32 tok_begin = search->frame_offsets[frame],
+      tok_end = search->frame_offsets[frame + 1];
+  BaseFloat cutoff = search->best_cost + opts_.beam;
+  if (tok_begin != tok_end) {
+#if HAVE_CUDA == 1
+    if (CuDevice::Instantiate().Enabled()) {
+      Timer tim;
+      cuda_viterbi_expand_emitting(
+          n_blocks(tok_end - tok_begin, CU1DBLOCK), CU1DBLOCK,
+          graph_.offsets_.Data(), graph_.eps_offsets_.Data(),
+          graph_.arc_dest_.Data(), graph_.arc_col_.Data(),
+          graph_.arc_cost_.Data(), loglikes.RowData(frame),
+          search->tok_state.Data(), search->tok_cost.Data(), tok_begin,
+          tok_end, cutoff, opts_.beam,
+          reinterpret_cast<unsigned long long*>(search->state_best.Data()),
+          search->new_states.Data(), search->counters.Data());
+      CU_SAFE_CALL(cudaGetLastError());
+      CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+    } else
+#endif
+    {
+      const int32 *offsets = graph_.offsets_.Data(),
+          *eps_offsets = graph_.eps_offsets_.Data(),
+          *arc_dest = graph_.arc_dest_.Data(),
+          *arc_col = graph_.arc_col_.Data(),
+          *tok_state = search->tok_state.Data();
+      const BaseFloat *arc_cost = graph_.arc_cost_.Data(),
+          *frame_loglikes = loglikes.RowData(frame),
+          *tok_cost = search->tok_cost.Data();
+      uint64 *state_best = search->state_best.Data();
+      int32 *new_states = search->new_states.Data(),
+          *counters = search->counters.Data();
+      for (int32 t = tok_begin; t < tok_end; t++) {
+        BaseFloat cost = tok_cost[t];
+        if (!(cost < cutoff)) continue;
+        int32 s = tok_state[t];
+        for (int32 a = offsets[s]; a < eps_offsets[s]; a++) {
+          BaseFloat new_cost = cost + arc_cost[a] - frame_loglikes[arc_col[a]];
+          if (new_cost < OrderedToFloat(counters[2]) + opts_.beam)
+            ViterbiRelaxCpu(arc_dest[a], new_cost, a, state_best, new_states,
+                            counters);
+        }
+      }
+    }
+  }
+  ProcessNonemitting(search);
+  FinishFrame(search);
+}
+
+
+void CuViterbiDecoder::ProcessNonemitting(Search *search) const {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    std::vector<int32> counters;
+    search->counters.CopyToVec(&counters);
+    // Each pass expands all the states of the frame so far; we stop when a
+    // pass improves no cost.  Graphs without epsilon cycles need at most one
+    // pass more than the length of the longest epsilon path.
+    for (int32 iter = 0; iter < opts_.max_eps_iters && counters[0] != 0;
+         iter++) {
+      cuda_viterbi_expand_nonemitting(
+          n_blocks(counters[0], CU1DBLOCK), CU1DBLOCK,
+          graph_.offsets_.Data(), graph_.eps_offsets_.Data(),
+          graph_.arc_dest_.Data(), graph_.arc_cost_.Data(), opts_.beam,
+          counters[0],
+          reinterpret_cast<unsigned long long*>(search->state_best.Data()),
+          search->new_states.Data(), search->counters.Data());
+      CU_SAFE_CALL(cudaGetLastError());
+      search->counters.CopyToVec(&counters);
+      if (counters[1] == 0) break;
+      SetElement(1, 0, &(search->counters));
+    }
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    const int32 *offsets = graph_.offsets_.Data(),
+        *eps_offsets = graph_.eps_offsets_.Data(),
+        *arc_dest = graph_.arc_dest_.Data();
+    const BaseFloat *arc_cost = graph_.arc_cost_.Data();
+    uint64 *state_best = search->state_best.Data();
+    int32 *new_states = search->new_states.Data(),
+        *counters = search->counters.Data();
+    // On the CPU we use a queue, and expand a state again only when its cost
+    // improves.  The limit on the number of expansions corresponds to
+    // max_eps_iters on the GPU.
+    std::deque<int32> queue(new_states, new_states + counters[0]);
+    int64 max_expansions = static_cast<int64>(opts_.max_eps_iters) *
+        graph_.NumStates();
+    for (int64 n = 0; !queue.empty() && n < max_expansions; n++) {
+      int32 s = queue.front();
+      queue.pop_front();
+      BaseFloat cost = OrderedToFloat(state_best[s] >> 32);
+      if (!(cost < OrderedToFloat(counters[2]) + opts_.beam)) continue;
+      for (int32 a = eps_offsets[s]; a < offsets[s + 1]; a++)
+        if (ViterbiRelaxCpu(arc_dest[a], cost + arc_cost[a], a, state_best,
+                            new_states, counters))
+          queue.push_back(arc_dest[a]);
+    }
+  }
+}
+
+
+void CuViterbiDecoder::FinishFrame(Search *search) const {
+  std::vector<int32> counters;
+  search->counters.CopyToVec(&counters);
+  int32 frame = search->frame_offsets.size() - 1,
+      num_new = counters[0],
+      tok_begin = search->frame_offsets.back(),
+      tok_end = tok_begin + num_new;
+  // The map for this frame still has the tokens of two frames ago.
+  int32 prev_begin = (frame >= 2 ? search->frame_offsets[frame - 2] : 0),
+      prev_end = (frame >= 2 ? search->frame_offsets[frame - 1] : 0);
+  CuArray<int32> &cur_map = search->token_map[frame % 2],
+      &prev_map = search->token_map[(frame + 1) % 2];
+  GrowArray(tok_begin, tok_end, &(search->tok_state));
+  GrowArray(tok_begin, tok_end, &(search->tok_arc));
+  GrowArray(tok_begin, tok_end, &(search->tok_prev));
+  GrowArray(tok_begin, tok_end, &(search->tok_cost));
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    if (prev_end != prev_begin) {
+      cudaI32_viterbi_clear_token_map(
+          n_blocks(prev_end - prev_begin, CU1DBLOCK), CU1DBLOCK,
+          search->tok_state.Data(), prev_begin, prev_end, cur_map.Data());
+    }
+    if (num_new != 0) {
+      cudaI32_viterbi_assign_tokens(n_blocks(num_new, CU1DBLOCK), CU1DBLOCK,
+                                    search->new_states.Data(), num_new,
+                                    tok_begin, cur_map.Data(),
+                                    search->tok_state.Data());
+      cuda_viterbi_set_backpointers(
+          n_blocks(num_new, CU1DBLOCK), CU1DBLOCK, graph_.arc_src_.Data(),
+          graph_.arc_col_.Data(), search->new_states.Data(), num_new,
+          tok_begin, prev_map.Data(), cur_map.Data(),
+          reinterpret_cast<unsigned long long*>(search->state_best.Data()),
+          search->tok_cost.Data(), search->tok_arc.Data(),
+          search->tok_prev.Data());
+    }
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    const int32 *arc_src = graph_.arc_src_.Data(),
+        *arc_col = graph_.arc_col_.Data(),
+        *new_states = search->new_states.Data();
+    int32 *cur_map_data = cur_map.Data(), *prev_map_data = prev_map.Data(),
+        *tok_state = search->tok_state.Data(),
+        *tok_arc = search->tok_arc.Data(),
+        *tok_prev = search->tok_prev.Data();
+    BaseFloat *tok_cost = search->tok_cost.Data();
+    uint64 *state_best = search->state_best.Data();
+    for (int32 t = prev_begin; t < prev_end; t++)
+      cur_map_data[tok_state[t]] = -1;
+    for (int32 i = 0; i < num_new; i++) {
+      cur_map_data[new_states[i]] = tok_begin + i;
+      tok_state[tok_begin + i] = new_states[i];
+    }
+    for (int32 i = 0; i < num_new; i++) {
+      int32 s = new_states[i], t = tok_begin + i;
+      uint64 packed = state_best[s];
+      int32 a = static_cast<int32>(static_cast<uint32>(packed & 0xffffffffu));
+      tok_cost[t] = OrderedToFloat(static_cast<uint32>(packed >> 32));
+      tok_arc[t] = a;
+      if (a < 0)
+        tok_prev[t] = -1;
+      else if (arc_col[a] >= 0)
+        tok_prev[t] = prev_map_data[arc_src[a]];
+      else
+        tok_prev[t] = cur_map_data[arc_src[a]];
+      state_best[s] = kNoCost;
+    }
+  }
+  search->frame_offsets.push_back(tok_end);
+  search->best_cost = (num_new == 0 ? std::numeric_limits<BaseFloat>::infinity()
+                       : OrderedToFloat(static_cast<uint32>(counters[2])));
+  counters[0] = 0;
+  counters[1] = 0;
+  counters[2] = static_cast<int32>(FloatToOrdered(
+      std::numeric_limits<BaseFloat>::infinity()));
+  search->counters.CopyFromVec(counters);
+}
+
+
+void CuViterbiDecoder::Traceback(const Search &search,
+                                 std::vector<CuDecodeGraph::Arc> *best_path,
+                                 BaseFloat *cost, bool *reached_final) const {
+  best_path->clear();
+  *cost = std::numeric_limits<BaseFloat>::infinity();
+  *reached_final = false;
+  int32 tok_begin = search.frame_offsets[search.frame_offsets.size() - 2],
+      tok_end = search.frame_offsets.back();
+  if (tok_begin == tok_end) {
+    KALDI_WARN << "No tokens survived to the end of the utterance.";
+    return;
+  }
+  std::vector<int32> tok_state, tok_arc, tok_prev;
+  std::vector<BaseFloat> tok_cost;
+  search.tok_state.CopyToVec(&tok_state);
+  search.tok_arc.CopyToVec(&tok_arc);
+  search.tok_prev.CopyToVec(&tok_prev);
+  search.tok_cost.CopyToVec(&tok_cost);
+  // Prefer the best token in a final state; if there is none, take the best
+  // token.
+  int32 best_tok = -1;
+  BaseFloat best_cost = std::numeric_limits<BaseFloat>::infinity();
+  for (int32 t = tok_begin; t < tok_end; t++) {
+    BaseFloat this_cost = tok_cost[t] + graph_.FinalCost(tok_state[t]);
+    if (this_cost < best_cost) {
+      best_cost = this_cost;
+      best_tok = t;
+    }
+  }
+  if (best_tok != -1) {
+    *reached_final = true;
+  } else {
+    for (int32 t = tok_begin; t < tok_end; t++) {
+      if (tok_cost[t] < best_cost) {
+        best_cost = tok_cost[t];
+        best_tok = t;
+      }
+    }
+  }
+  KALDI_ASSERT(best_tok != -1);
+  *cost = best_cost;
+  for (int32 t = best_tok; tok_arc[t] >= 0; t = tok_prev[t]) {
+    // The back-pointers can only form a cycle if the graph has an epsilon
+    // cycle with negative cost.
+    KALDI_ASSERT(tok_prev[t] >= 0 && best_path->size() < tok_end &&
+                 "CuViterbiDecoder: cycle in back-pointers.");
+    best_path->push_back(graph_.GetArc(tok_arc[t]));
+  }
+  std::reverse(best_path->begin(), best_path->end());
+}
+
+
+void CuViterbiDecoder::DecodeBatch(
+    const std::vector<const CuMatrixBase<BaseFloat>*> &loglikes,
+    std::vector<std::vector<CuDecodeGraph::Arc> > *best_paths,
+    std::vector<BaseFloat> *costs,
+    std::vector<bool> *reached_final) {
+  int32 num_utts = loglikes.size(), max_frames = 0;
+  std::vector<Search*> searches(num_utts);
+  for (int32 u = 0; u < num_utts; u++) {
+    KALDI_ASSERT(loglikes[u]->NumCols() >= graph_.NumCols());
+    max_frames = std::max(max_frames, loglikes[u]->NumRows());
+    searches[u] = new Search();
+    InitSearch(searches[u]);
+  }
+  for (int32 frame = 0; frame < max_frames; frame++)
+    for (int32 u = 0; u < num_utts; u++)
+      if (frame < loglikes[u]->NumRows())
+        ProcessFrame(*(loglikes[u]), frame, searches[u]);
+
+  best_paths->resize(num_utts);
+  costs->resize(num_utts);
+  reached_final->resize(num_utts);
+  for (int32 u = 0; u < num_utts; u++) {
+    bool this_reached_final;
+    Traceback(*(searches[u]), &((*best_paths)[u]), &((*costs)[u]),
+              &this_reached_final);
+    (*reached_final)[u] = this_reached_final;
+    delete searches[u];
+  }
+}
+
+
+bool CuViterbiDecoder::Decode(const CuMatrixBase<BaseFloat> &loglikes,
+                              std::vector<CuDecodeGraph::Arc> *best_path,
+                              BaseFloat *cost) {
+  std::vector<const CuMatrixBase<BaseFloat>*> loglikes_vec(1, &loglikes);
+  std::vector<std::vector<CuDecodeGraph::Arc> > best_paths;
+  std::vector<BaseFloat> costs;
+  std::vector<bool> reached_final;
+  DecodeBatch(loglikes_vec, &best_paths, &costs, &reached_final);
+  best_path->swap(best_paths[0]);
+  *cost = costs[0];
+  return reached_final[0];
+}
+
+
+}  // namespace kaldi
@@ -0,0 +1,202 @@
+// cudamatrix/cu-viterbi-decoder.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_CUDAMATRIX_CU_VITERBI_DECODER_H_
+#define KALDI_CUDAMATRIX_CU_VITERBI_DECODER_H_
+
+#include <vector>
+#include "itf/options-itf.h"
+#include "cudamatrix/cu-common.h"
+#include "cudamatrix/cu-array.h"
+#include "cudamatrix/cu-matrix.h"
+
+namespace kaldi {
+
+
+/**
+   CuDecodeGraph holds a decoding graph, such as HCLG, in the compressed
+   sparse row form that CuViterbiDecoder searches, on the GPU if we have one.
+   Like CuLevelledGraph it has no knowledge of FSTs or transition-ids: each
+   arc has a cost, the column of the log-likelihood matrix that it consumes
+   (-1 for non-emitting arcs), and input and output labels that are only
+   passed through to the best path.  See ../decoder/cu-faster-decoder.h for
+   the conversion from an FST.
+
+   The arcs leaving each state are stored together, the emitting ones first,
+   so a thread that expands a token reads a contiguous range of each array.
+ */
+class CuDecodeGraph {
+ public:
+  struct Arc {
+    int32 src;     // source state
+    int32 dest;    // destination state
+    int32 col;     // log-likelihood column consumed, or -1 if non-emitting.
+    int32 ilabel;  // passed through to the best path.
+    int32 olabel;
+    BaseFloat cost;  // graph cost (negated log-probability).
+  };
+
+  /// "final_costs" gives the final cost of each state, which is +infinity for
+  /// non-final states.  The arcs are renumbered; see GetArc().
+  CuDecodeGraph(int32 num_states, int32 start_state,
+                const std::vector<Arc> &arcs,
+                const std::vector<BaseFloat> &final_costs);
+
+  int32 NumStates() const { return final_costs_.size(); }
+
+  int32 NumArcs() const { return arcs_.size(); }
+
+  int32 Start() const { return start_; }
+
+  /// The largest "col" of any arc, plus one: the log-likelihood matrices
+  /// must have at least this many columns.
+  int32 NumCols() const { return num_cols_; }
+
+  /// Returns arc a, in the internal numbering (ordered by source state).
+  const Arc &GetArc(int32 a) const { return arcs_[a]; }
+
+  BaseFloat FinalCost(int32 s) const { return final_costs_[s]; }
+
+ private:
+  friend class CuViterbiDecoder;
+  int32 start_;
+  int32 num_cols_;
+  std::vector<Arc> arcs_;  // on the CPU, for the traceback.
+  std::vector<BaseFloat> final_costs_;
+  // The following are on the GPU if we have one.  The emitting arcs of state
+  // s are offsets_[s] ... eps_offsets_[s] - 1 and the non-emitting ones are
+  // eps_offsets_[s] ... offsets_[s+1] - 1.
+  CuArray<int32> offsets_;
+  CuArray<int32> eps_offsets_;
+  CuArray<int32> arc_src_;
+  CuArray<int32> arc_dest_;
+  CuArray<int32> arc_col_;
+  CuArray<BaseFloat> arc_cost_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CuDecodeGraph);
+};
+
+
+struct CuViterbiDecoderOptions {
+  BaseFloat beam;
+  int32 max_eps_iters;  // the most passes over the tokens of a frame when
+                        // following non-emitting arcs.
+  CuViterbiDecoderOptions(): beam(16.0), max_eps_iters(100) { }
+  void Register(OptionsItf *po) {
+    po->Register("beam", &beam, "Decoding beam.");
+    po->Register("max-eps-iters", &max_eps_iters, "Maximum number of passes "
+                 "over the tokens of a frame when following epsilon arcs "
+                 "(only matters if the graph has epsilon cycles).");
+  }
+};
+
+/**
+   CuViterbiDecoder does frame-synchronous Viterbi beam search over a
+   CuDecodeGraph, on the GPU if we have one.  Each frame is processed with a
+   few kernel launches: one thread per token expands its emitting arcs, with
+   an atomic compare-and-swap keeping the best (cost, arc) of each destination
+   state, so no locking or sorting is needed; then the non-emitting arcs are
+   followed in passes over the new tokens until no cost improves; then the
+   back-pointers of the new tokens are resolved.  The search keeps, for each
+   utterance, a dense per-state array for the frame being built and compact
+   token lists for all the frames, so the traceback needs one copy from the
+   device at the end.  Pruning is by beam only.
+
+   DecodeBatch() decodes several utterances together, frame by frame, so the
+   graph (which is shared) stays in the GPU's cache and the host loop overlaps
+   the launches of different utterances.  Without a GPU the same algorithm runs
+   on the CPU (with a queue rather than passes for the non-emitting arcs).
+ */
+class CuViterbiDecoder {
+ public:
+  CuViterbiDecoder(const CuDecodeGraph &graph,
+                   const CuViterbiDecoderOptions &opts):
+      graph_(graph), opts_(opts) { }
+
+  /// Decodes the utterances whose (already scaled) log-likelihoods are in
+  /// "loglikes", one row per frame and one column per "col" of the graph.
+  /// Sets (*best_paths)[i] to the arcs of the best path of utterance i and
+  /// (*costs)[i] to its cost (graph cost minus log-likelihood, plus the final
+  /// cost if a final state was reached, as reported in (*reached_final)[i]).
+  /// If no token survives, the path is empty and the cost is +infinity.
+  void DecodeBatch(const std::vector<const CuMatrixBase<BaseFloat>*> &loglikes,
+                   std::vector<std::vector<CuDecodeGraph::Arc> > *best_paths,
+                   std::vector<BaseFloat> *costs,
+                   std::vector<bool> *reached_final);
+
+  /// Decodes one utterance; returns true if a final state was reached.
+  bool Decode(const CuMatrixBase<BaseFloat> &loglikes,
+              std::vector<CuDecodeGraph::Arc> *best_path,
+              BaseFloat *cost);
+
+ private:
+  // The state of the search of one utterance.
+  struct Search {
+    // For each state, the best (cost, arc) of the frame being built, packed so
+    // that they can be updated together (see cu-viterbi-decoder.cc); all ones
+    // if the state has no token yet.
+    CuArray<uint64> state_best;
+    // For each state, its token in the frames with even and odd index, or -1.
+    CuArray<int32> token_map[2];
+    // The states that have tokens in the frame being built; only the first
+    // counters[0] are used.
+    CuArray<int32> new_states;
+    // [0] = the number of new states; [1] = set if a cost was improved when
+    // following non-emitting arcs; [2] = the best cost of the frame being
+    // built, as an order-preserving unsigned integer.
+    CuArray<int32> counters;
+    // The tokens of all the frames.  The tokens of frame t (after t frames
+    // have been consumed) are frame_offsets[t] ... frame_offsets[t+1] - 1;
+    // tok_arc is the arc that led to the token (-1 for the start), and
+    // tok_prev is the token it came from (-1 for the start).  The arrays are
+    // grown geometrically, so their dimension is not the number of tokens.
+    CuArray<int32> tok_state, tok_arc, tok_prev;
+    CuArray<BaseFloat> tok_cost;
+    std::vector<int32> frame_offsets;
+    BaseFloat best_cost;  // of the last frame finished.
+  };
+
+  // Sets up the search and does frame 0 (following non-emitting arcs from
+  // the start state).
+  void InitSearch(Search *search) const;
+
+  // Consumes one frame of log-likelihoods.
+  void ProcessFrame(const CuMatrixBase<BaseFloat> &loglikes, int32 frame,
+                    Search *search) const;
+
+  // Follows non-emitting arcs from the states in search->new_states.
+  void ProcessNonemitting(Search *search) const;
+
+  // Turns the new states into the tokens of the next frame, and resets the
+  // per-state arrays.
+  void FinishFrame(Search *search) const;
+
+  void Traceback(const Search &search,
+                 std::vector<CuDecodeGraph::Arc> *best_path,
+                 BaseFloat *cost, bool *reached_final) const;
+
+  const CuDecodeGraph &graph_;
+  CuViterbiDecoderOptions opts_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CuViterbiDecoder);
+};
+
+
+}  // namespace kaldi
+
+#endif  // KALDI_CUDAMATRIX_CU_VITERBI_DECODER_H_
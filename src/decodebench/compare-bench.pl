@@ -0,0 +1,92 @@
+#!/usr/bin/perl
+
+# Copyright 2026  agent
+# Apache 2.0
+
+# Compares benchmark results (the JSON lines written by "make bench" and by
+# decode-bench.sh) with a stored baseline, and exits with status 1 if anything
+# got worse by more than the thresholds.  Results are matched by their
+# "benchmark" and "params" fields; if a file has several results for the same
+# benchmark (the results files are appended to), the last one is used.  For
+# every figure below, higher is worse.  The times are compared with
+# --threshold, which should allow for the noise in the timings; the figures
+# that depend only on the computation (tokens and lattice size) and the memory
+# use are compared with --count-threshold.
+
+$threshold = 0.1;
+$count_threshold = 0.02;
+for ($x = 1; $x <= 2; $x++) {
+  if ($ARGV[0] =~ m/^--threshold=(.+)$/) { $threshold = $1; shift @ARGV; }
+  if ($ARGV[0] =~ m/^--count-threshold=(.+)$/) { $count_threshold = $1; shift @ARGV; }
+}
+
+if (@ARGV != 2) {
+  print STDERR "Usage: compare-bench.pl [options] <baseline-jsonl> <results-jsonl>\n" .
+    "e.g.: compare-bench.pl bench-baseline.jsonl bench-results.jsonl\n" .
+    "Options:\n" .
+    "  --threshold=<t>        # Flag times that went up by more than this\n" .
+    "                         # fraction (default: $threshold)\n" .
+    "  --count-threshold=<t>  # The same, for the token counts, lattice size and\n" .
+    "                         # memory (default: $count_threshold)\n";
+  exit 1;
+}
+
+%is_time = ("seconds" => 1, "rtf" => 1, "determinize_seconds" => 1,
+            "peak_rss_kb" => 0, "tokens_per_frame" => 0,
+            "lattice_arcs_per_frame" => 0);
+@figures = ("seconds", "rtf", "determinize_seconds", "peak_rss_kb",
+            "tokens_per_frame", "lattice_arcs_per_frame");
+
+# Reads a results file into a hash from "benchmark (params)" to a reference to
+# a hash of the numeric fields; also returns the keys in the order of the file.
+sub read_results {
+  my $file = shift;
+  my (%results, @keys);
+  open(F, "<$file") || die "compare-bench.pl: cannot open $file";
+  while (<F>) {
+    next if m/^\s*$/;
+    m/"benchmark": "((?:[^"\\]|\\.)*)"/ ||
+      die "compare-bench.pl: bad line in $file: $_";
+    my $key = $1;
+    if (m/"params": "((?:[^"\\]|\\.)*)"/ && $1 ne "") { $key .= " ($1)"; }
+    my %fields;
+    while (m/"(\w+)": (-?[0-9][0-9.eE+-]*)/g) { $fields{$1} = $2; }
+    push @keys, $key unless defined $results{$key};
+    $results{$key} = \%fields;
+  }
+  close(F);
+  return (\%results, \@keys);
+}
+
+($baseline, $baseline_keys) = read_results($ARGV[0]);
+($results, $keys) = read_results($ARGV[1]);
+
+$num_regressions = 0;
+$num_compared = 0;
+foreach $key (@$baseline_keys) {
+  if (!defined $results->{$key}) {
+    print "compare-bench.pl: WARNING: no result for $key\n";
+    next;
+  }
+  my ($base, $res) = ($baseline->{$key}, $results->{$key});
+  foreach $f (@figures) {
+    next unless defined $base->{$f} && defined $res->{$f};
+    next if $base->{$f} <= 0;  # e.g. peak RSS not known.
+    $num_compared++;
+    my $change = ($res->{$f} - $base->{$f}) / $base->{$f};
+    my $t = ($is_time{$f} ? $threshold : $count_threshold);
+    my $flag = "";
+    if ($change > $t) { $flag = "  REGRESSION"; $num_regressions++; }
+    elsif ($change < -$t) { $flag = "  improved"; }
+    printf("%-60s %-22s %12g %12g %+7.1f%%%s\n", $key, $f, $base->{$f},
+           $res->{$f}, 100.0 * $change, $flag);
+  }
+}
+foreach $key (@$keys) {
+  defined $baseline->{$key} ||
+    print "compare-bench.pl: $key is not in the baseline\n";
+}
+
+print "compare-bench.pl: compared $num_compared figures, " .
+  "$num_regressions regression(s).\n";
+exit($num_regressions > 0 ? 1 : 0);
@@ -0,0 +1,172 @@
+#!/bin/bash
+
+# Copyright 2026  agent
+# Apache 2.0
+
+# This script measures how fast the decoding binaries are, end to end.  It runs
+# gmm-latgen-faster, latgen-faster-mapped, nnet-latgen-faster and
+# online-wav-gmm-decode-faster on a small test set with --profile (see
+# util/kaldi-profile.h), and appends one line of JSON per program to
+# <results-jsonl>, in the format of the benchmark programs of "make bench"
+# (see util/kaldi-bench.h) with some extra fields, e.g.
+#  {"benchmark": "decode:gmm-latgen-faster", "params": "model=tri2b_mmi utts=all
+#   beam=13", "seconds": 5.2, "rtf": 0.093, "peak_rss_kb": 201344,
+#   "frames": 5590, "tokens_per_frame": 2481.7, "lattice_arcs_per_frame": 28.4,
+#   "determinize_seconds": 0.41}
+# "seconds" is the elapsed time of the whole program, including reading the
+# model and graph, and "rtf" is that divided by the duration of the audio that
+# was decoded.  The tokens are counted at the start of each frame, and the
+# lattice figures (for the programs that write lattices) are for the
+# determinized lattices.  Use compare-bench.pl to compare the results with
+# those of an earlier version.
+#
+# The test set is that of the online decoding demo (egs/voxforge/online_demo):
+# GMM models, their decoding graphs and some audio, which are downloaded into
+# <data-dir> the first time.  The features and log-likelihoods are computed up
+# front, so they don't count in the times of the programs that read them.  The
+# set has no nnet2 model, so nnet-latgen-faster is only run if you give
+# --nnet-dir: a directory with final.mdl, HCLG.fst and feats.scp, containing
+# the features that that model expects (e.g. a few utterances of a test set,
+# with the features as in steps/nnet2/decode.sh).  Programs that have not been
+# built are skipped, with a warning.
+#
+# "make decode_bench" in src/ runs this with the default options.
+
+# Begin configuration section.
+model=tri2b_mmi  # or tri2a, for a model without an LDA+MLLT transform.
+num_utts=0       # If >0, only decode this many utterances.
+beam=13.0
+lattice_beam=6.0
+max_active=7000
+acoustic_scale=0.0769
+nnet_dir=
+nnet_acoustic_scale=0.1
+frame_shift=0.01  # In seconds, for working out the duration of the audio.
+data_url=http://sourceforge.net/projects/kaldi/files/online-data.tar.bz2
+# End configuration section.
+
+echo "$0 $@"  # Print the command line for logging
+
+KALDI_ROOT=$(cd $(dirname $0)/../..; pwd)
+. $KALDI_ROOT/egs/wsj/s5/utils/parse_options.sh || exit 1;
+
+if [ $# != 2 ]; then
+  echo "Usage: $0 [options] <data-dir> <results-jsonl>"
+  echo " e.g.: $0 decodebench/data bench-results.jsonl"
+  echo "Options:"
+  echo "  --model <model>             # tri2b_mmi (default) or tri2a"
+  echo "  --num-utts <n>              # only decode the first n utterances"
+  echo "  --beam <beam>               # decoding beam (default: $beam)"
+  echo "  --nnet-dir <dir>            # also run nnet-latgen-faster (see top of script)"
+  exit 1;
+fi
+
+dir=$1
+results=$2
+
+src=$KALDI_ROOT/src
+export PATH=$src/bin:$src/featbin:$src/gmmbin:$src/nnet2bin:$src/onlinebin:$PATH
+
+mkdir -p $dir || exit 1;
+am=$dir/online-data/models/$model
+if [ ! -d $am ]; then
+  if [ ! -s $dir/online-data.tar.bz2 ]; then
+    echo "$0: downloading the test set from $data_url"
+    wget -T 10 -t 3 -O $dir/online-data.tar.bz2 $data_url
+    if [ ! -s $dir/online-data.tar.bz2 ]; then
+      echo "$0: download of the test set failed" && exit 1;
+    fi
+  fi
+  tar -C $dir -xjf $dir/online-data.tar.bz2 || exit 1;
+fi
+for f in $am/model $am/HCLG.fst $am/words.txt; do
+  [ ! -f $f ] && echo "$0: expected file $f to exist" && exit 1;
+done
+
+work=$dir/work_$model
+mkdir -p $work || exit 1;
+for f in $dir/online-data/audio/*.wav; do
+  echo "$(basename $f .wav) $f"
+done | sort > $work/wav.scp
+if [ $num_utts -gt 0 ]; then
+  head -n $num_utts $work/wav.scp > $work/wav.scp.tmp
+  mv $work/wav.scp.tmp $work/wav.scp
+  utts=$num_utts
+else
+  utts=all
+fi
+[ ! -s $work/wav.scp ] && echo "$0: no audio found" && exit 1;
+
+# The features are as in the online decoder: MFCC with sliding-window CMN,
+# then either spliced and transformed with the model's LDA+MLLT matrix, or
+# with deltas.
+if [ -f $am/matrix ]; then
+  compute-mfcc-feats scp:$work/wav.scp ark:- 2>$work/feats.log | \
+    apply-cmvn-sliding ark:- ark:- 2>>$work/feats.log | \
+    splice-feats --left-context=4 --right-context=4 ark:- ark:- 2>>$work/feats.log | \
+    transform-feats $am/matrix ark:- ark:$work/feats.ark 2>>$work/feats.log || \
+    { echo "$0: error computing features, see $work/feats.log"; exit 1; }
+  lda_matrix=$am/matrix
+else
+  compute-mfcc-feats scp:$work/wav.scp ark:- 2>$work/feats.log | \
+    apply-cmvn-sliding ark:- ark:- 2>>$work/feats.log | \
+    add-deltas ark:- ark:$work/feats.ark 2>>$work/feats.log || \
+    { echo "$0: error computing features, see $work/feats.log"; exit 1; }
+  lda_matrix=
+fi
+gmm-compute-likes $am/model ark:$work/feats.ark ark:$work/loglikes.ark \
+  2>$work/loglikes.log || \
+  { echo "$0: error computing log-likelihoods, see $work/loglikes.log"; exit 1; }
+
+failed=false
+
+# run_bench <params> <program> <args...> runs the program with --profile and
+# appends its results to $results.
+function run_bench {
+  local params=$1 prog=$2
+  shift 2
+  if ! which $prog >/dev/null 2>&1; then
+    echo "$0: WARNING: $prog has not been built; skipping it."
+    return
+  fi
+  echo "$0: running $prog"
+  if ! $prog --profile=$work/$prog.profile.json "$@" 2>$work/$prog.log; then
+    echo "$0: $prog failed, see $work/$prog.log"
+    failed=true
+    return
+  fi
+  $src/decodebench/profile-to-bench.pl "decode:$prog" "$params" $frame_shift \
+    $work/$prog.profile.json >> $results || failed=true
+}
+
+decode_opts="--beam=$beam --lattice-beam=$lattice_beam --max-active=$max_active"
+
+run_bench "model=$model utts=$utts beam=$beam" \
+  gmm-latgen-faster $decode_opts --acoustic-scale=$acoustic_scale \
+  $am/model $am/HCLG.fst ark:$work/feats.ark ark:/dev/null
+
+run_bench "model=$model utts=$utts beam=$beam" \
+  latgen-faster-mapped $decode_opts --acoustic-scale=$acoustic_scale \
+  $am/model $am/HCLG.fst ark:$work/loglikes.ark ark:/dev/null
+
+if [ ! -z "$nnet_dir" ]; then
+  for f in $nnet_dir/final.mdl $nnet_dir/HCLG.fst $nnet_dir/feats.scp; do
+    [ ! -f $f ] && echo "$0: expected file $f to exist" && exit 1;
+  done
+  run_bench "model=$(basename $nnet_dir) beam=$beam" \
+    nnet-latgen-faster $decode_opts --acoustic-scale=$nnet_acoustic_scale \
+    $nnet_dir/final.mdl $nnet_dir/HCLG.fst scp:$nnet_dir/feats.scp ark:/dev/null
+else
+  echo "$0: no --nnet-dir option, so not running nnet-latgen-faster."
+fi
+
+# We fix the beam (--beam-update=0), as otherwise the decoder would narrow it
+# to keep to --rt-max and a slowdown would show up as fewer tokens instead.
+run_bench "model=$model utts=$utts beam=$beam" \
+  online-wav-gmm-decode-faster --beam=$beam --max-active=$max_active \
+  --acoustic-scale=$acoustic_scale --beam-update=0 --max-beam-update=0 \
+  scp:$work/wav.scp $am/model $am/HCLG.fst $am/words.txt '1:2:3:4:5' \
+  ark,t:/dev/null ark,t:/dev/null $lda_matrix
+
+$failed && exit 1;
+exit 0;
@@ -0,0 +1,52 @@
+#!/usr/bin/perl
+
+# Copyright 2026  agent
+# Apache 2.0
+
+# Turns the summary that a decoding program wrote with --profile=foo.json into
+# one line of JSON for the benchmark results (see decode-bench.sh), using the
+# elapsed time, the peak RSS and the decoders' regions and counters.
+
+@ARGV != 4 &&
+  print STDERR "Usage: profile-to-bench.pl <name> <params> <frame-shift> <profile-json>\n" &&
+  exit 1;
+
+($name, $params, $frame_shift, $profile) = @ARGV;
+
+open(P, "<$profile") || die "profile-to-bench.pl: cannot open $profile";
+$elapsed = -1;
+$peak_rss_kb = -1;
+while (<P>) {
+  if (m/"elapsed": ([^,\s]+)/) { $elapsed = $1; }
+  if (m/"peak_rss_kb": ([^,\s]+)/) { $peak_rss_kb = $1; }
+  if (m/\{ "name": "(.+)", "calls": (\d+), "seconds": ([^\s]+) \}/) {
+    $calls{$1} = $2; $seconds{$1} = $3;
+  }
+  if (m/\{ "name": "(.+)", "count": (\d+) \}/) { $count{$1} = $2; }
+}
+close(P);
+$elapsed < 0 && die "profile-to-bench.pl: no elapsed time in $profile";
+
+# Each frame is one call to ProcessEmitting(), in whichever decoder was used.
+$frames = 0;
+$tokens = 0;
+foreach $decoder ("LatticeFasterDecoder", "FasterDecoder") {
+  $frames += $calls{"${decoder}::ProcessEmitting"};
+  $tokens += $count{"${decoder}::tokens"};
+}
+$frames == 0 && die "profile-to-bench.pl: no frames were decoded according to $profile";
+
+sub escape { my $s = shift; $s =~ s/(["\\])/\\$1/g; return $s; }
+
+$line = sprintf("{\"benchmark\": \"%s\", \"params\": \"%s\", \"seconds\": %g, " .
+                "\"rtf\": %g, \"peak_rss_kb\": %d, \"frames\": %d, " .
+                "\"tokens_per_frame\": %g",
+                escape($name), escape($params), $elapsed,
+                $elapsed / ($frames * $frame_shift), $peak_rss_kb, $frames,
+                $tokens / $frames);
+$det = "DeterminizeLatticePhonePrunedWrapper";
+if (defined $calls{$det}) {
+  $line .= sprintf(", \"lattice_arcs_per_frame\": %g, \"determinize_seconds\": %g",
+                   $count{"${det}::arcs"} / $frames, $seconds{$det});
+}
+print "$line}\n";
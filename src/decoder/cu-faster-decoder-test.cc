@@ -0,0 +1,156 @@
+// decoder/cu-faster-decoder-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/cu-faster-decoder.h"
+#include "decoder/faster-decoder.h"
+#include "decoder/decodable-matrix.h"
+#include "fstext/fstext-utils.h"
+#include "tree/context-dep.h"
+#include "cudamatrix/cu-device.h"
+
+namespace kaldi {
+
+typedef fst::StdArc Arc;
+
+// Returns a monophone model for phones 1 to 5, with 3-state HMMs.
+TransitionModel *GenTestTransitionModel() {
+  std::string topo_str = "<Topology>\n"
+      "<TopologyEntry>\n"
+      "<ForPhones> 1 2 3 4 5 </ForPhones>\n"
+      "<State> 0 <PdfClass> 0 <Transition> 0 0.5 <Transition> 1 0.5 </State>\n"
+      "<State> 1 <PdfClass> 1 <Transition> 1 0.5 <Transition> 2 0.5 </State>\n"
+      "<State> 2 <PdfClass> 2 <Transition> 2 0.5 <Transition> 3 0.5 </State>\n"
+      "<State> 3 </State>\n"
+      "</TopologyEntry>\n"
+      "</Topology>\n";
+  HmmTopology topo;
+  std::istringstream iss(topo_str);
+  topo.Read(iss, false);
+  std::vector<int32> phones, phone2num_pdf_classes(6, 3);
+  for (int32 p = 1; p <= 5; p++) phones.push_back(p);
+  ContextDependency *ctx_dep =
+      MonophoneContextDependency(phones, phone2num_pdf_classes);
+  TransitionModel *trans_model = new TransitionModel(*ctx_dep, topo);
+  delete ctx_dep;
+  return trans_model;
+}
+
+// Makes a random graph with transition-ids (or epsilon) on the input and
+// words (or epsilon) on the output.  Epsilon arcs only go forward, so there
+// are no epsilon cycles.
+void MakeRandomGraph(int32 num_tids, fst::VectorFst<Arc> *fst) {
+  int32 num_states = 2 + rand() % 100;
+  for (int32 s = 0; s < num_states; s++)
+    fst->AddState();
+  fst->SetStart(0);
+  for (int32 s = 0; s < num_states; s++) {
+    int32 num_arcs = 1 + rand() % 4;
+    for (int32 a = 0; a < num_arcs; a++) {
+      int32 olabel = (rand() % 3 == 0 ? 1 + rand() % 10 : 0);
+      BaseFloat weight = 2.0 * RandUniform();
+      if (s + 1 < num_states && rand() % 5 == 0) {
+        int32 next = s + 1 + rand() % (num_states - s - 1);
+        fst->AddArc(s, Arc(0, olabel, weight, next));
+      } else {
+        fst->AddArc(s, Arc(1 + rand() % num_tids, olabel, weight,
+                           rand() % num_states));
+      }
+    }
+    if (rand() % 3 == 0)
+      fst->SetFinal(s, RandUniform());
+  }
+}
+
+// Checks CuFasterDecoder against FasterDecoder.  With an unlimited beam both
+// do exact Viterbi, so they must find paths of the same cost; with a finite
+// beam we just check that CuFasterDecoder's output is a path of the right
+// length.
+void UnitTestCuFasterDecoder() {
+  TransitionModel *trans_model = GenTestTransitionModel();
+  int32 num_pdfs = trans_model->NumPdfs(),
+      num_tids = trans_model->NumTransitionIds();
+  for (int32 i = 0; i < 100; i++) {
+    fst::VectorFst<Arc> fst;
+    MakeRandomGraph(num_tids, &fst);
+    int32 num_frames = 1 + rand() % 60;
+    Matrix<BaseFloat> loglikes(num_frames, num_pdfs);
+    loglikes.SetRandn();
+    bool exact = (i % 2 == 0);
+    BaseFloat beam = (exact ? 1.0e+10 : 4.0 + 8.0 * RandUniform());
+
+    CuViterbiDecoderOptions cu_opts;
+    cu_opts.beam = beam;
+    CuFasterDecoder cu_decoder(fst, *trans_model, cu_opts);
+    CuMatrix<BaseFloat> cu_loglikes(loglikes);
+    Lattice cu_path;
+    bool cu_reached_final;
+    bool cu_ans = cu_decoder.Decode(cu_loglikes, &cu_path, &cu_reached_final);
+    std::vector<int32> cu_ilabels, cu_olabels;
+    LatticeWeight cu_weight;
+    if (cu_ans) {
+      KALDI_ASSERT(GetLinearSymbolSequence(cu_path, &cu_ilabels, &cu_olabels,
+                                           &cu_weight));
+      KALDI_ASSERT(cu_ilabels.size() == static_cast<size_t>(num_frames));
+    }
+    if (!exact) continue;
+
+    FasterDecoderOptions opts;
+    opts.beam = beam;
+    opts.max_active = std::numeric_limits<int32>::max();
+    opts.min_active = 0;
+    FasterDecoder decoder(fst, opts);
+    DecodableMatrixScaledMapped decodable(*trans_model, loglikes, 1.0);
+    decoder.Decode(&decodable);
+    Lattice path;
+    bool ans = decoder.GetBestPath(&path);
+    KALDI_ASSERT(ans == cu_ans);
+    if (!ans) continue;
+    KALDI_ASSERT(decoder.ReachedFinal() == cu_reached_final);
+    std::vector<int32> ilabels, olabels;
+    LatticeWeight weight;
+    KALDI_ASSERT(GetLinearSymbolSequence(path, &ilabels, &olabels, &weight));
+    KALDI_ASSERT(ApproxEqual(weight.Value1() + weight.Value2(),
+                             cu_weight.Value1() + cu_weight.Value2(),
+                             1.0e-04));
+  }
+  delete trans_model;
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 loop = 0; loop < 2; loop++) {
+#if HAVE_CUDA == 1
+    if (loop == 0)
+      CuDevice::Instantiate().SelectGpuId("no");
+    else
+      CuDevice::Instantiate().SelectGpuId("optional");
+#endif
+    UnitTestCuFasterDecoder();
+    if (loop == 0)
+      KALDI_LOG << "Tests without GPU use succeeded.";
+    else
+      KALDI_LOG << "Tests with GPU use (if available) succeeded.";
+#if HAVE_CUDA != 1
+    break;
+#endif
+  }
+  return 0;
+}
@@ -0,0 +1,116 @@
+// decoder/cu-faster-decoder.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/cu-faster-decoder.h"
+
+namespace kaldi {
+
+CuFasterDecoder::CuFasterDecoder(const fst::Fst<fst::StdArc> &fst,
+                                 const TransitionModel &trans_model,
+                                 const CuViterbiDecoderOptions &opts) {
+  typedef fst::StdArc::StateId StateId;
+  if (fst.Start() == fst::kNoStateId)
+    KALDI_ERR << "CuFasterDecoder: the decoding graph is empty.";
+  StateId num_states = 0;
+  for (fst::StateIterator<fst::Fst<fst::StdArc> > siter(fst); !siter.Done();
+       siter.Next())
+    num_states = std::max(num_states, siter.Value() + 1);
+  std::vector<BaseFloat> final_costs(num_states,
+                                     std::numeric_limits<BaseFloat>::infinity());
+  std::vector<CuDecodeGraph::Arc> arcs;
+  for (fst::StateIterator<fst::Fst<fst::StdArc> > siter(fst); !siter.Done();
+       siter.Next()) {
+    StateId s = siter.Value();
+    final_costs[s] = fst.Final(s).Value();  // +infinity if not final.
+    for (fst::ArcIterator<fst::Fst<fst::StdArc> > aiter(fst, s); !aiter.Done();
+         aiter.Next()) {
+      const fst::StdArc &arc = aiter.Value();
+      CuDecodeGraph::Arc cu_arc;
+      cu_arc.src = s;
+      cu_arc.dest = arc.nextstate;
+      cu_arc.col = (arc.ilabel == 0 ? -1 :
+                    trans_model.TransitionIdToPdf(arc.ilabel));
+      cu_arc.ilabel = arc.ilabel;
+      cu_arc.olabel = arc.olabel;
+      cu_arc.cost = arc.weight.Value();
+      arcs.push_back(cu_arc);
+    }
+  }
+  graph_ = new CuDecodeGraph(num_states, fst.Start(), arcs, final_costs);
+  decoder_ = new CuViterbiDecoder(*graph_, opts);
+}
+
+CuFasterDecoder::~CuFasterDecoder() {
+  delete decoder_;
+  delete graph_;
+}
+
+void CuFasterDecoder::DecodeBatch(
+    const std::vector<const CuMatrixBase<BaseFloat>*> &loglikes,
+    std::vector<Lattice> *best_paths,
+    std::vector<bool> *reached_final) {
+  std::vector<std::vector<CuDecodeGraph::Arc> > paths;
+  std::vector<BaseFloat> costs;
+  decoder_->DecodeBatch(loglikes, &paths, &costs, reached_final);
+  best_paths->resize(loglikes.size());
+  for (size_t u = 0; u < loglikes.size(); u++) {
+    Lattice &lat = (*best_paths)[u];
+    lat.DeleteStates();
+    if (costs[u] == std::numeric_limits<BaseFloat>::infinity())
+      continue;
+    // We need the log-likelihoods on the CPU to separate out the acoustic
+    // costs; this is small compared with the decoding.
+    Matrix<BaseFloat> this_loglikes(*(loglikes[u]));
+    const std::vector<CuDecodeGraph::Arc> &path = paths[u];
+    Lattice::StateId cur_state = lat.AddState();
+    lat.SetStart(cur_state);
+    int32 t = 0;
+    for (size_t i = 0; i < path.size(); i++) {
+      BaseFloat ac_cost = 0.0;
+      if (path[i].col >= 0)
+        ac_cost = -this_loglikes(t++, path[i].col);
+      Lattice::StateId next_state = lat.AddState();
+      lat.AddArc(cur_state, LatticeArc(path[i].ilabel, path[i].olabel,
+                                       LatticeWeight(path[i].cost, ac_cost),
+                                       next_state));
+      cur_state = next_state;
+    }
+    KALDI_ASSERT(t == this_loglikes.NumRows());
+    if ((*reached_final)[u])
+      lat.SetFinal(cur_state,
+                   LatticeWeight(graph_->FinalCost(path.empty() ?
+                                                   graph_->Start() :
+                                                   path.back().dest), 0.0));
+    else
+      lat.SetFinal(cur_state, LatticeWeight::One());
+  }
+}
+
+bool CuFasterDecoder::Decode(const CuMatrixBase<BaseFloat> &loglikes,
+                             Lattice *best_path, bool *reached_final) {
+  std::vector<const CuMatrixBase<BaseFloat>*> loglikes_vec(1, &loglikes);
+  std::vector<Lattice> best_paths;
+  std::vector<bool> reached_final_vec;
+  DecodeBatch(loglikes_vec, &best_paths, &reached_final_vec);
+  *best_path = best_paths[0];
+  *reached_final = reached_final_vec[0];
+  return best_path->Start() != fst::kNoStateId;
+}
+
+}  // namespace kaldi
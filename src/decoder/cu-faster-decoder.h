@@ -0,0 +1,75 @@
+// decoder/cu-faster-decoder.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_CU_FASTER_DECODER_H_
+#define KALDI_DECODER_CU_FASTER_DECODER_H_
+
+#include <vector>
+#include "fst/fstlib.h"
+#include "hmm/transition-model.h"
+#include "lat/kaldi-lattice.h"
+#include "cudamatrix/cu-viterbi-decoder.h"
+
+namespace kaldi {
+
+/**
+   CuFasterDecoder decodes with a graph such as HCLG, whose input labels are
+   transition-ids, on the GPU if we have one (see CuViterbiDecoder in
+   ../cudamatrix/cu-viterbi-decoder.h).  Unlike FasterDecoder it does not take
+   a DecodableInterface: the input is a matrix of (already scaled)
+   log-likelihoods indexed by pdf-id, e.g. the output of a neural net, which
+   can stay on the GPU.  The output is the best path, as a linear lattice in
+   the same format as FasterDecoder::GetBestPath(), with the graph and acoustic
+   costs separated; lattice generation is not supported.
+ */
+class CuFasterDecoder {
+ public:
+  /// The graph is converted to the decoder's representation (and copied to
+  /// the GPU) here, so the FST is not needed afterwards.
+  CuFasterDecoder(const fst::Fst<fst::StdArc> &fst,
+                  const TransitionModel &trans_model,
+                  const CuViterbiDecoderOptions &opts);
+
+  ~CuFasterDecoder();
+
+  /// Decodes several utterances together; this makes better use of the GPU
+  /// than decoding them one by one.  (*best_paths)[i] is set to the best path
+  /// of utterance i; if it did not reach a final state, the best path is to
+  /// any state (as FasterDecoder does), and (*reached_final)[i] is false.  If
+  /// the search failed, the lattice is empty.
+  void DecodeBatch(const std::vector<const CuMatrixBase<BaseFloat>*> &loglikes,
+                   std::vector<Lattice> *best_paths,
+                   std::vector<bool> *reached_final);
+
+  /// Decodes one utterance; returns true if it got output.
+  bool Decode(const CuMatrixBase<BaseFloat> &loglikes,
+              Lattice *best_path, bool *reached_final);
+
+  const CuDecodeGraph &Graph() const { return *graph_; }
+
+ private:
+  CuDecodeGraph *graph_;
+  CuViterbiDecoder *decoder_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CuFasterDecoder);
+};
+
+
+}  // namespace kaldi
+
+#endif  // KALDI_DECODER_CU_FASTER_DECODER_H_
@@ -0,0 +1,136 @@
+// decoder/decodable-am-diag-gmm-regtree-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+// This tests code in transform/, but it is here because it needs the
+// TransitionModel, and the transform library does not link against hmm/.
+
+#include "gmm/model-test-common.h"
+#include "transform/decodable-am-diag-gmm-regtree.h"
+#include "tree/context-dep.h"
+
+namespace kaldi {
+
+// Returns a monophone model for phones 1 to 5, with 3-state HMMs.
+TransitionModel *GenTestTransitionModel() {
+  std::string topo_str = "<Topology>\n"
+      "<TopologyEntry>\n"
+      "<ForPhones> 1 2 3 4 5 </ForPhones>\n"
+      "<State> 0 <PdfClass> 0 <Transition> 0 0.5 <Transition> 1 0.5 </State>\n"
+      "<State> 1 <PdfClass> 1 <Transition> 1 0.5 <Transition> 2 0.5 </State>\n"
+      "<State> 2 <PdfClass> 2 <Transition> 2 0.5 <Transition> 3 0.5 </State>\n"
+      "<State> 3 </State>\n"
+      "</TopologyEntry>\n"
+      "</Topology>\n";
+  HmmTopology topo;
+  std::istringstream iss(topo_str);
+  topo.Read(iss, false);
+  std::vector<int32> phones, phone2num_pdf_classes(6, 3);
+  for (int32 p = 1; p <= 5; p++) phones.push_back(p);
+  ContextDependency *ctx_dep =
+      MonophoneContextDependency(phones, phone2num_pdf_classes);
+  TransitionModel *trans_model = new TransitionModel(*ctx_dep, topo);
+  delete ctx_dep;
+  return trans_model;
+}
+
+// Sets "mat" (dim by dim+1) to a random affine transform near the identity.
+void RandAffineXform(int32 dim, Matrix<BaseFloat> *mat) {
+  mat->Resize(dim, dim + 1);
+  mat->SetRandn();
+  mat->Scale(0.1);
+  for (int32 d = 0; d < dim; d++)
+    (*mat)(d, d) += 1.0;
+}
+
+// Checks that LogLikelihoods() on a list of transition-ids (in random order,
+// with repeats) gives the same as LogLikelihood() on each of them, for both
+// regression-tree decodables.
+void UnitTestDecodableAmDiagGmmRegtree() {
+  TransitionModel *trans_model = GenTestTransitionModel();
+  int32 num_pdfs = trans_model->NumPdfs(),
+      num_tids = trans_model->NumTransitionIds(),
+      dim = 1 + rand() % 10, num_frames = 1 + rand() % 20;
+  AmDiagGmm am;
+  for (int32 p = 0; p < num_pdfs; p++) {
+    DiagGmm gmm;
+    unittest::InitRandDiagGmm(dim, 1 + rand() % 5, &gmm);
+    am.AddPdf(gmm);
+  }
+  am.ComputeGconsts();
+  RegressionTree regtree;
+  Vector<BaseFloat> occs(num_pdfs);
+  occs.Set(100.0);
+  std::vector<int32> sil_pdfs;
+  regtree.BuildTree(occs, sil_pdfs, am, 1 + rand() % 4);
+  // Each base class gets one of two transforms.
+  int32 num_xforms = 2;
+  std::vector<int32> bclass2xforms(regtree.NumBaseclasses());
+  for (size_t i = 0; i < bclass2xforms.size(); i++)
+    bclass2xforms[i] = rand() % num_xforms;
+  RegtreeFmllrDiagGmm fmllr;
+  RegtreeMllrDiagGmm mllr;
+  fmllr.Init(num_xforms, dim);
+  mllr.Init(num_xforms, dim);
+  for (int32 i = 0; i < num_xforms; i++) {
+    Matrix<BaseFloat> mat;
+    RandAffineXform(dim, &mat);
+    fmllr.SetParameters(mat, i);
+    RandAffineXform(dim, &mat);
+    mllr.SetParameters(mat, i);
+  }
+  fmllr.set_bclass2xforms(bclass2xforms);
+  mllr.set_bclass2xforms(bclass2xforms);
+  fmllr.ComputeLogDets();
+
+  Matrix<BaseFloat> feats(num_frames, dim);
+  feats.SetRandn();
+  BaseFloat scale = 0.1;
+  std::vector<int32> tids;
+  for (int32 i = 0; i < 2 * num_tids; i++)
+    tids.push_back(1 + rand() % num_tids);
+
+  // Separate objects for the batched and per-arc calls, so that neither sees
+  // values cached by the other.
+  DecodableAmDiagGmmRegtreeFmllr fmllr_batched(am, *trans_model, feats, fmllr,
+                                               regtree, scale),
+      fmllr_single(am, *trans_model, feats, fmllr, regtree, scale);
+  DecodableAmDiagGmmRegtreeMllr mllr_batched(am, *trans_model, feats, mllr,
+                                             regtree, scale),
+      mllr_single(am, *trans_model, feats, mllr, regtree, scale);
+  for (int32 frame = 0; frame < num_frames; frame++) {
+    std::vector<BaseFloat> fmllr_likes, mllr_likes;
+    fmllr_batched.LogLikelihoods(frame, tids, &fmllr_likes);
+    mllr_batched.LogLikelihoods(frame, tids, &mllr_likes);
+    KALDI_ASSERT(fmllr_likes.size() == tids.size() &&
+                 mllr_likes.size() == tids.size());
+    for (size_t i = 0; i < tids.size(); i++) {
+      AssertEqual(fmllr_likes[i], fmllr_single.LogLikelihood(frame, tids[i]));
+      AssertEqual(mllr_likes[i], mllr_single.LogLikelihood(frame, tids[i]));
+    }
+  }
+  delete trans_model;
+}
+
+}  // namespace kaldi
+
+int main() {
+  for (kaldi::int32 i = 0; i < 10; i++)
+    kaldi::UnitTestDecodableAmDiagGmmRegtree();
+  std::cout << "Test OK.\n";
+}
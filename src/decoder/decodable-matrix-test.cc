@@ -0,0 +1,93 @@
+// decoder/decodable-matrix-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/decodable-matrix.h"
+#include "tree/context-dep.h"
+
+namespace kaldi {
+
+// Returns a monophone model for phones 1 to 5, with 3-state HMMs.
+TransitionModel *GenTestTransitionModel() {
+  std::string topo_str = "<Topology>\n"
+      "<TopologyEntry>\n"
+      "<ForPhones> 1 2 3 4 5 </ForPhones>\n"
+      "<State> 0 <PdfClass> 0 <Transition> 0 0.5 <Transition> 1 0.5 </State>\n"
+      "<State> 1 <PdfClass> 1 <Transition> 1 0.5 <Transition> 2 0.5 </State>\n"
+      "<State> 2 <PdfClass> 2 <Transition> 2 0.5 <Transition> 3 0.5 </State>\n"
+      "<State> 3 </State>\n"
+      "</TopologyEntry>\n"
+      "</Topology>\n";
+  HmmTopology topo;
+  std::istringstream iss(topo_str);
+  topo.Read(iss, false);
+  std::vector<int32> phones, phone2num_pdf_classes(6, 3);
+  for (int32 p = 1; p <= 5; p++) phones.push_back(p);
+  ContextDependency *ctx_dep =
+      MonophoneContextDependency(phones, phone2num_pdf_classes);
+  TransitionModel *trans_model = new TransitionModel(*ctx_dep, topo);
+  delete ctx_dep;
+  return trans_model;
+}
+
+// Checks that DecodableRowCompressedMatrixScaledMapped gives the same
+// log-likelihoods as DecodableMatrixScaledMapped on the uncompressed matrix,
+// whether the frames are visited in order or not.
+void UnitTestDecodableRowCompressedMatrix() {
+  TransitionModel *trans_model = GenTestTransitionModel();
+  int32 num_pdfs = trans_model->NumPdfs(),
+      num_tids = trans_model->NumTransitionIds();
+  for (int32 i = 0; i < 10; i++) {
+    int32 num_frames = 1 + rand() % 100;
+    Matrix<BaseFloat> loglikes(num_frames, num_pdfs);
+    loglikes.SetRandn();
+    loglikes.Scale(10.0);
+    RowCompressedMatrix compressed(loglikes);
+    Matrix<BaseFloat> uncompressed(num_frames, num_pdfs);
+    compressed.CopyToMat(&uncompressed);
+    BaseFloat scale = 0.1;
+    DecodableMatrixScaledMapped decodable(*trans_model, uncompressed, scale);
+    DecodableRowCompressedMatrixScaledMapped
+        compressed_decodable(*trans_model, compressed, scale);
+    KALDI_ASSERT(compressed_decodable.NumFrames() == num_frames &&
+                 compressed_decodable.NumIndices() == num_tids &&
+                 compressed_decodable.IsLastFrame(num_frames - 1));
+    std::vector<int32> tids;
+    for (int32 tid = 1; tid <= num_tids; tid++)
+      tids.push_back(tid);
+    for (int32 j = 0; j < 2 * num_frames; j++) {
+      // first in order, then in random order.
+      int32 frame = (j < num_frames ? j : rand() % num_frames);
+      std::vector<BaseFloat> log_likes;
+      compressed_decodable.LogLikelihoods(frame, tids, &log_likes);
+      for (int32 tid = 1; tid <= num_tids; tid++) {
+        BaseFloat a = decodable.LogLikelihood(frame, tid);
+        KALDI_ASSERT(compressed_decodable.LogLikelihood(frame, tid) == a &&
+                     log_likes[tid - 1] == a);
+      }
+    }
+  }
+  delete trans_model;
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::UnitTestDecodableRowCompressedMatrix();
+  std::cout << "Test OK.\n";
+}
@@ -25,6 +25,7 @@
 
 #include "base/kaldi-common.h"
 #include "hmm/transition-model.h"
+#include "matrix/compressed-matrix.h"
 #include "itf/decodable-itf.h"
 
 namespace kaldi {
@@ -66,7 +67,15 @@ class DecodableMatrixScaledMapped: public DecodableInterface {
 
   // Note, frames are numbered from zero.
   virtual BaseFloat LogLikelihood(int32 frame, int32 tid) {
-    return scale_ * (*likes_)(frame, trans_model_.TransitionIdToPdf(tid));
+    return scale_ * (*likes_)(frame, trans_model_.TransitionIdToPdfFast(tid));
+  }
+
+  virtual void LogLikelihoods(int32 frame, const std::vector<int32> &tids,
+                              std::vector<BaseFloat> *log_likes) {
+    const BaseFloat *row = likes_->RowData(frame);
+    log_likes->resize(tids.size());
+    for (size_t i = 0; i < tids.size(); i++)
+      (*log_likes)[i] = scale_ * row[trans_model_.TransitionIdToPdfFast(tids[i])];
   }
 
   // Indices are one-based!  This is for compatibility with OpenFst.
@@ -84,6 +93,93 @@ class DecodableMatrixScaledMapped: public DecodableInterface {
 };
 
 
+/// This is like DecodableMatrixScaledMapped, but the log-likelihoods are
+/// stored as a RowCompressedMatrix (about one byte per element instead of
+/// four), and are uncompressed one block of RowCompressedMatrix::kRowsPerBlock
+/// frames at a time as the decoder asks for them.  The decoder visits the
+/// frames in order, so each block is uncompressed once.
+class DecodableRowCompressedMatrixScaledMapped: public DecodableInterface {
+ public:
+  // This constructor creates an object that will not delete "likes"
+  // when done.
+  DecodableRowCompressedMatrixScaledMapped(const TransitionModel &tm,
+                                           const RowCompressedMatrix &likes,
+                                           BaseFloat scale):
+      trans_model_(tm), likes_(&likes), scale_(scale), delete_likes_(false),
+      cache_offset_(-1) { Init(); }
+
+  // This constructor creates an object that will delete "likes"
+  // when done.
+  DecodableRowCompressedMatrixScaledMapped(const TransitionModel &tm,
+                                           BaseFloat scale,
+                                           const RowCompressedMatrix *likes):
+      trans_model_(tm), likes_(likes), scale_(scale), delete_likes_(true),
+      cache_offset_(-1) { Init(); }
+
+  virtual int32 NumFrames() { return likes_->NumRows(); }
+
+  virtual bool IsLastFrame(int32 frame) {
+    KALDI_ASSERT(frame < NumFrames());
+    return (frame == NumFrames() - 1);
+  }
+
+  // Note, frames are numbered from zero.
+  virtual BaseFloat LogLikelihood(int32 frame, int32 tid) {
+    return scale_ * GetRow(frame)[trans_model_.TransitionIdToPdfFast(tid)];
+  }
+
+  virtual void LogLikelihoods(int32 frame, const std::vector<int32> &tids,
+                              std::vector<BaseFloat> *log_likes) {
+    const BaseFloat *row = GetRow(frame);
+    log_likes->resize(tids.size());
+    for (size_t i = 0; i < tids.size(); i++)
+      (*log_likes)[i] = scale_ * row[trans_model_.TransitionIdToPdfFast(tids[i])];
+  }
+
+  // Indices are one-based!  This is for compatibility with OpenFst.
+  virtual int32 NumIndices() { return trans_model_.NumTransitionIds(); }
+
+  virtual ~DecodableRowCompressedMatrixScaledMapped() {
+    if (delete_likes_) delete likes_;
+  }
+ private:
+  void Init() {
+    if (likes_->NumCols() != trans_model_.NumPdfs())
+      KALDI_ERR << "DecodableRowCompressedMatrixScaledMapped: mismatch, matrix "
+                << "has " << likes_->NumCols() << " columns but transition-model "
+                << "has " << trans_model_.NumPdfs() << " pdf-ids.";
+    cache_.Resize(std::min<int32>(RowCompressedMatrix::kRowsPerBlock,
+                                  likes_->NumRows()),
+                  likes_->NumCols(), kUndefined);
+  }
+
+  // Returns the log-likelihoods for this frame, uncompressing its block of
+  // rows into cache_ if it is not already there.
+  inline const BaseFloat *GetRow(int32 frame) {
+    KALDI_PARANOID_ASSERT(frame >= 0 && frame < likes_->NumRows());
+    if (cache_offset_ < 0 || frame < cache_offset_ ||
+        frame >= cache_offset_ + cache_.NumRows()) {
+      const int32 block_size = RowCompressedMatrix::kRowsPerBlock;
+      cache_offset_ = (frame / block_size) * block_size;
+      SubMatrix<BaseFloat> block(cache_, 0,
+                                 std::min(block_size,
+                                          likes_->NumRows() - cache_offset_),
+                                 0, cache_.NumCols());
+      likes_->CopyRowsToMat(cache_offset_, &block);
+    }
+    return cache_.RowData(frame - cache_offset_);
+  }
+
+  const TransitionModel &trans_model_;  // for tid to pdf mapping
+  const RowCompressedMatrix *likes_;
+  BaseFloat scale_;
+  bool delete_likes_;
+  Matrix<BaseFloat> cache_;  // holds rows cache_offset_ onward.
+  int32 cache_offset_;  // -1 if nothing cached yet.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableRowCompressedMatrixScaledMapped);
+};
+
+
 class DecodableMatrixScaled: public DecodableInterface {
  public:
   DecodableMatrixScaled(const Matrix<BaseFloat> &likes,
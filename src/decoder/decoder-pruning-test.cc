@@ -0,0 +1,116 @@
+// decoder/decoder-pruning-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/decoder-pruning.h"
+
+namespace kaldi {
+
+// Checks the histogram cutoff against the exact one: it should keep no more
+// than max_active costs, and be within one bin-width of the exact cutoff.
+void UnitTestHistogramPruner() {
+  for (int32 i = 0; i < 50; i++) {
+    int32 num_costs = 1 + rand() % 2000,
+        max_active = 2 + rand() % 500,
+        min_active = rand() % max_active,
+        num_bins = 1 + rand() % 1000;
+    BaseFloat beam = 1.0 + 15.0 * RandUniform(), beam_delta = 0.5,
+        offset = 100.0 * RandGauss();
+    std::vector<BaseFloat> costs(num_costs);
+    BaseFloat best_cost = std::numeric_limits<BaseFloat>::infinity();
+    for (int32 j = 0; j < num_costs; j++) {
+      costs[j] = offset + 5.0 * std::abs(RandGauss());
+      best_cost = std::min(best_cost, costs[j]);
+    }
+    HistogramPruner exact, histogram(num_bins);
+    for (int32 j = 0; j < num_costs; j++) {
+      exact.Add(costs[j]);
+      histogram.Add(costs[j]);
+    }
+    BaseFloat exact_beam, histogram_beam,
+        exact_cutoff = exact.GetCutoff(best_cost, beam, max_active, min_active,
+                                       beam_delta, &exact_beam),
+        histogram_cutoff = histogram.GetCutoff(best_cost, beam, max_active,
+                                               min_active, beam_delta,
+                                               &histogram_beam);
+    int32 num_kept = 0;
+    for (int32 j = 0; j < num_costs; j++)
+      if (costs[j] <= histogram_cutoff) num_kept++;
+    if (histogram_cutoff < best_cost + beam)
+      KALDI_ASSERT(num_kept <= max_active || histogram_cutoff == best_cost);
+    KALDI_ASSERT(num_kept >= std::min(num_costs, min_active));
+    KALDI_ASSERT(histogram_cutoff <= exact_cutoff + 1.0e-04 &&
+                 histogram_cutoff >= exact_cutoff - beam / num_bins - 1.0e-04);
+    KALDI_ASSERT(std::abs((histogram_cutoff - best_cost) -
+                          (histogram_beam - (histogram_cutoff < best_cost + beam ?
+                                             beam_delta : 0.0))) < 1.0e-03 ||
+                 histogram_cutoff > best_cost + beam);
+    KALDI_ASSERT(exact_beam >= 0.0);
+    // Without max-active the two should agree exactly.
+    HistogramPruner exact2, histogram2(num_bins);
+    for (int32 j = 0; j < num_costs; j++) {
+      exact2.Add(costs[j]);
+      histogram2.Add(costs[j]);
+    }
+    int32 no_max = std::numeric_limits<int32>::max();
+    KALDI_ASSERT(exact2.GetCutoff(best_cost, beam, no_max, min_active,
+                                  beam_delta, NULL) ==
+                 histogram2.GetCutoff(best_cost, beam, no_max, min_active,
+                                      beam_delta, NULL));
+  }
+}
+
+void UnitTestAdaptiveBeamController() {
+  AdaptiveBeamOptions opts;
+  AdaptiveBeamController controller;
+  controller.Init(opts, 13.0);
+  KALDI_ASSERT(!controller.Enabled());
+
+  opts.target_active = 1000;
+  opts.min_beam = 5.0;
+  controller.Init(opts, 13.0);
+  KALDI_ASSERT(controller.Enabled() && controller.Beam() == 13.0);
+  // Too many tokens: the beam comes down, but not below min_beam.
+  for (int32 i = 0; i < 100; i++) {
+    BaseFloat beam = controller.Beam();
+    controller.Update(5000);
+    KALDI_ASSERT(controller.Beam() <= beam &&
+                 controller.Beam() >= beam - opts.gain - 1.0e-05);
+  }
+  KALDI_ASSERT(controller.Beam() == opts.min_beam);
+  // Too few: it goes back up, but not above the configured beam.
+  for (int32 i = 0; i < 100; i++)
+    controller.Update(10);
+  KALDI_ASSERT(controller.Beam() == 13.0);
+  // On target: it stays where it is.
+  controller.Init(opts, 13.0);
+  controller.Update(5000);
+  BaseFloat beam = controller.Beam();
+  controller.Update(1000);
+  KALDI_ASSERT(controller.Beam() == beam);
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestHistogramPruner();
+  UnitTestAdaptiveBeamController();
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
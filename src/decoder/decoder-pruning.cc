@@ -0,0 +1,147 @@
+// decoder/decoder-pruning.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <limits>
+#include "decoder/decoder-pruning.h"
+
+namespace kaldi {
+
+BaseFloat HistogramPruner::NthBestCost(size_t n, size_t end) {
+  KALDI_ASSERT(n < end && end <= costs_.size());
+  std::nth_element(costs_.begin(), costs_.begin() + n, costs_.begin() + end);
+  return costs_[n];
+}
+
+BaseFloat HistogramPruner::HistogramCutoff(BaseFloat best_cost, BaseFloat beam,
+                                           size_t max_active) {
+  bins_.assign(num_bins_, 0);
+  BaseFloat beam_cutoff = best_cost + beam,
+      inv_width = num_bins_ / beam;
+  int32 last_bin = num_bins_ - 1;
+  size_t num_in_beam = 0;
+  for (std::vector<BaseFloat>::const_iterator iter = costs_.begin(),
+           end = costs_.end(); iter != end; ++iter) {
+    BaseFloat cost = *iter;
+    if (cost < beam_cutoff) {
+      int32 bin = static_cast<int32>((cost - best_cost) * inv_width);
+      bins_[std::min(bin, last_bin)]++;
+      num_in_beam++;
+    }
+  }
+  if (num_in_beam <= max_active)
+    return std::numeric_limits<BaseFloat>::infinity();
+  size_t count = 0;
+  int32 bin = 0;
+  for (; bin < last_bin; bin++) {
+    if (count + bins_[bin] > max_active) break;
+    count += bins_[bin];
+  }
+  return best_cost + bin * (beam / num_bins_);
+}
+
+BaseFloat HistogramPruner::GetCutoff(BaseFloat best_cost, BaseFloat beam,
+                                     int32 max_active, int32 min_active,
+                                     BaseFloat beam_delta,
+                                     BaseFloat *adaptive_beam) {
+  size_t num_costs = costs_.size();
+  BaseFloat beam_cutoff = best_cost + beam,
+      min_active_cutoff = std::numeric_limits<BaseFloat>::infinity(),
+      max_active_cutoff = std::numeric_limits<BaseFloat>::infinity();
+
+  if (num_costs > static_cast<size_t>(max_active)) {
+    if (num_bins_ > 0)
+      max_active_cutoff = HistogramCutoff(best_cost, beam, max_active);
+    else
+      max_active_cutoff = NthBestCost(max_active, num_costs);
+  }
+  if (max_active_cutoff >= beam_cutoff &&
+      num_costs > static_cast<size_t>(min_active)) {
+    // min_active can only matter if max_active did not.  With the exact
+    // cutoff, the elements before position max_active are already the
+    // max_active best ones, so the search can be limited to those.
+    if (min_active == 0) {
+      min_active_cutoff = best_cost;
+    } else {
+      size_t end = (num_bins_ == 0 &&
+                    num_costs > static_cast<size_t>(max_active) ?
+                    max_active : num_costs);
+      min_active_cutoff = NthBestCost(min_active, end);
+    }
+  }
+
+  if (max_active_cutoff < beam_cutoff) { // max_active is tighter than beam.
+    if (adaptive_beam)
+      *adaptive_beam = max_active_cutoff - best_cost + beam_delta;
+    return max_active_cutoff;
+  } else if (min_active_cutoff > beam_cutoff) { // min_active is looser than beam.
+    if (adaptive_beam)
+      *adaptive_beam = min_active_cutoff - best_cost + beam_delta;
+    return min_active_cutoff;
+  } else {
+    if (adaptive_beam)
+      *adaptive_beam = beam;
+    return beam_cutoff;
+  }
+}
+
+
+void AdaptiveBeamController::Init(const AdaptiveBeamOptions &opts,
+                                  BaseFloat max_beam) {
+  opts.Check();
+  opts_ = opts;
+  enabled_ = opts.Enabled();
+  max_beam_ = max_beam;
+  beam_ = max_beam;
+  frame_seconds_ = -1.0;
+  timer_.Reset();
+}
+
+void AdaptiveBeamController::Update(size_t num_active) {
+  if (!enabled_) return;
+  // "log_ratio" is the log of (target / measured) for whichever target wants
+  // the smaller beam; the number of active tokens grows roughly exponentially
+  // with the beam, and so does the time per frame.
+  BaseFloat log_ratio = std::numeric_limits<BaseFloat>::infinity();
+  if (opts_.target_active > 0 && num_active > 0)
+    log_ratio = Log(static_cast<BaseFloat>(opts_.target_active) / num_active);
+  if (opts_.target_rtf > 0.0) {
+    double elapsed = timer_.Elapsed();
+    timer_.Reset();
+    if (frame_seconds_ < 0.0) {
+      // The first call just starts the timer.
+      frame_seconds_ = 0.0;
+    } else {
+      frame_seconds_ = (frame_seconds_ == 0.0 ? elapsed :
+                        0.9 * frame_seconds_ + 0.1 * elapsed);
+      if (frame_seconds_ > 0.0)
+        log_ratio = std::min(log_ratio, static_cast<BaseFloat>(
+            Log(opts_.target_rtf * opts_.frame_shift / frame_seconds_)));
+    }
+  }
+  if (log_ratio == std::numeric_limits<BaseFloat>::infinity()) return;
+  BaseFloat step = opts_.gain * log_ratio;
+  step = std::max(-opts_.gain, std::min(opts_.gain, step));
+  beam_ = std::max(opts_.min_beam, std::min(max_beam_, beam_ + step));
+  KALDI_VLOG(4) << "Adaptive beam is " << beam_ << " with " << num_active
+                << " active tokens.";
+}
+
+
+}  // namespace kaldi
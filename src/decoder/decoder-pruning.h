@@ -0,0 +1,143 @@
+// decoder/decoder-pruning.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_DECODER_PRUNING_H_
+#define KALDI_DECODER_DECODER_PRUNING_H_
+
+#include <vector>
+#include "base/kaldi-common.h"
+#include "itf/options-itf.h"
+#include "util/timer.h"
+
+namespace kaldi {
+
+/// HistogramPruner works out the per-frame cost cutoff of the faster decoders
+/// (the "GetCutoff" functions), taking into account the beam and the
+/// max-active and min-active constraints.  The decoder calls Add() for the
+/// cost of each active token while it looks for the best one, and then
+/// GetCutoff().  If num_bins > 0, the max-active cutoff is read off a
+/// histogram of the costs within the beam, with num_bins bins, instead of
+/// being found by std::nth_element; this is one more linear pass over the
+/// costs with no data movement.  The cutoff is then the lower edge of the bin
+/// in which the max_active'th best cost falls, so it keeps no more than
+/// max_active tokens and may keep up to one bin-width (beam / num_bins) less.
+/// If num_bins == 0 the cutoffs are exact, as before.
+class HistogramPruner {
+ public:
+  explicit HistogramPruner(int32 num_bins = 0): num_bins_(num_bins) { }
+
+  void SetNumBins(int32 num_bins) { num_bins_ = num_bins; }
+
+  void Clear() { costs_.clear(); }
+
+  inline void Add(BaseFloat cost) { costs_.push_back(cost); }
+
+  size_t Size() const { return costs_.size(); }
+
+  /// Returns the cost cutoff given the best cost among those added.  Outputs
+  /// the "adaptive beam" (the beam that the cutoff corresponds to, plus
+  /// beam_delta if max-active or min-active was the limiting factor), which
+  /// the decoders use to prune the next frame before its cutoff is known.
+  BaseFloat GetCutoff(BaseFloat best_cost, BaseFloat beam,
+                      int32 max_active, int32 min_active,
+                      BaseFloat beam_delta, BaseFloat *adaptive_beam);
+
+ private:
+  // Returns the n'th best (zero-based) of the first "end" elements of costs_;
+  // it reorders costs_.
+  BaseFloat NthBestCost(size_t n, size_t end);
+
+  // Returns the approximate max-active cutoff from the histogram, or infinity
+  // if no more than max_active costs are within the beam.
+  BaseFloat HistogramCutoff(BaseFloat best_cost, BaseFloat beam,
+                            size_t max_active);
+
+  int32 num_bins_;
+  std::vector<BaseFloat> costs_;
+  std::vector<int32> bins_;
+};
+
+
+struct AdaptiveBeamOptions {
+  int32 target_active;
+  BaseFloat target_rtf;
+  BaseFloat frame_shift;
+  BaseFloat min_beam;
+  BaseFloat gain;
+  AdaptiveBeamOptions(): target_active(0), target_rtf(0.0),
+                         frame_shift(0.01), min_beam(4.0), gain(0.25) { }
+  void Register(OptionsItf *po) {
+    po->Register("adaptive-beam-target-active", &target_active,
+                 "If >0, the decoder narrows or widens its beam (never beyond "
+                 "--beam) from frame to frame to keep roughly this many "
+                 "tokens active.");
+    po->Register("adaptive-beam-target-rtf", &target_rtf,
+                 "If >0, the decoder narrows or widens its beam (never beyond "
+                 "--beam) to decode at roughly this real-time factor.");
+    po->Register("adaptive-beam-frame-shift", &frame_shift,
+                 "Frame shift in seconds, used with --adaptive-beam-target-rtf.");
+    po->Register("adaptive-beam-min", &min_beam,
+                 "The smallest beam the adaptive beam may go down to.");
+    po->Register("adaptive-beam-gain", &gain,
+                 "Speed of the adaptive beam: the change in beam per frame, "
+                 "per unit of log-ratio between target and measured values "
+                 "(the change is limited to this value).");
+  }
+  bool Enabled() const { return target_active > 0 || target_rtf > 0.0; }
+  void Check() const {
+    KALDI_ASSERT(target_active >= 0 && target_rtf >= 0.0 &&
+                 frame_shift > 0.0 && min_beam > 0.0 && gain > 0.0);
+  }
+};
+
+/// AdaptiveBeamController varies the decoding beam between
+/// AdaptiveBeamOptions::min_beam and the configured beam so as to keep the
+/// number of active tokens near a target, or the real-time factor near a
+/// target, or both (if both are set it follows whichever wants the smaller
+/// beam).  Each frame, the decoder calls Update() once with the number of
+/// active tokens and uses Beam() in place of its configured beam.  The time
+/// per frame is measured between successive calls of Update() and smoothed,
+/// so a load spike narrows the beam over a few frames rather than at once.
+class AdaptiveBeamController {
+ public:
+  AdaptiveBeamController(): enabled_(false), max_beam_(0.0), beam_(0.0),
+                            frame_seconds_(-1.0) { }
+
+  /// Starts a new utterance, with the beam at max_beam.
+  void Init(const AdaptiveBeamOptions &opts, BaseFloat max_beam);
+
+  bool Enabled() const { return enabled_; }
+
+  BaseFloat Beam() const { return beam_; }
+
+  void Update(size_t num_active);
+
+ private:
+  AdaptiveBeamOptions opts_;
+  bool enabled_;
+  BaseFloat max_beam_;
+  BaseFloat beam_;
+  double frame_seconds_;  // smoothed time per frame; -1 before first frame.
+  Timer timer_;
+};
+
+
+}  // namespace kaldi
+
+#endif  // KALDI_DECODER_DECODER_PRUNING_H_
@@ -19,13 +19,19 @@
 // limitations under the License.
 
 #include "decoder/faster-decoder.h"
+#include "util/kaldi-profile.h"
+#include "hmm/hmm-utils.h"
+#include "fstext/fstext-utils.h"
 
 namespace kaldi {
 
 
 FasterDecoder::FasterDecoder(const fst::Fst<fst::StdArc> &fst,
-                             const FasterDecoderOptions &opts): fst_(fst), config_(opts) {
+                             const FasterDecoderOptions &opts):
+    fst_(&fst), fst_type_(fst::GetDecodingGraphType(fst)), config_(opts),
+    pruner_(opts.histogram_bins) {
   KALDI_ASSERT(config_.hash_ratio >= 1.0);  // less doesn't make much sense.
+  KALDI_ASSERT(config_.histogram_bins >= 0);
   KALDI_ASSERT(config_.max_active > 1);
   KALDI_ASSERT(config_.min_active >= 0 && config_.min_active < config_.max_active);
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
@@ -35,7 +41,8 @@ FasterDecoder::FasterDecoder(const fst::Fst<fst::StdArc> &fst,
 void FasterDecoder::Decode(DecodableInterface *decodable) {
   // clean up from last time:
   ClearToks(toks_.Clear());
-  StateId start_state = fst_.Start();
+  beam_controller_.Init(config_.adaptive_beam, config_.beam);
+  StateId start_state = fst_->Start();
   KALDI_ASSERT(start_state != fst::kNoStateId);
   Arc dummy_arc(0, 0, Weight::One(), start_state);
   toks_.Insert(start_state, new Token(dummy_arc, NULL));
@@ -48,7 +55,7 @@ void FasterDecoder::Decode(DecodableInterface *decodable) {
 
 bool FasterDecoder::ReachedFinal() {
   for (Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
-    Weight this_weight = Times(e->val->weight_, fst_.Final(e->key));
+    Weight this_weight = Times(e->val->weight_, fst_->Final(e->key));
     if (this_weight != Weight::Zero())
       return true;
   }
@@ -71,7 +78,7 @@ bool FasterDecoder::GetBestPath(fst::MutableFst<LatticeArc> *fst_out) {
   } else {
     Weight best_weight = Weight::Zero();
     for (Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
-      Weight this_weight = Times(e->val->weight_, fst_.Final(e->key));
+      Weight this_weight = Times(e->val->weight_, fst_->Final(e->key));
       if (this_weight != Weight::Zero() &&
           this_weight.Value() < best_weight.Value()) {
         best_weight = this_weight;
@@ -94,7 +101,7 @@ bool FasterDecoder::GetBestPath(fst::MutableFst<LatticeArc> *fst_out) {
                      tok->arc_.nextstate);
     arcs_reverse.push_back(l_arc);
   }
-  KALDI_ASSERT(arcs_reverse.back().nextstate == fst_.Start());
+  KALDI_ASSERT(arcs_reverse.back().nextstate == fst_->Start());
   arcs_reverse.pop_back();  // that was a "fake" token... gives no info.
 
   StateId cur_state = fst_out->AddState();
@@ -106,7 +113,7 @@ bool FasterDecoder::GetBestPath(fst::MutableFst<LatticeArc> *fst_out) {
     cur_state = arc.nextstate;
   }
   if (is_final) {
-    Weight final_weight = fst_.Final(best_tok->arc_.nextstate);
+    Weight final_weight = fst_->Final(best_tok->arc_.nextstate);
     fst_out->SetFinal(cur_state, LatticeWeight(final_weight.Value(), 0.0));
   } else {
     fst_out->SetFinal(cur_state, LatticeWeight::One());
@@ -120,6 +127,8 @@ bool FasterDecoder::GetBestPath(fst::MutableFst<LatticeArc> *fst_out) {
 BaseFloat FasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
                                    BaseFloat *adaptive_beam, Elem **best_elem) {
   BaseFloat best_weight = std::numeric_limits<BaseFloat>::infinity();
+  BaseFloat beam = (beam_controller_.Enabled() ? beam_controller_.Beam() :
+                    config_.beam);
   size_t count = 0;
   if (config_.max_active == std::numeric_limits<int32>::max() &&
       config_.min_active == 0) {
@@ -131,53 +140,24 @@ BaseFloat FasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
       }
     }
     if (tok_count != NULL) *tok_count = count;
-    if (adaptive_beam != NULL) *adaptive_beam = config_.beam;
-    return best_weight + config_.beam;
+    if (adaptive_beam != NULL) *adaptive_beam = beam;
+    beam_controller_.Update(count);
+    return best_weight + beam;
   } else {
-    tmp_array_.clear();
+    pruner_.Clear();
     for (Elem *e = list_head; e != NULL; e = e->tail, count++) {
       BaseFloat w = e->val->weight_.Value();
-      tmp_array_.push_back(w);
+      pruner_.Add(w);
       if (w < best_weight) {
         best_weight = w;
         if (best_elem) *best_elem = e;
       }
     }
     if (tok_count != NULL) *tok_count = count;
-    BaseFloat beam_cutoff = best_weight + config_.beam,
-        min_active_cutoff = std::numeric_limits<BaseFloat>::infinity(),
-        max_active_cutoff = std::numeric_limits<BaseFloat>::infinity();
-    
-    if (tmp_array_.size() > static_cast<size_t>(config_.max_active)) {
-      std::nth_element(tmp_array_.begin(),
-                       tmp_array_.begin() + config_.max_active,
-                       tmp_array_.end());
-      max_active_cutoff = tmp_array_[config_.max_active];
-    }
-    if (tmp_array_.size() > static_cast<size_t>(config_.min_active)) {
-      if (config_.min_active == 0) min_active_cutoff = best_weight;
-      else {
-        std::nth_element(tmp_array_.begin(),
-                         tmp_array_.begin() + config_.min_active,
-                         tmp_array_.size() > static_cast<size_t>(config_.max_active) ?
-                         tmp_array_.begin() + config_.max_active :
-                         tmp_array_.end());
-        min_active_cutoff = tmp_array_[config_.min_active];
-      }
-    }
-
-    if (max_active_cutoff < beam_cutoff) { // max_active is tighter than beam.
-      if (adaptive_beam)
-        *adaptive_beam = max_active_cutoff - best_weight + config_.beam_delta;
-      return max_active_cutoff;
-    } else if (min_active_cutoff > beam_cutoff) { // min_active is looser than beam.
-      if (adaptive_beam)
-        *adaptive_beam = min_active_cutoff - best_weight + config_.beam_delta;
-      return min_active_cutoff;
-    } else {
-      *adaptive_beam = config_.beam;
-      return beam_cutoff;
-    }
+    beam_controller_.Update(count);
+    return pruner_.GetCutoff(best_weight, beam, config_.max_active,
+                             config_.min_active, config_.beam_delta,
+                             adaptive_beam);
   }
 }
 
@@ -189,8 +169,41 @@ void FasterDecoder::PossiblyResizeHash(size_t num_toks) {
   }
 }
 
+template<class FST>
+void FasterDecoder::ComputeLogLikesTpl(
+    const FST &fst, DecodableInterface *decodable, int32 frame,
+    Elem *list, BaseFloat cutoff) {
+  active_labels_.clear();
+  for (Elem *e = list; e != NULL; e = e->tail) {
+    if (e->val->weight_.Value() > cutoff) continue;
+    for (fst::ArcIterator<FST> aiter(fst, e->key);
+         !aiter.Done();
+         aiter.Next()) {
+      Label ilabel = aiter.Value().ilabel;
+      if (ilabel != 0) {
+        if (static_cast<size_t>(ilabel) >= label_seen_.size()) {
+          label_seen_.resize(ilabel + 1, false);
+          loglikes_.resize(ilabel + 1);
+        }
+        if (!label_seen_[ilabel]) {
+          label_seen_[ilabel] = true;
+          active_labels_.push_back(ilabel);
+        }
+      }
+    }
+  }
+  decodable->LogLikelihoods(frame, active_labels_, &active_loglikes_);
+  for (size_t i = 0; i < active_labels_.size(); i++) {
+    Label ilabel = active_labels_[i];
+    loglikes_[ilabel] = active_loglikes_[i];
+    label_seen_[ilabel] = false;  // ready for next frame.
+  }
+}
+
 // ProcessEmitting returns the likelihood cutoff used.
-BaseFloat FasterDecoder::ProcessEmitting(DecodableInterface *decodable, int frame) {
+template<class FST>
+BaseFloat FasterDecoder::ProcessEmittingTpl(
+    const FST &fst, DecodableInterface *decodable, int frame) {
   Elem *last_toks = toks_.Clear();
   size_t tok_cnt;
   BaseFloat adaptive_beam;
@@ -198,7 +211,11 @@ BaseFloat FasterDecoder::ProcessEmitting(DecodableInterface *decodable, int fram
   BaseFloat weight_cutoff = GetCutoff(last_toks, &tok_cnt,
                                       &adaptive_beam, &best_elem);
   KALDI_VLOG(3) << tok_cnt << " tokens active.";
+  KALDI_PROFILE_COUNT("FasterDecoder::tokens", tok_cnt);
   PossiblyResizeHash(tok_cnt);  // This makes sure the hash is always big enough.
+
+  // Get all the log-likelihoods we'll need on this frame at once.
+  ComputeLogLikesTpl(fst, decodable, frame, last_toks, weight_cutoff);
     
   // This is the cutoff we use after adding in the log-likes (i.e.
   // for the next frame).  This is a bound on the cutoff we will use
@@ -210,12 +227,12 @@ BaseFloat FasterDecoder::ProcessEmitting(DecodableInterface *decodable, int fram
   if (best_elem) {
     StateId state = best_elem->key;
     Token *tok = best_elem->val;
-    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+    for (fst::ArcIterator<FST> aiter(fst, state);
          !aiter.Done();
          aiter.Next()) {
       const Arc &arc = aiter.Value();
       if (arc.ilabel != 0) {  // we'd propagate..
-        BaseFloat ac_cost = - decodable->LogLikelihood(frame, arc.ilabel),
+        BaseFloat ac_cost = - loglikes_[arc.ilabel],
             new_weight = arc.weight.Value() + tok->weight_.Value() + ac_cost;
         if (new_weight + adaptive_beam < next_weight_cutoff)
           next_weight_cutoff = new_weight + adaptive_beam;
@@ -236,12 +253,12 @@ BaseFloat FasterDecoder::ProcessEmitting(DecodableInterface *decodable, int fram
     if (tok->weight_.Value() < weight_cutoff) {  // not pruned.
       // np++;
       KALDI_ASSERT(state == tok->arc_.nextstate);
-      for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+      for (fst::ArcIterator<FST> aiter(fst, state);
            !aiter.Done();
            aiter.Next()) {
         Arc arc = aiter.Value();
         if (arc.ilabel != 0) {  // propagate..
-          Weight ac_weight(- decodable->LogLikelihood(frame, arc.ilabel));
+          Weight ac_weight(- loglikes_[arc.ilabel]);
           BaseFloat new_weight = arc.weight.Value() + tok->weight_.Value()
               + ac_weight.Value();
           if (new_weight < next_weight_cutoff) {  // not pruned..
@@ -270,8 +287,27 @@ BaseFloat FasterDecoder::ProcessEmitting(DecodableInterface *decodable, int fram
   return next_weight_cutoff;
 }
 
+BaseFloat FasterDecoder::ProcessEmitting(DecodableInterface *decodable, int frame) {
+  KALDI_PROFILE_SCOPE("FasterDecoder::ProcessEmitting");
+  switch (fst_type_) {
+    case fst::kVectorGraph:
+      return ProcessEmittingTpl(static_cast<const fst::VectorFst<Arc>&>(*fst_),
+                                decodable, frame);
+    case fst::kConstGraph:
+      return ProcessEmittingTpl(static_cast<const fst::ConstFst<Arc>&>(*fst_),
+                                decodable, frame);
+    case fst::kMappedConstGraph:
+      return ProcessEmittingTpl(static_cast<const fst::MappedConstFst&>(*fst_),
+                                decodable, frame);
+    default:
+      return ProcessEmittingTpl(*fst_, decodable, frame);
+  }
+}
+
 // TODO: first time we go through this, could avoid using the queue.
-void FasterDecoder::ProcessNonemitting(BaseFloat cutoff) {
+template<class FST>
+void FasterDecoder::ProcessNonemittingTpl(
+    const FST &fst, BaseFloat cutoff) {
   // Processes nonemitting arcs for one frame. 
   KALDI_ASSERT(queue_.empty());
   for (Elem *e = toks_.GetList(); e != NULL;  e = e->tail)
@@ -285,7 +321,7 @@ void FasterDecoder::ProcessNonemitting(BaseFloat cutoff) {
       continue;
     }
     KALDI_ASSERT(tok != NULL && state == tok->arc_.nextstate);
-    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+    for (fst::ArcIterator<FST> aiter(fst, state);
          !aiter.Done();
          aiter.Next()) {
       const Arc &arc = aiter.Value();
@@ -313,6 +349,27 @@ void FasterDecoder::ProcessNonemitting(BaseFloat cutoff) {
   }
 }
 
+void FasterDecoder::ProcessNonemitting(BaseFloat cutoff) {
+  KALDI_PROFILE_SCOPE("FasterDecoder::ProcessNonemitting");
+  switch (fst_type_) {
+    case fst::kVectorGraph:
+      ProcessNonemittingTpl(static_cast<const fst::VectorFst<Arc>&>(*fst_),
+                            cutoff);
+      break;
+    case fst::kConstGraph:
+      ProcessNonemittingTpl(static_cast<const fst::ConstFst<Arc>&>(*fst_),
+                            cutoff);
+      break;
+    case fst::kMappedConstGraph:
+      ProcessNonemittingTpl(static_cast<const fst::MappedConstFst&>(*fst_),
+                            cutoff);
+      break;
+    default:
+      ProcessNonemittingTpl(*fst_, cutoff);
+      break;
+  }
+}
+
 void FasterDecoder::ClearToks(Elem *list) {
   for (Elem *e = list, *e_tail; e != NULL; e = e_tail) {
     Token::TokenDelete(e->val);
@@ -321,4 +378,126 @@ void FasterDecoder::ClearToks(Elem *list) {
   }
 }
 
+FasterDecoderPool::FasterDecoderPool(const FasterDecoderOptions &config):
+    config_(config) {
+  if (pthread_mutex_init(&mutex_, NULL) != 0)
+    KALDI_ERR << "Cannot initialize pthread mutex";
+}
+
+FasterDecoderPool::~FasterDecoderPool() {
+  for (size_t i = 0; i < free_decoders_.size(); i++)
+    delete free_decoders_[i];
+  pthread_mutex_destroy(&mutex_);
+}
+
+FasterDecoder *FasterDecoderPool::Get(const fst::Fst<fst::StdArc> &fst) {
+  FasterDecoder *decoder = NULL;
+  pthread_mutex_lock(&mutex_);
+  if (!free_decoders_.empty()) {
+    decoder = free_decoders_.back();
+    free_decoders_.pop_back();
+  }
+  pthread_mutex_unlock(&mutex_);
+  if (decoder == NULL) return new FasterDecoder(fst, config_);
+  decoder->SetFst(fst);
+  decoder->SetOptions(config_);
+  return decoder;
+}
+
+void FasterDecoderPool::Release(FasterDecoder *decoder) {
+  pthread_mutex_lock(&mutex_);
+  free_decoders_.push_back(decoder);
+  pthread_mutex_unlock(&mutex_);
+}
+
+AlignUtteranceClass::AlignUtteranceClass(
+    const TransitionModel &trans_model, const AlignConfig &config,
+    BaseFloat acoustic_scale, FasterDecoderPool *decoder_pool,
+    const std::string &utt, fst::VectorFst<fst::StdArc> *decode_fst,
+    DecodableInterface *decodable, int32 num_frames,
+    Int32VectorWriter *alignment_writer,
+    BaseFloatWriter *scores_writer, double *like_sum, int64 *frame_sum,
+    int32 *num_done, int32 *num_err, int32 *num_retry):
+    trans_model_(trans_model), config_(config),
+    acoustic_scale_(acoustic_scale), decoder_pool_(decoder_pool), utt_(utt),
+    decode_fst_(decode_fst), decodable_(decodable), num_frames_(num_frames),
+    alignment_writer_(alignment_writer), scores_writer_(scores_writer),
+    like_sum_(like_sum), frame_sum_(frame_sum), num_done_(num_done),
+    num_err_(num_err), num_retry_(num_retry), success_(false),
+    retried_(false), score_(0.0) { }
+
+void AlignUtteranceClass::operator () () {
+  {  // Add transition-probs to the FST.
+    std::vector<int32> disambig_syms;  // empty.
+    AddTransitionProbs(trans_model_, disambig_syms, config_.transition_scale,
+                       config_.self_loop_scale, decode_fst_);
+  }
+  TrainingGraphAligner aligner;
+  if (config_.use_graph_aligner && aligner.Init(*decode_fst_)) {
+    success_ = aligner.Align(decodable_, config_.beam, &alignment_, &score_);
+    if (!success_ && config_.retry_beam != 0.0) {
+      retried_ = true;
+      success_ = aligner.Align(decodable_, config_.retry_beam, &alignment_,
+                               &score_);
+    }
+  } else {
+    FasterDecoder *decoder = decoder_pool_->Get(*decode_fst_);
+    decoder->Decode(decodable_);
+    fst::VectorFst<LatticeArc> decoded;  // linear FST.
+    success_ = decoder->ReachedFinal() // consider only final states.
+        && decoder->GetBestPath(&decoded);
+    if (!success_ && config_.retry_beam != 0.0) {
+      retried_ = true;
+      FasterDecoderOptions retry_opts;
+      retry_opts.beam = config_.retry_beam;  // Don't set the other options.
+      decoder->SetOptions(retry_opts);
+      decoder->Decode(decodable_);
+      success_ = decoder->ReachedFinal() && decoder->GetBestPath(&decoded);
+    }
+    decoder_pool_->Release(decoder);
+    if (success_) {
+      std::vector<int32> words;
+      LatticeWeight weight;
+      GetLinearSymbolSequence(decoded, &alignment_, &words, &weight);
+      score_ = -(weight.Value1() + weight.Value2());
+    }
+  }
+  delete decodable_;
+  decodable_ = NULL;
+  delete decode_fst_;
+  decode_fst_ = NULL;
+}
+
+AlignUtteranceClass::~AlignUtteranceClass() {
+  if (retried_) {
+    (*num_retry_)++;
+    KALDI_WARN << "Retried utterance " << utt_ << " with beam "
+               << config_.retry_beam;
+  }
+  if (success_) {
+    BaseFloat like = score_ / acoustic_scale_;
+    *like_sum_ += like;
+    *frame_sum_ += num_frames_;
+    if (scores_writer_ != NULL && scores_writer_->IsOpen())
+      scores_writer_->Write(utt_, score_);
+    alignment_writer_->Write(utt_, alignment_);
+    (*num_done_)++;
+    KALDI_VLOG(2) << "Log-like per frame for utterance " << utt_ << " is "
+                  << (like / num_frames_) << " over " << num_frames_
+                  << " frames.";
+    if (*num_done_ % 50 == 0) {
+      KALDI_LOG << "Processed " << *num_done_ << " utterances, "
+                << "log-like per frame for " << utt_ << " is "
+                << (like / num_frames_) << " over " << num_frames_
+                << " frames.";
+    }
+  } else {
+    KALDI_WARN << "Did not successfully decode file " << utt_ << ", len = "
+               << num_frames_;
+    (*num_err_)++;
+  }
+  delete decodable_;  // in case operator () was not called.
+  delete decode_fst_;
+}
+
 } // end namespace kaldi.
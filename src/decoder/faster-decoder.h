@@ -20,12 +20,18 @@
 #ifndef KALDI_DECODER_FASTER_DECODER_H_
 #define KALDI_DECODER_FASTER_DECODER_H_
 
+#include <pthread.h>
 #include "util/stl-utils.h"
 #include "itf/options-itf.h"
-#include "util/hash-list.h"
+#include "util/open-hash-list.h"
 #include "fst/fstlib.h"
+#include "fstext/mapped-fst.h"
 #include "itf/decodable-itf.h"
 #include "lat/kaldi-lattice.h" // for CompactLatticeArc
+#include "decoder/decoder-pruning.h"
+#include "decoder/training-graph-aligner.h"
+#include "hmm/transition-model.h"
+#include "util/table-types.h"
 
 #ifdef _MSC_VER
 #include <unordered_map>
@@ -42,12 +48,15 @@ struct FasterDecoderOptions {
   int32 min_active;
   BaseFloat beam_delta;
   BaseFloat hash_ratio;
+  int32 histogram_bins;
+  AdaptiveBeamOptions adaptive_beam;
   FasterDecoderOptions(): beam(16.0),
                           max_active(std::numeric_limits<int32>::max()),
                           min_active(20), // This decoder mostly used for
                                           // alignment, use small default.
                           beam_delta(0.5),
-                          hash_ratio(2.0) { }
+                          hash_ratio(2.0),
+                          histogram_bins(0) { }
   void Register(OptionsItf *po, bool full) {  /// if "full", use obscure
     /// options too.
     /// Depends on program.
@@ -60,6 +69,11 @@ struct FasterDecoderOptions {
                    "Increment used in decoder [obscure setting]");
       po->Register("hash-ratio", &hash_ratio,
                    "Setting used in decoder to control hash behavior");
+      po->Register("histogram-bins", &histogram_bins,
+                   "If >0, apply --max-active using a histogram of token costs "
+                   "with this many bins over the beam, instead of an exact "
+                   "selection (faster; keeps slightly fewer tokens)");
+      adaptive_beam.Register(po);
     }
   }
 };
@@ -74,8 +88,19 @@ class FasterDecoder {
   FasterDecoder(const fst::Fst<fst::StdArc> &fst,
                 const FasterDecoderOptions &config);
 
-  void SetOptions(const FasterDecoderOptions &config) { config_ = config; }
+  void SetOptions(const FasterDecoderOptions &config) {
+    config_ = config;
+    pruner_.SetNumBins(config.histogram_bins);
+  }
   
+  /// Makes the decoder use "fst" from now on, so that it (and the memory it
+  /// has allocated) can be reused for an utterance with a different graph, as
+  /// when aligning.  Call Decode() before ReachedFinal() or GetBestPath().
+  void SetFst(const fst::Fst<fst::StdArc> &fst) {
+    fst_ = &fst;
+    fst_type_ = fst::GetDecodingGraphType(fst);
+  }
+
   ~FasterDecoder() { ClearToks(toks_.Clear()); }
 
   void Decode(DecodableInterface *decodable);
@@ -129,7 +154,7 @@ class FasterDecoder {
 #endif
     }
   };
-  typedef HashList<StateId, Token*>::Elem Elem;
+  typedef OpenHashList<StateId, Token*>::Elem Elem;
 
 
   /// Gets the weight cutoff.  Also counts the active tokens.
@@ -138,21 +163,49 @@ class FasterDecoder {
 
   void PossiblyResizeHash(size_t num_toks);
 
+  // Works out which input labels are on emitting arcs out of tokens in
+  // "list" that are within "cutoff", and gets their log-likelihoods for this
+  // frame from the decodable object in a single call; the results go in
+  // loglikes_, indexed by label.
+  template<class FST>
+  void ComputeLogLikesTpl(const FST &fst, DecodableInterface *decodable,
+                          int32 frame, Elem *list, BaseFloat cutoff);
+
   // ProcessEmitting returns the likelihood cutoff used.
   BaseFloat ProcessEmitting(DecodableInterface *decodable, int frame);
 
   // TODO: first time we go through this, could avoid using the queue.
   void ProcessNonemitting(BaseFloat cutoff);
 
-  // HashList defined in ../util/hash-list.h.  It actually allows us to maintain
-  // more than one list (e.g. for current and previous frames), but only one of
-  // them at a time can be indexed by StateId.
-  HashList<StateId, Token*> toks_;
-  const fst::Fst<fst::StdArc> &fst_;
+  // ProcessEmitting() and ProcessNonemitting() call these versions, templated
+  // on the type of the FST, so that for the common types of decoding graph
+  // (see fst::DecodingGraphType) the arc iteration is inlined.
+  template<class FST>
+  BaseFloat ProcessEmittingTpl(const FST &fst, DecodableInterface *decodable,
+                               int frame);
+
+  template<class FST>
+  void ProcessNonemittingTpl(const FST &fst, BaseFloat cutoff);
+
+  // OpenHashList defined in ../util/open-hash-list.h (it has the same interface
+  // as HashList in ../util/hash-list.h, but uses open addressing, which is
+  // faster when there are many active tokens).  It actually allows us to
+  // maintain more than one list (e.g. for current and previous frames), but
+  // only one of them at a time can be indexed by StateId.
+  OpenHashList<StateId, Token*> toks_;
+  const fst::Fst<fst::StdArc> *fst_;
+  fst::DecodingGraphType fst_type_;
   FasterDecoderOptions config_;
   std::vector<StateId> queue_;  // temp variable used in ProcessNonemitting,
-  std::vector<BaseFloat> tmp_array_;  // used in GetCutoff.
+  HistogramPruner pruner_;  // used in GetCutoff.
   // make it class member to avoid internal new/delete.
+  AdaptiveBeamController beam_controller_;  // used in Decode() and GetCutoff().
+
+  // The following are used in ComputeLogLikesTpl().
+  std::vector<Label> active_labels_;  // labels needed on the current frame.
+  std::vector<BaseFloat> active_loglikes_;  // their log-likelihoods.
+  std::vector<BaseFloat> loglikes_;  // log-likelihoods indexed by label.
+  std::vector<bool> label_seen_;  // temporary, indexed by label.
 
   // It might seem unclear why we call ClearToks(toks_.Clear()).
   // There are two separate cleanup tasks we need to do at when we start a new file.
@@ -166,6 +219,105 @@ class FasterDecoder {
 };
 
 
+/// Options for forced alignment with FasterDecoder, as in gmm-align-compiled.
+struct AlignConfig {
+  BaseFloat beam;
+  BaseFloat retry_beam;
+  BaseFloat transition_scale;
+  BaseFloat self_loop_scale;
+  bool use_graph_aligner;
+  AlignConfig(): beam(200.0), retry_beam(0.0), transition_scale(1.0),
+                 self_loop_scale(1.0), use_graph_aligner(true) { }
+  void Register(OptionsItf *po) {
+    po->Register("beam", &beam, "Decoding beam");
+    po->Register("retry-beam", &retry_beam,
+                 "Decoding beam for second try at alignment");
+    po->Register("transition-scale", &transition_scale,
+                 "Transition-probability scale [relative to acoustics]");
+    po->Register("self-loop-scale", &self_loop_scale,
+                 "Scale of self-loop versus non-self-loop log probs "
+                 "[relative to acoustics]");
+    po->Register("use-graph-aligner", &use_graph_aligner,
+                 "If true, graphs without cycles other than self-loops (the "
+                 "normal case) are aligned with TrainingGraphAligner instead "
+                 "of FasterDecoder, which is faster");
+  }
+};
+
+/// FasterDecoderPool keeps FasterDecoder objects for reuse by the tasks of a
+/// multi-threaded program, so that each utterance does not allocate a new
+/// decoder and hash table.  It only ever has as many decoders as were in use
+/// at the same time.  Get() and Release() may be called from any thread.
+class FasterDecoderPool {
+ public:
+  explicit FasterDecoderPool(const FasterDecoderOptions &config);
+  ~FasterDecoderPool();
+  /// Returns a decoder for "fst", with the options given to the constructor.
+  FasterDecoder *Get(const fst::Fst<fst::StdArc> &fst);
+  /// Gives back a decoder obtained from Get().
+  void Release(FasterDecoder *decoder);
+ private:
+  FasterDecoderOptions config_;
+  pthread_mutex_t mutex_;
+  std::vector<FasterDecoder*> free_decoders_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(FasterDecoderPool);
+};
+
+// This class does the forced alignment of one utterance, in a way that allows
+// us to build a multi-threaded program using TaskSequencer (see
+// ../thread/kaldi-task-sequence.h): the transition probabilities are added to
+// the utterance's graph and the decoding is done in operator (), and the
+// output happens in the destructor, in the order of the utterances.  The
+// decoding is done with TrainingGraphAligner if the graph allows it (see
+// --use-graph-aligner), else with FasterDecoder.
+class AlignUtteranceClass {
+ public:
+  // NOTE: we "take ownership" of "decode_fst" and "decodable".  The decoder
+  // comes from "decoder_pool".  On success, the likelihood (divided by the
+  // acoustic scale) is added to "like_sum", the number of frames to
+  // "frame_sum", and "num_done" is incremented; on failure, "num_err" is.
+  // "num_retry" is incremented if --retry-beam was used.  "num_frames" is
+  // the number of frames of "decodable".  "scores_writer" may be NULL or not
+  // open.
+  AlignUtteranceClass(const TransitionModel &trans_model,
+                      const AlignConfig &config,
+                      BaseFloat acoustic_scale,
+                      FasterDecoderPool *decoder_pool,
+                      const std::string &utt,
+                      fst::VectorFst<fst::StdArc> *decode_fst,
+                      DecodableInterface *decodable,
+                      int32 num_frames,
+                      Int32VectorWriter *alignment_writer,
+                      BaseFloatWriter *scores_writer,
+                      double *like_sum, int64 *frame_sum,
+                      int32 *num_done, int32 *num_err, int32 *num_retry);
+  void operator () ();  // The alignment happens here.
+  ~AlignUtteranceClass();  // Output happens here.
+ private:
+  const TransitionModel &trans_model_;
+  const AlignConfig &config_;
+  BaseFloat acoustic_scale_;
+  FasterDecoderPool *decoder_pool_;
+  std::string utt_;
+  fst::VectorFst<fst::StdArc> *decode_fst_;
+  DecodableInterface *decodable_;
+  int32 num_frames_;
+  Int32VectorWriter *alignment_writer_;
+  BaseFloatWriter *scores_writer_;
+  double *like_sum_;
+  int64 *frame_sum_;
+  int32 *num_done_;
+  int32 *num_err_;
+  int32 *num_retry_;
+
+  // The following variables are stored by the computation.
+  bool success_;
+  bool retried_;
+  BaseFloat score_;  // the negated total cost (acoustic + graph).
+  std::vector<int32> alignment_;
+};
+
+
 } // end namespace kaldi.
 
 
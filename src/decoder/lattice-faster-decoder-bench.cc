@@ -0,0 +1,100 @@
+// decoder/lattice-faster-decoder-bench.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include "decoder/lattice-faster-decoder.h"
+#include "decoder/decodable-matrix.h"
+#include "util/kaldi-bench.h"
+
+namespace kaldi {
+
+// Makes a fixed random graph with "num_states" states that looks a bit like a
+// decoding graph: each state has a self-loop and two other arcs with pdf
+// labels, most of them to nearby states, and one state in 10 also has an
+// epsilon arc.  Every state is final.
+fst::VectorFst<fst::StdArc> *MakeBenchGraph(int32 num_states, int32 num_pdfs) {
+  typedef fst::StdArc Arc;
+  fst::VectorFst<Arc> *fst = new fst::VectorFst<Arc>();
+  for (int32 s = 0; s < num_states; s++)
+    fst->AddState();
+  fst->SetStart(0);
+  for (int32 s = 0; s < num_states; s++) {
+    int32 pdf = 1 + rand() % num_pdfs;
+    fst->AddArc(s, Arc(pdf, 0, 0.7, s));
+    for (int32 a = 0; a < 2; a++) {
+      int32 next = (rand() % 10 == 0 ? rand() % num_states :
+                    (s + 1 + rand() % 100) % num_states),
+          word = (rand() % 5 == 0 ? 1 + rand() % 1000 : 0);
+      fst->AddArc(s, Arc(1 + rand() % num_pdfs, word, 1.0 + RandUniform(),
+                         next));
+    }
+    if (rand() % 10 == 0)
+      fst->AddArc(s, Arc(0, 0, 2.0, rand() % num_states));
+    fst->SetFinal(s, 0.0);
+  }
+  return fst;
+}
+
+struct DecoderBench {
+  DecoderBench(const fst::Fst<fst::StdArc> &fst,
+               const LatticeFasterDecoderConfig &config,
+               const Matrix<BaseFloat> &loglikes):
+      decoder_(fst, config), loglikes_(loglikes) { }
+  void operator() () {
+    DecodableMatrixScaled decodable(loglikes_, 0.1);
+    if (!decoder_.Decode(&decodable))
+      KALDI_WARN << "Decoding failed.";
+  }
+  LatticeFasterDecoder decoder_;
+  const Matrix<BaseFloat> &loglikes_;
+};
+
+// Times LatticeFasterDecoder::Decode on a fixed graph and a fixed matrix of
+// log-likelihoods.
+void LatticeFasterDecoderBench(int32 num_states, int32 num_pdfs,
+                               int32 num_frames, BaseFloat beam,
+                               int32 max_active) {
+  fst::VectorFst<fst::StdArc> *fst = MakeBenchGraph(num_states, num_pdfs);
+  // Column zero is unused, as the pdf labels are one-based.
+  Matrix<BaseFloat> loglikes(num_frames, num_pdfs + 1);
+  loglikes.SetRandn();
+  loglikes.Scale(10.0);
+  LatticeFasterDecoderConfig config;
+  config.beam = beam;
+  config.max_active = max_active;
+  std::ostringstream params;
+  params << "states=" << num_states << " pdfs=" << num_pdfs
+         << " frames=" << num_frames << " beam=" << beam
+         << " max_active=" << max_active;
+  DecoderBench bench(*fst, config, loglikes);
+  PrintBenchmarkResult("LatticeFasterDecoder::Decode", params.str(),
+                       TimeBenchmark(bench, 3, 1.0), num_frames, "frames");
+  delete fst;
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  srand(0);
+  LatticeFasterDecoderBench(100000, 2000, 500, 13.0, 7000);
+  LatticeFasterDecoderBench(1000000, 4000, 500, 13.0, 7000);
+  LatticeFasterDecoderBench(1000000, 4000, 500, 16.0, 20000);
+  return 0;
+}
@@ -0,0 +1,250 @@
+// decoder/lattice-faster-decoder-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/lattice-faster-decoder.h"
+#include "decoder/decodable-matrix.h"
+#include "fstext/fstext-utils.h"
+#include "fstext/mapped-fst.h"
+
+namespace kaldi {
+
+typedef fst::StdArc Arc;
+
+// Makes a random graph like a small HCLG: arcs with transition-ids (or
+// epsilon) on the input and words (or epsilon) on the output.  Epsilon arcs
+// only go forward, so there are no epsilon cycles.
+void MakeRandomGraph(int32 num_tids, fst::VectorFst<Arc> *fst) {
+  int32 num_states = 2 + rand() % 50;
+  for (int32 s = 0; s < num_states; s++)
+    fst->AddState();
+  fst->SetStart(0);
+  for (int32 s = 0; s < num_states; s++) {
+    int32 num_arcs = 1 + rand() % 4;
+    for (int32 a = 0; a < num_arcs; a++) {
+      int32 olabel = (rand() % 3 == 0 ? 1 + rand() % 10 : 0);
+      BaseFloat weight = 2.0 * RandUniform();
+      if (s + 1 < num_states && rand() % 5 == 0) {
+        int32 next = s + 1 + rand() % (num_states - s - 1);
+        fst->AddArc(s, Arc(0, olabel, weight, next));
+      } else {
+        fst->AddArc(s, Arc(1 + rand() % num_tids, olabel, weight,
+                           rand() % num_states));
+      }
+    }
+    if (rand() % 3 == 0)
+      fst->SetFinal(s, RandUniform());
+  }
+}
+
+// Returns the total cost of a linear lattice, and its input and output
+// labels.
+BaseFloat PathCost(const fst::VectorFst<LatticeArc> &path,
+                   std::vector<int32> *ilabels, std::vector<int32> *olabels) {
+  LatticeWeight weight;
+  KALDI_ASSERT(GetLinearSymbolSequence(path, ilabels, olabels, &weight));
+  return weight.Value1() + weight.Value2();
+}
+
+// Checks that GetBestPathTraceback() finds the same path as GetBestPath(),
+// which takes the shortest path of the raw lattice, or (if there is a tie)
+// one of the same cost.
+void CheckBestPaths(const LatticeFasterDecoder &decoder,
+                    bool use_final_probs) {
+  fst::VectorFst<LatticeArc> path, traceback;
+  bool ans = decoder.GetBestPath(&path, use_final_probs),
+      traceback_ans = decoder.GetBestPathTraceback(&traceback,
+                                                   use_final_probs);
+  KALDI_ASSERT(ans == traceback_ans);
+  if (!ans) return;
+  std::vector<int32> ilabels, olabels, traceback_ilabels, traceback_olabels;
+  BaseFloat cost = PathCost(path, &ilabels, &olabels),
+      traceback_cost = PathCost(traceback, &traceback_ilabels,
+                                &traceback_olabels);
+  KALDI_ASSERT(ApproxEqual(cost, traceback_cost, 1.0e-04));
+  KALDI_ASSERT(traceback_ilabels.size() ==
+               static_cast<size_t>(decoder.NumFramesDecoded()));
+  if (ilabels != traceback_ilabels || olabels != traceback_olabels)
+    KALDI_LOG << "Best paths differ, with costs " << cost << " and "
+              << traceback_cost;
+}
+
+void UnitTestGetBestPathTraceback() {
+  for (int32 i = 0; i < 200; i++) {
+    int32 num_tids = 10, num_frames = 1 + rand() % 60;
+    fst::VectorFst<Arc> fst;
+    MakeRandomGraph(num_tids, &fst);
+    Matrix<BaseFloat> likes(num_frames, num_tids + 1);  // indexed by tid.
+    likes.SetRandn();
+    DecodableMatrixScaled decodable(likes, 1.0);
+
+    LatticeFasterDecoderConfig config;
+    config.beam = 2.0 + 10.0 * RandUniform();
+    config.lattice_beam = 0.5 + 5.0 * RandUniform();
+    config.prune_interval = 1 + rand() % 10;
+    if (rand() % 2 == 0)
+      config.max_active = 2 + rand() % 20;
+    if (rand() % 4 == 0)  // so small that only the best paths are kept.
+      config.max_mem_mb = 0.001;
+    LatticeFasterDecoder decoder(fst, config);
+    decoder.InitDecoding();
+    // Decode in chunks, getting partial results as we go.
+    while (decoder.NumFramesDecoded() < num_frames) {
+      decoder.AdvanceDecoding(&decodable, 1 + rand() % 10);
+      CheckBestPaths(decoder, false);
+      CheckBestPaths(decoder, true);
+    }
+    decoder.FinalizeDecoding();
+    CheckBestPaths(decoder, true);
+  }
+}
+
+// Checks that decoding in chunks with AdvanceDecoding() gives the same best
+// path and raw lattice as Decode().
+void UnitTestChunkedDecoding() {
+  for (int32 i = 0; i < 100; i++) {
+    int32 num_tids = 10, num_frames = 1 + rand() % 60;
+    fst::VectorFst<Arc> fst;
+    MakeRandomGraph(num_tids, &fst);
+    Matrix<BaseFloat> likes(num_frames, num_tids + 1);
+    likes.SetRandn();
+    DecodableMatrixScaled decodable(likes, 1.0);
+
+    LatticeFasterDecoderConfig config;
+    config.beam = 2.0 + 10.0 * RandUniform();
+    config.lattice_beam = 0.5 + 5.0 * RandUniform();
+    config.prune_interval = 1 + rand() % 10;
+    LatticeFasterDecoder decoder(fst, config), chunked_decoder(fst, config);
+    decoder.Decode(&decodable);
+    chunked_decoder.InitDecoding();
+    while (chunked_decoder.NumFramesDecoded() < num_frames)
+      chunked_decoder.AdvanceDecoding(&decodable, 1 + rand() % 10);
+    chunked_decoder.FinalizeDecoding();
+    KALDI_ASSERT(decoder.ReachedFinal() == chunked_decoder.ReachedFinal());
+
+    fst::VectorFst<LatticeArc> path, chunked_path, lat, chunked_lat;
+    bool ans = decoder.GetBestPath(&path);
+    KALDI_ASSERT(chunked_decoder.GetBestPath(&chunked_path) == ans);
+    if (!ans) continue;
+    std::vector<int32> ilabels, olabels, chunked_ilabels, chunked_olabels;
+    BaseFloat cost = PathCost(path, &ilabels, &olabels),
+        chunked_cost = PathCost(chunked_path, &chunked_ilabels,
+                                &chunked_olabels);
+    KALDI_ASSERT(cost == chunked_cost && ilabels == chunked_ilabels &&
+                 olabels == chunked_olabels);
+    KALDI_ASSERT(decoder.GetRawLattice(&lat) &&
+                 chunked_decoder.GetRawLattice(&chunked_lat));
+    KALDI_ASSERT(fst::Equal(lat, chunked_lat));
+  }
+}
+
+// Checks that the decoder gives the same best path and raw lattice with the
+// graph as a VectorFst, a ConstFst and a MappedConstFst, for which it uses
+// different instantiations of its inner loops.
+void UnitTestGraphTypes() {
+  for (int32 i = 0; i < 20; i++) {
+    int32 num_tids = 10, num_frames = 1 + rand() % 60;
+    fst::VectorFst<Arc> fst;
+    MakeRandomGraph(num_tids, &fst);
+    fst::ConstFst<Arc> const_fst(fst);
+    {
+      std::ofstream os("tmpf.mapped", std::ios::out | std::ios::binary);
+      KALDI_ASSERT(fst::WriteMappedConstFst(fst, os));
+    }
+    fst::MappedConstFst *mapped_fst = fst::MappedConstFst::Read("tmpf.mapped");
+    KALDI_ASSERT(mapped_fst != NULL);
+    Matrix<BaseFloat> likes(num_frames, num_tids + 1);
+    likes.SetRandn();
+    DecodableMatrixScaled decodable(likes, 1.0);
+
+    LatticeFasterDecoderConfig config;
+    config.beam = 2.0 + 10.0 * RandUniform();
+    config.lattice_beam = 0.5 + 5.0 * RandUniform();
+    LatticeFasterDecoder decoder(fst, config),
+        const_decoder(const_fst, config), mapped_decoder(*mapped_fst, config);
+    decoder.Decode(&decodable);
+    const_decoder.Decode(&decodable);
+    mapped_decoder.Decode(&decodable);
+    fst::VectorFst<LatticeArc> lat, const_lat, mapped_lat;
+    bool ans = decoder.GetRawLattice(&lat);
+    KALDI_ASSERT(const_decoder.GetRawLattice(&const_lat) == ans &&
+                 mapped_decoder.GetRawLattice(&mapped_lat) == ans);
+    if (ans)
+      KALDI_ASSERT(fst::Equal(lat, const_lat) && fst::Equal(lat, mapped_lat));
+    delete mapped_fst;
+  }
+  std::remove("tmpf.mapped");
+}
+
+// Returns the number of arcs in a lattice.
+int32 NumArcs(const fst::VectorFst<LatticeArc> &lat) {
+  int32 num_arcs = 0;
+  for (int32 s = 0; s < lat.NumStates(); s++)
+    num_arcs += lat.NumArcs(s);
+  return num_arcs;
+}
+
+// Checks --max-mem-mb: a limit that is never reached changes nothing, and a
+// tiny one gives a smaller lattice that still has the best path.
+void UnitTestMemoryLimit() {
+  for (int32 i = 0; i < 50; i++) {
+    int32 num_tids = 10, num_frames = 1 + rand() % 60;
+    fst::VectorFst<Arc> fst;
+    MakeRandomGraph(num_tids, &fst);
+    Matrix<BaseFloat> likes(num_frames, num_tids + 1);
+    likes.SetRandn();
+    DecodableMatrixScaled decodable(likes, 1.0);
+
+    LatticeFasterDecoderConfig config;
+    config.beam = 2.0 + 10.0 * RandUniform();
+    config.lattice_beam = 0.5 + 5.0 * RandUniform();
+    LatticeFasterDecoderConfig large_config(config), small_config(config);
+    large_config.max_mem_mb = 1000.0;
+    small_config.max_mem_mb = 0.001;
+    LatticeFasterDecoder decoder(fst, config),
+        large_decoder(fst, large_config), small_decoder(fst, small_config);
+    decoder.Decode(&decodable);
+    large_decoder.Decode(&decodable);
+    small_decoder.Decode(&decodable);
+    fst::VectorFst<LatticeArc> lat, large_lat, small_lat;
+    bool ans = decoder.GetRawLattice(&lat);
+    KALDI_ASSERT(large_decoder.GetRawLattice(&large_lat) == ans &&
+                 small_decoder.GetRawLattice(&small_lat) == ans);
+    if (!ans) continue;
+    KALDI_ASSERT(fst::Equal(lat, large_lat));
+    KALDI_ASSERT(NumArcs(small_lat) <= NumArcs(lat));
+
+    fst::VectorFst<LatticeArc> path, small_path;
+    std::vector<int32> ilabels, olabels, small_ilabels, small_olabels;
+    KALDI_ASSERT(decoder.GetBestPath(&path) &&
+                 small_decoder.GetBestPath(&small_path));
+    BaseFloat cost = PathCost(path, &ilabels, &olabels),
+        small_cost = PathCost(small_path, &small_ilabels, &small_olabels);
+    KALDI_ASSERT(ApproxEqual(cost, small_cost, 1.0e-04));
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::UnitTestGetBestPathTraceback();
+  kaldi::UnitTestChunkedDecoding();
+  kaldi::UnitTestGraphTypes();
+  kaldi::UnitTestMemoryLimit();
+  std::cout << "Test OK.\n";
+}
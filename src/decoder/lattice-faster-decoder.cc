@@ -20,22 +20,27 @@
 // limitations under the License.
 
 #include "decoder/lattice-faster-decoder.h"
+#include "util/kaldi-profile.h"
 
 namespace kaldi {
 
 // instantiate this class once for each thing you have to decode.
 LatticeFasterDecoder::LatticeFasterDecoder(const fst::Fst<fst::StdArc> &fst,
                                            const LatticeFasterDecoderConfig &config):
-    fst_(fst), delete_fst_(false), config_(config), num_toks_(0) {
+    fst_(fst), fst_type_(fst::GetDecodingGraphType(fst)), delete_fst_(false),
+    config_(config), num_toks_(0), decoding_finalized_(false) {
   config.Check();
+  pruner_.SetNumBins(config.histogram_bins);
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
 }
 
 
 LatticeFasterDecoder::LatticeFasterDecoder(const LatticeFasterDecoderConfig &config,
                                            fst::Fst<fst::StdArc> *fst):
-    fst_(*fst), delete_fst_(true), config_(config), num_toks_(0) {
+    fst_(*fst), fst_type_(fst::GetDecodingGraphType(*fst)), delete_fst_(true),
+    config_(config), num_toks_(0), decoding_finalized_(false) {
   config.Check();
+  pruner_.SetNumBins(config.histogram_bins);
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
 }
 
@@ -43,6 +48,16 @@ LatticeFasterDecoder::LatticeFasterDecoder(const LatticeFasterDecoderConfig &con
 // Returns true if any kind of traceback is available (not necessarily from
 // a final state).
 bool LatticeFasterDecoder::Decode(DecodableInterface *decodable) {
+  InitDecoding();
+  AdvanceDecoding(decodable);
+  FinalizeDecoding();
+  if (GetVerboseLevel() >= 2) PrintPoolStats();
+  // Returns true if we have any kind of traceback available (not necessarily
+  // to the end state; query ReachedFinal() for that).
+  return (NumFramesDecoded() > 0 && !final_costs_.empty());
+}
+
+void LatticeFasterDecoder::InitDecoding() {
   // clean up from last time:
   DeleteElems(toks_.Clear());
   cost_offsets_.clear();
@@ -50,41 +65,146 @@ bool LatticeFasterDecoder::Decode(DecodableInterface *decodable) {
   warned_ = false;
   final_active_ = false;
   final_costs_.clear();
-  num_toks_ = 0;
+  decoding_finalized_ = false;
+  token_pool_.ResetStats();
+  link_pool_.ResetStats();
+  beam_controller_.Init(config_.adaptive_beam, config_.beam);
+  lattice_beam_ = config_.lattice_beam;
+  mem_threshold_ = static_cast<size_t>(config_.max_mem_mb * 0.5 * 1048576.0);
   StateId start_state = fst_.Start();
   KALDI_ASSERT(start_state != fst::kNoStateId);
   active_toks_.resize(1);
-  Token *start_tok = new Token(0.0, 0.0, NULL, NULL);
+  Token *start_tok = NewToken(0.0, 0.0, NULL, NULL, NULL);
   active_toks_[0].toks = start_tok;
   toks_.Insert(start_state, start_tok);
   num_toks_++;
   ProcessNonemitting(0);
-    
+}
+
+void LatticeFasterDecoder::AdvanceDecoding(DecodableInterface *decodable,
+                                           int32 max_num_frames) {
+  KALDI_ASSERT(!active_toks_.empty() && !decoding_finalized_ &&
+               "You must call InitDecoding() before AdvanceDecoding()");
   // We use 1-based indexing for frames in this decoder (if you view it in
   // terms of features), but note that the decodable object uses zero-based
   // numbering, which we have to correct for when we call it.
-  for (int32 frame = 1; !decodable->IsLastFrame(frame-2); frame++) {
+  int32 frame = NumFramesDecoded() + 1,
+      end_frame = (max_num_frames < 0 ? std::numeric_limits<int32>::max() :
+                   frame + max_num_frames);
+  for (; frame < end_frame && !decodable->IsLastFrame(frame-2); frame++) {
     active_toks_.resize(frame+1); // new column
 
     ProcessEmitting(decodable, frame);
       
     ProcessNonemitting(frame);
 
-    if (decodable->IsLastFrame(frame-1))
-      PruneActiveTokensFinal(frame);
-    else if (frame % config_.prune_interval == 0)
-      PruneActiveTokens(frame, config_.lattice_beam * 0.1); // use larger delta.        
+    // The last frame is pruned in FinalizeDecoding(), using the final-probs.
+    if (frame % config_.prune_interval == 0 &&
+        !decodable->IsLastFrame(frame-1))
+      PruneActiveTokens(frame, lattice_beam_ * 0.1); // use larger delta.
+    if (config_.max_mem_mb > 0.0)
+      LimitMemory(frame);
   }
-  // Returns true if we have any kind of traceback available (not necessarily
-  // to the end state; query ReachedFinal() for that).
-  return !final_costs_.empty();
+}
+
+void LatticeFasterDecoder::LimitMemory(int32 cur_frame) {
+  if (TokenMemoryInUse() <= mem_threshold_) return;
+  double limit = config_.max_mem_mb * 1048576.0;
+  size_t mem_begin = TokenMemoryInUse();
+  // First try pruning with the current lattice beam; this may be all that is
+  // needed if the prune interval is long.
+  PruneActiveTokens(cur_frame, lattice_beam_ * 0.1);
+  BaseFloat lattice_beam_begin = lattice_beam_;
+  while (TokenMemoryInUse() > 0.5 * limit &&
+         lattice_beam_ > config_.lattice_beam / 16.0) {
+    lattice_beam_ *= 0.5;
+    // All frames have to be pruned again with the new beam.
+    for (int32 frame = 0; frame < cur_frame; frame++)
+      active_toks_[frame].must_prune_forward_links = true;
+    PruneActiveTokens(cur_frame, 0.0);
+  }
+  if (lattice_beam_ != lattice_beam_begin)
+    KALDI_WARN << "Memory for tokens and links was " << (mem_begin / 1048576.0)
+               << "MB on frame " << cur_frame << " (--max-mem-mb="
+               << config_.max_mem_mb << "); reduced lattice beam to "
+               << lattice_beam_ << ", now using "
+               << (TokenMemoryInUse() / 1048576.0) << "MB.";
+  // The "best path only" lattice beam is not zero, to allow for roundoff in
+  // the extra-costs.
+  const BaseFloat best_path_beam = 0.01;
+  if (TokenMemoryInUse() > 0.75 * limit && lattice_beam_ > best_path_beam) {
+    lattice_beam_ = best_path_beam;
+    for (int32 frame = 0; frame < cur_frame; frame++)
+      active_toks_[frame].must_prune_forward_links = true;
+    PruneActiveTokens(cur_frame, 0.0);
+    KALDI_WARN << "Memory for tokens and links is still "
+               << (TokenMemoryInUse() / 1048576.0) << "MB on frame "
+               << cur_frame << " (--max-mem-mb=" << config_.max_mem_mb
+               << "); keeping only the best path for the rest of the "
+               << "utterance.";
+  }
+  // Don't do this again until the memory has grown by another eighth of the
+  // limit, so that we don't prune on every frame.
+  mem_threshold_ = std::max(static_cast<size_t>(0.5 * limit),
+                            static_cast<size_t>(TokenMemoryInUse() +
+                                                0.125 * limit));
+}
+
+void LatticeFasterDecoder::FinalizeDecoding() {
+  KALDI_ASSERT(!active_toks_.empty());
+  if (decoding_finalized_) return;
+  PruneActiveTokensFinal(NumFramesDecoded());
+  decoding_finalized_ = true;
+}
+
+LatticeFasterDecoder::Token *LatticeFasterDecoder::BestFinalToken(
+    bool use_final_probs, BaseFloat *final_cost) const {
+  const BaseFloat infinity = std::numeric_limits<BaseFloat>::infinity();
+  Token *best_tok = NULL;
+  BaseFloat best_cost = infinity;
+  *final_cost = 0.0;
+  if (decoding_finalized_) {
+    // The final-costs were decided in FinalizeDecoding().
+    for (std::map<Token*, BaseFloat>::const_iterator iter =
+             final_costs_.begin(); iter != final_costs_.end(); ++iter) {
+      BaseFloat cost = iter->first->tot_cost + iter->second;
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_tok = iter->first;
+        *final_cost = iter->second;
+      }
+    }
+    return best_tok;
+  }
+  if (use_final_probs) {
+    for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
+      BaseFloat this_final_cost = fst_.Final(e->key).Value(),
+          cost = e->val->tot_cost + this_final_cost;
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_tok = e->val;
+        *final_cost = this_final_cost;
+      }
+    }
+    if (best_tok != NULL) return best_tok;
+  }
+  // No final-state active (or we were asked not to use the final-probs):
+  // treat all tokens as final, as ComputeFinalCosts() does.
+  for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
+    if (e->val->tot_cost < best_cost) {
+      best_cost = e->val->tot_cost;
+      best_tok = e->val;
+    }
+  }
+  return best_tok;
 }
 
 // Outputs an FST corresponding to the single best path
 // through the lattice.
-bool LatticeFasterDecoder::GetBestPath(fst::MutableFst<LatticeArc> *ofst) const {
+bool LatticeFasterDecoder::GetBestPath(fst::MutableFst<LatticeArc> *ofst,
+                                       bool use_final_probs) const {
   fst::VectorFst<LatticeArc> fst;
-  if (!GetRawLattice(&fst)) return false;
+  if (!GetRawLattice(&fst, use_final_probs)) return false;
   // std::cout << "Raw lattice is:\n";
   // fst::FstPrinter<LatticeArc> fstprinter(fst, NULL, NULL, NULL, false, true);
   // fstprinter.Print(&std::cout, "standard output");
@@ -92,14 +212,77 @@ bool LatticeFasterDecoder::GetBestPath(fst::MutableFst<LatticeArc> *ofst) const
   return true;
 }
 
+bool LatticeFasterDecoder::GetBestPathTraceback(
+    fst::MutableFst<LatticeArc> *ofst, bool use_final_probs) const {
+  ofst->DeleteStates();
+  BaseFloat final_cost;
+  Token *tok = BestFinalToken(use_final_probs, &final_cost);
+  if (tok == NULL) return false;
+  // Trace back to the start token; "arcs" gets the path in reverse order.
+  std::vector<LatticeArc> arcs;
+  int32 frame = NumFramesDecoded();
+  for (Token *prev_tok = tok->backpointer; prev_tok != NULL;
+       tok = prev_tok, prev_tok = tok->backpointer) {
+    // Find the link that the best path came in on; if there is more than
+    // one link from prev_tok to tok, the best one.
+    const ForwardLink *best_link = NULL;
+    for (const ForwardLink *l = prev_tok->links; l != NULL; l = l->next) {
+      if (l->next_tok == tok &&
+          (best_link == NULL || l->graph_cost + l->acoustic_cost <
+           best_link->graph_cost + best_link->acoustic_cost))
+        best_link = l;
+    }
+    if (best_link == NULL) {
+      // This should not happen, as the links on the best path to a token
+      // have zero extra cost and are never pruned.
+      KALDI_WARN << "Link on the best path has been pruned; getting the best "
+                 << "path from the lattice instead.";
+      return GetBestPath(ofst, use_final_probs);
+    }
+    BaseFloat cost_offset = 0.0;
+    if (best_link->ilabel != 0) { // emitting..
+      frame--;
+      KALDI_ASSERT(frame >= 0 && frame < cost_offsets_.size());
+      cost_offset = cost_offsets_[frame];
+    }
+    arcs.push_back(LatticeArc(best_link->ilabel, best_link->olabel,
+                              LatticeWeight(best_link->graph_cost,
+                                            best_link->acoustic_cost -
+                                            cost_offset),
+                              fst::kNoStateId));  // nextstate is set below.
+  }
+  KALDI_ASSERT(frame == 0);
+
+  // Now write out the path.
+  typedef LatticeArc::StateId StateId;
+  StateId cur_state = ofst->AddState();
+  ofst->SetStart(cur_state);
+  for (size_t i = arcs.size(); i > 0; i--) {
+    LatticeArc arc = arcs[i - 1];
+    arc.nextstate = ofst->AddState();
+    ofst->AddArc(cur_state, arc);
+    cur_state = arc.nextstate;
+  }
+  ofst->SetFinal(cur_state, LatticeWeight(final_cost, 0.0));
+  return true;
+}
+
 // Outputs an FST corresponding to the raw, state-level
 // tracebacks.
-bool LatticeFasterDecoder::GetRawLattice(fst::MutableFst<LatticeArc> *ofst) const {
+bool LatticeFasterDecoder::GetRawLattice(fst::MutableFst<LatticeArc> *ofst,
+                                         bool use_final_probs) const {
   typedef LatticeArc Arc;
   typedef Arc::StateId StateId;
   typedef Arc::Weight Weight;
   typedef Arc::Label Label;
   ofst->DeleteStates();
+  // If we are in the middle of the utterance, work out the final-costs now
+  // (without modifying the decoder's state).
+  std::map<Token*, BaseFloat> partial_final_costs;
+  if (!decoding_finalized_)
+    ComputeFinalCosts(use_final_probs, &partial_final_costs);
+  const std::map<Token*, BaseFloat> &final_costs =
+      (decoding_finalized_ ? final_costs_ : partial_final_costs);
   // num-frames plus one (since frames are one-based, and we have
   // an extra frame for the start-state).
   int32 num_frames = active_toks_.size() - 1;
@@ -149,8 +332,8 @@ bool LatticeFasterDecoder::GetRawLattice(fst::MutableFst<LatticeArc> *ofst) cons
       }
       if (f == num_frames) {
         std::map<Token*, BaseFloat>::const_iterator iter =
-            final_costs_.find(tok);
-        if (iter != final_costs_.end())
+            final_costs.find(tok);
+        if (iter != final_costs.end())
           ofst->SetFinal(cur_state, LatticeWeight(iter->second, 0));
       }
     }
@@ -201,7 +384,7 @@ void LatticeFasterDecoder::PossiblyResizeHash(size_t num_toks) {
 // (whose head is at active_toks_[frame]).
 inline LatticeFasterDecoder::Token *LatticeFasterDecoder::FindOrAddToken(
     StateId state, int32 frame, BaseFloat tot_cost,
-    bool *changed) {
+    Token *backpointer, bool *changed) {
   // Returns the Token pointer.  Sets "changed" (if non-NULL) to true
   // if the token was newly created or the cost changed.
   KALDI_ASSERT(frame < active_toks_.size());
@@ -212,7 +395,7 @@ inline LatticeFasterDecoder::Token *LatticeFasterDecoder::FindOrAddToken(
     // tokens on the currently final frame have zero extra_cost
     // as any of them could end up
     // on the winning path.
-    Token *new_tok = new Token (tot_cost, extra_cost, NULL, toks);
+    Token *new_tok = NewToken(tot_cost, extra_cost, NULL, toks, backpointer);
     // NULL: no forward links yet
     toks = new_tok;
     num_toks_++;
@@ -223,6 +406,7 @@ inline LatticeFasterDecoder::Token *LatticeFasterDecoder::FindOrAddToken(
     Token *tok = e_found->val; // There is an existing Token for this state.
     if (tok->tot_cost > tot_cost) { // replace old token
       tok->tot_cost = tot_cost;
+      tok->backpointer = backpointer;
       // we don't allocate a new token, the old stays linked in active_toks_
       // we only replace the tot_cost
       // in the current frame, there are no forward links (and no extra_cost)
@@ -280,11 +464,11 @@ void LatticeFasterDecoder::PruneForwardLinks(
         // link_exta_cost is the difference in score between the best paths
         // through link source state and through link destination state
         KALDI_ASSERT(link_extra_cost == link_extra_cost); // check for NaN
-        if (link_extra_cost > config_.lattice_beam) { // excise link
+        if (link_extra_cost > lattice_beam_) { // excise link
           ForwardLink *next_link = link->next;
           if (prev_link != NULL) prev_link->next = next_link;
           else tok->links = next_link;
-          delete link;
+          link_pool_.Free(link);
           link = next_link; // advance link but leave prev_link the same.
           *links_pruned = true;
         } else { // keep the link and update the tok_extra_cost if needed.
@@ -368,11 +552,11 @@ void LatticeFasterDecoder::PruneForwardLinksFinal(int32 frame) {
         BaseFloat link_extra_cost = next_tok->extra_cost +
             ((tok->tot_cost + link->acoustic_cost + link->graph_cost)
              - next_tok->tot_cost);
-        if (link_extra_cost > config_.lattice_beam) { // excise link
+        if (link_extra_cost > lattice_beam_) { // excise link
           ForwardLink *next_link = link->next;
           if (prev_link != NULL) prev_link->next = next_link;
           else tok->links = next_link;
-          delete link;
+          link_pool_.Free(link);
           link = next_link; // advance link but leave prev_link the same.
         } else { // keep the link and update the tok_extra_cost if needed.
           if (link_extra_cost < 0.0) { // this is just a precaution.
@@ -390,7 +574,7 @@ void LatticeFasterDecoder::PruneForwardLinksFinal(int32 frame) {
       // was not necessary in the non-final case because then, this case
       // showed up as having no forward links.  Here, the tok_extra_cost has
       // an extra component relating to the final-prob.
-      if (tok_extra_cost > config_.lattice_beam)
+      if (tok_extra_cost > lattice_beam_)
         tok_extra_cost = infinity;
       // to be pruned in PruneTokensForFrame
 
@@ -433,7 +617,7 @@ void LatticeFasterDecoder::PruneTokensForFrame(int32 frame) {
       // excise tok from list and delete tok.
       if (prev_tok != NULL) prev_tok->next = tok->next;
       else toks = tok->next;
-      delete tok;
+      token_pool_.Free(tok);
       num_toks_--;
     } else { // fetch next Token
       prev_tok = tok;
@@ -449,6 +633,7 @@ void LatticeFasterDecoder::PruneTokensForFrame(int32 frame) {
 // going backward and propagating the change.
 // for a larger delta, we will recurse less far back
 void LatticeFasterDecoder::PruneActiveTokens(int32 cur_frame, BaseFloat delta) {
+  KALDI_PROFILE_SCOPE("LatticeFasterDecoder::PruneActiveTokens");
   int32 num_toks_begin = num_toks_;
   for (int32 frame = cur_frame-1; frame >= 0; frame--) {
     // Reason why we need to prune forward links in this situation:
@@ -491,11 +676,31 @@ void LatticeFasterDecoder::PruneActiveTokensFinal(int32 cur_frame) {
                 << " to " << num_toks_;
 }
   
+void LatticeFasterDecoder::ComputeFinalCosts(
+    bool use_final_probs, std::map<Token*, BaseFloat> *final_costs) const {
+  final_costs->clear();
+  const Elem *list = toks_.GetList();
+  if (use_final_probs) {
+    const BaseFloat infinity = std::numeric_limits<BaseFloat>::infinity();
+    for (const Elem *e = list; e != NULL; e = e->tail) {
+      BaseFloat final_cost = fst_.Final(e->key).Value();
+      if (final_cost != infinity)
+        (*final_costs)[e->val] = final_cost;
+    }
+    if (!final_costs->empty()) return;
+  }
+  // No final-state active (or we were asked not to use the final-probs):
+  // treat all tokens as final.
+  for (const Elem *e = list; e != NULL; e = e->tail)
+    (*final_costs)[e->val] = 0.0;
+}
+
 /// Gets the weight cutoff.  Also counts the active tokens.
 BaseFloat LatticeFasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
                                           BaseFloat *adaptive_beam, Elem **best_elem) {
   BaseFloat best_weight = std::numeric_limits<BaseFloat>::infinity();
   // positive == high cost == bad.
+  BaseFloat beam = CurrentBeam();
   size_t count = 0;
   if (config_.max_active == std::numeric_limits<int32>::max() &&
       config_.min_active == 0) {
@@ -507,58 +712,61 @@ BaseFloat LatticeFasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
       }
     }
     if (tok_count != NULL) *tok_count = count;
-    if (adaptive_beam != NULL) *adaptive_beam = config_.beam;
-    return best_weight + config_.beam;
+    if (adaptive_beam != NULL) *adaptive_beam = beam;
+    beam_controller_.Update(count);
+    return best_weight + beam;
   } else {
-    tmp_array_.clear();
+    pruner_.Clear();
     for (Elem *e = list_head; e != NULL; e = e->tail, count++) {
       BaseFloat w = e->val->tot_cost;
-      tmp_array_.push_back(w);
+      pruner_.Add(w);
       if (w < best_weight) {
         best_weight = w;
         if (best_elem) *best_elem = e;
       }
     }
     if (tok_count != NULL) *tok_count = count;
+    beam_controller_.Update(count);
+    return pruner_.GetCutoff(best_weight, beam, config_.max_active,
+                             config_.min_active, config_.beam_delta,
+                             adaptive_beam);
+  }
+}
 
-    BaseFloat beam_cutoff = best_weight + config_.beam,
-        min_active_cutoff = std::numeric_limits<BaseFloat>::infinity(),
-        max_active_cutoff = std::numeric_limits<BaseFloat>::infinity();
-    
-    if (tmp_array_.size() > static_cast<size_t>(config_.max_active)) {
-      std::nth_element(tmp_array_.begin(),
-                       tmp_array_.begin() + config_.max_active,
-                       tmp_array_.end());
-      max_active_cutoff = tmp_array_[config_.max_active];
-    }
-    if (tmp_array_.size() > static_cast<size_t>(config_.min_active)) {
-      if (config_.min_active == 0) min_active_cutoff = best_weight;
-      else {
-        std::nth_element(tmp_array_.begin(),
-                         tmp_array_.begin() + config_.min_active,
-                         tmp_array_.size() > static_cast<size_t>(config_.max_active) ?
-                         tmp_array_.begin() + config_.max_active :
-                         tmp_array_.end());
-        min_active_cutoff = tmp_array_[config_.min_active];
+template<class FST>
+void LatticeFasterDecoder::ComputeLogLikesTpl(
+    const FST &fst, DecodableInterface *decodable, int32 frame,
+    Elem *list, BaseFloat cutoff) {
+  active_labels_.clear();
+  for (Elem *e = list; e != NULL; e = e->tail) {
+    if (e->val->tot_cost > cutoff) continue;
+    for (fst::ArcIterator<FST> aiter(fst, e->key);
+         !aiter.Done();
+         aiter.Next()) {
+      Label ilabel = aiter.Value().ilabel;
+      if (ilabel != 0) {
+        if (static_cast<size_t>(ilabel) >= label_seen_.size()) {
+          label_seen_.resize(ilabel + 1, false);
+          loglikes_.resize(ilabel + 1);
+        }
+        if (!label_seen_[ilabel]) {
+          label_seen_[ilabel] = true;
+          active_labels_.push_back(ilabel);
+        }
       }
     }
-
-    if (max_active_cutoff < beam_cutoff) { // max_active is tighter than beam.
-      if (adaptive_beam)
-        *adaptive_beam = max_active_cutoff - best_weight + config_.beam_delta;
-      return max_active_cutoff;
-    } else if (min_active_cutoff > beam_cutoff) { // min_active is looser than beam.
-      if (adaptive_beam)
-        *adaptive_beam = min_active_cutoff - best_weight + config_.beam_delta;
-      return min_active_cutoff;
-    } else {
-      *adaptive_beam = config_.beam;
-      return beam_cutoff;
-    }
+  }
+  decodable->LogLikelihoods(frame, active_labels_, &active_loglikes_);
+  for (size_t i = 0; i < active_labels_.size(); i++) {
+    Label ilabel = active_labels_[i];
+    loglikes_[ilabel] = active_loglikes_[i];
+    label_seen_[ilabel] = false;  // ready for next frame.
   }
 }
 
-void LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable, int32 frame) {
+template<class FST>
+void LatticeFasterDecoder::ProcessEmittingTpl(
+    const FST &fst, DecodableInterface *decodable, int32 frame) {
   // Processes emitting arcs for one frame.  Propagates from prev_toks_ to cur_toks_.
   Elem *last_toks = toks_.Clear(); // analogous to swapping prev_toks_ / cur_toks_
   // in simple-decoder.h.  
@@ -566,7 +774,12 @@ void LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable, int32
   BaseFloat adaptive_beam;
   size_t tok_cnt;
   BaseFloat cur_cutoff = GetCutoff(last_toks, &tok_cnt, &adaptive_beam, &best_elem);
+  KALDI_PROFILE_COUNT("LatticeFasterDecoder::tokens", tok_cnt);
   PossiblyResizeHash(tok_cnt);  // This makes sure the hash is always big enough.    
+
+  // Get all the log-likelihoods we'll need on this frame at once.  Note: the
+  // decodable object uses zero-based frame numbering.
+  ComputeLogLikesTpl(fst, decodable, frame - 1, last_toks, cur_cutoff);
     
   BaseFloat next_cutoff = std::numeric_limits<BaseFloat>::infinity();
   // pruning "online" before having seen all tokens
@@ -581,14 +794,13 @@ void LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable, int32
     StateId state = best_elem->key;
     Token *tok = best_elem->val;
     cost_offset = - tok->tot_cost;
-    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+    for (fst::ArcIterator<FST> aiter(fst, state);
          !aiter.Done();
          aiter.Next()) {
       Arc arc = aiter.Value();
       if (arc.ilabel != 0) {  // propagate..
         arc.weight = Times(arc.weight,
-                           Weight(cost_offset -
-                                  decodable->LogLikelihood(frame-1, arc.ilabel)));
+                           Weight(cost_offset - loglikes_[arc.ilabel]));
         BaseFloat new_weight = arc.weight.Value() + tok->tot_cost;
         if (new_weight + adaptive_beam < next_cutoff)
           next_cutoff = new_weight + adaptive_beam;
@@ -610,25 +822,25 @@ void LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable, int32
     StateId state = e->key;
     Token *tok = e->val;
     if (tok->tot_cost <=  cur_cutoff) {
-      for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+      for (fst::ArcIterator<FST> aiter(fst, state);
            !aiter.Done();
            aiter.Next()) {
         const Arc &arc = aiter.Value();
         if (arc.ilabel != 0) {  // propagate..
-          BaseFloat ac_cost = cost_offset -
-              decodable->LogLikelihood(frame-1, arc.ilabel),
+          BaseFloat ac_cost = cost_offset - loglikes_[arc.ilabel],
               graph_cost = arc.weight.Value(),
               cur_cost = tok->tot_cost,
               tot_cost = cur_cost + ac_cost + graph_cost;
           if (tot_cost > next_cutoff) continue;
-          else if (tot_cost + config_.beam < next_cutoff)
-            next_cutoff = tot_cost + config_.beam; // prune by best current token
-          Token *next_tok = FindOrAddToken(arc.nextstate, frame, tot_cost, NULL);
+          else if (tot_cost + CurrentBeam() < next_cutoff)
+            next_cutoff = tot_cost + CurrentBeam(); // prune by best current token
+          Token *next_tok = FindOrAddToken(arc.nextstate, frame, tot_cost,
+                                          tok, NULL);
           // NULL: no change indicator needed
           
           // Add ForwardLink from tok to next_tok (put on head of list tok->links)
-          tok->links = new ForwardLink(next_tok, arc.ilabel, arc.olabel, 
-                                       graph_cost, ac_cost, tok->links);
+          tok->links = NewForwardLink(next_tok, arc.ilabel, arc.olabel,
+                                      graph_cost, ac_cost, tok->links);
         }
       } // for all arcs
     }
@@ -637,9 +849,32 @@ void LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable, int32
   }
 }
 
+void LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable, int32 frame) {
+  KALDI_PROFILE_SCOPE("LatticeFasterDecoder::ProcessEmitting");
+  switch (fst_type_) {
+    case fst::kVectorGraph:
+      ProcessEmittingTpl(static_cast<const fst::VectorFst<Arc>&>(fst_),
+                         decodable, frame);
+      break;
+    case fst::kConstGraph:
+      ProcessEmittingTpl(static_cast<const fst::ConstFst<Arc>&>(fst_),
+                         decodable, frame);
+      break;
+    case fst::kMappedConstGraph:
+      ProcessEmittingTpl(static_cast<const fst::MappedConstFst&>(fst_),
+                         decodable, frame);
+      break;
+    default:
+      ProcessEmittingTpl(fst_, decodable, frame);
+      break;
+  }
+}
+
 // TODO: could possibly add adaptive_beam back as an argument here (was
 // returned from ProcessEmitting, in faster-decoder.h).
-void LatticeFasterDecoder::ProcessNonemitting(int32 frame) {
+template<class FST>
+void LatticeFasterDecoder::ProcessNonemittingTpl(
+    const FST &fst, int32 frame) {
   // note: "frame" is the same as emitting states just processed.
     
   // Processes nonemitting arcs for one frame.  Propagates within toks_.
@@ -662,7 +897,7 @@ void LatticeFasterDecoder::ProcessNonemitting(int32 frame) {
       warned_ = true;
     }
   }
-  BaseFloat cutoff = best_cost + config_.beam;
+  BaseFloat cutoff = best_cost + CurrentBeam();
     
   while (!queue_.empty()) {
     StateId state = queue_.back();
@@ -676,9 +911,8 @@ void LatticeFasterDecoder::ProcessNonemitting(int32 frame) {
     // because we're about to regenerate them.  This is a kind
     // of non-optimality (remember, this is the simple decoder),
     // but since most states are emitting it's not a huge issue.
-    tok->DeleteForwardLinks(); // necessary when re-visiting
-    tok->links = NULL;
-    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+    DeleteForwardLinks(tok); // necessary when re-visiting
+    for (fst::ArcIterator<FST> aiter(fst, state);
          !aiter.Done();
          aiter.Next()) {
       const Arc &arc = aiter.Value();
@@ -689,10 +923,10 @@ void LatticeFasterDecoder::ProcessNonemitting(int32 frame) {
           bool changed;
 
           Token *new_tok = FindOrAddToken(arc.nextstate, frame, tot_cost,
-                                          &changed);
+                                          tok, &changed);
             
-          tok->links = new ForwardLink(new_tok, 0, arc.olabel,
-                                       graph_cost, 0, tok->links);
+          tok->links = NewForwardLink(new_tok, 0, arc.olabel,
+                                      graph_cost, 0, tok->links);
             
           // "changed" tells us whether the new token has a different
           // cost from before, or is new [if so, add into queue].
@@ -703,6 +937,27 @@ void LatticeFasterDecoder::ProcessNonemitting(int32 frame) {
   } // while queue not empty
 }
 
+void LatticeFasterDecoder::ProcessNonemitting(int32 frame) {
+  KALDI_PROFILE_SCOPE("LatticeFasterDecoder::ProcessNonemitting");
+  switch (fst_type_) {
+    case fst::kVectorGraph:
+      ProcessNonemittingTpl(static_cast<const fst::VectorFst<Arc>&>(fst_),
+                            frame);
+      break;
+    case fst::kConstGraph:
+      ProcessNonemittingTpl(static_cast<const fst::ConstFst<Arc>&>(fst_),
+                            frame);
+      break;
+    case fst::kMappedConstGraph:
+      ProcessNonemittingTpl(static_cast<const fst::MappedConstFst&>(fst_),
+                            frame);
+      break;
+    default:
+      ProcessNonemittingTpl(fst_, frame);
+      break;
+  }
+}
+
 
 void LatticeFasterDecoder::DeleteElems(Elem *list) {
   for (Elem *e = list, *e_tail; e != NULL; e = e_tail) {
@@ -713,19 +968,32 @@ void LatticeFasterDecoder::DeleteElems(Elem *list) {
 }
   
 void LatticeFasterDecoder::ClearActiveTokens() { // a cleanup routine, at utt end/begin
-  for (size_t i = 0; i < active_toks_.size(); i++) {
-    // Delete all tokens alive on this frame, and any forward
-    // links they may have.
-    for (Token *tok = active_toks_[i].toks; tok != NULL; ) {
-      tok->DeleteForwardLinks();
-      Token *next_tok = tok->next;
-      delete tok;
-      num_toks_--;
-      tok = next_tok;
-    }
-  }
+  // All Tokens and ForwardLinks were allocated from our pools, so we can give
+  // them all back at once rather than walking the lists and deleting them one
+  // by one.
+  KALDI_ASSERT(token_pool_.NumInUse() == static_cast<size_t>(num_toks_));
   active_toks_.clear();
-  KALDI_ASSERT(num_toks_ == 0);
+  token_pool_.FreeAll();
+  link_pool_.FreeAll();
+  num_toks_ = 0;
+}
+
+void LatticeFasterDecoder::SetPoolBlockSizes(size_t token_block_size,
+                                             size_t link_block_size) {
+  KALDI_ASSERT(num_toks_ == 0 && "SetPoolBlockSizes called during decoding");
+  token_pool_.SetBlockSize(token_block_size);
+  link_pool_.SetBlockSize(link_block_size);
+}
+
+void LatticeFasterDecoder::PrintPoolStats() const {
+  const MemoryPoolStats &t = token_pool_.GetStats(),
+      &l = link_pool_.GetStats();
+  KALDI_LOG << "Token pool: max-in-use " << t.max_in_use << ", allocated "
+            << t.num_allocated << " in " << t.num_blocks << " blocks, "
+            << t.num_calls << " allocations this utterance.";
+  KALDI_LOG << "ForwardLink pool: max-in-use " << l.max_in_use
+            << ", allocated " << l.num_allocated << " in " << l.num_blocks
+            << " blocks, " << l.num_calls << " allocations this utterance.";
 }
 
 DecodeUtteranceLatticeFasterClass::DecodeUtteranceLatticeFasterClass(
@@ -745,7 +1013,9 @@ DecodeUtteranceLatticeFasterClass::DecodeUtteranceLatticeFasterClass(
     int64 *frame_sum, // on success, adds #frames to this.
     int32 *num_done, // on success (including partial decode), increments this.
     int32 *num_err,  // on failure, increments this.
-    int32 *num_partial):  // If partial decode (final-state not reached), increments this.
+    int32 *num_partial,  // If partial decode (final-state not reached), increments this.
+    const NumaReplicated<fst::Fst<fst::StdArc> > *graph,
+    const LatticeFasterDecoderConfig *config):
     decoder_(decoder), decodable_(decodable), trans_model_(&trans_model),
     word_syms_(word_syms), utt_(utt), acoustic_scale_(acoustic_scale),
     determinize_(determinize), allow_partial_(allow_partial),
@@ -755,9 +1025,14 @@ DecodeUtteranceLatticeFasterClass::DecodeUtteranceLatticeFasterClass(
     lattice_writer_(lattice_writer),
     like_sum_(like_sum), frame_sum_(frame_sum),
     num_done_(num_done), num_err_(num_err),
-    num_partial_(num_partial),
+    num_partial_(num_partial), graph_(graph),
     computed_(false), success_(false), partial_(false),
-    clat_(NULL), lat_(NULL) { }
+    clat_(NULL), lat_(NULL) {
+  if (decoder_ == NULL) {
+    KALDI_ASSERT(graph != NULL && config != NULL);
+    config_ = *config;
+  }
+}
 
 
 void DecodeUtteranceLatticeFasterClass::operator () () {
@@ -765,7 +1040,10 @@ void DecodeUtteranceLatticeFasterClass::operator () () {
   computed_ = true; // Just means this function was called-- a check on the
   // calling code.
   success_ = true;
+  ScopedLogTag log_tag(utt_);  // Messages from this thread show the utterance.
   using fst::VectorFst;
+  if (decoder_ == NULL)
+    decoder_ = new LatticeFasterDecoder(graph_->Get(), config_);
   if (!decoder_->Decode(decodable_)) {
     KALDI_WARN << "Failed to decode file " << utt_;
     success_ = false;
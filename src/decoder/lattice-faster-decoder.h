@@ -24,12 +24,15 @@
 
 
 #include "util/stl-utils.h"
-#include "util/hash-list.h"
+#include "util/open-hash-list.h"
+#include "util/memory-pool.h"
 #include "fst/fstlib.h"
 #include "itf/decodable-itf.h"
 #include "fstext/fstext-lib.h"
 #include "lat/determinize-lattice-pruned.h"
 #include "lat/kaldi-lattice.h"
+#include "decoder/decoder-pruning.h"
+#include "thread/kaldi-numa.h"
 
 namespace kaldi {
 
@@ -43,6 +46,9 @@ struct LatticeFasterDecoderConfig {
   // command-line program.
   BaseFloat beam_delta; // has nothing to do with beam_ratio
   BaseFloat hash_ratio;
+  int32 histogram_bins;
+  BaseFloat max_mem_mb;
+  AdaptiveBeamOptions adaptive_beam;
   // Most of the options inside det_opts are not actually queried by the
   // LatticeFasterDecoder class itself, but by the code that calls it, for
   // example in the function DecodeUtteranceLatticeFaster.
@@ -54,9 +60,12 @@ struct LatticeFasterDecoderConfig {
                                 prune_interval(25),
                                 determinize_lattice(true),
                                 beam_delta(0.5),
-                                hash_ratio(2.0) {}
+                                hash_ratio(2.0),
+                                histogram_bins(0),
+                                max_mem_mb(0.0) {}
   void Register(OptionsItf *po) {
     det_opts.Register(po);
+    adaptive_beam.Register(po);
     po->Register("beam", &beam, "Decoding beam.");
     po->Register("max-active", &max_active, "Decoder max active states.");
     po->Register("min-active", &min_active, "Decoder minimum #active states.");
@@ -71,11 +80,24 @@ struct LatticeFasterDecoderConfig {
                  "max-active constraint is applied.  Larger is more accurate.");
     po->Register("hash-ratio", &hash_ratio, "Setting used in decoder to control"
                  " hash behavior");
+    po->Register("histogram-bins", &histogram_bins, "If >0, apply --max-active "
+                 "using a histogram of token costs with this many bins over the "
+                 "beam, instead of an exact selection (faster; keeps slightly "
+                 "fewer tokens)");
+    po->Register("max-mem-mb", &max_mem_mb, "If >0, a limit in megabytes on "
+                 "the memory used for the tokens and links of the lattice "
+                 "being decoded.  When it is approached, the lattice beam is "
+                 "reduced, and if that is not enough only the best path is "
+                 "kept, for the rest of the utterance.  (Not a hard limit: the "
+                 "tokens on the current frame are limited only by "
+                 "--max-active.  See also --max-mem, for determinization.)");
   }
   void Check() const {
     KALDI_ASSERT(beam > 0.0 && max_active > 1 && lattice_beam > 0.0 
                  && prune_interval > 0 && beam_delta > 0.0
-                 && hash_ratio >= 1.0);
+                 && hash_ratio >= 1.0 && histogram_bins >= 0
+                 && max_mem_mb >= 0.0);
+    adaptive_beam.Check();
   }
 };
 
@@ -103,6 +125,7 @@ class LatticeFasterDecoder {
   
   void SetOptions(const LatticeFasterDecoderConfig &config) {
     config_ = config;
+    pruner_.SetNumBins(config.histogram_bins);
   }
 
   LatticeFasterDecoderConfig GetOptions() {
@@ -115,20 +138,64 @@ class LatticeFasterDecoder {
   }
 
   // Returns true if any kind of traceback is available (not necessarily from
-  // a final state).
+  // a final state).  This is equivalent to calling InitDecoding(),
+  // AdvanceDecoding(decodable) and FinalizeDecoding().
   bool Decode(DecodableInterface *decodable);
-  
+
+  /// InitDecoding, AdvanceDecoding and FinalizeDecoding are an alternative
+  /// to Decode() for when the features (and hence the decodable object) become
+  /// available a chunk at a time, e.g. in online decoding.  InitDecoding()
+  /// cleans up from any previous utterance and initializes the decoding.
+  void InitDecoding();
+
+  /// Decodes up to "max_num_frames" more frames (or until the decodable
+  /// object's last frame, if sooner); if max_num_frames is negative, decodes
+  /// until the last frame.  Because IsLastFrame() is all we can ask of the
+  /// decodable object, the caller has to make sure it can supply the frames
+  /// we'll ask for.  The lattice is pruned every config_.prune_interval frames
+  /// (counting from the start of the utterance, not of the chunk), so calling
+  /// this with small chunks costs no more than decoding all at once.
+  void AdvanceDecoding(DecodableInterface *decodable,
+                       int32 max_num_frames = -1);
+
+  /// Does the final-probs-aware pruning at the end of the utterance.  After
+  /// calling this you may not call AdvanceDecoding() again until the next
+  /// InitDecoding().  Calling it is optional: GetRawLattice() and
+  /// GetBestPath() also work on a partially decoded utterance, but the
+  /// lattice will be larger as it has not been pruned using the final-probs.
+  void FinalizeDecoding();
+
+  /// Returns the number of frames decoded so far.
+  int32 NumFramesDecoded() const { return active_toks_.size() - 1; }
+
   /// says whether a final-state was active on the last frame.  If it was not, the
   /// lattice (or traceback) will end with states that are not final-states.
+  /// Only meaningful after FinalizeDecoding() (or Decode()).
   bool ReachedFinal() const { return final_active_; }
 
   // Outputs an FST corresponding to the single best path
-  // through the lattice.
-  bool GetBestPath(fst::MutableFst<LatticeArc> *ofst) const;
+  // through the lattice.  If use_final_probs == false, or no final-state
+  // is active, all active states on the last frame are treated as final
+  // with zero cost; this is useful for getting partial results in the middle
+  // of an utterance.
+  bool GetBestPath(fst::MutableFst<LatticeArc> *ofst,
+                   bool use_final_probs = true) const;
+
+  // Like GetBestPath(), but instead of building the raw lattice and finding
+  // its shortest path, it follows each token's backpointer to the token its
+  // best path came from; its cost is linear in the number of frames, so it
+  // is the one to call repeatedly for partial results during decoding.  It
+  // gives the same path as GetBestPath(), except that where two paths have
+  // exactly equal cost it may pick the other one.
+  bool GetBestPathTraceback(fst::MutableFst<LatticeArc> *ofst,
+                            bool use_final_probs = true) const;
 
   // Outputs an FST corresponding to the raw, state-level
-  // tracebacks.
-  bool GetRawLattice(fst::MutableFst<LatticeArc> *ofst) const;
+  // tracebacks.  See GetBestPath() for the meaning of use_final_probs;
+  // after FinalizeDecoding() it is ignored, as the final-costs were
+  // already decided then.
+  bool GetRawLattice(fst::MutableFst<LatticeArc> *ofst,
+                     bool use_final_probs = true) const;
 
   // This function is now deprecated, since now we do determinization from
   // outside the LatticeTrackingDecoder class.
@@ -136,6 +203,15 @@ class LatticeFasterDecoder {
   // lattice (one path per word sequence).
   bool GetLattice(fst::MutableFst<CompactLatticeArc> *ofst) const;
 
+  /// Prints statistics on the memory pools used for the Tokens and
+  /// ForwardLinks, e.g. the peak number of each that were in use on the last
+  /// utterance; useful for sizing the pools via SetPoolBlockSizes().  Decode()
+  /// calls this itself if the verbose level is >= 2.
+  void PrintPoolStats() const;
+
+  /// Sets the number of Tokens and ForwardLinks that are obtained from the
+  /// system at one time.  Must be called before decoding.
+  void SetPoolBlockSizes(size_t token_block_size, size_t link_block_size);
 
  private:
   struct Token;
@@ -173,20 +249,47 @@ class LatticeFasterDecoder {
     ForwardLink *links; // Head of singly linked list of ForwardLinks
     
     Token *next; // Next in list of tokens for this frame.
+
+    Token *backpointer; // The token (on this frame or the previous one) that
+    // the best path to this token came from; NULL for the start token.  Used
+    // in GetBestPathTraceback().  The best path to a surviving token never
+    // gets pruned, as its links have zero extra cost relative to the token.
     
     inline Token(BaseFloat tot_cost, BaseFloat extra_cost, ForwardLink *links,
-                 Token *next): tot_cost(tot_cost), extra_cost(extra_cost),
-                 links(links), next(next) { }
-    inline void DeleteForwardLinks() {
-      ForwardLink *l = links, *m; 
-      while (l != NULL) {
-        m = l->next;
-        delete l;
-        l = m;
-      }
-      links = NULL;
-    }
+                 Token *next, Token *backpointer):
+        tot_cost(tot_cost), extra_cost(extra_cost), links(links), next(next),
+        backpointer(backpointer) { }
   };
+
+  // Tokens and ForwardLinks are allocated from these pools rather than
+  // with new and delete; see ../util/memory-pool.h.  Note: these are
+  // declared before the other members so that they are destroyed last.
+  MemoryPool<Token> token_pool_;
+  MemoryPool<ForwardLink> link_pool_;
+
+  inline Token *NewToken(BaseFloat tot_cost, BaseFloat extra_cost,
+                         ForwardLink *links, Token *next,
+                         Token *backpointer) {
+    return new (token_pool_.Allocate()) Token(tot_cost, extra_cost,
+                                              links, next, backpointer);
+  }
+  inline ForwardLink *NewForwardLink(Token *next_tok, Label ilabel,
+                                     Label olabel, BaseFloat graph_cost,
+                                     BaseFloat acoustic_cost,
+                                     ForwardLink *next) {
+    return new (link_pool_.Allocate()) ForwardLink(next_tok, ilabel, olabel,
+                                                   graph_cost, acoustic_cost,
+                                                   next);
+  }
+  inline void DeleteForwardLinks(Token *tok) {
+    ForwardLink *l = tok->links, *m;
+    while (l != NULL) {
+      m = l->next;
+      link_pool_.Free(l);
+      l = m;
+    }
+    tok->links = NULL;
+  }
   
   // head and tail of per-frame list of Tokens (list is in topological order),
   // and something saying whether we ever pruned it using PruneForwardLinks.
@@ -198,7 +301,7 @@ class LatticeFasterDecoder {
                  must_prune_tokens(true) { }
   };
 
-  typedef HashList<StateId, Token*>::Elem Elem;
+  typedef OpenHashList<StateId, Token*>::Elem Elem;
 
   void PossiblyResizeHash(size_t num_toks);
 
@@ -208,9 +311,10 @@ class LatticeFasterDecoder {
   // and also into the singly linked list of tokens active on this frame
   // (whose head is at active_toks_[frame]).
   // Returns the Token pointer.  Sets "changed" (if non-NULL) to true
-  // if the token was newly created or the cost changed.
+  // if the token was newly created or the cost changed; in that case its
+  // backpointer is set to "backpointer".
   inline Token *FindOrAddToken(StateId state, int32 frame, BaseFloat tot_cost,
-                               bool *changed);
+                               Token *backpointer, bool *changed);
   
   // prunes outgoing links for all tokens in active_toks_[frame]
   // it's called by PruneActiveTokens
@@ -249,11 +353,52 @@ class LatticeFasterDecoder {
   /// Version of PruneActiveTokens that we call on the final frame.
   /// Takes into account the final-prob of tokens.
   void PruneActiveTokensFinal(int32 cur_frame);
+
+  /// Returns the number of bytes used by the Tokens and ForwardLinks that
+  /// are currently allocated.
+  size_t TokenMemoryInUse() const {
+    return token_pool_.NumInUse() * sizeof(Token) +
+        link_pool_.NumInUse() * sizeof(ForwardLink);
+  }
+
+  /// Called on each frame if config_.max_mem_mb > 0.  If the tokens and links
+  /// use more than half of the limit, prunes the lattice, and if that is not
+  /// enough, reduces lattice_beam_ (as far as 1/16 of config_.lattice_beam)
+  /// and prunes all frames again; if we are then still over 3/4 of the limit,
+  /// sets lattice_beam_ to (nearly) zero, which keeps only the best path to
+  /// each token on the current frame.
+  void LimitMemory(int32 cur_frame);
+
+  /// Works out the final-costs of the tokens on the most recent frame, for
+  /// use by GetRawLattice() before FinalizeDecoding() has been called.  If
+  /// use_final_probs == false or no final-state is active, every token gets
+  /// zero cost, as in PruneForwardLinksFinal().
+  void ComputeFinalCosts(bool use_final_probs,
+                         std::map<Token*, BaseFloat> *final_costs) const;
+
+  /// Returns the token that ends the best path on the most recent frame (with
+  /// its final-cost in *final_cost, see GetBestPath() for the meaning of
+  /// use_final_probs), or NULL if there are no tokens.
+  Token *BestFinalToken(bool use_final_probs, BaseFloat *final_cost) const;
   
   /// Gets the weight cutoff.  Also counts the active tokens.
   BaseFloat GetCutoff(Elem *list_head, size_t *tok_count,
                       BaseFloat *adaptive_beam, Elem **best_elem);
 
+  /// The beam in use on this frame: config_.beam, unless the adaptive beam
+  /// (config_.adaptive_beam) is enabled.
+  BaseFloat CurrentBeam() const {
+    return beam_controller_.Enabled() ? beam_controller_.Beam() : config_.beam;
+  }
+
+  /// Works out which input labels are on emitting arcs out of tokens in
+  /// "list" that are within "cutoff", and gets their log-likelihoods for this
+  /// (zero-based) frame from the decodable object in a single call; the
+  /// results go in loglikes_, indexed by label.
+  template<class FST>
+  void ComputeLogLikesTpl(const FST &fst, DecodableInterface *decodable,
+                          int32 frame, Elem *list, BaseFloat cutoff);
+
   /// Processes emitting arcs for one frame.  Propagates from prev_toks_ to cur_toks_.
   void ProcessEmitting(DecodableInterface *decodable, int32 frame);
 
@@ -263,28 +408,54 @@ class LatticeFasterDecoder {
   /// returned from ProcessEmitting, in faster-decoder.h).
   void ProcessNonemitting(int32 frame);
 
-  // HashList defined in ../util/hash-list.h.  It actually allows us to maintain
-  // more than one list (e.g. for current and previous frames), but only one of
-  // them at a time can be indexed by StateId.
-  HashList<StateId, Token*> toks_;
+  /// ProcessEmitting() and ProcessNonemitting() call these versions, templated
+  /// on the type of the FST, so that for the common types of decoding graph
+  /// (see fst::DecodingGraphType) the arc iteration is inlined.
+  template<class FST>
+  void ProcessEmittingTpl(const FST &fst, DecodableInterface *decodable,
+                          int32 frame);
+
+  template<class FST>
+  void ProcessNonemittingTpl(const FST &fst, int32 frame);
+
+  // OpenHashList defined in ../util/open-hash-list.h (it has the same interface
+  // as HashList in ../util/hash-list.h, but uses open addressing, which is
+  // faster when there are many active tokens).  It actually allows us to
+  // maintain more than one list (e.g. for current and previous frames), but
+  // only one of them at a time can be indexed by StateId.
+  OpenHashList<StateId, Token*> toks_;
   std::vector<TokenList> active_toks_; // Lists of tokens, indexed by
   // frame (members of TokenList are toks, must_prune_forward_links,
   // must_prune_tokens).
   std::vector<StateId> queue_;  // temp variable used in ProcessNonemitting,
-  std::vector<BaseFloat> tmp_array_;  // used in GetCutoff.
+  HistogramPruner pruner_;  // used in GetCutoff.
   // make it class member to avoid internal new/delete.
+  AdaptiveBeamController beam_controller_;  // see CurrentBeam().
+
+  // The following are used in ComputeLogLikesTpl().
+  std::vector<Label> active_labels_;  // labels needed on the current frame.
+  std::vector<BaseFloat> active_loglikes_;  // their log-likelihoods.
+  std::vector<BaseFloat> loglikes_;  // log-likelihoods indexed by label.
+  std::vector<bool> label_seen_;  // temporary, indexed by label.
   const fst::Fst<fst::StdArc> &fst_;
+  fst::DecodingGraphType fst_type_;
   bool delete_fst_;
   std::vector<BaseFloat> cost_offsets_; // This contains, for each
   // frame, an offset that was added to the acoustic likelihoods on that
   // frame in order to keep everything in a nice dynamic range.
   LatticeFasterDecoderConfig config_;
+  BaseFloat lattice_beam_;  // The lattice beam used for pruning; equals
+  // config_.lattice_beam unless reduced by LimitMemory() on this utterance.
+  size_t mem_threshold_;  // LimitMemory() does nothing until the memory in use
+  // exceeds this.
   int32 num_toks_; // current total #toks allocated...
   bool warned_;
   bool final_active_; // use this to say whether we found active final tokens
   // on the last frame.
   std::map<Token*, BaseFloat> final_costs_; // A cache of final-costs
   // of tokens on the last frame-- it's just convenient to store it this way.
+  bool decoding_finalized_; // true if FinalizeDecoding() has been called
+  // for this utterance; final_costs_ is only valid if so.
   
   // There are various cleanup tasks... the the toks_ structure contains
   // singly linked lists of Token pointers, where Elem is the list type.
@@ -336,7 +507,12 @@ class DecodeUtteranceLatticeFasterClass {
   // Initializer sets various variables.
   // NOTE: we "take ownership" of "decoder" and "decodable".  These
   // are deleted by the destructor.  On error, "num_err" is incremented.
-  DecodeUtteranceLatticeFasterClass( 
+  // If "decoder" is NULL, "graph" and "config" must be given, and the decoder
+  // is created in operator () (i.e. by the thread that decodes) from the copy
+  // of the graph for that thread's NUMA node (see thread/kaldi-numa.h), so
+  // that with --numa-policy both the graph and the decoder's state are local
+  // to the thread.  "graph" must outlive this object.
+  DecodeUtteranceLatticeFasterClass(  
       LatticeFasterDecoder *decoder,
       DecodableInterface *decodable,
       const TransitionModel &trans_model,
@@ -353,7 +529,9 @@ class DecodeUtteranceLatticeFasterClass {
       int64 *frame_sum, // on success, adds #frames to this.
       int32 *num_done, // on success (including partial decode), increments this.
       int32 *num_err,  // on failure, increments this.
-      int32 *num_partial);  // If partial decode (final-state not reached), increments this.
+      int32 *num_partial,  // If partial decode (final-state not reached), increments this.
+      const NumaReplicated<fst::Fst<fst::StdArc> > *graph = NULL,
+      const LatticeFasterDecoderConfig *config = NULL);
   void operator () (); // The decoding happens here.
   ~DecodeUtteranceLatticeFasterClass(); // Output happens here.
  private:
@@ -375,6 +553,8 @@ class DecodeUtteranceLatticeFasterClass {
   int32 *num_done_;
   int32 *num_err_;
   int32 *num_partial_;
+  const NumaReplicated<fst::Fst<fst::StdArc> > *graph_;  // if decoder_ == NULL.
+  LatticeFasterDecoderConfig config_;  // if decoder_ == NULL.
 
   // The following variables are stored by the computation.
   bool computed_; // operator ()  was called.
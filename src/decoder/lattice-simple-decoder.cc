@@ -20,6 +20,7 @@
 // limitations under the License.
 
 #include "lattice-simple-decoder.h"
+#include "util/kaldi-profile.h"
 
 namespace kaldi {
 
@@ -400,6 +401,7 @@ void LatticeSimpleDecoder::PruneTokensForFrame(int32 frame) {
 // going backward and propagating the change.  larger delta -> will recurse less
 // far.
 void LatticeSimpleDecoder::PruneActiveTokens(int32 cur_frame, BaseFloat delta) {
+  KALDI_PROFILE_SCOPE("LatticeSimpleDecoder::PruneActiveTokens");
   int32 num_toks_begin = num_toks_;
   for (int32 frame = cur_frame-1; frame >= 0; frame--) {
     // Reason why we need to prune forward links in this situation:
@@ -447,7 +449,9 @@ void LatticeSimpleDecoder::PruneActiveTokensFinal(int32 cur_frame) {
                 << " to " << num_toks_;
 }
   
-void LatticeSimpleDecoder::ProcessEmitting(DecodableInterface *decodable, int32 frame) {
+template<class FST>
+void LatticeSimpleDecoder::ProcessEmittingTpl(
+    const FST &fst, DecodableInterface *decodable, int32 frame) {
   // Processes emitting arcs for one frame.  Propagates from
   // prev_toks_ to cur_toks_.
   BaseFloat cutoff = std::numeric_limits<BaseFloat>::infinity();
@@ -456,7 +460,7 @@ void LatticeSimpleDecoder::ProcessEmitting(DecodableInterface *decodable, int32
        ++iter) {
     StateId state = iter->first;
     Token *tok = iter->second;
-    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+    for (fst::ArcIterator<FST> aiter(fst, state);
          !aiter.Done();
          aiter.Next()) {
       const Arc &arc = aiter.Value();
@@ -479,7 +483,30 @@ void LatticeSimpleDecoder::ProcessEmitting(DecodableInterface *decodable, int32
   }
 }
 
-void LatticeSimpleDecoder::ProcessNonemitting(int32 frame) {
+void LatticeSimpleDecoder::ProcessEmitting(DecodableInterface *decodable, int32 frame) {
+  KALDI_PROFILE_SCOPE("LatticeSimpleDecoder::ProcessEmitting");
+  switch (fst_type_) {
+    case fst::kVectorGraph:
+      ProcessEmittingTpl(static_cast<const fst::VectorFst<Arc>&>(fst_),
+                         decodable, frame);
+      break;
+    case fst::kConstGraph:
+      ProcessEmittingTpl(static_cast<const fst::ConstFst<Arc>&>(fst_),
+                         decodable, frame);
+      break;
+    case fst::kMappedConstGraph:
+      ProcessEmittingTpl(static_cast<const fst::MappedConstFst&>(fst_),
+                         decodable, frame);
+      break;
+    default:
+      ProcessEmittingTpl(fst_, decodable, frame);
+      break;
+  }
+}
+
+template<class FST>
+void LatticeSimpleDecoder::ProcessNonemittingTpl(
+    const FST &fst, int32 frame) {
   // note: "frame" is the same as emitting states
   // just processed.
     
@@ -515,7 +542,7 @@ void LatticeSimpleDecoder::ProcessNonemitting(int32 frame) {
     // but since most states are emitting it's not a huge issue.
     tok->DeleteForwardLinks();
     tok->links = NULL;
-    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
+    for (fst::ArcIterator<FST> aiter(fst, state);
          !aiter.Done();
          aiter.Next()) {
       const Arc &arc = aiter.Value();
@@ -541,6 +568,27 @@ void LatticeSimpleDecoder::ProcessNonemitting(int32 frame) {
   }
 }
 
+void LatticeSimpleDecoder::ProcessNonemitting(int32 frame) {
+  KALDI_PROFILE_SCOPE("LatticeSimpleDecoder::ProcessNonemitting");
+  switch (fst_type_) {
+    case fst::kVectorGraph:
+      ProcessNonemittingTpl(static_cast<const fst::VectorFst<Arc>&>(fst_),
+                            frame);
+      break;
+    case fst::kConstGraph:
+      ProcessNonemittingTpl(static_cast<const fst::ConstFst<Arc>&>(fst_),
+                            frame);
+      break;
+    case fst::kMappedConstGraph:
+      ProcessNonemittingTpl(static_cast<const fst::MappedConstFst&>(fst_),
+                            frame);
+      break;
+    default:
+      ProcessNonemittingTpl(fst_, frame);
+      break;
+  }
+}
+
 void LatticeSimpleDecoder::ClearActiveTokens() { // a cleanup routine, at utt end/begin
   for (size_t i = 0; i < active_toks_.size(); i++) {
     // Delete all tokens alive on this frame, and any forward
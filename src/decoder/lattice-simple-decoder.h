@@ -82,7 +82,8 @@ class LatticeSimpleDecoder {
   // instantiate this class onece for each thing you have to decode.
   LatticeSimpleDecoder(const fst::Fst<fst::StdArc> &fst,
                        const LatticeSimpleDecoderConfig &config):
-      fst_(fst), config_(config), num_toks_(0) { config.Check(); }
+      fst_(fst), fst_type_(fst::GetDecodingGraphType(fst)), config_(config),
+      num_toks_(0) { config.Check(); }
   
   ~LatticeSimpleDecoder() { ClearActiveTokens(); }
 
@@ -221,10 +222,20 @@ class LatticeSimpleDecoder {
   // and final_probs_ (a hash) is also set by PruneForwardLinksFinal.
   void PruneActiveTokensFinal(int32 cur_frame);
 
+  /// ProcessEmitting() and ProcessNonemitting() call the "Tpl" versions,
+  /// templated on the type of the FST, so that for the common types of
+  /// decoding graph (see fst::DecodingGraphType) the arc iteration is inlined.
   void ProcessEmitting(DecodableInterface *decodable, int32 frame);
 
   void ProcessNonemitting(int32 frame);
 
+  template<class FST>
+  void ProcessEmittingTpl(const FST &fst, DecodableInterface *decodable,
+                          int32 frame);
+
+  template<class FST>
+  void ProcessNonemittingTpl(const FST &fst, int32 frame);
+
   void ClearActiveTokens(); // a cleanup routine, at utt end/begin
 
   // PruneCurrentTokens deletes the tokens from the "toks" map, but not
@@ -238,6 +249,7 @@ class LatticeSimpleDecoder {
   // frame (members of TokenList are toks, must_prune_forward_links,
   // must_prune_tokens).
   const fst::Fst<fst::StdArc> &fst_;
+  fst::DecodingGraphType fst_type_;
   LatticeSimpleDecoderConfig config_;
   int32 num_toks_; // current total #toks allocated...
   bool warned_;
@@ -37,6 +37,7 @@ LatticeTrackingDecoder::LatticeTrackingDecoder(const fst::Fst<fst::StdArc> &fst,
 bool LatticeTrackingDecoder::Decode(DecodableInterface *decodable,
                                     const fst::StdVectorFst &arc_graph) {
   arc_graph_ = &arc_graph;
+  IndexArcGraph();
   // clean up from last time:
   ClearToks(toks_.Clear());
   cost_offsets_.clear();
@@ -665,37 +666,30 @@ void LatticeTrackingDecoder::ProcessEmitting(DecodableInterface *decodable, int3
     Token *tok = e->val;
     if ((tok->tot_cost <= cur_cutoff) || (tok->lat_state != fst::kNoStateId)) {
       // only prune tokens that are not tracked
-      std::vector<std::pair<Label, StateId> > lat_arcs; // arc number and next state
+      // in case of tracked tokens, the arcs of arc_graph_ from lat_state
+      // are lat_arcs_[lat_arc_num] up to lat_arcs_[lat_arc_end].
+      int32 lat_arc_num = 0, lat_arc_end = 0;
       if (tok->lat_state != fst::kNoStateId) {
-        // in case of tracked tokens, iterate all outgoing arcs from arc_graph_
-        fst::MutableArcIterator<fst::StdVectorFst> lat_iter
-          (const_cast<fst::StdVectorFst*>(arc_graph_), tok->lat_state);
         // do final states correspond? (lat_state and HCLG state should be final)
         if (arc_graph_->Final(tok->lat_state) != Weight::Zero()) {
           KALDI_ASSERT(fst_.Final(state) != Weight::Zero());
         }
-        int32 last_arc_num = -1;
-        for (; !lat_iter.Done(); lat_iter.Next()) {
-          const Arc &lat_arc = lat_iter.Value();
-          KALDI_ASSERT(lat_arc.ilabel == state); // ilabel contains HCLG state
-          KALDI_ASSERT(lat_arc.olabel > last_arc_num);
-          // assume arc_graph arcs are sorted by arc_num, each arc_num occurs once
-          last_arc_num = lat_arc.olabel; // olabel contains HCLG arc number
-          lat_arcs.push_back(std::make_pair(lat_arc.olabel, lat_arc.nextstate));
-        }
+        lat_arc_num = lat_arcs_begin_[tok->lat_state];
+        lat_arc_end = lat_arcs_begin_[tok->lat_state + 1];
+        KALDI_ASSERT(lat_arc_num == lat_arc_end ||
+                     lat_hclg_states_[tok->lat_state] == state);
       }
-      int32 arc_num = 0, lat_arc_num = 0;
+      int32 arc_num = 0;
       for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state); // HCLG arcs
            !aiter.Done();
            aiter.Next()) {
         // match HCLG arcs with arc_graph arcs
         // not all HCLG arcs are in arc_graph
         StateId lat_nextstate = fst::kNoStateId;
-        if (lat_arc_num < lat_arcs.size()) { // still graph arcs to process
-          if (arc_num == lat_arcs[lat_arc_num].first) {
-            lat_nextstate = lat_arcs[lat_arc_num].second;
-            lat_arc_num++;
-          }
+        if (lat_arc_num < lat_arc_end &&  // still graph arcs to process
+            arc_num == lat_arcs_[lat_arc_num].first) {
+          lat_nextstate = lat_arcs_[lat_arc_num].second;
+          lat_arc_num++;
         }
         arc_num++;
         // normal arc processing
@@ -784,37 +778,30 @@ void LatticeTrackingDecoder::ProcessNonemitting(int32 frame) {
     tok->DeleteForwardLinks(); // necessary when re-visiting
     tok->links = NULL;
     //GetArcStateMap(&arc_map, state, tok->lat_state); // in case of tracked tokens, contains nextstates
-    std::vector<std::pair<Label, StateId> > lat_arcs; // arc number and next state
+    // in case of tracked tokens, the arcs of arc_graph_ from lat_state
+    // are lat_arcs_[lat_arc_num] up to lat_arcs_[lat_arc_end].
+    int32 lat_arc_num = 0, lat_arc_end = 0;
     if (tok->lat_state != fst::kNoStateId) {
-      // in case of tracked tokens, iterate all outgoing arcs from arc_graph_
-      fst::MutableArcIterator<fst::StdVectorFst> lat_iter
-        (const_cast<fst::StdVectorFst*>(arc_graph_), tok->lat_state);
       // do final states correspond? (lat_state and HCLG state should be final)
       if (arc_graph_->Final(tok->lat_state) != Weight::Zero()) {
         KALDI_ASSERT(fst_.Final(state) != Weight::Zero());
       }
-      int32 last_arc_num = -1;
-      for (; !lat_iter.Done(); lat_iter.Next()) {
-        const Arc &lat_arc = lat_iter.Value();
-        KALDI_ASSERT(lat_arc.ilabel == state); // ilabel contains HCLG state
-        KALDI_ASSERT(lat_arc.olabel > last_arc_num);
-        // assume arc_graph arcs are sorted by arc_num, each arc_num occurs once
-        last_arc_num = lat_arc.olabel; // olabel contains HCLG arc number
-        lat_arcs.push_back(std::make_pair(lat_arc.olabel, lat_arc.nextstate));
-      }
+      lat_arc_num = lat_arcs_begin_[tok->lat_state];
+      lat_arc_end = lat_arcs_begin_[tok->lat_state + 1];
+      KALDI_ASSERT(lat_arc_num == lat_arc_end ||
+                   lat_hclg_states_[tok->lat_state] == state);
     }
-    int32 arc_num = 0, lat_arc_num = 0;
+    int32 arc_num = 0;
     for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
          !aiter.Done();
          aiter.Next()) {
       // match HCLG arcs with arc_graph arcs
       // not all HCLG arcs are in arc_graph
       StateId lat_nextstate = fst::kNoStateId;
-      if (lat_arc_num < lat_arcs.size()) { // still graph arcs to process
-        if (arc_num == lat_arcs[lat_arc_num].first) {
-          lat_nextstate = lat_arcs[lat_arc_num].second;
-          lat_arc_num++;
-        }
+      if (lat_arc_num < lat_arc_end &&  // still graph arcs to process
+          arc_num == lat_arcs_[lat_arc_num].first) {
+        lat_nextstate = lat_arcs_[lat_arc_num].second;
+        lat_arc_num++;
       }
       arc_num++;
       // normal arc processing
@@ -842,6 +829,33 @@ void LatticeTrackingDecoder::ProcessNonemitting(int32 frame) {
 }
 
 
+void LatticeTrackingDecoder::IndexArcGraph() {
+  StateId num_states = arc_graph_->NumStates();
+  lat_arcs_begin_.resize(num_states + 1);
+  lat_arcs_.clear();
+  lat_hclg_states_.assign(num_states, fst::kNoStateId);
+  for (StateId s = 0; s < num_states; s++) {
+    lat_arcs_begin_[s] = lat_arcs_.size();
+    for (fst::ArcIterator<fst::StdVectorFst> aiter(*arc_graph_, s);
+         !aiter.Done(); aiter.Next()) {
+      const Arc &lat_arc = aiter.Value();
+      // ilabel contains HCLG state, olabel contains HCLG arc number
+      if (lat_hclg_states_[s] == fst::kNoStateId)
+        lat_hclg_states_[s] = lat_arc.ilabel;
+      KALDI_ASSERT(lat_arc.ilabel == lat_hclg_states_[s]);
+      lat_arcs_.push_back(std::make_pair(lat_arc.olabel, lat_arc.nextstate));
+    }
+    // the arcs are matched with the HCLG arcs in order of arc number, and each
+    // arc number may occur only once.
+    std::vector<std::pair<Label, StateId> >::iterator
+        begin = lat_arcs_.begin() + lat_arcs_begin_[s], end = lat_arcs_.end();
+    std::sort(begin, end);
+    for (; begin != end && begin + 1 != end; ++begin)
+      KALDI_ASSERT(begin->first < (begin + 1)->first);
+  }
+  lat_arcs_begin_[num_states] = lat_arcs_.size();
+}
+
 void LatticeTrackingDecoder::ClearToks(Elem *list) {
   for (Elem *e = list, *e_tail; e != NULL; e = e_tail) {
     // Token::TokenDelete(e->val);
@@ -307,6 +307,17 @@ class LatticeTrackingDecoder {
 
   const fst::StdVectorFst *arc_graph_; // graph arc lattice from first pass
 
+  // An index of the arcs of arc_graph_, made by IndexArcGraph() at the start
+  // of Decode(), so the tracked tokens do not have to go through arc_graph_
+  // on every frame: the arcs leaving lattice state s are
+  // lat_arcs_[lat_arcs_begin_[s]] up to lat_arcs_[lat_arcs_begin_[s+1]], as
+  // (HCLG arc number, next lattice state) pairs sorted by the arc number,
+  // and lat_hclg_states_[s] is the HCLG state they leave (or kNoStateId).
+  std::vector<int32> lat_arcs_begin_;
+  std::vector<std::pair<Label, StateId> > lat_arcs_;
+  std::vector<StateId> lat_hclg_states_;
+  void IndexArcGraph();
+
   // It might seem unclear why we call ClearToks(toks_.Clear()).
   // There are two separate cleanup tasks we need to do at when we start a new file.
   // one is to delete the Token objects in the list; the other is to delete
@@ -133,6 +133,7 @@ class NBestDecoder {
     Token *tok = token_store_.CreateTok(0, NULL);
     StateId end_state = 1E9; // some imaginary super end state
     tok->c = Weight::Zero();
+    tok->ca = Weight::Zero();
     tok->I = NULL;
     toks_.Insert(end_state, tok);
     Elem *best_e = toks_.Find(end_state);
@@ -170,6 +171,7 @@ class NBestDecoder {
                 lmscore = best_tok->c.Value() - amscore;
       if (KALDI_ISINF(amscore) || KALDI_ISINF(lmscore)) {
         KALDI_WARN << "infinity token! probably too narrow beam to retrieve n best";
+        token_store_.DeleteTok(best_tok);
         e_tail = e->tail;
         toks_.Delete(e);
         continue; // skip that token
@@ -235,19 +237,21 @@ class NBestDecoder {
     // the pointer *previous has a double function:
     // it's also used in linked lists to store allocated tokens
    public:
+    // The members are ordered largest first, so there is no padding: this
+    // makes SeqToken 16 bytes instead of 24 on 64-bit machines.
     struct SeqToken { // an incremental/relative token inside a full Token
-      Label i;   // input label i
       SeqToken *previous;  // lattice backward pointer (also as linked list)
+      Label i;   // input label i
       int refs;       // reference counter (for memory management)
     };
     class Token {
      public:
       // here will be the c and I of 'full tokens'
+      SeqToken *I; // sequence I
+      Token *previous; // t'
       Weight c; // c (total weight)
       Weight ca; // acoustic part of c
-      SeqToken *I; // sequence I
       Label o; // o
-      Token *previous; // t'
       int32 refs; // reference counter (for memory management)
       unsigned hash; // hashing the output symbol sequence
       inline bool operator < (const Token &other) {
@@ -269,23 +273,25 @@ class NBestDecoder {
     };
     typedef HashList<StateId, Token*> TokenHash;
     typedef TokenHash::Elem Elem;
+    // The blocks of tokens allocated for earlier utterances are kept for
+    // reuse; they are only freed by Clear().
     void Init(DecodableInterface *decodable, TokenHash *toks, int32 n_best) {
-      Clear();
       n_best_ = n_best;
       decodable_ = decodable;
       toks_ = toks;
     }
 
     inline void DeleteSeq(SeqToken *seq) {
-      // delete seq token: either decrease reference count or put to linked list
-      seq->refs--;
-      if (seq->refs > 0) return;
-      // really kill sequence token
-      // clean up unused sequence tokens recursively backwards
-      if (seq->previous != NULL) DeleteSeq(seq->previous);
-      // save the unused sequence token in linked list (abusing *previous)
-      seq->previous = free_st_head_;
-      free_st_head_ = seq;
+      // delete seq token: either decrease reference count or put to linked
+      // list, and the same for the tokens before it whose count reaches zero.
+      // This is a loop rather than a recursion, as the sequences can be long.
+      while (seq != NULL && --seq->refs == 0) {
+        SeqToken *prev = seq->previous;
+        // save the unused sequence token in linked list (abusing *previous)
+        seq->previous = free_st_head_;
+        free_st_head_ = seq;
+        seq = prev;
+      }
     }
     inline SeqToken *NewSeq() {
       // new seq token: either take from linked list or extend list
@@ -327,20 +333,18 @@ class NBestDecoder {
     }
 
     inline void DeleteTok(Token *tok) {
-      // delete token: either decrease reference count or put to linked list
-      tok->refs--;
-      if (tok->refs > 0) return;
-      // really kill token
-      // clean up unused tokens recursively backwards
-      if (tok->previous != NULL) {
-        DeleteTok(tok->previous);
-      }
-      if (tok->I != NULL) { // delete sequence I
-        DeleteSeq(tok->I);
+      // delete token: either decrease reference count or put to linked list,
+      // and the same for the tokens before it whose count reaches zero.
+      while (tok != NULL && --tok->refs == 0) {
+        if (tok->I != NULL) { // delete sequence I
+          DeleteSeq(tok->I);
+        }
+        Token *prev = tok->previous;
+        // save the unused token in linked list (abusing *previous)
+        tok->previous = free_t_head_;
+        free_t_head_ = tok;
+        tok = prev;
       }
-      // save the unused token in linked list (abusing *previous)
-      tok->previous = free_t_head_;
-      free_t_head_ = tok;
     }
     inline Token *CreateTok(Label output, Token *prev) {
       // new token: either take from linked list or extend list
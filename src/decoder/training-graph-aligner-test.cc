@@ -0,0 +1,124 @@
+// decoder/training-graph-aligner-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/training-graph-aligner.h"
+#include "decoder/faster-decoder.h"
+#include "decoder/decodable-matrix.h"
+#include "fstext/fstext-utils.h"
+
+namespace kaldi {
+
+typedef fst::StdArc Arc;
+
+// Makes a graph like those for training: a chain of "words" of one to three
+// HMM states with self-loops, with optional silence after each word.
+void MakeTrainingLikeGraph(int32 num_tids, fst::VectorFst<Arc> *fst) {
+  int32 num_words = 1 + rand() % 5;
+  int32 cur = fst->AddState();
+  fst->SetStart(cur);
+  for (int32 w = 0; w < num_words; w++) {
+    int32 num_hmm_states = 1 + rand() % 3;
+    for (int32 k = 0; k < num_hmm_states; k++) {
+      int32 next = fst->AddState();
+      fst->AddArc(cur, Arc(1 + rand() % (num_tids - 1), w + 1, RandUniform(),
+                           next));
+      fst->AddArc(next, Arc(1 + rand() % (num_tids - 1), 0, RandUniform(),
+                            next));
+      cur = next;
+    }
+    int32 after = fst->AddState(), silence = fst->AddState();
+    fst->AddArc(cur, Arc(0, 0, RandUniform(), after));
+    fst->AddArc(cur, Arc(num_tids, 0, RandUniform(), silence));
+    fst->AddArc(silence, Arc(num_tids, 0, RandUniform(), silence));
+    fst->AddArc(silence, Arc(0, 0, RandUniform(), after));
+    cur = after;
+  }
+  fst->SetFinal(cur, RandUniform());
+}
+
+// Checks that the aligner finds the same best path as FasterDecoder with a
+// beam wide enough not to prune.
+void UnitTestTrainingGraphAligner() {
+  for (int32 i = 0; i < 100; i++) {
+    int32 num_tids = 20, num_frames = 1 + rand() % 30;
+    fst::VectorFst<Arc> fst;
+    MakeTrainingLikeGraph(num_tids, &fst);
+    Matrix<BaseFloat> likes(num_frames, num_tids + 1);  // indexed by tid.
+    likes.SetRandn();
+    DecodableMatrixScaled decodable(likes, 1.0);
+
+    FasterDecoderOptions opts;
+    opts.beam = 1000.0;
+    FasterDecoder decoder(fst, opts);
+    decoder.Decode(&decodable);
+    fst::VectorFst<LatticeArc> decoded;
+    bool decoder_ok = decoder.ReachedFinal() && decoder.GetBestPath(&decoded);
+
+    TrainingGraphAligner aligner;
+    KALDI_ASSERT(aligner.Init(fst));
+    std::vector<int32> alignment;
+    BaseFloat score;
+    bool aligner_ok = aligner.Align(&decodable,
+                                    std::numeric_limits<BaseFloat>::infinity(),
+                                    &alignment, &score);
+    KALDI_ASSERT(aligner_ok == decoder_ok);
+    if (!decoder_ok) continue;
+
+    std::vector<int32> decoder_alignment, words;
+    LatticeWeight weight;
+    GetLinearSymbolSequence(decoded, &decoder_alignment, &words, &weight);
+    BaseFloat decoder_score = -(weight.Value1() + weight.Value2());
+    KALDI_ASSERT(ApproxEqual(score, decoder_score));
+    KALDI_ASSERT(alignment == decoder_alignment);
+
+    // With a narrow beam the path found can only be worse.
+    std::vector<int32> pruned_alignment;
+    BaseFloat pruned_score;
+    if (aligner.Align(&decodable, 2.0, &pruned_alignment, &pruned_score)) {
+      KALDI_ASSERT(pruned_alignment.size() == static_cast<size_t>(num_frames));
+      KALDI_ASSERT(pruned_score <= score + 1.0e-03);
+    }
+  }
+}
+
+// Graphs with cycles (other than self-loops) cannot be used.
+void UnitTestTrainingGraphAlignerCycle() {
+  TrainingGraphAligner aligner;
+  fst::VectorFst<Arc> fst;
+  fst.AddState();
+  fst.AddState();
+  fst.SetStart(0);
+  fst.SetFinal(1, 0.0);
+  fst.AddArc(0, Arc(1, 1, 0.0, 1));
+  fst.AddArc(1, Arc(1, 1, 0.0, 1));
+  KALDI_ASSERT(aligner.Init(fst));
+  fst.AddArc(1, Arc(2, 2, 0.0, 0));
+  KALDI_ASSERT(!aligner.Init(fst));
+  fst.DeleteArcs(1);
+  fst.AddArc(1, Arc(0, 0, 0.0, 1));  // epsilon self-loop.
+  KALDI_ASSERT(!aligner.Init(fst));
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::UnitTestTrainingGraphAligner();
+  kaldi::UnitTestTrainingGraphAlignerCycle();
+  std::cout << "Test OK.\n";
+}
@@ -0,0 +1,223 @@
+// decoder/training-graph-aligner.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <limits>
+#include "decoder/training-graph-aligner.h"
+
+namespace kaldi {
+
+bool TrainingGraphAligner::Init(const fst::VectorFst<fst::StdArc> &fst) {
+  typedef fst::StdArc Arc;
+  typedef Arc::StateId StateId;
+  StateId start = fst.Start();
+  if (start == fst::kNoStateId) return false;
+  StateId num_states = fst.NumStates();
+
+  // Find the states reachable from the start state, and how many arcs (other
+  // than self-loops) come into them.
+  std::vector<int32> in_degree(num_states, 0);
+  std::vector<bool> reachable(num_states, false);
+  std::vector<StateId> queue;
+  reachable[start] = true;
+  queue.push_back(start);
+  while (!queue.empty()) {
+    StateId s = queue.back();
+    queue.pop_back();
+    for (fst::ArcIterator<fst::VectorFst<Arc> > aiter(fst, s); !aiter.Done();
+         aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      if (arc.nextstate == s) {
+        if (arc.ilabel == 0) return false;  // epsilon self-loop.
+        continue;
+      }
+      in_degree[arc.nextstate]++;
+      if (!reachable[arc.nextstate]) {
+        reachable[arc.nextstate] = true;
+        queue.push_back(arc.nextstate);
+      }
+    }
+  }
+  if (in_degree[start] != 0) return false;  // there is a cycle.
+
+  // Put them in topological order.  Taking the states first-in first-out
+  // keeps parallel paths (e.g. with and without optional silence) next to
+  // each other, so the bands stay narrow.
+  std::vector<int32> position(num_states, -1);
+  std::vector<StateId> order;
+  order.push_back(start);
+  for (size_t i = 0; i < order.size(); i++) {
+    StateId s = order[i];
+    position[s] = i;
+    for (fst::ArcIterator<fst::VectorFst<Arc> > aiter(fst, s); !aiter.Done();
+         aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      if (arc.nextstate != s && --in_degree[arc.nextstate] == 0)
+        order.push_back(arc.nextstate);
+    }
+  }
+  int32 num_positions = order.size();
+  if (num_positions != std::count(reachable.begin(), reachable.end(), true))
+    return false;  // some states are on a cycle.
+
+  // Store the arcs at their destinations.
+  in_arcs_begin_.assign(num_positions + 1, 0);
+  max_emitting_dest_.assign(num_positions, -1);
+  max_epsilon_dest_.assign(num_positions, -1);
+  final_costs_.resize(num_positions);
+  for (int32 p = 0; p < num_positions; p++) {
+    final_costs_[p] = fst.Final(order[p]).Value();
+    for (fst::ArcIterator<fst::VectorFst<Arc> > aiter(fst, order[p]);
+         !aiter.Done(); aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      int32 dest = position[arc.nextstate];
+      in_arcs_begin_[dest + 1]++;
+      int32 &max_dest = (arc.ilabel == 0 ? max_epsilon_dest_[p] :
+                         max_emitting_dest_[p]);
+      max_dest = std::max(max_dest, dest);
+    }
+  }
+  for (int32 p = 0; p < num_positions; p++)
+    in_arcs_begin_[p + 1] += in_arcs_begin_[p];
+  in_arcs_.resize(in_arcs_begin_[num_positions]);
+  std::vector<int32> next_in_arc(in_arcs_begin_.begin(),
+                                 in_arcs_begin_.end() - 1);
+  for (int32 p = 0; p < num_positions; p++) {
+    for (fst::ArcIterator<fst::VectorFst<Arc> > aiter(fst, order[p]);
+         !aiter.Done(); aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      InArc &in_arc = in_arcs_[next_in_arc[position[arc.nextstate]]++];
+      in_arc.src = p;
+      in_arc.ilabel = arc.ilabel;
+      in_arc.cost = arc.weight.Value();
+    }
+  }
+  return true;
+}
+
+bool TrainingGraphAligner::Align(DecodableInterface *decodable,
+                                 BaseFloat beam,
+                                 std::vector<int32> *alignment,
+                                 BaseFloat *score) {
+  const BaseFloat inf = std::numeric_limits<BaseFloat>::infinity();
+  int32 num_positions = final_costs_.size();
+  KALDI_ASSERT(num_positions > 0 && "Init() was not called or failed");
+  // Outside the bands, the costs are always infinity.
+  prev_costs_.assign(num_positions, inf);
+  cur_costs_.assign(num_positions, inf);
+  band_begin_.clear();
+  band_offset_.clear();
+  best_arcs_.clear();
+
+  // The band of the previous frame; empty before frame 0.
+  int32 prev_begin = 0, prev_end = 0;
+  // Frame t covers frame t-1 of "decodable", as frame 0 is the start.
+  for (int32 t = 0; t == 0 || !decodable->IsLastFrame(t - 2); t++) {
+    // The states that can be reached with the non-epsilon arcs; the epsilon
+    // arcs may extend "end" as we go.
+    int32 begin = prev_begin, end = 1;
+    for (int32 q = prev_begin; q < prev_end; q++)
+      if (prev_costs_[q] != inf)
+        end = std::max(end, max_emitting_dest_[q] + 1);
+    band_begin_.push_back(begin);
+    band_offset_.push_back(best_arcs_.size());
+
+    BaseFloat best_cost = inf;
+    for (int32 p = begin; p < end; p++) {
+      BaseFloat cost = inf;
+      int32 best_arc = -1;
+      if (t == 0 && p == 0) cost = 0.0;  // the start state.
+      for (int32 a = in_arcs_begin_[p]; a < in_arcs_begin_[p + 1]; a++) {
+        const InArc &arc = in_arcs_[a];
+        BaseFloat arc_cost;
+        if (arc.ilabel == 0) {  // from this frame; arc.src < p.
+          arc_cost = cur_costs_[arc.src] + arc.cost;
+        } else {
+          if (t == 0 || prev_costs_[arc.src] == inf) continue;
+          arc_cost = prev_costs_[arc.src] + arc.cost -
+              decodable->LogLikelihood(t - 1, arc.ilabel);
+        }
+        if (arc_cost < cost) {
+          cost = arc_cost;
+          best_arc = a;
+        }
+      }
+      cur_costs_[p] = cost;
+      best_arcs_.push_back(best_arc);
+      if (cost != inf) {
+        end = std::max(end, max_epsilon_dest_[p] + 1);
+        best_cost = std::min(best_cost, cost);
+      }
+    }
+    if (best_cost == inf) {
+      KALDI_VLOG(2) << "No states active on frame " << t;
+      return false;
+    }
+
+    // Prune to the beam and find the band for the next frame.
+    BaseFloat cutoff = best_cost + beam;
+    int32 new_begin = end, new_end = begin;
+    for (int32 p = begin; p < end; p++) {
+      if (cur_costs_[p] > cutoff) {
+        cur_costs_[p] = inf;
+      } else if (cur_costs_[p] != inf) {
+        new_begin = std::min(new_begin, p);
+        new_end = p + 1;
+      }
+    }
+    for (int32 q = prev_begin; q < prev_end; q++)
+      prev_costs_[q] = inf;
+    std::swap(prev_costs_, cur_costs_);
+    prev_begin = new_begin;
+    prev_end = new_end;
+  }
+
+  // Now prev_costs_ has the costs of the last frame.
+  int32 num_frames = band_begin_.size() - 1, best_position = -1;
+  BaseFloat best_cost = inf;
+  for (int32 p = prev_begin; p < prev_end; p++) {
+    BaseFloat cost = prev_costs_[p] + final_costs_[p];
+    if (cost < best_cost) {
+      best_cost = cost;
+      best_position = p;
+    }
+  }
+  if (best_position == -1) return false;
+
+  alignment->clear();
+  alignment->reserve(num_frames);
+  int32 t = num_frames, p = best_position;
+  while (true) {
+    KALDI_ASSERT(p >= band_begin_[t]);
+    int32 a = best_arcs_[band_offset_[t] + p - band_begin_[t]];
+    if (a == -1) break;
+    const InArc &arc = in_arcs_[a];
+    if (arc.ilabel != 0) {
+      alignment->push_back(arc.ilabel);
+      t--;
+    }
+    p = arc.src;
+  }
+  KALDI_ASSERT(t == 0 && p == 0 && alignment->size() == static_cast<size_t>(num_frames));
+  std::reverse(alignment->begin(), alignment->end());
+  *score = -best_cost;
+  return true;
+}
+
+} // end namespace kaldi.
@@ -0,0 +1,105 @@
+// decoder/training-graph-aligner.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_TRAINING_GRAPH_ALIGNER_H_
+#define KALDI_DECODER_TRAINING_GRAPH_ALIGNER_H_
+
+#include "base/kaldi-common.h"
+#include "fst/fstlib.h"
+#include "itf/decodable-itf.h"
+
+namespace kaldi {
+
+/**
+   TrainingGraphAligner does Viterbi alignment of an utterance against its
+   training graph (as from TrainingGraphCompiler, with the transition
+   probabilities added), for graphs that have no cycles other than self-loops.
+   That is the case for the graphs of normal HMM topologies, including the
+   optional silence between words; the graphs are then nearly a left-to-right
+   chain.
+
+   Instead of the token passing of FasterDecoder, the states are put in
+   topological order and the costs of each frame are kept in a dense array
+   indexed by the position in that order.  Only a band of positions can be
+   active on any frame (from the first to the last state within the beam),
+   and the traceback stores one int32 per position in the band, so the time
+   and memory needed are predictable and there is no hashing or allocation
+   per token.  The result is the same as with FasterDecoder if the beam is
+   wide enough for neither to prune away the best path.
+ */
+class TrainingGraphAligner {
+ public:
+  TrainingGraphAligner() { }
+
+  /// Prepares for aligning with "fst", whose input labels are transition-ids
+  /// (zero for epsilon).  Returns false if "fst" has cycles other than
+  /// non-epsilon self-loops, or has no start state; it cannot be used then.
+  bool Init(const fst::VectorFst<fst::StdArc> &fst);
+
+  /// Aligns the frames of "decodable" with the graph given to Init(), keeping
+  /// only the states within "beam" of the best one on each frame (use
+  /// infinity for the exact Viterbi path).  Returns false if no final state
+  /// was reached; otherwise outputs the transition-ids of the best path, one
+  /// per frame, and its score, i.e. the acoustic log-likelihood minus the
+  /// graph cost, as for the best path of FasterDecoder.
+  bool Align(DecodableInterface *decodable, BaseFloat beam,
+             std::vector<int32> *alignment, BaseFloat *score);
+
+ private:
+  // An arc, stored at its destination state, as the costs are computed by
+  // looking at the arcs into each state.
+  struct InArc {
+    int32 src;  // position of the source state in the topological order.
+    int32 ilabel;  // transition-id, or zero for epsilon.
+    BaseFloat cost;  // graph cost.
+  };
+
+  // The arcs into position p are in_arcs_[in_arcs_begin_[p]] up to
+  // in_arcs_[in_arcs_begin_[p+1]]; for all the positions together.
+  std::vector<InArc> in_arcs_;
+  std::vector<int32> in_arcs_begin_;
+  // The largest position that position p has a non-epsilon arc into, and
+  // the same for epsilon arcs (-1 if none).
+  std::vector<int32> max_emitting_dest_;
+  std::vector<int32> max_epsilon_dest_;
+  // The final cost of each position.  The start state is at position 0, and
+  // the states that cannot be reached from it have no position.
+  std::vector<BaseFloat> final_costs_;
+
+  // For the traceback: for frame t (where frame 0 is before the first frame
+  // of the decodable), the band of active positions starts at
+  // band_begin_[t], and the best arc into position p is
+  // best_arcs_[band_offset_[t] + p - band_begin_[t]] (an index into in_arcs_,
+  // or -1 for the start state on frame 0).  The band ends where the next
+  // frame's offset starts.
+  std::vector<int32> band_begin_;
+  std::vector<int64> band_offset_;
+  std::vector<int32> best_arcs_;
+
+  // The costs for the previous and the current frame, indexed by position.
+  std::vector<BaseFloat> prev_costs_;
+  std::vector<BaseFloat> cur_costs_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(TrainingGraphAligner);
+};
+
+
+} // end namespace kaldi.
+
+#endif
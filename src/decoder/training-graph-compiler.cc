@@ -17,6 +17,7 @@
 // limitations under the License.
 #include "decoder/training-graph-compiler.h"
 #include "hmm/hmm-utils.h" // for GetHTransducer
+#include "thread/kaldi-thread.h"
 
 namespace kaldi {
 
@@ -27,7 +28,8 @@ TrainingGraphCompiler::TrainingGraphCompiler(const TransitionModel &trans_model,
                                              const std::vector<int32> &disambig_syms,
                                              const TrainingGraphCompilerOptions &opts):
     trans_model_(trans_model), ctx_dep_(ctx_dep), lex_fst_(lex_fst),
-    disambig_syms_(disambig_syms), opts_(opts) {
+    disambig_syms_(disambig_syms), opts_(opts), cfst_(NULL), h_fst_(NULL),
+    h_num_ilabels_(0) {
   using namespace fst;
   const std::vector<int32> &phone_syms = trans_model_.GetPhones();  // needed to create context fst.
 
@@ -59,6 +61,43 @@ TrainingGraphCompiler::TrainingGraphCompiler(const TransitionModel &trans_model,
   }
 }
 
+TrainingGraphCompiler::~TrainingGraphCompiler() {
+  delete lex_fst_;
+  delete cfst_;
+  delete h_fst_;
+  for (HmmCacheType::iterator iter = hmm_cache_.begin();
+       iter != hmm_cache_.end(); ++iter)
+    delete iter->second;
+}
+
+fst::ContextFst<fst::StdArc> *TrainingGraphCompiler::NewContextFst() const {
+  const std::vector<int32> &phone_syms = trans_model_.GetPhones();  // needed to create context fst.
+  int32 subseq_symbol = phone_syms.back() + 1;
+  if (!disambig_syms_.empty() && subseq_symbol <= disambig_syms_.back())
+    subseq_symbol = 1 + disambig_syms_.back();
+
+  return new fst::ContextFst<fst::StdArc>(subseq_symbol,
+                                          phone_syms,
+                                          disambig_syms_,
+                                          ctx_dep_.ContextWidth(),
+                                          ctx_dep_.CentralPosition());
+}
+
+void TrainingGraphCompiler::UpdateHTransducer() {
+  KALDI_ASSERT(cfst_ != NULL);
+  const std::vector<std::vector<int32> > &ilabel_info = cfst_->ILabelInfo();
+  if (h_fst_ != NULL && ilabel_info.size() == h_num_ilabels_)
+    return;  // Nothing new since we last built it.
+  HTransducerConfig h_cfg;
+  h_cfg.transition_scale = opts_.transition_scale;
+  delete h_fst_;
+  // The ilabels of cfst_ are never renumbered, so the new H is a superset of
+  // the old one, and most of the HMMs come from hmm_cache_.
+  h_fst_ = GetHTransducer(ilabel_info, ctx_dep_, trans_model_, h_cfg,
+                          &disambig_syms_h_, &hmm_cache_);
+  h_num_ilabels_ = ilabel_info.size();
+}
+
 bool TrainingGraphCompiler::CompileGraphFromText(
     const std::vector<int32> &transcript,
     fst::VectorFst<fst::StdArc> *out_fst) {
@@ -80,19 +119,8 @@ bool TrainingGraphCompiler::CompileGraph(const fst::VectorFst<fst::StdArc> &word
 
   KALDI_ASSERT(phone2word_fst.Start() != kNoStateId);
 
-  ContextFst<StdArc> *cfst = NULL;
-  {  // make cfst [ it's expanded on the fly ]
-    const std::vector<int32> &phone_syms = trans_model_.GetPhones();  // needed to create context fst.
-    int32 subseq_symbol = phone_syms.back() + 1;
-    if (!disambig_syms_.empty() && subseq_symbol <= disambig_syms_.back())
-      subseq_symbol = 1 + disambig_syms_.back();
-
-    cfst = new ContextFst<StdArc>(subseq_symbol,
-                                  phone_syms,
-                                  disambig_syms_,
-                                  ctx_dep_.ContextWidth(),
-                                  ctx_dep_.CentralPosition());
-  }
+  // make cfst [ it's expanded on the fly ]
+  ContextFst<StdArc> *cfst = NewContextFst();
 
   VectorFst<StdArc> ctx2word_fst;
   ComposeContextFst(*cfst, phone2word_fst, &ctx2word_fst);
@@ -161,6 +189,60 @@ bool TrainingGraphCompiler::CompileGraphsFromText(
   return ans;
 }
 
+// This class is used with RunParallelFor() to turn the context-dependent
+// graphs of CompileGraphs() into the final graphs.
+class CompileGraphsClass {
+ public:
+  CompileGraphsClass(const fst::VectorFst<fst::StdArc> &h_fst,
+                     const std::vector<int32> &disambig_syms_h,
+                     const TransitionModel &trans_model,
+                     const TrainingGraphCompilerOptions &opts,
+                     std::vector<fst::VectorFst<fst::StdArc>* > *fsts):
+      h_fst_(h_fst), disambig_syms_h_(disambig_syms_h),
+      trans_model_(trans_model), opts_(opts), fsts_(fsts) { }
+
+  void operator () (int32 begin, int32 end) {
+    using namespace fst;
+    // Each block uses its own deep copy of H: composition copies its inputs,
+    // and the reference counts of OpenFst's shallow copies are not
+    // thread-safe.
+    VectorFst<StdArc> H(static_cast<const Fst<StdArc>&>(h_fst_));
+    for (int32 i = begin; i < end; i++) {
+      VectorFst<StdArc> &ctx2word_fst = *((*fsts_)[i]);
+      VectorFst<StdArc> trans2word_fst;
+      TableCompose(H, ctx2word_fst, &trans2word_fst);
+
+      DeterminizeStarInLog(&trans2word_fst);
+
+      if (!disambig_syms_h_.empty()) {
+        RemoveSomeInputSymbols(disambig_syms_h_, &trans2word_fst);
+        if (opts_.rm_eps)
+          RemoveEpsLocal(&trans2word_fst);
+      }
+
+      // Encoded minimization.
+      MinimizeEncoded(&trans2word_fst);
+
+      std::vector<int32> disambig;
+      AddSelfLoops(trans_model_,
+                   disambig,
+                   opts_.self_loop_scale,
+                   opts_.reorder,
+                   &trans2word_fst);
+
+      KALDI_ASSERT(trans2word_fst.Start() != kNoStateId);
+
+      *((*fsts_)[i]) = trans2word_fst;
+    }
+  }
+ private:
+  const fst::VectorFst<fst::StdArc> &h_fst_;
+  const std::vector<int32> &disambig_syms_h_;
+  const TransitionModel &trans_model_;
+  const TrainingGraphCompilerOptions &opts_;
+  std::vector<fst::VectorFst<fst::StdArc>* > *fsts_;
+};
+
 bool TrainingGraphCompiler::CompileGraphs(
     const std::vector<const fst::VectorFst<fst::StdArc>* > &word_fsts,
     std::vector<fst::VectorFst<fst::StdArc>* > *out_fsts) {
@@ -171,20 +253,10 @@ bool TrainingGraphCompiler::CompileGraphs(
   out_fsts->resize(word_fsts.size(), NULL);
   if (word_fsts.empty()) return true;
 
-  ContextFst<StdArc> *cfst = NULL;
-  {  // make cfst [ it's expanded on the fly ]
-    const std::vector<int32> &phone_syms = trans_model_.GetPhones();  // needed to create context fst.
-    int32 subseq_symbol = phone_syms.back() + 1;
-    if (!disambig_syms_.empty() && subseq_symbol <= disambig_syms_.back())
-      subseq_symbol = 1 + disambig_syms_.back();
-
-    cfst = new ContextFst<StdArc>(subseq_symbol,
-                                  phone_syms,
-                                  disambig_syms_,
-                                  ctx_dep_.ContextWidth(),
-                                  ctx_dep_.CentralPosition());
-  }
+  if (cfst_ == NULL) cfst_ = NewContextFst();  // [ it's expanded on the fly ]
 
+  // The compositions with L and C share lex_cache_ and cfst_, so they are
+  // done in this thread.
   for (size_t i = 0; i < word_fsts.size(); i++) {
     VectorFst<StdArc> phone2word_fst;
     // TableCompose more efficient than compose.
@@ -194,7 +266,7 @@ bool TrainingGraphCompiler::CompileGraphs(
                  "Perhaps you have words missing in your lexicon?");
     
     VectorFst<StdArc> ctx2word_fst;
-    ComposeContextFst(*cfst, phone2word_fst, &ctx2word_fst);
+    ComposeContextFst(*cfst_, phone2word_fst, &ctx2word_fst);
     // ComposeContextFst is like Compose but faster for this particular Fst type.
     // [and doesn't expand too many arcs in the ContextFst.]
 
@@ -204,46 +276,11 @@ bool TrainingGraphCompiler::CompileGraphs(
     // representing phones-in-context.
   }
 
-  HTransducerConfig h_cfg;
-  h_cfg.transition_scale = opts_.transition_scale;
-
-  std::vector<int32> disambig_syms_h;
-  VectorFst<StdArc> *H = GetHTransducer(cfst->ILabelInfo(),
-                                        ctx_dep_,
-                                        trans_model_,
-                                        h_cfg,
-                                        &disambig_syms_h);
-
-  for (size_t i = 0; i < out_fsts->size(); i++) {
-    VectorFst<StdArc> &ctx2word_fst = *((*out_fsts)[i]);
-    VectorFst<StdArc> trans2word_fst;
-    TableCompose(*H, ctx2word_fst, &trans2word_fst);
-
-    DeterminizeStarInLog(&trans2word_fst);
+  UpdateHTransducer();
 
-    if (!disambig_syms_h.empty()) {
-      RemoveSomeInputSymbols(disambig_syms_h, &trans2word_fst);
-      if (opts_.rm_eps)
-        RemoveEpsLocal(&trans2word_fst);
-    }
-    
-    // Encoded minimization.
-    MinimizeEncoded(&trans2word_fst);
-
-    std::vector<int32> disambig;
-    AddSelfLoops(trans_model_,
-                 disambig,
-                 opts_.self_loop_scale,
-                 opts_.reorder,
-                 &trans2word_fst);
-
-    KALDI_ASSERT(trans2word_fst.Start() != kNoStateId);
-
-    *((*out_fsts)[i]) = trans2word_fst;
-  }
-
-  delete H;
-  delete cfst;
+  CompileGraphsClass c(*h_fst_, disambig_syms_h_, trans_model_, opts_,
+                       out_fsts);
+  RunParallelFor(0, out_fsts->size(), c, opts_.num_threads);
   return true;
 }
 
@@ -21,6 +21,7 @@
 
 #include "base/kaldi-common.h"
 #include "hmm/transition-model.h"
+#include "hmm/hmm-utils.h"
 #include "fst/fstlib.h"
 #include "fstext/fstext-lib.h"
 
@@ -33,6 +34,7 @@ struct TrainingGraphCompilerOptions {
   BaseFloat self_loop_scale;
   bool rm_eps;
   bool reorder;  // (Dan-style graphs)
+  int32 num_threads;  // used in CompileGraphs().
 
   explicit TrainingGraphCompilerOptions(BaseFloat transition_scale = 1.0,
                                         BaseFloat self_loop_scale = 1.0,
@@ -40,7 +42,8 @@ struct TrainingGraphCompilerOptions {
       transition_scale(transition_scale),
       self_loop_scale(self_loop_scale),
       rm_eps(false),
-      reorder(b) { }
+      reorder(b),
+      num_threads(1) { }
 
   void Register(OptionsItf *po) {
     po->Register("transition-scale", &transition_scale, "Scale of transition "
@@ -50,6 +53,8 @@ struct TrainingGraphCompilerOptions {
     po->Register("reorder", &reorder, "Reorder transition ids for greater decoding efficiency.");
     po->Register("rm-eps", &rm_eps,  "Remove [most] epsilons before minimization (only applicable "
                  "if disambig symbols present)");
+    po->Register("num-threads", &num_threads, "Number of threads used to "
+                 "determinize and minimize the graphs of a batch");
   }
 };
 
@@ -74,7 +79,11 @@ class TrainingGraphCompiler {
                     fst::VectorFst<fst::StdArc> *out_fst);
   
   // CompileGraphs allows you to compile a number of graphs at the same
-  // time.  This consumes more memory but is faster.
+  // time.  This consumes more memory but is faster.  The context FST and the
+  // H transducer (with its per-context-window HMMs) are kept between calls,
+  // so H only has to be rebuilt when a batch contains phones-in-context not
+  // seen before; the composition with H, determinization and minimization
+  // are done in opts.num_threads threads.
   bool CompileGraphs(
       const std::vector<const fst::VectorFst<fst::StdArc> *> &word_fsts,
       std::vector<fst::VectorFst<fst::StdArc> *> *out_fsts);
@@ -89,8 +98,14 @@ class TrainingGraphCompiler {
       std::vector<fst::VectorFst<fst::StdArc> *> *out_fsts);
   
   
-  ~TrainingGraphCompiler() { delete lex_fst_; }
+  ~TrainingGraphCompiler();
  private:
+  // Returns a newly allocated context FST.
+  fst::ContextFst<fst::StdArc> *NewContextFst() const;
+
+  // Makes sure h_fst_ covers all the ilabels of cfst_.
+  void UpdateHTransducer();
+
   const TransitionModel &trans_model_;
   const ContextDependency &ctx_dep_;
   fst::VectorFst<fst::StdArc> *lex_fst_; // lexicon FST (an input; we take
@@ -101,6 +116,16 @@ class TrainingGraphCompiler {
   // this is one of Dan's extensions.
 
   TrainingGraphCompilerOptions opts_;
+
+  // The following are used (and kept between calls) by CompileGraphs().
+  fst::ContextFst<fst::StdArc> *cfst_;  // expanded on the fly; owned here.
+  fst::VectorFst<fst::StdArc> *h_fst_;  // H for the ilabels of cfst_ that
+  // existed when it was built; owned here.
+  size_t h_num_ilabels_;  // The number of ilabels h_fst_ was built for.
+  std::vector<int32> disambig_syms_h_;  // disambig symbols on input of h_fst_.
+  HmmCacheType hmm_cache_;  // HMMs for context windows; FSTs owned here.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(TrainingGraphCompiler);
 };
 
 
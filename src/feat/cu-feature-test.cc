@@ -0,0 +1,118 @@
+// feat/cu-feature-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "feat/cu-feature.h"
+#include "cudamatrix/cu-device.h"
+
+namespace kaldi {
+
+// Gets a random waveform; we use noise rather than real speech so that no
+// frame has very low energy, as the log of a very small mel energy would be
+// sensitive to round-off.
+static void GetRandomWave(Vector<BaseFloat> *wave) {
+  wave->Resize(8000 + rand() % 8000);
+  wave->SetRandn();
+  wave->Scale(1000.0);
+}
+
+static void SetRandomFrameOptions(FrameExtractionOptions *opts) {
+  opts->dither = 0.0;  // the CPU and GPU versions would dither differently.
+  opts->round_to_power_of_two = (rand() % 4 != 0);
+  if (rand() % 2 == 0) opts->window_type = "hamming";
+  opts->remove_dc_offset = (rand() % 2 == 0);
+}
+
+static void UnitTestCuMfcc() {
+  for (int32 i = 0; i < 10; i++) {
+    MfccOptions opts;
+    SetRandomFrameOptions(&opts.frame_opts);
+    opts.use_energy = (rand() % 2 == 0);
+    opts.raw_energy = (rand() % 2 == 0);
+    opts.htk_compat = (rand() % 2 == 0);
+    opts.mel_opts.use_power = (rand() % 2 == 0);
+    if (rand() % 2 == 0) opts.cepstral_lifter = 0.0;
+    if (rand() % 2 == 0) opts.energy_floor = 1.0e+10;
+    BaseFloat vtln_warp = (rand() % 2 == 0 ? 1.0 : 0.9);
+
+    Vector<BaseFloat> wave;
+    GetRandomWave(&wave);
+
+    Mfcc mfcc(opts);
+    Matrix<BaseFloat> feats;
+    mfcc.Compute(wave, vtln_warp, &feats);
+
+    CuMfcc cu_mfcc(opts);
+    CuMatrix<BaseFloat> cu_feats;
+    cu_mfcc.Compute(wave, vtln_warp, &cu_feats);
+    KALDI_ASSERT(cu_feats.NumCols() == cu_mfcc.Dim());
+
+    Matrix<BaseFloat> feats2(cu_feats);
+    KALDI_ASSERT(feats.ApproxEqual(feats2, 0.001));
+  }
+}
+
+static void UnitTestCuFbank() {
+  for (int32 i = 0; i < 10; i++) {
+    FbankOptions opts;
+    SetRandomFrameOptions(&opts.frame_opts);
+    opts.use_energy = (rand() % 2 == 0);
+    opts.raw_energy = (rand() % 2 == 0);
+    opts.htk_compat = (rand() % 2 == 0);
+    opts.use_log_fbank = (rand() % 2 == 0);
+    opts.mel_opts.use_power = (rand() % 2 == 0);
+    BaseFloat vtln_warp = (rand() % 2 == 0 ? 1.0 : 1.1);
+
+    Vector<BaseFloat> wave, remainder, cu_remainder;
+    GetRandomWave(&wave);
+
+    Fbank fbank(opts);
+    Matrix<BaseFloat> feats;
+    fbank.Compute(wave, vtln_warp, &feats, &remainder);
+
+    CuFbank cu_fbank(opts);
+    CuMatrix<BaseFloat> cu_feats;
+    cu_fbank.Compute(wave, vtln_warp, &cu_feats, &cu_remainder);
+    KALDI_ASSERT(cu_feats.NumCols() == cu_fbank.Dim());
+    KALDI_ASSERT(remainder.ApproxEqual(cu_remainder, 0.0));
+
+    Matrix<BaseFloat> feats2(cu_feats);
+    KALDI_ASSERT(feats.ApproxEqual(feats2, 0.001));
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 loop = 0; loop < 2; loop++) {
+#if HAVE_CUDA == 1
+    if (loop == 0)
+      CuDevice::Instantiate().SelectGpuId("no");
+    else
+      CuDevice::Instantiate().SelectGpuId("optional");
+#endif
+    UnitTestCuMfcc();
+    UnitTestCuFbank();
+#if HAVE_CUDA != 1
+    break;
+#endif
+  }
+  KALDI_LOG << "Tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,239 @@
+// feat/cu-feature.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "feat/cu-feature.h"
+#include "feat/mel-computations.h"
+
+namespace kaldi {
+
+CuSpectrumComputer::CuSpectrumComputer(const FrameExtractionOptions &opts):
+    opts_(opts), feature_window_function_(opts) {
+  int32 padded_window_size = opts.PaddedWindowSize();
+  KALDI_ASSERT(padded_window_size % 2 == 0);
+  num_fft_bins_ = padded_window_size / 2 + 1;
+  Matrix<double> dft(padded_window_size, 2 * num_fft_bins_);
+  for (int32 n = 0; n < padded_window_size; n++) {
+    for (int32 k = 0; k < num_fft_bins_; k++) {
+      // Reduce n * k modulo the window size before converting to an angle, to
+      // keep the angle small and accurate.
+      double angle = M_2PI * ((n * k) % padded_window_size) /
+          padded_window_size;
+      dft(n, k) = cos(angle);
+      dft(n, num_fft_bins_ + k) = sin(angle);
+    }
+  }
+  dft_matrix_.Resize(padded_window_size, 2 * num_fft_bins_, kUndefined);
+  dft_matrix_.CopyFromMat(dft);
+}
+
+void CuSpectrumComputer::Compute(const VectorBase<BaseFloat> &wave,
+                                 bool use_power,
+                                 bool raw_energy,
+                                 CuMatrix<BaseFloat> *spectrum,
+                                 Vector<BaseFloat> *log_energy) {
+  int32 num_frames = NumFrames(wave.Dim(), opts_),
+      padded_window_size = dft_matrix_.NumRows();
+  if (num_frames == 0)
+    KALDI_ERR << "No frames fit in file (#samples is " << wave.Dim() << ")";
+  if (log_energy != NULL)
+    log_energy->Resize(num_frames);
+
+  Matrix<BaseFloat> windows(num_frames, padded_window_size, kUndefined);
+  Vector<BaseFloat> window;
+  for (int32 r = 0; r < num_frames; r++) {
+    BaseFloat this_log_energy;
+    ExtractWindow(wave, r, opts_, feature_window_function_, &window,
+                  (log_energy != NULL && raw_energy ? &this_log_energy : NULL));
+    if (log_energy != NULL)
+      (*log_energy)(r) = (raw_energy ? this_log_energy :
+                          log(VecVec(window, window)));
+    windows.CopyRowFromVec(window, r);
+  }
+  CuMatrix<BaseFloat> cu_windows(windows);
+  windows.Resize(0, 0);
+
+  CuMatrix<BaseFloat> dft(num_frames, 2 * num_fft_bins_, kUndefined);
+  dft.AddMatMat(1.0, cu_windows, kNoTrans, dft_matrix_, kNoTrans, 0.0);
+  dft.ApplyPow(2.0);
+  // The power spectrum is the sum of the squared real and imaginary parts.
+  spectrum->Resize(num_frames, num_fft_bins_, kUndefined);
+  spectrum->CopyFromMat(dft.ColRange(0, num_fft_bins_));
+  spectrum->AddMat(1.0, dft.ColRange(num_fft_bins_, num_fft_bins_));
+  if (!use_power) {
+    // Round-off in the DFT can make the imaginary part of the first and last
+    // bins very slightly nonzero but never negative, so this is safe.
+    spectrum->ApplyPow(0.5);
+  }
+}
+
+
+CuMfcc::CuMfcc(const MfccOptions &opts):
+    opts_(opts), spectrum_computer_(opts.frame_opts),
+    log_energy_floor_(0.0), htk_mode_(opts.mel_opts.htk_mode) {
+  int32 num_bins = opts.mel_opts.num_bins;
+  Matrix<BaseFloat> dct_matrix(num_bins, num_bins);
+  ComputeDctMatrix(&dct_matrix);
+  // As in class Mfcc, we include the zeroth DCT coefficient in either case.
+  SubMatrix<BaseFloat> dct_rows(dct_matrix, 0, opts.num_ceps, 0, num_bins);
+  dct_matrix_.Resize(opts.num_ceps, num_bins, kUndefined);
+  dct_matrix_.CopyFromMat(dct_rows);
+
+  Vector<BaseFloat> scale(opts.num_ceps);
+  scale.Set(1.0);
+  if (opts.cepstral_lifter != 0.0)
+    ComputeLifterCoeffs(opts.cepstral_lifter, &scale);
+  if (opts.htk_compat && !opts.use_energy)
+    scale(0) *= M_SQRT2;  // See the comment in Mfcc::Compute().
+  if (opts.cepstral_lifter != 0.0 || (opts.htk_compat && !opts.use_energy))
+    cepstral_scale_ = scale;
+  if (opts.energy_floor > 0.0)
+    log_energy_floor_ = log(opts.energy_floor);
+}
+
+CuMfcc::~CuMfcc() {
+  for (std::map<BaseFloat, CuMatrix<BaseFloat>*>::iterator iter =
+           mel_matrices_.begin(); iter != mel_matrices_.end(); ++iter)
+    delete iter->second;
+}
+
+// Gets the mel filterbank for this VTLN warp as a matrix of dimension
+// num-bins by spectrum_computer.Dim(); shared by CuMfcc and CuFbank.
+static const CuMatrix<BaseFloat> &GetMelMatrixInternal(
+    const MelBanksOptions &mel_opts,
+    const FrameExtractionOptions &frame_opts,
+    const CuSpectrumComputer &spectrum_computer,
+    BaseFloat vtln_warp,
+    std::map<BaseFloat, CuMatrix<BaseFloat>*> *mel_matrices) {
+  std::map<BaseFloat, CuMatrix<BaseFloat>*>::iterator iter =
+      mel_matrices->find(vtln_warp);
+  if (iter != mel_matrices->end())
+    return *(iter->second);
+  MelBanks mel_banks(mel_opts, frame_opts, vtln_warp);
+  Matrix<BaseFloat> mat;
+  mel_banks.GetMatrix(spectrum_computer.Dim(), &mat);
+  CuMatrix<BaseFloat> *ans = new CuMatrix<BaseFloat>(mat);
+  (*mel_matrices)[vtln_warp] = ans;
+  return *ans;
+}
+
+const CuMatrix<BaseFloat> &CuMfcc::GetMelMatrix(BaseFloat vtln_warp) {
+  return GetMelMatrixInternal(opts_.mel_opts, opts_.frame_opts,
+                              spectrum_computer_, vtln_warp, &mel_matrices_);
+}
+
+void CuMfcc::Compute(const VectorBase<BaseFloat> &wave,
+                     BaseFloat vtln_warp,
+                     CuMatrix<BaseFloat> *output,
+                     Vector<BaseFloat> *wave_remainder) {
+  KALDI_ASSERT(output != NULL);
+  if (wave_remainder != NULL)
+    ExtractWaveformRemainder(wave, opts_.frame_opts, wave_remainder);
+  CuMatrix<BaseFloat> spectrum;
+  Vector<BaseFloat> log_energy;
+  spectrum_computer_.Compute(wave, opts_.mel_opts.use_power, opts_.raw_energy,
+                             &spectrum,
+                             (opts_.use_energy ? &log_energy : NULL));
+  int32 num_frames = spectrum.NumRows();
+
+  const CuMatrix<BaseFloat> &mel_matrix = GetMelMatrix(vtln_warp);
+  CuMatrix<BaseFloat> mel_energies(num_frames, mel_matrix.NumRows(),
+                                   kUndefined);
+  mel_energies.AddMatMat(1.0, spectrum, kNoTrans, mel_matrix, kTrans, 0.0);
+  spectrum.Resize(0, 0);
+  if (htk_mode_)  // HTK-like flooring, as in MelBanks::Compute().
+    mel_energies.ApplyFloor(1.0);
+  mel_energies.ApplyLog();
+
+  CuMatrix<BaseFloat> mfcc(num_frames, opts_.num_ceps, kUndefined);
+  mfcc.AddMatMat(1.0, mel_energies, kNoTrans, dct_matrix_, kTrans, 0.0);
+  if (cepstral_scale_.Dim() != 0)
+    mfcc.MulColsVec(cepstral_scale_);
+
+  if (opts_.use_energy) {
+    if (opts_.energy_floor > 0.0)
+      log_energy.ApplyFloor(log_energy_floor_);
+    mfcc.CopyColFromVec(CuVector<BaseFloat>(log_energy), 0);
+  }
+
+  if (opts_.htk_compat) {
+    // Put the energy (or C0) last.
+    std::vector<MatrixIndexT> reorder(opts_.num_ceps);
+    for (int32 i = 0; i < opts_.num_ceps; i++)
+      reorder[i] = (i + 1) % opts_.num_ceps;
+    output->Resize(num_frames, opts_.num_ceps, kUndefined);
+    output->CopyCols(mfcc, reorder);
+  } else {
+    output->Swap(&mfcc);
+  }
+}
+
+
+CuFbank::CuFbank(const FbankOptions &opts):
+    opts_(opts), spectrum_computer_(opts.frame_opts),
+    log_energy_floor_(0.0), htk_mode_(opts.mel_opts.htk_mode) {
+  if (opts.energy_floor > 0.0)
+    log_energy_floor_ = log(opts.energy_floor);
+}
+
+CuFbank::~CuFbank() {
+  for (std::map<BaseFloat, CuMatrix<BaseFloat>*>::iterator iter =
+           mel_matrices_.begin(); iter != mel_matrices_.end(); ++iter)
+    delete iter->second;
+}
+
+const CuMatrix<BaseFloat> &CuFbank::GetMelMatrix(BaseFloat vtln_warp) {
+  return GetMelMatrixInternal(opts_.mel_opts, opts_.frame_opts,
+                              spectrum_computer_, vtln_warp, &mel_matrices_);
+}
+
+void CuFbank::Compute(const VectorBase<BaseFloat> &wave,
+                      BaseFloat vtln_warp,
+                      CuMatrix<BaseFloat> *output,
+                      Vector<BaseFloat> *wave_remainder) {
+  KALDI_ASSERT(output != NULL);
+  if (wave_remainder != NULL)
+    ExtractWaveformRemainder(wave, opts_.frame_opts, wave_remainder);
+  CuMatrix<BaseFloat> spectrum;
+  Vector<BaseFloat> log_energy;
+  spectrum_computer_.Compute(wave, opts_.mel_opts.use_power, opts_.raw_energy,
+                             &spectrum,
+                             (opts_.use_energy ? &log_energy : NULL));
+  int32 num_frames = spectrum.NumRows(),
+      num_bins = opts_.mel_opts.num_bins;
+
+  const CuMatrix<BaseFloat> &mel_matrix = GetMelMatrix(vtln_warp);
+  output->Resize(num_frames, Dim(), kUndefined);
+  // The energy goes first, or last if htk_compat == true.
+  int32 energy_col = (opts_.htk_compat ? num_bins : 0),
+      fbank_offset = (opts_.use_energy && !opts_.htk_compat ? 1 : 0);
+  CuSubMatrix<BaseFloat> fbank(output->ColRange(fbank_offset, num_bins));
+  fbank.AddMatMat(1.0, spectrum, kNoTrans, mel_matrix, kTrans, 0.0);
+  if (htk_mode_)  // HTK-like flooring, as in MelBanks::Compute().
+    fbank.ApplyFloor(1.0);
+  if (opts_.use_log_fbank)
+    fbank.ApplyLog();
+
+  if (opts_.use_energy) {
+    if (opts_.energy_floor > 0.0)
+      log_energy.ApplyFloor(log_energy_floor_);
+    output->CopyColFromVec(CuVector<BaseFloat>(log_energy), energy_col);
+  }
+}
+
+}  // namespace kaldi
@@ -0,0 +1,145 @@
+// feat/cu-feature.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FEAT_CU_FEATURE_H_
+#define KALDI_FEAT_CU_FEATURE_H_
+
+#include <map>
+
+#include "feat/feature-mfcc.h"
+#include "feat/feature-fbank.h"
+#include "cudamatrix/cu-matrix.h"
+#include "cudamatrix/cu-vector.h"
+
+namespace kaldi {
+/// @addtogroup  feat FeatureExtraction
+/// @{
+
+/* The classes in this file compute MFCC and filterbank features for a whole
+   utterance at a time, using CuMatrix operations, so that on a GPU the features
+   are computed on the device and can be given directly to the neural net (e.g.
+   NnetComputation() in ../nnet2/nnet-compute.h) without being copied back and
+   forth.  They give the same output as Mfcc and Fbank, up to round-off.
+
+   Only the framing, dithering, pre-emphasis and windowing are done on the CPU,
+   as they are cheap and involve random numbers (for the dithering); the frames
+   are then copied to the device in one go.  As there is no FFT in
+   ../cudamatrix, the spectrum is computed by multiplying by a DFT matrix; this
+   does more arithmetic than an FFT, but a GPU does large matrix multiplications
+   so fast that it is still much cheaper than a per-frame FFT on the CPU.  The
+   mel filterbank and the DCT are also matrix multiplications.  Without a GPU
+   these classes still work (the CuMatrix operations then run on the CPU), but
+   Mfcc and Fbank will be faster.
+*/
+
+/// Computes the power (or magnitude) spectra of all the frames of a waveform,
+/// one per row; this is the common part of CuMfcc and CuFbank.
+class CuSpectrumComputer {
+ public:
+  explicit CuSpectrumComputer(const FrameExtractionOptions &opts);
+
+  /// Dimension of the output spectrum: the padded window size / 2 + 1.
+  int32 Dim() const { return num_fft_bins_; }
+
+  /// Computes the spectra of the frames of "wave"; "spectrum" is resized to
+  /// NumFrames(wave.Dim(), opts) by Dim().  If use_power == false the
+  /// magnitude spectrum is output instead of the power spectrum.  If
+  /// "log_energy" is non-NULL it is set to the log-energy of each frame,
+  /// computed before pre-emphasis and windowing if raw_energy == true and
+  /// after otherwise.
+  void Compute(const VectorBase<BaseFloat> &wave,
+               bool use_power,
+               bool raw_energy,
+               CuMatrix<BaseFloat> *spectrum,
+               Vector<BaseFloat> *log_energy);
+
+ private:
+  FrameExtractionOptions opts_;
+  FeatureWindowFunction feature_window_function_;
+  int32 num_fft_bins_;
+  // The real DFT as a (padded window size) by (2 * num_fft_bins_) matrix: the
+  // first num_fft_bins_ columns give the real parts and the rest the
+  // imaginary parts (up to sign, which does not matter as we square them).
+  CuMatrix<BaseFloat> dft_matrix_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CuSpectrumComputer);
+};
+
+
+/// Computes the same features as class Mfcc, but using CuMatrix operations.
+class CuMfcc {
+ public:
+  explicit CuMfcc(const MfccOptions &opts);
+  ~CuMfcc();
+
+  int32 Dim() { return opts_.num_ceps; }
+
+  /// As Mfcc::Compute(), but the output is a CuMatrix.
+  void Compute(const VectorBase<BaseFloat> &wave,
+               BaseFloat vtln_warp,
+               CuMatrix<BaseFloat> *output,
+               Vector<BaseFloat> *wave_remainder = NULL);
+
+ private:
+  const CuMatrix<BaseFloat> &GetMelMatrix(BaseFloat vtln_warp);
+  MfccOptions opts_;
+  CuSpectrumComputer spectrum_computer_;
+  CuMatrix<BaseFloat> dct_matrix_;  // num_ceps by num_bins.
+  // Scale on each cepstral coefficient (the liftering, and for htk_compat the
+  // sqrt(2) on C0).  Empty if no scaling is needed.
+  CuVector<BaseFloat> cepstral_scale_;
+  BaseFloat log_energy_floor_;
+  bool htk_mode_;  // true if the mel bins are in HTK mode.
+  // The mel filterbank as a matrix; BaseFloat is VTLN coefficient.
+  std::map<BaseFloat, CuMatrix<BaseFloat>*> mel_matrices_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CuMfcc);
+};
+
+
+/// Computes the same features as class Fbank, but using CuMatrix operations.
+class CuFbank {
+ public:
+  explicit CuFbank(const FbankOptions &opts);
+  ~CuFbank();
+
+  int32 Dim() const {
+    return opts_.mel_opts.num_bins + (opts_.use_energy ? 1 : 0);
+  }
+
+  /// As Fbank::Compute(), but the output is a CuMatrix.
+  void Compute(const VectorBase<BaseFloat> &wave,
+               BaseFloat vtln_warp,
+               CuMatrix<BaseFloat> *output,
+               Vector<BaseFloat> *wave_remainder = NULL);
+
+ private:
+  const CuMatrix<BaseFloat> &GetMelMatrix(BaseFloat vtln_warp);
+  FbankOptions opts_;
+  CuSpectrumComputer spectrum_computer_;
+  BaseFloat log_energy_floor_;
+  bool htk_mode_;
+  std::map<BaseFloat, CuMatrix<BaseFloat>*> mel_matrices_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CuFbank);
+};
+
+
+/// @} End of "addtogroup feat"
+}  // namespace kaldi
+
+
+#endif  // KALDI_FEAT_CU_FEATURE_H_
@@ -19,12 +19,14 @@
 
 
 #include "feat/feature-fbank.h"
+#include "util/kaldi-profile.h"
 
 
 namespace kaldi {
 
 Fbank::Fbank(const FbankOptions &opts)
-    : opts_(opts), feature_window_function_(opts.frame_opts), srfft_(NULL) {
+    : opts_(opts), feature_window_function_(opts.frame_opts), srfft_(NULL),
+      use_rng_(false) {
   if (opts.energy_floor > 0.0)
     log_energy_floor_ = log(opts.energy_floor);
 
@@ -60,6 +62,7 @@ void Fbank::Compute(const VectorBase<BaseFloat> &wave,
                    BaseFloat vtln_warp,
                    Matrix<BaseFloat> *output,
                    Vector<BaseFloat> *wave_remainder) {
+  KALDI_PROFILE_SCOPE("Fbank::Compute");
   KALDI_ASSERT(output != NULL);
 
   // Get dimensions of output features
@@ -74,63 +77,59 @@ void Fbank::Compute(const VectorBase<BaseFloat> &wave,
   if (wave_remainder != NULL)
     ExtractWaveformRemainder(wave, opts_.frame_opts, wave_remainder);
 
-  // Buffers
-  Vector<BaseFloat> window;  // windowed waveform.
-  Vector<BaseFloat> mel_energies;
-  BaseFloat log_energy;
-
-  // Compute all the freames, r is frame index..
-  for (int32 r = 0; r < rows_out; r++) {
-    // Cut the window, apply window function
-    ExtractWindow(wave, r, opts_.frame_opts, feature_window_function_, &window,
-                  (opts_.use_energy && opts_.raw_energy ? &log_energy : NULL));
+  const MelBanks *this_mel_banks = GetMelBanks(vtln_warp);
+  // We process the frames in blocks; see the comment in Mfcc::Compute().
+  int32 padded_window_size = opts_.frame_opts.PaddedWindowSize(),
+      block_size = std::min(rows_out, kFeatureBlockSize),
+      num_bins = opts_.mel_opts.num_bins;
+  Matrix<BaseFloat> windows_block(block_size, padded_window_size, kUndefined),
+      mel_energies;
+  Vector<BaseFloat> log_energy_block(block_size, kUndefined);
+
+  // Compute all the frames, start is the index of the first frame in the block.
+  for (int32 start = 0; start < rows_out; start += block_size) {
+    int32 num_frames = std::min(block_size, rows_out - start);
+    SubMatrix<BaseFloat> windows(windows_block, 0, num_frames,
+                                 0, padded_window_size);
+    SubVector<BaseFloat> log_energy(log_energy_block, 0, num_frames);
+    // Cut the windows, apply window function
+    ExtractWindows(wave, start, opts_.frame_opts, feature_window_function_,
+                   &windows,
+                   (opts_.use_energy && opts_.raw_energy ? &log_energy : NULL),
+                   (use_rng_ ? &rng_ : NULL));
 
     // Compute energy after window function (not the raw one)
-    if (opts_.use_energy && !opts_.raw_energy)
-      log_energy = log(VecVec(window, window));
-
-    if (srfft_ != NULL)  // Compute FFT using split-radix algorithm.
-      srfft_->Compute(window.Data(), true);
-    else  // An alternative algorithm that works for non-powers-of-two.
-      RealFft(&window, true);
+    if (opts_.use_energy && !opts_.raw_energy) {
+      log_energy.AddDiagMat2(1.0, windows, kNoTrans, 0.0);
+      log_energy.ApplyLog();
+    }
 
-    // Convert the FFT into a power spectrum.
-    ComputePowerSpectrum(&window);
-    SubVector<BaseFloat> power_spectrum(window, 0, window.Dim()/2 + 1);
+    // Do the FFT and convert it into a power spectrum.
+    ComputePowerSpectra(srfft_, &windows);
+    SubMatrix<BaseFloat> power_spectra(windows, 0, num_frames,
+                                       0, padded_window_size / 2 + 1);
 
     // use magnitude spectrum
-    if(!opts_.mel_opts.use_power){
-    	power_spectrum.ApplyPow(0.5);
-    }
+    if (!opts_.mel_opts.use_power)
+      power_spectra.ApplyPow(0.5);
 
     // Integrate with MelFiterbank over power spectrum
-    const MelBanks *this_mel_banks = GetMelBanks(vtln_warp);
-    this_mel_banks->Compute(power_spectrum, &mel_energies);
+    this_mel_banks->Compute(power_spectra, &mel_energies);
     if (opts_.use_log_fbank)
       mel_energies.ApplyLog();  // take the log.
 
-    // Output buffers
-    SubVector<BaseFloat> this_output(output->Row(r));
-    SubVector<BaseFloat> this_fbank(this_output.Range((opts_.use_energy? 1 : 0),
-                                                      opts_.mel_opts.num_bins));
+    // Output buffers; HTK compat: energy is the last value, otherwise first.
+    SubMatrix<BaseFloat> this_output(output->RowRange(start, num_frames));
+    int32 energy_col = (opts_.htk_compat ? num_bins : 0),
+        fbank_offset = (opts_.use_energy && !opts_.htk_compat ? 1 : 0);
 
     // Copy to output
-    this_fbank.CopyFromVec(mel_energies);
-    // Copy energy as first value
+    this_output.ColRange(fbank_offset, num_bins).CopyFromMat(mel_energies);
+    // Copy energy
     if (opts_.use_energy) {
-      if (opts_.energy_floor > 0.0 && log_energy < log_energy_floor_) {
-        log_energy = log_energy_floor_;
-      }
-      this_output(0) = log_energy;
-    }
-
-    // HTK compat: Shift features, so energy is last value
-    if (opts_.htk_compat && opts_.use_energy) {
-      BaseFloat energy = this_output(0);
-      for (int32 i = 0; i < opts_.mel_opts.num_bins; i++) {
-        this_output(i) = this_output(i+1);
-      }
-      this_output(opts_.mel_opts.num_bins) = energy;
+      if (opts_.energy_floor > 0.0)
+        log_energy.ApplyFloor(log_energy_floor_);
+      this_output.CopyColFromVec(log_energy, energy_col);
     }
   }
 }
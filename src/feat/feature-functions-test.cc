@@ -92,6 +92,96 @@ void UnitTestOnlineCmvn() {
   }
 }
 
+void UnitTestOnlineSlidingWindowCmn() {
+  for (int32 i = 0; i < 100; i++) {
+    int32 num_frames = 1 + rand() % 200;
+    int32 dim = 1 + rand() % 10;
+    SlidingWindowCmnOptions opts;
+    opts.center = (rand() % 2 == 0);
+    opts.normalize_variance = (rand() % 2 == 0);
+    opts.cmn_window = 5 + rand() % 50;
+    opts.min_window = 1 + rand() % opts.cmn_window;
+
+    Matrix<BaseFloat> feats(num_frames, dim),
+        output_feats(num_frames, dim),
+        output_feats2(num_frames, dim);
+    feats.SetRandn();
+    SlidingWindowCmn(opts, feats, &output_feats);
+
+    // Taking the output frames as they become ready should give the same
+    // result.
+    OnlineSlidingWindowCmn cmn(opts, dim);
+    for (int32 t = 0; t < num_frames; t++) {
+      cmn.AcceptFrame(feats.Row(t));
+      while (cmn.NextFrameReady()) {
+        SubVector<BaseFloat> frame(output_feats2, cmn.NumFramesOutput());
+        cmn.GetNextFrame(&frame);
+      }
+      if (!opts.center && t + 1 >= opts.min_window)
+        KALDI_ASSERT(cmn.NumFramesOutput() == t + 1);
+    }
+    cmn.InputFinished();
+    while (cmn.NextFrameReady()) {
+      SubVector<BaseFloat> frame(output_feats2, cmn.NumFramesOutput());
+      cmn.GetNextFrame(&frame);
+    }
+    KALDI_ASSERT(cmn.NumFramesOutput() == num_frames);
+    AssertEqual(output_feats, output_feats2);
+  }
+}
+
+void UnitTestOnlineSlidingWindowCmnGlobal() {
+  for (int32 i = 0; i < 10; i++) {
+    int32 dim = 1 + rand() % 10, global_frames = 1 + rand() % 20;
+    SlidingWindowCmnOptions opts;
+    opts.min_window = 1;
+    Matrix<double> global_stats(2, dim + 1);
+    global_stats.SetRandn();
+    global_stats(0, dim) = 10.0;
+    Vector<BaseFloat> frame(dim), output(dim);
+    frame.SetRandn();
+
+    OnlineSlidingWindowCmn cmn(opts, dim);
+    cmn.SetGlobalStats(global_stats, global_frames);
+    cmn.AcceptFrame(frame);
+    KALDI_ASSERT(cmn.NextFrameReady());
+    cmn.GetNextFrame(&output);
+    // The first frame is normalized with the mean of itself and
+    // global_frames - 1 frames of the global mean.
+    Vector<BaseFloat> expected(frame), global_mean(dim);
+    for (int32 d = 0; d < dim; d++)
+      global_mean(d) = global_stats(0, d) / global_stats(0, dim);
+    expected.Scale(1.0 - 1.0 / global_frames);
+    expected.AddVec(-(global_frames - 1.0) / global_frames, global_mean);
+    AssertEqual(output, expected);
+  }
+}
+
+void UnitTestSpliceAndTransform() {
+  for (int32 i = 0; i < 20; i++) {
+    int32 num_frames = 1 + rand() % 20, dim = 1 + rand() % 10,
+        left_context = rand() % 5, right_context = rand() % 5,
+        spliced_dim = dim * (left_context + 1 + right_context),
+        out_dim = 1 + rand() % 15;
+    bool affine = (i % 2 == 0);
+    Matrix<BaseFloat> feats(num_frames, dim),
+        transform(out_dim, spliced_dim + (affine ? 1 : 0));
+    feats.SetRandn();
+    transform.SetRandn();
+
+    Matrix<BaseFloat> spliced, ref(num_frames, out_dim), out;
+    SpliceFrames(feats, left_context, right_context, &spliced);
+    ref.AddMatMat(1.0, spliced, kNoTrans,
+                  transform.Range(0, out_dim, 0, spliced_dim), kTrans, 0.0);
+    if (affine) {
+      Vector<BaseFloat> offset(out_dim);
+      offset.CopyColFromMat(transform, spliced_dim);
+      ref.AddVecToRows(1.0, offset);
+    }
+    SpliceAndTransform(feats, left_context, right_context, transform, &out);
+    AssertEqual(ref, out);
+  }
+}
 
 }
 
@@ -101,6 +191,9 @@ int main() {
   using namespace kaldi;
   try {
     UnitTestOnlineCmvn();
+    UnitTestOnlineSlidingWindowCmn();
+    UnitTestOnlineSlidingWindowCmnGlobal();
+    UnitTestSpliceAndTransform();
     std::cout << "Tests succeeded.\n";
     return 0;
   } catch (const std::exception &e) {
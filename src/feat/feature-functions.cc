@@ -48,9 +48,16 @@ int32 NumFrames(int32 nsamp,
 }
 
 
-void Dither(VectorBase<BaseFloat> *waveform, BaseFloat dither_value) {
-  for (int32 i = 0; i < waveform->Dim(); i++)
-    (*waveform)(i) += RandGauss() * dither_value;
+void Dither(VectorBase<BaseFloat> *waveform, BaseFloat dither_value,
+            RandomGenerator *rng) {
+  if (rng == NULL) {
+    for (int32 i = 0; i < waveform->Dim(); i++)
+      (*waveform)(i) += RandGauss() * dither_value;
+  } else {
+    Vector<BaseFloat> noise(waveform->Dim(), kUndefined);
+    noise.SetRandn(rng);
+    waveform->AddVec(dither_value, noise);
+  }
 }
 
 
@@ -93,7 +100,8 @@ void ExtractWindow(const VectorBase<BaseFloat> &wave,
                    const FrameExtractionOptions &opts,
                    const FeatureWindowFunction &window_function,
                    Vector<BaseFloat> *window,
-                   BaseFloat *log_energy_pre_window) {
+                   BaseFloat *log_energy_pre_window,
+                   RandomGenerator *rng) {
   int32 frame_shift = opts.WindowShift();
   int32 frame_length = opts.WindowSize();
   KALDI_ASSERT(window_function.window.Dim() == frame_length);
@@ -145,7 +153,7 @@ void ExtractWindow(const VectorBase<BaseFloat> &wave,
   SubVector<BaseFloat> window_part(*window, 0, frame_length);
   window_part.CopyFromVec(wave_part);
 
-  if (opts.dither != 0.0) Dither(&window_part, opts.dither);
+  if (opts.dither != 0.0) Dither(&window_part, opts.dither, rng);
 
   if (opts.remove_dc_offset)
     window_part.Add(-window_part.Sum() / frame_length);
@@ -165,6 +173,29 @@ void ExtractWindow(const VectorBase<BaseFloat> &wave,
                          frame_length_padded-frame_length).SetZero();
 }
 
+void ExtractWindows(const VectorBase<BaseFloat> &wave,
+                    int32 first_frame,
+                    const FrameExtractionOptions &opts,
+                    const FeatureWindowFunction &window_function,
+                    MatrixBase<BaseFloat> *windows,
+                    VectorBase<BaseFloat> *log_energy_pre_window,
+                    RandomGenerator *rng) {
+  KALDI_ASSERT(windows->NumCols() == opts.PaddedWindowSize() &&
+               first_frame >= 0 && first_frame + windows->NumRows() <=
+               NumFrames(wave.Dim(), opts));
+  KALDI_ASSERT(log_energy_pre_window == NULL ||
+               log_energy_pre_window->Dim() == windows->NumRows());
+  Vector<BaseFloat> window(windows->NumCols());
+  for (int32 r = 0; r < windows->NumRows(); r++) {
+    BaseFloat log_energy;
+    ExtractWindow(wave, first_frame + r, opts, window_function, &window,
+                  (log_energy_pre_window != NULL ? &log_energy : NULL), rng);
+    windows->CopyRowFromVec(window, r);
+    if (log_energy_pre_window != NULL)
+      (*log_energy_pre_window)(r) = log_energy;
+  }
+}
+
 void ExtractWaveformRemainder(const VectorBase<BaseFloat> &wave,
                               const FrameExtractionOptions &opts,
                               Vector<BaseFloat> *wave_remainder) {
@@ -205,6 +236,19 @@ void ComputePowerSpectrum(VectorBase<BaseFloat> *waveform) {
   // if the signal has been bandlimited sensibly this should be zero.
 }
 
+void ComputePowerSpectra(SplitRadixRealFft<BaseFloat> *srfft,
+                         MatrixBase<BaseFloat> *windows) {
+  for (int32 r = 0; r < windows->NumRows(); r++) {
+    SubVector<BaseFloat> row(*windows, r);
+    if (srfft != NULL)  // Compute FFT using the split-radix algorithm.
+      srfft->Compute(row.Data(), true);
+    else  // An alternative algorithm that works for non-powers-of-two.
+      RealFft(&row, true);
+    ComputePowerSpectrum(&row);
+  }
+}
+
+
 
 DeltaFeatures::DeltaFeatures(const DeltaFeaturesOptions &opts): opts_(opts) {
   KALDI_ASSERT(opts.order >= 0 && opts.order < 1000);  // just make sure we don't get binary junk.
@@ -410,6 +454,54 @@ void SpliceFrames(const MatrixBase<BaseFloat> &input_features,
   }
 }
 
+void SpliceAndTransform(const MatrixBase<BaseFloat> &input_features,
+                        int32 left_context,
+                        int32 right_context,
+                        const MatrixBase<BaseFloat> &transform,
+                        Matrix<BaseFloat> *output_features) {
+  int32 T = input_features.NumRows(), D = input_features.NumCols();
+  if (T == 0 || D == 0)
+    KALDI_ERR << "SpliceAndTransform: empty input\n";
+  KALDI_ASSERT(left_context >= 0 && right_context >= 0);
+  int32 N = 1 + left_context + right_context,
+      out_dim = transform.NumRows();
+  if (transform.NumCols() != D * N && transform.NumCols() != D * N + 1)
+    KALDI_ERR << "SpliceAndTransform: transform has " << transform.NumCols()
+              << " columns, expected " << (D * N) << " or " << (D * N + 1);
+  output_features->Resize(T, out_dim, kUndefined);
+  if (transform.NumCols() == D * N + 1) {
+    Vector<BaseFloat> offset(out_dim);
+    offset.CopyColFromMat(transform, D * N);
+    output_features->CopyRowsFromVec(offset);
+  } else {
+    output_features->SetZero();
+  }
+  Vector<BaseFloat> edge_frame(out_dim);
+  for (int32 j = 0; j < N; j++) {
+    SubMatrix<BaseFloat> block(transform, 0, out_dim, j * D, D);
+    // Output frame t uses input frame t + shift, limited to [0, T-1].
+    int32 shift = j - left_context,
+        begin = std::max<int32>(0, -shift),  // first t with t + shift >= 0.
+        end = std::min<int32>(T, T - shift);  // one past last t with
+                                              // t + shift < T.
+    if (end > begin)
+      output_features->RowRange(begin, end - begin).AddMatMat(
+          1.0, input_features.RowRange(begin + shift, end - begin), kNoTrans,
+          block, kTrans, 1.0);
+    if (begin > 0) {  // these frames use the first frame.
+      edge_frame.AddMatVec(1.0, block, kNoTrans, input_features.Row(0), 0.0);
+      for (int32 t = 0; t < std::min(begin, T); t++)
+        output_features->Row(t).AddVec(1.0, edge_frame);
+    }
+    if (end < T) {  // these frames use the last frame.
+      edge_frame.AddMatVec(1.0, block, kNoTrans, input_features.Row(T - 1),
+                           0.0);
+      for (int32 t = std::max(end, 0); t < T; t++)
+        output_features->Row(t).AddVec(1.0, edge_frame);
+    }
+  }
+}
+
 void ReverseFrames(const MatrixBase<BaseFloat> &input_features,
                    Matrix<BaseFloat> *output_features) {
   int32 T = input_features.NumRows(), D = input_features.NumCols();
@@ -431,102 +523,196 @@ void SlidingWindowCmnOptions::Check() const {
   // else ignored so value doesn't matter.
 }
 
-// Internal version of SlidingWindowCmn with double-precision arguments.
-void SlidingWindowCmnInternal(const SlidingWindowCmnOptions &opts,
-                              const MatrixBase<double> &input,
-                              MatrixBase<double> *output) {
+OnlineSlidingWindowCmn::OnlineSlidingWindowCmn(
+    const SlidingWindowCmnOptions &opts, int32 dim):
+    opts_(opts), dim_(dim), t_in_(0), t_out_(0), input_finished_(false),
+    window_start_(0), window_end_(0), sum_(dim), global_frames_(0) {
   opts.Check();
-  int32 num_frames = input.NumRows(), dim = input.NumCols();
+  KALDI_ASSERT(dim > 0);
+  // See AcceptFrame() for why this is enough.
+  history_.Resize(opts.cmn_window + opts.min_window + 2, dim);
+  if (opts.normalize_variance)
+    sumsq_.Resize(dim);
+}
 
-  int32 last_window_start = -1, last_window_end = -1;
-  Vector<double> cur_sum(dim), cur_sumsq(dim);
+void OnlineSlidingWindowCmn::SetGlobalStats(
+    const MatrixBase<double> &global_stats, int32 global_frames) {
+  KALDI_ASSERT(global_frames >= 0);
+  if (global_stats.NumRows() != 2 || global_stats.NumCols() != dim_ + 1)
+    KALDI_ERR << "Global CMVN stats have the wrong dimension "
+              << global_stats.NumRows() << " x " << global_stats.NumCols()
+              << ", expected 2 x " << (dim_ + 1);
+  if (global_stats(0, dim_) <= 0.0)
+    KALDI_ERR << "Global CMVN stats have zero count.";
+  global_stats_ = global_stats;
+  global_frames_ = global_frames;
+}
 
-  for (int32 t = 0; t < num_frames; t++) {
-    int32 window_start, window_end; // note: window_end will be one
-    // past the end of the window we use for normalization.
-    if (opts.center) {
-      window_start = t - (opts.cmn_window / 2);
-      window_end = window_start + opts.cmn_window;
-    } else {
-      window_start = t - opts.cmn_window;
-      window_end = t + 1;
-    }
-    if (window_start < 0) { // shift window right if starts <0.
-      window_end -= window_start;
-      window_start = 0; // or: window_start -= window_start
-    }
-    if (!opts.center) {
-      if (window_end > t)
-        window_end = std::max(t + 1, opts.min_window);
-    }
-    if (window_end > num_frames) {
-      window_start -= (window_end - num_frames);
-      window_end = num_frames;
-      if (window_start < 0) window_start = 0;
-    }
-    if (last_window_start == -1) {
-      SubMatrix<double> input_part(input,
-                                      window_start, window_end - window_start,
-                                      0, dim);
-      cur_sum.AddRowSumMat(1.0, input_part , 0.0);
-      if (opts.normalize_variance)
-        cur_sumsq.AddDiagMat2(1.0, input_part, kTrans, 0.0);
+void OnlineSlidingWindowCmn::AcceptFrame(const VectorBase<BaseFloat> &frame) {
+  KALDI_ASSERT(!input_finished_ && frame.Dim() == dim_);
+  // The frames we still need are those from window_start_ onwards.  If the
+  // caller takes the frames as soon as they are ready, the next frame's window
+  // ends after t_in_, so t_in_ - window_start_ is at most about the length of
+  // a window, which is at most max(cmn_window + 1, min_window).
+  if (t_in_ - window_start_ >= history_.NumRows())
+    KALDI_ERR << "Frames were not taken from OnlineSlidingWindowCmn as soon "
+              << "as they were ready.";
+  HistoryFrame(t_in_).CopyFromVec(frame);
+  t_in_++;
+}
+
+void OnlineSlidingWindowCmn::GetWindow(int32 t, int32 *window_start,
+                                       int32 *window_end) const {
+  // This follows the original (whole-matrix) SlidingWindowCmn(); note:
+  // *window_end is one past the end of the window.
+  if (opts_.center) {
+    *window_start = t - (opts_.cmn_window / 2);
+    *window_end = *window_start + opts_.cmn_window;
+  } else {
+    *window_start = t - opts_.cmn_window;
+    *window_end = t + 1;
+  }
+  if (*window_start < 0) { // shift window right if starts <0.
+    *window_end -= *window_start;
+    *window_start = 0;
+  }
+  if (!opts_.center) {
+    if (*window_end > t)
+      *window_end = std::max(t + 1, opts_.min_window);
+  }
+  if (input_finished_ && *window_end > t_in_) {
+    // we now know the number of frames, which is t_in_.
+    *window_start -= (*window_end - t_in_);
+    *window_end = t_in_;
+    if (*window_start < 0) *window_start = 0;
+  }
+}
+
+void OnlineSlidingWindowCmn::WriteState(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<OnlineSlidingWindowCmn>");
+  WriteBasicType(os, binary, t_in_);
+  WriteBasicType(os, binary, t_out_);
+  WriteBasicType(os, binary, input_finished_);
+  WriteBasicType(os, binary, window_start_);
+  WriteBasicType(os, binary, window_end_);
+  history_.Write(os, binary);
+  sum_.Write(os, binary);
+  sumsq_.Write(os, binary);
+  WriteToken(os, binary, "</OnlineSlidingWindowCmn>");
+}
+
+void OnlineSlidingWindowCmn::ReadState(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<OnlineSlidingWindowCmn>");
+  ReadBasicType(is, binary, &t_in_);
+  ReadBasicType(is, binary, &t_out_);
+  ReadBasicType(is, binary, &input_finished_);
+  ReadBasicType(is, binary, &window_start_);
+  ReadBasicType(is, binary, &window_end_);
+  Matrix<double> history;
+  history.Read(is, binary);
+  if (history.NumRows() != history_.NumRows() ||
+      history.NumCols() != history_.NumCols())
+    KALDI_ERR << "Sliding-window CMN state does not match the options: "
+              << "history is " << history.NumRows() << " x "
+              << history.NumCols() << ", expected " << history_.NumRows()
+              << " x " << history_.NumCols();
+  history_.Swap(&history);
+  sum_.Read(is, binary);
+  sumsq_.Read(is, binary);
+  KALDI_ASSERT(sum_.Dim() == dim_ &&
+               sumsq_.Dim() == (opts_.normalize_variance ? dim_ : 0));
+  ExpectToken(is, binary, "</OnlineSlidingWindowCmn>");
+}
+
+bool OnlineSlidingWindowCmn::NextFrameReady() const {
+  if (t_out_ >= t_in_) return false;
+  if (input_finished_) return true;
+  int32 window_start, window_end;
+  GetWindow(t_out_, &window_start, &window_end);
+  return window_end <= t_in_;
+}
+
+void OnlineSlidingWindowCmn::GetNextFrame(VectorBase<BaseFloat> *frame) {
+  KALDI_ASSERT(NextFrameReady() && frame->Dim() == dim_);
+  int32 window_start, window_end;
+  GetWindow(t_out_, &window_start, &window_end);
+  // The window only moves forward, so updating the stats costs O(1) per frame
+  // on average.
+  KALDI_ASSERT(window_start >= window_start_ && window_end >= window_end_);
+  for (; window_end_ < window_end; window_end_++) {
+    SubVector<double> frame_to_add(HistoryFrame(window_end_));
+    sum_.AddVec(1.0, frame_to_add);
+    if (opts_.normalize_variance)
+      sumsq_.AddVec2(1.0, frame_to_add);
+  }
+  for (; window_start_ < window_start; window_start_++) {
+    SubVector<double> frame_to_remove(HistoryFrame(window_start_));
+    sum_.AddVec(-1.0, frame_to_remove);
+    if (opts_.normalize_variance)
+      sumsq_.AddVec2(-1.0, frame_to_remove);
+  }
+  int32 window_frames = window_end - window_start;
+  KALDI_ASSERT(window_frames > 0);
+
+  Vector<double> sum(sum_), sumsq(sumsq_);
+  double count = window_frames;
+  if (window_frames < global_frames_) {
+    // Make up the stats to global_frames_ frames using the global stats.
+    double global_scale = (global_frames_ - window_frames) /
+        global_stats_(0, dim_);
+    sum.AddVec(global_scale, global_stats_.Row(0).Range(0, dim_));
+    if (opts_.normalize_variance)
+      sumsq.AddVec(global_scale, global_stats_.Row(1).Range(0, dim_));
+    count = global_frames_;
+  }
+
+  Vector<double> output_frame(HistoryFrame(t_out_));
+  output_frame.AddVec(-1.0 / count, sum);
+
+  if (opts_.normalize_variance) {
+    if (count == 1.0) {
+      output_frame.Set(0.0);
     } else {
-      if (window_start > last_window_start) {
-        KALDI_ASSERT(window_start == last_window_start + 1);
-        SubVector<double> frame_to_remove(input, last_window_start);
-        cur_sum.AddVec(-1.0, frame_to_remove);
-        if (opts.normalize_variance)
-          cur_sumsq.AddVec2(-1.0, frame_to_remove);
-      }
-      if (window_end > last_window_end) {
-        KALDI_ASSERT(window_end == last_window_end + 1);
-        SubVector<double> frame_to_add(input, last_window_end);
-        cur_sum.AddVec(1.0, frame_to_add);
-        if (opts.normalize_variance)
-          cur_sumsq.AddVec2(1.0, frame_to_add);
-      }
-    }
-    int32 window_frames = window_end - window_start;
-    last_window_start = window_start;
-    last_window_end = window_end;
-
-    KALDI_ASSERT(window_frames > 0);
-    SubVector<double> input_frame(input, t),
-        output_frame(*output, t);
-    output_frame.CopyFromVec(input_frame);
-    output_frame.AddVec(-1.0 / window_frames, cur_sum);
-
-    if (opts.normalize_variance) {
-      if (window_frames == 1) {
-        output_frame.Set(0.0);
-      } else {
-        Vector<double> variance(cur_sumsq);
-        variance.Scale(1.0 / window_frames);
-        variance.AddVec2(-1.0 / (window_frames * window_frames), cur_sum);
-        // now "variance" is the variance of the features in the window,
-        // around their own mean.
-        int32 num_floored = variance.ApplyFloor(1.0e-10);
-        if (num_floored > 0 && num_frames > 1) {
-          KALDI_WARN << "Flooring variance When normalizing variance, floored " << num_floored
-                     << " elements; num-frames was " << window_frames;
-        }
-        variance.ApplyPow(-0.5); // get inverse standard deviation.
-        output_frame.MulElements(variance);
+      Vector<double> variance(sumsq);
+      variance.Scale(1.0 / count);
+      variance.AddVec2(-1.0 / (count * count), sum);
+      // now "variance" is the variance of the features in the window,
+      // around their own mean.
+      int32 num_floored = variance.ApplyFloor(1.0e-10);
+      if (num_floored > 0) {
+        KALDI_WARN << "Flooring variance When normalizing variance, floored "
+                   << num_floored << " elements; num-frames was "
+                   << window_frames;
       }
+      variance.ApplyPow(-0.5); // get inverse standard deviation.
+      output_frame.MulElements(variance);
     }
   }
+  frame->CopyFromVec(output_frame);
+  t_out_++;
 }
 
 
 void SlidingWindowCmn(const SlidingWindowCmnOptions &opts,
                       const MatrixBase<BaseFloat> &input,
-                      MatrixBase<BaseFloat> *output) {
+                      MatrixBase<BaseFloat> *output,
+                      const MatrixBase<double> *global_stats,
+                      int32 global_frames) {
   KALDI_ASSERT(SameDim(input, *output) && input.NumRows() > 0);
-  Matrix<double> input_dbl(input), output_dbl(input.NumRows(), input.NumCols());
-  // calll double-precision version
-  SlidingWindowCmnInternal(opts, input_dbl, &output_dbl);
-  output->CopyFromMat(output_dbl);
+  int32 num_frames = input.NumRows();
+  OnlineSlidingWindowCmn cmn(opts, input.NumCols());
+  if (global_stats != NULL)
+    cmn.SetGlobalStats(*global_stats, global_frames);
+  int32 t_out = 0;
+  for (int32 t = 0; t <= num_frames; t++) {
+    if (t < num_frames) cmn.AcceptFrame(input.Row(t));
+    else cmn.InputFinished();
+    while (cmn.NextFrameReady()) {
+      SubVector<BaseFloat> output_frame(*output, t_out++);
+      cmn.GetNextFrame(&output_frame);
+    }
+  }
+  KALDI_ASSERT(t_out == num_frames);
 }
 
 
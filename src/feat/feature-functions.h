@@ -142,7 +142,12 @@ struct FeatureWindowFunction {
 int32 NumFrames(int32 wave_length,
                 const FrameExtractionOptions &opts);
 
-void Dither(VectorBase<BaseFloat> *waveform, BaseFloat dither_value);
+// Adds Gaussian noise with standard deviation "dither_value" to the
+// waveform.  If rng != NULL the noise comes from it, which is much faster than
+// the global RandGauss() and safe to use from several threads, each with its
+// own generator.
+void Dither(VectorBase<BaseFloat> *waveform, BaseFloat dither_value,
+            RandomGenerator *rng = NULL);
 
 void Preemphasize(VectorBase<BaseFloat> *waveform, BaseFloat preemph_coeff);
 
@@ -155,7 +160,26 @@ void ExtractWindow(const VectorBase<BaseFloat> &wave,
                    const FrameExtractionOptions &opts,
                    const FeatureWindowFunction &window_function,
                    Vector<BaseFloat> *window,
-                   BaseFloat *log_energy_pre_window = NULL);
+                   BaseFloat *log_energy_pre_window = NULL,
+                   RandomGenerator *rng = NULL);  // for Dither().
+
+// The number of frames that Mfcc::Compute() and Fbank::Compute() process at
+// a time; the windows for a block of this many frames take 0.5M of memory
+// with the default options.
+const int32 kFeatureBlockSize = 256;
+
+// ExtractWindows is as ExtractWindow, but extracts the frames first_frame,
+// first_frame + 1, ... into the rows of "windows", which must have
+// opts.PaddedWindowSize() columns.  If log_energy_pre_window != NULL, it must
+// have windows->NumRows() elements; it receives the log-energies.  This is
+// used to process blocks of frames at a time in the feature extraction code.
+void ExtractWindows(const VectorBase<BaseFloat> &wave,
+                    int32 first_frame,
+                    const FrameExtractionOptions &opts,
+                    const FeatureWindowFunction &window_function,
+                    MatrixBase<BaseFloat> *windows,
+                    VectorBase<BaseFloat> *log_energy_pre_window = NULL,
+                    RandomGenerator *rng = NULL);
 
 // ExtractWaveformRemainder is useful if the waveform is coming in segments.
 // It extracts the bit of the waveform at the end of this block that you
@@ -176,6 +200,14 @@ void ExtractWaveformRemainder(const VectorBase<BaseFloat> &wave,
 // remaining (n/2) - 1 elements are undefined at output.
 void ComputePowerSpectrum(VectorBase<BaseFloat> *complex_fft);
 
+// ComputePowerSpectra does the FFT of each row of "windows" in place, and
+// converts it to a power spectrum as ComputePowerSpectrum() does, so that at
+// output the first NumCols()/2 + 1 columns contain the power spectra.  If
+// srfft != NULL it is used for the FFT (its size must equal
+// windows->NumCols()); otherwise RealFft() is used.
+void ComputePowerSpectra(SplitRadixRealFft<BaseFloat> *srfft,
+                         MatrixBase<BaseFloat> *windows);
+
 
 
 inline void MaxNormalizeEnergy(Matrix<BaseFloat> *feats) {
@@ -293,6 +325,18 @@ void SpliceFrames(const MatrixBase<BaseFloat> &input_features,
                   int32 right_context,
                   Matrix<BaseFloat> *output_features);
 
+// SpliceAndTransform computes the same as SpliceFrames() followed by
+// multiplying each spliced frame by "transform" (e.g. an LDA+MLLT matrix),
+// which may have one extra column for an offset, as in transform-feats.  It
+// does not form the spliced features: each block of columns of the
+// transform is multiplied by the range of input frames it applies to, so it
+// needs less memory, and no copying of frames.
+void SpliceAndTransform(const MatrixBase<BaseFloat> &input_features,
+                        int32 left_context,
+                        int32 right_context,
+                        const MatrixBase<BaseFloat> &transform,
+                        Matrix<BaseFloat> *output_features);
+
 // ReverseFrames reverses the frames in time (used for backwards decoding)
 void ReverseFrames(const MatrixBase<BaseFloat> &input_features,
                   Matrix<BaseFloat> *output_features);
@@ -342,10 +386,92 @@ struct SlidingWindowCmnOptions {
 /// Applies sliding-window cepstral mean and/or variance normalization.  See the
 /// strings registering the options in the options class for information on how
 /// this works and what the options are.  input and output must have the same
-/// dimension.
+/// dimension.  If global_stats is non-NULL, it is used as a prior; see
+/// OnlineSlidingWindowCmn::SetGlobalStats().
 void SlidingWindowCmn(const SlidingWindowCmnOptions &opts,
                       const MatrixBase<BaseFloat> &input,
-                      MatrixBase<BaseFloat> *output);
+                      MatrixBase<BaseFloat> *output,
+                      const MatrixBase<double> *global_stats = NULL,
+                      int32 global_frames = 0);
+
+
+/// This class does the same computation as SlidingWindowCmn(), but on a
+/// stream of frames: you give it the frames one by one with AcceptFrame(), and
+/// take each normalized frame with GetNextFrame() as soon as the window it
+/// needs has been seen (with center == false that is straight away, after the
+/// first min_window frames).  The stats of the window are kept as running sums
+/// in double precision, adding the frame that enters the window and
+/// subtracting the one that leaves it, so the cost per frame does not depend on
+/// the window length.  SlidingWindowCmn() is implemented using this class.
+class OnlineSlidingWindowCmn {
+ public:
+  OnlineSlidingWindowCmn(const SlidingWindowCmnOptions &opts, int32 dim);
+
+  /// Sets global CMVN stats to use as a prior, in the format written by
+  /// compute-cmvn-stats (2 x (dim + 1): a row of sums and a row of sums of
+  /// squares, each with the count in its last element).  While the window has
+  /// fewer than "global_frames" frames, its stats are made up to
+  /// "global_frames" frames' worth using the (scaled) global stats; this makes
+  /// the normalization less noisy at the start of the data.
+  void SetGlobalStats(const MatrixBase<double> &global_stats,
+                      int32 global_frames);
+
+  /// Adds the next frame of input.  You must take all the frames that
+  /// NextFrameReady() says are ready before calling this again, because only
+  /// the frames needed for the window are kept.
+  void AcceptFrame(const VectorBase<BaseFloat> &frame);
+
+  /// Call this after the last AcceptFrame(); the remaining frames then become
+  /// ready.
+  void InputFinished() { input_finished_ = true; }
+
+  /// Returns true if the next output frame can be computed.
+  bool NextFrameReady() const;
+
+  /// Outputs the next normalized frame; requires NextFrameReady().
+  void GetNextFrame(VectorBase<BaseFloat> *frame);
+
+  int32 Dim() const { return dim_; }
+
+  /// Returns the number of frames accepted so far.
+  int32 NumFramesAccepted() const { return t_in_; }
+
+  /// Returns the number of frames output so far.
+  int32 NumFramesOutput() const { return t_out_; }
+
+  /// Writes the frames held and the stats of the window, but not the options
+  /// or the global stats, so that an object set up in the same way (e.g. in
+  /// another process) can carry on from the same point after ReadState().
+  void WriteState(std::ostream &os, bool binary) const;
+
+  void ReadState(std::istream &is, bool binary);
+
+ private:
+  /// Gets the window [*window_start, *window_end) used to normalize frame t,
+  /// which must be < t_in_.  If the input is not finished, this assumes that
+  /// there is no limit on the number of frames.
+  void GetWindow(int32 t, int32 *window_start, int32 *window_end) const;
+
+  SubVector<double> HistoryFrame(int32 t) {
+    return history_.Row(t % history_.NumRows());
+  }
+
+  SlidingWindowCmnOptions opts_;
+  int32 dim_;
+  Matrix<double> history_;  // Circular buffer of the frames that may still be
+                            // needed, indexed by t % history_.NumRows().
+  int32 t_in_;  // Number of frames accepted.
+  int32 t_out_;  // Number of frames output.
+  bool input_finished_;
+  int32 window_start_;  // sum_ and sumsq_ are the stats of the frames
+  int32 window_end_;    // in [window_start_, window_end_).
+  Vector<double> sum_;
+  Vector<double> sumsq_;  // Only used if opts_.normalize_variance.
+  Matrix<double> global_stats_;  // Empty if there is no prior.
+  int32 global_frames_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineSlidingWindowCmn);
+};
 
 
 /// @} End of "addtogroup feat"
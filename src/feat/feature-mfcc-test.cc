@@ -109,6 +109,28 @@ static void UnitTestSimple() {
 }
 
 
+// With SetDitherSeed(), the same seed and stream give the same features, and
+// the dithering noise differs between streams.
+static void UnitTestDitherSeed() {
+  std::cout << "=== UnitTestDitherSeed() ===\n";
+  Vector<BaseFloat> v(20000);
+  for (int32 i = 0; i < v.Dim(); i++)
+    v(i) = (abs( i * 433024253 ) % 65535) - (65535 / 2);
+  MfccOptions op;
+  op.frame_opts.dither = 1.0;
+  Matrix<BaseFloat> m1, m2, m3;
+  Mfcc mfcc1(op), mfcc2(op), mfcc3(op);
+  mfcc1.SetDitherSeed(10, 3);
+  mfcc2.SetDitherSeed(10, 3);
+  mfcc3.SetDitherSeed(10, 4);
+  mfcc1.Compute(v, 1.0, &m1, NULL);
+  mfcc2.Compute(v, 1.0, &m2, NULL);
+  mfcc3.Compute(v, 1.0, &m3, NULL);
+  KALDI_ASSERT(m1.ApproxEqual(m2, 0.0));
+  KALDI_ASSERT(!m1.ApproxEqual(m3, 0.0) && m1.ApproxEqual(m3, 0.01));
+  std::cout << "Test passed :)\n\n";
+}
+
 static void UnitTestHTKCompare1() {
   std::cout << "=== UnitTestHTKCompare1() ===\n";
 
@@ -645,6 +667,7 @@ static void UnitTestFeat() {
   UnitTestVtln();
   UnitTestReadWave();
   UnitTestSimple();
+  UnitTestDitherSeed();
   UnitTestHTKCompare1();
   UnitTestHTKCompare2();
   // commenting out this one as it doesn't compare right now I normalized
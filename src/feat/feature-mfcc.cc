@@ -19,12 +19,14 @@
 
 
 #include "feat/feature-mfcc.h"
+#include "util/kaldi-profile.h"
 
 
 namespace kaldi {
 
 Mfcc::Mfcc(const MfccOptions &opts)
-    : opts_(opts), feature_window_function_(opts.frame_opts), srfft_(NULL) {
+    : opts_(opts), feature_window_function_(opts.frame_opts), srfft_(NULL),
+      use_rng_(false) {
   int32 num_bins = opts.mel_opts.num_bins;
   Matrix<BaseFloat> dct_matrix(num_bins, num_bins);
   ComputeDctMatrix(&dct_matrix);
@@ -73,6 +75,7 @@ void Mfcc::Compute(const VectorBase<BaseFloat> &wave,
                    BaseFloat vtln_warp,
                    Matrix<BaseFloat> *output,
                    Vector<BaseFloat> *wave_remainder) {
+  KALDI_PROFILE_SCOPE("Mfcc::Compute");
   KALDI_ASSERT(output != NULL);
   int32 rows_out = NumFrames(wave.Dim(), opts_.frame_opts),
       cols_out = opts_.num_ceps;
@@ -81,50 +84,61 @@ void Mfcc::Compute(const VectorBase<BaseFloat> &wave,
   output->Resize(rows_out, cols_out);
   if (wave_remainder != NULL)
     ExtractWaveformRemainder(wave, opts_.frame_opts, wave_remainder);
-  Vector<BaseFloat> window;  // windowed waveform.
-  Vector<BaseFloat> mel_energies;
-  for (int32 r = 0; r < rows_out; r++) {  // r is frame index..
-    BaseFloat log_energy;
-    ExtractWindow(wave, r, opts_.frame_opts, feature_window_function_, &window,
-                  (opts_.use_energy && opts_.raw_energy ? &log_energy : NULL));
-
-    if (opts_.use_energy && !opts_.raw_energy)
-      log_energy = log(VecVec(window, window));
-
-    if (srfft_ != NULL)  // Compute FFT using the split-radix algorithm.
-      srfft_->Compute(window.Data(), true);
-    else  // An alternative algorithm that works for non-powers-of-two.
-      RealFft(&window, true);
+  const MelBanks *this_mel_banks = GetMelBanks(vtln_warp);
+  // We process the frames in blocks, doing each stage of the computation for
+  // the whole block at once, mostly as matrix operations; the blocks are
+  // small enough that the memory used does not grow with the file length.
+  int32 padded_window_size = opts_.frame_opts.PaddedWindowSize(),
+      block_size = std::min(rows_out, kFeatureBlockSize);
+  Matrix<BaseFloat> windows_block(block_size, padded_window_size, kUndefined),
+      mel_energies;
+  Vector<BaseFloat> log_energy_block(block_size, kUndefined);
+  for (int32 start = 0; start < rows_out; start += block_size) {
+    int32 num_frames = std::min(block_size, rows_out - start);
+    SubMatrix<BaseFloat> windows(windows_block, 0, num_frames,
+                                 0, padded_window_size);
+    SubVector<BaseFloat> log_energy(log_energy_block, 0, num_frames);
+    ExtractWindows(wave, start, opts_.frame_opts, feature_window_function_,
+                   &windows,
+                   (opts_.use_energy && opts_.raw_energy ? &log_energy : NULL),
+                   (use_rng_ ? &rng_ : NULL));
+
+    if (opts_.use_energy && !opts_.raw_energy) {
+      log_energy.AddDiagMat2(1.0, windows, kNoTrans, 0.0);
+      log_energy.ApplyLog();
+    }
 
-    // Convert the FFT into a power spectrum.
-    ComputePowerSpectrum(&window);
-    SubVector<BaseFloat> power_spectrum(window, 0, window.Dim()/2 + 1);
+    // Do the FFT and convert it into a power spectrum.
+    ComputePowerSpectra(srfft_, &windows);
+    SubMatrix<BaseFloat> power_spectra(windows, 0, num_frames,
+                                       0, padded_window_size / 2 + 1);
 
     // use magnitude spectrum
-    if(!opts_.mel_opts.use_power){
-    	power_spectrum.ApplyPow(0.5);
-    }
+    if (!opts_.mel_opts.use_power)
+      power_spectra.ApplyPow(0.5);
 
-    const MelBanks *this_mel_banks = GetMelBanks(vtln_warp);
-    this_mel_banks->Compute(power_spectrum, &mel_energies);
+    this_mel_banks->Compute(power_spectra, &mel_energies);
 
     mel_energies.ApplyLog();  // take the log.
 
-    SubVector<BaseFloat> this_mfcc(output->Row(r));
+    SubMatrix<BaseFloat> this_mfcc(output->RowRange(start, num_frames));
 
-    // this_mfcc = dct_matrix_ * mel_energies [which now have log]
-    this_mfcc.AddMatVec(1.0, dct_matrix_, kNoTrans, mel_energies, 0.0);
+    // this_mfcc = mel_energies [which now have log] * dct_matrix_^T
+    this_mfcc.AddMatMat(1.0, mel_energies, kNoTrans, dct_matrix_, kTrans, 0.0);
 
     if (opts_.cepstral_lifter != 0.0)
-      this_mfcc.MulElements(lifter_coeffs_);
+      this_mfcc.MulColsVec(lifter_coeffs_);
 
     if (opts_.use_energy) {
-      if (opts_.energy_floor > 0.0 && log_energy < log_energy_floor_)
-        log_energy = log_energy_floor_;
-      this_mfcc(0) = log_energy;
+      if (opts_.energy_floor > 0.0)
+        log_energy.ApplyFloor(log_energy_floor_);
+      this_mfcc.CopyColFromVec(log_energy, 0);
     }
+  }
 
-    if (opts_.htk_compat) {
+  if (opts_.htk_compat) {
+    for (int32 r = 0; r < rows_out; r++) {
+      SubVector<BaseFloat> this_mfcc(output->Row(r));
       BaseFloat energy = this_mfcc(0);
       for (int32 i = 0; i < opts_.num_ceps-1; i++)
         this_mfcc(i) = this_mfcc(i+1);
@@ -137,9 +151,4 @@ void Mfcc::Compute(const VectorBase<BaseFloat> &wave,
   }
 }
 
-
-
-
-
-
 }  // namespace kaldi
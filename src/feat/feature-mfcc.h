@@ -100,6 +100,15 @@ class Mfcc {
                Matrix<BaseFloat> *output,
                Vector<BaseFloat> *wave_remainder = NULL);
 
+  /// After this is called, the dithering noise comes from a RandomGenerator
+  /// owned by this object instead of from the global RandGauss(); this is
+  /// faster, and makes the output reproducible when several threads compute
+  /// features (e.g. use the utterance index as the stream).
+  void SetDitherSeed(uint64 seed, uint64 stream = 0) {
+    rng_.Seed(seed, stream);
+    use_rng_ = true;
+  }
+
  private:
   const MelBanks *GetMelBanks(BaseFloat vtln_warp);
   MfccOptions opts_;
@@ -109,6 +118,8 @@ class Mfcc {
   std::map<BaseFloat, MelBanks*> mel_banks_;  // BaseFloat is VTLN coefficient.
   FeatureWindowFunction feature_window_function_;
   SplitRadixRealFft<BaseFloat> *srfft_;
+  RandomGenerator rng_;
+  bool use_rng_;  // true if SetDitherSeed() was called.
   KALDI_DISALLOW_COPY_AND_ASSIGN(Mfcc);
 };
 
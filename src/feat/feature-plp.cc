@@ -20,6 +20,7 @@
 
 #include "feat/feature-plp.h"
 #include "util/parse-options.h"
+#include "util/kaldi-profile.h"
 
 
 namespace kaldi {
@@ -90,6 +91,7 @@ void Plp::Compute(const VectorBase<BaseFloat> &wave,
                   BaseFloat vtln_warp,
                   Matrix<BaseFloat> *output,
                   Vector<BaseFloat> *wave_remainder) {
+  KALDI_PROFILE_SCOPE("Plp::Compute");
   KALDI_ASSERT(output != NULL);
   int32 rows_out = NumFrames(wave.Dim(), opts_.frame_opts),
       cols_out = opts_.num_ceps;
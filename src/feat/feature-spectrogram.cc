@@ -20,6 +20,7 @@
 
 
 #include "feat/feature-spectrogram.h"
+#include "util/kaldi-profile.h"
 
 
 namespace kaldi {
@@ -42,6 +43,7 @@ Spectrogram::~Spectrogram() {
 void Spectrogram::Compute(const VectorBase<BaseFloat> &wave,
                    Matrix<BaseFloat> *output,
                    Vector<BaseFloat> *wave_remainder) {
+  KALDI_PROFILE_SCOPE("Spectrogram::Compute");
   KALDI_ASSERT(output != NULL);
 
   // Get dimensions of output features
@@ -216,6 +216,17 @@ BaseFloat MelBanks::VtlnWarpMelFreq(BaseFloat vtln_low_cutoff,  // upper+lower f
 }
 
 
+void MelBanks::GetMatrix(int32 num_fft_bins, Matrix<BaseFloat> *mat) const {
+  int32 num_bins = bins_.size();
+  mat->Resize(num_bins, num_fft_bins);
+  for (int32 i = 0; i < num_bins; i++) {
+    int32 offset = bins_[i].first;
+    const Vector<BaseFloat> &v(bins_[i].second);
+    KALDI_ASSERT(offset + v.Dim() <= num_fft_bins);
+    mat->Row(i).Range(offset, v.Dim()).CopyFromVec(v);
+  }
+}
+
 // "power_spectrum" contains fft energies.
 void MelBanks::Compute(const VectorBase<BaseFloat> &power_spectrum,
                        Vector<BaseFloat> *mel_energies_out) const {
@@ -245,6 +256,36 @@ void MelBanks::Compute(const VectorBase<BaseFloat> &power_spectrum,
   }
 }
 
+void MelBanks::Compute(const MatrixBase<BaseFloat> &power_spectra,
+                       Matrix<BaseFloat> *mel_energies_out) const {
+  int32 num_bins = bins_.size(), num_frames = power_spectra.NumRows();
+  // We compute the transpose first, so that each mel bin is computed for all
+  // the frames by a single, contiguous, matrix-vector product.
+  Matrix<BaseFloat> mel_energies_trans(num_bins, num_frames, kUndefined);
+  for (int32 i = 0; i < num_bins; i++) {
+    int32 offset = bins_[i].first;
+    const Vector<BaseFloat> &v(bins_[i].second);
+    mel_energies_trans.Row(i).AddMatVec(
+        1.0, power_spectra.ColRange(offset, v.Dim()), kNoTrans, v, 0.0);
+  }
+  // HTK-like flooring- for testing purposes (we prefer dither)
+  if (htk_mode_)
+    mel_energies_trans.ApplyFloor(1.0);
+  // See the comment about OpenBlas in the other version of Compute().
+  KALDI_ASSERT(!KALDI_ISNAN(mel_energies_trans.Sum()));
+  mel_energies_out->Resize(num_frames, num_bins, kUndefined);
+  mel_energies_out->CopyFromMat(mel_energies_trans, kTrans);
+
+  if (debug_) {
+    fprintf(stderr, "MEL BANKS:\n");
+    for (int32 r = 0; r < num_frames; r++) {
+      for (int32 i = 0; i < num_bins; i++)
+        fprintf(stderr, " %f", (*mel_energies_out)(r, i));
+      fprintf(stderr, "\n");
+    }
+  }
+}
+
 template<typename Real> void ComputeLifterCoeffs(BaseFloat Q, VectorBase<Real> *coeffs) {
   // Compute liftering coefficients (scaling on cepstral coeffs)
   // coeffs are numbered slightly differently from HTK: the zeroth
@@ -76,8 +76,25 @@ class MelBanks {
   void Compute(const VectorBase<BaseFloat> &fft_energies,
                Vector<BaseFloat> *mel_energies_out) const;
 
+  /// As Compute(), but for many frames at once: each row of "power_spectra"
+  /// contains the FFT energies of one frame, and "mel_energies_out" is resized
+  /// to power_spectra.NumRows() by NumBins().  Each mel bin is applied to the
+  /// whole block of frames in one matrix-vector product.
+  void Compute(const MatrixBase<BaseFloat> &power_spectra,
+               Matrix<BaseFloat> *mel_energies_out) const;
+
   int32 NumBins() const { return bins_.size(); }
 
+  /// Outputs the filterbank as a dense matrix of dimension NumBins() by
+  /// num_fft_bins, so that the mel energies of many frames can be computed
+  /// with one matrix multiplication.  num_fft_bins would normally be the
+  /// dimension of the power spectrum, i.e. the padded window size / 2 + 1;
+  /// it must be large enough to include all the nonzero weights.
+  void GetMatrix(int32 num_fft_bins, Matrix<BaseFloat> *mat) const;
+
+  /// If true, Compute() floors the mel energies to 1.0, as HTK does.
+  bool HtkMode() const { return htk_mode_; }
+
   // returns vector of central freq of each bin; needed by plp code.
   const Vector<BaseFloat> &GetCenterFreqs() const { return center_freqs_; }
 
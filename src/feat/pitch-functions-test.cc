@@ -436,12 +436,81 @@ void UnitTestResample() {
   }
 }
 
+// Generates a test signal: a tone whose frequency moves slowly, in noise.
+static void GetToneWave(Vector<BaseFloat> *wave) {
+  wave->Resize(16000 + rand() % 16000);
+  wave->SetRandn();
+  double phase = 0.0;
+  for (int32 i = 0; i < wave->Dim(); i++) {
+    double freq = 150.0 + 50.0 * sin(M_2PI * i / 16000.0);
+    phase += M_2PI * freq / 16000.0;
+    (*wave)(i) = 1000.0 * ((*wave)(i) * 0.1 + sin(phase));
+  }
+}
+
+static void UnitTestOnlinePitch() {
+  KALDI_LOG << "=== UnitTestOnlinePitch() ===\n";
+  for (int32 n = 0; n < 3; n++) {
+    PitchExtractionOptions op;
+    // With no ballast the RMS normalization (which differs between the online
+    // and batch versions) only has a very small effect on the POV.
+    op.nccf_ballast = 0.0;
+    Vector<BaseFloat> wave;
+    GetToneWave(&wave);
+    Matrix<BaseFloat> m;
+    Compute(op, wave, &m);
+
+    // With unlimited latency we should get the same as the batch version.
+    OnlinePitchExtractor online_pitch(op, -1);
+    online_pitch.AcceptWaveform(wave);
+    Matrix<BaseFloat> m2;
+    online_pitch.GetFrames(&m2);
+    KALDI_ASSERT(m2.NumRows() == 0);
+    online_pitch.InputFinished();
+    online_pitch.GetFrames(&m2);
+    KALDI_ASSERT(m.ApproxEqual(m2, 0.001));
+
+    // With a limited latency, the output should not depend on how we divide
+    // up the signal, and frames should not be delayed more than that.
+    int32 max_latency = 10 + rand() % 20;
+    op.nccf_ballast = 0.7;
+    OnlinePitchExtractor pitch1(op, max_latency), pitch2(op, max_latency);
+    pitch1.AcceptWaveform(wave);
+    pitch1.InputFinished();
+    Matrix<BaseFloat> m3;
+    pitch1.GetFrames(&m3);
+    KALDI_ASSERT(m3.NumRows() == m.NumRows());
+    int32 num_done = 0, num_output = 0;
+    while (num_done < wave.Dim()) {
+      int32 num_samples = std::min(wave.Dim() - num_done, rand() % 1000);
+      pitch2.AcceptWaveform(wave.Range(num_done, num_samples));
+      num_done += num_samples;
+      Matrix<BaseFloat> part;
+      pitch2.GetFrames(&part);
+      if (part.NumRows() != 0) {
+        Matrix<BaseFloat> m4(m3.RowRange(num_output, part.NumRows()));
+        KALDI_ASSERT(part.ApproxEqual(m4, 0.0));
+      }
+      num_output += part.NumRows();
+      // About 30 frames of latency come from the window and resampling.
+      KALDI_ASSERT(num_output + max_latency + 30 >=
+                   PitchNumFrames(num_done * op.resample_freq / op.samp_freq,
+                                  op));
+    }
+    pitch2.InputFinished();
+    Matrix<BaseFloat> part;
+    pitch2.GetFrames(&part);
+    KALDI_ASSERT(num_output + part.NumRows() == m3.NumRows());
+  }
+}
+
 static void UnitTestFeatNoKeele() {
   UnitTestSimple();
   UnitTestDeltaPitch();
   UnitTestTakeLogOfPitch();
   UnitTestWeightedMwn();
   UnitTestResample();
+  UnitTestOnlinePitch();
 }
 static void UnitTestFeatWithKeele() {
   UnitTestKeele();
@@ -231,34 +231,49 @@ class LinearResample {
   }
 
   void Upsample(const VectorBase<double> &input,
-                VectorBase<double> *output) {
+                VectorBase<double> *output) const {
     // each row of "input" corresponds to the data to resample;
     // the corresponding row of "output" is the resampled data.
     int32 num_samples_in_ = input.Dim();
     int32 resampled_len = 1 + static_cast<int>(num_samples_in_ / frame_shift_);
     if (output->Dim() != resampled_len) resampled_len = output->Dim();
 
-    for (int32 i = 0; i < resampled_len; i++) {
-      int32 inner_i = i % num_weights_;  // the index of weight to be used
-      int32 offset = (i - inner_i) * frame_shift_;
-      int32 fake_first_index = indexes_[inner_i].first_index + offset,
-            fake_last_index = indexes_[inner_i].last_index + offset;
-      int32 first_index = std::max(0, fake_first_index),
-            last_index = std::min((num_samples_in_ - 1), fake_last_index);
-      int32 num_indices = last_index - first_index + 1;
-      SubVector<double> input_part(input, first_index, num_indices);
-      Vector<double> &weights = weights_[inner_i];
-      if (num_indices == weights.Dim())
-        (*output)(i) = VecVec(input_part, weights);
-      else if (fake_first_index >= 0) {
-        SubVector<double> weight_vec(weights, 0, num_indices);
-        (*output)(i) = VecVec(input_part, weight_vec);
-      } else if (fake_first_index < 0) {
-        SubVector<double> weight_vec(weights, -fake_first_index, num_indices);
-        (*output)(i) = VecVec(input_part, weight_vec);
-      }
-    }
-    output->Scale(1.0/samp_rate_in_);
+    for (int32 i = 0; i < resampled_len; i++)
+      (*output)(i) = OutputSample(input, 0, i);
+  }
+
+  // The first input-sample index that output sample i depends on (may be
+  // negative).
+  int32 FirstInputIndex(int32 i) const {
+    int32 inner_i = i % num_weights_;
+    return indexes_[inner_i].first_index +
+        static_cast<int32>((i - inner_i) * frame_shift_);
+  }
+  // The last input-sample index that output sample i depends on.
+  int32 LastInputIndex(int32 i) const {
+    int32 inner_i = i % num_weights_;
+    return indexes_[inner_i].last_index +
+        static_cast<int32>((i - inner_i) * frame_shift_);
+  }
+
+  // Computes output sample i, where "input" contains the input samples
+  // starting from input sample "input_offset"; samples outside "input" are
+  // treated as zero.  This is what the online pitch extraction uses, as it
+  // only keeps the recent part of the input.
+  double OutputSample(const VectorBase<double> &input,
+                      int32 input_offset, int32 i) const {
+    int32 inner_i = i % num_weights_;  // the index of weight to be used
+    int32 fake_first_index = FirstInputIndex(i),
+        fake_last_index = LastInputIndex(i);
+    int32 first_index = std::max(input_offset, fake_first_index),
+        last_index = std::min(input_offset + input.Dim() - 1, fake_last_index);
+    int32 num_indices = last_index - first_index + 1;
+    if (num_indices <= 0) return 0.0;
+    SubVector<double> input_part(input, first_index - input_offset,
+                                 num_indices);
+    SubVector<double> weight_part(weights_[inner_i],
+                                  first_index - fake_first_index, num_indices);
+    return VecVec(input_part, weight_part) * (1.0 / samp_rate_in_);
   }
  private:
   void PreSet() {
@@ -704,6 +719,244 @@ void Compute(const PitchExtractionOptions &opts,
   pitch.GetPitch(output);
 }
 
+// Discards the first "num_samples" samples of "wave".
+static void DiscardSamples(int32 num_samples, Vector<double> *wave) {
+  KALDI_ASSERT(num_samples >= 0 && num_samples <= wave->Dim());
+  if (num_samples == 0) return;
+  Vector<double> remainder(wave->Range(num_samples,
+                                       wave->Dim() - num_samples));
+  wave->Swap(&remainder);
+}
+
+OnlinePitchExtractor::OnlinePitchExtractor(const PitchExtractionOptions &opts,
+                                           int32 max_latency):
+    opts_(opts), max_latency_(max_latency), input_offset_(0),
+    num_input_samples_(0), downsampled_offset_(0),
+    num_downsampled_samples_(0), sum_sq_(0.0), sum_sq_count_(0),
+    input_finished_(false), num_frames_computed_(0) {
+  signal_resampler_ = new LinearResample(opts.samp_freq, opts.resample_freq,
+                                         opts.lowpass_cutoff,
+                                         opts.lowpass_filter_width);
+  // The following are computed as in Compute().
+  double outer_min_lag = 1.0 / (1.0 * opts.max_f0) -
+      (opts.upsample_filter_width/(2.0 * opts.resample_freq));
+  double outer_max_lag = 1.0 / (1.0 * opts.min_f0) +
+      (opts.upsample_filter_width/(2.0 * opts.resample_freq));
+  num_max_lag_ = Round(outer_max_lag * opts.resample_freq) + 1;
+  num_lags_ = Round(opts.resample_freq * outer_max_lag) -
+      Round(opts.resample_freq *  outer_min_lag) + 1;
+  nccf_first_lag_ = Round(opts.resample_freq  * outer_min_lag);
+  nccf_last_lag_ = Round(opts.resample_freq / opts.min_f0) +
+      Round(opts.lowpass_filter_width / 2);
+  full_frame_length_ = opts.NccfWindowSize() + nccf_last_lag_;  // see
+                                                                // ExtractFrame().
+  SelectLag(opts, &num_states_, &lags_);
+  std::vector<double> lag_vec(num_states_);
+  for (int32 i = 0; i < num_states_; i++)
+    lag_vec[i] = lags_(i);
+  BaseFloat upsample_cutoff = opts.resample_freq * 0.5;
+  nccf_resampler_ = new ArbitraryResample(num_max_lag_ + 1, opts.resample_freq,
+                                          upsample_cutoff, lag_vec,
+                                          opts.upsample_filter_width);
+  obj_func_.Resize(num_states_);
+}
+
+OnlinePitchExtractor::~OnlinePitchExtractor() {
+  delete signal_resampler_;
+  delete nccf_resampler_;
+}
+
+void OnlinePitchExtractor::AcceptWaveform(const VectorBase<BaseFloat> &wave) {
+  if (input_finished_)
+    KALDI_ERR << "AcceptWaveform() called after InputFinished()";
+  if (wave.Dim() == 0) return;
+  int32 old_dim = input_.Dim();
+  input_.Resize(old_dim + wave.Dim(), kCopyData);
+  input_.Range(old_dim, wave.Dim()).CopyFromVec(wave);
+  num_input_samples_ += wave.Dim();
+  ResampleInput();
+  ComputeFrames();
+}
+
+void OnlinePitchExtractor::InputFinished() {
+  if (input_finished_) return;
+  input_finished_ = true;
+  ResampleInput();
+  ComputeFrames();
+  DecideFrames(frames_.size());
+}
+
+void OnlinePitchExtractor::GetFrames(Matrix<BaseFloat> *output) {
+  if (output_.empty()) {
+    output->Resize(0, 0);
+    return;
+  }
+  output->Resize(output_.size(), 2);
+  for (size_t i = 0; i < output_.size(); i++) {
+    (*output)(i, 0) = output_[i].first;
+    (*output)(i, 1) = output_[i].second;
+  }
+  output_.clear();
+}
+
+void OnlinePitchExtractor::ResampleInput() {
+  int32 num_samples_out = num_downsampled_samples_;
+  if (input_finished_) {
+    // The length of the downsampled signal, as in PreProcess().
+    double dt = opts_.samp_freq / opts_.resample_freq;
+    num_samples_out = 1 + static_cast<int>(num_input_samples_ / dt);
+  } else {
+    // Only compute the samples for which we have all the input.
+    while (signal_resampler_->LastInputIndex(num_samples_out) <
+           num_input_samples_)
+      num_samples_out++;
+  }
+  int32 num_new = num_samples_out - num_downsampled_samples_;
+  if (num_new <= 0) return;
+  int32 old_dim = downsampled_.Dim();
+  downsampled_.Resize(old_dim + num_new, kCopyData);
+  for (int32 i = 0; i < num_new; i++)
+    downsampled_(old_dim + i) = signal_resampler_->OutputSample(
+        input_, input_offset_, num_downsampled_samples_ + i);
+  num_downsampled_samples_ = num_samples_out;
+
+  // Discard the input that later downsampled samples do not depend on.
+  int32 first_needed =
+      signal_resampler_->FirstInputIndex(num_downsampled_samples_);
+  int32 num_discard = std::min(first_needed - input_offset_, input_.Dim());
+  if (num_discard > 0) {
+    DiscardSamples(num_discard, &input_);
+    input_offset_ += num_discard;
+  }
+}
+
+void OnlinePitchExtractor::ComputeFrames() {
+  int32 frame_shift = opts_.NccfWindowShift();
+  Vector<double> window;
+  while (true) {
+    if (input_finished_) {
+      if (num_frames_computed_ >=
+          PitchNumFrames(num_downsampled_samples_, opts_))
+        break;
+    } else if (downsampled_.Dim() < full_frame_length_) {
+      break;
+    }
+    // Update the sum of squares up to the end of this frame.
+    int32 frame_end = downsampled_offset_ +
+        std::min(full_frame_length_, downsampled_.Dim());
+    for (; sum_sq_count_ < frame_end; sum_sq_count_++) {
+      double x = downsampled_(sum_sq_count_ - downsampled_offset_);
+      sum_sq_ += x * x;
+    }
+    ExtractFrame(downsampled_, 0, opts_, &window);
+    double rms = pow(sum_sq_ / sum_sq_count_, 0.5);
+    if (rms != 0.0)
+      window.Scale(1.0 / rms);
+    ComputeFrame(window);
+    num_frames_computed_++;
+    int32 num_discard = std::min(frame_shift, downsampled_.Dim());
+    DiscardSamples(num_discard, &downsampled_);
+    downsampled_offset_ += num_discard;
+  }
+}
+
+void OnlinePitchExtractor::ComputeFrame(const Vector<double> &window) {
+  // Compute the NCCF for pitch extraction and for the POV, as in Compute().
+  Vector<double> inner_prod(num_lags_), norm_prod(num_lags_);
+  Nccf(window, nccf_first_lag_, nccf_last_lag_, opts_.NccfWindowSize(),
+       &inner_prod, &norm_prod);
+  double a_fact_pitch = pow(opts_.NccfWindowSize(), 4) * opts_.nccf_ballast,
+      a_fact_pov = pow(10, -9);
+  Matrix<double> nccf(2, num_max_lag_ + 1);  // rows are pitch, pov.
+  SubVector<double> nccf_pitch(nccf, 0), nccf_pov(nccf, 1);
+  ProcessNccf(inner_prod, norm_prod, a_fact_pitch,
+              nccf_first_lag_, nccf_last_lag_, &nccf_pitch);
+  ProcessNccf(inner_prod, norm_prod, a_fact_pov,
+              nccf_first_lag_, nccf_last_lag_, &nccf_pov);
+  Matrix<double> resampled_nccf(2, num_states_);
+  nccf_resampler_->Upsample(nccf, &resampled_nccf);
+
+  // The local cost, as in PitchExtractor::ComputeLocalCost().
+  SubVector<double> correl(resampled_nccf, 0);
+  Vector<double> local_cost(num_states_);
+  local_cost.Add(1.0);
+  local_cost.AddVec(-1.0, correl);
+  Vector<double> corr_lag_cost(num_states_);
+  corr_lag_cost.AddVecVec(opts_.soft_min_f0, correl, lags_, 0);
+  local_cost.AddVec(1.0, corr_lag_cost);
+
+  frames_.push_back(PitchFrame());
+  PitchFrame &frame = frames_.back();
+  frame.pov_nccf = resampled_nccf.Row(1);
+  std::vector<int32> &back_pointers = frame.back_pointers;
+  back_pointers.resize(num_states_);
+
+  // One step of PitchExtractor::FastViterbi().
+  Vector<double> obj_func(num_states_);
+  BaseFloat delta_pitch_sq = log(1 + opts_.delta_pitch)
+      * log(1 + opts_.delta_pitch);
+  double intercost, min_c, this_c;
+  int32 best_b, min_i, max_i;
+  // Forward Pass
+  for (int32 i = 0; i < num_states_; i++) {
+    min_i = (i == 0 ? 0 : back_pointers[i-1]);
+    min_c = std::numeric_limits<double>::infinity();
+    best_b = -1;
+    for (int32 k = min_i; k <= i; k++) {
+      intercost = (i-k) * (i-k) * delta_pitch_sq;
+      this_c = obj_func_(k) + opts_.penalty_factor * intercost;
+      if (this_c < min_c) {
+        min_c = this_c;
+        best_b = k;
+      }
+    }
+    back_pointers[i] = best_b;
+    obj_func(i) = min_c + local_cost(i);
+  }
+  // Backward Pass
+  for (int32 i = num_states_-1; i >= 0; i--) {
+    max_i = (i == num_states_-1 ? num_states_-1 : back_pointers[i+1]);
+    min_c = obj_func(i) - local_cost(i);
+    best_b = back_pointers[i];
+    for (int32 k = i+1 ; k <= max_i; k++) {
+      intercost = (i-k) * (i-k) * delta_pitch_sq;
+      this_c = obj_func_(k) + opts_.penalty_factor * intercost;
+      if (this_c < min_c) {
+        min_c = this_c;
+        best_b = k;
+      }
+    }
+    back_pointers[i] = best_b;
+    obj_func(i) = min_c + local_cost(i);
+  }
+  obj_func_.Swap(&obj_func);
+
+  if (max_latency_ >= 0 &&
+      static_cast<int32>(frames_.size()) > max_latency_)
+    DecideFrames(1);
+}
+
+void OnlinePitchExtractor::DecideFrames(int32 num_frames) {
+  KALDI_ASSERT(num_frames <= static_cast<int32>(frames_.size()));
+  if (num_frames == 0) return;
+  int32 num_undecided = frames_.size();
+  std::vector<int32> best_states(num_undecided);
+  MatrixIndexT best;
+  obj_func_.Min(&best);
+  for (int32 t = num_undecided - 1; t >= 0; t--) {
+    best_states[t] = best;
+    best = frames_[t].back_pointers[best];
+  }
+  for (int32 t = 0; t < num_frames; t++) {
+    int32 state = best_states[t];
+    output_.push_back(std::make_pair(
+        static_cast<BaseFloat>(frames_.front().pov_nccf(state)),
+        static_cast<BaseFloat>(1.0 / lags_(state))));
+    frames_.pop_front();
+  }
+}
+
+
 void ExtractDeltaPitch(const PostProcessPitchOptions &opts,
                        const Vector<BaseFloat> &input,
                        Vector<BaseFloat> *output) {
@@ -22,7 +22,9 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <deque>
 #include <string>
+#include <utility>
 #include <vector>
 
 
@@ -166,6 +168,93 @@ struct PostProcessPitchOptions {
                 "If true, the warped NCCF is added to output features");
   }
 };
+
+class LinearResample;
+class ArbitraryResample;
+
+/// OnlinePitchExtractor computes the same (pov, pitch) features as the
+/// function Compute() in pitch-functions.cc, but incrementally, so it can be
+/// used in online decoding without buffering the whole utterance.  The
+/// resampling and the NCCF are computed as the samples arrive, and so is the
+/// forward pass of the Viterbi; frame t is then decided by tracing back from
+/// the best state on frame t + max_latency.  This bounds both the latency and
+/// the memory used per stream.  The differences from Compute() are that the
+/// decision for each frame only uses max_latency frames of lookahead, and that
+/// instead of normalizing the whole signal by its RMS value we use the RMS
+/// value of the signal up to the end of the current frame.  The output does
+/// not depend on how the waveform is divided up between calls to
+/// AcceptWaveform().
+class OnlinePitchExtractor {
+ public:
+  /// If max_latency < 0, no frames are output until InputFinished() is
+  /// called, and the traceback is over the whole utterance, as in Compute().
+  OnlinePitchExtractor(const PitchExtractionOptions &opts,
+                       int32 max_latency);
+
+  ~OnlinePitchExtractor();
+
+  int32 Dim() const { return 2; }
+
+  /// Accepts more waveform data, sampled at opts.samp_freq.
+  void AcceptWaveform(const VectorBase<BaseFloat> &wave);
+
+  /// Tells the class that there will be no more data; the remaining frames
+  /// are then decided and can be obtained from GetFrames().
+  void InputFinished();
+
+  /// Outputs one row of (pov, pitch) for each frame that has been decided
+  /// since the last call; "output" may have zero rows.
+  void GetFrames(Matrix<BaseFloat> *output);
+
+ private:
+  // Computes the downsampled signal as far as we can.
+  void ResampleInput();
+  // Computes the NCCF and the forward pass of the Viterbi for as many frames
+  // as we can.
+  void ComputeFrames();
+  // Does the NCCF and the forward Viterbi for a single frame.
+  void ComputeFrame(const Vector<double> &window);
+  // Traces back from the best state on the latest frame, and outputs the
+  // first "num_frames" frames that have not yet been decided.
+  void DecideFrames(int32 num_frames);
+
+  PitchExtractionOptions opts_;
+  int32 max_latency_;
+  LinearResample *signal_resampler_;
+  ArbitraryResample *nccf_resampler_;
+  Vector<double> lags_;  // the lags corresponding to the Viterbi states.
+  int32 num_states_;
+  int32 nccf_first_lag_;  // the range of lags over which we compute the NCCF
+  int32 nccf_last_lag_;   // is [nccf_first_lag_, nccf_last_lag_).
+  int32 num_lags_;
+  int32 num_max_lag_;
+  int32 full_frame_length_;  // the frame length plus the maximum lag.
+
+  Vector<double> input_; // the input samples that are still needed.
+  int32 input_offset_;  // the index of the first sample in input_.
+  int32 num_input_samples_;  // total number of input samples seen.
+  Vector<double> downsampled_;  // the downsampled signal, starting from the
+                                // first sample of the next frame to compute.
+  int32 downsampled_offset_;  // the index of the first sample in downsampled_.
+  int32 num_downsampled_samples_;  // total number of downsampled samples.
+  double sum_sq_;  // the sum of squares of the downsampled signal up to
+                   // sample sum_sq_count_, for the RMS normalization.
+  int32 sum_sq_count_;
+  bool input_finished_;
+  int32 num_frames_computed_;
+
+  Vector<double> obj_func_;  // Viterbi objective function on the latest frame.
+  struct PitchFrame {
+    std::vector<int32> back_pointers;
+    Vector<double> pov_nccf;  // the NCCF from which we compute the POV.
+  };
+  // The frames that have been computed but not decided yet.
+  std::deque<PitchFrame> frames_;
+  // (pov, pitch) of the frames that have been decided but not output yet.
+  std::vector<std::pair<BaseFloat, BaseFloat> > output_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlinePitchExtractor);
+};
+
 /// @} End of "addtogroup feat"
 }  // namespace kaldi
 #endif  // KALDI_FEAT_PITCH_FUNCTIONS_H_
@@ -0,0 +1,90 @@
+// feat/wave-reader-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unistd.h>
+#include <fstream>
+
+#include "feat/wave-reader.h"
+
+namespace kaldi {
+
+// Checks that MappedWaveData gives the same samples as WaveData::Read().
+void UnitTestMappedWaveData() {
+  const char *filename = "tmp-wave-reader-test.wav";
+  for (int32 i = 0; i < 10; i++) {
+    int32 num_chan = 1 + rand() % 3, num_samp = 1 + rand() % 5000;
+    Matrix<BaseFloat> data(num_chan, num_samp);
+    for (int32 c = 0; c < num_chan; c++)
+      for (int32 t = 0; t < num_samp; t++)
+        data(c, t) = RandInt(-32768, 32767);
+    WaveData wave(16000.0, data);
+    {
+      std::ofstream os(filename, std::ios::binary);
+      wave.Write(os);
+    }
+    WaveData wave2;
+    {
+      std::ifstream is(filename, std::ios::binary);
+      wave2.Read(is);
+    }
+    KALDI_ASSERT(wave2.Data().ApproxEqual(data, 0.0));
+
+    MappedWaveData mapped;
+    KALDI_ASSERT(mapped.Open(filename));
+    KALDI_ASSERT(mapped.SampFreq() == 16000.0 &&
+                 mapped.NumChannels() == num_chan &&
+                 mapped.NumSamples() == num_samp);
+    const int16 *int16_data = mapped.Int16Data();
+    KALDI_ASSERT(int16_data != NULL);  // we wrote 16-bit native-order data.
+    for (int32 j = 0; j < 10; j++) {
+      int32 c = rand() % num_chan, offset = rand() % num_samp,
+          dim = rand() % (num_samp - offset + 1);
+      Vector<BaseFloat> samples(dim);
+      mapped.GetSamples(c, offset, &samples);
+      for (int32 t = 0; t < dim; t++) {
+        KALDI_ASSERT(samples(t) == data(c, offset + t));
+        KALDI_ASSERT(int16_data[(offset + t) * num_chan + c] ==
+                     data(c, offset + t));
+      }
+    }
+  }
+  {  // A file that is not a WAV file, and one that is truncated.
+    std::ofstream os(filename, std::ios::binary);
+    os << "not a wave file";
+  }
+  MappedWaveData mapped;
+  KALDI_ASSERT(!mapped.Open(filename));
+  Matrix<BaseFloat> data(1, 100);
+  WaveData wave(8000.0, data);
+  std::ostringstream os;
+  wave.Write(os);
+  {
+    std::ofstream fos(filename, std::ios::binary);
+    fos << os.str().substr(0, os.str().size() - 10);
+  }
+  KALDI_ASSERT(!mapped.Open(filename));
+  unlink(filename);
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::UnitTestMappedWaveData();
+  std::cout << "Test OK.\n";
+}
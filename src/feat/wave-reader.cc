@@ -40,6 +40,7 @@ void WaveData::Expect4ByteTag(std::istream &is, const char *expected) {
     KALDI_ERR << "WaveData: expected " << expected << ", got " << tmp;
 }
 
+// static
 uint32 WaveData::ReadUint32(std::istream &is, bool swap) {
   union {
     char result[4];
@@ -53,7 +54,7 @@ uint32 WaveData::ReadUint32(std::istream &is, bool swap) {
   return u.ans;
 }
 
-
+// static
 uint16 WaveData::ReadUint16(std::istream &is, bool swap) {
   union {
     char result[2];
@@ -105,9 +106,7 @@ void WaveData::WriteUint16(std::ostream &os, int16 i) {
 
 
 
-void WaveData::Read(std::istream &is) {
-  data_.Resize(0, 0);  // clear the data.
-
+void WaveData::ReadHeader(std::istream &is, WaveHeader *header) {
   char tmp[5];
   tmp[4] = '\0';
   Read4ByteTag(is, &tmp[0]);
@@ -150,7 +149,6 @@ void WaveData::Read(std::istream &is) {
 
   if (num_channels <= 0)
     KALDI_ERR << "WaveData: no channels present";
-  samp_freq_ = static_cast<BaseFloat>(sample_rate);
   if (bits_per_sample != 8 && bits_per_sample != 16 && bits_per_sample != 32)
     KALDI_ERR << "WaveData: bits_per_sample is " << bits_per_sample;
   if (byte_rate != sample_rate * bits_per_sample/8 * num_channels)
@@ -193,53 +191,45 @@ void WaveData::Read(std::istream &is) {
 
   uint32 data_chunk_size = ReadUint32(is, swap);
   riff_chunk_read += 4;
-  std::vector<char> chunk_data_vec(data_chunk_size);
-  char *data_ptr = &(chunk_data_vec[0]);
-  is.read(data_ptr, data_chunk_size);
   riff_chunk_read += data_chunk_size;
 
   if (riff_chunk_read != riff_chunk_size)
     KALDI_WARN << "Expected " << riff_chunk_size << " bytes in RIFF chunk, but got "
                << riff_chunk_read << " (do not support reading multiple data chunks).";
-  if (is.fail())
-    KALDI_ERR << "WaveData: failed to read data chunk.";
-
   if (data_chunk_size % block_align != 0)
     KALDI_ERR << "WaveData: data chunk size has unexpected length "
               << data_chunk_size << "; block-align = " << block_align;
   if (data_chunk_size == 0)
     KALDI_ERR << "WaveData: empty file (no data)";
 
-  uint32 num_samp = data_chunk_size / block_align;
+  header->samp_freq = static_cast<BaseFloat>(sample_rate);
+  header->num_channels = num_channels;
+  header->bits_per_sample = bits_per_sample;
+  header->block_align = block_align;
+  header->swap = swap;
+  header->data_size = data_chunk_size;
+}
+
+void WaveData::Read(std::istream &is) {
+  data_.Resize(0, 0);  // clear the data.
+
+  WaveHeader header;
+  ReadHeader(is, &header);
+  samp_freq_ = header.samp_freq;
+
+  std::vector<char> chunk_data_vec(header.data_size);
+  const char *data_ptr = &(chunk_data_vec[0]);
+  is.read(&(chunk_data_vec[0]), header.data_size);
+  if (is.fail())
+    KALDI_ERR << "WaveData: failed to read data chunk.";
+
+  int32 num_samp = header.NumSamples(), num_channels = header.num_channels,
+      bytes_per_sample = header.bits_per_sample / 8;
   data_.Resize(num_channels, num_samp);
-  for (uint32 i = 0; i < num_samp; i++) {
-    for (uint32 j = 0; j < num_channels; j++) {
-      switch (bits_per_sample) {
-        case 8:
-          data_(j, i) = *data_ptr;
-          data_ptr++;
-          break;
-        case 16:
-          {
-            int16 k = *reinterpret_cast<uint16*>(data_ptr);
-            if (swap)
-              KALDI_SWAP2(k);
-            data_(j, i) =  k;
-            data_ptr += 2;
-            break;
-          }
-        case 32:
-          {
-            int32 k = *reinterpret_cast<uint32*>(data_ptr);
-            if (swap)
-              KALDI_SWAP4(k);
-            data_(j, i) =  k;
-            data_ptr += 4;
-            break;
-          }
-        default:
-          KALDI_ERR << "bits per sample is " << bits_per_sample;  // already checked this.
-      }
+  for (int32 i = 0; i < num_samp; i++) {
+    for (int32 j = 0; j < num_channels; j++) {
+      data_(j, i) = ConvertSample(data_ptr, header);
+      data_ptr += bytes_per_sample;
     }
   }
 }
@@ -297,4 +287,56 @@ void WaveData::Write(std::ostream &os) const {
 }
 
 
+bool MappedWaveData::Open(const std::string &filename) {
+  if (!file_.Open(filename))
+    return false;
+  MemoryStreambuf buf(file_.Data(), file_.Size());
+  std::istream is(&buf);
+  try {
+    WaveData::ReadHeader(is, &header_);
+  } catch(const std::exception &e) {
+    KALDI_WARN << "Error reading header of WAV file " << filename;
+    file_.Close();
+    return false;
+  }
+  data_offset_ = static_cast<size_t>(is.tellg());
+  if (data_offset_ + header_.data_size > file_.Size()) {
+    KALDI_WARN << "WAV file " << filename << " is truncated: expected "
+               << header_.data_size << " bytes of data, got "
+               << (file_.Size() - data_offset_);
+    file_.Close();
+    return false;
+  }
+  return true;
+}
+
+const int16 *MappedWaveData::Int16Data() const {
+  KALDI_ASSERT(IsOpen());
+  // The mapping is page-aligned, so the data is aligned if its offset is even.
+  if (header_.bits_per_sample != 16 || header_.swap || data_offset_ % 2 != 0)
+    return NULL;
+  return reinterpret_cast<const int16*>(file_.Data() + data_offset_);
+}
+
+void MappedWaveData::GetSamples(int32 channel, int32 offset,
+                                VectorBase<BaseFloat> *dest) const {
+  KALDI_ASSERT(IsOpen() && channel >= 0 && channel < NumChannels() &&
+               offset >= 0 && offset + dest->Dim() <= NumSamples());
+  int32 dim = dest->Dim(), stride = NumChannels();
+  BaseFloat *out = dest->Data();
+  const int16 *int16_data = Int16Data();
+  if (int16_data != NULL) {
+    const int16 *in = int16_data + static_cast<size_t>(offset) * stride +
+        channel;
+    for (int32 i = 0; i < dim; i++)
+      out[i] = in[static_cast<size_t>(i) * stride];
+  } else {
+    const char *in = file_.Data() + data_offset_ +
+        static_cast<size_t>(offset) * header_.block_align +
+        channel * (header_.bits_per_sample / 8);
+    for (int32 i = 0; i < dim; i++, in += header_.block_align)
+      out[i] = WaveData::ConvertSample(in, header_);
+  }
+}
+
 }  // end namespace kaldi
@@ -46,12 +46,26 @@
 #include <cstring>
 
 #include "base/kaldi-types.h"
+#include "base/kaldi-utils.h"
 #include "matrix/kaldi-vector.h"
 #include "matrix/kaldi-matrix.h"
+#include "util/kaldi-mmap.h"
 
 
 namespace kaldi {
 
+/// The information in the header of a WAV file; see WaveData::ReadHeader().
+struct WaveHeader {
+  BaseFloat samp_freq;
+  int32 num_channels;
+  int32 bits_per_sample;
+  int32 block_align;  // bytes per sample times num_channels.
+  bool swap;  // true if the byte order of the samples is not the machine's.
+  uint32 data_size;  // size in bytes of the sample data.
+
+  int32 NumSamples() const { return data_size / block_align; }
+};
+
 /// This class's purpose is to read in Wave files.
 class WaveData {
  public:
@@ -66,6 +80,34 @@ class WaveData {
   /// "is" should be opened in binary mode.
   void Read(std::istream &is);
 
+  /// Reads the header of a WAV file and leaves "is" at the start of the sample
+  /// data; throws on error.  Read() and MappedWaveData use this.
+  static void ReadHeader(std::istream &is, WaveHeader *header);
+
+  /// Converts the sample at "data" (in the format described by "header") to
+  /// floating point.
+  static inline BaseFloat ConvertSample(const char *data,
+                                        const WaveHeader &header) {
+    switch (header.bits_per_sample) {
+      case 8:
+        return *data;
+      case 16: {
+        int16 k;
+        memcpy(&k, data, 2);
+        if (header.swap)
+          KALDI_SWAP2(k);
+        return k;
+      }
+      default: {  // 32; ReadHeader() checked this.
+        int32 k;
+        memcpy(&k, data, 4);
+        if (header.swap)
+          KALDI_SWAP4(k);
+        return k;
+      }
+    }
+  }
+
   /// Write() will throw on error.   os should be opened in binary mode.
   void Write(std::ostream &os) const;
 
@@ -93,8 +135,8 @@ class WaveData {
   Matrix<BaseFloat> data_;
   BaseFloat samp_freq_;
   static void Expect4ByteTag(std::istream &is, const char *expected);
-  uint32 ReadUint32(std::istream &is, bool swap);
-  uint16 ReadUint16(std::istream &is, bool swap);
+  static uint32 ReadUint32(std::istream &is, bool swap);
+  static uint16 ReadUint16(std::istream &is, bool swap);
   static void Read4ByteTag(std::istream &is, char *dest);
 
   static void WriteUint32(std::ostream &os, int32 i);
@@ -106,6 +148,49 @@ class WaveData {
 
 // Holder class for .wav files that enables us to read (but not write)
 // .wav files. c.f. util/kaldi-holder.h
+/// MappedWaveData gives access to a WAV file without reading all of it into
+/// memory, which matters for long recordings (e.g. when extract-segments cuts
+/// many short segments out of hour-long files).  The file is memory-mapped;
+/// 16-bit data in the machine's byte order can be accessed in place, and
+/// samples are converted to floating point only for the ranges requested.
+class MappedWaveData {
+ public:
+  MappedWaveData() { }
+
+  /// Maps the file and reads its header.  Returns false, with a warning, if
+  /// the file cannot be mapped (e.g. it is not a regular file) or is not a
+  /// valid WAV file.
+  bool Open(const std::string &filename);
+
+  void Close() { file_.Close(); }
+
+  bool IsOpen() const { return file_.IsOpen(); }
+
+  BaseFloat SampFreq() const { return header_.samp_freq; }
+
+  int32 NumChannels() const { return header_.num_channels; }
+
+  /// Returns the number of samples per channel.
+  int32 NumSamples() const { return header_.NumSamples(); }
+
+  /// If the file has 16-bit samples in the machine's byte order, returns a
+  /// pointer to them in the mapped memory; sample i of channel c is at
+  /// [i * NumChannels() + c].  Otherwise returns NULL.
+  const int16 *Int16Data() const;
+
+  /// Sets "dest" to samples offset, offset + 1, ... of channel "channel"; the
+  /// range must be within the file.
+  void GetSamples(int32 channel, int32 offset,
+                  VectorBase<BaseFloat> *dest) const;
+
+ private:
+  MappedFile file_;
+  WaveHeader header_;
+  size_t data_offset_;  // offset of the sample data in the file.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MappedWaveData);
+};
+
+
 class WaveHolder {
  public:
   typedef WaveData T;
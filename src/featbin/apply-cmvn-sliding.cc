@@ -39,7 +39,17 @@ int main(int argc, char *argv[]) {
     
     ParseOptions po(usage);
     SlidingWindowCmnOptions opts;
+    std::string global_stats_rxfilename;
+    int32 global_frames = 200;
     opts.Register(&po);
+    po.Register("global-stats", &global_stats_rxfilename, "Filename of global "
+                "CMVN stats (as from compute-cmvn-stats), used as a prior "
+                "while the window is short (e.g. at the start of the "
+                "utterance)");
+    po.Register("global-frames", &global_frames, "While the window has "
+                "fewer than this many frames, make its stats up to this many "
+                "frames using the global stats (only if --global-stats is "
+                "set)");
 
     po.Read(argc, argv);
 
@@ -53,12 +63,17 @@ int main(int argc, char *argv[]) {
     std::string feat_rspecifier = po.GetArg(1);
     std::string feat_wspecifier = po.GetArg(2);
 
+    Matrix<double> global_stats;
+    if (global_stats_rxfilename != "")
+      ReadKaldiObject(global_stats_rxfilename, &global_stats);
+
     SequentialBaseFloatMatrixReader feat_reader(feat_rspecifier);
     BaseFloatMatrixWriter feat_writer(feat_wspecifier);
     
     for (;!feat_reader.Done(); feat_reader.Next()) {
       std::string utt = feat_reader.Key();
-      Matrix<BaseFloat> feat(feat_reader.Value());
+      Matrix<BaseFloat> feat;
+      feat.Swap(&feat_reader.Value());
       if (feat.NumRows() == 0) {
         KALDI_WARN << "Empty feature matrix for utterance " << utt;
         num_err++;
@@ -67,7 +82,9 @@ int main(int argc, char *argv[]) {
       Matrix<BaseFloat> cmvn_feat(feat.NumRows(),
                                   feat.NumCols(), kUndefined);
 
-      SlidingWindowCmn(opts, feat, &cmvn_feat);
+      SlidingWindowCmn(opts, feat, &cmvn_feat,
+                       global_stats.NumRows() != 0 ? &global_stats : NULL,
+                       global_frames);
       
       feat_writer.Write(utt, cmvn_feat);
       num_done++;
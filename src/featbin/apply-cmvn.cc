@@ -73,7 +73,8 @@ int main(int argc, char *argv[]) {
       
       for (; !feat_reader.Done(); feat_reader.Next()) {
         std::string utt = feat_reader.Key();
-        Matrix<BaseFloat> feat(feat_reader.Value());
+        Matrix<BaseFloat> feat;
+        feat.Swap(&feat_reader.Value());
         if (norm_means) {
           if (!cmvn_reader.HasKey(utt)) {
             KALDI_WARN << "No normalization statistics available for key "
@@ -103,7 +104,8 @@ int main(int argc, char *argv[]) {
       
       for (;!feat_reader.Done(); feat_reader.Next()) {
         std::string utt = feat_reader.Key();
-        Matrix<BaseFloat> feat(feat_reader.Value());
+        Matrix<BaseFloat> feat;
+        feat.Swap(&feat_reader.Value());
         if (norm_means)
           ApplyCmvn(cmvn_stats, norm_vars, &feat);
         feat_writer.Write(utt, feat);
@@ -20,6 +20,63 @@
 #include "util/common-utils.h"
 #include "feat/pitch-functions.cc"
 #include "feat/wave-reader.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+// This class computes the pitch for one utterance in its operator (), and
+// writes it out in its destructor.  It is used with class TaskSequencer (see
+// ../thread/kaldi-task-sequence.h) so that we can process several utterances
+// in parallel and still write them in the original order.
+class PitchComputeClass {
+ public:
+  PitchComputeClass(const PitchExtractionOptions &opts,
+                    const std::string &utt,
+                    const VectorBase<BaseFloat> &waveform,
+                    BaseFloatMatrixWriter *feat_writer,
+                    int32 *num_done,
+                    int32 *num_err):
+      opts_(opts), utt_(utt), waveform_(waveform), feat_writer_(feat_writer),
+      num_done_(num_done), num_err_(num_err), computed_(false) { }
+
+  void operator () () {
+    try {
+      Compute(opts_, waveform_, &features_);
+      computed_ = true;
+    } catch (...) { }
+  }
+
+  ~PitchComputeClass() {
+    if (!computed_) {
+      KALDI_WARN << "Failed to compute pitch for utterance "
+                 << utt_;
+      (*num_err_)++;
+      return;
+    }
+    double tot = features_.Sum();
+    if (features_.NumCols() != 2 || KALDI_ISINF(tot) || KALDI_ISNAN(tot)) {
+      KALDI_WARN << "Pitch extraction failed for utterance " << utt_
+                 << ", num-rows is " << features_.NumRows() << ", total is "
+                 << tot;
+    }
+
+    feat_writer_->Write(utt_, features_);
+    if (*num_done_ % 50 == 0 && *num_done_ != 0)
+      KALDI_VLOG(2) << "Processed " << *num_done_ << " utterances";
+    (*num_done_)++;
+  }
+ private:
+  const PitchExtractionOptions &opts_;
+  std::string utt_;
+  Vector<BaseFloat> waveform_;
+  BaseFloatMatrixWriter *feat_writer_;
+  int32 *num_done_;
+  int32 *num_err_;
+  bool computed_;
+  Matrix<BaseFloat> features_;
+};
+
+}  // namespace kaldi
 
 
 int main(int argc, char *argv[]) {
@@ -37,12 +94,14 @@ int main(int argc, char *argv[]) {
     
     ParseOptions po(usage);
     PitchExtractionOptions pitch_opts;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
     int32 channel = -1; // Note: this isn't configurable because it's not a very
                         // good idea to control it this way: better to extract the
                         // on the command line (in the .scp file) using sox or
                         // similar.
 
     pitch_opts.Register(&po);
+    sequencer_config.Register(&po);
     
     po.Read(argc, argv);
 
@@ -58,6 +117,7 @@ int main(int argc, char *argv[]) {
     BaseFloatMatrixWriter feat_writer(feat_wspecifier);
 
     int32 num_done = 0, num_err = 0;
+    TaskSequencer<PitchComputeClass> sequencer(sequencer_config);
     for (; !wav_reader.Done(); wav_reader.Next()) {
       std::string utt = wav_reader.Key();  
       const WaveData &wave_data = wav_reader.Value(); 
@@ -89,27 +149,12 @@ int main(int argc, char *argv[]) {
       
       
       SubVector<BaseFloat> waveform(wave_data.Data(), this_chan);
-      Matrix<BaseFloat> features;
-      try {
-        Compute(pitch_opts, waveform, &features);
-      } catch (...) {
-        KALDI_WARN << "Failed to compute pitch for utterance "
-                   << utt;
-        continue;
-      }
-
-      double tot = features.Sum();
-      if (features.NumCols() != 2 || KALDI_ISINF(tot) || KALDI_ISNAN(tot)) {
-        KALDI_WARN << "Pitch extraction failed for utterance " << utt
-                   << ", num-rows is " << features.NumRows() << ", total is "
-                   << tot;
-      }
-      
-      feat_writer.Write(utt, features);
-      if (num_done % 50 == 0 && num_done != 0)
-        KALDI_VLOG(2) << "Processed " << num_done << " utterances";
-      num_done++;
+      // "sequencer" takes ownership of the task and deletes it (which writes
+      // the features) once it and all the tasks before it have finished.
+      sequencer.Run(new PitchComputeClass(pitch_opts, utt, waveform,
+                                          &feat_writer, &num_done, &num_err));
     }
+    sequencer.Wait();  // wait for the remaining tasks to finish.
     KALDI_LOG << "Done " << num_done << " utterances, " << num_err
               << " with errors.";
     return (num_done != 0 ? 0 : 1);
@@ -22,6 +22,90 @@
 #include "util/common-utils.h"
 #include "feat/feature-mfcc.h"
 #include "feat/wave-reader.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+// This class computes the features for one utterance in its operator (), and
+// writes them out in its destructor.  It is used with class TaskSequencer (see
+// ../thread/kaldi-task-sequence.h) so that we can compute the features of
+// several utterances in parallel and still write them in the original order.
+class MfccComputeClass {
+ public:
+  MfccComputeClass(const MfccOptions &opts,
+                   const std::string &utt,
+                   const VectorBase<BaseFloat> &waveform,
+                   BaseFloat vtln_warp,
+                   bool subtract_mean,
+                   BaseFloatMatrixWriter *kaldi_writer,
+                   TableWriter<HtkMatrixHolder> *htk_writer,
+                   int32 *num_success,
+                   int32 utt_index):
+      opts_(opts), utt_(utt), waveform_(waveform), vtln_warp_(vtln_warp),
+      subtract_mean_(subtract_mean), kaldi_writer_(kaldi_writer),
+      htk_writer_(htk_writer), num_success_(num_success),
+      utt_index_(utt_index), computed_(false) { }
+
+  void operator () () {
+    // Mfcc caches things and is not thread-safe, so each utterance gets
+    // its own; it is cheap to initialize compared with the computation.
+    Mfcc mfcc(opts_);
+    // The dithering noise depends only on the utterance's position in the
+    // input, so the output does not depend on the number of threads.
+    mfcc.SetDitherSeed(0, utt_index_);
+    try {
+      mfcc.Compute(waveform_, vtln_warp_, &features_, NULL);
+      computed_ = true;
+    } catch (...) { }
+  }
+
+  ~MfccComputeClass() {
+    if (!computed_) {
+      KALDI_WARN << "Failed to compute features for utterance "
+                 << utt_;
+      return;
+    }
+    if (subtract_mean_) {
+      Vector<BaseFloat> mean(features_.NumCols());
+      mean.AddRowSumMat(1.0, features_);
+      mean.Scale(1.0 / features_.NumRows());
+      for (int32 i = 0; i < features_.NumRows(); i++)
+        features_.Row(i).AddVec(-1.0, mean);
+    }
+    if (kaldi_writer_ != NULL) {
+      kaldi_writer_->Write(utt_, features_);
+    } else {
+      std::pair<Matrix<BaseFloat>, HtkHeader> p;
+      p.first.Resize(features_.NumRows(), features_.NumCols());
+      p.first.CopyFromMat(features_);
+      HtkHeader header = {
+        features_.NumRows(),
+        100000,  // 10ms shift
+        static_cast<int16>(sizeof(float)*(features_.NumCols())),
+        static_cast<uint16>( 006 | // MFCC
+        (opts_.use_energy ? 0100 : 020000)) // energy; otherwise c0
+      };
+      p.second = header;
+      htk_writer_->Write(utt_, p);
+    }
+    KALDI_VLOG(2) << "Processed features for key " << utt_;
+    (*num_success_)++;
+  }
+ private:
+  const MfccOptions &opts_;
+  std::string utt_;
+  Vector<BaseFloat> waveform_;
+  BaseFloat vtln_warp_;
+  bool subtract_mean_;
+  BaseFloatMatrixWriter *kaldi_writer_;
+  TableWriter<HtkMatrixHolder> *htk_writer_;
+  int32 *num_success_;
+  int32 utt_index_;
+  bool computed_;
+  Matrix<BaseFloat> features_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -33,6 +117,7 @@ int main(int argc, char *argv[]) {
     // construct all the global objects
     ParseOptions po(usage);
     MfccOptions mfcc_opts;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
     bool subtract_mean = false;
     BaseFloat vtln_warp = 1.0;
     std::string vtln_map_rspecifier;
@@ -61,6 +146,8 @@ int main(int argc, char *argv[]) {
     po.Register("min-duration", &min_duration, "Minimum duration of segments "
                 "to process (in seconds).");
 
+    sequencer_config.Register(&po);
+
     po.Read(argc, argv);
 
     if (po.NumArgs() != 2) {
@@ -72,8 +159,6 @@ int main(int argc, char *argv[]) {
 
     std::string output_wspecifier = po.GetArg(2);
 
-    Mfcc mfcc(mfcc_opts);
-
     SequentialTableReader<WaveHolder> reader(wav_rspecifier);
     BaseFloatMatrixWriter kaldi_writer;  // typedef to TableWriter<something>.
     TableWriter<HtkMatrixHolder> htk_writer;
@@ -97,6 +182,7 @@ int main(int argc, char *argv[]) {
     }
 
     int32 num_utts = 0, num_success = 0;
+    TaskSequencer<MfccComputeClass> sequencer(sequencer_config);
     for (; !reader.Done(); reader.Next()) {
       num_utts++;
       std::string utt = reader.Key();
@@ -142,42 +228,18 @@ int main(int argc, char *argv[]) {
                   << "option).  Utterance is " << utt;
 
       SubVector<BaseFloat> waveform(wave_data.Data(), this_chan);
-      Matrix<BaseFloat> features;
-      try {
-        mfcc.Compute(waveform, vtln_warp_local, &features, NULL);
-      } catch (...) {
-        KALDI_WARN << "Failed to compute features for utterance "
-                   << utt;
-        continue;
-      }
-      if (subtract_mean) {
-        Vector<BaseFloat> mean(features.NumCols());
-        mean.AddRowSumMat(1.0, features);
-        mean.Scale(1.0 / features.NumRows());
-        for (int32 i = 0; i < features.NumRows(); i++)
-          features.Row(i).AddVec(-1.0, mean);
-      }
-      if (output_format == "kaldi") {
-        kaldi_writer.Write(utt, features);
-      } else {
-        std::pair<Matrix<BaseFloat>, HtkHeader> p;
-        p.first.Resize(features.NumRows(), features.NumCols());
-        p.first.CopyFromMat(features);
-        HtkHeader header = {
-          features.NumRows(),
-          100000,  // 10ms shift
-          static_cast<int16>(sizeof(float)*(features.NumCols())),
-          static_cast<uint16>( 006 | // MFCC
-          (mfcc_opts.use_energy ? 0100 : 020000)) // energy; otherwise c0
-        };
-        p.second = header;
-        htk_writer.Write(utt, p);
-      }
+      // "sequencer" takes ownership of the task and deletes it (which writes
+      // the features) once it and all the tasks before it have finished.
+      MfccComputeClass *task = new MfccComputeClass(
+          mfcc_opts, utt, waveform, vtln_warp_local, subtract_mean,
+          (output_format == "kaldi" ? &kaldi_writer : NULL),
+          (output_format == "kaldi" ? NULL : &htk_writer), &num_success,
+          num_utts);
+      sequencer.Run(task);
       if (num_utts % 10 == 0)
         KALDI_LOG << "Processed " << num_utts << " utterances";
-      KALDI_VLOG(2) << "Processed features for key " << utt;
-      num_success++;
     }
+    sequencer.Wait();  // wait for the remaining tasks to finish.
     KALDI_LOG << " Done " << num_success << " out of " << num_utts
               << " utterances.";
     return (num_success != 0 ? 0 : 1);
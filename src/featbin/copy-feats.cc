@@ -40,6 +40,7 @@ int main(int argc, char *argv[]) {
     bool htk_in = false;
     bool sphinx_in = false;
     bool compress = false;
+    std::string compression_format = "column";
     po.Register("htk-in", &htk_in, "Read input as HTK features");
     po.Register("sphinx-in", &sphinx_in, "Read input as Sphinx features");
     po.Register("binary", &binary, "Binary-mode output (not relevant if writing "
@@ -47,6 +48,11 @@ int main(int argc, char *argv[]) {
     po.Register("compress", &compress, "If true, write output in compressed form"
                 "(only currently supported for wxfilename, i.e. archive/script,"
                 "output)");
+    po.Register("compression-format", &compression_format, "Format to use with "
+                "--compress=true: \"column\" for CompressedMatrix, or \"row\" "
+                "for RowCompressedMatrix, which allows ranges of rows to be "
+                "uncompressed on their own (see extract-rows "
+                "--row-compressed-input)");
     
     po.Read(argc, argv);
 
@@ -55,6 +61,9 @@ int main(int argc, char *argv[]) {
       exit(1);
     }
 
+    if (compression_format != "column" && compression_format != "row")
+      KALDI_ERR << "Invalid --compression-format option " << compression_format;
+
     int32 num_done = 0;
     
     if (ClassifyRspecifier(po.GetArg(1), NULL, NULL) != kNoRspecifier) {
@@ -77,6 +86,24 @@ int main(int argc, char *argv[]) {
           for (; !kaldi_reader.Done(); kaldi_reader.Next(), num_done++)
             kaldi_writer.Write(kaldi_reader.Key(), kaldi_reader.Value());
         }
+      } else if (compression_format == "row") {
+        RowCompressedMatrixWriter kaldi_writer(wspecifier);
+        if (htk_in) {
+          SequentialTableReader<HtkMatrixHolder> htk_reader(rspecifier);
+          for (; !htk_reader.Done(); htk_reader.Next(), num_done++)
+            kaldi_writer.Write(htk_reader.Key(),
+                               RowCompressedMatrix(htk_reader.Value().first));
+        } else if (sphinx_in) {
+          SequentialTableReader<SphinxMatrixHolder<> > sphinx_reader(rspecifier);
+          for (; !sphinx_reader.Done(); sphinx_reader.Next(), num_done++)
+            kaldi_writer.Write(sphinx_reader.Key(),
+                               RowCompressedMatrix(sphinx_reader.Value()));
+        } else {
+          SequentialBaseFloatMatrixReader kaldi_reader(rspecifier);
+          for (; !kaldi_reader.Done(); kaldi_reader.Next(), num_done++)
+            kaldi_writer.Write(kaldi_reader.Key(),
+                               RowCompressedMatrix(kaldi_reader.Value()));
+        }
       } else {
         CompressedMatrixWriter kaldi_writer(wspecifier);
         if (htk_in) {
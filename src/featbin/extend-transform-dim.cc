@@ -98,7 +98,8 @@ int main(int argc, char *argv[]) {
       int32 num_done = 0;
       for (; !reader.Done(); reader.Next()) {
         std::string key = reader.Key();
-        Matrix<BaseFloat> mat(reader.Value());
+        Matrix<BaseFloat> mat;
+        mat.Swap(&reader.Value());
         IncreaseTransformDimension(new_dimension, &mat);
         writer.Write(key, mat);
         num_done++;
@@ -39,6 +39,8 @@ int main(int argc, char *argv[]) {
         "\n"
         "Usage: extract-rows [options] <segments-file> <features-rspecifier> <features-wspecifier>\n"
         "  e.g. extract-rows --frame-shift=0.01 segments ark:feats-in.ark ark:feats-out.ark\n"
+        "If the features were written by copy-feats --compress=true --compression-format=row,\n"
+        "use --row-compressed-input=true so that only the requested rows are uncompressed.\n"
         "See also: select-feats, subset-feats, subsample-feats\n";
     
     ParseOptions po(usage);
@@ -48,6 +50,12 @@ int main(int argc, char *argv[]) {
     po.Register("frame-shift", &frame_shift,
     			"Frame shift in sec (e.g. 0.01), if segment files contains times "
                 "instead of frames");
+    bool row_compressed_input = false;
+    po.Register("row-compressed-input", &row_compressed_input,
+                "If true, read the features as RowCompressedMatrix (as written "
+                "by copy-feats --compress=true --compression-format=row) and "
+                "uncompress only the rows of each segment.  Other input would "
+                "be compressed, so it should not be used for that.");
 
     po.Read(argc, argv);
 
@@ -61,7 +69,11 @@ int main(int argc, char *argv[]) {
     string feat_wspecifier = po.GetArg(3);
 
     Input ki(segment_rspecifier);
-    RandomAccessBaseFloatMatrixReader reader(feat_rspecifier);
+    RandomAccessBaseFloatMatrixReader reader;
+    RandomAccessRowCompressedMatrixReader compressed_reader;
+    if (!(row_compressed_input ? compressed_reader.Open(feat_rspecifier) :
+          reader.Open(feat_rspecifier)))
+      KALDI_ERR << "Could not open features " << feat_rspecifier;
     BaseFloatMatrixWriter writer(feat_wspecifier);
 
     int32 num_lines = 0, num_missing = 0;
@@ -118,7 +130,22 @@ int main(int argc, char *argv[]) {
         continue;
       }
 
-      if (reader.HasKey(utt)) {
+      if (row_compressed_input && compressed_reader.HasKey(utt)) {
+        const RowCompressedMatrix &feats = compressed_reader.Value(utt);
+
+        if (feats.NumRows() < end)
+          end = feats.NumRows();
+        if (end <= start) {
+          KALDI_WARN << "Segment " << segment << " starts after the end of "
+                     << "utterance " << utt;
+          num_missing += 1;
+          continue;
+        }
+
+        Matrix<BaseFloat> to_write(end - start, feats.NumCols(), kUndefined);
+        feats.CopyRowsToMat(start, &to_write);
+        writer.Write(segment, to_write);
+      } else if (!row_compressed_input && reader.HasKey(utt)) {
         Matrix<BaseFloat> feats = reader.Value(utt);
 
         if (feats.NumRows() < end)
@@ -22,6 +22,7 @@
 #include "util/common-utils.h"
 #include "feat/feature-mfcc.h"
 #include "feat/wave-reader.h"
+#include <map>
 
 /*! @brief This is the main program for extracting segments from a wav file
  - usage : 
@@ -50,11 +51,17 @@ int main(int argc, char *argv[]) {
     ParseOptions po(usage);
     BaseFloat min_segment_length = 0.1, // Minimum segment length in seconds.
         max_overshoot = 0.5;  // max time by which last segment can overshoot
+    bool use_mmap = true;
     po.Register("min-segment-length", &min_segment_length,
                 "Minimum segment length in seconds (reject shorter segments)");
     po.Register("max-overshoot", &max_overshoot,
                 "End segmnents overshooting by less (in seconds) are truncated,"
                 " else rejected.");
+    po.Register("use-mmap", &use_mmap,
+                "If true and <wav-rspecifier> is a script file, recordings "
+                "that are plain files are memory-mapped and only the samples "
+                "in the segments are read, instead of reading whole "
+                "recordings into memory.");
 
     // OPTION PARSING ...
     // parse options  (+filling the registered variables)
@@ -72,6 +79,26 @@ int main(int argc, char *argv[]) {
     TableWriter<WaveHolder> writer(wav_wspecifier);
     Input ki(segments_rxfilename);  // no binary argment: never binary.
 
+    // For the recordings that can be memory-mapped, the filenames; the others
+    // are read with "reader".  Segments files are normally sorted by
+    // recording, so we keep just one recording mapped at a time.
+    std::map<std::string, std::string> recording_to_file;
+    if (use_mmap) {
+      std::string script_rxfilename;
+      RspecifierOptions opts;
+      if (ClassifyRspecifier(wav_rspecifier, &script_rxfilename, &opts) ==
+          kScriptRspecifier) {
+        std::vector<std::pair<std::string, std::string> > script;
+        if (ReadScriptFile(script_rxfilename, false, &script)) {
+          for (size_t i = 0; i < script.size(); i++)
+            if (ClassifyRxfilename(script[i].second) == kFileInput)
+              recording_to_file[script[i].first] = script[i].second;
+        }
+      }
+    }
+    MappedWaveData mapped;
+    std::string mapped_recording;  // the recording we last tried to map.
+
     int32 num_lines = 0, num_success = 0;
 
     std::string line;
@@ -121,17 +148,32 @@ int main(int argc, char *argv[]) {
       /* check whether a segment start time and end time exists in recording 
        * if fails , skips the segment.
        */ 
-      if (!reader.HasKey(recording)) {
-        KALDI_WARN << "Could not find recording " << recording
-                   << ", skipping segment " << segment;
-        continue;
+      std::map<std::string, std::string>::const_iterator file_iter =
+          recording_to_file.find(recording);
+      if (file_iter != recording_to_file.end() &&
+          recording != mapped_recording) {
+        mapped_recording = recording;
+        if (!mapped.Open(file_iter->second))  // it prints a warning.
+          KALDI_WARN << "Reading recording " << recording << " in full.";
       }
-      
-      const WaveData &wave = reader.Value(recording);
-      const Matrix<BaseFloat> &wave_data = wave.Data();
-      BaseFloat samp_freq = wave.SampFreq();  // read sampling fequency
-      int32 num_samp = wave_data.NumCols(),  // number of samples in recording
-        num_chan = wave_data.NumRows();  // number of channels in recording
+      bool use_mapped = (file_iter != recording_to_file.end() &&
+                         mapped.IsOpen());
+      const WaveData *wave = NULL;
+      if (!use_mapped) {
+        if (!reader.HasKey(recording)) {
+          KALDI_WARN << "Could not find recording " << recording
+                     << ", skipping segment " << segment;
+          continue;
+        }
+        wave = &(reader.Value(recording));
+      }
+      // read sampling fequency, number of samples and number of channels.
+      BaseFloat samp_freq = (use_mapped ? mapped.SampFreq() :
+                             wave->SampFreq());
+      int32 num_samp = (use_mapped ? mapped.NumSamples() :
+                        wave->Data().NumCols()),
+          num_chan = (use_mapped ? mapped.NumChannels() :
+                      wave->Data().NumRows());
 
       // Convert starting time of the segment to corresponding sample number.
       // If end time is -1 then use the whole file starting from start time.
@@ -185,7 +227,14 @@ int main(int argc, char *argv[]) {
       /*
        * This function  return a portion of a wav data from the orignial wav data matrix 
        */
-      SubMatrix<BaseFloat> segment_matrix(wave_data, channel, 1, start_samp, end_samp-start_samp);
+      Matrix<BaseFloat> segment_matrix(1, end_samp - start_samp, kUndefined);
+      if (use_mapped) {
+        SubVector<BaseFloat> samples(segment_matrix, 0);
+        mapped.GetSamples(channel, start_samp, &samples);
+      } else {
+        segment_matrix.CopyFromMat(SubMatrix<BaseFloat>(
+            wave->Data(), channel, 1, start_samp, end_samp - start_samp));
+      }
       WaveData segment_wave(samp_freq, segment_matrix);
       writer.Write(segment, segment_wave); // write segment in wave format.
       num_success++;
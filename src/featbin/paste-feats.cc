@@ -126,7 +126,7 @@ int main(int argc, char *argv[]) {
       
         // Collect features from streams to vector 'feats'
         vector<Matrix<BaseFloat> > feats(po.NumArgs() - 1);
-        feats[0] = input1.Value();
+        feats[0].Swap(&input1.Value());
         int32 i;
         for (i = 0; i < static_cast<int32>(input.size()); i++) {
           if (input[i]->HasKey(utt)) {
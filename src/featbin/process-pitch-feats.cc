@@ -153,7 +153,8 @@ int main(int argc, char *argv[]) {
 
     for (; !reader.Done(); reader.Next()) {
       std::string utt = reader.Key();   
-      Matrix<BaseFloat> features = reader.Value();
+      Matrix<BaseFloat> features;
+      features.Swap(&reader.Value());
       int num_frames = features.NumRows();
 
       if (num_frames == 0 && features.NumCols() != 2) {
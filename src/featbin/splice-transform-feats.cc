@@ -0,0 +1,158 @@
+// featbin/splice-transform-feats.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "feat/feature-functions.h"
+
+namespace kaldi {
+
+// Applies a linear or affine transform to each row of "feats", as
+// transform-feats does.  Returns false if the dimensions do not match.
+bool ApplyTransformToFeats(const MatrixBase<BaseFloat> &trans,
+                           const MatrixBase<BaseFloat> &feats,
+                           Matrix<BaseFloat> *feats_out) {
+  int32 feat_dim = feats.NumCols();
+  if (trans.NumCols() != feat_dim && trans.NumCols() != feat_dim + 1)
+    return false;
+  feats_out->Resize(feats.NumRows(), trans.NumRows());
+  SubMatrix<BaseFloat> linear_part(trans, 0, trans.NumRows(), 0, feat_dim);
+  feats_out->AddMatMat(1.0, feats, kNoTrans, linear_part, kTrans, 0.0);
+  if (trans.NumCols() == feat_dim + 1) {
+    Vector<BaseFloat> offset(trans.NumRows());
+    offset.CopyColFromMat(trans, feat_dim);
+    feats_out->AddVecToRows(1.0, offset);
+  }
+  return true;
+}
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+
+    const char *usage =
+        "Splice features and apply a global transform (e.g. LDA+MLLT) to them,\n"
+        "without forming the spliced features; then optionally apply\n"
+        "per-utterance or per-speaker transforms (e.g. fMLLR) and add deltas.\n"
+        "This gives the same output as the pipeline\n"
+        " splice-feats | transform-feats <transform> | transform-feats <fmllr>"
+        " | add-deltas\n"
+        "in one process.\n"
+        "Usage: splice-transform-feats [options] <transform-rxfilename> "
+        "<feats-rspecifier> <feats-wspecifier>\n"
+        "e.g.: splice-transform-feats --left-context=3 --right-context=3 "
+        "final.mat scp:feats.scp ark:-\n"
+        "See also: splice-feats, transform-feats, add-deltas\n";
+
+    ParseOptions po(usage);
+    int32 left_context = 4, right_context = 4;
+    std::string fmllr_rspecifier, utt2spk_rspecifier;
+    bool add_deltas = false;
+    DeltaFeaturesOptions delta_opts;
+    po.Register("left-context", &left_context, "Number of frames of left context");
+    po.Register("right-context", &right_context, "Number of frames of right context");
+    po.Register("fmllr", &fmllr_rspecifier, "rspecifier for transforms to apply "
+                "after the global transform (per-utterance, or per-speaker if "
+                "--utt2spk is given)");
+    po.Register("utt2spk", &utt2spk_rspecifier, "rspecifier for utterance to "
+                "speaker map, used with --fmllr");
+    po.Register("add-deltas", &add_deltas, "If true, add deltas at the end "
+                "(see --delta-order, --delta-window)");
+    delta_opts.Register(&po);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 3) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string transform_rxfilename = po.GetArg(1),
+        feat_rspecifier = po.GetArg(2),
+        feat_wspecifier = po.GetArg(3);
+
+    Matrix<BaseFloat> transform;
+    ReadKaldiObject(transform_rxfilename, &transform);
+
+    SequentialBaseFloatMatrixReader feat_reader(feat_rspecifier);
+    BaseFloatMatrixWriter feat_writer(feat_wspecifier);
+    RandomAccessBaseFloatMatrixReaderMapped fmllr_reader;
+    if (fmllr_rspecifier != "" &&
+        !fmllr_reader.Open(fmllr_rspecifier, utt2spk_rspecifier))
+      KALDI_ERR << "Problem opening transforms with rspecifier "
+                << '"' << fmllr_rspecifier << '"'
+                << " and utt2spk rspecifier "
+                << '"' << utt2spk_rspecifier << '"';
+
+    int32 num_done = 0, num_error = 0;
+    for (; !feat_reader.Done(); feat_reader.Next()) {
+      std::string utt = feat_reader.Key();
+      const Matrix<BaseFloat> &feats = feat_reader.Value();
+      int32 spliced_dim = feats.NumCols() * (left_context + 1 + right_context);
+      if (transform.NumCols() != spliced_dim &&
+          transform.NumCols() != spliced_dim + 1) {
+        KALDI_WARN << "Transform has bad dimension " << transform.NumRows()
+                   << "x" << transform.NumCols() << " versus spliced feature "
+                   << "dim " << spliced_dim << ", for utterance " << utt;
+        num_error++;
+        continue;
+      }
+      Matrix<BaseFloat> feats_out;
+      SpliceAndTransform(feats, left_context, right_context, transform,
+                         &feats_out);
+
+      if (fmllr_rspecifier != "") {
+        if (!fmllr_reader.HasKey(utt)) {
+          KALDI_WARN << "No fMLLR transform available for utterance "
+                     << utt << ", producing no output for this utterance";
+          num_error++;
+          continue;
+        }
+        Matrix<BaseFloat> fmllr_out;
+        if (!ApplyTransformToFeats(fmllr_reader.Value(utt), feats_out,
+                                   &fmllr_out)) {
+          KALDI_WARN << "fMLLR transform for utterance " << utt
+                     << " has bad dimension "
+                     << fmllr_reader.Value(utt).NumRows() << "x"
+                     << fmllr_reader.Value(utt).NumCols() << " versus feat dim "
+                     << feats_out.NumCols();
+          num_error++;
+          continue;
+        }
+        feats_out.Swap(&fmllr_out);
+      }
+
+      if (add_deltas) {
+        Matrix<BaseFloat> delta_out;
+        ComputeDeltas(delta_opts, feats_out, &delta_out);
+        feats_out.Swap(&delta_out);
+      }
+      feat_writer.Write(utt, feats_out);
+      num_done++;
+    }
+    KALDI_LOG << "Spliced and transformed " << num_done << " utterances; "
+              << num_error << " had errors.";
+    return (num_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -73,11 +73,15 @@ int main(int argc, char *argv[]) {
 
     float delta = kDelta;
     int max_states = -1;
+    int num_threads = 1;
     bool use_log = false;
     ParseOptions po(usage);
     po.Register("use-log", &use_log, "Determinize in log semiring.");
     po.Register("delta", &delta, "Delta value used to determine equivalence of weights.");
     po.Register("max-states", &max_states, "Maximum number of states in determinized FST before it will abort.");
+    po.Register("num-threads", &num_threads, "Number of threads used to expand "
+                "the determinized states (the output may be numbered differently "
+                "for different values, but is equivalent).");
     po.Read(argc, argv);
 
     if (po.NumArgs() > 2) {
@@ -99,10 +103,12 @@ int main(int argc, char *argv[]) {
 
       ArcSort(fst, ILabelCompare<StdArc>());  // improves speed.
       if (use_log) {
-        DeterminizeStarInLog(fst, delta, &debug_location, max_states);
+        DeterminizeStarInLog(fst, delta, &debug_location, max_states,
+                             num_threads);
       } else {
         VectorFst<StdArc> det_fst;
-        DeterminizeStar(*fst, &det_fst, delta, &debug_location, max_states);
+        DeterminizeStar(*fst, &det_fst, delta, &debug_location, max_states,
+                        false, num_threads);
         *fst = det_fst;  // will do shallow copy and then det_fst goes
         // out of scope anyway.
       }
@@ -118,10 +124,12 @@ int main(int argc, char *argv[]) {
         ArcSort(&fst, ILabelCompare<StdArc>()); // improves speed.
         try {
           if (use_log) {
-            DeterminizeStarInLog(&fst, delta, &debug_location, max_states);
+            DeterminizeStarInLog(&fst, delta, &debug_location, max_states,
+                                 num_threads);
           } else {
             VectorFst<StdArc> det_fst;
-            DeterminizeStar(fst, &det_fst, delta, &debug_location, max_states);
+            DeterminizeStar(fst, &det_fst, delta, &debug_location, max_states,
+                            false, num_threads);
             fst = det_fst;  // will do shallow copy and then det_fst goes out
             // of scope anyway.
           }
@@ -0,0 +1,77 @@
+// fstbin/fstmakemapped.cc
+
+// Copyright 2026  agent
+// (based on fstbin/fstdeterminizelog.cc; see that file for its authors)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "fst/fstlib.h"
+#include "fstext/fstext-utils.h"
+#include "fstext/mapped-fst.h"
+
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+    using kaldi::int32;
+
+    const char *usage =
+        "Converts an FST (typically a decoding graph, HCLG.fst) to the format\n"
+        "that the decoding programs memory-map instead of reading, so that it\n"
+        "loads instantly and is shared between processes on the same machine.\n"
+        "The output must be a file, and is specific to the machine's byte order.\n"
+        "Symbol tables are not kept.\n"
+        "\n"
+        "Usage:  fstmakemapped [in.fst] out.fst\n"
+        "E.g.:   fstmakemapped exp/tri3/graph/HCLG.fst exp/tri3/graph/HCLG.mapped.fst\n";
+
+    ParseOptions po(usage);
+    po.Read(argc, argv);
+
+    if (po.NumArgs() < 1 || po.NumArgs() > 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string fst_in_filename = (po.NumArgs() == 2 ? po.GetArg(1) : ""),
+        fst_out_filename = po.GetArg(po.NumArgs());
+
+    if (ClassifyWxfilename(fst_out_filename) != kFileOutput)
+      KALDI_ERR << "The output of fstmakemapped must be a file, not "
+                << PrintableWxfilename(fst_out_filename);
+
+    VectorFst<StdArc> *fst = ReadFstKaldi(fst_in_filename);
+
+    {
+      bool binary = true, write_header = false;
+      Output ko(fst_out_filename, binary, write_header);
+      if (!WriteMappedConstFst(*fst, ko.Stream()))
+        KALDI_ERR << "Error writing mapped FST to " << fst_out_filename;
+      ko.Close();
+    }
+    KALDI_LOG << "Wrote mapped FST with " << fst->NumStates() << " states to "
+              << fst_out_filename;
+    delete fst;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -43,10 +43,13 @@ int main(int argc, char *argv[]) {
         "Usage:  fstpushspecial [options] [in.fst [out.fst] ]\n";
 
     BaseFloat delta = kDelta;
+    int32 num_threads = 1;
     ParseOptions po(usage);
     po.Register("delta", &delta, "Delta cost: after pushing, all states will "
                 "have a total weight that differs from the average by no more "
                 "than this.");
+    po.Register("num-threads", &num_threads, "Number of threads to use in "
+                "the iterations (worthwhile for large FSTs).");
     po.Read(argc, argv);
 
     if (po.NumArgs() > 2) {
@@ -59,7 +62,7 @@ int main(int argc, char *argv[]) {
 
     VectorFst<StdArc> *fst = ReadFstKaldi(fst_in_filename);
 
-    PushSpecial(fst, delta);
+    PushSpecial(fst, delta, num_threads);
 
     WriteFstKaldi(*fst, fst_out_filename);
     delete fst;
@@ -23,6 +23,7 @@
 #include "util/common-utils.h"
 #include "fst/fstlib.h"
 #include "fstext/table-matcher.h"
+#include "fstext/parallel-compose.h"
 #include "fstext/fstext-utils.h"
 
 
@@ -67,12 +68,17 @@ int main(int argc, char *argv[]) {
     TableComposeOptions opts;
     std::string match_side = "left";
     std::string compose_filter = "sequence";
+    int32 num_threads = 1;
 
     po.Register("connect", &opts.connect, "If true, trim FST before output.");
     po.Register("match-side", &match_side, "Side of composition to do table "
                 "match, one of: \"left\" or \"right\".");
     po.Register("compose-filter", &compose_filter, "Composition filter to use, "
                 "one of: \"alt_sequence\", \"auto\", \"match\", \"sequence\"");
+    po.Register("num-threads", &num_threads, "If >1, use a composition routine "
+                "that expands the states in this many threads (it always uses "
+                "the sequence filter).  Only applies when composing two FSTs "
+                "that are not archives.");
     
     po.Read(argc, argv);
 
@@ -125,7 +131,10 @@ int main(int argc, char *argv[]) {
       
       VectorFst<StdArc> composed_fst;
 
-      TableCompose(*fst1, *fst2, &composed_fst, opts);
+      if (num_threads > 1)
+        TableComposeParallel(*fst1, *fst2, &composed_fst, opts, num_threads);
+      else
+        TableCompose(*fst1, *fst2, &composed_fst, opts);
 
       delete fst1;
       delete fst2;
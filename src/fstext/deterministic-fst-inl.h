@@ -205,6 +205,93 @@ bool CacheDeterministicOnDemandFst<Arc>::GetArc(StateId s, Label ilabel,
   }  
 }
 
+template<class Arc>
+SharedCacheDeterministicOnDemandFst<Arc>::SharedCacheDeterministicOnDemandFst(
+    DeterministicOnDemandFst<Arc> *fst,
+    size_t num_cached_arcs,
+    int32 num_shards,
+    bool fst_is_thread_safe): fst_(fst), lock_fst_(!fst_is_thread_safe) {
+  KALDI_ASSERT(num_cached_arcs > 0 && num_shards > 0);
+  shard_capacity_ = std::max<size_t>(1, num_cached_arcs / num_shards);
+  shards_.resize(num_shards);
+  for (int32 i = 0; i < num_shards; i++)
+    shards_[i] = new Shard;
+}
+
+template<class Arc>
+SharedCacheDeterministicOnDemandFst<Arc>::~SharedCacheDeterministicOnDemandFst() {
+  for (size_t i = 0; i < shards_.size(); i++)
+    delete shards_[i];
+}
+
+template<class Arc>
+inline typename SharedCacheDeterministicOnDemandFst<Arc>::Shard *
+SharedCacheDeterministicOnDemandFst<Arc>::GetShard(const Key &key) {
+  // Use different multipliers from KeyHasher, so that the arcs within a shard
+  // are still spread over the buckets of its hash.
+  size_t h = static_cast<size_t>(key.first) * 7853 +
+      static_cast<size_t>(key.second) * 104729;
+  return shards_[(h >> 4) % shards_.size()];
+}
+
+template<class Arc>
+typename Arc::StateId SharedCacheDeterministicOnDemandFst<Arc>::Start() {
+  if (lock_fst_) fst_mutex_.Lock();
+  StateId ans = fst_->Start();
+  if (lock_fst_) fst_mutex_.Unlock();
+  return ans;
+}
+
+template<class Arc>
+typename Arc::Weight SharedCacheDeterministicOnDemandFst<Arc>::Final(
+    StateId s) {
+  if (lock_fst_) fst_mutex_.Lock();
+  Weight ans = fst_->Final(s);
+  if (lock_fst_) fst_mutex_.Unlock();
+  return ans;
+}
+
+template<class Arc>
+bool SharedCacheDeterministicOnDemandFst<Arc>::GetArc(StateId s, Label ilabel,
+                                                      Arc *oarc) {
+  // As in CacheDeterministicOnDemandFst, we don't cache anything in case a
+  // requested arc does not exist.
+  KALDI_ASSERT(s >= 0 && ilabel != 0);
+  Key key(s, ilabel);
+  Shard *shard = GetShard(key);
+  shard->mutex.Lock();
+  typename MapType::iterator iter = shard->map.find(key);
+  if (iter != shard->map.end()) {
+    // Move it to the front of the list, as the most recently used.
+    shard->arcs.splice(shard->arcs.begin(), shard->arcs, iter->second);
+    *oarc = iter->second->second;
+    shard->mutex.Unlock();
+    return true;
+  }
+  shard->mutex.Unlock();
+
+  Arc arc;
+  if (lock_fst_) fst_mutex_.Lock();
+  bool ans = fst_->GetArc(s, ilabel, &arc);
+  if (lock_fst_) fst_mutex_.Unlock();
+  if (!ans)
+    return false;
+  *oarc = arc;
+
+  shard->mutex.Lock();
+  // Another thread may have added this arc while we were not holding the lock.
+  if (shard->map.find(key) == shard->map.end()) {
+    shard->arcs.push_front(std::make_pair(key, arc));
+    shard->map[key] = shard->arcs.begin();
+    if (shard->map.size() > shard_capacity_) {
+      shard->map.erase(shard->arcs.back().first);
+      shard->arcs.pop_back();
+    }
+  }
+  shard->mutex.Unlock();
+  return true;
+}
+
 template<class Arc>
 LmExampleDeterministicOnDemandFst<Arc>::LmExampleDeterministicOnDemandFst(
     void *lm, Label bos_symbol, Label eos_symbol):
@@ -177,6 +177,32 @@ void TestBackoffAndCache() {
   delete rfst;
 }
 
+void TestSharedCache() {
+  StdVectorFst *nfst = CreateBackoffFst();
+  ArcSort(nfst, StdILabelCompare());
+  BackoffDeterministicOnDemandFst<StdArc> dfst1a(*nfst);
+  // Use a very small cache so that arcs get evicted.
+  SharedCacheDeterministicOnDemandFst<StdArc> dfst1(&dfst1a, 4, 2);
+  assert(dfst1.Start() == dfst1a.Start());
+  // Ask for arcs in a random order; the cached FST should always give the
+  // same as the uncached one.
+  for (int32 i = 0; i < 500; i++) {
+    StdArc::StateId s = rand() % nfst->NumStates();
+    StdArc::Label ilabel = 10 + rand() % 6;
+    StdArc arc1, arc2;
+    bool b1 = dfst1.GetArc(s, ilabel, &arc1),
+        b2 = dfst1a.GetArc(s, ilabel, &arc2);
+    assert(b1 == b2);
+    if (b1) {
+      assert(arc1.ilabel == arc2.ilabel && arc1.olabel == arc2.olabel &&
+             arc1.nextstate == arc2.nextstate &&
+             ApproxEqual(arc1.weight, arc2.weight));
+    }
+    assert(ApproxEqual(dfst1.Final(s), dfst1a.Final(s)));
+  }
+  delete nfst;
+}
+
 void TestCompose() {
   cout << "Test with single generated backoff FST" << endl;
   StdVectorFst *nfst = CreateBackoffFst();
@@ -225,5 +251,6 @@ int main() {
   using namespace fst;
   TestBackoffAndCache();
   TestCompose();
+  TestSharedCache();
 }
   
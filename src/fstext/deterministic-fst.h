@@ -54,6 +54,7 @@
 #endif
 using std::tr1::unordered_map;
 
+#include <list>
 #include <string>
 #include <utility>
 #include <vector>
@@ -63,6 +64,7 @@ using std::tr1::unordered_map;
 #include <fst/slist.h>
 
 #include "util/stl-utils.h"
+#include "thread/kaldi-mutex.h"
 
 namespace fst {
 
@@ -185,6 +187,71 @@ class CacheDeterministicOnDemandFst: public DeterministicOnDemandFst<Arc> {
 };
 
 
+/**
+   This class is like CacheDeterministicOnDemandFst, but it is intended to be
+   shared between multiple decoding threads, e.g. as the lm_diff_fst of the
+   biglm decoders, so that they do not each need their own cache.  All functions
+   may be called from multiple threads at once.  The cache is split into
+   "shards" that are selected by a hash of the (state, ilabel) pair, each with
+   its own lock and eviction order, so threads rarely contend for a lock; within
+   a shard the least recently used arc is evicted when it is full.  On a cache
+   miss we call the underlying FST while holding a separate lock, since it need
+   not be thread-safe (e.g. ComposeDeterministicOnDemandFst is not), unless we
+   are told that it is (e.g. CompactNgramLmDeterministicFst), in which case the
+   threads look up their misses in parallel.
+ */
+template<class Arc>
+class SharedCacheDeterministicOnDemandFst:
+      public DeterministicOnDemandFst<Arc> {
+ public:
+  typedef typename Arc::StateId StateId;
+  typedef typename Arc::Weight Weight;
+  typedef typename Arc::Label Label;
+
+  /// We don't take ownership of this pointer.  The argument is "really" const.
+  /// "num_cached_arcs" is the total capacity of the cache.  If
+  /// "fst_is_thread_safe", we call "fst" without locking.
+  SharedCacheDeterministicOnDemandFst(DeterministicOnDemandFst<Arc> *fst,
+                                      size_t num_cached_arcs = 1000000,
+                                      int32 num_shards = 64,
+                                      bool fst_is_thread_safe = false);
+
+  virtual StateId Start();
+
+  /// We don't bother caching the final-probs, just the arcs.
+  virtual Weight Final(StateId s);
+
+  virtual bool GetArc(StateId s, Label ilabel, Arc *oarc);
+
+  virtual ~SharedCacheDeterministicOnDemandFst();
+
+ private:
+  typedef std::pair<StateId, Label> Key;
+  struct KeyHasher {
+    size_t operator()(const Key &key) const {
+      return static_cast<size_t>(key.first) * 26597 +
+          static_cast<size_t>(key.second) * 50329;
+    }
+  };
+  // The arcs of a shard, most recently used first.
+  typedef std::list<std::pair<Key, Arc> > ListType;
+  typedef unordered_map<Key, typename ListType::iterator, KeyHasher> MapType;
+  struct Shard {
+    kaldi::Mutex mutex;
+    ListType arcs;
+    MapType map;  // maps from key to position in "arcs".
+  };
+
+  inline Shard *GetShard(const Key &key);
+
+  DeterministicOnDemandFst<Arc> *fst_;
+  kaldi::Mutex fst_mutex_;  // held while calling fst_, if lock_fst_.
+  bool lock_fst_;
+  size_t shard_capacity_;  // max number of arcs cached per shard.
+  std::vector<Shard*> shards_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(SharedCacheDeterministicOnDemandFst);
+};
+
 /// This class is for didactic purposes, it does not really do anything.
 /// It shows how you would wrap a language model.  Note: you should probably
 /// have <s> and </s> not be real words in your LM, but <s> correspond somehow
@@ -22,6 +22,8 @@
 // Do not include this file directly.  It is included by determinize-star.h
 
 #include "base/kaldi-error.h"
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-thread.h"
 
 #ifdef _MSC_VER
 #include <unordered_map>
@@ -30,6 +32,8 @@
 #endif
 using std::tr1::unordered_map;
 #include <vector>
+#include <deque>
+#include <string>
 #include <climits>
 
 namespace fst {
@@ -290,13 +294,21 @@ template<class Arc> class DeterminizerStar {
 
 
   // Initializer.  After initializing the object you will typically call one of
-  // the Output functions.
+  // the Output functions.  If num_threads > 1, we expand the subsets on the
+  // queue in parallel (see DeterminizeParallel()).  This needs the input FST to
+  // be safe to read from several threads at once, which is true of expanded
+  // FSTs such as VectorFst but not of on-demand ones, so for those we use one
+  // thread.
   DeterminizerStar(const Fst<Arc> &ifst, float delta = kDelta,
-                   int max_states = -1, bool allow_partial = false):
+                   int max_states = -1, bool allow_partial = false,
+                   int num_threads = 1):
       ifst_(ifst.Copy()), delta_(delta), max_states_(max_states),
       determinized_(false), allow_partial_(allow_partial),
-      is_partial_(false), equal_(delta),
-      hash_(ifst.Properties(kExpanded, false) ? down_cast<const ExpandedFst<Arc>*, const Fst<Arc> >(&ifst)->NumStates()/2 + 3 : 20, hasher_, equal_) { }
+      is_partial_(false),
+      num_threads_(ifst.Properties(kExpanded, false) ? num_threads : 1),
+      equal_(delta),
+      hash_(ifst.Properties(kExpanded, false) ? down_cast<const ExpandedFst<Arc>*, const Fst<Arc> >(&ifst)->NumStates()/2 + 3 : 20, hasher_, equal_),
+      pool_block_(NULL), pool_block_size_(0), pool_block_used_(0) { }
 
   void Determinize(bool *debug_ptr) {
     assert(!determinized_);
@@ -314,22 +326,15 @@ template<class Arc> class DeterminizerStar {
       OutputStateId cur_id = SubsetToStateId(vec);
       assert(cur_id == 0 && "Do not call Determinize twice.");
     }
-    while (!Q_.empty()) {
-      pair<vector<Element>*, OutputStateId> cur_pair = Q_.front();
-      Q_.pop_front();
-      ProcessSubset(cur_pair);
-      if (debug_ptr && *debug_ptr) Debug();  // will exit.
-      if (max_states_ > 0 && output_arcs_.size() > max_states_) {
-        if (allow_partial_ == false) {
-          std::cerr << "Determinization aborted since passed " << max_states_
-                    << " states.\n";
-          throw std::runtime_error("max-states reached in determinization");
-        } else {
-          KALDI_WARN << "Determinization terminated since passed " << max_states_
-                     << " states, partial results will be generated.";
-          is_partial_ = true;
-          break;
-        }
+    if (num_threads_ > 1) {
+      DeterminizeParallel(debug_ptr);
+    } else {
+      while (!Q_.empty()) {
+        pair<SubsetRange, OutputStateId> cur_pair = Q_.front();
+        Q_.pop_front();
+        ProcessSubset(cur_pair);
+        if (debug_ptr && *debug_ptr) Debug();  // will exit.
+        if (MaxStatesReached()) break;
       }
     }
     determinized_ = true;
@@ -346,11 +351,17 @@ template<class Arc> class DeterminizerStar {
       delete ifst_;
       ifst_ = NULL;
     }
-    for (typename SubsetHash::iterator iter = hash_.begin();
-        iter != hash_.end(); ++iter)
-      delete iter->first;
     SubsetHash tmp;
     tmp.swap(hash_); 
+    deque<pair<SubsetRange, OutputStateId> > tmp_queue;
+    tmp_queue.swap(Q_);
+    for (size_t i = 0; i < subset_pool_.size(); i++)
+      delete [] subset_pool_[i];
+    vector<Element*> tmp_pool;
+    tmp_pool.swap(subset_pool_);
+    pool_block_ = NULL;
+    pool_block_size_ = 0;
+    pool_block_used_ = 0;
   }
   
   ~DeterminizerStar() {
@@ -386,6 +397,33 @@ template<class Arc> class DeterminizerStar {
     Weight weight;
   };
 
+  // A subset of the determinized FST, i.e. the Elements begin[0] ... begin[size-1].
+  // The subsets of all the states are stored one after the other in large
+  // blocks of memory (see CopyToPool()), rather than each in its own vector;
+  // for very large FSTs the per-vector overhead and the fragmentation of
+  // the heap would otherwise take as much memory as the Elements themselves.
+  struct SubsetRange {
+    const Element *begin;
+    size_t size;
+  };
+
+  // An arc out of a subset whose destination state we have not looked up
+  // yet; used in multi-threaded determinization.  "subset" is the normalized
+  // destination subset.
+  struct PendingArc {
+    Label ilabel;
+    StringId ostring;
+    Weight weight;
+    vector<Element> subset;
+  };
+
+  enum {
+    kMinPoolBlockSize = 1024,  // Sizes of the blocks of the subset pool,
+    kMaxPoolBlockSize = 1 << 20,  // in Elements.
+    kSubsetsPerThread = 16  // Number of subsets per thread we process at a time
+                            // in multi-threaded determinization.
+  };
+
 
   // Hashing function used in hash of subsets.
   // A subset is a pointer to vector<Element>.
@@ -402,9 +440,10 @@ template<class Arc> class DeterminizerStar {
 
   class SubsetKey {
    public:
-    size_t operator ()(const vector<Element> * subset) const {  // hashes only the state and string.
+    size_t operator ()(const SubsetRange &subset) const {  // hashes only the state and string.
       size_t hash = 0, factor = 1;
-      for (typename vector<Element>::const_iterator iter= subset->begin(); iter != subset->end(); ++iter) {
+      for (const Element *iter = subset.begin, *end = subset.begin + subset.size;
+           iter != end; ++iter) {
         hash *= factor;
         hash += iter->state + 103333*iter->string;
         factor *= 23531;  // these numbers are primes.
@@ -417,12 +456,11 @@ template<class Arc> class DeterminizerStar {
   // and string, and approximate match on weights.
   class SubsetEqual {
    public:
-    bool operator ()(const vector<Element> * s1, const vector<Element> * s2) const {
-      size_t sz = s1->size();
-      assert(sz>=0);
-      if (sz != s2->size()) return false;
-      typename vector<Element>::const_iterator iter1 = s1->begin(),
-          iter1_end = s1->end(), iter2=s2->begin();
+    bool operator ()(const SubsetRange &s1, const SubsetRange &s2) const {
+      size_t sz = s1.size;
+      if (sz != s2.size) return false;
+      const Element *iter1 = s1.begin, *iter1_end = s1.begin + sz,
+          *iter2 = s2.begin;
       for (; iter1 < iter1_end; ++iter1, ++iter2) {
         if (iter1->state != iter2->state ||
            iter1->string != iter2->string ||
@@ -439,12 +477,11 @@ template<class Arc> class DeterminizerStar {
   // Used only for debug.
   class SubsetEqualStates {
    public:
-    bool operator ()(const vector<Element> * s1, const vector<Element> * s2) const {
-      size_t sz = s1->size();
-      assert(sz>=0);
-      if (sz != s2->size()) return false;
-      typename vector<Element>::const_iterator iter1 = s1->begin(),
-          iter1_end = s1->end(), iter2=s2->begin();
+    bool operator ()(const SubsetRange &s1, const SubsetRange &s2) const {
+      size_t sz = s1.size;
+      if (sz != s2.size) return false;
+      const Element *iter1 = s1.begin, *iter1_end = s1.begin + sz,
+          *iter2 = s2.begin;
       for (; iter1 < iter1_end; ++iter1, ++iter2) {
         if (iter1->state != iter2->state) return false;
       }
@@ -453,14 +490,173 @@ template<class Arc> class DeterminizerStar {
   };
 
   // Define the hash type we use to store subsets.
-  typedef unordered_map<const vector<Element>*, OutputStateId, SubsetKey, SubsetEqual> SubsetHash;
+  typedef unordered_map<SubsetRange, OutputStateId, SubsetKey, SubsetEqual> SubsetHash;
+
+  // Expands the subsets (*batch)[i] for i == thread_id_ (mod num_threads_);
+  // used in DeterminizeParallel().
+  class ExpandSubsetsClass: public kaldi::MultiThreadable {
+   public:
+    ExpandSubsetsClass(DeterminizerStar *det,
+                       const vector<pair<SubsetRange, OutputStateId> > *batch,
+                       vector<vector<PendingArc> > *pending):
+        det_(det), batch_(batch), pending_(pending) { }
+    void operator () () {
+      try {
+        for (size_t i = thread_id_; i < batch_->size(); i += num_threads_)
+          det_->ExpandSubset((*batch_)[i], &((*pending_)[i]));
+      } catch (const std::runtime_error &e) {
+        // We can't let the exception out of the thread; it is rethrown by
+        // DeterminizeParallel().
+        det_->SetThreadError(e.what());
+      }
+    }
+   private:
+    DeterminizerStar *det_;
+    const vector<pair<SubsetRange, OutputStateId> > *batch_;
+    vector<vector<PendingArc> > *pending_;
+  };
+
+  // This is the multi-threaded version of the loop in Determinize().  We take
+  // a batch of subsets from the queue and expand them in parallel: epsilon
+  // closure, final-weight and the normalized destination subset of each
+  // transition (see ExpandSubset()).  Then, in this thread and in the order of
+  // the batch, we look up or create the destination states, which may add
+  // subsets to the queue.  The output depends on the number of threads (via
+  // the order in which states are numbered) but not on the timing.
+  void DeterminizeParallel(bool *debug_ptr) {
+    size_t batch_size = kSubsetsPerThread * num_threads_;
+    vector<pair<SubsetRange, OutputStateId> > batch;
+    vector<vector<PendingArc> > pending;
+    while (!Q_.empty()) {
+      batch.clear();
+      while (!Q_.empty() && batch.size() < batch_size) {
+        batch.push_back(Q_.front());
+        Q_.pop_front();
+      }
+      pending.clear();
+      pending.resize(batch.size());
+      {
+        ExpandSubsetsClass c(this, &batch, &pending);
+        // The destructor of "m" waits for the threads to finish.
+        kaldi::MultiThreader<ExpandSubsetsClass> m(num_threads_, c);
+      }
+      if (!thread_error_.empty())
+        throw std::runtime_error(thread_error_);
+      for (size_t i = 0; i < batch.size(); i++) {
+        OutputStateId state = batch[i].second;
+        vector<PendingArc> &arcs = pending[i];
+        for (size_t j = 0; j < arcs.size(); j++) {
+          TempArc temp_arc;
+          temp_arc.ilabel = arcs[j].ilabel;
+          temp_arc.nextstate = SubsetToStateId(arcs[j].subset);
+          temp_arc.ostring = arcs[j].ostring;
+          temp_arc.weight = arcs[j].weight;
+          output_arcs_[state].push_back(temp_arc);
+        }
+        ShrinkArcs(state);
+      }
+      if (debug_ptr && *debug_ptr) Debug();  // will exit.
+      if (MaxStatesReached()) break;
+    }
+  }
+
+  // Does the work of ProcessSubset() in multi-threaded determinization,
+  // except that the transitions go to "pending", as their destination states
+  // are looked up later.  This may be called from several threads at once:
+  // it only writes to output_arcs_[pair.second], and locks the repository.
+  void ExpandSubset(const pair<SubsetRange, OutputStateId> &pair,
+                    vector<PendingArc> *pending) {
+    vector<Element> closed_subset;  // subset after epsilon closure.
+    EpsilonClosure(pair.first, &closed_subset);
+    ProcessFinal(closed_subset, pair.second);
+    ProcessTransitions(closed_subset, pair.second, pending);
+  }
+
+  void SetThreadError(const char *what) {
+    error_mutex_.Lock();
+    if (thread_error_.empty()) thread_error_ = what;
+    error_mutex_.Unlock();
+  }
+
+  // Called after we process some subsets: returns true if we have passed
+  // max_states_ and allow_partial_ is true, so we should stop; throws if we
+  // have passed it and allow_partial_ is false.
+  bool MaxStatesReached() {
+    if (max_states_ > 0 && output_arcs_.size() > max_states_) {
+      if (allow_partial_ == false) {
+        std::cerr << "Determinization aborted since passed " << max_states_
+                  << " states.\n";
+        throw std::runtime_error("max-states reached in determinization");
+      } else {
+        KALDI_WARN << "Determinization terminated since passed " << max_states_
+                   << " states, partial results will be generated.";
+        is_partial_ = true;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Copies "subset" into the pool and returns where it is.  The pool consists
+  // of blocks of increasing size, up to kMaxPoolBlockSize Elements (a subset
+  // larger than that gets a block of its own); each subset is contiguous
+  // within a block.
+  SubsetRange CopyToPool(const vector<Element> &subset) {
+    size_t size = subset.size();
+    if (pool_block_ == NULL || pool_block_used_ + size > pool_block_size_) {
+      size_t block_size = std::min<size_t>(kMaxPoolBlockSize,
+                                           std::max<size_t>(kMinPoolBlockSize,
+                                                            2 * pool_block_size_));
+      block_size = std::max(block_size, size);
+      pool_block_ = new Element[block_size];
+      subset_pool_.push_back(pool_block_);
+      pool_block_size_ = block_size;
+      pool_block_used_ = 0;
+    }
+    Element *dest = pool_block_ + pool_block_used_;
+    std::copy(subset.begin(), subset.end(), dest);
+    pool_block_used_ += size;
+    SubsetRange ans;
+    ans.begin = dest;
+    ans.size = size;
+    return ans;
+  }
+
+  // Frees the unused capacity of output_arcs_[state], once all its arcs have
+  // been added; for large FSTs this saves a lot of memory.
+  void ShrinkArcs(OutputStateId state) {
+    vector<TempArc> &arcs = output_arcs_[state];
+    if (arcs.capacity() != arcs.size())
+      vector<TempArc>(arcs).swap(arcs);
+  }
+
+  // The following functions access repository_; if we are using several
+  // threads, they lock it, as it is shared between the threads.
+  void SeqOfId(StringId id, vector<Label> *seq) {
+    if (num_threads_ > 1) repository_mutex_.Lock();
+    repository_.SeqOfId(id, seq);
+    if (num_threads_ > 1) repository_mutex_.Unlock();
+  }
+  StringId IdOfSeq(const vector<Label> &seq) {
+    if (num_threads_ > 1) repository_mutex_.Lock();
+    StringId ans = repository_.IdOfSeq(seq);
+    if (num_threads_ > 1) repository_mutex_.Unlock();
+    return ans;
+  }
+  StringId RemovePrefix(StringId id, size_t prefix_len) {
+    if (prefix_len == 0) return id;
+    if (num_threads_ > 1) repository_mutex_.Lock();
+    StringId ans = repository_.RemovePrefix(id, prefix_len);
+    if (num_threads_ > 1) repository_mutex_.Unlock();
+    return ans;
+  }
 
 
   // This function computes epsilon closure of subset of states by following epsilon links.
   // Called by ProcessSubset.
   // Has no side effects except on the repository.
 
-  void EpsilonClosure(const vector<Element> & input_subset,
+  void EpsilonClosure(const SubsetRange &input_subset,
                       vector<Element> *output_subset) {
     // input_subset must have only one example of each StateId.
 
@@ -468,8 +664,9 @@ template<class Arc> class DeterminizerStar {
     typedef typename std::map<InputStateId, Element>::iterator MapIter;
     {
       MapIter iter = cur_subset.end();
-      for (size_t i = 0;i < input_subset.size();i++) {
-        std::pair<const InputStateId, Element> pr(input_subset[i].state, input_subset[i]);
+      for (size_t i = 0;i < input_subset.size;i++) {
+        std::pair<const InputStateId, Element> pr(input_subset.begin[i].state,
+                                                  input_subset.begin[i]);
         iter = cur_subset.insert(iter, pr);
         // By providing iterator where we inserted last one, we make insertion more efficient since
         // input subset was already in sorted order.
@@ -478,7 +675,8 @@ template<class Arc> class DeterminizerStar {
     // find whether input fst is known to be sorted in input label.
     bool sorted = ((ifst_->Properties(kILabelSorted, false) & kILabelSorted) != 0);
     
-    vector<Element> queue(input_subset);  // queue of things to be processed.
+    vector<Element> queue(input_subset.begin, input_subset.begin +
+                          input_subset.size);  // queue of things to be processed.
     bool replaced_elems = false; // relates to an optimization, see below.
     int counter = 0; // relates to max-states option, used for test.
     while (queue.size() != 0) {
@@ -511,10 +709,10 @@ template<class Arc> class DeterminizerStar {
             next_elem.string = elem.string;
           else {
             vector<Label> seq;
-            repository_.SeqOfId(elem.string, &seq);
+            SeqOfId(elem.string, &seq);
             if (arc.olabel != 0)
               seq.push_back(arc.olabel);
-            next_elem.string = repository_.IdOfSeq(seq);
+            next_elem.string = IdOfSeq(seq);
           }
           typename std::map<InputStateId, Element>::iterator
               iter = cur_subset.find(next_elem.state);
@@ -528,11 +726,11 @@ template<class Arc> class DeterminizerStar {
               { // Print some debugging information.  Can be helpful to debug
                 // the inputs when FSTs are mysteriously non-functional.
                 vector<Label> tmp_seq;
-                repository_.SeqOfId(iter->second.string, &tmp_seq);
+                SeqOfId(iter->second.string, &tmp_seq);
                 std::cerr << "First string: ";
                 for (size_t i = 0; i < tmp_seq.size(); i++) std::cerr << tmp_seq[i] << " ";
                 std::cerr << "\nSecond string: ";
-                repository_.SeqOfId(next_elem.string, &tmp_seq);
+                SeqOfId(next_elem.string, &tmp_seq);
                 for (size_t i = 0; i < tmp_seq.size(); i++) std::cerr << tmp_seq[i] << " ";
                 std::cerr << "\n";
               }
@@ -598,9 +796,11 @@ template<class Arc> class DeterminizerStar {
   }
 
   // ProcessTransition is called from "ProcessTransitions".  Broken out for clarity.
-  // Has side effects on output_arcs_, and (via SubsetToStateId) Q_ and hash_
+  // Has side effects on output_arcs_, and (via SubsetToStateId) Q_ and hash_;
+  // but if "pending" is not NULL, it appends the arc to it instead.
 
-  void ProcessTransition(OutputStateId state, Label ilabel, vector<Element> *subset) {
+  void ProcessTransition(OutputStateId state, Label ilabel, vector<Element> *subset,
+                         vector<PendingArc> *pending) {
     // At input, "subset" may contain duplicates for a given dest state (but in sorted
     // order).  This function removes duplicates from "subset", normalizes it, and adds
     // a transition to the dest. state (possibly affecting Q_ and hash_, if state did not
@@ -642,16 +842,16 @@ template<class Arc> class DeterminizerStar {
         vector<Label> tmp_seq;
         for (iter = begin; iter!= end; ++iter) {
           if (iter == begin) {
-            repository_.SeqOfId(iter->string, &seq);
+            SeqOfId(iter->string, &seq);
           } else {
-            repository_.SeqOfId(iter->string, &tmp_seq);
+            SeqOfId(iter->string, &tmp_seq);
             if (tmp_seq.size() < seq.size()) seq.resize(tmp_seq.size());  // size of shortest one.
             for (size_t i = 0;i < seq.size(); i++) // seq.size() is the shorter one at this point.
               if (tmp_seq[i] != seq[i]) seq.resize(i);
           }
           if (seq.size() == 0) break;  // will not get any prefix.
         }
-        common_str = repository_.IdOfSeq(seq);
+        common_str = IdOfSeq(seq);
       }
 
       {  // This block computes "tot_weight".
@@ -665,10 +865,20 @@ template<class Arc> class DeterminizerStar {
       size_t prefix_len = seq.size();
       for (iter = begin; iter != end; ++iter) {
         iter->weight = Divide(iter->weight, tot_weight);
-        iter->string = repository_.RemovePrefix(iter->string, prefix_len);
+        iter->string = RemovePrefix(iter->string, prefix_len);
       }
     }
 
+    if (pending != NULL) {  // The destination state is looked up later.
+      pending->resize(pending->size() + 1);
+      PendingArc &pending_arc = pending->back();
+      pending_arc.ilabel = ilabel;
+      pending_arc.ostring = common_str;
+      pending_arc.weight = tot_weight;
+      pending_arc.subset.swap(*subset);
+      return;
+    }
+
     // Now add an arc to the state that the subset represents.
     // We may create a new state id for this (in SubsetToStateId).
     TempArc temp_arc;
@@ -703,9 +913,11 @@ template<class Arc> class DeterminizerStar {
   // using a lexicographical ordering, and calling ProcessTransition for each range
   // with the same ilabel.
   // Side effects on repository, and (via ProcessTransition) on Q_, hash_,
-  // and output_arcs_.
+  // and output_arcs_; if "pending" is not NULL, the arcs are appended to it
+  // instead, and Q_ and hash_ are not touched.
 
-  void ProcessTransitions(const vector<Element> &closed_subset, OutputStateId state) {
+  void ProcessTransitions(const vector<Element> &closed_subset, OutputStateId state,
+                          vector<PendingArc> *pending = NULL) {
     vector<pair<Label, Element> > all_elems;
     {  // Push back into "all_elems", elements corresponding to all non-epsilon-input transitions
       // out of all states in "closed_subset".
@@ -725,9 +937,9 @@ template<class Arc> class DeterminizerStar {
               next_elem.string = elem.string;
             else {
               vector<Label> seq;
-              repository_.SeqOfId(elem.string, &seq);
+              SeqOfId(elem.string, &seq);
               seq.push_back(arc.olabel);
-              next_elem.string = repository_.IdOfSeq(seq);
+              next_elem.string = IdOfSeq(seq);
             }
             all_elems.push_back(this_pr);
           }
@@ -749,7 +961,7 @@ template<class Arc> class DeterminizerStar {
         cur++;
       }
       // We now have a subset for this ilabel.
-      ProcessTransition(state, ilabel, &this_subset);
+      ProcessTransition(state, ilabel, &this_subset, pending);
     }
   }
 
@@ -760,20 +972,23 @@ template<class Arc> class DeterminizerStar {
 
   OutputStateId SubsetToStateId(const vector<Element> &subset) {  // may add the subset to the queue.
     typedef typename SubsetHash::iterator IterType;
-    IterType iter = hash_.find(&subset);
+    SubsetRange key;
+    key.begin = (subset.empty() ? NULL : &(subset[0]));
+    key.size = subset.size();
+    IterType iter = hash_.find(key);
     if (iter == hash_.end()) {  // was not there.
-      vector<Element> *new_subset = new vector<Element>(subset);
+      SubsetRange new_subset = CopyToPool(subset);
       OutputStateId new_state_id = (OutputStateId) output_arcs_.size();
-      hash_[new_subset] = new_state_id;
+      hash_.insert(std::make_pair(new_subset, new_state_id));
       output_arcs_.push_back(vector<TempArc>());
       if (allow_partial_ == false) {
         // If --allow-partial is not requested, we do the old way.
-        Q_.push_front(pair<vector<Element>*, OutputStateId>(new_subset,  new_state_id));
+        Q_.push_front(pair<SubsetRange, OutputStateId>(new_subset,  new_state_id));
       } else {
         // If --allow-partial is requested, we do breadth first search. This
         // ensures that when we return partial results, we return the states
         // that are reachable by the fewest steps from the start state.
-        Q_.push_back(pair<vector<Element>*, OutputStateId>(new_subset,  new_state_id));
+        Q_.push_back(pair<SubsetRange, OutputStateId>(new_subset,  new_state_id));
       }
       return new_state_id;
     } else {
@@ -789,18 +1004,19 @@ template<class Arc> class DeterminizerStar {
   // of the state, and then handle transitions out (this may add more determinized states
   // to the queue).
 
-  void ProcessSubset(const pair<vector<Element>*, OutputStateId> & pair) {
-    const vector<Element> *subset = pair.first;
+  void ProcessSubset(const pair<SubsetRange, OutputStateId> & pair) {
     OutputStateId state = pair.second;
 
     vector<Element> closed_subset;  // subset after epsilon closure.
-    EpsilonClosure(*subset, &closed_subset);
+    EpsilonClosure(pair.first, &closed_subset);
 
     // Now follow non-epsilon arcs [and also process final states]
     ProcessFinal(closed_subset, state);
 
     // Now handle transitions out of these states.
     ProcessTransitions(closed_subset, state);
+
+    ShrinkArcs(state);
   }
 
   void Debug() {  // this function called if you send a signal
@@ -867,7 +1083,7 @@ template<class Arc> class DeterminizerStar {
 
 
   DISALLOW_COPY_AND_ASSIGN(DeterminizerStar);
-  deque<pair<vector<Element>*, OutputStateId> > Q_;  // queue of subsets to be processed.
+  deque<pair<SubsetRange, OutputStateId> > Q_;  // queue of subsets to be processed.
 
   vector<vector<TempArc> > output_arcs_;  // essentially an FST in our format.
 
@@ -877,21 +1093,31 @@ template<class Arc> class DeterminizerStar {
   bool determinized_; // used to check usage.
   bool allow_partial_;  // output paritial results or not
   bool is_partial_;     // if we get partial results or not
+  int num_threads_;  // number of threads used in Determinize().
   SubsetKey hasher_;  // object that computes keys-- has no data members.
   SubsetEqual equal_;  // object that compares subsets-- only data member is delta_.
   SubsetHash hash_;  // hash from Subset to StateId in final Fst.
 
+  vector<Element*> subset_pool_;  // The blocks of memory that hold the subsets.
+  Element *pool_block_;  // The block we are currently filling (the last one),
+  size_t pool_block_size_;  // its size in Elements,
+  size_t pool_block_used_;  // and how many of them are used.
+
   StringRepository<Label, StringId> repository_;  // associate integer id's with sequences of labels.
+  kaldi::Mutex repository_mutex_;  // locks repository_ in multi-threaded mode.
+  kaldi::Mutex error_mutex_;  // locks thread_error_.
+  std::string thread_error_;  // the first error from an ExpandSubsetsClass thread.
 };
 
 
 template<class Arc>
 bool DeterminizeStar(Fst<Arc> &ifst, MutableFst<Arc> *ofst,
                      float delta, bool *debug_ptr, int max_states,
-                     bool allow_partial) {
+                     bool allow_partial, int num_threads) {
   ofst->SetOutputSymbols(ifst.OutputSymbols());
   ofst->SetInputSymbols(ifst.InputSymbols());
-  DeterminizerStar<Arc> det(ifst, delta, max_states, allow_partial);
+  DeterminizerStar<Arc> det(ifst, delta, max_states, allow_partial,
+                            num_threads);
   det.Determinize(debug_ptr);
   det.Output(ofst);
   return det.IsPartial();
@@ -901,10 +1127,11 @@ bool DeterminizeStar(Fst<Arc> &ifst, MutableFst<Arc> *ofst,
 template<class Arc>
 bool DeterminizeStar(Fst<Arc> &ifst, MutableFst<GallicArc<Arc> > *ofst, float delta,
                      bool *debug_ptr, int max_states,
-                     bool allow_partial) {
+                     bool allow_partial, int num_threads) {
   ofst->SetOutputSymbols(ifst.InputSymbols());
   ofst->SetInputSymbols(ifst.InputSymbols());
-  DeterminizerStar<Arc> det(ifst, delta, max_states, allow_partial);
+  DeterminizerStar<Arc> det(ifst, delta, max_states, allow_partial,
+                            num_threads);
   det.Determinize(debug_ptr);
   det.Output(ofst);
   return det.IsPartial();
@@ -55,6 +55,32 @@ template<class Arc> void TestDeterminizeGeneral() {
 }
 
 
+// test that multi-threaded determinization gives an equivalent result, with
+// the same number of states, as the single-threaded version.
+template<class Arc> void TestDeterminizeParallel() {
+  int max_states = 100; // don't allow more det-states than this.
+  for(int i = 0; i < 20; i++) {
+    VectorFst<Arc> *fst = RandFst<Arc>();
+    VectorFst<Arc> ofst, ofst_parallel;
+    bool succeeded = true;
+    try {
+      DeterminizeStar<Arc>(*fst, &ofst, kDelta, NULL, max_states);
+    } catch (...) {
+      succeeded = false;
+    }
+    if (succeeded) {
+      int num_threads = 2 + rand() % 3;
+      DeterminizeStar<Arc>(*fst, &ofst_parallel, kDelta, NULL, max_states,
+                           false, num_threads);
+      assert(ofst.NumStates() == ofst_parallel.NumStates());
+      assert(RandEquivalent(ofst, ofst_parallel, 5/*paths*/, 0.01/*delta*/,
+                            rand()/*seed*/, 100/*path length, max*/));
+    }
+    delete fst;
+  }
+}
+
+
 // Don't instantiate with log semiring, as RandEquivalent may fail.
 template<class Arc>  void TestDeterminize() {
   typedef typename Arc::Label Label;
@@ -498,6 +524,7 @@ int main() {
     fst::TestStringRepository<fst::StdArc, unsigned char>();
     fst::TestStringRepository<fst::StdArc, char>();
     fst::TestDeterminizeGeneral<fst::StdArc>();
+    fst::TestDeterminizeParallel<fst::StdArc>();
     fst::TestDeterminize<fst::StdArc>();
     // fst::TestDeterminize2<fst::StdArc>();
     fst::TestPush<fst::StdArc>();
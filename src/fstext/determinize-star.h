@@ -61,7 +61,9 @@ namespace fst {
    The algorithm is a fairly normal determinization algorithm.  We keep in
    memory the subsets of states, together with their leftover strings and their
    weights.  The only difference is we detect input epsilon transitions and
-   treat them "specially".
+   treat them "specially".  The subsets are stored packed together in large
+   blocks of memory, which matters for very large inputs such as the HCLG of
+   a large vocabulary.
 */
 
 
@@ -81,13 +83,18 @@ namespace fst {
     out an error.
     The function will return false if partial FST is generated, and true if the
     complete determinized FST is generated.
+    If num_threads > 1, the determinized states are expanded (epsilon closure
+    and transitions out) by that many threads in parallel; this is only done
+    for expanded FSTs such as VectorFst, which are safe to read from several
+    threads.
 */
 template<class Arc>
 bool DeterminizeStar(Fst<Arc> &ifst, MutableFst<Arc> *ofst,
                      float delta = kDelta,
                      bool *debug_ptr = NULL,
                      int max_states = -1,
-                     bool allow_partial = false);
+                     bool allow_partial = false,
+                     int num_threads = 1);
 
 
 
@@ -101,12 +108,14 @@ bool DeterminizeStar(Fst<Arc> &ifst, MutableFst<Arc> *ofst,
     out an error.
     The function will return false if partial FST is generated, and true if the
     complete determinized FST is generated.
+    num_threads is as for the other version.
 */
 template<class Arc>
 bool DeterminizeStar(Fst<Arc> &ifst, MutableFst<GallicArc<Arc> > *ofst,
                      float delta = kDelta, bool *debug_ptr = NULL,
                      int max_states = -1,
-                     bool allow_partial = false);
+                     bool allow_partial = false,
+                     int num_threads = 1);
 
 
 /// @} end "addtogroup fst_extensions"
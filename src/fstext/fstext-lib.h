@@ -32,4 +32,7 @@
 #include "lattice-utils.h"
 #include "determinize-lattice.h"
 #include "deterministic-fst.h"
+#include "mapped-fst.h"
+#include "lookahead-compose.h"
+#include "parallel-compose.h"
 #endif
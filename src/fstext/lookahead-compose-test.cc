@@ -0,0 +1,61 @@
+// fstext/lookahead-compose-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "fstext/rand-fst.h"
+#include "fstext/lookahead-compose.h"
+
+
+namespace fst {
+
+// Checks that the on-the-fly lookahead composition is equivalent to the
+// normal composition, with a cache small enough that it gets
+// garbage-collected.
+void TestComposeLookAhead() {
+  for (int32 i = 0; i < 10; i++) {
+    RandFstOptions opts;
+    VectorFst<StdArc> *hcl = RandFst<StdArc>(opts);
+    VectorFst<StdArc> *g = RandFst<StdArc>(opts);
+
+    VectorFst<StdArc> sorted_g(*g), expected;
+    ArcSort(&sorted_g, ILabelCompare<StdArc>());
+    Compose(*hcl, sorted_g, &expected);
+
+    LookAheadHclFst *la_hcl = PrepareLookAheadHcl(*hcl);
+    PrepareLookAheadG(*la_hcl, g);
+    Fst<StdArc> *composed = ComposeLookAhead(*la_hcl, *g, 1024);
+    delete la_hcl;
+    delete hcl;
+    delete g;
+
+    VectorFst<StdArc> composed_vec(*composed);
+    delete composed;
+    assert(RandEquivalent(expected, composed_vec, 5/*paths*/, 0.01/*delta*/,
+                          rand()/*seed*/, 100/*path length, max*/));
+  }
+}
+
+} // namespace fst
+
+int main() {
+  for (int i = 0; i < 5; i++) {
+    fst::TestComposeLookAhead();
+  }
+  std::cout << "Test OK\n";
+}
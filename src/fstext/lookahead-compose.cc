@@ -0,0 +1,70 @@
+// fstext/lookahead-compose.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fstext/lookahead-compose.h"
+#include "fstext/fstext-utils.h"
+#include "fstext/mapped-fst.h"
+#include "base/kaldi-error.h"
+
+namespace fst {
+
+const char kLookAheadHclFstType[] = "kaldi_olabel_lookahead";
+
+
+LookAheadHclFst *PrepareLookAheadHcl(const Fst<StdArc> &hcl) {
+  // The constructor works out, for each state of HCL, the range of (relabeled)
+  // output labels reachable from it, which is what the lookahead uses.
+  return new LookAheadHclFst(hcl);
+}
+
+
+void PrepareLookAheadG(const LookAheadHclFst &hcl, MutableFst<StdArc> *g) {
+  LabelLookAheadRelabeler<StdArc>::Relabel(g, hcl, true);
+  ArcSort(g, ILabelCompare<StdArc>());
+}
+
+
+Fst<StdArc> *ComposeLookAhead(const LookAheadHclFst &hcl,
+                              const Fst<StdArc> &g,
+                              size_t cache_size) {
+  if (g.Properties(kILabelSorted, true) == 0)
+    KALDI_ERR << "ComposeLookAhead: G is not sorted on its input labels "
+              << "(was it prepared with PrepareLookAheadG()?)";
+  // The ComposeFst constructor sees that hcl has a lookahead matcher and
+  // chooses the lookahead compose filter, with weight and label pushing.
+  CacheOptions opts(true, cache_size);
+  return new ComposeFst<StdArc>(hcl, g, opts);
+}
+
+
+Fst<StdArc> *ReadLookAheadDecodingGraph(std::string hcl_rxfilename,
+                                        std::string g_rxfilename,
+                                        size_t cache_size) {
+  Fst<StdArc> *hcl = ReadDecodingGraph(hcl_rxfilename);
+  LookAheadHclFst *la_hcl = PrepareLookAheadHcl(*hcl);
+  delete hcl;
+  VectorFst<StdArc> *g = ReadFstKaldi(g_rxfilename);
+  PrepareLookAheadG(*la_hcl, g);
+  Fst<StdArc> *ans = ComposeLookAhead(*la_hcl, *g, cache_size);
+  delete la_hcl;  // the ComposeFst holds its own copies.
+  delete g;
+  return ans;
+}
+
+}  // namespace fst
@@ -0,0 +1,104 @@
+// fstext/lookahead-compose.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FSTEXT_LOOKAHEAD_COMPOSE_H_
+#define KALDI_FSTEXT_LOOKAHEAD_COMPOSE_H_
+
+#include <string>
+#include <fst/fstlib.h>
+#include <fst/fst-decl.h>
+#include <fst/matcher-fst.h>
+
+namespace fst {
+
+/*
+  This header provides on-the-fly composition of the decoding graph: instead of
+  expanding HCLG = HCL o G in advance, the decoder is given a ComposeFst that
+  works out the states of HCL o G as the search reaches them.  This is useful
+  when G changes often (e.g. per-user grammars) or is too large to compose
+  with HCL in advance.
+
+  HCL is converted to an FST with label lookahead on its output (word) side,
+  and the input labels of G are relabeled to match.  The composition then uses
+  the lookahead compose filter, which (for the tropical semiring) pushes the
+  weights and labels of G towards the start of HCL, so the LM scores are
+  available to the pruning as early as they would be in a statically
+  composed, weight-pushed HCLG, and dead-end paths are never expanded.
+
+  HCL should be prepared as for the normal graph-building recipe, i.e.
+  determinized and minimized with the disambiguation symbols, but with the
+  disambiguation symbols on its input side (the transition-ids) then replaced
+  by epsilons (fstrmsymbols), since the decoders do not expect them.  It must
+  keep its #0 self-loops on the output side, which match the backoff arcs of G.
+*/
+
+/// The flags of the label-lookahead matcher we use for HCL; these are the
+/// same as those of OpenFst's olabel_lookahead FST type.
+const uint32 kHclLookAheadFlags = kOutputLookAheadMatcher |
+    kLookAheadWeight | kLookAheadPrefix | kLookAheadEpsilons |
+    kLookAheadNonEpsilonPrefix;
+
+/// The type name of LookAheadHclFst (defined in lookahead-compose.cc).  We
+/// define our own type rather than use OpenFst's StdOLabelLookAheadFst,
+/// because the latter is only defined in an OpenFst extension library that
+/// is not built by default.
+extern const char kLookAheadHclFstType[];
+
+/// HCL as a ConstFst, with the data needed for label lookahead on its output
+/// side.
+typedef MatcherFst<ConstFst<StdArc>,
+                   LabelLookAheadMatcher<SortedMatcher<ConstFst<StdArc> >,
+                                         kHclLookAheadFlags,
+                                         FastLogAccumulator<StdArc> >,
+                   kLookAheadHclFstType,
+                   LabelLookAheadRelabeler<StdArc> > LookAheadHclFst;
+
+
+/// Converts "hcl" into a LookAheadHclFst.  Note: this relabels the output
+/// labels (words) of HCL, so any G to be composed with it must be prepared
+/// with PrepareLookAheadG(), with the LookAheadHclFst this returns.
+LookAheadHclFst *PrepareLookAheadHcl(const Fst<StdArc> &hcl);
+
+/// Relabels the input labels of "g" in the same way as the output labels of
+/// "hcl" were relabeled, and sorts its arcs on the input label, as required
+/// by ComposeLookAhead().  G may be changed (and prepared again) as often as
+/// needed without re-doing PrepareLookAheadHcl().
+void PrepareLookAheadG(const LookAheadHclFst &hcl, MutableFst<StdArc> *g);
+
+/// Returns HCL o G, as a ComposeFst whose states are computed when they are
+/// first visited.  "g" must have been prepared with PrepareLookAheadG().
+/// The states computed are cached, with garbage collection of the cache once
+/// it uses more than "cache_size" bytes, so the memory used stays bounded
+/// however much of the graph the search visits.  The ComposeFst keeps its own
+/// copies of "hcl" and "g", so they may be deleted before it.  The result can
+/// be given to any of the decoders, which will use the generic Fst interface.
+/// The caller owns the result.
+Fst<StdArc> *ComposeLookAhead(const LookAheadHclFst &hcl,
+                              const Fst<StdArc> &g,
+                              size_t cache_size);
+
+/// Reads HCL and G from the given rxfilenames and returns their lookahead
+/// composition, as ComposeLookAhead().  The caller owns the result.
+Fst<StdArc> *ReadLookAheadDecodingGraph(std::string hcl_rxfilename,
+                                        std::string g_rxfilename,
+                                        size_t cache_size);
+
+}  // namespace fst
+
+#endif  // KALDI_FSTEXT_LOOKAHEAD_COMPOSE_H_
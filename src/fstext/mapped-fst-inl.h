@@ -0,0 +1,213 @@
+// fstext/mapped-fst-inl.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FSTEXT_MAPPED_FST_INL_H_
+#define KALDI_FSTEXT_MAPPED_FST_INL_H_
+
+#include <cstring>
+#include <fstream>
+#include "base/kaldi-common.h"
+
+namespace fst {
+
+static const char kMappedConstFstMagic[16] = "kaldi-mappedfst";
+static const int32 kMappedConstFstVersion = 1;
+
+inline bool MappedConstFst::IsMappedConstFst(const std::string &filename) {
+  std::ifstream is(filename.c_str(), std::ios::in | std::ios::binary);
+  char magic[16];
+  if (!is.read(magic, sizeof(magic)))
+    return false;
+  return (memcmp(magic, kMappedConstFstMagic, sizeof(magic)) == 0);
+}
+
+inline MappedConstFst::Data *MappedConstFst::MapFile(
+    const std::string &filename) {
+  Data *data = new Data;
+  if (!data->file.Open(filename)) {
+    delete data;
+    return NULL;
+  }
+  data->filename = filename;
+  data->ref_count = 1;
+  const char *begin = data->file.Data();
+  size_t size = data->file.Size();
+  data->header = reinterpret_cast<const MappedConstFstHeader*>(begin);
+  const MappedConstFstHeader &h = *(data->header);
+  if (size < sizeof(MappedConstFstHeader) ||
+      memcmp(h.magic, kMappedConstFstMagic, sizeof(h.magic)) != 0) {
+    KALDI_WARN << "File " << filename << " is not a mapped FST (use "
+               << "fstmakemapped to create one).";
+    delete data;
+    return NULL;
+  }
+  if (h.version != kMappedConstFstVersion ||
+      h.state_size != static_cast<int32>(sizeof(State)) ||
+      h.arc_size != static_cast<int32>(sizeof(Arc))) {
+    KALDI_WARN << "Mapped FST " << filename << " has unexpected version or "
+               << "sizes; it may have been written on a machine with a "
+               << "different byte order, or by a different version of the code.";
+    delete data;
+    return NULL;
+  }
+  size_t expected_size = sizeof(MappedConstFstHeader) +
+      h.num_states * sizeof(State) + h.num_arcs * sizeof(Arc);
+  if (h.num_states < 0 || h.num_arcs < 0 || size != expected_size ||
+      h.start < kNoStateId || h.start >= h.num_states) {
+    KALDI_WARN << "Mapped FST " << filename << " is corrupt or truncated "
+               << "(size is " << size << ", expected " << expected_size << ")";
+    delete data;
+    return NULL;
+  }
+  data->states = reinterpret_cast<const State*>(
+      begin + sizeof(MappedConstFstHeader));
+  data->arcs = reinterpret_cast<const Arc*>(
+      begin + sizeof(MappedConstFstHeader) + h.num_states * sizeof(State));
+  return data;
+}
+
+inline MappedConstFst *MappedConstFst::Read(const std::string &filename) {
+  Data *data = MapFile(filename);
+  if (data == NULL)
+    return NULL;
+  return new MappedConstFst(data);
+}
+
+inline MappedConstFst::MappedConstFst(const MappedConstFst &other):
+    ExpandedFst<StdArc>(), data_(other.data_) {
+  data_->ref_count++;
+}
+
+inline MappedConstFst::~MappedConstFst() {
+  if (--(data_->ref_count) == 0)
+    delete data_;
+}
+
+inline MappedConstFst *MappedConstFst::Copy(bool safe) const {
+  if (!safe)
+    return new MappedConstFst(*this);
+  Data *data = MapFile(data_->filename);
+  if (data == NULL)
+    KALDI_ERR << "Could not map FST " << data_->filename << " again.";
+  return new MappedConstFst(data);
+}
+
+inline uint64 MappedConstFst::Properties(uint64 mask, bool test) const {
+  if (test) {
+    uint64 known;
+    return TestProperties(*this, mask, &known) & mask;
+  } else {
+    return ((data_->header->properties & kCopyProperties) | kExpanded) & mask;
+  }
+}
+
+
+inline bool WriteMappedConstFst(const ExpandedFst<StdArc> &fst,
+                                std::ostream &os) {
+  typedef StdArc Arc;
+  typedef Arc::StateId StateId;
+  KALDI_ASSERT(sizeof(MappedConstFstHeader) == 64);
+  StateId num_states = fst.NumStates();
+  int64 num_arcs = 0;
+  for (StateId s = 0; s < num_states; s++)
+    num_arcs += fst.NumArcs(s);
+
+  MappedConstFstHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, kMappedConstFstMagic, sizeof(h.magic));
+  h.version = kMappedConstFstVersion;
+  h.state_size = sizeof(MappedConstFst::State);
+  h.arc_size = sizeof(Arc);
+  h.start = fst.Start();
+  h.num_states = num_states;
+  h.num_arcs = num_arcs;
+  h.properties = fst.Properties(kCopyProperties, false);
+  os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+  int64 arc_offset = 0;
+  for (StateId s = 0; s < num_states; s++) {
+    MappedConstFst::State state;
+    memset(&state, 0, sizeof(state));
+    state.arc_offset = arc_offset;
+    state.final_cost = fst.Final(s).Value();
+    state.num_arcs = fst.NumArcs(s);
+    state.num_input_epsilons = fst.NumInputEpsilons(s);
+    state.num_output_epsilons = fst.NumOutputEpsilons(s);
+    os.write(reinterpret_cast<const char*>(&state), sizeof(state));
+    arc_offset += state.num_arcs;
+  }
+  for (StateId s = 0; s < num_states; s++) {
+    for (ArcIterator<ExpandedFst<Arc> > aiter(fst, s); !aiter.Done();
+         aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      os.write(reinterpret_cast<const char*>(&arc), sizeof(arc));
+    }
+  }
+  return os.good();
+}
+
+
+inline Fst<StdArc> *ReadDecodingGraph(std::string rxfilename) {
+  if (rxfilename == "") rxfilename = "-";  // interpret "" as stdin.
+  if (kaldi::ClassifyRxfilename(rxfilename) == kaldi::kFileInput &&
+      MappedConstFst::IsMappedConstFst(rxfilename)) {
+    Fst<StdArc> *ans = MappedConstFst::Read(rxfilename);
+    if (ans == NULL)
+      KALDI_ERR << "Could not map decoding graph " << rxfilename;
+    return ans;
+  }
+  kaldi::Input ki(rxfilename);
+  FstHeader hdr;
+  if (!hdr.Read(ki.Stream(), rxfilename))
+    KALDI_ERR << "Reading FST: error reading FST header from "
+              << kaldi::PrintableRxfilename(rxfilename)
+              << " (note: mapped FSTs cannot be read from a pipe)";
+  if (hdr.ArcType() != StdArc::Type())
+    KALDI_ERR << "FST with arc type " << hdr.ArcType() << " not supported.";
+  FstReadOptions ropts("<unspecified>", &hdr);
+  Fst<StdArc> *ans = NULL;
+  if (hdr.FstType() == "vector") {
+    ans = VectorFst<StdArc>::Read(ki.Stream(), ropts);
+  } else if (hdr.FstType() == "const") {
+    ans = ConstFst<StdArc>::Read(ki.Stream(), ropts);
+  } else {
+    KALDI_ERR << "Reading FST: unsupported FST type: " << hdr.FstType();
+  }
+  if (ans == NULL)
+    KALDI_ERR << "Could not read fst from "
+              << kaldi::PrintableRxfilename(rxfilename);
+  return ans;
+}
+
+inline Fst<StdArc> *CopyDecodingGraph(const Fst<StdArc> &fst) {
+  // The constructors from a generic Fst<StdArc> copy the states and arcs
+  // (the ones from the same type would just share the implementation).
+  switch (GetDecodingGraphType(fst)) {
+    case kConstGraph:
+      return new ConstFst<StdArc>(fst);
+    case kMappedConstGraph:
+      return NULL;
+    default:
+      return new VectorFst<StdArc>(fst);
+  }
+}
+
+} // end namespace fst
+
+#endif  // KALDI_FSTEXT_MAPPED_FST_INL_H_
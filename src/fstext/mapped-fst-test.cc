@@ -0,0 +1,98 @@
+// fstext/mapped-fst-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "fstext/rand-fst.h"
+#include "fstext/mapped-fst.h"
+#include <cstdio>
+
+
+namespace fst {
+
+// Checks that the specialized iterators give the same as the generic ones.
+void CheckMappedIterators(const MappedConstFst &mapped,
+                          const VectorFst<StdArc> &fst) {
+  int32 num_states = 0;
+  for (StateIterator<MappedConstFst> siter(mapped); !siter.Done();
+       siter.Next(), num_states++) {
+    StdArc::StateId s = siter.Value();
+    assert(s == num_states);
+    assert(mapped.NumInputEpsilons(s) == fst.NumInputEpsilons(s));
+    assert(mapped.NumOutputEpsilons(s) == fst.NumOutputEpsilons(s));
+    ArcIterator<VectorFst<StdArc> > aiter2(fst, s);
+    for (ArcIterator<MappedConstFst> aiter(mapped, s); !aiter.Done();
+         aiter.Next(), aiter2.Next()) {
+      assert(!aiter2.Done());
+      const StdArc &arc = aiter.Value(), &arc2 = aiter2.Value();
+      assert(arc.ilabel == arc2.ilabel && arc.olabel == arc2.olabel &&
+             arc.nextstate == arc2.nextstate && arc.weight == arc2.weight);
+    }
+    assert(aiter2.Done());
+  }
+  assert(num_states == fst.NumStates());
+}
+
+void TestMappedConstFst() {
+  for (int32 i = 0; i < 10; i++) {
+    RandFstOptions opts;
+    VectorFst<StdArc> *fst = RandFst<StdArc>(opts);
+    {
+      std::ofstream os("tmpf.mapped", std::ios::out | std::ios::binary);
+      assert(WriteMappedConstFst(*fst, os));
+    }
+    assert(MappedConstFst::IsMappedConstFst("tmpf.mapped"));
+    MappedConstFst *mapped = MappedConstFst::Read("tmpf.mapped");
+    assert(mapped != NULL);
+    assert(Equal(*fst, *mapped));
+    assert(mapped->Properties(kExpanded, false) == kExpanded);
+    CheckMappedIterators(*mapped, *fst);
+
+    MappedConstFst *copy1 = mapped->Copy(), *copy2 = mapped->Copy(true);
+    delete mapped;
+    assert(Equal(*fst, *copy1) && Equal(*fst, *copy2));
+    delete copy1;
+    delete copy2;
+
+    // ReadDecodingGraph() should accept either format.
+    fst->Write("tmpf.fst");
+    assert(!MappedConstFst::IsMappedConstFst("tmpf.fst"));
+    Fst<StdArc> *graph1 = ReadDecodingGraph("tmpf.fst"),
+        *graph2 = ReadDecodingGraph("tmpf.mapped");
+    assert(graph1->Type() == "vector" && graph2->Type() == "mapped-const");
+    assert(Equal(*graph1, *graph2));
+    delete graph1;
+    delete graph2;
+    ConstFst<StdArc> cfst(*fst);
+    cfst.Write("tmpf.fst");
+    Fst<StdArc> *graph3 = ReadDecodingGraph("tmpf.fst");
+    assert(graph3->Type() == "const" && Equal(*fst, *graph3));
+    delete graph3;
+    delete fst;
+  }
+  std::remove("tmpf.mapped");
+  std::remove("tmpf.fst");
+}
+
+} // end namespace fst
+
+int main() {
+  using namespace fst;
+  TestMappedConstFst();
+  std::cout << "Test OK\n";
+}
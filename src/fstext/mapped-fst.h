@@ -0,0 +1,277 @@
+// fstext/mapped-fst.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FSTEXT_MAPPED_FST_H_
+#define KALDI_FSTEXT_MAPPED_FST_H_
+
+#include <string>
+#include <iostream>
+#include <fst/fstlib.h>
+#include <fst/test-properties.h>
+#include "util/kaldi-io.h"
+#include "util/kaldi-mmap.h"
+
+/* This header defines MappedConstFst, a read-only FST over StdArc whose data
+   is a file that is memory-mapped, rather than read, when the FST is
+   "loaded".  It is intended for large decoding graphs (HCLG): loading is
+   instantaneous, only the parts of the graph that the decoder visits are ever
+   paged in, and because the mapping is shared, the pages are held in memory
+   only once however many processes on the machine decode with the same graph.
+
+   The layout is like that of OpenFst's ConstFst: a header, then an array of
+   fixed-size per-state records, then a single array of all the arcs, in state
+   order, so the arcs of a state are contiguous in memory.  The format is native
+   binary (not portable between machines with different byte order); it is
+   created with the program fstmakemapped from an ordinary FST.  Symbol tables
+   are not stored.
+*/
+
+namespace fst {
+
+/// The header at the start of a file as written by WriteMappedConstFst().
+/// It is 64 bytes long, so the state records that follow it are aligned.
+struct MappedConstFstHeader {
+  char magic[16];  // "kaldi-mappedfst", NUL-terminated.
+  int32 version;
+  int32 state_size;  // sizeof(MappedConstFst::State), as a check.
+  int32 arc_size;  // sizeof(StdArc), as a check.
+  int32 start;
+  int64 num_states;
+  int64 num_arcs;
+  uint64 properties;
+  char padding[8];
+};
+
+
+class MappedConstFst: public ExpandedFst<StdArc> {
+ public:
+  typedef StdArc Arc;
+  typedef Arc::StateId StateId;
+  typedef Arc::Weight Weight;
+  typedef Arc::Label Label;
+
+  /// The per-state record in the file.
+  struct State {
+    int64 arc_offset;  // index in the arc array of this state's first arc.
+    float final_cost;  // the final weight (+infinity if not final).
+    int32 num_arcs;
+    int32 num_input_epsilons;
+    int32 num_output_epsilons;
+  };
+
+  /// Maps the file, which must have been written by WriteMappedConstFst();
+  /// "filename" must be an actual file, not a pipe or "-".  Returns NULL (with
+  /// a warning) on failure.  Only the header is checked; the states and arcs
+  /// are not read until they are accessed.
+  static MappedConstFst *Read(const std::string &filename);
+
+  /// Returns true if "filename" is a file that starts like one written by
+  /// WriteMappedConstFst().  Does not print a warning if not.
+  static bool IsMappedConstFst(const std::string &filename);
+
+  MappedConstFst(const MappedConstFst &other);
+
+  virtual ~MappedConstFst();
+
+  virtual StateId Start() const { return data_->header->start; }
+
+  virtual Weight Final(StateId s) const {
+    return Weight(data_->states[s].final_cost);
+  }
+
+  virtual StateId NumStates() const { return data_->header->num_states; }
+
+  virtual size_t NumArcs(StateId s) const {
+    return data_->states[s].num_arcs;
+  }
+
+  virtual size_t NumInputEpsilons(StateId s) const {
+    return data_->states[s].num_input_epsilons;
+  }
+
+  virtual size_t NumOutputEpsilons(StateId s) const {
+    return data_->states[s].num_output_epsilons;
+  }
+
+  virtual uint64 Properties(uint64 mask, bool test) const;
+
+  virtual const std::string &Type() const {
+    static const std::string type = "mapped-const";
+    return type;
+  }
+
+  /// If "safe" is true the file is mapped again, so that the copy does not
+  /// share a reference count with this object and may be used (and destroyed)
+  /// in a different thread.
+  virtual MappedConstFst *Copy(bool safe = false) const;
+
+  virtual const SymbolTable *InputSymbols() const { return NULL; }
+
+  virtual const SymbolTable *OutputSymbols() const { return NULL; }
+
+  virtual void InitStateIterator(StateIteratorData<Arc> *data) const {
+    data->base = NULL;
+    data->nstates = NumStates();
+  }
+
+  virtual void InitArcIterator(StateId s, ArcIteratorData<Arc> *data) const {
+    data->base = NULL;
+    data->arcs = Arcs(s);
+    data->narcs = data_->states[s].num_arcs;
+    data->ref_count = NULL;
+  }
+
+  /// Returns a pointer to the first arc leaving state s; used by the
+  /// specialized ArcIterator.
+  const Arc *Arcs(StateId s) const {
+    return data_->arcs + data_->states[s].arc_offset;
+  }
+
+ private:
+  // The mapped file and pointers into it; this is shared between copies
+  // made with Copy(false).
+  struct Data {
+    std::string filename;
+    kaldi::MappedFile file;
+    const MappedConstFstHeader *header;
+    const State *states;
+    const Arc *arcs;
+    int ref_count;
+  };
+
+  explicit MappedConstFst(Data *data): data_(data) { }
+
+  // Maps the file and checks the header; returns NULL on failure.
+  static Data *MapFile(const std::string &filename);
+
+  Data *data_;
+  MappedConstFst &operator = (const MappedConstFst &);  // disallow.
+};
+
+
+/// Writes "fst" in the format read by MappedConstFst::Read().  The stream
+/// should have been opened in binary mode.  Returns false on error.
+inline bool WriteMappedConstFst(const ExpandedFst<StdArc> &fst,
+                                std::ostream &os);
+
+
+/// Reads a decoding graph for use by a decoder, which may be an ordinary
+/// OpenFst file of type "vector" or "const" (in which case it is read into
+/// memory), or a file written by WriteMappedConstFst() (in which case it is
+/// mapped).  Dies on error.  The returned pointer will later need to be
+/// deleted.
+inline Fst<StdArc> *ReadDecodingGraph(std::string rxfilename);
+
+
+/// Returns a deep copy of a decoding graph as returned by ReadDecodingGraph(),
+/// of the same type, whose memory is written by the calling thread; this is
+/// the copy function to use for NumaReplicated (see thread/kaldi-numa.h).
+/// Returns NULL for a MappedConstFst: its pages are in the page cache, shared
+/// with other processes, and we don't copy them.
+inline Fst<StdArc> *CopyDecodingGraph(const Fst<StdArc> &fst);
+
+
+/// The types of decoding graph that the decoders have versions of their inner
+/// loops specialized for (by templating them on the FST type, so the arc
+/// iteration is not done via virtual functions).
+enum DecodingGraphType {
+  kOtherGraph,  // some other type; use the generic Fst<StdArc> interface.
+  kVectorGraph,  // VectorFst<StdArc>
+  kConstGraph,  // ConstFst<StdArc>
+  kMappedConstGraph  // MappedConstFst
+};
+
+/// Works out which of the types in DecodingGraphType "fst" is.
+inline DecodingGraphType GetDecodingGraphType(const Fst<StdArc> &fst) {
+  if (dynamic_cast<const VectorFst<StdArc>*>(&fst) != NULL)
+    return kVectorGraph;
+  else if (dynamic_cast<const ConstFst<StdArc>*>(&fst) != NULL)
+    return kConstGraph;
+  else if (dynamic_cast<const MappedConstFst*>(&fst) != NULL)
+    return kMappedConstGraph;
+  else
+    return kOtherGraph;
+}
+
+
+/// A specialization of ArcIterator for MappedConstFst, which (unlike the
+/// generic one) has no virtual function calls, so that code that is templated
+/// on the FST type can have the arc iteration inlined.
+template<>
+class ArcIterator<MappedConstFst> {
+ public:
+  typedef StdArc Arc;
+  typedef Arc::StateId StateId;
+
+  ArcIterator(const MappedConstFst &fst, StateId s):
+      arcs_(fst.Arcs(s)), narcs_(fst.NumArcs(s)), i_(0) { }
+
+  bool Done() const { return i_ >= narcs_; }
+
+  const Arc &Value() const { return arcs_[i_]; }
+
+  void Next() { ++i_; }
+
+  size_t Position() const { return i_; }
+
+  void Reset() { i_ = 0; }
+
+  void Seek(size_t a) { i_ = a; }
+
+  uint32 Flags() const { return kArcValueFlags; }
+
+  void SetFlags(uint32 flags, uint32 mask) { }
+
+ private:
+  const Arc *arcs_;
+  size_t narcs_;
+  size_t i_;
+  DISALLOW_COPY_AND_ASSIGN(ArcIterator);
+};
+
+
+/// A specialization of StateIterator for MappedConstFst.
+template<>
+class StateIterator<MappedConstFst> {
+ public:
+  typedef StdArc::StateId StateId;
+
+  explicit StateIterator(const MappedConstFst &fst):
+      nstates_(fst.NumStates()), s_(0) { }
+
+  bool Done() const { return s_ >= nstates_; }
+
+  StateId Value() const { return s_; }
+
+  void Next() { ++s_; }
+
+  void Reset() { s_ = 0; }
+
+ private:
+  StateId nstates_;
+  StateId s_;
+  DISALLOW_COPY_AND_ASSIGN(StateIterator);
+};
+
+
+} // end namespace fst
+
+#include "fstext/mapped-fst-inl.h"
+
+#endif  // KALDI_FSTEXT_MAPPED_FST_H_
@@ -0,0 +1,410 @@
+// fstext/parallel-compose-inl.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FSTEXT_PARALLEL_COMPOSE_INL_H_
+#define KALDI_FSTEXT_PARALLEL_COMPOSE_INL_H_
+// Do not include this file directly.  It is included by parallel-compose.h
+
+#include "base/kaldi-error.h"
+#include "thread/kaldi-thread.h"
+
+#ifdef _MSC_VER
+#include <unordered_map>
+#else
+#include <tr1/unordered_map>
+#endif
+using std::tr1::unordered_map;
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+namespace fst {
+
+// This class does the work of TableComposeParallel(); see the comment in
+// parallel-compose.h for the algorithm.
+template<class Arc>
+class ParallelTableComposer {
+ public:
+  typedef typename Arc::Label Label;
+  typedef typename Arc::StateId StateId;
+  typedef typename Arc::Weight Weight;
+
+  ParallelTableComposer(const Fst<Arc> &fst1, const Fst<Arc> &fst2,
+                        const TableComposeOptions &opts, int num_threads):
+      fst1_(fst1), fst2_(fst2), opts_(opts),
+      num_threads_(std::max(num_threads, 1)),
+      match_input_(opts.table_match_type == MATCH_INPUT),
+      shards_(num_threads_) {
+    if (opts.table_match_type != MATCH_INPUT &&
+        opts.table_match_type != MATCH_OUTPUT)
+      KALDI_ERR << "TableComposeParallel: invalid table_match_type";
+    InitLookup();
+  }
+
+  void Compose(MutableFst<Arc> *ofst) {
+    ofst->DeleteStates();
+    ofst->SetInputSymbols(fst1_.InputSymbols());
+    ofst->SetOutputSymbols(fst2_.OutputSymbols());
+    StateId start1 = fst1_.Start(), start2 = fst2_.Start();
+    if (start1 == kNoStateId || start2 == kNoStateId)
+      return;  // Empty result.
+    Tuple start_tuple(start1, start2, 0);
+    Shard &shard = shards_[TupleHash()(start_tuple) % num_threads_];
+    StateId start = ofst->AddState();
+    shard.index[start_tuple] = shard.ids.size();
+    shard.ids.push_back(start);
+    ofst->SetStart(start);
+    queue_.push_back(std::make_pair(start_tuple, start));
+
+    size_t batch_size = kStatesPerThread * num_threads_;
+    std::vector<std::pair<Tuple, StateId> > batch;
+    std::vector<std::vector<PendingArc> > pending;
+    std::vector<Weight> finals;
+    // buckets[t][u] contains the arcs found by thread t whose destination
+    // states are in shards_[u].
+    std::vector<std::vector<std::vector<PendingArc*> > > buckets(
+        num_threads_, std::vector<std::vector<PendingArc*> >(num_threads_));
+    while (!queue_.empty()) {
+      batch.clear();
+      while (!queue_.empty() && batch.size() < batch_size) {
+        batch.push_back(queue_.front());
+        queue_.pop_front();
+      }
+      pending.clear();
+      pending.resize(batch.size());
+      finals.resize(batch.size());
+      for (int t = 0; t < num_threads_; t++)
+        for (int u = 0; u < num_threads_; u++)
+          buckets[t][u].clear();
+      {
+        ExpandClass c(this, &batch, &pending, &finals, &buckets);
+        // The destructor of "m" waits for the threads to finish.
+        kaldi::MultiThreader<ExpandClass> m(num_threads_, c);
+      }
+      {
+        LookupClass c(this, &buckets);
+        kaldi::MultiThreader<LookupClass> m(num_threads_, c);
+      }
+      // Number the new states in the order they were reached, and output
+      // the arcs.
+      for (size_t i = 0; i < batch.size(); i++) {
+        StateId state = batch[i].second;
+        ofst->SetFinal(state, finals[i]);
+        std::vector<PendingArc> &arcs = pending[i];
+        for (size_t j = 0; j < arcs.size(); j++) {
+          const PendingArc &arc = arcs[j];
+          StateId &nextstate = shards_[arc.hash % num_threads_].ids[arc.index];
+          if (nextstate == kNoStateId) {
+            nextstate = ofst->AddState();
+            queue_.push_back(std::make_pair(arc.dest, nextstate));
+          }
+          ofst->AddArc(state, Arc(arc.ilabel, arc.olabel, arc.weight,
+                                  nextstate));
+        }
+      }
+    }
+  }
+
+ private:
+  enum {
+    kStatesPerThread = 256  // Number of states per thread we expand at a time.
+  };
+
+  // A state of the composition: the states of the two FSTs, and the state of
+  // the sequence filter, which is 1 if we got here by a move of ifst2 alone
+  // (in which case ifst1 may not move alone next) and 0 otherwise.
+  struct Tuple {
+    StateId s1;
+    StateId s2;
+    int filter_state;
+    Tuple() { }
+    Tuple(StateId s1, StateId s2, int filter_state):
+        s1(s1), s2(s2), filter_state(filter_state) { }
+    bool operator == (const Tuple &other) const {
+      return s1 == other.s1 && s2 == other.s2 &&
+          filter_state == other.filter_state;
+    }
+  };
+
+  struct TupleHash {
+    size_t operator () (const Tuple &t) const {
+      return static_cast<size_t>(t.s1) * 7853 +
+          static_cast<size_t>(t.s2) * 104147 + t.filter_state;
+    }
+  };
+
+  // An output arc whose destination state has not been numbered yet.
+  struct PendingArc {
+    Label ilabel;
+    Label olabel;
+    Weight weight;
+    Tuple dest;
+    size_t hash;  // TupleHash of dest; dest is in shards_[hash % num_threads_].
+    StateId index;  // Index of dest in that shard's "ids"; set by LookupClass.
+  };
+
+  // The part of the hash of composition states that one thread looks after.
+  struct Shard {
+    // Maps each tuple to its position in "ids".
+    unordered_map<Tuple, StateId, TupleHash> index;
+    // The output state-ids, kNoStateId until they are numbered in Compose().
+    std::vector<StateId> ids;
+  };
+
+  // Expands the states in a contiguous part of the batch, one part per thread.
+  class ExpandClass: public kaldi::MultiThreadable {
+   public:
+    ExpandClass(ParallelTableComposer *composer,
+                const std::vector<std::pair<Tuple, StateId> > *batch,
+                std::vector<std::vector<PendingArc> > *pending,
+                std::vector<Weight> *finals,
+                std::vector<std::vector<std::vector<PendingArc*> > > *buckets):
+        composer_(composer), batch_(batch), pending_(pending), finals_(finals),
+        buckets_(buckets) { }
+    void operator () () {
+      size_t num_states = batch_->size(),
+          begin = num_states * thread_id_ / num_threads_,
+          end = num_states * (thread_id_ + 1) / num_threads_;
+      std::vector<std::vector<PendingArc*> > &buckets = (*buckets_)[thread_id_];
+      for (size_t i = begin; i < end; i++) {
+        std::vector<PendingArc> &arcs = (*pending_)[i];
+        composer_->ExpandState((*batch_)[i].first, &arcs, &((*finals_)[i]));
+        for (size_t j = 0; j < arcs.size(); j++)
+          buckets[arcs[j].hash % num_threads_].push_back(&(arcs[j]));
+      }
+    }
+   private:
+    ParallelTableComposer *composer_;
+    const std::vector<std::pair<Tuple, StateId> > *batch_;
+    std::vector<std::vector<PendingArc> > *pending_;
+    std::vector<Weight> *finals_;
+    std::vector<std::vector<std::vector<PendingArc*> > > *buckets_;
+  };
+
+  // Looks up (or adds) the destination states of the arcs that belong to
+  // shard thread_id_.  No other thread accesses that shard, so no locking is
+  // needed.
+  class LookupClass: public kaldi::MultiThreadable {
+   public:
+    LookupClass(ParallelTableComposer *composer,
+                std::vector<std::vector<std::vector<PendingArc*> > > *buckets):
+        composer_(composer), buckets_(buckets) { }
+    void operator () () {
+      Shard &shard = composer_->shards_[thread_id_];
+      for (int32 t = 0; t < num_threads_; t++) {
+        const std::vector<PendingArc*> &bucket = (*buckets_)[t][thread_id_];
+        for (size_t j = 0; j < bucket.size(); j++) {
+          PendingArc *arc = bucket[j];
+          std::pair<typename unordered_map<Tuple, StateId, TupleHash>::iterator,
+                    bool> ans = shard.index.insert(
+                        std::make_pair(arc->dest,
+                                       static_cast<StateId>(shard.ids.size())));
+          if (ans.second) shard.ids.push_back(kNoStateId);
+          arc->index = ans.first->second;
+        }
+      }
+    }
+   private:
+    ParallelTableComposer *composer_;
+    std::vector<std::vector<std::vector<PendingArc*> > > *buckets_;
+  };
+
+  // The label we look up arcs of the matching side by.
+  Label MatchLabel(const Arc &arc) const {
+    return match_input_ ? arc.ilabel : arc.olabel;
+  }
+
+  // Copies the arcs of the matching side into lookup_arcs_, and creates the
+  // tables for the states that have enough arcs (the same rule as
+  // TableMatcher).
+  void InitLookup() {
+    const Fst<Arc> &fst = (match_input_ ? fst2_ : fst1_);
+    uint64 sorted = (match_input_ ? kILabelSorted : kOLabelSorted);
+    if (fst.Properties(sorted, true) != sorted)
+      KALDI_ERR << "TableComposeParallel: the "
+                << (match_input_ ? "right" : "left")
+                << " FST must be sorted on its "
+                << (match_input_ ? "input" : "output") << " labels.";
+    StateId num_states = CountStates(fst);
+    lookup_begin_.resize(num_states + 1);
+    table_begin_.resize(num_states, -1);
+    for (StateId s = 0; s < num_states; s++) {
+      size_t begin = lookup_arcs_.size();
+      lookup_begin_[s] = begin;
+      for (ArcIterator<Fst<Arc> > aiter(fst, s); !aiter.Done(); aiter.Next())
+        lookup_arcs_.push_back(aiter.Value());
+      size_t num_arcs = lookup_arcs_.size() - begin;
+      if (num_arcs == 0 ||
+          num_arcs < static_cast<size_t>(opts_.min_table_size))
+        continue;
+      Label highest_label = MatchLabel(lookup_arcs_.back());
+      if ((highest_label + 1) * opts_.table_ratio > num_arcs)
+        continue;  // table would be too sparse.
+      table_begin_[s] = tables_.size();
+      tables_.resize(tables_.size() + highest_label + 1, -1);
+      // Go backwards so each entry ends up at the first arc with its label.
+      for (size_t pos = num_arcs; pos-- > 0; ) {
+        Label label = MatchLabel(lookup_arcs_[begin + pos]);
+        KALDI_ASSERT(label >= 0);
+        tables_[table_begin_[s] + label] = pos;
+      }
+    }
+    lookup_begin_[num_states] = lookup_arcs_.size();
+  }
+
+  // Returns the position in lookup_arcs_ of the first arc out of state s
+  // with the matching label "label" (if there is none, the position of
+  // the first arc with a higher label, or the end of the state's arcs).
+  size_t FindFirst(StateId s, Label label) const {
+    size_t begin = lookup_begin_[s], end = lookup_begin_[s + 1];
+    if (table_begin_[s] >= 0) {
+      if (label > MatchLabel(lookup_arcs_[end - 1]))
+        return end;
+      int32 pos = tables_[table_begin_[s] + label];
+      return (pos < 0 ? end : begin + pos);
+    }
+    while (begin < end) {  // Binary search.
+      size_t middle = (begin + end) / 2;
+      if (MatchLabel(lookup_arcs_[middle]) < label) begin = middle + 1;
+      else end = middle;
+    }
+    return begin;
+  }
+
+  inline void AddArc(Label ilabel, Label olabel, Weight weight,
+                     StateId s1, StateId s2, int filter_state,
+                     std::vector<PendingArc> *arcs) const {
+    arcs->resize(arcs->size() + 1);
+    PendingArc &arc = arcs->back();
+    arc.ilabel = ilabel;
+    arc.olabel = olabel;
+    arc.weight = weight;
+    arc.dest = Tuple(s1, s2, filter_state);
+    arc.hash = TupleHash()(arc.dest);
+  }
+
+  // Outputs the final-weight and the arcs (with their destination tuples) of
+  // the composition state "t".  This implements the sequence filter of
+  // OpenFst: ifst1 may not move alone on an epsilon output after ifst2 has
+  // moved alone on an epsilon input, and ifst2 may not move alone if all the
+  // arcs of ifst1 have epsilon outputs and the state is not final.
+  void ExpandState(const Tuple &t, std::vector<PendingArc> *arcs,
+                   Weight *final) const {
+    StateId s1 = t.s1, s2 = t.s2;
+    Weight final1 = fst1_.Final(s1);
+    *final = Times(final1, fst2_.Final(s2));
+    size_t num_eps1 = fst1_.NumOutputEpsilons(s1);
+    bool all_eps1 = (num_eps1 == fst1_.NumArcs(s1) && final1 == Weight::Zero()),
+        no_eps1 = (num_eps1 == 0);
+    int eps2_filter_state = (no_eps1 ? 0 : 1);
+    if (!match_input_) {  // The arcs of ifst1 are in lookup_arcs_.
+      size_t end1 = lookup_begin_[s1 + 1];
+      if (t.filter_state == 0) {  // ifst1 moves alone.
+        for (size_t i = FindFirst(s1, 0);
+             i < end1 && lookup_arcs_[i].olabel == 0; i++) {
+          const Arc &arc1 = lookup_arcs_[i];
+          AddArc(arc1.ilabel, 0, arc1.weight, arc1.nextstate, s2, 0, arcs);
+        }
+      }
+      for (ArcIterator<Fst<Arc> > aiter(fst2_, s2); !aiter.Done();
+           aiter.Next()) {
+        const Arc &arc2 = aiter.Value();
+        if (arc2.ilabel == 0) {  // ifst2 moves alone.
+          if (!all_eps1)
+            AddArc(0, arc2.olabel, arc2.weight, s1, arc2.nextstate,
+                   eps2_filter_state, arcs);
+        } else {
+          for (size_t i = FindFirst(s1, arc2.ilabel);
+               i < end1 && lookup_arcs_[i].olabel == arc2.ilabel; i++) {
+            const Arc &arc1 = lookup_arcs_[i];
+            AddArc(arc1.ilabel, arc2.olabel, Times(arc1.weight, arc2.weight),
+                   arc1.nextstate, arc2.nextstate, 0, arcs);
+          }
+        }
+      }
+    } else {  // The arcs of ifst2 are in lookup_arcs_.
+      size_t end2 = lookup_begin_[s2 + 1];
+      for (ArcIterator<Fst<Arc> > aiter(fst1_, s1); !aiter.Done();
+           aiter.Next()) {
+        const Arc &arc1 = aiter.Value();
+        if (arc1.olabel == 0) {  // ifst1 moves alone.
+          if (t.filter_state == 0)
+            AddArc(arc1.ilabel, 0, arc1.weight, arc1.nextstate, s2, 0, arcs);
+        } else {
+          for (size_t i = FindFirst(s2, arc1.olabel);
+               i < end2 && lookup_arcs_[i].ilabel == arc1.olabel; i++) {
+            const Arc &arc2 = lookup_arcs_[i];
+            AddArc(arc1.ilabel, arc2.olabel, Times(arc1.weight, arc2.weight),
+                   arc1.nextstate, arc2.nextstate, 0, arcs);
+          }
+        }
+      }
+      if (!all_eps1) {  // ifst2 moves alone.
+        for (size_t i = FindFirst(s2, 0);
+             i < end2 && lookup_arcs_[i].ilabel == 0; i++) {
+          const Arc &arc2 = lookup_arcs_[i];
+          AddArc(0, arc2.olabel, arc2.weight, s1, arc2.nextstate,
+                 eps2_filter_state, arcs);
+        }
+      }
+    }
+  }
+
+  const Fst<Arc> &fst1_;
+  const Fst<Arc> &fst2_;
+  TableComposeOptions opts_;
+  int num_threads_;
+  bool match_input_;  // True if we look up the arcs of ifst2 by input label,
+                      // false if those of ifst1 by output label.
+
+  // The arcs of the matching side; those of state s are at positions
+  // lookup_begin_[s] ... lookup_begin_[s+1] - 1.
+  std::vector<Arc> lookup_arcs_;
+  std::vector<size_t> lookup_begin_;
+  // For states with a table, tables_[table_begin_[s] + label] is the offset
+  // (from lookup_begin_[s]) of the first arc with that label, or -1.
+  // table_begin_[s] is -1 for states without a table.
+  std::vector<int64> table_begin_;
+  std::vector<int32> tables_;
+
+  std::vector<Shard> shards_;
+  std::deque<std::pair<Tuple, StateId> > queue_;  // States to be expanded.
+};
+
+
+template<class Arc>
+void TableComposeParallel(const Fst<Arc> &ifst1, const Fst<Arc> &ifst2,
+                          MutableFst<Arc> *ofst,
+                          const TableComposeOptions &opts,
+                          int num_threads) {
+  if (ifst1.Properties(kExpanded, false) == 0 ||
+      ifst2.Properties(kExpanded, false) == 0) {
+    TableCompose(ifst1, ifst2, ofst, opts);
+    return;
+  }
+  {
+    ParallelTableComposer<Arc> composer(ifst1, ifst2, opts, num_threads);
+    composer.Compose(ofst);
+  }
+  if (opts.connect) Connect(ofst);
+}
+
+} // end namespace fst
+
+#endif
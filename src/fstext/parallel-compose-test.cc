@@ -0,0 +1,65 @@
+// fstext/parallel-compose-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fstext/parallel-compose.h"
+#include "fstext/fst-test-utils.h"
+
+namespace fst {
+
+// Checks that TableComposeParallel() is equivalent to Compose(), and that
+// its output does not depend on the number of threads.
+// Don't instantiate with log semiring, as RandEquivalent may fail.
+template<class Arc> void TestTableComposeParallel(bool left) {
+  VectorFst<Arc> *fst1 = RandFst<Arc>();
+  VectorFst<Arc> *fst2 = RandFst<Arc>();
+
+  TableComposeOptions opts;
+  opts.table_match_type = (left ? MATCH_OUTPUT : MATCH_INPUT);
+  opts.min_table_size = 1 + rand() % 5;
+  opts.table_ratio = 0.25 * (rand() % 5);
+
+  ArcSort(fst1, OLabelCompare<Arc>());
+  ArcSort(fst2, ILabelCompare<Arc>());
+
+  VectorFst<Arc> composed_baseline;
+  Compose(*fst1, *fst2, &composed_baseline);
+
+  VectorFst<Arc> composed;
+  TableComposeParallel(*fst1, *fst2, &composed, opts, 1);
+  assert(RandEquivalent(composed, composed_baseline, 3/*paths*/, 0.01/*delta*/,
+                        rand()/*seed*/, 20/*path length-- max?*/));
+
+  for (int num_threads = 2; num_threads <= 4; num_threads++) {
+    VectorFst<Arc> composed_threaded;
+    TableComposeParallel(*fst1, *fst2, &composed_threaded, opts, num_threads);
+    assert(Equal(composed, composed_threaded));
+  }
+  delete fst1;
+  delete fst2;
+}
+
+} // end namespace fst
+
+int main() {
+  for (int i = 0; i < 10; i++) {
+    fst::TestTableComposeParallel<fst::StdArc>(true);
+    fst::TestTableComposeParallel<fst::StdArc>(false);
+  }
+  std::cout << "Test OK\n";
+}
@@ -0,0 +1,62 @@
+// fstext/parallel-compose.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FSTEXT_PARALLEL_COMPOSE_H_
+#define KALDI_FSTEXT_PARALLEL_COMPOSE_H_
+#include <fst/fstlib.h>
+#include <fst/fst-decl.h>
+#include "fstext/table-matcher.h"
+
+
+namespace fst {
+
+/// TableComposeParallel gives the same result as TableCompose() (up to the
+/// numbering of the states), but it is a dedicated composition routine that
+/// writes the VectorFst directly rather than going through ComposeFst, and it
+/// can expand the states in several threads.
+///
+/// The FST on the matching side (the left one if opts.table_match_type ==
+/// MATCH_OUTPUT, which is the default, else the right one) must be sorted on
+/// its output (resp. input) labels, as for TableCompose().  Before starting,
+/// its arcs are copied into flat arrays, with a lookup table from label to
+/// arc for states that have many arcs (see TableMatcherOptions), and binary
+/// search for the others.  The states of the output are then expanded in
+/// breadth-first order, in batches: the arcs out of the states of a batch are
+/// computed in parallel, then the destination states are looked up, also in
+/// parallel, in a hash that is split into one part per thread (a state being
+/// handled by the thread its hash value maps to, so no locking is needed),
+/// and finally the new states are numbered in this thread in the order they
+/// were found.  The output therefore does not depend on the number of
+/// threads.
+///
+/// The sequence filter is always used (opts.filter_type is ignored); the
+/// result is equivalent whatever the filter.  If either input does not have
+/// the kExpanded property, e.g. if it is computed on demand, which would not be
+/// safe to access from several threads, this falls back to TableCompose().
+template<class Arc>
+void TableComposeParallel(const Fst<Arc> &ifst1, const Fst<Arc> &ifst2,
+                          MutableFst<Arc> *ofst,
+                          const TableComposeOptions &opts = TableComposeOptions(),
+                          int num_threads = 1);
+
+} // end namespace fst
+
+#include "fstext/parallel-compose-inl.h"
+
+#endif
@@ -43,7 +43,8 @@ static void TestPushSpecial() {
   VectorFst<Arc> fst_copy(*fst);
 
   float delta = kDelta;
-  PushSpecial(&fst_copy, delta);
+  int num_threads = 1 + rand() % 3;
+  PushSpecial(&fst_copy, delta, num_threads);
 
   Weight min, max;
   float delta_dontcare = 0.1;
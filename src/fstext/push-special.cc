@@ -18,8 +18,11 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <limits>
+
 #include "fstext/push-special.h"
 #include "base/kaldi-error.h"
+#include "thread/kaldi-thread.h"
 
 namespace fst {
 
@@ -106,6 +109,70 @@ namespace fst {
 
 */
             
+// This class is used with RunParallelFor() in PushSpecialClass::Iterate():
+// each copy does the matrix-vector product for a range of states, and its
+// destructor adds its part of the statistics to the totals.
+class PushSpecialIterationClass {
+  typedef StdArc::StateId StateId;
+ public:
+  PushSpecialIterationClass(const std::vector<size_t> &arc_begin,
+                            const std::vector<StateId> &arc_dest,
+                            const std::vector<double> &arc_prob,
+                            const std::vector<double> &occ,
+                            std::vector<double> *new_occ,
+                            double *tot_sumsq,
+                            double *tot_min_ratio, double *tot_max_ratio):
+      arc_begin_(&arc_begin), arc_dest_(&arc_dest), arc_prob_(&arc_prob),
+      occ_(&occ), new_occ_(new_occ), did_work_(false), sumsq_(0.0),
+      min_ratio_(std::numeric_limits<double>::infinity()),
+      max_ratio_(-std::numeric_limits<double>::infinity()),
+      tot_sumsq_(tot_sumsq), tot_min_ratio_(tot_min_ratio),
+      tot_max_ratio_(tot_max_ratio) { }
+
+  void operator () (int32 begin, int32 end) {
+    const size_t *arc_begin = &((*arc_begin_)[0]);
+    const StateId *arc_dest =
+        (arc_dest_->empty() ? NULL : &((*arc_dest_)[0]));
+    const double *arc_prob = (arc_prob_->empty() ? NULL : &((*arc_prob_)[0])),
+        *occ = &((*occ_)[0]);
+    double *new_occ = &((*new_occ_)[0]);
+    for (StateId s = begin; s < end; s++) {
+      double sum = 0.0;
+      for (size_t k = arc_begin[s]; k < arc_begin[s + 1]; k++)
+        sum += arc_prob[k] * occ[arc_dest[k]];
+      // "ratio" is the total weight of state s after pushing with the
+      // current potentials, for the convergence test in Iterate().
+      double ratio = sum / occ[s];
+      min_ratio_ = std::min(min_ratio_, ratio);
+      max_ratio_ = std::max(max_ratio_, ratio);
+      new_occ[s] = 0.1 * occ[s] + sum;
+      sumsq_ += new_occ[s] * new_occ[s];
+    }
+    did_work_ = true;
+  }
+
+  ~PushSpecialIterationClass() {
+    if (did_work_) {
+      *tot_sumsq_ += sumsq_;
+      *tot_min_ratio_ = std::min(*tot_min_ratio_, min_ratio_);
+      *tot_max_ratio_ = std::max(*tot_max_ratio_, max_ratio_);
+    }
+  }
+ private:
+  const std::vector<size_t> *arc_begin_;
+  const std::vector<StateId> *arc_dest_;
+  const std::vector<double> *arc_prob_;
+  const std::vector<double> *occ_;
+  std::vector<double> *new_occ_;
+  bool did_work_;
+  double sumsq_;
+  double min_ratio_;
+  double max_ratio_;
+  double *tot_sumsq_;
+  double *tot_min_ratio_;
+  double *tot_max_ratio_;
+};
+
 class PushSpecialClass {
   typedef StdArc Arc;
   typedef Arc::Weight Weight;
@@ -114,92 +181,87 @@ class PushSpecialClass {
  public:
   // Everything happens in the initializer.
   PushSpecialClass(VectorFst<StdArc> *fst,
-                   float delta): fst_(fst) {
+                   float delta, int num_threads):
+      num_threads_(num_threads), fst_(fst) {
     num_states_ = fst_->NumStates();
     initial_state_ = fst_->Start();
     occ_.resize(num_states_, 1.0 / sqrt(num_states_)); // unit length
     
-    pred_.resize(num_states_);
+    // Store the weights as probabilities, in one flat array ordered by
+    // source state; the final-probs are treated as transitions to the start
+    // state.
+    arc_begin_.resize(num_states_ + 1);
+    size_t num_arcs = 0;
+    for (StateId s = 0; s < num_states_; s++)
+      num_arcs += fst_->NumArcs(s) + 1;
+    arc_dest_.reserve(num_arcs);
+    arc_prob_.reserve(num_arcs);
     for (StateId s = 0; s < num_states_; s++) {
+      arc_begin_[s] = arc_dest_.size();
       for (ArcIterator<VectorFst<StdArc> > aiter(*fst, s);
            !aiter.Done(); aiter.Next()) {
         const Arc &arc = aiter.Value();
-        StateId t = arc.nextstate;
-        double weight = exp(-arc.weight.Value());
-        pred_[t].push_back(std::make_pair(s, weight));
+        arc_dest_.push_back(arc.nextstate);
+        arc_prob_.push_back(exp(-arc.weight.Value()));
       }
       double final = exp(-fst_->Final(s).Value());
-      if (final != 0.0)
-        pred_[initial_state_].push_back(std::make_pair(s, final));
+      if (final != 0.0) {
+        arc_dest_.push_back(initial_state_);
+        arc_prob_.push_back(final);
+      }
     }
+    arc_begin_[num_states_] = arc_dest_.size();
     Iterate(delta);
     ModifyFst();
   }
  private:
-  double TestAccuracy() { // returns the error (the difference
-    // between the min and max weights).
-    double min_sum = 0, max_sum = 0;
-    for (StateId s = 0; s < num_states_; s++) {
-      double sum = 0.0;
-      for (ArcIterator<VectorFst<StdArc> > aiter(*fst_, s);
-           !aiter.Done(); aiter.Next()) {
-        const Arc &arc = aiter.Value();
-        StateId t = arc.nextstate;
-        sum += exp(-arc.weight.Value()) * occ_[t] / occ_[s];
-      }
-      sum += exp(-(fst_->Final(s).Value())) * occ_[initial_state_] / occ_[s];
-      if (s == 0) {
-        min_sum = sum;
-        max_sum = sum;
-      } else {
-        min_sum = std::min(min_sum, sum);
-        max_sum = std::max(max_sum, sum);
-      }
-    }
-    KALDI_VLOG(4) << "min,max is " << min_sum << " " << max_sum;
-    return log(max_sum / min_sum); // In FST world we'll actually
-    // dealing with logs, so the log of the ratio is more suitable
-    // to compare with delta (makes testing the algorithm easier).
-  }
-
+  // The convergence test compares with delta the log of the ratio between
+  // the largest and smallest total weight of a state (its arc probabilities
+  // plus final-prob) after pushing with the current potentials occ_, i.e.
+  //   \sum_t w(s, t) occ(t) / occ(s).
+  // This is a by-product of the matrix-vector product in the next
+  // iteration, so PushSpecialIterationClass computes it there rather than
+  // with a separate pass over the arcs.
   
   void Iterate(float delta) {
     // This is like the power method to find the top eigenvalue of a matrix.
     // We limit it to 2000 iters max, just in case something unanticipated
     // happens, but we should exit due to the "delta" thing, usually after
     // several tens of iterations.
+    std::vector<double> new_occ(num_states_);
     int iter;
     for (iter = 0; iter < 2000; iter++) {
-      std::vector<double> new_occ(num_states_);
       // We initialize new_occ to 0.1 * occ.  A simpler algorithm would
       // initialize them to zero, so it's like the pure power method.  This is
       // like the power method on (M + 0.1 I), and we do it this way to avoid a
       // problem we encountered with certain very simple linear FSTs where the
       // eigenvalues of the weight matrix (including negative and imaginary
       // ones) all have the same magnitude.
-      for (int i = 0; i < num_states_; i++)
-        new_occ[i] = 0.1 * occ_[i];
-      
-      for (int i = 0; i < num_states_; i++) {
-        std::vector<std::pair<StateId, double> >::const_iterator iter,
-            end = pred_[i].end();
-        for (iter = pred_[i].begin(); iter != end; ++iter) {
-          StateId j = iter->first;
-          double p = iter->second;
-          new_occ[j] += occ_[i] * p;
+      double sumsq = 0.0,
+          min_ratio = std::numeric_limits<double>::infinity(),
+          max_ratio = -std::numeric_limits<double>::infinity();
+      PushSpecialIterationClass c(arc_begin_, arc_dest_, arc_prob_, occ_,
+                                  &new_occ, &sumsq, &min_ratio, &max_ratio);
+      kaldi::RunParallelFor(0, num_states_, c, num_threads_);
+
+      // The ratios are for occ_ as it was after the previous iteration, so
+      // this is the convergence test for that iteration.
+      int prev_iter = iter - 1;
+      if (prev_iter % 5 == 0 && prev_iter > 0) {
+        KALDI_VLOG(4) << "min,max is " << min_ratio << " " << max_ratio;
+        // In FST world we'll actually dealing with logs, so the log of the
+        // ratio is more suitable to compare with delta (makes testing the
+        // algorithm easier).
+        if (log(max_ratio / min_ratio) <= delta) {
+          KALDI_VLOG(3) << "Weight-pushing converged after " << prev_iter
+                        << " iterations.";
+          return;
         }
       }
-      double sumsq = 0.0;
-      for (int i = 0; i < num_states_; i++) sumsq += new_occ[i] * new_occ[i];
       lambda_ = std::sqrt(sumsq);
       double inv_lambda = 1.0 / lambda_;
       for (int i = 0; i < num_states_; i++) occ_[i] = new_occ[i] * inv_lambda;
       KALDI_VLOG(4) << "Lambda is " << lambda_;
-      if (iter % 5 == 0 && iter > 0 && TestAccuracy() <= delta) {
-        KALDI_VLOG(3) << "Weight-pushing converged after " << iter
-                      << " iterations.";
-        return;
-      }
     }
     KALDI_WARN << "push-special: finished " << iter
                << " iterations without converging.  Output will be inaccurate.";
@@ -231,12 +293,17 @@ class PushSpecialClass {
  private:
   StateId num_states_;
   StateId initial_state_;
+  int num_threads_;
   std::vector<double> occ_; // the top eigenvector of (matrix of weights) transposed.
   double lambda_; // our current estimate of the top eigenvalue.
   
-  std::vector<std::vector<std::pair<StateId, double> > > pred_; // List of transitions
-  // into each state.  For the start state, this list consists of the list of
-  // states with final-probs, each with their final prob.
+  // The transitions out of each state s, in the form of a matrix in
+  // compressed-sparse-row format: they are arc_dest_[k] and arc_prob_[k] for
+  // arc_begin_[s] <= k < arc_begin_[s+1].  The final-probs are included as
+  // transitions to the start state.
+  std::vector<size_t> arc_begin_;
+  std::vector<StateId> arc_dest_;
+  std::vector<double> arc_prob_;
   
   VectorFst<StdArc> *fst_;
   
@@ -245,9 +312,9 @@ class PushSpecialClass {
 
 
 
-void PushSpecial(VectorFst<StdArc> *fst, float delta) {
+void PushSpecial(VectorFst<StdArc> *fst, float delta, int num_threads) {
   if (fst->NumStates() > 0)
-    PushSpecialClass c(fst, delta); // all the work
+    PushSpecialClass c(fst, delta, num_threads); // all the work
   // gets done in the initializer.
 }
 
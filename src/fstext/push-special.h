@@ -33,10 +33,13 @@ namespace fst {
   at the start or at the end.  Basically it pushes the weights such
   that the total weight of each state (i.e. the sum of the arc
   probabilities plus the final-prob) is the same for all states.
+  The iterations are done with num_threads threads, which is worthwhile for
+  large FSTs such as HCLG.
 */
 
 void PushSpecial(VectorFst<StdArc> *fst,
-                 float delta = kDelta);
+                 float delta = kDelta,
+                 int num_threads = 1);
 
 }
 
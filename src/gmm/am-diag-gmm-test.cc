@@ -21,6 +21,7 @@
 #include "gmm/model-test-common.h"
 #include "gmm/am-diag-gmm.h"
 #include "util/kaldi-io.h"
+#include "thread/kaldi-thread.h"
 
 using kaldi::AmDiagGmm;
 using kaldi::int32;
@@ -86,6 +87,29 @@ void TestSplitStates(const AmDiagGmm &am_gmm) {
   BaseFloat loglike1 = am_gmm1->LogLikelihood(0, feat);
   kaldi::AssertEqual(loglike, loglike1, 1e-2);
 
+  // Splitting and merging give the same result with any number of threads.
+  int32 seed = kaldi::RandInt(0, 1000), num_threads = kaldi::g_num_threads;
+  AmDiagGmm am_gmm2;
+  am_gmm2.CopyFromAmDiagGmm(am_gmm);
+  srand(seed);
+  kaldi::g_num_threads = 1;
+  am_gmm2.SplitByCount(occs, target_comp, 0.01, 0.2, 0.0);
+  am_gmm2.MergeByCount(occs, am_gmm.NumGauss(), 0.2, 0.0);
+  AmDiagGmm am_gmm3;
+  am_gmm3.CopyFromAmDiagGmm(am_gmm);
+  kaldi::g_num_threads = 1 + kaldi::RandInt(1, 4);
+  srand(seed);
+  am_gmm3.SplitByCount(occs, target_comp, 0.01, 0.2, 0.0);
+  am_gmm3.MergeByCount(occs, am_gmm.NumGauss(), 0.2, 0.0);
+  kaldi::g_num_threads = num_threads;
+  KALDI_ASSERT(am_gmm2.NumGauss() == am_gmm3.NumGauss());
+  for (int32 i = 0; i < am_gmm.NumPdfs(); i++) {
+    KALDI_ASSERT(am_gmm2.GetPdf(i).means_invvars().ApproxEqual(
+        am_gmm3.GetPdf(i).means_invvars(), 1.0e-10));
+    KALDI_ASSERT(am_gmm2.GetPdf(i).gconsts().ApproxEqual(
+        am_gmm3.GetPdf(i).gconsts(), 1.0e-10));
+  }
+
   delete am_gmm1;
 }
 
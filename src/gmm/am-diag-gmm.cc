@@ -28,6 +28,7 @@ using std::vector;
 #include "util/stl-utils.h"
 #include "tree/clusterable-classes.h"
 #include "tree/cluster-utils.h"
+#include "thread/kaldi-thread.h"
 
 namespace kaldi {
 
@@ -99,6 +100,38 @@ int32 AmDiagGmm::ComputeGconsts() {
 }
 
 
+// Splits (or merges) the GMMs of a range of pdfs to their targets, for
+// RunParallelFor().
+class SplitOrMergeClass {
+ public:
+  SplitOrMergeClass(const std::vector<int32> &targets, bool merge,
+                    float perturb_factor, uint64 seed,
+                    std::vector<DiagGmm*> *densities):
+      targets_(&targets), merge_(merge), perturb_factor_(perturb_factor),
+      seed_(seed), densities_(densities) { }
+  void operator () (int32 begin, int32 end) {
+    for (int32 i = begin; i < end; i++) {
+      DiagGmm *gmm = (*densities_)[i];
+      int32 target = (*targets_)[i];
+      if (merge_) {
+        if (gmm->NumGauss() > target)
+          gmm->Merge(target);
+      } else if (gmm->NumGauss() < target) {
+        // Each pdf has its own random numbers, so the result doesn't depend
+        // on the number of threads.
+        RandomGenerator rand_gen(seed_, i);
+        gmm->Split(target, perturb_factor_, NULL, &rand_gen);
+      }
+    }
+  }
+ private:
+  const std::vector<int32> *targets_;
+  bool merge_;
+  float perturb_factor_;
+  uint64 seed_;
+  std::vector<DiagGmm*> *densities_;
+};
+
 void AmDiagGmm::SplitByCount(const Vector<BaseFloat> &state_occs,
                              int32 target_components,
                              float perturb_factor, BaseFloat power,
@@ -108,10 +141,9 @@ void AmDiagGmm::SplitByCount(const Vector<BaseFloat> &state_occs,
   GetSplitTargets(state_occs, target_components, power,
                   min_count, &targets);
 
-  for (int32 i = 0; i < NumPdfs(); i++) {
-    if (densities_[i]->NumGauss() < targets[i])
-      densities_[i]->Split(targets[i], perturb_factor);
-  }
+  SplitOrMergeClass c(targets, false, perturb_factor, RandInt(0, 0x7fffffff),
+                      &densities_);
+  RunParallelFor(0, NumPdfs(), c);
 
   KALDI_LOG << "Split " << NumPdfs() << " states with target = "
             << target_components << ", power = " << power
@@ -131,11 +163,10 @@ void AmDiagGmm::MergeByCount(const Vector<BaseFloat> &state_occs,
   GetSplitTargets(state_occs, target_components,
                   power, min_count, &targets);
 
-  for (int32 i = 0; i < NumPdfs(); i++) {
+  for (int32 i = 0; i < NumPdfs(); i++)
     if (targets[i] == 0) targets[i] = 1;  // can't merge below 1.
-    if (densities_[i]->NumGauss() > targets[i])
-      densities_[i]->Merge(targets[i]);
-  }
+  SplitOrMergeClass c(targets, true, 0.0, 0, &densities_);
+  RunParallelFor(0, NumPdfs(), c);
 
   KALDI_LOG << "Merged " << NumPdfs() << " states with target = "
             << target_components << ", power = " << power
@@ -52,7 +52,9 @@ class AmDiagGmm {
   // and any state less than its target gets mixed up.  If some states
   // were over their target, this may take the #Gauss over the target.
   // we enforce a min-count on Gaussians while splitting (don't split
-  // if it would take it below min-count).
+  // if it would take it below min-count).  The pdfs are split in parallel,
+  // with g_num_threads threads; the result doesn't depend on the number of
+  // threads.
   void SplitByCount(const Vector<BaseFloat> &state_occs,
                     int32 target_components, float perturb_factor,
                     BaseFloat power, BaseFloat min_count);
@@ -62,6 +64,7 @@ class AmDiagGmm {
   // to work out targets for each state (according to power-of-occupancy rule),
   // and any state over its target gets mixed down.  If some states
   // were under their target, this may take the #Gauss below the target.
+  // The pdfs are merged in parallel, with g_num_threads threads.
   void MergeByCount(const Vector<BaseFloat> &state_occs,
                     int32 target_components,
                     BaseFloat power, BaseFloat min_count);
@@ -0,0 +1,192 @@
+// gmm/decodable-am-diag-gmm-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gmm/model-test-common.h"
+#include "gmm/decodable-am-diag-gmm.h"
+
+#include <unistd.h>
+
+namespace kaldi {
+
+// Checks that the batched LogLikelihoods() gives the same answer with and
+// without the stacked model, and the same as LogLikelihood().
+void TestDecodableAmDiagGmmStacked() {
+  int32 dim = 1 + rand() % 10, num_pdfs = 1 + rand() % 30,
+      num_frames = 1 + rand() % 10;
+  AmDiagGmm am_gmm;
+  for (int32 i = 0; i < num_pdfs; i++) {
+    DiagGmm gmm;
+    unittest::InitRandDiagGmm(dim, 1 + rand() % 5, &gmm);
+    am_gmm.AddPdf(gmm);
+  }
+  Matrix<BaseFloat> feats(num_frames, dim);
+  feats.SetRandn();
+
+  StackedAmDiagGmm stacked(am_gmm);
+  KALDI_ASSERT(stacked.NumPdfs() == num_pdfs && stacked.Dim() == dim &&
+               stacked.NumGauss() == am_gmm.NumGauss());
+
+  DecodableAmDiagGmmUnmapped decodable(am_gmm, feats),
+      decodable_stacked(am_gmm, feats);
+  decodable_stacked.SetStackedModel(&stacked);
+
+  for (int32 frame = 0; frame < num_frames; frame++) {
+    std::vector<int32> indices;  // one-based, may contain repeats.
+    int32 num_indices = rand() % (2 * num_pdfs);
+    for (int32 i = 0; i < num_indices; i++)
+      indices.push_back(1 + rand() % num_pdfs);
+    std::vector<BaseFloat> log_likes, log_likes_stacked;
+    decodable.LogLikelihoods(frame, indices, &log_likes);
+    decodable_stacked.LogLikelihoods(frame, indices, &log_likes_stacked);
+    KALDI_ASSERT(log_likes.size() == indices.size() &&
+                 log_likes_stacked.size() == indices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+      AssertEqual(log_likes[i], log_likes_stacked[i], 1.0e-03);
+      AssertEqual(log_likes[i],
+                  decodable_stacked.LogLikelihood(frame, indices[i]),
+                  1.0e-03);
+    }
+  }
+}
+
+// Checks that StackedAmDiagGmmBatchScorer gives the same answers as the
+// per-frame decodable, for requests from several "streams" at once.
+void TestStackedAmDiagGmmBatchScorer() {
+  int32 dim = 1 + rand() % 10, num_pdfs = 1 + rand() % 30,
+      num_requests = 1 + rand() % 8;
+  AmDiagGmm am_gmm;
+  for (int32 i = 0; i < num_pdfs; i++) {
+    DiagGmm gmm;
+    unittest::InitRandDiagGmm(dim, 1 + rand() % 5, &gmm);
+    am_gmm.AddPdf(gmm);
+  }
+  Matrix<BaseFloat> feats(num_requests, dim);
+  feats.SetRandn();
+  StackedAmDiagGmm stacked(am_gmm);
+  DecodableAmDiagGmmUnmapped decodable(am_gmm, feats);
+
+  StackedAmDiagGmmBatchScorer scorer(stacked);
+  for (int32 iter = 0; iter < 2; iter++) {  // The 2nd time reuses memory.
+    scorer.Clear();
+    std::vector<std::vector<int32> > pdf_ids(num_requests);
+    for (int32 r = 0; r < num_requests; r++) {
+      int32 num_ids = rand() % (2 * num_pdfs);  // may contain repeats.
+      for (int32 i = 0; i < num_ids; i++)
+        pdf_ids[r].push_back(rand() % num_pdfs);
+      KALDI_ASSERT(scorer.AddRequest(feats.Row(r), pdf_ids[r]) == r);
+    }
+    scorer.Compute();
+    for (int32 r = 0; r < num_requests; r++) {
+      const std::vector<BaseFloat> &log_likes = scorer.LogLikes(r);
+      KALDI_ASSERT(log_likes.size() == pdf_ids[r].size());
+      for (size_t i = 0; i < log_likes.size(); i++)
+        AssertEqual(log_likes[i],
+                    decodable.LogLikelihood(r, pdf_ids[r][i] + 1), 1.0e-03);
+    }
+  }
+}
+
+// Checks that StackedAmDiagGmmCuScorer gives the same log-likelihoods as
+// AmDiagGmm::LogLikelihood().
+void TestStackedAmDiagGmmCuScorer() {
+  int32 dim = 1 + rand() % 10, num_pdfs = 1 + rand() % 30,
+      num_frames = rand() % 50;
+  AmDiagGmm am_gmm;
+  for (int32 i = 0; i < num_pdfs; i++) {
+    DiagGmm gmm;
+    unittest::InitRandDiagGmm(dim, 1 + rand() % 5, &gmm);
+    am_gmm.AddPdf(gmm);
+  }
+  Matrix<BaseFloat> feats(num_frames, dim);
+  feats.SetRandn();
+  StackedAmDiagGmm stacked(am_gmm);
+  StackedAmDiagGmmCuScorer scorer(stacked);
+  CuMatrix<BaseFloat> cu_feats(feats), cu_loglikes;
+  scorer.LogLikelihoods(cu_feats, &cu_loglikes);
+  Matrix<BaseFloat> loglikes(cu_loglikes);
+  KALDI_ASSERT(loglikes.NumRows() == num_frames);
+  for (int32 t = 0; t < num_frames; t++)
+    for (int32 pdf = 0; pdf < num_pdfs; pdf++)
+      AssertEqual(loglikes(t, pdf),
+                  am_gmm.LogLikelihood(pdf, feats.Row(t)), 1.0e-03);
+}
+
+// Checks that a stacked model written with WriteMapped() and mapped with
+// ReadMapped() gives the same log-likelihoods as the one it was written from.
+void TestStackedAmDiagGmmMapped() {
+  int32 dim = 1 + rand() % 10, num_pdfs = 1 + rand() % 30,
+      num_frames = 1 + rand() % 10;
+  AmDiagGmm am_gmm;
+  for (int32 i = 0; i < num_pdfs; i++) {
+    DiagGmm gmm;
+    unittest::InitRandDiagGmm(dim, 1 + rand() % 5, &gmm);
+    am_gmm.AddPdf(gmm);
+  }
+  Matrix<BaseFloat> feats(num_frames, dim);
+  feats.SetRandn();
+  StackedAmDiagGmm stacked(am_gmm);
+  const char *filename = "tmp.mapped_gmm";
+  {
+    std::ofstream os(filename, std::ios::out | std::ios::binary);
+    stacked.WriteMapped(os);
+  }
+  StackedAmDiagGmm *mapped = StackedAmDiagGmm::ReadMapped(filename);
+  KALDI_ASSERT(mapped != NULL && mapped->NumPdfs() == num_pdfs &&
+               mapped->Dim() == dim && mapped->NumGauss() == stacked.NumGauss());
+  for (int32 pdf = 0; pdf <= num_pdfs; pdf++)
+    KALDI_ASSERT(mapped->GaussOffset(pdf) == stacked.GaussOffset(pdf));
+
+  DecodableAmDiagGmmUnmapped decodable(am_gmm, feats),
+      decodable_mapped(am_gmm, feats);
+  decodable_mapped.SetStackedModel(mapped);
+  for (int32 frame = 0; frame < num_frames; frame++) {
+    std::vector<int32> indices;
+    for (int32 i = 1; i <= num_pdfs; i++)
+      indices.push_back(i);
+    std::vector<BaseFloat> log_likes, log_likes_mapped;
+    decodable.LogLikelihoods(frame, indices, &log_likes);
+    decodable_mapped.LogLikelihoods(frame, indices, &log_likes_mapped);
+    for (size_t i = 0; i < indices.size(); i++)
+      AssertEqual(log_likes[i], log_likes_mapped[i], 1.0e-03);
+  }
+  delete mapped;
+
+  // A truncated file must be rejected.
+  {
+    std::ofstream os(filename, std::ios::out | std::ios::binary);
+    os << "kaldi-mappedgmm";
+  }
+  KALDI_ASSERT(StackedAmDiagGmm::ReadMapped(filename) == NULL);
+  unlink(filename);
+}
+
+}  // namespace kaldi
+
+int main() {
+  for (kaldi::int32 i = 0; i < 10; i++)
+    kaldi::TestDecodableAmDiagGmmStacked();
+  for (kaldi::int32 i = 0; i < 10; i++)
+    kaldi::TestStackedAmDiagGmmBatchScorer();
+  for (kaldi::int32 i = 0; i < 10; i++)
+    kaldi::TestStackedAmDiagGmmMapped();
+  for (kaldi::int32 i = 0; i < 10; i++)
+    kaldi::TestStackedAmDiagGmmCuScorer();
+  std::cout << "Test OK.\n";
+  return 0;
+}
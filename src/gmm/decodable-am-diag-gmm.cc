@@ -18,13 +18,395 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <cstring>
 #include <vector>
 using std::vector;
 
 #include "gmm/decodable-am-diag-gmm.h"
+#include "util/stl-utils.h"
 
 namespace kaldi {
 
+StackedAmDiagGmm::StackedAmDiagGmm(): num_pdfs_(0), num_gauss_(0), dim_(0),
+                                     offsets_(NULL), gconsts_(NULL),
+                                     params_(NULL), params_stride_(0),
+                                     file_(NULL) { }
+
+StackedAmDiagGmm::StackedAmDiagGmm(const AmDiagGmm &am): file_(NULL) {
+  int32 num_pdfs = am.NumPdfs(), dim = am.Dim(), num_gauss = 0;
+  offsets_storage_.resize(num_pdfs + 1);
+  for (int32 pdf = 0; pdf < num_pdfs; pdf++) {
+    offsets_storage_[pdf] = num_gauss;
+    num_gauss += am.GetPdf(pdf).NumGauss();
+  }
+  offsets_storage_[num_pdfs] = num_gauss;
+  params_storage_.Resize(num_gauss, 2 * dim);
+  gconsts_storage_.Resize(num_gauss);
+  for (int32 pdf = 0; pdf < num_pdfs; pdf++) {
+    const DiagGmm &gmm = am.GetPdf(pdf);
+    if (!gmm.valid_gconsts())
+      KALDI_ERR << "State "  << pdf << ": Must call ComputeGconsts() "
+          "before computing likelihood.";
+    KALDI_ASSERT(gmm.Dim() == dim);
+    int32 offset = offsets_storage_[pdf], n = gmm.NumGauss();
+    params_storage_.Range(offset, n, 0, dim).CopyFromMat(gmm.means_invvars());
+    SubMatrix<BaseFloat> inv_vars_part(params_storage_, offset, n, dim, dim);
+    inv_vars_part.CopyFromMat(gmm.inv_vars());
+    inv_vars_part.Scale(-0.5);
+    gconsts_storage_.Range(offset, n).CopyFromVec(gmm.gconsts());
+  }
+  num_pdfs_ = num_pdfs;
+  num_gauss_ = num_gauss;
+  dim_ = dim;
+  offsets_ = &(offsets_storage_[0]);
+  gconsts_ = gconsts_storage_.Data();
+  params_ = params_storage_.Data();
+  params_stride_ = params_storage_.Stride();
+}
+
+StackedAmDiagGmm::~StackedAmDiagGmm() {
+  delete file_;
+}
+
+/// The header at the start of a file as written by
+/// StackedAmDiagGmm::WriteMapped().  It is followed by the NumPdfs() + 1
+/// offsets, the NumGauss() gconsts and the NumGauss() rows of parameters, each
+/// of the first two padded to a multiple of 16 bytes so that the parameters
+/// are aligned.
+struct StackedAmDiagGmmMappedHeader {
+  char magic[16];  // "kaldi-mappedgmm", NUL-terminated.
+  int32 version;
+  int32 float_size;  // sizeof(BaseFloat), as a check.
+  int32 num_pdfs;
+  int32 num_gauss;
+  int32 dim;
+  char padding[28];
+};
+
+static const char *kStackedAmDiagGmmMagic = "kaldi-mappedgmm";
+
+static size_t PadTo16(size_t num_bytes) {
+  return (num_bytes + 15) & ~static_cast<size_t>(15);
+}
+
+static void WritePadded(std::ostream &os, const void *data, size_t num_bytes) {
+  os.write(reinterpret_cast<const char*>(data), num_bytes);
+  char zeros[16] = { 0 };
+  os.write(zeros, PadTo16(num_bytes) - num_bytes);
+}
+
+void StackedAmDiagGmm::WriteMapped(std::ostream &os) const {
+  StackedAmDiagGmmMappedHeader header;
+  memset(&header, 0, sizeof(header));
+  strcpy(header.magic, kStackedAmDiagGmmMagic);
+  header.version = 1;
+  header.float_size = sizeof(BaseFloat);
+  header.num_pdfs = num_pdfs_;
+  header.num_gauss = num_gauss_;
+  header.dim = dim_;
+  os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  WritePadded(os, offsets_, (num_pdfs_ + 1) * sizeof(int32));
+  WritePadded(os, gconsts_, num_gauss_ * sizeof(BaseFloat));
+  for (int32 g = 0; g < num_gauss_; g++)
+    os.write(reinterpret_cast<const char*>(params_ +
+                                           static_cast<size_t>(g) *
+                                           params_stride_),
+             2 * dim_ * sizeof(BaseFloat));
+  if (!os.good())
+    KALDI_ERR << "Error writing mapped stacked GMM.";
+}
+
+StackedAmDiagGmm *StackedAmDiagGmm::ReadMapped(const std::string &filename) {
+  MappedFile *file = new MappedFile();
+  if (!file->Open(filename)) {
+    delete file;
+    return NULL;
+  }
+  const char *data = file->Data();
+  const StackedAmDiagGmmMappedHeader *header =
+      reinterpret_cast<const StackedAmDiagGmmMappedHeader*>(data);
+  size_t offsets_bytes = 0, gconsts_bytes = 0, params_bytes = 0;
+  bool ok = (file->Size() >= sizeof(*header) &&
+             strncmp(header->magic, kStackedAmDiagGmmMagic,
+                     sizeof(header->magic)) == 0 &&
+             header->version == 1 &&
+             header->float_size == sizeof(BaseFloat) &&
+             header->num_pdfs >= 0 && header->num_gauss >= 0 &&
+             header->dim > 0);
+  if (ok) {
+    offsets_bytes = PadTo16((header->num_pdfs + 1) * sizeof(int32));
+    gconsts_bytes = PadTo16(header->num_gauss * sizeof(BaseFloat));
+    params_bytes = static_cast<size_t>(header->num_gauss) * 2 * header->dim *
+        sizeof(BaseFloat);
+    ok = (file->Size() ==
+          sizeof(*header) + offsets_bytes + gconsts_bytes + params_bytes);
+  }
+  if (!ok) {
+    KALDI_WARN << "File " << filename << " is not a mapped stacked GMM as "
+               << "written by this program (or it was written with a "
+               << "different floating-point type, or is truncated).";
+    delete file;
+    return NULL;
+  }
+  StackedAmDiagGmm *ans = new StackedAmDiagGmm();
+  ans->num_pdfs_ = header->num_pdfs;
+  ans->num_gauss_ = header->num_gauss;
+  ans->dim_ = header->dim;
+  data += sizeof(*header);
+  ans->offsets_ = reinterpret_cast<const int32*>(data);
+  data += offsets_bytes;
+  ans->gconsts_ = reinterpret_cast<const BaseFloat*>(data);
+  data += gconsts_bytes;
+  ans->params_ = reinterpret_cast<const BaseFloat*>(data);
+  ans->params_stride_ = 2 * header->dim;
+  ans->file_ = file;
+  // Check the offsets, so that a corrupted file cannot make us read outside
+  // the mapping.
+  for (int32 pdf = 0; pdf < ans->num_pdfs_; pdf++) {
+    if (ans->offsets_[pdf] < 0 || ans->offsets_[pdf] > ans->offsets_[pdf + 1]) {
+      KALDI_WARN << "Invalid offsets in mapped stacked GMM " << filename;
+      delete ans;
+      return NULL;
+    }
+  }
+  if (ans->offsets_[0] != 0 || ans->offsets_[ans->num_pdfs_] != ans->num_gauss_) {
+    KALDI_WARN << "Invalid offsets in mapped stacked GMM " << filename;
+    delete ans;
+    return NULL;
+  }
+  return ans;
+}
+
+void StackedAmDiagGmm::ComputeGaussLogLikes(
+    const VectorBase<BaseFloat> &data_ext, int32 begin, int32 end,
+    VectorBase<BaseFloat> *loglikes) const {
+  KALDI_ASSERT(begin >= 0 && begin < end && end <= NumGauss() &&
+               loglikes->Dim() == end - begin &&
+               data_ext.Dim() == 2 * dim_);
+  loglikes->CopyFromVec(Gconsts(begin, end));
+  loglikes->AddMatVec(1.0, Params(begin, end), kNoTrans, data_ext, 1.0);
+}
+
+void StackedAmDiagGmm::ComputeGaussLogLikes(
+    const MatrixBase<BaseFloat> &data_ext, int32 begin, int32 end,
+    MatrixBase<BaseFloat> *loglikes) const {
+  KALDI_ASSERT(begin >= 0 && begin < end && end <= NumGauss() &&
+               loglikes->NumRows() == data_ext.NumRows() &&
+               loglikes->NumCols() == end - begin &&
+               data_ext.NumCols() == 2 * dim_);
+  loglikes->CopyRowsFromVec(Gconsts(begin, end));
+  loglikes->AddMatMat(1.0, data_ext, kNoTrans, Params(begin, end), kTrans,
+                      1.0);
+}
+
+void StackedAmDiagGmm::ComputePdfLogLikes(
+    const VectorBase<BaseFloat> &data_ext, const std::vector<int32> &pdfs,
+    BaseFloat log_sum_exp_prune, VectorBase<BaseFloat> *gauss_loglikes,
+    std::vector<BaseFloat> *log_likes) const {
+  KALDI_ASSERT(gauss_loglikes->Dim() == NumGauss());
+  // If there is a gap of no more than this many Gaussians between the pdfs
+  // we need, we compute them in the same matrix-vector product; the extra
+  // work is less than the overhead of another call.
+  const int32 kMaxGap = 16;
+  log_likes->resize(pdfs.size());
+  size_t i = 0, num_pdfs = pdfs.size();
+  while (i < num_pdfs) {
+    // Find a run of pdfs i ... j-1 whose Gaussians are (nearly) contiguous.
+    int32 begin = GaussOffset(pdfs[i]), end = GaussOffset(pdfs[i] + 1);
+    size_t j = i + 1;
+    while (j < num_pdfs && GaussOffset(pdfs[j]) - end <= kMaxGap) {
+      end = GaussOffset(pdfs[j] + 1);
+      j++;
+    }
+    SubVector<BaseFloat> run_loglikes(*gauss_loglikes, begin, end - begin);
+    ComputeGaussLogLikes(data_ext, begin, end, &run_loglikes);
+    for (; i < j; i++) {
+      int32 pdf = pdfs[i], offset = GaussOffset(pdf);
+      SubVector<BaseFloat> loglikes(*gauss_loglikes, offset,
+                                    GaussOffset(pdf + 1) - offset);
+      BaseFloat log_sum = loglikes.LogSumExp(log_sum_exp_prune);
+      if (KALDI_ISNAN(log_sum) || KALDI_ISINF(log_sum))
+        KALDI_ERR << "Invalid answer (overflow or invalid variances/features?)";
+      (*log_likes)[i] = log_sum;
+    }
+  }
+}
+
+int32 StackedAmDiagGmm::MaxGaussPerPdf() const {
+  int32 ans = 0;
+  for (int32 pdf = 0; pdf < NumPdfs(); pdf++)
+    ans = std::max(ans, offsets_[pdf + 1] - offsets_[pdf]);
+  return ans;
+}
+
+StackedAmDiagGmmBatchScorer::StackedAmDiagGmmBatchScorer(
+    const StackedAmDiagGmm &stacked, BaseFloat log_sum_exp_prune):
+    stacked_(stacked), log_sum_exp_prune_(log_sum_exp_prune) { }
+
+int32 StackedAmDiagGmmBatchScorer::AddRequest(
+    const VectorBase<BaseFloat> &feats, const std::vector<int32> &pdf_ids) {
+  int32 dim = stacked_.Dim(), r = NumRequests();
+  KALDI_ASSERT(feats.Dim() == dim);
+  if (r == data_ext_.NumRows()) {  // Grow geometrically.
+    Matrix<BaseFloat> data_ext(std::max(4, 2 * r), 2 * dim, kUndefined);
+    if (r != 0)
+      data_ext.RowRange(0, r).CopyFromMat(data_ext_.RowRange(0, r));
+    data_ext_.Swap(&data_ext);
+  }
+  SubVector<BaseFloat> row(data_ext_, r);
+  row.Range(0, dim).CopyFromVec(feats);
+  row.Range(dim, dim).CopyFromVec(feats);
+  row.Range(dim, dim).ApplyPow(2.0);
+  pdf_ids_.push_back(pdf_ids);
+  log_likes_.push_back(std::vector<BaseFloat>());
+  return r;
+}
+
+void StackedAmDiagGmmBatchScorer::Clear() {
+  pdf_ids_.clear();
+  log_likes_.clear();
+}
+
+StackedAmDiagGmmCuScorer::StackedAmDiagGmmCuScorer(
+    const StackedAmDiagGmm &stacked) {
+  int32 num_pdfs = stacked.NumPdfs(), num_gauss = stacked.NumGauss();
+  KALDI_ASSERT(num_gauss > 0);
+  params_.Resize(num_gauss, 2 * stacked.Dim(), kUndefined);
+  params_.CopyFromMat(stacked.Params(0, num_gauss));
+  gconsts_.Resize(num_gauss, kUndefined);
+  gconsts_.CopyFromVec(stacked.Gconsts(0, num_gauss));
+  std::vector<Int32Pair> pdf_gauss(num_pdfs);
+  for (int32 pdf = 0; pdf < num_pdfs; pdf++) {
+    pdf_gauss[pdf].first = stacked.GaussOffset(pdf);
+    pdf_gauss[pdf].second = stacked.GaussOffset(pdf + 1);
+  }
+  pdf_gauss_.CopyFromVec(pdf_gauss);
+  // Limit the Gaussian log-likelihoods of a block to 64MB.
+  block_size_ = std::max(1, (1 << 24) / num_gauss);
+}
+
+void StackedAmDiagGmmCuScorer::LogLikelihoods(
+    const CuMatrixBase<BaseFloat> &feats,
+    CuMatrix<BaseFloat> *loglikes) const {
+  int32 num_frames = feats.NumRows(), dim = feats.NumCols(),
+      num_gauss = params_.NumRows(), num_pdfs = pdf_gauss_.Dim();
+  KALDI_ASSERT(2 * dim == params_.NumCols());
+  if (num_frames == 0) {
+    loglikes->Resize(0, 0);
+    return;
+  }
+  loglikes->Resize(num_frames, num_pdfs, kUndefined);
+  int32 block_size = std::min(block_size_, num_frames);
+  CuMatrix<BaseFloat> data_ext(block_size, 2 * dim, kUndefined),
+      gauss_loglikes(block_size, num_gauss, kUndefined);
+  for (int32 t = 0; t < num_frames; t += block_size) {
+    int32 n = std::min(block_size, num_frames - t);
+    CuSubMatrix<BaseFloat> this_feats(feats.Range(t, n, 0, dim)),
+        x(data_ext.Range(0, n, 0, dim)), x2(data_ext.Range(0, n, dim, dim)),
+        this_gauss(gauss_loglikes.Range(0, n, 0, num_gauss));
+    x.CopyFromMat(this_feats);
+    x2.CopyFromMat(this_feats);
+    x2.ApplyPow(2.0);
+    this_gauss.CopyRowsFromVec(gconsts_);
+    this_gauss.AddMatMat(1.0, data_ext.Range(0, n, 0, 2 * dim), kNoTrans,
+                         params_, kTrans, 1.0);
+    loglikes->Range(t, n, 0, num_pdfs).LogSumExpColumnRanges(this_gauss,
+                                                             pdf_gauss_);
+  }
+}
+
+void StackedAmDiagGmmBatchScorer::Compute() {
+  int32 num_requests = NumRequests();
+  if (num_requests == 0) return;
+  // Each element is (pdf-id, (request, position in request)); after sorting,
+  // the requests that need a given pdf are together.
+  std::vector<std::pair<int32, std::pair<int32, int32> > > entries;
+  for (int32 r = 0; r < num_requests; r++) {
+    const std::vector<int32> &pdf_ids = pdf_ids_[r];
+    log_likes_[r].resize(pdf_ids.size());
+    for (size_t i = 0; i < pdf_ids.size(); i++) {
+      KALDI_ASSERT(pdf_ids[i] >= 0 && pdf_ids[i] < stacked_.NumPdfs());
+      entries.push_back(std::make_pair(pdf_ids[i],
+                                       std::make_pair(r, i)));
+    }
+  }
+  std::sort(entries.begin(), entries.end());
+
+  if (group_data_.NumRows() < num_requests) {
+    group_data_.Resize(num_requests, data_ext_.NumCols(), kUndefined);
+    group_loglikes_.Resize(num_requests, stacked_.MaxGaussPerPdf(),
+                           kUndefined);
+  }
+  std::vector<int32> group_rows;  // For each entry of the group, its row.
+  size_t k = 0, num_entries = entries.size();
+  while (k < num_entries) {
+    int32 pdf = entries[k].first, num_rows = 0;
+    size_t end = k;
+    group_rows.clear();
+    for (; end < num_entries && entries[end].first == pdf; end++) {
+      int32 r = entries[end].second.first;
+      if (end == k || r != entries[end - 1].second.first) {
+        group_data_.Row(num_rows).CopyFromVec(data_ext_.Row(r));
+        num_rows++;
+      }
+      group_rows.push_back(num_rows - 1);
+    }
+    int32 begin_gauss = stacked_.GaussOffset(pdf),
+        end_gauss = stacked_.GaussOffset(pdf + 1);
+    SubMatrix<BaseFloat> data(group_data_, 0, num_rows, 0,
+                              group_data_.NumCols()),
+        loglikes(group_loglikes_, 0, num_rows, 0, end_gauss - begin_gauss);
+    stacked_.ComputeGaussLogLikes(data, begin_gauss, end_gauss, &loglikes);
+    BaseFloat log_sum = 0.0;
+    for (size_t j = k; j < end; j++) {
+      // Requests that need the pdf more than once share a row.
+      if (j == k || group_rows[j - k] != group_rows[j - k - 1]) {
+        log_sum = loglikes.Row(group_rows[j - k]).LogSumExp(
+            log_sum_exp_prune_);
+        if (KALDI_ISNAN(log_sum) || KALDI_ISINF(log_sum))
+          KALDI_ERR << "Invalid answer (overflow or invalid "
+                    << "variances/features?)";
+      }
+      log_likes_[entries[j].second.first][entries[j].second.second] = log_sum;
+    }
+    k = end;
+  }
+}
+
+void DecodableAmDiagGmmUnmapped::SetStackedModel(
+    const StackedAmDiagGmm *stacked) {
+  if (stacked != NULL) {
+    if (stacked->NumPdfs() != acoustic_model_.NumPdfs() ||
+        stacked->Dim() != feature_matrix_.NumCols())
+      KALDI_ERR << "Stacked model does not match acoustic model or features: "
+                << stacked->NumPdfs() << " vs. " << acoustic_model_.NumPdfs()
+                << " pdfs, dim " << stacked->Dim() << " vs. "
+                << feature_matrix_.NumCols();
+    data_ext_.Resize(2 * stacked->Dim());
+    gauss_loglikes_.Resize(stacked->NumGauss());
+  }
+  stacked_ = stacked;
+}
+
+void DecodableAmDiagGmmUnmapped::ComputeStackedLogLikes(
+    int32 frame, const std::vector<int32> &pdfs) {
+  if (frame != previous_frame_) {  // cache the squared stats.
+    data_squared_.CopyFromVec(feature_matrix_.Row(frame));
+    data_squared_.ApplyPow(2.0);
+    previous_frame_ = frame;
+  }
+  int32 dim = stacked_->Dim();
+  data_ext_.Range(0, dim).CopyFromVec(feature_matrix_.Row(frame));
+  data_ext_.Range(dim, dim).CopyFromVec(data_squared_);
+  stacked_->ComputePdfLogLikes(data_ext_, pdfs, log_sum_exp_prune_,
+                               &gauss_loglikes_, &stacked_log_likes_);
+  for (size_t i = 0; i < pdfs.size(); i++) {
+    log_like_cache_[pdfs[i]].log_like = stacked_log_likes_[i];
+    log_like_cache_[pdfs[i]].hit_time = frame;
+  }
+}
+
 BaseFloat DecodableAmDiagGmmUnmapped::LogLikelihoodZeroBased(
     int32 frame, int32 state) {
   KALDI_ASSERT(static_cast<size_t>(frame) < static_cast<size_t>(NumFrames()));
@@ -69,6 +451,122 @@ BaseFloat DecodableAmDiagGmmUnmapped::LogLikelihoodZeroBased(
   return log_sum;
 }
 
+void DecodableAmDiagGmmUnmapped::LogLikelihoodsZeroBased(
+    int32 frame, const std::vector<int32> &pdf_ids,
+    std::vector<BaseFloat> *log_likes) {
+  log_likes->resize(pdf_ids.size());
+  if (stacked_ != NULL) {
+    KALDI_ASSERT(static_cast<size_t>(frame) <
+                 static_cast<size_t>(NumFrames()));
+    needed_pdfs_.clear();
+    for (size_t i = 0; i < pdf_ids.size(); i++) {
+      int32 pdf = pdf_ids[i];
+      KALDI_ASSERT(static_cast<size_t>(pdf) < log_like_cache_.size());
+      if (log_like_cache_[pdf].hit_time != frame)
+        needed_pdfs_.push_back(pdf);
+    }
+    if (!needed_pdfs_.empty()) {
+      SortAndUniq(&needed_pdfs_);
+      ComputeStackedLogLikes(frame, needed_pdfs_);
+    }
+    for (size_t i = 0; i < pdf_ids.size(); i++)
+      (*log_likes)[i] = log_like_cache_[pdf_ids[i]].log_like;
+    return;
+  }
+  // LogLikelihoodZeroBased() caches its output, so repeats are cheap.
+  for (size_t i = 0; i < pdf_ids.size(); i++)
+    (*log_likes)[i] = LogLikelihoodZeroBased(frame, pdf_ids[i]);
+}
+
+void DecodableAmDiagGmmUnmapped::LogLikelihoods(
+    int32 frame, const std::vector<int32> &state_indices,
+    std::vector<BaseFloat> *log_likes) {
+  pdf_ids_.resize(state_indices.size());
+  for (size_t i = 0; i < state_indices.size(); i++)
+    pdf_ids_[i] = state_indices[i] - 1;
+  LogLikelihoodsZeroBased(frame, pdf_ids_, log_likes);
+}
+
+void DecodableAmDiagGmm::LogLikelihoods(
+    int32 frame, const std::vector<int32> &tids,
+    std::vector<BaseFloat> *log_likes) {
+  pdf_ids_.resize(tids.size());
+  for (size_t i = 0; i < tids.size(); i++)
+    pdf_ids_[i] = trans_model_.TransitionIdToPdfFast(tids[i]);
+  LogLikelihoodsZeroBased(frame, pdf_ids_, log_likes);
+}
+
+void DecodableAmDiagGmmScaled::LogLikelihoods(
+    int32 frame, const std::vector<int32> &tids,
+    std::vector<BaseFloat> *log_likes) {
+  pdf_ids_.resize(tids.size());
+  for (size_t i = 0; i < tids.size(); i++)
+    pdf_ids_[i] = trans_model_.TransitionIdToPdfFast(tids[i]);
+  LogLikelihoodsZeroBased(frame, pdf_ids_, log_likes);
+  for (size_t i = 0; i < log_likes->size(); i++)
+    (*log_likes)[i] *= scale_;
+}
+
+DecodableStackedAmDiagGmmScaled::DecodableStackedAmDiagGmmScaled(
+    const StackedAmDiagGmm &stacked, const TransitionModel &tm,
+    const Matrix<BaseFloat> &feats, BaseFloat scale,
+    BaseFloat log_sum_exp_prune):
+    stacked_(stacked), trans_model_(tm), feature_matrix_(feats), scale_(scale),
+    log_sum_exp_prune_(log_sum_exp_prune),
+    cache_log_like_(stacked.NumPdfs()), cache_frame_(stacked.NumPdfs(), -1),
+    data_ext_(2 * stacked.Dim()), data_ext_frame_(-1),
+    gauss_loglikes_(stacked.NumGauss()) {
+  if (stacked.NumPdfs() != tm.NumPdfs() || stacked.Dim() != feats.NumCols())
+    KALDI_ERR << "Stacked model does not match transition model or features: "
+              << stacked.NumPdfs() << " vs. " << tm.NumPdfs()
+              << " pdfs, dim " << stacked.Dim() << " vs. " << feats.NumCols();
+}
+
+void DecodableStackedAmDiagGmmScaled::ComputeLogLikes(
+    int32 frame, const std::vector<int32> &tids) {
+  KALDI_ASSERT(static_cast<size_t>(frame) < static_cast<size_t>(NumFrames()));
+  needed_pdfs_.clear();
+  for (size_t i = 0; i < tids.size(); i++) {
+    int32 pdf = trans_model_.TransitionIdToPdfFast(tids[i]);
+    if (cache_frame_[pdf] != frame)
+      needed_pdfs_.push_back(pdf);
+  }
+  if (needed_pdfs_.empty()) return;
+  SortAndUniq(&needed_pdfs_);
+  if (frame != data_ext_frame_) {
+    int32 dim = stacked_.Dim();
+    SubVector<BaseFloat> x(data_ext_, 0, dim), x2(data_ext_, dim, dim);
+    x.CopyFromVec(feature_matrix_.Row(frame));
+    x2.CopyFromVec(x);
+    x2.ApplyPow(2.0);
+    data_ext_frame_ = frame;
+  }
+  stacked_.ComputePdfLogLikes(data_ext_, needed_pdfs_, log_sum_exp_prune_,
+                              &gauss_loglikes_, &needed_log_likes_);
+  for (size_t i = 0; i < needed_pdfs_.size(); i++) {
+    cache_log_like_[needed_pdfs_[i]] = needed_log_likes_[i];
+    cache_frame_[needed_pdfs_[i]] = frame;
+  }
+}
+
+BaseFloat DecodableStackedAmDiagGmmScaled::LogLikelihood(int32 frame,
+                                                         int32 tid) {
+  tids_.resize(1);
+  tids_[0] = tid;
+  ComputeLogLikes(frame, tids_);
+  return scale_ * cache_log_like_[trans_model_.TransitionIdToPdfFast(tid)];
+}
+
+void DecodableStackedAmDiagGmmScaled::LogLikelihoods(
+    int32 frame, const std::vector<int32> &tids,
+    std::vector<BaseFloat> *log_likes) {
+  ComputeLogLikes(frame, tids);
+  log_likes->resize(tids.size());
+  for (size_t i = 0; i < tids.size(); i++)
+    (*log_likes)[i] =
+        scale_ * cache_log_like_[trans_model_.TransitionIdToPdfFast(tids[i])];
+}
+
 void DecodableAmDiagGmmUnmapped::ResetLogLikeCache() {
   if (static_cast<int32>(log_like_cache_.size()) != acoustic_model_.NumPdfs()) {
     log_like_cache_.resize(acoustic_model_.NumPdfs());
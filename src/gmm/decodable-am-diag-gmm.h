@@ -22,18 +22,188 @@
 #ifndef KALDI_GMM_DECODABLE_AM_DIAG_GMM_H_
 #define KALDI_GMM_DECODABLE_AM_DIAG_GMM_H_
 
+#include <string>
 #include <vector>
 
 #include "base/kaldi-common.h"
+#include "cudamatrix/cu-array.h"
+#include "cudamatrix/cu-matrix.h"
+#include "cudamatrix/cu-vector.h"
 #include "gmm/am-diag-gmm.h"
 #include "hmm/transition-model.h"
 #include "itf/decodable-itf.h"
+#include "util/kaldi-mmap.h"
 #include "transform/regression-tree.h"
 #include "transform/regtree-fmllr-diag-gmm.h"
 #include "transform/regtree-mllr-diag-gmm.h"
 
 namespace kaldi {
 
+/// StackedAmDiagGmm holds the parameters of all the Gaussians of an AmDiagGmm
+/// stacked into one matrix, with the Gaussians of each pdf in consecutive
+/// rows, so that the log-likelihoods of the Gaussians of a range of pdfs can
+/// be computed with a single matrix-vector product.  Each row is
+/// [ means_invvars, -0.5 * inv_vars ], so it is to be multiplied by the
+/// "extended" data vector [ x, x^2 ].  It is built once per model and may be
+/// shared (it is const) between decodable objects in different threads; see
+/// DecodableAmDiagGmmUnmapped::SetStackedModel().
+///
+/// It may also be written to a file with WriteMapped() and memory-mapped from
+/// it with ReadMapped(), like MappedConstFst (../fstext/mapped-fst.h) for
+/// decoding graphs: "loading" it is then instantaneous, and the pages are
+/// shared by all the processes on the machine that decode with the same
+/// model.  The format is native binary (not portable between machines with
+/// different byte order or floating-point type).  Use it with
+/// DecodableStackedAmDiagGmmScaled, which needs no AmDiagGmm.
+class StackedAmDiagGmm {
+ public:
+  explicit StackedAmDiagGmm(const AmDiagGmm &am);
+
+  /// Maps a file written by WriteMapped(); "filename" must be an actual file,
+  /// not a pipe or "-".  Returns NULL (with a warning) on failure.
+  static StackedAmDiagGmm *ReadMapped(const std::string &filename);
+
+  /// Writes the model in the format read by ReadMapped().  The stream should
+  /// have been opened in binary mode.
+  void WriteMapped(std::ostream &os) const;
+
+  ~StackedAmDiagGmm();
+
+  int32 NumPdfs() const { return num_pdfs_; }
+  int32 NumGauss() const { return num_gauss_; }
+  int32 Dim() const { return dim_; }
+
+  /// Index of the first Gaussian of this pdf; the Gaussians of pdf p are
+  /// GaussOffset(p) ... GaussOffset(p+1) - 1.
+  int32 GaussOffset(int32 pdf) const { return offsets_[pdf]; }
+
+  /// Sets "loglikes" (of dimension end - begin) to the log-likelihoods of
+  /// Gaussians begin ... end-1, given the extended data vector [ x, x^2 ].
+  void ComputeGaussLogLikes(const VectorBase<BaseFloat> &data_ext,
+                            int32 begin, int32 end,
+                            VectorBase<BaseFloat> *loglikes) const;
+
+  /// Matrix version of ComputeGaussLogLikes(): row i of "loglikes" (of
+  /// dimension data_ext.NumRows() by end - begin) is set from row i of
+  /// "data_ext", with a single matrix-matrix product.
+  void ComputeGaussLogLikes(const MatrixBase<BaseFloat> &data_ext,
+                            int32 begin, int32 end,
+                            MatrixBase<BaseFloat> *loglikes) const;
+
+  /// Sets (*log_likes)[i] to the log-likelihood of pdf pdfs[i] given the
+  /// extended data vector, for "pdfs" sorted and unique.  The pdfs whose
+  /// Gaussians are (nearly) contiguous are computed together.
+  /// "gauss_loglikes" is used as temporary storage and must have dimension
+  /// NumGauss().  "log_sum_exp_prune" is as for DecodableAmDiagGmmUnmapped.
+  void ComputePdfLogLikes(const VectorBase<BaseFloat> &data_ext,
+                          const std::vector<int32> &pdfs,
+                          BaseFloat log_sum_exp_prune,
+                          VectorBase<BaseFloat> *gauss_loglikes,
+                          std::vector<BaseFloat> *log_likes) const;
+
+  /// The largest number of Gaussians in any pdf.
+  int32 MaxGaussPerPdf() const;
+
+  /// The parameters of Gaussians begin ... end-1, one row per Gaussian.
+  SubMatrix<BaseFloat> Params(int32 begin, int32 end) const {
+    return SubMatrix<BaseFloat>(const_cast<BaseFloat*>(params_) +
+                                static_cast<size_t>(begin) * params_stride_,
+                                end - begin, 2 * dim_, params_stride_);
+  }
+  /// The gconsts of Gaussians begin ... end-1.
+  SubVector<BaseFloat> Gconsts(int32 begin, int32 end) const {
+    return SubVector<BaseFloat>(const_cast<BaseFloat*>(gconsts_) + begin,
+                                end - begin);
+  }
+ private:
+  StackedAmDiagGmm();
+
+  int32 num_pdfs_;
+  int32 num_gauss_;
+  int32 dim_;
+  // The data is in the *_storage_ members if we computed it, or in "file_" if
+  // it was mapped; these point to wherever it is.
+  const int32 *offsets_;  // NumPdfs() + 1 offsets.
+  const BaseFloat *gconsts_;  // NumGauss() gconsts.
+  const BaseFloat *params_;  // NumGauss() rows of dimension 2 * Dim().
+  int32 params_stride_;
+  std::vector<int32> offsets_storage_;
+  Vector<BaseFloat> gconsts_storage_;
+  Matrix<BaseFloat> params_storage_;
+  MappedFile *file_;  // NULL unless mapped.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(StackedAmDiagGmm);
+};
+
+/// StackedAmDiagGmmBatchScorer computes the pdf log-likelihoods needed by
+/// several decoders at once, e.g. the current frames of the different streams
+/// of an online server.  Each request is a feature vector and a list of
+/// pdf-ids; Compute() groups the requests by pdf, so the parameters of each
+/// pdf are read once per batch and applied to the data of all the requests
+/// that need that pdf with one matrix-matrix product.  This class is not
+/// thread-safe; see OnlineBatchScorer in ../online/online-decodable.h.
+class StackedAmDiagGmmBatchScorer {
+ public:
+  /// "log_sum_exp_prune" is as for DecodableAmDiagGmmUnmapped.
+  explicit StackedAmDiagGmmBatchScorer(const StackedAmDiagGmm &stacked,
+                                       BaseFloat log_sum_exp_prune = -1.0);
+
+  /// Adds a request and returns its index.  "pdf_ids" may contain repeats.
+  int32 AddRequest(const VectorBase<BaseFloat> &feats,
+                   const std::vector<int32> &pdf_ids);
+
+  int32 NumRequests() const { return static_cast<int32>(pdf_ids_.size()); }
+
+  /// Computes the log-likelihoods of all the requests added so far.
+  void Compute();
+
+  /// Returns the log-likelihoods of request r, in the same order as its
+  /// pdf-ids; only valid after Compute().
+  const std::vector<BaseFloat> &LogLikes(int32 r) const {
+    KALDI_ASSERT(static_cast<size_t>(r) < log_likes_.size());
+    return log_likes_[r];
+  }
+
+  /// Removes all the requests (but keeps the memory).
+  void Clear();
+
+ private:
+  const StackedAmDiagGmm &stacked_;
+  BaseFloat log_sum_exp_prune_;
+  Matrix<BaseFloat> data_ext_;  ///< Row r is [ x, x^2 ] for request r.
+  std::vector<std::vector<int32> > pdf_ids_;
+  std::vector<std::vector<BaseFloat> > log_likes_;
+  Matrix<BaseFloat> group_data_;  ///< Rows of data_ext_ for one pdf.
+  Matrix<BaseFloat> group_loglikes_;  ///< Per-Gaussian, for one pdf.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(StackedAmDiagGmmBatchScorer);
+};
+
+/// StackedAmDiagGmmCuScorer computes the log-likelihoods of all the pdfs on
+/// all the frames of an utterance with CuMatrix operations, so on the GPU if
+/// one is in use, for decoding with DecodableMatrixScaledMapped (see
+/// gmm-latgen-faster-parallel --use-gpu).  The stacked parameters are copied
+/// to the device once.  For each block of frames, the Gaussian
+/// log-likelihoods are computed with one matrix-matrix product, and those of
+/// each pdf are combined with CuMatrixBase::LogSumExpColumnRanges().  Every
+/// pdf is computed on every frame, whether or not the decoder would have
+/// needed it, so this only pays off if the matrix operations are much faster
+/// than on the CPU.  There is no log_sum_exp_prune.
+class StackedAmDiagGmmCuScorer {
+ public:
+  explicit StackedAmDiagGmmCuScorer(const StackedAmDiagGmm &stacked);
+
+  /// Sets "loglikes" to the log-likelihoods of the pdfs (one column per pdf)
+  /// given the rows of "feats".
+  void LogLikelihoods(const CuMatrixBase<BaseFloat> &feats,
+                      CuMatrix<BaseFloat> *loglikes) const;
+
+ private:
+  CuMatrix<BaseFloat> params_;  ///< As StackedAmDiagGmm::Params().
+  CuVector<BaseFloat> gconsts_;
+  CuArray<Int32Pair> pdf_gauss_;  ///< The range of Gaussians of each pdf.
+  int32 block_size_;  ///< Number of frames done at a time, to limit memory.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(StackedAmDiagGmmCuScorer);
+};
+
 /// DecodableAmDiagGmmUnmapped is a decodable object that
 /// takes indices that correspond to pdf-id's plus one.
 /// This may be used in future in a decoder that doesn't need
@@ -53,15 +223,28 @@ class DecodableAmDiagGmmUnmapped : public DecodableInterface {
                              BaseFloat log_sum_exp_prune = -1.0):
     acoustic_model_(am), feature_matrix_(feats),
     previous_frame_(-1), log_sum_exp_prune_(log_sum_exp_prune), 
-    data_squared_(feats.NumCols()) {
+    stacked_(NULL), data_squared_(feats.NumCols()) {
     ResetLogLikeCache();
   }
 
+  /// If you call this, log-likelihoods requested through LogLikelihoods()
+  /// will be computed from the stacked model, which lets us compute all the
+  /// pdfs needed on a frame with a few large matrix-vector products rather
+  /// than two per pdf.  It does not take ownership.  Do not use this with
+  /// derived classes that override LogLikelihoodZeroBased(), e.g. to use
+  /// transformed models.
+  void SetStackedModel(const StackedAmDiagGmm *stacked);
+
   // Note, frames are numbered from zero.  But state_index is numbered
   // from one (this routine is called by FSTs).
   virtual BaseFloat LogLikelihood(int32 frame, int32 state_index) {
     return LogLikelihoodZeroBased(frame, state_index - 1);
   }
+
+  virtual void LogLikelihoods(int32 frame,
+                              const std::vector<int32> &state_indices,
+                              std::vector<BaseFloat> *log_likes);
+
   int32 NumFrames() { return feature_matrix_.NumRows(); }
   
   // Indices are one-based!  This is for compatibility with OpenFst.
@@ -76,6 +259,13 @@ class DecodableAmDiagGmmUnmapped : public DecodableInterface {
   void ResetLogLikeCache();
   virtual BaseFloat LogLikelihoodZeroBased(int32 frame, int32 state_index);
 
+  /// Batched version of LogLikelihoodZeroBased(): sets (*log_likes)[i] to
+  /// the log-likelihood of pdf pdf_ids[i] on this frame.  There may be
+  /// repeats in pdf_ids.
+  virtual void LogLikelihoodsZeroBased(int32 frame,
+                                       const std::vector<int32> &pdf_ids,
+                                       std::vector<BaseFloat> *log_likes);
+
   const AmDiagGmm &acoustic_model_;
   const Matrix<BaseFloat> &feature_matrix_;
   int32 previous_frame_;
@@ -87,14 +277,76 @@ class DecodableAmDiagGmmUnmapped : public DecodableInterface {
     int32 hit_time;     ///< Frame for which this value is relevant
   };
   std::vector<LikelihoodCacheRecord> log_like_cache_;
+  std::vector<int32> pdf_ids_;  ///< Temporary used in LogLikelihoods().
  private:
+  /// Computes the log-likelihoods of "pdfs", which must be sorted and unique,
+  /// for this frame using stacked_, and puts them in log_like_cache_.
+  void ComputeStackedLogLikes(int32 frame, const std::vector<int32> &pdfs);
+
+  const StackedAmDiagGmm *stacked_;  ///< Not owned here; may be NULL.
   Vector<BaseFloat> data_squared_;  ///< Cache for fast likelihood calculation
+  Vector<BaseFloat> data_ext_;  ///< [ x, x^2 ]; used with stacked_.
+  Vector<BaseFloat> gauss_loglikes_;  ///< Per-Gaussian; used with stacked_.
+  std::vector<int32> needed_pdfs_;  ///< Temporary used with stacked_.
+  std::vector<BaseFloat> stacked_log_likes_;  ///< Temporary used with stacked_.
 
 
   KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableAmDiagGmmUnmapped);
 };
 
 
+/// DecodableStackedAmDiagGmmScaled is like DecodableAmDiagGmmScaled with a
+/// stacked model, but it needs only the StackedAmDiagGmm, so it can be used
+/// with a model mapped by StackedAmDiagGmm::ReadMapped() without loading the
+/// AmDiagGmm.  Indices are transition-ids.
+class DecodableStackedAmDiagGmmScaled: public DecodableInterface {
+ public:
+  DecodableStackedAmDiagGmmScaled(const StackedAmDiagGmm &stacked,
+                                  const TransitionModel &tm,
+                                  const Matrix<BaseFloat> &feats,
+                                  BaseFloat scale,
+                                  BaseFloat log_sum_exp_prune = -1.0);
+
+  // Note, frames are numbered from zero but transition-ids from one.
+  virtual BaseFloat LogLikelihood(int32 frame, int32 tid);
+
+  virtual void LogLikelihoods(int32 frame, const std::vector<int32> &tids,
+                              std::vector<BaseFloat> *log_likes);
+
+  int32 NumFrames() { return feature_matrix_.NumRows(); }
+
+  // Indices are one-based!  This is for compatibility with OpenFst.
+  virtual int32 NumIndices() { return trans_model_.NumTransitionIds(); }
+
+  virtual bool IsLastFrame(int32 frame) {
+    KALDI_ASSERT(frame < NumFrames());
+    return (frame == NumFrames() - 1);
+  }
+
+  const TransitionModel *TransModel() { return &trans_model_; }
+
+ private:
+  /// Makes sure the log-likelihoods of the pdfs of "tids" on this frame are in
+  /// the cache.
+  void ComputeLogLikes(int32 frame, const std::vector<int32> &tids);
+
+  const StackedAmDiagGmm &stacked_;
+  const TransitionModel &trans_model_;
+  const Matrix<BaseFloat> &feature_matrix_;
+  BaseFloat scale_;
+  BaseFloat log_sum_exp_prune_;
+  std::vector<BaseFloat> cache_log_like_;  ///< Indexed by pdf.
+  std::vector<int32> cache_frame_;  ///< Frame of cache_log_like_, or -1.
+  Vector<BaseFloat> data_ext_;  ///< [ x, x^2 ] for frame data_ext_frame_.
+  int32 data_ext_frame_;
+  Vector<BaseFloat> gauss_loglikes_;  ///< Temporary, per Gaussian.
+  std::vector<int32> needed_pdfs_;  ///< Temporary.
+  std::vector<BaseFloat> needed_log_likes_;  ///< Temporary.
+  std::vector<int32> tids_;  ///< Temporary used in LogLikelihood().
+  KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableStackedAmDiagGmmScaled);
+};
+
+
 class DecodableAmDiagGmm: public DecodableAmDiagGmmUnmapped {
  public:
   DecodableAmDiagGmm(const AmDiagGmm &am,
@@ -107,8 +359,12 @@ class DecodableAmDiagGmm: public DecodableAmDiagGmmUnmapped {
   // Note, frames are numbered from zero.
   virtual BaseFloat LogLikelihood(int32 frame, int32 tid) {
     return LogLikelihoodZeroBased(frame,
-                                  trans_model_.TransitionIdToPdf(tid));
+                                  trans_model_.TransitionIdToPdfFast(tid));
   }
+
+  virtual void LogLikelihoods(int32 frame, const std::vector<int32> &tids,
+                              std::vector<BaseFloat> *log_likes);
+
   // Indices are one-based!  This is for compatibility with OpenFst.
   virtual int32 NumIndices() { return trans_model_.NumTransitionIds(); }
 
@@ -142,8 +398,11 @@ class DecodableAmDiagGmmScaled: public DecodableAmDiagGmmUnmapped {
   // Note, frames are numbered from zero but transition-ids from one.
   virtual BaseFloat LogLikelihood(int32 frame, int32 tid) {
     return scale_*LogLikelihoodZeroBased(frame,
-                                         trans_model_.TransitionIdToPdf(tid));
+                                         trans_model_.TransitionIdToPdfFast(tid));
   }
+
+  virtual void LogLikelihoods(int32 frame, const std::vector<int32> &tids,
+                              std::vector<BaseFloat> *log_likes);
   // Indices are one-based!  This is for compatibility with OpenFst.
   virtual int32 NumIndices() { return trans_model_.NumTransitionIds(); }
 
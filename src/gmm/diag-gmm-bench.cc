@@ -0,0 +1,89 @@
+// gmm/diag-gmm-bench.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include "gmm/diag-gmm.h"
+#include "util/kaldi-bench.h"
+
+namespace kaldi {
+
+struct DiagGmmLogLikesBench {
+  DiagGmmLogLikesBench(const DiagGmm &gmm, const Matrix<BaseFloat> &data):
+      gmm_(gmm), data_(data) { }
+  void operator() () { gmm_.LogLikelihoods(data_, &loglikes_); }
+  const DiagGmm &gmm_;
+  const Matrix<BaseFloat> &data_;
+  Matrix<BaseFloat> loglikes_;
+};
+
+struct DiagGmmLogLikesFrameBench {
+  DiagGmmLogLikesFrameBench(const DiagGmm &gmm, const Matrix<BaseFloat> &data):
+      gmm_(gmm), data_(data) { }
+  void operator() () {
+    for (int32 t = 0; t < data_.NumRows(); t++)
+      gmm_.LogLikelihoods(data_.Row(t), &loglikes_);
+  }
+  const DiagGmm &gmm_;
+  const Matrix<BaseFloat> &data_;
+  Vector<BaseFloat> loglikes_;
+};
+
+// Times DiagGmm::LogLikelihoods on a fixed random GMM, both a frame at a time
+// (as in the decoders) and on a block of frames.
+void DiagGmmBench(int32 num_gauss, int32 dim, int32 num_frames) {
+  DiagGmm gmm(num_gauss, dim);
+  Matrix<BaseFloat> inv_vars(num_gauss, dim), means(num_gauss, dim);
+  Vector<BaseFloat> weights(num_gauss);
+  for (int32 i = 0; i < num_gauss; i++) {
+    for (int32 j = 0; j < dim; j++) {
+      inv_vars(i, j) = exp(RandGauss() * 0.5);
+      means(i, j) = RandGauss();
+    }
+    weights(i) = exp(RandGauss());
+  }
+  weights.Scale(1.0 / weights.Sum());
+  gmm.SetWeights(weights);
+  gmm.SetInvVarsAndMeans(inv_vars, means);
+  gmm.ComputeGconsts();
+  Matrix<BaseFloat> data(num_frames, dim);
+  data.SetRandn();
+
+  std::ostringstream params;
+  params << "num_gauss=" << num_gauss << " dim=" << dim
+         << " frames=" << num_frames;
+  // Two multiply-adds per Gaussian per dimension (x and x^2 terms).
+  double flops = 4.0 * num_frames * num_gauss * dim;
+  DiagGmmLogLikesBench matrix_bench(gmm, data);
+  PrintBenchmarkResult("DiagGmm::LogLikelihoods(matrix)", params.str(),
+                       TimeBenchmark(matrix_bench), flops, "flops");
+  DiagGmmLogLikesFrameBench frame_bench(gmm, data);
+  PrintBenchmarkResult("DiagGmm::LogLikelihoods(vector)", params.str(),
+                       TimeBenchmark(frame_bench), flops, "flops");
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  srand(0);
+  DiagGmmBench(16, 39, 1000);
+  DiagGmmBench(400, 40, 1000);
+  DiagGmmBench(2048, 40, 100);
+  return 0;
+}
@@ -215,6 +215,12 @@ void UnitTestDiagGmm() {
     gmm3 = new DiagGmm();
     Input ki2("tmpfb", &binary_in);
     gmm3->Read(ki2.Stream(), binary_in);
+    // In binary mode the gconsts are read, not recomputed; they should be
+    // what ComputeGconsts() gives.
+    KALDI_ASSERT(gmm3->valid_gconsts());
+    Vector<BaseFloat> read_gconsts(gmm3->gconsts());
+    gmm3->ComputeGconsts();
+    KALDI_ASSERT(read_gconsts.ApproxEqual(gmm3->gconsts(), 1.0e-06));
 
     float loglike5 = gmm3->ComponentPosteriors(feat, &posterior1);
     AssertEqual(loglike, loglike5, 0.01);
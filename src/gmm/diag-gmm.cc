@@ -121,18 +121,28 @@ int32 DiagGmm::ComputeGconsts() {
   if (num_mix != static_cast<int32>(gconsts_.Dim()))
     gconsts_.Resize(num_mix);
 
+  // gc(mix) = log(weight) + offset
+  //    + 0.5 * sum_d (log(inv_vars(mix, d))
+  //                   - means_invvars(mix, d)^2 / inv_vars(mix, d)),
+  // with the sums over d done for all the components at once.
+  // Change sign for logdet because var is inverted. Also, note that
+  // mean_invvars(mix, d)*mean_invvars(mix, d)/inv_vars(mix, d) is the
+  // mean-squared times inverse variance, since mean_invvars(mix, d) contains
+  // the mean times inverse variance.
+  // So gc is the likelihood at zero feature value.
+  Vector<BaseFloat> sums(num_mix);
+  Matrix<BaseFloat> tmp(inv_vars_);
+  tmp.ApplyLog();
+  sums.AddColSumMat(0.5, tmp, 0.0);
+  tmp.CopyFromMat(means_invvars_);
+  tmp.MulElements(means_invvars_);
+  tmp.DivElements(inv_vars_);
+  sums.AddColSumMat(-0.5, tmp, 1.0);
+
   for (int32 mix = 0; mix < num_mix; mix++) {
     KALDI_ASSERT(weights_(mix) >= 0);  // Cannot have negative weights.
-    BaseFloat gc = log(weights_(mix)) + offset;  // May be -inf if weights == 0
-    for (int32 d = 0; d < dim; d++) {
-      gc += 0.5 * log(inv_vars_(mix, d)) - 0.5 * means_invvars_(mix, d)
-        * means_invvars_(mix, d) / inv_vars_(mix, d);
-    }
-    // Change sign for logdet because var is inverted. Also, note that
-    // mean_invvars(mix, d)*mean_invvars(mix, d)/inv_vars(mix, d) is the
-    // mean-squared times inverse variance, since mean_invvars(mix, d) contains
-    // the mean times inverse variance.
-    // So gc is the likelihood at zero feature value.
+    // May be -inf if weights == 0
+    BaseFloat gc = log(weights_(mix)) + offset + sums(mix);
 
     if (KALDI_ISNAN(gc)) {  // negative infinity is OK but NaN is not acceptable
       KALDI_ERR << "At component "  << mix
@@ -152,7 +162,8 @@ int32 DiagGmm::ComputeGconsts() {
 }
 
 void DiagGmm::Split(int32 target_components, float perturb_factor,
-                    std::vector<int32> *history) {
+                    std::vector<int32> *history,
+                    RandomGenerator *rand_gen) {
   if (target_components < NumGauss() || NumGauss() == 0) {
     KALDI_ERR << "Cannot split from "  << NumGauss() << " to "
               << target_components  << " components";
@@ -196,7 +207,8 @@ void DiagGmm::Split(int32 target_components, float perturb_factor,
     weights_(current_components) = weights_(max_idx);
     Vector<BaseFloat> rand_vec(dim);
     for (int32 i = 0; i < dim; i++) {
-      rand_vec(i) = RandGauss() * std::sqrt(inv_vars_(max_idx, i));
+      rand_vec(i) = (rand_gen != NULL ? rand_gen->RandGauss() : RandGauss()) *
+          std::sqrt(inv_vars_(max_idx, i));
       // note, this looks wrong but is really right because it's the
       // means_invvars we're multiplying and they have the dimension
       // of an inverse standard variance. [dan]
@@ -733,8 +745,10 @@ void DiagGmm::Read(std::istream &is, bool binary) {
   if (token != "<DiagGMMBegin>" && token != "<DiagGMM>")
     KALDI_ERR << "Expected <DiagGMM>, got " << token;
   ReadToken(is, binary, &token);
+  bool have_gconsts = false;
   if (token == "<GCONSTS>") {  // The gconsts are optional.
     gconsts_.Read(is, binary);
+    have_gconsts = true;
     ExpectToken(is, binary, "<WEIGHTS>");
   } else {
     if (token != "<WEIGHTS>")
@@ -752,7 +766,15 @@ void DiagGmm::Read(std::istream &is, bool binary) {
   if (token != "<DiagGMMEnd>" && token != "</DiagGMM>")
     KALDI_ERR << "Expected </DiagGMM>, got " << token;
 
-  ComputeGconsts();  // safer option than trusting the read gconsts
+  // Write() only writes gconsts that ComputeGconsts() computed from the
+  // current parameters, so in binary mode, where they are stored exactly, we
+  // can use them as they are (recomputing them was most of the time it took
+  // to read a model).  In text mode they may have been rounded or edited, so
+  // the safer option is to recompute them.
+  if (binary && have_gconsts && gconsts_.Dim() == weights_.Dim())
+    valid_gconsts_ = true;
+  else
+    ComputeGconsts();
 }
 
 std::istream & operator >>(std::istream &is, kaldi::DiagGmm &gmm) {
@@ -836,12 +858,17 @@ BaseFloat DiagGmm::GaussianSelection(const MatrixBase<BaseFloat> &data,
   output->clear();
   output->resize(num_frames);
 
+  // These buffers are reused for each frame, to avoid memory allocation.
+  Vector<BaseFloat> loglikes_copy(num_gauss, kUndefined);
+  std::vector<std::pair<BaseFloat, int32> > pairs;
+  pairs.reserve(num_gauss);
+
   for (int32 i = 0; i < num_frames; i++) {
     SubVector<BaseFloat> loglikes(loglikes_mat, i);
 
     BaseFloat thresh;
     if (num_gselect < num_gauss) {
-      Vector<BaseFloat> loglikes_copy(loglikes);
+      loglikes_copy.CopyFromVec(loglikes);
       BaseFloat *ptr = loglikes_copy.Data();
       std::nth_element(ptr, ptr+num_gauss-num_gselect, ptr+num_gauss);
       thresh = ptr[num_gauss-num_gselect];
@@ -849,7 +876,7 @@ BaseFloat DiagGmm::GaussianSelection(const MatrixBase<BaseFloat> &data,
       thresh = -std::numeric_limits<BaseFloat>::infinity();
     }
     BaseFloat tot_loglike = -std::numeric_limits<BaseFloat>::infinity();
-    std::vector<std::pair<BaseFloat, int32> > pairs;
+    pairs.clear();
     for (int32 p = 0; p < num_gauss; p++) {
       if (loglikes(p) >= thresh) {
         pairs.push_back(std::make_pair(loglikes(p), p));
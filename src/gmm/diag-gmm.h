@@ -138,9 +138,11 @@ class DiagGmm {
   void Generate(VectorBase<BaseFloat> *output);
 
   /// Split the components and remember the order in which the components were
-  /// split
+  /// split.  The perturbations come from "rand_gen" if it is not NULL, or
+  /// else from RandGauss().
   void Split(int32 target_components, float perturb_factor,
-             std::vector<int32> *history = NULL);
+             std::vector<int32> *history = NULL,
+             RandomGenerator *rand_gen = NULL);
 
   /// Perturbs the component means with a random vector multiplied by the
   /// pertrub factor.
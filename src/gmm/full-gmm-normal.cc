@@ -27,6 +27,7 @@
 
 #include "gmm/full-gmm-normal.h"
 #include "gmm/full-gmm.h"
+#include "matrix/sp-matrix-batch.h"
 
 namespace kaldi {
 
@@ -62,11 +63,16 @@ void FullGmmNormal::CopyFromFullGmm(const FullGmm &fullgmm) {
   /// we need to split the natural components for each gaussian
   Vector<double> mean_times_invcovar(dim);
 
+  // copy and invert the (inverse) covariance matrices; they are inverted
+  // together, which is faster than one by one for typical dimensions.
+  std::vector<SpMatrix<double>*> vars_ptrs(num_gauss);
   for (size_t i = 0; i < num_gauss; i++) {
-    // copy and invert (inverse) covariance matrix
     vars_[i].CopyFromSp(fullgmm.inv_covars_[i]);
-    vars_[i].InvertDouble();
+    vars_ptrs[i] = &(vars_[i]);
+  }
+  InvertPosDefBatch(vars_ptrs);
 
+  for (size_t i = 0; i < num_gauss; i++) {
     // multiply the (mean x icov) by (cov) to get the means back
     mean_times_invcovar.CopyFromVec(fullgmm.means_invcovars_.Row(i));
     (means_.Row(i)).AddSpVec(1.0, vars_[i], mean_times_invcovar, 0.0);
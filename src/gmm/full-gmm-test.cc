@@ -216,6 +216,31 @@ UnitTestFullGmm() {
       gmm2.LogLikelihoodsPreselect(feat, indices, &loglikes);
       AssertEqual(loglikes.LogSumExp(), loglike_gmm2);
     }
+    {
+      // The matrix versions should agree with the single-frame ones.
+      Matrix<BaseFloat> feats(3, gmm2.Dim());
+      feats.SetRandn();
+      feats.Row(1).CopyFromVec(feat);
+      Matrix<BaseFloat> loglikes_mat;
+      gmm2.LogLikelihoods(feats, &loglikes_mat);
+      std::vector<std::vector<int32> > gselect;
+      int32 num_gselect = 1 + rand() % gmm2.NumGauss();
+      BaseFloat tot_like = gmm2.GaussianSelection(feats, num_gselect,
+                                                  &gselect), tot_like2 = 0.0;
+      KALDI_ASSERT(gselect.size() == 3);
+      for (int32 t = 0; t < 3; t++) {
+        Vector<BaseFloat> loglikes;
+        gmm2.LogLikelihoods(feats.Row(t), &loglikes);
+        Vector<BaseFloat> loglikes2(loglikes_mat.Row(t));
+        AssertEqual(loglikes, loglikes2, 0.001);
+        std::vector<int32> this_gselect;
+        tot_like2 += gmm2.GaussianSelection(feats.Row(t), num_gselect,
+                                            &this_gselect);
+        KALDI_ASSERT(this_gselect.size() == gselect[t].size());
+      }
+      AssertEqual(tot_like, tot_like2, 0.001);
+      AssertEqual(loglikes_mat.Row(1).LogSumExp(), loglike_gmm2);
+    }
 
 
     // single component mean accessor + mutator
@@ -610,6 +610,41 @@ void FullGmm::LogLikelihoods(const VectorBase<BaseFloat> &data,
   }
 }
 
+void FullGmm::LogLikelihoods(const MatrixBase<BaseFloat> &data,
+                             Matrix<BaseFloat> *loglikes) const {
+  int32 num_frames = data.NumRows(), num_gauss = NumGauss(), dim = Dim(),
+      packed_dim = (dim * (dim + 1)) / 2;
+  KALDI_ASSERT(num_frames != 0);
+  if (data.NumCols() != dim) {
+    KALDI_ERR << "FullGmm::LogLikelihoods, dimension mismatch "
+              << data.NumCols() << " vs. " << dim;
+  }
+  loglikes->Resize(num_frames, num_gauss, kUndefined);
+  loglikes->CopyRowsFromVec(gconsts_);
+  // loglikes += data * (means * inv(covars))^T.
+  loglikes->AddMatMat(1.0, data, kNoTrans, means_invcovars_, kTrans, 1.0);
+
+  // As in the single-frame version, the quadratic term for each frame and
+  // component is the dot product of the packed lower triangles of
+  // data*data^T, with the diagonal halved, and of the inverse covariance; so
+  // for all of them at once it is a matrix product.
+  Matrix<BaseFloat> data_sq(num_frames, packed_dim, kUndefined);
+  for (int32 t = 0; t < num_frames; t++) {
+    const BaseFloat *x = data.RowData(t);
+    BaseFloat *out = data_sq.RowData(t);
+    for (int32 i = 0; i < dim; i++) {
+      for (int32 j = 0; j < i; j++)
+        *(out++) = x[i] * x[j];
+      *(out++) = 0.5 * x[i] * x[i];
+    }
+  }
+  Matrix<BaseFloat> inv_covars_packed(num_gauss, packed_dim, kUndefined);
+  for (int32 mix = 0; mix < num_gauss; mix++)
+    inv_covars_packed.Row(mix).CopyFromPacked(inv_covars_[mix]);
+  // loglikes -= 0.5 * tr(data*data' * inv(covar)).
+  loglikes->AddMatMat(-1.0, data_sq, kNoTrans, inv_covars_packed, kTrans, 1.0);
+}
+
 void FullGmm::LogLikelihoodsPreselect(const VectorBase<BaseFloat> &data,
                                       const vector<int32> &indices,
                                       Vector<BaseFloat> *loglikes) const {
@@ -634,14 +669,13 @@ void FullGmm::LogLikelihoodsPreselect(const VectorBase<BaseFloat> &data,
 
 
 /// Get gaussian selection information for one frame.
-BaseFloat FullGmm::GaussianSelection(const VectorBase<BaseFloat> &data,
+// Outputs the indexes of the best "num_gselect" log-likelihoods, sorted from
+// best to worst, and returns the total log-likelihood of those.
+static BaseFloat SelectBestGaussians(const VectorBase<BaseFloat> &loglikes,
                                      int32 num_gselect,
-                                     std::vector<int32> *output) const {
-  int32 num_gauss = NumGauss();
-  Vector<BaseFloat> loglikes(num_gauss, kUndefined);
+                                     std::vector<int32> *output) {
+  int32 num_gauss = loglikes.Dim();
   output->clear();
-  this->LogLikelihoods(data, &loglikes);
-
   BaseFloat thresh;
   if (num_gselect < num_gauss) {
     Vector<BaseFloat> loglikes_copy(loglikes);
@@ -670,6 +704,41 @@ BaseFloat FullGmm::GaussianSelection(const VectorBase<BaseFloat> &data,
   return tot_loglike;
 }
 
+BaseFloat FullGmm::GaussianSelection(const VectorBase<BaseFloat> &data,
+                                     int32 num_gselect,
+                                     std::vector<int32> *output) const {
+  int32 num_gauss = NumGauss();
+  Vector<BaseFloat> loglikes(num_gauss, kUndefined);
+  this->LogLikelihoods(data, &loglikes);
+  return SelectBestGaussians(loglikes, num_gselect, output);
+}
+
+BaseFloat FullGmm::GaussianSelection(
+    const MatrixBase<BaseFloat> &data,
+    int32 num_gselect,
+    std::vector<std::vector<int32> > *output) const {
+  int32 num_frames = data.NumRows(), num_gauss = NumGauss(), dim = Dim();
+  output->clear();
+  output->resize(num_frames);
+  // Process the frames in blocks, so that the loglikes and the packed outer
+  // products of a block (see LogLikelihoods()) take up to about 10MB.
+  int32 bytes_per_frame = (num_gauss + (dim * (dim + 1)) / 2) *
+      sizeof(BaseFloat),
+      block_frames = std::max(1, 10000000 / bytes_per_frame);
+  double ans = 0.0;
+  Matrix<BaseFloat> loglikes;
+  for (int32 start = 0; start < num_frames; start += block_frames) {
+    int32 this_num_frames = std::min(num_frames - start, block_frames);
+    SubMatrix<BaseFloat> data_part(data, start, this_num_frames,
+                                   0, data.NumCols());
+    this->LogLikelihoods(data_part, &loglikes);
+    for (int32 t = 0; t < this_num_frames; t++)
+      ans += SelectBestGaussians(loglikes.Row(t), num_gselect,
+                                 &((*output)[start + t]));
+  }
+  return ans;
+}
+
 
 BaseFloat FullGmm::GaussianSelectionPreselect(
     const VectorBase<BaseFloat> &data,
@@ -819,8 +888,10 @@ void FullGmm::Read(std::istream &in_stream, bool binary) {
     KALDI_ERR << "Expected <FullGMM>, got " << token;
 //  ExpectToken(in_stream, binary, "<GCONSTS>");
   ReadToken(in_stream, binary, &token);
+  bool have_gconsts = false;
   if (token == "<GCONSTS>") {  // The gconsts are optional.
     gconsts_.Read(in_stream, binary);
+    have_gconsts = true;
     ExpectToken(in_stream, binary, "<WEIGHTS>");
   } else {
     if (token != "<WEIGHTS>")
@@ -842,7 +913,11 @@ void FullGmm::Read(std::istream &in_stream, bool binary) {
   if (token != "<FullGMMEnd>" && token != "</FullGMM>")
     KALDI_ERR << "Expected </FullGMM>, got " << token;
 
-  ComputeGconsts();  // safer option than trusting the read gconsts
+  // As in DiagGmm::Read(), we trust gconsts read in binary mode.
+  if (binary && have_gconsts && gconsts_.Dim() == weights_.Dim())
+    valid_gconsts_ = true;
+  else
+    ComputeGconsts();
 }
 
 std::istream & operator >>(std::istream & in_stream, kaldi::FullGmm &gmm) {
@@ -73,6 +73,14 @@ class FullGmm {
   void LogLikelihoods(const VectorBase<BaseFloat> &data,
                       Vector<BaseFloat> *loglikes) const;
 
+  /// This version of the LogLikelihoods function operates on a sequence of
+  /// frames simultaneously; the row index of both "data" and "loglikes" is the
+  /// frame index.  It forms the (packed) outer products of the frames once and
+  /// evaluates all the components with matrix multiplications, which is much
+  /// faster than calling the vector version for each frame.
+  void LogLikelihoods(const MatrixBase<BaseFloat> &data,
+                      Matrix<BaseFloat> *loglikes) const;
+
   /// Outputs the per-component log-likelihoods of a subset of mixture
   /// components. Note: indices.size() will equal loglikes->Dim() at output.
   /// loglikes[i] will correspond to the log-likelihood of the Gaussian
@@ -88,6 +96,13 @@ class FullGmm {
                               int32 num_gselect,
                               std::vector<int32> *output) const;
 
+  /// This version of the Gaussian selection function works for a sequence
+  /// of frames rather than just a single frame.  Returns sum of the log-likes
+  /// over all frames.
+  BaseFloat GaussianSelection(const MatrixBase<BaseFloat> &data,
+                              int32 num_gselect,
+                              std::vector<std::vector<int32> > *output) const;
+
   /// Get gaussian selection information for one frame.  Returns log-like for
   /// this frame.  Output is the best "num_gselect" indices that were
   /// preselected, sorted from best to worst likelihood.  If "num_gselect" >
@@ -0,0 +1,115 @@
+// gmm/mle-am-diag-gmm-batched.cc
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gmm/mle-am-diag-gmm-batched.h"
+
+namespace kaldi {
+
+AccumAmDiagGmmBatched::AccumAmDiagGmmBatched(const AmDiagGmm &model) {
+  int32 num_pdfs = model.NumPdfs(), dim = model.Dim();
+  offsets_.resize(num_pdfs + 1);
+  offsets_[0] = 0;
+  for (int32 i = 0; i < num_pdfs; i++)
+    offsets_[i + 1] = offsets_[i] + model.GetPdf(i).NumGauss();
+  int32 tot_gauss = offsets_[num_pdfs];
+
+  Matrix<BaseFloat> means_invvars(tot_gauss, dim, kUndefined),
+      inv_vars(tot_gauss, dim, kUndefined), gconsts(1, tot_gauss, kUndefined);
+  for (int32 i = 0; i < num_pdfs; i++) {
+    const DiagGmm &gmm = model.GetPdf(i);
+    if (!gmm.valid_gconsts())
+      KALDI_ERR << "Must call ComputeGconsts() before using the model";
+    int32 num_gauss = gmm.NumGauss();
+    means_invvars.Range(offsets_[i], num_gauss, 0, dim).CopyFromMat(
+        gmm.means_invvars());
+    inv_vars.Range(offsets_[i], num_gauss, 0, dim).CopyFromMat(
+        gmm.inv_vars());
+    gconsts.Range(0, 1, offsets_[i], num_gauss).Row(0).CopyFromVec(
+        gmm.gconsts());
+  }
+  means_invvars_.Swap(&means_invvars);
+  inv_vars_.Swap(&inv_vars);
+  gconsts_.Swap(&gconsts);
+}
+
+BaseFloat AccumAmDiagGmmBatched::AccumulateForUtterance(
+    const CuMatrixBase<BaseFloat> &data,
+    const std::vector<int32> &gmm_indexes,
+    AccumAmDiagGmm *accs) const {
+  int32 num_pdfs = offsets_.size() - 1, dim = data.NumCols();
+  KALDI_ASSERT(gmm_indexes.size() == static_cast<size_t>(data.NumRows()) &&
+               accs->NumAccs() == num_pdfs && dim == means_invvars_.NumCols());
+  std::vector<std::vector<MatrixIndexT> > frames(num_pdfs);
+  for (size_t t = 0; t < gmm_indexes.size(); t++) {
+    KALDI_ASSERT(gmm_indexes[t] >= 0 && gmm_indexes[t] < num_pdfs);
+    frames[gmm_indexes[t]].push_back(t);
+  }
+  CuMatrix<BaseFloat> data_sq(data);
+  data_sq.ApplyPow(2.0);
+
+  double tot_log_like = 0.0;
+  for (int32 i = 0; i < num_pdfs; i++) {
+    int32 num_frames = frames[i].size();
+    if (num_frames == 0) continue;
+    int32 offset = offsets_[i], num_gauss = offsets_[i + 1] - offset;
+    CuSubMatrix<BaseFloat> means_invvars(means_invvars_, offset, num_gauss,
+                                         0, dim),
+        inv_vars(inv_vars_, offset, num_gauss, 0, dim),
+        gconsts(gconsts_, 0, 1, offset, num_gauss);
+
+    CuMatrix<BaseFloat> feats(num_frames, dim, kUndefined),
+        feats_sq(num_frames, dim, kUndefined),
+        loglikes(num_frames, num_gauss, kUndefined);
+    feats.CopyRows(data, frames[i]);
+    feats_sq.CopyRows(data_sq, frames[i]);
+    loglikes.CopyRowsFromVec(gconsts.Row(0));
+    loglikes.AddMatMat(1.0, feats, kNoTrans, means_invvars, kTrans, 1.0);
+    loglikes.AddMatMat(-0.5, feats_sq, kNoTrans, inv_vars, kTrans, 1.0);
+
+    // The per-frame log-likelihoods are only needed for diagnostics; we get
+    // them on the CPU rather than writing a per-row log-sum-exp.
+    Matrix<BaseFloat> loglikes_cpu(loglikes);
+    for (int32 t = 0; t < num_frames; t++) {
+      BaseFloat log_like = loglikes_cpu.Row(t).LogSumExp();
+      if (KALDI_ISNAN(log_like) || KALDI_ISINF(log_like))
+        KALDI_ERR << "Invalid answer (overflow or invalid variances/features?)";
+      tot_log_like += log_like;
+    }
+
+    CuMatrix<BaseFloat> post(num_frames, num_gauss, kUndefined),
+        x_stats(num_gauss, dim), x2_stats(num_gauss, dim);
+    post.ApplySoftMaxPerRow(loglikes);
+    CuVector<BaseFloat> occ(num_gauss);
+    occ.AddRowSumMat(1.0, post, 0.0);
+    x_stats.AddMatMat(1.0, post, kTrans, feats, kNoTrans, 0.0);
+    x2_stats.AddMatMat(1.0, post, kTrans, feats_sq, kNoTrans, 0.0);
+
+    Vector<double> occ_cpu(occ.Dim(), kUndefined);
+    occ.CopyToVec(&occ_cpu);
+    Matrix<double> x_stats_cpu(x_stats), x2_stats_cpu(x2_stats);
+    AccumDiagGmm &acc = accs->GetAcc(i);
+    KALDI_ASSERT(acc.NumGauss() == num_gauss);
+    for (int32 g = 0; g < num_gauss; g++)
+      acc.AddStatsForComponent(g, occ_cpu(g), x_stats_cpu.Row(g),
+                               x2_stats_cpu.Row(g));
+  }
+  accs->AddToTotals(data.NumRows(), tot_log_like);
+  return tot_log_like;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,65 @@
+// gmm/mle-am-diag-gmm-batched.h
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_GMM_MLE_AM_DIAG_GMM_BATCHED_H_
+#define KALDI_GMM_MLE_AM_DIAG_GMM_BATCHED_H_
+
+#include <vector>
+#include "gmm/mle-am-diag-gmm.h"
+#include "cudamatrix/cu-matrix.h"
+#include "cudamatrix/cu-vector.h"
+
+namespace kaldi {
+
+/// This class does the same job as AccumAmDiagGmm::AccumulateForUtterance(),
+/// but with CuMatrix operations, so on the GPU if one is in use.  The frames
+/// of an utterance that are aligned to each pdf are gathered into a matrix;
+/// the Gaussian log-likelihoods are computed from it with two matrix
+/// multiplications, the posteriors with a per-row softmax, and the stats
+/// with two more (posteriors^T * feats and posteriors^T * feats^2).  Only the
+/// stats are copied back and added to the double-precision accumulators.
+/// The matrix operations are done in single precision, so the stats match
+/// those of AccumAmDiagGmm only to within roundoff.
+class AccumAmDiagGmmBatched {
+ public:
+  /// Copies the Gaussian parameters from "model" (to the GPU, if in use).
+  /// "model" must not be changed while this object exists, and it must have
+  /// valid gconsts.
+  explicit AccumAmDiagGmmBatched(const AmDiagGmm &model);
+
+  /// Accumulates stats for an utterance into "accs", which must have been
+  /// initialized for the same model; gmm_indexes[t] is the pdf that row t of
+  /// "data" is aligned to.  Returns the total log-likelihood.
+  BaseFloat AccumulateForUtterance(const CuMatrixBase<BaseFloat> &data,
+                                   const std::vector<int32> &gmm_indexes,
+                                   AccumAmDiagGmm *accs) const;
+
+ private:
+  /// The Gaussians of pdf i are rows offsets_[i] through offsets_[i+1] - 1 of
+  /// the matrices below.
+  std::vector<int32> offsets_;
+  CuMatrix<BaseFloat> means_invvars_;
+  CuMatrix<BaseFloat> inv_vars_;
+  /// The gconsts of all the Gaussians, as a single row.
+  CuMatrix<BaseFloat> gconsts_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(AccumAmDiagGmmBatched);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_GMM_MLE_AM_DIAG_GMM_BATCHED_H_
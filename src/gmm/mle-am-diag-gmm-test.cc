@@ -20,6 +20,7 @@
 #include "gmm/model-test-common.h"
 #include "gmm/am-diag-gmm.h"
 #include "gmm/mle-am-diag-gmm.h"
+#include "gmm/mle-am-diag-gmm-batched.h"
 #include "util/kaldi-io.h"
 
 using kaldi::AmDiagGmm;
@@ -88,6 +89,40 @@ void TestAmDiagGmmAccsIO(const AmDiagGmm &am_gmm,
   delete accs2;
 }
 
+// Tests that accumulating a whole utterance at once, on the CPU or with
+// AccumAmDiagGmmBatched, gives the same stats as accumulating frame by frame.
+void TestAmDiagGmmAccsUtterance(const AmDiagGmm &am_gmm,
+                                const Matrix<BaseFloat> &feats) {
+  std::vector<int32> gmm_indexes(feats.NumRows());
+  for (size_t t = 0; t < gmm_indexes.size(); t++)
+    gmm_indexes[t] = RandInt(0, am_gmm.NumPdfs() - 1);
+
+  AccumAmDiagGmm accs, accs_utt, accs_batched;
+  accs.Init(am_gmm, kGmmAll);
+  accs_utt.Init(am_gmm, kGmmAll);
+  accs_batched.Init(am_gmm, kGmmAll);
+  BaseFloat loglike = 0.0;
+  for (int32 t = 0; t < feats.NumRows(); t++)
+    loglike += accs.AccumulateForGmm(am_gmm, feats.Row(t), gmm_indexes[t],
+                                     1.0);
+  BaseFloat loglike_utt = accs_utt.AccumulateForUtterance(am_gmm, feats,
+                                                          gmm_indexes);
+  AccumAmDiagGmmBatched batched(am_gmm);
+  CuMatrix<BaseFloat> cu_feats(feats);
+  BaseFloat loglike_batched = batched.AccumulateForUtterance(cu_feats,
+                                                             gmm_indexes,
+                                                             &accs_batched);
+  AssertEqual(loglike, loglike_utt, 1e-4);
+  AssertEqual(loglike, loglike_batched, 1e-4);
+  AssertEqual(accs.TotLogLike(), accs_batched.TotLogLike(), 1e-4);
+  AssertEqual(accs.TotCount(), accs_utt.TotCount(), 1e-5);
+  AssertEqual(accs.TotCount(), accs_batched.TotCount(), 1e-5);
+  for (int32 i = 0; i < am_gmm.NumPdfs(); i++) {
+    accs.GetAcc(i).AssertEqual(accs_utt.GetAcc(i));
+    accs.GetAcc(i).AssertEqual(accs_batched.GetAcc(i));
+  }
+}
+
 void UnitTestMleAmDiagGmm() {
   int32 dim = 1 + kaldi::RandInt(0, 9),  // random dimension of the gmm
       num_pdfs = 5 + kaldi::RandInt(0, 9);  // random number of states
@@ -123,6 +158,7 @@ void UnitTestMleAmDiagGmm() {
     }
   }
   TestAmDiagGmmAccsIO(am_gmm, feats);
+  TestAmDiagGmmAccsUtterance(am_gmm, feats);
 }
 
 
@@ -21,6 +21,7 @@
 #include "gmm/am-diag-gmm.h"
 #include "gmm/mle-am-diag-gmm.h"
 #include "util/stl-utils.h"
+#include "thread/kaldi-thread.h"
 
 namespace kaldi {
 
@@ -78,6 +79,29 @@ BaseFloat AccumAmDiagGmm::AccumulateForGmm(
   return log_like;
 }
 
+BaseFloat AccumAmDiagGmm::AccumulateForUtterance(
+    const AmDiagGmm &model, const MatrixBase<BaseFloat> &data,
+    const std::vector<int32> &gmm_indexes) {
+  KALDI_ASSERT(gmm_indexes.size() == static_cast<size_t>(data.NumRows()));
+  std::vector<std::vector<MatrixIndexT> > frames(gmm_accumulators_.size());
+  for (size_t t = 0; t < gmm_indexes.size(); t++) {
+    KALDI_ASSERT(static_cast<size_t>(gmm_indexes[t]) < frames.size());
+    frames[gmm_indexes[t]].push_back(t);
+  }
+  double log_like = 0.0;
+  for (size_t i = 0; i < frames.size(); i++) {
+    if (frames[i].empty()) continue;
+    Matrix<BaseFloat> this_data(frames[i].size(), data.NumCols(),
+                                kUndefined);
+    this_data.CopyRows(data, frames[i]);
+    log_like += gmm_accumulators_[i]->AccumulateFromDiag(model.GetPdf(i),
+                                                         this_data);
+  }
+  total_log_like_ += log_like;
+  total_frames_ += data.NumRows();
+  return log_like;
+}
+
 BaseFloat AccumAmDiagGmm::AccumulateForGmmTwofeats(
     const AmDiagGmm &model,
     const VectorBase<BaseFloat> &data1,
@@ -184,6 +208,31 @@ void ResizeModel (int32 dim, AmDiagGmm *am_gmm) {
   }
 }
 
+// Updates the GMMs of a range of pdfs, for RunParallelFor().
+class MleAmDiagGmmUpdateClass {
+ public:
+  MleAmDiagGmmUpdateClass(const MleDiagGmmOptions &config,
+                          const AccumAmDiagGmm &am_diag_gmm_acc,
+                          GmmFlagsType flags, AmDiagGmm *am_gmm,
+                          std::vector<BaseFloat> *obj_changes,
+                          std::vector<BaseFloat> *counts):
+      config_(&config), am_diag_gmm_acc_(&am_diag_gmm_acc), flags_(flags),
+      am_gmm_(am_gmm), obj_changes_(obj_changes), counts_(counts) { }
+  void operator () (int32 begin, int32 end) {
+    for (int32 i = begin; i < end; i++)
+      MleDiagGmmUpdate(*config_, am_diag_gmm_acc_->GetAcc(i), flags_,
+                       &(am_gmm_->GetPdf(i)), &((*obj_changes_)[i]),
+                       &((*counts_)[i]));
+  }
+ private:
+  const MleDiagGmmOptions *config_;
+  const AccumAmDiagGmm *am_diag_gmm_acc_;
+  GmmFlagsType flags_;
+  AmDiagGmm *am_gmm_;
+  std::vector<BaseFloat> *obj_changes_;
+  std::vector<BaseFloat> *counts_;
+};
+
 void MleAmDiagGmmUpdate (const MleDiagGmmOptions &config,
                          const AccumAmDiagGmm &am_diag_gmm_acc,
                          GmmFlagsType flags,
@@ -200,18 +249,19 @@ void MleAmDiagGmmUpdate (const MleDiagGmmOptions &config,
   
   KALDI_ASSERT(am_gmm != NULL);
   KALDI_ASSERT(am_diag_gmm_acc.NumAccs() == am_gmm->NumPdfs());
+  int32 num_pdfs = am_diag_gmm_acc.NumAccs();
+  // The pdfs are updated in parallel; the totals are summed afterwards, in
+  // order, so they don't depend on the number of threads.
+  std::vector<BaseFloat> obj_changes(num_pdfs), counts(num_pdfs);
+  MleAmDiagGmmUpdateClass c(config, am_diag_gmm_acc, flags, am_gmm,
+                            &obj_changes, &counts);
+  RunParallelFor(0, num_pdfs, c);
+
   if (obj_change_out != NULL) *obj_change_out = 0.0;
   if (count_out != NULL) *count_out = 0.0;
-  BaseFloat tmp_obj_change, tmp_count;
-  BaseFloat *p_obj = (obj_change_out != NULL) ? &tmp_obj_change : NULL,
-            *p_count   = (count_out != NULL) ? &tmp_count : NULL;
-
-  for (int32 i = 0; i < am_diag_gmm_acc.NumAccs(); i++) {
-    MleDiagGmmUpdate(config, am_diag_gmm_acc.GetAcc(i), flags,
-                     &(am_gmm->GetPdf(i)), p_obj, p_count);
-
-    if (obj_change_out != NULL) *obj_change_out += tmp_obj_change;
-    if (count_out != NULL) *count_out += tmp_count;
+  for (int32 i = 0; i < num_pdfs; i++) {
+    if (obj_change_out != NULL) *obj_change_out += obj_changes[i];
+    if (count_out != NULL) *count_out += counts[i];
   }
 }
 
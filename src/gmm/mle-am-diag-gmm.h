@@ -52,6 +52,15 @@ class AccumAmDiagGmm {
                              const VectorBase<BaseFloat> &data,
                              int32 gmm_index, BaseFloat weight);
 
+  /// Accumulates stats for a whole utterance, where gmm_indexes[t] is the GMM
+  /// that row t of "data" is aligned to (weight 1.0); returns the total log
+  /// likelihood.  The frames aligned to each GMM are processed together with
+  /// matrix operations (see AccumDiagGmm::AccumulateFromDiag), so this is
+  /// faster than calling AccumulateForGmm() for each frame.
+  BaseFloat AccumulateForUtterance(const AmDiagGmm &model,
+                                   const MatrixBase<BaseFloat> &data,
+                                   const std::vector<int32> &gmm_indexes);
+
   /// Accumulate stats for a single GMM in the model; uses data1 for
   /// getting posteriors and data2 for stats. Returns log likelihood.
   BaseFloat AccumulateForGmmTwofeats(const AmDiagGmm &model,
@@ -83,6 +92,13 @@ class AccumAmDiagGmm {
   BaseFloat TotCount() const { return total_frames_; }
   BaseFloat TotLogLike() const { return total_log_like_; }
 
+  /// Adds to the totals returned by TotCount() and TotLogLike(); for code
+  /// that accumulates the stats of the GMMs itself via GetAcc().
+  void AddToTotals(double num_frames, double log_like) {
+    total_frames_ += num_frames;
+    total_log_like_ += log_like;
+  }
+
   const AccumDiagGmm& GetAcc(int32 index) const;
 
   AccumDiagGmm& GetAcc(int32 index);
@@ -109,6 +125,7 @@ class AccumAmDiagGmm {
 
 /// for computing the maximum-likelihood estimates of the parameters of
 /// an acoustic model that uses diagonal Gaussian mixture models as emission densities.
+/// The pdfs are updated in parallel, with g_num_threads threads.
 void MleAmDiagGmmUpdate(const MleDiagGmmOptions &config,
                         const AccumAmDiagGmm &amdiaggmm_acc,
                         GmmFlagsType flags,
@@ -203,6 +203,46 @@ BaseFloat AccumDiagGmm::AccumulateFromDiag(const DiagGmm &gmm,
   return log_like;
 }
 
+void AccumDiagGmm::AccumulateFromPosteriors(
+    const MatrixBase<BaseFloat> &data,
+    const MatrixBase<BaseFloat> &posteriors) {
+  if (flags_ & kGmmMeans)
+    KALDI_ASSERT(static_cast<int32>(data.NumCols()) == Dim());
+  KALDI_ASSERT(static_cast<int32>(posteriors.NumCols()) == NumGauss() &&
+               posteriors.NumRows() == data.NumRows());
+  Matrix<double> post_d(posteriors);  // Copy with type-conversion
+
+  occupancy_.AddRowSumMat(1.0, post_d);
+  if (flags_ & kGmmMeans) {
+    Matrix<double> data_d(data);  // Copy with type-conversion
+    mean_accumulator_.AddMatMat(1.0, post_d, kTrans, data_d, kNoTrans, 1.0);
+    if (flags_ & kGmmVariances) {
+      data_d.ApplyPow(2.0);
+      variance_accumulator_.AddMatMat(1.0, post_d, kTrans, data_d, kNoTrans,
+                                      1.0);
+    }
+  }
+}
+
+BaseFloat AccumDiagGmm::AccumulateFromDiag(const DiagGmm &gmm,
+                                           const MatrixBase<BaseFloat> &data) {
+  KALDI_ASSERT(gmm.NumGauss() == NumGauss());
+  KALDI_ASSERT(gmm.Dim() == Dim());
+  KALDI_ASSERT(static_cast<int32>(data.NumCols()) == Dim());
+
+  Matrix<BaseFloat> posteriors;
+  gmm.LogLikelihoods(data, &posteriors);
+  double log_like = 0.0;
+  for (MatrixIndexT t = 0; t < posteriors.NumRows(); t++) {
+    BaseFloat this_log_like = posteriors.Row(t).ApplySoftMax();
+    if (KALDI_ISNAN(this_log_like) || KALDI_ISINF(this_log_like))
+      KALDI_ERR << "Invalid answer (overflow or invalid variances/features?)";
+    log_like += this_log_like;
+  }
+  AccumulateFromPosteriors(data, posteriors);
+  return log_like;
+}
+
 // Careful: this wouldn't be valid if it were used to update the
 // Gaussian weights.
 void AccumDiagGmm::SmoothStats(BaseFloat tau) {
@@ -142,6 +142,19 @@ class AccumDiagGmm {
                                const VectorBase<BaseFloat> &data,
                                BaseFloat frame_posterior);
 
+  /// Accumulate for all components, for many frames at once: row t of
+  /// "gauss_posteriors" holds the posteriors for row t of "data".  The stats
+  /// are accumulated with matrix multiplications.
+  void AccumulateFromPosteriors(const MatrixBase<BaseFloat> &data,
+                                const MatrixBase<BaseFloat> &gauss_posteriors);
+
+  /// This does the same job as AccumulateFromDiag for each row of "data" (with
+  /// frame_posterior = 1.0), but computes the likelihoods and accumulates the
+  /// stats for all the frames together with matrix operations.  Returns the
+  /// total log-likelihood.
+  BaseFloat AccumulateFromDiag(const DiagGmm &gmm,
+                               const MatrixBase<BaseFloat> &data);
+
   /// This does the same job as AccumulateFromDiag, but using
   /// multiple threads.  Returns sum of (log-likelihood times
   /// frame weight) over all frames.
@@ -109,24 +109,11 @@ int main(int argc, char *argv[]) {
 
         Posterior pdf_posterior;
         ConvertPosteriorToPdfs(trans_model, posterior, &pdf_posterior);
-        for (size_t i = 0; i < posterior.size(); i++) {
-          for (size_t j = 0; j < pdf_posterior[i].size(); j++) {
-            int32 pdf_id = pdf_posterior[i][j].first;
-            BaseFloat weight = pdf_posterior[i][j].second;
-
-            Vector<BaseFloat> posteriors;
-            const DiagGmm &gmm = am_gmm.GetPdf(pdf_id);
-            tot_like_this_file +=
-                weight * gmm.ComponentPosteriors(transformed_mat.Row(i),
-                                                 &posteriors);
-            tot_weight += weight;
-            posteriors.Scale(weight);
-            hlda_accs.AccumulateFromPosteriors(pdf_id,
-                                               gmm,
-                                               mat.Row(i),
-                                               posteriors);
-          }
-        }
+        for (size_t i = 0; i < pdf_posterior.size(); i++)
+          for (size_t j = 0; j < pdf_posterior[i].size(); j++)
+            tot_weight += pdf_posterior[i][j].second;
+        tot_like_this_file = hlda_accs.AccumulateFromPdfPosteriors(
+            am_gmm, mat, transformed_mat, pdf_posterior);
         KALDI_LOG << "Average like for this file is "
                   << (tot_like_this_file/tot_weight) << " over "
                   << tot_weight <<" frames.";
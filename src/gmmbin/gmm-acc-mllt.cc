@@ -94,17 +94,11 @@ int main(int argc, char *argv[]) {
 
         Posterior pdf_posterior;
         ConvertPosteriorToPdfs(trans_model, posterior, &pdf_posterior);
-        for (size_t i = 0; i < posterior.size(); i++) {
-          for (size_t j = 0; j < pdf_posterior[i].size(); j++) {
-            int32 pdf_id = pdf_posterior[i][j].first;
-            BaseFloat weight = pdf_posterior[i][j].second;
-
-            tot_like_this_file += mllt_accs.AccumulateFromGmm(am_gmm.GetPdf(pdf_id),
-                                                              mat.Row(i),
-                                                              weight) * weight;
-            tot_weight += weight;
-          }
-        }
+        for (size_t i = 0; i < pdf_posterior.size(); i++)
+          for (size_t j = 0; j < pdf_posterior[i].size(); j++)
+            tot_weight += pdf_posterior[i][j].second;
+        tot_like_this_file = mllt_accs.AccumulateFromPdfPosteriors(
+            am_gmm, mat, pdf_posterior);
         KALDI_LOG << "Average like for this file is "
                   << (tot_like_this_file/tot_weight) << " over "
                   << tot_weight << " frames.";
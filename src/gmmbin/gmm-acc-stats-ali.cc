@@ -23,6 +23,8 @@
 #include "gmm/am-diag-gmm.h"
 #include "hmm/transition-model.h"
 #include "gmm/mle-am-diag-gmm.h"
+#include "gmm/mle-am-diag-gmm-batched.h"
+#include "cudamatrix/cu-device.h"
 
 
 
@@ -39,7 +41,11 @@ int main(int argc, char *argv[]) {
 
     ParseOptions po(usage);
     bool binary = true;
+    std::string use_gpu = "no";
     po.Register("binary", &binary, "Write output in binary mode");
+    po.Register("use-gpu", &use_gpu,
+                "yes|no|optional, only has effect if compiled with CUDA.  If "
+                "the GPU is used, the stats are accumulated on it.");
     po.Read(argc, argv);
 
     if (po.NumArgs() != 4) {
@@ -52,6 +58,10 @@ int main(int argc, char *argv[]) {
         alignments_rspecifier = po.GetArg(3),
         accs_wxfilename = po.GetArg(4);
 
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().SelectGpuId(use_gpu);
+#endif
+
     AmDiagGmm am_gmm;
     TransitionModel trans_model;
     {
@@ -65,6 +75,11 @@ int main(int argc, char *argv[]) {
     trans_model.InitStats(&transition_accs);
     AccumAmDiagGmm gmm_accs;
     gmm_accs.Init(am_gmm, kGmmAll);
+    AccumAmDiagGmmBatched *batched_accs = NULL;
+#if HAVE_CUDA==1
+    if (CuDevice::Instantiate().Enabled())
+      batched_accs = new AccumAmDiagGmmBatched(am_gmm);
+#endif
 
     double tot_like = 0.0;
     kaldi::int64 tot_t = 0;
@@ -90,14 +105,21 @@ int main(int argc, char *argv[]) {
         }
 
         num_done++;
-        BaseFloat tot_like_this_file = 0.0;
+        BaseFloat tot_like_this_file;
 
+        std::vector<int32> pdf_ids(alignment.size());
         for (size_t i = 0; i < alignment.size(); i++) {
-          int32 tid = alignment[i],  // transition identifier.
-              pdf_id = trans_model.TransitionIdToPdf(tid);
+          int32 tid = alignment[i];  // transition identifier.
+          pdf_ids[i] = trans_model.TransitionIdToPdf(tid);
           trans_model.Accumulate(1.0, tid, &transition_accs);
-          tot_like_this_file += gmm_accs.AccumulateForGmm(am_gmm, mat.Row(i),
-                                                          pdf_id, 1.0);
+        }
+        if (batched_accs != NULL) {
+          CuMatrix<BaseFloat> cu_mat(mat);
+          tot_like_this_file = batched_accs->AccumulateForUtterance(
+              cu_mat, pdf_ids, &gmm_accs);
+        } else {
+          tot_like_this_file = gmm_accs.AccumulateForUtterance(am_gmm, mat,
+                                                               pdf_ids);
         }
         tot_like += tot_like_this_file;
         tot_t += alignment.size();
@@ -109,6 +131,7 @@ int main(int argc, char *argv[]) {
         }
       }
     }
+    delete batched_accs;
     KALDI_LOG << "Done " << num_done << " files, " << num_err
               << " with errors.";
 
@@ -121,6 +144,9 @@ int main(int argc, char *argv[]) {
       gmm_accs.Write(ko.Stream(), binary);
     }
     KALDI_LOG << "Written accs.";
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().PrintProfile();
+#endif
     if (num_done != 0)
       return 0;
     else
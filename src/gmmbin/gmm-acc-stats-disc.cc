@@ -0,0 +1,376 @@
+// gmmbin/gmm-acc-stats-disc.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "gmm/am-diag-gmm.h"
+#include "gmm/mle-am-diag-gmm.h"
+#include "gmm/decodable-am-diag-gmm.h"
+#include "hmm/transition-model.h"
+#include "hmm/posterior.h"
+#include "lat/kaldi-lattice.h"
+#include "lat/lattice-functions.h"
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+struct DiscAccsOptions {
+  std::string criterion;
+  bool rescore;
+  BaseFloat old_acoustic_scale;
+  BaseFloat acoustic_scale;
+  BaseFloat lm_scale;
+  BaseFloat b;
+  BaseFloat max_silence_error;
+  bool drop_frames;
+  bool cancel;
+  std::vector<int32> silence_phones;
+
+  DiscAccsOptions(): criterion("mmi"), rescore(true), old_acoustic_scale(0.0),
+                     acoustic_scale(0.1), lm_scale(1.0), b(0.0),
+                     max_silence_error(0.0), drop_frames(true),
+                     cancel(true) { }
+};
+
+// The numerator and denominator stats, as written by gmm-acc-stats2.
+struct DiscAccs {
+  Vector<double> num_trans_accs;
+  Vector<double> den_trans_accs;
+  AccumAmDiagGmm num_gmm_accs;
+  AccumAmDiagGmm den_gmm_accs;
+  double tot_like;  // total acoustic likelihood, weighted by the posteriors.
+  double tot_weight;  // total of the (signed) posteriors.
+  double tot_objf;  // total objective function (MMI: den lattice likelihood).
+
+  DiscAccs(const TransitionModel &trans_model, const AmDiagGmm &am_gmm,
+           GmmFlagsType flags): tot_like(0.0), tot_weight(0.0), tot_objf(0.0) {
+    trans_model.InitStats(&num_trans_accs);
+    trans_model.InitStats(&den_trans_accs);
+    num_gmm_accs.Init(am_gmm, flags);
+    den_gmm_accs.Init(am_gmm, flags);
+  }
+  void Add(const DiscAccs &other) {
+    num_trans_accs.AddVec(1.0, other.num_trans_accs);
+    den_trans_accs.AddVec(1.0, other.den_trans_accs);
+    num_gmm_accs.Add(1.0, other.num_gmm_accs);
+    den_gmm_accs.Add(1.0, other.den_gmm_accs);
+    tot_like += other.tot_like;
+    tot_weight += other.tot_weight;
+    tot_objf += other.tot_objf;
+  }
+};
+
+// One set of stats for each thread.  As TaskSequencer runs no more than
+// --num-threads tasks at a time, a task can always get a free one.
+class DiscAccsPool {
+ public:
+  DiscAccsPool(int32 num_threads, const TransitionModel &trans_model,
+               const AmDiagGmm &am_gmm, GmmFlagsType flags) {
+    for (int32 i = 0; i < num_threads; i++)
+      accs_.push_back(new DiscAccs(trans_model, am_gmm, flags));
+    free_ = accs_;
+  }
+  DiscAccs *Get() {
+    mutex_.Lock();
+    KALDI_ASSERT(!free_.empty());
+    DiscAccs *ans = free_.back();
+    free_.pop_back();
+    mutex_.Unlock();
+    return ans;
+  }
+  void Release(DiscAccs *accs) {
+    mutex_.Lock();
+    free_.push_back(accs);
+    mutex_.Unlock();
+  }
+  /// Adds the stats of the other threads to the first ones, and returns them.
+  DiscAccs &Merge() {
+    for (size_t i = 1; i < accs_.size(); i++)
+      accs_[0]->Add(*(accs_[i]));
+    return *(accs_[0]);
+  }
+  ~DiscAccsPool() { DeletePointers(&accs_); }
+ private:
+  std::vector<DiscAccs*> accs_;
+  std::vector<DiscAccs*> free_;
+  Mutex mutex_;
+};
+
+// Computes the discriminative-training posteriors of one utterance from its
+// lattice and numerator alignment, and accumulates the stats for them.  Run
+// in parallel by TaskSequencer; the destructor only updates the counts.
+class DiscAccsTask {
+ public:
+  DiscAccsTask(const DiscAccsOptions &opts, const TransitionModel &trans_model,
+               const AmDiagGmm &am_gmm, const std::string &key,
+               const CompactLattice &clat, const Matrix<BaseFloat> &feats,
+               const std::vector<int32> &alignment, DiscAccsPool *pool,
+               int32 *num_done, int32 *num_err, int64 *num_frames):
+      opts_(opts), trans_model_(trans_model), am_gmm_(am_gmm), key_(key),
+      clat_(clat), feats_(feats), alignment_(alignment), pool_(pool),
+      ok_(false), num_done_(num_done), num_err_(num_err),
+      num_frames_(num_frames) { }
+
+  void operator () () {
+    if (opts_.rescore) {
+      if (opts_.old_acoustic_scale != 1.0)
+        fst::ScaleLattice(fst::AcousticLatticeScale(opts_.old_acoustic_scale),
+                          &clat_);
+      DecodableAmDiagGmm gmm_decodable(am_gmm_, trans_model_, feats_);
+      if (!RescoreCompactLattice(&gmm_decodable, &clat_)) return;
+    }
+    Lattice lat;
+    ConvertLattice(clat_, &lat);
+    clat_.DeleteStates();
+    if (lat.Start() == fst::kNoStateId) {
+      KALDI_WARN << "Empty lattice for utterance " << key_;
+      return;
+    }
+    if (opts_.b != 0.0 &&
+        !LatticeBoost(trans_model_, alignment_, opts_.silence_phones, opts_.b,
+                      opts_.max_silence_error, &lat))
+      return;  // will already have printed a warning.
+    if (opts_.acoustic_scale != 1.0 || opts_.lm_scale != 1.0)
+      fst::ScaleLattice(fst::LatticeScale(opts_.lm_scale, opts_.acoustic_scale),
+                        &lat);
+    TopSortLatticeIfNeeded(&lat);
+
+    Posterior post;
+    BaseFloat objf;
+    if (opts_.criterion == "mmi")
+      objf = LatticeForwardBackwardMmi(trans_model_, lat, alignment_,
+                                       opts_.drop_frames, false, opts_.cancel,
+                                       &post);
+    else
+      objf = LatticeForwardBackwardMpeVariants(trans_model_,
+                                               opts_.silence_phones, lat,
+                                               alignment_, opts_.criterion,
+                                               &post);
+    if (post.size() != static_cast<size_t>(feats_.NumRows())) {
+      KALDI_WARN << "Lattice for utterance " << key_ << " has wrong length "
+                 << post.size() << " vs. " << feats_.NumRows();
+      return;
+    }
+
+    DiscAccs *accs = pool_->Get();
+    accs->tot_objf += objf;
+    for (size_t i = 0; i < post.size(); i++) {
+      for (size_t j = 0; j < post[i].size(); j++) {
+        int32 tid = post[i][j].first,
+            pdf_id = trans_model_.TransitionIdToPdf(tid);
+        BaseFloat weight = post[i][j].second;
+        trans_model_.Accumulate(fabs(weight), tid,
+                                (weight > 0.0 ? &accs->num_trans_accs :
+                                 &accs->den_trans_accs));
+        accs->tot_like +=
+            (weight > 0.0 ? &accs->num_gmm_accs : &accs->den_gmm_accs)->
+            AccumulateForGmm(am_gmm_, feats_.Row(i), pdf_id, fabs(weight)) *
+            weight;
+        accs->tot_weight += weight;
+      }
+    }
+    pool_->Release(accs);
+    ok_ = true;
+  }
+
+  ~DiscAccsTask() {
+    if (ok_) {
+      (*num_done_)++;
+      *num_frames_ += feats_.NumRows();
+    } else {
+      (*num_err_)++;
+    }
+  }
+ private:
+  const DiscAccsOptions &opts_;
+  const TransitionModel &trans_model_;
+  const AmDiagGmm &am_gmm_;
+  std::string key_;
+  CompactLattice clat_;
+  Matrix<BaseFloat> feats_;
+  std::vector<int32> alignment_;
+  DiscAccsPool *pool_;
+  bool ok_;
+  int32 *num_done_;
+  int32 *num_err_;
+  int64 *num_frames_;
+};
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  using namespace kaldi;
+  typedef kaldi::int32 int32;
+  typedef kaldi::int64 int64;
+  try {
+    const char *usage =
+        "Accumulate numerator and denominator stats for discriminative GMM\n"
+        "training (MMI, boosted MMI, MPFE or SMBR) directly from the\n"
+        "denominator lattices and numerator alignments.  This does in one\n"
+        "program what the pipeline gmm-rescore-lattice | lattice-boost-ali |\n"
+        "lattice-to-post (or lattice-to-mpe-post) | gmm-acc-stats2 does, with\n"
+        "--num-threads threads.  The output is as for gmm-acc-stats2: the\n"
+        "positive posteriors go to the num stats, the negative ones to den.\n"
+        "Usage:  gmm-acc-stats-disc [options] <model-in> <feature-rspecifier> "
+        "<lats-rspecifier> <ali-rspecifier> <num-stats-out> <den-stats-out>\n"
+        "e.g.:\n"
+        " gmm-acc-stats-disc --b=0.1 --silence-phones=1:2:3 1.mdl \"$feats\" "
+        "ark:1.lats ark:1.ali 1.num_acc 1.den_acc\n";
+
+    ParseOptions po(usage);
+    bool binary = true;
+    std::string update_flags_str = "mvwt";
+    std::string silence_phones_str;
+    DiscAccsOptions opts;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
+    po.Register("binary", &binary, "Write stats in binary mode");
+    po.Register("update-flags", &update_flags_str, "Which GMM parameters to "
+                "update: subset of mvwt.");
+    po.Register("criterion", &opts.criterion, "Criterion: \"mmi\", \"mpfe\" "
+                "or \"smbr\".");
+    po.Register("rescore", &opts.rescore, "If true, replace the acoustic "
+                "scores in the lattices with those of the model (as "
+                "gmm-rescore-lattice).");
+    po.Register("old-acoustic-scale", &opts.old_acoustic_scale, "With "
+                "--rescore=true, add in the scores in the input lattices with "
+                "this scale, rather than discarding them.");
+    po.Register("acoustic-scale", &opts.acoustic_scale,
+                "Scaling factor for acoustic likelihoods");
+    po.Register("lm-scale", &opts.lm_scale,
+                "Scaling factor for \"graph costs\" (including LM costs)");
+    po.Register("b", &opts.b, "Boosting factor for boosted MMI (as "
+                "lattice-boost-ali); zero for no boosting.");
+    po.Register("max-silence", &opts.max_silence_error, "Maximum error "
+                "assigned to silence phones when boosting [c.f. "
+                "--silence-phones option].");
+    po.Register("silence-phones", &silence_phones_str, "Colon-separated list "
+                "of integer id's of silence phones, e.g. 46:47");
+    po.Register("drop-frames", &opts.drop_frames, "For MMI: if true, ignore "
+                "the frames where the numerator and denominator pdf-ids are "
+                "disjoint.");
+    po.Register("cancel", &opts.cancel, "For MMI: if true, cancel the "
+                "numerator and denominator posteriors of the same "
+                "transition-id.");
+    sequencer_config.Register(&po);
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 6) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    if (opts.criterion != "mmi" && opts.criterion != "mpfe" &&
+        opts.criterion != "smbr")
+      KALDI_ERR << "Invalid --criterion " << opts.criterion;
+    if (sequencer_config.num_threads < 1)
+      KALDI_ERR << "--num-threads must be at least 1";
+    if (opts.acoustic_scale == 0.0)
+      KALDI_ERR << "Do not use a zero acoustic scale (cannot be inverted)";
+    if (!SplitStringToIntegers(silence_phones_str, ":", false,
+                               &opts.silence_phones))
+      KALDI_ERR << "Invalid silence-phones string " << silence_phones_str;
+    SortAndUniq(&opts.silence_phones);
+    if (opts.silence_phones.empty() && (opts.b != 0.0 || opts.criterion != "mmi"))
+      KALDI_WARN << "No silence phones specified, make sure this is what you "
+                 << "intended.";
+
+    std::string model_rxfilename = po.GetArg(1),
+        feature_rspecifier = po.GetArg(2),
+        lats_rspecifier = po.GetArg(3),
+        ali_rspecifier = po.GetArg(4),
+        num_accs_wxfilename = po.GetArg(5),
+        den_accs_wxfilename = po.GetArg(6);
+
+    AmDiagGmm am_gmm;
+    TransitionModel trans_model;
+    {
+      bool binary;
+      Input ki(model_rxfilename, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_gmm.Read(ki.Stream(), binary);
+    }
+
+    DiscAccsPool pool(sequencer_config.num_threads, trans_model, am_gmm,
+                      StringToGmmFlags(update_flags_str));
+
+    SequentialCompactLatticeReader lattice_reader(lats_rspecifier);
+    RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
+    RandomAccessInt32VectorReader alignment_reader(ali_rspecifier);
+
+    int32 num_done = 0, num_err = 0;
+    int64 num_frames = 0;
+    {
+      TaskSequencer<DiscAccsTask> sequencer(sequencer_config);
+      for (; !lattice_reader.Done(); lattice_reader.Next()) {
+        std::string key = lattice_reader.Key();
+        if (!feature_reader.HasKey(key)) {
+          KALDI_WARN << "No features for utterance " << key;
+          num_err++;
+          continue;
+        }
+        if (!alignment_reader.HasKey(key)) {
+          KALDI_WARN << "No alignment for utterance " << key;
+          num_err++;
+          continue;
+        }
+        // The task copies its inputs, and the reader's copy of the lattice is
+        // freed before the task runs, so no data is shared between threads.
+        DiscAccsTask *task = new DiscAccsTask(opts, trans_model, am_gmm, key,
+                                              lattice_reader.Value(),
+                                              feature_reader.Value(key),
+                                              alignment_reader.Value(key),
+                                              &pool, &num_done, &num_err,
+                                              &num_frames);
+        lattice_reader.FreeCurrent();
+        sequencer.Run(task);  // takes ownership of "task".
+      }
+    }  // the sequencer's destructor waits for the tasks to finish.
+
+    DiscAccs &accs = pool.Merge();
+    KALDI_LOG << "Done " << num_done << " files, " << num_err
+              << " had errors.";
+    KALDI_LOG << "Overall weighted acoustic likelihood per frame was "
+              << (accs.tot_like / num_frames) << " over " << num_frames
+              << " frames; average weight per frame was "
+              << (accs.tot_weight / num_frames);
+    if (opts.criterion == "mmi")
+      KALDI_LOG << "Overall denominator log-likelihood per frame was "
+                << (accs.tot_objf / num_frames);
+    else
+      KALDI_LOG << "Overall average frame-accuracy was "
+                << (accs.tot_objf / num_frames);
+
+    {
+      Output ko(num_accs_wxfilename, binary);
+      accs.num_trans_accs.Write(ko.Stream(), binary);
+      accs.num_gmm_accs.Write(ko.Stream(), binary);
+    }
+    {
+      Output ko(den_accs_wxfilename, binary);
+      accs.den_trans_accs.Write(ko.Stream(), binary);
+      accs.den_gmm_accs.Write(ko.Stream(), binary);
+    }
+    KALDI_LOG << "Written accs.";
+    return (num_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
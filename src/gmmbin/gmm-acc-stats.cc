@@ -76,9 +76,10 @@ int main(int argc, char *argv[]) {
     double tot_t = 0.0;
 
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
-    RandomAccessPosteriorReader posteriors_reader(posteriors_rspecifier);
+    RandomAccessCompactPosteriorReader posteriors_reader(posteriors_rspecifier);
 
     int32 num_done = 0, num_err = 0;
+    CompactPosterior pdf_posterior;  // reused, to avoid reallocation.
     for (; !feature_reader.Done(); feature_reader.Next()) {
       std::string key = feature_reader.Key();
       if (!posteriors_reader.HasKey(key)) {
@@ -86,11 +87,11 @@ int main(int argc, char *argv[]) {
         num_err++;
       } else {
         const Matrix<BaseFloat> &mat = feature_reader.Value();
-        const Posterior &posterior = posteriors_reader.Value(key);
+        const CompactPosterior &posterior = posteriors_reader.Value(key);
 
-        if (static_cast<int32>(posterior.size()) != mat.NumRows()) {
-          KALDI_WARN << "Posterior vector has wrong size " 
-                     << (posterior.size()) << " vs. "
+        if (posterior.NumFrames() != mat.NumRows()) {
+          KALDI_WARN << "Posterior vector has wrong size "
+                     << posterior.NumFrames() << " vs. "
                      << (mat.NumRows());
           num_err++;
           continue;
@@ -99,22 +100,23 @@ int main(int argc, char *argv[]) {
         num_done++;
         BaseFloat tot_like_this_file = 0.0, tot_weight = 0.0;
 
-        Posterior pdf_posterior;
         ConvertPosteriorToPdfs(trans_model, posterior, &pdf_posterior);
-        for (size_t i = 0; i < posterior.size(); i++) {
+        for (int32 i = 0; i < posterior.NumFrames(); i++) {
           // Accumulates for GMM.
-          for (size_t j = 0; j < pdf_posterior[i].size(); j++) {
-            int32 pdf_id = pdf_posterior[i][j].first;
-            BaseFloat weight = pdf_posterior[i][j].second;
+          for (int32 j = pdf_posterior.FrameBegin(i);
+               j < pdf_posterior.FrameEnd(i); j++) {
+            int32 pdf_id = pdf_posterior.Id(j);
+            BaseFloat weight = pdf_posterior.Weight(j);
             tot_like_this_file += gmm_accs.AccumulateForGmm(am_gmm, mat.Row(i), pdf_id, weight)
                 * weight;
             tot_weight += weight;
           }
 
           // Accumulates for transitions.
-          for (size_t j = 0; j < posterior[i].size(); j++) {
-            int32 tid = posterior[i][j].first;
-            BaseFloat weight = posterior[i][j].second;
+          for (int32 j = posterior.FrameBegin(i); j < posterior.FrameEnd(i);
+               j++) {
+            int32 tid = posterior.Id(j);
+            BaseFloat weight = posterior.Weight(j);
             trans_model.Accumulate(weight, tid, &transition_accs);
           }
         }
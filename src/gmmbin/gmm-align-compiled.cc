@@ -29,6 +29,7 @@
 #include "decoder/training-graph-compiler.h"
 #include "gmm/decodable-am-diag-gmm.h"
 #include "lat/kaldi-lattice.h" // for {Compact}LatticeArc
+#include "thread/kaldi-task-sequence.h"
 
 int main(int argc, char *argv[]) {
   try {
@@ -46,32 +47,31 @@ int main(int argc, char *argv[]) {
         " gmm-align-compiled 1.mdl ark:graphs.fsts scp:train.scp ark:1.ali\n"
         "or:\n"
         " compile-train-graphs tree 1.mdl lex.fst ark:train.tra b, ark:- | \\\n"
-        "   gmm-align-compiled 1.mdl ark:- scp:train.scp t, ark:1.ali\n";
+        "   gmm-align-compiled 1.mdl ark:- scp:train.scp t, ark:1.ali\n"
+        "With --num-threads=N, utterances are aligned in parallel (the output\n"
+        "is in the same order).\n";
 
     ParseOptions po(usage);
-    BaseFloat beam = 200.0;
-    BaseFloat retry_beam = 0.0;
+    AlignConfig align_config;
     BaseFloat acoustic_scale = 1.0;
-    BaseFloat transition_scale = 1.0;
-    BaseFloat self_loop_scale = 1.0;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
 
-    po.Register("beam", &beam, "Decoding beam");
-    po.Register("retry-beam", &retry_beam, "Decoding beam for second try at alignment");
-    po.Register("transition-scale", &transition_scale, "Transition-probability scale [relative to acoustics]");
+    align_config.Register(&po);
     po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for acoustic likelihoods");
-    po.Register("self-loop-scale", &self_loop_scale, "Scale of self-loop versus non-self-loop log probs [relative to acoustics]");
+    sequencer_config.Register(&po);
     po.Read(argc, argv);
 
     if (po.NumArgs() < 4 || po.NumArgs() > 5) {
       po.PrintUsage();
       exit(1);
     }
-    if (retry_beam != 0 && retry_beam <= beam)
-      KALDI_WARN << "Beams do not make sense: beam " << beam
-                 << ", retry-beam " << retry_beam;
+    if (align_config.retry_beam != 0 &&
+        align_config.retry_beam <= align_config.beam)
+      KALDI_WARN << "Beams do not make sense: beam " << align_config.beam
+                 << ", retry-beam " << align_config.retry_beam;
     
     FasterDecoderOptions decode_opts;
-    decode_opts.beam = beam;  // Don't set the other options.
+    decode_opts.beam = align_config.beam;  // Don't set the other options.
 
     std::string model_in_filename = po.GetArg(1);
     std::string fst_rspecifier = po.GetArg(2);
@@ -94,87 +94,49 @@ int main(int argc, char *argv[]) {
     BaseFloatWriter scores_writer(scores_wspecifier);
 
     int num_success = 0, num_no_feat = 0, num_other_error = 0, num_retry = 0;
-    BaseFloat tot_like = 0.0;
+    double tot_like = 0.0;
     kaldi::int64 frame_count = 0;
 
-    for (; !fst_reader.Done(); fst_reader.Next()) {
-      std::string key = fst_reader.Key();
-      if (!feature_reader.HasKey(key)) {
-        num_no_feat++;
-        KALDI_WARN << "No features for utterance " << key;
-      } else {
+    // The model is shared by all the threads, read-only; the decoders are
+    // reused from one utterance to the next.
+    FasterDecoderPool decoder_pool(decode_opts);
+    {
+      TaskSequencer<AlignUtteranceClass> sequencer(sequencer_config);
+      for (; !fst_reader.Done(); fst_reader.Next()) {
+        std::string key = fst_reader.Key();
+        if (!feature_reader.HasKey(key)) {
+          num_no_feat++;
+          KALDI_WARN << "No features for utterance " << key;
+          continue;
+        }
         const Matrix<BaseFloat> &features = feature_reader.Value(key);
-        VectorFst<StdArc> decode_fst(fst_reader.Value());
-        fst_reader.FreeCurrent();  // this stops copy-on-write of the fst
-        // by deleting the fst inside the reader, since we're about to mutate
-        // the fst by adding transition probs.
-
         if (features.NumRows() == 0) {
           KALDI_WARN << "Zero-length utterance: " << key;
           num_other_error++;
           continue;
         }
-        if (decode_fst.Start() == fst::kNoStateId) {
+        VectorFst<StdArc> *decode_fst = new VectorFst<StdArc>(fst_reader.Value());
+        fst_reader.FreeCurrent();  // this stops copy-on-write of the fst
+        // by deleting the fst inside the reader, since we're about to mutate
+        // the fst by adding transition probs.
+        if (decode_fst->Start() == fst::kNoStateId) {
           KALDI_WARN << "Empty decoding graph for " << key;
           num_other_error++;
+          delete decode_fst;
           continue;
         }
-
-        {  // Add transition-probs to the FST.
-          std::vector<int32> disambig_syms;  // empty.
-          AddTransitionProbs(trans_model, disambig_syms,
-                             transition_scale, self_loop_scale,
-                             &decode_fst);
-        }
-
-        // SimpleDecoder decoder(decode_fst, beam);
-        FasterDecoder decoder(decode_fst, decode_opts);
-        // makes it a bit faster: 37 sec -> 26 sec on 1000 RM utterances @ beam 200.
-
-        DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
-                                               acoustic_scale);
-        decoder.Decode(&gmm_decodable);
-
-        VectorFst<LatticeArc> decoded;  // linear FST.
-        bool ans = decoder.ReachedFinal() // consider only final states.
-            && decoder.GetBestPath(&decoded);  
-        if (!ans && retry_beam != 0.0) {
-          num_retry++;
-          KALDI_WARN << "Retrying utterance " << key << " with beam " << retry_beam;
-          decode_opts.beam = retry_beam;
-          decoder.SetOptions(decode_opts);
-          decoder.Decode(&gmm_decodable);
-          ans = decoder.ReachedFinal() // consider only final states.
-              && decoder.GetBestPath(&decoded);  
-          decode_opts.beam = beam;
-          decoder.SetOptions(decode_opts);
-        }
-        if (ans) {
-          std::vector<int32> alignment;
-          std::vector<int32> words;
-          LatticeWeight weight;
-          frame_count += features.NumRows();
-
-          GetLinearSymbolSequence(decoded, &alignment, &words, &weight);
-          BaseFloat like = -(weight.Value1()+weight.Value2()) / acoustic_scale;
-          tot_like += like;
-          if (scores_writer.IsOpen())
-            scores_writer.Write(key, -(weight.Value1()+weight.Value2()));
-          alignment_writer.Write(key, alignment);
-          num_success ++;
-          if (num_success % 50  == 0) {
-            KALDI_LOG << "Processed " << num_success << " utterances, "
-                      << "log-like per frame for " << key << " is "
-                      << (like / features.NumRows()) << " over "
-                      << features.NumRows() << " frames.";
-          }
-        } else {
-          KALDI_WARN << "Did not successfully decode file " << key << ", len = "
-                     << (features.NumRows());
-          num_other_error++;
-        }
+        // The likelihoods are computed in the thread, while decoding.
+        DecodableAmDiagGmmScaled *gmm_decodable = new DecodableAmDiagGmmScaled(
+            am_gmm, trans_model, acoustic_scale, -1.0,
+            new Matrix<BaseFloat>(features));
+        AlignUtteranceClass *task = new AlignUtteranceClass(
+            trans_model, align_config, acoustic_scale, &decoder_pool, key,
+            decode_fst, gmm_decodable, features.NumRows(), &alignment_writer,
+            &scores_writer, &tot_like, &frame_count, &num_success,
+            &num_other_error, &num_retry);
+        sequencer.Run(task);  // takes ownership of "task".
       }
-    }
+    }  // the sequencer's destructor waits for the tasks to finish.
     KALDI_LOG << "Overall log-likelihood per frame is " << (tot_like/frame_count)
               << " over " << frame_count<< " frames.";
     KALDI_LOG << "Retried " << num_retry << " out of "
@@ -128,6 +128,7 @@ int main(int argc, char *argv[]) {
 
           num_done++;
         }  // end looping over all utterances of this speaker
+        spk_stats.CommitFrameStats();
         basis_accs.AccuGradientScatter(spk_stats);
         num_spk++;
       }  // end looping over speakers
@@ -157,6 +158,8 @@ int main(int argc, char *argv[]) {
         AccumulateForUtterance(feats, gpost, trans_model, am_gmm, &utt_stats);
         num_done++;
 
+        utt_stats.CommitFrameStats();
+
         basis_accs.AccuGradientScatter(utt_stats);
       } // end looping over all utterances
     }
@@ -129,6 +129,7 @@ int main(int argc, char *argv[]) {
 
           num_done++;
         }  // end looping over all utterances of this speaker
+        spk_stats.CommitFrameStats();
         basis_accs.AccuGradientScatter(spk_stats);
         num_spk++;
       }  // end looping over speakers
@@ -158,6 +159,8 @@ int main(int argc, char *argv[]) {
         AccumulateForUtterance(feats, post, trans_model, am_gmm, &utt_stats);
         num_done++;
 
+        utt_stats.CommitFrameStats();
+
         basis_accs.AccuGradientScatter(utt_stats);
       } // end looping over utterances
     }
@@ -21,7 +21,9 @@
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "gmm/am-diag-gmm.h"
+#include "gmm/decodable-am-diag-gmm.h"
 #include "hmm/transition-model.h"
+#include "cudamatrix/cu-device.h"
 #include "fstext/fstext-lib.h"
 #include "util/timer.h"
 
@@ -40,6 +42,10 @@ int main(int argc, char *argv[]) {
         "(outputs matrices of log-likelihoods indexed by (frame, pdf)\n"
         "Usage: gmm-compute-likes [options] model-in features-rspecifier likes-wspecifier\n";
     ParseOptions po(usage);
+    std::string use_gpu = "no";
+    po.Register("use-gpu", &use_gpu,
+                "yes|no|optional, only has effect if compiled with CUDA.  If "
+                "the GPU is used, the log-likelihoods are computed on it.");
 
     po.Read(argc, argv);
 
@@ -52,6 +58,10 @@ int main(int argc, char *argv[]) {
         feature_rspecifier = po.GetArg(2),
         loglikes_wspecifier = po.GetArg(3);
 
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().SelectGpuId(use_gpu);
+#endif
+
     AmDiagGmm am_gmm;
     {
       bool binary;
@@ -61,6 +71,14 @@ int main(int argc, char *argv[]) {
       am_gmm.Read(ki.Stream(), binary);
     }
 
+    StackedAmDiagGmmCuScorer *cu_scorer = NULL;
+#if HAVE_CUDA==1
+    if (CuDevice::Instantiate().Enabled()) {
+      StackedAmDiagGmm stacked(am_gmm);
+      cu_scorer = new StackedAmDiagGmmCuScorer(stacked);
+    }
+#endif
+
     BaseFloatMatrixWriter loglikes_writer(loglikes_wspecifier);
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
 
@@ -68,6 +86,13 @@ int main(int argc, char *argv[]) {
     for (; !feature_reader.Done(); feature_reader.Next()) {
       std::string key = feature_reader.Key();
       const Matrix<BaseFloat> &features (feature_reader.Value());
+      if (cu_scorer != NULL) {
+        CuMatrix<BaseFloat> cu_feats(features), cu_loglikes;
+        cu_scorer->LogLikelihoods(cu_feats, &cu_loglikes);
+        loglikes_writer.Write(key, Matrix<BaseFloat>(cu_loglikes));
+        num_done++;
+        continue;
+      }
       Matrix<BaseFloat> loglikes(features.NumRows(), am_gmm.NumPdfs());
       for (int32 i = 0; i < features.NumRows(); i++) {
         for (int32 j = 0; j < am_gmm.NumPdfs(); j++) {
@@ -79,6 +104,10 @@ int main(int argc, char *argv[]) {
       num_done++;
     }
 
+    delete cu_scorer;
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().PrintProfile();
+#endif
     KALDI_LOG << "gmm-compute-likes: computed likelihoods for " << num_done
               << " utterances.";
     return 0;
@@ -71,7 +71,8 @@ bool DecodeUtterance(kaldi::FasterDecoder *decoder,
                      DecodeInfo *info,
                      const string &uttid,
                      int32 num_frames,
-                     BaseFloat *total_like) {
+                     BaseFloat *total_like,
+                     vector<kaldi::int32> *alignment_out) {
   decoder->Decode(decodable);
   KALDI_LOG << "Length of file is " << num_frames;;
 
@@ -86,6 +87,7 @@ bool DecodeUtterance(kaldi::FasterDecoder *decoder,
     LatticeWeight weight;
     GetLinearSymbolSequence(decoded, &alignment, &words, &weight);
 
+    if (alignment_out != NULL) *alignment_out = alignment;
     info->words_writer.Write(uttid, words);
     if (info->alignment_writer.IsOpen())
       info->alignment_writer.Write(uttid, alignment);
@@ -121,11 +123,19 @@ int main(int argc, char *argv[]) {
     const char *usage = "Decode features using GMM-based model.\n"
               "Usage: gmm-decode-faster-regtree-mllr [options] model-in fst-in "
               "regtree-in features-rspecifier transforms-rspecifier "
-              "words-wspecifier [alignments-wspecifier]\n";
+              "words-wspecifier [alignments-wspecifier]\n"
+              "With --incremental=true, the transform of each speaker is "
+              "re-estimated\n"
+              "after each of its utterances from the alignments so far, and "
+              "used for the\n"
+              "speaker's next utterance (until then, the transform read in "
+              "is used, if any).\n";
     ParseOptions po(usage);
     bool binary = true;
     bool allow_partial = true;
     BaseFloat acoustic_scale = 0.1;
+    bool incremental = false;
+    RegtreeMllrOptions mllr_opts;
     
     std::string word_syms_filename, utt2spk_rspecifier;
     FasterDecoderOptions decoder_opts;
@@ -139,6 +149,10 @@ int main(int argc, char *argv[]) {
         "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial,
                 "Produce output even when final state was not reached");
+    po.Register("incremental", &incremental, "If true, re-estimate each "
+                "speaker's MLLR transform after each of its utterances "
+                "[see usage message]");
+    mllr_opts.Register(&po);
     po.Read(argc, argv);
 
     if (po.NumArgs() < 6 || po.NumArgs() > 7) {
@@ -175,6 +189,8 @@ int main(int argc, char *argv[]) {
     RandomAccessRegtreeMllrDiagGmmReaderMapped mllr_reader(xforms_rspecifier,
                                                            utt2spk_rspecifier);
 
+    RandomAccessTokenReader utt2spk_reader(utt2spk_rspecifier);
+
     Int32VectorWriter words_writer(words_wspecifier);
 
     Int32VectorWriter alignment_writer(alignment_wspecifier);
@@ -193,6 +209,17 @@ int main(int argc, char *argv[]) {
     int num_success = 0, num_fail = 0;
     FasterDecoder decoder(*decode_fst, decoder_opts);
 
+    // The transformed means are kept between utterances, and only those for
+    // baseclasses whose transform changed are recomputed.
+    RegtreeMllrMeansCache means_cache(am_gmm, regtree);
+    // For --incremental: the stats and transform of the current speaker.
+    string cur_spk;
+    bool have_spk = false;
+    RegtreeMllrDiagGmmAccs spk_accs;
+    if (incremental) spk_accs.Init(regtree.NumBaseclasses(), am_gmm.Dim());
+    RegtreeMllrDiagGmm spk_mllr;
+    bool have_spk_mllr = false;
+
     Timer timer;
 
     DecodeInfo decode_info(am_gmm, trans_model, &decoder, acoustic_scale,
@@ -211,34 +238,69 @@ int main(int argc, char *argv[]) {
         continue;
       }
 
-      if (!mllr_reader.HasKey(utt)) {  // Decode without MLLR if none found
-        KALDI_WARN << "No MLLR transform for key " << utt <<
-            ", decoding without MLLR.";
-        kaldi::DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model,
-                                                      features,
-                                                      acoustic_scale);
-        if (DecodeUtterance(&decoder, &gmm_decodable, &decode_info,
-                            utt, features.NumRows(), &tot_like)) {
-          frame_count += gmm_decodable.NumFrames();
-          num_success++;
-        } else {
-          num_fail++;
+      if (incremental) {
+        string spk = utt;
+        if (utt2spk_rspecifier != "") {
+          if (!utt2spk_reader.HasKey(utt))
+            KALDI_ERR << "No speaker for utterance " << utt;
+          spk = utt2spk_reader.Value(utt);
+        }
+        if (!have_spk || spk != cur_spk) {
+          cur_spk = spk;
+          have_spk = true;
+          spk_accs.SetZero();
+          have_spk_mllr = false;
         }
-        continue;
       }
 
-      // If found, load the transforms for the current utterance.
-      const RegtreeMllrDiagGmm &mllr = mllr_reader.Value(utt);
-      kaldi::DecodableAmDiagGmmRegtreeMllr gmm_decodable(am_gmm, trans_model,
-                                                         features, mllr,
-                                                         regtree,
-                                                         acoustic_scale);
-      if (DecodeUtterance(&decoder, &gmm_decodable, &decode_info,
-                          utt, features.NumRows(), &tot_like)) {
-        frame_count += gmm_decodable.NumFrames();
-        num_success++;
+      const RegtreeMllrDiagGmm *mllr = NULL;
+      if (have_spk_mllr)
+        mllr = &spk_mllr;
+      else if (mllr_reader.HasKey(utt))
+        mllr = &mllr_reader.Value(utt);
+
+      vector<int32> alignment;
+      bool success;
+      if (mllr == NULL) {  // Decode without MLLR if none found
+        if (!incremental)
+          KALDI_WARN << "No MLLR transform for key " << utt <<
+              ", decoding without MLLR.";
+        kaldi::DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model,
+                                                      features,
+                                                      acoustic_scale);
+        success = DecodeUtterance(&decoder, &gmm_decodable, &decode_info,
+                                  utt, features.NumRows(), &tot_like,
+                                  &alignment);
       } else {
+        int32 num_changed = means_cache.SetTransform(*mllr);
+        KALDI_VLOG(2) << "Means of " << num_changed << " pdfs changed.";
+        kaldi::DecodableAmDiagGmmRegtreeMllr gmm_decodable(am_gmm, trans_model,
+                                                           features,
+                                                           &means_cache,
+                                                           acoustic_scale);
+        success = DecodeUtterance(&decoder, &gmm_decodable, &decode_info,
+                                  utt, features.NumRows(), &tot_like,
+                                  &alignment);
+      }
+      if (!success) {
         num_fail++;
+        continue;
+      }
+      frame_count += features.NumRows();
+      num_success++;
+
+      if (incremental &&
+          alignment.size() == static_cast<size_t>(features.NumRows())) {
+        for (size_t t = 0; t < alignment.size(); t++)
+          spk_accs.AccumulateForGmm(regtree, am_gmm, features.Row(t),
+                                    trans_model.TransitionIdToPdf(alignment[t]),
+                                    1.0);
+        BaseFloat impr, count;
+        spk_accs.Update(regtree, mllr_opts, &spk_mllr, &impr, &count);
+        have_spk_mllr = true;
+        KALDI_LOG << "Speaker " << cur_spk << ": MLLR objective function "
+                  << "improvement per frame is " << (impr / count) << " over "
+                  << count << " frames.";
       }
     }  // end looping over all utterances
 
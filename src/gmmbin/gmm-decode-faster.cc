@@ -29,41 +29,6 @@
 #include "util/timer.h"
 #include "lat/kaldi-lattice.h" // for CompactLatticeArc
 
-namespace kaldi {
-
-fst::Fst<fst::StdArc> *ReadNetwork(std::string filename) {
-  // read decoding network FST
-  Input ki(filename); // use ki.Stream() instead of is.
-  if (!ki.Stream().good()) KALDI_ERR << "Could not open decoding-graph FST "
-                                      << filename;
-  fst::FstHeader hdr;
-  if (!hdr.Read(ki.Stream(), "<unknown>")) {
-    KALDI_ERR << "Reading FST: error reading FST header.";
-  }
-  if (hdr.ArcType() != fst::StdArc::Type()) {
-    KALDI_ERR << "FST with arc type " << hdr.ArcType() << " not supported.\n";
-  }
-  fst::FstReadOptions ropts("<unspecified>", &hdr);
-
-  fst::Fst<fst::StdArc> *decode_fst = NULL;
-
-  if (hdr.FstType() == "vector") {
-    decode_fst = fst::VectorFst<fst::StdArc>::Read(ki.Stream(), ropts);
-  } else if (hdr.FstType() == "const") {
-    decode_fst = fst::ConstFst<fst::StdArc>::Read(ki.Stream(), ropts);
-  } else {
-    KALDI_ERR << "Reading FST: unsupported FST type: " << hdr.FstType();
-  }
-  if (decode_fst == NULL) { // fst code will warn.
-    KALDI_ERR << "Error reading FST (after reading header).";
-    return NULL;
-  } else {
-    return decode_fst;
-  }
-}
-
-}
-
 int main(int argc, char *argv[]) {
   try {
     using namespace kaldi;
@@ -75,7 +40,7 @@ int main(int argc, char *argv[]) {
         "Note: lattices, if output, will just be linear sequences; use gmm-latgen-faster\n"
         "  if you want \"real\" lattices.\n";
     ParseOptions po(usage);
-    bool allow_partial = true;
+    bool allow_partial = true, stacked_gmm = false;
     BaseFloat acoustic_scale = 0.1;
     
     std::string word_syms_filename;
@@ -87,6 +52,10 @@ int main(int argc, char *argv[]) {
                 "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial,
                 "Produce output even when final state was not reached");
+    po.Register("stacked-gmm", &stacked_gmm,
+                "If true, compute the log-likelihoods of all pdfs needed on a "
+                "frame at once using a stacked copy of the model (faster, "
+                "but uses more memory).");
     po.Read(argc, argv);
 
     if (po.NumArgs() < 4 || po.NumArgs() > 6) {
@@ -110,6 +79,9 @@ int main(int argc, char *argv[]) {
       am_gmm.Read(ki.Stream(), binary);
     }
 
+    StackedAmDiagGmm *stacked = NULL;
+    if (stacked_gmm) stacked = new StackedAmDiagGmm(am_gmm);
+
     Int32VectorWriter words_writer(words_wspecifier);
 
     Int32VectorWriter alignment_writer(alignment_wspecifier);
@@ -129,7 +101,7 @@ int main(int argc, char *argv[]) {
     // It has to do with what happens on UNIX systems if you call fork() on a
     // large process: the page-table entries are duplicated, which requires a
     // lot of virtual memory.
-    fst::Fst<fst::StdArc> *decode_fst = ReadNetwork(fst_rxfilename);
+    fst::Fst<fst::StdArc> *decode_fst = fst::ReadDecodingGraph(fst_rxfilename);
     
     BaseFloat tot_like = 0.0;
     kaldi::int64 frame_count = 0;
@@ -150,6 +122,7 @@ int main(int argc, char *argv[]) {
 
       DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
                                              acoustic_scale);
+      gmm_decodable.SetStackedModel(stacked);
       decoder.Decode(&gmm_decodable);
 
       fst::VectorFst<LatticeArc> decoded;  // linear FST.
@@ -216,6 +189,7 @@ int main(int argc, char *argv[]) {
 
     if (word_syms) delete word_syms;    
     delete decode_fst;
+    delete stacked;
     return (num_success != 0 ? 0 : 1);
   } catch(const std::exception &e) {
     std::cerr << e.what();
@@ -29,6 +29,8 @@
 #include "util/timer.h"
 #include "lat/kaldi-lattice.h" // for CompactLatticeArc
 #include "fstext/lattice-utils.h" // for ConvertLattice
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-task-sequence.h"
 
 using namespace kaldi;
 
@@ -65,6 +67,155 @@ fst::Fst<fst::StdArc> *ReadNetwork(std::string filename) {
 }
 
 
+// One decoder for each thread, so that the tokens they have allocated are
+// reused for the following utterances.  As TaskSequencer runs no more than
+// --num-threads tasks at a time, a task can always get a free one.
+class NBestDecoderPool {
+ public:
+  NBestDecoderPool(int32 num_threads, const fst::Fst<fst::StdArc> &fst,
+                   const NBestDecoderOptions &opts) {
+    for (int32 i = 0; i < num_threads; i++)
+      decoders_.push_back(new NBestDecoder(fst, opts));
+    free_ = decoders_;
+  }
+  NBestDecoder *Get() {
+    mutex_.Lock();
+    KALDI_ASSERT(!free_.empty());
+    NBestDecoder *ans = free_.back();
+    free_.pop_back();
+    mutex_.Unlock();
+    return ans;
+  }
+  void Release(NBestDecoder *decoder) {
+    mutex_.Lock();
+    free_.push_back(decoder);
+    mutex_.Unlock();
+  }
+  ~NBestDecoderPool() { DeletePointers(&decoders_); }
+ private:
+  std::vector<NBestDecoder*> decoders_;
+  std::vector<NBestDecoder*> free_;
+  Mutex mutex_;
+};
+
+// Decodes one utterance, for use with class TaskSequencer: operator() does
+// the decoding (possibly in parallel with other utterances), and the
+// destructor writes the output, in the order of the input.
+class DecodeUtteranceNBestClass {
+ public:
+  DecodeUtteranceNBestClass(const std::string &key,
+                            const AmDiagGmm &am_gmm,
+                            const TransitionModel &trans_model,
+                            BaseFloat acoustic_scale, bool allow_partial,
+                            const fst::SymbolTable *word_syms,
+                            NBestDecoderPool *decoders,
+                            Matrix<BaseFloat> *features,  // takes ownership
+                            CompactLatticeWriter *compact_lattice_writer,
+                            Int32VectorWriter *words_writer,
+                            Int32VectorWriter *alignment_writer,
+                            BaseFloat *tot_like, int64 *frame_count,
+                            int32 *num_success, int32 *num_fail):
+      key_(key), am_gmm_(am_gmm), trans_model_(trans_model),
+      acoustic_scale_(acoustic_scale), allow_partial_(allow_partial),
+      word_syms_(word_syms), decoders_(decoders), features_(features),
+      compact_lattice_writer_(compact_lattice_writer),
+      words_writer_(words_writer), alignment_writer_(alignment_writer),
+      tot_like_(tot_like), frame_count_(frame_count),
+      num_success_(num_success), num_fail_(num_fail), got_output_(false),
+      success_(false), was_final_(true), nbest_(0), nbest_beam_(0.0), like_(0.0) { }
+
+  void operator () () {
+    DecodableAmDiagGmmScaled gmm_decodable(am_gmm_, trans_model_, *features_,
+                                           acoustic_scale_);
+    NBestDecoder *decoder = decoders_->Get();
+    decoder->Decode(&gmm_decodable);
+    got_output_ = decoder->GetNBestLattice(&decoded_, &was_final_, &nbest_,
+                                           &nbest_beam_);
+    decoders_->Release(decoder);
+    if (!got_output_ || (!was_final_ && !allow_partial_)) return;
+    success_ = true;
+
+    fst::VectorFst<CompactLatticeArc> decoded1;
+    ShortestPath(decoded_, &decoded1);
+    fst::VectorFst<LatticeArc> utterance;
+    ConvertLattice(decoded1, &utterance, true);
+    LatticeWeight weight;
+    GetLinearSymbolSequence(utterance, &alignment_, &words_, &weight);
+    like_ = -(weight.Value1() - weight.Value2());
+
+    if (acoustic_scale_ != 0.0) // We'll write the lattice without acoustic scaling
+      fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / acoustic_scale_),
+                        &decoded_);
+  }
+
+  ~DecodeUtteranceNBestClass() {
+    int32 num_frames = features_->NumRows();
+    delete features_;
+    if (got_output_ && !was_final_) {
+      if (allow_partial_) {
+        KALDI_WARN << "Decoder did not reach end-state, "
+                   << "outputting partial traceback since --allow-partial=true";
+      } else {
+        KALDI_WARN << "Decoder did not reach end-state, "
+                   << "output partial traceback with --allow-partial=true";
+      }
+    }
+    if (!success_) {
+      (*num_fail_)++;
+      KALDI_WARN << "Did not successfully decode utterance " << key_
+                 << ", len = " << num_frames;
+      return;
+    }
+    (*num_success_)++;
+    KALDI_LOG << "retrieved:" << nbest_ << " tokens, effective beam:"
+              << nbest_beam_;
+    compact_lattice_writer_->Write(key_, decoded_);
+    *frame_count_ += num_frames;
+    words_writer_->Write(key_, words_);
+    if (alignment_writer_->IsOpen())
+      alignment_writer_->Write(key_, alignment_);
+    if (word_syms_ != NULL) {
+      std::cerr << key_ << ' ';
+      for (size_t i = 0; i < words_.size(); i++) {
+        std::string s = word_syms_->Find(words_[i]);
+        if (s == "")
+          KALDI_ERR << "Word-id " << words_[i] <<" not in symbol table.";
+        std::cerr << s << ' ';
+      }
+      std::cerr << '\n';
+    }
+    *tot_like_ += like_;
+    KALDI_LOG << "Log-like per frame for utterance " << key_ << " is "
+              << (like_ / num_frames) << " over " << num_frames << " frames.";
+  }
+ private:
+  std::string key_;
+  const AmDiagGmm &am_gmm_;
+  const TransitionModel &trans_model_;
+  BaseFloat acoustic_scale_;
+  bool allow_partial_;
+  const fst::SymbolTable *word_syms_;
+  NBestDecoderPool *decoders_;
+  Matrix<BaseFloat> *features_;
+  CompactLatticeWriter *compact_lattice_writer_;
+  Int32VectorWriter *words_writer_;
+  Int32VectorWriter *alignment_writer_;
+  BaseFloat *tot_like_;
+  int64 *frame_count_;
+  int32 *num_success_;
+  int32 *num_fail_;
+
+  bool got_output_;
+  bool success_;
+  bool was_final_;
+  int32 nbest_;
+  BaseFloat nbest_beam_;
+  fst::VectorFst<CompactLatticeArc> decoded_;
+  std::vector<int32> alignment_;
+  std::vector<int32> words_;
+  BaseFloat like_;
+};
+
 int main(int argc, char *argv[]) {
   try {
     typedef kaldi::int32 int32;
@@ -82,7 +233,9 @@ int main(int argc, char *argv[]) {
     
     std::string word_syms_filename;
     NBestDecoderOptions decoder_opts;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
     decoder_opts.Register(&po, true);  // true == include obscure settings.
+    sequencer_config.Register(&po);
     po.Register("acoustic-scale", &acoustic_scale,
                 "Scaling factor for acoustic likelihoods");
     po.Register("word-symbol-table", &word_syms_filename,
@@ -96,6 +249,10 @@ int main(int argc, char *argv[]) {
       exit(1);
     }
 
+    // With many decoding threads, queue log messages rather than having the
+    // threads wait for stderr.
+    if (sequencer_config.num_threads > 1) SetLogAsync(true);
+
     std::string model_in_filename = po.GetArg(1),
         fst_in_filename = po.GetArg(2),
         feature_rspecifier = po.GetArg(3),
@@ -139,91 +296,32 @@ int main(int argc, char *argv[]) {
 
     BaseFloat tot_like = 0.0;
     kaldi::int64 frame_count = 0;
-    int num_success = 0, num_fail = 0;
-    NBestDecoder decoder(*decode_fst, decoder_opts);
+    int32 num_success = 0, num_fail = 0;
+    NBestDecoderPool decoders(sequencer_config.num_threads, *decode_fst,
+                              decoder_opts);
 
     Timer timer;
 
-    for (; !feature_reader.Done(); feature_reader.Next()) {
-      std::string key = feature_reader.Key();
-      Matrix<BaseFloat> features (feature_reader.Value());
-      feature_reader.FreeCurrent();
-      if (features.NumRows() == 0) {
-        KALDI_WARN << "Zero-length utterance: " << key;
-        num_fail++;
-        continue;
-      }
-
-      DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
-                                             acoustic_scale);
-      decoder.Decode(&gmm_decodable);
-
-      fst::VectorFst<CompactLatticeArc> decoded;  // output FST.
-      bool was_final;
-      int32 nbest;
-      BaseFloat nbest_beam;
-      if (decoder.GetNBestLattice(&decoded, &was_final, &nbest, &nbest_beam)) {
-        if (!was_final) {
-          if (allow_partial) {
-            KALDI_WARN << "Decoder did not reach end-state, "
-               << "outputting partial traceback since --allow-partial=true";
-          } else {
-            KALDI_WARN << "Decoder did not reach end-state, "
-               << "output partial traceback with --allow-partial=true";
-            num_fail++;
-            KALDI_WARN << "Did not successfully decode utterance " << key
-                   << ", len = " << features.NumRows();
-            continue; // next utterance
-          }
-        }
-        num_success++;
-        KALDI_LOG << "retrieved:" << nbest << " tokens, effective beam:" << nbest_beam;
-
-//        std::cout << "n-best paths:\n";
-//        fst::FstPrinter<CompactLatticeArc> fstprinter(decoded, NULL, NULL, NULL, false, true);
-//        fstprinter.Print(&std::cout, "standard output");
-
-        if (acoustic_scale != 0.0) // We'll write the lattice without acoustic scaling
-          fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / acoustic_scale), &decoded);
-        compact_lattice_writer.Write(key, decoded);
-
-        fst::VectorFst<CompactLatticeArc> decoded1;
-        ShortestPath(decoded, &decoded1);
-        fst::VectorFst<LatticeArc> utterance;
-        ConvertLattice(decoded1, &utterance, true);
-
-        std::vector<int32> alignment;
-        std::vector<int32> words;
-        LatticeWeight weight;
-        frame_count += features.NumRows();
-
-        GetLinearSymbolSequence(utterance, &alignment, &words, &weight);
-
-        words_writer.Write(key, words);
-        if (alignment_writer.IsOpen())
-          alignment_writer.Write(key, alignment);
-        if (word_syms != NULL) {
-          std::cerr << key << ' ';
-          for (size_t i = 0; i < words.size(); i++) {
-            std::string s = word_syms->Find(words[i]);
-            if (s == "")
-              KALDI_ERR << "Word-id " << words[i] <<" not in symbol table.";
-            std::cerr << s << ' ';
-          }
-          std::cerr << '\n';
+    {
+      TaskSequencer<DecodeUtteranceNBestClass> sequencer(sequencer_config);
+      for (; !feature_reader.Done(); feature_reader.Next()) {
+        std::string key = feature_reader.Key();
+        Matrix<BaseFloat> *features =
+            new Matrix<BaseFloat>(feature_reader.Value());
+        feature_reader.FreeCurrent();
+        if (features->NumRows() == 0) {
+          KALDI_WARN << "Zero-length utterance: " << key;
+          num_fail++;
+          delete features;
+          continue;
         }
-        BaseFloat like = -(weight.Value1() - weight.Value2());
-        // KALDI_LOG << "final weight:" << weight.Value1() << "," << weight.Value2();
-        tot_like += like;
-        KALDI_LOG << "Log-like per frame for utterance " << key << " is "
-                  << (like / features.NumRows()) << " over "
-                  << features.NumRows() << " frames.";
-      } else {
-        num_fail++;
-        KALDI_WARN << "Did not successfully decode utterance " << key
-                   << ", len = " << features.NumRows();
+        sequencer.Run(new DecodeUtteranceNBestClass(
+            key, am_gmm, trans_model, acoustic_scale, allow_partial, word_syms,
+            &decoders, features, &compact_lattice_writer, &words_writer,
+            &alignment_writer, &tot_like, &frame_count, &num_success,
+            &num_fail));  // takes ownership of the task.
       }
-    }
+    }  // the sequencer's destructor waits for the tasks to finish.
 
     double elapsed = timer.Elapsed();
     KALDI_LOG << "Time taken [excluding initialization] "<< elapsed
@@ -151,6 +151,7 @@ int main(int argc, char *argv[]) {
 
         double impr, spk_tot_t; int32 wgt_size;
         {
+          spk_stats.CommitFrameStats();
           // Compute the transform and write it out.
           Matrix<BaseFloat> transform(am_gmm.Dim(), am_gmm.Dim() + 1);
           transform.SetUnit();
@@ -194,6 +195,7 @@ int main(int argc, char *argv[]) {
         AccumulateForUtterance(feats, post, trans_model, am_gmm, &spk_stats);
         num_done++;
 
+        spk_stats.CommitFrameStats();
         BaseFloat impr, utt_tot_t; int32 wgt_size;
         {  // Compute the transform and write it out.
           Matrix<BaseFloat> transform(am_gmm.Dim(), am_gmm.Dim()+1);
@@ -30,6 +30,7 @@ using std::vector;
 #include "hmm/transition-model.h"
 #include "transform/fmllr-diag-gmm.h"
 #include "hmm/posterior.h"
+#include "thread/kaldi-task-sequence.h"
 
 namespace kaldi {
 void AccumulateForUtterance(const Matrix<BaseFloat> &feats,
@@ -49,6 +50,64 @@ void AccumulateForUtterance(const Matrix<BaseFloat> &feats,
   }
 }
 
+// This class is used to estimate the transforms of several speakers (or
+// utterances) in parallel, with TaskSequencer.  The accumulation and the
+// update happen in the operator (); the output happens in the destructor.
+class FmllrEstimateTask {
+ public:
+  FmllrEstimateTask(const TransitionModel &trans_model,
+                    const AmDiagGmm &am_gmm,
+                    const FmllrOptions &fmllr_opts,
+                    const std::string &key,  // speaker or utterance.
+                    bool is_speaker,
+                    BaseFloatMatrixWriter *transform_writer,
+                    double *tot_impr,
+                    double *tot_t):
+      trans_model_(trans_model), am_gmm_(am_gmm), fmllr_opts_(fmllr_opts),
+      key_(key), is_speaker_(is_speaker), transform_writer_(transform_writer),
+      tot_impr_(tot_impr), tot_t_(tot_t), impr_(0.0), count_(0.0) { }
+
+  // Adds an utterance; call this before the task is run.
+  void AddUtterance(const Matrix<BaseFloat> &feats, const Posterior &post) {
+    feats_.push_back(feats);
+    posts_.push_back(post);
+  }
+
+  void operator () () {
+    FmllrDiagGmmAccs spk_stats(am_gmm_.Dim(), fmllr_opts_);
+    for (size_t i = 0; i < feats_.size(); i++)
+      AccumulateForUtterance(feats_[i], posts_[i], trans_model_, am_gmm_,
+                             &spk_stats);
+    feats_.clear();  // Free memory.
+    posts_.clear();
+    transform_.Resize(am_gmm_.Dim(), am_gmm_.Dim() + 1);
+    transform_.SetUnit();
+    spk_stats.Update(fmllr_opts_, &transform_, &impr_, &count_);
+  }
+
+  ~FmllrEstimateTask() {
+    transform_writer_->Write(key_, transform_);
+    KALDI_LOG << "For " << (is_speaker_ ? "speaker " : "utterance ") << key_
+              << ", auxf-impr from fMLLR is " << (impr_ / count_) << ", over "
+              << count_ << " frames.";
+    *tot_impr_ += impr_;
+    *tot_t_ += count_;
+  }
+ private:
+  const TransitionModel &trans_model_;
+  const AmDiagGmm &am_gmm_;
+  const FmllrOptions &fmllr_opts_;
+  std::string key_;
+  bool is_speaker_;
+  BaseFloatMatrixWriter *transform_writer_;
+  double *tot_impr_;
+  double *tot_t_;
+  std::vector<Matrix<BaseFloat> > feats_;
+  std::vector<Posterior> posts_;
+  Matrix<BaseFloat> transform_;
+  BaseFloat impr_;
+  BaseFloat count_;
+};
 
 }
 
@@ -65,10 +124,12 @@ int main(int argc, char *argv[]) {
 
     ParseOptions po(usage);
     FmllrOptions fmllr_opts;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
     string spk2utt_rspecifier;
     po.Register("spk2utt", &spk2utt_rspecifier, "rspecifier for speaker to "
                 "utterance-list map");
     fmllr_opts.Register(&po);
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -99,91 +160,77 @@ int main(int argc, char *argv[]) {
     BaseFloatMatrixWriter transform_writer(trans_wspecifier);
 
     int32 num_done = 0, num_no_post = 0, num_other_error = 0;
-    if (spk2utt_rspecifier != "") {  // per-speaker adaptation
-      SequentialTokenVectorReader spk2utt_reader(spk2utt_rspecifier);
-      RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
-
-      for (; !spk2utt_reader.Done(); spk2utt_reader.Next()) {
-        FmllrDiagGmmAccs spk_stats(am_gmm.Dim(), fmllr_opts);
-        string spk = spk2utt_reader.Key();
-        const vector<string> &uttlist = spk2utt_reader.Value();
-        for (size_t i = 0; i < uttlist.size(); i++) {
-          std::string utt = uttlist[i];
-          if (!feature_reader.HasKey(utt)) {
-            KALDI_WARN << "Did not find features for utterance " << utt;
-            num_other_error++;
-            continue;
-          }
+    {
+      // The speakers (or utterances) are processed in parallel; the tasks
+      // write their output and add to tot_impr and tot_t in their
+      // destructors, which the sequencer calls one at a time, in order.
+      TaskSequencer<FmllrEstimateTask> sequencer(sequencer_config);
+      if (spk2utt_rspecifier != "") {  // per-speaker adaptation
+        SequentialTokenVectorReader spk2utt_reader(spk2utt_rspecifier);
+        RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
+
+        for (; !spk2utt_reader.Done(); spk2utt_reader.Next()) {
+          string spk = spk2utt_reader.Key();
+          FmllrEstimateTask *task = new FmllrEstimateTask(
+              trans_model, am_gmm, fmllr_opts, spk, true, &transform_writer,
+              &tot_impr, &tot_t);
+          const vector<string> &uttlist = spk2utt_reader.Value();
+          for (size_t i = 0; i < uttlist.size(); i++) {
+            std::string utt = uttlist[i];
+            if (!feature_reader.HasKey(utt)) {
+              KALDI_WARN << "Did not find features for utterance " << utt;
+              num_other_error++;
+              continue;
+            }
+            if (!post_reader.HasKey(utt)) {
+              KALDI_WARN << "Did not find posteriors for utterance " << utt;
+              num_no_post++;
+              continue;
+            }
+            const Matrix<BaseFloat> &feats = feature_reader.Value(utt);
+            const Posterior &post = post_reader.Value(utt);
+            if (static_cast<int32>(post.size()) != feats.NumRows()) {
+              KALDI_WARN << "Posterior vector has wrong size " << (post.size())
+                         << " vs. " << (feats.NumRows());
+              num_other_error++;
+              continue;
+            }
+
+            task->AddUtterance(feats, post);
+
+            num_done++;
+          }  // end looping over all utterances of the current speaker
+          sequencer.Run(task);  // Computes the transform and writes it out.
+        }  // end looping over speakers
+      } else {  // per-utterance adaptation
+        SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
+        for (; !feature_reader.Done(); feature_reader.Next()) {
+          string utt = feature_reader.Key();
           if (!post_reader.HasKey(utt)) {
-            KALDI_WARN << "Did not find posteriors for utterance " << utt;
+            KALDI_WARN << "Did not find posts for utterance "
+                       << utt;
             num_no_post++;
             continue;
           }
-          const Matrix<BaseFloat> &feats = feature_reader.Value(utt);
+          const Matrix<BaseFloat> &feats = feature_reader.Value();
           const Posterior &post = post_reader.Value(utt);
+
           if (static_cast<int32>(post.size()) != feats.NumRows()) {
-            KALDI_WARN << "Posterior vector has wrong size " << (post.size())
-                       << " vs. " << (feats.NumRows());
+            KALDI_WARN << "Posterior has wrong size " << (post.size())
+                << " vs. " << (feats.NumRows());
             num_other_error++;
             continue;
           }
-
-          AccumulateForUtterance(feats, post, trans_model, am_gmm, &spk_stats);
-
           num_done++;
-        }  // end looping over all utterances of the current speaker
-
-        BaseFloat impr, spk_tot_t;
-        {  // Compute the transform and write it out.
-          Matrix<BaseFloat> transform(am_gmm.Dim(), am_gmm.Dim()+1);
-          transform.SetUnit();
-          spk_stats.Update(fmllr_opts, &transform, &impr, &spk_tot_t);
-          transform_writer.Write(spk, transform);
-        }
-        KALDI_LOG << "For speaker " << spk << ", auxf-impr from fMLLR is "
-                  << (impr/spk_tot_t) << ", over " << spk_tot_t << " frames.";
-        tot_impr += impr;
-        tot_t += spk_tot_t;
-      }  // end looping over speakers
-    } else {  // per-utterance adaptation
-      SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
-      for (; !feature_reader.Done(); feature_reader.Next()) {
-        string utt = feature_reader.Key();
-        if (!post_reader.HasKey(utt)) {
-          KALDI_WARN << "Did not find posts for utterance "
-                     << utt;
-          num_no_post++;
-          continue;
-        }
-        const Matrix<BaseFloat> &feats = feature_reader.Value();
-        const Posterior &post = post_reader.Value(utt);
-
-        if (static_cast<int32>(post.size()) != feats.NumRows()) {
-          KALDI_WARN << "Posterior has wrong size " << (post.size())
-              << " vs. " << (feats.NumRows());
-          num_other_error++;
-          continue;
-        }
-        num_done++;
-
-        FmllrDiagGmmAccs spk_stats(am_gmm.Dim(), fmllr_opts);
 
-        AccumulateForUtterance(feats, post, trans_model, am_gmm,
-                               &spk_stats);
-
-        BaseFloat impr, utt_tot_t;
-        {  // Compute the transform and write it out.
-          Matrix<BaseFloat> transform(am_gmm.Dim(), am_gmm.Dim()+1);
-          transform.SetUnit();
-          spk_stats.Update(fmllr_opts, &transform, &impr, &utt_tot_t);
-          transform_writer.Write(utt, transform);
+          FmllrEstimateTask *task = new FmllrEstimateTask(
+              trans_model, am_gmm, fmllr_opts, utt, false, &transform_writer,
+              &tot_impr, &tot_t);
+          task->AddUtterance(feats, post);
+          sequencer.Run(task);  // Computes the transform and writes it out.
         }
-        KALDI_LOG << "For utterance " << utt << ", auxf-impr from fMLLR is "
-                  << (impr/utt_tot_t) << ", over " << utt_tot_t << " frames.";
-        tot_impr += impr;
-        tot_t += utt_tot_t;
       }
-    }
+    }  // the sequencer's destructor waits for the remaining tasks.
 
     KALDI_LOG << "Done " << num_done << " files, " << num_no_post
               << " with no posts, " << num_other_error << " with other errors.";
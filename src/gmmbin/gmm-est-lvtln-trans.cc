@@ -136,6 +136,7 @@ int main(int argc, char *argv[]) {
           num_done++;
         }  // end looping over all utterances of the current speaker
 
+        spk_stats.CommitFrameStats();
         BaseFloat impr, spk_tot_t;
         {  // Compute the transform and write it out.
           Matrix<BaseFloat> transform(lvtln.Dim(), lvtln.Dim()+1);
@@ -183,6 +184,7 @@ int main(int argc, char *argv[]) {
 
         AccumulateForUtterance(feats, gpost, am_gmm,
                                &spk_stats);
+        spk_stats.CommitFrameStats();
         BaseFloat impr, utt_tot_t = spk_stats.beta_;
         {  // Compute the transform and write it out.
           Matrix<BaseFloat> transform(lvtln.Dim(), lvtln.Dim()+1);
@@ -23,6 +23,7 @@
 #include "tree/context-dep.h"
 #include "hmm/transition-model.h"
 #include "gmm/mle-am-diag-gmm.h"
+#include "thread/kaldi-thread.h"
 
 int main(int argc, char *argv[]) {
   try {
@@ -44,6 +45,7 @@ int main(int argc, char *argv[]) {
     BaseFloat min_count = 20.0;
     std::string update_flags_str = "mvwt";
     std::string occs_out_filename;
+    int32 num_threads = 1;
 
     ParseOptions po(usage);
     po.Register("binary", &binary_write, "Write output in binary mode");
@@ -61,10 +63,13 @@ int main(int argc, char *argv[]) {
                 "means by standard deviation times this factor.");
     po.Register("write-occs", &occs_out_filename, "File to write pdf "
                 "occupation counts to.");
+    po.Register("num-threads", &num_threads, "Number of threads used to "
+                "update, split and merge the GMMs of the pdfs in parallel.");
     tcfg.Register(&po);
     gmm_opts.Register(&po);
 
     po.Read(argc, argv);
+    g_num_threads = num_threads;
 
     if (po.NumArgs() != 3) {
       po.PrintUsage();
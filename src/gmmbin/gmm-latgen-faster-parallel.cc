@@ -27,11 +27,41 @@
 #include "hmm/transition-model.h"
 #include "fstext/fstext-lib.h"
 #include "decoder/lattice-faster-decoder.h"
+#include "decoder/decodable-matrix.h"
 #include "gmm/decodable-am-diag-gmm.h"
+#include "cudamatrix/cu-device.h"
 #include "util/timer.h"
 #include "feat/feature-functions.h"  // feature reversal
 #include "thread/kaldi-task-sequence.h"
 
+namespace kaldi {
+
+// Returns the decodable object for an utterance, which takes ownership of
+// "features".  If "cu_scorer" is not NULL the log-likelihoods of all the
+// pdfs are computed with it now and the features are deleted.
+DecodableInterface *MakeDecodable(const AmDiagGmm &am_gmm,
+                                  const TransitionModel &trans_model,
+                                  BaseFloat acoustic_scale,
+                                  BaseFloat log_sum_exp_prune,
+                                  const StackedAmDiagGmm *stacked,
+                                  const StackedAmDiagGmmCuScorer *cu_scorer,
+                                  Matrix<BaseFloat> *features) {
+  if (cu_scorer != NULL) {
+    CuMatrix<BaseFloat> cu_feats(*features), cu_loglikes;
+    delete features;
+    cu_scorer->LogLikelihoods(cu_feats, &cu_loglikes);
+    Matrix<BaseFloat> *loglikes = new Matrix<BaseFloat>(cu_loglikes);
+    return new DecodableMatrixScaledMapped(trans_model, acoustic_scale,
+                                           loglikes);
+  }
+  DecodableAmDiagGmmScaled *decodable =
+      new DecodableAmDiagGmmScaled(am_gmm, trans_model, acoustic_scale,
+                                   log_sum_exp_prune, features);
+  decodable->SetStackedModel(stacked);
+  return decodable;
+}
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -39,6 +69,7 @@ int main(int argc, char *argv[]) {
     typedef kaldi::int32 int32;
     using fst::SymbolTable;
     using fst::VectorFst;
+    using fst::Fst;
     using fst::StdArc;
 
     const char *usage =
@@ -48,11 +79,12 @@ int main(int argc, char *argv[]) {
         "features-rspecifier lattice-wspecifier [ words-wspecifier [alignments-wspecifier] ]\n";
     ParseOptions po(usage);
     Timer timer;
-    bool allow_partial = false;
+    bool allow_partial = false, stacked_gmm = false;
     BaseFloat acoustic_scale = 0.1;
     BaseFloat log_sum_exp_prune = 0.0;
     LatticeFasterDecoderConfig latgen_config;
     TaskSequencerConfig sequencer_config; // has --num-threads option
+    std::string use_gpu = "no";
     
     std::string word_syms_filename;
     latgen_config.Register(&po);
@@ -66,6 +98,15 @@ int main(int argc, char *argv[]) {
                 "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial,
                 "If true, produce output even if end state was not reached.");
+    po.Register("stacked-gmm", &stacked_gmm,
+                "If true, compute the log-likelihoods of all pdfs needed on a "
+                "frame at once using a stacked copy of the model (faster, "
+                "but uses more memory).");
+    po.Register("use-gpu", &use_gpu,
+                "yes|no|optional, only has effect if compiled with CUDA.  If "
+                "the GPU is used, the log-likelihoods of all pdfs on all "
+                "frames of each utterance are computed on it before decoding "
+                "(--stacked-gmm and --log-sum-exp-prune are then ignored).");
     
     po.Read(argc, argv);
 
@@ -74,6 +115,14 @@ int main(int argc, char *argv[]) {
       exit(1);
     }
 
+    // With many decoding threads, queue log messages rather than having the
+    // threads wait for stderr.
+    if (sequencer_config.num_threads > 1) SetLogAsync(true);
+
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().SelectGpuId(use_gpu);
+#endif
+
     std::string model_in_filename = po.GetArg(1),
         fst_in_str = po.GetArg(2),
         feature_rspecifier = po.GetArg(3),
@@ -89,6 +138,20 @@ int main(int argc, char *argv[]) {
       trans_model.Read(ki.Stream(), binary);
       am_gmm.Read(ki.Stream(), binary);
     }
+    // The stacked model, if used, is shared by all the decoding threads.
+    StackedAmDiagGmm *stacked = NULL;
+    // With the GPU, the log-likelihoods are computed here in the main thread
+    // (so only one thread uses the GPU), and the decoding threads just look
+    // them up.
+    StackedAmDiagGmmCuScorer *cu_scorer = NULL;
+#if HAVE_CUDA==1
+    if (CuDevice::Instantiate().Enabled()) {
+      StackedAmDiagGmm stacked_tmp(am_gmm);
+      cu_scorer = new StackedAmDiagGmmCuScorer(stacked_tmp);
+    }
+#endif
+    if (cu_scorer == NULL && stacked_gmm)
+      stacked = new StackedAmDiagGmm(am_gmm);
 
     bool determinize = latgen_config.determinize_lattice;
     CompactLatticeWriter compact_lattice_writer;
@@ -111,8 +174,9 @@ int main(int argc, char *argv[]) {
     double tot_like = 0.0;
     kaldi::int64 frame_count = 0;
     int num_done = 0, num_err = 0;
-    VectorFst<StdArc> *decode_fst = NULL; // only used if there is a single
-                                          // decoding graph.
+    Fst<StdArc> *decode_fst = NULL; // only used if there is a single
+                                    // decoding graph.
+    NumaReplicated<Fst<StdArc> > *graph = NULL;  // likewise.
     
     TaskSequencer<DecodeUtteranceLatticeFasterClass> sequencer(sequencer_config);
       
@@ -120,9 +184,13 @@ int main(int argc, char *argv[]) {
       SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
       // Input FST is just one FST, not a table of FSTs.
 
-      decode_fst = fst::ReadFstKaldi(fst_in_str);
+      decode_fst = fst::ReadDecodingGraph(fst_in_str);
+      // With --numa-policy, each NUMA node gets its own copy of the graph.
+      graph = new NumaReplicated<Fst<StdArc> >(*decode_fst,
+                                               g_numa_policy != "none",
+                                               fst::CopyDecodingGraph);
       
-      {    
+      {        
         for (; !feature_reader.Done(); feature_reader.Next()) {
           std::string utt = feature_reader.Key();
           Matrix<BaseFloat> *features =
@@ -135,25 +203,24 @@ int main(int argc, char *argv[]) {
             continue;
           }
           
-          LatticeFasterDecoder *decoder = new LatticeFasterDecoder(*decode_fst,
-                                                                   latgen_config);
-          // takes ownership of "features"
-          DecodableAmDiagGmmScaled *gmm_decodable =
-              new DecodableAmDiagGmmScaled(am_gmm, trans_model, 
-                                           acoustic_scale,
-                                           log_sum_exp_prune,
-                                           features);
+          int32 num_frames = features->NumRows();
+          DecodableInterface *gmm_decodable =
+              MakeDecodable(am_gmm, trans_model, acoustic_scale,
+                            log_sum_exp_prune, stacked, cu_scorer, features);
 
+          // The decoder is created by the task, in the decoding thread.
           DecodeUtteranceLatticeFasterClass *task =
               new DecodeUtteranceLatticeFasterClass(
-                  decoder, gmm_decodable, // takes ownership of these two.
+                  NULL, gmm_decodable, // takes ownership of gmm_decodable.
                   trans_model, word_syms, utt, acoustic_scale, determinize,
                   allow_partial, &alignment_writer, &words_writer,
                   &compact_lattice_writer, &lattice_writer,
-                  &tot_like, &frame_count, &num_done, &num_err, NULL);
+                  &tot_like, &frame_count, &num_done, &num_err, NULL,
+                  graph, &latgen_config);
             
-          sequencer.Run(task); // takes ownership of "task",
-          // and will delete it when done.
+          // The number of frames is the cost, for --task-lookahead.
+          sequencer.Run(task, num_frames); // takes ownership of
+          // "task", and will delete it when done.
         }
       }
     } else { // We have different FSTs for different utterances.
@@ -181,10 +248,10 @@ int main(int argc, char *argv[]) {
             latgen_config,
             new VectorFst<StdArc>(fst_reader.Value()));
           
-        // The "decodable" object takes ownership of the features.
-        DecodableAmDiagGmmScaled *gmm_decodable =
-            new DecodableAmDiagGmmScaled(am_gmm, trans_model, acoustic_scale,
-                                         log_sum_exp_prune, features);
+        int32 num_frames = features->NumRows();
+        DecodableInterface *gmm_decodable =
+            MakeDecodable(am_gmm, trans_model, acoustic_scale,
+                          log_sum_exp_prune, stacked, cu_scorer, features);
 
         DecodeUtteranceLatticeFasterClass *task =
             new DecodeUtteranceLatticeFasterClass(
@@ -193,13 +260,19 @@ int main(int argc, char *argv[]) {
                 allow_partial, &alignment_writer, &words_writer,
                 &compact_lattice_writer, &lattice_writer,
                 &tot_like, &frame_count, &num_err, &num_done, NULL);
-        sequencer.Run(task); // takes ownership of "task",
-        // and will delete it when done.
+        sequencer.Run(task, num_frames); // takes ownership of
+        // "task", and will delete it when done.
       }
     }
     sequencer.Wait();
 
+    delete graph;
     if (decode_fst != NULL) delete decode_fst;
+    delete stacked;
+    delete cu_scorer;
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().PrintProfile();
+#endif
     
     double elapsed = timer.Elapsed();
     KALDI_LOG << "Decoded with " << sequencer_config.num_threads << " threads.";
@@ -31,12 +31,34 @@
 #include "util/timer.h"
 #include "feat/feature-functions.h"  // feature reversal
 
+namespace kaldi {
+
+// Returns a new decodable object for "features": one that uses only
+// "stacked" if "am_gmm" is NULL (the model was mapped), and otherwise the
+// usual one, using "stacked" (which may be NULL) for speed.
+DecodableInterface *NewGmmDecodable(const AmDiagGmm *am_gmm,
+                                    const StackedAmDiagGmm *stacked,
+                                    const TransitionModel &trans_model,
+                                    const Matrix<BaseFloat> &features,
+                                    BaseFloat acoustic_scale) {
+  if (am_gmm == NULL)
+    return new DecodableStackedAmDiagGmmScaled(*stacked, trans_model, features,
+                                               acoustic_scale);
+  DecodableAmDiagGmmScaled *ans = new DecodableAmDiagGmmScaled(
+      *am_gmm, trans_model, features, acoustic_scale);
+  ans->SetStackedModel(stacked);
+  return ans;
+}
+
+}  // namespace kaldi
+
 int main(int argc, char *argv[]) {
   try {
     using namespace kaldi;
     typedef kaldi::int32 int32;
     using fst::SymbolTable;
     using fst::VectorFst;
+    using fst::Fst;
     using fst::StdArc;
 
     const char *usage =
@@ -45,11 +67,11 @@ int main(int argc, char *argv[]) {
         " lattice-wspecifier [ words-wspecifier [alignments-wspecifier] ]\n";
     ParseOptions po(usage);
     Timer timer;
-    bool allow_partial = false;
+    bool allow_partial = false, stacked_gmm = false;
     BaseFloat acoustic_scale = 0.1;
     LatticeFasterDecoderConfig config;
     
-    std::string word_syms_filename;
+    std::string word_syms_filename, mapped_gmm_filename;
     config.Register(&po);
     po.Register("acoustic-scale", &acoustic_scale,
                 "Scaling factor for acoustic likelihoods");
@@ -57,6 +79,16 @@ int main(int argc, char *argv[]) {
                 "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial,
                 "If true, produce output even if end state was not reached.");
+    po.Register("stacked-gmm", &stacked_gmm,
+                "If true, compute the log-likelihoods of all pdfs needed on a "
+                "frame at once using a stacked copy of the model (faster, "
+                "but uses more memory).");
+    po.Register("mapped-gmm", &mapped_gmm_filename,
+                "If set, a model written by gmm-make-mapped, which is "
+                "memory-mapped and used for the likelihoods instead of the "
+                "GMMs in model-in (from which only the transition model is "
+                "then read).  This loads instantly, and the model's memory is "
+                "shared between processes.");
     
     po.Read(argc, argv);
 
@@ -74,12 +106,23 @@ int main(int argc, char *argv[]) {
     
     TransitionModel trans_model;
     AmDiagGmm am_gmm;
+    StackedAmDiagGmm *stacked = NULL;
     {
       bool binary;
       Input ki(model_in_filename, &binary);
       trans_model.Read(ki.Stream(), binary);
-      am_gmm.Read(ki.Stream(), binary);
+      if (mapped_gmm_filename == "")
+        am_gmm.Read(ki.Stream(), binary);
+    }
+    if (mapped_gmm_filename != "") {
+      stacked = StackedAmDiagGmm::ReadMapped(mapped_gmm_filename);
+      if (stacked == NULL)
+        KALDI_ERR << "Could not map model from " << mapped_gmm_filename;
+    } else if (stacked_gmm) {
+      stacked = new StackedAmDiagGmm(am_gmm);
     }
+    const AmDiagGmm *am_gmm_ptr =
+        (mapped_gmm_filename == "" ? &am_gmm : NULL);
 
     bool determinize = config.determinize_lattice;
     CompactLatticeWriter compact_lattice_writer;
@@ -106,7 +149,7 @@ int main(int argc, char *argv[]) {
     if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) {
       SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
       // Input FST is just one FST, not a table of FSTs.
-      VectorFst<StdArc> *decode_fst = fst::ReadFstKaldi(fst_in_str);
+      Fst<StdArc> *decode_fst = fst::ReadDecodingGraph(fst_in_str);
       
       {
         LatticeFasterDecoder decoder(*decode_fst, config);
@@ -121,12 +164,12 @@ int main(int argc, char *argv[]) {
             continue;
           }
           
-          DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
-                                                 acoustic_scale);
+          DecodableInterface *gmm_decodable = NewGmmDecodable(
+              am_gmm_ptr, stacked, trans_model, features, acoustic_scale);
 
           double like;
           if (DecodeUtteranceLatticeFaster(
-                  decoder, gmm_decodable, trans_model, word_syms, utt,
+                  decoder, *gmm_decodable, trans_model, word_syms, utt,
                   acoustic_scale, determinize, allow_partial, &alignment_writer,
                   &words_writer, &compact_lattice_writer, &lattice_writer,
                   &like)) {
@@ -134,6 +177,7 @@ int main(int argc, char *argv[]) {
             frame_count += features.NumRows();
             num_done++;
           } else num_err++;
+          delete gmm_decodable;
         }
       }
       delete decode_fst; // delete this only after decoder goes out of scope.
@@ -156,11 +200,11 @@ int main(int argc, char *argv[]) {
         }
 
         LatticeFasterDecoder decoder(fst_reader.Value(), config);
-        DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
-                                               acoustic_scale);
+        DecodableInterface *gmm_decodable = NewGmmDecodable(
+            am_gmm_ptr, stacked, trans_model, features, acoustic_scale);
         double like;
         if (DecodeUtteranceLatticeFaster(
-                decoder, gmm_decodable, trans_model, word_syms, utt,
+                decoder, *gmm_decodable, trans_model, word_syms, utt,
                 acoustic_scale, determinize, allow_partial, &alignment_writer,
                 &words_writer, &compact_lattice_writer, &lattice_writer,
                 &like)) {
@@ -168,6 +212,7 @@ int main(int argc, char *argv[]) {
           frame_count += features.NumRows();
           num_done++;
         } else num_err++;
+        delete gmm_decodable;
       }
     }
       
@@ -181,6 +226,7 @@ int main(int argc, char *argv[]) {
               << frame_count << " frames.";
 
     if (word_syms) delete word_syms;
+    delete stacked;
     if (num_done != 0) return 0;
     else return 1;
   } catch(const std::exception &e) {
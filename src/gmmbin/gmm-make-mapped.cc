@@ -0,0 +1,86 @@
+// gmmbin/gmm-make-mapped.cc
+
+// Copyright 2026  agent
+// (based on gmmbin/gmm-compute-likes.cc; see that file for its authors)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "gmm/am-diag-gmm.h"
+#include "hmm/transition-model.h"
+#include "gmm/decodable-am-diag-gmm.h"
+
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using kaldi::int32;
+
+    const char *usage =
+        "Writes the Gaussians of a GMM-based acoustic model in the stacked,\n"
+        "memory-mapped format read by the --mapped-gmm option of\n"
+        "gmm-latgen-faster, so that the model loads instantly and is shared\n"
+        "between processes on the same machine.  The output must be a file, and\n"
+        "is specific to the machine's byte order and floating-point type.  The\n"
+        "transition model is not written; the decoders still read it from the\n"
+        "original model.\n"
+        "\n"
+        "Usage:  gmm-make-mapped [options] <model-in> <mapped-gmm-out>\n"
+        "E.g.:   gmm-make-mapped exp/tri3/final.mdl exp/tri3/final.mapped_gmm\n";
+
+    ParseOptions po(usage);
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string model_in_filename = po.GetArg(1),
+        mapped_out_filename = po.GetArg(2);
+
+    if (ClassifyWxfilename(mapped_out_filename) != kFileOutput)
+      KALDI_ERR << "The output of gmm-make-mapped must be a file, not "
+                << PrintableWxfilename(mapped_out_filename);
+
+    AmDiagGmm am_gmm;
+    {
+      bool binary;
+      TransitionModel trans_model;
+      Input ki(model_in_filename, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_gmm.Read(ki.Stream(), binary);
+    }
+
+    StackedAmDiagGmm stacked(am_gmm);
+    {
+      bool binary = true, write_header = false;
+      Output ko(mapped_out_filename, binary, write_header);
+      stacked.WriteMapped(ko.Stream());
+      ko.Close();
+    }
+    KALDI_LOG << "Wrote mapped model with " << stacked.NumPdfs() << " pdfs and "
+              << stacked.NumGauss() << " Gaussians to "
+              << mapped_out_filename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
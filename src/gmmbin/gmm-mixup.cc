@@ -23,6 +23,7 @@
 #include "tree/context-dep.h"
 #include "hmm/transition-model.h"
 #include "gmm/mle-am-diag-gmm.h"
+#include "thread/kaldi-thread.h"
 
 int main(int argc, char *argv[]) {
   try {
@@ -43,6 +44,7 @@ int main(int argc, char *argv[]) {
     BaseFloat perturb_factor = 0.01;
     BaseFloat power = 0.2;
     BaseFloat min_count = 20.0;
+    int32 num_threads = 1;
     
     ParseOptions po(usage);
     po.Register("binary", &binary_write, "Write output in binary mode");
@@ -56,8 +58,11 @@ int main(int argc, char *argv[]) {
         " states.");
     po.Register("perturb-factor", &perturb_factor, "While mixing up, perturb "
         "means by standard deviation times this factor.");
+    po.Register("num-threads", &num_threads, "Number of threads used to "
+                "split and merge the GMMs of the pdfs in parallel.");
 
     po.Read(argc, argv);
+    g_num_threads = num_threads;
 
     if (po.NumArgs() != 3) {
       po.PrintUsage();
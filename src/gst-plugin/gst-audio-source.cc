@@ -25,7 +25,7 @@ namespace kaldi {
 
 
 GstBufferSource::GstBufferSource() :
-  ended_(false) {
+  ended_(false), bytes_available_(0) {
   buf_queue_ = g_async_queue_new();
   current_buffer_ = NULL;
   pos_in_current_buf_ = 0;
@@ -50,18 +50,48 @@ GstBufferSource::~GstBufferSource() {
 void GstBufferSource::PushBuffer(GstBuffer *buf) {
   g_mutex_lock(&lock_);
   gst_buffer_ref(buf);
+  bytes_available_ += gst_buffer_get_size(buf);
   g_async_queue_push(buf_queue_, buf);
   g_cond_signal(&data_cond_);
   g_mutex_unlock(&lock_);
 }
 
+void GstBufferSource::PushSamples(const SampleType *data, int32 num_samples,
+                                  int32 stride) {
+  GstBuffer *buf = gst_buffer_new_allocate(NULL,
+                                           num_samples * sizeof(SampleType),
+                                           NULL);
+  GstMapInfo info;
+  gst_buffer_map(buf, &info, GST_MAP_WRITE);
+  SampleType *out = reinterpret_cast<SampleType*>(info.data);
+  for (int32 i = 0; i < num_samples; i++)
+    out[i] = data[i * stride];
+  gst_buffer_unmap(buf, &info);
+  PushBuffer(buf);
+  gst_buffer_unref(buf);
+}
+
 void GstBufferSource::SetEnded(bool ended) {
-  ended_ = ended;
   g_mutex_lock(&lock_);
+  ended_ = ended;
   g_cond_signal(&data_cond_);
   g_mutex_unlock(&lock_);
 }
 
+bool GstBufferSource::Ended() {
+  g_mutex_lock(&lock_);
+  bool ans = ended_;
+  g_mutex_unlock(&lock_);
+  return ans;
+}
+
+int32 GstBufferSource::NumSamplesAvailable() {
+  g_mutex_lock(&lock_);
+  int32 ans = bytes_available_ / sizeof(SampleType);
+  g_mutex_unlock(&lock_);
+  return ans;
+}
+
 
 bool GstBufferSource::Read(Vector<BaseFloat> *data) {
   uint32 nsamples_req = data->Dim();  // (16bit) samples requested
@@ -93,6 +123,9 @@ bool GstBufferSource::Read(Vector<BaseFloat> *data) {
 
     nbytes_transferred += nbytes_from_current;
     pos_in_current_buf_ += nbytes_from_current;
+    g_mutex_lock(&lock_);
+    bytes_available_ -= nbytes_from_current;
+    g_mutex_unlock(&lock_);
     if (pos_in_current_buf_ == gst_buffer_get_size(current_buffer_)) {
       // we are done with the current buffer
       gst_buffer_unref(current_buffer_);
@@ -39,8 +39,17 @@ class GstBufferSource : public OnlineAudioSourceItf {
 
   void PushBuffer(GstBuffer *buf);
 
+  // Copies "num_samples" samples, "stride" samples apart (e.g. one channel of
+  // interleaved audio) into a new buffer and pushes it.
+  void PushSamples(const SampleType *data, int32 num_samples, int32 stride);
+
   void SetEnded(bool ended);
 
+  bool Ended();
+
+  // The number of samples that have been pushed but not yet read.
+  int32 NumSamplesAvailable();
+
   ~GstBufferSource();
 
  private:
@@ -49,6 +58,7 @@ class GstBufferSource : public OnlineAudioSourceItf {
   gint pos_in_current_buf_;
   GstBuffer *current_buffer_;
   bool ended_;
+  int32 bytes_available_;  // bytes pushed and not yet read; under lock_.
   GMutex lock_;
   GCond data_cond_;
   KALDI_DISALLOW_COPY_AND_ASSIGN(GstBufferSource);
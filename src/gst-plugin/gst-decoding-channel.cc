@@ -0,0 +1,177 @@
+// gst-plugin/gst-decoding-channel.cc
+
+// Copyright 2026  agent
+// (based on gst-plugin/gst-online-gmm-decode-faster.cc; see that file for its authors)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <map>
+
+#include "gst-plugin/gst-decoding-channel.h"
+#include "online/onlinebin-util.h"
+#include "fstext/fstext-utils.h"
+
+namespace kaldi {
+
+// The models that are loaded, indexed by their key; protected by
+// shared_models_lock.
+static std::map<std::string, GstSharedModel*> shared_models;
+static GMutex shared_models_lock;
+
+GstSharedModel *GstSharedModelAcquire(const std::string &model_rspecifier,
+                                      const std::string &fst_rspecifier,
+                                      const std::string &word_syms_filename,
+                                      const std::string &lda_mat_rspecifier) {
+  std::string key = model_rspecifier + "\n" + fst_rspecifier + "\n" +
+      word_syms_filename + "\n" + lda_mat_rspecifier;
+  g_mutex_lock(&shared_models_lock);
+  std::map<std::string, GstSharedModel*>::iterator iter =
+      shared_models.find(key);
+  GstSharedModel *model = NULL;
+  if (iter != shared_models.end()) {
+    model = iter->second;
+  } else {
+    // We keep the lock while loading, so that two elements that start at the
+    // same time don't both load the model.
+    model = new GstSharedModel();
+    model->key = key;
+    try {
+      if (lda_mat_rspecifier != "")
+        ReadKaldiObject(lda_mat_rspecifier, &(model->lda_transform));
+      bool binary;
+      Input ki(model_rspecifier, &binary);
+      model->trans_model.Read(ki.Stream(), binary);
+      model->am_gmm.Read(ki.Stream(), binary);
+      if (!(model->word_syms = fst::SymbolTable::ReadText(word_syms_filename)))
+        KALDI_ERR << "Could not read symbol table from file "
+                  << word_syms_filename;
+      model->decode_fst = ReadDecodeGraph(fst_rspecifier);
+    } catch (const std::exception &e) {
+      KALDI_WARN << "Error loading the model: " << e.what();
+      delete model;
+      g_mutex_unlock(&shared_models_lock);
+      return NULL;
+    }
+    shared_models[key] = model;
+  }
+  model->ref_count++;
+  g_mutex_unlock(&shared_models_lock);
+  return model;
+}
+
+void GstSharedModelRelease(GstSharedModel *model) {
+  g_mutex_lock(&shared_models_lock);
+  KALDI_ASSERT(model->ref_count > 0);
+  if (--model->ref_count == 0) {
+    shared_models.erase(model->key);
+    delete model;
+  }
+  g_mutex_unlock(&shared_models_lock);
+}
+
+
+// We are not properly registering/exposing MFCC and frame extraction options,
+// because there are parts of the online decoding code, where some of these
+// options are hardwired(ToDo: we should fix this at some point)
+static MfccOptions GstMfccOptions() {
+  MfccOptions mfcc_opts;
+  mfcc_opts.use_energy = false;
+  mfcc_opts.frame_opts.frame_length_ms = 25;
+  mfcc_opts.frame_opts.frame_shift_ms = 10;
+  return mfcc_opts;
+}
+
+// we always assume 16 kHz Fs on input.
+static const int32 kGstSampleFreq = 16000;
+
+GstDecodingChannel::GstDecodingChannel(const GstSharedModel &model,
+                                       const GstDecodingChannelOptions &opts):
+    model_(model), mfcc_(GstMfccOptions()),
+    fe_input_(&source_, &mfcc_, 25 * (kGstSampleFreq / 1000),
+              10 * (kGstSampleFreq / 1000)),
+    cmn_input_(&fe_input_, opts.cmn_window, opts.min_cmn_window),
+    feat_transform_(NULL), feature_matrix_(NULL), decodable_(NULL),
+    decoder_(NULL), partial_res_(false), finished_(false) {
+  if (model.lda_transform.NumRows() != 0) {
+    feat_transform_ = new OnlineLdaInput(&cmn_input_, model.lda_transform,
+                                         opts.left_context,
+                                         opts.right_context);
+  } else {
+    DeltaFeaturesOptions delta_opts;
+    delta_opts.order = 2;  // up to delta-delta derivative features.
+    // Note from Dan: keeping the next statement for back-compatibility,
+    // but I don't think this is really the right way to set the window-size
+    // in the delta computation: it should be a separate config.
+    delta_opts.window = opts.left_context / 2;
+    feat_transform_ = new OnlineDeltaInput(delta_opts, &cmn_input_);
+  }
+  // feature_reading_opts contains timeout, batch size.
+  feature_matrix_ = new OnlineFeatureMatrix(*opts.feature_reading_opts,
+                                            feat_transform_);
+  decodable_ = new OnlineDecodableDiagGmmScaled(model.am_gmm,
+                                                model.trans_model,
+                                                opts.acoustic_scale,
+                                                feature_matrix_);
+  decoder_ = new OnlineFasterDecoder(*model.decode_fst, *opts.decoder_opts,
+                                     *opts.silence_phones, model.trans_model);
+}
+
+GstDecodingChannel::~GstDecodingChannel() {
+  delete decoder_;
+  delete decodable_;
+  delete feature_matrix_;
+  delete feat_transform_;
+}
+
+void GstDecodingChannel::DecodeChunk(std::vector<int32> *words,
+                                     bool *end_of_utt) {
+  KALDI_ASSERT(!finished_);
+  *end_of_utt = false;
+  try {
+    DecodeChunkInternal(words, end_of_utt);
+  } catch (const std::exception &e) {
+    KALDI_WARN << "Error decoding, giving up on this channel: " << e.what();
+    finished_ = true;
+  }
+}
+
+void GstDecodingChannel::DecodeChunkInternal(std::vector<int32> *words,
+                                             bool *end_of_utt) {
+  std::vector<int32> word_ids;
+  OnlineFasterDecoder::DecodeState dstate = decoder_->Decode(decodable_);
+  if (dstate & (OnlineFasterDecoder::kEndFeats |
+                OnlineFasterDecoder::kEndUtt)) {
+    decoder_->FinishTraceBack(&out_fst_);
+    fst::GetLinearSymbolSequence(out_fst_,
+                                 static_cast<std::vector<int32> *>(0),
+                                 &word_ids,
+                                 static_cast<LatticeArc::Weight*>(0));
+    *end_of_utt = partial_res_ || !word_ids.empty();
+    partial_res_ = false;
+    if (dstate == OnlineFasterDecoder::kEndFeats)
+      finished_ = true;
+  } else if (decoder_->PartialTraceback(&out_fst_)) {
+    fst::GetLinearSymbolSequence(out_fst_,
+                                 static_cast<std::vector<int32> *>(0),
+                                 &word_ids,
+                                 static_cast<LatticeArc::Weight*>(0));
+    if (!word_ids.empty())
+      partial_res_ = true;
+  }
+  words->insert(words->end(), word_ids.begin(), word_ids.end());
+}
+
+}  // namespace kaldi
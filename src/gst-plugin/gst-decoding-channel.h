@@ -0,0 +1,130 @@
+// gst-plugin/gst-decoding-channel.h
+
+// Copyright 2026  agent
+// (based on gst-plugin/gst-online-gmm-decode-faster.cc; see that file for its authors)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_GST_PLUGIN_GST_DECODING_CHANNEL_H_
+#define KALDI_GST_PLUGIN_GST_DECODING_CHANNEL_H_
+
+#include <string>
+#include <vector>
+#include <gst/gst.h>
+
+#include "feat/feature-mfcc.h"
+#include "online/online-feat-input.h"
+#include "online/online-decodable.h"
+#include "online/online-faster-decoder.h"
+#include "gst-plugin/gst-audio-source.h"
+
+namespace kaldi {
+
+// The models that the decoders use.  They are read-only after loading, so the
+// element instances of a process that use the same files share one copy; see
+// GstSharedModelAcquire().
+struct GstSharedModel {
+  std::string key;  // the file names, which identify the model.
+  int32 ref_count;
+  TransitionModel trans_model;
+  AmDiagGmm am_gmm;
+  fst::Fst<fst::StdArc> *decode_fst;
+  fst::SymbolTable *word_syms;
+  Matrix<BaseFloat> lda_transform;  // Empty if we use deltas.
+
+  GstSharedModel(): ref_count(0), decode_fst(NULL), word_syms(NULL) { }
+  ~GstSharedModel() {
+    delete decode_fst;
+    delete word_syms;
+  }
+};
+
+// Returns the model read from these files, loading it if no other element of
+// the process has it; returns NULL (after logging) on error.  Thread-safe.
+GstSharedModel *GstSharedModelAcquire(const std::string &model_rspecifier,
+                                      const std::string &fst_rspecifier,
+                                      const std::string &word_syms_filename,
+                                      const std::string &lda_mat_rspecifier);
+
+// Releases a model returned by GstSharedModelAcquire(); the last release
+// deletes it.
+void GstSharedModelRelease(GstSharedModel *model);
+
+// The per-stream options of the decoding channels, set from the element's
+// properties.
+struct GstDecodingChannelOptions {
+  const OnlineFasterDecoderOpts *decoder_opts;
+  const OnlineFeatureMatrixOptions *feature_reading_opts;
+  const std::vector<int32> *silence_phones;
+  BaseFloat acoustic_scale;
+  int32 cmn_window;
+  int32 min_cmn_window;
+  int32 left_context;
+  int32 right_context;
+};
+
+// One audio channel of the element: its audio queue, feature pipeline and
+// decoder.  The streaming thread adds audio with Source().PushSamples(); the
+// decoding is done in chunks, by the threads of a GThreadPool (see
+// gst-online-gmm-decode-faster.cc), and DecodeChunk() is called by at most
+// one thread at a time.
+class GstDecodingChannel {
+ public:
+  GstDecodingChannel(const GstSharedModel &model,
+                     const GstDecodingChannelOptions &opts);
+  ~GstDecodingChannel();
+
+  GstBufferSource &Source() { return source_; }
+
+  // Returns true if DecodeChunk() can be called without (much) waiting for
+  // audio: if we have "min_samples" samples or the input has ended.
+  bool ReadyToDecode(int32 min_samples) {
+    return !finished_ && (source_.NumSamplesAvailable() >= min_samples ||
+                          source_.Ended());
+  }
+
+  // Decodes one batch of frames.  It appends the words that became final to
+  // "words"; "end_of_utt" is set to true if an utterance ended and there
+  // were words in it.  If there is an error, it logs it and the channel is
+  // finished.
+  void DecodeChunk(std::vector<int32> *words, bool *end_of_utt);
+
+  // Returns true once all the input has been decoded.
+  bool Finished() const { return finished_; }
+
+ private:
+  typedef OnlineFeInput<Mfcc> FeInput;
+
+  void DecodeChunkInternal(std::vector<int32> *words, bool *end_of_utt);
+
+  const GstSharedModel &model_;
+  GstBufferSource source_;
+  Mfcc mfcc_;
+  FeInput fe_input_;
+  OnlineCmnInput cmn_input_;
+  OnlineFeatInputItf *feat_transform_;
+  OnlineFeatureMatrix *feature_matrix_;
+  OnlineDecodableDiagGmmScaled *decodable_;
+  OnlineFasterDecoder *decoder_;
+  fst::VectorFst<LatticeArc> out_fst_;
+  bool partial_res_;  // true if words have been output in this utterance.
+  bool finished_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(GstDecodingChannel);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_GST_PLUGIN_GST_DECODING_CHANNEL_H_
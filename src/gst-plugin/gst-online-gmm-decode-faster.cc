@@ -34,6 +34,11 @@
  *                              lda-mat=$trans_matrix \
  *     ! filesink location=$resultfile
  * ]|
+ * Multi-channel (interleaved) input is decoded with one decoder per channel;
+ * the words are then output as "channel:word", and with the hyp-word-channel
+ * signal.  The elements of a process share the models they have in common,
+ * and the decoding is done by a pool of num-threads threads shared by
+ * all the elements.
  * </refsect2>
  */
 
@@ -66,6 +71,7 @@ GST_DEBUG_CATEGORY_STATIC(gst_online_gmm_decode_faster_debug);
 
 enum {
   HYP_WORD_SIGNAL,
+  HYP_WORD_CHANNEL_SIGNAL,
   LAST_SIGNAL
 };
 
@@ -87,6 +93,8 @@ enum {
 #define DEFAULT_ACOUSTIC_SCALE  1.0/13
 #define DEFAULT_LEFT_CONTEXT    4
 #define DEFAULT_RIGHT_CONTEXT   4
+#define DEFAULT_CHUNK_LENGTH    0.3
+#define DEFAULT_NUM_THREADS     4
 
 
 /* the capabilities of the inputs and outputs.
@@ -100,7 +108,7 @@ static GstStaticPadTemplate sink_factory =
                             GST_STATIC_CAPS(
                                 "audio/x-raw, "
                                 "format = (string) S16LE, "
-                                "channels = (int) 1, "
+                                "channels = (int) [ 1, 64 ], "
                                 "rate = (int) 16000 "));
 
 
@@ -138,7 +146,11 @@ static GstFlowReturn gst_online_gmm_decode_faster_chain(GstPad * pad,
                                                         GstBuffer * buf);
 
 static void
-gst_online_gmm_decode_faster_loop(GstOnlineGmmDecodeFaster * filter);
+gst_online_gmm_decode_faster_decode_task(gpointer data, gpointer user_data);
+
+// The pool that decodes the channels of all the elements.
+static GThreadPool *decode_pool = NULL;
+static GMutex decode_pool_lock;
 
 
 /* GObject vmethod implementations */
@@ -216,6 +228,13 @@ static void gst_online_gmm_decode_faster_class_init(GstOnlineGmmDecodeFasterClas
                      G_STRUCT_OFFSET(GstOnlineGmmDecodeFasterClass, hyp_word),
                      NULL, NULL, kaldi_marshal_VOID__STRING, G_TYPE_NONE, 1,
                      G_TYPE_STRING);
+  gst_online_gmm_decode_faster_signals[HYP_WORD_CHANNEL_SIGNAL]
+      = g_signal_new("hyp-word-channel", G_TYPE_FROM_CLASS(klass),
+                     G_SIGNAL_RUN_LAST,
+                     G_STRUCT_OFFSET(GstOnlineGmmDecodeFasterClass,
+                                     hyp_word_channel),
+                     NULL, NULL, kaldi_marshal_VOID__INT_STRING, G_TYPE_NONE, 2,
+                     G_TYPE_INT, G_TYPE_STRING);
 }
 
 
@@ -239,6 +258,14 @@ gst_online_gmm_decode_faster_init(GstOnlineGmmDecodeFaster * filter) {
   filter->word_syms_filename_ = g_strdup(DEFAULT_WORD_SYMS);
   filter->lda_mat_rspecifier_ = g_strdup("");
   filter->silence_phones_ = new std::vector<int32>;
+  filter->model_ = NULL;
+  filter->channels_ = new std::vector<GstDecodingChannel*>;
+  filter->busy_ = new std::vector<bool>;
+  filter->num_busy_ = 0;
+  filter->num_channels_ = 1;
+  g_mutex_init(&filter->lock_);
+  g_cond_init(&filter->idle_cond_);
+  g_mutex_init(&filter->push_lock_);
   SplitStringToIntegers(DEFAULT_SILENCE_PHONES, ":", false, filter->silence_phones_);
 
   filter->simple_options_ = new SimpleOptions();
@@ -253,6 +280,8 @@ gst_online_gmm_decode_faster_init(GstOnlineGmmDecodeFaster * filter) {
   filter->min_cmn_window_ = 100;  // adds 1 second latency, only at utterance start.
   filter->right_context_ = DEFAULT_RIGHT_CONTEXT;
   filter->left_context_ = DEFAULT_LEFT_CONTEXT;
+  filter->chunk_length_ = DEFAULT_CHUNK_LENGTH;
+  filter->num_threads_ = DEFAULT_NUM_THREADS;
 
   filter->simple_options_->Register("left-context", &filter->left_context_,
                                     "Number of frames of left context");
@@ -266,6 +295,13 @@ gst_online_gmm_decode_faster_init(GstOnlineGmmDecodeFaster * filter) {
   filter->simple_options_->Register("min-cmn-window", &filter->min_cmn_window_,
                                     "Minumum CMN window used at start of decoding (adds "
                                       "latency only at start)");
+  filter->simple_options_->Register("chunk-length", &filter->chunk_length_,
+                                    "Seconds of new audio a channel must have "
+                                    "before it is decoded");
+  filter->simple_options_->Register("num-threads", &filter->num_threads_,
+                                    "Number of decoding threads, shared by all "
+                                    "the elements of the process (the largest "
+                                    "value is used)");
 
 
   filter->sinkpad_ = gst_pad_new_from_static_template(&sink_factory, "sink");
@@ -381,51 +417,108 @@ gst_online_gmm_decode_faster_init(GstOnlineGmmDecodeFaster * filter) {
 
 static bool
 gst_online_gmm_decode_faster_allocate(GstOnlineGmmDecodeFaster * filter) {
-  if (!filter->decoder_) {
+  if (!filter->model_) {
     GST_INFO_OBJECT(filter,  "Loading Kaldi decoder");
-    filter->lda_transform_ = new Matrix<BaseFloat>;
-    if (strlen(filter->lda_mat_rspecifier_) > 0) {
-      bool binary_in;
-      Input ki(filter->lda_mat_rspecifier_, &binary_in);
-      filter->lda_transform_->Read(ki.Stream(), binary_in);
-    }
-    filter->trans_model_ = new TransitionModel();
-    filter->am_gmm_ = new AmDiagGmm();
-    {
-      bool binary;
-      Input ki(filter->model_rspecifier_, &binary);
-      filter->trans_model_->Read(ki.Stream(), binary);
-      filter->am_gmm_->Read(ki.Stream(), binary);
-    }
-    filter->word_syms_ = NULL;
-    if (!(filter->word_syms_ = fst::SymbolTable::ReadText(filter->word_syms_filename_))) {
-      GST_ERROR_OBJECT(filter, "Could not read symbol table from file %s", filter->word_syms_filename_);
+    filter->model_ = GstSharedModelAcquire(filter->model_rspecifier_,
+                                           filter->fst_rspecifier_,
+                                           filter->word_syms_filename_,
+                                           filter->lda_mat_rspecifier_);
+    if (!filter->model_) {
+      GST_ERROR_OBJECT(filter, "Could not load the model from %s, %s, %s",
+                       filter->model_rspecifier_, filter->fst_rspecifier_,
+                       filter->word_syms_filename_);
       return false;
     }
 
-    filter->decode_fst_ = ReadDecodeGraph(filter->fst_rspecifier_);
-
     int32 window_size = filter->right_context_ + filter->left_context_ + 1;
     filter->decoder_opts_->batch_size = std::max(filter->decoder_opts_->batch_size, window_size);
 
-    filter->out_fst_ = new fst::VectorFst<LatticeArc> ();
-
-    filter->au_src_ = new GstBufferSource();
-
-    filter->decoder_ = new OnlineFasterDecoder(*(filter->decode_fst_),
-                                               *(filter->decoder_opts_),
-                                               *(filter->silence_phones_),
-                                               *(filter->trans_model_));
+    g_mutex_lock(&decode_pool_lock);
+    if (decode_pool == NULL) {
+      decode_pool = g_thread_pool_new(gst_online_gmm_decode_faster_decode_task,
+                                      NULL, std::max(filter->num_threads_, 1),
+                                      FALSE, NULL);
+    } else if (g_thread_pool_get_max_threads(decode_pool) < filter->num_threads_) {
+      g_thread_pool_set_max_threads(decode_pool, filter->num_threads_, NULL);
+    }
+    g_mutex_unlock(&decode_pool_lock);
 
     GST_INFO_OBJECT(filter,  "Finished loading Kaldi decoder");
   }
   return true;
 }
 
+// Creates the decoders of the channels, if they don't exist; called with
+// filter->lock_ held.
+static void
+gst_online_gmm_decode_faster_create_channels(GstOnlineGmmDecodeFaster * filter) {
+  if (!filter->channels_->empty())
+    return;
+  KALDI_ASSERT(filter->num_busy_ == 0);
+  GstDecodingChannelOptions opts;
+  opts.decoder_opts = filter->decoder_opts_;
+  opts.feature_reading_opts = filter->feature_reading_opts_;
+  opts.silence_phones = filter->silence_phones_;
+  opts.acoustic_scale = filter->acoustic_scale_;
+  opts.cmn_window = filter->cmn_window_;
+  opts.min_cmn_window = filter->min_cmn_window_;
+  opts.left_context = filter->left_context_;
+  opts.right_context = filter->right_context_;
+  for (int32 c = 0; c < filter->num_channels_; c++)
+    filter->channels_->push_back(new GstDecodingChannel(*(filter->model_),
+                                                        opts));
+  filter->busy_->assign(filter->num_channels_, false);
+}
+
+// Deletes the decoders of the channels; called with filter->lock_ held, when
+// no channel is busy.
+static void
+gst_online_gmm_decode_faster_delete_channels(GstOnlineGmmDecodeFaster * filter) {
+  KALDI_ASSERT(filter->num_busy_ == 0);
+  for (size_t c = 0; c < filter->channels_->size(); c++)
+    delete (*filter->channels_)[c];
+  filter->channels_->clear();
+  filter->busy_->clear();
+}
+
+// The work items of the decoding pool.
+struct GstDecodeTask {
+  GstOnlineGmmDecodeFaster *filter;
+  int32 channel;
+};
+
+// Gives channel c to the decoding pool if it has enough audio and is not
+// already queued or being decoded; called with filter->lock_ held.
+static void
+gst_online_gmm_decode_faster_maybe_queue(GstOnlineGmmDecodeFaster * filter,
+                                         int32 c) {
+  int32 chunk_samples = static_cast<int32>(filter->chunk_length_ * kSampleFreq);
+  if ((*filter->busy_)[c] || !(*filter->channels_)[c]->ReadyToDecode(chunk_samples))
+    return;
+  (*filter->busy_)[c] = true;
+  filter->num_busy_++;
+  GstDecodeTask *task = new GstDecodeTask;
+  task->filter = filter;
+  task->channel = c;
+  g_thread_pool_push(decode_pool, task, NULL);
+}
+
 static void
 gst_online_gmm_decode_faster_finalize(GObject * object) {
   GstOnlineGmmDecodeFaster *filter = GST_ONLINEGMMDECODEFASTER(object);
 
+  // Wait for the decoding pool to finish with our channels.
+  g_mutex_lock(&filter->lock_);
+  while (filter->num_busy_ > 0)
+    g_cond_wait(&filter->idle_cond_, &filter->lock_);
+  gst_online_gmm_decode_faster_delete_channels(filter);
+  g_mutex_unlock(&filter->lock_);
+  delete filter->channels_;
+  delete filter->busy_;
+  g_mutex_clear(&filter->lock_);
+  g_cond_clear(&filter->idle_cond_);
+  g_mutex_clear(&filter->push_lock_);
+
   g_free(filter->model_rspecifier_);
   g_free(filter->fst_rspecifier_);
   g_free(filter->word_syms_filename_);
@@ -433,33 +526,9 @@ gst_online_gmm_decode_faster_finalize(GObject * object) {
   delete filter->silence_phones_;
   delete filter->decoder_opts_;
   delete filter->feature_reading_opts_;
-  if (filter->decoder_) {
-    delete filter->decoder_;
-    filter->decoder_ = NULL;
-  }
-  if (filter->lda_transform_) {
-    delete filter->lda_transform_;
-    filter->lda_transform_ = NULL;
-  }
-  if (filter->am_gmm_) {
-    delete filter->am_gmm_;
-    filter->am_gmm_ = NULL;
-  }
-  if (filter->word_syms_) {
-    delete filter->word_syms_;
-    filter->word_syms_ = NULL;
-  }
-  if (filter->decode_fst_) {
-    delete filter->decode_fst_;
-    filter->decode_fst_ = NULL;
-  }
-  if (filter->out_fst_) {
-    delete filter->out_fst_;
-    filter->out_fst_ = NULL;
-  }
-  if (filter->au_src_) {
-    delete filter->au_src_;
-    filter->au_src_ = NULL;
+  if (filter->model_) {
+    GstSharedModelRelease(filter->model_);
+    filter->model_ = NULL;
   }
   if (filter->simple_options_) {
     delete filter->simple_options_;
@@ -487,7 +556,7 @@ gst_online_gmm_decode_faster_set_property(GObject * object, guint prop_id,
     return;
   }
   // All other props cannot be changed after initialization
-  if (filter->decoder_) {
+  if (filter->model_) {
     GST_WARNING_OBJECT(filter,  "Decoder already initialized, cannot change it's properties");
     return;
   }
@@ -654,11 +723,20 @@ gst_online_gmm_decode_faster_change_state(GstElement *element, GstStateChange tr
 /*
  * Emit a single recognized word:
  *   * emit through the sink pad of the element
- *   * emit by the hy-word signal
+ *   * emit by the hyp-word and hyp-word-channel signals
+ * With more than one channel, the word is prefixed with the channel on the
+ * pad and in hyp-word.
  */
 static void
-gst_online_gmm_decode_faster_push_word(GstOnlineGmmDecodeFaster * filter, GstPad *pad, std::string word) {
-  const gchar *hyp = word.c_str();
+gst_online_gmm_decode_faster_push_word(GstOnlineGmmDecodeFaster * filter, GstPad *pad,
+                                       int32 channel, std::string word) {
+  std::string tagged_word = word;
+  if (filter->num_channels_ > 1) {
+    std::ostringstream ss;
+    ss << channel << ":" << word;
+    tagged_word = ss.str();
+  }
+  const gchar *hyp = tagged_word.c_str();
   guint hyp_len = strlen(hyp);
   GST_DEBUG_OBJECT(filter,  "WORD: %s", hyp);
   /* +1 for terminating NUL character */
@@ -671,11 +749,14 @@ gst_online_gmm_decode_faster_push_word(GstOnlineGmmDecodeFaster * filter, GstPad
   gst_pad_push(pad, buffer);
   /* Emit a signal for applications. */
   g_signal_emit(filter, gst_online_gmm_decode_faster_signals[HYP_WORD_SIGNAL], 0, hyp);
+  g_signal_emit(filter, gst_online_gmm_decode_faster_signals[HYP_WORD_CHANNEL_SIGNAL], 0,
+                channel, word.c_str());
 }
 
 
 static void
 gst_online_gmm_decode_faster_push_words(GstOnlineGmmDecodeFaster * filter, GstPad *pad,
+                                        int32 channel,
                                         const std::vector<int32>& words,
                                         const fst::SymbolTable *word_syms,
                                         bool line_break) {
@@ -686,95 +767,57 @@ gst_online_gmm_decode_faster_push_words(GstOnlineGmmDecodeFaster * filter, GstPa
     if (word == "") {
       GST_ERROR_OBJECT(filter, "Word-id %d  not in symbol table!",  words[i]);
     }
-    gst_online_gmm_decode_faster_push_word(filter, pad, word);
+    gst_online_gmm_decode_faster_push_word(filter, pad, channel, word);
   }
 
   if (line_break) {
-    gst_online_gmm_decode_faster_push_word(filter, pad, "<#s>");
+    gst_online_gmm_decode_faster_push_word(filter, pad, channel, "<#s>");
   }
 }
 
+// Run by the threads of decode_pool: decodes a chunk of one channel and
+// pushes the words.  After the last channel of the stream has finished it
+// pushes EOS.
 static void
-gst_online_gmm_decode_faster_loop(GstOnlineGmmDecodeFaster * filter) {
-  // We are not properly registering/exposing MFCC and frame extraction options,
-  // because there are parts of the online decoding code, where some of these
-  // options are hardwired(ToDo: we should fix this at some point)
-  MfccOptions mfcc_opts;
-  mfcc_opts.use_energy = false;
-  int32 frame_length = mfcc_opts.frame_opts.frame_length_ms = 25;
-  int32 frame_shift = mfcc_opts.frame_opts.frame_shift_ms = 10;
-
-  // Up to delta-delta derivative features are calculated (unless LDA is used)
-  const int32 kDeltaOrder = 2;
-  Mfcc mfcc(mfcc_opts);
-  FeInput fe_input(filter->au_src_, &mfcc,
-                   frame_length * (kSampleFreq / 1000),
-                   frame_shift * (kSampleFreq / 1000));
-  OnlineCmnInput cmn_input(&fe_input, filter->cmn_window_, filter->min_cmn_window_);
-
-  OnlineFeatInputItf *feat_transform = 0;
-  if (strlen(filter->lda_mat_rspecifier_) > 0) {
-    feat_transform = new OnlineLdaInput(&cmn_input, *(filter->lda_transform_),
-                                        filter->left_context_,
-                                        filter->right_context_);
-  } else {
-    DeltaFeaturesOptions opts;
-    opts.order = kDeltaOrder;
-    // Note from Dan: keeping the next statement for back-compatibility,
-    // but I don't think this is really the right way to set the window-size
-    // in the delta computation: it should be a separate config.
-    opts.window = filter->left_context_ / 2;
-    feat_transform = new OnlineDeltaInput(opts, &cmn_input);
+gst_online_gmm_decode_faster_decode_task(gpointer data, gpointer user_data) {
+  GstDecodeTask *task = reinterpret_cast<GstDecodeTask*>(data);
+  GstOnlineGmmDecodeFaster *filter = task->filter;
+  int32 c = task->channel;
+  delete task;
+
+  g_mutex_lock(&filter->lock_);
+  GstDecodingChannel *channel = (*filter->channels_)[c];
+  g_mutex_unlock(&filter->lock_);
+
+  // Nobody else touches the channel while it is busy.
+  std::vector<int32> word_ids;
+  bool end_of_utt = false;
+  channel->DecodeChunk(&word_ids, &end_of_utt);
+  g_mutex_lock(&filter->push_lock_);
+  gst_online_gmm_decode_faster_push_words(filter, filter->srcpad_, c, word_ids,
+                                          filter->model_->word_syms, end_of_utt);
+  g_mutex_unlock(&filter->push_lock_);
+
+  g_mutex_lock(&filter->lock_);
+  (*filter->busy_)[c] = false;
+  filter->num_busy_--;
+  bool all_finished = true;
+  for (size_t i = 0; i < filter->channels_->size(); i++)
+    if (!(*filter->channels_)[i]->Finished())
+      all_finished = false;
+  if (!channel->Finished())
+    gst_online_gmm_decode_faster_maybe_queue(filter, c);
+  if (all_finished && filter->num_busy_ == 0) {
+    GST_DEBUG_OBJECT(filter, "Finished decoding the stream");
+    gst_online_gmm_decode_faster_delete_channels(filter);
+    GST_DEBUG_OBJECT(filter, "Pushing EOS event");
+    g_mutex_lock(&filter->push_lock_);
+    gst_pad_push_event(filter->srcpad_, gst_event_new_eos());
+    g_mutex_unlock(&filter->push_lock_);
   }
-
-
-  // feature_reading_opts contains timeout, batch size.
-  OnlineFeatureMatrix feature_matrix(*(filter->feature_reading_opts_),
-                                     feat_transform);
-
-
-  OnlineDecodableDiagGmmScaled decodable(*(filter->am_gmm_), *(filter->trans_model_),
-                                         filter->acoustic_scale_, &feature_matrix);
-
-  GST_DEBUG_OBJECT(filter,  "starting decoding loop");
-
-  bool partial_res = false;
-  while (1) {
-    OnlineFasterDecoder::DecodeState dstate = filter->decoder_->Decode(&decodable);
-
-    if (dstate & (filter->decoder_->kEndFeats | filter->decoder_->kEndUtt)) {
-      std::vector<int32> word_ids;
-      filter->decoder_->FinishTraceBack(filter->out_fst_);
-      fst::GetLinearSymbolSequence(*(filter->out_fst_),
-                                   static_cast<vector<int32> *>(0),
-                                   &word_ids,
-                                   static_cast<LatticeArc::Weight*>(0));
-      gst_online_gmm_decode_faster_push_words(filter, filter->srcpad_, word_ids, filter->word_syms_, partial_res || word_ids.size());
-      partial_res = false;
-      if (dstate == filter->decoder_->kEndFeats)
-        break;
-    } else {
-      std::vector<int32> word_ids;
-      if (filter->decoder_->PartialTraceback(filter->out_fst_)) {
-        fst::GetLinearSymbolSequence(*(filter->out_fst_),
-                                     static_cast<vector<int32> *>(0),
-                                     &word_ids,
-                                     static_cast<LatticeArc::Weight*>(0));
-        gst_online_gmm_decode_faster_push_words(filter, filter->srcpad_, word_ids, filter->word_syms_, false);
-        if (!partial_res)
-          partial_res = (word_ids.size() > 0);
-      }
-    }
-  }
-  GST_DEBUG_OBJECT(filter, "Finished decoding loop");
-  GST_DEBUG_OBJECT(filter, "Pushing EOS event");
-  gst_pad_push_event(filter->srcpad_, gst_event_new_eos());
-
-  GST_DEBUG_OBJECT(filter, "Pausing decoding task");
-  gst_pad_pause_task(filter->srcpad_);
-  delete feat_transform;
-  delete filter->au_src_;
-  filter->au_src_ = new GstBufferSource();
+  if (filter->num_busy_ == 0)
+    g_cond_broadcast(&filter->idle_cond_);
+  g_mutex_unlock(&filter->lock_);
 }
 
 /* GstElement vmethod implementations */
@@ -790,16 +833,29 @@ gst_online_gmm_decode_faster_sink_event(GstPad * pad, GstObject * parent, GstEve
   switch (GST_EVENT_TYPE(event)) {
     case GST_EVENT_SEGMENT:
     {
-      GST_DEBUG_OBJECT(filter,  "Starting decoding task");
-      gst_pad_start_task(filter->srcpad_,
-                         (GstTaskFunction) gst_online_gmm_decode_faster_loop, filter, NULL);
-
-      GST_DEBUG_OBJECT(filter,  "Started decoding task");
+      GST_DEBUG_OBJECT(filter,  "Creating the channel decoders");
+      g_mutex_lock(&filter->lock_);
+      gst_online_gmm_decode_faster_create_channels(filter);
+      g_mutex_unlock(&filter->lock_);
+      gst_event_unref(event);
       ret = TRUE;
       break;
     }
     case GST_EVENT_CAPS:
     {
+      GstCaps *caps;
+      gst_event_parse_caps(event, &caps);
+      gint channels = 1;
+      gst_structure_get_int(gst_caps_get_structure(caps, 0), "channels",
+                            &channels);
+      g_mutex_lock(&filter->lock_);
+      if (filter->channels_->empty())
+        filter->num_channels_ = channels;
+      else if (channels != filter->num_channels_)
+        GST_WARNING_OBJECT(filter, "Cannot change the number of channels "
+                           "in the middle of a stream");
+      g_mutex_unlock(&filter->lock_);
+      gst_event_unref(event);
       ret = TRUE;
       break;
     }
@@ -807,7 +863,18 @@ gst_online_gmm_decode_faster_sink_event(GstPad * pad, GstObject * parent, GstEve
     {
       /* end-of-stream, we should close down all stream leftovers here */
       GST_DEBUG_OBJECT(filter, "EOS received");
-      filter->au_src_->SetEnded(true);
+      g_mutex_lock(&filter->lock_);
+      if (filter->channels_->empty()) {  // No audio; nothing to decode.
+        g_mutex_lock(&filter->push_lock_);
+        gst_pad_push_event(filter->srcpad_, gst_event_new_eos());
+        g_mutex_unlock(&filter->push_lock_);
+      }
+      for (size_t c = 0; c < filter->channels_->size(); c++) {
+        (*filter->channels_)[c]->Source().SetEnded(true);
+        gst_online_gmm_decode_faster_maybe_queue(filter, c);
+      }
+      g_mutex_unlock(&filter->lock_);
+      gst_event_unref(event);
       ret = TRUE;
       break;
     }
@@ -819,7 +886,8 @@ gst_online_gmm_decode_faster_sink_event(GstPad * pad, GstObject * parent, GstEve
 }
 
 /* chain function
- * this function does the actual processing
+ * this function only queues the audio of each channel; the decoding is done
+ * by the threads of decode_pool.
  */
 static GstFlowReturn gst_online_gmm_decode_faster_chain(GstPad * pad,
                                                         GstObject * parent,
@@ -828,10 +896,29 @@ static GstFlowReturn gst_online_gmm_decode_faster_chain(GstPad * pad,
 
   filter = GST_ONLINEGMMDECODEFASTER(parent);
 
-  if (G_UNLIKELY(!filter->decoder_))
+  if (G_UNLIKELY(!filter->model_))
     goto not_negotiated;
   if (!filter->silent_) {
-    filter->au_src_->PushBuffer(buf);
+    g_mutex_lock(&filter->lock_);
+    gst_online_gmm_decode_faster_create_channels(filter);
+    int32 num_channels = filter->channels_->size();
+    GstMapInfo info;
+    gst_buffer_map(buf, &info, GST_MAP_READ);
+    const GstBufferSource::SampleType *samples =
+        reinterpret_cast<const GstBufferSource::SampleType*>(info.data);
+    int32 num_samples = info.size /
+        (num_channels * sizeof(GstBufferSource::SampleType));
+    if (num_channels == 1) {
+      (*filter->channels_)[0]->Source().PushBuffer(buf);
+    } else {
+      for (int32 c = 0; c < num_channels; c++)
+        (*filter->channels_)[c]->Source().PushSamples(samples + c, num_samples,
+                                                      num_channels);
+    }
+    gst_buffer_unmap(buf, &info);
+    for (int32 c = 0; c < num_channels; c++)
+      gst_online_gmm_decode_faster_maybe_queue(filter, c);
+    g_mutex_unlock(&filter->lock_);
   }
   gst_buffer_unref(buf);
   return GST_FLOW_OK;
@@ -31,6 +31,7 @@
 #include "online/onlinebin-util.h"
 #include "util/simple-options.h"
 #include "gst-plugin/gst-audio-source.h"
+#include "gst-plugin/gst-decoding-channel.h"
 
 namespace kaldi {
 
@@ -63,14 +64,18 @@ struct _GstOnlineGmmDecodeFaster {
 
   bool silent_;
 
-  OnlineFasterDecoder *decoder_;
-  Matrix<BaseFloat> *lda_transform_;
-  TransitionModel *trans_model_;
-  AmDiagGmm *am_gmm_;
-  fst::Fst<fst::StdArc> *decode_fst_;
-  fst::SymbolTable *word_syms_;
-  fst::VectorFst<LatticeArc> *out_fst_;
-  GstBufferSource *au_src_;
+  // Shared with the other elements of the process that use the same files.
+  GstSharedModel *model_;
+  // One per input channel; the channels are decoded in chunks by the threads
+  // of a pool shared by all the elements, so that the streaming thread only
+  // queues audio and never waits for the decoder.
+  std::vector<GstDecodingChannel*> *channels_;
+  std::vector<bool> *busy_;  // the channels that are queued or being decoded.
+  int32 num_busy_;
+  int32 num_channels_;  // from the caps.
+  GMutex lock_;  // protects channels_, busy_ and num_busy_.
+  GCond idle_cond_;  // signaled when num_busy_ becomes zero.
+  GMutex push_lock_;  // held while pushing words; the channels share the pad.
 
   gchar* model_rspecifier_;
   gchar* fst_rspecifier_;
@@ -83,6 +88,8 @@ struct _GstOnlineGmmDecodeFaster {
   int32 cmn_window_;
   int32 min_cmn_window_;
   int32 right_context_, left_context_;
+  BaseFloat chunk_length_;  // seconds of new audio that trigger decoding.
+  int32 num_threads_;  // size of the decoding thread pool.
 
   OnlineFasterDecoderOpts *decoder_opts_;
   OnlineFeatureMatrixOptions *feature_reading_opts_;
@@ -93,6 +100,8 @@ struct _GstOnlineGmmDecodeFaster {
 struct _GstOnlineGmmDecodeFasterClass {
   GstElementClass parent_class;
   void (*hyp_word)(GstElement *element, const gchar *hyp_str);
+  void (*hyp_word_channel)(GstElement *element, gint channel,
+                           const gchar *hyp_str);
 };
 
 GType gst_online_gmm_decode_faster_get_type(void);
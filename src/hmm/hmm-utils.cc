@@ -253,11 +253,14 @@ fst::VectorFst<fst::StdArc> *GetHTransducer (const std::vector<std::vector<int32
                                              const ContextDependencyInterface &ctx_dep,
                                              const TransitionModel &trans_model,
                                              const HTransducerConfig &config,
-                                             std::vector<int32> *disambig_syms_left) {
+                                             std::vector<int32> *disambig_syms_left,
+                                             HmmCacheType *cache) {
   KALDI_ASSERT(ilabel_info.size() >= 1 && ilabel_info[0].size() == 0);  // make sure that eps == eps.
-  HmmCacheType cache;
+  HmmCacheType local_cache;
   // "cache" is an optimization that prevents GetHmmAsFst repeating work
   // unnecessarily.
+  bool own_cache = (cache == NULL);
+  if (own_cache) cache = &local_cache;
   using namespace fst;
   typedef StdArc Arc;
   typedef Arc::Weight Weight;
@@ -299,12 +302,19 @@ fst::VectorFst<fst::StdArc> *GetHTransducer (const std::vector<std::vector<int32
                                         ctx_dep,
                                         trans_model,
                                         config,
-                                        &cache);
+                                        cache);
       fsts[j] = fst;
     }
   }
 
   VectorFst<Arc> *ans = MakeLoopFst(fsts);
+  if (!own_cache) {
+    // The HMMs belong to the caller's cache; only delete the FSTs for the
+    // disambiguation symbols.
+    for (int32 j = 1; j < static_cast<int32>(ilabel_info.size()); j++)
+      if (!(ilabel_info[j].size() == 1 && ilabel_info[j][0] <= 0))
+        fsts[j] = NULL;
+  }
   SortAndUniq(&fsts); // remove duplicate pointers, which we will have
   // in general, since we used the cache.
   DeletePointers(&fsts);
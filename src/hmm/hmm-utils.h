@@ -139,13 +139,17 @@ GetHmmAsFstSimple(std::vector<int32> context_window,
   * "disambig_syms_left" will be set to a list of the disambiguation symbols on
   * the input of the transducer (i.e. same symbol type as whatever is on the
   * input of the transducer
+  * If "cache" is non-NULL, the HMMs are looked up in and added to it, so that
+  * a caller who builds H repeatedly for growing ilabel_info vectors does not
+  * recompute them; the FSTs in it are then owned by the caller.
   */
 fst::VectorFst<fst::StdArc>*
 GetHTransducer (const std::vector<std::vector<int32> > &ilabel_info,
                 const ContextDependencyInterface &ctx_dep,
                 const TransitionModel &trans_model,
                 const HTransducerConfig &config,
-                std::vector<int32> *disambig_syms_left);
+                std::vector<int32> *disambig_syms_left,
+                HmmCacheType *cache = NULL);
 
 /**
   * GetIlabelMapping produces a mapping that's similar to HTK's logical-to-physical
@@ -0,0 +1,157 @@
+// hmm/posterior-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "hmm/posterior.h"
+
+namespace kaldi {
+
+// Returns a monophone model for phones 1 to 5, with 3-state HMMs.
+TransitionModel *GenTestTransitionModel() {
+  std::string topo_str = "<Topology>\n"
+      "<TopologyEntry>\n"
+      "<ForPhones> 1 2 3 4 5 </ForPhones>\n"
+      "<State> 0 <PdfClass> 0 <Transition> 0 0.5 <Transition> 1 0.5 </State>\n"
+      "<State> 1 <PdfClass> 1 <Transition> 1 0.5 <Transition> 2 0.5 </State>\n"
+      "<State> 2 <PdfClass> 2 <Transition> 2 0.5 <Transition> 3 0.5 </State>\n"
+      "<State> 3 </State>\n"
+      "</TopologyEntry>\n"
+      "</Topology>\n";
+  HmmTopology topo;
+  std::istringstream iss(topo_str);
+  topo.Read(iss, false);
+  std::vector<int32> phones, phone2num_pdf_classes(6, 3);
+  for (int32 p = 1; p <= 5; p++) phones.push_back(p);
+  ContextDependency *ctx_dep =
+      MonophoneContextDependency(phones, phone2num_pdf_classes);
+  TransitionModel *trans_model = new TransitionModel(*ctx_dep, topo);
+  delete ctx_dep;
+  return trans_model;
+}
+
+// Random posteriors over transition-ids, with repeated transition-ids,
+// zeros and empty frames.
+void GenRandPosterior(const TransitionModel &trans_model, Posterior *post) {
+  post->clear();
+  post->resize(rand() % 20);
+  for (size_t t = 0; t < post->size(); t++) {
+    int32 num_entries = rand() % 4;
+    for (int32 j = 0; j < num_entries; j++) {
+      int32 tid = 1 + rand() % trans_model.NumTransitionIds();
+      BaseFloat weight = (rand() % 5 == 0 ? 0.0 : RandUniform());
+      (*post)[t].push_back(std::make_pair(tid, weight));
+    }
+  }
+}
+
+void AssertPosteriorsEqual(const Posterior &post1, const Posterior &post2) {
+  KALDI_ASSERT(post1.size() == post2.size());
+  for (size_t t = 0; t < post1.size(); t++) {
+    KALDI_ASSERT(post1[t].size() == post2[t].size());
+    for (size_t j = 0; j < post1[t].size(); j++) {
+      KALDI_ASSERT(post1[t][j].first == post2[t][j].first);
+      KALDI_ASSERT(ApproxEqual(post1[t][j].second, post2[t][j].second));
+    }
+  }
+}
+
+void UnitTestCompactPosteriorIo() {
+  TransitionModel *trans_model = GenTestTransitionModel();
+  for (int32 i = 0; i < 20; i++) {
+    Posterior post, post2;
+    GenRandPosterior(*trans_model, &post);
+    CompactPosterior compact(post);
+    compact.CopyToPosterior(&post2);
+    KALDI_ASSERT(post == post2);
+
+    // The formats of PosteriorHolder and CompactPosteriorHolder are the same.
+    bool binary = (i % 2 == 0);
+    std::ostringstream os1, os2;
+    PosteriorHolder::Write(os1, binary, post);
+    CompactPosteriorHolder::Write(os2, binary, compact);
+    KALDI_ASSERT(os1.str() == os2.str());
+    CompactPosteriorHolder holder;
+    std::istringstream is(os1.str());
+    KALDI_ASSERT(holder.Read(is));
+    holder.Value().CopyToPosterior(&post2);
+    AssertPosteriorsEqual(post, post2);
+  }
+  delete trans_model;
+}
+
+void UnitTestCompactPosteriorOps() {
+  TransitionModel *trans_model = GenTestTransitionModel();
+  std::vector<int32> silence_phones;
+  silence_phones.push_back(1);
+  ConstIntegerSet<int32> silence_set(silence_phones);
+  for (int32 i = 0; i < 20; i++) {
+    Posterior post, post2, ans, compact_ans;
+    GenRandPosterior(*trans_model, &post);
+    GenRandPosterior(*trans_model, &post2);
+    post2.resize(post.size());
+    CompactPosterior compact(post), compact2(post2), compact_out;
+
+    BaseFloat scale = (i % 3 == 0 ? 0.0 : RandGauss());
+    ans = post;
+    ScalePosterior(scale, &ans);
+    compact_out = compact;
+    ScalePosterior(scale, &compact_out);
+    compact_out.CopyToPosterior(&compact_ans);
+    AssertPosteriorsEqual(ans, compact_ans);
+
+    ConvertPosteriorToPdfs(*trans_model, post, &ans);
+    ConvertPosteriorToPdfs(*trans_model, compact, &compact_out);
+    compact_out.CopyToPosterior(&compact_ans);
+    AssertPosteriorsEqual(ans, compact_ans);
+
+    bool merge = (rand() % 2 == 0), drop_frames = (rand() % 2 == 0);
+    ans.clear();  // the version for Posterior appends to the output.
+    int32 num_disjoint = MergePosteriors(post, post2, merge, drop_frames,
+                                         &ans);
+    KALDI_ASSERT(MergePosteriors(compact, compact2, merge, drop_frames,
+                                 &compact_out) == num_disjoint);
+    compact_out.CopyToPosterior(&compact_ans);
+    AssertPosteriorsEqual(ans, compact_ans);
+
+    BaseFloat silence_scale = (i % 2 == 0 ? 0.0 : 0.5);
+    ans = post;
+    WeightSilencePost(*trans_model, silence_set, silence_scale, &ans);
+    compact_out = compact;
+    WeightSilencePost(*trans_model, silence_set, silence_scale, &compact_out);
+    compact_out.CopyToPosterior(&compact_ans);
+    AssertPosteriorsEqual(ans, compact_ans);
+
+    ans = post;
+    WeightSilencePostDistributed(*trans_model, silence_set, silence_scale,
+                                 &ans);
+    compact_out = compact;
+    WeightSilencePostDistributed(*trans_model, silence_set, silence_scale,
+                                 &compact_out);
+    compact_out.CopyToPosterior(&compact_ans);
+    AssertPosteriorsEqual(ans, compact_ans);
+  }
+  delete trans_model;
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::UnitTestCompactPosteriorIo();
+  kaldi::UnitTestCompactPosteriorOps();
+  std::cout << "Test OK.\n";
+}
@@ -119,8 +119,7 @@ bool PosteriorHolder::Read(std::istream &is) {
             break;
           }
           int32 i; BaseFloat p;
-          line_is >> i >> p;
-          if (line_is.fail())
+          if (!ReadTextNumber(line_is, &i) || !ReadTextNumber(line_is, &p))
             KALDI_ERR << "Error reading Posterior object (could not get data after \"[\");";
           this_vec.push_back(std::make_pair(i, p));
         }
@@ -200,6 +199,163 @@ bool GaussPostHolder::Read(std::istream &is) {
 }
 
 
+void CompactPosterior::Clear() {
+  frame_begin_.assign(1, 0);
+  ids_.clear();
+  weights_.clear();
+}
+
+void CompactPosterior::Reserve(int32 num_frames, int32 num_entries) {
+  frame_begin_.reserve(num_frames + 1);
+  ids_.reserve(num_entries);
+  weights_.reserve(num_entries);
+}
+
+void CompactPosterior::Scale(BaseFloat scale) {
+  if (weights_.empty()) return;
+  SubVector<BaseFloat> weights(&(weights_[0]), weights_.size());
+  weights.Scale(scale);
+}
+
+void CompactPosterior::CopyFromPosterior(const Posterior &post) {
+  Clear();
+  size_t num_entries = 0;
+  for (size_t i = 0; i < post.size(); i++)
+    num_entries += post[i].size();
+  Reserve(post.size(), num_entries);
+  for (size_t i = 0; i < post.size(); i++) {
+    AddFrame();
+    for (size_t j = 0; j < post[i].size(); j++)
+      AddEntry(post[i][j].first, post[i][j].second);
+  }
+}
+
+void CompactPosterior::CopyToPosterior(Posterior *post) const {
+  post->resize(NumFrames());
+  for (int32 t = 0; t < NumFrames(); t++) {
+    std::vector<std::pair<int32, BaseFloat> > &frame = (*post)[t];
+    frame.resize(FrameEnd(t) - FrameBegin(t));
+    for (int32 i = FrameBegin(t); i < FrameEnd(t); i++)
+      frame[i - FrameBegin(t)] = std::make_pair(ids_[i], weights_[i]);
+  }
+}
+
+void CompactPosterior::Swap(CompactPosterior *other) {
+  frame_begin_.swap(other->frame_begin_);
+  ids_.swap(other->ids_);
+  weights_.swap(other->weights_);
+}
+
+void CompactPosterior::Write(std::ostream &os, bool binary) const {
+  if (binary) {
+    int32 sz = NumFrames();
+    WriteBasicType(os, binary, sz);
+    for (int32 t = 0; t < NumFrames(); t++) {
+      int32 sz2 = FrameEnd(t) - FrameBegin(t);
+      WriteBasicType(os, binary, sz2);
+      for (int32 i = FrameBegin(t); i < FrameEnd(t); i++) {
+        WriteBasicType(os, binary, ids_[i]);
+        WriteBasicType(os, binary, weights_[i]);
+      }
+    }
+  } else {  // The same human-friendly format as PosteriorHolder.
+    for (int32 t = 0; t < NumFrames(); t++) {
+      os << "[ ";
+      for (int32 i = FrameBegin(t); i < FrameEnd(t); i++)
+        os << ids_[i] << ' ' << weights_[i] << ' ';
+      os << "] ";
+    }
+    os << '\n';  // newline terminate the record.
+  }
+}
+
+void CompactPosterior::Read(std::istream &is, bool binary) {
+  Clear();
+  if (binary) {
+    int32 sz;
+    ReadBasicType(is, true, &sz);
+    if (sz < 0)
+      KALDI_ERR << "Reading posteriors: got negative size";
+    frame_begin_.reserve(sz + 1);
+    for (int32 t = 0; t < sz; t++) {
+      int32 sz2;
+      ReadBasicType(is, true, &sz2);
+      if (sz2 < 0)
+        KALDI_ERR << "Reading posteriors: got negative size";
+      AddFrame();
+      for (int32 j = 0; j < sz2; j++) {
+        int32 id;
+        BaseFloat weight;
+        ReadBasicType(is, true, &id);
+        ReadBasicType(is, true, &weight);
+        AddEntry(id, weight);
+      }
+    }
+  } else {
+    std::string line;
+    getline(is, line);  // this will discard the \n, if present.
+    if (is.fail())
+      KALDI_ERR << "Reading posteriors: error reading line "
+                << (is.eof() ? "[eof]" : "");
+    std::istringstream line_is(line);
+    while (1) {
+      std::string str;
+      line_is >> std::ws;  // eat up whitespace.
+      if (line_is.eof()) break;
+      line_is >> str;
+      if (str != "[") KALDI_ERR << "Reading Posterior object: expecting [, got "
+                                << str << " (if this is an integer, possibly "
+                          "you gave alignments in place of posteriors?)";
+      AddFrame();
+      while (1) {
+        line_is >> std::ws;
+        if (line_is.peek() == ']') {
+          line_is.get();
+          break;
+        }
+        int32 i; BaseFloat p;
+        if (!ReadTextNumber(line_is, &i) || !ReadTextNumber(line_is, &p))
+          KALDI_ERR << "Error reading Posterior object (could not get data "
+                    << "after \"[\");";
+        AddEntry(i, p);
+      }
+    }
+  }
+}
+
+// static
+bool CompactPosteriorHolder::Write(std::ostream &os, bool binary,
+                                   const T &t) {
+  InitKaldiOutputStream(os, binary);  // Puts binary header if binary mode.
+  try {
+    t.Write(os, binary);
+    return os.good();
+  } catch(const std::exception &e) {
+    KALDI_WARN << "Exception caught writing table of posteriors";
+    if (!IsKaldiError(e.what())) { std::cerr << e.what(); }
+    return false;  // Write failure.
+  }
+}
+
+bool CompactPosteriorHolder::Read(std::istream &is) {
+  t_.Clear();
+  bool is_binary;
+  if (!InitKaldiInputStream(is, &is_binary)) {
+    KALDI_WARN << "Reading Table object, failed reading binary header\n";
+    return false;
+  }
+  try {
+    t_.Read(is, is_binary);
+    return true;
+  } catch (std::exception &e) {
+    KALDI_WARN << "Exception caught reading table of posteriors";
+    if (!IsKaldiError(e.what())) { std::cerr << e.what(); }
+    t_.Clear();
+    return false;
+  }
+}
+
+
 void ScalePosterior(BaseFloat scale, Posterior *post) {
   if (scale == 1.0) return;
   for (size_t i = 0; i < post->size(); i++) {
@@ -212,6 +368,19 @@ void ScalePosterior(BaseFloat scale, Posterior *post) {
   }
 }
 
+void ScalePosterior(BaseFloat scale, CompactPosterior *post) {
+  if (scale == 1.0) return;
+  if (scale == 0.0) {
+    CompactPosterior empty;
+    empty.Reserve(post->NumFrames(), 0);
+    for (int32 t = 0; t < post->NumFrames(); t++)
+      empty.AddFrame();
+    post->Swap(&empty);
+  } else {
+    post->Scale(scale);
+  }
+}
+
 bool PosteriorEntriesAreDisjoint(
     const std::vector<std::pair<int32,BaseFloat> > &post_elem1,
     const std::vector<std::pair<int32,BaseFloat> > &post_elem2) {
@@ -260,6 +429,46 @@ int32 MergePosteriors(const Posterior &post1,
   return num_disjoint;
 }
 
+int32 MergePosteriors(const CompactPosterior &post1,
+                      const CompactPosterior &post2,
+                      bool merge,
+                      bool drop_frames,
+                      CompactPosterior *post) {
+  KALDI_ASSERT(post1.NumFrames() == post2.NumFrames()); // precondition.
+  post->Clear();
+  post->Reserve(post1.NumFrames(), post1.NumEntries() + post2.NumEntries());
+
+  int32 num_disjoint = 0;
+  std::vector<std::pair<int32, BaseFloat> > frame;  // reused for each frame.
+  std::vector<int32> ids1;
+  for (int32 t = 0; t < post1.NumFrames(); t++) {
+    frame.clear();
+    ids1.clear();
+    for (int32 i = post1.FrameBegin(t); i < post1.FrameEnd(t); i++) {
+      frame.push_back(std::make_pair(post1.Id(i), post1.Weight(i)));
+      ids1.push_back(post1.Id(i));
+    }
+    std::sort(ids1.begin(), ids1.end());
+    bool disjoint = true;
+    for (int32 i = post2.FrameBegin(t); i < post2.FrameEnd(t); i++) {
+      frame.push_back(std::make_pair(post2.Id(i), post2.Weight(i)));
+      if (disjoint && std::binary_search(ids1.begin(), ids1.end(),
+                                         post2.Id(i)))
+        disjoint = false;
+    }
+    post->AddFrame();
+    if (disjoint) {
+      num_disjoint++;
+      if (drop_frames) continue;
+    }
+    if (merge) MergePairVectorSumming(&frame);
+    else std::sort(frame.begin(), frame.end());
+    for (size_t j = 0; j < frame.size(); j++)
+      post->AddEntry(frame[j].first, frame[j].second);
+  }
+  return num_disjoint;
+}
+
 void AlignmentToPosterior(const std::vector<int32> &ali,
                           Posterior *post) {
   post->clear();
@@ -271,6 +480,16 @@ void AlignmentToPosterior(const std::vector<int32> &ali,
   }
 }
 
+void AlignmentToPosterior(const std::vector<int32> &ali,
+                          CompactPosterior *post) {
+  post->Clear();
+  post->Reserve(ali.size(), ali.size());
+  for (size_t i = 0; i < ali.size(); i++) {
+    post->AddFrame();
+    post->AddEntry(ali[i], 1.0);
+  }
+}
+
 struct ComparePosteriorByPdfs {
   const TransitionModel *tmodel_;
   ComparePosteriorByPdfs(const TransitionModel &tmodel): tmodel_(&tmodel) {}
@@ -318,6 +537,26 @@ void ConvertPosteriorToPdfs(const TransitionModel &tmodel,
   }
 }
 
+void ConvertPosteriorToPdfs(const TransitionModel &tmodel,
+                            const CompactPosterior &post_in,
+                            CompactPosterior *post_out) {
+  post_out->Clear();
+  post_out->Reserve(post_in.NumFrames(), post_in.NumEntries());
+  std::vector<std::pair<int32, BaseFloat> > frame;  // reused for each frame.
+  for (int32 t = 0; t < post_in.NumFrames(); t++) {
+    frame.clear();
+    for (int32 i = post_in.FrameBegin(t); i < post_in.FrameEnd(t); i++)
+      frame.push_back(std::make_pair(tmodel.TransitionIdToPdf(post_in.Id(i)),
+                                     post_in.Weight(i)));
+    // Sorts on the pdf-id, sums the weights of the same pdf-id and removes
+    // zeros, as the std::map in the version for Posterior does.
+    MergePairVectorSumming(&frame);
+    post_out->AddFrame();
+    for (size_t j = 0; j < frame.size(); j++)
+      post_out->AddEntry(frame[j].first, frame[j].second);
+  }
+}
+
 void ConvertPosteriorToPhones(const TransitionModel &tmodel,
                               const Posterior &post_in,
                               Posterior *post_out) {
@@ -368,6 +607,30 @@ void WeightSilencePost(const TransitionModel &trans_model,
 }
 
 
+void WeightSilencePost(const TransitionModel &trans_model,
+                       const ConstIntegerSet<int32> &silence_set,
+                       BaseFloat silence_scale,
+                       CompactPosterior *post) {
+  CompactPosterior ans;
+  ans.Reserve(post->NumFrames(), post->NumEntries());
+  for (int32 t = 0; t < post->NumFrames(); t++) {
+    ans.AddFrame();
+    for (int32 i = post->FrameBegin(t); i < post->FrameEnd(t); i++) {
+      int32 tid = post->Id(i),
+          phone = trans_model.TransitionIdToPhone(tid);
+      BaseFloat weight = post->Weight(i);
+      if (silence_set.count(phone) != 0) {  // is a silence.
+        if (silence_scale != 0.0)
+          ans.AddEntry(tid, weight * silence_scale);
+      } else {
+        ans.AddEntry(tid, weight);
+      }
+    }
+  }
+  post->Swap(&ans);
+}
+
+
 void WeightSilencePostDistributed(const TransitionModel &trans_model,
                                   const ConstIntegerSet<int32> &silence_set,
                                   BaseFloat silence_scale,
@@ -400,4 +663,32 @@ void WeightSilencePostDistributed(const TransitionModel &trans_model,
 }
 
 
+void WeightSilencePostDistributed(const TransitionModel &trans_model,
+                                  const ConstIntegerSet<int32> &silence_set,
+                                  BaseFloat silence_scale,
+                                  CompactPosterior *post) {
+  CompactPosterior ans;
+  ans.Reserve(post->NumFrames(), post->NumEntries());
+  for (int32 t = 0; t < post->NumFrames(); t++) {
+    ans.AddFrame();
+    BaseFloat sil_weight = 0.0, nonsil_weight = 0.0;
+    for (int32 i = post->FrameBegin(t); i < post->FrameEnd(t); i++) {
+      int32 phone = trans_model.TransitionIdToPhone(post->Id(i));
+      if (silence_set.count(phone) != 0) sil_weight += post->Weight(i);
+      else nonsil_weight += post->Weight(i);
+    }
+    KALDI_ASSERT(sil_weight >= 0.0 && nonsil_weight >= 0.0); // This "distributed"
+    // weighting approach doesn't make sense if we have negative weights.
+    BaseFloat frame_scale = 1.0;
+    if (sil_weight + nonsil_weight != 0.0)
+      frame_scale = (sil_weight * silence_scale + nonsil_weight) /
+                    (sil_weight + nonsil_weight);
+    if (frame_scale != 0.0)
+      for (int32 i = post->FrameBegin(t); i < post->FrameEnd(t); i++)
+        ans.AddEntry(post->Id(i), post->Weight(i) * frame_scale);
+  }
+  post->Swap(&ans);
+}
+
+
 } // End namespace kaldi
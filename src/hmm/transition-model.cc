@@ -95,6 +95,22 @@ void TransitionModel::ComputeDerived() {
     for (int32 tid = state2id_[tstate]; tid < state2id_[tstate+1]; tid++)
       id2state_[tid] = tstate;
 
+  // Element zero (transition-id zero is not valid) gets pdf -1, phone 0.
+  id2pdf_id_.assign(cur_transition_id, -1);
+  id2phone_.assign(cur_transition_id, 0);
+  is_self_loop_.assign(cur_transition_id, 0);
+  for (int32 tstate = 1; tstate <= static_cast<int32>(triples_.size()); tstate++) {
+    const Triple &triple = triples_[tstate-1];
+    const HmmTopology::HmmState &state =
+        topo_.TopologyForPhone(triple.phone)[triple.hmm_state];
+    for (int32 tid = state2id_[tstate]; tid < state2id_[tstate+1]; tid++) {
+      int32 trans_index = tid - state2id_[tstate];
+      id2pdf_id_[tid] = triple.pdf;
+      id2phone_[tid] = triple.phone;
+      is_self_loop_[tid] =
+          (state.transitions[trans_index].first == triple.hmm_state);
+    }
+  }
 }
 void TransitionModel::InitializeProbs() {
   log_probs_.Resize(NumTransitionIds()+1);  // one-based array, zeroth element empty.
@@ -131,6 +147,11 @@ void TransitionModel::Check() const {
         hmm_state = TransitionStateToHmmState(tstate),
         pdf = TransitionStateToPdf(tstate);
     KALDI_ASSERT(tstate == TripleToTransitionState(phone, hmm_state, pdf));
+    const HmmTopology::HmmState &state =
+        topo_.TopologyForPhone(phone)[hmm_state];
+    KALDI_ASSERT(id2pdf_id_[tid] == pdf && id2phone_[tid] == phone &&
+                 (is_self_loop_[tid] != 0) ==
+                 (state.transitions[index].first == hmm_state));
     KALDI_ASSERT(log_probs_(tid) <= 0.0 && log_probs_(tid) - log_probs_(tid) == 0.0);
     // checking finite and non-positive (and not out-of-bounds).
   }
@@ -226,15 +247,8 @@ bool TransitionModel::IsFinal(int32 trans_id) const {
 
 
 bool TransitionModel::IsSelfLoop(int32 trans_id) const {
-  KALDI_ASSERT(static_cast<size_t>(trans_id) < id2state_.size());
-  int32 trans_state = id2state_[trans_id];
-  int32 trans_index = trans_id - state2id_[trans_state];
-  const Triple &triple = triples_[trans_state-1];
-  int32 phone = triple.phone, hmm_state = triple.hmm_state;
-  const HmmTopology::TopologyEntry &entry = topo_.TopologyForPhone(phone);
-  KALDI_ASSERT(static_cast<size_t>(hmm_state) < entry.size());
-  return (static_cast<size_t>(trans_index) < entry[hmm_state].transitions.size()
-          && entry[hmm_state].transitions[trans_index].first == hmm_state);
+  KALDI_ASSERT(static_cast<size_t>(trans_id) < is_self_loop_.size());
+  return is_self_loop_[trans_id];
 }
 
 int32 TransitionModel::SelfLoopOf(int32 trans_state) const {  // returns the self-loop transition-id,
@@ -640,9 +654,8 @@ void TransitionModel::MapUpdateShared(const Vector<double> &stats,
 
 
 int32 TransitionModel::TransitionIdToPhone(int32 trans_id) const {
-  KALDI_ASSERT(trans_id != 0 && static_cast<size_t>(trans_id) < id2state_.size());
-  int32 trans_state = id2state_[trans_id];
-  return triples_[trans_state-1].phone;
+  KALDI_ASSERT(trans_id != 0 && static_cast<size_t>(trans_id) < id2phone_.size());
+  return id2phone_[trans_id];
 }
 
 int32 TransitionModel::TransitionIdToPdfClass(int32 trans_id) const {
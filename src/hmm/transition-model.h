@@ -152,6 +152,9 @@ class TransitionModel {
   // this state doesn't have a self-loop.
 
   inline int32 TransitionIdToPdf(int32 trans_id) const;
+  /// As TransitionIdToPdf(), but checks that trans_id is in range only in
+  /// paranoid mode; for the inner loops of decodables and the like.
+  inline int32 TransitionIdToPdfFast(int32 trans_id) const;
   int32 TransitionIdToPhone(int32 trans_id) const;
   int32 TransitionIdToPdfClass(int32 trans_id) const;
   int32 TransitionIdToHmmState(int32 trans_id) const;
@@ -245,7 +248,8 @@ class TransitionModel {
                        const MapTransitionUpdateConfig &cfg,
                        BaseFloat *objf_impr_out, BaseFloat *count_out);
   void ComputeTriples(const ContextDependency &ctx_dep);  // called from constructor.  initializes triples_.
-  void ComputeDerived();  // called from constructor and Read function: computes state2id_ and id2state_.
+  void ComputeDerived();  // called from constructor and Read function: computes state2id_, id2state_,
+  // id2pdf_id_, id2phone_ and is_self_loop_.
   void ComputeDerivedOfProbs();  // computes quantities derived from log-probs (currently just
   // non_self_loop_log_probs_; called whenever log-probs change.
   void InitializeProbs();  // called from constructor.
@@ -287,6 +291,14 @@ class TransitionModel {
   /// state (indexed by transition-id).
   std::vector<int32> id2state_;
 
+  /// For each transition-id, the corresponding pdf-id, phone and whether it is
+  /// a self-loop (indexed by transition-id).  These are derived from the
+  /// above; they are kept so that lookups in the decoders' inner loops are a
+  /// single load.
+  std::vector<int32> id2pdf_id_;
+  std::vector<int32> id2phone_;
+  std::vector<char> is_self_loop_;
+
   /// For each transition-id, the corresponding log-prob.  Indexed by transition-id.
   Vector<BaseFloat> log_probs_;
 
@@ -305,11 +317,13 @@ class TransitionModel {
 };
 
 inline int32 TransitionModel::TransitionIdToPdf(int32 trans_id) const {
-  // If a lot of time is spent here we may create an extra array
-  // to handle this.
-  KALDI_ASSERT(static_cast<size_t>(trans_id) < id2state_.size());
-  int32 trans_state = id2state_[trans_id];
-  return triples_[trans_state-1].pdf;
+  KALDI_ASSERT(static_cast<size_t>(trans_id) < id2pdf_id_.size());
+  return id2pdf_id_[trans_id];
+}
+
+inline int32 TransitionModel::TransitionIdToPdfFast(int32 trans_id) const {
+  KALDI_PARANOID_ASSERT(static_cast<size_t>(trans_id) < id2pdf_id_.size());
+  return id2pdf_id_[trans_id];
 }
 
 /// Works out which pdfs might correspond to the given phones.  Will return true
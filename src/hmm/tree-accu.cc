@@ -93,11 +93,16 @@ void AccumulateTreeStats(const TransitionModel &trans_model,
         std::pair<EventKeyType, EventValueType> pr(kPdfClass, pdf_class);
         evec_more.push_back(pr);
         std::sort(evec_more.begin(), evec_more.end());  // these must be sorted!
-        if (stats->count(evec_more) == 0)
-          (*stats)[evec_more] = new GaussClusterable(dim, var_floor);
-        
+        // Look up the event only once: the new element, if any, is inserted
+        // with a NULL pointer.
+        GaussClusterable *null_stats = NULL;
+        GaussClusterable *&this_stats =
+            stats->insert(std::make_pair(evec_more, null_stats)).first->second;
+        if (this_stats == NULL)
+          this_stats = new GaussClusterable(dim, var_floor);
+
         BaseFloat weight = 1.0;
-        (*stats)[evec_more]->AddStats(features.Row(cur_pos), weight);
+        this_stats->AddStats(features.Row(cur_pos), weight);
         cur_pos++;
       }
     }
@@ -44,6 +44,19 @@ class DecodableInterface {
   /// Returns the log likelihood, which will be negated in the decoder.
   virtual BaseFloat LogLikelihood(int32 frame, int32 index) = 0;
 
+  /// Computes the log likelihoods for a set of indices on one frame, i.e. sets
+  /// (*log_likes)[i] = LogLikelihood(frame, indices[i]).  Decoders call this
+  /// once per frame with all the indices they will need on that frame, which
+  /// saves a virtual function call per arc.  The default implementation just
+  /// calls LogLikelihood(); decodable objects should override it if they can
+  /// do better, e.g. by vectorizing the computation over the indices.
+  virtual void LogLikelihoods(int32 frame, const std::vector<int32> &indices,
+                              std::vector<BaseFloat> *log_likes) {
+    log_likes->resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+      (*log_likes)[i] = LogLikelihood(frame, indices[i]);
+  }
+
   /// Returns true if this is the last frame.  Frames are one-based.
   virtual bool IsLastFrame(int32 frame) = 0;
 
@@ -0,0 +1,76 @@
+// ivector/ivector-extractor-batched.cc
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ivector/ivector-extractor-batched.h"
+
+namespace kaldi {
+
+IvectorExtractorBatched::IvectorExtractorBatched(
+    const IvectorExtractor &extractor): extractor_(extractor) {
+  int32 I = extractor.NumGauss(), D = extractor.FeatDim(),
+      S = extractor.IvectorDim();
+  Matrix<BaseFloat> linear_proj(I * D, S);
+  Matrix<double> temp(D, S);
+  for (int32 i = 0; i < I; i++) {
+    temp.AddSpMat(1.0, extractor.Sigma_inv_[i], extractor.M_[i], kNoTrans,
+                  0.0);
+    SubMatrix<BaseFloat> part(linear_proj, i * D, D, 0, S);
+    part.CopyFromMat(temp);
+  }
+  linear_proj_.Swap(&linear_proj);
+  U_.Resize(extractor.U_.NumRows(), extractor.U_.NumCols(), kUndefined);
+  U_.CopyFromMat(extractor.U_);
+}
+
+void IvectorExtractorBatched::GetIvectorMeans(
+    const std::vector<const IvectorExtractorUtteranceStats*> &utt_stats,
+    Matrix<double> *means) const {
+  int32 num_utts = utt_stats.size(), I = extractor_.NumGauss(),
+      D = extractor_.FeatDim(), S = extractor_.IvectorDim();
+  means->Resize(num_utts, S);
+  if (num_utts == 0) return;
+
+  Matrix<BaseFloat> gamma(num_utts, I, kUndefined), X(num_utts, I * D,
+                                                      kUndefined);
+  for (int32 b = 0; b < num_utts; b++) {
+    KALDI_ASSERT(utt_stats[b]->gamma.Dim() == I &&
+                 utt_stats[b]->X.NumCols() == D);
+    gamma.Row(b).CopyFromVec(utt_stats[b]->gamma);
+    X.Row(b).CopyRowsFromMat(utt_stats[b]->X);
+  }
+  CuMatrix<BaseFloat> cu_gamma(gamma), cu_X(X),
+      cu_linear(num_utts, S, kUndefined),
+      cu_quadratic(num_utts, U_.NumCols(), kUndefined);
+  cu_linear.AddMatMat(1.0, cu_X, kNoTrans, linear_proj_, kNoTrans, 0.0);
+  cu_quadratic.AddMatMat(1.0, cu_gamma, kNoTrans, U_, kNoTrans, 0.0);
+  Matrix<double> linear(cu_linear), quadratic(cu_quadratic);
+
+  for (int32 b = 0; b < num_utts; b++) {
+    Vector<double> this_linear(linear.Row(b));
+    SpMatrix<double> this_quadratic(S);
+    SubVector<double> q_vec(this_quadratic.Data(), S * (S + 1) / 2);
+    q_vec.CopyFromVec(quadratic.Row(b));
+    extractor_.GetIvectorDistPrior(*(utt_stats[b]), &this_linear,
+                                   &this_quadratic);
+    SubVector<double> mean(*means, b);
+    extractor_.SolveIvectorDistribution(*(utt_stats[b]), this_linear,
+                                        &this_quadratic, &mean, NULL);
+  }
+}
+
+}  // namespace kaldi
@@ -0,0 +1,69 @@
+// ivector/ivector-extractor-batched.h
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_IVECTOR_IVECTOR_EXTRACTOR_BATCHED_H_
+#define KALDI_IVECTOR_IVECTOR_EXTRACTOR_BATCHED_H_
+
+#include <vector>
+#include "ivector/ivector-extractor.h"
+#include "cudamatrix/cu-matrix.h"
+
+namespace kaldi {
+
+/// This class computes iVectors for a batch of utterances at a time.  The
+/// expensive parts of GetIvectorDistribution(), which are the linear term
+/// (sum_i M_i^T Sigma_i^{-1} X_i) and the quadratic term (sum_i gamma_i U_i),
+/// are done for the whole batch as two matrix multiplications, on the GPU if
+/// one is in use.  The rest (adding the prior, and solving for the iVector,
+/// including the weight terms if applicable) is done on the CPU exactly as in
+/// IvectorExtractor.  The matrix multiplications are done in single precision,
+/// so the output matches IvectorExtractor::GetIvectorDistribution() only to
+/// within roundoff.
+/// Note: this keeps a copy of the U_i quantities, which for a large extractor
+/// (I = 2048, S = 400) is about 650Mb.
+class IvectorExtractorBatched {
+ public:
+  /// Copies what it needs from "extractor" (to the GPU, if in use).
+  /// "extractor" must not be changed or destroyed while this object exists.
+  explicit IvectorExtractorBatched(const IvectorExtractor &extractor);
+
+  /// Sets row b of "means" to the mean of the iVector distribution for
+  /// utt_stats[b], i.e. what IvectorExtractor::GetIvectorDistribution() would
+  /// output (including the prior offset in the first dimension).  "means" is
+  /// resized to utt_stats.size() by IvectorDim().
+  void GetIvectorMeans(
+      const std::vector<const IvectorExtractorUtteranceStats*> &utt_stats,
+      Matrix<double> *means) const;
+
+  const IvectorExtractor &Extractor() const { return extractor_; }
+
+ private:
+  const IvectorExtractor &extractor_;
+  /// Dimension is [I*D][S]; rows i*D through (i+1)*D - 1 are Sigma_i^{-1} M_i,
+  /// so the linear term for an utterance is its first-order stats, arranged
+  /// as a row vector, times this.
+  CuMatrix<BaseFloat> linear_proj_;
+  /// A copy of extractor.U_: the U_i quantities, as packed symmetric matrices
+  /// in the rows.  Dimension is [I][S*(S+1)/2].
+  CuMatrix<BaseFloat> U_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(IvectorExtractorBatched);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_IVECTOR_IVECTOR_EXTRACTOR_BATCHED_H_
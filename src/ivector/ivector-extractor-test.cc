@@ -18,6 +18,7 @@
 #include "gmm/model-test-common.h"
 #include "gmm/full-gmm-normal.h"
 #include "ivector/ivector-extractor.h"
+#include "ivector/ivector-extractor-batched.h"
 #include "util/kaldi-io.h"
 
 
@@ -76,6 +77,106 @@ void TestIvectorStatsIO(IvectorStats &stats) {
 }
   
 
+// Checks that IvectorExtractorBatched gives the same iVectors as
+// IvectorExtractor::GetIvectorDistribution().
+void TestIvectorExtractorBatched(const IvectorExtractor &extractor,
+                                 const FullGmm &fgmm,
+                                 const std::vector<Matrix<BaseFloat> > &all_feats) {
+  int32 num_utts = all_feats.size();
+  std::vector<IvectorExtractorUtteranceStats*> utt_stats(num_utts);
+  for (int32 utt = 0; utt < num_utts; utt++) {
+    const Matrix<BaseFloat> &feats = all_feats[utt];
+    Posterior post(feats.NumRows());
+    for (int32 t = 0; t < feats.NumRows(); t++) {
+      Vector<BaseFloat> gauss_post(fgmm.NumGauss());
+      fgmm.ComponentPosteriors(feats.Row(t), &gauss_post);
+      for (int32 i = 0; i < gauss_post.Dim(); i++)
+        post[t].push_back(std::make_pair(i, gauss_post(i)));
+    }
+    utt_stats[utt] = new IvectorExtractorUtteranceStats(
+        extractor.NumGauss(), extractor.FeatDim(), false);
+    extractor.GetStats(feats, post, utt_stats[utt]);
+  }
+  IvectorExtractorBatched batched(extractor);
+  Matrix<double> means;
+  batched.GetIvectorMeans(std::vector<const IvectorExtractorUtteranceStats*>(
+      utt_stats.begin(), utt_stats.end()), &means);
+  KALDI_ASSERT(means.NumRows() == num_utts);
+  for (int32 utt = 0; utt < num_utts; utt++) {
+    Vector<double> mean(extractor.IvectorDim());
+    extractor.GetIvectorDistribution(*(utt_stats[utt]), &mean, NULL);
+    KALDI_ASSERT(mean.ApproxEqual(Vector<double>(means.Row(utt)), 1.0e-03));
+    delete utt_stats[utt];
+  }
+}
+
+// Checks IvectorExtractorApprox against the exact iVectors.  Without
+// iVector-dependent weights, the exact iVector maximizes the auxf, and with a
+// single Gaussian the approximation is exact.
+void TestIvectorExtractorApprox(const IvectorExtractor &extractor,
+                                const FullGmm &fgmm,
+                                const Matrix<BaseFloat> &feats) {
+  Posterior post(feats.NumRows());
+  for (int32 t = 0; t < feats.NumRows(); t++) {
+    Vector<BaseFloat> gauss_post(fgmm.NumGauss());
+    fgmm.ComponentPosteriors(feats.Row(t), &gauss_post);
+    for (int32 i = 0; i < gauss_post.Dim(); i++)
+      post[t].push_back(std::make_pair(i, gauss_post(i)));
+  }
+  IvectorExtractorUtteranceStats utt_stats(extractor.NumGauss(),
+                                           extractor.FeatDim(), false);
+  extractor.GetStats(feats, post, &utt_stats);
+  IvectorExtractorApprox approx(extractor);
+  Vector<double> mean(extractor.IvectorDim()),
+      approx_mean(extractor.IvectorDim());
+  extractor.GetIvectorDistribution(utt_stats, &mean, NULL);
+  approx.GetIvectorMean(utt_stats, &approx_mean);
+  double auxf = extractor.GetAuxf(utt_stats, mean),
+      approx_auxf = extractor.GetAuxf(utt_stats, approx_mean);
+  KALDI_LOG << "Auxf per frame with exact iVector is "
+            << (auxf / feats.NumRows()) << ", with approximate iVector "
+            << (approx_auxf / feats.NumRows());
+  if (!extractor.IvectorDependentWeights()) {
+    KALDI_ASSERT(approx_auxf <= auxf + 1.0e-05 * std::abs(auxf));
+    if (extractor.NumGauss() == 1)
+      KALDI_ASSERT(mean.ApproxEqual(approx_mean, 1.0e-05));
+  }
+}
+
+// Checks that accumulating the utterances into two IvectorStats objects and
+// combining them with Add() gives the same update as accumulating them into
+// one.  Only done without iVector-dependent weights, as the stats for those
+// are a random sample; and we don't update the variances, which may not be
+// well determined from so little data.
+void TestIvectorStatsAdd(const IvectorExtractor &extractor,
+                         const FullGmm &fgmm,
+                         const std::vector<Matrix<BaseFloat> > &all_feats) {
+  if (extractor.IvectorDependentWeights()) return;
+  IvectorStatsOptions stats_opts;
+  stats_opts.update_variances = false;
+  IvectorStats stats(extractor, stats_opts), stats1(extractor, stats_opts),
+      stats2(extractor, stats_opts);
+  for (size_t utt = 0; utt < all_feats.size(); utt++) {
+    stats.AccStatsForUtterance(extractor, all_feats[utt], fgmm);
+    if (utt % 2 == 0) stats1.AccStatsForUtterance(extractor, all_feats[utt], fgmm);
+    else stats2.AccStatsForUtterance(extractor, all_feats[utt], fgmm);
+  }
+  stats1.Add(stats2);
+  { // Write() flushes the cache of stats for R, which Update() requires.
+    std::ostringstream ostr;
+    stats.Write(ostr, true);
+    stats1.Write(ostr, true);
+  }
+
+  IvectorExtractorEstimationOptions estimation_opts;
+  estimation_opts.gaussian_min_count = extractor.FeatDim() + 5;
+  IvectorExtractor extractor1(extractor), extractor2(extractor);
+  double auxf_impr1 = stats.Update(estimation_opts, &extractor1),
+      auxf_impr2 = stats1.Update(estimation_opts, &extractor2);
+  AssertEqual(stats.AuxfPerFrame(), stats1.AuxfPerFrame(), 1.0e-05);
+  AssertEqual(auxf_impr1, auxf_impr2, 1.0e-03);
+}
+
 void UnitTestIvectorExtractor() {
   FullGmm fgmm;
   int32 dim = 5 + rand() % 5, num_comp = 1 + rand() % 5;
@@ -141,6 +242,9 @@ void UnitTestIvectorExtractor() {
     last_auxf_impr = auxf_impr;
     last_auxf = auxf;
   }
+  TestIvectorExtractorBatched(extractor, fgmm, all_feats);
+  TestIvectorExtractorApprox(extractor, fgmm, all_feats[0]);
+  TestIvectorStatsAdd(extractor, fgmm, all_feats);
   std::cout << "********************************************************************************************\n";
 }
 
@@ -93,11 +93,21 @@ void IvectorExtractor::GetIvectorDistribution(
     const IvectorExtractorUtteranceStats &utt_stats,
     VectorBase<double> *mean,
     SpMatrix<double> *var) const {
+  Vector<double> linear(IvectorDim());
+  SpMatrix<double> quadratic(IvectorDim());
+  GetIvectorDistMean(utt_stats, &linear, &quadratic);
+  GetIvectorDistPrior(utt_stats, &linear, &quadratic);
+  SolveIvectorDistribution(utt_stats, linear, &quadratic, mean, var);
+}
+
+void IvectorExtractor::SolveIvectorDistribution(
+    const IvectorExtractorUtteranceStats &utt_stats,
+    const VectorBase<double> &linear,
+    SpMatrix<double> *quadratic_in,
+    VectorBase<double> *mean,
+    SpMatrix<double> *var) const {
+  SpMatrix<double> &quadratic = *quadratic_in;
   if (!IvectorDependentWeights()) {
-    Vector<double> linear(IvectorDim());
-    SpMatrix<double> quadratic(IvectorDim());
-    GetIvectorDistMean(utt_stats, &linear, &quadratic);
-    GetIvectorDistPrior(utt_stats, &linear, &quadratic);
     if (var != NULL) {
       var->CopyFromSp(quadratic);
       var->Invert(); // now it's a variance.
@@ -109,10 +119,6 @@ void IvectorExtractor::GetIvectorDistribution(
       mean->AddSpVec(1.0, quadratic, linear, 0.0);
     }
   } else {
-    Vector<double> linear(IvectorDim());
-    SpMatrix<double> quadratic(IvectorDim());
-    GetIvectorDistMean(utt_stats, &linear, &quadratic);
-    GetIvectorDistPrior(utt_stats, &linear, &quadratic);
     // At this point, "linear" and "quadratic" contain
     // the mean and prior-related terms, and we avoid
     // recomputing those. 
@@ -163,6 +169,72 @@ void IvectorExtractor::GetIvectorDistribution(
 }
 
 
+IvectorExtractorApprox::IvectorExtractorApprox(
+    const IvectorExtractor &extractor): extractor_(extractor) {
+  int32 I = extractor.NumGauss(), D = extractor.FeatDim(),
+      S = extractor.IvectorDim();
+  // The Gaussian weights at the mean of the prior, used to weight the U_i.
+  Vector<double> w(I);
+  if (extractor.IvectorDependentWeights()) {
+    w.CopyColFromMat(extractor.w_, 0);
+    w.Scale(extractor.ivector_offset_);
+    w.ApplySoftMax();
+  } else {
+    w.CopyFromVec(extractor.w_vec_);
+    w.Scale(1.0 / w.Sum());
+  }
+  SpMatrix<double> U_avg(S);
+  SubVector<double> U_avg_vec(U_avg.Data(), S * (S + 1) / 2);
+  U_avg_vec.AddMatVec(1.0, extractor.U_, kTrans, w, 0.0);
+  Vector<double> eigs(S);
+  P_.Resize(S, S);
+  U_avg.Eig(&eigs, &P_);
+
+  SigmaInvMP_.resize(I);
+  d_.Resize(I, S);
+  double tot_energy = 0.0, diag_energy = 0.0;
+  Matrix<double> MP(D, S);
+  SpMatrix<double> U_i(S);
+  for (int32 i = 0; i < I; i++) {
+    MP.AddMatMat(1.0, extractor.M_[i], kNoTrans, P_, kNoTrans, 0.0);
+    SigmaInvMP_[i].Resize(D, S);
+    SigmaInvMP_[i].AddSpMat(1.0, extractor.Sigma_inv_[i], MP, kNoTrans, 0.0);
+    // d_i = diag(P^T M_i^T Sigma_i^{-1} M_i P).
+    d_.Row(i).AddDiagMatMat(1.0, MP, kTrans, SigmaInvMP_[i], kNoTrans, 0.0);
+    // The Frobenius norm is invariant to the change of basis, so the energy in
+    // the off-diagonal part is ||U_i||^2 - ||d_i||^2.
+    SubVector<double> U_i_vec(U_i.Data(), S * (S + 1) / 2);
+    U_i_vec.CopyFromVec(extractor.U_.Row(i));
+    tot_energy += w(i) * TraceSpSp(U_i, U_i);
+    diag_energy += w(i) * VecVec(d_.Row(i), d_.Row(i));
+  }
+  KALDI_LOG << "Approximating the U_i as diagonal in a common basis keeps "
+            << (100.0 * diag_energy / tot_energy) << "% of their (weighted) "
+            << "squared Frobenius norm.";
+}
+
+void IvectorExtractorApprox::GetIvectorMean(
+    const IvectorExtractorUtteranceStats &utt_stats,
+    VectorBase<double> *mean) const {
+  int32 I = extractor_.NumGauss(), S = extractor_.IvectorDim();
+  KALDI_ASSERT(utt_stats.gamma.Dim() == I && mean->Dim() == S);
+  // The linear term, in the basis P; it starts with the term from the prior,
+  // whose mean is ivector_offset_ in dimension zero.
+  Vector<double> linear(S);
+  linear.AddVec(extractor_.ivector_offset_, P_.Row(0));
+  for (int32 i = 0; i < I; i++)
+    if (utt_stats.gamma(i) != 0.0)
+      linear.AddMatVec(1.0, SigmaInvMP_[i], kTrans, utt_stats.X.Row(i), 1.0);
+  // The diagonal of the quadratic term, in the basis P; the prior contributes
+  // the unit matrix.
+  Vector<double> quadratic(S);
+  quadratic.Set(1.0);
+  quadratic.AddMatVec(1.0, d_, kTrans, utt_stats.gamma, 1.0);
+  linear.DivElements(quadratic);
+  mean->AddMatVec(1.0, P_, kNoTrans, linear, 0.0);
+}
+
+
 IvectorExtractor::IvectorExtractor(
     const IvectorExtractorOptions &opts,
     const FullGmm &fgmm) {
@@ -794,8 +866,12 @@ void IvectorStats::CommitStatsForUtterance(
                                    &ivec_mean,
                                    &ivec_var);
 
-  if (config_.compute_auxf)
-    tot_auxf_ += extractor.GetAuxf(utt_stats, ivec_mean, &ivec_var);
+  if (config_.compute_auxf) {
+    double auxf = extractor.GetAuxf(utt_stats, ivec_mean, &ivec_var);
+    prior_stats_lock_.Lock();  // tot_auxf_ is guarded by this lock too.
+    tot_auxf_ += auxf;
+    prior_stats_lock_.Unlock();
+  }
   
   CommitStatsForM(extractor, utt_stats, ivec_mean, ivec_var);
   if (extractor.IvectorDependentWeights())
@@ -870,10 +946,14 @@ double IvectorStats::AccStatsForUtterance(
   Posterior post(num_frames);
 
   double tot_log_like = 0.0;
+  Matrix<BaseFloat> loglikes;
+  fgmm.LogLikelihoods(feats, &loglikes);  // Much faster than frame by frame.
   for (int32 t = 0; t < num_frames; t++) {
-    SubVector<BaseFloat> frame(feats, t);
-    Vector<BaseFloat> posterior(fgmm.NumGauss(), kUndefined);
-    tot_log_like += fgmm.ComponentPosteriors(frame, &posterior);
+    SubVector<BaseFloat> posterior(loglikes, t);
+    BaseFloat log_like = posterior.ApplySoftMax();
+    if (KALDI_ISNAN(log_like) || KALDI_ISINF(log_like))
+      KALDI_ERR << "Invalid answer (overflow or invalid variances/features?)";
+    tot_log_like += log_like;
     for (int32 i = 0; i < posterior.Dim(); i++)
       post[t].push_back(std::make_pair(i, posterior(i)));
   }
@@ -891,6 +971,14 @@ void IvectorStats::Add(const IvectorStats &other) {
   for (size_t i = 0; i < Y_.size(); i++)
     Y_[i].AddMat(weight, other.Y_[i]);
   R_.AddMat(weight, other.R_);
+  if (other.R_num_cached_ > 0) {
+    // "other" may have stats in its cache for R that it has not yet added to
+    // its R_.
+    R_.AddMatMat(weight, other.R_gamma_cache_.RowRange(0, other.R_num_cached_),
+                 kTrans,
+                 other.R_ivec_scatter_cache_.RowRange(0, other.R_num_cached_),
+                 kNoTrans, 1.0);
+  }
   Q_.AddMat(weight, other.Q_);
   G_.AddMat(weight, other.G_);
   KALDI_ASSERT(S_.size() == other.S_.size());
@@ -978,6 +1066,8 @@ void IvectorStats::Read(std::istream &is, bool binary, bool add) {
 double IvectorStats::Update(const IvectorExtractorEstimationOptions &opts,
                                IvectorExtractor *extractor) const {
   CheckDims(*extractor);
+  KALDI_ASSERT(R_num_cached_ == 0 && "Please flush the cache using the "
+               "non-const Write() before calling Update().");
   if (tot_auxf_ != 0.0) {
     KALDI_LOG << "Overall auxf/frame on training data was "
               << (tot_auxf_/gamma_.Sum()) << " per frame over "
@@ -58,6 +58,8 @@ struct IvectorEstimationOptions {
 
 class IvectorExtractor;
 class IvectorExtractorComputeDerivedVarsClass;
+class IvectorExtractorBatched;
+class IvectorExtractorApprox;
 
 /// These are the stats for a particular utterance, i.e. the sufficient stats
 /// for estimating an iVector (if need_2nd_order_stats == true, we can also
@@ -111,6 +113,8 @@ struct IvectorExtractorOptions {
 class IvectorExtractor {
  public:
   friend class IvectorStats;
+  friend class IvectorExtractorBatched;
+  friend class IvectorExtractorApprox;
 
   IvectorExtractor(): ivector_offset_(0.0) { }
   
@@ -281,7 +285,54 @@ class IvectorExtractor {
   // of quadratic_term to 1.0, which mathematically is the least they can be,
   // due to the prior term.
   static void InvertWithFlooring(const SpMatrix<double> &quadratic_term,
-                                 SpMatrix<double> *var);  
+                                 SpMatrix<double> *var);
+
+  // This is the second half of GetIvectorDistribution(): given the linear and
+  // quadratic terms from the means and the prior, it works out the
+  // distribution (adding the terms from the weights, if applicable).
+  // "quadratic" is used as a temporary.
+  void SolveIvectorDistribution(
+      const IvectorExtractorUtteranceStats &utt_stats,
+      const VectorBase<double> &linear,
+      SpMatrix<double> *quadratic,
+      VectorBase<double> *mean,
+      SpMatrix<double> *var) const;
+};
+
+
+/// This class does approximate iVector extraction, for when speed matters
+/// more than accuracy (e.g. in online speaker diarization).  At construction
+/// time it finds a single basis P (the eigenvectors of the average of the U_i
+/// = M_i^T Sigma_i^{-1} M_i, weighted by the Gaussian weights at the prior
+/// mean) and approximates each U_i as P diag(d_i) P^T, ignoring its
+/// off-diagonal part in that basis.  The quadratic term of the iVector
+/// distribution, including the prior, then becomes
+/// P diag(1 + sum_i gamma_i d_i) P^T, which costs O(I S) to compute and is
+/// trivial to invert, instead of O(I S^2) plus an O(S^3) inversion; the linear
+/// term still costs O(I D S).  The constructor logs how much of the U_i is
+/// lost by the approximation.  Note: the terms arising from iVector-dependent
+/// weights (if IvectorDependentWeights()) are not included.
+class IvectorExtractorApprox {
+ public:
+  /// "extractor" must not be changed or destroyed while this object exists.
+  explicit IvectorExtractorApprox(const IvectorExtractor &extractor);
+
+  /// Gets an approximation to the mean of the iVector distribution (i.e. to
+  /// the iVector as output by IvectorExtractor::GetIvectorDistribution(),
+  /// including the prior offset).  "mean" must have dimension IvectorDim().
+  void GetIvectorMean(const IvectorExtractorUtteranceStats &utt_stats,
+                      VectorBase<double> *mean) const;
+
+ private:
+  const IvectorExtractor &extractor_;
+  /// The basis; its columns are orthonormal.  Dimension is [S][S].
+  Matrix<double> P_;
+  /// Sigma_i^{-1} M_i P, used to get the linear term in the basis P.
+  /// Dimension is [I][D][S].
+  std::vector<Matrix<double> > SigmaInvMP_;
+  /// Row i is the diagonal of P^T U_i P.  Dimension is [I][S].
+  Matrix<double> d_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(IvectorExtractorApprox);
 };
 
 
@@ -342,6 +393,8 @@ class IvectorStats {
   IvectorStats(const IvectorExtractor &extractor,
                const IvectorStatsOptions &stats_opts);
   
+  /// Adds "other", which must have the same dimensions, to this object, e.g.
+  /// to combine stats accumulated by different threads.
   void Add(const IvectorStats &other);
   
   void AccStatsForUtterance(const IvectorExtractor &extractor,
@@ -512,8 +565,8 @@ class IvectorStats {
   std::vector< SpMatrix<double> > S_;
 
 
-  /// This mutex guards num_ivectors_, ivector_sum_ and ivector_scatter_ (for multi-threaded
-  /// update)
+  /// This mutex guards tot_auxf_, num_ivectors_, ivector_sum_ and
+  /// ivector_scatter_ (for multi-threaded update)
   Mutex prior_stats_lock_;
 
   /// Count of the number of iVectors we trained on.   Need for prior re-estimation.
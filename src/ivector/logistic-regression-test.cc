@@ -19,6 +19,7 @@
 
 #include <time.h>
 #include "ivector/logistic-regression.h"
+#include "thread/kaldi-thread.h"
 
 namespace kaldi {
 
@@ -64,6 +65,57 @@ void UnitTestPosteriors() {
   KALDI_ASSERT(log_posteriors.ApproxEqual(batch_log_posteriors, tolerance));
 }
 
+// Compares GetObjfAndGrad() with a simple version of it, with several
+// mixture components per class and different numbers of threads.
+void UnitTestObjfAndGrad() {
+  int32 n_features = rand() % 100 + 10,
+        n_xs = rand() % 200 + 100,
+        n_labels = rand() % 10 + 2,
+        n_mixes = n_labels + rand() % 10;
+  BaseFloat normalizer = 0.01;
+  Matrix<BaseFloat> xs(n_xs, n_features);
+  xs.SetRandn();
+  std::vector<int32> ys, classes;
+  for (int32 i = 0; i < n_xs; i++)
+    ys.push_back(rand() % n_labels);
+  for (int32 j = 0; j < n_mixes; j++)
+    classes.push_back(j < n_labels ? j : rand() % n_labels);
+  Matrix<BaseFloat> weights(n_mixes, n_features);
+  weights.SetRandn();
+  LogisticRegression classifier;
+  classifier.SetWeights(weights, classes);
+  Matrix<BaseFloat> xw(n_xs, n_mixes);
+  xw.AddMatMat(1.0, xs, kNoTrans, weights, kTrans, 0.0);
+
+  double ref_objf = 0.0;
+  Matrix<BaseFloat> ref_grad(n_mixes, n_features);
+  for (int32 i = 0; i < n_xs; i++) {
+    Vector<BaseFloat> row(xw.Row(i));
+    row.ApplySoftMax();
+    BaseFloat class_sum = 0.0;
+    for (int32 j = 0; j < n_mixes; j++)
+      if (classes[j] == ys[i]) class_sum += row(j);
+    if (class_sum < 1.0e-20) class_sum = 1.0e-20;  // as GetObjfAndGrad() does.
+    ref_objf += std::log(class_sum);
+    for (int32 j = 0; j < n_mixes; j++)
+      ref_grad.Row(j).AddVec((classes[j] == ys[i] ? row(j) / class_sum : 0.0)
+                             - row(j), xs.Row(i));
+  }
+  ref_grad.Scale(1.0 / n_xs);
+  ref_grad.AddMat(-normalizer, weights);
+  ref_objf = ref_objf / n_xs - 0.5 * normalizer *
+      TraceMatMat(weights, weights, kTrans);
+
+  int32 saved_num_threads = g_num_threads;
+  for (g_num_threads = 1; g_num_threads <= 4; g_num_threads++) {
+    Matrix<BaseFloat> grad(n_mixes, n_features);
+    BaseFloat objf = classifier.GetObjfAndGrad(xs, ys, xw, &grad, normalizer);
+    KALDI_ASSERT(ApproxEqual(objf, ref_objf));
+    KALDI_ASSERT(grad.ApproxEqual(ref_grad, 1.0e-04));
+  }
+  g_num_threads = saved_num_threads;
+}
+
 void UnitTestTrain() {
 
   int32 n_features = rand() % 600 + 10,
@@ -89,12 +141,14 @@ void UnitTestTrain() {
   // the x vectors: a 1.0 which handles the prior.
   Matrix<BaseFloat> xs_with_prior(n_xs, n_features + 1);
   for (int32 i = 0; i < n_xs; i++) {
-    xs_with_prior(i, n_xs) = 1.0;
+    xs_with_prior(i, n_features) = 1.0;
   }
   SubMatrix<BaseFloat> sub_xs(xs_with_prior, 0, n_xs, 0, n_features);
   sub_xs.CopyFromMat(xs);
 
-  Matrix<BaseFloat> xw(n_xs, n_labels);
+  // The classifier only has as many classes as the largest label seen.
+  int32 n_classes = classifier.weights_.NumRows();
+  Matrix<BaseFloat> xw(n_xs, n_classes);
   xw.AddMatMat(1.0, xs_with_prior, kNoTrans, classifier.weights_, 
                kTrans, 0.0);
 
@@ -105,11 +159,11 @@ void UnitTestTrain() {
                                                   ys, xw, &grad, normalizer);
 
   // Calculate objective function using a random weight matrix.
-  Matrix<BaseFloat> xw_rand(n_xs, n_labels);
+  Matrix<BaseFloat> xw_rand(n_xs, n_classes);
   
   Matrix<BaseFloat> weights_rand(classifier.weights_);
   weights_rand.SetRandn();
-  xw.AddMatMat(1.0, xs_with_prior, kNoTrans, weights_rand, 
+  xw_rand.AddMatMat(1.0, xs_with_prior, kNoTrans, weights_rand, 
                kTrans, 0.0);
 
   // Verify that the objective function after training is better
@@ -126,5 +180,6 @@ int main() {
   srand (time(NULL));
   UnitTestTrain();
   UnitTestPosteriors();
+  UnitTestObjfAndGrad();
   return 0;
 }
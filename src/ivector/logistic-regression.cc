@@ -20,6 +20,7 @@
 
 #include "ivector/logistic-regression.h"
 #include "gmm/model-common.h" // For GetSplitTargets()
+#include "thread/kaldi-thread.h"
 #include <numeric> // For std::accumulate
 
 namespace kaldi {
@@ -137,6 +138,28 @@ void LogisticRegression::TrainParameters(const Matrix<BaseFloat> &xs,
   weights_.CopyRowsFromVec(best_w);
 }
 
+// Computes the log posteriors of the classes from the scores "xw" of the
+// mixture components, whose classes are "classes":
+//   log p(c|x) = log sum_{j in c} exp(xw_j) - log sum_j exp(xw_j).
+// The first sum is done as a log-sum-exp for each class, so it cannot
+// overflow or underflow.
+static void ComputeClassLogPosteriors(const VectorBase<BaseFloat> &xw,
+                                      const std::vector<int32> &classes,
+                                      VectorBase<BaseFloat> *log_posteriors) {
+  int32 num_mixes = xw.Dim(), num_classes = log_posteriors->Dim();
+  Vector<BaseFloat> class_max(num_classes);
+  class_max.Set(-std::numeric_limits<BaseFloat>::infinity());
+  for (int32 j = 0; j < num_mixes; j++)
+    class_max(classes[j]) = std::max(class_max(classes[j]), xw(j));
+  Vector<BaseFloat> class_sum(num_classes);
+  for (int32 j = 0; j < num_mixes; j++)
+    class_sum(classes[j]) += std::exp(xw(j) - class_max(classes[j]));
+  BaseFloat tot_log_sum = xw.LogSumExp();
+  for (int32 k = 0; k < num_classes; k++)
+    (*log_posteriors)(k) = class_max(k) + std::log(class_sum(k)) -
+        tot_log_sum;
+}
+
 void LogisticRegression::GetLogPosteriors(const Matrix<BaseFloat> &xs,
                                        Matrix<BaseFloat> *log_posteriors) {
   int32 xs_num_rows = xs.NumRows(),
@@ -160,16 +183,8 @@ void LogisticRegression::GetLogPosteriors(const Matrix<BaseFloat> &xs,
 
   // training example i
   for (int32 i = 0; i < xs_num_rows; i++) {
-    for (int32 j = 0; j < num_mixes; j++) {
-      // The actual classes k
-      for (int32 k = 0; k < num_classes; k++) {
-        if (k == class_[j]) {
-          (*log_posteriors)(i,k) += std::exp(xw(i,j));
-        }
-      }
-    }
-    log_posteriors->Row(i).ApplyLog();
-    log_posteriors->Row(i).Add(-xw.Row(i).LogSumExp());
+    SubVector<BaseFloat> log_post(*log_posteriors, i);
+    ComputeClassLogPosteriors(xw.Row(i), class_, &log_post);
   }
 }
 
@@ -187,15 +202,7 @@ void LogisticRegression::GetLogPosteriors(const Vector<BaseFloat> &x,
   x_with_prior(x_dim) = 1.0;
   
   xw.AddMatVec(1.0, weights_, kNoTrans, x_with_prior, kNoTrans);
-  for (int32 i = 0; i < xw.Dim(); i++) {
-    for (int j = 0; j < num_classes; j++) {
-      if (j == class_[i]) {
-        (*log_posteriors)(j) += std::exp(xw(i));
-      }
-    }
-  }
-  log_posteriors->ApplyLog();
-  log_posteriors->Add(-xw.LogSumExp());
+  ComputeClassLogPosteriors(xw, class_, log_posteriors);
 }
 
 BaseFloat LogisticRegression::DoStep(const Matrix<BaseFloat> &xs,
@@ -227,45 +234,76 @@ BaseFloat LogisticRegression::DoStep(const Matrix<BaseFloat> &xs,
   return objf;
 }
 
+// This class is used with RunParallelFor() in GetObjfAndGrad(): each copy
+// computes the objective function and gradient for a range of the training
+// examples, and its destructor adds them to the totals.  RunParallelFor()
+// destroys the copies in order, so the result does not depend on the
+// timing of the threads.
+class LogisticRegressionObjfClass {
+ public:
+  LogisticRegressionObjfClass(const Matrix<BaseFloat> &xs,
+                              const std::vector<int32> &ys,
+                              const Matrix<BaseFloat> &xw,
+                              const std::vector<int32> &classes,
+                              double *tot_objf, Matrix<BaseFloat> *tot_grad):
+      xs_(&xs), ys_(&ys), xw_(&xw), classes_(&classes), objf_(0.0),
+      tot_objf_(tot_objf), tot_grad_(tot_grad) { }
+
+  void operator () (int32 begin, int32 end) {
+    const std::vector<int32> &classes = *classes_;
+    int32 num_rows = end - begin, num_mixes = classes.size();
+    // The derivative of the objective function w.r.t. xw, for these rows.
+    Matrix<BaseFloat> deriv(xw_->RowRange(begin, num_rows));
+    for (int32 i = 0; i < num_rows; i++) {
+      SubVector<BaseFloat> row(deriv, i);
+      row.ApplySoftMax();
+      int32 y = (*ys_)[begin + i];
+      BaseFloat class_sum = 0.0;
+      for (int32 k = 0; k < num_mixes; k++)
+        if (classes[k] == y) class_sum += row(k);
+      if (class_sum < 1.0e-20) class_sum = 1.0e-20;
+      objf_ += std::log(class_sum);
+      // p(y = k | x_i) where k is a component; if the classes aren't split
+      // into mixture components then p/class_sum = 1.0 for the right class.
+      for (int32 k = 0; k < num_mixes; k++) {
+        BaseFloat p = row(k);
+        row(k) = (classes[k] == y ? p / class_sum - p : -p);
+      }
+    }
+    grad_.Resize(num_mixes, xs_->NumCols());
+    grad_.AddMatMat(1.0, deriv, kTrans, xs_->RowRange(begin, num_rows),
+                    kNoTrans, 0.0);
+  }
+
+  ~LogisticRegressionObjfClass() {
+    if (grad_.NumRows() != 0) {
+      *tot_objf_ += objf_;
+      tot_grad_->AddMat(1.0, grad_);
+    }
+  }
+ private:
+  const Matrix<BaseFloat> *xs_;
+  const std::vector<int32> *ys_;
+  const Matrix<BaseFloat> *xw_;
+  const std::vector<int32> *classes_;
+  double objf_;
+  Matrix<BaseFloat> grad_;
+  double *tot_objf_;
+  Matrix<BaseFloat> *tot_grad_;
+};
+
 BaseFloat LogisticRegression::GetObjfAndGrad(
     const Matrix<BaseFloat> &xs,
     const std::vector<int32> &ys, const Matrix<BaseFloat> &xw,
     Matrix<BaseFloat> *grad, BaseFloat normalizer) {
-  BaseFloat raw_objf = 0.0;
-  int32 num_classes = *std::max_element(ys.begin(), ys.end()) + 1;
-  std::vector< std::vector<int32> > class_to_cols(num_classes, std::vector<int32>());
-  for (int32 i = 0; i < class_.size(); i++) {
-    class_to_cols[class_[i]].push_back(i);
-  }
-  // For each training example class
-  for (int32 i = 0; i < ys.size(); i++) {
-    Vector<BaseFloat> row(xw.NumCols());
-    row.CopyFromVec(xw.Row(i));
-    row.ApplySoftMax();
-    // Identify the rows of weights_ (which are a set of columns in wx) 
-    // which correspond to class ys[i]
-    const std::vector<int32> &cols = class_to_cols[ys[i]];
-    SubVector<BaseFloat> x = xs.Row(i);
-    BaseFloat class_sum = 0.0;
-    for (int32 j = 0; j < cols.size(); j++) {
-      class_sum += row(cols[j]);
-    }
-    if (class_sum < 1.0e-20) class_sum = 1.0e-20;
-    raw_objf += std::log(class_sum);
-    // Iterate over weights for each component. If there are no
-    // mixtures each row corresponds to a class.
-    for (int32 k = 0; k < weights_.NumRows(); k++) {
-      // p(y = k | x_i) where k is a component.
-      BaseFloat p = row(k);
-      if (class_[k] == ys[i]) {
-        // If the classes aren't split into mixture components
-        // then p/class_sum = 1.0.
-        grad->Row(k).AddVec(p/class_sum - p, x);
-      } else {
-        grad->Row(k).AddVec(-1.0 * p, x);
-      }
-    }
-  }
+  // The gradient w.r.t. the weights is deriv^T xs, where deriv is the
+  // derivative w.r.t. xw; this is computed by blocks of rows of xs, in
+  // parallel, so most of the work is in matrix multiplications.
+  double raw_objf = 0.0;
+  int32 num_rows = ys.size();
+  LogisticRegressionObjfClass c(xs, ys, xw, class_, &raw_objf, grad);
+  RunParallelFor(0, num_rows, c);
+
   // Scale and add regularization term.
   grad->Scale(1.0/ys.size());
   grad->AddMat(-1.0 * normalizer, weights_);
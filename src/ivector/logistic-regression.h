@@ -73,6 +73,7 @@ class LogisticRegression {
  protected:
   void friend UnitTestTrain();
   void friend UnitTestPosteriors();
+  void friend UnitTestObjfAndGrad();
 
  private:
   // Performs a step in the L-BFGS. This is mostly used internally
@@ -94,8 +95,8 @@ class LogisticRegression {
              const LogisticRegressionConfig &conf);
 
   // Returns the objective function given the training data, xs, ys.
-  // The gradient is also calculated, and returned in grad. Uses
-  // L2 regularization.
+  // The gradient is also calculated, and added to grad. Uses
+  // L2 regularization.  Uses g_num_threads threads.
   BaseFloat GetObjfAndGrad(const Matrix<BaseFloat> &xs, 
                         const std::vector<int32> &ys, 
                         const Matrix<BaseFloat> &xw, 
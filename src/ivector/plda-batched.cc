@@ -0,0 +1,101 @@
+// ivector/plda-batched.cc
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <functional>
+#include "ivector/plda-batched.h"
+
+namespace kaldi {
+
+PldaBatchedScorer::PldaBatchedScorer(
+    const Plda &plda,
+    const MatrixBase<BaseFloat> &transformed_train_ivectors,
+    const std::vector<int32> &num_train_utts) {
+  int32 num_train = transformed_train_ivectors.NumRows(), dim = plda.Dim();
+  KALDI_ASSERT(transformed_train_ivectors.NumCols() == dim &&
+               static_cast<int32>(num_train_utts.size()) == num_train);
+  const Vector<double> &psi = plda.psi_;
+  Matrix<double> linear(num_train, dim, kUndefined),
+      quadratic(num_train, dim, kUndefined);
+  Vector<double> offset(num_train, kUndefined);
+  // The log-determinant of the variance I + Psi without the class.
+  Vector<double> variance_without(psi);
+  variance_without.Add(1.0);
+  double logdet_without = variance_without.SumLog();
+  for (int32 i = 0; i < num_train; i++) {
+    int32 n = num_train_utts[i];
+    KALDI_ASSERT(n > 0);
+    double logdet_given = 0.0, sq_term = 0.0;
+    for (int32 d = 0; d < dim; d++) {
+      double a = n * psi(d) / (n * psi(d) + 1.0),
+          c = 1.0 + psi(d) / (n * psi(d) + 1.0),
+          u = transformed_train_ivectors(i, d);
+      linear(i, d) = u * a / c;
+      quadratic(i, d) = -0.5 * (1.0 / c - 1.0 / variance_without(d));
+      logdet_given += log(c);
+      sq_term += a * a * u * u / c;
+    }
+    offset(i) = -0.5 * (logdet_given - logdet_without + sq_term);
+  }
+  linear_.Resize(num_train, dim, kUndefined);
+  linear_.CopyFromMat(linear);
+  quadratic_.Resize(num_train, dim, kUndefined);
+  quadratic_.CopyFromMat(quadratic);
+  offset_.Resize(num_train, kUndefined);
+  offset_.CopyFromVec(offset);
+}
+
+void PldaBatchedScorer::Score(
+    const CuMatrixBase<BaseFloat> &transformed_test_ivectors,
+    CuMatrix<BaseFloat> *scores) const {
+  KALDI_ASSERT(transformed_test_ivectors.NumCols() == linear_.NumCols());
+  CuMatrix<BaseFloat> test_sq(transformed_test_ivectors);
+  test_sq.ApplyPow(2.0);
+  scores->Resize(transformed_test_ivectors.NumRows(), NumTrain(), kUndefined);
+  scores->CopyRowsFromVec(offset_);
+  scores->AddMatMat(1.0, transformed_test_ivectors, kNoTrans,
+                    linear_, kTrans, 1.0);
+  scores->AddMatMat(1.0, test_sq, kNoTrans, quadratic_, kTrans, 1.0);
+}
+
+void PldaBatchedScorer::ScoreTopK(
+    const CuMatrixBase<BaseFloat> &transformed_test_ivectors,
+    int32 k,
+    std::vector<std::vector<std::pair<int32, BaseFloat> > > *best) const {
+  KALDI_ASSERT(k > 0);
+  CuMatrix<BaseFloat> cu_scores;
+  Score(transformed_test_ivectors, &cu_scores);
+  Matrix<BaseFloat> scores(cu_scores);
+  int32 num_test = scores.NumRows(), num_train = NumTrain(),
+      this_k = std::min(k, num_train);
+  best->resize(num_test);
+  std::vector<std::pair<BaseFloat, int32> > pairs(num_train);
+  for (int32 j = 0; j < num_test; j++) {
+    const BaseFloat *row = scores.RowData(j);
+    for (int32 i = 0; i < num_train; i++)
+      pairs[i] = std::make_pair(row[i], i);
+    std::partial_sort(pairs.begin(), pairs.begin() + this_k, pairs.end(),
+                      std::greater<std::pair<BaseFloat, int32> >());
+    std::vector<std::pair<int32, BaseFloat> > &this_best = (*best)[j];
+    this_best.resize(this_k);
+    for (int32 r = 0; r < this_k; r++)
+      this_best[r] = std::make_pair(pairs[r].second, pairs[r].first);
+  }
+}
+
+}  // namespace kaldi
@@ -0,0 +1,75 @@
+// ivector/plda-batched.h
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_IVECTOR_PLDA_BATCHED_H_
+#define KALDI_IVECTOR_PLDA_BATCHED_H_
+
+#include <utility>
+#include <vector>
+#include "ivector/plda.h"
+#include "cudamatrix/cu-matrix.h"
+#include "cudamatrix/cu-vector.h"
+
+namespace kaldi {
+
+/// This class computes PLDA log-likelihood ratios between a fixed set of
+/// "train" (enrollment) iVectors and batches of test iVectors, all pairs at
+/// once.  Because Plda works in a space where the within-class covariance is
+/// unit and the between-class covariance Psi is diagonal, the log-likelihood
+/// ratio for train iVector u (averaged over n utterances) and test iVector v is
+///   sum_d  v_d u_d a_d / c_d  - 0.5 v_d^2 (1/c_d - 1/(1 + psi_d)) + const(u, n),
+/// with a_d = n psi_d / (n psi_d + 1) and c_d = 1 + psi_d / (n psi_d + 1).
+/// So the whole matrix of scores is two matrix multiplications, done on the
+/// GPU if one is in use.  The results match Plda::LogLikelihoodRatio() to
+/// within single-precision roundoff.
+class PldaBatchedScorer {
+ public:
+  /// Each row of "transformed_train_ivectors" is a train iVector that has been
+  /// transformed by Plda::TransformIvector(); num_train_utts[i] is the number
+  /// of utterances that train iVector i was averaged over.
+  PldaBatchedScorer(const Plda &plda,
+                    const MatrixBase<BaseFloat> &transformed_train_ivectors,
+                    const std::vector<int32> &num_train_utts);
+
+  int32 NumTrain() const { return linear_.NumRows(); }
+
+  /// Sets (*scores)(j, i) to the log-likelihood ratio between train iVector i
+  /// and row j of "transformed_test_ivectors", i.e. what
+  /// Plda::LogLikelihoodRatio(train_i, num_train_utts[i], test_j) would
+  /// return.  "scores" is resized to (num-test, num-train).
+  void Score(const CuMatrixBase<BaseFloat> &transformed_test_ivectors,
+             CuMatrix<BaseFloat> *scores) const;
+
+  /// For each row j of "transformed_test_ivectors", outputs in (*best)[j] the
+  /// min(k, NumTrain()) train iVectors with the highest scores, as (train
+  /// index, score) pairs, from best to worst.
+  void ScoreTopK(const CuMatrixBase<BaseFloat> &transformed_test_ivectors,
+                 int32 k,
+                 std::vector<std::vector<std::pair<int32, BaseFloat> > > *best)
+      const;
+
+ private:
+  CuMatrix<BaseFloat> linear_;  // [num-train][dim]; u_d a_d / c_d.
+  CuMatrix<BaseFloat> quadratic_;  // [num-train][dim]; -0.5 (1/c_d - 1/(1+psi_d)).
+  CuVector<BaseFloat> offset_;  // [num-train]; the terms not involving v.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(PldaBatchedScorer);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_IVECTOR_PLDA_BATCHED_H_
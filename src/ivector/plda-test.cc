@@ -16,10 +16,49 @@
 // limitations under the License.
 
 #include "ivector/plda.h"
+#include "ivector/plda-batched.h"
 
 
 namespace kaldi {
 
+// Checks that PldaBatchedScorer gives the same scores as
+// Plda::LogLikelihoodRatio().
+void UnitTestPldaBatchedScorer(Plda &plda) {
+  int32 dim = plda.Dim(), num_train = 1 + rand() % 10,
+      num_test = 1 + rand() % 10;
+  Matrix<BaseFloat> train(num_train, dim), test(num_test, dim);
+  train.SetRandn();
+  test.SetRandn();
+  std::vector<int32> num_train_utts(num_train);
+  for (int32 i = 0; i < num_train; i++)
+    num_train_utts[i] = 1 + rand() % 10;
+  PldaBatchedScorer scorer(plda, train, num_train_utts);
+  CuMatrix<BaseFloat> cu_test(test), cu_scores;
+  scorer.Score(cu_test, &cu_scores);
+  Matrix<BaseFloat> scores(cu_scores);
+  for (int32 j = 0; j < num_test; j++) {
+    for (int32 i = 0; i < num_train; i++) {
+      double score = plda.LogLikelihoodRatio(Vector<double>(train.Row(i)),
+                                             num_train_utts[i],
+                                             Vector<double>(test.Row(j)));
+      AssertEqual(score, scores(j, i), 1.0e-03);
+    }
+  }
+  int32 k = 1 + rand() % 4;
+  std::vector<std::vector<std::pair<int32, BaseFloat> > > best;
+  scorer.ScoreTopK(cu_test, k, &best);
+  KALDI_ASSERT(best.size() == static_cast<size_t>(num_test));
+  for (int32 j = 0; j < num_test; j++) {
+    KALDI_ASSERT(best[j].size() ==
+                 static_cast<size_t>(std::min(k, num_train)));
+    BaseFloat max_score = scores.Row(j).Max();
+    KALDI_ASSERT(best[j][0].second == max_score &&
+                 scores(j, best[j][0].first) == max_score);
+    for (size_t r = 1; r < best[j].size(); r++)
+      KALDI_ASSERT(best[j][r].second <= best[j][r-1].second);
+  }
+}
+
 void UnitTestPldaEstimation(int32 dim) {
   int32 num_classes = 4000 + rand() % 10;
   Matrix<double> between_proj(dim, dim);
@@ -58,7 +97,6 @@ void UnitTestPldaEstimation(int32 dim) {
   between_var.AddMat2(1.0, between_proj, kNoTrans, 0.0);
   within_var.AddMat2(1.0, within_proj, kNoTrans, 0.0);
 
-  stats.Sort();
   PldaEstimator estimator(stats);
   Plda plda;
   PldaEstimationConfig config;
@@ -81,7 +119,7 @@ void UnitTestPldaEstimation(int32 dim) {
     KALDI_LOG << "Diagonal of between-class variance in normalized space "
               << "should be: " << s;
   }
-  
+  UnitTestPldaBatchedScorer(plda);
 }
 
 }
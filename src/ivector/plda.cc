@@ -203,35 +203,33 @@ void PldaStats::AddSamples(double weight,
     KALDI_ASSERT(dim_ == group.NumCols());
   }
   int32 n = group.NumRows(); // number of examples for this class
-  Vector<double> *mean = new Vector<double>(dim_);
-  mean->AddRowSumMat(1.0 / n, group);
+  Vector<double> mean(dim_);
+  mean.AddRowSumMat(1.0 / n, group);
 
   offset_scatter_.AddMat2(weight, group, kTrans, 1.0);
   // the following statement has the same effect as if we
   // had first subtracted the mean from each element of
   // the group before the statement above.
-  offset_scatter_.AddVec2(-n * weight, *mean);
+  offset_scatter_.AddVec2(-n * weight, mean);
 
-  class_info_.push_back(ClassInfo(weight, mean, n));
+  ClassGroupStats *&class_group = class_groups_[n];
+  if (class_group == NULL) class_group = new ClassGroupStats(dim_);
+  class_group->weight += weight;
+  class_group->mean_sum.AddVec(weight, mean);
+  class_group->mean_scatter.AddVec2(weight, mean);
 
   num_classes_ ++;
   num_examples_ += n;
   class_weight_ += weight;
   example_weight_ += weight * n;
 
-  sum_.AddVec(weight, *mean);
+  sum_.AddVec(weight, mean);
 }
 
 PldaStats::~PldaStats() {
-  for (size_t i = 0; i < class_info_.size(); i++)
-    delete class_info_[i].mean;
-}
-
-bool PldaStats::IsSorted() const {
-  for (size_t i = 0; i + 1 < class_info_.size(); i++)
-    if (class_info_[i+1] < class_info_[i])
-      return false;
-  return true;
+  for (std::map<int32, ClassGroupStats*>::iterator iter =
+           class_groups_.begin(); iter != class_groups_.end(); ++iter)
+    delete iter->second;
 }
 
 void PldaStats::Init(int32 dim) {
@@ -243,13 +241,31 @@ void PldaStats::Init(int32 dim) {
   example_weight_ = 0.0;
   sum_.Resize(dim);
   offset_scatter_.Resize(dim);
-  KALDI_ASSERT(class_info_.empty());  
+  KALDI_ASSERT(class_groups_.empty());
 }
 
 
 PldaEstimator::PldaEstimator(const PldaStats &stats):
     stats_(stats) {
-  KALDI_ASSERT(stats.IsSorted());
+  // Get the scatter of each group of class means around the global mean,
+  // using sum_i w_i (x_i - mu)(x_i - mu)^T
+  //   = sum_i w_i x_i x_i^T - s mu^T - mu s^T + w mu mu^T,
+  // where s = sum_i w_i x_i and w = sum_i w_i.
+  Vector<double> global_mean(stats.sum_);
+  if (stats.class_weight_ != 0.0)
+    global_mean.Scale(1.0 / stats.class_weight_);
+  class_groups_.resize(stats.class_groups_.size());
+  std::map<int32, PldaStats::ClassGroupStats*>::const_iterator iter =
+      stats.class_groups_.begin();
+  for (size_t g = 0; g < class_groups_.size(); g++, ++iter) {
+    const PldaStats::ClassGroupStats &group_stats = *(iter->second);
+    ClassGroup &group = class_groups_[g];
+    group.num_examples = iter->first;
+    group.weight = group_stats.weight;
+    group.scatter = group_stats.mean_scatter;
+    group.scatter.AddVecVec(-1.0, group_stats.mean_sum, global_mean);
+    group.scatter.AddVec2(group_stats.weight, global_mean);
+  }
   InitParameters();
 }
 
@@ -277,24 +293,21 @@ double PldaEstimator::ComputeObjfPart1() const {
 double PldaEstimator::ComputeObjfPart2() const {
   double tot_objf = 0.0;
   
-  int32 n = -1; // the number of examples for the current class
   SpMatrix<double> combined_inv_var(Dim());
   // combined_inv_var = (between_var_ + within_var_ / n)^{-1}
   double combined_var_logdet;
   
-  for (size_t i = 0; i < stats_.class_info_.size(); i++) {
-    const ClassInfo &info = stats_.class_info_[i];
-    if (info.num_examples != n) {
-      n = info.num_examples;
-      // variance of mean of n examples is between-class + 1/n * within-class
-      combined_inv_var.CopyFromSp(between_var_);
-      combined_inv_var.AddSp(1.0 / n, within_var_);
-      combined_inv_var.Invert(&combined_var_logdet);
-    }
-    Vector<double> mean (*(info.mean));
-    mean.AddVec(-1.0 / stats_.class_weight_, stats_.sum_);
-    tot_objf += info.weight * -0.5 * (combined_var_logdet + M_LOG_2PI * Dim()
-                                      + VecSpVec(mean, combined_inv_var, mean));
+  for (size_t g = 0; g < class_groups_.size(); g++) {
+    const ClassGroup &group = class_groups_[g];
+    int32 n = group.num_examples;
+    // variance of mean of n examples is between-class + 1/n * within-class
+    combined_inv_var.CopyFromSp(between_var_);
+    combined_inv_var.AddSp(1.0 / n, within_var_);
+    combined_inv_var.Invert(&combined_var_logdet);
+    // the sum over classes of weight * mean^T combined_inv_var mean is
+    // tr(combined_inv_var * scatter).
+    tot_objf += -0.5 * (group.weight * (combined_var_logdet + M_LOG_2PI * Dim())
+                        + TraceSpSp(combined_inv_var, group.scatter));
   }
   return tot_objf;
 }
@@ -377,6 +390,12 @@ void PldaEstimator::GetStatsFromIntraClass() {
     The drawback of this formulation is that each time we encounter a different
     value of n (number of examples) we will have to do a different matrix
     inversion.  We'll try to improve on this later using a suitable transform.
+
+    Since w = A m with A = (between_var^{-1} + n within_var^{-1})^{-1} n within_var^{-1},
+    which only depends on n, the sum of the w w^T terms over the classes with n
+    examples is A S A^T, where S is the weighted sum of m m^T over those
+    classes; similarly the sum of the (m-w) (m-w)^T terms is (I-A) S (I-A)^T.
+    So we only need S for each n, not the individual class means.
  */
 
 void PldaEstimator::GetStatsFromClassMeans() {
@@ -386,30 +405,24 @@ void PldaEstimator::GetStatsFromClassMeans() {
   within_var_inv.Invert();
   // mixed_var will equal (between_var^{-1} + n within_var^{-1})^{-1}.
   SpMatrix<double> mixed_var(Dim()); 
-  int32 n = -1; // the current number of examples for the class.
-
-  for (size_t i = 0; i < stats_.class_info_.size(); i++) {
-    const ClassInfo &info = stats_.class_info_[i];
-    double weight = info.weight;
-    if (info.num_examples != n) {
-      n = info.num_examples;
-      mixed_var.CopyFromSp(between_var_inv);
-      mixed_var.AddSp(n, within_var_inv);
-      mixed_var.Invert();
-    }
-    Vector<double> m = *(info.mean); // the mean for this class.
-    m.AddVec(-1.0 / stats_.class_weight_, stats_.sum_); // remove global mean
-    Vector<double> temp(Dim()); // n within_var^{-1} m
-    temp.AddSpVec(n, within_var_inv, m, 0.0);
-    Vector<double> w(Dim()); // w, as defined in the comment.
-    w.AddSpVec(1.0, mixed_var, temp, 0.0);
-    Vector<double> m_w(m); // m - w
-    m_w.AddVec(-1.0, w);
+  Matrix<double> proj(Dim(), Dim()), // A as defined in the comment.
+      offset_proj(Dim(), Dim()); // I - A.
+
+  for (size_t g = 0; g < class_groups_.size(); g++) {
+    const ClassGroup &group = class_groups_[g];
+    int32 n = group.num_examples;
+    double weight = group.weight;
+    mixed_var.CopyFromSp(between_var_inv);
+    mixed_var.AddSp(n, within_var_inv);
+    mixed_var.Invert();
+    proj.AddSpSp(n, mixed_var, within_var_inv, 0.0);
+    offset_proj.SetUnit();
+    offset_proj.AddMat(-1.0, proj);
     between_var_stats_.AddSp(weight, mixed_var);
-    between_var_stats_.AddVec2(weight, w);
+    between_var_stats_.AddMat2Sp(1.0, proj, kNoTrans, group.scatter, 1.0);
     between_var_count_ += weight;
     within_var_stats_.AddSp(weight * n, mixed_var);
-    within_var_stats_.AddVec2(weight * n, m_w);
+    within_var_stats_.AddMat2Sp(n, offset_proj, kNoTrans, group.scatter, 1.0);
     within_var_count_ += weight;
   }
 }
@@ -21,6 +21,7 @@
 
 #include <vector>
 #include <algorithm>
+#include <map>
 #include "base/kaldi-common.h"
 #include "matrix/matrix-lib.h"
 #include "gmm/model-common.h"
@@ -115,6 +116,7 @@ class Plda {
  protected:
   void ComputeDerivedVars(); // computes offset_.
   friend class PldaEstimator;
+  friend class PldaBatchedScorer;
   
   Vector<double> mean_;  // mean of samples in original space.
   Matrix<double> transform_; // of dimension FeatureDim() by FeatureDim();
@@ -156,8 +158,6 @@ class PldaStats {
 
   void Init(int32 dim);
 
-  void Sort() { std::sort(class_info_.begin(), class_info_.end()); }
-  bool IsSorted() const;
   ~PldaStats();
  protected:
   
@@ -174,21 +174,20 @@ class PldaStats {
 
   SpMatrix<double> offset_scatter_; // Sum over all examples, of the weight
                                     // times (example - class-mean).
-  
-  // We have one of these objects per class.
-  struct ClassInfo {
-    double weight;
-    Vector<double> *mean; // owned here, but as a pointer so
-                          // sort can be lightweight
-    int32 num_examples; // the number of examples in the class
-    bool operator < (const ClassInfo &other) const {
-      return (num_examples < other.num_examples);
-    }
-    ClassInfo(double weight, Vector<double> *mean, int32 num_examples):
-        weight(weight), mean(mean), num_examples(num_examples) { }
+
+  // The estimation only depends on the class means through these stats,
+  // which we keep for each distinct number of examples per class; so the
+  // memory used does not grow with the number of classes.
+  struct ClassGroupStats {
+    double weight; // total weight of the classes with this many examples.
+    Vector<double> mean_sum; // weighted sum of their means.
+    SpMatrix<double> mean_scatter; // weighted sum of mean * mean^T.
+    ClassGroupStats(int32 dim): weight(0.0), mean_sum(dim),
+                                mean_scatter(dim) { }
   };
-   
-  std::vector<ClassInfo> class_info_;
+
+  // Indexed by the number of examples in the class; owns the pointers.
+  std::map<int32, ClassGroupStats*> class_groups_;
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(PldaStats);
 };
@@ -211,8 +210,15 @@ class PldaEstimator {
   void Estimate(const PldaEstimationConfig &config,
                 Plda *output);
 private:
-  typedef PldaStats::ClassInfo ClassInfo;
-  
+  // Stats of the class means for one number of examples per class, with the
+  // global mean removed; computed from PldaStats::class_groups_.
+  struct ClassGroup {
+    int32 num_examples;
+    double weight; // total weight of these classes.
+    SpMatrix<double> scatter; // weighted sum of m m^T, where m is a class
+                              // mean minus the global mean.
+  };
+    
   /// Returns the part of the objf relating to
   /// offsets from the class means.  (total, not normalized)
   double ComputeObjfPart1() const;
@@ -246,6 +252,8 @@ private:
   
   const PldaStats &stats_;
 
+  std::vector<ClassGroup> class_groups_;
+
   SpMatrix<double> within_var_;
   SpMatrix<double> between_var_;
 
@@ -0,0 +1,130 @@
+// ivector/score-histogram-test.cc
+
+// Copyright 2026  agent
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include "ivector/score-histogram.h"
+
+
+namespace kaldi {
+
+// Computes the miss and false-alarm rates directly from the lists of scores,
+// with the threshold at "threshold".
+static void BruteForceErrorRates(const std::vector<BaseFloat> &target_scores,
+                                 const std::vector<BaseFloat> &nontarget_scores,
+                                 BaseFloat threshold,
+                                 double *miss_rate, double *fa_rate) {
+  int32 num_miss = 0, num_fa = 0;
+  for (size_t i = 0; i < target_scores.size(); i++)
+    if (target_scores[i] < threshold) num_miss++;
+  for (size_t i = 0; i < nontarget_scores.size(); i++)
+    if (nontarget_scores[i] >= threshold) num_fa++;
+  *miss_rate = num_miss * 1.0 / target_scores.size();
+  *fa_rate = num_fa * 1.0 / nontarget_scores.size();
+}
+
+void UnitTestScoreHistogram() {
+  std::vector<BaseFloat> target_scores, nontarget_scores;
+  int32 num_target = 1 + rand() % 100, num_nontarget = 1 + rand() % 1000;
+  for (int32 i = 0; i < num_target; i++)
+    target_scores.push_back(2.0 + RandGauss());
+  for (int32 i = 0; i < num_nontarget; i++)
+    nontarget_scores.push_back(RandGauss());
+
+  ScoreHistogram hist, hist1, hist2;
+  for (int32 i = 0; i < num_target; i++)
+    hist.AddScore(target_scores[i], true);
+  for (int32 i = 0; i < num_nontarget; i++) {
+    hist.AddScore(nontarget_scores[i], false);
+    (i % 2 == 0 ? hist1 : hist2).AddScore(nontarget_scores[i], false);
+  }
+  for (int32 i = 0; i < num_target; i++)
+    (i % 2 == 0 ? hist1 : hist2).AddScore(target_scores[i], true);
+  hist1.Add(hist2);
+
+  // The EER is where the two error rates (as functions of the threshold)
+  // cross; with exact bins, the rates at the threshold it returns must be
+  // within one trial of each other's crossing point.
+  BaseFloat threshold, threshold1;
+  BaseFloat eer = hist.ComputeEer(&threshold),
+      eer1 = hist1.ComputeEer(&threshold1);
+  AssertEqual(eer, eer1);
+  AssertEqual(threshold, threshold1);
+  double miss_rate, fa_rate;
+  BruteForceErrorRates(target_scores, nontarget_scores, threshold,
+                       &miss_rate, &fa_rate);
+  AssertEqual(eer, 0.5 * (miss_rate + fa_rate), 1.0e-05);
+  KALDI_ASSERT(std::abs(miss_rate - fa_rate) <=
+               1.0 / num_target + 1.0 / num_nontarget + 1.0e-05);
+
+  // minDCF: no threshold at any of the scores should do better.
+  DcfOptions opts;
+  opts.p_target = 0.05;
+  BaseFloat dcf_threshold, min_dcf = hist.ComputeMinDcf(opts, &dcf_threshold);
+  double norm = std::min<double>(opts.c_miss * opts.p_target,
+                                 opts.c_fa * (1.0 - opts.p_target));
+  BruteForceErrorRates(target_scores, nontarget_scores, dcf_threshold,
+                       &miss_rate, &fa_rate);
+  AssertEqual(min_dcf, (opts.c_miss * opts.p_target * miss_rate +
+                        opts.c_fa * (1.0 - opts.p_target) * fa_rate) / norm,
+              1.0e-04);
+  for (int32 i = 0; i < num_target + num_nontarget; i++) {
+    BaseFloat t = (i < num_target ? target_scores[i] :
+                   nontarget_scores[i - num_target]);
+    BruteForceErrorRates(target_scores, nontarget_scores, t,
+                         &miss_rate, &fa_rate);
+    BaseFloat dcf = (opts.c_miss * opts.p_target * miss_rate +
+                     opts.c_fa * (1.0 - opts.p_target) * fa_rate) / norm;
+    KALDI_ASSERT(dcf >= min_dcf - 1.0e-04);
+  }
+
+  // With a coarse resolution the answers are only approximate.
+  ScoreHistogram coarse_hist(0.01);
+  for (int32 i = 0; i < num_target; i++)
+    coarse_hist.AddScore(target_scores[i], true);
+  for (int32 i = 0; i < num_nontarget; i++)
+    coarse_hist.AddScore(nontarget_scores[i], false);
+  BaseFloat coarse_threshold;
+  BaseFloat coarse_eer = coarse_hist.ComputeEer(&coarse_threshold);
+  KALDI_LOG << "EER is " << eer << " at threshold " << threshold
+            << "; with resolution 0.01, " << coarse_eer << " at "
+            << coarse_threshold << "; minDCF is " << min_dcf;
+
+  // Write and read.
+  for (int32 i = 0; i < 2; i++) {
+    bool binary = (i == 0);
+    std::ostringstream os;
+    coarse_hist.Write(os, binary);
+    ScoreHistogram hist_read;
+    std::istringstream is(os.str());
+    hist_read.Read(is, binary);
+    AssertEqual(hist_read.NumTarget(), coarse_hist.NumTarget());
+    AssertEqual(hist_read.NumNontarget(), coarse_hist.NumNontarget());
+    BaseFloat read_threshold;
+    AssertEqual(hist_read.ComputeEer(&read_threshold), coarse_eer);
+    AssertEqual(read_threshold, coarse_threshold);
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int i = 0; i < 10; i++)
+    UnitTestScoreHistogram();
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -0,0 +1,170 @@
+// ivector/score-histogram.cc
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <limits>
+#include <vector>
+#include "ivector/score-histogram.h"
+
+namespace kaldi {
+
+void ScoreHistogram::AddScore(BaseFloat score, bool is_target, double count) {
+  if (resolution_ > 0.0)
+    score = static_cast<BaseFloat>(std::floor(score / resolution_) *
+                                   resolution_);
+  std::pair<double, double> &counts = bins_[score];
+  if (is_target) {
+    counts.first += count;
+    num_target_ += count;
+  } else {
+    counts.second += count;
+    num_nontarget_ += count;
+  }
+}
+
+void ScoreHistogram::Add(const ScoreHistogram &other) {
+  if (other.resolution_ != resolution_)
+    KALDI_ERR << "Adding score histograms with different resolutions "
+              << resolution_ << " vs. " << other.resolution_;
+  std::map<BaseFloat, std::pair<double, double> >::const_iterator
+      iter = other.bins_.begin(), end = other.bins_.end();
+  for (; iter != end; ++iter) {
+    std::pair<double, double> &counts = bins_[iter->first];
+    counts.first += iter->second.first;
+    counts.second += iter->second.second;
+  }
+  num_target_ += other.num_target_;
+  num_nontarget_ += other.num_nontarget_;
+}
+
+void ScoreHistogram::GetErrorRates(std::vector<BaseFloat> *thresholds,
+                                   std::vector<double> *miss_rates,
+                                   std::vector<double> *fa_rates) const {
+  if (num_target_ <= 0.0 || num_nontarget_ <= 0.0)
+    KALDI_ERR << "Need both target and non-target scores to compute error "
+              << "rates (have " << num_target_ << " target and "
+              << num_nontarget_ << " non-target).";
+  thresholds->clear();
+  miss_rates->clear();
+  fa_rates->clear();
+  // With the threshold at a bin, the targets below it are missed and the
+  // non-targets at or above it are false alarms.
+  double targets_below = 0.0, nontargets_below = 0.0;
+  std::map<BaseFloat, std::pair<double, double> >::const_iterator
+      iter = bins_.begin(), end = bins_.end();
+  for (; iter != end; ++iter) {
+    thresholds->push_back(iter->first);
+    miss_rates->push_back(targets_below / num_target_);
+    fa_rates->push_back(1.0 - nontargets_below / num_nontarget_);
+    targets_below += iter->second.first;
+    nontargets_below += iter->second.second;
+  }
+  thresholds->push_back(std::numeric_limits<BaseFloat>::infinity());
+  miss_rates->push_back(1.0);
+  fa_rates->push_back(0.0);
+}
+
+BaseFloat ScoreHistogram::ComputeEer(BaseFloat *threshold) const {
+  std::vector<BaseFloat> thresholds;
+  std::vector<double> miss_rates, fa_rates;
+  GetErrorRates(&thresholds, &miss_rates, &fa_rates);
+  // The miss rate increases and the false-alarm rate decreases with the
+  // threshold; find where they cross, and take whichever of the two
+  // thresholds around the crossing has the closer rates.
+  size_t k = 0;
+  while (miss_rates[k] < fa_rates[k]) k++;  // stops at the last one at latest.
+  if (k > 0 && fa_rates[k-1] - miss_rates[k-1] < miss_rates[k] - fa_rates[k])
+    k--;
+  if (threshold != NULL) *threshold = thresholds[k];
+  return 0.5 * (miss_rates[k] + fa_rates[k]);
+}
+
+BaseFloat ScoreHistogram::ComputeMinDcf(const DcfOptions &opts,
+                                        BaseFloat *threshold) const {
+  KALDI_ASSERT(opts.p_target > 0.0 && opts.p_target < 1.0 &&
+               opts.c_miss > 0.0 && opts.c_fa > 0.0);
+  std::vector<BaseFloat> thresholds;
+  std::vector<double> miss_rates, fa_rates;
+  GetErrorRates(&thresholds, &miss_rates, &fa_rates);
+  double miss_cost = opts.c_miss * opts.p_target,
+      fa_cost = opts.c_fa * (1.0 - opts.p_target),
+      min_dcf = std::numeric_limits<double>::infinity();
+  size_t best_k = 0;
+  for (size_t k = 0; k < thresholds.size(); k++) {
+    double dcf = miss_cost * miss_rates[k] + fa_cost * fa_rates[k];
+    if (dcf < min_dcf) {
+      min_dcf = dcf;
+      best_k = k;
+    }
+  }
+  if (threshold != NULL) *threshold = thresholds[best_k];
+  return min_dcf / std::min(miss_cost, fa_cost);
+}
+
+void ScoreHistogram::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<ScoreHistogram>");
+  WriteToken(os, binary, "<Resolution>");
+  WriteBasicType(os, binary, resolution_);
+  WriteToken(os, binary, "<NumBins>");
+  int32 num_bins = bins_.size();
+  WriteBasicType(os, binary, num_bins);
+  if (!binary) os << "\n";
+  std::map<BaseFloat, std::pair<double, double> >::const_iterator
+      iter = bins_.begin(), end = bins_.end();
+  for (; iter != end; ++iter) {
+    WriteBasicType(os, binary, iter->first);
+    WriteBasicType(os, binary, iter->second.first);
+    WriteBasicType(os, binary, iter->second.second);
+    if (!binary) os << "\n";
+  }
+  WriteToken(os, binary, "</ScoreHistogram>");
+}
+
+void ScoreHistogram::Read(std::istream &is, bool binary, bool add) {
+  ExpectToken(is, binary, "<ScoreHistogram>");
+  ExpectToken(is, binary, "<Resolution>");
+  BaseFloat resolution;
+  ReadBasicType(is, binary, &resolution);
+  if (!add) {
+    resolution_ = resolution;
+    bins_.clear();
+    num_target_ = 0.0;
+    num_nontarget_ = 0.0;
+  } else if (resolution != resolution_) {
+    KALDI_ERR << "Adding score histograms with different resolutions "
+              << resolution_ << " vs. " << resolution;
+  }
+  ExpectToken(is, binary, "<NumBins>");
+  int32 num_bins;
+  ReadBasicType(is, binary, &num_bins);
+  KALDI_ASSERT(num_bins >= 0);
+  for (int32 i = 0; i < num_bins; i++) {
+    BaseFloat score;
+    double num_target, num_nontarget;
+    ReadBasicType(is, binary, &score);
+    ReadBasicType(is, binary, &num_target);
+    ReadBasicType(is, binary, &num_nontarget);
+    std::pair<double, double> &counts = bins_[score];
+    counts.first += num_target;
+    counts.second += num_nontarget;
+    num_target_ += num_target;
+    num_nontarget_ += num_nontarget;
+  }
+  ExpectToken(is, binary, "</ScoreHistogram>");
+}
+
+}  // namespace kaldi
@@ -0,0 +1,99 @@
+// ivector/score-histogram.h
+
+// Copyright 2026  agent
+
+
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_IVECTOR_SCORE_HISTOGRAM_H_
+#define KALDI_IVECTOR_SCORE_HISTOGRAM_H_
+
+#include <map>
+#include <utility>
+#include <vector>
+#include "base/kaldi-common.h"
+#include "itf/options-itf.h"
+
+namespace kaldi {
+
+struct DcfOptions {
+  BaseFloat p_target;
+  BaseFloat c_miss;
+  BaseFloat c_fa;
+  DcfOptions(): p_target(0.01), c_miss(1.0), c_fa(1.0) { }
+  void Register(OptionsItf *po) {
+    po->Register("p-target", &p_target, "Prior probability of a target trial, "
+                 "for the detection cost function (DCF)");
+    po->Register("c-miss", &c_miss, "Cost of a missed target, for the DCF");
+    po->Register("c-fa", &c_fa, "Cost of a false alarm, for the DCF");
+  }
+};
+
+/// ScoreHistogram accumulates counts of target and non-target trial scores,
+/// so that the equal error rate (EER) and minimum detection cost (minDCF) can
+/// be computed without storing or sorting the list of scores.  If the
+/// resolution is > 0, scores are rounded down to a multiple of it, so the
+/// memory used is bounded by the range of the scores divided by the
+/// resolution; if it is zero, each distinct score has its own bin, which
+/// gives exact results.  Histograms of different parts of a trial list (e.g.
+/// computed in parallel) can be written, read and added together.
+class ScoreHistogram {
+ public:
+  explicit ScoreHistogram(BaseFloat resolution = 0.0):
+      resolution_(resolution), num_target_(0.0), num_nontarget_(0.0) {
+    KALDI_ASSERT(resolution >= 0.0);
+  }
+
+  void AddScore(BaseFloat score, bool is_target, double count = 1.0);
+
+  /// Adds the counts from "other", which must have the same resolution.
+  void Add(const ScoreHistogram &other);
+
+  double NumTarget() const { return num_target_; }
+  double NumNontarget() const { return num_nontarget_; }
+
+  /// Returns the equal error rate as a proportion between 0 and 1, and sets
+  /// "threshold" to the score at which it is attained: trials scoring at
+  /// least the threshold are accepted.  Requires target and non-target
+  /// trials.
+  BaseFloat ComputeEer(BaseFloat *threshold) const;
+
+  /// Returns the minimum over thresholds of the detection cost
+  /// c_miss p_target P_miss + c_fa (1 - p_target) P_fa, normalized by the
+  /// cost of the best trivial system, min(c_miss p_target, c_fa (1 - p_target)).
+  BaseFloat ComputeMinDcf(const DcfOptions &opts, BaseFloat *threshold) const;
+
+  void Write(std::ostream &os, bool binary) const;
+  /// If "add" is true, adds the counts read to the current ones.
+  void Read(std::istream &is, bool binary, bool add = false);
+
+ private:
+  // Called by ComputeEer() and ComputeMinDcf().  Fills in, for each bin b
+  // (in increasing order of score), the miss and false-alarm rates if the
+  // threshold is at that bin; plus one final entry where everything is
+  // rejected.
+  void GetErrorRates(std::vector<BaseFloat> *thresholds,
+                     std::vector<double> *miss_rates,
+                     std::vector<double> *fa_rates) const;
+
+  BaseFloat resolution_;
+  // Maps the (rounded) score to the counts of target and non-target trials.
+  std::map<BaseFloat, std::pair<double, double> > bins_;
+  double num_target_;
+  double num_nontarget_;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_IVECTOR_SCORE_HISTOGRAM_H_
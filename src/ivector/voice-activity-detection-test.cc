@@ -0,0 +1,108 @@
+// ivector/voice-activity-detection-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ivector/voice-activity-detection.h"
+
+namespace kaldi {
+
+// The straightforward computation, looping over the window of each frame.
+void ComputeVadEnergySimple(const VadEnergyOptions &opts,
+                            const MatrixBase<BaseFloat> &feats,
+                            Vector<BaseFloat> *output_voiced) {
+  int32 T = feats.NumRows(), context = opts.vad_frames_context;
+  output_voiced->Resize(T);
+  Vector<BaseFloat> log_energy(T);
+  log_energy.CopyColFromMat(feats, 0);
+  BaseFloat energy_threshold = opts.vad_energy_threshold +
+      opts.vad_energy_mean_scale * log_energy.Sum() / T;
+  for (int32 t = 0; t < T; t++) {
+    int32 num_count = 0, den_count = 0;
+    for (int32 t2 = t - context; t2 <= t + context; t2++) {
+      if (t2 >= 0 && t2 < T) {
+        den_count++;
+        if (log_energy(t2) > energy_threshold)
+          num_count++;
+      }
+    }
+    (*output_voiced)(t) =
+        (num_count >= den_count * opts.vad_proportion_threshold ? 1.0 : 0.0);
+  }
+}
+
+void GetRandVadOptions(VadEnergyOptions *opts) {
+  opts->vad_energy_threshold = RandGauss();
+  opts->vad_frames_context = rand() % 8;
+  opts->vad_proportion_threshold = 0.1 + 0.8 * RandUniform();
+}
+
+void UnitTestComputeVadEnergy() {
+  for (int32 i = 0; i < 50; i++) {
+    VadEnergyOptions opts;
+    GetRandVadOptions(&opts);
+    opts.vad_energy_mean_scale = (i % 2 == 0 ? 0.0 : RandUniform());
+    Matrix<BaseFloat> feats(1 + rand() % 50, 1 + rand() % 3);
+    feats.SetRandn();
+    Vector<BaseFloat> voiced, voiced_simple;
+    ComputeVadEnergy(opts, feats, &voiced);
+    ComputeVadEnergySimple(opts, feats, &voiced_simple);
+    KALDI_ASSERT(voiced.ApproxEqual(voiced_simple, 0.0));
+  }
+}
+
+// Feeds the frames to OnlineVadEnergy in random-sized pieces, taking the
+// decisions as soon as they are ready.  With no mean term in the threshold,
+// the decisions must be the same as those of ComputeVadEnergy().
+void UnitTestOnlineVadEnergy() {
+  for (int32 i = 0; i < 50; i++) {
+    VadEnergyOptions opts;
+    GetRandVadOptions(&opts);
+    opts.vad_energy_mean_scale = 0.0;
+    int32 T = 1 + rand() % 50;
+    Matrix<BaseFloat> feats(T, 2);
+    feats.SetRandn();
+    Vector<BaseFloat> voiced;
+    ComputeVadEnergy(opts, feats, &voiced);
+
+    OnlineVadEnergy vad(opts);
+    Vector<BaseFloat> online_voiced(T);
+    int32 t_in = 0, t_out = 0;
+    while (t_in < T) {
+      int32 n = std::min(T - t_in, 1 + rand() % 5);
+      for (int32 j = 0; j < n; j++, t_in++) {
+        vad.AcceptFrame(feats.Row(t_in));
+        while (vad.NextFrameReady())
+          online_voiced(t_out++) = (vad.GetNextFrame() ? 1.0 : 0.0);
+      }
+      KALDI_ASSERT(t_out == std::max(0, t_in - opts.vad_frames_context));
+    }
+    vad.InputFinished();
+    while (vad.NextFrameReady())
+      online_voiced(t_out++) = (vad.GetNextFrame() ? 1.0 : 0.0);
+    KALDI_ASSERT(t_out == T && vad.NumFramesOutput() == T);
+    KALDI_ASSERT(voiced.ApproxEqual(online_voiced, 0.0));
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::UnitTestComputeVadEnergy();
+  kaldi::UnitTestOnlineVadEnergy();
+  std::cout << "Test OK.\n";
+}
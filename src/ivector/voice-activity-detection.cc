@@ -24,6 +24,13 @@
 
 namespace kaldi {
 
+static void CheckVadEnergyOptions(const VadEnergyOptions &opts) {
+  KALDI_ASSERT(opts.vad_energy_mean_scale >= 0.0);
+  KALDI_ASSERT(opts.vad_frames_context >= 0);
+  KALDI_ASSERT(opts.vad_proportion_threshold > 0.0 &&
+               opts.vad_proportion_threshold < 1.0);
+}
+
 void ComputeVadEnergy(const VadEnergyOptions &opts,
                       const MatrixBase<BaseFloat> &feats,
                       Vector<BaseFloat> *output_voiced) {
@@ -33,33 +40,74 @@ void ComputeVadEnergy(const VadEnergyOptions &opts,
     KALDI_WARN << "Empty features";
     return;
   }
+  CheckVadEnergyOptions(opts);
   Vector<BaseFloat> log_energy(T);
   log_energy.CopyColFromMat(feats, 0); // column zero is log-energy.
   
   BaseFloat energy_threshold = opts.vad_energy_threshold;
-  if (opts.vad_energy_mean_scale != 0.0) {
-    KALDI_ASSERT(opts.vad_energy_mean_scale > 0.0);
+  if (opts.vad_energy_mean_scale != 0.0)
     energy_threshold += opts.vad_energy_mean_scale * log_energy.Sum() / T;
-  }
-  
-  KALDI_ASSERT(opts.vad_frames_context >= 0);
-  KALDI_ASSERT(opts.vad_proportion_threshold > 0.0 &&
-               opts.vad_proportion_threshold < 1.0);
+
+  // num_above[t] is the number of frames before t that are above the
+  // threshold, so the count for a window [t1, t2] is
+  // num_above[t2 + 1] - num_above[t1].
+  std::vector<int32> num_above(T + 1);
+  num_above[0] = 0;
+  const BaseFloat *log_energy_data = log_energy.Data();
+  for (int32 t = 0; t < T; t++)
+    num_above[t + 1] = num_above[t] +
+        (log_energy_data[t] > energy_threshold ? 1 : 0);
+
+  int32 context = opts.vad_frames_context;
   for (int32 t = 0; t < T; t++) {
-    const BaseFloat *log_energy_data = log_energy.Data();
-    int32 num_count = 0, den_count = 0, context = opts.vad_frames_context;
-    for (int32 t2 = t - context; t2 <= t + context; t2++) {
-      if (t2 >= 0 && t2 < T) {
-        den_count++;
-        if (log_energy_data[t] > energy_threshold)
-          num_count++;
-      }
-    }
+    int32 t1 = std::max(t - context, 0), t2 = std::min(t + context, T - 1),
+        num_count = num_above[t2 + 1] - num_above[t1],
+        den_count = t2 - t1 + 1;
     if (num_count >= den_count * opts.vad_proportion_threshold)
       (*output_voiced)(t) = 1.0;
     else
       (*output_voiced)(t) = 0.0;
   }
-}  
+}
+
+
+OnlineVadEnergy::OnlineVadEnergy(const VadEnergyOptions &opts):
+    opts_(opts), energy_sum_(0.0), first_frame_(0), t_in_(0), t_out_(0),
+    input_finished_(false) {
+  CheckVadEnergyOptions(opts);
+}
+
+void OnlineVadEnergy::AcceptFrame(const VectorBase<BaseFloat> &frame) {
+  KALDI_ASSERT(!input_finished_ && frame.Dim() > 0);
+  BaseFloat log_energy = frame(0);
+  energy_sum_ += log_energy;
+  t_in_++;
+  BaseFloat energy_threshold = opts_.vad_energy_threshold +
+      opts_.vad_energy_mean_scale * energy_sum_ / t_in_;
+  int32 prev_num_above = (num_above_.empty() ? 0 : num_above_.back());
+  num_above_.push_back(prev_num_above +
+                       (log_energy > energy_threshold ? 1 : 0));
+}
+
+bool OnlineVadEnergy::NextFrameReady() const {
+  if (t_out_ >= t_in_) return false;
+  return input_finished_ || t_in_ > t_out_ + opts_.vad_frames_context;
+}
+
+bool OnlineVadEnergy::GetNextFrame() {
+  KALDI_ASSERT(NextFrameReady());
+  int32 t = t_out_, context = opts_.vad_frames_context,
+      t1 = std::max(t - context, 0), t2 = std::min(t + context, t_in_ - 1);
+  // We need num_above_ for frames t1 - 1 ... t2; drop what comes before.
+  while (first_frame_ < t1 - 1) {
+    num_above_.pop_front();
+    first_frame_++;
+  }
+  int32 num_count = num_above_[t2 - first_frame_] -
+      (t1 == 0 ? 0 : num_above_[t1 - 1 - first_frame_]),
+      den_count = t2 - t1 + 1;
+  t_out_++;
+  return (num_count >= den_count * opts_.vad_proportion_threshold);
+}
 
 }
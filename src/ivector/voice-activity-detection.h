@@ -23,6 +23,7 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <deque>
 #include <string>
 #include <vector>
 
@@ -77,11 +78,59 @@ struct VadEnergyOptions {
 /// in this file), and for each frame the decision is based on the
 /// proportion of frames in a context window around the current frame,
 /// which are above this cutoff.
+/// The cost per frame does not depend on vad_frames_context: the counts
+/// for the windows are obtained from running totals.
 void ComputeVadEnergy(const VadEnergyOptions &opts,
                       const MatrixBase<BaseFloat> &input_features,
                       Vector<BaseFloat> *output_voiced);
 
 
+/// A streaming version of ComputeVadEnergy(), for use where the frames arrive
+/// incrementally (see OnlineVadInput in ../online/online-feat-input.h).  The
+/// decision for frame t is available once frame t + vad_frames_context has
+/// been accepted (or the input is finished).  Because the mean log-energy of
+/// the whole file is not known in advance, the threshold for each frame uses
+/// the mean log-energy of the frames up to and including that frame, so the
+/// decisions may differ from those of ComputeVadEnergy() near the start.
+/// The memory used does not grow with the length of the input.
+class OnlineVadEnergy {
+ public:
+  explicit OnlineVadEnergy(const VadEnergyOptions &opts);
+
+  /// Adds the next frame of input; only element zero (the log-energy) is
+  /// looked at.
+  void AcceptFrame(const VectorBase<BaseFloat> &frame);
+
+  /// Call this after the last AcceptFrame(); the decisions for the remaining
+  /// frames then become ready.
+  void InputFinished() { input_finished_ = true; }
+
+  /// Returns true if the decision for the next frame can be made.
+  bool NextFrameReady() const;
+
+  /// Returns the decision (true if voiced) for the next frame; requires
+  /// NextFrameReady().
+  bool GetNextFrame();
+
+  /// Returns the number of frames accepted so far.
+  int32 NumFramesAccepted() const { return t_in_; }
+
+  /// Returns the number of frames for which a decision was output so far.
+  int32 NumFramesOutput() const { return t_out_; }
+
+ private:
+  VadEnergyOptions opts_;
+  double energy_sum_;  // Sum of the log-energies of the frames accepted.
+  // num_above_[i] is the number of frames among 0 ... first_frame_ + i that
+  // were above the threshold; it covers frames first_frame_ ... t_in_ - 1.
+  std::deque<int32> num_above_;
+  int32 first_frame_;
+  int32 t_in_;  // Number of frames accepted.
+  int32 t_out_;  // Number of decisions output.
+  bool input_finished_;
+};
+
+
 }  // namespace kaldi
 
 
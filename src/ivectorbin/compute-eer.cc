@@ -20,58 +20,7 @@
 
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
-
-namespace kaldi {
-
-/**
-   ComputeEer computes the Equal Error Rate (EER) for the given scores
-   and returns it as a proportion beween 0 and 1.
-   If we set the threshold at x, then the target error-rate is the
-   proportion of target_scores below x; and the non-target error-rate
-   is the proportion of non-target scores above x.  We seek a
-   threshold x for which these error rates are the same; this
-   error rate is the EER.
-
-   We compute this by iterating over the positions in target_scores: 0, 1, 2,
-   and so on, and for each position consider whether the cutoff could be here.
-   For each of these position we compute the corresponding position in
-   nontarget_scores where the cutoff would be if the EER were the same.
-   For instance, if the vectors had the same length, this would be position
-   length() - 1, length() - 2, and so on.  As soon as the value at that
-   position in nontarget_scores at that position is less than the value from
-   target_scores, we have our EER.
-
-   In coding this we weren't particularly careful about edge cases or
-   making sure whether it's actually n + 1 instead of n.
-*/
-
-BaseFloat ComputeEer(std::vector<BaseFloat> *target_scores,
-                     std::vector<BaseFloat> *nontarget_scores,
-                     BaseFloat *threshold) {
-  KALDI_ASSERT(!target_scores->empty() && !nontarget_scores->empty());
-  std::sort(target_scores->begin(), target_scores->end());
-  std::sort(nontarget_scores->begin(), nontarget_scores->end());
-  
-  size_t target_position = 0,
-      target_size = target_scores->size();
-  for (; target_position + 1 < target_size; target_position++) {
-    ssize_t nontarget_size = nontarget_scores->size(),
-        nontarget_n = nontarget_size * target_position * 1.0 / target_size,
-        nontarget_position = nontarget_size - 1 - nontarget_n;
-    if (nontarget_position  < 0)
-      nontarget_position = 0;
-    if ((*nontarget_scores)[nontarget_position] <
-        (*target_scores)[target_position])
-      break;
-  }
-  *threshold = (*target_scores)[target_position];
-  BaseFloat eer = target_position * 1.0 / target_size;
-  return eer;
-}
-
-
-}
-
+#include "ivector/score-histogram.h"
 
 
 int main(int argc, char *argv[]) {
@@ -83,58 +32,93 @@ int main(int argc, char *argv[]) {
         "Input is a series of lines, each with two fields.\n"
         "The first field must be a numeric score, and the second\n"
         "either the string 'target' or 'nontarget'. \n"
-        "The EER will be printed to the standard output.\n"
+        "The EER will be printed to the standard output, and the minimum\n"
+        "detection cost (see --p-target, --c-miss, --c-fa) will be logged.\n"
+        "The scores are accumulated in a histogram rather than stored, so\n"
+        "large trial lists can be handled; with --resolution > 0 the memory\n"
+        "used does not depend on the number of trials.  Several inputs (e.g.\n"
+        "shards of a trial list) may be given.  With --write-histogram, the\n"
+        "histogram is written out, and with --read-histograms the inputs are\n"
+        "such histograms (e.g. computed in parallel) rather than score lines.\n"
         "\n"
-        "Usage: compute-eer <scores-in>\n"
-        "e.g.: compute-eer -\n";
+        "Usage: compute-eer [options] <scores-in-1> [<scores-in-2> ...]\n"
+        "e.g.: compute-eer -\n"
+        " or: compute-eer --read-histograms=true hist.1 hist.2 hist.3\n";
     
     ParseOptions po(usage);
+    BaseFloat resolution = 0.0;
+    bool read_histograms = false, binary = true;
+    std::string histogram_wxfilename;
+    DcfOptions dcf_opts;
+    po.Register("resolution", &resolution, "If >0, round scores down to a "
+                "multiple of this before computing the EER, which bounds "
+                "the memory used.  If 0, results are exact.");
+    po.Register("read-histograms", &read_histograms, "If true, the inputs are "
+                "histograms written with --write-histogram, not score lines.");
+    po.Register("write-histogram", &histogram_wxfilename, "If set, write the "
+                "histogram of scores to this file.");
+    po.Register("binary", &binary, "Write the histogram in binary mode.");
+    dcf_opts.Register(&po);
     po.Read(argc, argv);
     
-    if (po.NumArgs() != 1) {
+    if (po.NumArgs() < 1) {
       po.PrintUsage();
       exit(1);
     }
 
-    std::string scores_rxfilename = po.GetArg(1);
-
-    std::vector<BaseFloat> target_scores, nontarget_scores;
-    Input ki(scores_rxfilename);
+    ScoreHistogram hist(resolution);
+    for (int32 n = 1; n <= po.NumArgs(); n++) {
+      std::string scores_rxfilename = po.GetArg(n);
+      if (read_histograms) {
+        bool binary_in;
+        Input ki(scores_rxfilename, &binary_in);
+        // the resolution of the first histogram read is used.
+        hist.Read(ki.Stream(), binary_in, (n > 1));
+        continue;
+      }
+      Input ki(scores_rxfilename);
     
-    std::string line;
-    while (std::getline(ki.Stream(), line)) {
+      std::string line;
       std::vector<std::string> split_line;
-      SplitStringToVector(line, " \t", true, &split_line);
-      BaseFloat score;
-      if (split_line.size() != 2) {
-        KALDI_ERR << "Invalid input line (must have two fields): "
-                  << line;
-      }
-      if (!ConvertStringToReal(split_line[0], &score)) {
-        KALDI_ERR << "Invalid input line (first field must be float): "
-                  << line;
-      }
-      if (split_line[1] == "target")
-        target_scores.push_back(score);
-      else if (split_line[1] == "nontarget")
-        nontarget_scores.push_back(score);
-      else {
-        KALDI_ERR << "Invalid input line (second field must be "
-                  << "'target' or 'nontarget')";
+      while (std::getline(ki.Stream(), line)) {
+        SplitStringToVector(line, " \t", true, &split_line);
+        BaseFloat score;
+        if (split_line.size() != 2) {
+          KALDI_ERR << "Invalid input line (must have two fields): "
+                    << line;
+        }
+        if (!ConvertStringToReal(split_line[0], &score)) {
+          KALDI_ERR << "Invalid input line (first field must be float): "
+                    << line;
+        }
+        if (split_line[1] == "target")
+          hist.AddScore(score, true);
+        else if (split_line[1] == "nontarget")
+          hist.AddScore(score, false);
+        else {
+          KALDI_ERR << "Invalid input line (second field must be "
+                    << "'target' or 'nontarget')";
+        }
       }
     }
-    if (target_scores.empty() && nontarget_scores.empty())
+    if (!histogram_wxfilename.empty())
+      WriteKaldiObject(hist, histogram_wxfilename, binary);
+
+    if (hist.NumTarget() == 0 && hist.NumNontarget() == 0)
       KALDI_ERR << "Empty input.";
-    if (target_scores.empty())
+    if (hist.NumTarget() == 0)
       KALDI_ERR << "No target scores seen.";
-    if (nontarget_scores.empty())
+    if (hist.NumNontarget() == 0)
       KALDI_ERR << "No non-target scores seen.";
 
-    BaseFloat threshold;
-    BaseFloat eer = ComputeEer(&target_scores, &nontarget_scores, &threshold);
+    BaseFloat threshold, dcf_threshold;
+    BaseFloat eer = hist.ComputeEer(&threshold),
+        min_dcf = hist.ComputeMinDcf(dcf_opts, &dcf_threshold);
 
     KALDI_LOG << "Equal error rate is " << (100.0 * eer)
               << "%, at threshold " << threshold;
+    KALDI_LOG << "Minimum detection cost (p-target=" << dcf_opts.p_target
+              << ") is " << min_dcf << ", at threshold " << dcf_threshold;
 
     std::cout.precision(4);
     std::cout << (100.0 * eer);
@@ -22,7 +22,60 @@
 #include "util/common-utils.h"
 #include "matrix/kaldi-matrix.h"
 #include "ivector/voice-activity-detection.h"
+#include "thread/kaldi-task-sequence.h"
 
+namespace kaldi {
+
+// This class computes the voice-activity decisions for one utterance in its
+// operator (), and writes them out (and updates the statistics) in its
+// destructor.  It is used with class TaskSequencer so that we can process
+// several utterances in parallel and still write them in the original order.
+class VadComputeClass {
+ public:
+  VadComputeClass(const VadEnergyOptions &opts,
+                  const std::string &utt,
+                  const Matrix<BaseFloat> &feat,
+                  bool omit_unvoiced_utts,
+                  BaseFloatVectorWriter *vad_writer,
+                  int32 *num_done, int32 *num_unvoiced,
+                  double *tot_length, double *tot_decision):
+      opts_(opts), utt_(utt), feat_(feat),
+      omit_unvoiced_utts_(omit_unvoiced_utts), vad_writer_(vad_writer),
+      num_done_(num_done), num_unvoiced_(num_unvoiced),
+      tot_length_(tot_length), tot_decision_(tot_decision) { }
+
+  void operator () () {
+    ComputeVadEnergy(opts_, feat_, &vad_result_);
+  }
+
+  ~VadComputeClass() {
+    double sum = vad_result_.Sum();
+    if (sum == 0.0) {
+      KALDI_WARN << "No frames were judged voiced for utterance " << utt_;
+      (*num_unvoiced_)++;
+    } else {
+      (*num_done_)++;
+    }
+    *tot_decision_ += sum;
+    *tot_length_ += vad_result_.Dim();
+
+    if (!(omit_unvoiced_utts_ && sum == 0))
+      vad_writer_->Write(utt_, vad_result_);
+  }
+ private:
+  const VadEnergyOptions &opts_;
+  std::string utt_;
+  Matrix<BaseFloat> feat_;
+  bool omit_unvoiced_utts_;
+  BaseFloatVectorWriter *vad_writer_;
+  int32 *num_done_;
+  int32 *num_unvoiced_;
+  double *tot_length_;
+  double *tot_decision_;
+  Vector<BaseFloat> vad_result_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -48,6 +101,8 @@ int main(int argc, char *argv[]) {
                 "utterances that were judged 100% unvoiced.");
     VadEnergyOptions opts;
     opts.Register(&po);
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
+    sequencer_config.Register(&po);
     po.Read(argc, argv);
 
     if (po.NumArgs() != 2) {
@@ -65,31 +120,25 @@ int main(int argc, char *argv[]) {
     int32 num_unvoiced = 0;
     double tot_length = 0.0, tot_decision = 0.0;
     
-    for (;!feat_reader.Done(); feat_reader.Next()) {
-      std::string utt = feat_reader.Key();
-      Matrix<BaseFloat> feat(feat_reader.Value());
-      if (feat.NumRows() == 0) {
-        KALDI_WARN << "Empty feature matrix for utterance " << utt;
-        num_err++;
-        continue;
-      }
-      Vector<BaseFloat> vad_result(feat.NumRows());
-
-      ComputeVadEnergy(opts, feat, &vad_result);
-
-      double sum = vad_result.Sum();
-      if (sum == 0.0) {
-        KALDI_WARN << "No frames were judged voiced for utterance " << utt;
-        num_unvoiced++;
-      } else {
-        num_done++;
-      }
-      tot_decision += vad_result.Sum();
-      tot_length += vad_result.Dim();
-      
-      if (!(omit_unvoiced_utts && sum == 0)) {
-        vad_writer.Write(utt, vad_result);
+    {
+      TaskSequencer<VadComputeClass> sequencer(sequencer_config);
+      for (;!feat_reader.Done(); feat_reader.Next()) {
+        std::string utt = feat_reader.Key();
+        const Matrix<BaseFloat> &feat = feat_reader.Value();
+        if (feat.NumRows() == 0) {
+          KALDI_WARN << "Empty feature matrix for utterance " << utt;
+          num_err++;
+          continue;
+        }
+        // "sequencer" takes ownership of the task and deletes it (which
+        // writes the output) once it and all the tasks before it have
+        // finished.
+        sequencer.Run(new VadComputeClass(opts, utt, feat, omit_unvoiced_utts,
+                                          &vad_writer, &num_done,
+                                          &num_unvoiced, &tot_length,
+                                          &tot_decision));
       }
+      sequencer.Wait();
     }
 
     KALDI_LOG << "Applied energy based voice activity detection; "
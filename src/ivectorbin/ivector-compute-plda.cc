@@ -112,7 +112,6 @@ int main(int argc, char *argv[]) {
       KALDI_ERR << "No speakers with multiple utterances, "
                 << "unable to estimate PLDA.";
     
-    plda_stats.Sort();
     PldaEstimator plda_estimator(plda_stats);
     Plda plda;
     plda_estimator.Estimate(plda_config, &plda);
@@ -22,7 +22,9 @@
 #include "util/common-utils.h"
 #include "gmm/am-diag-gmm.h"
 #include "ivector/ivector-extractor.h"
+#include "ivector/ivector-extractor-batched.h"
 #include "thread/kaldi-task-sequence.h"
+#include "cudamatrix/cu-device.h"
 
 namespace kaldi {
 
@@ -36,9 +38,12 @@ class IvectorExtractTask {
                      const Matrix<BaseFloat> &feats,
                      const Posterior &posterior,
                      BaseFloatVectorWriter *writer,
-                     double *tot_auxf_change):
+                     double *tot_auxf_change,
+                     const IvectorExtractorApprox *approx = NULL,
+                     double *tot_approx_loss = NULL):
       extractor_(extractor), utt_(utt), feats_(feats), posterior_(posterior),
-      writer_(writer), tot_auxf_change_(tot_auxf_change) { }
+      writer_(writer), tot_auxf_change_(tot_auxf_change), approx_(approx),
+      tot_approx_loss_(tot_approx_loss), approx_loss_(0.0) { }
 
   void operator () () {
     bool need_2nd_order_stats = false;
@@ -54,11 +59,18 @@ class IvectorExtractTask {
 
     if (tot_auxf_change_ != NULL) {
       double old_auxf = extractor_.GetAuxf(utt_stats, ivector_);
-      extractor_.GetIvectorDistribution(utt_stats, &ivector_, NULL);
+      GetIvector(utt_stats);
       double new_auxf = extractor_.GetAuxf(utt_stats, ivector_);
       auxf_change_ = new_auxf - old_auxf;
     } else {
-      extractor_.GetIvectorDistribution(utt_stats, &ivector_, NULL);
+      GetIvector(utt_stats);
+    }
+    if (tot_approx_loss_ != NULL) {
+      // Work out how much worse the auxf is than with the exact iVector.
+      Vector<double> exact_ivector(extractor_.IvectorDim());
+      extractor_.GetIvectorDistribution(utt_stats, &exact_ivector, NULL);
+      approx_loss_ = extractor_.GetAuxf(utt_stats, exact_ivector) -
+          extractor_.GetAuxf(utt_stats, ivector_);
     }
   }
   ~IvectorExtractTask() {
@@ -69,6 +81,8 @@ class IvectorExtractTask {
                     << (auxf_change_ / T) << " per frame over " << T
                     << " frames.";
     }
+    if (tot_approx_loss_ != NULL)
+      *tot_approx_loss_ += approx_loss_;
     // We actually write out the offset of the iVector's from the mean of the
     // prior distribution; this is the form we'll need it in for scoring.  (most
     // formulations of iVectors have zero-mean priors so this is not normally an
@@ -79,17 +93,65 @@ class IvectorExtractTask {
     writer_->Write(utt_, Vector<BaseFloat>(ivector_));
   }
  private:
+  void GetIvector(const IvectorExtractorUtteranceStats &utt_stats) {
+    if (approx_ != NULL)
+      approx_->GetIvectorMean(utt_stats, &ivector_);
+    else
+      extractor_.GetIvectorDistribution(utt_stats, &ivector_, NULL);
+  }
+
   const IvectorExtractor &extractor_;
   std::string utt_;
   Matrix<BaseFloat> feats_;
   Posterior posterior_;
   BaseFloatVectorWriter *writer_;
   double *tot_auxf_change_; // if non-NULL we need the auxf change.
+  const IvectorExtractorApprox *approx_;  // if non-NULL, used to get the
+                                          // iVector.
+  double *tot_approx_loss_;  // if non-NULL we need the auxf loss from using
+                             // approx_.
   Vector<double> ivector_;
   double auxf_change_;
+  double approx_loss_;
 };
 
 
+// This is used when --batch-size > 1: it extracts the iVectors for the
+// utterances whose stats are in "utt_stats", writes them out and deletes the
+// stats.
+void ProcessBatch(const IvectorExtractorBatched &batched,
+                  std::vector<std::string> *utts,
+                  std::vector<const IvectorExtractorUtteranceStats*> *utt_stats,
+                  BaseFloatVectorWriter *writer,
+                  double *tot_auxf_change) {
+  const IvectorExtractor &extractor = batched.Extractor();
+  Matrix<double> ivectors;
+  batched.GetIvectorMeans(*utt_stats, &ivectors);
+  for (size_t b = 0; b < utts->size(); b++) {
+    Vector<double> ivector(ivectors.Row(b));
+    if (tot_auxf_change != NULL) {
+      Vector<double> prior_mean(extractor.IvectorDim());
+      prior_mean(0) = extractor.PriorOffset();
+      double auxf_change = extractor.GetAuxf(*((*utt_stats)[b]), ivector) -
+          extractor.GetAuxf(*((*utt_stats)[b]), prior_mean);
+      *tot_auxf_change += auxf_change;
+      KALDI_VLOG(2) << "Auxf change for utterance " << (*utts)[b] << " was "
+                    << (auxf_change / (*utt_stats)[b]->gamma.Sum())
+                    << " per frame.";
+    }
+    // As in IvectorExtractTask, we write out the offset from the mean of the
+    // prior.
+    ivector(0) -= extractor.PriorOffset();
+    KALDI_VLOG(2) << "Ivector norm for utterance " << (*utts)[b]
+                  << " was " << ivector.Norm(2.0);
+    writer->Write((*utts)[b], Vector<BaseFloat>(ivector));
+    delete (*utt_stats)[b];
+  }
+  utts->clear();
+  utt_stats->clear();
+}
+
+
 
 }
 
@@ -106,16 +168,35 @@ int main(int argc, char *argv[]) {
         "<posteriors-rspecifier> <ivector-wspecifier>\n"
         "e.g.: \n"
         " fgmm-global-gselect-to-post 1.fgmm '$feats' 'ark:gunzip -c gselect.1.gz|' ark:- | \\\n"
-        "  ivector-extract final.ie '$feats' ark,s,cs:- ark,t:ivectors.1.ark\n";
+        "  ivector-extract final.ie '$feats' ark,s,cs:- ark,t:ivectors.1.ark\n"
+        "With --batch-size > 1, iVectors are extracted for that many utterances\n"
+        "at a time, using matrix multiplications (on the GPU if --use-gpu=yes);\n"
+        "in that case --num-threads has no effect.\n"
+        "With --approximate=true, a fast approximation is used (see\n"
+        "IvectorExtractorApprox); --report-approx-loss shows what it costs.\n";
 
     ParseOptions po(usage);
     bool compute_objf_change = true;
     IvectorStatsOptions stats_opts;
     TaskSequencerConfig sequencer_config;
+    int32 batch_size = 1;
+    std::string use_gpu = "no";
+    bool approximate = false, report_approx_loss = false;
     po.Register("compute-objf-change", &compute_objf_change,
                 "If true, compute the change in objective function from using "
                 "nonzero iVector (a potentially useful diagnostic).  Combine "
                 "with --verbose=2 for per-utterance information");
+    po.Register("batch-size", &batch_size, "If >1, extract iVectors for this "
+                "many utterances at a time, using matrix multiplications.");
+    po.Register("use-gpu", &use_gpu, "yes|no|optional, only has effect if "
+                "compiled with CUDA and --batch-size > 1");
+    po.Register("approximate", &approximate, "If true, use a fast "
+                "approximation in which the U_i matrices are diagonalized in "
+                "a common basis, and the weight terms are ignored.");
+    po.Register("report-approx-loss", &report_approx_loss, "If true (with "
+                "--approximate=true), also compute the exact iVectors and "
+                "report the average loss in objective function from the "
+                "approximation.");
     stats_opts.Register(&po);
     sequencer_config.Register(&po);
     
@@ -137,6 +218,16 @@ int main(int argc, char *argv[]) {
     IvectorExtractor extractor;
     ReadKaldiObject(ivector_extractor_rxfilename, &extractor);
 
+    if (approximate && batch_size > 1)
+      KALDI_ERR << "--approximate=true and --batch-size > 1 are not supported "
+                << "together.";
+    IvectorExtractorApprox *approx = NULL;
+    if (approximate)
+      approx = new IvectorExtractorApprox(extractor);
+    double tot_approx_loss = 0.0;
+    double *approx_loss_ptr = (approximate && report_approx_loss ?
+                               &tot_approx_loss : NULL);
+
     double tot_auxf_change = 0.0;
     int64 tot_t = 0;
     int32 num_done = 0, num_err = 0;
@@ -145,7 +236,48 @@ int main(int argc, char *argv[]) {
     RandomAccessPosteriorReader posteriors_reader(posteriors_rspecifier);
     BaseFloatVectorWriter ivector_writer(ivectors_wspecifier);
 
-    {
+    if (batch_size > 1) {
+#if HAVE_CUDA==1
+      CuDevice::Instantiate().SelectGpuId(use_gpu);
+#endif
+      IvectorExtractorBatched batched(extractor);
+      std::vector<std::string> utts;
+      std::vector<const IvectorExtractorUtteranceStats*> utt_stats;
+      double *auxf_ptr = (compute_objf_change ? &tot_auxf_change : NULL );
+      for (; !feature_reader.Done(); feature_reader.Next()) {
+        std::string key = feature_reader.Key();
+        if (!posteriors_reader.HasKey(key)) {
+          KALDI_WARN << "No posteriors for utterance " << key;
+          num_err++;
+          continue;
+        }
+        const Matrix<BaseFloat> &mat = feature_reader.Value();
+        const Posterior &posterior = posteriors_reader.Value(key);
+
+        if (static_cast<int32>(posterior.size()) != mat.NumRows()) {
+          KALDI_WARN << "Size mismatch between posterior " << (posterior.size())
+                     << " and features " << (mat.NumRows()) << " for utterance "
+                     << key;
+          num_err++;
+          continue;
+        }
+        IvectorExtractorUtteranceStats *stats =
+            new IvectorExtractorUtteranceStats(extractor.NumGauss(),
+                                               extractor.FeatDim(), false);
+        extractor.GetStats(mat, posterior, stats);
+        utts.push_back(key);
+        utt_stats.push_back(stats);
+        if (static_cast<int32>(utts.size()) == batch_size)
+          ProcessBatch(batched, &utts, &utt_stats, &ivector_writer, auxf_ptr);
+
+        tot_t += posterior.size();
+        num_done++;
+      }
+      ProcessBatch(batched, &utts, &utt_stats, &ivector_writer, auxf_ptr);
+#if HAVE_CUDA==1
+      CuDevice::Instantiate().PrintProfile();
+#endif
+    } else {
       TaskSequencer<IvectorExtractTask> sequencer(sequencer_config);
       for (; !feature_reader.Done(); feature_reader.Next()) {
         std::string key = feature_reader.Key();
@@ -168,7 +300,8 @@ int main(int argc, char *argv[]) {
         double *auxf_ptr = (compute_objf_change ? &tot_auxf_change : NULL );
 
         sequencer.Run(new IvectorExtractTask(extractor, key, mat, posterior,
-                                             &ivector_writer, auxf_ptr));
+                                             &ivector_writer, auxf_ptr,
+                                             approx, approx_loss_ptr));
                       
         tot_t += posterior.size();
         num_done++;
@@ -183,6 +316,11 @@ int main(int argc, char *argv[]) {
       KALDI_LOG << "Overall average objective-function change from estimating "
                 << "ivector was " << (tot_auxf_change / tot_t) << " per frame "
                 << " over " << tot_t << " frames.";
+    if (approx_loss_ptr != NULL)
+      KALDI_LOG << "Average loss in objective function from the approximate "
+                << "iVector extraction was " << (tot_approx_loss / tot_t)
+                << " per frame.";
+    delete approx;
 
     return (num_done != 0 ? 0 : 1);
   } catch(const std::exception &e) {
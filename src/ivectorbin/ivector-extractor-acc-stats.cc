@@ -67,8 +67,9 @@ int main(int argc, char *argv[]) {
     const char *usage =
         "Accumulate stats for iVector extractor training\n"
         "Reads in features and Gaussian-level posteriors (typically from a full GMM)\n"
-        "Supports multiple threads, but won't be able to make use of too many at a time\n"
-        "(e.g. more than about 4)\n"
+        "Supports multiple threads; with more than about 4 threads, use the\n"
+        "--num-stats-copies option to reduce contention for the stats, at the\n"
+        "cost of more memory.\n"
         "Usage:  ivector-extractor-acc-stats [options] <model-in> <feature-rspecifier>"
         "<posteriors-rspecifier> <stats-out>\n"
         "e.g.: \n"
@@ -79,7 +80,13 @@ int main(int argc, char *argv[]) {
     bool binary = true;
     IvectorStatsOptions stats_opts;
     TaskSequencerConfig sequencer_opts;
+    int32 num_stats_copies = 1;
     po.Register("binary", &binary, "Write output in binary mode");
+    po.Register("num-stats-copies", &num_stats_copies, "Number of separate "
+                "copies of the stats that the threads accumulate to, to reduce "
+                "locking; they are summed at the end.  Each copy uses as much "
+                "memory as the stats that are written out.  Values above "
+                "--num-threads are not useful.");
     stats_opts.Register(&po);
     sequencer_opts.Register(&po);
 
@@ -113,7 +120,15 @@ int main(int argc, char *argv[]) {
     ReadKaldiObject(ivector_extractor_rxfilename, &extractor);
     
     IvectorStats stats(extractor, stats_opts);
-    
+
+    // The utterances are assigned to the copies of the stats in turn.  Each
+    // copy is still protected by its own locks, since two utterances assigned
+    // to the same copy may be processed at the same time.
+    KALDI_ASSERT(num_stats_copies > 0);
+    num_stats_copies = std::min(num_stats_copies, sequencer_opts.num_threads);
+    std::vector<IvectorStats*> stats_copies(1, &stats);
+    for (int32 i = 1; i < num_stats_copies; i++)
+      stats_copies.push_back(new IvectorStats(extractor, stats_opts));
     
     int64 tot_t = 0;
     int32 num_done = 0, num_err = 0;
@@ -139,7 +154,8 @@ int main(int argc, char *argv[]) {
           continue;
         }
 
-        sequencer.Run(new IvectorTask(extractor, mat, posterior, &stats));
+        sequencer.Run(new IvectorTask(extractor, mat, posterior,
+                                      stats_copies[num_done % num_stats_copies]));
 
         tot_t += posterior.size();
         num_done++;
@@ -147,6 +163,10 @@ int main(int argc, char *argv[]) {
       // destructor of "sequencer" will wait for any remaining tasks that
       // have not yet completed.
     }
+    for (int32 i = 1; i < num_stats_copies; i++) {
+      stats.Add(*(stats_copies[i]));
+      delete stats_copies[i];
+    }
     
     KALDI_LOG << "Done " << num_done << " files, " << num_err
               << " with errors.  Total frames " << tot_t;
@@ -0,0 +1,282 @@
+// ivectorbin/ivector-plda-scoring-dense.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "ivector/plda.h"
+#include "ivector/plda-batched.h"
+#include "ivector/score-histogram.h"
+#include "cudamatrix/cu-device.h"
+
+
+int main(int argc, char *argv[]) {
+  using namespace kaldi;
+  typedef kaldi::int32 int32;
+  typedef std::string string;
+  try {
+    const char *usage =
+        "Computes PLDA log-likelihood ratios between every training iVector and\n"
+        "every test iVector (no trials file), using matrix multiplications that\n"
+        "are done on the GPU if one is used.  The output has lines of the form\n"
+        "<train-key> <test-key> <score>\n"
+        "With --top-k=K, only the K best-scoring training iVectors are output for\n"
+        "each test iVector, best first (e.g. for speaker search).\n"
+        "As for ivector-plda-scoring, the training iVectors are averaged over\n"
+        "speakers and the number of utterances per speaker may be given using\n"
+        "the --num-utts option.\n"
+        "With --vector-output=true, <scores-wspecifier> is instead a table of\n"
+        "score vectors indexed by test key (e.g. a binary archive), with the\n"
+        "training iVectors in the order written to --train-keys.  With\n"
+        "--utt2spk and --histogram, target (same speaker) and non-target\n"
+        "scores are accumulated in a histogram that compute-eer\n"
+        "--read-histograms=true can read, so the EER of all-vs-all trials can\n"
+        "be computed without writing the scores out (see --vector-output=false\n"
+        "with scores-wxfilename /dev/null).\n"
+        "\n"
+        "Usage: ivector-plda-scoring-dense <plda> <train-ivector-rspecifier>\n"
+        " <test-ivector-rspecifier> <scores-wxfilename>\n"
+        "\n"
+        "e.g.: ivector-plda-scoring-dense --num-utts=ark:exp/train/num_utts.ark "
+        "--top-k=10 plda ark:exp/train/spk_ivectors.ark ark:exp/test/ivectors.ark -\n"
+        "or: ivector-plda-scoring-dense --utt2spk=ark:data/test/utt2spk \\\n"
+        "  --histogram=hist plda ark:spk_ivectors.ark ark:ivectors.ark /dev/null\n";
+
+    ParseOptions po(usage);
+
+    std::string num_utts_rspecifier, use_gpu = "no", train_keys_wxfilename,
+        utt2spk_rspecifier, histogram_wxfilename;
+    int32 top_k = 0, batch_size = 256;
+    bool vector_output = false;
+    BaseFloat resolution = 0.001;
+
+    PldaConfig plda_config;
+    plda_config.Register(&po);
+    po.Register("num-utts", &num_utts_rspecifier, "Table to read the number of "
+                "utterances per speaker, e.g. ark:num_utts.ark\n");
+    po.Register("top-k", &top_k, "If >0, output only this many best-scoring "
+                "training iVectors for each test iVector.");
+    po.Register("batch-size", &batch_size, "Number of test iVectors to score "
+                "at a time.");
+    po.Register("use-gpu", &use_gpu, "yes|no|optional, only has effect if "
+                "compiled with CUDA");
+    po.Register("vector-output", &vector_output, "If true, write a table of "
+                "score vectors (one per test iVector) instead of text lines.");
+    po.Register("train-keys", &train_keys_wxfilename, "File to write the keys "
+                "of the training iVectors to, one per line, in the order of the "
+                "elements of the vectors written with --vector-output.");
+    po.Register("utt2spk", &utt2spk_rspecifier, "Table mapping test keys to "
+                "speakers; a score is a target trial if the training key is "
+                "the test key's speaker.  Used with --histogram.");
+    po.Register("histogram", &histogram_wxfilename, "If set, write a histogram "
+                "of target and non-target scores to this file, for compute-eer.");
+    po.Register("resolution", &resolution, "Resolution of the score "
+                "histogram (see --histogram); 0 means exact.");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 4) {
+      po.PrintUsage();
+      exit(1);
+    }
+    KALDI_ASSERT(batch_size > 0 && top_k >= 0);
+    if (top_k > 0 && (vector_output || !histogram_wxfilename.empty()))
+      KALDI_ERR << "--top-k cannot be used with --vector-output or --histogram";
+    if (histogram_wxfilename.empty() != utt2spk_rspecifier.empty())
+      KALDI_ERR << "--histogram and --utt2spk must be used together";
+
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().SelectGpuId(use_gpu);
+#endif
+
+    std::string plda_rxfilename = po.GetArg(1),
+        train_ivector_rspecifier = po.GetArg(2),
+        test_ivector_rspecifier = po.GetArg(3),
+        scores_wxfilename = po.GetArg(4);
+
+    Plda plda;
+    ReadKaldiObject(plda_rxfilename, &plda);
+    int32 dim = plda.Dim();
+
+    double tot_test_renorm_scale = 0.0, tot_train_renorm_scale = 0.0;
+    int64 num_train_errs = 0, num_test_ivectors = 0, num_scores = 0;
+    double sum = 0.0, sumsq = 0.0;
+
+    SequentialBaseFloatVectorReader train_ivector_reader(train_ivector_rspecifier);
+    RandomAccessInt32Reader num_utts_reader(num_utts_rspecifier);
+
+    KALDI_LOG << "Reading train iVectors";
+    std::vector<std::string> train_keys;
+    std::vector<int32> num_train_utts;
+    std::vector<Vector<BaseFloat>*> train_ivectors;
+    for (; !train_ivector_reader.Done(); train_ivector_reader.Next()) {
+      std::string spk = train_ivector_reader.Key();
+      const Vector<BaseFloat> &ivector = train_ivector_reader.Value();
+      int32 num_examples;
+      if (!num_utts_rspecifier.empty()) {
+        if (!num_utts_reader.HasKey(spk)) {
+          KALDI_WARN << "Number of utterances not given for speaker " << spk;
+          num_train_errs++;
+          continue;
+        }
+        num_examples = num_utts_reader.Value(spk);
+      } else {
+        num_examples = 1;
+      }
+      Vector<BaseFloat> *transformed_ivector = new Vector<BaseFloat>(dim);
+      tot_train_renorm_scale += plda.TransformIvector(plda_config, ivector,
+                                                      num_examples,
+                                                      transformed_ivector);
+      train_keys.push_back(spk);
+      num_train_utts.push_back(num_examples);
+      train_ivectors.push_back(transformed_ivector);
+    }
+    int32 num_train = train_ivectors.size();
+    KALDI_LOG << "Read " << num_train << " training iVectors, "
+              << "errors on " << num_train_errs;
+    if (num_train == 0)
+      KALDI_ERR << "No training iVectors present.";
+    KALDI_LOG << "Average renormalization scale on training iVectors was "
+              << (tot_train_renorm_scale / num_train);
+
+    Matrix<BaseFloat> train_mat(num_train, dim);
+    for (int32 i = 0; i < num_train; i++) {
+      train_mat.Row(i).CopyFromVec(*(train_ivectors[i]));
+      delete train_ivectors[i];
+    }
+    PldaBatchedScorer scorer(plda, train_mat, num_train_utts);
+    train_mat.Resize(0, 0);
+
+    if (!train_keys_wxfilename.empty()) {
+      Output ko(train_keys_wxfilename, false);
+      for (int32 i = 0; i < num_train; i++)
+        ko.Stream() << train_keys[i] << '\n';
+    }
+
+    bool binary = false;
+    Output ko;
+    BaseFloatVectorWriter vector_writer;
+    if (vector_output)
+      vector_writer.Open(scores_wxfilename);
+    else
+      ko.Open(scores_wxfilename, binary, false);
+
+    RandomAccessTokenReader utt2spk_reader(utt2spk_rspecifier);
+    ScoreHistogram hist(resolution);
+    std::map<std::string, int32> train_key_to_index;
+    for (int32 i = 0; i < num_train; i++)
+      train_key_to_index[train_keys[i]] = i;
+    int64 num_no_spk = 0;
+
+    SequentialBaseFloatVectorReader test_ivector_reader(test_ivector_rspecifier);
+    std::vector<std::string> test_keys;
+    Matrix<BaseFloat> test_mat(batch_size, dim);
+    while (true) {
+      // Read the next batch of test iVectors.
+      test_keys.clear();
+      for (; !test_ivector_reader.Done() &&
+               static_cast<int32>(test_keys.size()) < batch_size;
+           test_ivector_reader.Next()) {
+        const Vector<BaseFloat> &ivector = test_ivector_reader.Value();
+        SubVector<BaseFloat> transformed_ivector(test_mat, test_keys.size());
+        int32 num_examples = 1;  // always 1 for test; see ivector-plda-scoring.
+        tot_test_renorm_scale += plda.TransformIvector(plda_config, ivector,
+                                                       num_examples,
+                                                       &transformed_ivector);
+        test_keys.push_back(test_ivector_reader.Key());
+      }
+      int32 this_batch = test_keys.size();
+      if (this_batch == 0) break;
+      num_test_ivectors += this_batch;
+      CuMatrix<BaseFloat> test_cu(test_mat.RowRange(0, this_batch));
+
+      if (top_k > 0) {
+        std::vector<std::vector<std::pair<int32, BaseFloat> > > best;
+        scorer.ScoreTopK(test_cu, top_k, &best);
+        for (int32 j = 0; j < this_batch; j++) {
+          for (size_t r = 0; r < best[j].size(); r++) {
+            BaseFloat score = best[j][r].second;
+            ko.Stream() << train_keys[best[j][r].first] << ' ' << test_keys[j]
+                        << ' ' << score << '\n';
+            sum += score;
+            sumsq += score * score;
+            num_scores++;
+          }
+        }
+      } else {
+        CuMatrix<BaseFloat> scores_cu;
+        scorer.Score(test_cu, &scores_cu);
+        Matrix<BaseFloat> scores(scores_cu);
+        for (int32 j = 0; j < this_batch; j++) {
+          SubVector<BaseFloat> this_scores(scores, j);
+          if (vector_output) {
+            vector_writer.Write(test_keys[j], Vector<BaseFloat>(this_scores));
+          } else {
+            for (int32 i = 0; i < num_train; i++)
+              ko.Stream() << train_keys[i] << ' ' << test_keys[j] << ' '
+                          << this_scores(i) << '\n';
+          }
+          if (!histogram_wxfilename.empty()) {
+            // The index of the training iVector of this test iVector's
+            // speaker, or -1 if there is none.
+            int32 target_index = -1;
+            if (!utt2spk_reader.HasKey(test_keys[j])) {
+              num_no_spk++;
+            } else {
+              std::map<std::string, int32>::const_iterator iter =
+                  train_key_to_index.find(utt2spk_reader.Value(test_keys[j]));
+              if (iter != train_key_to_index.end()) target_index = iter->second;
+            }
+            for (int32 i = 0; i < num_train; i++)
+              hist.AddScore(this_scores(i), (i == target_index));
+          }
+          sum += this_scores.Sum();
+          sumsq += VecVec(this_scores, this_scores);
+        }
+        num_scores += static_cast<int64>(this_batch) * num_train;
+      }
+    }
+    if (num_test_ivectors == 0)
+      KALDI_ERR << "No test iVectors present.";
+    KALDI_LOG << "Read " << num_test_ivectors << " test iVectors; average "
+              << "renormalization scale was "
+              << (tot_test_renorm_scale / num_test_ivectors);
+
+    BaseFloat mean = sum / num_scores, scatter = sumsq / num_scores,
+        variance = scatter - mean * mean, stddev = sqrt(variance);
+    KALDI_LOG << "Output " << num_scores << " scores; mean score was " << mean
+              << ", standard deviation was " << stddev;
+    if (!histogram_wxfilename.empty()) {
+      if (num_no_spk > 0)
+        KALDI_WARN << "No speaker given in utt2spk for " << num_no_spk
+                   << " test iVectors; their scores are all non-target.";
+      WriteKaldiObject(hist, histogram_wxfilename, true);
+      KALDI_LOG << "Wrote histogram of " << hist.NumTarget() << " target and "
+                << hist.NumNontarget() << " non-target scores to "
+                << histogram_wxfilename;
+    }
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().PrintProfile();
+#endif
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
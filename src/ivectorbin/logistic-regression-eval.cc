@@ -24,7 +24,27 @@
 
 using namespace kaldi;
 
-int ComputeLogPosteriors(ParseOptions &po, const LogisticRegressionConfig &config) {
+// Computes the log posteriors of the vectors in "keys" and "vectors" with a
+// single call to GetLogPosteriors, writes them, and clears the buffers.
+void WriteLogPosteriorsForBatch(LogisticRegression *classifier,
+                                std::vector<std::string> *keys,
+                                std::vector<Vector<BaseFloat> > *vectors,
+                                BaseFloatVectorWriter *posterior_writer) {
+  if (keys->empty()) return;
+  Matrix<BaseFloat> xs(vectors->size(), (*vectors)[0].Dim());
+  for (size_t i = 0; i < vectors->size(); i++)
+    xs.Row(i).CopyFromVec((*vectors)[i]);
+  Matrix<BaseFloat> log_posteriors;
+  classifier->GetLogPosteriors(xs, &log_posteriors);
+  for (size_t i = 0; i < keys->size(); i++)
+    posterior_writer->Write((*keys)[i],
+                            Vector<BaseFloat>(log_posteriors.Row(i)));
+  keys->clear();
+  vectors->clear();
+}
+
+int ComputeLogPosteriors(ParseOptions &po, const LogisticRegressionConfig &config,
+                         int32 batch_size) {
   std::string model = po.GetArg(1),
       vector_rspecifier = po.GetArg(2),
       log_posteriors_wspecifier = po.GetArg(3);
@@ -39,13 +59,19 @@ int ComputeLogPosteriors(ParseOptions &po, const LogisticRegressionConfig &confi
   int32 num_utt_done = 0;
 
   for (; !vector_reader.Done(); vector_reader.Next()) {
-    std::string utt = vector_reader.Key();
     const Vector<BaseFloat> &vector = vector_reader.Value();
-    Vector<BaseFloat> log_posteriors;
-    classifier.GetLogPosteriors(vector, &log_posteriors);
-    posterior_writer.Write(utt, log_posteriors);
+    if (!vectors.empty() && vector.Dim() != vectors[0].Dim())
+      WriteLogPosteriorsForBatch(&classifier, &utt_list, &vectors,
+                                 &posterior_writer);
+    utt_list.push_back(vector_reader.Key());
+    vectors.push_back(vector);
+    if (static_cast<int32>(vectors.size()) >= batch_size)
+      WriteLogPosteriorsForBatch(&classifier, &utt_list, &vectors,
+                                 &posterior_writer);
     num_utt_done++;
   }
+  WriteLogPosteriorsForBatch(&classifier, &utt_list, &vectors,
+                             &posterior_writer);
   KALDI_LOG << "Calculated log posteriors for " << num_utt_done << " vectors.";
   return (num_utt_done == 0 ? 1 : 0);
 }
@@ -123,8 +149,12 @@ int main(int argc, char *argv[]) {
   bool binary = false;
   LogisticRegressionConfig config;
   config.Register(&po);
+  int32 batch_size = 1000;
   po.Register("binary", &binary, "Write output in binary mode");
+  po.Register("batch-size", &batch_size, "Number of vectors whose log "
+              "posteriors are computed together (first usage only).");
   po.Read(argc, argv);
+  KALDI_ASSERT(batch_size > 0);
 
   if (po.NumArgs() != 3 && po.NumArgs() != 4) {
     po.PrintUsage();
@@ -133,7 +163,7 @@ int main(int argc, char *argv[]) {
   
   return (po.NumArgs() == 4) ?
       ComputeScores(po, config) :
-      ComputeLogPosteriors(po, config);
+      ComputeLogPosteriors(po, config, batch_size);
   } catch(const std::exception &e) {
     std::cerr << e.what();
     return -1;
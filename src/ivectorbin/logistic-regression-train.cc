@@ -21,6 +21,7 @@
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "ivector/logistic-regression.h"
+#include "thread/kaldi-thread.h"
 
 
 int main(int argc, char *argv[]) {
@@ -41,6 +42,8 @@ int main(int argc, char *argv[]) {
     LogisticRegressionConfig config;
     config.Register(&po);
     po.Register("binary", &binary, "Write output in binary mode");
+    po.Register("num-threads", &g_num_threads, "Number of threads used to "
+                "compute the objective function and gradient.");
     po.Read(argc, argv);
     
     if (po.NumArgs() != 3) {
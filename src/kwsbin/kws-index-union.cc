@@ -23,6 +23,41 @@
 #include "fstext/fstext-utils.h"
 #include "lat/kaldi-kws.h"
 #include "lat/kws-functions.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+// Optimizes one shard of the index; used with TaskSequencer, so the shards
+// are optimized in parallel and written in order by the destructor.
+class OptimizeShardTask {
+ public:
+  OptimizeShardTask(const std::string &key, bool skip_opt, int32 max_states,
+                    const KwsLexicographicFst &index,
+                    TableWriter< fst::VectorFstTplHolder<KwsLexicographicArc> >
+                    *index_writer):
+      key_(key), skip_opt_(skip_opt), max_states_(max_states),
+      index_(index), index_writer_(index_writer) { }
+
+  void operator () () {
+    // Do the encoded epsilon removal, determinization and minimization.
+    // allow_partial == false: if determinization fails we keep the
+    // union as it is, which should affect the speed of search but not
+    // the results.
+    if (!skip_opt_)
+      OptimizeFactorTransducer(&index_, max_states_, false);
+  }
+
+  ~OptimizeShardTask() { index_writer_->Write(key_, index_); }
+
+ private:
+  std::string key_;
+  bool skip_opt_;
+  int32 max_states_;
+  KwsLexicographicFst index_;
+  TableWriter< fst::VectorFstTplHolder<KwsLexicographicArc> > *index_writer_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -35,18 +70,36 @@ int main(int argc, char *argv[]) {
         "Take a union of the indexed lattices. The input index is in the T*T*T semiring and\n"
         "the output index is also in the T*T*T semiring. At the end of this program, encoded\n"
         "epsilon removal, determinization and minimization will be applied.\n"
+        "With --num-shards=N > 1, the input indices are divided (round-robin) into N\n"
+        "shards, each of which is unioned and optimized separately (in parallel, with\n"
+        "--num-threads), and written with key <shard-prefix>.1 ... <shard-prefix>.N;\n"
+        "this avoids the super-linear cost of optimizing one big union.  kws-search\n"
+        "searches all the entries of the index archive, so new audio can be added to\n"
+        "an existing index by indexing it with a different --shard-prefix and\n"
+        "appending the output archive to the existing one.\n"
         "\n"
         "Usage: kws-index-union [options]  index-rspecifier index-wspecifier\n"
-        " e.g.: kws-index-union ark:input.idx ark:global.idx\n";
+        " e.g.: kws-index-union ark:input.idx ark:global.idx\n"
+        "       kws-index-union --num-shards=8 --num-threads=8 --shard-prefix=batch2 \\\n"
+        "         ark:new.idx ark:- >> global.idx\n";
 
     ParseOptions po(usage);
 
     bool strict = true;
     bool skip_opt = false;
     int32 max_states = -1;
+    int32 num_shards = 1;
+    std::string shard_prefix = "global";
+    TaskSequencerConfig sequencer_config; // has --num-threads option
     po.Register("strict", &strict, "Will allow 0 lattice if it is set to false.");
     po.Register("skip-optimization", &skip_opt, "Skip optimization if it's set to true.");
     po.Register("max-states", &max_states, "Maximum states for DeterminizeStar.");
+    po.Register("num-shards", &num_shards, "Number of separate index shards to "
+                "create.");
+    po.Register("shard-prefix", &shard_prefix, "Key of the output index; if "
+                "--num-shards > 1, the keys are <shard-prefix>.1, "
+                "<shard-prefix>.2, etc.");
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -54,6 +107,8 @@ int main(int argc, char *argv[]) {
       po.PrintUsage();
       exit(1);
     }
+    if (num_shards < 1)
+      KALDI_ERR << "Invalid --num-shards=" << num_shards;
 
     std::string index_rspecifier = po.GetArg(1),
         index_wspecifier = po.GetOptArg(2);
@@ -62,38 +117,37 @@ int main(int argc, char *argv[]) {
     TableWriter< VectorFstTplHolder<KwsLexicographicArc> > index_writer(index_wspecifier);
 
     int32 n_done = 0;
-    KwsLexicographicFst global_index;
+    std::vector<KwsLexicographicFst> shards(num_shards);
     for (; !index_reader.Done(); index_reader.Next()) {
       std::string key = index_reader.Key();
       KwsLexicographicFst index = index_reader.Value();
       index_reader.FreeCurrent();
 
-      Union(&global_index, index);
+      Union(&(shards[n_done % num_shards]), index);
 
       n_done++;
     }
 
-    if (skip_opt == false) {
-      // Do the encoded epsilon removal, determinization and minimization
-      KwsLexicographicFst ifst = global_index;
-      EncodeMapper<KwsLexicographicArc> encoder(kEncodeLabels, ENCODE);
-      Encode(&ifst, &encoder);
-      try {
-        DeterminizeStar(ifst, &global_index, kDelta, NULL, max_states);
-      } catch(const std::exception &e) {
-        KALDI_WARN << e.what()
-                   << " (should affect speed of search but not results)";
-        global_index = ifst;
-      }
-      Minimize(&global_index);
-      Decode(&global_index, encoder);
-    } else {
+    if (skip_opt)
       KALDI_LOG << "Skipping index optimization...";
+    {
+      TaskSequencer<OptimizeShardTask> sequencer(sequencer_config);
+      for (int32 i = 0; i < num_shards; i++) {
+        std::string key = shard_prefix;
+        if (num_shards > 1) {
+          std::ostringstream ostr;
+          ostr << shard_prefix << '.' << (i + 1);
+          key = ostr.str();
+        }
+        OptimizeShardTask *task = new OptimizeShardTask(
+            key, skip_opt, max_states, shards[i], &index_writer);
+        // Release our copy before the task runs, so the task's copy of the
+        // FST is not shared with this thread.
+        shards[i] = KwsLexicographicFst();
+        sequencer.Run(task);
+      }
     }
 
-    // Write the result
-    index_writer.Write("global", global_index);
-
     KALDI_LOG << "Done " << n_done << " indices";
     if (strict == true)
       return (n_done != 0 ? 0 : 1);
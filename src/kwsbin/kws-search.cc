@@ -22,6 +22,7 @@
 #include "util/common-utils.h"
 #include "fstext/fstext-utils.h"
 #include "lat/kaldi-kws.h"
+#include "thread/kaldi-task-sequence.h"
 
 namespace kaldi {
 
@@ -68,6 +69,333 @@ class VectorFstToKwsLexicographicFstMapper {
   uint64 Properties(uint64 props) const { return props; }
 };
 
+typedef std::vector<std::pair<std::string, fst::VectorFst<fst::StdArc> > >
+    KeywordList;
+
+// Searches one index (or one shard of an index) for keywords.
+class KwsIndexSearcher {
+ public:
+  // Modifies "index".
+  explicit KwsIndexSearcher(KwsLexicographicFst *index): index_(index) {
+    using namespace fst;
+    // First we have to remove the disambiguation symbols. But rather than
+    // removing them totally, we actually move them from input side to output
+    // side, making the output symbol a "combined" symbol of the disambiguation
+    // symbols and the utterance id's.
+    // Note that in Dogan and Murat's original paper, they simply remove the
+    // disambiguation symbol on the input symbol side, which will not allow us
+    // to do epsilon removal after composition with the keyword FST. They have
+    // to traverse the resulting FST.
+    int32 label_count = 1;
+    std::tr1::unordered_map<uint64, uint32> label_encoder;
+    for (StateIterator<KwsLexicographicFst> siter(*index); !siter.Done(); siter.Next()) {
+      StateId state_id = siter.Value();
+      for (MutableArcIterator<KwsLexicographicFst> 
+           aiter(index, state_id); !aiter.Done(); aiter.Next()) {
+        Arc arc = aiter.Value();
+        // Skip the non-final arcs
+        if (index->Final(arc.nextstate) == Weight::Zero())
+          continue;
+        // Encode the input and output label of the final arc, and this is the
+        // new output label for this arc; set the input label to <epsilon>
+        uint64 osymbol = EncodeLabel(arc.ilabel, arc.olabel);
+        arc.ilabel = 0;
+        if (label_encoder.find(osymbol) == label_encoder.end()) {
+          arc.olabel = label_count;
+          label_encoder[osymbol] = label_count;
+          label_decoder_[label_count] = osymbol;
+          label_count++;
+        } else { 
+          arc.olabel = label_encoder[osymbol];
+        }
+        aiter.SetValue(arc);
+      }
+    }
+    ArcSort(index, fst::ILabelCompare<KwsLexicographicArc>());
+  }
+
+  // Appends the results for "keyword" to "results", each as (utterance_id,
+  // beg_frame, end_frame, score).  Returns the number of results with an
+  // unexpected structure, which are skipped.
+  int32 Search(const std::string &key, const fst::VectorFst<fst::StdArc> &keyword,
+               int32 n_best, double negative_tolerance,
+               std::vector<std::vector<double> > *results) {
+    using namespace fst;
+    KwsLexicographicFst keyword_fst;
+    KwsLexicographicFst result_fst;
+    Map(keyword, &keyword_fst, VectorFstToKwsLexicographicFstMapper());
+    Compose(keyword_fst, *index_, &result_fst);
+    Project(&result_fst, PROJECT_OUTPUT);
+    return GetResults(key, n_best, negative_tolerance, &result_fst, results);
+  }
+
+  // Searches for keywords[begin] ... keywords[end-1] with one composition
+  // with the index, and appends the results for keywords[i] to (*results)[i].
+  // The keywords are merged into one query FST, each followed by a "marker"
+  // arc whose input label identifies it, and determinized so that keywords
+  // with a common prefix share the states for it; thus the part of the index
+  // that matches a prefix is only traversed once.  The result of the
+  // composition is then split up by marker.  Returns the number of results
+  // with an unexpected structure.
+  int32 SearchBatch(const KeywordList &keywords, size_t begin, size_t end,
+                    int32 n_best, double negative_tolerance,
+                    std::vector<std::vector<std::vector<double> > > *results) {
+    using namespace fst;
+    typedef StdArc::StateId QueryStateId;
+    // The markers must not clash with the input labels of the keywords.
+    int32 marker_offset = 1;
+    for (size_t i = begin; i < end; i++) {
+      const VectorFst<StdArc> &keyword = keywords[i].second;
+      for (StateIterator<VectorFst<StdArc> > siter(keyword); !siter.Done(); siter.Next())
+        for (ArcIterator<VectorFst<StdArc> > aiter(keyword, siter.Value());
+             !aiter.Done(); aiter.Next())
+          marker_offset = std::max(marker_offset, aiter.Value().ilabel + 1);
+    }
+
+    // Build the union of the keywords, with the marker arcs.
+    VectorFst<StdArc> query;
+    QueryStateId query_start = query.AddState();
+    query.SetStart(query_start);
+    for (size_t i = begin; i < end; i++) {
+      const VectorFst<StdArc> &keyword = keywords[i].second;
+      if (keyword.Start() == kNoStateId) continue;
+      QueryStateId offset = query.NumStates(),
+          final_state = offset + keyword.NumStates();
+      for (QueryStateId s = 0; s <= keyword.NumStates(); s++)
+        query.AddState();
+      query.SetFinal(final_state, TropicalWeight::One());
+      query.AddArc(query_start, StdArc(0, 0, TropicalWeight::One(),
+                                       offset + keyword.Start()));
+      for (StateIterator<VectorFst<StdArc> > siter(keyword); !siter.Done(); siter.Next()) {
+        QueryStateId s = siter.Value();
+        for (ArcIterator<VectorFst<StdArc> > aiter(keyword, s);
+             !aiter.Done(); aiter.Next()) {
+          StdArc arc = aiter.Value();
+          arc.nextstate += offset;
+          query.AddArc(offset + s, arc);
+        }
+        TropicalWeight final_weight = keyword.Final(s);
+        if (final_weight != TropicalWeight::Zero())
+          query.AddArc(offset + s, StdArc(marker_offset + (i - begin), 0,
+                                          final_weight, final_state));
+      }
+    }
+    // Turn the union into a prefix tree.  The keywords are acyclic, so this
+    // is determinizable.
+    RmEpsilon(&query);
+    EncodeMapper<StdArc> encoder(kEncodeLabels, ENCODE);
+    Encode(&query, &encoder);
+    VectorFst<StdArc> det_query;
+    Determinize(query, &det_query);
+    Decode(&det_query, encoder);
+
+    KwsLexicographicFst query_fst, composed;
+    Map(det_query, &query_fst, VectorFstToKwsLexicographicFstMapper());
+    Compose(query_fst, *index_, &composed);
+    if (composed.Start() == kNoStateId)
+      return 0; // No result found
+    // The query and the index are acyclic, so this succeeds.
+    TopSort(&composed);
+
+    // keyword_of_state[s] is the keyword (minus "begin") if state s comes after
+    // a marker arc, else -1; the states after a marker are specific to that
+    // keyword.  For the others, reachable[s] is the sorted list of keywords
+    // whose markers can be reached from s.
+    StateId num_states = composed.NumStates();
+    std::vector<int32> keyword_of_state(num_states, -1);
+    for (StateId s = 0; s < num_states; s++) {
+      for (ArcIterator<KwsLexicographicFst> aiter(composed, s);
+           !aiter.Done(); aiter.Next()) {
+        const Arc &arc = aiter.Value();
+        if (arc.ilabel >= marker_offset)
+          keyword_of_state[arc.nextstate] = arc.ilabel - marker_offset;
+        else if (keyword_of_state[s] != -1)
+          keyword_of_state[arc.nextstate] = keyword_of_state[s];
+      }
+    }
+    std::vector<std::vector<int32> > reachable(num_states);
+    for (StateId s = num_states - 1; s >= 0; s--) {
+      if (keyword_of_state[s] != -1) continue;
+      std::vector<int32> &this_reachable = reachable[s];
+      for (ArcIterator<KwsLexicographicFst> aiter(composed, s);
+           !aiter.Done(); aiter.Next()) {
+        const Arc &arc = aiter.Value();
+        if (arc.ilabel >= marker_offset) {
+          this_reachable.push_back(arc.ilabel - marker_offset);
+        } else if (keyword_of_state[arc.nextstate] == -1) {
+          const std::vector<int32> &next_reachable = reachable[arc.nextstate];
+          this_reachable.insert(this_reachable.end(), next_reachable.begin(),
+                                next_reachable.end());
+        }
+      }
+      SortAndUniq(&this_reachable);
+    }
+
+    // For each keyword, copy the part of "composed" that is on the paths
+    // through its marker, projected on the output, and get the results.
+    int32 n_fail = 0;
+    for (size_t i = begin; i < end; i++) {
+      int32 k = i - begin;
+      if (!IsOnPath(keyword_of_state, reachable, composed.Start(), k))
+        continue;
+      KwsLexicographicFst result_fst;
+      std::tr1::unordered_map<StateId, StateId> state_map;
+      std::vector<StateId> queue;
+      state_map[composed.Start()] = result_fst.AddState();
+      result_fst.SetStart(0);
+      queue.push_back(composed.Start());
+      while (!queue.empty()) {
+        StateId s = queue.back();
+        queue.pop_back();
+        StateId new_s = state_map[s];
+        result_fst.SetFinal(new_s, composed.Final(s));
+        for (ArcIterator<KwsLexicographicFst> aiter(composed, s);
+             !aiter.Done(); aiter.Next()) {
+          Arc arc = aiter.Value();
+          if (!IsOnPath(keyword_of_state, reachable, arc.nextstate, k))
+            continue;
+          std::tr1::unordered_map<StateId, StateId>::iterator iter =
+              state_map.find(arc.nextstate);
+          if (iter == state_map.end()) {
+            iter = state_map.insert(std::make_pair(arc.nextstate,
+                                                   result_fst.AddState())).first;
+            queue.push_back(arc.nextstate);
+          }
+          arc.ilabel = arc.olabel; // as Project(PROJECT_OUTPUT).
+          arc.nextstate = iter->second;
+          result_fst.AddArc(new_s, arc);
+        }
+      }
+      n_fail += GetResults(keywords[i].first, n_best, negative_tolerance,
+                           &result_fst, &((*results)[i]));
+    }
+    return n_fail;
+  }
+
+ private:
+  // Used in SearchBatch(): true if state s is on a path through the marker
+  // of keyword k.
+  static bool IsOnPath(const std::vector<int32> &keyword_of_state,
+                       const std::vector<std::vector<int32> > &reachable,
+                       StateId s, int32 k) {
+    if (keyword_of_state[s] != -1)
+      return keyword_of_state[s] == k;
+    return std::binary_search(reachable[s].begin(), reachable[s].end(), k);
+  }
+
+  // Finds the n best paths of "result_fst", which is the result of composing
+  // a keyword with the index, projected on the output; appends them to
+  // "results", each as (utterance_id, beg_frame, end_frame, score).  Returns
+  // the number of results with an unexpected structure, which are skipped.
+  int32 GetResults(const std::string &key, int32 n_best,
+                   double negative_tolerance, KwsLexicographicFst *result_fst,
+                   std::vector<std::vector<double> > *results) {
+    using namespace fst;
+    Minimize(result_fst);
+    ShortestPath(*result_fst, result_fst, n_best);
+    RmEpsilon(result_fst);
+
+    // No result found
+    if (result_fst->Start() == kNoStateId)
+      return 0;
+
+    // Got something here
+    int32 n_fail = 0;
+    double score;
+    int32 tbeg, tend, uid;
+    for (ArcIterator<KwsLexicographicFst> 
+         aiter(*result_fst, result_fst->Start()); !aiter.Done(); aiter.Next()) {
+      const Arc &arc = aiter.Value();
+
+      // We're expecting a two-state FST
+      if (result_fst->Final(arc.nextstate) != Weight::One()) {
+        KALDI_WARN << "The resulting FST does not have the expected structure for key " << key;
+        n_fail++;
+        continue;
+      }
+
+      uint64 osymbol = label_decoder_[arc.olabel];
+      uid = (int32)DecodeLabelUid(osymbol);
+      tbeg = arc.weight.Value2().Value1().Value();
+      tend = arc.weight.Value2().Value2().Value();
+      score = arc.weight.Value1().Value();
+
+      if (score < 0) {
+        if (score < negative_tolerance) {
+          KALDI_WARN << "Score out of expected range: " << score;
+        }
+        score = 0.0;
+      }
+      vector<double> result;
+      result.push_back(uid);
+      result.push_back(tbeg);
+      result.push_back(tend);
+      result.push_back(score);
+      results->push_back(result);
+    }
+    return n_fail;
+  }
+
+  KwsLexicographicFst *index_;
+  std::tr1::unordered_map<uint32, uint64> label_decoder_;
+};
+
+// Searches one shard of the index for all the keywords; used with
+// TaskSequencer so that the shards are searched in parallel.  The destructor
+// adds the results to the per-keyword lists, in shard order.
+class SearchShardTask {
+ public:
+  SearchShardTask(const KwsLexicographicFst &index, const KeywordList &keywords,
+                  int32 batch_size, int32 n_best, double negative_tolerance,
+                  std::vector<std::vector<std::vector<double> > > *all_results,
+                  int32 *n_fail):
+      index_(index), keywords_(keywords), batch_size_(batch_size),
+      n_best_(n_best),
+      negative_tolerance_(negative_tolerance), results_(keywords.size()),
+      all_results_(all_results), n_fail_(0), tot_n_fail_(n_fail) { }
+
+  void operator () () {
+    KwsIndexSearcher searcher(&index_);
+    if (batch_size_ > 1) {
+      for (size_t begin = 0; begin < keywords_.size(); begin += batch_size_) {
+        size_t end = std::min(keywords_.size(), begin + batch_size_);
+        n_fail_ += searcher.SearchBatch(keywords_, begin, end, n_best_,
+                                        negative_tolerance_, &results_);
+      }
+    } else {
+      for (size_t i = 0; i < keywords_.size(); i++)
+        n_fail_ += searcher.Search(keywords_[i].first, keywords_[i].second,
+                                   n_best_, negative_tolerance_, &(results_[i]));
+    }
+  }
+
+  ~SearchShardTask() {
+    for (size_t i = 0; i < results_.size(); i++)
+      (*all_results_)[i].insert((*all_results_)[i].end(),
+                                results_[i].begin(), results_[i].end());
+    *tot_n_fail_ += n_fail_;
+  }
+
+ private:
+  KwsLexicographicFst index_;
+  const KeywordList &keywords_;
+  int32 batch_size_;
+  int32 n_best_;
+  double negative_tolerance_;
+  std::vector<std::vector<std::vector<double> > > results_;
+  std::vector<std::vector<std::vector<double> > > *all_results_;
+  int32 n_fail_;
+  int32 *tot_n_fail_;
+};
+
+// For sorting results from several shards: best (lowest) score first.
+struct CompareResultScore {
+  bool operator() (const std::vector<double> &a,
+                   const std::vector<double> &b) const {
+    return a[3] < b[3];
+  }
+};
+
 }
 
 int main(int argc, char *argv[]) {
@@ -84,7 +412,9 @@ int main(int argc, char *argv[]) {
     const char *usage =
         "Search the keywords over the index. This program can be executed parallely, either\n"
         "on the index side or the keywords side; we use a script to combine the final search\n"
-        "results. Note that the index archive has a only key \"global\".\n"
+        "results. The index archive may contain several shards (see kws-index-union\n"
+        "--num-shards), which are all searched, in parallel with --num-threads; usually\n"
+        "it has the single key \"global\".\n"
         "The output file is in the format:\n"
         "kw utterance_id beg_frame end_frame negated_log_probs\n"
         " e.g.: KW1 1 23 67 0.6074219\n"
@@ -99,6 +429,8 @@ int main(int argc, char *argv[]) {
     bool strict = true;
     double negative_tolerance = -0.1;
     double keyword_beam = -1;
+    int32 batch_size = 1;
+    TaskSequencerConfig sequencer_config; // has --num-threads option
     
     po.Register("nbest", &n_best, "Return the best n hypotheses.");
     po.Register("keyword-nbest", &keyword_nbest,
@@ -109,6 +441,11 @@ int main(int argc, char *argv[]) {
                 "than this tolerance.");
     po.Register("keyword-beam", &keyword_beam,
                 "Prune the FST with the given beam if the FST contains multiple keywords.");
+    po.Register("batch-size", &batch_size, "If > 1, search for this many "
+                "keywords at once: they are merged into one query FST, so the "
+                "search of the index is shared between keywords with common "
+                "prefixes.");
+    sequencer_config.Register(&po);
 
     if (n_best < 0 && n_best != -1) {
       KALDI_ERR << "Bad number for nbest";
@@ -134,51 +471,13 @@ int main(int argc, char *argv[]) {
         keyword_rspecifier = po.GetOptArg(2),
         result_wspecifier = po.GetOptArg(3);
 
-    RandomAccessTableReader< VectorFstTplHolder<KwsLexicographicArc> > index_reader(index_rspecifier);
+    SequentialTableReader< VectorFstTplHolder<KwsLexicographicArc> > index_reader(index_rspecifier);
     SequentialTableReader<VectorFstHolder> keyword_reader(keyword_rspecifier);
     TableWriter< BasicVectorHolder<double> > result_writer(result_wspecifier);
 
-    // Index has key "global"
-    KwsLexicographicFst index = index_reader.Value("global");
-    
-    // First we have to remove the disambiguation symbols. But rather than
-    // removing them totally, we actually move them from input side to output
-    // side, making the output symbol a "combined" symbol of the disambiguation
-    // symbols and the utterance id's.
-    // Note that in Dogan and Murat's original paper, they simply remove the
-    // disambiguation symbol on the input symbol side, which will not allow us
-    // to do epsilon removal after composition with the keyword FST. They have
-    // to traverse the resulting FST.
-    int32 label_count = 1;
-    std::tr1::unordered_map<uint64, uint32> label_encoder;
-    std::tr1::unordered_map<uint32, uint64> label_decoder;
-    for (StateIterator<KwsLexicographicFst> siter(index); !siter.Done(); siter.Next()) {
-      StateId state_id = siter.Value();
-      for (MutableArcIterator<KwsLexicographicFst> 
-           aiter(&index, state_id); !aiter.Done(); aiter.Next()) {
-        Arc arc = aiter.Value();
-        // Skip the non-final arcs
-        if (index.Final(arc.nextstate) == Weight::Zero())
-          continue;
-        // Encode the input and output label of the final arc, and this is the
-        // new output label for this arc; set the input label to <epsilon>
-        uint64 osymbol = EncodeLabel(arc.ilabel, arc.olabel);
-        arc.ilabel = 0;
-        if (label_encoder.find(osymbol) == label_encoder.end()) {
-          arc.olabel = label_count;
-          label_encoder[osymbol] = label_count;
-          label_decoder[label_count] = osymbol;
-          label_count++;
-        } else { 
-          arc.olabel = label_encoder[osymbol];
-        }
-        aiter.SetValue(arc);
-      }
-    }
-    ArcSort(&index, fst::ILabelCompare<KwsLexicographicArc>());
-    
-    int32 n_done = 0;
-    int32 n_fail = 0;
+    // We read all the keywords first, as we search each shard of the index
+    // for all of them.
+    KeywordList keywords;
     for (; !keyword_reader.Done(); keyword_reader.Next()) {
       std::string key = keyword_reader.Key();
       VectorFst<StdArc> keyword = keyword_reader.Value();
@@ -193,54 +492,39 @@ int main(int argc, char *argv[]) {
         ShortestPath(keyword, &tmp, keyword_nbest, true, true);
         keyword = tmp;
       }
+      keywords.push_back(std::make_pair(key, keyword));
+    }
 
-      KwsLexicographicFst keyword_fst;
-      KwsLexicographicFst result_fst;
-      Map(keyword, &keyword_fst, VectorFstToKwsLexicographicFstMapper());
-      Compose(keyword_fst, index, &result_fst);
-      Project(&result_fst, PROJECT_OUTPUT);
-      Minimize(&result_fst);
-      ShortestPath(result_fst, &result_fst, n_best);
-      RmEpsilon(&result_fst);
-
-      // No result found
-      if (result_fst.Start() == kNoStateId)
-        continue;
-
-      // Got something here
-      double score;
-      int32 tbeg, tend, uid;
-      for (ArcIterator<KwsLexicographicFst> 
-           aiter(result_fst, result_fst.Start()); !aiter.Done(); aiter.Next()) {
-        const Arc &arc = aiter.Value();
-
-        // We're expecting a two-state FST
-        if (result_fst.Final(arc.nextstate) != Weight::One()) {
-          KALDI_WARN << "The resulting FST does not have the expected structure for key " << key;
-          n_fail++;
-          continue;
-        }
-
-        uint64 osymbol = label_decoder[arc.olabel];
-        uid = (int32)DecodeLabelUid(osymbol);
-        tbeg = arc.weight.Value2().Value1().Value();
-        tend = arc.weight.Value2().Value2().Value();
-        score = arc.weight.Value1().Value();
-
-        if (score < 0) {
-          if (score < negative_tolerance) {
-            KALDI_WARN << "Score out of expected range: " << score;
-          }
-          score = 0.0;
-        }
-        vector<double> result;
-        result.push_back(uid);
-        result.push_back(tbeg);
-        result.push_back(tend);
-        result.push_back(score);
-        result_writer.Write(key, result);
+    // all_results[i] is the list of results for keywords[i], from all shards.
+    std::vector<std::vector<std::vector<double> > > all_results(keywords.size());
+    int32 n_shards = 0;
+    int32 n_fail = 0;
+    {
+      TaskSequencer<SearchShardTask> sequencer(sequencer_config);
+      for (; !index_reader.Done(); index_reader.Next(), n_shards++) {
+        SearchShardTask *task = new SearchShardTask(
+            index_reader.Value(), keywords, batch_size, n_best,
+            negative_tolerance,
+            &all_results, &n_fail);
+        index_reader.FreeCurrent();
+        sequencer.Run(task);
       }
+    }
+    if (n_shards == 0)
+      KALDI_ERR << "No index was read from " << index_rspecifier;
 
+    int32 n_done = 0;
+    for (size_t i = 0; i < keywords.size(); i++) {
+      std::vector<std::vector<double> > &results = all_results[i];
+      if (results.empty()) continue; // No result found
+      if (n_shards > 1 && n_best != -1 &&
+          results.size() > static_cast<size_t>(n_best)) {
+        // Each shard gave its n best; keep the n best overall.
+        std::stable_sort(results.begin(), results.end(), CompareResultScore());
+        results.resize(n_best);
+      }
+      for (size_t j = 0; j < results.size(); j++)
+        result_writer.Write(keywords[i].first, results[j]);
       n_done++;
     }
 
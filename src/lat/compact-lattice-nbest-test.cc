@@ -0,0 +1,88 @@
+// lat/compact-lattice-nbest-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "lat/kaldi-lattice.h"
+#include "lat/compact-lattice-nbest.h"
+#include "fstext/rand-fst.h"
+
+
+namespace kaldi {
+using namespace fst;
+
+// Returns the cost of a linear FST (a single path).
+template<class Arc>
+double LinearPathCost(const VectorFst<Arc> &fst) {
+  typename Arc::StateId s = fst.Start();
+  KALDI_ASSERT(s != kNoStateId);
+  double cost = 0.0;
+  while (fst.NumArcs(s) != 0) {
+    KALDI_ASSERT(fst.NumArcs(s) == 1);
+    ArcIterator<VectorFst<Arc> > aiter(fst, s);
+    cost += ConvertToCost(aiter.Value().weight);
+    s = aiter.Value().nextstate;
+  }
+  return cost + ConvertToCost(fst.Final(s));
+}
+
+void TestCompactLatticeNbest() {
+  RandFstOptions opts;
+  opts.acyclic = true;
+  Lattice *lat = RandPairFst<LatticeArc>(opts);
+  CompactLattice clat;
+  ConvertLattice(*lat, &clat);
+  int32 n = 1 + rand() % 20;
+
+  // Compare the costs with those of the n-best from fst::ShortestPath.
+  std::vector<Lattice> nbest_lats;
+  {
+    Lattice nbest_lat;
+    ShortestPath(*lat, &nbest_lat, n);
+    ConvertNbestToVector(nbest_lat, &nbest_lats);
+  }
+  std::vector<double> ref_costs;
+  for (size_t i = 0; i < nbest_lats.size(); i++)
+    ref_costs.push_back(LinearPathCost(nbest_lats[i]));
+  std::sort(ref_costs.begin(), ref_costs.end());
+
+  CompactLatticeNbestGenerator generator(clat);
+  std::vector<double> costs;
+  CompactLattice path;
+  double cost;
+  while (static_cast<int32>(costs.size()) < n && generator.Next(&path, &cost)) {
+    KALDI_ASSERT(std::abs(cost - LinearPathCost(path)) < 1.0e-04);
+    if (!costs.empty())
+      KALDI_ASSERT(cost >= costs.back() - 1.0e-04);
+    costs.push_back(cost);
+  }
+  KALDI_ASSERT(costs.size() == ref_costs.size() &&
+               generator.NumPaths() == static_cast<int32>(costs.size()));
+  for (size_t i = 0; i < costs.size(); i++)
+    KALDI_ASSERT(std::abs(costs[i] - ref_costs[i]) < 1.0e-04);
+  delete lat;
+}
+
+}  // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 1000; i++)
+    TestCompactLatticeNbest();
+  KALDI_LOG << "Success.";
+}
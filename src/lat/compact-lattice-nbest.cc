@@ -0,0 +1,143 @@
+// lat/compact-lattice-nbest.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <limits>
+
+#include "lat/compact-lattice-nbest.h"
+#include "lat/lattice-functions.h"
+
+namespace kaldi {
+
+CompactLatticeNbestGenerator::CompactLatticeNbestGenerator(
+    const CompactLattice &clat): clat_(clat), num_paths_(0) {
+  TopSortCompactLatticeIfNeeded(&clat_);
+  StateId num_states = clat_.NumStates();
+  // Viterbi costs to the end, which is the A* heuristic.  (Unlike
+  // ComputeCompactLatticeBetas(), which sums over paths.)
+  best_cost_.resize(num_states);
+  for (StateId s = num_states - 1; s >= 0; s--) {
+    double best_cost = ConvertToCost(clat_.Final(s));
+    for (fst::ArcIterator<CompactLattice> aiter(clat_, s); !aiter.Done();
+         aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      best_cost = std::min(best_cost, ConvertToCost(arc.weight) +
+                           best_cost_[arc.nextstate]);
+    }
+    best_cost_[s] = best_cost;
+  }
+  options_.resize(num_states);
+  options_computed_.resize(num_states, false);
+
+  StateId start = clat_.Start();
+  if (start == fst::kNoStateId ||
+      best_cost_[start] == std::numeric_limits<double>::infinity())
+    return;  // No paths.
+  Node root;
+  root.parent = -1;
+  root.option = -1;
+  root.state = start;
+  root.cost = best_cost_[start];
+  nodes_.push_back(root);
+  AddCandidate(0, 0);
+}
+
+const std::vector<CompactLatticeNbestGenerator::Option>&
+CompactLatticeNbestGenerator::GetOptions(StateId s) {
+  std::vector<Option> &options = options_[s];
+  if (!options_computed_[s]) {
+    const double inf = std::numeric_limits<double>::infinity();
+    int32 arc_index = 0;
+    for (fst::ArcIterator<CompactLattice> aiter(clat_, s); !aiter.Done();
+         aiter.Next(), arc_index++) {
+      const Arc &arc = aiter.Value();
+      double cost = ConvertToCost(arc.weight) + best_cost_[arc.nextstate];
+      if (cost != inf)
+        options.push_back(Option(cost - best_cost_[s], arc_index));
+    }
+    double final_cost = ConvertToCost(clat_.Final(s));
+    if (final_cost != inf)
+      options.push_back(Option(final_cost - best_cost_[s], -1));
+    std::sort(options.begin(), options.end());
+    options_computed_[s] = true;
+  }
+  return options;
+}
+
+void CompactLatticeNbestGenerator::AddCandidate(int32 parent, int32 option) {
+  const std::vector<Option> &options = GetOptions(nodes_[parent].state);
+  if (option < static_cast<int32>(options.size()))
+    queue_.push(Candidate(nodes_[parent].cost + options[option].delta,
+                          parent, option));
+}
+
+bool CompactLatticeNbestGenerator::Next(CompactLattice *path, double *cost) {
+  while (!queue_.empty()) {
+    Candidate candidate = queue_.top();
+    queue_.pop();
+    StateId parent_state = nodes_[candidate.parent].state;
+    int32 arc_index = options_[parent_state][candidate.option].arc_index;
+    // The next-best way to continue from the parent.
+    AddCandidate(candidate.parent, candidate.option + 1);
+
+    if (arc_index != -1) {
+      // Extend the partial path by this arc; its best continuation costs
+      // the same, so it is queued with the same cost.
+      fst::ArcIterator<CompactLattice> aiter(clat_, parent_state);
+      aiter.Seek(arc_index);
+      Node node;
+      node.parent = candidate.parent;
+      node.option = candidate.option;
+      node.state = aiter.Value().nextstate;
+      node.cost = candidate.cost;
+      nodes_.push_back(node);
+      AddCandidate(nodes_.size() - 1, 0);
+      continue;
+    }
+
+    // A complete path, ending at parent_state.  Trace back the arcs.
+    std::vector<std::pair<StateId, int32> > arcs;  // (state, arc index).
+    for (int32 n = candidate.parent; nodes_[n].parent != -1;
+         n = nodes_[n].parent) {
+      StateId prev_state = nodes_[nodes_[n].parent].state;
+      arcs.push_back(std::make_pair(
+          prev_state, options_[prev_state][nodes_[n].option].arc_index));
+    }
+    std::reverse(arcs.begin(), arcs.end());
+
+    path->DeleteStates();
+    StateId cur_state = path->AddState();
+    path->SetStart(cur_state);
+    for (size_t i = 0; i < arcs.size(); i++) {
+      fst::ArcIterator<CompactLattice> aiter(clat_, arcs[i].first);
+      aiter.Seek(arcs[i].second);
+      Arc arc = aiter.Value();
+      arc.nextstate = path->AddState();
+      path->AddArc(cur_state, arc);
+      cur_state = arc.nextstate;
+    }
+    path->SetFinal(cur_state, clat_.Final(parent_state));
+    if (cost != NULL) *cost = candidate.cost;
+    num_paths_++;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace kaldi
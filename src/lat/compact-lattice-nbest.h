@@ -0,0 +1,117 @@
+// lat/compact-lattice-nbest.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_LAT_COMPACT_LATTICE_NBEST_H_
+#define KALDI_LAT_COMPACT_LATTICE_NBEST_H_
+
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "fstext/fstext-lib.h"
+#include "lat/kaldi-lattice.h"
+
+namespace kaldi {
+
+/// This class generates the paths of an acyclic CompactLattice in order of
+/// increasing cost, one at a time, so you only pay for the paths you ask
+/// for.  It is an A* search whose heuristic is the exact best cost from each
+/// state to the end, so the search never goes down a dead end; and the
+/// alternatives at each state are sorted once and generated lazily (the
+/// next-best alternative at a state is only queued once the previous one
+/// has been taken), so the memory used is proportional to the number of
+/// paths generated times their length.  Unlike fst::ShortestPath with
+/// nshortest = n, nothing is determinized or expanded in advance, which
+/// matters for large n.
+///
+/// Different paths may have the same word sequence if the lattice was not
+/// determinized, as with fst::ShortestPath.
+class CompactLatticeNbestGenerator {
+ public:
+  /// The lattice must be acyclic; it is topologically sorted if needed.  It
+  /// is copied, so it need not outlive this object.
+  explicit CompactLatticeNbestGenerator(const CompactLattice &clat);
+
+  /// Outputs the next-best path as a linear CompactLattice, and its cost if
+  /// "cost" is non-NULL.  Returns false if there are no more paths.
+  bool Next(CompactLattice *path, double *cost = NULL);
+
+  /// Returns the number of paths output so far.
+  int32 NumPaths() const { return num_paths_; }
+
+ private:
+  typedef CompactLatticeArc Arc;
+  typedef Arc::StateId StateId;
+
+  // One way of continuing from a state: taking the arc with index arc_index,
+  // or ending the path there if arc_index == -1.  "delta" is how much worse
+  // this is than the best way of continuing from the state.
+  struct Option {
+    double delta;
+    int32 arc_index;
+    Option(double delta, int32 arc_index): delta(delta), arc_index(arc_index) { }
+    bool operator < (const Option &other) const { return delta < other.delta; }
+  };
+
+  // A node in the tree of partial paths that have been taken: its path is
+  // the path of node "parent" extended by option "option" of the parent's
+  // state.  The root (the start state) has parent == -1.
+  struct Node {
+    int32 parent;
+    int32 option;
+    StateId state;  // The state reached, or kNoStateId for a complete path.
+    double cost;  // The cost of the best complete path through this node.
+  };
+
+  // A candidate extension of a node, in the priority queue: "option" of the
+  // state of node "parent", with total cost "cost".
+  struct Candidate {
+    double cost;
+    int32 parent;
+    int32 option;
+    Candidate(double cost, int32 parent, int32 option):
+        cost(cost), parent(parent), option(option) { }
+    // Reversed so that std::priority_queue gives the lowest cost first.
+    bool operator < (const Candidate &other) const {
+      return cost > other.cost;
+    }
+  };
+
+  // Queues option "option" of the state of node "parent", if it exists.
+  void AddCandidate(int32 parent, int32 option);
+
+  // Computes options_[s] if not already done.
+  const std::vector<Option> &GetOptions(StateId s);
+
+  CompactLattice clat_;
+  std::vector<double> best_cost_;  // Best cost from each state to the end.
+  // options_[s] contains the options of state s, sorted by delta; it is
+  // computed when s is first reached.
+  std::vector<std::vector<Option> > options_;
+  std::vector<bool> options_computed_;
+  std::vector<Node> nodes_;
+  std::priority_queue<Candidate> queue_;
+  int32 num_paths_;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_LAT_COMPACT_LATTICE_NBEST_H_
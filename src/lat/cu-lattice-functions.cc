@@ -0,0 +1,222 @@
+// lat/cu-lattice-functions.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <limits>
+
+#include "lat/cu-lattice-functions.h"
+#include "lat/lattice-functions.h"
+#include "cudamatrix/cu-levelled-graph.h"
+#include "cudamatrix/cu-vector.h"
+
+namespace kaldi {
+
+typedef CuLevelledGraph<double>::Arc LevelledArc;
+
+// Gets the arcs and final-probs of the lattice in the form needed by class
+// CuLevelledGraph; the arcs are numbered in the order we visit them, and an
+// arc with a transition-id on it has the matrix element (t, pdf-id).  Outputs
+// the transition-id of each arc (zero for epsilons) to "tids" and, if
+// acoustic_like is non-NULL, its acoustic log-likelihood.  Returns the number
+// of frames.
+static int32 GetLevelledArcs(const TransitionModel &trans,
+                             const Lattice &lat,
+                             std::vector<LevelledArc> *arcs,
+                             std::vector<double> *final_like,
+                             std::vector<int32> *tids,
+                             std::vector<double> *acoustic_like) {
+  typedef Lattice::Arc Arc;
+  typedef Arc::Weight Weight;
+  typedef Arc::StateId StateId;
+
+  if (lat.Properties(fst::kTopSorted, true) == 0)
+    KALDI_ERR << "Input lattice must be topologically sorted.";
+  KALDI_ASSERT(lat.Start() == 0);
+
+  int32 num_states = lat.NumStates();
+  std::vector<int32> state_times;
+  int32 max_time = LatticeStateTimes(lat, &state_times);
+  arcs->clear();
+  tids->clear();
+  if (acoustic_like != NULL) acoustic_like->clear();
+  final_like->resize(num_states);
+  for (StateId s = 0; s < num_states; s++) {
+    for (fst::ArcIterator<Lattice> aiter(lat, s); !aiter.Done(); aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      LevelledArc levelled_arc;
+      levelled_arc.src = s;
+      levelled_arc.dest = arc.nextstate;
+      levelled_arc.like = -ConvertToCost(arc.weight);
+      if (arc.ilabel != 0) {
+        levelled_arc.row = state_times[s];
+        levelled_arc.col = trans.TransitionIdToPdf(arc.ilabel);
+      } else {
+        levelled_arc.row = -1;
+        levelled_arc.col = -1;
+      }
+      arcs->push_back(levelled_arc);
+      tids->push_back(arc.ilabel);
+      if (acoustic_like != NULL)
+        acoustic_like->push_back(-arc.weight.Value2());
+    }
+    Weight f = lat.Final(s);
+    if (f != Weight::Zero()) {
+      (*final_like)[s] = -(f.Value1() + f.Value2());
+      KALDI_ASSERT(state_times[s] == max_time &&
+                   "Lattice is inconsistent (final-prob not at max_time)");
+    } else {
+      (*final_like)[s] = -std::numeric_limits<double>::infinity();
+    }
+  }
+  return max_time;
+}
+
+// Copies the double-precision posteriors to "post".
+static void CopyPosteriors(const CuMatrix<double> &post_double,
+                           CuMatrix<BaseFloat> *post) {
+  post->Resize(post_double.NumRows(), post_double.NumCols(), kUndefined);
+  post->CopyFromMat(post_double);
+}
+
+
+BaseFloat LatticeForwardBackwardCuda(const TransitionModel &trans,
+                                     const Lattice &lat,
+                                     CuMatrix<BaseFloat> *post,
+                                     double *acoustic_like_sum) {
+  std::vector<LevelledArc> arcs;
+  std::vector<double> final_like, acoustic_like;
+  std::vector<int32> tids;
+  int32 num_frames = GetLevelledArcs(trans, lat, &arcs, &final_like, &tids,
+                                     (acoustic_like_sum != NULL ?
+                                      &acoustic_like : NULL));
+  CuLevelledGraph<double> graph(lat.NumStates(), arcs, final_like);
+  CuVector<double> arc_post;
+  double tot_like = graph.ForwardBackward(&arc_post);
+
+  CuMatrix<double> post_double(num_frames, trans.NumPdfs());
+  graph.AddArcPostToMatrix(arc_post, 1.0, &post_double);
+  CopyPosteriors(post_double, post);
+  if (acoustic_like_sum != NULL) {
+    Vector<double> acoustic_like_vec(acoustic_like.size());
+    std::copy(acoustic_like.begin(), acoustic_like.end(),
+              acoustic_like_vec.Data());
+    *acoustic_like_sum = VecVec(arc_post, CuVector<double>(acoustic_like_vec));
+  }
+  return tot_like;
+}
+
+
+BaseFloat LatticeForwardBackwardMpeVariantsCuda(
+    const TransitionModel &trans,
+    const std::vector<int32> &silence_phones,
+    const Lattice &lat,
+    const std::vector<int32> &num_ali,
+    std::string criterion,
+    CuMatrix<BaseFloat> *post) {
+  KALDI_ASSERT(criterion == "mpfe" || criterion == "smbr");
+  bool is_mpfe = (criterion == "mpfe");
+
+  std::vector<LevelledArc> arcs;
+  std::vector<double> final_like;
+  std::vector<int32> tids;
+  int32 num_frames = GetLevelledArcs(trans, lat, &arcs, &final_like, &tids,
+                                     NULL);
+  KALDI_ASSERT(num_frames == static_cast<int32>(num_ali.size()));
+
+  // Work out the frame accuracy of each arc, as in
+  // LatticeForwardBackwardMpeVariants().
+  int32 num_arcs = arcs.size();
+  Vector<double> frame_acc(num_arcs);
+  for (int32 a = 0; a < num_arcs; a++) {
+    int32 tid = tids[a];
+    if (tid == 0) continue;
+    int32 cur_time = arcs[a].row,
+        phone = trans.TransitionIdToPhone(tid);
+    bool phone_is_sil = std::binary_search(silence_phones.begin(),
+                                           silence_phones.end(), phone);
+    if (!is_mpfe) {  // smbr.
+      int32 pdf = trans.TransitionIdToPdf(tid),
+          ref_pdf = trans.TransitionIdToPdf(num_ali[cur_time]);
+      frame_acc(a) = (pdf == ref_pdf && !phone_is_sil) ? 1.0 : 0.0;
+    } else {
+      int32 ref_phone = trans.TransitionIdToPhone(num_ali[cur_time]);
+      frame_acc(a) = (phone == ref_phone && !phone_is_sil) ? 1.0 : 0.0;
+    }
+  }
+
+  CuLevelledGraph<double> graph(lat.NumStates(), arcs, final_like);
+  CuVector<double> arc_post, arc_acc(frame_acc);
+  double tot_acc = graph.ForwardBackwardAcc(arc_acc, &arc_post);
+
+  CuMatrix<double> post_double(num_frames, trans.NumPdfs());
+  graph.AddArcPostToMatrix(arc_post, 1.0, &post_double);
+  CopyPosteriors(post_double, post);
+  return tot_acc;
+}
+
+
+BaseFloat LatticeForwardBackwardMmiCuda(
+    const TransitionModel &trans,
+    const Lattice &lat,
+    const std::vector<int32> &num_ali,
+    bool drop_frames,
+    CuMatrix<BaseFloat> *post) {
+  std::vector<LevelledArc> arcs;
+  std::vector<double> final_like;
+  std::vector<int32> tids;
+  int32 num_frames = GetLevelledArcs(trans, lat, &arcs, &final_like, &tids,
+                                     NULL);
+  KALDI_ASSERT(num_frames == static_cast<int32>(num_ali.size()));
+  CuLevelledGraph<double> graph(lat.NumStates(), arcs, final_like);
+  CuVector<double> arc_post;
+  double tot_like = graph.ForwardBackward(&arc_post);
+
+  // The negated denominator posteriors.
+  CuMatrix<double> post_double(num_frames, trans.NumPdfs());
+  graph.AddArcPostToMatrix(arc_post, -1.0, &post_double);
+
+  std::vector<Int32Pair> num_indexes(num_frames);
+  std::vector<MatrixElement<double> > num_elements(num_frames);
+  for (int32 t = 0; t < num_frames; t++) {
+    int32 pdf = trans.TransitionIdToPdf(num_ali[t]);
+    num_indexes[t].first = t;
+    num_indexes[t].second = pdf;
+    MatrixElement<double> elem = {t, pdf, 1.0};
+    num_elements[t] = elem;
+  }
+  Vector<double> frame_scale;
+  if (drop_frames) {
+    // A frame is dropped if the numerator pdf-id has no denominator
+    // posterior, i.e. the num and den pdf-ids are disjoint (see
+    // MergePosteriors()).
+    std::vector<double> den_of_num;
+    post_double.Lookup(num_indexes, &den_of_num);
+    frame_scale.Resize(num_frames);
+    for (int32 t = 0; t < num_frames; t++)
+      frame_scale(t) = (den_of_num[t] != 0.0 ? 1.0 : 0.0);
+  }
+  post_double.AddElements(1.0, num_elements);
+  if (drop_frames)
+    post_double.MulRowsVec(CuVector<double>(frame_scale));
+  CopyPosteriors(post_double, post);
+  return tot_like;
+}
+
+}  // namespace kaldi
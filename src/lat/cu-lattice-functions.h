@@ -0,0 +1,77 @@
+// lat/cu-lattice-functions.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_LAT_CU_LATTICE_FUNCTIONS_H_
+#define KALDI_LAT_CU_LATTICE_FUNCTIONS_H_
+
+#include <vector>
+#include <string>
+
+#include "base/kaldi-common.h"
+#include "hmm/transition-model.h"
+#include "lat/kaldi-lattice.h"
+#include "cudamatrix/cu-matrix.h"
+
+namespace kaldi {
+
+/*
+  The functions in this file are versions of LatticeForwardBackward(),
+  LatticeForwardBackwardMmi() and LatticeForwardBackwardMpeVariants() (see
+  lattice-functions.h) that do the forward-backward using class
+  CuLevelledGraph, i.e. on the GPU if we are using one.  Instead of a Posterior
+  they output a matrix of dimension (number of frames) by trans.NumPdfs(),
+  containing the posteriors summed at the pdf-id level, so that in
+  neural-net discriminative training the derivatives can be computed without
+  copying the posteriors to the device.  The lattices must be topologically
+  sorted.  The forward-backward is done in double precision.
+*/
+
+/// As LatticeForwardBackward(), but outputs the pdf-level posteriors as a
+/// matrix as described above.  Returns the total log-probability of the
+/// lattice.
+BaseFloat LatticeForwardBackwardCuda(const TransitionModel &trans,
+                                     const Lattice &lat,
+                                     CuMatrix<BaseFloat> *post,
+                                     double *acoustic_like_sum = NULL);
+
+/// As LatticeForwardBackwardMpeVariants(), but outputs the pdf-level
+/// posteriors as a matrix.  Returns the MPFE or sMBR criterion.
+BaseFloat LatticeForwardBackwardMpeVariantsCuda(
+    const TransitionModel &trans,
+    const std::vector<int32> &silence_phones,
+    const Lattice &lat,
+    const std::vector<int32> &num_ali,
+    std::string criterion,
+    CuMatrix<BaseFloat> *post);
+
+/// As LatticeForwardBackwardMmi() with convert_to_pdf_ids == true and
+/// cancel == true (in the matrix form the positive and negative parts
+/// necessarily cancel).  Returns the forward-backward likelihood of the
+/// lattice.
+BaseFloat LatticeForwardBackwardMmiCuda(
+    const TransitionModel &trans,
+    const Lattice &lat,
+    const std::vector<int32> &num_ali,
+    bool drop_frames,
+    CuMatrix<BaseFloat> *post);
+
+}  // namespace kaldi
+
+#endif  // KALDI_LAT_CU_LATTICE_FUNCTIONS_H_
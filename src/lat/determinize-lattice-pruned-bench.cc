@@ -0,0 +1,92 @@
+// lat/determinize-lattice-pruned-bench.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include "lat/determinize-lattice-pruned.h"
+#include "lat/kaldi-lattice.h"
+#include "util/kaldi-bench.h"
+
+namespace kaldi {
+
+// Makes a lattice like the ones that come out of the decoder, after Invert()
+// so the words are on the input side: "num_paths" paths of "num_frames"
+// frames from the start state to the final state, with a word every
+// "word_len" frames.  Paths are in groups of 10 that share their
+// transition-ids, and within each group many paths share their words, so
+// that determinization has a lot of merging to do.
+void MakeBenchLattice(int32 num_paths, int32 num_frames, int32 word_len,
+                      Lattice *lat) {
+  lat->DeleteStates();
+  int32 start = lat->AddState();
+  lat->SetStart(start);
+  std::vector<int32> path_ends;
+  for (int32 p = 0; p < num_paths; p++) {
+    int32 cur = start;
+    for (int32 t = 0; t < num_frames; t++) {
+      int32 next = lat->AddState(),
+          word = (t % word_len == 0 ? 1 + (t + p / 3) % 1000 : 0),
+          tid = 1 + (t * 7 + p % 10) % 3000;
+      LatticeWeight weight(0.1 * (rand() % 10), 0.5 * RandGauss());
+      lat->AddArc(cur, LatticeArc(word, tid, weight, next));
+      cur = next;
+    }
+    path_ends.push_back(cur);
+  }
+  int32 final_state = lat->AddState();
+  lat->SetFinal(final_state, LatticeWeight::One());
+  for (size_t i = 0; i < path_ends.size(); i++)
+    lat->AddArc(path_ends[i],
+                LatticeArc(0, 0, LatticeWeight::One(), final_state));
+  fst::ArcSort(lat, fst::ILabelCompare<LatticeArc>());
+}
+
+struct DeterminizeBench {
+  DeterminizeBench(const Lattice &lat, BaseFloat beam):
+      lat_(lat), beam_(beam) { }
+  void operator() () {
+    if (!fst::DeterminizeLatticePruned(lat_, beam_, &clat_))
+      KALDI_WARN << "Determinization finished early.";
+  }
+  const Lattice &lat_;
+  BaseFloat beam_;
+  CompactLattice clat_;
+};
+
+void DeterminizeLatticePrunedBench(int32 num_paths, int32 num_frames,
+                                   BaseFloat beam) {
+  Lattice lat;
+  MakeBenchLattice(num_paths, num_frames, 20, &lat);
+  std::ostringstream params;
+  params << "paths=" << num_paths << " frames=" << num_frames
+         << " beam=" << beam;
+  DeterminizeBench bench(lat, beam);
+  PrintBenchmarkResult("DeterminizeLatticePruned", params.str(),
+                       TimeBenchmark(bench), lat.NumStates(), "states");
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  srand(0);
+  DeterminizeLatticePrunedBench(100, 300, 6.0);
+  DeterminizeLatticePrunedBench(1000, 300, 6.0);
+  DeterminizeLatticePrunedBench(1000, 1000, 8.0);
+  return 0;
+}
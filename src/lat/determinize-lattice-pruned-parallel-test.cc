@@ -0,0 +1,85 @@
+// lat/determinize-lattice-pruned-parallel-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lat/determinize-lattice-pruned-parallel.h"
+#include "fstext/lattice-utils.h"
+#include "fstext/fst-test-utils.h"
+#include "lat/kaldi-lattice.h"
+#include "lat/lattice-functions.h"
+
+namespace kaldi {
+
+// Makes a random acyclic lattice that is the concatenation of a few random
+// lattices, so that it has some bottleneck states.
+static void GetRandomConcatenatedLattice(Lattice *lat) {
+  fst::RandFstOptions opts;
+  opts.n_states = 4;
+  opts.n_arcs = 8;
+  opts.n_final = 2;
+  opts.allow_empty = false;
+  opts.weight_multiplier = 0.5;
+  opts.acyclic = true;
+  lat->DeleteStates();
+  int32 num_pieces = 1 + rand() % 5;
+  for (int32 i = 0; i < num_pieces; i++) {
+    Lattice *piece = fst::RandPairFst<LatticeArc>(opts);
+    if (i == 0) *lat = *piece;
+    else fst::Concat(lat, *piece);
+    delete piece;
+  }
+  fst::Connect(lat);
+  fst::TopSort(lat);
+}
+
+static void TestDeterminizeLatticePrunedParallel() {
+  for (int32 i = 0; i < 50; i++) {
+    Lattice lat;
+    GetRandomConcatenatedLattice(&lat);
+    if (lat.NumStates() == 0) continue;
+    fst::ArcSort(&lat, fst::ILabelCompare<LatticeArc>());
+
+    std::vector<int32> bottlenecks;
+    LatticeBottleneckStates(lat, &bottlenecks);
+    KALDI_ASSERT(!bottlenecks.empty() && bottlenecks[0] == 0);
+
+    fst::DeterminizeLatticePrunedOptions det_opts;
+    BaseFloat beam = 10.0;
+    CompactLattice clat1, clat2;
+    bool ans1 = fst::DeterminizeLatticePruned<LatticeWeight, int32>(
+        lat, beam, &clat1, det_opts);
+    DeterminizeLatticeParallelOptions parallel_opts;
+    parallel_opts.num_threads = 2;
+    parallel_opts.segment_size = 1 + rand() % 3;
+    bool ans2 = DeterminizeLatticePrunedParallel(lat, beam, &clat2, det_opts,
+                                                 parallel_opts);
+    KALDI_ASSERT(ans1 && ans2);
+    KALDI_ASSERT(clat2.Properties(fst::kIDeterministic, true) &
+                 fst::kIDeterministic);
+    KALDI_ASSERT(fst::RandEquivalent(clat1, clat2, 5 /*paths*/,
+                                     0.01 /*delta*/, rand() /*seed*/,
+                                     100 /*path length, max*/));
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::TestDeterminizeLatticePrunedParallel();
+  std::cout << "Tests succeeded\n";
+}
@@ -0,0 +1,222 @@
+// lat/determinize-lattice-pruned-parallel.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lat/determinize-lattice-pruned-parallel.h"
+#include "lat/lattice-functions.h"
+#include "fstext/lattice-utils.h"
+#include "thread/kaldi-thread.h"
+
+namespace kaldi {
+
+void LatticeBottleneckStates(const Lattice &lat,
+                             std::vector<int32> *bottlenecks) {
+  typedef Lattice::Arc Arc;
+  typedef Arc::Weight Weight;
+  bottlenecks->clear();
+  int32 num_states = lat.NumStates();
+  // Going through the states in order, "max_dest" is the highest-numbered
+  // state that any arc from a previous state enters.  State s is a bottleneck
+  // if no arc from a previous state goes past it and no previous state is
+  // final: then any successful path must go through s.
+  int32 max_dest = 0;
+  bool seen_final = false;
+  for (int32 s = 0; s < num_states; s++) {
+    if (max_dest <= s && !seen_final)
+      bottlenecks->push_back(s);
+    for (fst::ArcIterator<Lattice> aiter(lat, s); !aiter.Done(); aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      KALDI_ASSERT(arc.nextstate > s && "Lattice is not topologically sorted.");
+      max_dest = std::max<int32>(max_dest, arc.nextstate);
+    }
+    if (lat.Final(s) != Weight::Zero())
+      seen_final = true;
+  }
+}
+
+// Copies the states begin ... end of "lat" to "segment" (as states 0 ... end -
+// begin), with the arcs leaving all but the last of them.  If last_segment ==
+// false, the last state is made final with weight One(), else we keep the
+// final-probs.
+static void GetLatticeSegment(const Lattice &lat, int32 begin, int32 end,
+                              bool last_segment, Lattice *segment) {
+  typedef Lattice::Arc Arc;
+  typedef Arc::Weight Weight;
+  segment->DeleteStates();
+  for (int32 s = begin; s <= end; s++)
+    segment->AddState();
+  segment->SetStart(0);
+  for (int32 s = begin; s <= end; s++) {
+    if (s < end || last_segment) {
+      for (fst::ArcIterator<Lattice> aiter(lat, s); !aiter.Done();
+           aiter.Next()) {
+        Arc arc = aiter.Value();
+        KALDI_ASSERT(arc.nextstate <= end);
+        arc.nextstate -= begin;
+        segment->AddArc(s - begin, arc);
+      }
+    }
+    if (last_segment)
+      segment->SetFinal(s - begin, lat.Final(s));
+  }
+  if (!last_segment)
+    segment->SetFinal(end - begin, Weight::One());
+}
+
+// This class is used with RunParallelFor() to determinize segments.
+class DeterminizeSegmentsClass {
+ public:
+  DeterminizeSegmentsClass(const std::vector<Lattice> &segments,
+                           double prune,
+                           const fst::DeterminizeLatticePrunedOptions &opts,
+                           std::vector<CompactLattice> *det_segments,
+                           std::vector<char> *succeeded):
+      segments_(segments), prune_(prune), opts_(opts),
+      det_segments_(det_segments), succeeded_(succeeded) { }
+
+  void operator () (int32 begin, int32 end) {
+    for (int32 i = begin; i < end; i++)
+      (*succeeded_)[i] = fst::DeterminizeLatticePruned<LatticeWeight, int32>(
+          segments_[i], prune_, &((*det_segments_)[i]), opts_);
+  }
+ private:
+  const std::vector<Lattice> &segments_;
+  double prune_;
+  const fst::DeterminizeLatticePrunedOptions &opts_;
+  std::vector<CompactLattice> *det_segments_;
+  std::vector<char> *succeeded_;  // char, as vector<bool> is not thread-safe.
+};
+
+// Concatenates the lattices in "segments" to give "clat"; the final states of
+// each segment are joined to the start state of the next by epsilon arcs
+// carrying the final weights.
+static void ConcatenateSegments(const std::vector<CompactLattice> &segments,
+                                CompactLattice *clat) {
+  typedef CompactLattice::Arc Arc;
+  typedef Arc::Weight Weight;
+  clat->DeleteStates();
+  int32 num_segments = segments.size();
+  std::vector<int32> offsets(num_segments + 1, 0);
+  for (int32 i = 0; i < num_segments; i++) {
+    if (segments[i].Start() == fst::kNoStateId)
+      return;  // An empty segment means an empty lattice.
+    offsets[i + 1] = offsets[i] + segments[i].NumStates();
+  }
+  for (int32 s = 0; s < offsets[num_segments]; s++)
+    clat->AddState();
+  clat->SetStart(segments[0].Start());
+  for (int32 i = 0; i < num_segments; i++) {
+    const CompactLattice &segment = segments[i];
+    bool last_segment = (i + 1 == num_segments);
+    for (int32 s = 0; s < segment.NumStates(); s++) {
+      for (fst::ArcIterator<CompactLattice> aiter(segment, s); !aiter.Done();
+           aiter.Next()) {
+        Arc arc = aiter.Value();
+        arc.nextstate += offsets[i];
+        clat->AddArc(s + offsets[i], arc);
+      }
+      Weight final = segment.Final(s);
+      if (final == Weight::Zero()) continue;
+      if (last_segment)
+        clat->SetFinal(s + offsets[i], final);
+      else
+        clat->AddArc(s + offsets[i],
+                     Arc(0, 0, final, offsets[i + 1] + segments[i + 1].Start()));
+    }
+  }
+}
+
+bool DeterminizeLatticePrunedParallel(
+    const Lattice &ifst,
+    double prune,
+    CompactLattice *ofst,
+    const fst::DeterminizeLatticePrunedOptions &det_opts,
+    const DeterminizeLatticeParallelOptions &parallel_opts) {
+  if (parallel_opts.num_threads <= 1 ||
+      ifst.NumStates() < 2 * parallel_opts.segment_size)
+    return fst::DeterminizeLatticePruned<LatticeWeight, int32>(
+        ifst, prune, ofst, det_opts);
+  Lattice lat(ifst);
+  // The determinization prunes with the same beam, so pruning first does not
+  // change the output; it also gives us a connected, sorted lattice, and
+  // removes paths that would hide the bottlenecks.
+  if (!PruneLattice(prune, &lat) || !fst::TopSort(&lat)) {
+    // The lattice was empty or had cycles; let the normal code deal with it.
+    return fst::DeterminizeLatticePruned<LatticeWeight, int32>(
+        ifst, prune, ofst, det_opts);
+  }
+
+  std::vector<int32> bottlenecks, cuts;
+  LatticeBottleneckStates(lat, &bottlenecks);
+  int32 num_states = lat.NumStates();
+  cuts.push_back(0);
+  for (size_t i = 0; i < bottlenecks.size(); i++) {
+    int32 s = bottlenecks[i];
+    if (s - cuts.back() >= parallel_opts.segment_size &&
+        num_states - s >= parallel_opts.segment_size)
+      cuts.push_back(s);
+  }
+  int32 num_segments = cuts.size();
+  KALDI_VLOG(2) << "Determinizing lattice with " << num_states
+                << " states in " << num_segments << " segments.";
+  if (num_segments == 1) {
+    fst::ArcSort(&lat, fst::ILabelCompare<LatticeArc>());
+    return fst::DeterminizeLatticePruned<LatticeWeight, int32>(
+        lat, prune, ofst, det_opts);
+  }
+  cuts.push_back(num_states - 1);
+
+  std::vector<Lattice> segments(num_segments);
+  for (int32 i = 0; i < num_segments; i++) {
+    GetLatticeSegment(lat, cuts[i], cuts[i + 1], (i + 1 == num_segments),
+                      &(segments[i]));
+    fst::ArcSort(&(segments[i]), fst::ILabelCompare<LatticeArc>());
+  }
+  lat.DeleteStates();  // Free memory.
+
+  std::vector<CompactLattice> det_segments(num_segments);
+  std::vector<char> succeeded(num_segments, 0);
+  DeterminizeSegmentsClass c(segments, prune, det_opts, &det_segments,
+                             &succeeded);
+  RunParallelFor(0, num_segments, c, parallel_opts.num_threads);
+  segments.clear();
+
+  bool ans = true;
+  for (int32 i = 0; i < num_segments; i++)
+    if (!succeeded[i]) ans = false;
+
+  CompactLattice concatenated;
+  ConcatenateSegments(det_segments, &concatenated);
+  det_segments.clear();
+  // Words are on the input side of "ifst", so we don't invert.
+  Lattice concatenated_lat;
+  ConvertLattice(concatenated, &concatenated_lat, false);
+  if (concatenated_lat.Start() == fst::kNoStateId) {
+    ofst->DeleteStates();
+    return false;
+  }
+  if (!fst::TopSort(&concatenated_lat))
+    KALDI_ERR << "Unexpected cycles in concatenated lattice.";
+  fst::ArcSort(&concatenated_lat, fst::ILabelCompare<LatticeArc>());
+  if (!fst::DeterminizeLatticePruned<LatticeWeight, int32>(
+          concatenated_lat, prune, ofst, det_opts))
+    ans = false;
+  return ans;
+}
+
+}  // namespace kaldi
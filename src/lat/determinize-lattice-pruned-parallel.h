@@ -0,0 +1,84 @@
+// lat/determinize-lattice-pruned-parallel.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_LAT_DETERMINIZE_LATTICE_PRUNED_PARALLEL_H_
+#define KALDI_LAT_DETERMINIZE_LATTICE_PRUNED_PARALLEL_H_
+
+#include <vector>
+#include "base/kaldi-common.h"
+#include "itf/options-itf.h"
+#include "lat/kaldi-lattice.h"
+#include "lat/determinize-lattice-pruned.h"
+
+namespace kaldi {
+
+struct DeterminizeLatticeParallelOptions {
+  int32 num_threads;  // Number of threads used for a single lattice.
+  int32 segment_size;  // Minimum number of states in each segment.
+
+  DeterminizeLatticeParallelOptions(): num_threads(1), segment_size(20000) { }
+
+  void Register(OptionsItf *po) {
+    po->Register("num-segment-threads", &num_threads, "Number of threads used "
+                 "to determinize each lattice (in segments); if 1, the "
+                 "lattice is determinized as a whole.");
+    po->Register("segment-size", &segment_size, "Minimum number of states in "
+                 "each segment of a lattice determinized with "
+                 "--num-segment-threads > 1.");
+  }
+};
+
+/**
+   This gives the same output as fst::DeterminizeLatticePruned(), but it uses
+   multiple threads to determinize a single (long) lattice.
+
+   After pruning the lattice with "prune", we find the "bottleneck" states,
+   which are states that every successful path passes through (for instance, in
+   a long pause where all the surviving paths share one state).  We cut the
+   lattice at some of these into segments of at least opts.segment_size
+   states, and determinize the segments in parallel.  Concatenating the
+   determinized segments gives a lattice that is much smaller than the input,
+   and that has the same best path for each word sequence; but it need not be
+   deterministic, since a word sequence might be split between segments in more
+   than one way.  So we finish with a determinization of the concatenated
+   lattice, which is fast because it is small.  If no bottleneck states are
+   found we just call DeterminizeLatticePruned().
+
+   As for DeterminizeLatticePruned(), "ifst" must be topologically sorted,
+   and preferably sorted on ilabel.  Returns false if any of the determinizations
+   returned false (see DeterminizeLatticePruned()); the output is then still
+   a valid lattice.
+*/
+bool DeterminizeLatticePrunedParallel(
+    const Lattice &ifst,
+    double prune,
+    CompactLattice *ofst,
+    const fst::DeterminizeLatticePrunedOptions &det_opts,
+    const DeterminizeLatticeParallelOptions &parallel_opts);
+
+/// Outputs the "bottleneck" states of a lattice that is topologically sorted
+/// and connected: the states that every path from the start state to a final
+/// state passes through, in increasing order.  The start state is included.
+/// This is exposed for testing.
+void LatticeBottleneckStates(const Lattice &lat,
+                             std::vector<int32> *bottlenecks);
+
+}  // namespace kaldi
+
+#endif  // KALDI_LAT_DETERMINIZE_LATTICE_PRUNED_PARALLEL_H_
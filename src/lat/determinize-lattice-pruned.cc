@@ -33,6 +33,7 @@ using std::tr1::unordered_map;
 #include "lat/minimize-lattice.h"   // for minimization
 #include "lat/push-lattice.h"       // for minimization
 #include "lat/determinize-lattice-pruned.h"
+#include "util/kaldi-profile.h"
 
 namespace fst {
 
@@ -107,6 +108,83 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
     }
   }
 
+  // Output to the pooled form of compact lattice (see pooled-lattice.h).  The
+  // pooled form has to be built in order of state, so we number the states
+  // in topological order, which also means the output can be pruned with
+  // PrunePooledCompactLattice() without sorting it.  If destroy == true,
+  // release memory as we go (but we cannot output again).
+  void Output(PooledCompactLatticeTpl<Weight, IntType> *ofst,
+              bool destroy = true) {
+    KALDI_ASSERT(determinized_);
+    typedef typename Arc::StateId StateId;
+    StateId nStates = static_cast<StateId>(output_states_.size());
+    if (destroy)
+      FreeMostMemory();
+    ofst->Clear();
+    if (nStates == 0) {
+      return;
+    }
+    // Work out the topological order (Kahn's algorithm); order[i] is the
+    // i'th state in the output and new_id is the inverse map.  All states
+    // are reachable from state zero, so if the output is acyclic (which it
+    // is if the input was) the order includes all of them.
+    vector<int32> in_degree(nStates, 0);
+    size_t num_arcs = 0;
+    for (StateId s = 0; s < nStates; s++) {
+      const vector<TempArc> &this_vec = output_states_[s]->arcs;
+      for (size_t i = 0; i < this_vec.size(); i++) {
+        if (this_vec[i].nextstate != kNoStateId) {
+          in_degree[this_vec[i].nextstate]++;
+          num_arcs++;
+        }
+      }
+    }
+    vector<StateId> order, new_id(nStates, kNoStateId);
+    order.reserve(nStates);
+    order.push_back(0);
+    for (size_t i = 0; i < order.size(); i++) {
+      const vector<TempArc> &this_vec = output_states_[order[i]]->arcs;
+      for (size_t j = 0; j < this_vec.size(); j++) {
+        StateId nextstate = this_vec[j].nextstate;
+        if (nextstate != kNoStateId && --in_degree[nextstate] == 0)
+          order.push_back(nextstate);
+      }
+    }
+    if (static_cast<StateId>(order.size()) != nStates) {
+      KALDI_WARN << "Determinized lattice has cycles; not sorting it.";
+      for (StateId s = 0; s < nStates; s++) order[s] = s;
+      order.resize(nStates);
+    }
+    for (StateId i = 0; i < nStates; i++) new_id[order[i]] = i;
+
+    ofst->Reserve(nStates, num_arcs, num_arcs);
+    vector<IntType> seq;
+    for (StateId i = 0; i < nStates; i++) {
+      StateId this_state_id = order[i];
+      ofst->AddState();
+      vector<TempArc> &this_vec(output_states_[this_state_id]->arcs);
+      typename vector<TempArc>::const_iterator iter = this_vec.begin(),
+          end = this_vec.end();
+      for (; iter != end; ++iter) {
+        const TempArc &temp_arc(*iter);
+        repository_.ConvertToVector(temp_arc.string, &seq);
+        typename PooledCompactLatticeTpl<Weight, IntType>::StringRef ref =
+            ofst->AddString(seq);
+        if (temp_arc.nextstate == kNoStateId)  // is really final weight.
+          ofst->SetFinal(i, temp_arc.weight, ref);
+        else  // acceptor, so ilabel == olabel.
+          ofst->AddArc(i, temp_arc.ilabel, temp_arc.ilabel, temp_arc.weight,
+                       ref, new_id[temp_arc.nextstate]);
+      }
+      if (destroy) { vector<TempArc> temp; temp.swap(this_vec); }
+    }
+    ofst->SetStart(new_id[0]);
+    if (destroy) {
+      FreeOutputStates();
+      repository_.Destroy();
+    }
+  }
+
   // Output to standard FST with Weight as its weight type.  We will create extra
   // states to handle sequences of symbols on the output.  If destroy == true,
   // release memory as we go (but we cannot output again).
@@ -193,7 +271,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
   LatticeDeterminizerPruned(const ExpandedFst<Arc> &ifst,
                             double beam,
                             DeterminizeLatticePrunedOptions opts):
-      num_arcs_(0), num_elems_(0), ifst_(ifst.Copy()), beam_(beam), opts_(opts),
+      num_arcs_(0), peak_mem_(0), ifst_(ifst.Copy()), beam_(beam), opts_(opts),
       equal_(opts_.delta), determinized_(false),
       minimal_hash_(3, hasher_, equal_), initial_hash_(3, hasher_, equal_) {
     KALDI_ASSERT(Weight::Properties() & kIdempotent); // this algorithm won't
@@ -215,20 +293,10 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
       ifst_ = NULL;
     }
     { MinimalSubsetHash tmp; tmp.swap(minimal_hash_); }
-    
-    for (size_t i = 0; i < output_states_.size(); i++) {
-      vector<Element> empty_subset;
-      empty_subset.swap(output_states_[i]->minimal_subset);
-    }
-    
-    for (typename InitialSubsetHash::iterator iter = initial_hash_.begin();
-         iter != initial_hash_.end(); ++iter)
-      delete iter->first;
-    { InitialSubsetHash tmp; tmp.swap(initial_hash_); }
-    for (size_t i = 0; i < output_states_.size(); i++) {
-      vector<Element> tmp;
-      tmp.swap(output_states_[i]->minimal_subset);
-    }
+    for (size_t i = 0; i < output_states_.size(); i++)
+      output_states_[i]->minimal_subset = Subset();
+    minimal_pool_.Clear();
+    ClearInitialHash();
     { vector<char> tmp;  tmp.swap(isymbol_or_final_); }
     { // Free up the queue.  I'm not sure how to make sure all
       // the memory is really freed (no swap() function)... doesn't really
@@ -242,6 +310,14 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
     { vector<pair<Label, Element> > tmp; tmp.swap(all_elems_tmp_); }
   }
   
+  // Empties initial_hash_, which is only a lookaside buffer that saves us
+  // recomputing the epsilon closure of subsets we have seen before, and frees
+  // the subsets it points to.
+  void ClearInitialHash() {
+    { InitialSubsetHash tmp; tmp.swap(initial_hash_); }
+    initial_pool_.Clear();
+  }
+
   ~LatticeDeterminizerPruned() {
     FreeMostMemory();
     FreeOutputStates();
@@ -267,7 +343,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
         Task *task = queue_.top();
         queue_.pop();
         tasks.push_back(task);
-        AddStrings(task->subset, &needed_strings);
+        AddStrings(Subset(task->subset), &needed_strings);
       }
       for (size_t i = 0; i < tasks.size(); i++)
         queue_.push(tasks[i]);
@@ -277,9 +353,8 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
     for (typename InitialSubsetHash::const_iterator
              iter = initial_hash_.begin();
          iter != initial_hash_.end(); ++iter) {
-      const vector<Element> &vec = *(iter->first);
       Element elem = iter->second;
-      AddStrings(vec, &needed_strings);
+      AddStrings(iter->first, &needed_strings);
       needed_strings.push_back(elem.string);
     }
     std::sort(needed_strings.begin(), needed_strings.end());
@@ -290,23 +365,43 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
     
     repository_.Rebuild(needed_strings);
   }
+
+  // Returns the approximate memory usage of the determinization, in bytes,
+  // and its three parts (which may be NULL).  This only counts the main data
+  // structures, so the real usage will be more.
+  size_t MemoryUsage(size_t *repo_size, size_t *arcs_size,
+                     size_t *elems_size) {
+    size_t this_repo_size = repository_.MemSize(),
+        this_arcs_size = num_arcs_ * sizeof(TempArc),
+        this_elems_size = minimal_pool_.MemSize() + initial_pool_.MemSize(),
+        total_size = this_repo_size + this_arcs_size + this_elems_size;
+    if (repo_size != NULL) *repo_size = this_repo_size;
+    if (arcs_size != NULL) *arcs_size = this_arcs_size;
+    if (elems_size != NULL) *elems_size = this_elems_size;
+    peak_mem_ = std::max(peak_mem_, total_size);
+    return total_size;
+  }
   
   bool CheckMemoryUsage() {
-    int32 repo_size = repository_.MemSize(),
-        arcs_size = num_arcs_ * sizeof(TempArc),
-        elems_size = num_elems_ * sizeof(Element),
-        total_size = repo_size + arcs_size + elems_size;
-    if (opts_.max_mem > 0 && total_size > opts_.max_mem) { // We passed the memory threshold.
-      // This is usually due to the repository getting large, so we
-      // clean this out.
+    size_t repo_size, arcs_size, elems_size,
+        total_size = MemoryUsage(&repo_size, &arcs_size, &elems_size);
+    if (opts_.max_mem > 0 &&
+        total_size > static_cast<size_t>(opts_.max_mem)) {
+      // We passed the memory threshold.  This is usually due to the
+      // repository getting large, so we clean this out, after first
+      // discarding the lookaside buffer initial_hash_, which frees its
+      // subsets and any strings that only it was using.
+      ClearInitialHash();
       RebuildRepository();
-      int32 new_repo_size = repository_.MemSize(),
-          new_total_size = new_repo_size + arcs_size + elems_size;
+      size_t new_repo_size, new_elems_size,
+          new_total_size = MemoryUsage(&new_repo_size, NULL, &new_elems_size);
 
       KALDI_VLOG(2) << "Rebuilt repository in determinize-lattice: repository shrank from "
-                    << repo_size << " to " << new_repo_size << " bytes (approximately)";
+                    << repo_size << " to " << new_repo_size << " bytes, and "
+                    << "subsets from " << elems_size << " to " << new_elems_size
+                    << " bytes (approximately)";
       
-      if (new_total_size > static_cast<int32>(opts_.max_mem * 0.8)) {
+      if (new_total_size > static_cast<size_t>(opts_.max_mem * 0.8)) {
         // Rebuilding didn't help enough-- we need a margin to stop
         // having to rebuild too often.  We'll just return to the user at
         // this point, with a partial lattice that's pruned tighter than
@@ -371,6 +466,9 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
       delete task;
     }
     determinized_ = true;
+    MemoryUsage(NULL, NULL, NULL);  // updates peak_mem_.
+    KALDI_VLOG(2) << "Peak memory usage in lattice determinization was "
+                  << peak_mem_ << " bytes (approximately).";
     if (effective_beam != NULL) {
       if (queue_.empty()) *effective_beam = beam_;
       else
@@ -381,6 +479,10 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
     // all tasks and did not break out of the loop early due to reaching a memory,
     // arc or state limit.
   }
+
+  // Returns the peak of the approximate memory usage that we check against
+  // opts.max_mem, in bytes.  Only valid after Determinize().
+  size_t PeakMemoryUsage() const { return peak_mem_; }
  private:
   
   typedef typename Arc::Label Label;
@@ -418,8 +520,65 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
     Weight weight;
   };
 
+  // A subset of Elements (sorted on state, with no repeated states) that is
+  // stored in an ElementPool.  The keys of the hashes are of this type.
+  struct Subset {
+    const Element *elems;
+    int32 size;
+    Subset(): elems(NULL), size(0) { }
+    // Refers to the contents of "vec", so is only valid while "vec" is
+    // unchanged; this is used for hash lookups.
+    explicit Subset(const vector<Element> &vec):
+        elems(vec.empty() ? NULL : &(vec[0])), size(vec.size()) { }
+    const Element *begin() const { return elems; }
+    const Element *end() const { return elems + size; }
+  };
+
+  // ElementPool stores subsets in large blocks, so that we don't need an
+  // allocation (with its overhead) for every subset we store.  Subsets stay
+  // where they are until Clear() is called, which frees all of them.
+  class ElementPool {
+   public:
+    ElementPool(): cur_(NULL), num_free_(0), num_allocated_(0) { }
+    ~ElementPool() { Clear(); }
+    Subset Store(const vector<Element> &vec) {
+      size_t size = vec.size();
+      if (size > num_free_) {
+        size_t block_size = std::max(static_cast<size_t>(kBlockSize), size);
+        cur_ = new Element[block_size];
+        blocks_.push_back(cur_);
+        num_free_ = block_size;
+        num_allocated_ += block_size;
+      }
+      Subset ans;
+      ans.elems = cur_;
+      ans.size = size;
+      std::copy(vec.begin(), vec.end(), cur_);
+      cur_ += size;
+      num_free_ -= size;
+      return ans;
+    }
+    size_t MemSize() const { return num_allocated_ * sizeof(Element); }
+    void Clear() {
+      for (size_t i = 0; i < blocks_.size(); i++)
+        delete [] blocks_[i];
+      vector<Element*> tmp;
+      tmp.swap(blocks_);
+      cur_ = NULL;
+      num_free_ = 0;
+      num_allocated_ = 0;
+    }
+   private:
+    enum { kBlockSize = 4096 };
+    vector<Element*> blocks_;
+    Element *cur_;  // next free Element in the last block.
+    size_t num_free_;  // number of free Elements in the last block.
+    size_t num_allocated_;
+    DISALLOW_COPY_AND_ASSIGN(ElementPool);
+  };
+
   // Hashing function used in hash of subsets.
-  // A subset is a pointer to vector<Element>.
+  // A subset is a Subset, which points to Elements in an ElementPool.
   // The Elements are in sorted order on state id, and without repeated states.
   // Because the order of Elements is fixed, we can use a hashing function that is
   // order-dependent.  However the weights are not included in the hashing function--
@@ -433,9 +592,9 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
 
   class SubsetKey {
    public:
-    size_t operator ()(const vector<Element> * subset) const {  // hashes only the state and string.
+    size_t operator ()(const Subset &subset) const {  // hashes only the state and string.
       size_t hash = 0, factor = 1;
-      for (typename vector<Element>::const_iterator iter= subset->begin(); iter != subset->end(); ++iter) {
+      for (const Element *iter = subset.begin(); iter != subset.end(); ++iter) {
         hash *= factor;
         hash += iter->state + reinterpret_cast<size_t>(iter->string);
         factor *= 23531;  // these numbers are primes.
@@ -448,12 +607,10 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
   // and string, and approximate match on weights.
   class SubsetEqual {
    public:
-    bool operator ()(const vector<Element> * s1, const vector<Element> * s2) const {
-      size_t sz = s1->size();
-      KALDI_ASSERT(sz>=0);
-      if (sz != s2->size()) return false;
-      typename vector<Element>::const_iterator iter1 = s1->begin(),
-          iter1_end = s1->end(), iter2=s2->begin();
+    bool operator ()(const Subset &s1, const Subset &s2) const {
+      if (s1.size != s2.size) return false;
+      const Element *iter1 = s1.begin(), *iter1_end = s1.end(),
+          *iter2 = s2.begin();
       for (; iter1 < iter1_end; ++iter1, ++iter2) {
         if (iter1->state != iter2->state ||
            iter1->string != iter2->string ||
@@ -470,12 +627,10 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
   // Used only for debug.
   class SubsetEqualStates {
    public:
-    bool operator ()(const vector<Element> * s1, const vector<Element> * s2) const {
-      size_t sz = s1->size();
-      KALDI_ASSERT(sz>=0);
-      if (sz != s2->size()) return false;
-      typename vector<Element>::const_iterator iter1 = s1->begin(),
-          iter1_end = s1->end(), iter2=s2->begin();
+    bool operator ()(const Subset &s1, const Subset &s2) const {
+      if (s1.size != s2.size) return false;
+      const Element *iter1 = s1.begin(), *iter1_end = s1.end(),
+          *iter2 = s2.begin();
       for (; iter1 < iter1_end; ++iter1, ++iter2) {
         if (iter1->state != iter2->state) return false;
       }
@@ -485,7 +640,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
 
   // Define the hash type we use to map subsets (in minimal
   // representation) to OutputStateId.
-  typedef unordered_map<const vector<Element>*, OutputStateId,
+  typedef unordered_map<Subset, OutputStateId,
                         SubsetKey, SubsetEqual> MinimalSubsetHash;
 
   // Define the hash type we use to map subsets (in initial
@@ -493,7 +648,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
   // extra weight. [note: we interpret the Element.state in here
   // as an OutputStateId even though it's declared as InputStateId;
   // these types are the same anyway].
-  typedef unordered_map<const vector<Element>*, Element,
+  typedef unordered_map<Subset, Element,
                         SubsetKey, SubsetEqual> InitialSubsetHash;
   
 
@@ -522,7 +677,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
   OutputStateId MinimalToStateId(const vector<Element> &subset,
                                  const double forward_cost) {
     typename MinimalSubsetHash::const_iterator iter
-        = minimal_hash_.find(&subset);
+        = minimal_hash_.find(Subset(subset));
     if (iter != minimal_hash_.end()) { // Found a matching subset.
       OutputStateId state_id = iter->second;
       const OutputState &state = *(output_states_[state_id]);
@@ -535,10 +690,10 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
       }
     }
     OutputStateId state_id = static_cast<OutputStateId>(output_states_.size());
-    OutputState *new_state = new OutputState(subset, forward_cost);
-    minimal_hash_[&(new_state->minimal_subset)] = state_id;
+    OutputState *new_state = new OutputState(minimal_pool_.Store(subset),
+                                             forward_cost);
+    minimal_hash_[new_state->minimal_subset] = state_id;
     output_states_.push_back(new_state);
-    num_elems_ += subset.size();
     // Note: in the previous algorithm, we pushed the new state-id onto the queue
     // at this point.  Here, the queue happens elsewhere, and we directly process
     // the state (which result in stuff getting added to the queue).
@@ -555,7 +710,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
                                  Weight *remaining_weight,
                                  StringId *common_prefix) {
     typename InitialSubsetHash::const_iterator iter
-        = initial_hash_.find(&subset_in);
+        = initial_hash_.find(Subset(subset_in));
     if (iter != initial_hash_.end()) { // Found a matching subset.
       const Element &elem = iter->second;
       *remaining_weight = elem.weight;
@@ -589,10 +744,8 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
     // Before returning "ans", add the initial subset to the hash,
     // so that we can bypass the epsilon-closure etc., next time
     // we process the same initial subset.
-    vector<Element> *initial_subset_ptr = new vector<Element>(subset_in);
     elem.state = ans;
-    initial_hash_[initial_subset_ptr] = elem;
-    num_elems_ += initial_subset_ptr->size(); // keep track of memory usage.
+    initial_hash_[initial_pool_.Store(subset_in)] = elem;
     return ans;
   }
 
@@ -744,7 +897,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
 
   void ProcessFinal(OutputStateId output_state_id) {
     OutputState &state = *(output_states_[output_state_id]);
-    const vector<Element> &minimal_subset = state.minimal_subset;
+    const Subset &minimal_subset = state.minimal_subset;
     // processes final-weights for this subset.  state.minimal_subset_ may be
     // empty if the graphs is not connected/trimmed, I think, do don't check
     // that it's nonempty.
@@ -752,7 +905,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
     // compiler happy; if it doesn't get set in the loop, we won't use the value anyway.
     Weight final_weight = Weight::Zero();
     bool is_final = false;
-    typename vector<Element>::const_iterator iter = minimal_subset.begin(), end = minimal_subset.end();
+    const Element *iter = minimal_subset.begin(), *end = minimal_subset.end();
     for (; iter != end; ++iter) {
       const Element &elem = *iter;
       Weight this_final_weight = Times(elem.weight, ifst_->Final(elem.state));
@@ -912,7 +1065,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
   // the information we need to process the transition.
   
   void ProcessTransitions(OutputStateId output_state_id) {
-    const vector<Element> &minimal_subset = output_states_[output_state_id]->minimal_subset;
+    const Subset &minimal_subset = output_states_[output_state_id]->minimal_subset;
     // it's possible that minimal_subset could be empty if there are
     // unreachable parts of the graph, so don't check that it's nonempty.
     vector<pair<Label, Element> > &all_elems(all_elems_tmp_); // use class member
@@ -920,7 +1073,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
     {
       // Push back into "all_elems", elements corresponding to all
       // non-epsilon-input transitions out of all states in "minimal_subset".
-      typename vector<Element>::const_iterator iter = minimal_subset.begin(), end = minimal_subset.end();
+      const Element *iter = minimal_subset.begin(), *end = minimal_subset.end();
       for (;iter != end; ++iter) {
         const Element &elem = *iter;
         for (ArcIterator<ExpandedFst<Arc> > aiter(*ifst_, elem.state); ! aiter.Done(); aiter.Next()) {
@@ -1084,12 +1237,12 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
       // Weight::One() is the "forward-weight" of this determinized state...
       // i.e. the minimal cost from the start of the determinized FST to this
       // state [One() because it's the start state].
-      OutputState *initial_state = new OutputState(subset, 0);
+      OutputState *initial_state = new OutputState(minimal_pool_.Store(subset),
+                                                   0);
       KALDI_ASSERT(output_states_.empty());
       output_states_.push_back(initial_state);
-      num_elems_ += subset.size();
       OutputStateId initial_state_id = 0;
-      minimal_hash_[&(initial_state->minimal_subset)] = initial_state_id;
+      minimal_hash_[initial_state->minimal_subset] = initial_state_id;
       ProcessFinal(initial_state_id);
       ProcessTransitions(initial_state_id); // this will add tasks to
       // the queue, which we'll start processing in Determinize().
@@ -1099,7 +1252,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
   DISALLOW_COPY_AND_ASSIGN(LatticeDeterminizerPruned);
 
   struct OutputState {
-    vector<Element> minimal_subset;
+    Subset minimal_subset;  // stored in minimal_pool_.
     vector<TempArc> arcs; // arcs out of the state-- those that have been processed.
     // Note: the final-weight is included here with kNoStateId as the state id.  We
     // always process the final-weight regardless of the beam; when producing the
@@ -1109,7 +1262,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
     // Note: we know this minimal cost from when we first create the OutputState;
     // this is because of the priority-queue we use, that ensures that the
     // "best" path into the state will be expanded first.
-    OutputState(const vector<Element> &minimal_subset,
+    OutputState(const Subset &minimal_subset,
                 double forward_cost): minimal_subset(minimal_subset),
                                       forward_cost(forward_cost) { }
   };
@@ -1117,8 +1270,7 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
   vector<OutputState*> output_states_; // All the info about the output states.
   
   int num_arcs_; // keep track of memory usage: number of arcs in output_states_[ ]->arcs
-  int num_elems_; // keep track of memory usage: number of elems in output_states_ and
-  // the keys of initial_hash_
+  size_t peak_mem_; // the peak of the memory usage we check against max_mem.
   
   const ExpandedFst<Arc> *ifst_;
   std::vector<double> backward_costs_; // This vector stores, for every state in ifst_,
@@ -1146,8 +1298,9 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
                                      // weight and string is needed because after
                                      // we convert to minimal representation and
                                      // normalize, there may be an extra weight
-                                     // and string.  Owns the pointers
-                                     // in its keys.
+                                     // and string.
+  ElementPool minimal_pool_;  // stores the keys of minimal_hash_.
+  ElementPool initial_pool_;  // stores the keys of initial_hash_.
   
   struct Task {
     OutputStateId state; // State from which we're processing the transition.
@@ -1183,10 +1336,9 @@ template<class Weight, class IntType> class LatticeDeterminizerPruned {
   LatticeStringRepository<IntType> repository_;  // defines a compact and fast way of
   // storing sequences of labels.
 
-  void AddStrings(const vector<Element> &vec,
+  void AddStrings(const Subset &subset,
                   vector<StringId> *needed_strings) {
-    for (typename std::vector<Element>::const_iterator iter = vec.begin();
-         iter != vec.end(); ++iter)
+    for (const Element *iter = subset.begin(); iter != subset.end(); ++iter)
       needed_strings->push_back(iter->string);
   }
 };
@@ -1239,6 +1391,42 @@ bool DeterminizeLatticePruned(
 }
 
 
+// As above, but outputs the pooled form of compact lattice.
+template<class Weight, class IntType>
+bool DeterminizeLatticePruned(
+    const ExpandedFst<ArcTpl<Weight> > &ifst,
+    double beam,
+    PooledCompactLatticeTpl<Weight, IntType> *ofst,
+    DeterminizeLatticePrunedOptions opts) {
+  KALDI_ASSERT(opts.retry_cutoff >= 0.0 && opts.retry_cutoff < 1.0);
+  int32 max_num_iters = 10;  // avoid the potential for infinite loops if
+                             // retrying.
+  VectorFst<ArcTpl<Weight> > temp_fst;
+
+  for (int32 iter = 0; iter < max_num_iters; iter++) {
+    LatticeDeterminizerPruned<Weight, IntType> det(iter == 0 ? ifst : temp_fst,
+                                                   beam, opts);
+    double effective_beam;
+    bool ans = det.Determinize(&effective_beam);
+    if (effective_beam >= beam * opts.retry_cutoff ||
+        iter + 1 == max_num_iters) {
+      det.Output(ofst);
+      return ans;
+    } else {
+      if (effective_beam < 0.0) effective_beam = 0.0;
+      double new_beam = beam * sqrt(effective_beam / beam);
+      if (new_beam < 0.5 * beam) new_beam = 0.5 * beam;
+      beam = new_beam;
+      if (iter == 0) temp_fst = ifst;
+      kaldi::PruneLattice(beam, &temp_fst);
+      KALDI_LOG << "Pruned state-level lattice with beam " << beam
+                << " and retrying determinization with that beam.";
+    }
+  }
+  return false; // Suppress compiler warning; this code is unreachable.
+}
+
+
 // normally Weight would be LatticeWeight<float> (which has two floats),
 // or possibly TropicalWeightTpl<float>, and IntType would be int32.
 // Caution: there are two versions of the function DeterminizeLatticePruned,
@@ -1480,6 +1668,7 @@ bool DeterminizeLatticePhonePrunedWrapper(
     double beam,
     MutableFst<kaldi::CompactLatticeArc> *ofst,
     DeterminizeLatticePhonePrunedOptions opts) {
+  KALDI_PROFILE_SCOPE("DeterminizeLatticePhonePrunedWrapper");
   bool ans = true;
   Invert(ifst);
   if (ifst->Properties(fst::kTopSorted, true) == 0) {
@@ -1495,6 +1684,15 @@ bool DeterminizeLatticePhonePrunedWrapper(
   ans = DeterminizeLatticePhonePruned<kaldi::LatticeWeight, kaldi::int32>(
       trans_model, ifst, beam, ofst, opts);
   Connect(ofst);
+  if (kaldi::Profiler::Enabled()) {
+    kaldi::int64 num_arcs = 0;
+    for (StateIterator<MutableFst<kaldi::CompactLatticeArc> > siter(*ofst);
+         !siter.Done(); siter.Next())
+      num_arcs += ofst->NumArcs(siter.Value());
+    KALDI_PROFILE_COUNT("DeterminizeLatticePhonePrunedWrapper::states",
+                        ofst->NumStates());
+    KALDI_PROFILE_COUNT("DeterminizeLatticePhonePrunedWrapper::arcs", num_arcs);
+  }
   return ans;
 }
 
@@ -1515,6 +1713,13 @@ bool DeterminizeLatticePruned<kaldi::LatticeWeight, kaldi::int32>(
     MutableFst<kaldi::LatticeArc> *ofst, 
     DeterminizeLatticePrunedOptions opts);
 
+template
+bool DeterminizeLatticePruned<kaldi::LatticeWeight, kaldi::int32>(
+    const ExpandedFst<kaldi::LatticeArc> &ifst,
+    double prune,
+    PooledCompactLatticeTpl<kaldi::LatticeWeight, kaldi::int32> *ofst,
+    DeterminizeLatticePrunedOptions opts);
+
 template
 bool DeterminizeLatticePhonePruned<kaldi::LatticeWeight, kaldi::int32>(
     const kaldi::TransitionModel &trans_model,
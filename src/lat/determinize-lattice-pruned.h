@@ -31,6 +31,7 @@
 #include "hmm/transition-model.h"
 #include "itf/options-itf.h"
 #include "lat/kaldi-lattice.h"
+#include "lat/pooled-lattice.h"
 
 namespace fst {
 
@@ -209,6 +210,17 @@ bool DeterminizeLatticePruned(
     MutableFst<ArcTpl<CompactLatticeWeightTpl<Weight, IntType> > > *ofst,
     DeterminizeLatticePrunedOptions opts = DeterminizeLatticePrunedOptions());
 
+/*  As above, but the output is in the pooled form of compact lattice (see
+    pooled-lattice.h), which stores all the strings in one array.  The states
+    of the output are numbered in topological order.
+*/
+template<class Weight, class IntType>
+bool DeterminizeLatticePruned(
+    const ExpandedFst<ArcTpl<Weight> > &ifst,
+    double prune,
+    PooledCompactLatticeTpl<Weight, IntType> *ofst,
+    DeterminizeLatticePrunedOptions opts = DeterminizeLatticePrunedOptions());
+
 /** This function takes in lattices and inserts phones at phone boundaries. It
     uses the transition model to work out the transition_id to phone map. The
     returning value is the starting index of the phone label. Typically we pick
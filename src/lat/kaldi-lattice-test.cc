@@ -20,6 +20,7 @@
 
 #include "lat/kaldi-lattice.h"
 #include "fstext/rand-fst.h"
+#include "util/timer.h"
 
 
 namespace kaldi {
@@ -154,6 +155,71 @@ void TestLatticeTableCross(bool binary) {
   }
 }
 
+// Packed format: write as CompactLattice, read as CompactLattice and Lattice.
+void TestPackedCompactLatticeTable() {
+  SetWritePackedCompactLattice(true);
+  CompactLatticeWriter writer("ark:tmpf");
+  int N = 10;
+  std::vector<CompactLattice*> lat_vec(N);
+  for (int i = 0; i < N; i++) {
+    char buf[2];
+    buf[0] = '0' + i;
+    buf[1] = '\0';
+    std::string key = "key" + std::string(buf);
+    CompactLattice *fst = RandCompactLattice();
+    lat_vec[i] = fst;
+    writer.Write(key, *fst);
+  }
+  writer.Close();
+  SetWritePackedCompactLattice(false);
+
+  RandomAccessCompactLatticeReader reader("ark:tmpf");  
+  RandomAccessLatticeReader lat_reader("ark:tmpf");  
+  for (int i = 0; i < N; i++) {
+    char buf[2];
+    buf[0] = '0' + i;
+    buf[1] = '\0';
+    std::string key = "key" + std::string(buf);
+    const CompactLattice &fst = reader.Value(key);
+    KALDI_ASSERT(fst::Equal(fst, *(lat_vec[i])));
+    CompactLattice fst2;
+    ConvertLattice(lat_reader.Value(key), &fst2);
+    KALDI_ASSERT(fst::Equal(fst2, *(lat_vec[i])));
+    delete lat_vec[i];
+  }
+}
+
+// Compares the speed and size of the OpenFst and packed binary formats.
+void TestPackedCompactLatticeSpeed() {
+  int N = 200;
+  std::vector<CompactLattice*> lat_vec(N);
+  for (int i = 0; i < N; i++)
+    lat_vec[i] = RandCompactLattice();
+  for (int packed = 0; packed < 2; packed++) {
+    std::ostringstream os;
+    Timer timer;
+    for (int i = 0; i < N; i++) {
+      if (packed) WritePackedCompactLattice(os, *(lat_vec[i]));
+      else WriteCompactLattice(os, true, *(lat_vec[i]));
+    }
+    double write_time = timer.Elapsed();
+    std::istringstream is(os.str());
+    timer.Reset();
+    for (int i = 0; i < N; i++) {
+      CompactLattice *clat = NULL;
+      bool ans = (packed ? ReadPackedCompactLattice(is, &clat) :
+                  ReadCompactLattice(is, true, &clat));
+      KALDI_ASSERT(ans && fst::Equal(*clat, *(lat_vec[i])));
+      delete clat;
+    }
+    double read_time = timer.Elapsed();
+    KALDI_LOG << (packed ? "Packed" : "OpenFst") << " format: "
+              << os.str().size() << " bytes, write time " << write_time
+              << ", read time " << read_time;
+  }
+  for (int i = 0; i < N; i++)
+    delete lat_vec[i];
+}
 
 
 } // end namespace kaldi
@@ -167,5 +233,7 @@ int main() {
     TestLatticeTable(binary);
     TestLatticeTableCross(binary);
   }
+  TestPackedCompactLatticeTable();
+  TestPackedCompactLatticeSpeed();
   std::cout << "Test OK\n";
 }
@@ -20,6 +20,7 @@
 
 
 #include "lat/kaldi-lattice.h"
+#include <cstring>
 #include "fst/script/print-impl.h"
 
 namespace kaldi {
@@ -363,6 +364,231 @@ bool ReadCompactLattice(std::istream &is, bool binary,
 }
 
 
+// The packed format for CompactLattice.  After the magic number there is an
+// 8-byte length and then a buffer of that length, containing (with "varint"
+// meaning an unsigned integer in 7-bit groups, least significant first, the
+// high bit set on all but the last byte, and "zigzag" meaning a signed integer
+// mapped to an unsigned one as (0, -1, 1, -2, ..) -> (0, 1, 2, 3 ..)):
+//   varint num-strings, then for each string: varint length, then the
+//     differences between successive elements (the first from zero), zigzag.
+//   varint num-states, varint (start-state + 1).
+//   for each state: varint num-arcs, varint (0 if not final, else
+//     1 + string-index of final-weight, then the two floats of the weight),
+//     then for each arc: varint ilabel, varint (0 if olabel == ilabel, else
+//     olabel + 1), zigzag (nextstate - state), varint string-index, and the
+//     two floats of the weight.
+// Floats are written as 4 raw bytes; like the rest of Kaldi, we assume a
+// little-endian machine.
+static const char *kPackedLatticeMagic = "KPL1";
+static const size_t kPackedLatticeMagicSize = 4;
+
+static bool g_write_packed_compact_lattice = false;
+
+void SetWritePackedCompactLattice(bool packed) {
+  g_write_packed_compact_lattice = packed;
+}
+
+bool GetWritePackedCompactLattice() {
+  return g_write_packed_compact_lattice;
+}
+
+static inline void PackVarint(uint64 i, std::string *buf) {
+  while (i >= 128) {
+    buf->push_back(static_cast<char>((i & 127) | 128));
+    i >>= 7;
+  }
+  buf->push_back(static_cast<char>(i));
+}
+
+static inline void PackZigzag(int64 i, std::string *buf) {
+  PackVarint((static_cast<uint64>(i) << 1) ^ static_cast<uint64>(i >> 63), buf);
+}
+
+static inline void PackFloat(float f, std::string *buf) {
+  buf->append(reinterpret_cast<const char*>(&f), sizeof(f));
+}
+
+// The Unpack* functions return false if they would read past "end".
+static inline bool UnpackVarint(const char **cur, const char *end, uint64 *i) {
+  uint64 ans = 0;
+  for (int32 shift = 0; *cur != end && shift < 64; shift += 7) {
+    unsigned char c = static_cast<unsigned char>(*((*cur)++));
+    ans |= static_cast<uint64>(c & 127) << shift;
+    if (c < 128) {
+      *i = ans;
+      return true;
+    }
+  }
+  return false;
+}
+
+static inline bool UnpackZigzag(const char **cur, const char *end, int64 *i) {
+  uint64 u;
+  if (!UnpackVarint(cur, end, &u)) return false;
+  *i = static_cast<int64>(u >> 1) ^ -static_cast<int64>(u & 1);
+  return true;
+}
+
+static inline bool UnpackFloat(const char **cur, const char *end, float *f) {
+  if (end - *cur < static_cast<ptrdiff_t>(sizeof(float))) return false;
+  memcpy(f, *cur, sizeof(float));
+  *cur += sizeof(float);
+  return true;
+}
+
+// Returns the index of "str" in the pool of strings, adding it to the pool
+// (i.e. to "string_map" and "strings_buf") if it is not already there.
+static inline int32 PackedStringIndex(
+    const std::vector<int32> &str,
+    unordered_map<std::vector<int32>, int32, VectorHasher<int32> > *string_map,
+    std::string *strings_buf) {
+  std::pair<const std::vector<int32>, int32> pr(str, string_map->size());
+  std::pair<unordered_map<std::vector<int32>, int32,
+                          VectorHasher<int32> >::iterator, bool> ret =
+      string_map->insert(pr);
+  if (ret.second) { // A new string: add it to the pool.
+    PackVarint(str.size(), strings_buf);
+    int32 prev = 0;
+    for (size_t i = 0; i < str.size(); i++) {
+      PackZigzag(static_cast<int64>(str[i]) - prev, strings_buf);
+      prev = str[i];
+    }
+  }
+  return ret.first->second;
+}
+
+bool WritePackedCompactLattice(std::ostream &os, const CompactLattice &clat) {
+  typedef CompactLattice::StateId StateId;
+  unordered_map<std::vector<int32>, int32, VectorHasher<int32> > string_map;
+  std::string strings_buf, buf;
+  StateId num_states = clat.NumStates();
+  PackVarint(num_states, &buf);
+  PackVarint(clat.Start() + 1, &buf); // kNoStateId == -1 becomes 0.
+  for (StateId s = 0; s < num_states; s++) {
+    PackVarint(clat.NumArcs(s), &buf);
+    CompactLatticeWeight final = clat.Final(s);
+    if (final == CompactLatticeWeight::Zero()) {
+      PackVarint(0, &buf);
+    } else {
+      PackVarint(1 + PackedStringIndex(final.String(), &string_map,
+                                       &strings_buf), &buf);
+      PackFloat(final.Weight().Value1(), &buf);
+      PackFloat(final.Weight().Value2(), &buf);
+    }
+    for (fst::ArcIterator<CompactLattice> aiter(clat, s); !aiter.Done();
+         aiter.Next()) {
+      const CompactLatticeArc &arc = aiter.Value();
+      PackVarint(arc.ilabel, &buf);
+      PackVarint(arc.olabel == arc.ilabel ? 0 : arc.olabel + 1, &buf);
+      PackZigzag(static_cast<int64>(arc.nextstate) - s, &buf);
+      PackVarint(PackedStringIndex(arc.weight.String(), &string_map,
+                                   &strings_buf), &buf);
+      PackFloat(arc.weight.Weight().Value1(), &buf);
+      PackFloat(arc.weight.Weight().Value2(), &buf);
+    }
+  }
+  std::string header;
+  PackVarint(string_map.size(), &header);
+  uint64 size = header.size() + strings_buf.size() + buf.size();
+  os.write(kPackedLatticeMagic, kPackedLatticeMagicSize);
+  os.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  os.write(header.data(), header.size());
+  os.write(strings_buf.data(), strings_buf.size());
+  os.write(buf.data(), buf.size());
+  return os.good();
+}
+
+bool ReadPackedCompactLattice(std::istream &is, CompactLattice **clat) {
+  KALDI_ASSERT(*clat == NULL);
+  typedef CompactLattice::StateId StateId;
+  char magic[4];
+  uint64 size;
+  is.read(magic, kPackedLatticeMagicSize);
+  is.read(reinterpret_cast<char*>(&size), sizeof(size));
+  if (is.fail() ||
+      strncmp(magic, kPackedLatticeMagic, kPackedLatticeMagicSize) != 0) {
+    KALDI_WARN << "Reading packed lattice: bad header.";
+    return false;
+  }
+  std::vector<char> buf(size);
+  if (size > 0) is.read(&(buf[0]), size);
+  if (is.fail()) {
+    KALDI_WARN << "Reading packed lattice: unexpected end of stream.";
+    return false;
+  }
+  const char *cur = (size > 0 ? &(buf[0]) : NULL), *end = cur + size;
+
+  uint64 num_strings, num_states, start, num_arcs, u;
+  if (!UnpackVarint(&cur, end, &num_strings) || num_strings > size) {
+    KALDI_WARN << "Reading packed lattice: bad data.";
+    return false;
+  }
+  std::vector<std::vector<int32> > strings(num_strings);
+  for (size_t i = 0; i < num_strings; i++) {
+    uint64 length;
+    if (!UnpackVarint(&cur, end, &length) ||
+        length > static_cast<uint64>(end - cur)) {
+      KALDI_WARN << "Reading packed lattice: bad data.";
+      return false;
+    }
+    std::vector<int32> &str = strings[i];
+    str.resize(length);
+    int64 prev = 0, diff;
+    for (size_t j = 0; j < length; j++) {
+      if (!UnpackZigzag(&cur, end, &diff)) {
+        KALDI_WARN << "Reading packed lattice: bad data.";
+        return false;
+      }
+      str[j] = prev = prev + diff;
+    }
+  }
+  if (!UnpackVarint(&cur, end, &num_states) ||
+      !UnpackVarint(&cur, end, &start) || start > num_states ||
+      num_states > size) {
+    KALDI_WARN << "Reading packed lattice: bad data.";
+    return false;
+  }
+  CompactLattice *ans = new CompactLattice();
+  for (StateId s = 0; s < static_cast<StateId>(num_states); s++)
+    ans->AddState();
+  ans->SetStart(static_cast<StateId>(start) - 1);
+  bool ok = true;
+  for (StateId s = 0; ok && s < static_cast<StateId>(num_states); s++) {
+    float f1, f2;
+    ok = UnpackVarint(&cur, end, &num_arcs) && UnpackVarint(&cur, end, &u);
+    if (ok && u != 0) {
+      ok = u <= num_strings && UnpackFloat(&cur, end, &f1) &&
+          UnpackFloat(&cur, end, &f2);
+      if (ok)
+        ans->SetFinal(s, CompactLatticeWeight(LatticeWeight(f1, f2),
+                                              strings[u - 1]));
+    }
+    for (uint64 a = 0; ok && a < num_arcs; a++) {
+      uint64 ilabel, olabel, index;
+      int64 offset;
+      ok = UnpackVarint(&cur, end, &ilabel) &&
+          UnpackVarint(&cur, end, &olabel) &&
+          UnpackZigzag(&cur, end, &offset) &&
+          UnpackVarint(&cur, end, &index) && index < num_strings &&
+          UnpackFloat(&cur, end, &f1) && UnpackFloat(&cur, end, &f2) &&
+          s + offset >= 0 && s + offset < static_cast<int64>(num_states);
+      if (ok)
+        ans->AddArc(s, CompactLatticeArc(
+            ilabel, (olabel == 0 ? ilabel : olabel - 1),
+            CompactLatticeWeight(LatticeWeight(f1, f2), strings[index]),
+            s + offset));
+    }
+  }
+  if (!ok || cur != end) {
+    KALDI_WARN << "Reading packed lattice: bad data.";
+    delete ans;
+    return false;
+  }
+  *clat = ans;
+  return true;
+}
+
+
 bool CompactLatticeHolder::Read(std::istream &is) {
   Clear(); // in case anything currently stored.
   int c = is.peek();
@@ -374,6 +600,8 @@ bool CompactLatticeHolder::Read(std::istream &is) {
     // cannot begin with space because it starts with the FST Type() which is not
     // space).
     return ReadCompactLattice(is, false, &t_);
+  } else if (c == kPackedLatticeMagic[0]) {
+    return ReadPackedCompactLattice(is, &t_);
   } else if (c != 214) { // 214 is first char of FST magic number,
     // on little-endian machines which is all we support (\326 octal)
     KALDI_WARN << "Reading compact lattice: does not appear to be an FST "
@@ -490,6 +718,13 @@ bool LatticeHolder::Read(std::istream &is) {
     // cannot begin with space because it starts with the FST Type() which is not
     // space).
     return ReadLattice(is, false, &t_);
+  } else if (c == kPackedLatticeMagic[0]) {
+    CompactLattice *clat = NULL;
+    if (!ReadPackedCompactLattice(is, &clat)) return false;
+    t_ = new Lattice();
+    ConvertLattice(*clat, t_);
+    delete clat;
+    return true;
   } else if (c != 214) { // 214 is first char of FST magic number,
     // on little-endian machines which is all we support (\326 octal)
     KALDI_WARN << "Reading compact lattice: does not appear to be an FST "
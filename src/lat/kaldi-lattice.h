@@ -65,6 +65,24 @@ bool ReadCompactLattice(std::istream &is, bool binary,
 bool ReadLattice(std::istream &is, bool binary,
                  Lattice **lat);
 
+// The following functions write and read CompactLattice in Kaldi's "packed"
+// binary format, which is smaller and much faster to read and write than the
+// OpenFst format: integers are varint-coded (and next-states coded relative to
+// the current state), arcs are decoded from one contiguous buffer, and the
+// transition-id strings are stored once each, in a pool.  It cannot be read by
+// OpenFst tools.  It starts with a magic number that the holders below
+// recognize, so programs can read it wherever they can read a binary lattice.
+bool WritePackedCompactLattice(std::ostream &os, const CompactLattice &clat);
+// requires that *clat be NULL when called.
+bool ReadPackedCompactLattice(std::istream &is, CompactLattice **clat);
+
+/// If called with true, CompactLatticeHolder (and hence CompactLatticeWriter)
+/// writes binary lattices in the packed format; the default is the OpenFst
+/// format.  This is a process-wide setting, intended to be set from a
+/// command-line option, e.g. lattice-copy --write-packed=true.
+void SetWritePackedCompactLattice(bool packed);
+bool GetWritePackedCompactLattice();
+
 
 class CompactLatticeHolder {
  public:
@@ -75,7 +93,10 @@ class CompactLatticeHolder {
   static bool Write(std::ostream &os, bool binary, const T &t) {
     // Note: we don't include the binary-mode header when writing
     // this object to disk; this ensures that if we write to single
-    // files, the result can be read by OpenFst.
+    // files, the result can be read by OpenFst (unless we were asked
+    // to use the packed format).
+    if (binary && GetWritePackedCompactLattice())
+      return WritePackedCompactLattice(os, t);
     return WriteCompactLattice(os, binary, t);
   }
 
@@ -88,6 +109,11 @@ class CompactLatticeHolder {
     return *t_;
   } 
 
+  T &Value() {
+    KALDI_ASSERT(t_ != NULL && "Called Value() on empty CompactLatticeHolder");
+    return *t_;
+  }
+
   void Clear() { if (t_) { delete t_; t_ = NULL; } }
 
   ~CompactLatticeHolder() { Clear(); }
@@ -118,6 +144,11 @@ class LatticeHolder {
     return *t_;
   } 
 
+  T &Value() {
+    KALDI_ASSERT(t_ != NULL && "Called Value() on empty LatticeHolder");
+    return *t_;
+  }
+
   void Clear() { if (t_) { delete t_; t_ = NULL; } }
 
   ~LatticeHolder() { Clear(); }
@@ -966,6 +966,59 @@ void AddWordInsPenToCompactLattice(BaseFloat word_ins_penalty,
   }  // end looping over states  
 } 
 
+void ComposeLatticeDeterministic(
+    const Lattice &lat,
+    fst::DeterministicOnDemandFst<fst::StdArc> *det_fst,
+    Lattice *composed_lat) {
+  typedef LatticeArc::StateId StateId;
+  typedef std::pair<StateId, StateId> StatePair;
+  composed_lat->DeleteStates();
+  if (lat.Start() == fst::kNoStateId || det_fst->Start() == fst::kNoStateId)
+    return;
+  unordered_map<StatePair, StateId, PairHasher<StateId> > state_map;
+  std::vector<StatePair> queue;
+  StatePair start_pair(lat.Start(), det_fst->Start());
+  StateId start = composed_lat->AddState();
+  composed_lat->SetStart(start);
+  state_map[start_pair] = start;
+  queue.push_back(start_pair);
+  while (!queue.empty()) {
+    StatePair pr = queue.back();
+    queue.pop_back();
+    StateId s = state_map[pr];
+    LatticeWeight final_weight = lat.Final(pr.first);
+    if (final_weight != LatticeWeight::Zero()) {
+      fst::StdArc::Weight lm_final = det_fst->Final(pr.second);
+      if (lm_final != fst::StdArc::Weight::Zero()) {
+        final_weight.SetValue1(final_weight.Value1() + lm_final.Value());
+        composed_lat->SetFinal(s, final_weight);
+      }
+    }
+    for (fst::ArcIterator<Lattice> aiter(lat, pr.first); !aiter.Done();
+         aiter.Next()) {
+      LatticeArc arc = aiter.Value();
+      StatePair next_pr(arc.nextstate, pr.second);
+      if (arc.olabel != 0) {
+        fst::StdArc lm_arc;
+        if (!det_fst->GetArc(pr.second, arc.olabel, &lm_arc))
+          continue;
+        next_pr.second = lm_arc.nextstate;
+        arc.weight.SetValue1(arc.weight.Value1() + lm_arc.weight.Value());
+      }
+      typedef unordered_map<StatePair, StateId,
+                            PairHasher<StateId> >::iterator IterType;
+      std::pair<IterType, bool> result =
+          state_map.insert(std::make_pair(next_pr, fst::kNoStateId));
+      if (result.second) {  // newly inserted.
+        result.first->second = composed_lat->AddState();
+        queue.push_back(next_pr);
+      }
+      arc.nextstate = result.first->second;
+      composed_lat->AddArc(s, arc);
+    }
+  }
+}
+
 struct ClatRescoreTuple {
   ClatRescoreTuple(int32 state, int32 arc, int32 tid):
       state_id(state), arc_id(arc), tid(tid) { }
@@ -1123,6 +1176,35 @@ bool RescoreCompactLattice(DecodableInterface *decodable,
 }
 
 
+void CompactLatticeFramePdfs(const TransitionModel &tmodel,
+                             const CompactLattice &clat,
+                             std::vector<std::pair<int32, int32> > *frame_pdfs) {
+  frame_pdfs->clear();
+  if (clat.NumStates() == 0) return;
+  std::vector<int32> state_times;
+  kaldi::CompactLatticeStateTimes(clat, &state_times);
+  int32 num_states = clat.NumStates();
+  for (int32 state = 0; state < num_states; state++) {
+    int32 t = state_times[state];
+    if (t < 0) continue;  // not accessible.
+    for (fst::ArcIterator<CompactLattice> aiter(clat, state); !aiter.Done();
+         aiter.Next()) {
+      const std::vector<int32> &arc_string = aiter.Value().weight.String();
+      for (size_t offset = 0; offset < arc_string.size(); offset++)
+        frame_pdfs->push_back(std::make_pair(
+            t + static_cast<int32>(offset),
+            tmodel.TransitionIdToPdf(arc_string[offset])));
+    }
+    const std::vector<int32> &final_string = clat.Final(state).String();
+    for (size_t offset = 0; offset < final_string.size(); offset++)
+      frame_pdfs->push_back(std::make_pair(
+          t + static_cast<int32>(offset),
+          tmodel.TransitionIdToPdf(final_string[offset])));
+  }
+  SortAndUniq(frame_pdfs);
+}
+
+
 bool RescoreLattice(DecodableInterface *decodable,
                     Lattice *lat) {
   if (lat->NumStates() == 0) {
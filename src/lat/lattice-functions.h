@@ -209,6 +209,18 @@ void CompactLatticeShortestPath(const CompactLattice &clat,
 void AddWordInsPenToCompactLattice(BaseFloat word_ins_penalty,
                                    CompactLattice *clat);
 
+/// Composes "lat" on its output labels (the words) with the deterministic
+/// on-demand FST "det_fst" (typically a language model such as
+/// CompactNgramLmDeterministicFst), adding the costs of its arcs and
+/// final-probs to the graph costs.  Only state pairs reachable from the start
+/// are created.  Epsilon output labels do not advance det_fst; arcs whose words
+/// det_fst has no arc for are removed.  The output is not connected (trimmed)
+/// and may have no final states if det_fst accepts no path through "lat".
+void ComposeLatticeDeterministic(
+    const Lattice &lat,
+    fst::DeterministicOnDemandFst<fst::StdArc> *det_fst,
+    Lattice *composed_lat);
+
 /// This function *adds* the negated scores obtained from the Decodable object,
 /// to the acoustic scores on the arcs.  If you want to replace them, you should
 /// use ScaleCompactLattice to first set the acoustic scores to zero.  Returns
@@ -235,6 +247,16 @@ bool RescoreCompactLatticeSpeedup(
     CompactLattice *clat);
 
 
+/// Outputs, sorted and without duplicates, the (frame, pdf-id) pairs that
+/// appear in the strings of the lattice, i.e. the acoustic likelihoods that
+/// RescoreCompactLattice() will ask the Decodable object for.  This lets a
+/// Decodable object compute only those likelihoods (see
+/// nnet2::DecodableAmNnetSparse).  The lattice must be topologically sorted
+/// and must have transition-ids in its strings.
+void CompactLatticeFramePdfs(const TransitionModel &tmodel,
+                             const CompactLattice &clat,
+                             std::vector<std::pair<int32, int32> > *frame_pdfs);
+
 /// This function *adds* the negated scores obtained from the Decodable object,
 /// to the acoustic scores on the arcs.  If you want to replace them, you should
 /// use ScaleCompactLattice to first set the acoustic scores to zero.  Returns
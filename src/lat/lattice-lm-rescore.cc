@@ -0,0 +1,96 @@
+// lat/lattice-lm-rescore.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lat/lattice-lm-rescore.h"
+#include "lat/lattice-functions.h"
+
+namespace kaldi {
+
+LatticeLmRescorer::LatticeLmRescorer(
+    const fst::VectorFst<fst::StdArc> *lm_fst,
+    fst::DeterministicOnDemandFst<fst::StdArc> *det_lm_fst):
+    lm_fst_(lm_fst), det_lm_fst_(det_lm_fst) {
+  KALDI_ASSERT((lm_fst == NULL) != (det_lm_fst == NULL));
+  if (lm_fst != NULL)
+    KALDI_ASSERT(lm_fst->Properties(fst::kILabelSorted, true) != 0);
+}
+
+LatticeLmRescorer::~LatticeLmRescorer() {
+  for (size_t i = 0; i < free_composers_.size(); i++)
+    delete free_composers_[i];
+}
+
+LatticeLmRescorer::LmComposer *LatticeLmRescorer::GetComposer() const {
+  mutex_.Lock();
+  LmComposer *ans;
+  if (free_composers_.empty()) {
+    // Change the options for TableCompose to match the input (because it's the
+    // arcs of the LM FST we want to do lookup on).
+    fst::TableComposeOptions compose_opts(fst::TableMatcherOptions(),
+                                          true, fst::SEQUENCE_FILTER,
+                                          fst::MATCH_INPUT);
+    // This is done with the lock held because it copies *lm_fst_, which
+    // changes its reference count.
+    ans = new LmComposer(*lm_fst_, compose_opts);
+  } else {
+    ans = free_composers_.back();
+    free_composers_.pop_back();
+  }
+  mutex_.Unlock();
+  return ans;
+}
+
+void LatticeLmRescorer::ReleaseComposer(LmComposer *composer) const {
+  mutex_.Lock();
+  free_composers_.push_back(composer);
+  mutex_.Unlock();
+}
+
+bool LatticeLmRescorer::Rescore(BaseFloat lm_scale, Lattice *lat,
+                                CompactLattice *clat) const {
+  if (lm_scale == 0.0) {
+    // zero scale so nothing to do.
+    ConvertLattice(*lat, clat);
+    return true;
+  }
+  // Before composing with the LM FST, we scale the lattice weights by the
+  // inverse of "lm_scale".  We'll later scale by "lm_scale".  We do it this
+  // way so we can determinize and it will give the right effect (taking the
+  // "best path" through the LM) regardless of the sign of lm_scale.
+  fst::ScaleLattice(fst::GraphLatticeScale(1.0/lm_scale), lat);
+  ArcSort(lat, fst::OLabelCompare<LatticeArc>());
+
+  Lattice composed_lat;
+  if (det_lm_fst_ != NULL) {
+    ComposeLatticeDeterministic(*lat, det_lm_fst_, &composed_lat);
+  } else {
+    // Could just do, more simply: Compose(lat, lm_fst, &composed_lat);
+    // and not have the cache at all.  The command below is faster, though;
+    // it's constant not logarithmic in vocab size.
+    LmComposer *composer = GetComposer();
+    TableCompose(*lat, composer->lm_fst, &composed_lat, &composer->cache);
+    ReleaseComposer(composer);
+  }
+  Invert(&composed_lat); // make it so word labels are on the input.
+  DeterminizeLattice(composed_lat, clat);
+  fst::ScaleLattice(fst::GraphLatticeScale(lm_scale), clat);
+  return (clat->Start() != fst::kNoStateId);
+}
+
+}  // namespace kaldi
@@ -0,0 +1,87 @@
+// lat/lattice-lm-rescore.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_LAT_LATTICE_LM_RESCORE_H_
+#define KALDI_LAT_LATTICE_LM_RESCORE_H_
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "fstext/fstext-lib.h"
+#include "lat/kaldi-lattice.h"
+#include "thread/kaldi-mutex.h"
+
+namespace kaldi {
+
+/// LatticeLmRescorer does the work of lattice-lmrescore: it adds lm_scale
+/// times the cost of the best path through an LM to the graph costs of the
+/// paths through a lattice, by composing with the LM and then
+/// lattice-determinizing.  The LM is either an FST, which we compose with
+/// using TableCompose(), or a DeterministicOnDemandFst (e.g. the one for a
+/// CompactNgramLm), which we compose with using ComposeLatticeDeterministic().
+///
+/// Rescore() may be called from several threads at once.  The on-demand LM
+/// FST and the TableCompose() cache are not thread-safe, so each thread
+/// borrows its own copy of them from a pool; a DeterministicOnDemandFst
+/// given to this class must itself be safe to use from several threads if
+/// Rescore() is called that way.
+class LatticeLmRescorer {
+ public:
+  /// Exactly one of lm_fst and det_lm_fst should be non-NULL.  We don't take
+  /// ownership of them, and they must outlive this object.  lm_fst must be
+  /// sorted on input label.
+  LatticeLmRescorer(const fst::VectorFst<fst::StdArc> *lm_fst,
+                    fst::DeterministicOnDemandFst<fst::StdArc> *det_lm_fst);
+
+  ~LatticeLmRescorer();
+
+  /// Rescores "lat" (which it modifies) and puts the result in "clat".
+  /// Returns false if the result is empty (e.g. the LM was incompatible).
+  /// If lm_scale == 0.0 it just converts the lattice.
+  bool Rescore(BaseFloat lm_scale, Lattice *lat, CompactLattice *clat) const;
+
+ private:
+  // The LM FST interpreted using the LatticeWeight semiring, with all the
+  // cost on the first member of the pair (since it's a graph weight), plus
+  // the cache that TableCompose() uses for fast lookup of its arcs.
+  struct LmComposer {
+    fst::MapFst<fst::StdArc, LatticeArc, fst::StdToLatticeMapper<BaseFloat> >
+        lm_fst;
+    fst::TableComposeCache<fst::Fst<LatticeArc> > cache;
+    LmComposer(const fst::VectorFst<fst::StdArc> &std_lm_fst,
+               const fst::TableComposeOptions &opts):
+        lm_fst(std_lm_fst, fst::StdToLatticeMapper<BaseFloat>()),
+        cache(opts) { }
+  };
+
+  LmComposer *GetComposer() const;
+  void ReleaseComposer(LmComposer *composer) const;
+
+  const fst::VectorFst<fst::StdArc> *lm_fst_;
+  fst::DeterministicOnDemandFst<fst::StdArc> *det_lm_fst_;
+  mutable Mutex mutex_;  // protects free_composers_.
+  mutable std::vector<LmComposer*> free_composers_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(LatticeLmRescorer);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_LAT_LATTICE_LM_RESCORE_H_
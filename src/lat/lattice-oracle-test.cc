@@ -0,0 +1,99 @@
+// lat/lattice-oracle-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "lat/kaldi-lattice.h"
+#include "lat/lattice-oracle.h"
+#include "fstext/rand-fst.h"
+#include "util/edit-distance.h"
+
+
+namespace kaldi {
+using namespace fst;
+
+// Appends to "sequences" the word sequences of all paths from state s to a
+// final state, with "prefix" prepended.
+void GetAllWordSequences(const Lattice &lat, LatticeArc::StateId s,
+                         std::vector<int32> *prefix,
+                         std::vector<std::vector<int32> > *sequences) {
+  if (lat.Final(s) != LatticeWeight::Zero())
+    sequences->push_back(*prefix);
+  for (ArcIterator<Lattice> aiter(lat, s); !aiter.Done(); aiter.Next()) {
+    const LatticeArc &arc = aiter.Value();
+    if (arc.olabel != 0) prefix->push_back(arc.olabel);
+    GetAllWordSequences(lat, arc.nextstate, prefix, sequences);
+    if (arc.olabel != 0) prefix->pop_back();
+  }
+}
+
+void TestLatticeOracle() {
+  RandFstOptions opts;
+  opts.acyclic = true;
+  Lattice *lat = RandPairFst<LatticeArc>(opts);
+  TopSort(lat);
+
+  std::vector<int32> reference(rand() % 8);
+  for (size_t i = 0; i < reference.size(); i++)
+    reference[i] = 1 + rand() % opts.n_syms;
+
+  // Brute force: the minimum edit distance over all paths.
+  std::vector<std::vector<int32> > sequences;
+  if (lat->Start() != kNoStateId) {
+    std::vector<int32> prefix;
+    GetAllWordSequences(*lat, lat->Start(), &prefix, &sequences);
+  }
+  int32 best_errs = -1;
+  for (size_t i = 0; i < sequences.size(); i++) {
+    int32 errs = LevenshteinEditDistance(reference, sequences[i]);
+    if (best_errs == -1 || errs < best_errs) best_errs = errs;
+  }
+
+  std::vector<int32> oracle_words;
+  int32 num_ins, num_del, num_sub;
+  bool ans = LatticeOracle(*lat, reference, -1, &oracle_words,
+                           &num_ins, &num_del, &num_sub);
+  KALDI_ASSERT(ans == !sequences.empty());
+  if (ans) {
+    KALDI_ASSERT(num_ins + num_del + num_sub == best_errs);
+    int32 ins, del, sub;
+    KALDI_ASSERT(LevenshteinEditDistance(reference, oracle_words,
+                                         &ins, &del, &sub) == best_errs);
+    KALDI_ASSERT(std::find(sequences.begin(), sequences.end(),
+                           oracle_words) != sequences.end());
+
+    // With a beam we may not find the oracle, but anything we find is a path.
+    int32 beam = rand() % 3;
+    if (LatticeOracle(*lat, reference, beam, &oracle_words,
+                      &num_ins, &num_del, &num_sub)) {
+      KALDI_ASSERT(num_ins + num_del + num_sub >= best_errs);
+      KALDI_ASSERT(std::find(sequences.begin(), sequences.end(),
+                             oracle_words) != sequences.end());
+    }
+  }
+  delete lat;
+}
+
+}  // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 1000; i++)
+    TestLatticeOracle();
+  KALDI_LOG << "Success.";
+}
@@ -0,0 +1,202 @@
+// lat/lattice-oracle.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "lat/lattice-oracle.h"
+
+namespace kaldi {
+
+namespace {
+
+// One cell of the dynamic-programming table, for a pair (lattice state s,
+// number of reference words consumed n).  The traceback information says how
+// we got here:
+//   prev_state == -1:  unreached, or the start cell.
+//   prev_state == s:   deletion of reference word n-1 (from cell (s, n-1)).
+//   word == 0:         epsilon arc from cell (prev_state, n).
+//   word < 0:          insertion of the lattice word -word, from
+//                      (prev_state, n).
+//   word > 0:          lattice word aligned to reference word n-1 (correct or
+//                      substitution), from (prev_state, n-1).
+// The first case that applies is the one meant.
+struct OracleCell {
+  int32 cost;
+  int32 prev_state;
+  int32 word;
+};
+
+inline void Relax(int32 cost, int32 prev_state, int32 word,
+                  OracleCell *cell) {
+  if (cost < cell->cost) {
+    cell->cost = cost;
+    cell->prev_state = prev_state;
+    cell->word = word;
+  }
+}
+
+}  // namespace
+
+bool LatticeOracle(const Lattice &lat,
+                   const std::vector<int32> &reference,
+                   int32 beam,
+                   std::vector<int32> *oracle_words,
+                   int32 *num_ins,
+                   int32 *num_del,
+                   int32 *num_sub) {
+  typedef Lattice::Arc Arc;
+  typedef Arc::StateId StateId;
+  typedef Arc::Weight Weight;
+  const int32 kInf = std::numeric_limits<int32>::max() / 2;
+
+  oracle_words->clear();
+  *num_ins = *num_del = *num_sub = 0;
+  if (lat.Properties(fst::kTopSorted, true) == 0)
+    KALDI_ERR << "LatticeOracle: lattice must be topologically sorted.";
+  StateId start = lat.Start(), num_states = lat.NumStates();
+  if (start == fst::kNoStateId) return false;
+  int32 num_ref = reference.size(), width = num_ref + 1;
+
+  // The minimum and maximum number of words on a path from each state to a
+  // final state; min_words[s] == kInf if there is no such path.
+  std::vector<int32> min_words(num_states, kInf), max_words(num_states, -1);
+  for (StateId s = num_states - 1; s >= 0; s--) {
+    if (lat.Final(s) != Weight::Zero())
+      min_words[s] = max_words[s] = 0;
+    for (fst::ArcIterator<Lattice> aiter(lat, s); !aiter.Done(); aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      StateId t = arc.nextstate;
+      KALDI_ASSERT(t > s);
+      if (min_words[t] == kInf) continue;
+      int32 w = (arc.olabel != 0 ? 1 : 0);
+      min_words[s] = std::min(min_words[s], min_words[t] + w);
+      max_words[s] = std::max(max_words[s], max_words[t] + w);
+    }
+  }
+  if (min_words[start] == kInf) return false;
+  // No path needs more errors than this: the shortest lattice path can be
+  // aligned with the reference with substitutions plus insertions or
+  // deletions.
+  int32 upper_bound = std::max(num_ref, min_words[start]);
+
+  std::vector<OracleCell> cells(static_cast<size_t>(num_states) * width);
+  for (size_t i = 0; i < cells.size(); i++) {
+    cells[i].cost = kInf;
+    cells[i].prev_state = -1;
+    cells[i].word = 0;
+  }
+  cells[static_cast<size_t>(start) * width].cost = 0;
+
+  std::vector<int32> active;  // The unpruned n's in the current state.
+  for (StateId s = start; s < num_states; s++) {
+    if (min_words[s] == kInf) continue;  // Not coaccessible.
+    OracleCell *row = &(cells[static_cast<size_t>(s) * width]);
+    // Deletions of reference words stay in state s.
+    for (int32 n = 0; n < num_ref; n++)
+      if (row[n].cost != kInf)
+        Relax(row[n].cost + 1, s, 0, &(row[n + 1]));
+
+    // A lower bound on the total errors of any complete path through cell
+    // (s, n) is its cost plus max(0, r - max_words[s], min_words[s] - r),
+    // where r = num_ref - n is the number of reference words left.
+    int32 threshold = upper_bound;
+    if (beam >= 0) {
+      int32 best = kInf;
+      for (int32 n = 0; n <= num_ref; n++) {
+        if (row[n].cost == kInf) continue;
+        int32 r = num_ref - n,
+            bound = std::max(0, std::max(r - max_words[s], min_words[s] - r));
+        best = std::min(best, row[n].cost + bound);
+      }
+      if (best != kInf)
+        threshold = std::min(threshold, best + beam);
+    }
+    active.clear();
+    for (int32 n = 0; n <= num_ref; n++) {
+      if (row[n].cost == kInf) continue;
+      int32 r = num_ref - n,
+          bound = std::max(0, std::max(r - max_words[s], min_words[s] - r));
+      if (row[n].cost + bound <= threshold)
+        active.push_back(n);
+    }
+    if (active.empty()) continue;
+
+    for (fst::ArcIterator<Lattice> aiter(lat, s); !aiter.Done(); aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      StateId t = arc.nextstate;
+      if (min_words[t] == kInf) continue;
+      OracleCell *next_row = &(cells[static_cast<size_t>(t) * width]);
+      int32 word = arc.olabel;
+      std::vector<int32>::const_iterator iter = active.begin(),
+          end = active.end();
+      if (word == 0) {
+        for (; iter != end; ++iter)
+          Relax(row[*iter].cost, s, 0, &(next_row[*iter]));
+      } else {
+        for (; iter != end; ++iter) {
+          int32 n = *iter, cost = row[n].cost;
+          Relax(cost + 1, s, -word, &(next_row[n]));  // insertion
+          if (n < num_ref)
+            Relax(cost + (word == reference[n] ? 0 : 1), s, word,
+                  &(next_row[n + 1]));
+        }
+      }
+    }
+  }
+
+  StateId best_final = fst::kNoStateId;
+  int32 best_cost = kInf;
+  for (StateId s = 0; s < num_states; s++) {
+    if (lat.Final(s) != Weight::Zero() &&
+        cells[static_cast<size_t>(s) * width + num_ref].cost < best_cost) {
+      best_cost = cells[static_cast<size_t>(s) * width + num_ref].cost;
+      best_final = s;
+    }
+  }
+  if (best_final == fst::kNoStateId) return false;  // Everything pruned.
+
+  StateId s = best_final;
+  int32 n = num_ref;
+  while (true) {
+    const OracleCell &cell = cells[static_cast<size_t>(s) * width + n];
+    if (cell.prev_state == -1) break;
+    if (cell.prev_state == s) {
+      (*num_del)++;
+      n--;
+    } else {
+      if (cell.word < 0) {
+        (*num_ins)++;
+        oracle_words->push_back(-cell.word);
+      } else if (cell.word > 0) {
+        if (cell.word != reference[n - 1]) (*num_sub)++;
+        oracle_words->push_back(cell.word);
+        n--;
+      }
+      s = cell.prev_state;
+    }
+  }
+  KALDI_ASSERT(s == start && n == 0 &&
+               *num_ins + *num_del + *num_sub == best_cost);
+  std::reverse(oracle_words->begin(), oracle_words->end());
+  return true;
+}
+
+}  // namespace kaldi
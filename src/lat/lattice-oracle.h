@@ -0,0 +1,59 @@
+// lat/lattice-oracle.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_LAT_LATTICE_ORACLE_H_
+#define KALDI_LAT_LATTICE_ORACLE_H_
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "fstext/fstext-lib.h"
+#include "lat/kaldi-lattice.h"
+
+namespace kaldi {
+
+/// Finds the word sequence in the lattice "lat" (words on the output side;
+/// zero is epsilon) that has the smallest edit distance to "reference", i.e.
+/// the oracle path.  This is a dynamic program over pairs (lattice state,
+/// number of reference words consumed), computed in a flat table in
+/// topological order of the states, so it is much faster than composing the
+/// lattice with an edit-distance transducer.  The lattice must be
+/// topologically sorted (its weights are ignored).
+///
+/// Cells that cannot be on a best path are pruned using bounds on the number
+/// of words on the remaining lattice paths, which does not affect the result.
+/// If "beam" is >= 0, we additionally prune cells whose cost (plus that
+/// bound) is more than "beam" errors worse than the best one in the same
+/// state; this is faster on dense lattices but may not find the oracle path.
+///
+/// Outputs the oracle word sequence and the numbers of insertions, deletions
+/// and substitutions; the edit distance is their sum.  Returns false if the
+/// lattice has no successful path (or, with a beam, if all were pruned).
+bool LatticeOracle(const Lattice &lat,
+                   const std::vector<int32> &reference,
+                   int32 beam,
+                   std::vector<int32> *oracle_words,
+                   int32 *num_ins,
+                   int32 *num_del,
+                   int32 *num_sub);
+
+}  // namespace kaldi
+
+#endif  // KALDI_LAT_LATTICE_ORACLE_H_
@@ -21,6 +21,8 @@
 // limitations under the License.
 
 
+#include <algorithm>
+
 #include "lat/minimize-lattice.h"
 #include "hmm/transition-model.h"
 #include "util/stl-utils.h"
@@ -192,35 +194,41 @@ template<class Weight, class IntType> class CompactLatticeMinimizer {
     // since the equivalence test relies on later states being already sorted
     // out into equivalence classes (by state_map_).
     StateId num_states = clat_->NumStates();
-    unordered_map<HashType, std::vector<StateId> > hash_groups_;
-    
+    // The states grouped by hash value: sorting the pairs (hash, state) puts
+    // each group in a contiguous range, in increasing order of state.  This
+    // is a flat array rather than a hash map from hash value to a vector of
+    // states, which would do an allocation per group.
+    std::vector<std::pair<HashType, StateId> > hash_groups(num_states);
     for (StateId s = 0; s < num_states; s++)
-      hash_groups_[state_hashes_[s]].push_back(s);
+      hash_groups[s] = std::make_pair(state_hashes_[s], s);
+    std::sort(hash_groups.begin(), hash_groups.end());
+    // group_begin[s] is the start of the range for the hash of state s.
+    std::vector<StateId> group_begin(num_states);
+    size_t max_size = 0;
+    for (StateId i = 0; i < num_states; ) {
+      StateId j = i + 1;
+      while (j < num_states && hash_groups[j].first == hash_groups[i].first)
+        j++;
+      for (StateId k = i; k < j; k++)
+        group_begin[hash_groups[k].second] = i;
+      max_size = std::max(max_size, static_cast<size_t>(j - i));
+      i = j;
+    }
 
     state_map_.resize(num_states);
     for (StateId s = 0; s < num_states; s++)
       state_map_[s] = s; // Default mapping.
     
-
-    { // This block is just diagnostic.
-      typedef typename unordered_map<HashType,
-              std::vector<StateId> >::const_iterator HashIter;
-      size_t max_size = 0;
-      for (HashIter iter = hash_groups_.begin(); iter != hash_groups_.end();
-           ++iter)
-        max_size = std::max(max_size, iter->second.size());
-      if (max_size > 1000) {
-        KALDI_WARN << "Largest equivalence group (using hash) is " << max_size
-                   << ", minimization might be slow.";
-      }
+    if (max_size > 1000) { // This is just diagnostic.
+      KALDI_WARN << "Largest equivalence group (using hash) is " << max_size
+                 << ", minimization might be slow.";
     }
 
     for (StateId s = num_states - 1; s >= 0; s--) {
       HashType hash = state_hashes_[s];
-      const std::vector<StateId> &equivalence_class = hash_groups_[hash];
-      KALDI_ASSERT(!equivalence_class.empty());
-      for (size_t i = 0; i < equivalence_class.size(); i++) {
-        StateId t = equivalence_class[i];
+      for (StateId i = group_begin[s];
+           i < num_states && hash_groups[i].first == hash; i++) {
+        StateId t = hash_groups[i].second;
         // Below, there is no point doing the test if state_map_[t] != t, because
         // in that case we will, before after this, be comparing with another state
         // that is equivalent to t.
@@ -0,0 +1,131 @@
+// lat/pooled-lattice-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "lat/pooled-lattice.h"
+#include "lat/determinize-lattice-pruned.h"
+#include "lat/lattice-functions.h"
+#include "fstext/fst-test-utils.h"
+
+namespace kaldi {
+
+static Lattice *RandAcyclicLattice() {
+  fst::RandFstOptions opts;
+  opts.n_states = 5;
+  opts.n_arcs = 10;
+  opts.n_final = 2;
+  opts.allow_empty = false;
+  opts.weight_multiplier = 0.5;
+  opts.acyclic = true;
+  Lattice *lat = fst::RandPairFst<LatticeArc>(opts);
+  bool sorted = fst::TopSort(lat);
+  KALDI_ASSERT(sorted);
+  return lat;
+}
+
+void TestPooledCompactLatticeCopy() {
+  for (int32 i = 0; i < 20; i++) {
+    Lattice *lat = fst::RandPairFst<LatticeArc>();
+    CompactLattice clat, clat2;
+    ConvertLattice(*lat, &clat);
+    PooledCompactLattice pooled(clat);
+    KALDI_ASSERT(pooled.NumStates() == clat.NumStates());
+    pooled.CopyTo(&clat2);
+    KALDI_ASSERT(fst::Equal(clat, clat2));
+    delete lat;
+  }
+}
+
+void TestPooledCompactLatticeDeterminize() {
+  for (int32 i = 0; i < 20; i++) {
+    Lattice *lat = RandAcyclicLattice();
+    CompactLattice clat, pooled_clat;
+    PooledCompactLattice pooled;
+    bool ans1 = fst::DeterminizeLatticePruned<LatticeWeight, int32>(
+        *lat, 10.0, &clat),
+        ans2 = fst::DeterminizeLatticePruned<LatticeWeight, int32>(
+            *lat, 10.0, &pooled);
+    KALDI_ASSERT(ans1 == ans2);
+    KALDI_ASSERT(pooled.NumStates() == clat.NumStates());
+    pooled.CopyTo(&pooled_clat);
+    // The states of the pooled form are in topological order.
+    KALDI_ASSERT(pooled_clat.Properties(fst::kTopSorted, true) != 0);
+    if (ans1 && clat.NumStates() != 0)
+      KALDI_ASSERT(fst::RandEquivalent(clat, pooled_clat, 5, 0.01, rand(),
+                                       100));
+    delete lat;
+  }
+}
+
+void TestPooledCompactLatticeStateTimes() {
+  // A lattice with two paths of three frames each: 0 -> 1 -> 3 with strings
+  // of length 1 and 2, and 0 -> 2 -> 3 with strings of length 2 and 1, and
+  // a final-string of length 1 on state 3.
+  CompactLattice clat;
+  for (int32 s = 0; s < 4; s++) clat.AddState();
+  clat.SetStart(0);
+  std::vector<int32> one(1, 1), two(2, 2);
+  LatticeWeight w(0.5, 1.0);
+  clat.AddArc(0, CompactLatticeArc(1, 1, CompactLatticeWeight(w, one), 1));
+  clat.AddArc(0, CompactLatticeArc(2, 2, CompactLatticeWeight(w, two), 2));
+  clat.AddArc(1, CompactLatticeArc(3, 3, CompactLatticeWeight(w, two), 3));
+  clat.AddArc(2, CompactLatticeArc(4, 4, CompactLatticeWeight(w, one), 3));
+  clat.SetFinal(3, CompactLatticeWeight(LatticeWeight::One(), one));
+  PooledCompactLattice pooled(clat);
+
+  std::vector<int32> times, pooled_times;
+  int32 num_frames = CompactLatticeStateTimes(clat, &times),
+      pooled_num_frames = PooledCompactLatticeStateTimes(pooled,
+                                                         &pooled_times);
+  KALDI_ASSERT(num_frames == 4 && pooled_num_frames == 4);
+  KALDI_ASSERT(times == pooled_times);
+}
+
+void TestPooledCompactLatticePrune() {
+  for (int32 i = 0; i < 20; i++) {
+    Lattice *lat = RandAcyclicLattice();
+    CompactLattice clat, pooled_clat;
+    ConvertLattice(*lat, &clat);
+    fst::TopSort(&clat);
+    PooledCompactLattice pooled(clat);
+
+    BaseFloat beam = 0.5 + 5.0 * RandUniform();
+    bool ans1 = PruneLattice(beam, &clat),
+        ans2 = PrunePooledCompactLattice(beam, &pooled);
+    KALDI_ASSERT(ans1 == ans2);
+    if (ans1) {
+      KALDI_ASSERT(pooled.NumStates() == clat.NumStates());
+      pooled.CopyTo(&pooled_clat);
+      KALDI_ASSERT(fst::RandEquivalent(clat, pooled_clat, 5, 0.01, rand(),
+                                       100));
+    }
+    delete lat;
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  TestPooledCompactLatticeCopy();
+  TestPooledCompactLatticeDeterminize();
+  TestPooledCompactLatticeStateTimes();
+  TestPooledCompactLatticePrune();
+  std::cout << "Test OK\n";
+}
@@ -0,0 +1,168 @@
+// lat/pooled-lattice.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <limits>
+#include "lat/pooled-lattice.h"
+
+namespace kaldi {
+
+// Returns true if all arcs go to higher-numbered states and the start state
+// is zero (or there is no start state).
+static bool IsTopSorted(const PooledCompactLattice &clat) {
+  typedef PooledCompactLattice::Arc Arc;
+  typedef PooledCompactLattice::StateId StateId;
+  if (clat.Start() != 0 && clat.Start() != fst::kNoStateId) return false;
+  for (StateId s = 0; s < clat.NumStates(); s++)
+    for (const Arc *arc = clat.ArcsBegin(s), *end = clat.ArcsEnd(s);
+         arc != end; ++arc)
+      if (arc->nextstate <= s) return false;
+  return true;
+}
+
+int32 PooledCompactLatticeStateTimes(const PooledCompactLattice &clat,
+                                     std::vector<int32> *times) {
+  typedef PooledCompactLattice::Arc Arc;
+  if (!IsTopSorted(clat))
+    KALDI_ERR << "Input lattice must be topologically sorted.";
+  KALDI_ASSERT(clat.Start() == 0);
+  int32 num_states = clat.NumStates();
+  times->clear();
+  times->resize(num_states, -1);
+  (*times)[0] = 0;
+  int32 utt_len = -1;
+  for (int32 state = 0; state < num_states; state++) {
+    int32 cur_time = (*times)[state];
+    for (const Arc *arc = clat.ArcsBegin(state), *end = clat.ArcsEnd(state);
+         arc != end; ++arc) {
+      int32 arc_len = arc->string.size;
+      if ((*times)[arc->nextstate] == -1)
+        (*times)[arc->nextstate] = cur_time + arc_len;
+      else
+        KALDI_ASSERT((*times)[arc->nextstate] == cur_time + arc_len);
+    }
+    if (clat.FinalWeight(state) != LatticeWeight::Zero()) {
+      int32 this_utt_len = cur_time + clat.FinalString(state).size;
+      if (utt_len == -1) utt_len = this_utt_len;
+      else {
+        if (this_utt_len != utt_len) {
+          KALDI_WARN << "Utterance does not "
+              "seem to have a consistent length.";
+          utt_len = std::max(utt_len, this_utt_len);
+        }
+      }
+    }
+  }
+  if (utt_len == -1) {
+    KALDI_WARN << "Utterance does not have a final-state.";
+    return 0;
+  }
+  return utt_len;
+}
+
+bool PrunePooledCompactLattice(BaseFloat beam, PooledCompactLattice *clat) {
+  typedef PooledCompactLattice::Arc Arc;
+  typedef PooledCompactLattice::StateId StateId;
+  KALDI_ASSERT(beam > 0.0);
+  if (!IsTopSorted(*clat)) {
+    KALDI_WARN << "Lattice is not topologically sorted.";
+    return false;
+  }
+  StateId num_states = clat->NumStates();
+  if (num_states == 0 || clat->Start() == fst::kNoStateId) return false;
+  const double inf = std::numeric_limits<double>::infinity();
+
+  // The forward and backward Viterbi costs.
+  std::vector<double> forward_cost(num_states, inf),
+      backward_cost(num_states, inf);
+  forward_cost[0] = 0.0;
+  double best_final_cost = inf;
+  for (StateId s = 0; s < num_states; s++) {
+    double this_forward_cost = forward_cost[s];
+    for (const Arc *arc = clat->ArcsBegin(s), *end = clat->ArcsEnd(s);
+         arc != end; ++arc) {
+      double next_forward_cost = this_forward_cost + ConvertToCost(arc->weight);
+      if (forward_cost[arc->nextstate] > next_forward_cost)
+        forward_cost[arc->nextstate] = next_forward_cost;
+    }
+    best_final_cost = std::min(best_final_cost, this_forward_cost +
+                               ConvertToCost(clat->FinalWeight(s)));
+  }
+  if (best_final_cost == inf) {
+    KALDI_WARN << "Lattice has no successful path.";
+    return false;
+  }
+  for (StateId s = num_states - 1; s >= 0; s--) {
+    double this_backward_cost = ConvertToCost(clat->FinalWeight(s));
+    for (const Arc *arc = clat->ArcsBegin(s), *end = clat->ArcsEnd(s);
+         arc != end; ++arc)
+      this_backward_cost = std::min(this_backward_cost,
+                                    ConvertToCost(arc->weight) +
+                                    backward_cost[arc->nextstate]);
+    backward_cost[s] = this_backward_cost;
+  }
+
+  // A state survives if it is on a path within the beam; an arc survives if
+  // the best path through it is within the beam (so both its states do).
+  // Renumbering the surviving states in order keeps the lattice
+  // topologically sorted.
+  double cutoff = best_final_cost + beam;
+  std::vector<StateId> new_state(num_states, fst::kNoStateId);
+  StateId num_new_states = 0;
+  size_t num_new_arcs = 0, new_pool_size = 0;
+  for (StateId s = 0; s < num_states; s++) {
+    if (forward_cost[s] + backward_cost[s] > cutoff) continue;
+    new_state[s] = num_new_states++;
+    for (const Arc *arc = clat->ArcsBegin(s), *end = clat->ArcsEnd(s);
+         arc != end; ++arc) {
+      if (forward_cost[s] + ConvertToCost(arc->weight) +
+          backward_cost[arc->nextstate] <= cutoff) {
+        num_new_arcs++;
+        new_pool_size += arc->string.size;
+      }
+    }
+  }
+
+  PooledCompactLattice ans;
+  ans.Reserve(num_new_states, num_new_arcs, new_pool_size);
+  for (StateId s = 0; s < num_states; s++) {
+    if (new_state[s] == fst::kNoStateId) continue;
+    StateId t = ans.AddState();
+    const LatticeWeight &final_weight = clat->FinalWeight(s);
+    if (forward_cost[s] + ConvertToCost(final_weight) <= cutoff) {
+      const PooledCompactLattice::StringRef &ref = clat->FinalString(s);
+      ans.SetFinal(t, final_weight,
+                   ans.AddString(clat->StringData(ref), ref.size));
+    }
+    for (const Arc *arc = clat->ArcsBegin(s), *end = clat->ArcsEnd(s);
+         arc != end; ++arc) {
+      if (forward_cost[s] + ConvertToCost(arc->weight) +
+          backward_cost[arc->nextstate] <= cutoff) {
+        ans.AddArc(t, arc->ilabel, arc->olabel, arc->weight,
+                   ans.AddString(clat->StringData(arc->string),
+                                 arc->string.size),
+                   new_state[arc->nextstate]);
+      }
+    }
+  }
+  ans.SetStart(0);
+  clat->Swap(&ans);
+  return true;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,258 @@
+// lat/pooled-lattice.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_LAT_POOLED_LATTICE_H_
+#define KALDI_LAT_POOLED_LATTICE_H_
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "fstext/fstext-lib.h"
+#include "lat/kaldi-lattice.h"
+
+namespace fst {
+
+/**
+   PooledCompactLatticeTpl is an alternative in-memory form of a compact
+   lattice (VectorFst<ArcTpl<CompactLatticeWeightTpl<Weight, IntType> > >).  In
+   the VectorFst form, each state has its own vector of arcs and each arc and
+   final-weight has its own std::vector for its string of transition-ids, so a
+   large lattice needs hundreds of thousands of small allocations.  Here the
+   arcs of all states are in one array (state s has the arcs from
+   arc_begin_[s] to arc_begin_[s+1]), and all the strings are in one pool of
+   integers, which arcs and final-weights refer to by offset and length.
+
+   It is built by adding states in order and the arcs of each state right
+   after it (AddState(), then AddArc() for that state), which is the order in
+   which the algorithms that produce lattices create them; it cannot be
+   modified afterwards except by Clear().  Algorithms that modify lattices,
+   such as pruning, create a new PooledCompactLatticeTpl.  See
+   DeterminizeLatticePruned() in determinize-lattice-pruned.h, and
+   PrunePooledCompactLattice() below, for algorithms that work on this type.
+ */
+template<class Weight, class IntType>
+class PooledCompactLatticeTpl {
+ public:
+  typedef int StateId;
+  typedef int Label;
+  typedef CompactLatticeWeightTpl<Weight, IntType> CompactWeight;
+  typedef ArcTpl<CompactWeight> CompactArc;
+
+  /// A string is stored as an offset into the pool, and a length.
+  struct StringRef {
+    int32 begin;
+    int32 size;
+    StringRef(): begin(0), size(0) { }
+  };
+
+  struct Arc {
+    Label ilabel;
+    Label olabel;
+    StateId nextstate;
+    Weight weight;
+    StringRef string;
+  };
+
+  PooledCompactLatticeTpl(): start_(kNoStateId) { arc_begin_.push_back(0); }
+
+  /// Converts from the VectorFst form.  The input need not be topologically
+  /// sorted.
+  explicit PooledCompactLatticeTpl(const ExpandedFst<CompactArc> &clat):
+      start_(kNoStateId) {
+    arc_begin_.push_back(0);
+    CopyFrom(clat);
+  }
+
+  void Clear() {
+    start_ = kNoStateId;
+    arc_begin_.clear();
+    arc_begin_.push_back(0);
+    final_weights_.clear();
+    final_strings_.clear();
+    arcs_.clear();
+    pool_.clear();
+  }
+
+  /// Reserves memory; the arguments are the expected sizes.
+  void Reserve(int32 num_states, int32 num_arcs, int32 pool_size) {
+    arc_begin_.reserve(num_states + 1);
+    final_weights_.reserve(num_states);
+    final_strings_.reserve(num_states);
+    arcs_.reserve(num_arcs);
+    pool_.reserve(pool_size);
+  }
+
+  StateId NumStates() const { return final_weights_.size(); }
+  StateId Start() const { return start_; }
+  void SetStart(StateId s) { start_ = s; }
+  size_t NumArcs() const { return arcs_.size(); }
+  size_t NumArcs(StateId s) const {
+    return arc_begin_[s + 1] - arc_begin_[s];
+  }
+  /// The arcs of state s are ArcsBegin(s) ... ArcsEnd(s) - 1.
+  const Arc *ArcsBegin(StateId s) const {
+    return arcs_.empty() ? NULL : &(arcs_[0]) + arc_begin_[s];
+  }
+  const Arc *ArcsEnd(StateId s) const {
+    return arcs_.empty() ? NULL : &(arcs_[0]) + arc_begin_[s + 1];
+  }
+  /// Weight::Zero() if s is not final.
+  const Weight &FinalWeight(StateId s) const { return final_weights_[s]; }
+  const StringRef &FinalString(StateId s) const { return final_strings_[s]; }
+  /// Returns a pointer to the first element of the string (which is NULL or
+  /// invalid if ref.size == 0).
+  const IntType *StringData(const StringRef &ref) const {
+    return pool_.empty() ? NULL : &(pool_[0]) + ref.begin;
+  }
+  size_t PoolSize() const { return pool_.size(); }
+
+  /// Adds a new state (not final, with no arcs).  Arcs may only be added to
+  /// the most recently added state.
+  StateId AddState() {
+    final_weights_.push_back(Weight::Zero());
+    final_strings_.push_back(StringRef());
+    arc_begin_.push_back(arcs_.size());
+    return final_weights_.size() - 1;
+  }
+
+  /// Adds a string to the pool.
+  StringRef AddString(const IntType *data, size_t size) {
+    StringRef ans;
+    ans.begin = pool_.size();
+    ans.size = size;
+    pool_.insert(pool_.end(), data, data + size);
+    return ans;
+  }
+  StringRef AddString(const std::vector<IntType> &str) {
+    return AddString(str.empty() ? NULL : &(str[0]), str.size());
+  }
+
+  /// Adds an arc to state s, which must be the most recently added state.
+  /// "string" must have been returned by AddString() on this object.
+  void AddArc(StateId s, Label ilabel, Label olabel, const Weight &weight,
+              const StringRef &string, StateId nextstate) {
+    KALDI_ASSERT(s + 1 == NumStates());
+    Arc arc;
+    arc.ilabel = ilabel;
+    arc.olabel = olabel;
+    arc.nextstate = nextstate;
+    arc.weight = weight;
+    arc.string = string;
+    arcs_.push_back(arc);
+    arc_begin_.back() = arcs_.size();
+  }
+
+  void SetFinal(StateId s, const Weight &weight, const StringRef &string) {
+    final_weights_[s] = weight;
+    final_strings_[s] = string;
+  }
+
+  /// Copies from the VectorFst form, replacing the current contents.
+  void CopyFrom(const ExpandedFst<CompactArc> &clat) {
+    Clear();
+    StateId num_states = clat.NumStates();
+    size_t num_arcs = 0;
+    for (StateId s = 0; s < num_states; s++)
+      num_arcs += clat.NumArcs(s);
+    Reserve(num_states, num_arcs, num_arcs);
+    for (StateId s = 0; s < num_states; s++) {
+      AddState();
+      CompactWeight final = clat.Final(s);
+      if (final != CompactWeight::Zero())
+        SetFinal(s, final.Weight(), AddString(final.String()));
+      for (ArcIterator<ExpandedFst<CompactArc> > aiter(clat, s); !aiter.Done();
+           aiter.Next()) {
+        const CompactArc &arc = aiter.Value();
+        AddArc(s, arc.ilabel, arc.olabel, arc.weight.Weight(),
+               AddString(arc.weight.String()), arc.nextstate);
+      }
+    }
+    start_ = clat.Start();
+  }
+
+  /// Copies to the VectorFst form.
+  void CopyTo(MutableFst<CompactArc> *clat) const {
+    clat->DeleteStates();
+    StateId num_states = NumStates();
+    for (StateId s = 0; s < num_states; s++)
+      clat->AddState();
+    clat->SetStart(start_);
+    std::vector<IntType> str;
+    for (StateId s = 0; s < num_states; s++) {
+      if (final_weights_[s] != Weight::Zero()) {
+        GetString(final_strings_[s], &str);
+        clat->SetFinal(s, CompactWeight(final_weights_[s], str));
+      }
+      for (const Arc *arc = ArcsBegin(s), *end = ArcsEnd(s); arc != end; ++arc) {
+        GetString(arc->string, &str);
+        clat->AddArc(s, CompactArc(arc->ilabel, arc->olabel,
+                                   CompactWeight(arc->weight, str),
+                                   arc->nextstate));
+      }
+    }
+  }
+
+  void Swap(PooledCompactLatticeTpl *other) {
+    std::swap(start_, other->start_);
+    arc_begin_.swap(other->arc_begin_);
+    final_weights_.swap(other->final_weights_);
+    final_strings_.swap(other->final_strings_);
+    arcs_.swap(other->arcs_);
+    pool_.swap(other->pool_);
+  }
+
+  void GetString(const StringRef &ref, std::vector<IntType> *str) const {
+    const IntType *data = StringData(ref);
+    str->assign(data, data + ref.size);
+  }
+
+ private:
+  StateId start_;
+  std::vector<int32> arc_begin_;  // indexed by state, plus one at the end.
+  std::vector<Weight> final_weights_;  // indexed by state.
+  std::vector<StringRef> final_strings_;  // indexed by state.
+  std::vector<Arc> arcs_;
+  std::vector<IntType> pool_;  // all the strings.
+};
+
+}  // namespace fst
+
+namespace kaldi {
+
+typedef fst::PooledCompactLatticeTpl<LatticeWeight, int32> PooledCompactLattice;
+
+/// As CompactLatticeStateTimes() in lattice-functions.h, for the pooled form:
+/// outputs the frame index at each state, and returns the total number of
+/// frames.  Requires that the lattice be topologically sorted (nextstate >
+/// state for all arcs), which lattices created by DeterminizeLatticePruned()
+/// are.
+int32 PooledCompactLatticeStateTimes(const PooledCompactLattice &clat,
+                                     std::vector<int32> *times);
+
+/// As PruneLattice() in lattice-functions.h, for the pooled form: prunes
+/// the lattice to the given beam and removes the states and arcs that are not
+/// on a successful path, and the strings that are no longer used.  Requires
+/// that the lattice be topologically sorted; returns false (with a warning)
+/// if it is not, or if it is empty.
+bool PrunePooledCompactLattice(BaseFloat beam, PooledCompactLattice *clat);
+
+}  // namespace kaldi
+
+#endif  // KALDI_LAT_POOLED_LATTICE_H_
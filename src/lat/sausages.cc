@@ -59,8 +59,9 @@ void MinimumBayesRisk::MbrDecode() {
     }
     KALDI_VLOG(2) << "Iter = " << counter << ", delta-Q = " << delta_Q;
     if (delta_Q == 0) break;
-    if (counter > 100) {
-      KALDI_WARN << "Iterating too many times in MbrDecode; stopping.";
+    if (static_cast<int32>(counter) + 1 >= max_iterations_) {
+      KALDI_VLOG(1) << "Stopping MbrDecode after " << max_iterations_
+                    << " iterations without converging.";
       break;
     }
   }
@@ -89,156 +90,167 @@ void MinimumBayesRisk::NormalizeEps(std::vector<int32> *vec) {
   (*vec)[0] = 0;
 }
 
-double MinimumBayesRisk::EditDistance(int32 N, int32 Q,
-                                      Vector<double> &alpha,
-                                      Matrix<double> &alpha_dash,
-                                      Vector<double> &alpha_dash_arc) {
-  alpha(1) = 0.0; // = log(1).  Line 5.
-  alpha_dash(1, 0) = 0.0; // Line 5.
+double MinimumBayesRisk::EditDistance(int32 N, int32 Q) {
+  // alpha(n) is not needed here: the quantities exp(alpha(s_a) + p_a -
+  // alpha(n)) of line 19 are precomputed in arc_post_, as they do not depend
+  // on R_.  alpha_dash(n, q) is alpha_dash_[n * stride + q].
+  int32 stride = Q + 1;
+  alpha_dash_.assign((N + 1) * stride, 0.0); // Line 11.
+  alpha_dash_arc_.resize(stride);
+  double *alpha_dash = &(alpha_dash_[0]),
+      *alpha_dash_arc = &(alpha_dash_arc_[0]);
+  double *alpha_dash_1 = alpha_dash + stride; // row n = 1.
+  alpha_dash_1[0] = 0.0; // Line 5.
   for (int32 q = 1; q <= Q; q++) 
-    alpha_dash(1, q) = alpha_dash(1, q-1) + l(0, r(q)); // Line 7.
+    alpha_dash_1[q] = alpha_dash_1[q-1] + l(0, r(q)); // Line 7.
   for (int32 n = 2; n <= N; n++) {
-    double alpha_n = kLogZeroDouble;
+    double *alpha_dash_n = alpha_dash + n * stride;
     for (size_t i = 0; i < pre_[n].size(); i++) {
-      const Arc &arc = arcs_[pre_[n][i]];
-      alpha_n = LogAdd(alpha_n, alpha(arc.start_node) + arc.loglike);
-    }
-    alpha(n) = alpha_n; // Line 10.
-    // Line 11 omitted: matrix was initialized to zero.
-    for (size_t i = 0; i < pre_[n].size(); i++) {
-      const Arc &arc = arcs_[pre_[n][i]];
-      int32 s_a = arc.start_node, w_a = arc.word;
-      BaseFloat p_a = arc.loglike;
-      for (int32 q = 0; q <= Q; q++) {
-        if (q == 0) {
-          alpha_dash_arc(q) = // line 15.
-              alpha_dash(s_a, q) + l(w_a, 0) + delta();
-        } else {  // a1,a2,a3 are the 3 parts of min expression of line 17.
-          int32 r_q = r(q);
-          double a1 = alpha_dash(s_a, q-1) + l(w_a, r_q),
-              a2 = alpha_dash(s_a, q) + l(w_a, 0) + delta(),
-              a3 = alpha_dash_arc(q-1) + l(0, r_q);
-          alpha_dash_arc(q) = std::min(a1, std::min(a2, a3));
-        }
-        // line 19:
-        alpha_dash(n, q) += exp(alpha(s_a) + p_a - alpha(n)) * alpha_dash_arc(q);
+      int32 a = pre_[n][i];
+      const Arc &arc = arcs_[a];
+      int32 w_a = arc.word;
+      const double *alpha_dash_s = alpha_dash + arc.start_node * stride;
+      double post = arc_post_[a], l_w0 = l(w_a, 0) + delta();
+      alpha_dash_arc[0] = alpha_dash_s[0] + l_w0; // line 15.
+      alpha_dash_n[0] += post * alpha_dash_arc[0]; // line 19.
+      for (int32 q = 1; q <= Q; q++) {
+        // a1,a2,a3 are the 3 parts of min expression of line 17.
+        int32 r_q = r(q);
+        double a1 = alpha_dash_s[q-1] + l(w_a, r_q),
+            a2 = alpha_dash_s[q] + l_w0,
+            a3 = alpha_dash_arc[q-1] + l(0, r_q);
+        alpha_dash_arc[q] = std::min(a1, std::min(a2, a3));
+        alpha_dash_n[q] += post * alpha_dash_arc[q]; // line 19.
       }
     }
   }
-  return alpha_dash(N, Q); // line 23.
+  return alpha_dash[N * stride + Q]; // line 23.
 }
 
 // Figure 5 in the paper.
 void MinimumBayesRisk::AccStats() {
-  using std::map;
-  
   int32 N = static_cast<int32>(pre_.size()) - 1,
-      Q = static_cast<int32>(R_.size());
+      Q = static_cast<int32>(R_.size()),
+      stride = Q + 1;
 
-  Vector<double> alpha(N+1); // index (1...N)
-  Matrix<double> alpha_dash(N+1, Q+1); // index (1...N, 0...Q)
-  Vector<double> alpha_dash_arc(Q+1); // index 0...Q
-  Matrix<double> beta_dash(N+1, Q+1); // index (1...N, 0...Q)
-  Vector<double> beta_dash_arc(Q+1); // index 0...Q
-  vector<char> b_arc(Q+1); // integer in {1,2,3}; index 1...Q
-  vector<map<int32, double> > gamma(Q+1); // temp. form of gamma.
-  // index 1...Q [word] -> occ.
-
-  // The tau arrays below are the sums over words of the tau_b
-  // and tau_e timing quantities mentioned in Appendix C of
-  // the paper... we are using these to get averaged times for
-  // the sausage bins, not specifically for the 1-best output.
-  Vector<double> tau_b(Q+1), tau_e(Q+1);
-
-  double Ltmp = EditDistance(N, Q, alpha, alpha_dash, alpha_dash_arc); 
+  double Ltmp = EditDistance(N, Q); 
   if (L_ != 0 && Ltmp > L_) { // L_ != 0 is to rule out 1st iter.
     KALDI_WARN << "Edit distance increased: " << Ltmp << " > "
                << L_;
   }
   L_ = Ltmp;
   KALDI_VLOG(2) << "L = " << L_;
-  // omit line 10: zero when initialized.
-  beta_dash(N, Q) = 1.0; // Line 11.
+
+  // The buffers are class members, so that we don't reallocate them on each
+  // iteration; here we size and zero them.
+  beta_dash_.assign((N + 1) * stride, 0.0); // line 10.
+  beta_dash_arc_.resize(stride);
+  b_arc_.resize(stride);
+  // The tau arrays below are the sums over words of the tau_b
+  // and tau_e timing quantities mentioned in Appendix C of
+  // the paper... we are using these to get averaged times for
+  // the sausage bins, not specifically for the 1-best output.
+  tau_b_.assign(stride, 0.0);
+  tau_e_.assign(stride, 0.0);
+  if (gamma_tmp_.size() < static_cast<size_t>(stride))
+    gamma_tmp_.resize(stride);
+  for (int32 q = 1; q <= Q; q++)
+    gamma_tmp_[q].clear();
+  
+  const double *alpha_dash = &(alpha_dash_[0]);
+  double *alpha_dash_arc = &(alpha_dash_arc_[0]),
+      *beta_dash = &(beta_dash_[0]),
+      *beta_dash_arc = &(beta_dash_arc_[0]),
+      *tau_b = &(tau_b_[0]), *tau_e = &(tau_e_[0]);
+  char *b_arc = &(b_arc_[0]);
+  
+  beta_dash[N * stride + Q] = 1.0; // Line 11.
   for (int32 n = N; n >= 2; n--) {
+    const double *beta_dash_n = beta_dash + n * stride;
     for (size_t i = 0; i < pre_[n].size(); i++) {
-      const Arc &arc = arcs_[pre_[n][i]];
+      int32 a = pre_[n][i];
+      const Arc &arc = arcs_[a];
       int32 s_a = arc.start_node, w_a = arc.word;
-      BaseFloat p_a = arc.loglike;
-      alpha_dash_arc(0) = alpha_dash(s_a, 0) + l(w_a, 0) + delta(); // line 14.
+      const double *alpha_dash_s = alpha_dash + s_a * stride;
+      double *beta_dash_s = beta_dash + s_a * stride;
+      double post = arc_post_[a], l_w0 = l(w_a, 0) + delta();
+      alpha_dash_arc[0] = alpha_dash_s[0] + l_w0; // line 14.
       for (int32 q = 1; q <= Q; q++) { // this loop == lines 15-18.
         int32 r_q = r(q);
-        double a1 = alpha_dash(s_a, q-1) + l(w_a, r_q),
-            a2 = alpha_dash(s_a, q) + l(w_a, 0) + delta(),
-            a3 = alpha_dash_arc(q-1) + l(0, r_q);
+        double a1 = alpha_dash_s[q-1] + l(w_a, r_q),
+            a2 = alpha_dash_s[q] + l_w0,
+            a3 = alpha_dash_arc[q-1] + l(0, r_q);
         if (a1 <= a2) {
-          if (a1 <= a3) { b_arc[q] = 1; alpha_dash_arc(q) = a1; }
-          else { b_arc[q] = 3; alpha_dash_arc(q) = a3; }
+          if (a1 <= a3) { b_arc[q] = 1; alpha_dash_arc[q] = a1; }
+          else { b_arc[q] = 3; alpha_dash_arc[q] = a3; }
         } else {
-          if (a2 <= a3) { b_arc[q] = 2; alpha_dash_arc(q) = a2; }
-          else { b_arc[q] = 3; alpha_dash_arc(q) = a3; }
+          if (a2 <= a3) { b_arc[q] = 2; alpha_dash_arc[q] = a2; }
+          else { b_arc[q] = 3; alpha_dash_arc[q] = a3; }
         }
       }
-      beta_dash_arc.SetZero(); // line 19.
+      std::fill(beta_dash_arc, beta_dash_arc + stride, 0.0); // line 19.
       for (int32 q = Q; q >= 1; q--) {
         // line 21:
-        beta_dash_arc(q) += exp(alpha(s_a) + p_a - alpha(n)) * beta_dash(n, q);
+        beta_dash_arc[q] += post * beta_dash_n[q];
         switch (static_cast<int>(b_arc[q])) { // lines 22 and 23:
           case 1:
-            beta_dash(s_a, q-1) += beta_dash_arc(q);
+            beta_dash_s[q-1] += beta_dash_arc[q];
             // next: gamma(q, w(a)) += beta_dash_arc(q)
-            AddToMap(w_a, beta_dash_arc(q), &(gamma[q]));
+            AddToGamma(w_a, beta_dash_arc[q], &(gamma_tmp_[q]));
             // next: accumulating times, see decl for tau_b,tau_e
-            tau_b(q) += state_times_[s_a] * beta_dash_arc(q);
-            tau_e(q) += state_times_[n] * beta_dash_arc(q);
+            tau_b[q] += state_times_[s_a] * beta_dash_arc[q];
+            tau_e[q] += state_times_[n] * beta_dash_arc[q];
             break;
           case 2:
-            beta_dash(s_a, q) += beta_dash_arc(q);
+            beta_dash_s[q] += beta_dash_arc[q];
             break;
           case 3:
-            beta_dash_arc(q-1) += beta_dash_arc(q);
+            beta_dash_arc[q-1] += beta_dash_arc[q];
             // next: gamma(q, epsilon) += beta_dash_arc(q)
-            AddToMap(0, beta_dash_arc(q), &(gamma[q]));
+            AddToGamma(0, beta_dash_arc[q], &(gamma_tmp_[q]));
             // next: accumulating times, see decl for tau_b,tau_e
             // WARNING: there was an error in Appendix C.  If we followed
             // the instructions there the next line would say state_times_[sa], but
             // it would be wrong.  I will try to publish an erratum.
-            tau_b(q) += state_times_[n] * beta_dash_arc(q);
-            tau_e(q) += state_times_[n] * beta_dash_arc(q);
+            tau_b[q] += state_times_[n] * beta_dash_arc[q];
+            tau_e[q] += state_times_[n] * beta_dash_arc[q];
             break;
           default:
             KALDI_ERR << "Invalid b_arc value"; // error in code.
         }
       }
-      beta_dash_arc(0) += exp(alpha(s_a) + p_a - alpha(n)) * beta_dash(n, 0);
-      beta_dash(s_a, 0) += beta_dash_arc(0); // line 26.
+      beta_dash_arc[0] += post * beta_dash_n[0];
+      beta_dash_s[0] += beta_dash_arc[0]; // line 26.
     }
   }
-  beta_dash_arc.SetZero(); // line 29.
+  std::fill(beta_dash_arc, beta_dash_arc + stride, 0.0); // line 29.
+  const double *beta_dash_1 = beta_dash + stride;
   for (int32 q = Q; q >= 1; q--) {
-    beta_dash_arc(q) += beta_dash(1, q);
-    beta_dash_arc(q-1) += beta_dash_arc(q);
-    AddToMap(0, beta_dash_arc(q), &(gamma[q]));
+    beta_dash_arc[q] += beta_dash_1[q];
+    beta_dash_arc[q-1] += beta_dash_arc[q];
+    AddToGamma(0, beta_dash_arc[q], &(gamma_tmp_[q]));
     // the statements below are actually redundant because
     // state_times_[1] is zero.
-    tau_b(q) += state_times_[1] * beta_dash_arc(q);
-    tau_e(q) += state_times_[1] * beta_dash_arc(q);
+    tau_b[q] += state_times_[1] * beta_dash_arc[q];
+    tau_e[q] += state_times_[1] * beta_dash_arc[q];
   }
   for (int32 q = 1; q <= Q; q++) { // a check (line 35)
     double sum = 0.0;
-    for (map<int32, double>::iterator iter = gamma[q].begin();
-         iter != gamma[q].end(); ++iter) sum += iter->second;
+    for (size_t j = 0; j < gamma_tmp_[q].size(); j++)
+      sum += gamma_tmp_[q][j].second;
     if (fabs(sum - 1.0) > 0.1)
       KALDI_WARN << "sum of gamma[" << q << ",s] is " << sum;
   }
   // The next part is where we take gamma, and convert
   // to the class member gamma_, which is using a different
   // data structure and indexed from zero, not one.
-  gamma_.clear();
   gamma_.resize(Q);
   for (int32 q = 1; q <= Q; q++) {
-    for (map<int32, double>::iterator iter = gamma[q].begin();
-         iter != gamma[q].end(); ++iter)
-      gamma_[q-1].push_back(std::make_pair(iter->first, static_cast<BaseFloat>(iter->second)));
+    const std::vector<std::pair<int32, double> > &this_gamma = gamma_tmp_[q];
+    gamma_[q-1].clear();
+    for (size_t j = 0; j < this_gamma.size(); j++)
+      gamma_[q-1].push_back(std::make_pair(this_gamma[j].first,
+                                           static_cast<BaseFloat>(this_gamma[j].second)));
     // sort gamma_[q-1] from largest to smallest posterior.
     GammaCompare comp;
     std::sort(gamma_[q-1].begin(), gamma_[q-1].end(), comp);
@@ -249,8 +261,8 @@ void MinimumBayesRisk::AccStats() {
   times_.clear();
   times_.resize(Q);
   for (int32 q = 1; q <= Q; q++) {
-    times_[q-1].first = tau_b(q);
-    times_[q-1].second = tau_e(q);
+    times_[q-1].first = tau_b[q];
+    times_[q-1].second = tau_e[q];
     if (times_[q-1].first > times_[q-1].second) // this is quite bad.
       KALDI_WARN << "Times out of order";
     if (q > 1 && times_[q-2].second > times_[q-1].first) {
@@ -265,7 +277,19 @@ void MinimumBayesRisk::AccStats() {
 }
 
 MinimumBayesRisk::MinimumBayesRisk(const CompactLattice &clat_in, bool do_mbr):
-    do_mbr_(do_mbr) {
+    do_mbr_(do_mbr), max_iterations_(MinimumBayesRiskOptions().max_iterations) {
+  Init(clat_in);
+}
+
+MinimumBayesRisk::MinimumBayesRisk(const CompactLattice &clat_in,
+                                   const MinimumBayesRiskOptions &opts):
+    do_mbr_(opts.decode_mbr), max_iterations_(opts.max_iterations) {
+  if (max_iterations_ <= 0)
+    KALDI_ERR << "Invalid --max-iterations=" << max_iterations_;
+  Init(clat_in);
+}
+
+void MinimumBayesRisk::Init(const CompactLattice &clat_in) {
   CompactLattice clat(clat_in); // copy.
 
   CreateSuperFinal(&clat); // Add super-final state to clat... this is
@@ -313,6 +337,26 @@ MinimumBayesRisk::MinimumBayesRisk(const CompactLattice &clat_in, bool do_mbr):
     }
   }
 
+  // Work out the forward log-probabilities alpha(n) (line 10 of Figure 4),
+  // and from them the arc posteriors used in lines 19 and 21 of Figures 4
+  // and 5.  These don't depend on R_, so we only do this once.
+  std::vector<double> alpha(N+1, kLogZeroDouble); // index (1...N)
+  if (N > 0) alpha[1] = 0.0; // = log(1).
+  for (int32 n = 2; n <= N; n++) {
+    double alpha_n = kLogZeroDouble;
+    for (size_t i = 0; i < pre_[n].size(); i++) {
+      const Arc &arc = arcs_[pre_[n][i]];
+      alpha_n = LogAdd(alpha_n, alpha[arc.start_node] + arc.loglike);
+    }
+    alpha[n] = alpha_n;
+  }
+  arc_post_.resize(arcs_.size());
+  for (size_t a = 0; a < arcs_.size(); a++) {
+    const Arc &arc = arcs_[a];
+    arc_post_[a] = exp(alpha[arc.start_node] + arc.loglike -
+                       alpha[arc.end_node]);
+  }
+
   // We don't need to look at clat.Start() or clat.Final(state):
   // we know clat.Start() == 0 since it's topologically sorted,
   // and clat.Final(state) is Zero() except for One() at the last-
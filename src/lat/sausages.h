@@ -52,6 +52,25 @@ namespace kaldi {
 /// is where we put possible insertions. 
 
 
+struct MinimumBayesRiskOptions {
+  /// Boolean configuration parameter: if true, we actually update the
+  /// hypothesis to do MBR decoding (if false, our output is the MAP decoded
+  /// output, but we output the stats too).
+  bool decode_mbr;
+  /// The maximum number of iterations of the algorithm (each is one
+  /// forward-backward pass of the edit-distance computation).  Usually it
+  /// converges in a few; a smaller limit trades accuracy for speed.
+  int32 max_iterations;
+  MinimumBayesRiskOptions(): decode_mbr(true), max_iterations(100) { }
+  void Register(OptionsItf *po) {
+    po->Register("decode-mbr", &decode_mbr, "If true, do Minimum Bayes Risk "
+                 "decoding (else, Maximum a Posteriori)");
+    po->Register("max-iterations", &max_iterations, "Maximum number of "
+                 "iterations of Minimum Bayes Risk decoding; fewer is faster "
+                 "but may be less accurate.");
+  }
+};
+
 /// This class does the word-level Minimum Bayes Risk computation, and gives you
 /// either the 1-best MBR output together with the expected Bayes Risk,
 /// or a sausage-like structure.
@@ -64,6 +83,9 @@ class MinimumBayesRisk {
   MinimumBayesRisk(const CompactLattice &clat, bool do_mbr = true); // if do_mbr == false,
   // it will just use the MAP recognition output, but will get the MBR stats for things
   // like confidences.
+
+  MinimumBayesRisk(const CompactLattice &clat,
+                   const MinimumBayesRiskOptions &opts);
   
   const std::vector<int32> &GetOneBest() const { // gets one-best (with no epsilons)
     return R_;
@@ -96,6 +118,10 @@ class MinimumBayesRisk {
   }  
 
  private:
+  /// Sets up the internal representation of the lattice and does the
+  /// computation; called from the constructors.
+  void Init(const CompactLattice &clat_in);
+
   /// Minimum-Bayes-Risk Decode. Top-level algorithm.  Figure 6 of the paper.
   void MbrDecode(); 
 
@@ -106,11 +132,9 @@ class MinimumBayesRisk {
   inline int32 r(int32 q) { return R_[q-1]; }
   
   
-  /// Figure 4 of the paper; called from AccStats (Fig. 5)
-  double EditDistance(int32 N, int32 Q,
-                      Vector<double> &alpha,
-                      Matrix<double> &alpha_dash,
-                      Vector<double> &alpha_dash_arc);
+  /// Figure 4 of the paper; called from AccStats (Fig. 5).  Leaves
+  /// alpha'(n, q) in alpha_dash_.
+  double EditDistance(int32 N, int32 Q);
 
   /// Figure 5 of the paper.  Outputs to gamma_ and L_.
   void AccStats(); 
@@ -125,13 +149,19 @@ class MinimumBayesRisk {
   static inline BaseFloat delta() { return 1.0e-05; } // A constant
   // used in the algorithm.
 
-  /// Function used to increment map.
-  static inline void AddToMap(int32 i, double d, std::map<int32, double> *gamma) {
+  /// Function used to increment the stats for one bin.  There are only a few
+  /// words in each bin, so a linear search is faster than a map.
+  static inline void AddToGamma(int32 i, double d,
+                                std::vector<std::pair<int32, double> > *gamma) {
     if (d == 0) return;
-    std::pair<const int32, double> pr(i, d);
-    std::pair<std::map<int32, double>::iterator, bool> ret = gamma->insert(pr);
-    if (!ret.second) // not inserted, so add to contents.
-      ret.first->second += d;
+    for (std::vector<std::pair<int32, double> >::iterator iter = gamma->begin(),
+             end = gamma->end(); iter != end; ++iter) {
+      if (iter->first == i) {
+        iter->second += d;
+        return;
+      }
+    }
+    gamma->push_back(std::make_pair(i, d));
   }
     
   struct Arc {
@@ -145,6 +175,9 @@ class MinimumBayesRisk {
   /// to do MBR decoding (if false, our output is the MAP decoded output, but we
   /// output the stats too).
   bool do_mbr_;
+
+  /// Maximum number of iterations of MbrDecode().
+  int32 max_iterations_;
   
   /// Arcs in the topologically sorted acceptor form of the word-level lattice,
   /// with one final-state.  Contains (word-symbol, log-likelihood on arc ==
@@ -157,6 +190,25 @@ class MinimumBayesRisk {
 
   std::vector<int32> state_times_; // time of each state in the word lattice,
   // indexed from 1 (same index as into pre_)
+
+  /// For each arc a (same index as arcs_), exp(alpha(s_a) + p_a - alpha(e_a)),
+  /// where alpha is the forward log-probability: the probability of the arc
+  /// given its end node.  It does not depend on R_, so we compute it once
+  /// instead of on each iteration.
+  std::vector<double> arc_post_;
+
+  // The following are used in EditDistance() and AccStats(); they are class
+  // members so that they are not reallocated on each iteration.
+  // alpha_dash_ and beta_dash_ are (N+1) by (Q+1) matrices stored by row,
+  // indexed (n, q) -> n * (Q+1) + q.
+  std::vector<double> alpha_dash_;
+  std::vector<double> alpha_dash_arc_; // index 0...Q
+  std::vector<double> beta_dash_;
+  std::vector<double> beta_dash_arc_; // index 0...Q
+  std::vector<char> b_arc_; // integer in {1,2,3}; index 1...Q
+  std::vector<double> tau_b_, tau_e_; // index 1...Q
+  std::vector<std::vector<std::pair<int32, double> > > gamma_tmp_; // temp. form
+  // of gamma; index 1...Q, each a list of (word, occupancy).
   
   std::vector<int32> R_; // current 1-best word sequence, normalized to have
   // epsilons between each word and at the beginning and end.  R in paper...
@@ -178,33 +178,62 @@ class LatticeLexiconWordAligner {
     ComputationState comp_state;
   };
 
-  struct TupleHash {
-    size_t operator() (const Tuple &state) const {
-      return state.input_state + 102763 * state.comp_state.Hash();
-      // 102763 is just an arbitrary prime number 
+  struct ComputationStateHash {
+    size_t operator() (const ComputationState &state) const {
+      return state.Hash();
     }
   };
-  struct TupleEqual {
-    bool operator () (const Tuple &state1, const Tuple &state2) const {
-      // treat this like operator ==
-      return (state1.input_state == state2.input_state
-              && state1.comp_state == state2.comp_state);
-    }
-  };
-  
-  typedef unordered_map<Tuple, StateId, TupleHash, TupleEqual> MapType;
+
+  // We have one map for each input state, from computation-state to the
+  // output state.  See AdvanceQueue() for how this limits memory use.
+  typedef unordered_map<ComputationState, StateId,
+                        ComputationStateHash> MapType;
 
   // This function may alter queue_.
   StateId GetStateForTuple(const Tuple &tuple) {
-    MapType::iterator iter = map_.find(tuple);
-    if (iter == map_.end()) { // not in map.
+    // Inserting directly means we only hash the computation state once.
+    std::pair<MapType::iterator, bool> ans =
+        maps_[tuple.input_state].insert(
+            std::make_pair(tuple.comp_state,
+                           static_cast<StateId>(fst::kNoStateId)));
+    if (ans.second) { // not previously in map.
       StateId output_state = lat_out_->AddState();
-      map_[tuple] = output_state;
-      queue_.push_back(std::make_pair(tuple, output_state));
+      ans.first->second = output_state;
+      queue_[tuple.input_state].push_back(std::make_pair(tuple, output_state));
+      // The next line only has an effect if the lattice has cycles.
+      cur_input_state_ = std::min(cur_input_state_, tuple.input_state);
       return output_state;
     } else {
-      return iter->second;
+      return ans.first->second;
+    }
+  }
+
+  // The queue is processed in order of input state, i.e. in topological order
+  // of the input lattice, so once we have processed all the tuples for input
+  // state s no more can appear and we can free its map; see the same function
+  // in word-align-lattice.cc.  We don't free the maps of final states, which
+  // ProcessFinalForceOut() may need.  This function moves cur_input_state_ to
+  // the first input state with tuples to process, and returns false if there
+  // are none.
+  bool AdvanceQueue() {
+    StateId num_states = queue_.size();
+    while (cur_input_state_ < num_states &&
+           queue_[cur_input_state_].empty()) {
+      if (top_sorted_ &&
+          lat_in_.Final(cur_input_state_) == CompactLatticeWeight::Zero()) {
+        MapType empty_map;
+        maps_[cur_input_state_].swap(empty_map);
+      }
+      cur_input_state_++;
     }
+    return (cur_input_state_ < num_states);
+  }
+
+  // Discards any tuples that are still in the queue.
+  void ClearQueue() {
+    for (size_t i = 0; i < queue_.size(); i++)
+      queue_[i].clear();
+    cur_input_state_ = queue_.size();
   }
   
   // This function may alter queue_, via GetStateForTuple.
@@ -266,10 +295,12 @@ class LatticeLexiconWordAligner {
   }
 
   void ProcessQueueElement() {
-    KALDI_ASSERT(!queue_.empty());
-    Tuple tuple = queue_.back().first;
-    StateId output_state = queue_.back().second;
-    queue_.pop_back();
+    std::vector<std::pair<Tuple, StateId> > &this_queue =
+        queue_[cur_input_state_];
+    KALDI_ASSERT(!this_queue.empty());
+    Tuple tuple = this_queue.back().first;
+    StateId output_state = this_queue.back().second;
+    this_queue.pop_back();
 
     ProcessEpsilonTransitions(tuple, output_state);
     ProcessWordTransitions(tuple, output_state);
@@ -290,7 +321,7 @@ class LatticeLexiconWordAligner {
                             CompactLattice *lat_out):
       lat_in_(lat), tmodel_(tmodel), lexicon_info_(lexicon_info),
       max_states_(max_states), 
-      lat_out_(lat_out),
+      lat_out_(lat_out), cur_input_state_(0),
       partial_word_label_(partial_word_label == 0 ?
                           kTemporaryEpsilon : partial_word_label),
       error_(false) {
@@ -298,7 +329,14 @@ class LatticeLexiconWordAligner {
 
     fst::CreateSuperFinal(&lat_in_); // Creates a super-final state, so the
     // only final-probs are One().  Note: the member lat_in_ is not a reference.
-    
+    // We process the input states in topological order (see AdvanceQueue()).
+    top_sorted_ = (lat_in_.Properties(fst::kTopSorted, true) != 0 ||
+                   fst::TopSort(&lat_in_));
+    if (!top_sorted_)
+      KALDI_WARN << "Lattice has cycles; word alignment will use more memory.";
+    maps_.resize(lat_in_.NumStates());
+    queue_.resize(lat_in_.NumStates());
+
   }
 
   // Removes epsilons; also removes unreachable states...
@@ -327,7 +365,7 @@ class LatticeLexiconWordAligner {
     StateId start_state = GetStateForTuple(initial_tuple);
     lat_out_->SetStart(start_state);
     
-    while (!queue_.empty()) {
+    while (AdvanceQueue()) {
       if (max_states_ > 0 && lat_out_->NumStates() > max_states_) {
         KALDI_WARN << "Number of states in lattice exceeded max-states of "
                    << max_states_ << ", original lattice had "
@@ -349,13 +387,19 @@ class LatticeLexiconWordAligner {
   int32 max_states_;
   CompactLattice *lat_out_;
 
-  std::vector<std::pair<Tuple, StateId> > queue_;
+  bool top_sorted_;  // true if lat_in_ is topologically sorted.
+  // queue_[s] contains the tuples with input state s that we have yet to
+  // process, and the corresponding output states.
+  std::vector<std::vector<std::pair<Tuple, StateId> > > queue_;
+  StateId cur_input_state_;  // we process queue_ in order of input state.
 
   std::vector<std::pair<Tuple, StateId> > final_queue_; // as queue_, but
   // just contains states that may have final-probs to process.  We process these
   // all at once, at the end.
   
-  MapType map_; // map from tuples to StateId.
+  // maps_[s] maps from computation-state to output state, for tuples with
+  // input state s.
+  std::vector<MapType> maps_;
   int32 partial_word_label_;
   bool error_;
 };
@@ -543,7 +587,7 @@ bool LatticeLexiconWordAligner::HasNonEpsArcsOut(StateId output_state) {
 }
 
 void LatticeLexiconWordAligner::ProcessFinalForceOut() {
-  KALDI_ASSERT(queue_.empty());
+  KALDI_ASSERT(!AdvanceQueue());
   std::vector<std::pair<Tuple, StateId> > new_final_queue_;
   new_final_queue_.reserve(final_queue_.size());
   for (size_t i = 0; i < final_queue_.size();i++) { // note: all the states will
@@ -568,7 +612,7 @@ void LatticeLexiconWordAligner::ProcessFinalForceOut() {
       new_final_queue_.push_back(std::make_pair(tuple, new_state));
     }
   }
-  queue_.clear();
+  ClearQueue();
   std::swap(final_queue_, new_final_queue_);
 }
 
@@ -140,33 +140,59 @@ class LatticeWordAligner {
     ComputationState comp_state;
   };
 
-  struct TupleHash {
-    size_t operator() (const Tuple &state) const {
-      return state.input_state + 102763 * state.comp_state.Hash();
-      // 102763 is just an arbitrary prime number 
+  struct ComputationStateHash {
+    size_t operator() (const ComputationState &state) const {
+      return state.Hash();
     }
   };
-  struct TupleEqual {
-    bool operator () (const Tuple &state1, const Tuple &state2) const {
-      // treat this like operator ==
-      return (state1.input_state == state2.input_state
-              && state1.comp_state == state2.comp_state);
-    }
-  };
-  
-  typedef unordered_map<Tuple, StateId, TupleHash, TupleEqual> MapType;
+
+  // We have one map for each input state, from computation-state to the
+  // output state.  See AdvanceQueue() for how this limits memory use.
+  typedef unordered_map<ComputationState, StateId,
+                        ComputationStateHash> MapType;
 
   StateId GetStateForTuple(const Tuple &tuple, bool add_to_queue) {
-    MapType::iterator iter = map_.find(tuple);
-    if (iter == map_.end()) { // not in map.
+    // Inserting directly means we only hash the computation state once.
+    std::pair<MapType::iterator, bool> ans =
+        maps_[tuple.input_state].insert(
+            std::make_pair(tuple.comp_state,
+                           static_cast<StateId>(fst::kNoStateId)));
+    if (ans.second) { // not previously in map.
       StateId output_state = lat_out_->AddState();
-      map_[tuple] = output_state;
-      if (add_to_queue)
-        queue_.push_back(std::make_pair(tuple, output_state));
+      ans.first->second = output_state;
+      if (add_to_queue) {
+        queue_[tuple.input_state].push_back(
+            std::make_pair(tuple, output_state));
+        // The next line only has an effect if the lattice has cycles.
+        cur_input_state_ = std::min(cur_input_state_, tuple.input_state);
+      }
       return output_state;
     } else {
-      return iter->second;
+      return ans.first->second;
+    }
+  }
+
+  // The queue is processed in order of input state, i.e. in topological order
+  // of the input lattice: tuples for input state s are only created from
+  // tuples for s or for its predecessors.  So once we have processed all the
+  // tuples for s, no more can appear and we can free its map, which keeps the
+  // memory used by the maps bounded by the "width" of the lattice rather than
+  // its length.  We don't free the maps of final states (there is only one,
+  // the super-final state, which is processed last), or any maps if the
+  // lattice has cycles.  This function moves cur_input_state_ to the first
+  // input state with tuples to process, and returns false if there are none.
+  bool AdvanceQueue() {
+    StateId num_states = queue_.size();
+    while (cur_input_state_ < num_states &&
+           queue_[cur_input_state_].empty()) {
+      if (top_sorted_ &&
+          lat_.Final(cur_input_state_) == CompactLatticeWeight::Zero()) {
+        MapType empty_map;
+        maps_[cur_input_state_].swap(empty_map);
+      }
+      cur_input_state_++;
     }
+    return (cur_input_state_ < num_states);
   }
   
   void ProcessFinal(Tuple tuple, StateId output_state) {
@@ -199,10 +225,12 @@ class LatticeWordAligner {
 
   
   void ProcessQueueElement() {
-    KALDI_ASSERT(!queue_.empty());
-    Tuple tuple = queue_.back().first;
-    StateId output_state = queue_.back().second;
-    queue_.pop_back();
+    std::vector<std::pair<Tuple, StateId> > &this_queue =
+        queue_[cur_input_state_];
+    KALDI_ASSERT(!this_queue.empty());
+    Tuple tuple = this_queue.back().first;
+    StateId output_state = this_queue.back().second;
+    this_queue.pop_back();
 
     // First thing is-- we see whether the computation-state has something
     // pending that it wants to output.  In this case we don't do
@@ -256,7 +284,7 @@ class LatticeWordAligner {
                      CompactLattice *lat_out):
       lat_(lat), tmodel_(tmodel), info_in_(info), info_(info),
       max_states_(max_states), lat_out_(lat_out),
-      error_(false) {
+      cur_input_state_(0), error_(false) {
     bool test = true;
     uint64 props = lat_.Properties(fst::kIDeterministic|fst::kIEpsilons, test);
     if (props != fst::kIDeterministic) {
@@ -266,6 +294,13 @@ class LatticeWordAligner {
     }
     fst::CreateSuperFinal(&lat_); // Creates a super-final state, so the
     // only final-probs are One().
+    // We process the input states in topological order (see AdvanceQueue()).
+    top_sorted_ = (lat_.Properties(fst::kTopSorted, true) != 0 ||
+                   fst::TopSort(&lat_));
+    if (!top_sorted_)
+      KALDI_WARN << "Lattice has cycles; word alignment will use more memory.";
+    maps_.resize(lat_.NumStates());
+    queue_.resize(lat_.NumStates());
     
     // Inside this class, we don't want to use zero for the silence
     // or partial-word labels, as this will interfere with the RmEpsilon
@@ -311,7 +346,7 @@ class LatticeWordAligner {
     StateId start_state = GetStateForTuple(initial_tuple, true); // True = add this to queue.
     lat_out_->SetStart(start_state);
     
-    while (!queue_.empty()) {
+    while (AdvanceQueue()) {
       if (max_states_ > 0 && lat_out_->NumStates() > max_states_) {
         KALDI_WARN << "Number of states in lattice exceeded max-states of "
                    << max_states_ << ", original lattice had "
@@ -334,9 +369,15 @@ class LatticeWordAligner {
   int32 max_states_;
   CompactLattice *lat_out_;
 
-  std::vector<std::pair<Tuple, StateId> > queue_;
+  bool top_sorted_;  // true if lat_ is topologically sorted.
+  // queue_[s] contains the tuples with input state s that we have yet to
+  // process, and the corresponding output states.
+  std::vector<std::vector<std::pair<Tuple, StateId> > > queue_;
+  StateId cur_input_state_;  // we process queue_ in order of input state.
   
-  MapType map_; // map from tuples to StateId.
+  // maps_[s] maps from computation-state to output state, for tuples with
+  // input state s.
+  std::vector<MapType> maps_;
   bool error_;
   
 };
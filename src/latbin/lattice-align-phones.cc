@@ -23,6 +23,65 @@
 #include "lat/kaldi-lattice.h"
 #include "lat/phone-align-lattice.h"
 #include "lat/lattice-functions.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+// Phone-aligns one lattice; used with RunTableTasks().
+class LatticeAlignPhonesWorker {
+ public:
+  typedef CompactLattice Input;
+  typedef CompactLattice Result;
+
+  LatticeAlignPhonesWorker(const TransitionModel &tmodel,
+                           const PhoneAlignLatticeOptions &opts,
+                           bool output_if_error,
+                           CompactLatticeWriter *writer):
+      num_done(0), num_err(0), tmodel_(tmodel), opts_(opts),
+      output_if_error_(output_if_error), writer_(writer) { }
+
+  bool Process(const std::string &key, CompactLattice *clat,
+               CompactLattice *aligned_clat) const {
+    bool ok = PhoneAlignLattice(*clat, tmodel_, opts_, aligned_clat);
+    if (aligned_clat->Start() != fst::kNoStateId)
+      TopSortCompactLatticeIfNeeded(aligned_clat);
+    return ok;
+  }
+
+  void Write(const std::string &key, bool ok,
+             const CompactLattice &aligned_clat) {
+    if (!ok) {
+      num_err++;
+      if (!output_if_error_)
+        KALDI_WARN << "Lattice for " << key << " did align correctly";
+      else {
+        if (aligned_clat.Start() != fst::kNoStateId) {
+          KALDI_LOG << "Outputting partial lattice for " << key;
+          writer_->Write(key, aligned_clat);
+        }
+      }
+    } else {
+      if (aligned_clat.Start() == fst::kNoStateId) {
+        num_err++;
+        KALDI_WARN << "Lattice was empty for key " << key;
+      } else {
+        num_done++;
+        KALDI_VLOG(2) << "Aligned lattice for " << key;
+        writer_->Write(key, aligned_clat);
+      }
+    }
+  }
+
+  int32 num_done, num_err;
+
+ private:
+  const TransitionModel &tmodel_;
+  const PhoneAlignLatticeOptions &opts_;
+  bool output_if_error_;
+  CompactLatticeWriter *writer_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -40,12 +99,14 @@ int main(int argc, char *argv[]) {
     
     ParseOptions po(usage);
     bool output_if_error = true;
+    TaskSequencerConfig sequencer_config; // has --num-threads option
     
     po.Register("output-error-lats", &output_if_error, "Output lattices that aligned "
                 "with errors (e.g. due to force-out");
     
     PhoneAlignLatticeOptions opts;
     opts.Register(&po);
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -65,38 +126,10 @@ int main(int argc, char *argv[]) {
     SequentialCompactLatticeReader clat_reader(lats_rspecifier);
     CompactLatticeWriter clat_writer(lats_wspecifier); 
 
-    int32 num_done = 0, num_err = 0;
-    
-    for (; !clat_reader.Done(); clat_reader.Next()) {
-      std::string key = clat_reader.Key();
-      const CompactLattice &clat = clat_reader.Value();
-
-      CompactLattice aligned_clat;
-      bool ok = PhoneAlignLattice(clat, tmodel, opts, &aligned_clat);
-      
-      if (!ok) {
-        num_err++;
-        if (!output_if_error)
-          KALDI_WARN << "Lattice for " << key << " did align correctly";
-        else {
-          if (aligned_clat.Start() != fst::kNoStateId) {
-            KALDI_LOG << "Outputting partial lattice for " << key;
-            TopSortCompactLatticeIfNeeded(&aligned_clat);
-            clat_writer.Write(key, aligned_clat);
-          }
-        }
-      } else {
-        if (aligned_clat.Start() == fst::kNoStateId) {
-          num_err++;
-          KALDI_WARN << "Lattice was empty for key " << key;
-        } else {
-          num_done++;
-          KALDI_VLOG(2) << "Aligned lattice for " << key;
-          TopSortCompactLatticeIfNeeded(&aligned_clat);
-          clat_writer.Write(key, aligned_clat);
-        }
-      }
-    }
+    LatticeAlignPhonesWorker worker(tmodel, opts, output_if_error,
+                                    &clat_writer);
+    RunTableTasks(sequencer_config, &clat_reader, &worker);
+    int32 num_done = worker.num_done, num_err = worker.num_err;
     KALDI_LOG << "Successfully aligned " << num_done << " lattices; "
               << num_err << " had errors.";
     return (num_done > num_err ? 0 : 1); // We changed the error condition slightly here,
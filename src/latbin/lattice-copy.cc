@@ -38,11 +38,17 @@ int main(int argc, char *argv[]) {
         "format to standard from compact lattice.)\n"
         "Usage: lattice-copy [options] lattice-rspecifier lattice-wspecifier\n"
         " e.g.: lattice-copy --write-compact=false ark:1.lats ark,t:text.lats\n"
+        "With --write-packed=true, compact lattices are written in Kaldi's packed\n"
+        "binary format, which is smaller and faster to read; all lattice-reading\n"
+        "programs recognize it, but OpenFst tools cannot read it.\n"
         "See also: lattice-to-fst, and the script egs/wsj/s5/utils/convert_slf.pl\n";
     
     ParseOptions po(usage);
     bool write_compact = true;
+    bool write_packed = false;
     po.Register("write-compact", &write_compact, "If true, write in normal (compact) form.");
+    po.Register("write-packed", &write_packed, "If true (and --write-compact=true), "
+                "write binary lattices in the packed format.");
     
     po.Read(argc, argv);
 
@@ -55,6 +61,7 @@ int main(int argc, char *argv[]) {
         lats_wspecifier = po.GetArg(2);
 
     int32 n_done = 0;
+    SetWritePackedCompactLattice(write_packed);
     
     if (write_compact) {
       SequentialCompactLatticeReader lattice_reader(lats_rspecifier);
@@ -20,6 +20,7 @@
 #include "util/common-utils.h"
 #include "lat/kaldi-lattice.h"
 #include "lat/determinize-lattice-pruned.h"
+#include "lat/determinize-lattice-pruned-parallel.h"
 #include "lat/lattice-functions.h"
 #include "lat/push-lattice.h"
 #include "lat/minimize-lattice.h"
@@ -32,6 +33,7 @@ class DeterminizeLatticeTask {
   // Initializer takes ownership of "lat".
   DeterminizeLatticeTask(
       fst::DeterminizeLatticePrunedOptions &opts,
+      const DeterminizeLatticeParallelOptions &parallel_opts,
       std::string key,
       BaseFloat acoustic_scale,
       BaseFloat beam,
@@ -39,8 +41,8 @@ class DeterminizeLatticeTask {
       Lattice *lat,
       CompactLatticeWriter *clat_writer,
       int32 *num_warn):
-      opts_(opts), key_(key), acoustic_scale_(acoustic_scale), beam_(beam),
-      minimize_(minimize), lat_(lat), clat_writer_(clat_writer),
+      opts_(opts), parallel_opts_(parallel_opts), key_(key),
+      acoustic_scale_(acoustic_scale), beam_(beam), minimize_(minimize), lat_(lat), clat_writer_(clat_writer),
       num_warn_(num_warn) { }
 
   void operator () () {
@@ -55,7 +57,8 @@ class DeterminizeLatticeTask {
       (*num_warn_)++;
     }
     fst::ArcSort(lat_, fst::ILabelCompare<LatticeArc>());
-    if (!DeterminizeLatticePruned(*lat_, beam_, &det_clat_, opts_)) {
+    if (!DeterminizeLatticePrunedParallel(*lat_, beam_, &det_clat_, opts_,
+                                          parallel_opts_)) {
       KALDI_WARN << "For key " << key_ << ", determinization did not succeed"
           "(partial output will be pruned tighter than the specified beam.)";
       (*num_warn_)++;
@@ -78,6 +81,7 @@ class DeterminizeLatticeTask {
   }
  private:
   const fst::DeterminizeLatticePrunedOptions &opts_;
+  const DeterminizeLatticeParallelOptions &parallel_opts_;
   std::string key_;
   BaseFloat acoustic_scale_;
   BaseFloat beam_;
@@ -103,6 +107,8 @@ int main(int argc, char *argv[]) {
         "for each input-symbol sequence.  This is a version of lattice-determnize-pruned\n"
         "that accepts the --num-threads option.  These programs do pruning as part of the\n"
         "determinization algorithm, which is more efficient and prevents blowup.\n"
+        "With --num-segment-threads > 1, long lattices are also split into segments\n"
+        "that are determinized in parallel.\n"
         "See http://kaldi.sourceforge.net/lattices.html for more information on lattices.\n"
         "\n"
         "Usage: lattice-determinize-pruned-parallel [options] lattice-rspecifier lattice-wspecifier\n"
@@ -124,8 +130,10 @@ int main(int argc, char *argv[]) {
     po.Register("beam", &beam, "Pruning beam [applied after acoustic scaling].");
     po.Register("minimize", &minimize,
                 "If true, push and minimize after determinization");
+    DeterminizeLatticeParallelOptions parallel_config;
     determinize_config.Register(&po);
     sequencer_config.Register(&po);
+    parallel_config.Register(&po);
     po.Read(argc, argv);
 
     if (po.NumArgs() != 2) {
@@ -159,8 +167,8 @@ int main(int argc, char *argv[]) {
       KALDI_VLOG(2) << "Processing lattice " << key;
 
       DeterminizeLatticeTask *task = new DeterminizeLatticeTask(
-          determinize_config, key, acoustic_scale, beam, minimize,
-          lat, &compact_lat_writer, &n_warn);
+          determinize_config, parallel_config, key, acoustic_scale, beam,
+          minimize, lat, &compact_lat_writer, &n_warn);
       sequencer.Run(task);
       n_done++;
     }
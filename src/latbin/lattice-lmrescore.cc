@@ -22,6 +22,49 @@
 #include "util/common-utils.h"
 #include "fstext/fstext-lib.h"
 #include "lat/kaldi-lattice.h"
+#include "lat/lattice-functions.h"
+#include "lat/lattice-lm-rescore.h"
+#include "lm/compact-ngram-lm.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+// Rescores one lattice with the LM; used with RunTableTasks().
+class LatticeLmRescoreWorker {
+ public:
+  typedef Lattice Input;
+  typedef CompactLattice Result;
+
+  LatticeLmRescoreWorker(BaseFloat lm_scale, const LatticeLmRescorer &rescorer,
+                         CompactLatticeWriter *compact_lattice_writer):
+      n_done(0), n_fail(0), lm_scale_(lm_scale), rescorer_(rescorer),
+      compact_lattice_writer_(compact_lattice_writer) { }
+
+  bool Process(const std::string &key, Lattice *lat,
+               CompactLattice *determinized_lat) const {
+    return rescorer_.Rescore(lm_scale_, lat, determinized_lat);
+  }
+
+  void Write(const std::string &key, bool ok,
+             const CompactLattice &determinized_lat) {
+    if (!ok) {
+      KALDI_WARN << "Empty lattice for utterance " << key << " (incompatible LM?)";
+      n_fail++;
+    } else {
+      compact_lattice_writer_->Write(key, determinized_lat);
+      n_done++;
+    }
+  }
+
+  int32 n_done, n_fail;
+
+ private:
+  BaseFloat lm_scale_;
+  const LatticeLmRescorer &rescorer_;
+  CompactLatticeWriter *compact_lattice_writer_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -37,13 +80,23 @@ int main(int argc, char *argv[]) {
         "Add lm_scale * [cost of best path through LM FST] to graph-cost of\n"
         "paths through lattice.  Does this by composing with LM FST, then\n"
         "lattice-determinizing (it has to negate weights first if lm_scale<0)\n"
+        "The LM may also be in the format written by arpa-to-compact-lm, for\n"
+        "LMs too large to turn into an FST; in that case it must be a file,\n"
+        "which is memory-mapped, and the LM arcs that the lattices use are kept\n"
+        "in a cache shared by the threads and the utterances (see --lm-cache-size).\n"
         "Usage: lattice-lmrescore [options] lattice-rspecifier lm-fst-in lattice-wspecifier\n"
         " e.g.: lattice-lmrescore --lm-scale=-1.0 ark:in.lats data/G.fst ark:out.lats\n";
       
     ParseOptions po(usage);
     BaseFloat lm_scale = 1.0;
+    int32 lm_cache_size = 1000000;
+    TaskSequencerConfig sequencer_config; // has --num-threads option
     
     po.Register("lm-scale", &lm_scale, "Scaling factor for language model costs; frequently 1.0 or -1.0");
+    po.Register("lm-cache-size", &lm_cache_size, "For a compact LM, the number "
+                "of LM arcs to cache across utterances and threads (0 means "
+                "no cache)");
+    sequencer_config.Register(&po);
     
     po.Read(argc, argv);
 
@@ -58,35 +111,32 @@ int main(int argc, char *argv[]) {
 
 
 
-    VectorFst<StdArc> *std_lm_fst = ReadFstKaldi(fst_rxfilename);    
+    // If the LM is a compact LM (from arpa-to-compact-lm) we compose with it
+    // on demand; otherwise it is an FST and we use TableCompose.
+    CompactNgramLm *compact_lm = NULL;
+    CompactNgramLmDeterministicFst *compact_lm_fst = NULL;
+    // The cache of the arcs of compact_lm_fst; the lookups in the trie (with
+    // the backoff) are the main cost of rescoring with a large LM.
+    fst::SharedCacheDeterministicOnDemandFst<StdArc> *cached_lm_fst = NULL;
+    if (ClassifyRxfilename(fst_rxfilename) == kFileInput &&
+        CompactNgramLm::IsCompactNgramLm(fst_rxfilename)) {
+      compact_lm = new CompactNgramLm;
+      if (!compact_lm->Open(fst_rxfilename))
+        KALDI_ERR << "Could not open compact LM " << fst_rxfilename;
+      compact_lm_fst = new CompactNgramLmDeterministicFst(*compact_lm);
+      if (lm_cache_size > 0)
+        cached_lm_fst = new fst::SharedCacheDeterministicOnDemandFst<StdArc>(
+            compact_lm_fst, lm_cache_size, 64, true);  // true: thread-safe.
+    }
+
+    VectorFst<StdArc> *std_lm_fst = (compact_lm != NULL ? new VectorFst<StdArc>
+                                     : ReadFstKaldi(fst_rxfilename));
     if (std_lm_fst->Properties(fst::kILabelSorted, true) == 0) {
       // Make sure LM is sorted on ilabel.
       fst::ILabelCompare<StdArc> ilabel_comp;
       fst::ArcSort(std_lm_fst, ilabel_comp);
     }
 
-    // mapped_fst is the LM fst interpreted using the LatticeWeight semiring,
-    // with all the cost on the first member of the pair (since it's a graph
-    // weight).
-    fst::StdToLatticeMapper<BaseFloat> mapper;
-    fst::MapFst<StdArc, LatticeArc, fst::StdToLatticeMapper<BaseFloat> >
-        lm_fst(*std_lm_fst, mapper);
-    delete std_lm_fst;
-    
-    // The next fifteen or so lines are a kind of optimization and
-    // can be ignored if you just want to understand what is going on.
-    // Change the options for TableCompose to match the input
-    // (because it's the arcs of the LM FST we want to do lookup
-    // on).
-    fst::TableComposeOptions compose_opts(fst::TableMatcherOptions(),
-                                          true, fst::SEQUENCE_FILTER,
-                                          fst::MATCH_INPUT);
-    
-    // The following is an optimization for the TableCompose
-    // composition: it stores certain tables that enable fast
-    // lookup of arcs during composition.
-    fst::TableComposeCache<fst::Fst<LatticeArc> > lm_compose_cache(compose_opts);
-    
     // Read as regular lattice-- this is the form we need it in for efficient
     // composition and determinization.
     SequentialLatticeReader lattice_reader(lats_rspecifier);
@@ -94,49 +144,18 @@ int main(int argc, char *argv[]) {
     // Write as compact lattice.
     CompactLatticeWriter compact_lattice_writer(lats_wspecifier); 
 
-    int32 n_done = 0, n_fail = 0;
-    
-    for (; !lattice_reader.Done(); lattice_reader.Next()) {
-      std::string key = lattice_reader.Key();
-      Lattice lat = lattice_reader.Value();
-      lattice_reader.FreeCurrent();
-      if (lm_scale != 0.0) {
-        // Only need to modify it if LM scale nonzero.
-        // Before composing with the LM FST, we scale the lattice weights
-        // by the inverse of "lm_scale".  We'll later scale by "lm_scale".
-        // We do it this way so we can determinize and it will give the
-        // right effect (taking the "best path" through the LM) regardless
-        // of the sign of lm_scale.
-        fst::ScaleLattice(fst::GraphLatticeScale(1.0/lm_scale), &lat);
-        ArcSort(&lat, fst::OLabelCompare<LatticeArc>());
-        
-        Lattice composed_lat;
-        // Could just do, more simply: Compose(lat, lm_fst, &composed_lat);
-        // and not have lm_compose_cache at all.
-        // The command below is faster, though; it's constant not
-        // logarithmic in vocab size.
-        TableCompose(lat, lm_fst, &composed_lat, &lm_compose_cache);
-
-        Invert(&composed_lat); // make it so word labels are on the input.
-        CompactLattice determinized_lat;
-        DeterminizeLattice(composed_lat, &determinized_lat);
-        fst::ScaleLattice(fst::GraphLatticeScale(lm_scale), &determinized_lat);
-        if (determinized_lat.Start() == fst::kNoStateId) {
-          KALDI_WARN << "Empty lattice for utterance " << key << " (incompatible LM?)";
-          n_fail++;
-        } else {
-          compact_lattice_writer.Write(key, determinized_lat);
-          n_done++;
-        }
-      } else {
-        // zero scale so nothing to do.
-        n_done++;
-        CompactLattice compact_lat;
-        ConvertLattice(lat, &compact_lat);
-        compact_lattice_writer.Write(key, compact_lat);
-      }
-    }
+    fst::DeterministicOnDemandFst<StdArc> *det_lm_fst = compact_lm_fst;
+    if (cached_lm_fst != NULL) det_lm_fst = cached_lm_fst;
+    LatticeLmRescorer rescorer((det_lm_fst != NULL ? NULL : std_lm_fst),
+                               det_lm_fst);
+    LatticeLmRescoreWorker worker(lm_scale, rescorer, &compact_lattice_writer);
+    RunTableTasks(sequencer_config, &lattice_reader, &worker);
+    int32 n_done = worker.n_done, n_fail = worker.n_fail;
 
+    delete std_lm_fst;
+    delete cached_lm_fst;
+    delete compact_lm_fst;
+    delete compact_lm;
     KALDI_LOG << "Done " << n_done << " lattices, failed for " << n_fail;
     return (n_done != 0 ? 0 : 1);
   } catch(const std::exception &e) {
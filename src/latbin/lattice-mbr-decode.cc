@@ -20,6 +20,80 @@
 #include "util/common-utils.h"
 #include "lat/sausages.h"
 #include "hmm/posterior.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+// Does MBR decoding of one lattice; used with RunTableTasks().
+class LatticeMbrDecodeWorker {
+ public:
+  typedef CompactLattice Input;
+  struct Result {
+    std::vector<int32> one_best;
+    BaseFloat bayes_risk;
+    Posterior sausage_stats;
+    std::vector<std::pair<BaseFloat, BaseFloat> > times;
+  };
+
+  LatticeMbrDecodeWorker(BaseFloat acoustic_scale, BaseFloat lm_scale,
+                         const MinimumBayesRiskOptions &mbr_opts,
+                         bool one_best_times,
+                         Int32VectorWriter *trans_writer,
+                         BaseFloatWriter *bayes_risk_writer,
+                         PosteriorWriter *sausage_stats_writer,
+                         BaseFloatPairVectorWriter *times_writer):
+      n_done(0), n_words(0), tot_bayes_risk(0.0),
+      acoustic_scale_(acoustic_scale), lm_scale_(lm_scale),
+      mbr_opts_(mbr_opts), one_best_times_(one_best_times), trans_writer_(trans_writer),
+      bayes_risk_writer_(bayes_risk_writer),
+      sausage_stats_writer_(sausage_stats_writer),
+      times_writer_(times_writer) { }
+
+  bool Process(const std::string &key, CompactLattice *clat,
+               Result *result) const {
+    fst::ScaleLattice(fst::LatticeScale(lm_scale_, acoustic_scale_), clat);
+
+    MinimumBayesRisk mbr(*clat, mbr_opts_);
+
+    result->one_best = mbr.GetOneBest();
+    result->bayes_risk = mbr.GetBayesRisk();
+    if (sausage_stats_writer_->IsOpen())
+      result->sausage_stats = mbr.GetSausageStats();
+    if (times_writer_->IsOpen())
+      result->times = (one_best_times_ ? mbr.GetOneBestTimes() :
+                       mbr.GetSausageTimes());
+    return true;
+  }
+
+  void Write(const std::string &key, bool ok, const Result &result) {
+    if (trans_writer_->IsOpen())
+      trans_writer_->Write(key, result.one_best);
+    if (bayes_risk_writer_->IsOpen())
+      bayes_risk_writer_->Write(key, result.bayes_risk);
+    if (sausage_stats_writer_->IsOpen())
+      sausage_stats_writer_->Write(key, result.sausage_stats);
+    if (times_writer_->IsOpen())
+      times_writer_->Write(key, result.times);
+      
+    n_done++;
+    n_words += result.one_best.size();
+    tot_bayes_risk += result.bayes_risk;
+  }
+
+  int32 n_done, n_words;
+  BaseFloat tot_bayes_risk;
+
+ private:
+  BaseFloat acoustic_scale_, lm_scale_;
+  MinimumBayesRiskOptions mbr_opts_;
+  bool one_best_times_;
+  Int32VectorWriter *trans_writer_;
+  BaseFloatWriter *bayes_risk_writer_;
+  PosteriorWriter *sausage_stats_writer_;
+  BaseFloatPairVectorWriter *times_writer_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -50,6 +124,8 @@ int main(int argc, char *argv[]) {
     BaseFloat acoustic_scale = 1.0;
     BaseFloat lm_scale = 1.0;
     bool one_best_times = false;
+    MinimumBayesRiskOptions mbr_opts;
+    TaskSequencerConfig sequencer_config; // has --num-threads option
 
     std::string word_syms_filename;
     po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for "
@@ -60,6 +136,8 @@ int main(int argc, char *argv[]) {
                 "words [for debug output]");
     po.Register("one-best-times", &one_best_times, "If true, output times "
                 "corresponding to one-best, not whole sausage.");
+    mbr_opts.Register(&po);
+    sequencer_config.Register(&po);
     
     po.Read(argc, argv);
 
@@ -91,31 +169,13 @@ int main(int argc, char *argv[]) {
         KALDI_ERR << "Could not read symbol table from file "
                    << word_syms_filename;
 
-    int32 n_done = 0, n_words = 0;
-    BaseFloat tot_bayes_risk = 0.0;
-    
-    for (; !clat_reader.Done(); clat_reader.Next()) {
-      std::string key = clat_reader.Key();
-      CompactLattice clat = clat_reader.Value();
-      clat_reader.FreeCurrent();
-      fst::ScaleLattice(fst::LatticeScale(lm_scale, acoustic_scale), &clat);
-
-      MinimumBayesRisk mbr(clat);
-
-      if (trans_wspecifier != "")
-        trans_writer.Write(key, mbr.GetOneBest());
-      if (bayes_risk_wspecifier != "")
-        bayes_risk_writer.Write(key, mbr.GetBayesRisk());
-      if (sausage_stats_wspecifier != "")
-        sausage_stats_writer.Write(key, mbr.GetSausageStats());
-      if (times_wspecifier != "")
-        times_writer.Write(key, one_best_times ? mbr.GetOneBestTimes() :
-                           mbr.GetSausageTimes());
-      
-      n_done++;
-      n_words += mbr.GetOneBest().size();
-      tot_bayes_risk += mbr.GetBayesRisk();
-    }
+    LatticeMbrDecodeWorker worker(acoustic_scale, lm_scale, mbr_opts,
+                                  one_best_times,
+                                  &trans_writer, &bayes_risk_writer,
+                                  &sausage_stats_writer, &times_writer);
+    RunTableTasks(sequencer_config, &clat_reader, &worker);
+    int32 n_done = worker.n_done, n_words = worker.n_words;
+    BaseFloat tot_bayes_risk = worker.tot_bayes_risk;
 
     KALDI_LOG << "Done " << n_done << " lattices.";
     KALDI_LOG << "Average Bayes Risk per sentence is "
@@ -24,8 +24,65 @@
 #include "lat/kaldi-lattice.h"
 #include "lat/minimize-lattice.h"
 #include "lat/push-lattice.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+// Pushes and minimizes one lattice; used with RunTableTasks().
+class LatticeMinimizeWorker {
+ public:
+  typedef CompactLattice Input;
+  typedef CompactLattice Result;
+
+  LatticeMinimizeWorker(bool push_strings, bool push_weights,
+                        CompactLatticeWriter *writer):
+      n_done(0), n_err(0), push_strings_(push_strings),
+      push_weights_(push_weights), writer_(writer) { }
+
+  bool Process(const std::string &key, CompactLattice *clat,
+               CompactLattice *result) const {
+    KALDI_VLOG(1) << "Processing lattice for utterance " << key;
+    if (push_strings_ && !PushCompactLatticeStrings(clat)) {
+      KALDI_WARN << "Failure in pushing lattice strings (bad lattice?), "
+                 << "for key " << key;
+      return false;
+    }
+    if (push_weights_ && !PushCompactLatticeWeights(clat)) {
+      KALDI_WARN << "Failure in pushing lattice weights (bad lattice?),"
+                 << "for key " << key ;
+      return false;
+    }
+    if (!MinimizeCompactLattice(clat)) {
+      KALDI_WARN << "Failure in minimizing lattice (bad lattice?),"
+                 << "for key " << key ;
+      return false;
+    }
+    if (clat->NumStates() == 0) {
+      KALDI_WARN << "Empty lattice for key " << key;
+      return false;
+    }
+    *result = *clat;
+    return true;
+  }
+
+  void Write(const std::string &key, bool ok, const CompactLattice &result) {
+    if (!ok) {
+      n_err++;
+      return;
+    }
+    writer_->Write(key, result);
+    n_done++;
+  }
+
+  int32 n_done, n_err;
 
+ private:
+  bool push_strings_;
+  bool push_weights_;
+  CompactLatticeWriter *writer_;
+};
 
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -48,11 +105,13 @@ int main(int argc, char *argv[]) {
 
     bool push_strings = true;
     bool push_weights = true;
+    TaskSequencerConfig sequencer_config; // has --num-threads option
 
     po.Register("push-strings", &push_strings, "If true, push the strings in the "
                 "lattice to the start.");
     po.Register("push-weights", &push_weights, "If true, push the weights in the "
                 "lattice to the start.");
+    sequencer_config.Register(&po);
     
     po.Read(argc, argv);
 
@@ -68,39 +127,9 @@ int main(int argc, char *argv[]) {
     SequentialCompactLatticeReader clat_reader(lats_rspecifier);
     CompactLatticeWriter clat_writer(lats_wspecifier); 
 
-    int32 n_done = 0, n_err = 0;
-
-    
-    for (; !clat_reader.Done(); clat_reader.Next()) {
-      std::string key = clat_reader.Key();
-      CompactLattice clat = clat_reader.Value();
-      KALDI_VLOG(1) << "Processing lattice for utterance " << key;
-      if (push_strings && !PushCompactLatticeStrings(&clat)) {
-        KALDI_WARN << "Failure in pushing lattice strings (bad lattice?), "
-                   << "for key " << key;
-        n_err++;
-        continue;
-      }
-      if (push_weights && !PushCompactLatticeWeights(&clat)) {
-        KALDI_WARN << "Failure in pushing lattice weights (bad lattice?),"
-                   << "for key " << key ;           
-        n_err++;
-        continue;
-      }
-      if (!MinimizeCompactLattice(&clat)) {
-        KALDI_WARN << "Failure in minimizing lattice (bad lattice?),"
-                   << "for key " << key ;           
-        n_err++;
-        continue;
-      }
-      if (clat.NumStates() == 0) {
-        KALDI_WARN << "Empty lattice for key " << key;
-        n_err++;
-        continue;
-      }
-      clat_writer.Write(key, clat);
-      n_done++;
-    }
+    LatticeMinimizeWorker worker(push_strings, push_weights, &clat_writer);
+    RunTableTasks(sequencer_config, &clat_reader, &worker);
+    int32 n_done = worker.n_done, n_err = worker.n_err;
     KALDI_LOG << "Minimized " << n_done << " lattices, errors on " << n_err;
     return (n_done != 0 ? 0 : 1);
   } catch(const std::exception &e) {
@@ -22,6 +22,8 @@
 #include "util/common-utils.h"
 #include "fstext/fstext-lib.h"
 #include "lat/kaldi-lattice.h"
+#include "lat/lattice-oracle.h"
+#include "thread/kaldi-task-sequence.h"
 
 namespace kaldi {
 
@@ -55,129 +57,26 @@ void ReadSymbolList(const std::string &rxfilename,
   }
 }
 
-void MapWildCards(const LabelSet &wildcards, fst::StdVectorFst *ofst) {
-  // map all wildcards symbols to epsilons
-  for (fst::StateIterator<fst::StdVectorFst> siter(*ofst); !siter.Done(); siter.Next()) {
-    fst::StdArc::StateId s = siter.Value();
-    for (fst::MutableArcIterator<fst::StdVectorFst> aiter(ofst, s); !aiter.Done();  aiter.Next()) {
-      fst::StdArc arc(aiter.Value());
-      LabelSet::const_iterator it = wildcards.find(arc.ilabel);
-      if (it != wildcards.end()) {
-        KALDI_VLOG(4) << "MapWildCards: mapping symbol " << arc.ilabel
-                      << " to epsilon" << endl;
-        arc.ilabel = 0;
-      }
-      it = wildcards.find(arc.olabel);
-      if (it != wildcards.end()) {arc.olabel = 0;}
-      aiter.SetValue(arc);
-    }
-  }    
-}
-
-// convert from Lattice to standard FST
-// also maps wildcard symbols to epsilons
-// then removes epsilons
-void ConvertLatticeToUnweightedAcceptor(const kaldi::Lattice &ilat,
-                                        const LabelSet &wildcards,
-                                        fst::StdVectorFst *ofst) {
-  // first convert from  lattice to normal FST
-  fst::ConvertLattice(ilat, ofst); 
-  // remove weights, project to output, sort according to input arg
-  fst::Map(ofst, fst::RmWeightMapper<fst::StdArc>()); 
-  fst::Project(ofst, fst::PROJECT_OUTPUT);  // The words are on the output side  
-  MapWildCards(wildcards, ofst);
-  fst::RmEpsilon(ofst);   // Don't tolerate epsilons as they make it hard to tally errors
-  fst::ArcSort(ofst, fst::StdILabelCompare());
-}
-
-void CreateEditDistance(const fst::StdVectorFst &fst1,
-                        const fst::StdVectorFst &fst2,
-                        fst::StdVectorFst *pfst) {
-  using namespace fst;
-  typedef StdArc StdArc;
-  typedef StdArc::Weight Weight;
-  typedef StdArc::Label Label;
-  Weight correct_cost(0.0);
-  Weight substitution_cost(1.0);
-  Weight insertion_cost(1.0);
-  Weight deletion_cost(1.0);
-
-  // create set of output symbols in fst1
-  std::vector<Label> fst1syms, fst2syms;
-  GetOutputSymbols(fst1, false /*no epsilons*/, &fst1syms);
-  GetInputSymbols(fst2, false /*no epsilons*/, &fst2syms);
-
-  pfst->AddState();
-  pfst->SetStart(0);
-  for (size_t i = 0; i < fst1syms.size(); i++) 
-    pfst->AddArc(0, StdArc(fst1syms[i], 0, deletion_cost, 0)); // deletions
-  
-  for (size_t i = 0; i < fst2syms.size(); i++)
-    pfst->AddArc(0, StdArc(0, fst2syms[i], insertion_cost, 0));  // insertions
- 
-  // stupid implementation O(N^2)
-  for (size_t i = 0; i < fst1syms.size(); i++) {
-    Label label1 = fst1syms[i];
-    for (size_t j = 0; j < fst2syms.size(); j++) {
-      Label label2 = fst2syms[j];
-      Weight cost( label1 == label2 ? correct_cost : substitution_cost);
-      pfst->AddArc(0, StdArc(label1, label2, cost, 0)); // substitutions
-    }
-  }
-  pfst->SetFinal(0, Weight::One());
-  ArcSort(pfst, StdOLabelCompare());
-}
-
-void CountErrors(fst::StdVectorFst &fst,
-                 int32 *correct,
-                 int32 *substitutions,
-                 int32 *insertions,
-                 int32 *deletions,
-                 int32 *num_words) {
-  typedef fst::StdArc::StateId StateId;
-  typedef fst::StdArc::Weight Weight;
-   *correct = *substitutions = *insertions = *deletions = *num_words = 0;
-
-  // go through the first complete path in fst (there should be only one)
-  StateId src = fst.Start(); 
-  while (fst.Final(src)== Weight::Zero()) { // while not final
-    for (fst::ArcIterator<fst::StdVectorFst> aiter(fst, src); !aiter.Done(); aiter.Next()) {
-      fst::StdArc arc = aiter.Value();
-      if (arc.ilabel == arc.olabel && arc.ilabel != 0) {
-        (*correct)++;
-        (*num_words)++;
-      } else if (arc.ilabel == 0 && arc.olabel != 0) {
-        (*deletions)++;
-        (*num_words)++;
-      } else if (arc.ilabel != 0 && arc.olabel == 0) {
-        (*insertions)++; 
-      } else if (arc.ilabel != 0 && arc.olabel != 0) {
-        (*substitutions)++;
-        (*num_words)++;
-      } else {
-        KALDI_ASSERT(arc.ilabel == 0 && arc.olabel == 0);
+// Maps the wildcard symbols on the output side of "lat" to epsilon, and
+// topologically sorts it, as required by LatticeOracle().
+void PrepareLatticeForOracle(const LabelSet &wildcards, Lattice *lat) {
+  if (!wildcards.empty()) {
+    for (fst::StateIterator<Lattice> siter(*lat); !siter.Done(); siter.Next()) {
+      LatticeArc::StateId s = siter.Value();
+      for (fst::MutableArcIterator<Lattice> aiter(lat, s); !aiter.Done();
+           aiter.Next()) {
+        LatticeArc arc(aiter.Value());
+        if (arc.olabel != 0 && wildcards.count(arc.olabel) != 0) {
+          arc.olabel = 0;
+          aiter.SetValue(arc);
+        }
       }
-      src = arc.nextstate;
-      continue; // jump to next state
     }
   }
+  if (lat->Properties(fst::kTopSorted, true) == 0 && !fst::TopSort(lat))
+    KALDI_ERR << "Cycles detected in lattice.";
 }
 
-
-bool CheckFst(fst::StdVectorFst &fst, string name, string key) {
-
-#ifdef DEBUG
-  StateId numstates = fst.NumStates();
-  cerr << " "<<name<<" has "<<numstates<<" states"<<endl;
-  std::stringstream ss; ss <<name<<key<<".fst";
-  fst.Write(ss.str());
-  return(fst.Start() == fst::kNoStateId); 
-#else
-  return true;
-#endif
-}
-
-
 // Guoguo Chen added the implementation for option "write-lattices". This
 // function does a depth first search on the lattice and remove the arcs that
 // don't correctespond to the oracle path. By "remove" I actually point the next
@@ -218,6 +117,118 @@ bool GetOracleLattice(Lattice *oracle_lat,
   return status;
 }
 
+// The statistics and outputs shared by the LatticeOracleTask objects.
+struct LatticeOracleOutput {
+  fst::SymbolTable *word_syms;  // May be NULL.
+  Int32VectorWriter *transcriptions_writer;
+  CompactLatticeWriter *lats_writer;  // Only used if IsOpen().
+  int32 n_done, n_fail;
+  int32 tot_correct, tot_substitutions, tot_insertions, tot_deletions,
+      tot_words;
+};
+
+// Finds the oracle path of one lattice; used with TaskSequencer, so
+// operator () may run in parallel with other tasks, and the destructor,
+// which writes the output, is called in the order of the input.
+class LatticeOracleTask {
+ public:
+  // Takes ownership of "lat".
+  LatticeOracleTask(const std::string &key, Lattice *lat,
+                    const std::vector<int32> &reference,
+                    const LabelSet &wildcards, int32 beam,
+                    LatticeOracleOutput *output):
+      key_(key), lat_(lat), reference_(reference), wildcards_(wildcards),
+      beam_(beam), output_(output), ok_(false), num_ins_(0), num_del_(0),
+      num_sub_(0) { }
+
+  void operator () () {
+    // Remove any wildcards in the reference.
+    std::vector<int32> reference;
+    for (size_t i = 0; i < reference_.size(); i++)
+      if (wildcards_.count(reference_[i]) == 0)
+        reference.push_back(reference_[i]);
+    reference_.swap(reference);
+
+    Lattice word_lat(*lat_);
+    PrepareLatticeForOracle(wildcards_, &word_lat);
+    ok_ = LatticeOracle(word_lat, reference_, beam_, &oracle_words_,
+                        &num_ins_, &num_del_, &num_sub_);
+
+    // Guoguo Chen added the implementation for option "write-lattices".
+    // Currently it's just a naive implementation: traversal the original
+    // lattice and get the path corresponding to the oracle word sequence.
+    // Note that this new lattice has the alignment information.
+    if (ok_ && output_->lats_writer->IsOpen()) {
+      Lattice oracle_lat(*lat_);
+      LatticeArc::StateId bad_state = oracle_lat.AddState();
+      if (!GetOracleLattice(&oracle_lat, oracle_words_,
+                            bad_state, oracle_lat.Start(), 0))
+        KALDI_WARN << "Failed to find the oracle path in the original "
+                   << "lattice: " << key_;
+      ConvertLattice(oracle_lat, &oracle_clat_);
+    }
+    delete lat_;
+    lat_ = NULL;
+  }
+
+  ~LatticeOracleTask() {
+    delete lat_;  // In case operator () was not called.
+    output_->n_done++;
+    if (!ok_) {
+      KALDI_WARN << "Best-path failed for key " << key_;
+      output_->n_fail++;
+      return;
+    }
+    int32 num_words = reference_.size(),
+        tot_errs = num_ins_ + num_del_ + num_sub_;
+    KALDI_LOG << "%WER " << (100.*tot_errs) / num_words << " [ " << tot_errs
+              << " / " << num_words << ", " << num_ins_ << " insertions, "
+              << num_del_ << " deletions, " << num_sub_ << " sub ]";
+    output_->tot_correct += num_words - num_del_ - num_sub_;
+    output_->tot_substitutions += num_sub_;
+    output_->tot_insertions += num_ins_;
+    output_->tot_deletions += num_del_;
+    output_->tot_words += num_words;
+    KALDI_LOG << "For utterance " << key_ << ", best cost " << tot_errs;
+
+    if (output_->transcriptions_writer->IsOpen())
+      output_->transcriptions_writer->Write(key_, oracle_words_);
+    fst::SymbolTable *word_syms = output_->word_syms;
+    if (word_syms != NULL) {
+      std::cerr << key_ << " (oracle) ";
+      for (size_t i = 0; i < oracle_words_.size(); i++) {
+        std::string s = word_syms->Find(oracle_words_[i]);
+        if (s == "")
+          KALDI_ERR << "Word-id " << oracle_words_[i] <<" not in symbol table.";
+        std::cerr << s << ' ';
+      }
+      std::cerr << '\n' << key_ << " (reference) ";
+      for (size_t i = 0; i < reference_.size(); i++) {
+        std::string s = word_syms->Find(reference_[i]);
+        if (s == "")
+          KALDI_ERR << "Word-id " << reference_[i] << " not in symbol table.";
+        std::cerr << s << ' ';
+      }
+      std::cerr << '\n';
+    }
+    if (output_->lats_writer->IsOpen())
+      output_->lats_writer->Write(key_, oracle_clat_);
+  }
+
+ private:
+  std::string key_;
+  Lattice *lat_;  // Owned here; deleted once no longer needed.
+  std::vector<int32> reference_;
+  const LabelSet &wildcards_;
+  int32 beam_;
+  LatticeOracleOutput *output_;
+
+  bool ok_;
+  std::vector<int32> oracle_words_;
+  int32 num_ins_, num_del_, num_sub_;
+  CompactLattice oracle_clat_;
+};
+
 }
 
 int main(int argc, char *argv[]) {
@@ -225,17 +236,12 @@ int main(int argc, char *argv[]) {
     using namespace kaldi;
     typedef kaldi::int32 int32;
     typedef kaldi::int64 int64;
-    using fst::SymbolTable;
-    using fst::VectorFst;
-    using fst::StdArc;
-    typedef fst::StdArc::Weight Weight;
-    typedef fst::StdArc::StateId StateId;
 
     const char *usage =
-        "Finds the path having the smallest edit-distance between two lattices.\n"
-        "For efficiency put the smallest lattices first (for example reference strings).\n"
+        "Finds the path in each lattice having the smallest edit-distance to the\n"
+        "reference transcription (the oracle path), and the oracle WER.\n"
         "Usage: lattice-oracle [options] test-lattice-rspecifier reference-rspecifier "
-        "transcriptions-wspecifier [edit-distance-wspecifier]\n"
+        "transcriptions-wspecifier\n"
         " e.g.: lattice-oracle ark:lat.1 'ark:sym2int.pl -f 2- data/lang/words.txt <data/test/text' ark,t:-\n";
         
     ParseOptions po(usage);
@@ -244,6 +250,8 @@ int main(int argc, char *argv[]) {
     std::string wild_syms_rxfilename;
     std::string wildcard_symbols;
     std::string lats_wspecifier;
+    int32 beam = -1;
+    TaskSequencerConfig sequencer_config; // has --num-threads option
     
     po.Register("word-symbol-table", &word_syms_filename,
                 "Symbol table for words [for debug output]");
@@ -257,6 +265,10 @@ int main(int argc, char *argv[]) {
                 "option --wildcard-symbols-list.");
     po.Register("write-lattices", &lats_wspecifier, "If supplied, write 1-best "
                 "path as lattices to this wspecifier");
+    po.Register("beam", &beam, "If >= 0, prune paths with more than this many "
+                "errors more than the best one at the same lattice state: "
+                "faster on dense lattices, but the oracle path may be missed.");
+    sequencer_config.Register(&po);
     
     po.Read(argc, argv);
  
@@ -303,117 +315,37 @@ int main(int argc, char *argv[]) {
         wildcards.insert(wildcard_symbols_vec[i]);
     }  
     
-    int32 n_done = 0, n_fail = 0;
-    int32 tot_correct=0, tot_substitutions=0, tot_insertions=0, tot_deletions=0,
-        tot_words=0;
-
-    for (; !lattice_reader.Done(); lattice_reader.Next()) {
-      std::string key = lattice_reader.Key();
-      const Lattice &lat = lattice_reader.Value();
-      cerr << "Lattice "<<key<<" read."<<endl;
-
-      // remove all weights while creating a standard FST
-      VectorFst<StdArc> lattice_fst;
-      ConvertLatticeToUnweightedAcceptor(lat, wildcards, &lattice_fst);
-      CheckFst(lattice_fst, "lattice_fst_", key);
-      
-      // TODO: map certain symbols (using an FST created with CreateMapFst())
-      
-      if (!reference_reader.HasKey(key)) {
-        KALDI_WARN << "No reference present for utterance " << key;
-        n_fail++;
-        continue;
-      }
-      const std::vector<int32> &reference = reference_reader.Value(key);
-      VectorFst<StdArc> reference_fst;
-      MakeLinearAcceptor(reference, &reference_fst);
-      MapWildCards(wildcards, &reference_fst); // Remove any wildcards in reference.
-      
-      CheckFst(reference_fst, "reference_fst_", key);
-            
-      // recreate edit distance fst if necessary
-      fst::StdVectorFst edit_distance_fst;
-      CreateEditDistance(lattice_fst, reference_fst, &edit_distance_fst);
-      
-      // compose with edit distance transducer
-      VectorFst<StdArc> edit_ref_fst;
-      fst::Compose(edit_distance_fst, reference_fst, &edit_ref_fst);
-      CheckFst(edit_ref_fst, "composed_", key);
-      
-      // make sure composed FST is input sorted
-      fst::ArcSort(&edit_ref_fst, fst::StdILabelCompare());
-      
-      // compose with previous result
-      VectorFst<StdArc> result_fst;
-      fst::Compose(lattice_fst, edit_ref_fst, &result_fst);
-      CheckFst(result_fst, "result_", key);
-      
-      // find out best path
-      VectorFst<StdArc> best_path;
-      fst::ShortestPath(result_fst, &best_path);
-      CheckFst(best_path, "best_path_", key);
-
-      if (best_path.Start() == fst::kNoStateId) {
-        KALDI_WARN << "Best-path failed for key " << key;
-        n_fail++;
-      } else {
-        // count errors
-        int32 correct, substitutions, insertions, deletions, num_words;
-        CountErrors(best_path, &correct, &substitutions, &insertions, &deletions, &num_words);
-        int32 toterrs = substitutions + insertions + deletions;
-        KALDI_LOG << "%WER " << (100.*toterrs) / num_words << " [ " << toterrs
-                  << " / " << num_words << ", " << insertions << " insertions, " << deletions
-                  << " deletions, " << substitutions << " sub ]";
-        tot_correct += correct;
-        tot_substitutions += substitutions;
-        tot_insertions += insertions;
-        tot_deletions += deletions;
-        tot_words += num_words;     
-        
-        std::vector<int32> oracle_words;
-        std::vector<int32> reference_words;
-        Weight weight;
-        GetLinearSymbolSequence(best_path, &oracle_words, &reference_words, &weight);
-        KALDI_LOG << "For utterance " << key << ", best cost " << weight;
-        if (transcriptions_wspecifier != "")
-          transcriptions_writer.Write(key, oracle_words);
-        if (word_syms != NULL) {
-          std::cerr << key << " (oracle) ";
-          for (size_t i = 0; i < oracle_words.size(); i++) {
-            std::string s = word_syms->Find(oracle_words[i]);
-            if (s == "")
-              KALDI_ERR << "Word-id " << oracle_words[i] <<" not in symbol table.";
-            std::cerr << s << ' ';
-          }
-          std::cerr << '\n' << key << " (reference) ";
-          for (size_t i = 0; i < reference_words.size(); i++) {
-            std::string s = word_syms->Find(reference_words[i]);
-            if (s == "")
-              KALDI_ERR << "Word-id " << reference_words[i]
-                        << " not in symbol table.";
-            std::cerr << s << ' ';
-          }
-          std::cerr << '\n';
-        }
-
-        // Guoguo Chen added the implementation for option "write-lattices".
-        // Currently it's just a naive implementation: traversal the original
-        // lattice and get the path corresponding to the oracle word sequence.
-        // Note that this new lattice has the alignment information.
-        if (lats_wspecifier != "") {
-          Lattice oracle_lat = lat;
-          LatticeArc::StateId bad_state = oracle_lat.AddState();
-          if (!GetOracleLattice(&oracle_lat, oracle_words,
-                                bad_state, oracle_lat.Start(), 0)) 
-            KALDI_WARN << "Failed to find the oracle path in the original "
-                       << "lattice: " << key;
-          CompactLattice oracle_clat;
-          ConvertLattice(oracle_lat, &oracle_clat);
-          lats_writer.Write(key, oracle_clat);
+    LatticeOracleOutput output;
+    output.word_syms = word_syms;
+    output.transcriptions_writer = &transcriptions_writer;
+    output.lats_writer = &lats_writer;
+    output.n_done = output.n_fail = 0;
+    output.tot_correct = output.tot_substitutions = output.tot_insertions =
+        output.tot_deletions = output.tot_words = 0;
+
+    {
+      TaskSequencer<LatticeOracleTask> sequencer(sequencer_config);
+      for (; !lattice_reader.Done(); lattice_reader.Next()) {
+        std::string key = lattice_reader.Key();
+        if (!reference_reader.HasKey(key)) {
+          KALDI_WARN << "No reference present for utterance " << key;
+          output.n_fail++;
+          continue;
         }
+        // The task takes ownership of the copy; free the reader's copy so the
+        // two do not share data across threads.
+        Lattice *lat = new Lattice(lattice_reader.Value());
+        lattice_reader.FreeCurrent();
+        sequencer.Run(new LatticeOracleTask(key, lat,
+                                            reference_reader.Value(key),
+                                            wildcards, beam, &output));
       }
-      n_done++;
+      sequencer.Wait();
     }
+    int32 n_done = output.n_done, n_fail = output.n_fail,
+        tot_substitutions = output.tot_substitutions,
+        tot_insertions = output.tot_insertions,
+        tot_deletions = output.tot_deletions, tot_words = output.tot_words;
     if (word_syms) delete word_syms;
     int32 tot_errs = tot_substitutions + tot_deletions + tot_insertions;
     // Warning: the script egs/s5/*/steps/oracle_wer.sh parses the next line.
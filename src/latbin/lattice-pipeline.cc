@@ -0,0 +1,499 @@
+// latbin/lattice-pipeline.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "fstext/fstext-lib.h"
+#include "hmm/transition-model.h"
+#include "lat/kaldi-lattice.h"
+#include "lat/lattice-functions.h"
+#include "lat/lattice-lm-rescore.h"
+#include "lat/word-align-lattice.h"
+#include "lat/sausages.h"
+#include "lm/compact-ngram-lm.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+// Parses the options and arguments of one stage of the pipeline, given as a
+// list of tokens (not including the stage name), in the same way as the
+// command line of a program.
+void ParseStageOptions(const std::string &program_name,
+                       const std::vector<std::string> &tokens,
+                       ParseOptions *po) {
+  std::vector<const char*> argv;
+  argv.push_back(program_name.c_str());
+  argv.push_back("--print-args=false");
+  for (size_t i = 0; i < tokens.size(); i++)
+    argv.push_back(tokens[i].c_str());
+  po->Read(argv.size(), &(argv[0]));
+}
+
+/// One stage of the pipeline, modifying a CompactLattice in memory.
+/// Process() may be called from several threads at once.
+class LatticeStage {
+ public:
+  /// Returns false if the lattice should not be output (a warning will have
+  /// been printed).
+  virtual bool Process(const std::string &key, CompactLattice *clat) const = 0;
+  virtual ~LatticeStage() { }
+};
+
+// As lattice-scale.
+class ScaleStage: public LatticeStage {
+ public:
+  ScaleStage(const std::string &program_name,
+             const std::vector<std::string> &tokens): scale_(2) {
+    const char *usage = "Stage: scale [options]  (as lattice-scale)\n";
+    ParseOptions po(usage);
+    BaseFloat acoustic_scale = 1.0, inv_acoustic_scale = 1.0, lm_scale = 1.0,
+        acoustic2lm_scale = 0.0, lm2acoustic_scale = 0.0;
+    po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for acoustic likelihoods");
+    po.Register("inv-acoustic-scale", &inv_acoustic_scale, "An alternative way "
+                "of setting the acoustic scale: you can set its inverse.");
+    po.Register("lm-scale", &lm_scale, "Scaling factor for graph/lm costs");
+    po.Register("acoustic2lm-scale", &acoustic2lm_scale, "Add this times original acoustic costs to LM costs");
+    po.Register("lm2acoustic-scale", &lm2acoustic_scale, "Add this times original LM costs to acoustic costs");
+    ParseStageOptions(program_name, tokens, &po);
+    if (po.NumArgs() != 0) {
+      po.PrintUsage();
+      KALDI_ERR << "Stage 'scale' takes no arguments.";
+    }
+    KALDI_ASSERT(acoustic_scale == 1.0 || inv_acoustic_scale == 1.0);
+    if (inv_acoustic_scale != 1.0)
+      acoustic_scale = 1.0 / inv_acoustic_scale;
+    scale_[0].resize(2);
+    scale_[1].resize(2);
+    scale_[0][0] = lm_scale;
+    scale_[0][1] = acoustic2lm_scale;
+    scale_[1][0] = lm2acoustic_scale;
+    scale_[1][1] = acoustic_scale;
+  }
+  virtual bool Process(const std::string &key, CompactLattice *clat) const {
+    ScaleLattice(scale_, clat);
+    return true;
+  }
+ private:
+  std::vector<std::vector<double> > scale_;
+};
+
+// As lattice-add-penalty.
+class AddPenaltyStage: public LatticeStage {
+ public:
+  AddPenaltyStage(const std::string &program_name,
+                  const std::vector<std::string> &tokens):
+      word_ins_penalty_(0.0) {
+    const char *usage = "Stage: add-penalty [options]  (as lattice-add-penalty)\n";
+    ParseOptions po(usage);
+    po.Register("word-ins-penalty", &word_ins_penalty_, "Word insertion penalty");
+    ParseStageOptions(program_name, tokens, &po);
+    if (po.NumArgs() != 0) {
+      po.PrintUsage();
+      KALDI_ERR << "Stage 'add-penalty' takes no arguments.";
+    }
+  }
+  virtual bool Process(const std::string &key, CompactLattice *clat) const {
+    AddWordInsPenToCompactLattice(word_ins_penalty_, clat);
+    return true;
+  }
+ private:
+  BaseFloat word_ins_penalty_;
+};
+
+// As lattice-prune.
+class PruneStage: public LatticeStage {
+ public:
+  PruneStage(const std::string &program_name,
+             const std::vector<std::string> &tokens):
+      acoustic_scale_(1.0), beam_(10.0) {
+    const char *usage = "Stage: prune [options]  (as lattice-prune)\n";
+    ParseOptions po(usage);
+    BaseFloat inv_acoustic_scale = 1.0;
+    po.Register("acoustic-scale", &acoustic_scale_, "Scaling factor for acoustic likelihoods");
+    po.Register("inv-acoustic-scale", &inv_acoustic_scale, "An alternative way of setting the "
+                "acoustic scale: you can set its inverse.");
+    po.Register("beam", &beam_, "Pruning beam [applied after acoustic scaling]");
+    ParseStageOptions(program_name, tokens, &po);
+    if (po.NumArgs() != 0) {
+      po.PrintUsage();
+      KALDI_ERR << "Stage 'prune' takes no arguments.";
+    }
+    KALDI_ASSERT(acoustic_scale_ == 1.0 || inv_acoustic_scale == 1.0);
+    if (inv_acoustic_scale != 1.0)
+      acoustic_scale_ = 1.0 / inv_acoustic_scale;
+    if (acoustic_scale_ == 0.0)
+      KALDI_ERR << "Do not use a zero acoustic scale (cannot be inverted)";
+  }
+  virtual bool Process(const std::string &key, CompactLattice *clat) const {
+    fst::ScaleLattice(fst::AcousticLatticeScale(acoustic_scale_), clat);
+    if (!PruneLattice(beam_, clat))
+      KALDI_WARN << "Error pruning latice for utterance " << key;
+    fst::ScaleLattice(fst::AcousticLatticeScale(1.0/acoustic_scale_), clat);
+    return true;
+  }
+ private:
+  BaseFloat acoustic_scale_;
+  BaseFloat beam_;
+};
+
+// As lattice-lmrescore.
+class LmRescoreStage: public LatticeStage {
+ public:
+  LmRescoreStage(const std::string &program_name,
+                 const std::vector<std::string> &tokens):
+      lm_scale_(1.0), compact_lm_(NULL), compact_lm_fst_(NULL),
+      std_lm_fst_(NULL), rescorer_(NULL) {
+    const char *usage =
+        "Stage: lmrescore [options] <lm-fst-in>  (as lattice-lmrescore)\n";
+    ParseOptions po(usage);
+    po.Register("lm-scale", &lm_scale_, "Scaling factor for language model "
+                "costs; frequently 1.0 or -1.0");
+    ParseStageOptions(program_name, tokens, &po);
+    if (po.NumArgs() != 1) {
+      po.PrintUsage();
+      KALDI_ERR << "Stage 'lmrescore' takes one argument.";
+    }
+    std::string fst_rxfilename = po.GetArg(1);
+    if (ClassifyRxfilename(fst_rxfilename) == kFileInput &&
+        CompactNgramLm::IsCompactNgramLm(fst_rxfilename)) {
+      compact_lm_ = new CompactNgramLm;
+      if (!compact_lm_->Open(fst_rxfilename))
+        KALDI_ERR << "Could not open compact LM " << fst_rxfilename;
+      compact_lm_fst_ = new CompactNgramLmDeterministicFst(*compact_lm_);
+    } else {
+      std_lm_fst_ = fst::ReadFstKaldi(fst_rxfilename);
+      if (std_lm_fst_->Properties(fst::kILabelSorted, true) == 0) {
+        // Make sure LM is sorted on ilabel.
+        fst::ILabelCompare<fst::StdArc> ilabel_comp;
+        fst::ArcSort(std_lm_fst_, ilabel_comp);
+      }
+    }
+    rescorer_ = new LatticeLmRescorer(std_lm_fst_, compact_lm_fst_);
+  }
+  virtual bool Process(const std::string &key, CompactLattice *clat) const {
+    Lattice lat;
+    ConvertLattice(*clat, &lat);
+    if (!rescorer_->Rescore(lm_scale_, &lat, clat)) {
+      KALDI_WARN << "Empty lattice for utterance " << key << " (incompatible LM?)";
+      return false;
+    }
+    return true;
+  }
+  virtual ~LmRescoreStage() {
+    delete rescorer_;
+    delete std_lm_fst_;
+    delete compact_lm_fst_;
+    delete compact_lm_;
+  }
+ private:
+  BaseFloat lm_scale_;
+  CompactNgramLm *compact_lm_;
+  CompactNgramLmDeterministicFst *compact_lm_fst_;
+  fst::VectorFst<fst::StdArc> *std_lm_fst_;
+  LatticeLmRescorer *rescorer_;
+};
+
+// As lattice-align-words.
+class AlignWordsStage: public LatticeStage {
+ public:
+  AlignWordsStage(const std::string &program_name,
+                  const std::vector<std::string> &tokens):
+      max_expand_(0.0), output_if_error_(true), info_(NULL) {
+    const char *usage =
+        "Stage: align-words [options] <word-boundary-file> <model>  "
+        "(as lattice-align-words)\n";
+    ParseOptions po(usage);
+    po.Register("output-error-lats", &output_if_error_, "Output lattices that aligned "
+                "with errors (e.g. due to force-out");
+    po.Register("max-expand", &max_expand_, "If >0, the maximum amount by which this "
+                "program will expand lattices before refusing to continue.  E.g. 10.");
+    WordBoundaryInfoNewOpts opts;
+    opts.Register(&po);
+    ParseStageOptions(program_name, tokens, &po);
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      KALDI_ERR << "Stage 'align-words' takes two arguments.";
+    }
+    info_ = new WordBoundaryInfo(opts, po.GetArg(1));
+    ReadKaldiObject(po.GetArg(2), &tmodel_);
+  }
+  virtual bool Process(const std::string &key, CompactLattice *clat) const {
+    int32 max_states;
+    if (max_expand_ > 0) max_states = 1000 + max_expand_ * clat->NumStates();
+    else max_states = 0;
+    CompactLattice aligned_clat;
+    bool ok = WordAlignLattice(*clat, tmodel_, *info_, max_states,
+                               &aligned_clat);
+    if (aligned_clat.Start() == fst::kNoStateId) {
+      KALDI_WARN << "Empty aligned lattice for " << key
+                 << ", producing no output.";
+      return false;
+    }
+    if (!ok) {
+      if (!output_if_error_) {
+        KALDI_WARN << "Lattice for " << key
+                   << " did not align correctly, producing no output.";
+        return false;
+      }
+      KALDI_WARN << "Outputting partial lattice for " << key;
+    }
+    TopSortCompactLatticeIfNeeded(&aligned_clat);
+    *clat = aligned_clat;
+    return true;
+  }
+  virtual ~AlignWordsStage() { delete info_; }
+ private:
+  BaseFloat max_expand_;
+  bool output_if_error_;
+  TransitionModel tmodel_;
+  WordBoundaryInfo *info_;
+};
+
+// As lattice-to-ctm-conf; this can only be the last stage, and it doesn't
+// modify the lattice.
+class CtmStage {
+ public:
+  struct Result {
+    std::vector<int32> words;
+    std::vector<std::pair<BaseFloat, BaseFloat> > times;
+    std::vector<BaseFloat> conf;
+  };
+  CtmStage(const std::string &program_name,
+           const std::vector<std::string> &tokens):
+      acoustic_scale_(1.0), lm_scale_(1.0), frame_shift_(0.01) {
+    const char *usage =
+        "Stage: to-ctm-conf [options]  (as lattice-to-ctm-conf; last stage only)\n";
+    ParseOptions po(usage);
+    BaseFloat inv_acoustic_scale = 1.0;
+    po.Register("acoustic-scale", &acoustic_scale_, "Scaling factor for "
+                "acoustic likelihoods");
+    po.Register("inv-acoustic-scale", &inv_acoustic_scale, "An alternative way "
+                "of setting the acoustic scale: you can set its inverse.");
+    po.Register("lm-scale", &lm_scale_, "Scaling factor for language model "
+                "probabilities");
+    mbr_opts_.Register(&po);
+    po.Register("frame-shift", &frame_shift_, "Time in seconds between frames.");
+    ParseStageOptions(program_name, tokens, &po);
+    if (po.NumArgs() != 0) {
+      po.PrintUsage();
+      KALDI_ERR << "Stage 'to-ctm-conf' takes no arguments.";
+    }
+    KALDI_ASSERT(acoustic_scale_ == 1.0 || inv_acoustic_scale == 1.0);
+    if (inv_acoustic_scale != 1.0)
+      acoustic_scale_ = 1.0 / inv_acoustic_scale;
+  }
+  // Returns the Bayes risk.
+  BaseFloat Process(CompactLattice *clat, Result *result) const {
+    fst::ScaleLattice(fst::LatticeScale(lm_scale_, acoustic_scale_), clat);
+    MinimumBayesRisk mbr(*clat, mbr_opts_);
+    result->conf = mbr.GetOneBestConfidences();
+    result->words = mbr.GetOneBest();
+    result->times = mbr.GetOneBestTimes();
+    KALDI_ASSERT(result->conf.size() == result->words.size() &&
+                 result->words.size() == result->times.size());
+    return mbr.GetBayesRisk();
+  }
+  void Write(const std::string &key, const Result &result,
+             std::ostream &os) const {
+    for (size_t i = 0; i < result.words.size(); i++) {
+      KALDI_ASSERT(result.words[i] != 0); // Should not have epsilons.
+      os << key << " 1 " << (frame_shift_ * result.times[i].first) << ' '
+         << (frame_shift_ * (result.times[i].second - result.times[i].first))
+         << ' ' << result.words[i] << ' ' << result.conf[i] << '\n';
+    }
+  }
+ private:
+  BaseFloat acoustic_scale_, lm_scale_;
+  MinimumBayesRiskOptions mbr_opts_;
+  BaseFloat frame_shift_;
+};
+
+
+// Runs all the stages on one lattice; used with RunTableTasks().
+class LatticePipelineWorker {
+ public:
+  typedef CompactLattice Input;
+  struct Result {
+    CompactLattice clat;
+    CtmStage::Result ctm;
+    BaseFloat bayes_risk;
+  };
+
+  // Does not take ownership of the pointers.  Exactly one of clat_writer and
+  // ctm_stage should be non-NULL; if ctm_stage is non-NULL, ctm output goes to
+  // ctm_output.
+  LatticePipelineWorker(const std::vector<LatticeStage*> &stages,
+                        const CtmStage *ctm_stage,
+                        CompactLatticeWriter *clat_writer,
+                        std::ostream *ctm_output):
+      n_done(0), n_fail(0), n_words(0), tot_bayes_risk(0.0),
+      stages_(stages), ctm_stage_(ctm_stage), clat_writer_(clat_writer),
+      ctm_output_(ctm_output) { }
+
+  bool Process(const std::string &key, CompactLattice *clat,
+               Result *result) const {
+    for (size_t i = 0; i < stages_.size(); i++)
+      if (!stages_[i]->Process(key, clat))
+        return false;
+    if (ctm_stage_ != NULL)
+      result->bayes_risk = ctm_stage_->Process(clat, &(result->ctm));
+    else
+      result->clat = *clat;
+    return true;
+  }
+
+  void Write(const std::string &key, bool ok, const Result &result) {
+    if (!ok) {
+      n_fail++;
+      return;
+    }
+    if (ctm_stage_ != NULL) {
+      ctm_stage_->Write(key, result.ctm, *ctm_output_);
+      n_words += result.ctm.words.size();
+      tot_bayes_risk += result.bayes_risk;
+    } else {
+      clat_writer_->Write(key, result.clat);
+    }
+    n_done++;
+  }
+
+  int32 n_done, n_fail, n_words;
+  BaseFloat tot_bayes_risk;
+
+ private:
+  const std::vector<LatticeStage*> &stages_;
+  const CtmStage *ctm_stage_;
+  CompactLatticeWriter *clat_writer_;
+  std::ostream *ctm_output_;
+};
+
+}  // namespace kaldi
+
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Run a sequence of lattice operations on each lattice, in memory.  This\n"
+        "does the same as a pipe of the corresponding programs, but without\n"
+        "writing and reading the lattices between them.  <stages> is a list of\n"
+        "stages separated by '|', each being a stage name followed by its options\n"
+        "and arguments, as they would be given to the program.  Stages are:\n"
+        "  scale [options]                          (as lattice-scale)\n"
+        "  add-penalty [options]                    (as lattice-add-penalty)\n"
+        "  prune [options]                          (as lattice-prune)\n"
+        "  lmrescore [options] <lm-fst-in>          (as lattice-lmrescore)\n"
+        "  align-words [options] <word-boundary-file> <model>\n"
+        "                                           (as lattice-align-words)\n"
+        "  to-ctm-conf [options]                    (as lattice-to-ctm-conf)\n"
+        "to-ctm-conf may only be the last stage; if it is, the output is a ctm\n"
+        "file, otherwise it is a table of lattices.  Arguments may not contain\n"
+        "spaces or '|'.  Use <stage-name> --help for the options of a stage.\n"
+        "\n"
+        "Usage: lattice-pipeline [options] <stages> <lattice-rspecifier> "
+        "(<lattice-wspecifier>|<ctm-wxfilename>)\n"
+        " e.g.: lattice-pipeline 'lmrescore --lm-scale=-1.0 G_old.fst | "
+        "lmrescore G_new.fst | align-words word_boundary.int final.mdl | "
+        "to-ctm-conf --inv-acoustic-scale=12' ark:1.lats 1.ctm\n";
+
+    ParseOptions po(usage);
+    TaskSequencerConfig sequencer_config; // has --num-threads option
+    sequencer_config.Register(&po);
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 3) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string stages_str = po.GetArg(1),
+        lats_rspecifier = po.GetArg(2),
+        output_specifier = po.GetArg(3);
+
+    std::vector<LatticeStage*> stages;
+    CtmStage *ctm_stage = NULL;
+    std::vector<std::string> stage_strs;
+    SplitStringToVector(stages_str, "|", false, &stage_strs);
+    for (size_t i = 0; i < stage_strs.size(); i++) {
+      std::vector<std::string> tokens;
+      SplitStringToVector(stage_strs[i], " \t\n", true, &tokens);
+      if (tokens.empty())
+        KALDI_ERR << "Empty stage in " << stages_str;
+      if (ctm_stage != NULL)
+        KALDI_ERR << "to-ctm-conf can only be the last stage: " << stages_str;
+      std::string name = tokens[0],
+          program_name = std::string(argv[0]);
+      tokens.erase(tokens.begin());
+      if (name == "scale") {
+        stages.push_back(new ScaleStage(program_name, tokens));
+      } else if (name == "add-penalty") {
+        stages.push_back(new AddPenaltyStage(program_name, tokens));
+      } else if (name == "prune") {
+        stages.push_back(new PruneStage(program_name, tokens));
+      } else if (name == "lmrescore") {
+        stages.push_back(new LmRescoreStage(program_name, tokens));
+      } else if (name == "align-words") {
+        stages.push_back(new AlignWordsStage(program_name, tokens));
+      } else if (name == "to-ctm-conf") {
+        ctm_stage = new CtmStage(program_name, tokens);
+      } else {
+        KALDI_ERR << "Unknown stage name " << name;
+      }
+    }
+
+    SequentialCompactLatticeReader clat_reader(lats_rspecifier);
+    CompactLatticeWriter *clat_writer = NULL;
+    Output *ctm_output = NULL;
+    if (ctm_stage != NULL) {
+      ctm_output = new Output(output_specifier, false);
+      ctm_output->Stream() << std::fixed;
+      ctm_output->Stream().precision(2);
+    } else {
+      clat_writer = new CompactLatticeWriter(output_specifier);
+    }
+
+    int32 n_done, n_fail;
+    {
+      LatticePipelineWorker worker(stages, ctm_stage, clat_writer,
+                                   (ctm_output != NULL ?
+                                    &(ctm_output->Stream()) : NULL));
+      RunTableTasks(sequencer_config, &clat_reader, &worker);
+      n_done = worker.n_done;
+      n_fail = worker.n_fail;
+      if (ctm_stage != NULL && n_done > 0)
+        KALDI_LOG << "Overall average Bayes Risk per sentence is "
+                  << (worker.tot_bayes_risk / n_done) << " and per word, "
+                  << (worker.tot_bayes_risk / worker.n_words);
+    }
+
+    delete clat_writer;
+    delete ctm_output;
+    delete ctm_stage;
+    for (size_t i = 0; i < stages.size(); i++)
+      delete stages[i];
+    KALDI_LOG << "Done " << n_done << " lattices, failed for " << n_fail;
+    return (n_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -24,6 +24,64 @@
 #include "fstext/fstext-lib.h"
 #include "lat/kaldi-lattice.h"
 #include "lat/lattice-functions.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+// Prunes one lattice; used with RunTableTasks().
+class LatticePruneWorker {
+ public:
+  typedef CompactLattice Input;
+  struct Result {
+    CompactLattice clat;
+    int64 num_states_in, num_arcs_in;
+  };
+
+  LatticePruneWorker(BaseFloat acoustic_scale, BaseFloat beam,
+                     CompactLatticeWriter *writer):
+      n_done(0), n_err(0), n_arcs_in(0), n_arcs_out(0),
+      n_states_in(0), n_states_out(0),
+      acoustic_scale_(acoustic_scale), beam_(beam), writer_(writer) { }
+
+  bool Process(const std::string &key, CompactLattice *clat,
+               Result *result) const {
+    fst::ScaleLattice(fst::AcousticLatticeScale(acoustic_scale_), clat);
+    result->num_arcs_in = NumArcs(*clat);
+    result->num_states_in = clat->NumStates();
+    bool ok = PruneLattice(beam_, clat);
+    if (!ok)
+      KALDI_WARN << "Error pruning latice for utterance " << key;
+    fst::ScaleLattice(fst::AcousticLatticeScale(1.0/acoustic_scale_), clat);
+    result->clat = *clat;
+    return ok;
+  }
+
+  void Write(const std::string &key, bool ok, const Result &result) {
+    if (!ok) n_err++;
+    int64 pruned_narcs = NumArcs(result.clat),
+        pruned_nstates = result.clat.NumStates();
+    n_arcs_in += result.num_arcs_in;
+    n_states_in += result.num_states_in;
+    n_arcs_out += pruned_narcs;
+    n_states_out += pruned_nstates;
+    KALDI_LOG << "For utterance " << key << ", pruned #states from "
+              << result.num_states_in << " to " << pruned_nstates
+              << " and #arcs from " << result.num_arcs_in << " to "
+              << pruned_narcs;
+    writer_->Write(key, result.clat);
+    n_done++;
+  }
+
+  int32 n_done, n_err;
+  int64 n_arcs_in, n_arcs_out, n_states_in, n_states_out;
+
+ private:
+  BaseFloat acoustic_scale_;
+  BaseFloat beam_;
+  CompactLatticeWriter *writer_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -43,11 +101,13 @@ int main(int argc, char *argv[]) {
     BaseFloat acoustic_scale = 1.0;
     BaseFloat inv_acoustic_scale = 1.0;
     BaseFloat beam = 10.0;
+    TaskSequencerConfig sequencer_config; // has --num-threads option
     
     po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for acoustic likelihoods");
     po.Register("inv-acoustic-scale", &inv_acoustic_scale, "An alternative way of setting the "
                 "acoustic scale: you can set its inverse.");
     po.Register("beam", &beam, "Pruning beam [applied after acoustic scaling]");
+    sequencer_config.Register(&po);
     
     po.Read(argc, argv);
 
@@ -68,42 +128,17 @@ int main(int argc, char *argv[]) {
     SequentialCompactLatticeReader compact_lattice_reader(lats_rspecifier);
     CompactLatticeWriter compact_lattice_writer(lats_wspecifier); 
 
-    int32 n_done = 0, n_err = 0;
-    int64 n_arcs_in = 0, n_arcs_out = 0,
-        n_states_in = 0, n_states_out = 0;
-
     if (acoustic_scale == 0.0)
       KALDI_ERR << "Do not use a zero acoustic scale (cannot be inverted)";
-    
-    for (; !compact_lattice_reader.Done(); compact_lattice_reader.Next()) {
-      std::string key = compact_lattice_reader.Key();
-      CompactLattice clat = compact_lattice_reader.Value();
-      compact_lattice_reader.FreeCurrent();
-      fst::ScaleLattice(fst::AcousticLatticeScale(acoustic_scale), &clat);
-      int64 narcs = NumArcs(clat), nstates = clat.NumStates();
-      n_arcs_in += narcs;
-      n_states_in += nstates;
-      CompactLattice pruned_clat(clat);
-      if (!PruneLattice(beam, &pruned_clat)) {
-        KALDI_WARN << "Error pruning latice for utterance " << key;
-        n_err++;
-      }
-      int64 pruned_narcs = NumArcs(pruned_clat),          
-          pruned_nstates = pruned_clat.NumStates();
-      n_arcs_out += pruned_narcs;
-      n_states_out += pruned_nstates;
-      KALDI_LOG << "For utterance " << key << ", pruned #states from "
-                << nstates << " to " << pruned_nstates << " and #arcs from "
-                << narcs << " to " << pruned_narcs;
-      fst::ScaleLattice(fst::AcousticLatticeScale(1.0/acoustic_scale), &pruned_clat);
-      compact_lattice_writer.Write(key, pruned_clat);
-      n_done++;
-    }
+
+    LatticePruneWorker worker(acoustic_scale, beam, &compact_lattice_writer);
+    RunTableTasks(sequencer_config, &compact_lattice_reader, &worker);
+    int32 n_done = worker.n_done;
 
     BaseFloat den = (n_done > 0 ? static_cast<BaseFloat>(n_done) : 1.0);
-    KALDI_LOG << "Overall, pruned from on average " << (n_states_in/den) << " to "
-              << (n_states_out/den) << " states, and from " << (n_arcs_in/den)
-              << " to " << (n_arcs_out/den) << " arcs, over " << n_done
+    KALDI_LOG << "Overall, pruned from on average " << (worker.n_states_in/den) << " to "
+              << (worker.n_states_out/den) << " states, and from " << (worker.n_arcs_in/den)
+              << " to " << (worker.n_arcs_out/den) << " arcs, over " << n_done
               << " utterances.";
     KALDI_LOG << "Done " << n_done << " lattices.";
     return (n_done != 0 ? 0 : 1);
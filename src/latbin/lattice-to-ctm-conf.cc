@@ -19,6 +19,69 @@
 
 #include "util/common-utils.h"
 #include "lat/sausages.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+// Does MBR (or MAP) decoding of one lattice and outputs it in ctm format; used
+// with RunTableTasks().
+class LatticeToCtmWorker {
+ public:
+  typedef CompactLattice Input;
+  struct Result {
+    std::vector<int32> words;
+    std::vector<std::pair<BaseFloat, BaseFloat> > times;
+    std::vector<BaseFloat> conf;
+    BaseFloat bayes_risk;
+  };
+
+  LatticeToCtmWorker(BaseFloat acoustic_scale, BaseFloat lm_scale,
+                     const MinimumBayesRiskOptions &mbr_opts,
+                     BaseFloat frame_shift, std::ostream *os):
+      n_done(0), n_words(0), tot_bayes_risk(0.0),
+      acoustic_scale_(acoustic_scale), lm_scale_(lm_scale),
+      mbr_opts_(mbr_opts), frame_shift_(frame_shift), os_(os) { }
+
+  bool Process(const std::string &key, CompactLattice *clat,
+               Result *result) const {
+    fst::ScaleLattice(fst::LatticeScale(lm_scale_, acoustic_scale_), clat);
+
+    MinimumBayesRisk mbr(*clat, mbr_opts_);
+      
+    result->conf = mbr.GetOneBestConfidences();
+    result->words = mbr.GetOneBest();
+    result->times = mbr.GetOneBestTimes();
+    result->bayes_risk = mbr.GetBayesRisk();
+    KALDI_ASSERT(result->conf.size() == result->words.size() &&
+                 result->words.size() == result->times.size());
+    return true;
+  }
+
+  void Write(const std::string &key, bool ok, const Result &result) {
+    const std::vector<int32> &words = result.words;
+    const std::vector<std::pair<BaseFloat, BaseFloat> > &times = result.times;
+    for (size_t i = 0; i < words.size(); i++) {
+      KALDI_ASSERT(words[i] != 0); // Should not have epsilons.
+      *os_ << key << " 1 " << (frame_shift_ * times[i].first) << ' '
+           << (frame_shift_ * (times[i].second-times[i].first)) << ' '
+           << words[i] << ' ' << result.conf[i] << '\n';
+    }
+    n_done++;
+    n_words += words.size();
+    tot_bayes_risk += result.bayes_risk;
+  }
+
+  int32 n_done, n_words;
+  BaseFloat tot_bayes_risk;
+
+ private:
+  BaseFloat acoustic_scale_, lm_scale_;
+  MinimumBayesRiskOptions mbr_opts_;
+  BaseFloat frame_shift_;
+  std::ostream *os_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -41,8 +104,9 @@ int main(int argc, char *argv[]) {
     
     ParseOptions po(usage);
     BaseFloat acoustic_scale = 1.0, inv_acoustic_scale = 1.0, lm_scale = 1.0;
-    bool decode_mbr = true;
+    MinimumBayesRiskOptions mbr_opts; // has --decode-mbr option
     BaseFloat frame_shift = 0.01;
+    TaskSequencerConfig sequencer_config; // has --num-threads option
 
     std::string word_syms_filename;
     po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for "
@@ -51,9 +115,9 @@ int main(int argc, char *argv[]) {
                 "of setting the acoustic scale: you can set its inverse.");
     po.Register("lm-scale", &lm_scale, "Scaling factor for language model "
                 "probabilities");
-    po.Register("decode-mbr", &decode_mbr, "If true, do Minimum Bayes Risk "
-                "decoding (else, Maximum a Posteriori)");
     po.Register("frame-shift", &frame_shift, "Time in seconds between frames.\n");
+    mbr_opts.Register(&po);
+    sequencer_config.Register(&po);
     
     po.Read(argc, argv);
 
@@ -77,32 +141,11 @@ int main(int argc, char *argv[]) {
     // the #digits after the decimal point.
     ko.Stream().precision(2);
 
-    int32 n_done = 0, n_words = 0;
-    BaseFloat tot_bayes_risk = 0.0;
-    
-    for (; !clat_reader.Done(); clat_reader.Next()) {
-      std::string key = clat_reader.Key();
-      CompactLattice clat = clat_reader.Value();
-      clat_reader.FreeCurrent();
-      fst::ScaleLattice(fst::LatticeScale(lm_scale, acoustic_scale), &clat);
-
-      MinimumBayesRisk mbr(clat, decode_mbr);
-      
-      const std::vector<BaseFloat> &conf = mbr.GetOneBestConfidences();
-      const std::vector<int32> &words = mbr.GetOneBest();
-      const std::vector<std::pair<BaseFloat, BaseFloat> > &times =
-          mbr.GetOneBestTimes();
-      KALDI_ASSERT(conf.size() == words.size() && words.size() == times.size());
-      for (size_t i = 0; i < words.size(); i++) {
-        KALDI_ASSERT(words[i] != 0); // Should not have epsilons.
-        ko.Stream() << key << " 1 " << (frame_shift * times[i].first) << ' '
-                    << (frame_shift * (times[i].second-times[i].first)) << ' '
-                    << words[i] << ' ' << conf[i] << '\n';
-      }
-      n_done++;
-      n_words += mbr.GetOneBest().size();
-      tot_bayes_risk += mbr.GetBayesRisk();
-    }
+    LatticeToCtmWorker worker(acoustic_scale, lm_scale, mbr_opts,
+                              frame_shift, &(ko.Stream()));
+    RunTableTasks(sequencer_config, &clat_reader, &worker);
+    int32 n_done = worker.n_done, n_words = worker.n_words;
+    BaseFloat tot_bayes_risk = worker.tot_bayes_risk;
 
     KALDI_LOG << "Done " << n_done << " lattices.";
     KALDI_LOG << "Overall average Bayes Risk per sentence is "
@@ -22,6 +22,7 @@
 #include "util/common-utils.h"
 #include "fstext/fstext-lib.h"
 #include "lat/kaldi-lattice.h"
+#include "lat/compact-lattice-nbest.h"
 
 int main(int argc, char *argv[]) {
   try {
@@ -33,7 +34,9 @@ int main(int argc, char *argv[]) {
     using fst::StdArc;
 
     const char *usage =
-        "Work out N-best paths in lattices and write out as FSTs\n"
+        "Work out N-best paths in lattices and write out as FSTs.  The paths are\n"
+        "generated lazily in order of cost, so large n is not a problem (lattices\n"
+        "must be acyclic).\n"
         "Usage: lattice-to-nbest [options] lattice-rspecifier lattice-wspecifier\n"
         " e.g.: lattice-to-nbest --acoustic-scale=0.1 --n=10 ark:1.lats ark:nbest.lats\n";
       
@@ -65,9 +68,7 @@ int main(int argc, char *argv[]) {
         lats_wspecifier = po.GetArg(2);
 
 
-    // Read as regular lattice-- this is the form we need it in for efficient
-    // pruning.
-    SequentialLatticeReader lattice_reader(lats_rspecifier);
+    SequentialCompactLatticeReader clat_reader(lats_rspecifier);
     
     // Write as compact lattice.
     CompactLatticeWriter compact_nbest_writer(lats_wspecifier); 
@@ -77,43 +78,48 @@ int main(int argc, char *argv[]) {
 
     if (acoustic_scale == 0.0)
       KALDI_ERR << "Do not use a zero acoustic scale (cannot be inverted)";
-    for (; !lattice_reader.Done(); lattice_reader.Next()) {
-      std::string key = lattice_reader.Key();
-      Lattice lat = lattice_reader.Value();
-      lattice_reader.FreeCurrent();
-      fst::ScaleLattice(fst::AcousticLatticeScale(acoustic_scale), &lat);
+    for (; !clat_reader.Done(); clat_reader.Next()) {
+      std::string key = clat_reader.Key();
+      CompactLattice clat = clat_reader.Value();
+      clat_reader.FreeCurrent();
+      fst::ScaleLattice(fst::AcousticLatticeScale(acoustic_scale), &clat);
 
-      std::vector<Lattice> nbest_lats;
-      {
-        Lattice nbest_lat;
-        if (!random) {
-          fst::ShortestPath(lat, &nbest_lat, n);
-        } else {
-          fst::UniformArcSelector<LatticeArc> uniform_selector;
-          fst::RandGenOptions<fst::UniformArcSelector<LatticeArc> > opts(uniform_selector);
-          opts.npath = n;
-          fst::RandGen(lat, &nbest_lat, opts);
-        }
+      std::vector<CompactLattice> nbest_clats;
+      if (!random) {
+        CompactLatticeNbestGenerator nbest_generator(clat);
+        CompactLattice nbest_clat;
+        while (static_cast<int32>(nbest_clats.size()) < n &&
+               nbest_generator.Next(&nbest_clat))
+          nbest_clats.push_back(nbest_clat);
+      } else {
+        Lattice lat, nbest_lat;
+        ConvertLattice(clat, &lat);
+        fst::UniformArcSelector<LatticeArc> uniform_selector;
+        fst::RandGenOptions<fst::UniformArcSelector<LatticeArc> > opts(uniform_selector);
+        opts.npath = n;
+        fst::RandGen(lat, &nbest_lat, opts);
+        std::vector<Lattice> nbest_lats;
         fst::ConvertNbestToVector(nbest_lat, &nbest_lats);
+        nbest_clats.resize(nbest_lats.size());
+        for (size_t k = 0; k < nbest_lats.size(); k++)
+          ConvertLattice(nbest_lats[k], &(nbest_clats[k]));
       }
       
-      if (nbest_lats.empty()) {
+      if (nbest_clats.empty()) {
         KALDI_WARN << "Possibly empty lattice for utterance-id " << key
                    << "(no N-best entries)";
       } else {
-        for (int32 k = 0; k < static_cast<int32>(nbest_lats.size()); k++) {
+        for (int32 k = 0; k < static_cast<int32>(nbest_clats.size()); k++) {
           std::ostringstream s;
           s << key << "-" << (k+1); // so if key is "utt_id", the keys
           // of the n-best are utt_id-1, utt_id-2, utt_id-3, etc.
           std::string nbest_key = s.str();
           fst::ScaleLattice(fst::AcousticLatticeScale(1.0/acoustic_scale),
-                            &(nbest_lats[k]));
-          CompactLattice nbest_clat;
-          ConvertLattice(nbest_lats[k], &nbest_clat); // write in compact form.
-          compact_nbest_writer.Write(nbest_key, nbest_clat);
+                            &(nbest_clats[k]));
+          compact_nbest_writer.Write(nbest_key, nbest_clats[k]);
         }
         n_done++;
-        n_paths_out += nbest_lats.size();
+        n_paths_out += nbest_clats.size();
       }
     }
       
@@ -23,6 +23,75 @@
 #include "fstext/fstext-lib.h"
 #include "lat/kaldi-lattice.h"
 #include "lat/lattice-functions.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+// Does forward-backward on one lattice; used with RunTableTasks().
+class LatticeToPostWorker {
+ public:
+  typedef Lattice Input;
+  struct Result {
+    Posterior post;
+    double like, ac_like;
+    int32 num_states, num_arcs;
+  };
+
+  LatticeToPostWorker(BaseFloat acoustic_scale, BaseFloat lm_scale,
+                      PosteriorWriter *posterior_writer,
+                      BaseFloatWriter *loglikes_writer):
+      n_done(0), total_like(0.0), total_ac_like(0.0), total_time(0.0),
+      acoustic_scale_(acoustic_scale), lm_scale_(lm_scale),
+      posterior_writer_(posterior_writer), loglikes_writer_(loglikes_writer) { }
+
+  bool Process(const std::string &key, Lattice *lat, Result *result) const {
+    if (acoustic_scale_ != 1.0 || lm_scale_ != 1.0)
+      fst::ScaleLattice(fst::LatticeScale(lm_scale_, acoustic_scale_), lat);
+      
+    uint64 props = lat->Properties(fst::kFstProperties, false);
+    if (!(props & fst::kTopSorted)) {
+      if (fst::TopSort(lat) == false)
+        KALDI_ERR << "Cycles detected in lattice.";
+    }
+    result->like = LatticeForwardBackward(*lat, &(result->post),
+                                          &(result->ac_like));
+    result->num_states = lat->NumStates();
+    result->num_arcs = fst::NumArcs(*lat);
+    return true;
+  }
+
+  void Write(const std::string &key, bool ok, const Result &result) {
+    double lat_time = result.post.size();
+    total_like += result.like;
+    total_time += lat_time;
+    total_ac_like += result.ac_like;
+
+    KALDI_VLOG(2) << "Processed lattice for utterance: " << key << "; found "
+                  << result.num_states << " states and " << result.num_arcs
+                  << " arcs. Average log-likelihood = "
+                  << (result.like/lat_time) << " over " << lat_time
+                  << " frames.  Average acoustic log-like per frame is "
+                  << (result.ac_like/lat_time);
+      
+    if (loglikes_writer_->IsOpen()) 
+      loglikes_writer_->Write(key, result.like);
+
+    posterior_writer_->Write(key, result.post);
+    n_done++;
+  }
+
+  int32 n_done;
+  double total_like;
+  double total_ac_like; // acoustic likelihood weighted by posterior.
+  double total_time;
+
+ private:
+  BaseFloat acoustic_scale_, lm_scale_;
+  PosteriorWriter *posterior_writer_;
+  BaseFloatWriter *loglikes_writer_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -37,11 +106,13 @@ int main(int argc, char *argv[]) {
         " e.g.: lattice-to-post --acoustic-scale=0.1 ark:1.lats ark:1.post\n";
 
     kaldi::BaseFloat acoustic_scale = 1.0, lm_scale = 1.0;
+    kaldi::TaskSequencerConfig sequencer_config; // has --num-threads option
     kaldi::ParseOptions po(usage);
     po.Register("acoustic-scale", &acoustic_scale,
                 "Scaling factor for acoustic likelihoods");
     po.Register("lm-scale", &lm_scale,
                 "Scaling factor for \"graph costs\" (including LM costs)");
+    sequencer_config.Register(&po);
     po.Read(argc, argv);
 
     if (po.NumArgs() < 2 || po.NumArgs() > 3) {
@@ -62,50 +133,16 @@ int main(int argc, char *argv[]) {
     kaldi::PosteriorWriter posterior_writer(posteriors_wspecifier);
     kaldi::BaseFloatWriter loglikes_writer(loglikes_wspecifier);
 
-    int32 n_done = 0;
-    double total_like = 0.0, lat_like;
-    double total_ac_like = 0.0, lat_ac_like; // acoustic likelihood weighted by posterior.
-    double total_time = 0, lat_time;
-
-    for (; !lattice_reader.Done(); lattice_reader.Next()) {
-      std::string key = lattice_reader.Key();
-      kaldi::Lattice lat = lattice_reader.Value();
-      lattice_reader.FreeCurrent();
-      if (acoustic_scale != 1.0 || lm_scale != 1.0)
-        fst::ScaleLattice(fst::LatticeScale(lm_scale, acoustic_scale), &lat);
-      
-      kaldi::uint64 props = lat.Properties(fst::kFstProperties, false);
-      if (!(props & fst::kTopSorted)) {
-        if (fst::TopSort(&lat) == false)
-          KALDI_ERR << "Cycles detected in lattice.";
-      }
-
-      kaldi::Posterior post;
-      lat_like = kaldi::LatticeForwardBackward(lat, &post, &lat_ac_like);
-      total_like += lat_like;
-      lat_time = post.size();
-      total_time += lat_time;
-      total_ac_like += lat_ac_like;
-
-      KALDI_VLOG(2) << "Processed lattice for utterance: " << key << "; found "
-                    << lat.NumStates() << " states and " << fst::NumArcs(lat)
-                    << " arcs. Average log-likelihood = " << (lat_like/lat_time)
-                    << " over " << lat_time << " frames.  Average acoustic log-like"
-                    << " per frame is " << (lat_ac_like/lat_time);
-      
-      if (loglikes_writer.IsOpen()) 
-        loglikes_writer.Write(key, lat_like);
-
-      posterior_writer.Write(key, post);
-      n_done++;
-    }
+    kaldi::LatticeToPostWorker worker(acoustic_scale, lm_scale,
+                                      &posterior_writer, &loglikes_writer);
+    kaldi::RunTableTasks(sequencer_config, &lattice_reader, &worker);
 
     KALDI_LOG << "Overall average log-like/frame is "
-              << (total_like/total_time) << " over " << total_time
-              << " frames.  Average acoustic like/frame is "
-              << (total_ac_like/total_time);
-    KALDI_LOG << "Done " << n_done << " lattices.";
-    return (n_done != 0 ? 0 : 1);
+              << (worker.total_like/worker.total_time) << " over "
+              << worker.total_time << " frames.  Average acoustic like/frame is "
+              << (worker.total_ac_like/worker.total_time);
+    KALDI_LOG << "Done " << worker.n_done << " lattices.";
+    return (worker.n_done != 0 ? 0 : 1);
   } catch(const std::exception &e) {
     std::cerr << e.what();
     return -1;
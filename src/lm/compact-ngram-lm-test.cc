@@ -0,0 +1,116 @@
+// lm/compact-ngram-lm-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <fstream>
+#include <cmath>
+#include "lm/compact-ngram-lm.h"
+
+namespace kaldi {
+
+// Word ids in the symbol table we use with input.arpa.
+static const int32 kA = 1, kB = 2, kBos = 3, kEos = 4;
+
+static void BuildFromInputArpa(const std::string &filename) {
+  fst::SymbolTable symbols("words");
+  symbols.AddSymbol("<eps>", 0);
+  symbols.AddSymbol("a", kA);
+  symbols.AddSymbol("b", kB);
+  symbols.AddSymbol("<s>", kBos);
+  symbols.AddSymbol("</s>", kEos);
+  std::ifstream is("input.arpa");
+  KALDI_ASSERT(is.good());
+  std::ofstream os(filename.c_str(), std::ios::out | std::ios::binary);
+  KALDI_ASSERT(BuildCompactNgramLm(is, symbols, os));
+}
+
+// Converts a log10 probability from the ARPA file to a cost.
+static float Cost(double log10_prob) { return -log10_prob * M_LN10; }
+
+static void TestCompactNgramLm() {
+  std::string filename = "tmp.compactlm";
+  BuildFromInputArpa(filename);
+  KALDI_ASSERT(CompactNgramLm::IsCompactNgramLm(filename));
+  KALDI_ASSERT(!CompactNgramLm::IsCompactNgramLm("input.arpa"));
+  CompactNgramLm lm;
+  KALDI_ASSERT(lm.Open(filename));
+  KALDI_ASSERT(lm.Order() == 3 && lm.BosSymbol() == kBos &&
+               lm.EosSymbol() == kEos);
+  KALDI_ASSERT(lm.NumNgrams(1) == 4 && lm.NumNgrams(2) == 2 &&
+               lm.NumNgrams(3) == 2);
+
+  // Every n-gram should be found again from its words.
+  for (int32 n = 1; n <= 3; n++) {
+    for (int64 i = 0; i < lm.NumNgrams(n); i++) {
+      std::vector<int32> words;
+      lm.GetNgram(n, i, &words);
+      KALDI_ASSERT(lm.FindNgram(&(words[0]), n) == i);
+    }
+  }
+  int32 bb[2] = { kB, kB };
+  KALDI_ASSERT(lm.FindNgram(bb, 2) == -1);
+
+  float cost;
+  int32 dest_order;
+  int64 dest_index;
+  std::vector<int32> hist;
+  hist.push_back(kBos);
+  hist.push_back(kA);
+  // trigram "<s> a b".
+  KALDI_ASSERT(lm.GetWordCost(hist, kB, &cost, &dest_order, &dest_index));
+  AssertEqual(cost, Cost(-0.34958));
+  int32 ab[2] = { kA, kB };
+  KALDI_ASSERT(dest_order == 2 && dest_index == lm.FindNgram(ab, 2));
+  // "<s> a a" backs off to "a a" and then to "a": backoff of "<s> a" plus
+  // backoff of "a" plus unigram "a".
+  KALDI_ASSERT(lm.GetWordCost(hist, kA, &cost, &dest_order, &dest_index));
+  AssertEqual(cost, Cost(-4.2 - 3.3 - 5.234679));
+  KALDI_ASSERT(dest_order == 1 && dest_index == lm.FindNgram(&kA, 1));
+
+  hist.clear();
+  hist.push_back(kB);
+  hist.push_back(kA);
+  // "b a" is not a bigram, so there is no backoff weight for it.
+  KALDI_ASSERT(lm.GetWordCost(hist, kEos, &cost, &dest_order, &dest_index));
+  AssertEqual(cost, Cost(-3.3 - 4.333333));
+  KALDI_ASSERT(!lm.GetWordCost(hist, 10, &cost, &dest_order, &dest_index));
+
+  // Now the FST interface: the sentence "a b".
+  CompactNgramLmDeterministicFst fst(lm);
+  fst::StdArc arc;
+  fst::StdArc::StateId s = fst.Start();
+  KALDI_ASSERT(fst.GetArc(s, kA, &arc));
+  KALDI_ASSERT(arc.ilabel == kA && arc.olabel == kA);
+  AssertEqual(arc.weight.Value(), Cost(-1.30490));
+  KALDI_ASSERT(fst.GetArc(arc.nextstate, kB, &arc));
+  AssertEqual(arc.weight.Value(), Cost(-0.34958));
+  AssertEqual(fst.Final(arc.nextstate).Value(), Cost(-0.23940));
+  KALDI_ASSERT(!fst.GetArc(s, kEos, &arc));
+  KALDI_ASSERT(!fst.GetArc(s, 10, &arc));
+
+  std::remove(filename.c_str());
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::TestCompactNgramLm();
+  std::cerr << "Test OK.\n";
+  return 0;
+}
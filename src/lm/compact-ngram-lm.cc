@@ -0,0 +1,608 @@
+// lm/compact-ngram-lm.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include "lm/compact-ngram-lm.h"
+#include "util/text-utils.h"
+
+namespace kaldi {
+
+static const char kCompactNgramLmMagic[16] = "kaldi-compactlm";
+static const int32 kCompactNgramLmVersion = 1;
+static const int32 kQuantizationTableSize = 65536;
+
+
+bool CompactNgramLm::IsCompactNgramLm(const std::string &filename) {
+  std::ifstream is(filename.c_str(), std::ios::in | std::ios::binary);
+  char magic[16];
+  if (!is.read(magic, sizeof(magic)))
+    return false;
+  return (memcmp(magic, kCompactNgramLmMagic, sizeof(magic)) == 0);
+}
+
+
+// Returns true if an array of "count" elements of size "elem_size" at byte
+// offset "offset" is aligned and lies within a file of size "file_size".
+static bool ArrayInFile(int64 offset, int64 count, size_t elem_size,
+                        size_t file_size) {
+  return offset >= static_cast<int64>(sizeof(CompactNgramLmHeader)) &&
+      offset % elem_size == 0 && count >= 0 &&
+      offset + count * static_cast<int64>(elem_size) <=
+      static_cast<int64>(file_size);
+}
+
+
+bool CompactNgramLm::Open(const std::string &filename) {
+  if (!file_.Open(filename))
+    return false;
+  const char *begin = file_.Data();
+  size_t size = file_.Size();
+  header_ = reinterpret_cast<const CompactNgramLmHeader*>(begin);
+  if (size < sizeof(CompactNgramLmHeader) ||
+      memcmp(header_->magic, kCompactNgramLmMagic,
+             sizeof(header_->magic)) != 0) {
+    KALDI_WARN << "File " << filename << " is not a compact LM (use "
+               << "arpa-to-compact-lm to create one).";
+    file_.Close();
+    header_ = NULL;
+    return false;
+  }
+  const CompactNgramLmHeader &h = *header_;
+  if (h.version != kCompactNgramLmVersion || h.order < 1 ||
+      h.order > CompactNgramLmHeader::kMaxOrder) {
+    KALDI_WARN << "Compact LM " << filename << " has unexpected version or "
+               << "order; it may have been written on a machine with a "
+               << "different byte order, or by a different version of the "
+               << "code.";
+    file_.Close();
+    header_ = NULL;
+    return false;
+  }
+  int32 N = h.order;
+  words_.resize(N);
+  cost_codes_.resize(N);
+  backoff_codes_.resize(N, NULL);
+  children_.resize(N, NULL);
+  cost_tables_.resize(N);
+  backoff_tables_.resize(N, NULL);
+  bool ok = true;
+  for (int32 n = 1; n <= N; n++) {
+    int64 num = h.num_ngrams[n - 1];
+    ok = ok && ArrayInFile(h.words_offset[n - 1], num, sizeof(int32), size) &&
+        ArrayInFile(h.cost_offset[n - 1], num, sizeof(uint16), size) &&
+        ArrayInFile(h.cost_table_offset[n - 1], kQuantizationTableSize,
+                    sizeof(float), size);
+    if (n < N)
+      ok = ok &&
+          ArrayInFile(h.backoff_offset[n - 1], num, sizeof(uint16), size) &&
+          ArrayInFile(h.child_offset[n - 1], num + 1, sizeof(uint32), size) &&
+          ArrayInFile(h.backoff_table_offset[n - 1], kQuantizationTableSize,
+                      sizeof(float), size);
+    if (!ok) break;
+    words_[n - 1] = reinterpret_cast<const int32*>(
+        begin + h.words_offset[n - 1]);
+    cost_codes_[n - 1] = reinterpret_cast<const uint16*>(
+        begin + h.cost_offset[n - 1]);
+    cost_tables_[n - 1] = reinterpret_cast<const float*>(
+        begin + h.cost_table_offset[n - 1]);
+    if (n < N) {
+      backoff_codes_[n - 1] = reinterpret_cast<const uint16*>(
+          begin + h.backoff_offset[n - 1]);
+      children_[n - 1] = reinterpret_cast<const uint32*>(
+          begin + h.child_offset[n - 1]);
+      backoff_tables_[n - 1] = reinterpret_cast<const float*>(
+          begin + h.backoff_table_offset[n - 1]);
+      if (children_[n - 1][num] != h.num_ngrams[n]) ok = false;
+    }
+  }
+  if (!ok) {
+    KALDI_WARN << "Compact LM " << filename << " is corrupt or truncated.";
+    file_.Close();
+    header_ = NULL;
+    return false;
+  }
+  return true;
+}
+
+
+int64 CompactNgramLm::FindNgram(const int32 *words, int32 n) const {
+  if (n < 1 || n > Order())
+    return -1;
+  int64 begin = 0, end = NumNgrams(1);
+  for (int32 k = 1; ; k++) {
+    const int32 *w = words_[k - 1],
+        *p = std::lower_bound(w + begin, w + end, words[k - 1]);
+    if (p == w + end || *p != words[k - 1])
+      return -1;
+    int64 i = p - w;
+    if (k == n)
+      return i;
+    begin = children_[k - 1][i];
+    end = children_[k - 1][i + 1];
+  }
+}
+
+
+void CompactNgramLm::GetNgram(int32 n, int64 i,
+                              std::vector<int32> *words) const {
+  KALDI_ASSERT(n >= 1 && n <= Order() && i >= 0 && i < NumNgrams(n));
+  words->resize(n);
+  for (int32 k = n; k >= 1; k--) {
+    (*words)[k - 1] = words_[k - 1][i];
+    if (k > 1) {
+      // The parent is the (k-1)-gram p with children_[k-2][p] <= i <
+      // children_[k-2][p+1].
+      const uint32 *c = children_[k - 2];
+      i = (std::upper_bound(c, c + NumNgrams(k - 1) + 1,
+                            static_cast<uint32>(i)) - c) - 1;
+    }
+  }
+}
+
+
+bool CompactNgramLm::GetWordCost(const std::vector<int32> &hist, int32 word,
+                                 float *cost, int32 *dest_order,
+                                 int64 *dest_index) const {
+  int32 N = Order();
+  // seq is the last N-1 words of the history, followed by the word.
+  size_t start = (hist.size() > static_cast<size_t>(N - 1) ?
+                  hist.size() - (N - 1) : 0);
+  std::vector<int32> seq(hist.begin() + start, hist.end());
+  seq.push_back(word);
+  int32 len = seq.size();
+
+  // Standard backoff: find the longest suffix of seq that is an n-gram,
+  // adding the backoff costs of the histories that we back off from.
+  float c = 0.0;
+  bool found = false;
+  for (int32 a = 0; a < len; a++) {
+    int32 n = len - a;
+    int64 i = FindNgram(&(seq[a]), n);
+    if (i >= 0) {
+      c += NgramCost(n, i);
+      found = true;
+      break;
+    }
+    if (n > 1) {
+      int64 j = FindNgram(&(seq[a]), n - 1);
+      if (j >= 0)
+        c += NgramBackoff(n - 1, j);
+    }
+  }
+  if (!found)
+    return false;
+  *cost = c;
+  // The destination is the longest suffix of seq of order less than N that
+  // is an n-gram; this exists because the word itself is a unigram.
+  for (int32 a = (len == N ? 1 : 0); a < len; a++) {
+    int64 i = FindNgram(&(seq[a]), len - a);
+    if (i >= 0) {
+      *dest_order = len - a;
+      *dest_index = i;
+      return true;
+    }
+  }
+  KALDI_ERR << "Compact LM: unigram not found (code error)";
+  return false;
+}
+
+
+namespace {
+
+// Holds the n-grams of one order while building.
+struct NgramOrder {
+  int32 order;
+  std::vector<int32> words;  // "order" words per n-gram.
+  std::vector<float> costs;
+  std::vector<float> backoffs;
+  int64 Size() const { return costs.size(); }
+  const int32 *Words(int64 i) const { return &(words[i * order]); }
+};
+
+// Compares n-grams of one order by their word sequence.
+struct NgramIndexCompare {
+  explicit NgramIndexCompare(const NgramOrder &o): o_(o) { }
+  bool operator () (int64 i, int64 j) const {
+    return std::lexicographical_compare(o_.Words(i), o_.Words(i) + o_.order,
+                                        o_.Words(j), o_.Words(j) + o_.order);
+  }
+  const NgramOrder &o_;
+};
+
+// Returns -1, 0 or 1 as the n-word sequence a is less than, equal to or
+// greater than b.
+int32 CompareWords(const int32 *a, const int32 *b, int32 n) {
+  for (int32 k = 0; k < n; k++) {
+    if (a[k] < b[k]) return -1;
+    else if (a[k] > b[k]) return 1;
+  }
+  return 0;
+}
+
+// Sets up "table" (of size kQuantizationTableSize, sorted) and "codes" so that
+// table[codes[i]] approximates values[i].  If there are no more distinct values
+// than the table size the representation is exact; otherwise nearby distinct
+// values are merged so as to keep the maximum error small.
+void Quantize(const std::vector<float> &values, std::vector<float> *table,
+              std::vector<uint16> *codes) {
+  std::vector<float> uniq(values);
+  std::sort(uniq.begin(), uniq.end());
+  uniq.erase(std::unique(uniq.begin(), uniq.end()), uniq.end());
+  size_t num_used;
+  table->resize(kQuantizationTableSize);
+  if (uniq.size() <= static_cast<size_t>(kQuantizationTableSize)) {
+    num_used = uniq.size();
+    std::copy(uniq.begin(), uniq.end(), table->begin());
+  } else {
+    // Put the bin boundaries at the largest gaps between successive distinct
+    // values, and represent each bin by the middle of its range.
+    num_used = kQuantizationTableSize;
+    std::vector<std::pair<float, size_t> > gaps(uniq.size() - 1);
+    for (size_t i = 0; i + 1 < uniq.size(); i++)
+      gaps[i] = std::make_pair(uniq[i + 1] - uniq[i], i + 1);
+    std::nth_element(gaps.begin(), gaps.begin() + (num_used - 1), gaps.end(),
+                     std::greater<std::pair<float, size_t> >());
+    std::vector<size_t> boundaries(1, 0);
+    for (size_t b = 0; b + 1 < num_used; b++)
+      boundaries.push_back(gaps[b].second);
+    std::sort(boundaries.begin(), boundaries.end());
+    boundaries.push_back(uniq.size());
+    for (size_t b = 0; b < num_used; b++)
+      (*table)[b] = 0.5 * (uniq[boundaries[b]] + uniq[boundaries[b + 1] - 1]);
+  }
+  for (size_t b = num_used; b < table->size(); b++)
+    (*table)[b] = (num_used == 0 ? 0.0 : (*table)[num_used - 1]);
+
+  codes->resize(values.size());
+  std::vector<float>::const_iterator tbegin = table->begin(),
+      tend = table->begin() + num_used;
+  for (size_t i = 0; i < values.size(); i++) {
+    std::vector<float>::const_iterator p =
+        std::lower_bound(tbegin, tend, values[i]);
+    if (p == tend || (p != tbegin && values[i] - *(p - 1) < *p - values[i]))
+      --p;
+    (*codes)[i] = static_cast<uint16>(p - tbegin);
+  }
+}
+
+// Writes an array, padding the stream to a multiple of 8 bytes first.
+template<class T>
+void WriteArray(const std::vector<T> &v, std::ostream &os) {
+  int64 pos = os.tellp();
+  static const char zeros[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+  if (pos % 8 != 0)
+    os.write(zeros, 8 - pos % 8);
+  if (!v.empty())
+    os.write(reinterpret_cast<const char*>(&(v[0])), sizeof(T) * v.size());
+}
+
+int64 ArrayOffset(int64 *pos, int64 num_bytes) {
+  if (*pos % 8 != 0) *pos += 8 - *pos % 8;
+  int64 ans = *pos;
+  *pos += num_bytes;
+  return ans;
+}
+
+// Reads the n-grams from the ARPA file into "orders"; returns false on error.
+bool ReadArpa(std::istream &is, const fst::SymbolTable &symbols,
+              std::vector<NgramOrder> *orders) {
+  std::string line;
+  std::vector<std::string> fields;
+  std::vector<int64> counts;
+  // Read the \data\ section.
+  while (std::getline(is, line)) {
+    Trim(&line);
+    if (line == "\\data\\") break;
+  }
+  while (std::getline(is, line)) {
+    Trim(&line);
+    if (line.empty()) {
+      if (counts.empty()) continue;
+      else break;
+    }
+    if (line.compare(0, 6, "ngram ") != 0) break;
+    std::string spec = line.substr(6);
+    size_t eq = spec.find('=');
+    int32 n;
+    int64 count;
+    if (eq == std::string::npos ||
+        !ConvertStringToInteger(spec.substr(0, eq), &n) ||
+        !ConvertStringToInteger(spec.substr(eq + 1), &count) ||
+        n != static_cast<int32>(counts.size()) + 1 || count < 0) {
+      KALDI_WARN << "Bad line in \\data\\ section of ARPA file: " << line;
+      return false;
+    }
+    counts.push_back(count);
+  }
+  int32 N = counts.size();
+  if (N < 2 || N > CompactNgramLmHeader::kMaxOrder) {
+    KALDI_WARN << "ARPA file has order " << N << "; compact LMs support "
+               << "orders 2 to " << CompactNgramLmHeader::kMaxOrder;
+    return false;
+  }
+  orders->resize(N);
+  for (int32 n = 1; n <= N; n++) {
+    NgramOrder &o = (*orders)[n - 1];
+    o.order = n;
+    o.words.reserve(counts[n - 1] * n);
+    o.costs.reserve(counts[n - 1]);
+    o.backoffs.reserve(counts[n - 1]);
+  }
+
+  int32 cur_order = 0;
+  int64 num_skipped = 0;
+  std::vector<int32> words;
+  bool seen_end = false;
+  do {
+    Trim(&line);
+    if (line.empty()) continue;
+    if (line[0] == '\\') {
+      if (line == "\\end\\") {
+        seen_end = true;
+        break;
+      }
+      int32 n;
+      size_t dash = line.find("-grams:");
+      if (dash == std::string::npos ||
+          !ConvertStringToInteger(line.substr(1, dash - 1), &n) ||
+          n < 1 || n > N) {
+        KALDI_WARN << "Bad section header in ARPA file: " << line;
+        return false;
+      }
+      cur_order = n;
+      continue;
+    }
+    if (cur_order == 0) {
+      KALDI_WARN << "Unexpected line in ARPA file: " << line;
+      return false;
+    }
+    SplitStringToVector(line, " \t", true, &fields);
+    double logprob, backoff = 0.0;
+    if ((fields.size() != static_cast<size_t>(cur_order) + 1 &&
+         fields.size() != static_cast<size_t>(cur_order) + 2) ||
+        !ConvertStringToReal(fields[0], &logprob) ||
+        (fields.size() == static_cast<size_t>(cur_order) + 2 &&
+         !ConvertStringToReal(fields.back(), &backoff))) {
+      KALDI_WARN << "Bad line in " << cur_order << "-grams section of ARPA "
+                 << "file: " << line;
+      return false;
+    }
+    words.resize(cur_order);
+    bool oov = false;
+    for (int32 k = 0; k < cur_order; k++) {
+      int64 id = symbols.Find(fields[k + 1]);
+      if (id == fst::SymbolTable::kNoSymbol) oov = true;
+      else words[k] = id;
+    }
+    if (oov) {
+      num_skipped++;
+      continue;
+    }
+    NgramOrder &o = (*orders)[cur_order - 1];
+    o.words.insert(o.words.end(), words.begin(), words.end());
+    // Convert from log10 probabilities to natural-log costs.
+    o.costs.push_back(-logprob * M_LN10);
+    o.backoffs.push_back(-backoff * M_LN10);
+  } while (std::getline(is, line));
+  if (!seen_end)
+    KALDI_WARN << "No \\end\\ marker in ARPA file; file may be truncated.";
+  if (num_skipped > 0)
+    KALDI_WARN << "Skipped " << num_skipped << " n-grams containing words "
+               << "not in the symbol table.";
+  return true;
+}
+
+}  // namespace
+
+
+bool BuildCompactNgramLm(std::istream &arpa_is,
+                         const fst::SymbolTable &symbols,
+                         std::ostream &os) {
+  int64 bos = symbols.Find("<s>"), eos = symbols.Find("</s>");
+  if (bos == fst::SymbolTable::kNoSymbol ||
+      eos == fst::SymbolTable::kNoSymbol) {
+    KALDI_WARN << "Symbol table does not contain <s> and </s>";
+    return false;
+  }
+  std::vector<NgramOrder> orders;
+  if (!ReadArpa(arpa_is, symbols, &orders))
+    return false;
+  int32 N = orders.size();
+
+  // Sort each order, remove duplicates and n-grams whose (n-1)-word prefix is
+  // not present, and work out the children of each n-gram.
+  std::vector<std::vector<uint32> > children(N);
+  int64 num_dropped = 0, num_duplicates = 0;
+  for (int32 n = 1; n <= N; n++) {
+    NgramOrder &o = orders[n - 1];
+    std::vector<int64> index(o.Size());
+    for (int64 i = 0; i < o.Size(); i++) index[i] = i;
+    std::stable_sort(index.begin(), index.end(), NgramIndexCompare(o));
+    NgramOrder sorted;
+    sorted.order = n;
+    const NgramOrder *parent = (n > 1 ? &(orders[n - 2]) : NULL);
+    if (parent != NULL)
+      children[n - 2].resize(parent->Size() + 1);
+    int64 p = 0;  // current parent
+    for (size_t r = 0; r < index.size(); r++) {
+      int64 i = index[r];
+      const int32 *w = o.Words(i);
+      if (sorted.Size() > 0 &&
+          CompareWords(w, sorted.Words(sorted.Size() - 1), n) == 0) {
+        num_duplicates++;
+        continue;
+      }
+      if (parent != NULL) {
+        while (p < parent->Size() &&
+               CompareWords(parent->Words(p), w, n - 1) < 0) {
+          p++;
+          children[n - 2][p] = sorted.Size();
+        }
+        if (p == parent->Size() ||
+            CompareWords(parent->Words(p), w, n - 1) != 0) {
+          num_dropped++;
+          continue;
+        }
+      }
+      sorted.words.insert(sorted.words.end(), w, w + n);
+      sorted.costs.push_back(o.costs[i]);
+      sorted.backoffs.push_back(o.backoffs[i]);
+    }
+    if (parent != NULL)
+      for (p++; p <= parent->Size(); p++)
+        children[n - 2][p] = sorted.Size();
+    o.words.swap(sorted.words);
+    o.costs.swap(sorted.costs);
+    o.backoffs.swap(sorted.backoffs);
+    if (o.Size() > static_cast<int64>(std::numeric_limits<uint32>::max())) {
+      KALDI_WARN << "Too many " << n << "-grams for compact LM format.";
+      return false;
+    }
+  }
+  if (num_duplicates > 0)
+    KALDI_WARN << "Ignored " << num_duplicates << " duplicate n-grams.";
+  if (num_dropped > 0)
+    KALDI_WARN << "Dropped " << num_dropped << " n-grams whose history was "
+               << "not present as an n-gram.";
+  if (!std::binary_search(orders[0].words.begin(), orders[0].words.end(),
+                          static_cast<int32>(bos))) {
+    KALDI_WARN << "ARPA file has no unigram for <s>";
+    return false;
+  }
+
+  // Quantize, and work out the layout of the file.
+  CompactNgramLmHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, kCompactNgramLmMagic, sizeof(h.magic));
+  h.version = kCompactNgramLmVersion;
+  h.order = N;
+  h.bos_symbol = bos;
+  h.eos_symbol = eos;
+  std::vector<std::vector<int32> > last_words(N);
+  std::vector<std::vector<uint16> > cost_codes(N), backoff_codes(N);
+  std::vector<std::vector<float> > cost_tables(N), backoff_tables(N);
+  int64 pos = sizeof(h);
+  double max_error = 0.0;
+  for (int32 n = 1; n <= N; n++) {
+    const NgramOrder &o = orders[n - 1];
+    int64 num = o.Size();
+    h.num_ngrams[n - 1] = num;
+    last_words[n - 1].resize(num);
+    for (int64 i = 0; i < num; i++)
+      last_words[n - 1][i] = o.Words(i)[n - 1];
+    Quantize(o.costs, &(cost_tables[n - 1]), &(cost_codes[n - 1]));
+    for (int64 i = 0; i < num; i++)
+      max_error = std::max(max_error, static_cast<double>(std::abs(
+          cost_tables[n - 1][cost_codes[n - 1][i]] - o.costs[i])));
+    h.words_offset[n - 1] = ArrayOffset(&pos, num * sizeof(int32));
+    h.cost_offset[n - 1] = ArrayOffset(&pos, num * sizeof(uint16));
+    h.cost_table_offset[n - 1] = ArrayOffset(
+        &pos, kQuantizationTableSize * sizeof(float));
+    if (n < N) {
+      Quantize(o.backoffs, &(backoff_tables[n - 1]), &(backoff_codes[n - 1]));
+      h.backoff_offset[n - 1] = ArrayOffset(&pos, num * sizeof(uint16));
+      h.child_offset[n - 1] = ArrayOffset(&pos, (num + 1) * sizeof(uint32));
+      h.backoff_table_offset[n - 1] = ArrayOffset(
+          &pos, kQuantizationTableSize * sizeof(float));
+    }
+    KALDI_LOG << "Order " << n << ": " << num << " n-grams.";
+  }
+  KALDI_LOG << "Maximum quantization error in costs is " << max_error;
+
+  os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+  for (int32 n = 1; n <= N; n++) {
+    WriteArray(last_words[n - 1], os);
+    WriteArray(cost_codes[n - 1], os);
+    WriteArray(cost_tables[n - 1], os);
+    if (n < N) {
+      WriteArray(backoff_codes[n - 1], os);
+      WriteArray(children[n - 1], os);
+      WriteArray(backoff_tables[n - 1], os);
+    }
+  }
+  return os.good();
+}
+
+
+CompactNgramLmDeterministicFst::CompactNgramLmDeterministicFst(
+    const CompactNgramLm &lm): lm_(lm) {
+  int32 N = lm.Order();
+  KALDI_ASSERT(N >= 2);
+  state_offsets_.resize(N);
+  state_offsets_[0] = 0;
+  for (int32 n = 1; n < N; n++)
+    state_offsets_[n] = state_offsets_[n - 1] + lm.NumNgrams(n);
+  // state_offsets_[N-1] is the total number of states.
+  if (state_offsets_[N - 1] > static_cast<int64>(
+          std::numeric_limits<StateId>::max()))
+    KALDI_ERR << "Compact LM has too many histories to be used as an FST.";
+  int32 bos = lm.BosSymbol();
+  int64 i = lm.FindNgram(&bos, 1);
+  if (i < 0)
+    KALDI_ERR << "Compact LM has no unigram for <s>";
+  start_state_ = i;
+}
+
+
+void CompactNgramLmDeterministicFst::GetHistory(
+    StateId s, std::vector<Label> *hist) const {
+  KALDI_ASSERT(s >= 0 && s < state_offsets_.back());
+  int32 n = std::upper_bound(state_offsets_.begin(), state_offsets_.end() - 1,
+                             static_cast<int64>(s)) - state_offsets_.begin();
+  lm_.GetNgram(n, s - state_offsets_[n - 1], hist);
+}
+
+
+fst::StdArc::Weight CompactNgramLmDeterministicFst::Final(StateId s) {
+  std::vector<Label> hist;
+  GetHistory(s, &hist);
+  float cost;
+  int32 dest_order;
+  int64 dest_index;
+  if (lm_.GetWordCost(hist, lm_.EosSymbol(), &cost, &dest_order, &dest_index))
+    return Weight(cost);
+  else
+    return Weight::Zero();
+}
+
+
+bool CompactNgramLmDeterministicFst::GetArc(StateId s, Label ilabel,
+                                            fst::StdArc *oarc) {
+  if (ilabel == lm_.BosSymbol() || ilabel == lm_.EosSymbol())
+    return false;
+  std::vector<Label> hist;
+  GetHistory(s, &hist);
+  float cost;
+  int32 dest_order;
+  int64 dest_index;
+  if (!lm_.GetWordCost(hist, ilabel, &cost, &dest_order, &dest_index))
+    return false;
+  oarc->ilabel = ilabel;
+  oarc->olabel = ilabel;
+  oarc->weight = Weight(cost);
+  oarc->nextstate = state_offsets_[dest_order - 1] + dest_index;
+  return true;
+}
+
+}  // namespace kaldi
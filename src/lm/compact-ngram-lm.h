@@ -0,0 +1,193 @@
+// lm/compact-ngram-lm.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_LM_COMPACT_NGRAM_LM_H_
+#define KALDI_LM_COMPACT_NGRAM_LM_H_
+
+#include <string>
+#include <vector>
+#include "fst/fstlib.h"
+#include "base/kaldi-common.h"
+#include "util/kaldi-mmap.h"
+#include "fstext/deterministic-fst.h"
+
+namespace kaldi {
+
+/// @addtogroup LanguageModel
+/// @{
+
+/**
+   CompactNgramLm is a compact, read-only form of a backoff n-gram language
+   model (as read from an ARPA file), for use with LMs that would be too large
+   to turn into an FST (G.fst).  The file is memory-mapped rather than read, so
+   loading is instantaneous and processes on the same machine share the memory.
+   It is created from an ARPA file by BuildCompactNgramLm() (see the program
+   arpa-to-compact-lm), and accessed as an FST via
+   CompactNgramLmDeterministicFst.
+
+   The n-grams are stored as a trie: the n-grams of each order are sorted on
+   their word sequence, so that the n-grams that extend any particular
+   (n-1)-gram by one word are contiguous, and for each n-gram below the highest
+   order we store the index of its first extension.  For each n-gram we store
+   the word and the quantized cost (negated natural-log probability) and
+   backoff cost.
+   The quantization uses, separately for each order, a table of 65536 values;
+   if there are fewer distinct values than that, it is exact.  We do not store
+   parent pointers; the parent of an n-gram is found by binary search.
+
+   Words are represented as integer ids from the symbol table (words.txt) that
+   was supplied when building, so that the FST has the same labels as the
+   decoding graph.  The format is native binary (not portable between machines
+   with different byte order).
+*/
+
+
+/// The header at the start of a file written by BuildCompactNgramLm().
+struct CompactNgramLmHeader {
+  char magic[16];  // "kaldi-compactlm", NUL-terminated.
+  int32 version;
+  int32 order;  // the highest n-gram order, N.
+  int32 bos_symbol;  // the word id of <s>
+  int32 eos_symbol;  // the word id of </s>
+  // For order n = 1..N (index n-1), the number of n-grams, and the offset in
+  // bytes from the start of the file of each array (0 if not present).
+  static const int32 kMaxOrder = 20;
+  int64 num_ngrams[kMaxOrder];
+  int64 words_offset[kMaxOrder];  // int32 word id of the last word.
+  int64 cost_offset[kMaxOrder];  // uint16 quantized cost.
+  int64 backoff_offset[kMaxOrder];  // uint16 quantized backoff cost (n < N).
+  int64 child_offset[kMaxOrder];  // uint32 index of the first extension
+                                  // (num_ngrams + 1 elements; n < N).
+  int64 cost_table_offset[kMaxOrder];  // 65536 floats: the quantization
+  int64 backoff_table_offset[kMaxOrder];  // tables.
+};
+
+
+class CompactNgramLm {
+ public:
+  CompactNgramLm(): header_(NULL) { }
+
+  /// Maps the file, which must have been written by BuildCompactNgramLm().
+  /// "filename" must be an actual file, not a pipe.  Returns false (with a
+  /// warning) on failure.
+  bool Open(const std::string &filename);
+
+  /// Returns true if "filename" is a file that starts like one written by
+  /// BuildCompactNgramLm().  Does not print a warning if not.
+  static bool IsCompactNgramLm(const std::string &filename);
+
+  int32 Order() const { return header_->order; }
+
+  int32 BosSymbol() const { return header_->bos_symbol; }
+
+  int32 EosSymbol() const { return header_->eos_symbol; }
+
+  int64 NumNgrams(int32 n) const { return header_->num_ngrams[n - 1]; }
+
+  /// Looks up the n-gram "words" (oldest word first) where n = words.size();
+  /// returns its index among the n-grams of that order, or -1 if it is not
+  /// present.
+  int64 FindNgram(const int32 *words, int32 n) const;
+
+  /// Returns the cost of the n-gram with index "i" among the n-grams of order
+  /// n.
+  float NgramCost(int32 n, int64 i) const {
+    return cost_tables_[n - 1][cost_codes_[n - 1][i]];
+  }
+
+  /// Returns the backoff cost of the n-gram with index "i" among the n-grams
+  /// of order n; requires n < Order().
+  float NgramBackoff(int32 n, int64 i) const {
+    return backoff_tables_[n - 1][backoff_codes_[n - 1][i]];
+  }
+
+  /// Gets the words of the n-gram with index "i" among the n-grams of order
+  /// n, oldest word first.
+  void GetNgram(int32 n, int64 i, std::vector<int32> *words) const;
+
+  /// Returns the cost of "word" following the history "hist" (oldest word
+  /// first), with backoff, and sets (*dest_order, *dest_index) to the order
+  /// and index of the longest suffix of (hist, word) of order less than
+  /// Order() that is a known n-gram.  Returns false if the word is not in the
+  /// LM at all.
+  bool GetWordCost(const std::vector<int32> &hist, int32 word, float *cost,
+                   int32 *dest_order, int64 *dest_index) const;
+
+ private:
+  MappedFile file_;
+  const CompactNgramLmHeader *header_;
+  // The following are pointers into the mapped file, indexed by order - 1.
+  std::vector<const int32*> words_;
+  std::vector<const uint16*> cost_codes_;
+  std::vector<const uint16*> backoff_codes_;
+  std::vector<const uint32*> children_;
+  std::vector<const float*> cost_tables_;
+  std::vector<const float*> backoff_tables_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CompactNgramLm);
+};
+
+
+/// Reads an ARPA-format language model from "arpa_is" and writes it to "os",
+/// which should have been opened in binary mode, in the format read by
+/// CompactNgramLm.  Words are converted to integer ids using "symbols", which
+/// must contain <s> and </s>; n-grams containing words that are not in the
+/// symbol table are skipped with a warning.  Returns false on error.
+bool BuildCompactNgramLm(std::istream &arpa_is,
+                         const fst::SymbolTable &symbols,
+                         std::ostream &os);
+
+
+/// This class exposes a CompactNgramLm as an FST, for composition with
+/// lattices or for use in the biglm decoders.  There is one state for each
+/// n-gram of order less than N, which represents that history; the state id is
+/// the index of the n-gram, counting the n-grams of all orders in sequence.
+/// Since it has no mutable state, it may be used from multiple threads.
+/// Weights are costs in the natural-log domain, as in G.fst; the start state
+/// is the history "<s>", and the final-prob is the cost of </s>.
+class CompactNgramLmDeterministicFst:
+      public fst::DeterministicOnDemandFst<fst::StdArc> {
+ public:
+  typedef fst::StdArc::Weight Weight;
+  typedef fst::StdArc::StateId StateId;
+  typedef fst::StdArc::Label Label;
+
+  /// We don't take ownership of "lm".
+  explicit CompactNgramLmDeterministicFst(const CompactNgramLm &lm);
+
+  virtual StateId Start() { return start_state_; }
+
+  virtual Weight Final(StateId s);
+
+  virtual bool GetArc(StateId s, Label ilabel, fst::StdArc *oarc);
+
+ private:
+  // Gets the history that state s represents.
+  void GetHistory(StateId s, std::vector<Label> *hist) const;
+
+  const CompactNgramLm &lm_;
+  // state_offsets_[n-1] is the state id of the first n-gram of order n.
+  std::vector<int64> state_offsets_;
+  StateId start_state_;
+};
+
+/// @}
+
+}  // namespace kaldi
+
+#endif  // KALDI_LM_COMPACT_NGRAM_LM_H_
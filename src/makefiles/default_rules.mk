@@ -65,7 +65,7 @@ $(BINFILES): $(LIBFILE) $(XDEPENDS)
 	$(MAKE) -C ${@D} ${@F}
 
 clean:
-	-rm -f *.o *.a *.so $(TESTFILES) $(BINFILES) $(TESTOUTPUTS) tmp* *.tmp
+	-rm -f *.o *.a *.so $(TESTFILES) $(BENCHFILES) $(BINFILES) $(TESTOUTPUTS) tmp* *.tmp
 
 $(TESTFILES): $(LIBFILE) $(XDEPENDS)
 
@@ -74,6 +74,17 @@ test_compile: $(TESTFILES)
 test: test_compile
 	@result=0; for x in $(TESTFILES); do printf "Running $$x ..."; ./$$x >/dev/null 2>&1; if [ $$? -ne 0 ]; then echo "... FAIL"; result=1; else echo "... SUCCESS";  fi;  done; exit $$result
 
+# "make bench" runs the benchmark programs, appending the results (one line
+# of JSON per result; see util/kaldi-bench.h) to $(BENCH_RESULTS).
+BENCH_RESULTS ?= bench-results.jsonl
+
+$(BENCHFILES): $(LIBFILE) $(XDEPENDS)
+
+bench_compile: $(BENCHFILES)
+
+bench: bench_compile
+	@result=0; for x in $(BENCHFILES); do printf "Running $$x ..."; ./$$x >>$(BENCH_RESULTS) 2>$$x.log; if [ $$? -ne 0 ]; then echo "... FAIL (see $$x.log)"; result=1; else echo "... SUCCESS";  fi;  done; exit $$result
+
 .valgrind: $(BINFILES) $(TESTFILES)
 
 
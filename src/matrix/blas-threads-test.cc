@@ -0,0 +1,86 @@
+// matrix/blas-threads-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "matrix/matrix-lib.h"
+
+namespace kaldi {
+
+// Tests the products small enough to be done without BLAS (see
+// Xgemm_small() in cblas-wrappers.h), and a few larger ones, against a
+// straightforward computation.
+template<typename Real>
+static void UnitTestSmallGemm() {
+  for (int32 i = 0; i < 200; i++) {
+    MatrixIndexT m = 1 + rand() % 5, n = 1 + rand() % 5, k = 1 + rand() % 5;
+    MatrixTransposeType transA = (rand() % 2 == 0 ? kNoTrans : kTrans),
+        transB = (rand() % 2 == 0 ? kNoTrans : kTrans);
+    Matrix<Real> A(transA == kNoTrans ? m : k, transA == kNoTrans ? k : m),
+        B(transB == kNoTrans ? k : n, transB == kNoTrans ? n : k), M(m, n);
+    A.SetRandn();
+    B.SetRandn();
+    M.SetRandn();
+    Real alpha = RandGauss(), beta = (i % 3 == 0 ? 0.0 : RandGauss());
+    Matrix<double> ref(m, n);
+    for (MatrixIndexT r = 0; r < m; r++) {
+      for (MatrixIndexT c = 0; c < n; c++) {
+        double sum = 0.0;
+        for (MatrixIndexT j = 0; j < k; j++)
+          sum += (transA == kNoTrans ? A(r, j) : A(j, r)) *
+              (transB == kNoTrans ? B(j, c) : B(c, j));
+        ref(r, c) = alpha * sum + (beta == 0.0 ? 0.0 : beta * M(r, c));
+      }
+    }
+    if (beta == 0.0)  // as in BLAS, M should then be ignored, even NaNs.
+      M(0, 0) = std::numeric_limits<Real>::quiet_NaN();
+    M.AddMatMat(alpha, A, transA, B, transB, beta);
+    Matrix<Real> ref_real(ref);
+    AssertEqual(M, ref_real, 1.0e-04);
+  }
+}
+
+static void UnitTestBlasNumThreadsScope() {
+  KALDI_LOG << "BLAS library is " << BlasLibraryName();
+  if (!SetBlasNumThreads(2)) {
+    KALDI_ASSERT(GetBlasNumThreads() == -1);
+    BlasNumThreadsScope scope(1);  // does nothing.
+    return;
+  }
+  int32 num_threads = GetBlasNumThreads();
+  KALDI_ASSERT(num_threads >= 1 && num_threads <= 2);
+  {
+    BlasNumThreadsScope scope(1);
+    KALDI_ASSERT(GetBlasNumThreads() == 1);
+    {
+      BlasNumThreadsScope inner_scope(3);
+      KALDI_ASSERT(GetBlasNumThreads() == 1);
+    }
+    KALDI_ASSERT(GetBlasNumThreads() == 1);
+  }
+  KALDI_ASSERT(GetBlasNumThreads() == num_threads);
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::UnitTestSmallGemm<float>();
+  kaldi::UnitTestSmallGemm<double>();
+  kaldi::UnitTestBlasNumThreadsScope();
+  std::cout << "Test OK.\n";
+  return 0;
+}
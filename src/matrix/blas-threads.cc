@@ -0,0 +1,167 @@
+// matrix/blas-threads.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+#include <map>
+#include "matrix/blas-threads.h"
+
+// The thread-control functions of the BLAS libraries we know.  They are
+// declared weak, so they are NULL if the library we are linked with does not
+// have them.  (We do not include kaldi-blas.h, as mkl.h declares the MKL ones
+// differently.)
+#if defined(__GNUC__) && !defined(__APPLE__)
+extern "C" {
+void openblas_set_num_threads(int num_threads) __attribute__((weak));
+int openblas_get_num_threads() __attribute__((weak));
+void MKL_Set_Num_Threads(int num_threads) __attribute__((weak));
+int MKL_Set_Num_Threads_Local(int num_threads) __attribute__((weak));
+int MKL_Get_Max_Threads() __attribute__((weak));
+void bli_thread_set_num_threads(int64_t num_threads) __attribute__((weak));
+int64_t bli_thread_get_num_threads() __attribute__((weak));
+}
+#define KALDI_HAVE_WEAK_BLAS_SYMBOLS 1
+#endif
+
+namespace kaldi {
+
+namespace {
+
+enum BlasLibrary { kUnknownBlas, kOpenBlas, kMkl, kBlis };
+
+BlasLibrary GetBlasLibrary() {
+#ifdef KALDI_HAVE_WEAK_BLAS_SYMBOLS
+  if (openblas_set_num_threads != NULL && openblas_get_num_threads != NULL)
+    return kOpenBlas;
+  if (MKL_Set_Num_Threads != NULL && MKL_Set_Num_Threads_Local != NULL &&
+      MKL_Get_Max_Threads != NULL)
+    return kMkl;
+  if (bli_thread_set_num_threads != NULL && bli_thread_get_num_threads != NULL)
+    return kBlis;
+#endif
+  return kUnknownBlas;
+}
+
+// The rest is for the libraries with only a process-wide setting.
+pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+// The number of threads set with SetBlasNumThreads(), or the library's own
+// default; -1 until needed.
+int32 g_process_num_threads = -1;
+// The number the library has been set to by us; -1 if not known.
+int32 g_current_num_threads = -1;
+// The number of BlasNumThreadsScope objects that exist, for each number of
+// threads.
+std::map<int32, int32> g_scope_counts;
+
+void SetProcessWide(BlasLibrary library, int32 num_threads) {
+#ifdef KALDI_HAVE_WEAK_BLAS_SYMBOLS
+  if (library == kOpenBlas) openblas_set_num_threads(num_threads);
+  else if (library == kBlis) bli_thread_set_num_threads(num_threads);
+  else if (library == kMkl) MKL_Set_Num_Threads(num_threads);
+#endif
+}
+
+// Sets the library to the smallest of g_process_num_threads and the numbers
+// of the scopes; requires g_mutex to be held.
+void UpdateNumThreadsLocked(BlasLibrary library) {
+  if (g_process_num_threads < 0)
+    g_process_num_threads = GetBlasNumThreads();
+  int32 num_threads = g_process_num_threads;
+  if (!g_scope_counts.empty())
+    num_threads = std::min(num_threads, g_scope_counts.begin()->first);
+  if (num_threads != g_current_num_threads && num_threads > 0) {
+    SetProcessWide(library, num_threads);
+    g_current_num_threads = num_threads;
+  }
+}
+
+}  // namespace
+
+const char *BlasLibraryName() {
+  switch (GetBlasLibrary()) {
+    case kOpenBlas: return "openblas";
+    case kMkl: return "mkl";
+    case kBlis: return "blis";
+    default: return "unknown";
+  }
+}
+
+bool SetBlasNumThreads(int32 num_threads) {
+  KALDI_ASSERT(num_threads > 0);
+  BlasLibrary library = GetBlasLibrary();
+  if (library == kUnknownBlas) return false;
+  if (library == kMkl) {  // the per-thread settings are not affected.
+    SetProcessWide(library, num_threads);
+    return true;
+  }
+  pthread_mutex_lock(&g_mutex);
+  g_process_num_threads = num_threads;
+  g_current_num_threads = -1;
+  UpdateNumThreadsLocked(library);
+  pthread_mutex_unlock(&g_mutex);
+  return true;
+}
+
+int32 GetBlasNumThreads() {
+#ifdef KALDI_HAVE_WEAK_BLAS_SYMBOLS
+  switch (GetBlasLibrary()) {
+    case kOpenBlas: return openblas_get_num_threads();
+    case kMkl: return MKL_Get_Max_Threads();
+    case kBlis: return bli_thread_get_num_threads();
+    default: break;
+  }
+#endif
+  return -1;
+}
+
+BlasNumThreadsScope::BlasNumThreadsScope(int32 num_threads):
+    num_threads_(num_threads), previous_(0) {
+  KALDI_ASSERT(num_threads > 0);
+  BlasLibrary library = GetBlasLibrary();
+  if (library == kUnknownBlas) return;
+#ifdef KALDI_HAVE_WEAK_BLAS_SYMBOLS
+  if (library == kMkl) {
+    previous_ = MKL_Set_Num_Threads_Local(num_threads);
+    return;
+  }
+#endif
+  pthread_mutex_lock(&g_mutex);
+  g_scope_counts[num_threads]++;
+  UpdateNumThreadsLocked(library);
+  pthread_mutex_unlock(&g_mutex);
+}
+
+BlasNumThreadsScope::~BlasNumThreadsScope() {
+  BlasLibrary library = GetBlasLibrary();
+  if (library == kUnknownBlas) return;
+#ifdef KALDI_HAVE_WEAK_BLAS_SYMBOLS
+  if (library == kMkl) {
+    // previous_ == 0 means there was no per-thread setting.
+    MKL_Set_Num_Threads_Local(previous_);
+    return;
+  }
+#endif
+  pthread_mutex_lock(&g_mutex);
+  std::map<int32, int32>::iterator iter = g_scope_counts.find(num_threads_);
+  KALDI_ASSERT(iter != g_scope_counts.end());
+  if (--(iter->second) == 0) g_scope_counts.erase(iter);
+  UpdateNumThreadsLocked(library);
+  pthread_mutex_unlock(&g_mutex);
+}
+
+}  // namespace kaldi
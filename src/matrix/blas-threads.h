@@ -0,0 +1,80 @@
+// matrix/blas-threads.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_BLAS_THREADS_H_
+#define KALDI_MATRIX_BLAS_THREADS_H_
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_funcs_misc
+/// @{
+
+/*
+  These functions control how many threads the BLAS library uses for large
+  operations (e.g. matrix multiplication).  Which library we are linked with
+  (the one from kaldi-blas.h is only the headers) is found out at run time:
+  OpenBLAS, MKL and BLIS are recognized; with others, e.g. ATLAS, whose number
+  of threads is fixed when it is compiled, nothing can be changed.
+
+  Programs that do their own multi-threading should not also have BLAS use
+  several threads per call, as the cores are then oversubscribed.  For this,
+  the jobs run by MultiThreadPool (so by MultiThreader, RunParallelFor and
+  TaskSequencer) are run inside a BlasNumThreadsScope with one thread.  The
+  number of threads for everything else can be set with the standard
+  --blas-num-threads option of ParseOptions.
+*/
+
+/// Returns the name of the BLAS library we are linked with: "openblas",
+/// "mkl", "blis", or "unknown" if its number of threads cannot be controlled.
+const char *BlasLibraryName();
+
+/// Sets the number of threads the BLAS library uses, for the whole process.
+/// Returns false if this is not supported for the library.
+bool SetBlasNumThreads(int32 num_threads);
+
+/// Returns the number of threads the BLAS library uses (in the calling thread,
+/// for libraries that have a per-thread setting), or -1 if unknown.
+int32 GetBlasNumThreads();
+
+/**
+   While an object of this class exists, the BLAS calls made by the current
+   thread use at most "num_threads" threads; e.g. a call site that is itself
+   run in many threads can use BlasNumThreadsScope(1).  With MKL this is a
+   per-thread setting.  With libraries that only have a process-wide setting
+   (OpenBLAS and BLIS), the process-wide number of threads is set to the
+   smallest number requested by the scopes that exist in any thread, and is
+   restored when they are all gone.  The scopes may be nested.
+ */
+class BlasNumThreadsScope {
+ public:
+  explicit BlasNumThreadsScope(int32 num_threads);
+  ~BlasNumThreadsScope();
+ private:
+  int32 num_threads_;
+  int32 previous_;  // for the per-thread setting.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(BlasNumThreadsScope);
+};
+
+/// @} end of "addtogroup matrix_funcs_misc"
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_BLAS_THREADS_H_
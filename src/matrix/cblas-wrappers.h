@@ -26,6 +26,7 @@
 #include "matrix/kaldi-vector.h"
 #include "matrix/kaldi-matrix.h"
 #include "matrix/matrix-functions.h"
+#include "matrix/simd-kernels.h"
 
 // Do not include this file directly.  It is to be included
 // by .cc files in this directory.
@@ -208,6 +209,40 @@ inline void Xgemv_sparsevec(MatrixTransposeType trans, MatrixIndexT num_rows,
   }
 }
 
+// Does the same as cblas_Xgemm() below, without calling BLAS; for very small
+// products, the overhead of the BLAS call is larger than the computation.
+// Note: as in BLAS, if beta == 0 the old contents of M are ignored.
+template<typename Real>
+inline void Xgemm_small(const Real alpha, MatrixTransposeType transA,
+                        const Real *Adata, MatrixIndexT a_stride,
+                        MatrixTransposeType transB, const Real *Bdata,
+                        MatrixIndexT b_stride, const Real beta, Real *Mdata,
+                        MatrixIndexT num_rows, MatrixIndexT num_cols,
+                        MatrixIndexT inner_dim, MatrixIndexT stride) {
+  // A(i, k) is Adata[i * a_row + k * a_col], B(k, j) is
+  // Bdata[k * b_row + j * b_col].
+  MatrixIndexT a_row = (transA == kNoTrans ? a_stride : 1),
+      a_col = (transA == kNoTrans ? 1 : a_stride),
+      b_row = (transB == kNoTrans ? b_stride : 1),
+      b_col = (transB == kNoTrans ? 1 : b_stride);
+  for (MatrixIndexT i = 0; i < num_rows; i++) {
+    Real *row = Mdata + i * stride;
+    for (MatrixIndexT j = 0; j < num_cols; j++)
+      row[j] = (beta == 0.0 ? 0.0 : beta * row[j]);
+    for (MatrixIndexT k = 0; k < inner_dim; k++) {
+      Real a = alpha * Adata[i * a_row + k * a_col];
+      const Real *b = Bdata + k * b_row;
+      for (MatrixIndexT j = 0; j < num_cols; j++)
+        row[j] += a * b[j * b_col];
+    }
+  }
+}
+
+// Products with num_rows * num_cols * inner_dim up to this are done by
+// Xgemm_small().  (Measured with OpenBLAS: about 3 times faster for 2x2 and
+// 3x3 matrices, and about equal at 4x4.)
+const int64 kSmallGemmSize = 64;
+
 inline void cblas_Xgemm(const float alpha,
                         MatrixTransposeType transA,
                         const float *Adata,
@@ -217,9 +252,15 @@ inline void cblas_Xgemm(const float alpha,
                         const float beta,
                         float *Mdata, 
                         MatrixIndexT num_rows, MatrixIndexT num_cols,MatrixIndexT stride) {
+  MatrixIndexT inner_dim = (transA == kNoTrans ? a_num_cols : a_num_rows);
+  if (static_cast<int64>(num_rows) * num_cols * inner_dim <= kSmallGemmSize) {
+    Xgemm_small(alpha, transA, Adata, a_stride, transB, Bdata, b_stride, beta,
+                Mdata, num_rows, num_cols, inner_dim, stride);
+    return;
+  }
   cblas_sgemm(CblasRowMajor, static_cast<CBLAS_TRANSPOSE>(transA), 
               static_cast<CBLAS_TRANSPOSE>(transB),
-              num_rows, num_cols, transA == kNoTrans ? a_num_cols : a_num_rows,
+              num_rows, num_cols, inner_dim,
               alpha, Adata, a_stride, Bdata, b_stride,
               beta, Mdata, stride); 
 }
@@ -232,9 +273,15 @@ inline void cblas_Xgemm(const double alpha,
                         const double beta,
                         double *Mdata, 
                         MatrixIndexT num_rows, MatrixIndexT num_cols,MatrixIndexT stride) {
+  MatrixIndexT inner_dim = (transA == kNoTrans ? a_num_cols : a_num_rows);
+  if (static_cast<int64>(num_rows) * num_cols * inner_dim <= kSmallGemmSize) {
+    Xgemm_small(alpha, transA, Adata, a_stride, transB, Bdata, b_stride, beta,
+                Mdata, num_rows, num_cols, inner_dim, stride);
+    return;
+  }
   cblas_dgemm(CblasRowMajor, static_cast<CBLAS_TRANSPOSE>(transA), 
               static_cast<CBLAS_TRANSPOSE>(transB),
-              num_rows, num_cols, transA == kNoTrans ? a_num_cols : a_num_rows,
+              num_rows, num_cols, inner_dim,
               alpha, Adata, a_stride, Bdata, b_stride,
               beta, Mdata, stride); 
 }
@@ -350,20 +397,7 @@ inline void mul_elements(
     const MatrixIndexT dim,
     const float *a,
     float *b) { // does b *= a, elementwise.
-  float c1, c2, c3, c4;
-  MatrixIndexT i;
-  for (i = 0; i + 4 <= dim; i += 4) {
-    c1 = a[i] * b[i];
-    c2 = a[i+1] * b[i+1];
-    c3 = a[i+2] * b[i+2];
-    c4 = a[i+3] * b[i+3];
-    b[i] = c1;
-    b[i+1] = c2;
-    b[i+2] = c3;
-    b[i+3] = c4;
-  }
-  for (; i < dim; i++)
-    b[i] *= a[i];
+  GetSimdKernels().mul_elements(a, b, dim);
 }
 
 
@@ -0,0 +1,68 @@
+// matrix/compressed-matrix-bench.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include "matrix/compressed-matrix.h"
+#include "util/kaldi-bench.h"
+
+namespace kaldi {
+
+struct CompressBench {
+  explicit CompressBench(const Matrix<BaseFloat> &mat): mat_(mat) { }
+  void operator() () { cmat_.CopyFromMat(mat_); }
+  const Matrix<BaseFloat> &mat_;
+  CompressedMatrix cmat_;
+};
+
+struct UncompressBench {
+  explicit UncompressBench(const Matrix<BaseFloat> &mat):
+      cmat_(mat), mat_(mat.NumRows(), mat.NumCols()) { }
+  void operator() () { cmat_.CopyToMat(&mat_); }
+  CompressedMatrix cmat_;
+  Matrix<BaseFloat> mat_;
+};
+
+// Times the round-trip through CompressedMatrix at typical feature-matrix
+// shapes.
+void CompressedMatrixBench(int32 num_rows, int32 num_cols) {
+  Matrix<BaseFloat> mat(num_rows, num_cols);
+  mat.SetRandn();
+  std::ostringstream params;
+  params << "rows=" << num_rows << " cols=" << num_cols;
+  double num_elements = num_rows * static_cast<double>(num_cols);
+  CompressBench compress_bench(mat);
+  PrintBenchmarkResult("CompressedMatrix::CopyFromMat", params.str(),
+                       TimeBenchmark(compress_bench), num_elements,
+                       "elements");
+  UncompressBench uncompress_bench(mat);
+  PrintBenchmarkResult("CompressedMatrix::CopyToMat", params.str(),
+                       TimeBenchmark(uncompress_bench), num_elements,
+                       "elements");
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  srand(0);
+  CompressedMatrixBench(1000, 13);
+  CompressedMatrixBench(1000, 40);
+  CompressedMatrixBench(10000, 440);
+  return 0;
+}
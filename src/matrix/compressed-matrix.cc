@@ -20,6 +20,9 @@
 
 #include "matrix/compressed-matrix.h"
 #include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace kaldi {
 
@@ -243,6 +246,53 @@ inline float CompressedMatrix::CharToFloat(
 }
 
 
+// static
+void CompressedMatrix::UncompressColumn(const GlobalHeader &global_header,
+                                        const PerColHeader &header,
+                                        const unsigned char *byte_data,
+                                        int32 num_rows, float *out) {
+  float p0 = Uint16ToFloat(global_header, header.percentile_0),
+      p25 = Uint16ToFloat(global_header, header.percentile_25),
+      p75 = Uint16ToFloat(global_header, header.percentile_75),
+      p100 = Uint16ToFloat(global_header, header.percentile_100);
+  int32 i = 0;
+#ifdef __SSE2__
+  // We do 16 values at a time.  The piecewise linear function of CharToFloat()
+  // is computed without branches, as
+  //  p0 + s1 * min(v, 64) + s2 * max(min(v, 192) - 64, 0) + s3 * max(v - 192, 0),
+  // which gives the same value up to roundoff.
+  __m128 offset = _mm_set1_ps(p0),
+      scale1 = _mm_set1_ps((p25 - p0) * (1/64.0)),
+      scale2 = _mm_set1_ps((p75 - p25) * (1/128.0)),
+      scale3 = _mm_set1_ps((p100 - p75) * (1/63.0)),
+      c64 = _mm_set1_ps(64.0), c192 = _mm_set1_ps(192.0),
+      zero = _mm_setzero_ps();
+  __m128i zeroi = _mm_setzero_si128();
+  for (; i + 16 <= num_rows; i += 16) {
+    __m128i bytes = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(byte_data + i));
+    __m128i lo = _mm_unpacklo_epi8(bytes, zeroi),
+        hi = _mm_unpackhi_epi8(bytes, zeroi);
+    __m128i ints[4] = { _mm_unpacklo_epi16(lo, zeroi),
+                        _mm_unpackhi_epi16(lo, zeroi),
+                        _mm_unpacklo_epi16(hi, zeroi),
+                        _mm_unpackhi_epi16(hi, zeroi) };
+    for (int32 k = 0; k < 4; k++) {
+      __m128 v = _mm_cvtepi32_ps(ints[k]);
+      __m128 f = _mm_add_ps(offset, _mm_mul_ps(scale1, _mm_min_ps(v, c64)));
+      f = _mm_add_ps(f, _mm_mul_ps(scale2, _mm_max_ps(
+          _mm_sub_ps(_mm_min_ps(v, c192), c64), zero)));
+      f = _mm_add_ps(f, _mm_mul_ps(scale3, _mm_max_ps(_mm_sub_ps(v, c192),
+                                                      zero)));
+      _mm_storeu_ps(out + i + 4 * k, f);
+    }
+  }
+#endif
+  for (; i < num_rows; i++)
+    out[i] = CharToFloat(p0, p25, p75, p100, byte_data[i]);
+}
+
+
 template<typename Real>  // static
 void CompressedMatrix::CompressColumn(
     const GlobalHeader &global_header,
@@ -410,15 +460,14 @@ void CompressedMatrix::CopyToMat(MatrixBase<Real> *mat) const {
     int32 num_cols = h->num_cols, num_rows = h->num_rows;
     KALDI_ASSERT(mat->NumRows() == num_rows);
     KALDI_ASSERT(mat->NumCols() == num_cols);
-    for (int32 i = 0; i < num_cols; i++, per_col_header++) {
-      float p0 = Uint16ToFloat(*h, per_col_header->percentile_0),
-          p25 = Uint16ToFloat(*h, per_col_header->percentile_25),
-          p75 = Uint16ToFloat(*h, per_col_header->percentile_75),
-          p100 = Uint16ToFloat(*h, per_col_header->percentile_100);
-      for (int32 j = 0; j < num_rows; j++, byte_data++) {
-        float f = CharToFloat(p0, p25, p75, p100, *byte_data);
-        (*mat)(j, i) = f;
-      }
+    MatrixIndexT stride = mat->Stride();
+    std::vector<float> col(num_rows);
+    for (int32 i = 0; i < num_cols; i++, per_col_header++,
+             byte_data += num_rows) {
+      UncompressColumn(*h, *per_col_header, byte_data, num_rows, &(col[0]));
+      Real *dest = mat->Data() + i;
+      for (int32 j = 0; j < num_rows; j++)
+        dest[j * stride] = col[j];
     }
   }
 }
@@ -464,14 +513,10 @@ void CompressedMatrix::CopyColToVec(MatrixIndexT col,
                                                               h->num_cols);
   byte_data += col*h->num_rows;  // point to first value in the column we want
   per_col_header += col;
-  float p0 = Uint16ToFloat(*h, per_col_header->percentile_0),
-        p25 = Uint16ToFloat(*h, per_col_header->percentile_25),
-        p75 = Uint16ToFloat(*h, per_col_header->percentile_75),
-        p100 = Uint16ToFloat(*h, per_col_header->percentile_100);
-  for (int32 i = 0; i < h->num_rows; i++, byte_data++) {
-    float f = CharToFloat(p0, p25, p75, p100, *byte_data);
-    (*v)(i) = f;
-  }
+  std::vector<float> temp(h->num_rows);
+  UncompressColumn(*h, *per_col_header, byte_data, h->num_rows, &(temp[0]));
+  for (int32 i = 0; i < h->num_rows; i++)
+    (*v)(i) = temp[i];
 }
 
 // instantiate the templates.
@@ -492,8 +537,8 @@ void CompressedMatrix::CopyToMat(int32 row_offset,
   KALDI_PARANOID_ASSERT(column_offset < this->NumCols());
   KALDI_PARANOID_ASSERT(row_offset >= 0);
   KALDI_PARANOID_ASSERT(column_offset >= 0);
-  KALDI_ASSERT(row_offset+dest->NumRows() < this->NumRows());
-  KALDI_ASSERT(column_offset+dest->NumCols() < this->NumCols());
+  KALDI_ASSERT(row_offset+dest->NumRows() <= this->NumRows());
+  KALDI_ASSERT(column_offset+dest->NumCols() <= this->NumCols());
   // everything is OK
   GlobalHeader *h = reinterpret_cast<GlobalHeader*>(data_);
   PerColHeader *per_col_header = reinterpret_cast<PerColHeader*>(h+1);
@@ -508,18 +553,17 @@ void CompressedMatrix::CopyToMat(int32 row_offset,
 
   per_col_header += column_offset;  // skip the appropriate number of headers
 
+  MatrixIndexT stride = dest->Stride();
+  std::vector<float> col(tgt_rows);
   for (int32 i = 0;
        i < tgt_cols;
        i++, per_col_header++, start_of_subcol+=num_rows) {
-    byte_data = start_of_subcol;
-    float p0 = Uint16ToFloat(*h, per_col_header->percentile_0),
-          p25 = Uint16ToFloat(*h, per_col_header->percentile_25),
-          p75 = Uint16ToFloat(*h, per_col_header->percentile_75),
-          p100 = Uint16ToFloat(*h, per_col_header->percentile_100);
-    for (int32 j = 0; j < tgt_rows; j++, byte_data++) {
-      float f = CharToFloat(p0, p25, p75, p100, *byte_data);
-      (*dest)(j, i) = f;
-    }
+    if (tgt_rows == 0) break;
+    UncompressColumn(*h, *per_col_header, start_of_subcol, tgt_rows,
+                     &(col[0]));
+    Real *dest_data = dest->Data() + i;
+    for (int32 j = 0; j < tgt_rows; j++)
+      dest_data[j * stride] = col[j];
   }
 }
 
@@ -554,5 +598,272 @@ CompressedMatrix &CompressedMatrix::operator = (const CompressedMatrix &mat) {
   return *this;
 }
 
+
+
+int32 RowCompressedMatrix::NumBlocks(const GlobalHeader &header) {
+  int32 rows_per_block = header.rows_per_block,
+      num_blocks = header.num_rows / rows_per_block,
+      remainder = header.num_rows % rows_per_block;
+  if (num_blocks == 0 || remainder >= rows_per_block / 4)
+    num_blocks++;
+  return num_blocks;
+}
+
+int32 RowCompressedMatrix::BlockRows(const GlobalHeader &header, int32 b) {
+  if (b + 1 < NumBlocks(header))
+    return header.rows_per_block;
+  else
+    return header.num_rows - b * header.rows_per_block;
+}
+
+MatrixIndexT RowCompressedMatrix::DataSize(const GlobalHeader &header) {
+  int32 num_blocks = NumBlocks(header);
+  return sizeof(GlobalHeader) +
+      (num_blocks - 1) * BlockSize(header.rows_per_block, header.num_cols) +
+      BlockSize(BlockRows(header, num_blocks - 1), header.num_cols);
+}
+
+const char *RowCompressedMatrix::Block(int32 b) const {
+  const GlobalHeader &h = *reinterpret_cast<const GlobalHeader*>(data_);
+  return static_cast<const char*>(data_) + sizeof(GlobalHeader) +
+      b * BlockSize(h.rows_per_block, h.num_cols);
+}
+
+template<typename Real>
+void RowCompressedMatrix::CopyFromMat(const MatrixBase<Real> &mat) {
+  Destroy();
+  if (mat.NumRows() == 0) return;  // Zero-size matrix stored as zero pointer.
+  GlobalHeader h;
+  KALDI_COMPILE_TIME_ASSERT(sizeof(h) == 16);
+  h.num_rows = mat.NumRows();
+  h.num_cols = mat.NumCols();
+  h.rows_per_block = kRowsPerBlock;
+  h.reserved = 0;
+  data_ = CompressedMatrix::AllocateData(DataSize(h));
+  *reinterpret_cast<GlobalHeader*>(data_) = h;
+  int32 num_cols = h.num_cols;
+  int32 num_blocks = NumBlocks(h);
+  for (int32 b = 0; b < num_blocks; b++) {
+    int32 block_rows = BlockRows(h, b);
+    // Compress the block as a CompressedMatrix, then copy its headers and
+    // transpose its bytes.
+    CompressedMatrix cmat(SubMatrix<Real>(mat, b * kRowsPerBlock, block_rows,
+                                          0, num_cols));
+    const char *src = static_cast<const char*>(cmat.data_);
+    char *dest = const_cast<char*>(Block(b));
+    MatrixIndexT headers_size = sizeof(CompressedMatrix::GlobalHeader) +
+        num_cols * sizeof(CompressedMatrix::PerColHeader);
+    memcpy(dest, src, headers_size);
+    const unsigned char *src_bytes =
+        reinterpret_cast<const unsigned char*>(src + headers_size);
+    unsigned char *dest_bytes =
+        reinterpret_cast<unsigned char*>(dest + headers_size);
+    for (int32 c = 0; c < num_cols; c++)
+      for (int32 r = 0; r < block_rows; r++)
+        dest_bytes[r * num_cols + c] = src_bytes[c * block_rows + r];
+  }
+}
+
+template
+void RowCompressedMatrix::CopyFromMat(const MatrixBase<float> &mat);
+template
+void RowCompressedMatrix::CopyFromMat(const MatrixBase<double> &mat);
+
+template<typename Real>
+void RowCompressedMatrix::UncompressBlockRows(int32 b, int32 begin,
+                                              int32 end,
+                                              MatrixIndexT dest_row,
+                                              MatrixBase<Real> *dest) const {
+  const char *block = Block(b);
+  const CompressedMatrix::GlobalHeader &block_header =
+      *reinterpret_cast<const CompressedMatrix::GlobalHeader*>(block);
+  const CompressedMatrix::PerColHeader *col_headers =
+      reinterpret_cast<const CompressedMatrix::PerColHeader*>(
+          &block_header + 1);
+  int32 num_cols = block_header.num_cols;
+  const unsigned char *byte_data =
+      reinterpret_cast<const unsigned char*>(col_headers + num_cols);
+  // For each column, the piecewise linear function of
+  // CompressedMatrix::CharToFloat() as
+  //  p0 + s1 * min(v, 64) + s2 * max(min(v, 192) - 64, 0) + s3 * max(v - 192, 0),
+  // which we can compute across columns without branches.
+  std::vector<float> offset(num_cols), scale1(num_cols), scale2(num_cols),
+      scale3(num_cols), row(num_cols);
+  for (int32 c = 0; c < num_cols; c++) {
+    float p0 = CompressedMatrix::Uint16ToFloat(block_header,
+                                               col_headers[c].percentile_0),
+        p25 = CompressedMatrix::Uint16ToFloat(block_header,
+                                              col_headers[c].percentile_25),
+        p75 = CompressedMatrix::Uint16ToFloat(block_header,
+                                              col_headers[c].percentile_75),
+        p100 = CompressedMatrix::Uint16ToFloat(block_header,
+                                               col_headers[c].percentile_100);
+    offset[c] = p0;
+    scale1[c] = (p25 - p0) * (1/64.0);
+    scale2[c] = (p75 - p25) * (1/128.0);
+    scale3[c] = (p100 - p75) * (1/63.0);
+  }
+  for (int32 r = begin; r < end; r++, dest_row++) {
+    const unsigned char *bytes = byte_data + r * num_cols;
+    int32 c = 0;
+#ifdef __SSE2__
+    __m128 c64 = _mm_set1_ps(64.0), c192 = _mm_set1_ps(192.0),
+        zero = _mm_setzero_ps();
+    __m128i zeroi = _mm_setzero_si128();
+    for (; c + 4 <= num_cols; c += 4) {
+      int32 four_bytes;
+      memcpy(&four_bytes, bytes + c, 4);
+      __m128i ints = _mm_unpacklo_epi16(
+          _mm_unpacklo_epi8(_mm_cvtsi32_si128(four_bytes), zeroi), zeroi);
+      __m128 v = _mm_cvtepi32_ps(ints);
+      __m128 f = _mm_add_ps(_mm_loadu_ps(&(offset[c])),
+                            _mm_mul_ps(_mm_loadu_ps(&(scale1[c])),
+                                       _mm_min_ps(v, c64)));
+      f = _mm_add_ps(f, _mm_mul_ps(_mm_loadu_ps(&(scale2[c])), _mm_max_ps(
+          _mm_sub_ps(_mm_min_ps(v, c192), c64), zero)));
+      f = _mm_add_ps(f, _mm_mul_ps(_mm_loadu_ps(&(scale3[c])),
+                                   _mm_max_ps(_mm_sub_ps(v, c192), zero)));
+      _mm_storeu_ps(&(row[c]), f);
+    }
+#endif
+    for (; c < num_cols; c++) {
+      float v = bytes[c];
+      row[c] = offset[c] + scale1[c] * std::min(v, 64.0f) +
+          scale2[c] * std::max(std::min(v, 192.0f) - 64.0f, 0.0f) +
+          scale3[c] * std::max(v - 192.0f, 0.0f);
+    }
+    Real *dest_data = dest->RowData(dest_row);
+    for (c = 0; c < num_cols; c++)
+      dest_data[c] = row[c];
+  }
+}
+
+template<typename Real>
+void RowCompressedMatrix::CopyRowsToMat(MatrixIndexT row_offset,
+                                        MatrixBase<Real> *dest) const {
+  KALDI_ASSERT(row_offset >= 0 &&
+               row_offset + dest->NumRows() <= NumRows() &&
+               dest->NumCols() == NumCols());
+  if (dest->NumRows() == 0) return;
+  const GlobalHeader &h = *reinterpret_cast<const GlobalHeader*>(data_);
+  int32 rows_per_block = h.rows_per_block,
+      end_row = row_offset + dest->NumRows();
+  int32 num_blocks = NumBlocks(h);
+  for (int32 b = std::min(row_offset / rows_per_block, num_blocks - 1);
+       b < num_blocks && b * rows_per_block < end_row; b++) {
+    int32 block_start = b * rows_per_block,
+        begin = std::max(row_offset, block_start),
+        end = std::min(end_row, block_start + BlockRows(h, b));
+    UncompressBlockRows(b, begin - block_start, end - block_start,
+                        begin - row_offset, dest);
+  }
+}
+
+template<typename Real>
+void RowCompressedMatrix::CopyToMat(MatrixBase<Real> *mat) const {
+  KALDI_ASSERT(mat->NumRows() == NumRows() && mat->NumCols() == NumCols());
+  CopyRowsToMat(0, mat);
+}
+
+template<typename Real>
+void RowCompressedMatrix::CopyRowToVec(MatrixIndexT row,
+                                       VectorBase<Real> *v) const {
+  KALDI_ASSERT(v->Dim() == NumCols());
+  SubMatrix<Real> dest(v->Data(), 1, v->Dim(), v->Dim());
+  CopyRowsToMat(row, &dest);
+}
+
+template
+void RowCompressedMatrix::CopyRowsToMat(MatrixIndexT row_offset,
+                                        MatrixBase<float> *dest) const;
+template
+void RowCompressedMatrix::CopyRowsToMat(MatrixIndexT row_offset,
+                                        MatrixBase<double> *dest) const;
+template
+void RowCompressedMatrix::CopyToMat(MatrixBase<float> *mat) const;
+template
+void RowCompressedMatrix::CopyToMat(MatrixBase<double> *mat) const;
+template
+void RowCompressedMatrix::CopyRowToVec(MatrixIndexT row,
+                                       VectorBase<float> *v) const;
+template
+void RowCompressedMatrix::CopyRowToVec(MatrixIndexT row,
+                                       VectorBase<double> *v) const;
+
+void RowCompressedMatrix::Write(std::ostream &os, bool binary) const {
+  if (binary) {
+    WriteToken(os, binary, "RCM");
+    if (data_ != NULL) {
+      const GlobalHeader &h = *reinterpret_cast<const GlobalHeader*>(data_);
+      os.write(static_cast<const char*>(data_), DataSize(h));
+    } else {  // an empty matrix.
+      GlobalHeader h;
+      h.num_rows = h.num_cols = h.reserved = 0;
+      h.rows_per_block = kRowsPerBlock;
+      os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    }
+  } else {
+    // In text mode, just use the same format as a regular matrix.
+    Matrix<BaseFloat> temp_mat(NumRows(), NumCols(), kUndefined);
+    CopyToMat(&temp_mat);
+    temp_mat.Write(os, binary);
+  }
+  if (os.fail())
+    KALDI_ERR << "Error writing compressed matrix to stream.";
+}
+
+void RowCompressedMatrix::Read(std::istream &is, bool binary) {
+  Destroy();
+  if (binary && Peek(is, binary) == 'R') {
+    ExpectToken(is, binary, "RCM");
+    GlobalHeader h;
+    is.read(reinterpret_cast<char*>(&h), sizeof(h));
+    if (is.fail())
+      KALDI_ERR << "Failed to read header";
+    if (h.num_rows == 0) return;  // empty matrix.
+    if (h.num_rows < 0 || h.num_cols <= 0 || h.rows_per_block <= 0)
+      KALDI_ERR << "Invalid header for row-compressed matrix: "
+                << h.num_rows << ", " << h.num_cols << ", "
+                << h.rows_per_block;
+    MatrixIndexT size = DataSize(h);
+    data_ = CompressedMatrix::AllocateData(size);
+    *reinterpret_cast<GlobalHeader*>(data_) = h;
+    is.read(static_cast<char*>(data_) + sizeof(GlobalHeader),
+            size - sizeof(GlobalHeader));
+    if (is.fail())
+      KALDI_ERR << "Failed to read data.";
+  } else {
+    // Read as a regular Matrix (which also handles CompressedMatrix), and
+    // compress it.
+    Matrix<BaseFloat> temp;
+    temp.Read(is, binary);
+    CopyFromMat(temp);
+  }
+}
+
+void RowCompressedMatrix::Destroy() {
+  if (data_ != NULL) {
+    delete [] static_cast<float*>(data_);
+    data_ = NULL;
+  }
+}
+
+RowCompressedMatrix::RowCompressedMatrix(const RowCompressedMatrix &mat):
+    data_(NULL) {
+  *this = mat; // use assignment operator.
+}
+
+RowCompressedMatrix &RowCompressedMatrix::operator = (
+    const RowCompressedMatrix &mat) {
+  if (&mat == this) return *this;
+  Destroy();
+  if (mat.data_ != NULL) {
+    MatrixIndexT size = DataSize(*static_cast<GlobalHeader*>(mat.data_));
+    data_ = CompressedMatrix::AllocateData(size);
+    memcpy(data_, mat.data_, size);
+  }
+  return *this;
+}
+
 }  // namespace kaldi
 
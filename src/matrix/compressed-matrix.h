@@ -100,6 +100,8 @@ class CompressedMatrix {
   
   friend class Matrix<float>;
   friend class Matrix<double>;
+  template<typename Real> friend class CuMatrixBase;  // for CopyFromMat().
+  friend class RowCompressedMatrix;
  private:
 
   // allocates data using new [], ensures byte alignment
@@ -147,6 +149,13 @@ class CompressedMatrix {
   static inline float CharToFloat(float p0, float p25,
                                   float p75, float p100,
                                   unsigned char value);
+
+  // Uncompresses "num_rows" consecutive bytes of a column, starting at
+  // "byte_data", into "out".
+  static void UncompressColumn(const GlobalHeader &global_header,
+                               const PerColHeader &header,
+                               const unsigned char *byte_data,
+                               int32 num_rows, float *out);
   
   void Destroy();
   
@@ -157,6 +166,111 @@ class CompressedMatrix {
 };
 
 
+/// RowCompressedMatrix is a second compressed format, for when you want to
+/// get at ranges of rows (e.g. chunks of frames of an utterance) without
+/// uncompressing the whole matrix.  The rows are divided into blocks of
+/// kRowsPerBlock rows, and each block is compressed as in CompressedMatrix;
+/// that is, with its own range and per-column percentiles, but the bytes are
+/// stored row by row, so a range of rows is uncompressed by reading only its
+/// blocks' headers and a contiguous range of bytes.  The headers cost about
+/// 8 / kRowsPerBlock bytes per element, on top of the one byte per element,
+/// and the compression is slightly more accurate than CompressedMatrix since
+/// the ranges are more local.
+/// In a binary archive it is written with the token "RCM", and it may be
+/// read as an ordinary Matrix.
+class RowCompressedMatrix {
+ public:
+  static const int32 kRowsPerBlock = 32;
+
+  RowCompressedMatrix(): data_(NULL) { }
+
+  ~RowCompressedMatrix() { Destroy(); }
+
+  template<typename Real>
+  explicit RowCompressedMatrix(const MatrixBase<Real> &mat): data_(NULL) {
+    CopyFromMat(mat);
+  }
+
+  RowCompressedMatrix(const RowCompressedMatrix &mat);
+
+  RowCompressedMatrix &operator = (const RowCompressedMatrix &mat);
+
+  /// This will resize *this and copy the contents of mat to *this.
+  template<typename Real>
+  void CopyFromMat(const MatrixBase<Real> &mat);
+
+  /// Note: mat must have the correct size.
+  template<typename Real>
+  void CopyToMat(MatrixBase<Real> *mat) const;
+
+  /// Uncompresses the rows row_offset ... row_offset + dest->NumRows() - 1
+  /// into "dest", which must have NumCols() columns.  Only the blocks of rows
+  /// that overlap this range are read.
+  template<typename Real>
+  void CopyRowsToMat(MatrixIndexT row_offset, MatrixBase<Real> *dest) const;
+
+  /// Copies row #row of the matrix into vector v, which must have NumCols()
+  /// elements.
+  template<typename Real>
+  void CopyRowToVec(MatrixIndexT row, VectorBase<Real> *v) const;
+
+  void Write(std::ostream &os, bool binary) const;
+
+  /// Reads the "RCM" format; in binary mode it will also read an ordinary
+  /// (or CompressedMatrix) matrix and compress it.
+  void Read(std::istream &is, bool binary);
+
+  inline MatrixIndexT NumRows() const { return (data_ == NULL) ? 0 :
+      reinterpret_cast<GlobalHeader*>(data_)->num_rows; }
+
+  inline MatrixIndexT NumCols() const { return (data_ == NULL) ? 0 :
+      reinterpret_cast<GlobalHeader*>(data_)->num_cols; }
+
+  void Swap(RowCompressedMatrix *other) { std::swap(data_, other->data_); }
+
+ private:
+  struct GlobalHeader {
+    int32 num_rows;
+    int32 num_cols;
+    int32 rows_per_block;  // kRowsPerBlock when written; stored as a check.
+    int32 reserved;
+  };
+  // After the GlobalHeader come the blocks, in order.  Every block but the
+  // last has rows_per_block rows; each one is a CompressedMatrix::GlobalHeader
+  // for the block, then its num_cols CompressedMatrix::PerColHeaders, then its
+  // bytes, row by row.  A remainder of fewer than rows_per_block / 4 rows is
+  // added to the last full block rather than getting a block of its own,
+  // because CompressedMatrix is inaccurate for very few rows.
+
+  static int32 NumBlocks(const GlobalHeader &header);
+
+  // Returns the number of rows in block b.
+  static int32 BlockRows(const GlobalHeader &header, int32 b);
+
+  static MatrixIndexT BlockSize(int32 num_rows, int32 num_cols) {
+    return sizeof(CompressedMatrix::GlobalHeader) +
+        num_cols * (sizeof(CompressedMatrix::PerColHeader) + num_rows);
+  }
+
+  static MatrixIndexT DataSize(const GlobalHeader &header);
+
+  // Returns the address of block b (the one containing row
+  // b * rows_per_block).
+  const char *Block(int32 b) const;
+
+  // Uncompresses rows [begin, end) of block b into dest, starting at its row
+  // dest_row.
+  template<typename Real>
+  void UncompressBlockRows(int32 b, int32 begin, int32 end,
+                           MatrixIndexT dest_row,
+                           MatrixBase<Real> *dest) const;
+
+  void Destroy();
+
+  void *data_;  // The GlobalHeader and the blocks, or NULL if empty.
+};
+
+
 /// @} end of \addtogroup matrix_group
 
 
@@ -0,0 +1,99 @@
+// matrix/fast-exp-bench.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include "matrix/kaldi-vector.h"
+#include "util/kaldi-bench.h"
+
+namespace kaldi {
+
+struct LogAddBench {
+  LogAddBench(const std::vector<double> &x, bool fast):
+      x_(x), fast_(fast), sum_(0.0) { }
+  void operator() () {
+    double sum = kLogZeroDouble;
+    if (fast_)
+      for (size_t i = 0; i < x_.size(); i++) sum = LogAddFast(sum, x_[i]);
+    else
+      for (size_t i = 0; i < x_.size(); i++) sum = LogAdd(sum, x_[i]);
+    sum_ += sum;  // so the loop is not optimized away.
+  }
+  const std::vector<double> &x_;
+  bool fast_;
+  double sum_;
+};
+
+struct LogSumExpBench {
+  explicit LogSumExpBench(const Vector<BaseFloat> &v): v_(v), sum_(0.0) { }
+  void operator() () { sum_ += v_.LogSumExp(); }
+  const Vector<BaseFloat> &v_;
+  double sum_;
+};
+
+struct SoftMaxBench {
+  explicit SoftMaxBench(const Vector<BaseFloat> &v): v_(v), w_(v.Dim()) { }
+  void operator() () { w_.CopyFromVec(v_); w_.ApplySoftMax(); }
+  const Vector<BaseFloat> &v_;
+  Vector<BaseFloat> w_;
+};
+
+// Compares LogAdd() with LogAddFast(), in the way it is used when summing
+// over lattice arcs.
+void LogAddBenchmark() {
+  std::vector<double> x(10000);
+  for (size_t i = 0; i < x.size(); i++) x[i] = -10.0 * RandUniform();
+  for (int32 fast = 0; fast < 2; fast++) {
+    LogAddBench bench(x, fast != 0);
+    PrintBenchmarkResult(fast ? "LogAddFast" : "LogAdd", "n=10000",
+                         TimeBenchmark(bench), x.size(), "calls");
+  }
+}
+
+// Compares LogSumExp() and ApplySoftMax() with and without
+// g_kaldi_fast_math, at typical numbers of Gaussians or pdfs.
+void SoftMaxBenchmark(int32 dim) {
+  Vector<BaseFloat> v(dim);
+  v.SetRandn();
+  v.Scale(2.0);
+  std::ostringstream params;
+  params << "dim=" << dim;
+  for (int32 fast = 0; fast < 2; fast++) {
+    g_kaldi_fast_math = (fast != 0);
+    std::string suffix = (fast ? " [fast-math]" : "");
+    LogSumExpBench log_sum_exp_bench(v);
+    PrintBenchmarkResult("VectorBase::LogSumExp" + suffix, params.str(),
+                         TimeBenchmark(log_sum_exp_bench), dim, "elements");
+    SoftMaxBench soft_max_bench(v);
+    PrintBenchmarkResult("VectorBase::ApplySoftMax" + suffix, params.str(),
+                         TimeBenchmark(soft_max_bench), dim, "elements");
+  }
+  g_kaldi_fast_math = false;
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  srand(0);
+  LogAddBenchmark();
+  SoftMaxBenchmark(64);
+  SoftMaxBenchmark(1000);
+  SoftMaxBenchmark(10000);
+  return 0;
+}
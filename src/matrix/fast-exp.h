@@ -0,0 +1,130 @@
+// matrix/fast-exp.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_FAST_EXP_H_
+#define KALDI_MATRIX_FAST_EXP_H_
+
+#include "base/kaldi-common.h"
+#include "matrix/matrix-common.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace kaldi {
+
+// This header contains the vectorized exp() used by LogSumExp() and
+// ApplySoftMax() of VectorBase<float> and MatrixBase<float> when
+// g_kaldi_fast_math is true.  It is the polynomial approximation of the Cephes
+// library: exp(x) = 2^n exp(r) with n = round(x / log(2)), and exp(r) for
+// |r| <= log(2)/2 approximated by a polynomial of degree 7.  Its relative
+// error is below 2e-7; inputs below -87.3 give exactly zero.  Without SSE2,
+// the functions below just call Exp().
+
+#ifdef __SSE2__
+static inline __m128 ExpApprox(__m128 x) {
+  const __m128 one = _mm_set1_ps(1.0f),
+      min_x = _mm_set1_ps(-87.3365447505531f),
+      max_x = _mm_set1_ps(88.3762626647949f);
+  __m128 valid = _mm_cmpge_ps(x, min_x);  // Inputs below min_x give zero.
+  x = _mm_max_ps(_mm_min_ps(x, max_x), min_x);
+  // n = floor(x / log(2) + 0.5).
+  __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)),
+                         _mm_set1_ps(0.5f));
+  __m128 tx = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));  // Rounds towards zero.
+  fx = _mm_sub_ps(tx, _mm_and_ps(_mm_cmpgt_ps(tx, fx), one));
+  // r = x - n log(2), with log(2) split into two parts for accuracy.
+  x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(0.693359375f)));
+  x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(-2.12194440e-4f)));
+  __m128 y = _mm_set1_ps(1.9875691500e-4f);
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507e-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073e-3f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894e-2f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201e-1f));
+  y = _mm_add_ps(_mm_mul_ps(y, _mm_mul_ps(x, x)), _mm_add_ps(x, one));
+  // Multiply by 2^n, by putting n + 127 in the exponent bits.
+  __m128i n = _mm_add_epi32(_mm_cvttps_epi32(fx), _mm_set1_epi32(127));
+  __m128 pow2n = _mm_castsi128_ps(_mm_slli_epi32(n, 23));
+  return _mm_and_ps(_mm_mul_ps(y, pow2n), valid);
+}
+
+// Returns the sum of the four elements of v, in double precision.
+static inline double HorizontalSum(__m128 v) {
+  float parts[4];
+  _mm_storeu_ps(parts, v);
+  return (static_cast<double>(parts[0]) + parts[1]) +
+      (static_cast<double>(parts[2]) + parts[3]);
+}
+#endif
+
+/// Returns the sum over i = 0 ... n-1 with x[i] >= cutoff, of
+/// exp(x[i] - offset).
+inline double SumExpApprox(const float *x, MatrixIndexT n, float offset,
+                           float cutoff) {
+  double sum = 0.0;
+  MatrixIndexT i = 0;
+#ifdef __SSE2__
+  __m128 offset4 = _mm_set1_ps(offset), cutoff4 = _mm_set1_ps(cutoff);
+  while (i + 4 <= n) {
+    // We add up at most 256 elements in single precision, to limit the
+    // roundoff, before adding to "sum".
+    MatrixIndexT block_end = std::min(n, i + 256);
+    __m128 block_sum = _mm_setzero_ps();
+    for (; i + 4 <= block_end; i += 4) {
+      __m128 v = _mm_loadu_ps(x + i), mask = _mm_cmpge_ps(v, cutoff4);
+      if (_mm_movemask_ps(mask) == 0)
+        continue;  // All four are pruned.
+      __m128 e = ExpApprox(_mm_sub_ps(v, offset4));
+      block_sum = _mm_add_ps(block_sum, _mm_and_ps(e, mask));
+    }
+    sum += HorizontalSum(block_sum);
+  }
+#endif
+  for (; i < n; i++)
+    if (x[i] >= cutoff)
+      sum += Exp(x[i] - offset);
+  return sum;
+}
+
+/// Sets x[i] = exp(x[i] - offset) for i = 0 ... n-1, and returns the sum of
+/// the new values.
+inline double ExpApproxInPlace(float *x, MatrixIndexT n, float offset) {
+  double sum = 0.0;
+  MatrixIndexT i = 0;
+#ifdef __SSE2__
+  __m128 offset4 = _mm_set1_ps(offset);
+  while (i + 4 <= n) {
+    MatrixIndexT block_end = std::min(n, i + 256);
+    __m128 block_sum = _mm_setzero_ps();
+    for (; i + 4 <= block_end; i += 4) {
+      __m128 e = ExpApprox(_mm_sub_ps(_mm_loadu_ps(x + i), offset4));
+      _mm_storeu_ps(x + i, e);
+      block_sum = _mm_add_ps(block_sum, e);
+    }
+    sum += HorizontalSum(block_sum);
+  }
+#endif
+  for (; i < n; i++)
+    sum += (x[i] = Exp(x[i] - offset));
+  return sum;
+}
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_FAST_EXP_H_
@@ -21,10 +21,12 @@
 // limitations under the License.
 
 #include "matrix/kaldi-matrix.h"
+#include "matrix/matrix-allocator.h"
 #include "matrix/sp-matrix.h"
 #include "matrix/jama-svd.h"
 #include "matrix/jama-eig.h"
 #include "matrix/compressed-matrix.h"
+#include "matrix/fast-exp.h"
 
 namespace kaldi {
 
@@ -584,7 +586,6 @@ inline void Matrix<Real>::Init(const MatrixIndexT rows,
   MatrixIndexT real_cols;
   size_t size;
   void *data;  // aligned memory block
-  void *temp;  // memory block to be really freed
 
   // compute the size of skip and real cols
   skip = ((16 / sizeof(Real)) - cols % (16 / sizeof(Real)))
@@ -594,14 +595,11 @@ inline void Matrix<Real>::Init(const MatrixIndexT rows,
       * sizeof(Real);
   
   // allocate the memory and set the right dimensions and parameters
-  if (NULL != (data = KALDI_MEMALIGN(16, size, &temp))) {
-    MatrixBase<Real>::data_        = static_cast<Real *> (data);
-    MatrixBase<Real>::num_rows_      = rows;
-    MatrixBase<Real>::num_cols_      = cols;
-    MatrixBase<Real>::stride_  = real_cols;
-  } else {
-    throw std::bad_alloc();
-  }
+  data = MatrixAllocate(size);  // throws std::bad_alloc on failure.
+  MatrixBase<Real>::data_        = static_cast<Real *> (data);
+  MatrixBase<Real>::num_rows_      = rows;
+  MatrixBase<Real>::num_cols_      = cols;
+  MatrixBase<Real>::stride_  = real_cols;
 }
 
 template<typename Real>
@@ -909,7 +907,7 @@ template<typename Real>
 void Matrix<Real>::Destroy() {
   // we need to free the data block if it was defined
   if (NULL != MatrixBase<Real>::data_)
-    KALDI_MEMALIGN_FREE( MatrixBase<Real>::data_);
+    MatrixFree(MatrixBase<Real>::data_);
   MatrixBase<Real>::data_ = NULL;
   MatrixBase<Real>::num_rows_ = MatrixBase<Real>::num_cols_
       = MatrixBase<Real>::stride_ = 0;
@@ -1053,6 +1051,83 @@ void MatrixBase<Real>::GroupPnormDeriv(const MatrixBase<Real> &src1,
   }
 }
 
+template<typename Real>
+void MatrixBase<Real>::DiffGroupPnorm(const MatrixBase<Real> &in_value,
+                                      const MatrixBase<Real> &out_value,
+                                      const MatrixBase<Real> &out_deriv,
+                                      Real power) {
+  KALDI_ASSERT(SameDim(*this, in_value) && SameDim(out_value, out_deriv) &&
+               out_value.num_rows_ == num_rows_ && out_value.num_cols_ > 0);
+  MatrixIndexT num_rows = num_rows_, num_groups = out_value.num_cols_,
+      group_size = num_cols_ / num_groups;
+  KALDI_ASSERT(num_cols_ == num_groups * group_size);
+  for (MatrixIndexT r = 0; r < num_rows; r++) {
+    Real *data = RowData(r);
+    const Real *in_data = in_value.RowData(r),
+        *out_data = out_value.RowData(r), *deriv_data = out_deriv.RowData(r);
+    for (MatrixIndexT g = 0; g < num_groups; g++) {
+      Real norm = out_data[g], deriv = deriv_data[g];
+      Real *group_data = data + g * group_size;
+      const Real *group_in = in_data + g * group_size;
+      if (norm == 0.0 || deriv == 0.0) {
+        for (MatrixIndexT j = 0; j < group_size; j++)
+          group_data[j] = 0.0;
+      } else if (power == 2.0) {  // the usual case: d norm / d x = x / norm.
+        Real scale = deriv / norm;
+        for (MatrixIndexT j = 0; j < group_size; j++)
+          group_data[j] = scale * group_in[j];
+      } else if (power == 1.0) {
+        for (MatrixIndexT j = 0; j < group_size; j++)
+          group_data[j] = (group_in[j] == 0 ? 0 :
+                           (group_in[j] > 0 ? deriv : -deriv));
+      } else {
+        Real scale = deriv * pow(norm, 1 - power);
+        for (MatrixIndexT j = 0; j < group_size; j++)
+          group_data[j] = scale * pow(std::abs(group_in[j]), power - 1) *
+              (group_in[j] >= 0 ? 1 : -1);
+      }
+    }
+  }
+}
+
+template<typename Real>
+void MatrixBase<Real>::GroupMax(const MatrixBase<Real> &src) {
+  KALDI_ASSERT(src.num_rows_ == num_rows_ && num_cols_ > 0);
+  MatrixIndexT group_size = src.num_cols_ / num_cols_;
+  KALDI_ASSERT(src.num_cols_ == num_cols_ * group_size && group_size > 0);
+  for (MatrixIndexT r = 0; r < num_rows_; r++) {
+    Real *data = RowData(r);
+    const Real *src_data = src.RowData(r);
+    for (MatrixIndexT g = 0; g < num_cols_; g++, src_data += group_size) {
+      Real max = src_data[0];
+      for (MatrixIndexT j = 1; j < group_size; j++)
+        max = std::max(max, src_data[j]);
+      data[g] = max;
+    }
+  }
+}
+
+template<typename Real>
+void MatrixBase<Real>::DiffGroupMax(const MatrixBase<Real> &in_value,
+                                    const MatrixBase<Real> &out_value,
+                                    const MatrixBase<Real> &out_deriv) {
+  KALDI_ASSERT(SameDim(*this, in_value) && SameDim(out_value, out_deriv) &&
+               out_value.num_rows_ == num_rows_ && out_value.num_cols_ > 0);
+  MatrixIndexT num_groups = out_value.num_cols_,
+      group_size = num_cols_ / num_groups;
+  KALDI_ASSERT(num_cols_ == num_groups * group_size);
+  for (MatrixIndexT r = 0; r < num_rows_; r++) {
+    Real *data = RowData(r);
+    const Real *in_data = in_value.RowData(r),
+        *out_data = out_value.RowData(r), *deriv_data = out_deriv.RowData(r);
+    for (MatrixIndexT g = 0; g < num_groups; g++) {
+      Real max = out_data[g], deriv = deriv_data[g];
+      for (MatrixIndexT j = g * group_size; j < (g + 1) * group_size; j++)
+        data[j] = (in_data[j] == max ? deriv : 0.0);
+    }
+  }
+}
+
 template<typename Real>  // scales each column by scale[i].
 void MatrixBase<Real>::MulColsVec(const VectorBase<Real> &scale) {
   KALDI_ASSERT(scale.Dim() == num_cols_);
@@ -1109,12 +1184,26 @@ void MatrixBase<Real>::SetRandUniform() {
   }
 }
 
+template<typename Real>
+void MatrixBase<Real>::SetRandn(RandomGenerator *rng) {
+  for (MatrixIndexT row = 0; row < num_rows_; row++)
+    rng->RandGauss(this->RowData(row), num_cols_);
+}
+
+template<typename Real>
+void MatrixBase<Real>::SetRandUniform(RandomGenerator *rng) {
+  for (MatrixIndexT row = 0; row < num_rows_; row++)
+    rng->RandUniform(this->RowData(row), num_cols_);
+}
+
 template<typename Real>
 void MatrixBase<Real>::Write(std::ostream &os, bool binary) const {
   if (!os.good()) {
     KALDI_ERR << "Failed to write matrix to stream: stream not good";
   }
-  if (binary) {  // Use separate binary and text formats,
+  if (binary && AlignedWritePadding(os, 0) != -1) {
+    WriteAligned(os);
+  } else if (binary) {  // Use separate binary and text formats,
     // since in binary mode we need to know if it's float or double.
     std::string my_token = (sizeof(Real) == 4 ? "FM" : "DM");
 
@@ -1153,6 +1242,35 @@ void MatrixBase<Real>::Write(std::ostream &os, bool binary) const {
 }
 
 
+// The aligned format is: the token "FA" or "DA", the number of rows, the
+// number of columns, the stride, the number of bytes of padding, the padding
+// (zeros), and then the rows, each padded with zeros to "stride" elements.
+template<typename Real>
+void MatrixBase<Real>::WriteAligned(std::ostream &os) const {
+  const bool binary = true;
+  WriteToken(os, binary, (sizeof(Real) == 4 ? "FA" : "DA"));
+  int32 rows = num_rows_, cols = num_cols_,
+      align = kBinaryAlignment / sizeof(Real),
+      stride = (cols + align - 1) / align * align;
+  WriteBasicType(os, binary, rows);
+  WriteBasicType(os, binary, cols);
+  WriteBasicType(os, binary, stride);
+  // The padding count takes 5 bytes (the size byte and the int32).
+  int32 padding = AlignedWritePadding(os, 5);
+  if (padding < 0) padding = 0;
+  WriteBasicType(os, binary, padding);
+  std::vector<char> zeros(std::max<size_t>(padding,
+                                           sizeof(Real) * (stride - cols)), 0);
+  if (padding > 0) os.write(&(zeros[0]), padding);
+  for (MatrixIndexT i = 0; i < num_rows_; i++) {
+    os.write(reinterpret_cast<const char*>(RowData(i)), sizeof(Real) * cols);
+    if (stride > cols)
+      os.write(&(zeros[0]), sizeof(Real) * (stride - cols));
+  }
+  if (!os.good())
+    KALDI_ERR << "Failed to write matrix to stream";
+}
+
 template<typename Real>
 void MatrixBase<Real>::Read(std::istream & is, bool binary, bool add) {
   if (add) {
@@ -1199,7 +1317,6 @@ void Matrix<Real>::Read(std::istream & is, bool binary, bool add) {
   }
 
   // now assume add == false.
-  MatrixIndexT pos_at_start = is.tellg();
   std::ostringstream specific_error;
 
   if (binary) {  // Read in binary mode.
@@ -1211,8 +1328,16 @@ void Matrix<Real>::Read(std::istream & is, bool binary, bool add) {
       this->Resize(compressed_mat.NumRows(), compressed_mat.NumCols());
       compressed_mat.CopyToMat(this);
       return;
+    } else if (peekval == 'R') {
+      // The same for RowCompressedMatrix.
+      RowCompressedMatrix compressed_mat;
+      compressed_mat.Read(is, binary);
+      this->Resize(compressed_mat.NumRows(), compressed_mat.NumCols());
+      compressed_mat.CopyToMat(this);
+      return;
     }
-    const char *my_token =  (sizeof(Real) == 4 ? "FM" : "DM");
+    const char *my_token =  (sizeof(Real) == 4 ? "FM" : "DM"),
+        *my_aligned_token = (sizeof(Real) == 4 ? "FA" : "DA");
     char other_token_start = (sizeof(Real) == 4 ? 'D' : 'F');
     if (peekval == other_token_start) {  // need to instantiate the other type to read it.
       typedef typename OtherReal<Real>::Real OtherType;  // if Real == float, OtherType == double, and vice versa.
@@ -1224,23 +1349,36 @@ void Matrix<Real>::Read(std::istream & is, bool binary, bool add) {
     }
     std::string token;
     ReadToken(is, binary, &token);
-    if (token != my_token) {
+    bool aligned = (token == my_aligned_token);
+    if (token != my_token && !aligned) {
       specific_error << ": Expected token " << my_token << ", got " << token;
       goto bad;
     }
-    int32 rows, cols;
+    int32 rows, cols, stride = 0, padding = 0;
     ReadBasicType(is, binary, &rows);  // throws on error.
     ReadBasicType(is, binary, &cols);  // throws on error.
+    if (aligned) {  // See WriteAligned() for the format.
+      ReadBasicType(is, binary, &stride);
+      ReadBasicType(is, binary, &padding);
+      if (stride < cols || padding < 0 || padding >= kBinaryAlignment) {
+        specific_error << ": bad stride " << stride << " or padding "
+                       << padding << " for aligned matrix";
+        goto bad;
+      }
+      is.ignore(padding);
+    }
     if ((MatrixIndexT)rows != this->num_rows_ || (MatrixIndexT)cols != this->num_cols_) {
       this->Resize(rows, cols);
     }
-    if (this->Stride() == this->NumCols() && rows*cols!=0) {
+    if (!aligned && this->Stride() == this->NumCols() && rows*cols!=0) {
       is.read(reinterpret_cast<char*>(this->Data()),
               sizeof(Real)*rows*cols);
       if (is.fail()) goto bad;
     } else {
       for (MatrixIndexT i = 0; i < (MatrixIndexT)rows; i++) {
         is.read(reinterpret_cast<char*>(this->RowData(i)), sizeof(Real)*cols);
+        if (stride > cols)
+          is.ignore(sizeof(Real) * (stride - cols));
         if (is.fail()) goto bad;
       }
     }
@@ -1308,8 +1446,7 @@ void Matrix<Real>::Read(std::istream & is, bool binary, bool add) {
         }
       } else if ( (i >= '0' && i <= '9') || i == '-' ) {  // A number...
         Real r;
-        is >> r;
-        if (is.fail()) {
+        if (!ReadTextNumber(is, &r)) {
           specific_error << "Stream failure/EOF while reading matrix data.";
           goto cleanup;
         }
@@ -1342,8 +1479,7 @@ void Matrix<Real>::Read(std::istream & is, bool binary, bool add) {
   }
 bad:
   KALDI_ERR << "Failed to read matrix from stream.  " << specific_error.str()
-            << " File position at start is "
-            << pos_at_start << ", currently " << is.tellg();
+            << " File position is " << is.tellg();
 }
 
 
@@ -2367,11 +2503,18 @@ Real MatrixBase<Real>::LogSumExp(Real prune) const {
 
   double sum_relto_max_elem = 0.0;
 
-  for (MatrixIndexT i = 0; i < num_rows_; i++) {
-    for (MatrixIndexT j = 0; j < num_cols_; j++) {
-      BaseFloat f = (*this)(i, j);
-      if (f >= cutoff)
-        sum_relto_max_elem += Exp(f - max_elem);
+  if (sizeof(Real) == 4 && g_kaldi_fast_math) {
+    for (MatrixIndexT i = 0; i < num_rows_; i++)
+      sum_relto_max_elem += SumExpApprox(
+          reinterpret_cast<const float*>(RowData(i)), num_cols_, max_elem,
+          cutoff);
+  } else {
+    for (MatrixIndexT i = 0; i < num_rows_; i++) {
+      for (MatrixIndexT j = 0; j < num_cols_; j++) {
+        BaseFloat f = (*this)(i, j);
+        if (f >= cutoff)
+          sum_relto_max_elem += Exp(f - max_elem);
+      }
     }
   }
   return max_elem + Log(sum_relto_max_elem);
@@ -2381,9 +2524,15 @@ template<typename Real>
 Real MatrixBase<Real>::ApplySoftMax() {
   Real max = this->Max(), sum = 0.0;
   // the 'max' helps to get in good numeric range.
-  for (MatrixIndexT i = 0; i < num_rows_; i++)
-    for (MatrixIndexT j = 0; j < num_cols_; j++)
-      sum += ((*this)(i, j) = Exp((*this)(i, j) - max));
+  if (sizeof(Real) == 4 && g_kaldi_fast_math) {
+    for (MatrixIndexT i = 0; i < num_rows_; i++)
+      sum += ExpApproxInPlace(reinterpret_cast<float*>(RowData(i)),
+                              num_cols_, max);
+  } else {
+    for (MatrixIndexT i = 0; i < num_rows_; i++)
+      for (MatrixIndexT j = 0; j < num_cols_; j++)
+        sum += ((*this)(i, j) = Exp((*this)(i, j) - max));
+  }
   this->Scale(1.0 / sum);
   return max + Log(sum);
 }
@@ -126,6 +126,10 @@ class MatrixBase {
   void SetRandn();
   /// Sets to numbers uniformly distributed on (0, 1)
   void SetRandUniform();
+  /// As SetRandn() and SetRandUniform(), but taking the random numbers from
+  /// "rng" (see VectorBase::SetRandn(RandomGenerator*)).
+  void SetRandn(RandomGenerator *rng);
+  void SetRandUniform(RandomGenerator *rng);
 
   /*  Copying functions.  These do not resize the matrix! */
 
@@ -426,6 +430,27 @@ class MatrixBase {
   void GroupPnormDeriv(const MatrixBase<Real> &input, const MatrixBase<Real> &output,
                        Real power);
 
+  /// Backpropagates through the GroupPnorm function above in one pass:
+  /// "in_value" and "out_value" are its input and output, and out_deriv the
+  /// derivative w.r.t. the output; sets *this (with the dimension of in_value)
+  /// to the derivative w.r.t. the input.  This is GroupPnormDeriv() followed
+  /// by MulRowsGroupMat(out_deriv), without the intermediate matrix.
+  void DiffGroupPnorm(const MatrixBase<Real> &in_value,
+                      const MatrixBase<Real> &out_value,
+                      const MatrixBase<Real> &out_deriv, Real power);
+
+  /// Apply the function y(i) = max_{j = i*G}^{(i+1)*G-1} x_j, where
+  /// G = x.NumCols() / y.NumCols() must be an integer.
+  void GroupMax(const MatrixBase<Real> &src);
+
+  /// Backpropagates through the GroupMax function above in one pass: sets
+  /// each element of *this to the derivative of the corresponding output
+  /// (out_deriv) if the element of in_value equals the max of its group
+  /// (out_value), and to zero otherwise.
+  void DiffGroupMax(const MatrixBase<Real> &in_value,
+                    const MatrixBase<Real> &out_value,
+                    const MatrixBase<Real> &out_deriv);
+
 
   /// Set each element to the tanh of the corresponding element of "src".
   void Tanh(const MatrixBase<Real> &src);
@@ -601,9 +626,17 @@ class MatrixBase {
   /// Use instead of stream<<*this, if you want to add to existing contents.
   // Will throw exception on failure.
   void Read(std::istream & in, bool binary, bool add = false);
-  /// write to stream.
+  /// write to stream.  In binary mode, if aligned writing is on for the stream
+  /// (see SetAlignedWrite()), this calls WriteAligned().
   void Write(std::ostream & out, bool binary) const;
 
+  /// Writes in the aligned binary format, where the data starts at a multiple
+  /// of kBinaryAlignment bytes in the file and each row is padded to a
+  /// multiple of kBinaryAlignment bytes, so that a memory-mapped archive can
+  /// be used (e.g. copied to the GPU) without copying it first.  Read()
+  /// reads this format as well as the normal one.
+  void WriteAligned(std::ostream &out) const;
+
   // Below is internal methods for Svd, user does not have to know about this.
 #if !defined(HAVE_ATLAS) && !defined(USE_KALDI_SVD)
   // protected:
@@ -26,6 +26,9 @@
 #include "matrix/cblas-wrappers.h"
 #include "matrix/kaldi-vector.h"
 #include "matrix/kaldi-matrix.h"
+#include "matrix/fast-exp.h"
+#include "matrix/simd-kernels.h"
+#include "matrix/matrix-allocator.h"
 #include "matrix/sp-matrix.h"
 
 namespace kaldi {
@@ -159,18 +162,9 @@ inline void Vector<Real>::Init(const MatrixIndexT dim) {
     this->data_ = NULL;
     return;
   }
-  MatrixIndexT size;
-  void *data;
-  void *free_data;
-
-  size = dim * sizeof(Real);
-
-  if ((data = KALDI_MEMALIGN(16, size, &free_data)) != NULL) {
-    this->data_ = static_cast<Real*> (data);
-    this->dim_ = dim;
-  } else {
-    throw std::bad_alloc();
-  }
+  // MatrixAllocate() throws std::bad_alloc on failure.
+  this->data_ = static_cast<Real*>(MatrixAllocate(dim * sizeof(Real)));
+  this->dim_ = dim;
 }
 
 
@@ -266,7 +260,7 @@ template<typename Real>
 void Vector<Real>::Destroy() {
   /// we need to free the data block if it was defined
   if (this->data_ != NULL)
-    KALDI_MEMALIGN_FREE(this->data_);
+    MatrixFree(this->data_);
   this->data_ = NULL;
   this->dim_ = 0;
 }
@@ -289,6 +283,16 @@ void VectorBase<Real>::SetRandn() {
   for (MatrixIndexT i = 0; i < Dim(); i++) data_[i] = kaldi::RandGauss();
 }
 
+template<typename Real>
+void VectorBase<Real>::SetRandn(RandomGenerator *rng) {
+  rng->RandGauss(data_, dim_);
+}
+
+template<typename Real>
+void VectorBase<Real>::SetRandUniform(RandomGenerator *rng) {
+  rng->RandUniform(data_, dim_);
+}
+
 template<typename Real>
 MatrixIndexT VectorBase<Real>::RandCategorical() const {
   Real sum = this->Sum();
@@ -437,8 +441,11 @@ void VectorBase<Real>::ApplyPow(Real power) {
       if (!(data_[i] >= 0.0))
         KALDI_ERR << "Cannot take square root of negative value "
                   << data_[i];
-      data_[i] = std::sqrt(data_[i]);
+      if (sizeof(Real) != 4) data_[i] = std::sqrt(data_[i]);
     }
+    if (sizeof(Real) == 4)
+      GetSimdKernels().sqrt(reinterpret_cast<float*>(data_),
+                            reinterpret_cast<float*>(data_), dim_);
   } else {
     for (MatrixIndexT i = 0; i < dim_; i++) {
       data_[i] = pow(data_[i], power);
@@ -693,10 +700,15 @@ Real VectorBase<Real>::LogSumExp(Real prune) const {
 
   double sum_relto_max_elem = 0.0;
 
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    BaseFloat f = data_[i];
-    if (f >= cutoff)
-      sum_relto_max_elem += Exp(f - max_elem);
+  if (sizeof(Real) == 4 && g_kaldi_fast_math) {
+    sum_relto_max_elem = SumExpApprox(reinterpret_cast<const float*>(data_),
+                                      dim_, max_elem, cutoff);
+  } else {
+    for (MatrixIndexT i = 0; i < dim_; i++) {
+      BaseFloat f = data_[i];
+      if (f >= cutoff)
+        sum_relto_max_elem += Exp(f - max_elem);
+    }
   }
   return max_elem + Log(sum_relto_max_elem);
 }
@@ -713,8 +725,11 @@ void VectorBase<Real>::ApplyLog() {
   for (MatrixIndexT i = 0; i < dim_; i++) {
     if (data_[i] < 0.0)
       KALDI_ERR << "Trying to take log of a negative number.";
-    data_[i] = Log(data_[i]);
+    if (sizeof(Real) != 4) data_[i] = Log(data_[i]);
   }
+  if (sizeof(Real) == 4)
+    GetSimdKernels().log(reinterpret_cast<float*>(data_),
+                         reinterpret_cast<float*>(data_), dim_);
 }
 
 template<typename Real>
@@ -727,6 +742,11 @@ void VectorBase<Real>::ApplyLogAndCopy(const VectorBase<Real> &v) {
 
 template<typename Real>
 void VectorBase<Real>::ApplyExp() {
+  if (sizeof(Real) == 4) {
+    GetSimdKernels().exp(reinterpret_cast<float*>(data_),
+                         reinterpret_cast<float*>(data_), dim_);
+    return;
+  }
   for (MatrixIndexT i = 0; i < dim_; i++) {
     data_[i] = Exp(data_[i]);
   }
@@ -777,9 +797,13 @@ MatrixIndexT VectorBase<Real>::ApplyFloor(const VectorBase<Real> &floor_vec) {
 
 template<typename Real>
 Real VectorBase<Real>::ApplySoftMax() {
-Real max = this->Max(), sum = 0.0;
-  for (MatrixIndexT i = 0; i < dim_; i++) {
-    sum += (data_[i] = Exp(data_[i] - max));
+  Real max = this->Max(), sum = 0.0;
+  if (sizeof(Real) == 4 && g_kaldi_fast_math) {
+    sum = ExpApproxInPlace(reinterpret_cast<float*>(data_), dim_, max);
+  } else {
+    for (MatrixIndexT i = 0; i < dim_; i++) {
+      sum += (data_[i] = Exp(data_[i] - max));
+    }
   }
   this->Scale(1.0 / sum);
   return max + Log(sum);
@@ -801,6 +825,11 @@ void VectorBase<double>::Tanh(const VectorBase<double> &src) {
 template<typename Real>
 void VectorBase<Real>::Tanh(const VectorBase<Real> &src) {
   KALDI_ASSERT(dim_ == src.dim_);
+  if (sizeof(Real) == 4) {
+    GetSimdKernels().tanh(reinterpret_cast<const float*>(src.data_),
+                          reinterpret_cast<float*>(data_), dim_);
+    return;
+  }
   for (MatrixIndexT i = 0; i < dim_; i++) {
     Real x = src.data_[i];
     if (x > 0.0) {
@@ -839,6 +868,11 @@ void VectorBase<double>::Sigmoid(const VectorBase<double> &src) {
 template<typename Real>
 void VectorBase<Real>::Sigmoid(const VectorBase<Real> &src) {
   KALDI_ASSERT(dim_ == src.dim_);
+  if (sizeof(Real) == 4) {
+    GetSimdKernels().sigmoid(reinterpret_cast<const float*>(src.data_),
+                             reinterpret_cast<float*>(data_), dim_);
+    return;
+  }
   for (MatrixIndexT i = 0; i < dim_; i++) {
     Real x = src.data_[i];
     // We aim to avoid floating-point overflow here.
@@ -869,6 +903,11 @@ void VectorBase<Real>::Scale(Real alpha) {
 template<typename Real>
 void VectorBase<Real>::MulElements(const VectorBase<Real> &v) {
   KALDI_ASSERT(dim_ == v.dim_);
+  if (sizeof(Real) == 4) {
+    GetSimdKernels().mul_elements(reinterpret_cast<const float*>(v.data_),
+                                  reinterpret_cast<float*>(data_), dim_);
+    return;
+  }
   for (MatrixIndexT i = 0; i < dim_; i++) {
     data_[i] *= v.data_[i];
   }
@@ -1022,7 +1061,6 @@ void Vector<Real>::Read(std::istream & is,  bool binary, bool add) {
   } // now assume add == false.
 
   std::ostringstream specific_error;
-  MatrixIndexT pos_at_start = is.tellg();
 
   if (binary) {
     int peekval = Peek(is, binary);
@@ -1068,8 +1106,9 @@ void Vector<Real>::Read(std::istream & is,  bool binary, bool add) {
       int i = is.peek();
       if (i == '-' || (i >= '0' && i <= '9')) {  // common cases first.
         Real r;
-        is >> r;
-        if (is.fail()) { specific_error << "Failed to read number."; goto bad; }
+        if (!ReadTextNumber(is, &r)) {
+          specific_error << "Failed to read number."; goto bad;
+        }
         if (! std::isspace(is.peek()) && is.peek() != ']') {
           specific_error << "Expected whitespace after number."; goto bad;
         }
@@ -1118,8 +1157,7 @@ void Vector<Real>::Read(std::istream & is,  bool binary, bool add) {
   // we never reach this line (the while loop returns directly).
 bad:
   KALDI_ERR << "Failed to read vector from stream.  " << specific_error.str()
-            << " File position at start is "
-            << pos_at_start<<", currently "<<is.tellg();
+            << " File position is " << is.tellg();
 }
 
 
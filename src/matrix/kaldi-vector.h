@@ -48,6 +48,14 @@ class VectorBase {
   /// Set vector to random normally-distributed noise.
   void SetRandn();
 
+  /// Set vector to random normally-distributed noise, taking the random
+  /// numbers from "rng"; this is much faster than SetRandn(), and may be
+  /// called from several threads if each has its own generator.
+  void SetRandn(RandomGenerator *rng);
+
+  /// Set vector to numbers uniformly distributed on (0, 1), from "rng".
+  void SetRandUniform(RandomGenerator *rng);
+
   /// This function returns a random index into this vector,
   /// chosen with probability proportional to the corresponding
   /// element.  Requires that this->Min() >= 0 and this->Sum() > 0.
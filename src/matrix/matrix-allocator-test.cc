@@ -0,0 +1,103 @@
+// matrix/matrix-allocator-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+#include "matrix/matrix-lib.h"
+#include "matrix/matrix-allocator.h"
+
+namespace kaldi {
+
+// Creates and destroys temporaries of random sizes, checking alignment and
+// that the contents are not disturbed by other allocations.
+static void *MakeTemporaries(void *arg) {
+  int32 seed = *static_cast<int32*>(arg);
+  std::vector<Matrix<BaseFloat>*> mats;
+  for (int32 i = 0; i < 2000; i++) {
+    int32 rows = 1 + (seed + i * 7) % 50, cols = 1 + (seed + i * 13) % 300;
+    Matrix<BaseFloat> *mat = new Matrix<BaseFloat>(rows, cols);
+    KALDI_ASSERT(reinterpret_cast<size_t>(mat->Data()) % 16 == 0);
+    mat->Set(i);
+    mats.push_back(mat);
+    if (mats.size() > 10) {
+      Matrix<BaseFloat> *old = mats[i % 10];
+      KALDI_ASSERT(old->Min() == old->Max());
+      delete old;
+      mats[i % 10] = mats.back();
+      mats.pop_back();
+    }
+    Vector<double> vec(1 + i % 1000);
+    KALDI_ASSERT(reinterpret_cast<size_t>(vec.Data()) % 16 == 0);
+    vec.Set(1.0);
+    KALDI_ASSERT(vec.Sum() == vec.Dim());
+  }
+  for (size_t i = 0; i < mats.size(); i++)
+    delete mats[i];
+  return NULL;
+}
+
+void UnitTestMatrixPool() {
+  // Memory allocated with the pool off, freed with it on, and vice versa.
+  Matrix<BaseFloat> before(10, 10);
+  SetMatrixPoolEnabled(true);
+  Matrix<BaseFloat> during(10, 10);
+  before.Resize(0, 0);
+  SpMatrix<BaseFloat> sp(20);
+  sp.SetUnit();
+  Matrix<BaseFloat> full(sp);
+  KALDI_ASSERT(full.Trace() == 20);
+
+  MatrixPoolStats stats1, stats2;
+  GetMatrixPoolStats(&stats1);
+  for (int32 i = 0; i < 100; i++) {
+    Vector<BaseFloat> temp(100);
+    temp.Set(i);
+  }
+  GetMatrixPoolStats(&stats2);
+  KALDI_ASSERT(stats2.num_allocations == stats1.num_allocations + 100);
+  KALDI_ASSERT(stats2.num_reused >= stats1.num_reused + 99);
+
+  const int32 num_threads = 4;
+  pthread_t threads[num_threads];
+  int32 seeds[num_threads];
+  for (int32 i = 0; i < num_threads; i++) {
+    seeds[i] = i;
+    KALDI_ASSERT(pthread_create(&threads[i], NULL, MakeTemporaries,
+                                &(seeds[i])) == 0);
+  }
+  for (int32 i = 0; i < num_threads; i++)
+    pthread_join(threads[i], NULL);
+  GetMatrixPoolStats(&stats2);
+  KALDI_ASSERT(stats2.num_allocations ==
+               stats2.num_reused + stats2.num_system);
+  KALDI_LOG << "Matrix pool: " << stats2.num_allocations << " allocations, "
+            << stats2.num_reused << " reused.";
+
+  SetMatrixPoolEnabled(false);
+  during.Resize(0, 0);
+  int32 seed = 10;
+  MakeTemporaries(&seed);
+}
+
+}  // namespace kaldi
+
+int main() {
+  kaldi::UnitTestMatrixPool();
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -0,0 +1,182 @@
+// matrix/matrix-allocator.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+#include <cstdlib>
+#include <new>
+#include <set>
+#include "matrix/matrix-allocator.h"
+
+namespace kaldi {
+
+namespace {
+
+// Each block starts with a header of 16 bytes (to keep the data aligned) that
+// says which size class it is in, or kUnpooled.
+struct BlockHeader {
+  int32 size_class;
+  uint32 magic;
+};
+const size_t kHeaderSize = 16;
+const uint32 kMagic = 0x4b4d4154;
+const int32 kUnpooled = -1;
+// Size classes are kMinClassSize << c for c = 0 ... kNumClasses - 1, i.e. 64
+// bytes to 1MB, including the header.
+const size_t kMinClassSize = 64;
+const int32 kNumClasses = 15;
+const size_t kMaxCachedBytes = 32 << 20;
+
+struct ThreadPool {
+  void *free_lists[kNumClasses];  // Each free block stores the next pointer.
+  MatrixPoolStats stats;
+  ThreadPool() {
+    for (int32 c = 0; c < kNumClasses; c++) free_lists[c] = NULL;
+  }
+};
+
+bool g_pool_enabled = false;
+
+// The following are protected by g_mutex.
+pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+MatrixPoolStats g_exited_stats;  // Statistics of threads that have exited.
+std::set<ThreadPool*> g_live_pools;
+
+pthread_once_t g_key_once = PTHREAD_ONCE_INIT;
+pthread_key_t g_key;
+
+void AddStats(const MatrixPoolStats &src, MatrixPoolStats *dest) {
+  dest->num_allocations += src.num_allocations;
+  dest->num_reused += src.num_reused;
+  dest->num_system += src.num_system;
+  dest->bytes_cached += src.bytes_cached;
+}
+
+// Called at thread exit: frees the thread's cached blocks.
+void DestroyThreadPool(void *ptr) {
+  ThreadPool *pool = static_cast<ThreadPool*>(ptr);
+  for (int32 c = 0; c < kNumClasses; c++) {
+    while (pool->free_lists[c] != NULL) {
+      void *data = pool->free_lists[c];
+      pool->free_lists[c] = *static_cast<void**>(data);
+      KALDI_MEMALIGN_FREE(static_cast<char*>(data) - kHeaderSize);
+    }
+  }
+  pool->stats.bytes_cached = 0;
+  pthread_mutex_lock(&g_mutex);
+  AddStats(pool->stats, &g_exited_stats);
+  g_live_pools.erase(pool);
+  pthread_mutex_unlock(&g_mutex);
+  delete pool;
+}
+
+void CreateKey() {
+  if (pthread_key_create(&g_key, DestroyThreadPool) != 0)
+    KALDI_ERR << "Could not create thread-specific key for matrix pool.";
+}
+
+ThreadPool *GetThreadPool() {
+  pthread_once(&g_key_once, CreateKey);
+  ThreadPool *pool = static_cast<ThreadPool*>(pthread_getspecific(g_key));
+  if (pool == NULL) {
+    pool = new ThreadPool();
+    pthread_setspecific(g_key, pool);
+    pthread_mutex_lock(&g_mutex);
+    g_live_pools.insert(pool);
+    pthread_mutex_unlock(&g_mutex);
+  }
+  return pool;
+}
+
+// Returns the smallest size class that can hold "size" bytes, or kUnpooled
+// if it is too large.
+inline int32 SizeClass(size_t size) {
+  size_t class_size = kMinClassSize;
+  for (int32 c = 0; c < kNumClasses; c++, class_size <<= 1)
+    if (size <= class_size) return c;
+  return kUnpooled;
+}
+
+inline size_t ClassSize(int32 c) { return kMinClassSize << c; }
+
+}  // end anonymous namespace
+
+
+void *MatrixAllocate(size_t size) {
+  size_t block_size = size + kHeaderSize;
+  int32 size_class = kUnpooled;
+  if (g_pool_enabled) {
+    ThreadPool *pool = GetThreadPool();
+    pool->stats.num_allocations++;
+    size_class = SizeClass(block_size);
+    if (size_class != kUnpooled) {
+      block_size = ClassSize(size_class);
+      void *data = pool->free_lists[size_class];
+      if (data != NULL) {
+        pool->free_lists[size_class] = *static_cast<void**>(data);
+        pool->stats.num_reused++;
+        pool->stats.bytes_cached -= block_size;
+        return data;
+      }
+    }
+    pool->stats.num_system++;
+  }
+  void *block, *temp;
+  if ((block = KALDI_MEMALIGN(16, block_size, &temp)) == NULL)
+    throw std::bad_alloc();
+  BlockHeader *header = static_cast<BlockHeader*>(block);
+  header->size_class = size_class;
+  header->magic = kMagic;
+  return static_cast<char*>(block) + kHeaderSize;
+}
+
+void MatrixFree(void *data) {
+  if (data == NULL) return;
+  char *block = static_cast<char*>(data) - kHeaderSize;
+  const BlockHeader *header = reinterpret_cast<const BlockHeader*>(block);
+  KALDI_ASSERT(header->magic == kMagic);  // Else not from MatrixAllocate().
+  int32 size_class = header->size_class;
+  if (size_class != kUnpooled && g_pool_enabled) {
+    ThreadPool *pool = GetThreadPool();
+    size_t block_size = ClassSize(size_class);
+    if (pool->stats.bytes_cached + block_size <= kMaxCachedBytes) {
+      *static_cast<void**>(data) = pool->free_lists[size_class];
+      pool->free_lists[size_class] = data;
+      pool->stats.bytes_cached += block_size;
+      return;
+    }
+  }
+  KALDI_MEMALIGN_FREE(block);
+}
+
+void SetMatrixPoolEnabled(bool enabled) {
+  g_pool_enabled = enabled;
+}
+
+bool MatrixPoolEnabled() { return g_pool_enabled; }
+
+void GetMatrixPoolStats(MatrixPoolStats *stats) {
+  pthread_mutex_lock(&g_mutex);
+  *stats = g_exited_stats;
+  for (std::set<ThreadPool*>::const_iterator iter = g_live_pools.begin();
+       iter != g_live_pools.end(); ++iter)
+    AddStats((*iter)->stats, stats);
+  pthread_mutex_unlock(&g_mutex);
+}
+
+}  // namespace kaldi
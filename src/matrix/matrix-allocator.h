@@ -0,0 +1,81 @@
+// matrix/matrix-allocator.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_MATRIX_ALLOCATOR_H_
+#define KALDI_MATRIX_MATRIX_ALLOCATOR_H_
+
+#include <cstddef>
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_funcs_misc
+/// @{
+
+/*
+  These functions allocate the memory of Matrix, Vector and PackedMatrix (and
+  of CuMatrix, CuVector and CuPackedMatrix when not using the GPU; all of
+  these can exchange their memory with Swap(), so they must all use the same
+  allocator).  The memory is 16-byte aligned.
+
+  By default each allocation goes to the system (posix_memalign()).  If
+  SetMatrixPoolEnabled(true) has been called, allocations of up to 1MB are
+  rounded up to a power of two and are taken from a pool that is kept per
+  thread, so there is no locking: freed memory goes on a free list for its
+  size in the pool of the thread that freed it, and is reused by that
+  thread's next allocation of the same size class.  This helps code that
+  creates many short-lived temporaries in inner loops.  Each thread keeps at
+  most 32MB of freed memory, and returns it to the system when the thread
+  exits.
+*/
+
+/// Returns 16-byte aligned memory of at least "size" bytes, which must be
+/// freed with MatrixFree().  Throws std::bad_alloc on failure.
+void *MatrixAllocate(size_t size);
+
+/// Frees memory returned by MatrixAllocate(); does nothing if data == NULL.
+/// It may be called from any thread.
+void MatrixFree(void *data);
+
+/// Switches the per-thread pool on or off.  Memory allocated while it was on
+/// may still be freed after it is switched off, and vice versa.
+void SetMatrixPoolEnabled(bool enabled);
+
+/// Returns true if the pool is switched on.
+bool MatrixPoolEnabled();
+
+/// Usage statistics for the pool, summed over all threads.
+struct MatrixPoolStats {
+  int64 num_allocations;  ///< Calls to MatrixAllocate().
+  int64 num_reused;  ///< Allocations that were satisfied from the pool.
+  int64 num_system;  ///< Allocations that went to the system.
+  int64 bytes_cached;  ///< Bytes of freed memory currently held in pools.
+  MatrixPoolStats(): num_allocations(0), num_reused(0), num_system(0),
+                     bytes_cached(0) { }
+};
+
+/// Gets the statistics so far.  Those of threads that are still running may be
+/// slightly out of date.
+void GetMatrixPoolStats(MatrixPoolStats *stats);
+
+/// @} end of "addtogroup matrix_funcs_misc"
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_MATRIX_ALLOCATOR_H_
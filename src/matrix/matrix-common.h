@@ -68,6 +68,7 @@ template<typename Real> class CuSpMatrix;
 template<typename Real> class CuTpMatrix;
 
 class CompressedMatrix;
+class RowCompressedMatrix;
 
 /// This class provides a way for switching between double and float types.
 template<typename T> class OtherReal { };  // useful in reading+writing routines
@@ -834,47 +834,48 @@ void ComputePca(const MatrixBase<Real> &X,
   MatrixIndexT G = U->NumRows();  // # of retained basis elements.
   KALDI_ASSERT(A == NULL || (A->NumRows() == N && A->NumCols() == G));
   KALDI_ASSERT(G <= N && G <= D);
+  if (!exact) {
+    // Take the top singular vectors of X directly: if X ~= V diag(s) U, the
+    // PCA basis is U, the eigenvalues are s^2 and the coefficients are
+    // V diag(s).
+    Vector<Real> s(G);
+    Matrix<Real> V(N, G);
+    RandomizedSvd(X, &s, &V, U);
+    if (print_eigs) {
+      Vector<Real> l(s);
+      l.ApplyPow(2.0);
+      KALDI_LOG << "Retained PCA eigenvalues are " << l;
+    }
+    if (A != NULL) {
+      A->CopyFromMat(V);
+      A->MulColsVec(s);
+    }
+    return;
+  }
   if (D < N) {  // Do conventional PCA.
     SpMatrix<Real> Msp(D);  // Matrix of outer products.
     Msp.AddMat2(1.0, X, kTrans, 0.0);  // M <-- X^T X
-    Matrix<Real> Utmp;
-    Vector<Real> l;
-    if (exact) {
-      Utmp.Resize(D, D);
-      l.Resize(D);
-      //Matrix<Real> M(Msp);
-      //M.DestructiveSvd(&l, &Utmp, NULL);
-      Msp.Eig(&l, &Utmp);
-    } else {
-      Utmp.Resize(D, G);
-      l.Resize(G);
-      Msp.TopEigs(&l, &Utmp);
-    }
+    Matrix<Real> Utmp(D, D);
+    Vector<Real> l(D);
+    //Matrix<Real> M(Msp);
+    //M.DestructiveSvd(&l, &Utmp, NULL);
+    Msp.Eig(&l, &Utmp);
     SortSvd(&l, &Utmp);
     
     for (MatrixIndexT g = 0; g < G; g++)
       U->Row(g).CopyColFromMat(Utmp, g);
     if (print_eigs)
-      KALDI_LOG << (exact ? "" : "Retained ")
-                << "PCA eigenvalues are " << l;
+      KALDI_LOG << "PCA eigenvalues are " << l;
     if (A != NULL)
       A->AddMatMat(1.0, X, kNoTrans, *U, kTrans, 0.0);
   } else {  // Do inner-product PCA.
     SpMatrix<Real> Nsp(N);  // Matrix of inner products.
     Nsp.AddMat2(1.0, X, kNoTrans, 0.0);  // M <-- X X^T
 
-    Matrix<Real> Vtmp;
-    Vector<Real> l;
-    if (exact) {
-      Vtmp.Resize(N, N);
-      l.Resize(N);
-      Matrix<Real> Nmat(Nsp);
-      Nmat.DestructiveSvd(&l, &Vtmp, NULL);
-    } else {
-      Vtmp.Resize(N, G);
-      l.Resize(G);
-      Nsp.TopEigs(&l, &Vtmp);
-    }
+    Matrix<Real> Vtmp(N, N);
+    Vector<Real> l(N);
+    Matrix<Real> Nmat(Nsp);
+    Nmat.DestructiveSvd(&l, &Vtmp, NULL);
     
     MatrixIndexT num_zeroed = 0;
     for (MatrixIndexT g = 0; g < G; g++) {
@@ -926,6 +927,63 @@ void ComputePca(const MatrixBase<double> &X,
                 bool exact);
 
 
+template<typename Real>
+void RandomizedSvd(const MatrixBase<Real> &M,
+                   VectorBase<Real> *s,
+                   MatrixBase<Real> *U,
+                   MatrixBase<Real> *Vt,
+                   MatrixIndexT oversample,
+                   int32 num_power_iters) {
+  MatrixIndexT rows = M.NumRows(), cols = M.NumCols(), k = s->Dim(),
+      l = std::min(k + oversample, std::min(rows, cols));
+  KALDI_ASSERT(k > 0 && k <= l && oversample >= 0 && num_power_iters >= 0);
+  KALDI_ASSERT(U->NumRows() == rows && U->NumCols() == k &&
+               Vt->NumRows() == k && Vt->NumCols() == cols);
+  if (l == std::min(rows, cols))
+    num_power_iters = 0;  // The result is exact anyway.
+  // The rows of Z will be an orthonormal basis for (approximately) the
+  // top-l-dimensional row space of M, and the rows of Q the same for its
+  // column space; we store things this way so we can use OrthogonalizeRows().
+  Matrix<Real> Q(l, rows, kUndefined), Z(l, cols, kUndefined);
+  Z.SetRandn();
+  for (int32 i = 0; i <= num_power_iters; i++) {
+    Q.AddMatMat(1.0, Z, kNoTrans, M, kTrans, 0.0);  // Q = Z M^T.
+    Q.OrthogonalizeRows();
+    Z.AddMatMat(1.0, Q, kNoTrans, M, kNoTrans, 0.0);  // Z = Q M.
+    Z.OrthogonalizeRows();
+  }
+  // Let C = M Z^T, so M ~= C Z.  Doing the SVD C = W diag(s) Y^T gives
+  // M ~= W diag(s) (Y^T Z).  Projecting on the row space rather than the
+  // column space means M^T M is exactly diagonalized by the rows of Vt, which
+  // matters for PCA.
+  Matrix<Real> C(rows, l), W(rows, l), Yt(l, l);
+  C.AddMatMat(1.0, M, kNoTrans, Z, kTrans, 0.0);
+  Vector<Real> s_tmp(l);
+  C.DestructiveSvd(&s_tmp, &W, &Yt);
+  SortSvd(&s_tmp, &W, &Yt);
+  s->CopyFromVec(s_tmp.Range(0, k));
+  U->CopyFromMat(SubMatrix<Real>(W, 0, rows, 0, k));
+  Vt->AddMatMat(1.0, SubMatrix<Real>(Yt, 0, k, 0, l), kNoTrans,
+                Z, kNoTrans, 0.0);
+}
+
+template
+void RandomizedSvd(const MatrixBase<float> &M,
+                   VectorBase<float> *s,
+                   MatrixBase<float> *U,
+                   MatrixBase<float> *Vt,
+                   MatrixIndexT oversample,
+                   int32 num_power_iters);
+
+template
+void RandomizedSvd(const MatrixBase<double> &M,
+                   VectorBase<double> *s,
+                   MatrixBase<double> *U,
+                   MatrixBase<double> *Vt,
+                   MatrixIndexT oversample,
+                   int32 num_power_iters);
+
+
 // Added by Dan, Feb. 13 2012. 
 // This function does: *plus += max(0, a b^T),
 // *minus += max(0, -(a b^T)).
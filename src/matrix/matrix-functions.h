@@ -190,8 +190,8 @@ class MatrixExponential {
     @param print_eigs [in] If true, prints out diagnostic information about the
          eigenvalues.
     @param exact [in] If true, does the exact computation; if false, does
-         a much faster (but almost exact) computation based on the Lanczos
-         method.
+         a much faster (but almost exact) computation based on
+         RandomizedSvd().
 */
 
 template<typename Real>
@@ -202,6 +202,36 @@ void ComputePca(const MatrixBase<Real> &X,
                 bool exact = true);
 
 
+/**
+   RandomizedSvd computes an approximation to the top k singular values
+   and vectors of M, for k = s->Dim(), so that M ~= U diag(s) Vt; it is for
+   when k is much smaller than the dimensions of M, so a full SVD would be a
+   waste.  It is the randomized range-finder of Halko, Martinsson and Tropp
+   ("Finding structure with randomness", 2011): we multiply M by a random
+   matrix with k + oversample columns, do num_power_iters subspace iterations
+   with M M^T to sharpen the range estimate, and do an exact SVD of M projected
+   onto that small subspace.  Nearly all the work is matrix-matrix products.
+   The singular values are output sorted from greatest to least.  The more
+   slowly the spectrum of M decays, the more power iterations you need.  If
+   k + oversample >= min(M.NumRows(), M.NumCols()), the result is exact (up to
+   roundoff), so a large "oversample" gives a full SVD that, unlike
+   DestructiveSvd(), works for either shape of M.
+
+   @param M [in]  The matrix to decompose, of any shape.
+   @param s [out] The top k singular values; k = s->Dim() must be
+          <= min(M.NumRows(), M.NumCols()).
+   @param U [out] M.NumRows() by k; the left singular vectors are its columns.
+   @param Vt [out] k by M.NumCols(); the right singular vectors are its rows.
+*/
+template<typename Real>
+void RandomizedSvd(const MatrixBase<Real> &M,
+                   VectorBase<Real> *s,
+                   MatrixBase<Real> *U,
+                   MatrixBase<Real> *Vt,
+                   MatrixIndexT oversample = 10,
+                   int32 num_power_iters = 2);
+
+
 
 // This function does: *plus += max(0, a b^T),
 // *minus += max(0, -(a b^T)).
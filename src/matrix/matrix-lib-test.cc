@@ -420,7 +420,9 @@ static void UnitTestSetRandn() {
   for (MatrixIndexT i = 0; i < 5; i++) {
     MatrixIndexT rows = 100 + rand() % 50, cols = 100 + rand() % 50;
     Matrix<Real> M(rows, cols);
-    M.SetRandn();
+    RandomGenerator rng(rand(), i);
+    if (i % 2 == 0) M.SetRandn();
+    else M.SetRandn(&rng);
 
     for (MatrixIndexT pow = 1; pow < 5; pow++) {
       // test moments 1 through 4 of
@@ -452,7 +454,9 @@ static void UnitTestSetRandUniform() {
   for (MatrixIndexT i = 0; i < 5; i++) {
     MatrixIndexT rows = 200 + rand() % 50, cols = 200 + rand() % 50;
     Matrix<Real> M(rows, cols);
-    M.SetRandUniform();
+    RandomGenerator rng(rand(), i);
+    if (i % 2 == 0) M.SetRandUniform();
+    else M.SetRandUniform(&rng);
 
     M.Add(-0.5); // we'll be testing the central moments, so
     // center it around zero first.
@@ -584,6 +588,123 @@ static void UnitTestSimpleForVec() {  // testing some simple operaters on vector
 
 }
 
+template<typename Real>
+static void UnitTestFastMath() {
+  // Compares the LogSumExp() and ApplySoftMax() functions with
+  // g_kaldi_fast_math set to those without (they only differ for float).
+  for (MatrixIndexT i = 0; i < 10; i++) {
+    MatrixIndexT dim = (i == 0 ? 1000 : rand() % 30) + 1;
+    Vector<Real> V(dim);
+    V.SetRandn();
+    V.Scale(10.0);
+    if (dim > 1)  // else everything would be -inf.
+      V(rand() % dim) = kLogZeroBaseFloat;  // exp() should give zero.
+    Real prune = (i % 2 == 0 ? -1.0 : 5.0);
+    Vector<Real> W(V), W_fast(V);
+    Real a = V.LogSumExp(prune), b = W.ApplySoftMax();
+    g_kaldi_fast_math = true;
+    Real a_fast = V.LogSumExp(prune), b_fast = W_fast.ApplySoftMax();
+    g_kaldi_fast_math = false;
+    KALDI_ASSERT(std::abs(a - a_fast) < 1.0e-04 &&
+                 std::abs(b - b_fast) < 1.0e-04);
+    AssertEqual(W, W_fast, 1.0e-04);
+
+    Matrix<Real> M(1 + rand() % 10, 1 + rand() % 10), N(M.NumRows(), M.NumCols());
+    M.SetRandn();
+    N.CopyFromMat(M);
+    Matrix<Real> N_fast(M);
+    a = M.LogSumExp();
+    b = N.ApplySoftMax();
+    g_kaldi_fast_math = true;
+    a_fast = M.LogSumExp();
+    b_fast = N_fast.ApplySoftMax();
+    g_kaldi_fast_math = false;
+    KALDI_ASSERT(std::abs(a - a_fast) < 1.0e-04 &&
+                 std::abs(b - b_fast) < 1.0e-04);
+    AssertEqual(N, N_fast, 1.0e-04);
+  }
+}
+
+// Checks that a float result is close to the double one: a relative error of
+// at most "tol" for values >= 1 and an absolute one below that, and the same
+// infinities and NaNs.
+static void AssertFloatClose(float a, double b, float tol) {
+  if (KALDI_ISNAN(b)) {
+    KALDI_ASSERT(KALDI_ISNAN(a));
+  } else if (std::abs(b) > std::numeric_limits<float>::max()) {
+    KALDI_ASSERT(a == static_cast<float>(b));
+  } else {
+    KALDI_ASSERT(std::abs(a - b) <= tol * std::max(1.0, std::abs(b)));
+  }
+}
+
+static void UnitTestSimdKernels() {
+  // Compares the elementwise functions of VectorBase<float>, with each of the
+  // versions of SimdKernels this CPU supports, with the double versions.
+  std::string default_name = GetSimdKernels().name;
+  const char *names[] = { "scalar", "sse2", "avx2", "avx512" };
+  const float inf = std::numeric_limits<float>::infinity(),
+      nan = std::numeric_limits<float>::quiet_NaN();
+  for (int32 n = 0; n < 4; n++) {
+    if (!SelectSimdKernels(names[n])) continue;
+    KALDI_ASSERT(std::string(GetSimdKernels().name) == names[n]);
+    for (MatrixIndexT i = 0; i < 10; i++) {
+      MatrixIndexT dim = (i == 0 ? 1000 : rand() % 40) + 1;
+      Vector<float> V(dim);
+      V.SetRandn();
+      V.Scale(i % 2 == 0 ? 5.0 : 50.0);  // the larger ones overflow exp().
+      if (i == 0) {  // test the special cases.
+        float special[] = { 0.0, -0.0, inf, -inf, nan, 1.0e-40, 88.5, -87.5,
+                            100.0, -100.0, 1.0e-30, -1.0e-30 };
+        for (int32 j = 0; j < 12; j++) V(7 * j) = special[j];
+      }
+      Vector<double> D(V);
+
+      Vector<float> E(V);
+      Vector<double> DE(D);
+      E.ApplyExp();
+      DE.ApplyExp();
+      for (MatrixIndexT j = 0; j < dim; j++)
+        AssertFloatClose(E(j), DE(j), 1.0e-06);
+
+      Vector<float> L(V);
+      L.ApplyAbs();
+      Vector<double> DL(L);
+      L.ApplyLog();
+      DL.ApplyLog();
+      Vector<float> S(V);
+      S.ApplyAbs();
+      for (MatrixIndexT j = 0; j < dim; j++)  // sqrt(NaN) is an error.
+        if (KALDI_ISNAN(S(j))) S(j) = 0.0;
+      Vector<double> DS(S);
+      S.ApplyPow(0.5);
+      DS.ApplyPow(0.5);
+      for (MatrixIndexT j = 0; j < dim; j++) {
+        AssertFloatClose(L(j), DL(j), 1.0e-06);
+        AssertFloatClose(S(j), DS(j), 1.0e-06);
+      }
+
+      Vector<float> G(dim), T(V);  // T tests the in-place version.
+      Vector<double> DG(dim), DT(dim);
+      G.Sigmoid(V);
+      T.Tanh(T);
+      DG.Sigmoid(D);
+      DT.Tanh(D);
+      for (MatrixIndexT j = 0; j < dim; j++) {
+        AssertFloatClose(G(j), DG(j), 1.0e-06);
+        AssertFloatClose(T(j), DT(j), 1.0e-06);
+      }
+
+      Vector<float> W(dim), P(V);
+      W.SetRandn();
+      P.MulElements(W);
+      for (MatrixIndexT j = 0; j < dim; j++)
+        KALDI_ASSERT(KALDI_ISNAN(V(j)) || P(j) == V(j) * W(j));
+    }
+  }
+  KALDI_ASSERT(SelectSimdKernels(default_name));
+}
+
 template<typename Real>
 static void UnitTestVectorMax() {
   int32 dimM = 1 + rand() % 10;
@@ -2396,6 +2517,35 @@ template<typename Real> static void UnitTestIo() {
 }
 
 
+template<typename Real> static void UnitTestIoAligned() {
+  typedef typename OtherReal<Real>::Real OtherType;
+  for (MatrixIndexT i = 0; i < 10; i++) {
+    MatrixIndexT rows = rand() % 10, cols = (rows == 0 ? 0 : 1 + rand() % 40);
+    Matrix<Real> M(rows, cols);
+    InitRand(&M);
+    int32 offset = rand() % 100;
+    std::ostringstream os;
+    SetAlignedWrite(os, true, offset);
+    M.Write(os, true);
+    M.Write(os, true);
+    // Following the token, rows, cols and stride comes the padding count; the
+    // data after the padding must be aligned.
+    std::string str = os.str();
+    int32 padding;
+    memcpy(&padding, str.data() + 19, sizeof(padding));
+    KALDI_ASSERT((offset + 23 + padding) % kBinaryAlignment == 0);
+    std::istringstream is(str);
+    Matrix<Real> N;
+    Matrix<OtherType> O;
+    N.Read(is, true);
+    O.Read(is, true);
+    AssertEqual(M, N);
+    Matrix<Real> O2(O);
+    AssertEqual(M, O2);
+    KALDI_ASSERT(is.peek() == EOF);
+  }
+}
+
 template<typename Real> static void UnitTestIoCross() {  // across types.
 
   typedef typename OtherReal<Real>::Real Other;  // e.g. if Real == float, Other == double.
@@ -2836,7 +2986,8 @@ template<typename Real> static void UnitTestSymAddMat2() {
     T2.CopyFromMat(M2);
     Matrix<Real> X1(T1), X2(T2); // so we can test equality.                                                                  
     AssertEqual(X1, X2);
-    KALDI_ASSERT(dimM == 0 || X1.Trace() != 0);
+    // (If alpha and beta are both zero, the result is zero.)
+    KALDI_ASSERT(dimM == 0 || (alpha == 0 && beta == 0) || X1.Trace() != 0);
   }
 }
 
@@ -3783,6 +3934,45 @@ static void UnitTestPca2(bool full_test) {
   }
 }
 
+template<typename Real>
+static void UnitTestRandomizedSvd() {
+  for (MatrixIndexT i = 0; i < 5; i++) {
+    MatrixIndexT rows = 50 + rand() % 100, cols = 50 + rand() % 100,
+        rank = 20 + rand() % 10, k = 1 + rand() % rank;
+    if (i % 2 == 0) rank = std::min(rows, cols);  // full rank.
+    // M has geometrically decaying singular values.
+    Matrix<Real> At(rank, rows), B(rank, cols), M(rows, cols);
+    At.SetRandn();
+    B.SetRandn();
+    At.OrthogonalizeRows();
+    B.OrthogonalizeRows();
+    Matrix<Real> A(At, kTrans);
+    Vector<Real> true_s(rank);
+    for (MatrixIndexT r = 0; r < rank; r++)
+      true_s(r) = 10.0 * std::pow(0.8, static_cast<Real>(r));
+    A.MulColsVec(true_s);
+    M.AddMatMat(1.0, A, kNoTrans, B, kNoTrans, 0.0);
+
+    Vector<Real> s(k);
+    Matrix<Real> U(rows, k), Vt(k, cols);
+    RandomizedSvd(M, &s, &U, &Vt);
+    SubVector<Real> top_s(true_s, 0, k);
+    KALDI_LOG << "Singular values are " << s << ", should be " << top_s;
+    AssertEqual(s, top_s, 0.01);
+    KALDI_ASSERT(NonOrthogonality(U, kTrans) < 0.001 &&
+                 NonOrthogonality(Vt, kNoTrans) < 0.001);
+    // The approximation error should be about the (k+1)'th singular value.
+    Matrix<Real> M2(M);
+    U.MulColsVec(s);
+    M2.AddMatMat(-1.0, U, kNoTrans, Vt, kNoTrans, 1.0);
+    Real err = M2.FrobeniusNorm(),
+        best_err = true_s.Range(k, rank - k).Norm(2.0);
+    KALDI_LOG << "Approximation error is " << err << ", best possible is "
+              << best_err;
+    KALDI_ASSERT(err <= 1.01 * best_err + 0.001);
+  }
+}
+
 template<typename Real>
 static void UnitTestSvdSpeed() {
   std::vector<MatrixIndexT> sizes;
@@ -3844,6 +4034,110 @@ static void UnitTestSvdSpeed() {
   }
 }
 
+template<typename Real> static void UnitTestRowCompressedMatrix() {
+  RowCompressedMatrix empty_cmat;
+  KALDI_ASSERT(empty_cmat.NumRows() == 0 && empty_cmat.NumCols() == 0);
+  for (MatrixIndexT n = 0; n < 10; n++) {
+    // (CompressedMatrix is inaccurate for 1 or 2 rows.)
+    MatrixIndexT num_rows = 3 + rand() % 100, num_cols = 1 + rand() % 15;
+    Matrix<Real> M(num_rows, num_cols);
+    M.SetRandn();
+    RowCompressedMatrix cmat(M);
+    KALDI_ASSERT(cmat.NumRows() == num_rows && cmat.NumCols() == num_cols);
+    Matrix<Real> M2(num_rows, num_cols);
+    cmat.CopyToMat(&M2);
+    Matrix<Real> diff(M2);
+    diff.AddMat(-1.0, M);
+    KALDI_ASSERT(diff.FrobeniusNorm() < 0.01 * M.FrobeniusNorm());
+
+    // a range of rows, possibly spanning several blocks.
+    MatrixIndexT row_offset = rand() % num_rows,
+        sub_rows = 1 + rand() % (num_rows - row_offset);
+    Matrix<Real> Msub(sub_rows, num_cols);
+    cmat.CopyRowsToMat(row_offset, &Msub);
+    SubMatrix<Real> M2sub(M2, row_offset, sub_rows, 0, num_cols);
+    AssertEqual(Msub, M2sub);
+    Vector<Real> v(num_cols), v2(M2.Row(row_offset));
+    cmat.CopyRowToVec(row_offset, &v);
+    AssertEqual(v, v2);
+
+    bool binary = (n % 2 == 1);
+    {
+      std::ofstream outs("tmpf", std::ios_base::out |std::ios_base::binary);
+      InitKaldiOutputStream(outs, binary);
+      cmat.Write(outs, binary);
+    }
+    { // read back, and also as a regular matrix.
+      bool binary_in;
+      std::ifstream ins("tmpf", std::ios_base::in | std::ios_base::binary);
+      InitKaldiInputStream(ins, &binary_in);
+      RowCompressedMatrix cmat2;
+      cmat2.Read(ins, binary_in);
+      RowCompressedMatrix cmat3(cmat2);
+      Matrix<Real> M3(num_rows, num_cols);
+      cmat3.CopyToMat(&M3);
+      if (binary) AssertEqual(M2, M3);
+      else KALDI_ASSERT(M2.ApproxEqual(M3, 0.01));
+    }
+    {
+      bool binary_in;
+      std::ifstream ins("tmpf", std::ios_base::in | std::ios_base::binary);
+      InitKaldiInputStream(ins, &binary_in);
+      Matrix<Real> M3;
+      M3.Read(ins, binary_in);
+      KALDI_ASSERT(M2.ApproxEqual(M3, binary ? 1.0e-05 : 0.01));
+    }
+  }
+}
+
+template<typename Real> static void UnitTestQuantizedMatrix() {
+  for (MatrixIndexT n = 0; n < 10; n++) {
+    MatrixIndexT num_rows = rand() % 40, num_cols = 1 + rand() % 50,
+        num_a_rows = 1 + rand() % 30;
+    if (num_rows == 0)  // a Matrix can't be e.g. 0 x 3.
+      num_cols = num_a_rows = 0;
+    Matrix<Real> M(num_rows, num_cols);
+    M.SetRandn();
+    if (num_rows > 0) M.Row(rand() % num_rows).SetZero();  // a pathology.
+    QuantizedMatrix qmat(M);
+    KALDI_ASSERT(qmat.NumRows() == num_rows && qmat.NumCols() == num_cols);
+    Matrix<Real> M2(num_rows, num_cols);
+    qmat.CopyToMat(&M2);
+    for (MatrixIndexT r = 0; r < num_rows; r++) {
+      Real max_abs = std::max(M.Row(r).Max(), -M.Row(r).Min());
+      for (MatrixIndexT c = 0; c < num_cols; c++)
+        KALDI_ASSERT(std::abs(M(r, c) - M2(r, c)) <= 0.5001 * max_abs / 127.0);
+    }
+
+    Matrix<Real> A(num_a_rows, num_cols), C(num_a_rows, num_rows),
+        C_ref(num_a_rows, num_rows);
+    A.SetRandn();
+    C.SetRandn();
+    C_ref.CopyFromMat(C);
+    Real alpha = 0.5, beta = 2.0;
+    qmat.AddMatMatTrans(alpha, A, beta, &C);
+    C_ref.AddMatMat(alpha, A, kNoTrans, M2, kTrans, beta);
+    Matrix<Real> diff(C);
+    diff.AddMat(-1.0, C_ref);
+    // The error comes from quantizing A.
+    KALDI_ASSERT(diff.FrobeniusNorm() <= 0.02 * C_ref.FrobeniusNorm() + 1.0e-05);
+
+    for (int32 i = 0; i < 2; i++) {
+      bool binary = (i == 0);
+      std::ostringstream os;
+      qmat.Write(os, binary);
+      QuantizedMatrix qmat2;
+      std::istringstream is(os.str());
+      qmat2.Read(is, binary);
+      Matrix<Real> M3(num_rows, num_cols);
+      qmat2.CopyToMat(&M3);
+      if (binary) AssertEqual(M2, M3);
+      else KALDI_ASSERT(M2.ApproxEqual(M3, 1.0e-04));
+    }
+  }
+}
+
+
 template<typename Real> static void UnitTestCompressedMatrix() {
   // This is the basic test.
 
@@ -3940,6 +4234,10 @@ template<typename Real> static void UnitTestCompressedMatrix() {
           AssertEqual(M2(i+sub_row_offset, k+sub_col_offset), Msub(i, k));
         }
       }
+      // the submatrix may also be the whole matrix.
+      Matrix<Real> Mfull(num_rows, num_cols);
+      cmat.CopyToMat(0, 0, &Mfull);
+      AssertEqual(M2, Mfull);
     }
 
     if (n < 5) {  // test I/O.
@@ -4133,6 +4431,7 @@ template<typename Real> static void MatrixUnitTest(bool full_test) {
   KALDI_LOG << " Point D";
   UnitTestTpInvert<Real>();
   UnitTestIo<Real>();
+  UnitTestIoAligned<Real>();
   UnitTestIoCross<Real>();
   UnitTestHtkIo<Real>();
   UnitTestScale<Real>();
@@ -4181,6 +4480,7 @@ template<typename Real> static void MatrixUnitTest(bool full_test) {
   UnitTestVectorMax<Real>();
   UnitTestVectorMin<Real>();
   UnitTestSimpleForMat<Real>();
+  UnitTestFastMath<Real>();
   UnitTestTanh<Real>();
   UnitTestSigmoid<Real>();
   UnitTestSoftHinge<Real>();
@@ -4222,8 +4522,11 @@ template<typename Real> static void MatrixUnitTest(bool full_test) {
   UnitTestMax2<Real>();
   UnitTestPca<Real>(full_test);
   UnitTestPca2<Real>(full_test);
+  UnitTestRandomizedSvd<Real>();
   UnitTestAddVecVec<Real>();
   UnitTestReplaceValue<Real>();
+  UnitTestQuantizedMatrix<Real>();
+  UnitTestRowCompressedMatrix<Real>();
   // The next one is slow.  The upshot is that Eig is up to ten times faster
   // than SVD. 
   // UnitTestSvdSpeed<Real>();
@@ -4239,6 +4542,7 @@ int main() {
   bool full_test = false;
   kaldi::MatrixUnitTest<double>(full_test);
   kaldi::MatrixUnitTest<float>(full_test);
+  kaldi::UnitTestSimdKernels();
   KALDI_LOG << "Tests succeeded.\n";
 
 }
@@ -31,7 +31,10 @@
 #include "matrix/matrix-functions.h"
 #include "matrix/srfft.h"
 #include "matrix/compressed-matrix.h"
+#include "matrix/quantized-matrix.h"
 #include "matrix/optimization.h"
+#include "matrix/simd-kernels.h"
+#include "matrix/blas-threads.h"
 
 #endif
 
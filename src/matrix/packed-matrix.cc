@@ -26,6 +26,7 @@
 #include "matrix/cblas-wrappers.h"
 #include "matrix/packed-matrix.h"
 #include "matrix/kaldi-vector.h"
+#include "matrix/matrix-allocator.h"
 
 namespace kaldi {
 
@@ -66,15 +67,9 @@ inline void PackedMatrix<Real>::Init(MatrixIndexT r) {
                << "in MatrixIndexT: not all code is tested for this case.";
   }
 
-  void *data;  // aligned memory block
-  void *temp;
-
-  if ((data = KALDI_MEMALIGN(16, size * sizeof(Real), &temp)) != NULL) {
-    this->data_ = static_cast<Real *> (data);
-    this->num_rows_ = r;
-  } else {
-    throw std::bad_alloc();
-  }
+  // MatrixAllocate() throws std::bad_alloc on failure.
+  this->data_ = static_cast<Real *>(MatrixAllocate(size * sizeof(Real)));
+  this->num_rows_ = r;
 }
 
 template<typename Real>
@@ -226,7 +221,7 @@ Real PackedMatrix<Real>::Trace() const {
 template<typename Real>
 void PackedMatrix<Real>::Destroy() {
   // we need to free the data block if it was defined
-  if (data_ != NULL) KALDI_MEMALIGN_FREE(data_);
+  if (data_ != NULL) MatrixFree(data_);
   data_ = NULL;
   num_rows_ = 0;
 }
@@ -312,7 +307,6 @@ void PackedMatrix<Real>::Read(std::istream& is, bool binary, bool add) {
   } // now assume add == false.
 
   std::ostringstream specific_error;
-  MatrixIndexT pos_at_start = is.tellg();
   int peekval = Peek(is, binary);
   const char *my_token =  (sizeof(Real) == 4 ? "FP" : "DP");
   const char *new_format_token = "[";
@@ -392,9 +386,8 @@ void PackedMatrix<Real>::Read(std::istream& is, bool binary, bool add) {
         //std::cout<<"here!!!!!hxu!!!!!"<<std::endl;
       }
       else if ( (i >= '0' && i <= '9') || i == '-' ) {  // A number...
-        Real r; 
-        is >> r;
-        if (is.fail()) {
+        Real r;
+        if (!ReadTextNumber(is, &r)) {
           specific_error << "Stream failure/EOF while reading matrix data.";
           goto bad;
         } 
@@ -421,8 +414,7 @@ void PackedMatrix<Real>::Read(std::istream& is, bool binary, bool add) {
   }
 bad:
   KALDI_ERR << "Failed to read packed matrix from stream. " << specific_error.str()
-            << " File position at start is "
-            << pos_at_start << ", currently " << is.tellg();
+            << " File position is " << is.tellg();
 }
 
 
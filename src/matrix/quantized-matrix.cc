@@ -0,0 +1,195 @@
+// matrix/quantized-matrix.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "matrix/quantized-matrix.h"
+#include <algorithm>
+#include <cmath>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace kaldi {
+
+// Returns the dot product of a and b, which have n elements where n is a
+// multiple of 16.
+static inline int32 DotProductInt8(const signed char *a, const signed char *b,
+                                   MatrixIndexT n) {
+#ifdef __SSE2__
+  __m128i sum = _mm_setzero_si128();
+  for (MatrixIndexT k = 0; k < n; k += 16) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + k)),
+        vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + k));
+    // Sign-extend to 16 bits: interleaving a vector with itself puts each byte
+    // in both halves of a 16-bit word, and the arithmetic shift keeps the
+    // sign of the upper copy.
+    __m128i va_lo = _mm_srai_epi16(_mm_unpacklo_epi8(va, va), 8),
+        va_hi = _mm_srai_epi16(_mm_unpackhi_epi8(va, va), 8),
+        vb_lo = _mm_srai_epi16(_mm_unpacklo_epi8(vb, vb), 8),
+        vb_hi = _mm_srai_epi16(_mm_unpackhi_epi8(vb, vb), 8);
+    // Multiply pairs of 16-bit elements and add adjacent products into 32
+    // bits; this cannot overflow since |q| <= 127.
+    sum = _mm_add_epi32(sum, _mm_madd_epi16(va_lo, vb_lo));
+    sum = _mm_add_epi32(sum, _mm_madd_epi16(va_hi, vb_hi));
+  }
+  int32 parts[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(parts), sum);
+  return parts[0] + parts[1] + parts[2] + parts[3];
+#else
+  int32 sum = 0;
+  for (MatrixIndexT k = 0; k < n; k++)
+    sum += static_cast<int32>(a[k]) * static_cast<int32>(b[k]);
+  return sum;
+#endif
+}
+
+template<typename Real>
+float QuantizedMatrix::QuantizeRow(const Real *src, MatrixIndexT num_cols,
+                                   signed char *dest) {
+  Real max_abs = 0.0;
+  for (MatrixIndexT j = 0; j < num_cols; j++)
+    max_abs = std::max(max_abs, std::abs(src[j]));
+  if (max_abs == 0.0) {
+    std::fill(dest, dest + num_cols, 0);
+    return 0.0;
+  }
+  float scale = max_abs / 127.0, inv_scale = 127.0 / max_abs;
+  for (MatrixIndexT j = 0; j < num_cols; j++) {
+    int32 q = static_cast<int32>(std::floor(src[j] * inv_scale + 0.5));
+    if (q > 127) q = 127;
+    if (q < -127) q = -127;
+    dest[j] = static_cast<signed char>(q);
+  }
+  return scale;
+}
+
+template<typename Real>
+void QuantizedMatrix::CopyFromMat(const MatrixBase<Real> &mat) {
+  num_rows_ = mat.NumRows();
+  num_cols_ = mat.NumCols();
+  stride_ = (num_cols_ + 15) / 16 * 16;
+  scales_.resize(num_rows_);
+  data_.clear();
+  data_.resize(static_cast<size_t>(num_rows_) * stride_, 0);
+  for (MatrixIndexT i = 0; i < num_rows_; i++)
+    scales_[i] = QuantizeRow(mat.RowData(i), num_cols_,
+                             &(data_[static_cast<size_t>(i) * stride_]));
+}
+
+template<typename Real>
+void QuantizedMatrix::CopyToMat(MatrixBase<Real> *mat) const {
+  KALDI_ASSERT(mat->NumRows() == num_rows_ && mat->NumCols() == num_cols_);
+  for (MatrixIndexT i = 0; i < num_rows_; i++) {
+    const signed char *q = &(data_[static_cast<size_t>(i) * stride_]);
+    Real *row = mat->RowData(i), scale = scales_[i];
+    for (MatrixIndexT j = 0; j < num_cols_; j++)
+      row[j] = scale * q[j];
+  }
+}
+
+template<typename Real>
+void QuantizedMatrix::AddMatMatTrans(Real alpha, const MatrixBase<Real> &A,
+                                     Real beta, MatrixBase<Real> *C) const {
+  KALDI_ASSERT(A.NumCols() == num_cols_ && C->NumRows() == A.NumRows() &&
+               C->NumCols() == num_rows_);
+  if (beta == 0.0) C->SetZero();  // C may be uninitialized.
+  else if (beta != 1.0) C->Scale(beta);
+  if (num_rows_ == 0 || A.NumRows() == 0) return;
+  // Quantize A, a block of rows at a time; each row of *this is used for all
+  // the rows in the block while it is in cache.
+  const MatrixIndexT kBlockSize = 16;
+  std::vector<signed char> a_data(kBlockSize * stride_);
+  std::vector<float> a_scales(kBlockSize);
+  for (MatrixIndexT r = 0; r < A.NumRows(); r += kBlockSize) {
+    MatrixIndexT num_block_rows = std::min(kBlockSize, A.NumRows() - r);
+    std::fill(a_data.begin(), a_data.end(), 0);
+    for (MatrixIndexT i = 0; i < num_block_rows; i++)
+      a_scales[i] = QuantizeRow(A.RowData(r + i), num_cols_,
+                                &(a_data[i * stride_]));
+    for (MatrixIndexT j = 0; j < num_rows_; j++) {
+      const signed char *b = &(data_[static_cast<size_t>(j) * stride_]);
+      Real b_scale = alpha * scales_[j];
+      for (MatrixIndexT i = 0; i < num_block_rows; i++) {
+        int32 dot = DotProductInt8(&(a_data[i * stride_]), b, stride_);
+        (*C)(r + i, j) += b_scale * a_scales[i] * dot;
+      }
+    }
+  }
+}
+
+void QuantizedMatrix::Write(std::ostream &os, bool binary) const {
+  if (binary) {
+    WriteToken(os, binary, "QM");
+    WriteBasicType(os, binary, num_rows_);
+    WriteBasicType(os, binary, num_cols_);
+    if (num_rows_ != 0)
+      os.write(reinterpret_cast<const char*>(&(scales_[0])),
+               sizeof(float) * num_rows_);
+    for (MatrixIndexT i = 0; i < num_rows_; i++)
+      os.write(reinterpret_cast<const char*>(
+          &(data_[static_cast<size_t>(i) * stride_])), num_cols_);
+    if (os.fail())
+      KALDI_ERR << "Error writing quantized matrix to stream.";
+  } else {
+    // In text mode, just use the same format as a regular matrix.
+    Matrix<BaseFloat> temp_mat(num_rows_, num_cols_, kUndefined);
+    this->CopyToMat(&temp_mat);
+    temp_mat.Write(os, binary);
+  }
+}
+
+void QuantizedMatrix::Read(std::istream &is, bool binary) {
+  if (binary && Peek(is, binary) == 'Q') {
+    ExpectToken(is, binary, "QM");
+    ReadBasicType(is, binary, &num_rows_);
+    ReadBasicType(is, binary, &num_cols_);
+    if (num_rows_ < 0 || num_cols_ < 0)
+      KALDI_ERR << "Bad dimensions reading quantized matrix.";
+    stride_ = (num_cols_ + 15) / 16 * 16;
+    scales_.resize(num_rows_);
+    data_.clear();
+    data_.resize(static_cast<size_t>(num_rows_) * stride_, 0);
+    if (num_rows_ != 0)
+      is.read(reinterpret_cast<char*>(&(scales_[0])),
+              sizeof(float) * num_rows_);
+    for (MatrixIndexT i = 0; i < num_rows_; i++)
+      is.read(reinterpret_cast<char*>(
+          &(data_[static_cast<size_t>(i) * stride_])), num_cols_);
+    if (is.fail())
+      KALDI_ERR << "Failed to read quantized matrix.";
+  } else {
+    // A regular matrix (always the case in text mode).
+    Matrix<BaseFloat> temp;
+    temp.Read(is, binary);
+    this->CopyFromMat(temp);
+  }
+}
+
+// Instantiate the templates.
+template void QuantizedMatrix::CopyFromMat(const MatrixBase<float> &mat);
+template void QuantizedMatrix::CopyFromMat(const MatrixBase<double> &mat);
+template void QuantizedMatrix::CopyToMat(MatrixBase<float> *mat) const;
+template void QuantizedMatrix::CopyToMat(MatrixBase<double> *mat) const;
+template void QuantizedMatrix::AddMatMatTrans(
+    float alpha, const MatrixBase<float> &A, float beta,
+    MatrixBase<float> *C) const;
+template void QuantizedMatrix::AddMatMatTrans(
+    double alpha, const MatrixBase<double> &A, double beta,
+    MatrixBase<double> *C) const;
+
+}  // namespace kaldi
@@ -0,0 +1,93 @@
+// matrix/quantized-matrix.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_MATRIX_QUANTIZED_MATRIX_H_
+#define KALDI_MATRIX_QUANTIZED_MATRIX_H_ 1
+
+#include <vector>
+#include "matrix/kaldi-matrix.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_group
+/// @{
+
+/// This class stores a matrix in 8 bits per element, for fast inference with
+/// the weight matrices of neural nets.  Each row is stored as signed 8-bit
+/// integers in the range [-127, 127] together with a scale, so element (i, j)
+/// is approximately scale(i) * q(i, j).  Unlike CompressedMatrix, which only
+/// supports copying, it supports multiplication (AddMatMatTrans()) without
+/// decompressing: the other matrix is quantized in the same way, row by row,
+/// and the products are accumulated as integers (with SSE2 if available).
+class QuantizedMatrix {
+ public:
+  QuantizedMatrix(): num_rows_(0), num_cols_(0), stride_(0) { }
+
+  template<typename Real>
+  explicit QuantizedMatrix(const MatrixBase<Real> &mat) { CopyFromMat(mat); }
+
+  /// This will resize *this and copy the contents of mat to *this.
+  template<typename Real>
+  void CopyFromMat(const MatrixBase<Real> &mat);
+
+  /// Note: mat must have the correct size.
+  template<typename Real>
+  void CopyToMat(MatrixBase<Real> *mat) const;
+
+  /// Does C = alpha * A * (*this)^T + beta * C, where A is quantized row by
+  /// row to 8 bits before the multiplication.  The relative error of each
+  /// element of the product is typically around 1%.
+  template<typename Real>
+  void AddMatMatTrans(Real alpha, const MatrixBase<Real> &A, Real beta,
+                      MatrixBase<Real> *C) const;
+
+  MatrixIndexT NumRows() const { return num_rows_; }
+
+  MatrixIndexT NumCols() const { return num_cols_; }
+
+  /// In text mode, this is written as a regular (dequantized) matrix.
+  void Write(std::ostream &os, bool binary) const;
+
+  /// In text mode this reads a regular matrix and quantizes it; in binary
+  /// mode it will also accept a regular matrix.
+  void Read(std::istream &is, bool binary);
+
+ private:
+  // Quantizes "num_cols" elements of "src" into "dest" (which has space for
+  // a multiple of 16 elements, the rest of which are left zero) and returns
+  // the scale.
+  template<typename Real>
+  static float QuantizeRow(const Real *src, MatrixIndexT num_cols,
+                           signed char *dest);
+
+  MatrixIndexT num_rows_;
+  MatrixIndexT num_cols_;
+  MatrixIndexT stride_;  // num_cols_ rounded up to a multiple of 16.
+  std::vector<float> scales_;  // one per row.
+  std::vector<signed char> data_;  // num_rows_ * stride_ elements; padding
+                                   // is zero.
+};
+
+
+/// @} end of \addtogroup matrix_group
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_QUANTIZED_MATRIX_H_
@@ -0,0 +1,83 @@
+// matrix/simd-kernels-avx2.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+// This file is compiled with -mavx2 -mfma (see the Makefile), and its code is
+// only run if the CPU supports them; see simd-kernels.h for what it may
+// include.
+
+#include "matrix/simd-kernels-impl.h"
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+namespace kaldi {
+
+#if defined(__AVX2__) && defined(__FMA__)
+namespace {
+
+struct Avx2 {
+  typedef __m256 V;
+  typedef __m256 M;
+  static const int32 kWidth = 8;
+  static V Set1(float f) { return _mm256_set1_ps(f); }
+  static V Load(const float *x) { return _mm256_loadu_ps(x); }
+  static void Store(float *y, V v) { _mm256_storeu_ps(y, v); }
+  static V Add(V a, V b) { return _mm256_add_ps(a, b); }
+  static V Sub(V a, V b) { return _mm256_sub_ps(a, b); }
+  static V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+  static V Div(V a, V b) { return _mm256_div_ps(a, b); }
+  static V MulAdd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+  static V Max(V a, V b) { return _mm256_max_ps(a, b); }
+  static V Sqrt(V a) { return _mm256_sqrt_ps(a); }
+  static V Floor(V x) { return _mm256_floor_ps(x); }
+  static V Pow2(V n) {
+    __m256i i = _mm256_add_epi32(_mm256_cvttps_epi32(n),
+                                 _mm256_set1_epi32(127));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(i, 23));
+  }
+  static V Exponent(V x) {
+    __m256i i = _mm256_srli_epi32(_mm256_castps_si256(x), 23);
+    return _mm256_cvtepi32_ps(_mm256_sub_epi32(i, _mm256_set1_epi32(126)));
+  }
+  static V Mantissa(V x) {
+    __m256i i = _mm256_and_si256(_mm256_castps_si256(x),
+                                 _mm256_set1_epi32(0x807fffff));
+    return _mm256_castsi256_ps(_mm256_or_si256(i,
+                                               _mm256_set1_epi32(0x3f000000)));
+  }
+  static M CmpLt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static V Select(M m, V a, V b) { return _mm256_blendv_ps(b, a, m); }
+  static bool AllInRange(V x, V lo, V hi) {
+    return _mm256_movemask_ps(_mm256_and_ps(
+        _mm256_cmp_ps(x, lo, _CMP_GE_OQ),
+        _mm256_cmp_ps(x, hi, _CMP_LE_OQ))) == 0xff;
+  }
+};
+
+}  // namespace
+
+bool GetSimdKernelsAvx2(SimdKernels *kernels) {
+  GetKernels<Avx2>("avx2", kernels);
+  return true;
+}
+#else
+bool GetSimdKernelsAvx2(SimdKernels *kernels) { return false; }
+#endif
+
+}  // namespace kaldi
@@ -0,0 +1,84 @@
+// matrix/simd-kernels-avx512.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+// This file is compiled with -mavx512f (see the Makefile), and its code is
+// only run if the CPU supports it; see simd-kernels.h for what it may include.
+
+#include "matrix/simd-kernels-impl.h"
+#ifdef __AVX512F__
+#include <immintrin.h>
+#endif
+
+namespace kaldi {
+
+#ifdef __AVX512F__
+namespace {
+
+struct Avx512 {
+  typedef __m512 V;
+  typedef __mmask16 M;
+  static const int32 kWidth = 16;
+  static V Set1(float f) { return _mm512_set1_ps(f); }
+  static V Load(const float *x) { return _mm512_loadu_ps(x); }
+  static void Store(float *y, V v) { _mm512_storeu_ps(y, v); }
+  static V Add(V a, V b) { return _mm512_add_ps(a, b); }
+  static V Sub(V a, V b) { return _mm512_sub_ps(a, b); }
+  static V Mul(V a, V b) { return _mm512_mul_ps(a, b); }
+  static V Div(V a, V b) { return _mm512_div_ps(a, b); }
+  static V MulAdd(V a, V b, V c) { return _mm512_fmadd_ps(a, b, c); }
+  static V Max(V a, V b) { return _mm512_max_ps(a, b); }
+  static V Sqrt(V a) { return _mm512_sqrt_ps(a); }
+  static V Floor(V x) {
+    return _mm512_roundscale_ps(x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+  }
+  static V Pow2(V n) {
+    __m512i i = _mm512_add_epi32(_mm512_cvttps_epi32(n),
+                                 _mm512_set1_epi32(127));
+    return _mm512_castsi512_ps(_mm512_slli_epi32(i, 23));
+  }
+  static V Exponent(V x) {
+    __m512i i = _mm512_srli_epi32(_mm512_castps_si512(x), 23);
+    return _mm512_cvtepi32_ps(_mm512_sub_epi32(i, _mm512_set1_epi32(126)));
+  }
+  static V Mantissa(V x) {
+    // (the bitwise operations on floats need AVX512DQ, so we use integers.)
+    __m512i i = _mm512_and_si512(_mm512_castps_si512(x),
+                                 _mm512_set1_epi32(0x807fffff));
+    return _mm512_castsi512_ps(_mm512_or_si512(i,
+                                               _mm512_set1_epi32(0x3f000000)));
+  }
+  static M CmpLt(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+  static V Select(M m, V a, V b) { return _mm512_mask_blend_ps(m, b, a); }
+  static bool AllInRange(V x, V lo, V hi) {
+    return (_mm512_cmp_ps_mask(x, lo, _CMP_GE_OQ) &
+            _mm512_cmp_ps_mask(x, hi, _CMP_LE_OQ)) == 0xffff;
+  }
+};
+
+}  // namespace
+
+bool GetSimdKernelsAvx512(SimdKernels *kernels) {
+  GetKernels<Avx512>("avx512", kernels);
+  return true;
+}
+#else
+bool GetSimdKernelsAvx512(SimdKernels *kernels) { return false; }
+#endif
+
+}  // namespace kaldi
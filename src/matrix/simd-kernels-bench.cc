@@ -0,0 +1,79 @@
+// matrix/simd-kernels-bench.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include "matrix/kaldi-vector.h"
+#include "matrix/simd-kernels.h"
+#include "util/kaldi-bench.h"
+
+namespace kaldi {
+
+enum ElementwiseOp { kExp, kLog, kSqrt, kSigmoid, kTanh, kMulElements };
+
+struct ElementwiseBench {
+  ElementwiseBench(ElementwiseOp op, const Vector<BaseFloat> &v):
+      op_(op), v_(v), w_(v.Dim()) { }
+  void operator() () {
+    switch (op_) {
+      case kExp: w_.CopyFromVec(v_); w_.ApplyExp(); break;
+      case kLog: w_.CopyFromVec(v_); w_.ApplyLog(); break;
+      case kSqrt: w_.CopyFromVec(v_); w_.ApplyPow(0.5); break;
+      case kSigmoid: w_.Sigmoid(v_); break;
+      case kTanh: w_.Tanh(v_); break;
+      case kMulElements: w_.CopyFromVec(v_); w_.MulElements(v_); break;
+    }
+  }
+  ElementwiseOp op_;
+  const Vector<BaseFloat> &v_;
+  Vector<BaseFloat> w_;
+};
+
+// Times the elementwise operations of VectorBase<float> with each version of
+// the SIMD kernels this CPU supports.
+void SimdKernelsBenchmark(int32 dim) {
+  Vector<BaseFloat> v(dim);
+  v.SetRandn();
+  v.ApplyAbs();  // so log and sqrt are defined.
+  std::ostringstream params;
+  params << "dim=" << dim;
+  const char *op_names[] = { "ApplyExp", "ApplyLog", "ApplyPow(0.5)",
+                             "Sigmoid", "Tanh", "MulElements" };
+  const char *names[] = { "scalar", "sse2", "avx2", "avx512" };
+  std::string default_name = GetSimdKernels().name;
+  for (int32 op = 0; op < 6; op++) {
+    for (int32 n = 0; n < 4; n++) {
+      if (!SelectSimdKernels(names[n])) continue;
+      ElementwiseBench bench(static_cast<ElementwiseOp>(op), v);
+      PrintBenchmarkResult(std::string("VectorBase::") + op_names[op] + " [" +
+                           names[n] + "]", params.str(),
+                           TimeBenchmark(bench), dim, "elements");
+    }
+  }
+  SelectSimdKernels(default_name);
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  srand(0);
+  SimdKernelsBenchmark(256);
+  SimdKernelsBenchmark(10000);
+  return 0;
+}
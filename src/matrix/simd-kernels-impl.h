@@ -0,0 +1,232 @@
+// matrix/simd-kernels-impl.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_SIMD_KERNELS_IMPL_H_
+#define KALDI_MATRIX_SIMD_KERNELS_IMPL_H_
+
+// This file is only to be included by simd-kernels*.cc.  It contains the
+// kernels of SimdKernels written in terms of a class "Isa" that wraps the
+// intrinsics of one instruction set; it has:
+//   typedefs V (a vector of floats) and M (a mask, the result of a comparison),
+//   kWidth (the number of floats in V),
+//   Set1, Load, Store, Add, Sub, Mul, Div, MulAdd (a * b + c), Max, Sqrt,
+//   Floor, Pow2 (2^n for integer-valued n), Exponent and Mantissa (x = m * 2^e
+//   with m in [0.5, 1), for normal positive x), CmpLt, Select (m ? a : b),
+//   and AllInRange (true if lo <= x <= hi for all elements, so false for NaN).
+// Everything here has internal linkage, as each file that includes it is
+// compiled with different instruction-set flags; see simd-kernels.h.
+
+#include <math.h>
+#include "matrix/simd-kernels.h"
+
+namespace kaldi {
+namespace {
+
+// The scalar versions, which are also used for the ends of the arrays and for
+// the elements the vectorized versions do not handle.
+
+inline float ScalarSigmoid(float x) {
+  // We aim to avoid floating-point overflow here.
+  if (x > 0.0f) {
+    return 1.0f / (1.0f + expf(-x));
+  } else {
+    float ex = expf(x);
+    return ex / (ex + 1.0f);
+  }
+}
+
+inline float ScalarTanh(float x) {
+  if (x > 0.0f) {
+    float inv_expx = expf(-x);
+    return -1.0f + 2.0f / (1.0f + inv_expx * inv_expx);
+  } else {
+    float inv_expx = expf(x);
+    return 1.0f - 2.0f / (1.0f + inv_expx * inv_expx);
+  }
+}
+
+void ScalarExpKernel(const float *x, float *y, int32 n) {
+  for (int32 i = 0; i < n; i++) y[i] = expf(x[i]);
+}
+
+void ScalarLogKernel(const float *x, float *y, int32 n) {
+  for (int32 i = 0; i < n; i++) y[i] = logf(x[i]);
+}
+
+void ScalarSqrtKernel(const float *x, float *y, int32 n) {
+  for (int32 i = 0; i < n; i++) y[i] = sqrtf(x[i]);
+}
+
+void ScalarSigmoidKernel(const float *x, float *y, int32 n) {
+  for (int32 i = 0; i < n; i++) y[i] = ScalarSigmoid(x[i]);
+}
+
+void ScalarTanhKernel(const float *x, float *y, int32 n) {
+  for (int32 i = 0; i < n; i++) y[i] = ScalarTanh(x[i]);
+}
+
+void ScalarMulElementsKernel(const float *x, float *y, int32 n) {
+  for (int32 i = 0; i < n; i++) y[i] *= x[i];
+}
+
+// exp(x) for -87.3 < x < 88.3: exp(x) = 2^n exp(r), with n = round(x / log(2))
+// and exp(r) for |r| <= log(2)/2 approximated by a polynomial.
+template<class Isa>
+inline typename Isa::V VecExp(typename Isa::V x) {
+  typedef typename Isa::V V;
+  const V one = Isa::Set1(1.0f);
+  V n = Isa::Floor(Isa::MulAdd(x, Isa::Set1(1.44269504088896341f),
+                               Isa::Set1(0.5f)));
+  // log(2) is split in two parts, so r = x - n log(2) is accurate.
+  x = Isa::Sub(x, Isa::Mul(n, Isa::Set1(0.693359375f)));
+  x = Isa::Sub(x, Isa::Mul(n, Isa::Set1(-2.12194440e-4f)));
+  V y = Isa::Set1(1.9875691500e-4f);
+  y = Isa::MulAdd(y, x, Isa::Set1(1.3981999507e-3f));
+  y = Isa::MulAdd(y, x, Isa::Set1(8.3334519073e-3f));
+  y = Isa::MulAdd(y, x, Isa::Set1(4.1665795894e-2f));
+  y = Isa::MulAdd(y, x, Isa::Set1(1.6666665459e-1f));
+  y = Isa::MulAdd(y, x, Isa::Set1(5.0000001201e-1f));
+  y = Isa::MulAdd(y, Isa::Mul(x, x), Isa::Add(x, one));
+  return Isa::Mul(y, Isa::Pow2(n));
+}
+
+// log(x) for normal positive x: log(x) = e log(2) + log(m) with m in
+// [sqrt(0.5), sqrt(2)), and log(1 + r) approximated by a polynomial.
+template<class Isa>
+inline typename Isa::V VecLog(typename Isa::V x) {
+  typedef typename Isa::V V;
+  typedef typename Isa::M M;
+  const V one = Isa::Set1(1.0f), zero = Isa::Set1(0.0f);
+  V e = Isa::Exponent(x), m = Isa::Mantissa(x);
+  M small = Isa::CmpLt(m, Isa::Set1(0.707106781186547524f));
+  e = Isa::Sub(e, Isa::Select(small, one, zero));
+  m = Isa::Sub(Isa::Add(m, Isa::Select(small, m, zero)), one);
+  V z = Isa::Mul(m, m);
+  V y = Isa::Set1(7.0376836292e-2f);
+  y = Isa::MulAdd(y, m, Isa::Set1(-1.1514610310e-1f));
+  y = Isa::MulAdd(y, m, Isa::Set1(1.1676998740e-1f));
+  y = Isa::MulAdd(y, m, Isa::Set1(-1.2420140846e-1f));
+  y = Isa::MulAdd(y, m, Isa::Set1(1.4249322787e-1f));
+  y = Isa::MulAdd(y, m, Isa::Set1(-1.6668057665e-1f));
+  y = Isa::MulAdd(y, m, Isa::Set1(2.0000714765e-1f));
+  y = Isa::MulAdd(y, m, Isa::Set1(-2.4999993993e-1f));
+  y = Isa::MulAdd(y, m, Isa::Set1(3.3333331174e-1f));
+  y = Isa::Mul(Isa::Mul(y, m), z);
+  y = Isa::MulAdd(e, Isa::Set1(-2.12194440e-4f), y);
+  y = Isa::MulAdd(z, Isa::Set1(-0.5f), y);
+  return Isa::MulAdd(e, Isa::Set1(0.693359375f), Isa::Add(m, y));
+}
+
+template<class Isa>
+void ExpKernel(const float *x, float *y, int32 n) {
+  typedef typename Isa::V V;
+  const V lo = Isa::Set1(-87.3f), hi = Isa::Set1(88.3f);
+  int32 i = 0;
+  for (; i + Isa::kWidth <= n; i += Isa::kWidth) {
+    V v = Isa::Load(x + i);
+    if (Isa::AllInRange(v, lo, hi)) Isa::Store(y + i, VecExp<Isa>(v));
+    else ScalarExpKernel(x + i, y + i, Isa::kWidth);
+  }
+  ScalarExpKernel(x + i, y + i, n - i);
+}
+
+template<class Isa>
+void LogKernel(const float *x, float *y, int32 n) {
+  typedef typename Isa::V V;
+  // the smallest normal and the largest finite float.
+  const V lo = Isa::Set1(1.17549435e-38f), hi = Isa::Set1(3.40282347e+38f);
+  int32 i = 0;
+  for (; i + Isa::kWidth <= n; i += Isa::kWidth) {
+    V v = Isa::Load(x + i);
+    if (Isa::AllInRange(v, lo, hi)) Isa::Store(y + i, VecLog<Isa>(v));
+    else ScalarLogKernel(x + i, y + i, Isa::kWidth);
+  }
+  ScalarLogKernel(x + i, y + i, n - i);
+}
+
+template<class Isa>
+void SqrtKernel(const float *x, float *y, int32 n) {
+  int32 i = 0;
+  for (; i + Isa::kWidth <= n; i += Isa::kWidth)
+    Isa::Store(y + i, Isa::Sqrt(Isa::Load(x + i)));
+  ScalarSqrtKernel(x + i, y + i, n - i);
+}
+
+template<class Isa>
+void SigmoidKernel(const float *x, float *y, int32 n) {
+  typedef typename Isa::V V;
+  const V lo = Isa::Set1(-80.0f), hi = Isa::Set1(80.0f),
+      one = Isa::Set1(1.0f), zero = Isa::Set1(0.0f);
+  int32 i = 0;
+  for (; i + Isa::kWidth <= n; i += Isa::kWidth) {
+    V v = Isa::Load(x + i);
+    if (Isa::AllInRange(v, lo, hi)) {
+      V e = VecExp<Isa>(Isa::Sub(zero, v));
+      Isa::Store(y + i, Isa::Div(one, Isa::Add(one, e)));
+    } else {
+      ScalarSigmoidKernel(x + i, y + i, Isa::kWidth);
+    }
+  }
+  ScalarSigmoidKernel(x + i, y + i, n - i);
+}
+
+template<class Isa>
+void TanhKernel(const float *x, float *y, int32 n) {
+  typedef typename Isa::V V;
+  const V lo = Isa::Set1(-40.0f), hi = Isa::Set1(40.0f),
+      one = Isa::Set1(1.0f), two = Isa::Set1(2.0f), zero = Isa::Set1(0.0f);
+  int32 i = 0;
+  for (; i + Isa::kWidth <= n; i += Isa::kWidth) {
+    V v = Isa::Load(x + i);
+    if (Isa::AllInRange(v, lo, hi)) {
+      // tanh(|x|) = -1 + 2 / (1 + exp(-2|x|)), as in the scalar version.
+      V minus_abs = Isa::Sub(zero, Isa::Max(v, Isa::Sub(zero, v)));
+      V e = VecExp<Isa>(Isa::Add(minus_abs, minus_abs));
+      V t = Isa::Sub(Isa::Div(two, Isa::Add(one, e)), one);
+      Isa::Store(y + i, Isa::Select(Isa::CmpLt(v, zero), Isa::Sub(zero, t), t));
+    } else {
+      ScalarTanhKernel(x + i, y + i, Isa::kWidth);
+    }
+  }
+  ScalarTanhKernel(x + i, y + i, n - i);
+}
+
+template<class Isa>
+void MulElementsKernel(const float *x, float *y, int32 n) {
+  int32 i = 0;
+  for (; i + Isa::kWidth <= n; i += Isa::kWidth)
+    Isa::Store(y + i, Isa::Mul(Isa::Load(x + i), Isa::Load(y + i)));
+  ScalarMulElementsKernel(x + i, y + i, n - i);
+}
+
+template<class Isa>
+void GetKernels(const char *name, SimdKernels *kernels) {
+  kernels->name = name;
+  kernels->exp = ExpKernel<Isa>;
+  kernels->log = LogKernel<Isa>;
+  kernels->sqrt = SqrtKernel<Isa>;
+  kernels->sigmoid = SigmoidKernel<Isa>;
+  kernels->tanh = TanhKernel<Isa>;
+  kernels->mul_elements = MulElementsKernel<Isa>;
+}
+
+}  // namespace
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_SIMD_KERNELS_IMPL_H_
@@ -0,0 +1,143 @@
+// matrix/simd-kernels.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "matrix/simd-kernels-impl.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace kaldi {
+
+// Defined in simd-kernels-avx2.cc and simd-kernels-avx512.cc; they return
+// false if those files were compiled without the instruction set.
+bool GetSimdKernelsAvx2(SimdKernels *kernels);
+bool GetSimdKernelsAvx512(SimdKernels *kernels);
+
+namespace {
+
+#ifdef __SSE2__
+struct Sse2 {
+  typedef __m128 V;
+  typedef __m128 M;
+  static const int32 kWidth = 4;
+  static V Set1(float f) { return _mm_set1_ps(f); }
+  static V Load(const float *x) { return _mm_loadu_ps(x); }
+  static void Store(float *y, V v) { _mm_storeu_ps(y, v); }
+  static V Add(V a, V b) { return _mm_add_ps(a, b); }
+  static V Sub(V a, V b) { return _mm_sub_ps(a, b); }
+  static V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+  static V Div(V a, V b) { return _mm_div_ps(a, b); }
+  static V MulAdd(V a, V b, V c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+  static V Max(V a, V b) { return _mm_max_ps(a, b); }
+  static V Sqrt(V a) { return _mm_sqrt_ps(a); }
+  static V Floor(V x) {
+    // SSE2 has no floor; truncate and subtract 1 where that rounded up.
+    V t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), _mm_set1_ps(1.0f)));
+  }
+  static V Pow2(V n) {
+    __m128i i = _mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127));
+    return _mm_castsi128_ps(_mm_slli_epi32(i, 23));
+  }
+  static V Exponent(V x) {
+    __m128i i = _mm_srli_epi32(_mm_castps_si128(x), 23);
+    return _mm_cvtepi32_ps(_mm_sub_epi32(i, _mm_set1_epi32(126)));
+  }
+  static V Mantissa(V x) {
+    __m128i i = _mm_and_si128(_mm_castps_si128(x), _mm_set1_epi32(0x807fffff));
+    return _mm_castsi128_ps(_mm_or_si128(i, _mm_set1_epi32(0x3f000000)));
+  }
+  static M CmpLt(V a, V b) { return _mm_cmplt_ps(a, b); }
+  static V Select(M m, V a, V b) {
+    return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+  }
+  static bool AllInRange(V x, V lo, V hi) {
+    return _mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(x, lo),
+                                      _mm_cmple_ps(x, hi))) == 0xf;
+  }
+};
+#endif
+
+bool CpuSupports(const std::string &name) {
+  if (name == "scalar") return true;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  __builtin_cpu_init();
+  if (name == "sse2") return __builtin_cpu_supports("sse2");
+  if (name == "avx2")
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  if (name == "avx512") return __builtin_cpu_supports("avx512f");
+#endif
+  return false;
+}
+
+// Sets *kernels to the version "name" if it is compiled in and the CPU
+// supports it.
+bool GetSimdKernelsByName(const std::string &name, SimdKernels *kernels) {
+  if (!CpuSupports(name)) return false;
+  if (name == "scalar") {
+    kernels->name = "scalar";
+    kernels->exp = ScalarExpKernel;
+    kernels->log = ScalarLogKernel;
+    kernels->sqrt = ScalarSqrtKernel;
+    kernels->sigmoid = ScalarSigmoidKernel;
+    kernels->tanh = ScalarTanhKernel;
+    kernels->mul_elements = ScalarMulElementsKernel;
+    return true;
+  }
+#ifdef __SSE2__
+  if (name == "sse2") {
+    GetKernels<Sse2>("sse2", kernels);
+    return true;
+  }
+#endif
+  if (name == "avx2") return GetSimdKernelsAvx2(kernels);
+  if (name == "avx512") return GetSimdKernelsAvx512(kernels);
+  return false;
+}
+
+SimdKernels g_simd_kernels;
+bool g_simd_kernels_initialized = false;
+
+// Static initialization, so that the selection is done before any threads
+// are started.
+struct SimdKernelsInitializer {
+  SimdKernelsInitializer() { GetSimdKernels(); }
+} simd_kernels_initializer;
+
+}  // namespace
+
+const SimdKernels &GetSimdKernels() {
+  if (!g_simd_kernels_initialized) {
+    const char *names[] = { "avx512", "avx2", "sse2", "scalar" };
+    for (int32 i = 0; i < 4; i++)
+      if (GetSimdKernelsByName(names[i], &g_simd_kernels)) break;
+    g_simd_kernels_initialized = true;
+  }
+  return g_simd_kernels;
+}
+
+bool SelectSimdKernels(const std::string &name) {
+  SimdKernels kernels;
+  if (!GetSimdKernelsByName(name, &kernels)) return false;
+  g_simd_kernels = kernels;
+  g_simd_kernels_initialized = true;
+  return true;
+}
+
+}  // namespace kaldi
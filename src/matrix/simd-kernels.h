@@ -0,0 +1,73 @@
+// matrix/simd-kernels.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_SIMD_KERNELS_H_
+#define KALDI_MATRIX_SIMD_KERNELS_H_
+
+#include <string>
+#include "base/kaldi-types.h"
+
+namespace kaldi {
+
+/*
+  SimdKernels holds the functions that VectorBase<float> (and through it
+  MatrixBase<float>) uses for its elementwise operations: ApplyExp(),
+  ApplyLog(), ApplyPow(0.5), Sigmoid(), Tanh() and MulElements().  There is
+  one version per instruction set (scalar, SSE2, AVX2+FMA and AVX-512), and the
+  fastest one the CPU supports is chosen at run time, so a binary compiled for
+  generic x86-64 still uses AVX2 or AVX-512 where they exist.
+
+  The exp and log are the polynomial approximations of the Cephes library, with
+  a relative error of a few times 1e-7 (the scalar version calls expf() and
+  logf()).  Inputs outside the range where the approximations hold (very large
+  or small values, zeros, infinities and NaNs) are passed to the C library, so
+  the special cases behave exactly as in the scalar code.
+
+  The versions for instruction sets beyond the baseline are in separate files
+  compiled with the corresponding flags (see the Makefile).  Those files must
+  not include any header that defines inline functions they call, as the
+  linker may pick their copy of such a function, compiled for e.g. AVX2, for
+  the whole program; this header only declares things, so it is safe.
+
+  In all the functions, x and y may be the same pointer, but must not
+  otherwise overlap.
+*/
+struct SimdKernels {
+  const char *name;  // "scalar", "sse2", "avx2" or "avx512".
+  void (*exp)(const float *x, float *y, int32 n);  // y = exp(x)
+  void (*log)(const float *x, float *y, int32 n);  // y = log(x)
+  void (*sqrt)(const float *x, float *y, int32 n);  // y = sqrt(x)
+  void (*sigmoid)(const float *x, float *y, int32 n);  // y = 1 / (1 + exp(-x))
+  void (*tanh)(const float *x, float *y, int32 n);  // y = tanh(x)
+  void (*mul_elements)(const float *x, float *y, int32 n);  // y *= x
+};
+
+/// Returns the kernels for the best instruction set this CPU supports (or the
+/// ones chosen by SelectSimdKernels()).
+const SimdKernels &GetSimdKernels();
+
+/// Selects the kernels by name ("scalar", "sse2", "avx2" or "avx512").
+/// Returns false, and changes nothing, if that version is not compiled in or
+/// the CPU does not support it.  This is intended for testing and benchmarking;
+/// it must not be called while other threads use the kernels.
+bool SelectSimdKernels(const std::string &name);
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_SIMD_KERNELS_H_
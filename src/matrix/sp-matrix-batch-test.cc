@@ -0,0 +1,147 @@
+// matrix/sp-matrix-batch-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "matrix/sp-matrix-batch.h"
+#include "matrix/kaldi-matrix.h"
+
+namespace kaldi {
+
+template<typename Real>
+static void InitRandPosDef(MatrixIndexT dim, SpMatrix<Real> *S) {
+  Matrix<Real> M(dim, dim);
+  M.SetRandn();
+  S->Resize(dim);
+  S->AddMat2(1.0, M, kNoTrans, 0.0);
+  for (MatrixIndexT i = 0; i < dim; i++)
+    (*S)(i, i) += 1.0;
+}
+
+// Returns a batch of matrices whose dimensions are such that there are
+// partly filled groups, and some that are processed one by one.
+template<typename Real>
+static void InitBatch(std::vector<SpMatrix<Real>*> *mats) {
+  int32 num_mats = 5 + rand() % 30;
+  for (int32 i = 0; i < num_mats; i++) {
+    MatrixIndexT dim = (i % 7 == 0 ? kMaxInterleavedDim + 1 + rand() % 10 :
+                        1 + rand() % 20);
+    mats->push_back(new SpMatrix<Real>());
+    InitRandPosDef(dim, mats->back());
+  }
+}
+
+template<typename Real>
+static void UnitTestCholeskyBatch() {
+  std::vector<SpMatrix<Real>*> mats;
+  InitBatch(&mats);
+  std::vector<const SpMatrix<Real>*> A(mats.begin(), mats.end());
+  std::vector<TpMatrix<Real>*> L(mats.size());
+  for (size_t i = 0; i < mats.size(); i++)
+    L[i] = new TpMatrix<Real>(mats[i]->NumRows());
+  CholeskyBatch(A, L);
+  for (size_t i = 0; i < mats.size(); i++) {
+    TpMatrix<Real> ref(mats[i]->NumRows());
+    ref.Cholesky(*mats[i]);
+    Matrix<Real> ref_mat(ref), mat(*L[i]);
+    AssertEqual(ref_mat, mat, 0.001);
+    delete L[i];
+    delete mats[i];
+  }
+}
+
+template<typename Real>
+static void UnitTestInvertPosDefBatch() {
+  std::vector<SpMatrix<Real>*> mats;
+  InitBatch(&mats);
+  std::vector<SpMatrix<Real> > orig(mats.size());
+  for (size_t i = 0; i < mats.size(); i++)
+    orig[i] = *mats[i];
+  std::vector<Real> logdet;
+  InvertPosDefBatch(mats, &logdet);
+  KALDI_ASSERT(logdet.size() == mats.size());
+  for (size_t i = 0; i < mats.size(); i++) {
+    SpMatrix<Real> ref(orig[i]);
+    Real ref_logdet;
+    ref.Invert(&ref_logdet);
+    KALDI_ASSERT(ref.ApproxEqual(*mats[i], 0.001));
+    KALDI_ASSERT(ApproxEqual(ref_logdet, logdet[i], 0.001));
+    delete mats[i];
+  }
+}
+
+template<typename Real>
+static void UnitTestSolvePosDefBatch() {
+  std::vector<SpMatrix<Real>*> mats;
+  InitBatch(&mats);
+  std::vector<const SpMatrix<Real>*> A(mats.begin(), mats.end());
+  std::vector<Vector<Real> > b(mats.size());
+  std::vector<Vector<Real> > solutions(mats.size());
+  std::vector<VectorBase<Real>*> x(mats.size());
+  for (size_t i = 0; i < mats.size(); i++) {
+    b[i].Resize(mats[i]->NumRows());
+    b[i].SetRandn();
+    solutions[i] = b[i];
+    x[i] = &(solutions[i]);
+  }
+  SolvePosDefBatch(A, x);
+  for (size_t i = 0; i < mats.size(); i++) {
+    Vector<Real> Ax(b[i].Dim());
+    Ax.AddSpVec(1.0, *mats[i], *x[i], 0.0);
+    AssertEqual(Ax, b[i], 0.001);
+    delete mats[i];
+  }
+}
+
+template<typename Real>
+static void UnitTestBatchNotPosDef() {
+  for (int32 large = 0; large < 2; large++) {
+    MatrixIndexT dim = (large ? kMaxInterleavedDim + 5 : 4);
+    std::vector<SpMatrix<Real>*> mats(3);
+    for (size_t i = 0; i < mats.size(); i++) {
+      mats[i] = new SpMatrix<Real>();
+      InitRandPosDef(dim, mats[i]);
+    }
+    (*mats[1])(dim - 1, dim - 1) = -1.0;
+    bool threw = false;
+    try {
+      InvertPosDefBatch(mats);
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    KALDI_ASSERT(threw);
+    for (size_t i = 0; i < mats.size(); i++)
+      delete mats[i];
+  }
+}
+
+}  // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 5; i++) {
+    UnitTestCholeskyBatch<float>();
+    UnitTestCholeskyBatch<double>();
+    UnitTestInvertPosDefBatch<float>();
+    UnitTestInvertPosDefBatch<double>();
+    UnitTestSolvePosDefBatch<float>();
+    UnitTestSolvePosDefBatch<double>();
+  }
+  UnitTestBatchNotPosDef<double>();
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -0,0 +1,372 @@
+// matrix/sp-matrix-batch.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <map>
+#include "matrix/sp-matrix-batch.h"
+#include "matrix/kaldi-vector.h"
+
+namespace kaldi {
+
+namespace {
+
+// In the "interleaved" format used below, a group of kBatchLanes packed lower
+// triangular (or symmetric) matrices of dimension "dim" is stored so that
+// element (r, c), r >= c, of the l'th matrix is at
+// data[(r * (r + 1) / 2 + c) * kBatchLanes + l], and element r of the l'th
+// vector of a group of vectors is at data[r * kBatchLanes + l].  All the
+// loops over l have a fixed length and contiguous accesses, so they are
+// vectorized.
+
+inline MatrixIndexT PackedOffset(MatrixIndexT r, MatrixIndexT c) {
+  return ((r * (r + 1)) / 2 + c) * kBatchLanes;
+}
+
+// Replaces the symmetric matrices with their Cholesky factors.  Sets
+// failed[l] to true if the l'th matrix is not positive definite (and carries
+// on with a unit pivot, so the other lanes are not affected).
+template<typename Real>
+void InterleavedCholesky(MatrixIndexT dim, Real *data, bool *failed) {
+  Real s[kBatchLanes];
+  for (MatrixIndexT r = 0; r < dim; r++) {
+    Real *row_r = data + PackedOffset(r, 0);
+    for (MatrixIndexT c = 0; c <= r; c++) {
+      const Real *row_c = data + PackedOffset(c, 0);
+      Real *rc = row_r + c * kBatchLanes;
+      for (int32 l = 0; l < kBatchLanes; l++) s[l] = rc[l];
+      for (MatrixIndexT k = 0; k < c; k++) {
+        const Real *rk = row_r + k * kBatchLanes, *ck = row_c + k * kBatchLanes;
+        for (int32 l = 0; l < kBatchLanes; l++) s[l] -= rk[l] * ck[l];
+      }
+      if (c < r) {
+        const Real *cc = row_c + c * kBatchLanes;
+        for (int32 l = 0; l < kBatchLanes; l++) rc[l] = s[l] / cc[l];
+      } else {
+        for (int32 l = 0; l < kBatchLanes; l++) {
+          if (s[l] > 0.0) {
+            rc[l] = std::sqrt(s[l]);
+          } else {
+            failed[l] = true;
+            rc[l] = 1.0;
+          }
+        }
+      }
+    }
+  }
+}
+
+// Adds to logdet[l] the log-determinant of the l'th matrix given its Cholesky
+// factor.
+template<typename Real>
+void InterleavedLogDet(MatrixIndexT dim, const Real *chol, double *logdet) {
+  for (MatrixIndexT r = 0; r < dim; r++) {
+    const Real *rr = chol + PackedOffset(r, r);
+    for (int32 l = 0; l < kBatchLanes; l++)
+      logdet[l] += 2.0 * Log(static_cast<double>(rr[l]));
+  }
+}
+
+// Given the Cholesky factors L, replaces them with (L L^T)^{-1}.  First we
+// invert L in place, column by column from the right (as LAPACK's trti2
+// does), then we form M^T M in place where M = L^{-1} (as lauum does).
+template<typename Real>
+void InterleavedInvertCholesky(MatrixIndexT dim, Real *data) {
+  Real s[kBatchLanes], neg_inv_diag[kBatchLanes];
+  for (MatrixIndexT j = dim - 1; j >= 0; j--) {
+    Real *jj = data + PackedOffset(j, j);
+    for (int32 l = 0; l < kBatchLanes; l++) {
+      jj[l] = 1.0 / jj[l];
+      neg_inv_diag[l] = -jj[l];
+    }
+    // M(i, j) = -M(j, j) \sum_{k=j+1}^i M(i, k) L(k, j).  Going downwards
+    // from the bottom, the L(k, j) we need have not been overwritten yet.
+    for (MatrixIndexT i = dim - 1; i > j; i--) {
+      const Real *row_i = data + PackedOffset(i, 0);
+      for (int32 l = 0; l < kBatchLanes; l++) s[l] = 0.0;
+      for (MatrixIndexT k = j + 1; k <= i; k++) {
+        const Real *ik = row_i + k * kBatchLanes,
+            *kj = data + PackedOffset(k, j);
+        for (int32 l = 0; l < kBatchLanes; l++) s[l] += ik[l] * kj[l];
+      }
+      Real *ij = data + PackedOffset(i, j);
+      for (int32 l = 0; l < kBatchLanes; l++) ij[l] = s[l] * neg_inv_diag[l];
+    }
+  }
+  // X(i, j) = \sum_{k=i}^{dim-1} M(k, i) M(k, j), for j <= i.  This only
+  // needs elements of rows i and below, of which only (i, j) itself is
+  // overwritten, after it has been used.
+  for (MatrixIndexT i = 0; i < dim; i++) {
+    for (MatrixIndexT j = 0; j <= i; j++) {
+      for (int32 l = 0; l < kBatchLanes; l++) s[l] = 0.0;
+      for (MatrixIndexT k = i; k < dim; k++) {
+        const Real *ki = data + PackedOffset(k, i),
+            *kj = data + PackedOffset(k, j);
+        for (int32 l = 0; l < kBatchLanes; l++) s[l] += ki[l] * kj[l];
+      }
+      Real *ij = data + PackedOffset(i, j);
+      for (int32 l = 0; l < kBatchLanes; l++) ij[l] = s[l];
+    }
+  }
+}
+
+// Solves L L^T x = b given the Cholesky factors; "vec" contains b on input
+// and x on output.
+template<typename Real>
+void InterleavedCholeskySolve(MatrixIndexT dim, const Real *chol, Real *vec) {
+  Real s[kBatchLanes];
+  for (MatrixIndexT r = 0; r < dim; r++) {  // Solve L y = b.
+    const Real *row_r = chol + PackedOffset(r, 0);
+    Real *vr = vec + r * kBatchLanes;
+    for (int32 l = 0; l < kBatchLanes; l++) s[l] = vr[l];
+    for (MatrixIndexT k = 0; k < r; k++) {
+      const Real *rk = row_r + k * kBatchLanes, *vk = vec + k * kBatchLanes;
+      for (int32 l = 0; l < kBatchLanes; l++) s[l] -= rk[l] * vk[l];
+    }
+    const Real *rr = row_r + r * kBatchLanes;
+    for (int32 l = 0; l < kBatchLanes; l++) vr[l] = s[l] / rr[l];
+  }
+  for (MatrixIndexT r = dim - 1; r >= 0; r--) {  // Solve L^T x = y.
+    Real *vr = vec + r * kBatchLanes;
+    for (int32 l = 0; l < kBatchLanes; l++) s[l] = vr[l];
+    for (MatrixIndexT k = r + 1; k < dim; k++) {
+      const Real *kr = chol + PackedOffset(k, r), *vk = vec + k * kBatchLanes;
+      for (int32 l = 0; l < kBatchLanes; l++) s[l] -= kr[l] * vk[l];
+    }
+    const Real *rr = chol + PackedOffset(r, r);
+    for (int32 l = 0; l < kBatchLanes; l++) vr[l] = s[l] / rr[l];
+  }
+}
+
+// Copies up to kBatchLanes packed matrices into the interleaved format; the
+// unused lanes are set to the unit matrix so that they stay well defined.
+template<typename Real>
+void InterleaveMatrices(MatrixIndexT dim, const std::vector<const Real*> &src,
+                        Real *dest) {
+  MatrixIndexT size = (dim * (dim + 1)) / 2;
+  int32 num_lanes = src.size();
+  for (int32 l = 0; l < num_lanes; l++)
+    for (MatrixIndexT k = 0; k < size; k++)
+      dest[k * kBatchLanes + l] = src[l][k];
+  for (int32 l = num_lanes; l < kBatchLanes; l++) {
+    for (MatrixIndexT k = 0; k < size; k++) dest[k * kBatchLanes + l] = 0.0;
+    for (MatrixIndexT r = 0; r < dim; r++) dest[PackedOffset(r, r) + l] = 1.0;
+  }
+}
+
+template<typename Real>
+void DeinterleaveMatrices(MatrixIndexT dim, const Real *src,
+                          const std::vector<Real*> &dest) {
+  MatrixIndexT size = (dim * (dim + 1)) / 2;
+  for (size_t l = 0; l < dest.size(); l++)
+    for (MatrixIndexT k = 0; k < size; k++)
+      dest[l][k] = src[k * kBatchLanes + l];
+}
+
+// Puts the indexes of the matrices of dimension <= kMaxInterleavedDim into
+// groups of up to kBatchLanes matrices of the same dimension, and the others
+// into "large".
+void GroupByDim(const std::vector<MatrixIndexT> &dims,
+                std::vector<std::vector<int32> > *groups,
+                std::vector<int32> *large) {
+  std::map<MatrixIndexT, std::vector<int32> > by_dim;
+  for (size_t i = 0; i < dims.size(); i++) {
+    if (dims[i] > kMaxInterleavedDim) large->push_back(i);
+    else if (dims[i] > 0) by_dim[dims[i]].push_back(i);
+  }
+  for (std::map<MatrixIndexT, std::vector<int32> >::const_iterator
+           iter = by_dim.begin(); iter != by_dim.end(); ++iter) {
+    const std::vector<int32> &indexes = iter->second;
+    for (size_t start = 0; start < indexes.size(); start += kBatchLanes) {
+      size_t end = std::min(indexes.size(), start + kBatchLanes);
+      groups->push_back(std::vector<int32>(indexes.begin() + start,
+                                           indexes.begin() + end));
+    }
+  }
+}
+
+// Checks the failure flags of a group.
+void CheckFailed(const std::vector<int32> &group, const bool *failed,
+                 const char *func) {
+  for (size_t l = 0; l < group.size(); l++)
+    if (failed[l])
+      KALDI_ERR << func << ": matrix " << group[l] << " of the batch is not "
+                << "positive definite.";
+}
+
+// Cholesky for the matrices that are processed one by one.
+template<typename Real>
+void CholeskyLarge(const SpMatrix<Real> &A, int32 index, const char *func,
+                   TpMatrix<Real> *L) {
+  try {
+    L->Cholesky(A);
+  } catch (const std::runtime_error &) {
+    KALDI_ERR << func << ": matrix " << index << " of the batch is not "
+              << "positive definite.";
+  }
+}
+
+}  // end anonymous namespace
+
+
+template<typename Real>
+void CholeskyBatch(const std::vector<const SpMatrix<Real>*> &A,
+                   const std::vector<TpMatrix<Real>*> &L) {
+  KALDI_ASSERT(A.size() == L.size());
+  std::vector<MatrixIndexT> dims(A.size());
+  for (size_t i = 0; i < A.size(); i++) {
+    dims[i] = A[i]->NumRows();
+    KALDI_ASSERT(L[i]->NumRows() == dims[i]);
+  }
+  std::vector<std::vector<int32> > groups;
+  std::vector<int32> large;
+  GroupByDim(dims, &groups, &large);
+  std::vector<Real> buffer;
+  for (size_t g = 0; g < groups.size(); g++) {
+    const std::vector<int32> &group = groups[g];
+    MatrixIndexT dim = dims[group[0]];
+    buffer.resize(PackedOffset(dim, 0));
+    std::vector<const Real*> src(group.size());
+    std::vector<Real*> dest(group.size());
+    for (size_t l = 0; l < group.size(); l++) {
+      src[l] = A[group[l]]->Data();
+      dest[l] = L[group[l]]->Data();
+    }
+    InterleaveMatrices(dim, src, &(buffer[0]));
+    bool failed[kBatchLanes] = { false };
+    InterleavedCholesky(dim, &(buffer[0]), failed);
+    CheckFailed(group, failed, "CholeskyBatch");
+    DeinterleaveMatrices(dim, &(buffer[0]), dest);
+  }
+  for (size_t i = 0; i < large.size(); i++)
+    CholeskyLarge(*A[large[i]], large[i], "CholeskyBatch", L[large[i]]);
+}
+
+template<typename Real>
+void InvertPosDefBatch(const std::vector<SpMatrix<Real>*> &A,
+                       std::vector<Real> *logdet) {
+  std::vector<MatrixIndexT> dims(A.size());
+  for (size_t i = 0; i < A.size(); i++)
+    dims[i] = A[i]->NumRows();
+  if (logdet != NULL) logdet->assign(A.size(), 0.0);
+  std::vector<std::vector<int32> > groups;
+  std::vector<int32> large;
+  GroupByDim(dims, &groups, &large);
+  std::vector<Real> buffer;
+  for (size_t g = 0; g < groups.size(); g++) {
+    const std::vector<int32> &group = groups[g];
+    MatrixIndexT dim = dims[group[0]];
+    buffer.resize(PackedOffset(dim, 0));
+    std::vector<const Real*> src(group.size());
+    std::vector<Real*> dest(group.size());
+    for (size_t l = 0; l < group.size(); l++)
+      src[l] = dest[l] = A[group[l]]->Data();
+    InterleaveMatrices(dim, src, &(buffer[0]));
+    bool failed[kBatchLanes] = { false };
+    InterleavedCholesky(dim, &(buffer[0]), failed);
+    CheckFailed(group, failed, "InvertPosDefBatch");
+    if (logdet != NULL) {
+      double group_logdet[kBatchLanes] = { 0.0 };
+      InterleavedLogDet(dim, &(buffer[0]), group_logdet);
+      for (size_t l = 0; l < group.size(); l++)
+        (*logdet)[group[l]] = group_logdet[l];
+    }
+    InterleavedInvertCholesky(dim, &(buffer[0]));
+    DeinterleaveMatrices(dim, &(buffer[0]), dest);
+  }
+  for (size_t i = 0; i < large.size(); i++) {
+    SpMatrix<Real> *mat = A[large[i]];
+    TpMatrix<Real> chol(mat->NumRows());
+    CholeskyLarge(*mat, large[i], "InvertPosDefBatch", &chol);
+    if (logdet != NULL) {
+      double sum = 0.0;
+      for (MatrixIndexT r = 0; r < chol.NumRows(); r++)
+        sum += 2.0 * Log(static_cast<double>(chol(r, r)));
+      (*logdet)[large[i]] = sum;
+    }
+    chol.Invert();
+    mat->AddTp2(1.0, chol, kTrans, 0.0);  // A^{-1} = L^{-T} L^{-1}.
+  }
+}
+
+template<typename Real>
+void SolvePosDefBatch(const std::vector<const SpMatrix<Real>*> &A,
+                      const std::vector<VectorBase<Real>*> &x) {
+  KALDI_ASSERT(A.size() == x.size());
+  std::vector<MatrixIndexT> dims(A.size());
+  for (size_t i = 0; i < A.size(); i++) {
+    dims[i] = A[i]->NumRows();
+    KALDI_ASSERT(x[i]->Dim() == dims[i]);
+  }
+  std::vector<std::vector<int32> > groups;
+  std::vector<int32> large;
+  GroupByDim(dims, &groups, &large);
+  std::vector<Real> buffer, vec_buffer;
+  for (size_t g = 0; g < groups.size(); g++) {
+    const std::vector<int32> &group = groups[g];
+    MatrixIndexT dim = dims[group[0]];
+    buffer.resize(PackedOffset(dim, 0));
+    vec_buffer.assign(dim * kBatchLanes, 0.0);
+    std::vector<const Real*> src(group.size());
+    for (size_t l = 0; l < group.size(); l++) {
+      src[l] = A[group[l]]->Data();
+      const Real *b = x[group[l]]->Data();
+      for (MatrixIndexT r = 0; r < dim; r++)
+        vec_buffer[r * kBatchLanes + l] = b[r];
+    }
+    InterleaveMatrices(dim, src, &(buffer[0]));
+    bool failed[kBatchLanes] = { false };
+    InterleavedCholesky(dim, &(buffer[0]), failed);
+    CheckFailed(group, failed, "SolvePosDefBatch");
+    InterleavedCholeskySolve(dim, &(buffer[0]), &(vec_buffer[0]));
+    for (size_t l = 0; l < group.size(); l++) {
+      Real *v = x[group[l]]->Data();
+      for (MatrixIndexT r = 0; r < dim; r++)
+        v[r] = vec_buffer[r * kBatchLanes + l];
+    }
+  }
+  for (size_t i = 0; i < large.size(); i++) {
+    const SpMatrix<Real> &mat = *A[large[i]];
+    TpMatrix<Real> chol(mat.NumRows());
+    CholeskyLarge(mat, large[i], "SolvePosDefBatch", &chol);
+    chol.Invert();
+    x[large[i]]->MulTp(chol, kNoTrans);  // y = L^{-1} b.
+    x[large[i]]->MulTp(chol, kTrans);  // x = L^{-T} y.
+  }
+}
+
+template
+void CholeskyBatch(const std::vector<const SpMatrix<float>*> &A,
+                   const std::vector<TpMatrix<float>*> &L);
+template
+void CholeskyBatch(const std::vector<const SpMatrix<double>*> &A,
+                   const std::vector<TpMatrix<double>*> &L);
+template
+void InvertPosDefBatch(const std::vector<SpMatrix<float>*> &A,
+                       std::vector<float> *logdet);
+template
+void InvertPosDefBatch(const std::vector<SpMatrix<double>*> &A,
+                       std::vector<double> *logdet);
+template
+void SolvePosDefBatch(const std::vector<const SpMatrix<float>*> &A,
+                      const std::vector<VectorBase<float>*> &x);
+template
+void SolvePosDefBatch(const std::vector<const SpMatrix<double>*> &A,
+                      const std::vector<VectorBase<double>*> &x);
+
+}  // namespace kaldi
@@ -0,0 +1,75 @@
+// matrix/sp-matrix-batch.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_SP_MATRIX_BATCH_H_
+#define KALDI_MATRIX_SP_MATRIX_BATCH_H_
+
+#include <vector>
+#include "matrix/sp-matrix.h"
+#include "matrix/tp-matrix.h"
+
+namespace kaldi {
+
+/// \addtogroup matrix_funcs_misc
+/// @{
+
+/*
+  These functions do the same operation on many small positive definite
+  matrices at once, e.g. the per-Gaussian covariances of a full-covariance GMM
+  or the per-row statistics in an fMLLR or SGMM update.  The matrices may have
+  different dimensions.  Matrices of the same dimension up to
+  kMaxInterleavedDim are processed in groups of kBatchLanes: their packed
+  elements are interleaved so that the innermost loops run over the matrices
+  of a group, which the compiler turns into SIMD instructions.  Larger
+  matrices are processed one by one with the BLAS-based code.
+
+  All of them use the Cholesky decomposition, and call KALDI_ERR (which throws
+  std::runtime_error) if one of the matrices is not positive definite, in
+  which case the outputs are undefined.
+*/
+
+/// Number of matrices processed together by the batched functions.
+const int32 kBatchLanes = 8;
+/// Matrices larger than this are processed one by one.
+const MatrixIndexT kMaxInterleavedDim = 64;
+
+/// Computes the Cholesky factors: (*L[i]) (*L[i])^T = *A[i].  L[i] must have
+/// the same dimension as A[i].
+template<typename Real>
+void CholeskyBatch(const std::vector<const SpMatrix<Real>*> &A,
+                   const std::vector<TpMatrix<Real>*> &L);
+
+/// Inverts each of the matrices in place.  If logdet != NULL, it is resized
+/// to A.size() and (*logdet)[i] is set to the log-determinant of the original
+/// A[i].
+template<typename Real>
+void InvertPosDefBatch(const std::vector<SpMatrix<Real>*> &A,
+                       std::vector<Real> *logdet = NULL);
+
+/// Solves the linear systems A[i] x = b[i]: on input *x[i] is b[i], and on
+/// output it is the solution.
+template<typename Real>
+void SolvePosDefBatch(const std::vector<const SpMatrix<Real>*> &A,
+                      const std::vector<VectorBase<Real>*> &x);
+
+/// @} end of "addtogroup matrix_funcs_misc"
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_SP_MATRIX_BATCH_H_
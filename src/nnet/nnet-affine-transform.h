@@ -139,6 +139,42 @@ class AffineTransform : public UpdatableComponent {
     out->AddMatMat(1.0, in, kNoTrans, linearity_, kTrans, 1.0);
   }
 
+  /// Returns true if PropagateWithActivation() supports an activation
+  /// component of this type.
+  static bool CanFuseActivation(ComponentType activation) {
+    return (activation == kSigmoid || activation == kTanh ||
+            activation == kSoftmax);
+  }
+
+  /// Forward pass of this component followed by an activation component of
+  /// type "activation" (see CanFuseActivation()), for use when not training:
+  /// the bias is added by the kernel that computes the nonlinearity rather
+  /// than in a separate pass, and the affine output is not kept.
+  void PropagateWithActivation(const CuMatrix<BaseFloat> &in,
+                               ComponentType activation,
+                               CuMatrix<BaseFloat> *out) {
+    if (input_dim_ != in.NumCols()) {
+      KALDI_ERR << "Non-matching dims! " << TypeToMarker(GetType())
+                << " input-dim : " << input_dim_ << " data : " << in.NumCols();
+    }
+    out->Resize(in.NumRows(), output_dim_, kUndefined);
+    out->AddMatMat(1.0, in, kNoTrans, linearity_, kTrans, 0.0);
+    switch (activation) {
+      case kSigmoid:
+        out->SigmoidWithBias(*out, bias_);
+        break;
+      case kTanh:
+        out->TanhWithBias(*out, bias_);
+        break;
+      case kSoftmax:
+        out->AddVecToRows(1.0, bias_, 1.0);
+        out->ApplySoftMaxPerRow(*out);
+        break;
+      default:
+        KALDI_ERR << "Cannot fuse activation " << TypeToMarker(activation);
+    }
+  }
+
   void BackpropagateFnc(const CuMatrix<BaseFloat> &in, const CuMatrix<BaseFloat> &out,
                         const CuMatrix<BaseFloat> &out_diff, CuMatrix<BaseFloat> *in_diff) {
     // multiply error derivative by weights
@@ -25,7 +25,7 @@
 
 #include "nnet/nnet-component.h"
 #include "nnet/nnet-various.h"
-#include "cudamatrix/cu-math.h"
+#include "nnet/nnet-pooling-blocks.h"
 
 namespace kaldi {
 namespace nnet1 {
@@ -121,95 +121,43 @@ class AveragePooling2DComponent : public Component {
   }
 
   void PropagateFnc(const CuMatrix<BaseFloat> &in, CuMatrix<BaseFloat> *out) {
-    
-        // useful dims
-    int32 num_input_fmaps = input_dim_ / (fmap_x_len_ * fmap_y_len_);
-    // int32 inp_fmap_size = fmap_x_len_ * fmap_y_len_;
-    // int32 out_fmap_x_len = (fmap_x_len_ - pool_x_len_)/pool_x_step_ + 1;
-    // int32 out_fmap_y_len = (fmap_y_len_ - pool_y_len_)/pool_y_step_ + 1;
-    // int32 out_fmap_size = out_fmap_x_len*out_fmap_y_len;
-    // int32 num_output_fmaps = num_input_fmaps;
-    // int32 num_frames = in.NumRows();
-    
-    int out_fmap_cnt=0;
-    for (int32 m=0; m < fmap_x_len_-pool_x_len_+1;m=m+pool_x_step_){
-      for (int32 n=0; n< fmap_y_len_-pool_y_len_+1; n=n+pool_y_step_){
-	int32 st=0;
-	st=(m*fmap_y_len_+n)*num_input_fmaps;	  
-	CuSubMatrix<BaseFloat> pool(out->ColRange(out_fmap_cnt*num_input_fmaps, num_input_fmaps));
-	pool.SetZero(); // reset
-	for (int32 i=0; i< pool_x_len_; i++){
-	  for (int32 j=0; j< pool_y_len_; j++){
-	    int32 c=0;
-	    c=st+i*(num_input_fmaps*fmap_y_len_)+j*num_input_fmaps;
-	    pool.AddMat(1.0, in.ColRange(c, num_input_fmaps));
-	    }
-	  }
-	pool.Scale(1.0/(pool_x_len_*pool_y_len_));
-	out_fmap_cnt++;
-	}
-      }
+    if (!pooling_.IsInitialized()) InitPooling();
+    // do the average-pooling of all the pools at once
+    pooling_.AveragePool(in, out);
   }
 
   void BackpropagateFnc(const CuMatrix<BaseFloat> &in, const CuMatrix<BaseFloat> &out,
                         const CuMatrix<BaseFloat> &out_diff, CuMatrix<BaseFloat> *in_diff) {
+    if (!pooling_.IsInitialized()) InitPooling();
+    // the diffs are divided by the pool size (derivative of averaging),
+    // and those of patches used in more pools by #pools.
+    pooling_.AveragePoolBackward(out_diff, in_diff);
+  }
 
-    // useful dims
+ private:
+  /// Pools over the pool_x_len_ x pool_y_len_ windows of each feature-map,
+  /// in blocks of num_input_fmaps columns (one per position in the map).
+  void InitPooling() {
     int32 num_input_fmaps = input_dim_ / (fmap_x_len_ * fmap_y_len_);
-    int32 inp_fmap_size = fmap_x_len_ * fmap_y_len_;
-    // int32 out_fmap_x_len = (fmap_x_len_ - pool_x_len_)/pool_x_step_ + 1;
-    // int32 out_fmap_y_len = (fmap_y_len_ - pool_y_len_)/pool_y_step_ + 1;
-    // int32 out_fmap_size = out_fmap_x_len*out_fmap_y_len;
-    // int32 num_output_fmaps = output_dim_ / (out_fmap_x_len * out_fmap_y_len);
-    // int32 num_frames = in.NumRows();
-
-    //
-    // here we note how many diff matrices are summed for each input patch,
-    std::vector<int32> patch_summands(inp_fmap_size, 0);
-    // this metainfo will be used to divide diff of patches 
-    // used in more than one pool.
-    //
-
-    in_diff->SetZero(); // reset
-
-    int out_fmap_cnt=0;
-    for (int32 m=0; m < fmap_x_len_-pool_x_len_+1;m=m+pool_x_step_){
-      for (int32 n=0; n< fmap_y_len_-pool_y_len_+1; n=n+pool_y_step_){
-	int32 st=0;
-	st=(m*fmap_y_len_+n)*num_input_fmaps;	  
-	CuSubMatrix<BaseFloat> src(out_diff.ColRange(out_fmap_cnt*num_input_fmaps, num_input_fmaps));
-	for (int32 i=0; i< pool_x_len_; i++){
-	  for (int32 j=0; j< pool_y_len_; j++){
-	    int32 c=0;
-	    c=st+i*(num_input_fmaps*fmap_y_len_)+j*num_input_fmaps;
-	    CuSubMatrix<BaseFloat> tgt(in_diff->ColRange(c, num_input_fmaps));
-	    tgt.AddMat(1.0, src);
-	    patch_summands[c/num_input_fmaps] += 1;
-	    }
-	  }
-	out_fmap_cnt++;
-	}
-      }
-    
-    // divide diff by average-pooling-dim (derivative of averaging)
-    in_diff->Scale(1.0/(pool_x_len_*pool_y_len_));
-
-    // divide diff by #summands (compensate for patches used in more pools)
-    for (int i=0; i<fmap_x_len_; i++){
-      for (int32 j=0; j<fmap_y_len_; j++){
-	int32 c=i*fmap_y_len_+j;
-	CuSubMatrix<BaseFloat> tgt(in_diff->ColRange(c*num_input_fmaps, num_input_fmaps));
-	KALDI_ASSERT(patch_summands[c] > 0); // patch at least in one pool
-	tgt.Scale(1.0/patch_summands[c]);
+    std::vector<std::vector<int32> > pools;
+    for (int32 m = 0; m < fmap_x_len_-pool_x_len_+1; m = m+pool_x_step_) {
+      for (int32 n = 0; n < fmap_y_len_-pool_y_len_+1; n = n+pool_y_step_) {
+        std::vector<int32> pool;
+        for (int32 i = 0; i < pool_x_len_; i++)
+          for (int32 j = 0; j < pool_y_len_; j++)
+            pool.push_back((m+i)*fmap_y_len_ + n+j);
+        pools.push_back(pool);
       }
     }
+    pooling_.Init(pools, fmap_x_len_ * fmap_y_len_, num_input_fmaps);
   }
 
- private:
   int32 fmap_x_len_, fmap_y_len_,
     pool_x_len_, pool_y_len_,
     pool_x_step_, pool_y_step_;
 
+  PoolingBlocks pooling_;
+
 };
 
 } // namespace nnet1
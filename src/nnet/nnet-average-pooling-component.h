@@ -24,7 +24,7 @@
 
 #include "nnet/nnet-component.h"
 #include "nnet/nnet-various.h"
-#include "cudamatrix/cu-math.h"
+#include "nnet/nnet-pooling-blocks.h"
 
 namespace kaldi {
 namespace nnet1 {
@@ -96,63 +96,37 @@ class AveragePoolingComponent : public Component {
   }
 
   void PropagateFnc(const CuMatrix<BaseFloat> &in, CuMatrix<BaseFloat> *out) {
-    // useful dims
-    int32 num_patches = input_dim_ / pool_stride_;
-    int32 num_pools = 1 + (num_patches - pool_size_) / pool_step_;
-
-    // do the average-pooling (pools indexed by q)
-    for (int32 q = 0; q < num_pools; q++) {
-      // get output buffer of the pool
-      CuSubMatrix<BaseFloat> pool(out->ColRange(q*pool_stride_, pool_stride_));
-      pool.SetZero(); // reset
-      for (int32 r = 0; r < pool_size_; r++) { // sum
-        int32 p = r + q * pool_step_; // p = input patch
-        pool.AddMat(1.0, in.ColRange(p*pool_stride_, pool_stride_));
-      }
-      pool.Scale(1.0 / pool_size_); // divide by #summands
-    }
+    if (!pooling_.IsInitialized()) InitPooling();
+    // do the average-pooling of all the pools at once
+    pooling_.AveragePool(in, out);
   }
 
   void BackpropagateFnc(const CuMatrix<BaseFloat> &in, const CuMatrix<BaseFloat> &out,
                         const CuMatrix<BaseFloat> &out_diff, CuMatrix<BaseFloat> *in_diff) {
-    // useful dims
+    if (!pooling_.IsInitialized()) InitPooling();
+    // the diffs are divided by the pool size (derivative of averaging),
+    // and those of patches used in more pools by #pools.
+    pooling_.AveragePoolBackward(out_diff, in_diff);
+  }
+
+ private:
+  /// Pool q is over the input patches q*pool_step_ ... q*pool_step_+pool_size_-1,
+  /// in blocks of pool_stride_ columns.
+  void InitPooling() {
     int32 num_patches = input_dim_ / pool_stride_;
     int32 num_pools = 1 + (num_patches - pool_size_) / pool_step_;
-
-    //
-    // here we note how many diff matrices are summed for each input patch,
-    std::vector<int32> patch_summands(num_patches, 0);
-    // this metainfo will be used to divide diff of patches 
-    // used in more than one pool.
-    //
-    
-    in_diff->SetZero(); // reset
-
-    for(int32 q=0; q<num_pools; q++) { // sum
-      for(int32 r=0; r<pool_size_; r++) {
-        int32 p = r + q * pool_step_;
-        CuSubMatrix<BaseFloat> tgt(in_diff->ColRange(p*pool_stride_, pool_stride_));
-        CuSubMatrix<BaseFloat> src(out_diff.ColRange(q*pool_stride_, pool_stride_));
-        tgt.AddMat(1.0, src);
-        patch_summands[p] += 1;
-      }
-    }
-
-    // divide diff by average-pooling-dim (derivative of averaging)
-    in_diff->Scale(1.0 / pool_size_);
-
-    // divide diff by #summands (compensate for patches used in more pools)
-    for(int32 p=0; p<num_patches; p++) {
-      CuSubMatrix<BaseFloat> tgt(in_diff->ColRange(p*pool_stride_, pool_stride_));
-      KALDI_ASSERT(patch_summands[p] > 0); // patch at least in one pool
-      tgt.Scale(1.0/patch_summands[p]);
-    }
+    std::vector<std::vector<int32> > pools(num_pools);
+    for (int32 q = 0; q < num_pools; q++)
+      for (int32 r = 0; r < pool_size_; r++)
+        pools[q].push_back(r + q * pool_step_); // p = input patch
+    pooling_.Init(pools, num_patches, pool_stride_);
   }
 
- private:
   int32 pool_size_,   // input patches used for pooling
         pool_step_,   // shift used for pooling (allow overlapping pools)
         pool_stride_; // stride used to cut input matrix to a vector of matrices
+
+  PoolingBlocks pooling_;
 };
 
 } // namespace nnet1
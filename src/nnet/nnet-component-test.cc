@@ -26,6 +26,7 @@
 #include "nnet/nnet-max-pooling-component.h"
 #include "nnet/nnet-max-pooling-2d-component.h"
 #include "nnet/nnet-average-pooling-2d-component.h"
+#include "nnet/nnet-parallel-component.h"
 #include "util/common-utils.h"
 
 #include <sstream>
@@ -68,6 +69,50 @@ namespace nnet1 {
     delete c;
   }
 
+  void UnitTestConvolutionalComponentOverlap() {
+    // 2 spliced frames of 3 bands, 2 overlapping patches of 2 bands,
+    ConvolutionalComponent* c = new ConvolutionalComponent(6,2);
+
+    std::string comp_data_str = "<PatchDim> 2 <PatchStep> 1 <PatchStride> 3 <Filters> [ 1 1 1 1 \n] <Bias> [ 0.5 ]\n";
+    std::istringstream is_comp_data(comp_data_str);
+    c->ReadData(is_comp_data, false);
+
+    Matrix<BaseFloat> mat_in_host(2, 6);
+    for (int32 r = 0; r < 2; r++)
+      for (int32 i = 0; i < 6; i++)
+        mat_in_host(r, i) = (r + 1) * (i + 1);
+    CuMatrix<BaseFloat> mat_in(mat_in_host);
+
+    // propagate, patches are the input columns {0,1,3,4} and {1,2,4,5}
+    CuMatrix<BaseFloat> mat_out;
+    c->Propagate(mat_in,&mat_out);
+    Matrix<BaseFloat> mat_out_ref(2, 2);
+    for (int32 r = 0; r < 2; r++) {
+      mat_out_ref(r, 0) = 0.5 + 12 * (r + 1);
+      mat_out_ref(r, 1) = 0.5 + 16 * (r + 1);
+    }
+    KALDI_LOG << "mat_in" << mat_in << "mat_out" << mat_out;
+    CuMatrix<BaseFloat> mat_out_ref_cu(mat_out_ref);
+    AssertEqual(mat_out_ref_cu, mat_out);
+
+    // backpropagate, the derivatives of shared inputs are averaged
+    Matrix<BaseFloat> mat_out_diff_host(2, 2);
+    mat_out_diff_host.Row(0).Set(1.0);
+    mat_out_diff_host(1, 0) = 1.0;
+    mat_out_diff_host(1, 1) = 2.0;
+    CuMatrix<BaseFloat> mat_out_diff(mat_out_diff_host), mat_in_diff;
+    c->Backpropagate(mat_in, mat_out, mat_out_diff, &mat_in_diff);
+    Matrix<BaseFloat> mat_in_diff_ref(2, 6);
+    mat_in_diff_ref.Row(0).Set(1.0);
+    BaseFloat row1[6] = { 1.0, 1.5, 2.0, 1.0, 1.5, 2.0 };
+    for (int32 i = 0; i < 6; i++) mat_in_diff_ref(1, i) = row1[i];
+    KALDI_LOG << "mat_out_diff " << mat_out_diff << " mat_in_diff " << mat_in_diff;
+    CuMatrix<BaseFloat> mat_in_diff_ref_cu(mat_in_diff_ref);
+    AssertEqual(mat_in_diff_ref_cu, mat_in_diff);
+
+    delete c;
+  }
+
   void UnitTestMaxPooling2DComponent(){
     std::string dim_str;
 
@@ -245,6 +290,75 @@ namespace nnet1 {
     
   }
 
+  void UnitTestFeedforwardFused() {
+    // Feedforward() combines each AffineTransform with the following
+    // activation; check it against Propagate(), which does not.
+    Nnet nnet;
+    nnet.AppendComponent(Component::Init(
+        "<AffineTransform> <InputDim> 10 <OutputDim> 12 <ParamStddev> 0.5"));
+    nnet.AppendComponent(Component::Init("<Sigmoid> <InputDim> 12 <OutputDim> 12"));
+    nnet.AppendComponent(Component::Init(
+        "<AffineTransform> <InputDim> 12 <OutputDim> 9 <ParamStddev> 0.5"));
+    nnet.AppendComponent(Component::Init("<Tanh> <InputDim> 9 <OutputDim> 9"));
+    nnet.AppendComponent(Component::Init(
+        "<AffineTransform> <InputDim> 9 <OutputDim> 7 <ParamStddev> 0.5"));
+    nnet.AppendComponent(Component::Init("<Softmax> <InputDim> 7 <OutputDim> 7"));
+
+    Nnet nnet_copy(nnet);  // has the buffers that Propagate() needs.
+    CuMatrix<BaseFloat> in(20, 10), out_fused, out_ref;
+    in.SetRandn();
+    nnet.Feedforward(in, &out_fused);
+    nnet_copy.Propagate(in, &out_ref);
+    AssertEqual(out_fused, out_ref);
+
+    // a single un-fused component at the end.
+    nnet.RemoveLastComponent();
+    nnet_copy.RemoveLastComponent();
+    nnet.Feedforward(in, &out_fused);
+    nnet_copy.Propagate(in, &out_ref);
+    AssertEqual(out_fused, out_ref);
+  }
+
+  void UnitTestParallelComponent() {
+    // The nested nnets see column ranges of the input and write column ranges
+    // of the output; check against running them one by one.
+    Nnet nnets[3];
+    int32 dims[3][2] = { { 5, 4 }, { 3, 6 }, { 7, 2 } };
+    std::ostringstream os;
+    os << "<ParallelComponent> 12 15 <NestedNnetCount> 3 ";  // out, in dims.
+    for (int32 i = 0; i < 3; i++) {
+      std::ostringstream affine;
+      affine << "<AffineTransform> <InputDim> " << dims[i][0]
+             << " <OutputDim> " << dims[i][1] << " <ParamStddev> 0.5";
+      nnets[i].AppendComponent(Component::Init(affine.str()));
+      std::ostringstream sigmoid;
+      sigmoid << "<Sigmoid> <InputDim> " << dims[i][1]
+              << " <OutputDim> " << dims[i][1];
+      nnets[i].AppendComponent(Component::Init(sigmoid.str()));
+      os << "<NestedNnet> " << (i + 1) << " ";
+      nnets[i].Write(os, false);
+    }
+    os << "</ParallelComponent>\n";
+    std::istringstream is(os.str());
+    Component *c = Component::Read(is, false);
+    KALDI_ASSERT(c->GetType() == Component::kParallelComponent);
+
+    CuMatrix<BaseFloat> in(20, 15), out, out_ref(20, 12);
+    in.SetRandn();
+    c->Propagate(in, &out);
+    for (int32 i = 0, in_offset = 0, out_offset = 0; i < 3; i++) {
+      Nnet nnet_copy(nnets[i]);  // has the buffers that Propagate() needs.
+      CuMatrix<BaseFloat> part_in(in.ColRange(in_offset, dims[i][0])),
+          part_out;
+      nnet_copy.Propagate(part_in, &part_out);
+      out_ref.ColRange(out_offset, dims[i][1]).CopyFromMat(part_out);
+      in_offset += dims[i][0];
+      out_offset += dims[i][1];
+    }
+    AssertEqual(out, out_ref);
+    delete c;
+  }
+
   void UnitTestMatOperations(){
     //    CuMatrix<BaseFloat> A;
 
@@ -331,7 +445,10 @@ int main() {
 #endif
     // unit-tests :
     UnitTestConvolutionalComponent();
+    UnitTestConvolutionalComponentOverlap();
     UnitTestMaxPoolingComponent();
+    UnitTestFeedforwardFused();
+    UnitTestParallelComponent();
     // UnitTestConvolutional2DComponent();
     // UnitTestMatOperations();
     // UnitTestMaxPooling2DComponent();
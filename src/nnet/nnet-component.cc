@@ -24,6 +24,7 @@
 #include "nnet/nnet-kl-hmm.h"
 #include "nnet/nnet-affine-transform.h"
 #include "nnet/nnet-affine-transform-nobias.h"
+#include "nnet/nnet-quantized-affine-transform.h"
 #include "nnet/nnet-rbm.h"
 #include "nnet/nnet-various.h"
 #include "nnet/nnet-kl-hmm.h"
@@ -59,6 +60,7 @@ const struct Component::key_value Component::kMarkerMap[] = {
   { Component::kCopy,"<Copy>" },
   { Component::kAddShift,"<AddShift>" },
   { Component::kRescale,"<Rescale>" },
+  { Component::kQuantizedAffineTransform,"<QuantizedAffineTransform>" },
   { Component::kKlHmm,"<KlHmm>" },
   { Component::kAveragePoolingComponent,"<AveragePoolingComponent>"},
   { Component::kAveragePooling2DComponent,"<AveragePooling2DComponent>"},
@@ -139,6 +141,9 @@ Component* Component::NewComponentOfType(ComponentType comp_type,
     case Component::kRescale :
       ans = new Rescale(input_dim, output_dim);
       break;
+    case Component::kQuantizedAffineTransform :
+      ans = new QuantizedAffineTransform(input_dim, output_dim);
+      break;
     case Component::kKlHmm :
       ans = new KlHmm(input_dim, output_dim);
       break;
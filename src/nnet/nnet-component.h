@@ -28,6 +28,7 @@
 #include "cudamatrix/cu-matrix.h"
 #include "cudamatrix/cu-vector.h"
 #include "nnet/nnet-trnopts.h"
+#include "util/kaldi-profile.h"
 
 #include <iostream>
 
@@ -69,6 +70,7 @@ class Component {
     kBlockLinearity,
     kAddShift,
     kRescale,
+    kQuantizedAffineTransform,
     
     kKlHmm = 0x0800,
     kSentenceAveragingComponent,
@@ -218,6 +220,9 @@ inline void Component::Propagate(const CuMatrix<BaseFloat> &in,
     KALDI_ERR << "Non-matching dims! " << TypeToMarker(GetType()) 
               << " input-dim : " << input_dim_ << " data : " << in.NumCols();
   }
+  KALDI_PROFILE_SCOPE_DYNAMIC(
+      std::string(TypeToMarker(GetType())) + "::Propagate",
+      "in=" + ProfileDims(in.NumRows(), in.NumCols()));
   // Allocate target buffer
   out->Resize(in.NumRows(), output_dim_, kSetZero); // reset
   // Call the propagation implementation of the component
@@ -234,6 +239,9 @@ inline void Component::Backpropagate(const CuMatrix<BaseFloat> &in,
     KALDI_ERR << "Non-matching output dims, component:" << output_dim_ 
               << " data:" << out_diff.NumCols();
   }
+  KALDI_PROFILE_SCOPE_DYNAMIC(
+      std::string(TypeToMarker(GetType())) + "::Backpropagate",
+      "out_diff=" + ProfileDims(out_diff.NumRows(), out_diff.NumCols()));
   
   // Target buffer NULL : backpropagate only through components with nested nnets.
   if (in_diff == NULL) {
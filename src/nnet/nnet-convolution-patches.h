@@ -0,0 +1,154 @@
+// nnet/nnet-convolution-patches.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_NNET_NNET_CONVOLUTION_PATCHES_H_
+#define KALDI_NNET_NNET_CONVOLUTION_PATCHES_H_
+
+#include <vector>
+
+#include "cudamatrix/cu-matrix.h"
+#include "cudamatrix/cu-vector.h"
+#include "cudamatrix/cu-array.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+/**
+ * ConvolutionPatches does the data re-arrangement for the convolutional
+ * components, so that the convolution over all the patch positions is a
+ * single large matrix multiplication ("im2col").
+ *
+ * The input features of a minibatch are re-shaped into a 'patch matrix'
+ * with one vectorized patch per row, where the rows
+ * p*num_frames ... (p+1)*num_frames-1 are the patches at position p.
+ * Multiplying it by the transposed filter matrix gives the filter
+ * activations of all the positions at once, in the same 'stacked' layout,
+ * and StackColumnBlocks() / UnstackColumnBlocks() convert between that and
+ * the layout of the component output (position-major blocks of columns).
+ *
+ * The patches are described by a column map: column_map[p * patch_dim + d]
+ * is the input column of element d of the patch at position p.
+ */
+class ConvolutionPatches {
+ public:
+  ConvolutionPatches(): num_patches_(0), patch_dim_(0) { }
+
+  /// Sets up the patches, see the class comment.
+  void Init(const std::vector<int32> &column_map, int32 num_patches,
+            int32 input_dim) {
+    KALDI_ASSERT(num_patches > 0 && column_map.size() % num_patches == 0);
+    num_patches_ = num_patches;
+    patch_dim_ = column_map.size() / num_patches;
+    column_map_ = column_map;
+    // For the backward pass, we sort the elements of all the patches by the
+    // input column they were copied from, so the derivative w.r.t. each
+    // input column is the sum of a contiguous range of columns.
+    std::vector<std::vector<int32> > elements(input_dim);
+    for (size_t i = 0; i < column_map.size(); i++) {
+      KALDI_ASSERT(column_map[i] >= 0 && column_map[i] < input_dim);
+      elements[column_map[i]].push_back(i);
+    }
+    std::vector<int32> sorted_elements;
+    std::vector<Int32Pair> ranges(input_dim);
+    Vector<BaseFloat> inv_counts(input_dim);
+    for (int32 c = 0; c < input_dim; c++) {
+      ranges[c].first = sorted_elements.size();
+      sorted_elements.insert(sorted_elements.end(), elements[c].begin(),
+                             elements[c].end());
+      ranges[c].second = sorted_elements.size();
+      // columns not used by any patch get zero derivative
+      if (!elements[c].empty())
+        inv_counts(c) = 1.0 / elements[c].size();
+    }
+    sorted_elements_ = sorted_elements;
+    input_ranges_ = ranges;
+    inv_counts_ = inv_counts;
+  }
+
+  bool IsInitialized() const { return num_patches_ > 0; }
+  int32 NumPatches() const { return num_patches_; }
+  int32 PatchDim() const { return patch_dim_; }
+
+  /// Forms the patch matrix of 'in' (im2col), of dimension
+  /// [num_patches * num_frames][patch_dim].
+  void GetPatches(const CuMatrixBase<BaseFloat> &in,
+                  CuMatrix<BaseFloat> *patches) {
+    all_patches_.Resize(in.NumRows(), column_map_.Dim(), kUndefined);
+    all_patches_.CopyCols(in, column_map_);
+    StackColumnBlocks(all_patches_, num_patches_, patches);
+  }
+
+  /// The reverse of GetPatches() for the derivatives (col2im): sets each
+  /// column of 'in_diff' to the average of the elements of 'patch_diffs'
+  /// that correspond to that input column (averaged, rather than summed,
+  /// as the weights are shared).
+  void AveragePatchDiffs(const CuMatrixBase<BaseFloat> &patch_diffs,
+                         CuMatrixBase<BaseFloat> *in_diff) {
+    int32 num_frames = in_diff->NumRows();
+    all_patches_.Resize(num_frames, column_map_.Dim(), kUndefined);
+    UnstackColumnBlocks(patch_diffs, num_patches_, &all_patches_);
+    sorted_patches_.Resize(num_frames, column_map_.Dim(), kUndefined);
+    sorted_patches_.CopyCols(all_patches_, sorted_elements_);
+    in_diff->SumColumnRanges(sorted_patches_, input_ranges_);
+    in_diff->MulColsVec(inv_counts_);
+  }
+
+  /// Splits 'in' into 'num_blocks' equal blocks of columns, and stacks them
+  /// vertically in 'out' (first block at the top).
+  static void StackColumnBlocks(const CuMatrixBase<BaseFloat> &in,
+                                int32 num_blocks, CuMatrix<BaseFloat> *out) {
+    KALDI_ASSERT(in.NumCols() % num_blocks == 0);
+    int32 num_rows = in.NumRows(), block_dim = in.NumCols() / num_blocks;
+    out->Resize(num_blocks * num_rows, block_dim, kUndefined);
+    for (int32 b = 0; b < num_blocks; b++)
+      out->RowRange(b * num_rows, num_rows).CopyFromMat(
+          in.ColRange(b * block_dim, block_dim));
+  }
+
+  /// The reverse of StackColumnBlocks(); 'out' must have the right size.
+  static void UnstackColumnBlocks(const CuMatrixBase<BaseFloat> &in,
+                                  int32 num_blocks,
+                                  CuMatrixBase<BaseFloat> *out) {
+    int32 num_rows = out->NumRows(), block_dim = in.NumCols();
+    KALDI_ASSERT(in.NumRows() == num_blocks * num_rows &&
+                 out->NumCols() == num_blocks * block_dim);
+    for (int32 b = 0; b < num_blocks; b++)
+      out->ColRange(b * block_dim, block_dim).CopyFromMat(
+          in.RowRange(b * num_rows, num_rows));
+  }
+
+ private:
+  int32 num_patches_, patch_dim_;
+  CuArray<int32> column_map_;
+  /// Indexes into column_map_, ordered by input column.
+  CuArray<int32> sorted_elements_;
+  /// For each input column, its range in sorted_elements_.
+  CuArray<Int32Pair> input_ranges_;
+  /// For each input column, 1 / (number of patch elements copied from it).
+  CuVector<BaseFloat> inv_counts_;
+
+  /// Buffers, [num_frames][num_patches * patch_dim].
+  CuMatrix<BaseFloat> all_patches_, sorted_patches_;
+};
+
+} // namespace nnet1
+} // namespace kaldi
+
+#endif
@@ -25,6 +25,7 @@
 
 #include "nnet/nnet-component.h"
 #include "nnet/nnet-various.h"
+#include "nnet/nnet-convolution-patches.h"
 #include "cudamatrix/cu-math.h"
 
 namespace kaldi {
@@ -47,9 +48,10 @@ namespace nnet1 {
  * In order to have a fast implementations, the filters 
  * are represented in vectorized form, where each rectangular
  * filter corresponds to a row in a matrix, where all filters 
- * are stored. The features are then re-shaped to a set of matrices, 
- * where one matrix corresponds to single patch-position, 
- * where the filters get applied.
+ * are stored. The features are then re-shaped to a single matrix
+ * with one patch per row, where the patch-positions are stacked
+ * vertically, so all the filters are applied at all the positions
+ * by one matrix multiplication (see ConvolutionPatches).
  * 
  * The type of convolution is controled by hyperparameters:
  * x_patch_dim_,y_patch_dim_     ... temporal and frequency axes sizes of the patch (e.g. (9,9) for 9x9 2D filter)
@@ -242,53 +244,44 @@ class Convolutional2DComponent : public UpdatableComponent {
     int32 num_filters = filters_.NumRows(); // this is total num_filters, so each input_fmap has num_filters/num_input_fmaps
     KALDI_ASSERT(num_filters == num_output_fmaps);
     // int32 filter_size = filt_x_len_*filt_y_len_;
-    int32 num_frames = in.NumRows();
-    
-    // we will need the buffers 
-    if (vectorized_feature_patches_.size() == 0) {
-      vectorized_feature_patches_.resize(out_fmap_size);
-      feature_patch_diffs_.resize(out_fmap_size);
-    }
-
-    for (int32 p=0; p<out_fmap_size; p++){
-      vectorized_feature_patches_[p].Resize(num_frames, filters_.NumCols());
-    }
     
     // Checked for num_input_fmaps=1, check for num_inp_fmaps>1
-    int32 out_fmap_cnt=0;
-    for (int32 m=0; m < fmap_x_len_-filt_x_len_+1;m=m+filt_x_step_){
-      for (int32 n=0; n< fmap_y_len_-filt_y_len_+1; n=n+filt_y_step_){
-	std::vector<int32> column_mask;
-	int32 st=0;
-	if (connect_fmap_ == 1){
-	  st=(m*fmap_y_len_+n)*num_input_fmaps;	  
-	}
-	else{
-	  st=m*fmap_y_len_*num_input_fmaps + n;
-	}
-
-	for (int32 i=0; i< filt_x_len_; i++){
-	  for (int32 j=0; j< filt_y_len_*num_input_fmaps; j++){
-	    int32 c=0;
-	    if (connect_fmap_ == 1){	    
-	      c=st+i*(num_input_fmaps*fmap_y_len_)+j;
-	    }
-	    else{
-	      c=st+i*(num_input_fmaps*fmap_y_len_)+(j/num_input_fmaps)+(j%num_input_fmaps)*fmap_y_len_;
-	    }
-	    column_mask.push_back(c);
-	  }
-	}
-	vectorized_feature_patches_[out_fmap_cnt].CopyCols(in, column_mask);
-	out_fmap_cnt++;
+    if (!patches_.IsInitialized()) {
+      std::vector<int32> column_map;
+      for (int32 m=0; m < fmap_x_len_-filt_x_len_+1;m=m+filt_x_step_){
+        for (int32 n=0; n< fmap_y_len_-filt_y_len_+1; n=n+filt_y_step_){
+          int32 st=0;
+          if (connect_fmap_ == 1){
+            st=(m*fmap_y_len_+n)*num_input_fmaps;
+          }
+          else{
+            st=m*fmap_y_len_*num_input_fmaps + n;
+          }
+
+          for (int32 i=0; i< filt_x_len_; i++){
+            for (int32 j=0; j< filt_y_len_*num_input_fmaps; j++){
+              int32 c=0;
+              if (connect_fmap_ == 1){
+                c=st+i*(num_input_fmaps*fmap_y_len_)+j;
+              }
+              else{
+                c=st+i*(num_input_fmaps*fmap_y_len_)+(j/num_input_fmaps)+(j%num_input_fmaps)*fmap_y_len_;
+              }
+              column_map.push_back(c);
+            }
+          }
+        }
       }
+      KALDI_ASSERT(column_map.size() == out_fmap_size * filters_.NumCols());
+      patches_.Init(column_map, out_fmap_size, input_dim_);
     }
+    // all the patch-positions are stacked vertically
+    patches_.GetPatches(in, &vectorized_feature_patches_);
 
-    for (int32 p=0; p<out_fmap_size; p++){
-      CuSubMatrix<BaseFloat> tgt(out->ColRange(p*num_filters, num_filters));
-      tgt.AddVecToRows(1.0, bias_, 0.0);
-      tgt.AddMatMat(1.0, vectorized_feature_patches_[p], kNoTrans, filters_, kTrans, 1.0);
-    }
+    patch_out_.Resize(vectorized_feature_patches_.NumRows(), num_filters, kUndefined);
+    patch_out_.AddVecToRows(1.0, bias_, 0.0);
+    patch_out_.AddMatMat(1.0, vectorized_feature_patches_, kNoTrans, filters_, kTrans, 1.0);
+    ConvolutionPatches::UnstackColumnBlocks(patch_out_, out_fmap_size, out);
   }
 
 
@@ -296,73 +289,28 @@ class Convolutional2DComponent : public UpdatableComponent {
                         const CuMatrix<BaseFloat> &out_diff, CuMatrix<BaseFloat> *in_diff) {
 
     // useful dims
-    int32 num_input_fmaps = input_dim_ / (fmap_x_len_ * fmap_y_len_);
-    // int32 inp_fmap_size = fmap_x_len_ * fmap_y_len_;
     int32 out_fmap_x_len = (fmap_x_len_ - filt_x_len_)/filt_x_step_ + 1;
     int32 out_fmap_y_len = (fmap_y_len_ - filt_y_len_)/filt_y_step_ + 1;
     int32 out_fmap_size = out_fmap_x_len*out_fmap_y_len;
-    int32 num_output_fmaps = output_dim_ / (out_fmap_x_len * out_fmap_y_len);
-    int32 num_filters = filters_.NumRows(); // this is total num_filters, so each input_fmap has num_filters/num_input_fmaps
-    KALDI_ASSERT(num_filters == num_output_fmaps);
-    // int32 filter_size = filt_x_len_*filt_y_len_;
-    int32 num_frames = in.NumRows();
 
-    for (int32 p=0; p<out_fmap_size; p++){
-      feature_patch_diffs_[p].Resize(num_frames,filters_.NumCols(),kSetZero);
-      CuSubMatrix<BaseFloat> out_diff_patch(out_diff.ColRange(p*num_filters, num_filters));
-      feature_patch_diffs_[p].AddMatMat(1.0, out_diff_patch, kNoTrans, filters_, kNoTrans, 0.0);
-    }
+    ConvolutionPatches::StackColumnBlocks(out_diff, out_fmap_size, &patch_out_);
+    feature_patch_diffs_.Resize(patch_out_.NumRows(), filters_.NumCols(), kUndefined);
+    feature_patch_diffs_.AddMatMat(1.0, patch_out_, kNoTrans, filters_, kNoTrans, 0.0);
 
-    int32 out_fmap_cnt=0;
-    in_diff_summands_.Resize(in_diff->NumCols(), kSetZero);
-    for (int32 m=0; m < fmap_x_len_-filt_x_len_+1;m=m+filt_x_step_){
-      for (int32 n=0; n< fmap_y_len_-filt_y_len_+1; n=n+filt_y_step_){
-	int32 st=0;
-	if (connect_fmap_ == 1){
-	  st=(m*fmap_y_len_+n)*num_input_fmaps;	  
-	}
-	else{
-	  st=m*fmap_y_len_*num_input_fmaps + n;
-	}
-
-	for (int32 i=0; i< filt_x_len_; i++){
-	  for (int32 j=0; j< filt_y_len_*num_input_fmaps; j++){
-	    int32 c=0;
-	    if (connect_fmap_ == 1){	    
-	      c=st+i*(num_input_fmaps*fmap_y_len_)+j;
-	    }
-	    else{
-	      c=st+i*(num_input_fmaps*fmap_y_len_)+(j/num_input_fmaps)+(j%num_input_fmaps)*fmap_y_len_;
-	    }
-	    CuSubMatrix<BaseFloat> src(feature_patch_diffs_[out_fmap_cnt].ColRange(i*filt_y_len_*num_input_fmaps+j,1)); // from which col 
-	    CuSubMatrix<BaseFloat> tgt(in_diff->ColRange(c,1)); // to which col?
-	    tgt.AddMat(1.0, src);
-	    // add 1.0 
-	    in_diff_summands_.Range(c,1).Add(1.0);
-	  }
-	}
-	out_fmap_cnt++;
-      }
-    }
-    // compensate for summands
-    in_diff_summands_.InvertElements();
-    in_diff->MulColsVec(in_diff_summands_);
+    // sum into in_diff, compensating for summands
+    patches_.AveragePatchDiffs(feature_patch_diffs_, in_diff);
   }
 
 
   void Update(const CuMatrix<BaseFloat> &input, const CuMatrix<BaseFloat> &diff) {
 
     // useful dims
-    // int32 num_input_fmaps = input_dim_ / (fmap_x_len_ * fmap_y_len_);
-    // int32 inp_fmap_size = fmap_x_len_ * fmap_y_len_;
     int32 out_fmap_x_len = (fmap_x_len_ - filt_x_len_)/filt_x_step_ + 1;
     int32 out_fmap_y_len = (fmap_y_len_ - filt_y_len_)/filt_y_step_ + 1;
     int32 out_fmap_size = out_fmap_x_len*out_fmap_y_len;
     int32 num_output_fmaps = output_dim_ / (out_fmap_x_len * out_fmap_y_len);
     int32 num_filters = filters_.NumRows(); // this is total num_filters, so each input_fmap has num_filters/num_input_fmaps
     KALDI_ASSERT(num_filters == num_output_fmaps);
-    // int32 filter_size = filt_x_len_*filt_y_len_;
-    // int32 num_frames = input.NumRows();
 
     // we use following hyperparameters from the option class
     const BaseFloat lr = opts_.learn_rate;
@@ -376,14 +324,11 @@ class Convolutional2DComponent : public UpdatableComponent {
     //
     // calculate the gradient
     // 
-    filters_grad_.Resize(filters_.NumRows(), filters_.NumCols(), kSetZero);
-    bias_grad_.Resize(filters_.NumRows());
-    
-    for (int32 p=0; p<out_fmap_size; p++){
-      CuSubMatrix<BaseFloat> diff_patch(diff.ColRange(p*num_filters, num_filters));
-      filters_grad_.AddMatMat(1.0, diff_patch, kTrans, vectorized_feature_patches_[p], kNoTrans, 1.0);
-      bias_grad_.AddRowSumMat(1.0, diff_patch, 1.0);
-    }
+    ConvolutionPatches::StackColumnBlocks(diff, out_fmap_size, &patch_out_);
+    filters_grad_.Resize(filters_.NumRows(), filters_.NumCols(), kUndefined);
+    filters_grad_.AddMatMat(1.0, patch_out_, kTrans, vectorized_feature_patches_, kNoTrans, 0.0);
+    bias_grad_.Resize(filters_.NumRows(), kUndefined);
+    bias_grad_.AddRowSumMat(1.0, patch_out_, 0.0);
 
     // scale
     filters_grad_.Scale(1.0/out_fmap_size);
@@ -410,23 +355,24 @@ class Convolutional2DComponent : public UpdatableComponent {
   CuMatrix<BaseFloat> filters_grad_; ///< gradient of filters
   CuVector<BaseFloat> bias_grad_; ///< gradient of biases
 
+  /// Re-arranges the inputs into patches and back
+  ConvolutionPatches patches_;
+
   /** Buffer of reshaped inputs:
    *  1row = vectorized rectangular feature patch,
-   *  1col = dim over speech frames,
-   *  std::vector-dim = patch-position
+   *  rows p*num_frames ... (p+1)*num_frames-1 = patch-position p
    */
-  std::vector<CuMatrix<BaseFloat> > vectorized_feature_patches_;
+  CuMatrix<BaseFloat> vectorized_feature_patches_;
 
   /** Buffer for backpropagation:
-   *  derivatives in the domain of 'vectorized_feature_patches_',
-   *  1row = vectorized rectangular feature patch,
-   *  1col = dim over speech frames,
-   *  std::vector-dim = patch-position
+   *  derivatives in the domain of 'vectorized_feature_patches_'
    */
-  std::vector<CuMatrix<BaseFloat> > feature_patch_diffs_;
+  CuMatrix<BaseFloat> feature_patch_diffs_;
 
-  /// Auxiliary vector for compensating #summands when backpropagating
-  CuVector<BaseFloat> in_diff_summands_;
+  /** Filter activations (or their derivatives) with the patch-positions
+   *  stacked as in 'vectorized_feature_patches_'
+   */
+  CuMatrix<BaseFloat> patch_out_;
 };
 
 } // namespace nnet1
@@ -24,6 +24,7 @@
 
 #include "nnet/nnet-component.h"
 #include "nnet/nnet-various.h"
+#include "nnet/nnet-convolution-patches.h"
 #include "cudamatrix/cu-math.h"
 
 namespace kaldi {
@@ -46,9 +47,10 @@ namespace nnet1 {
  * In order to have a fast implementations, the filters 
  * are represented in vectorized form, where each rectangular
  * filter corresponds to a row in a matrix, where all filters 
- * are stored. The features are then re-shaped to a set of matrices, 
- * where one matrix corresponds to single patch-position, 
- * where the filters get applied.
+ * are stored. The features are then re-shaped to a single matrix
+ * with one patch per row, where the patch-positions are stacked
+ * vertically, so all the filters are applied at all the positions
+ * by one matrix multiplication (see ConvolutionPatches).
  * 
  * The type of convolution is controled by hyperparameters:
  * patch_dim_     ... frequency axis size of the patch
@@ -208,15 +210,8 @@ class ConvolutionalComponent : public UpdatableComponent {
     int32 num_splice = input_dim_ / patch_stride_;
     int32 num_patches = 1 + (patch_stride_ - patch_dim_) / patch_step_;
     int32 num_filters = filters_.NumRows();
-    int32 num_frames = in.NumRows();
     int32 filter_dim = filters_.NumCols();
 
-    // we will need the buffers 
-    if (vectorized_feature_patches_.size() == 0) {
-      vectorized_feature_patches_.resize(num_patches);
-      feature_patch_diffs_.resize(num_patches);
-    }
-
     /* Prepare feature patches, the layout is:
      * |----------|----------|----------|---------| (in = spliced frames)
      *   xxx        xxx        xxx        xxx       (x = selected elements)
@@ -229,69 +224,49 @@ class ConvolutionalComponent : public UpdatableComponent {
      *   xxx-xxx-xxx-xxx : filter dim
      *  
      */
-    for (int32 p=0; p<num_patches; p++) {
-      vectorized_feature_patches_[p].Resize(num_frames, filter_dim, kSetZero);
+    if (!patches_.IsInitialized()) {
       // build-up a column selection mask:
-      std::vector<int32> column_mask;
-      for (int32 s=0; s<num_splice; s++) {
-        for (int32 d=0; d<patch_dim_; d++) {
-          column_mask.push_back(p * patch_step_ + s * patch_stride_ + d);
+      std::vector<int32> column_map;
+      for (int32 p=0; p<num_patches; p++) {
+        for (int32 s=0; s<num_splice; s++) {
+          for (int32 d=0; d<patch_dim_; d++) {
+            column_map.push_back(p * patch_step_ + s * patch_stride_ + d);
+          }
         }
       }
-      KALDI_ASSERT(column_mask.size() == filter_dim);
-      // select the columns
-      vectorized_feature_patches_[p].CopyCols(in, column_mask);
-    }
-
-    // compute filter activations
-    for (int32 p=0; p<num_patches; p++) {
-      CuSubMatrix<BaseFloat> tgt(out->ColRange(p * num_filters, num_filters));
-      tgt.AddVecToRows(1.0, bias_, 0.0); // add bias
-      // apply all filters
-      tgt.AddMatMat(1.0, vectorized_feature_patches_[p], kNoTrans, filters_, kTrans, 1.0);
+      KALDI_ASSERT(column_map.size() == num_patches * filter_dim);
+      patches_.Init(column_map, num_patches, input_dim_);
     }
+    // select the columns, all the patch-positions are stacked vertically
+    patches_.GetPatches(in, &vectorized_feature_patches_);
+
+    // compute filter activations for all the patch-positions at once
+    patch_out_.Resize(vectorized_feature_patches_.NumRows(), num_filters, kUndefined);
+    patch_out_.AddVecToRows(1.0, bias_, 0.0); // add bias
+    // apply all filters
+    patch_out_.AddMatMat(1.0, vectorized_feature_patches_, kNoTrans, filters_, kTrans, 1.0);
+    ConvolutionPatches::UnstackColumnBlocks(patch_out_, num_patches, out);
   }
 
 
   void BackpropagateFnc(const CuMatrix<BaseFloat> &in, const CuMatrix<BaseFloat> &out,
                         const CuMatrix<BaseFloat> &out_diff, CuMatrix<BaseFloat> *in_diff) {
     // useful dims
-    int32 num_splice = input_dim_ / patch_stride_;
     int32 num_patches = 1 + (patch_stride_ - patch_dim_) / patch_step_;
-    int32 num_filters = filters_.NumRows();
-    int32 num_frames = in.NumRows();
-    int32 filter_dim = filters_.NumCols();
 
-    // backpropagate to vector of matrices (corresponding to position of a filter)
-    for (int32 p=0; p<num_patches; p++) {
-      feature_patch_diffs_[p].Resize(num_frames, filter_dim, kSetZero); // reset
-      CuSubMatrix<BaseFloat> out_diff_patch(out_diff.ColRange(p * num_filters, num_filters));
-      feature_patch_diffs_[p].AddMatMat(1.0, out_diff_patch, kNoTrans, filters_, kNoTrans, 0.0);
-    }
+    // backpropagate to the stacked patch-positions
+    ConvolutionPatches::StackColumnBlocks(out_diff, num_patches, &patch_out_);
+    feature_patch_diffs_.Resize(patch_out_.NumRows(), filters_.NumCols(), kUndefined);
+    feature_patch_diffs_.AddMatMat(1.0, patch_out_, kNoTrans, filters_, kNoTrans, 0.0);
 
-    // sum the derivatives into in_diff, we will compensate #summands
-    // TODO: rewrite to use : std::vector<int32>
-    in_diff_summands_.Resize(in_diff->NumCols(), kSetZero); // reset
-    for (int32 p=0; p<num_patches; p++) {
-      for (int32 s=0; s<num_splice; s++) {
-        CuSubMatrix<BaseFloat> src(feature_patch_diffs_[p].ColRange(s * patch_dim_, patch_dim_));
-        CuSubMatrix<BaseFloat> tgt(in_diff->ColRange(p * patch_step_ + s * patch_stride_, patch_dim_));
-        tgt.AddMat(1.0, src); // sum
-        // add 1.0 to keep track of target columns in the sum
-        in_diff_summands_.Range(p * patch_step_ + s * patch_stride_, patch_dim_).Add(1.0);
-      }
-    }
-    // compensate #summands
-    in_diff_summands_.InvertElements();
-    in_diff->MulColsVec(in_diff_summands_);
+    // sum the derivatives into in_diff, compensating #summands
+    patches_.AveragePatchDiffs(feature_patch_diffs_, in_diff);
   }
 
 
   void Update(const CuMatrix<BaseFloat> &input, const CuMatrix<BaseFloat> &diff) {
     // useful dims
     int32 num_patches = 1 + (patch_stride_ - patch_dim_) / patch_step_;
-    int32 num_filters = filters_.NumRows();
-    int32 filter_dim = filters_.NumCols();
 
     // we use following hyperparameters from the option class
     const BaseFloat lr = opts_.learn_rate;
@@ -304,14 +279,13 @@ class ConvolutionalComponent : public UpdatableComponent {
     //
     // calculate the gradient
     //
-    filters_grad_.Resize(num_filters, filter_dim, kSetZero); // reset
-    bias_grad_.Resize(num_filters, kSetZero); // reset
-    // use all the patches
-    for (int32 p=0; p<num_patches; p++) { // sum
-      CuSubMatrix<BaseFloat> diff_patch(diff.ColRange(p * num_filters, num_filters));
-      filters_grad_.AddMatMat(1.0, diff_patch, kTrans, vectorized_feature_patches_[p], kNoTrans, 1.0);
-      bias_grad_.AddRowSumMat(1.0, diff_patch, 1.0);
-    }
+    // use all the patches (the first component gets no BackpropagateFnc,
+    // so we stack 'diff' here)
+    ConvolutionPatches::StackColumnBlocks(diff, num_patches, &patch_out_);
+    filters_grad_.Resize(filters_.NumRows(), filters_.NumCols(), kUndefined);
+    filters_grad_.AddMatMat(1.0, patch_out_, kTrans, vectorized_feature_patches_, kNoTrans, 0.0);
+    bias_grad_.Resize(filters_.NumRows(), kUndefined);
+    bias_grad_.AddRowSumMat(1.0, patch_out_, 0.0);
     // scale
     filters_grad_.Scale(1.0/num_patches);
     bias_grad_.Scale(1.0/num_patches);
@@ -336,23 +310,25 @@ class ConvolutionalComponent : public UpdatableComponent {
   CuMatrix<BaseFloat> filters_grad_; ///< gradient of filters
   CuVector<BaseFloat> bias_grad_; ///< gradient of biases
 
+  /// Re-arranges the inputs into patches and back
+  ConvolutionPatches patches_;
+
   /** Buffer of reshaped inputs:
    *  1row = vectorized rectangular feature patch,
-   *  1col = dim over speech frames,
-   *  std::vector-dim = patch-position
+   *  rows p*num_frames ... (p+1)*num_frames-1 = patch-position p
    */
-  std::vector<CuMatrix<BaseFloat> > vectorized_feature_patches_; 
+  CuMatrix<BaseFloat> vectorized_feature_patches_;
 
   /** Buffer for backpropagation:
-   *  derivatives in the domain of 'vectorized_feature_patches_',
-   *  1row = vectorized rectangular feature patch,
-   *  1col = dim over speech frames,
-   *  std::vector-dim = patch-position
+   *  derivatives in the domain of 'vectorized_feature_patches_'
    */
-  std::vector<CuMatrix<BaseFloat> > feature_patch_diffs_;
+  CuMatrix<BaseFloat> feature_patch_diffs_;
 
-  /// Auxiliary vector for compensating #summands when backpropagating
-  CuVector<BaseFloat> in_diff_summands_;
+  /** Filter activations (or their derivatives) with the patch-positions
+   *  stacked as in 'vectorized_feature_patches_',
+   *  1row = all filters at one patch-position of one frame
+   */
+  CuMatrix<BaseFloat> patch_out_;
 };
 
 } // namespace nnet1
@@ -45,11 +45,9 @@ class KlHmm : public Component {
 
   void PropagateFnc(const CuMatrix<BaseFloat> &in, CuMatrix<BaseFloat> *out) {
     if (kl_inv_q_.NumRows() == 0) {
-      // Copy the CudaMatrix to a Matrix
-      Matrix<BaseFloat> in_tmp(in.NumRows(), in.NumCols());
-      in.CopyToMat(&in_tmp);
       // Just check if there are posteriors in the Matrix (just check the first row)
-      BaseFloat post_sum=in_tmp.Row(0).Sum();
+      Vector<BaseFloat> first_row(in.Row(0));
+      BaseFloat post_sum = first_row.Sum();
       KALDI_ASSERT(ApproxEqual(post_sum, 1.0));
       // Get a tmp Matrix of the stats
       Matrix<BaseFloat> kl_stats_tmp(kl_stats_);
@@ -74,22 +72,15 @@ class KlHmm : public Component {
       //Holds now log (1/Q)
       kl_inv_q_.CopyFromMat(kl_stats_tmp);
     }
-    // Get the logarithm of the features for the Entropy calculation
-    // Copy the CudaMatrix to a Matrix
-    Matrix<BaseFloat> in_log_tmp(in.NumRows(), in.NumCols());
-    in.CopyToMat(&in_log_tmp);
-    // Flooring and log
-    in_log_tmp.ApplyFloor(1e-20);
-    in_log_tmp.ApplyLog();
-    CuMatrix<BaseFloat> log_in(in.NumRows(), in.NumCols());
-    log_in.CopyFromMat(in_log_tmp);
-    // P*logP
-    CuMatrix<BaseFloat> tmp_entropy(in);
-    tmp_entropy.MulElements(log_in);
-    // Getting the entropy (sum P*logP)
-    CuVector<BaseFloat> in_entropy(in.NumRows(), kSetZero);
-    in_entropy.AddColSumMat(1,tmp_entropy);
-    // sum P*log (1/Q)
+    // Get the logarithm of the features for the Entropy calculation,
+    // flooring first; this stays on the device.
+    CuMatrix<BaseFloat> log_in(in);
+    log_in.ApplyFloor(1e-20);
+    log_in.ApplyLog();
+    // Getting the entropy (sum P*logP), the diagonal of P (logP)^T
+    CuVector<BaseFloat> in_entropy(in.NumRows(), kUndefined);
+    in_entropy.AddDiagMatMat(1.0, in, kNoTrans, log_in, kTrans, 0.0);
+    // sum P*log (1/Q), for all the states at once
     out->AddMatMat(1, in, kNoTrans, kl_inv_q_, kTrans, 0);
     // (sum P*logP) + (sum P*log(1/Q)
     out->AddVecToCols(1, in_entropy);
@@ -135,6 +126,53 @@ class KlHmm : public Component {
     }
   }
 
+  /// Accumulate the statistics from posteriors in a CuMatrix.  The statistics
+  /// are the product of the transposed one-hot alignment matrix with the
+  /// posteriors; rather than forming that matrix, the frames are sorted by
+  /// state, so that each state's statistics are the sum of a range of them,
+  /// which is done with one SumColumnRanges() on the device.  Only the sums
+  /// of the states that occur are copied back, to be added to the
+  /// double-precision statistics.
+  void Accumulate(const CuMatrixBase<BaseFloat> &posteriors,
+                  const std::vector<int32> &alignment) {
+    KALDI_ASSERT(posteriors.NumRows() == alignment.size());
+    KALDI_ASSERT(posteriors.NumCols() == kl_stats_.NumCols());
+    int32 num_frames = alignment.size(), num_states = kl_stats_.NumRows();
+    if (num_frames == 0) return;
+    // Counting sort of the frames by state.
+    std::vector<int32> state_count(num_states + 1, 0);
+    for (int32 i = 0; i < num_frames; i++) {
+      KALDI_ASSERT(alignment[i] >= 0 && alignment[i] < num_states);
+      state_count[alignment[i] + 1]++;
+    }
+    std::vector<int32> states;
+    std::vector<Int32Pair> ranges;
+    for (int32 s = 0; s < num_states; s++) {
+      if (state_count[s + 1] > 0) {
+        Int32Pair range;
+        range.first = state_count[s];
+        range.second = state_count[s] + state_count[s + 1];
+        states.push_back(s);
+        ranges.push_back(range);
+      }
+      state_count[s + 1] += state_count[s];  // now the start of state s + 1.
+    }
+    std::vector<MatrixIndexT> reorder(num_frames);
+    for (int32 i = 0; i < num_frames; i++)
+      reorder[state_count[alignment[i]]++] = i;
+
+    CuMatrix<BaseFloat> sorted(num_frames, posteriors.NumCols(), kUndefined);
+    sorted.CopyRows(posteriors, reorder);
+    CuMatrix<BaseFloat> sorted_trans(sorted, kTrans);
+    CuMatrix<BaseFloat> sums_trans(posteriors.NumCols(), states.size(),
+                                   kUndefined);
+    sums_trans.SumColumnRanges(sorted_trans, CuArray<Int32Pair>(ranges));
+    Matrix<BaseFloat> sums(states.size(), posteriors.NumCols(), kUndefined);
+    sums_trans.CopyToMat(&sums, kTrans);
+    for (size_t k = 0; k < states.size(); k++)
+      kl_stats_.Row(states[k]).AddVec(1.0, sums.Row(k));
+  }
+
  private: 
   Matrix<double> kl_stats_;
   CuMatrix<BaseFloat> kl_inv_q_;
@@ -76,32 +76,49 @@ void Xent::Eval(const CuMatrix<BaseFloat>& net_out, const Posterior& post, CuMat
     num_pdf = net_out.NumCols();
   KALDI_ASSERT(num_frames == post.size());
 
-  // convert posterior to matrix
-  Matrix<BaseFloat> tgt_mat_host(num_frames, num_pdf, kSetZero); // zero-filled
+  // convert posterior to the sparse targets { frame, pdf, weight },
+  // merging repeated pdfs of a frame, and find the target maxima
+  tgt_elements_.clear();
+  max_id_tgt_host_.resize(num_frames);
   for (int32 t = 0; t < post.size(); t++) {
+    size_t frame_begin = tgt_elements_.size();
     for (int32 i = 0; i < post[t].size(); i++) {
       int32 pdf = post[t][i].first;
       if (pdf >= num_pdf) {
         KALDI_ERR << "Posterior pdf-id out of NN-output dimension, please check number of pdfs by 'hmm-info'."
                   << " nn-outputs : " << num_pdf << ", posterior pdf-id : " << pdf;
       }
-      tgt_mat_host(t, pdf) += post[t][i].second;
+      size_t j = frame_begin;
+      while (j < tgt_elements_.size() && tgt_elements_[j].column != pdf) j++;
+      if (j == tgt_elements_.size()) {
+        MatrixElement<BaseFloat> elem = { t, pdf, 0.0 };
+        tgt_elements_.push_back(elem);
+      }
+      tgt_elements_[j].weight += post[t][i].second;
+    }
+    // the max-target, the lowest pdf-id of equal maxima (as FindRowMaxId)
+    int32 max_id = 0;
+    BaseFloat max = 0.0;
+    for (size_t j = frame_begin; j < tgt_elements_.size(); j++) {
+      const MatrixElement<BaseFloat> &elem = tgt_elements_[j];
+      if (elem.weight > max || (elem.weight == max && elem.column < max_id)) {
+        max = elem.weight;
+        max_id = elem.column;
+      }
     }
+    max_id_tgt_host_[t] = max_id;
   }
-  tgt_mat_device_ = tgt_mat_host; // -> GPU
 
-  // compute derivaitve w.r.t. pre-softmax activation (net_out - tgt)
+  // compute derivaitve w.r.t. pre-softmax activation (net_out - tgt),
+  // and the per-target t*log(y), in one pass over the sparse targets (in GPU)
   *diff = net_out;
-  diff->AddMat(-1.0, tgt_mat_device_);
+  diff->DiffXent(tgt_elements_, &log_post_tgt_);
 
   // evaluate the frame-level classification
   int32 correct=0;
   net_out.FindRowMaxId(&max_id_out_); // find max in nn-output
-  tgt_mat_device_.FindRowMaxId(&max_id_tgt_); // find max in targets
   max_id_out_host_.resize(num_frames);
-  max_id_tgt_host_.resize(num_frames);
   max_id_out_.CopyToVec(&max_id_out_host_);
-  max_id_tgt_.CopyToVec(&max_id_tgt_host_);
   // count frames where maxima match
   for(int32 i=0; i<num_frames; i++) {
     if (max_id_tgt_host_[i] == max_id_out_host_[i]) correct++;
@@ -109,16 +126,8 @@ void Xent::Eval(const CuMatrix<BaseFloat>& net_out, const Posterior& post, CuMat
   // TODO calculate phone-level accuracy,
   // need to get shuffled phone-ids externally ...
 
-  // calculate cross_entropy (in GPU)
-  xentropy_aux_ = net_out; // y
-  xentropy_aux_.Add(1e-20); // avoid -inf
-  xentropy_aux_.ApplyLog(); // log(y)
-  xentropy_aux_.MulElements(tgt_mat_device_); // t*log(y)
-  log_post_tgt_.Resize(num_frames);
-  log_post_tgt_.AddColSumMat(1.0,xentropy_aux_,0.0); // sum over cols (pdfs)
-  log_post_tgt_host_.Resize(num_frames);
-  log_post_tgt_.CopyToVec(&log_post_tgt_host_);
-  double cross_entropy = -log_post_tgt_host_.Sum(); // sum over rows (frames)
+  // calculate cross_entropy (sum in GPU)
+  double cross_entropy = -log_post_tgt_.Sum();
 
   // calculate entropy (from Posterior)
   double entropy = 0.0;
@@ -183,9 +192,7 @@ void Xent::EvalVec(const CuMatrix<BaseFloat> &net_out, const std::vector<int32>
   // log(sum_row(net_out.*target_mat)))
   // they now are stored in vector log_post_tgt_
   //
-  log_post_tgt_host_.Resize(log_post_tgt_.Dim());
-  log_post_tgt_.CopyToVec(&log_post_tgt_host_);
-  loss_    -= log_post_tgt_host_.Sum();
+  loss_    -= log_post_tgt_.Sum(); // sum in GPU
   
   // accumulate error quantites
   frames_  += net_out.NumRows();
@@ -22,6 +22,7 @@
 #include "nnet/nnet-activation.h"
 #include "nnet/nnet-affine-transform.h"
 #include "nnet/nnet-various.h"
+#include "util/kaldi-profile.h"
 
 
 namespace kaldi {
@@ -63,6 +64,7 @@ Nnet::~Nnet() {
 
 
 void Nnet::Propagate(const CuMatrix<BaseFloat> &in, CuMatrix<BaseFloat> *out) {
+  KALDI_PROFILE_SCOPE("Nnet::Propagate");
   KALDI_ASSERT(NULL != out);
 
   if (NumComponents() == 0) {
@@ -70,23 +72,35 @@ void Nnet::Propagate(const CuMatrix<BaseFloat> &in, CuMatrix<BaseFloat> *out) {
     return; 
   }
 
+  out->Resize(in.NumRows(), OutputDim(), kUndefined);
+  PropagateSubMatrix(in, out);
+}
+
+
+void Nnet::PropagateSubMatrix(const CuMatrixBase<BaseFloat> &in,
+                              CuMatrixBase<BaseFloat> *out) {
+  KALDI_ASSERT(NULL != out && out->NumRows() == in.NumRows());
+  if (NumComponents() == 0) {
+    out->CopyFromMat(in);
+    return;
+  }
+
   // we need at least L+1 input buffers
   KALDI_ASSERT((int32)propagate_buf_.size() >= NumComponents()+1);
   
-  propagate_buf_[0].Resize(in.NumRows(), in.NumCols());
+  propagate_buf_[0].Resize(in.NumRows(), in.NumCols(), kUndefined);
   propagate_buf_[0].CopyFromMat(in);
 
   for(int32 i=0; i<(int32)components_.size(); i++) {
     components_[i]->Propagate(propagate_buf_[i], &propagate_buf_[i+1]);
   }
 
-  CuMatrix<BaseFloat> &mat = propagate_buf_[components_.size()];
-  out->Resize(mat.NumRows(), mat.NumCols());
-  out->CopyFromMat(mat);
+  out->CopyFromMat(propagate_buf_[components_.size()]);
 }
 
 
 void Nnet::Backpropagate(const CuMatrix<BaseFloat> &out_diff, CuMatrix<BaseFloat> *in_diff) {
+  KALDI_PROFILE_SCOPE("Nnet::Backpropagate");
 
   //////////////////////////////////////
   // Backpropagation
@@ -158,21 +172,35 @@ void Nnet::Feedforward(const CuMatrix<BaseFloat> &in, CuMatrix<BaseFloat> *out)
     return; 
   }
 
-  if (NumComponents() == 1) {
-    components_[0]->Propagate(in, out);
-    return;
-  }
-
-  // we need at least 2 input buffers
-  KALDI_ASSERT(propagate_buf_.size() >= 2);
-
-  // propagate by using exactly 2 auxiliary buffers
-  int32 L = 0;
-  components_[L]->Propagate(in, &propagate_buf_[L%2]);
-  for(L++; L<=NumComponents()-2; L++) {
-    components_[L]->Propagate(propagate_buf_[(L-1)%2], &propagate_buf_[L%2]);
+  // we need at least 2 buffers (an Nnet made by AppendComponent() may not
+  // have them yet)
+  if (propagate_buf_.size() < 2) propagate_buf_.resize(2);
+
+  // propagate by using exactly 2 auxiliary buffers, alternately; an
+  // AffineTransform followed by a Sigmoid, Tanh or Softmax is done as a
+  // single step, see AffineTransform::PropagateWithActivation().
+  const CuMatrix<BaseFloat> *cur_in = &in;
+  int32 L = 0, buf = 0;
+  while (L < NumComponents()) {
+    bool fuse = (L + 1 < NumComponents() &&
+                 components_[L]->GetType() == Component::kAffineTransform &&
+                 AffineTransform::CanFuseActivation(
+                     components_[L+1]->GetType()));
+    int32 num_done = (fuse ? 2 : 1);
+    CuMatrix<BaseFloat> *cur_out = (L + num_done == NumComponents() ?
+                                    out : &propagate_buf_[buf]);
+    if (fuse) {
+      AffineTransform *affine = dynamic_cast<AffineTransform*>(components_[L]);
+      KALDI_ASSERT(affine != NULL);
+      affine->PropagateWithActivation(*cur_in, components_[L+1]->GetType(),
+                                      cur_out);
+    } else {
+      components_[L]->Propagate(*cur_in, cur_out);
+    }
+    cur_in = cur_out;
+    buf = 1 - buf;
+    L += num_done;
   }
-  components_[L]->Propagate(propagate_buf_[(L-1)%2], out);
   // release the buffers we don't need anymore
   propagate_buf_[0].Resize(0,0);
   propagate_buf_[1].Resize(0,0);
@@ -189,6 +217,29 @@ int32 Nnet::InputDim() const {
   return components_.front()->InputDim();
 }
 
+bool Nnet::IsFrameLocal() const {
+  for (size_t i = 0; i < components_.size(); i++) {
+    switch (components_[i]->GetType()) {
+      case Component::kAffineTransform: case Component::kAffineTransformNobias:
+      case Component::kQuantizedAffineTransform:
+      case Component::kConvolutionalComponent:
+      case Component::kConvolutional2DComponent:
+      case Component::kSoftmax: case Component::kSigmoid: case Component::kTanh:
+      case Component::kDropout: case Component::kRbm: case Component::kCopy:
+      case Component::kBlockLinearity:
+      case Component::kAddShift: case Component::kRescale:
+      case Component::kAveragePoolingComponent:
+      case Component::kAveragePooling2DComponent:
+      case Component::kMaxPoolingComponent:
+      case Component::kMaxPooling2DComponent:
+        break;
+      default:  // e.g. kSplice, kSentenceAveragingComponent.
+        return false;
+    }
+  }
+  return true;
+}
+
 const Component& Nnet::GetComponent(int32 component) const {
   KALDI_ASSERT(static_cast<size_t>(component) < components_.size());
   return *(components_[component]);
@@ -44,6 +44,10 @@ class Nnet {
  public:
   /// Perform forward pass through the network
   void Propagate(const CuMatrix<BaseFloat> &in, CuMatrix<BaseFloat> *out); 
+  /// As Propagate(), but "in" and "out" may be sub-matrices (e.g. column
+  /// ranges of larger matrices); "out" must already have the right size.
+  void PropagateSubMatrix(const CuMatrixBase<BaseFloat> &in,
+                          CuMatrixBase<BaseFloat> *out);
   /// Perform backward pass through the network
   void Backpropagate(const CuMatrix<BaseFloat> &out_diff, CuMatrix<BaseFloat> *in_diff);
   /// Perform forward pass through the network, don't keep buffers (use it when not training)
@@ -54,6 +58,11 @@ class Nnet {
   /// Dimensionality of network outputs (posteriors | bn-features | etc.)
   int32 OutputDim() const; 
 
+  /// Returns true if each output frame depends only on the same input frame
+  /// (no Splice, sentence-level or unknown components), so the frames of
+  /// several utterances may be propagated together as one matrix.
+  bool IsFrameLocal() const;
+
   /// Returns number of components-- think of this as similar to # of layers, but
   /// e.g. the nonlinearity and the linear part count as separate components,
   /// so the number of components will be more than the number of layers.
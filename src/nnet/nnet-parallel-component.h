@@ -25,6 +25,8 @@
 #include "nnet/nnet-component.h"
 #include "nnet/nnet-various.h"
 #include "cudamatrix/cu-math.h"
+#include "cudamatrix/cu-device.h"
+#include "thread/kaldi-thread.h"
 
 #include <sstream>
 
@@ -171,17 +173,18 @@ class ParallelComponent : public UpdatableComponent {
   }
 
   void PropagateFnc(const CuMatrix<BaseFloat> &in, CuMatrix<BaseFloat> *out) {
-    int32 input_offset = 0, output_offset = 0;
-    for (int32 i=0; i<nnet_.size(); i++) {
-      CuSubMatrix<BaseFloat> src(in.ColRange(input_offset, nnet_[i].InputDim()));
-      CuSubMatrix<BaseFloat> tgt(out->ColRange(output_offset, nnet_[i].OutputDim()));
-      //
-      CuMatrix<BaseFloat> tgt_aux;
-      nnet_[i].Propagate(CuMatrix<BaseFloat>(src), &tgt_aux); // need CuMatrix<> here
-      tgt.CopyFromMat(tgt_aux);
-      //
-      input_offset += nnet_[i].InputDim();
-      output_offset += nnet_[i].OutputDim();
+    // The nested nnets read column ranges of "in" and write column ranges of
+    // "out" directly.  On the CPU they run in parallel, in the threads of
+    // MultiThreadPool; on the GPU they run one after another.
+    bool parallel = (nnet_.size() > 1);
+#if HAVE_CUDA == 1
+    if (CuDevice::Instantiate().Enabled()) parallel = false;
+#endif
+    PropagateNestedNnets c(this, in, out);
+    if (parallel) {
+      RunParallelFor(0, nnet_.size(), c, nnet_.size());
+    } else {
+      c(0, nnet_.size());
     }
   }
 
@@ -213,6 +216,33 @@ class ParallelComponent : public UpdatableComponent {
   }
 
  private:
+  // This class is used with RunParallelFor() in PropagateFnc(); it
+  // propagates the nested nnets begin ... end-1.
+  class PropagateNestedNnets {
+   public:
+    PropagateNestedNnets(ParallelComponent *me, const CuMatrix<BaseFloat> &in,
+                         CuMatrix<BaseFloat> *out):
+        me_(me), in_(&in), out_(out) { }
+    void operator () (int32 begin, int32 end) {
+      int32 input_offset = 0, output_offset = 0;
+      for (int32 i = 0; i < end; i++) {
+        Nnet &nnet = me_->nnet_[i];
+        if (i >= begin) {
+          CuSubMatrix<BaseFloat> tgt(out_->ColRange(output_offset,
+                                                    nnet.OutputDim()));
+          nnet.PropagateSubMatrix(in_->ColRange(input_offset, nnet.InputDim()),
+                                  &tgt);
+        }
+        input_offset += nnet.InputDim();
+        output_offset += nnet.OutputDim();
+      }
+    }
+   private:
+    ParallelComponent *me_;
+    const CuMatrix<BaseFloat> *in_;
+    CuMatrix<BaseFloat> *out_;
+  };
+
   std::vector<Nnet> nnet_;
 };
 
@@ -92,5 +92,28 @@ void PdfPrior::SubtractOnLogpost(CuMatrix<BaseFloat> *llk) {
   llk->AddVecToRows(-prior_scale_, log_priors_);
 }
 
+void PdfPriorAccumulator::Accumulate(const CuMatrixBase<BaseFloat> &nnet_out) {
+  if (pending_.Dim() == 0) pending_.Resize(nnet_out.NumCols());
+  KALDI_ASSERT(pending_.Dim() == nnet_out.NumCols());
+  pending_.AddRowSumMat(1.0, nnet_out);
+  if (++num_pending_ == 256) Flush();
+}
+
+void PdfPriorAccumulator::Flush() {
+  if (num_pending_ == 0) return;
+  Vector<double> pending(pending_);
+  if (counts_.Dim() == 0) counts_.Resize(pending.Dim());
+  counts_.AddVec(1.0, pending);
+  pending_.SetZero();
+  num_pending_ = 0;
+}
+
+void PdfPriorAccumulator::Write(const std::string &wxfilename) {
+  Flush();
+  Output out(wxfilename, false);
+  counts_.Write(out.Stream(), false);
+  out.Close();
+}
+
 }  // namespace nnet1
 }  // namespace kaldi
@@ -68,6 +68,31 @@ class PdfPrior {
   KALDI_DISALLOW_COPY_AND_ASSIGN(PdfPrior);
 };
 
+/// Accumulates the sum of the nnet outputs (the pdf posteriors, for a
+/// softmax output) over the frames seen in training or cross-validation, so
+/// that the training program can write "soft" class-frame-counts for PdfPrior
+/// without a separate forward pass.  The sum is kept on the device and is
+/// added to a double-precision sum on the host every few hundred minibatches.
+class PdfPriorAccumulator {
+ public:
+  PdfPriorAccumulator(): num_pending_(0) { }
+
+  /// Adds the rows of "nnet_out" (one per frame).
+  void Accumulate(const CuMatrixBase<BaseFloat> &nnet_out);
+
+  /// Writes the counts in text form, as read by --class-frame-counts.
+  void Write(const std::string &wxfilename);
+
+ private:
+  void Flush();
+
+  CuVector<BaseFloat> pending_;  // on the device.
+  int32 num_pending_;  // number of minibatches in pending_.
+  Vector<double> counts_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(PdfPriorAccumulator);
+};
+
 }  // namespace nnet1
 }  // namespace kaldi
 
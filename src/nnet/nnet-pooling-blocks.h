@@ -0,0 +1,131 @@
+// nnet/nnet-pooling-blocks.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_NNET_NNET_POOLING_BLOCKS_H_
+#define KALDI_NNET_NNET_POOLING_BLOCKS_H_
+
+#include <vector>
+
+#include "cudamatrix/cu-matrix.h"
+#include "cudamatrix/cu-vector.h"
+#include "cudamatrix/cu-array.h"
+#include "cudamatrix/cu-math.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+/**
+ * PoolingBlocks holds the pooling pattern of the pooling components, so that
+ * the whole forward or backward pass is a single call of the pooling
+ * functions in cu-math.h (one kernel on the GPU).
+ *
+ * The input and output columns are split into blocks of 'block_dim' columns
+ * ('patches'), and output block q pools over the input blocks pools[q].
+ * In the backward pass, the derivative of an input block that is in several
+ * pools is divided by the number of those pools.
+ */
+class PoolingBlocks {
+ public:
+  PoolingBlocks(): block_dim_(0), pool_size_(0), all_blocks_pooled_(false) { }
+
+  /// Sets up the pooling; all the pools must have the same size.
+  void Init(const std::vector<std::vector<int32> > &pools,
+            int32 num_in_blocks, int32 block_dim) {
+    KALDI_ASSERT(!pools.empty() && block_dim > 0);
+    block_dim_ = block_dim;
+    pool_size_ = pools[0].size();
+    std::vector<int32> pool_blocks;
+    std::vector<std::vector<int32> > pools_of_block(num_in_blocks);
+    for (size_t q = 0; q < pools.size(); q++) {
+      KALDI_ASSERT(static_cast<int32>(pools[q].size()) == pool_size_);
+      for (int32 k = 0; k < pool_size_; k++) {
+        int32 p = pools[q][k];
+        KALDI_ASSERT(p >= 0 && p < num_in_blocks);
+        pool_blocks.push_back(p);
+        pools_of_block[p].push_back(q);
+      }
+    }
+    std::vector<int32> out_blocks;
+    std::vector<Int32Pair> in_ranges(num_in_blocks);
+    Vector<BaseFloat> max_scale(num_in_blocks);
+    all_blocks_pooled_ = true;
+    for (int32 p = 0; p < num_in_blocks; p++) {
+      in_ranges[p].first = out_blocks.size();
+      out_blocks.insert(out_blocks.end(), pools_of_block[p].begin(),
+                        pools_of_block[p].end());
+      in_ranges[p].second = out_blocks.size();
+      // divide by #summands (compensate for patches used in more pools)
+      if (pools_of_block[p].empty()) all_blocks_pooled_ = false;
+      else max_scale(p) = 1.0 / pools_of_block[p].size();
+    }
+    pool_blocks_ = pool_blocks;
+    out_blocks_ = out_blocks;
+    in_ranges_ = in_ranges;
+    max_scale_ = max_scale;
+    // the average-pooling also divides by the pool size.
+    max_scale.Scale(1.0 / pool_size_);
+    avg_scale_ = max_scale;
+  }
+
+  bool IsInitialized() const { return pool_size_ > 0; }
+
+  void MaxPool(const CuMatrixBase<BaseFloat> &in,
+               CuMatrixBase<BaseFloat> *out) const {
+    cu::MaxPool(in, pool_blocks_, block_dim_, out);
+  }
+
+  void AveragePool(const CuMatrixBase<BaseFloat> &in,
+                   CuMatrixBase<BaseFloat> *out) const {
+    cu::AveragePool(in, pool_blocks_, block_dim_, out);
+  }
+
+  void MaxPoolBackward(const CuMatrixBase<BaseFloat> &in,
+                       const CuMatrixBase<BaseFloat> &out,
+                       const CuMatrixBase<BaseFloat> &out_diff,
+                       CuMatrixBase<BaseFloat> *in_diff) const {
+    KALDI_ASSERT(all_blocks_pooled_); // patch at least in one pool
+    cu::MaxPoolBackward(in, out, out_diff, out_blocks_, in_ranges_,
+                        max_scale_, block_dim_, in_diff);
+  }
+
+  void AveragePoolBackward(const CuMatrixBase<BaseFloat> &out_diff,
+                           CuMatrixBase<BaseFloat> *in_diff) const {
+    KALDI_ASSERT(all_blocks_pooled_); // patch at least in one pool
+    cu::AveragePoolBackward(out_diff, out_blocks_, in_ranges_, avg_scale_,
+                            block_dim_, in_diff);
+  }
+
+ private:
+  int32 block_dim_, pool_size_;
+  bool all_blocks_pooled_;
+  /// pool_blocks_[q * pool_size_ + k] is the k'th input block of pool q.
+  CuArray<int32> pool_blocks_;
+  /// The pools containing input block p are out_blocks_[j] for j in
+  /// in_ranges_[p].
+  CuArray<int32> out_blocks_;
+  CuArray<Int32Pair> in_ranges_;
+  /// Per input block, the scale of the derivative in the backward pass.
+  CuVector<BaseFloat> max_scale_, avg_scale_;
+};
+
+} // namespace nnet1
+} // namespace kaldi
+
+#endif
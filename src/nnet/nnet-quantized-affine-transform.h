@@ -0,0 +1,108 @@
+// nnet/nnet-quantized-affine-transform.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_NNET_NNET_QUANTIZED_AFFINE_TRANSFORM_H_
+#define KALDI_NNET_NNET_QUANTIZED_AFFINE_TRANSFORM_H_
+
+
+#include "nnet/nnet-component.h"
+#include "nnet/nnet-affine-transform.h"
+#include "nnet/nnet-various.h"
+#include "matrix/quantized-matrix.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+/**
+ * Inference-only version of AffineTransform, with the weights stored with
+ * 8 bits per element (see QuantizedMatrix), for faster forwarding on CPU.
+ * It is created from a trained AffineTransform by "nnet-copy --quantize=true";
+ * it cannot be trained or backpropagated through.  The multiplication is
+ * always done on CPU, so on GPU it involves copying the data.
+ */
+class QuantizedAffineTransform : public Component {
+ public:
+  QuantizedAffineTransform(int32 dim_in, int32 dim_out)
+    : Component(dim_in, dim_out)
+  { }
+  explicit QuantizedAffineTransform(AffineTransform &affine)
+    : Component(affine.InputDim(), affine.OutputDim()),
+      bias_(affine.GetBias())
+  {
+    Matrix<BaseFloat> linearity(affine.GetLinearity());
+    linearity_.CopyFromMat(linearity);
+  }
+  ~QuantizedAffineTransform()
+  { }
+
+  Component* Copy() const { return new QuantizedAffineTransform(*this); }
+  ComponentType GetType() const { return kQuantizedAffineTransform; }
+
+  void InitData(std::istream &is) {
+    KALDI_ERR << "QuantizedAffineTransform cannot be initialized from a "
+              << "config, use nnet-copy --quantize=true on a trained nnet.";
+  }
+
+  void ReadData(std::istream &is, bool binary) {
+    linearity_.Read(is, binary);
+    bias_.Read(is, binary);
+
+    KALDI_ASSERT(linearity_.NumRows() == output_dim_);
+    KALDI_ASSERT(linearity_.NumCols() == input_dim_);
+    KALDI_ASSERT(bias_.Dim() == output_dim_);
+  }
+
+  void WriteData(std::ostream &os, bool binary) const {
+    linearity_.Write(os, binary);
+    bias_.Write(os, binary);
+  }
+
+  std::string Info() const {
+    Matrix<BaseFloat> linearity(linearity_.NumRows(), linearity_.NumCols());
+    linearity_.CopyToMat(&linearity);
+    return std::string("\n  linearity") + MomentStatistics(linearity) +
+           "\n  bias" + MomentStatistics(bias_);
+  }
+
+  void PropagateFnc(const CuMatrix<BaseFloat> &in, CuMatrix<BaseFloat> *out) {
+    Matrix<BaseFloat> in_host(in.NumRows(), in.NumCols(), kUndefined),
+        out_host(in.NumRows(), output_dim_, kUndefined);
+    in.CopyToMat(&in_host);
+    linearity_.AddMatMatTrans(static_cast<BaseFloat>(1.0), in_host,
+                              static_cast<BaseFloat>(0.0), &out_host);
+    out->CopyFromMat(out_host);
+    out->AddVecToRows(1.0, bias_, 1.0);
+  }
+
+  void BackpropagateFnc(const CuMatrix<BaseFloat> &in, const CuMatrix<BaseFloat> &out,
+                        const CuMatrix<BaseFloat> &out_diff, CuMatrix<BaseFloat> *in_diff) {
+    KALDI_ERR << "QuantizedAffineTransform cannot be backpropagated through "
+              << "(quantized nnets are for inference only).";
+  }
+
+ private:
+  QuantizedMatrix linearity_;
+  CuVector<BaseFloat> bias_;
+};
+
+} // namespace nnet1
+} // namespace kaldi
+
+#endif
@@ -227,11 +227,60 @@ void UnitTestStdVectorRandomizer() {
 }
 
 
+void UnitTestRandomizersShuffle() {
+  // the frame index is stored in all the data, so we can check that all the
+  // randomizers are shuffled the same way, also after re-filling.
+  NnetDataRandomizerOptions c;
+  c.randomizer_size = 1000;
+  c.minibatch_size = 100;
+  RandomizerMask mask(c);
+  MatrixRandomizer mat_r(c);
+  VectorRandomizer vec_r(c);
+  PosteriorRandomizer post_r(c);
+  int32 num_frames = 1111;
+  typedef std::vector<std::vector<std::pair<int32, BaseFloat> > > Posterior;
+  for (int32 fill = 0; fill < 2; fill++) {
+    Matrix<BaseFloat> m(num_frames, 3);
+    Vector<BaseFloat> v(num_frames);
+    Posterior post(num_frames);
+    for (int32 t = 0; t < num_frames; t++) {
+      int32 frame = fill * num_frames + t;
+      m.Row(t).Set(frame);
+      v(t) = frame;
+      post[t].push_back(std::make_pair(frame, 1.0));
+    }
+    mat_r.AddData(CuMatrix<BaseFloat>(m));
+    vec_r.AddData(v);
+    post_r.AddData(post);
+    KALDI_ASSERT(mat_r.IsFull());
+    const std::vector<int32> &mask_vec = mask.Generate(mat_r.NumFrames());
+    mat_r.Randomize(mask_vec);
+    vec_r.Randomize(mask_vec);
+    post_r.Randomize(mask_vec);
+    std::vector<int32> seen;
+    for ( ; !mat_r.Done(); mat_r.Next(), vec_r.Next(), post_r.Next()) {
+      Matrix<BaseFloat> m2(mat_r.Value());
+      const Vector<BaseFloat> &v2 = vec_r.Value();
+      const Posterior &post2 = post_r.Value();
+      for (int32 t = 0; t < m2.NumRows(); t++) {
+        KALDI_ASSERT(m2(t, 0) == v2(t) && m2(t, 2) == v2(t));
+        KALDI_ASSERT(post2[t].size() == 1 && post2[t][0].first == v2(t));
+        seen.push_back(post2[t][0].first);
+      }
+    }
+    // no frame is delivered twice
+    std::sort(seen.begin(), seen.end());
+    KALDI_ASSERT(std::unique(seen.begin(), seen.end()) == seen.end());
+  }
+}
+
+
 int main() {
   UnitTestRandomizerMask();
   UnitTestMatrixRandomizer();
   UnitTestVectorRandomizer();
   UnitTestStdVectorRandomizer();
+  UnitTestRandomizersShuffle();
   
   std::cout << "Tests succeeded.\n";
 }
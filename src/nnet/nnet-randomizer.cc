@@ -73,17 +73,21 @@ void MatrixRandomizer::Randomize(const std::vector<int32>& mask) {
   KALDI_ASSERT(data_begin_ == 0);
   KALDI_ASSERT(data_end_ > 0);
   KALDI_ASSERT(data_end_ == mask.size());
-  // Copy to auxiliary buffer for unshuffled data
-  data_aux_ = data_;
-  // Put the mask to GPU 
-  CuArray<int32> mask_in_gpu(mask.size());
-  mask_in_gpu.CopyFromVec(mask);
+  // Put the mask to GPU (the buffer is kept between the refills)
+  mask_in_gpu_.CopyFromVec(mask);
+  // Move the unshuffled data to the auxiliary buffer by swapping the buffers,
+  // copying the whole buffer would double the memory traffic of the shuffling.
+  data_aux_.Swap(&data_);
+  if (data_.NumRows() != data_aux_.NumRows() ||
+      data_.NumCols() != data_aux_.NumCols()) {
+    data_.Resize(data_aux_.NumRows(), data_aux_.NumCols(), kUndefined);
+  }
   // Randomize the data, mask is used to index rows in source matrix:
-  // (Here the vector 'mask_in_gpu' is typically shorter than number of rows in 'data_aux_',
+  // (Here the vector 'mask_in_gpu_' is typically shorter than number of rows in 'data_aux_',
   //  because the the buffer 'data_aux_' is larger than capacity 'randomizer_size'.
   //  The extra rows in 'data_aux_' do not contain speech frames and are not copied
-  //  from 'data_aux_', the extra rows in 'data_' are unchanged by cu::Randomize.)
-  cu::Randomize(data_aux_, mask_in_gpu, &data_);
+  //  from 'data_aux_', the extra rows in 'data_' are not used.)
+  cu::Randomize(data_aux_, mask_in_gpu_, &data_);
 }
 
 void MatrixRandomizer::Next() {
@@ -131,11 +135,14 @@ void VectorRandomizer::Randomize(const std::vector<int32>& mask) {
   KALDI_ASSERT(data_begin_ == 0);
   KALDI_ASSERT(data_end_ > 0);
   KALDI_ASSERT(data_end_ == mask.size());
-  // Use auxiliary buffer for unshuffled data
-  Vector<BaseFloat> data_aux(data_);
+  // Use auxiliary buffer for unshuffled data (only the frames are copied)
+  data_aux_.Resize(data_end_, kUndefined);
+  data_aux_.CopyFromVec(data_.Range(0, data_end_));
   // randomize the data, mask is used to index elements in source vector
-  for(int32 i = 0; i<mask.size(); i++) {
-    data_(i) = data_aux(mask.at(i));
+  const BaseFloat *src = data_aux_.Data();
+  BaseFloat *tgt = data_.Data();
+  for (int32 i = 0; i < data_end_; i++) {
+    tgt[i] = src[mask[i]];
   }
 }
 
@@ -185,12 +192,15 @@ void StdVectorRandomizer<T>::Randomize(const std::vector<int32>& mask) {
   KALDI_ASSERT(data_begin_ == 0);
   KALDI_ASSERT(data_end_ > 0);
   KALDI_ASSERT(data_end_ == mask.size());
-  // Use auxiliary buffer for unshuffled data
-  std::vector<T> data_aux(data_);
-  // randomize the data, mask is used to index elements in source vector
-  for(int32 i = 0; i<mask.size(); i++) {
-    data_.at(i) = data_aux.at(mask.at(i));
+  // Move the elements to the auxiliary buffer in the randomized order, and
+  // back.  We swap rather than copy, as the mask is a permutation, and
+  // swapping e.g. the posteriors of a frame does not reallocate them.
+  data_aux_.resize(data_end_);
+  for (int32 i = 0; i < data_end_; i++) {
+    KALDI_ASSERT(mask[i] >= 0 && mask[i] < data_end_);
+    std::swap(data_aux_[i], data_[mask[i]]);
   }
+  std::swap_ranges(data_aux_.begin(), data_aux_.end(), data_.begin());
 }
 
 template<typename T>
@@ -90,6 +90,7 @@ class MatrixRandomizer {
   CuMatrix<BaseFloat> data_; // can be larger than 'randomizer_size'
   CuMatrix<BaseFloat> data_aux_; // auxiliary buffer for shuffling
   CuMatrix<BaseFloat> minibatch_; // buffer for mini-batch
+  CuArray<int32> mask_in_gpu_; // the mask, uploaded for the shuffling
 
   /// Cursor to beginning of data (row index, moves as mini-batches are delivered)
   int32 data_begin_;
@@ -126,6 +127,7 @@ class VectorRandomizer {
 
  private:
   Vector<BaseFloat> data_; // can be larger than 'randomizer_size'
+  Vector<BaseFloat> data_aux_; // auxiliary buffer for shuffling
   Vector<BaseFloat> minibatch_; // buffer for mini-batch
 
   /// Cursor to beginning of data (row index, moves as mini-batches are delivered)
@@ -164,6 +166,7 @@ class StdVectorRandomizer {
 
  private:
   std::vector<T> data_; // can be larger than 'randomizer_size'
+  std::vector<T> data_aux_; // auxiliary buffer for shuffling
   std::vector<T> minibatch_; // buffer for mini-batch
 
   /// Cursor to beginning of data (row index, moves as mini-batches are delivered)
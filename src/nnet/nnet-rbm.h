@@ -26,6 +26,7 @@
 #include "nnet/nnet-nnet.h"
 #include "nnet/nnet-various.h"
 #include "cudamatrix/cu-math.h"
+#include "cudamatrix/cu-rand.h"
 
 namespace kaldi {
 namespace nnet1 {
@@ -492,6 +493,56 @@ protected:
 };
 
 
+/// Trains an RBM with contrastive divergence (CD-k, or persistent CD-k), one
+/// mini-batch at a time.  The buffers are kept between mini-batches, so they
+/// are not reallocated while the mini-batch size stays the same.
+class RbmCdTrainer {
+ public:
+  RbmCdTrainer(const RbmCdOptions &opts, RbmBase *rbm): opts_(opts), rbm_(rbm) {
+    KALDI_ASSERT(opts.cd_k >= 1);
+  }
+
+  /// Does one update of the RBM with the mini-batch "pos_vis".
+  void Train(const CuMatrix<BaseFloat> &pos_vis) {
+    // positive phase
+    rbm_->Propagate(pos_vis, &pos_hid_);
+    // negative phase: start the Gibbs chain from the data, or (persistent CD)
+    // from where the previous mini-batch's chain ended.
+    if (!opts_.persistent || chain_hid_.NumRows() != pos_vis.NumRows())
+      SampleHidden(pos_hid_, &chain_hid_);
+    for (int32 k = 0; k < opts_.cd_k; k++) {
+      if (k > 0) SampleHidden(neg_hid_, &chain_hid_);
+      rbm_->Reconstruct(chain_hid_, &neg_vis_);
+      rbm_->Propagate(neg_vis_, &neg_hid_);
+    }
+    if (opts_.persistent) SampleHidden(neg_hid_, &chain_hid_);
+    // update step
+    rbm_->RbmUpdate(pos_vis, pos_hid_, neg_vis_, neg_hid_);
+  }
+
+  /// The reconstruction of the last mini-batch (end of its negative phase).
+  const CuMatrix<BaseFloat> &Reconstruction() const { return neg_vis_; }
+
+ private:
+  void SampleHidden(const CuMatrix<BaseFloat> &probs,
+                    CuMatrix<BaseFloat> *states) {
+    if (rbm_->HidType() == RbmBase::Bernoulli) {
+      rand_.BinarizeProbs(probs, states);
+    } else {
+      // assume HidType RbmBase::Gaussian
+      states->Resize(probs.NumRows(), probs.NumCols(), kUndefined);
+      states->CopyFromMat(probs);
+      rand_.AddGaussNoise(states);
+    }
+  }
+
+  RbmCdOptions opts_;
+  RbmBase *rbm_;
+  CuRand<BaseFloat> rand_;
+  CuMatrix<BaseFloat> pos_hid_, chain_hid_, neg_vis_, neg_hid_;
+};
+
+
 
 } // namespace nnet1
 } // namespace kaldi
@@ -103,6 +103,20 @@ struct RbmTrainOptions {
 };
 
 
+struct RbmCdOptions {
+  int32 cd_k;
+  bool persistent;
+  RbmCdOptions(): cd_k(1), persistent(false) { }
+  void Register(OptionsItf *po) {
+    po->Register("cd-k", &cd_k, "Number of Gibbs sampling steps of the "
+                 "negative phase of contrastive divergence (CD-k)");
+    po->Register("persistent-cd", &persistent, "If true, use persistent CD: "
+                 "the negative phase starts where the previous mini-batch's "
+                 "Gibbs chain ended, instead of from the data");
+  }
+};
+
+
 }//namespace nnet1
 }//namespace kaldi
 
@@ -18,6 +18,7 @@
 // limitations under the License.
 
 #include "nnet2/combine-nnet-a.h"
+#include "nnet2/nnet-update-parallel.h"
 
 namespace kaldi {
 namespace nnet2 {
@@ -60,6 +61,8 @@ static void AddDirection(const Nnet &orig_nnet,
 
 static BaseFloat ComputeObjfAndGradient(
     const std::vector<NnetExample> &validation_set,
+    const NnetValidationComputer &computer,
+    int32 num_threads,
     const Vector<double> &scale_params,
     const Nnet &orig_nnet,
     const Nnet &direction,
@@ -71,17 +74,12 @@ static BaseFloat ComputeObjfAndGradient(
   AddDirection(orig_nnet, direction, scale_params_float, &nnet_combined);
   
   Nnet nnet_gradient(nnet_combined);
-  bool is_gradient = true;
-  nnet_gradient.SetZero(is_gradient);
   
-  // note: "ans" is normalized by the total weight of validation frames.
-  int32 batch_size = 1024;
-  BaseFloat ans = ComputeNnetGradient(nnet_combined,
-                                      validation_set,
-                                      batch_size,
-                                      &nnet_gradient);
-
+  // note: "ans" is normalized by the number of validation frames.
   BaseFloat tot_count = validation_set.size();
+  BaseFloat ans = computer.Compute(nnet_combined, num_threads,
+                                   &nnet_gradient) / tot_count;
+
   int32 i = 0; // index into scale_params.
   for (int32 j = 0; j < nnet_combined.NumComponents(); j++) {
     const UpdatableComponent *uc_direction =
@@ -106,6 +104,11 @@ void CombineNnetsA(const NnetCombineAconfig &config,
 
   Nnet direction; // the update direction = avg(nnets[1 ... N]) - nnets[0].
   GetUpdateDirection(nnets, &direction);
+
+  // Formats the validation set once, and caches the output of the
+  // components that do not depend on the scales.
+  NnetValidationComputer computer(nnets[0], validation_set,
+                                  config.minibatch_size);
   
   Vector<double> scale_params(nnets[0].NumUpdatableComponents()); // initial
   // scale on "direction".
@@ -118,6 +121,8 @@ void CombineNnetsA(const NnetCombineAconfig &config,
 
   // Compute objf at zero; we don't actually need this gradient.
   zero_objf = ComputeObjfAndGradient(validation_set,
+                                     computer,
+                                     config.num_threads,
                                      scale_params,
                                      nnets[0],
                                      direction,
@@ -139,6 +144,8 @@ void CombineNnetsA(const NnetCombineAconfig &config,
   for (int32 i = 0; i < config.num_bfgs_iters; i++) {    
     scale_params.CopyFromVec(lbfgs.GetProposedValue());
     objf = ComputeObjfAndGradient(validation_set,
+                                  computer,
+                                  config.num_threads,
                                   scale_params,
                                   nnets[0],
                                   direction,
@@ -178,6 +185,8 @@ void CombineNnetsA(const NnetCombineAconfig &config,
 
     BaseFloat optimized_objf = objf;
     objf = ComputeObjfAndGradient(validation_set,
+                                  computer,
+                                  config.num_threads,
                                   scale_params,
                                   nnets[0],
                                   direction,
@@ -42,12 +42,16 @@ struct NnetCombineAconfig {
   BaseFloat max_learning_rate_factor; // 2.0 by default.
   BaseFloat min_learning_rate; // 0.0001 by default; we don't allow learning rate to go below
   // this, mainly because it would lead to roundoff problems.
+
+  int32 num_threads;
+  int32 minibatch_size;
   
   NnetCombineAconfig(): num_bfgs_iters(15), initial_step(0.1),
                         valid_impr_thresh(0.5), overshoot(1.8),
                         min_learning_rate_factor(0.5),
                         max_learning_rate_factor(2.0),
-                        min_learning_rate(0.0001) { }
+                        min_learning_rate(0.0001), num_threads(1),
+                        minibatch_size(1024) { }
   
   void Register(OptionsItf *po) {
     po->Register("num-bfgs-iters", &num_bfgs_iters, "Maximum number of function "
@@ -69,6 +73,11 @@ struct NnetCombineAconfig {
                  "Minimum factor by which to increase the learning rate for any layer.");
     po->Register("min-learning-rate", &min_learning_rate,
                  "Floor on the automatically updated learning rates");
+    po->Register("num-threads", &num_threads, "Number of threads to use in "
+                 "evaluating the validation-set objective function and gradient "
+                 "(use 1 if you are using a GPU).");
+    po->Register("minibatch-size", &minibatch_size, "Minibatch size used in "
+                 "computing the validation-set objective function and gradient.");
   }  
 };
 
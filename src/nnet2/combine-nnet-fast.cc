@@ -105,7 +105,8 @@ class FastNnetCombiner {
                    const std::vector<Nnet> &nnets_in,
                    Nnet *nnet_out):
       config_(combine_config), egs_(validation_set),
-      nnets_(nnets_in), nnet_out_(nnet_out) {
+      nnets_(nnets_in), nnet_out_(nnet_out),
+      computer_(nnets_in[0], validation_set, combine_config.minibatch_size) {
 
     GetInitialParams();
     ComputePreconditioner();
@@ -193,6 +194,9 @@ class FastNnetCombiner {
   const std::vector<NnetExample> &egs_;
   const std::vector<Nnet> &nnets_;
   Nnet *nnet_out_;
+  // Holds the formatted validation set, and the output of the components
+  // that do not depend on the combination weights.
+  NnetValidationComputer computer_;
 };
 
 
@@ -302,11 +306,9 @@ double FastNnetCombiner::ComputeObjfAndGradient(
   ComputeCurrentNnet(&nnet); // compute it at the value "params_".
   
   Nnet nnet_gradient(nnet);
-  bool is_gradient = true;
-  nnet_gradient.SetZero(is_gradient);
-  double tot_weight = 0.0;
-  double objf = DoBackpropParallel(nnet, config_.minibatch_size, config_.num_threads,
-                                   egs_, &tot_weight, &nnet_gradient) / egs_.size();
+  double tot_weight = computer_.TotalWeight();
+  double objf = computer_.Compute(nnet, config_.num_threads,
+                                  &nnet_gradient) / egs_.size();
   KALDI_ASSERT(tot_weight == static_cast<int32>(egs_.size()));
   
   // raw_gradient is gradient in non-preconditioned space.
@@ -388,12 +390,10 @@ int32 FastNnetCombiner::GetInitialModel(
   double best_objf;
   Vector<double> objfs(nnets.size());
   for (int32 n = 0; n < num_nnets; n++) {
-    double num_frames;
-    double objf = ComputeNnetObjfParallel(nnets[n], config_.minibatch_size,
-                                          config_.num_threads, validation_set,
-                                          &num_frames);
+    double num_frames = computer_.TotalWeight();
     KALDI_ASSERT(num_frames != 0);
-    objf /= num_frames;
+    double objf = computer_.Compute(nnets[n], config_.num_threads,
+                                    NULL) / num_frames;
     
     if (n == 0 || objf > best_objf) {
       best_objf = objf;
@@ -412,11 +412,8 @@ int32 FastNnetCombiner::GetInitialModel(
     scale_params.Set(1.0 / num_nnets);
     Nnet average_nnet;
     CombineNnets(scale_params, nnets, &average_nnet);
-    double num_frames;
-    double objf = ComputeNnetObjfParallel(average_nnet, config_.minibatch_size,
-                                          config_.num_threads, validation_set,
-                                          &num_frames);
-    objf /= num_frames;
+    double objf = computer_.Compute(average_nnet, config_.num_threads,
+                                    NULL) / computer_.TotalWeight();
     KALDI_LOG << "Objf with all neural nets averaged is " << objf;
     if (objf > best_objf) {
       return num_nnets;
@@ -18,6 +18,7 @@
 // limitations under the License.
 
 #include "nnet2/combine-nnet.h"
+#include "nnet2/nnet-update-parallel.h"
 
 namespace kaldi {
 namespace nnet2 {
@@ -48,8 +49,9 @@ static void CombineNnets(const Vector<BaseFloat> &scale_params,
 /// or (#models) for the average of all of them.
 static int32 GetInitialModel(
     const std::vector<NnetExample> &validation_set,
+    const NnetValidationComputer &computer,
+    int32 num_threads,
     const std::vector<Nnet> &nnets) {
-  int32 minibatch_size = 1024;
   int32 num_nnets = static_cast<int32>(nnets.size());
   KALDI_ASSERT(!nnets.empty());
   BaseFloat tot_frames = validation_set.size();
@@ -57,8 +59,8 @@ static int32 GetInitialModel(
   BaseFloat best_objf;
   Vector<BaseFloat> objfs(nnets.size());
   for (int32 n = 0; n < num_nnets; n++) {
-    BaseFloat objf = ComputeNnetObjf(nnets[n], validation_set,
-                                     minibatch_size) / tot_frames;
+    BaseFloat objf = computer.Compute(nnets[n], num_threads, NULL) /
+        tot_frames;
     
     if (n == 0 || objf > best_objf) {
       best_objf = objf;
@@ -75,8 +77,8 @@ static int32 GetInitialModel(
     scale_params.Set(1.0 / num_nnets);
     Nnet average_nnet;
     CombineNnets(scale_params, nnets, &average_nnet);
-    BaseFloat objf = ComputeNnetObjf(average_nnet, validation_set,
-                                     minibatch_size) / tot_frames;
+    BaseFloat objf = computer.Compute(average_nnet, num_threads, NULL) /
+        tot_frames;
     KALDI_LOG << "Objf with all neural nets averaged is " << objf;
     if (objf > best_objf) {
       return num_nnets;
@@ -91,13 +93,15 @@ static int32 GetInitialModel(
 static void GetInitialScaleParams(
     const NnetCombineConfig &combine_config,
     const std::vector<NnetExample> &validation_set,
+    const NnetValidationComputer &computer,
     const std::vector<Nnet> &nnets,
     Vector<double> *scale_params) {
 
   int32 initial_model = combine_config.initial_model,
       num_nnets = static_cast<int32>(nnets.size());
   if (initial_model < 0 || initial_model > num_nnets)
-    initial_model = GetInitialModel(validation_set, nnets);
+    initial_model = GetInitialModel(validation_set, computer,
+                                    combine_config.num_threads, nnets);
   
   KALDI_ASSERT(initial_model >= 0 && initial_model <= num_nnets);
   int32 num_uc = nnets[0].NumUpdatableComponents();
@@ -123,6 +127,8 @@ static void GetInitialScaleParams(
 
 static double ComputeObjfAndGradient(
     const std::vector<NnetExample> &validation_set,
+    const NnetValidationComputer &computer,
+    int32 num_threads,
     const Vector<double> &scale_params,
     const std::vector<Nnet> &nnets,
     bool debug,
@@ -134,17 +140,12 @@ static double ComputeObjfAndGradient(
   CombineNnets(scale_params_float, nnets, &nnet_combined);
   
   Nnet nnet_gradient(nnet_combined);
-  bool is_gradient = true;
-  nnet_gradient.SetZero(is_gradient);
   
-  // note: "ans" is normalized by the total weight of validation frames.
-  int32 batch_size = 1024;
-  double ans = ComputeNnetGradient(nnet_combined,
-                                   validation_set,
-                                   batch_size,
-                                   &nnet_gradient);
-
+  // note: "ans" is normalized by the number of validation frames.
   double tot_frames = validation_set.size();
+  double ans = computer.Compute(nnet_combined, num_threads,
+                                &nnet_gradient) / tot_frames;
+
   if (gradient != NULL) {
     int32 i = 0; // index into scale_params.  
     for (int32 n = 0; n < static_cast<int32>(nnets.size()); n++) {
@@ -176,6 +177,8 @@ static double ComputeObjfAndGradient(
       Vector<double> scale_params_temp(scale_params);
       scale_params_temp(i) += delta;
       double new_ans = ComputeObjfAndGradient(validation_set,
+                                              computer,
+                                              num_threads,
                                               scale_params_temp,
                                               nnets,
                                               false,
@@ -197,8 +200,14 @@ void CombineNnets(const NnetCombineConfig &combine_config,
 
   Vector<double> scale_params;
 
+  // Formats the validation set once, and caches the output of the
+  // components that do not depend on the combination weights.
+  NnetValidationComputer computer(nnets[0], validation_set,
+                                  combine_config.minibatch_size);
+
   GetInitialScaleParams(combine_config,
                         validation_set,
+                        computer,
                         nnets,
                         &scale_params);
 
@@ -220,6 +229,8 @@ void CombineNnets(const NnetCombineConfig &combine_config,
   for (int32 i = 0; i < combine_config.num_bfgs_iters; i++) {    
     scale_params.CopyFromVec(lbfgs.GetProposedValue());
     objf = ComputeObjfAndGradient(validation_set,
+                                  computer,
+                                  combine_config.num_threads,
                                   scale_params,
                                   nnets,
                                   combine_config.test_gradient,
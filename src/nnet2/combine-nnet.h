@@ -42,10 +42,12 @@ struct NnetCombineConfig {
   // num-iters is in reality the number of function evaluations.
   
   BaseFloat initial_impr;
+  int32 num_threads;
+  int32 minibatch_size;
   bool test_gradient;
   NnetCombineConfig(): initial_model(-1), num_bfgs_iters(30),
-                       initial_impr(0.01),
-                       test_gradient(false) { }
+                       initial_impr(0.01), num_threads(1),
+                       minibatch_size(1024), test_gradient(false) { }
   
   void Register(OptionsItf *po) {
     po->Register("initial-model", &initial_model, "Specifies where to start the "
@@ -56,6 +58,11 @@ struct NnetCombineConfig {
                  "evaluations for BFGS to use when optimizing combination weights");
     po->Register("initial-impr", &initial_impr, "Amount of objective-function change "
                  "we aim for on the first iteration.");
+    po->Register("num-threads", &num_threads, "Number of threads to use in "
+                 "evaluating the validation-set objective function and gradient "
+                 "(use 1 if you are using a GPU).");
+    po->Register("minibatch-size", &minibatch_size, "Minibatch size used in "
+                 "computing the validation-set objective function and gradient.");
     po->Register("test-gradient", &test_gradient, "If true, activate code that "
                  "tests the gradient is accurate.");
   }  
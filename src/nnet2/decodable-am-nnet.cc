@@ -0,0 +1,128 @@
+// nnet2/decodable-am-nnet.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nnet2/decodable-am-nnet.h"
+#include "cudamatrix/cu-math.h"
+
+namespace kaldi {
+namespace nnet2 {
+
+DecodableAmNnetPrunedInfo::DecodableAmNnetPrunedInfo(const AmNnet &am_nnet,
+                                                     int32 normalizer_rank) {
+  const Nnet &nnet = am_nnet.GetNnet();
+  int32 num_components = nnet.NumComponents();
+  const AffineComponent *ac = (num_components < 3 ? NULL :
+      dynamic_cast<const AffineComponent*>(
+          &(nnet.GetComponent(num_components - 2))));
+  if (ac == NULL || dynamic_cast<const SoftmaxComponent*>(
+          &(nnet.GetComponent(num_components - 1))) == NULL)
+    KALDI_ERR << "To compute the output only for some pdfs, the neural net "
+              << "must end with an AffineComponent and a SoftmaxComponent, "
+              << "after at least one other component.";
+
+  std::vector<Component*> components;
+  for (int32 c = 0; c + 2 < num_components; c++)
+    components.push_back(nnet.GetComponent(c).Copy());
+  hidden_nnet_.Init(&components);
+
+  final_linear_.Resize(ac->OutputDim(), ac->InputDim(), kUndefined);
+  ac->LinearParams().CopyToMat(&final_linear_);
+  final_bias_.Resize(ac->OutputDim(), kUndefined);
+  ac->BiasParams().CopyToVec(&final_bias_);
+  log_priors_ = am_nnet.Priors();
+  KALDI_ASSERT(log_priors_.Dim() == final_bias_.Dim() &&
+               "Priors in neural network not set up.");
+  log_priors_.ApplyLog();
+
+  if (normalizer_rank <= 0) return;
+  // Get the top "normalizer_rank" singular values and vectors of the final
+  // linear transform, so final_linear_ ~= out * in.
+  int32 rows = final_linear_.NumRows(), cols = final_linear_.NumCols(),
+      rank = std::min(normalizer_rank, std::min(rows, cols));
+  Vector<BaseFloat> s(rank);
+  normalizer_out_.Resize(rows, rank);
+  normalizer_in_.Resize(rank, cols);
+  CuMatrix<BaseFloat> linear(final_linear_);
+  cu::RandomizedSvd(linear, &s, &normalizer_out_, &normalizer_in_);
+  normalizer_out_.MulColsVec(CuVector<BaseFloat>(s));
+  KALDI_VLOG(1) << "Estimating the softmax normalizer with a rank " << rank
+                << " approximation of the " << final_linear_.NumRows()
+                << " by " << final_linear_.NumCols() << " final layer.";
+}
+
+
+DecodableAmNnetPruned::DecodableAmNnetPruned(
+    const TransitionModel &trans_model,
+    const DecodableAmNnetPrunedInfo &info,
+    const CuMatrixBase<BaseFloat> &feats,
+    const CuVectorBase<BaseFloat> &spk_info,
+    bool pad_input,
+    BaseFloat prob_scale):
+    trans_model_(trans_model), info_(info), prob_scale_(prob_scale),
+    pdf_log_like_(info.NumPdfs()), pdf_frame_(info.NumPdfs(), -1) {
+  const Nnet &nnet = info.HiddenNnet();
+  int32 num_frames = feats.NumRows() - (pad_input ? 0 :
+                                        nnet.LeftContext() +
+                                        nnet.RightContext()),
+      hidden_dim = nnet.OutputDim(), num_pdfs = info.NumPdfs();
+  CuMatrix<BaseFloat> hidden(num_frames, hidden_dim);
+  // the following function is declared in nnet-compute.h
+  NnetComputation(nnet, feats, spk_info, pad_input, &hidden);
+
+  log_normalizer_.Resize(num_frames);
+  int32 rank = info.NormalizerRank();
+  if (rank > 0) {
+    // Estimate the normalizer from the approximate output, a chunk of frames
+    // at a time so we don't store the whole #frames by #pdfs matrix.
+    CuVector<BaseFloat> bias(info.final_bias_);
+    int32 chunk_size = 256;
+    for (int32 t = 0; t < num_frames; t += chunk_size) {
+      int32 this_chunk_size = std::min(chunk_size, num_frames - t);
+      CuSubMatrix<BaseFloat> this_hidden(hidden, t, this_chunk_size,
+                                         0, hidden_dim);
+      CuMatrix<BaseFloat> projected(this_chunk_size, rank),
+          approx_output(this_chunk_size, num_pdfs, kUndefined);
+      projected.AddMatMat(1.0, this_hidden, kNoTrans,
+                          info.normalizer_in_, kTrans, 0.0);
+      approx_output.CopyRowsFromVec(bias);
+      approx_output.AddMatMat(1.0, projected, kNoTrans,
+                              info.normalizer_out_, kTrans, 1.0);
+      Matrix<BaseFloat> approx_output_cpu(approx_output);
+      for (int32 i = 0; i < this_chunk_size; i++)
+        log_normalizer_(t + i) = approx_output_cpu.Row(i).LogSumExp();
+    }
+  }
+  // Transfer the hidden-layer output to the CPU for faster access by the
+  // decoding process.
+  hidden_.Swap(&hidden);
+}
+
+BaseFloat DecodableAmNnetPruned::ComputePdfLogLikelihood(int32 frame,
+                                                         int32 pdf) const {
+  BaseFloat log_prob = VecVec(hidden_.Row(frame),
+                              info_.final_linear_.Row(pdf)) +
+      info_.final_bias_(pdf) - log_normalizer_(frame);
+  if (info_.NormalizerRank() > 0)  // floor at log(1e-20), as DecodableAmNnet.
+    log_prob = std::max(log_prob, static_cast<BaseFloat>(-46.0517));
+  // divide by the prior, and apply the probability scale.
+  return prob_scale_ * (log_prob - info_.log_priors_(pdf));
+}
+
+} // namespace nnet2
+} // namespace kaldi
@@ -20,6 +20,8 @@
 #ifndef KALDI_NNET2_DECODABLE_AM_NNET_H_
 #define KALDI_NNET2_DECODABLE_AM_NNET_H_
 
+#include <algorithm>
+#include <utility>
 #include <vector>
 
 #include "base/kaldi-common.h"
@@ -37,20 +39,36 @@ namespace nnet2 {
 
 class DecodableAmNnet: public DecodableInterface {
  public:
+  /// If frame_subsampling_factor > 1, the neural net output is only
+  /// computed on every frame_subsampling_factor'th frame (see
+  /// NnetComputationSubsampled()), and each such output is used for it and
+  /// the following frames up to the next computed one ("frame skipping").
   DecodableAmNnet(const TransitionModel &trans_model,
                   const AmNnet &am_nnet,
                   const CuMatrixBase<BaseFloat> &feats,
                   const CuVectorBase<BaseFloat> &spk_info,
                   bool pad_input = true, // if !pad_input, the NumIndices()
                   // will be < feats.NumRows().
-                  BaseFloat prob_scale = 1.0):
-      trans_model_(trans_model) {
+                  BaseFloat prob_scale = 1.0,
+                  int32 frame_subsampling_factor = 1):
+      trans_model_(trans_model),
+      frame_subsampling_factor_(frame_subsampling_factor) {
+    KALDI_ASSERT(frame_subsampling_factor >= 1);
+    const Nnet &nnet = am_nnet.GetNnet();
+    num_frames_ = feats.NumRows() - (pad_input ? 0 :
+                                     nnet.LeftContext() + nnet.RightContext());
     // Note: we could make this more memory-efficient by doing the
     // computation in smaller chunks than the whole utterance, and not
     // storing the whole thing.  We'll leave this for later.
-    CuMatrix<BaseFloat> log_probs(feats.NumRows(), trans_model.NumPdfs());
-    // the following function is declared in nnet-compute.h
-    NnetComputation(am_nnet.GetNnet(), feats, spk_info, pad_input, &log_probs);
+    CuMatrix<BaseFloat> log_probs;
+    // the following functions are declared in nnet-compute.h
+    if (frame_subsampling_factor == 1) {
+      log_probs.Resize(num_frames_, trans_model.NumPdfs());
+      NnetComputation(nnet, feats, spk_info, pad_input, &log_probs);
+    } else {
+      NnetComputationSubsampled(nnet, feats, spk_info, pad_input,
+                                frame_subsampling_factor, &log_probs);
+    }
     log_probs.ApplyFloor(1.0e-20); // Avoid log of zero which leads to NaN.
     log_probs.ApplyLog();
     CuVector<BaseFloat> priors(am_nnet.Priors());
@@ -69,11 +87,21 @@ class DecodableAmNnet: public DecodableInterface {
   // Note, frames are numbered from zero.  But state_index is numbered
   // from one (this routine is called by FSTs).
   virtual BaseFloat LogLikelihood(int32 frame, int32 transition_id) {
-    return log_probs_(frame,
-                      trans_model_.TransitionIdToPdf(transition_id));
+    return log_probs_(frame / frame_subsampling_factor_,
+                      trans_model_.TransitionIdToPdfFast(transition_id));
+  }
+
+  virtual void LogLikelihoods(int32 frame,
+                              const std::vector<int32> &transition_ids,
+                              std::vector<BaseFloat> *log_likes) {
+    const BaseFloat *row =
+        log_probs_.RowData(frame / frame_subsampling_factor_);
+    log_likes->resize(transition_ids.size());
+    for (size_t i = 0; i < transition_ids.size(); i++)
+      (*log_likes)[i] = row[trans_model_.TransitionIdToPdfFast(transition_ids[i])];
   }
 
-  int32 NumFrames() { return log_probs_.NumRows(); }
+  int32 NumFrames() { return num_frames_; }
   
   // Indices are one-based!  This is for compatibility with OpenFst.
   virtual int32 NumIndices() { return trans_model_.NumTransitionIds(); }
@@ -87,6 +115,8 @@ class DecodableAmNnet: public DecodableInterface {
   const TransitionModel &trans_model_;
   Matrix<BaseFloat> log_probs_; // actually not really probabilities, since we divide
   // by the prior -> they won't sum to one.
+  int32 frame_subsampling_factor_;
+  int32 num_frames_;
 
   KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableAmNnet);
 };
@@ -106,7 +136,8 @@ class DecodableAmNnetParallel: public DecodableInterface {
       bool pad_input = true,
       BaseFloat prob_scale = 1.0):
       trans_model_(trans_model), am_nnet_(am_nnet), feats_(feats),
-      spk_info_(spk_info), pad_input_(pad_input), prob_scale_(prob_scale) {
+      spk_info_(spk_info), pad_input_(pad_input), prob_scale_(prob_scale),
+      cached_frame_(-1) {
     KALDI_ASSERT(feats_ != NULL && spk_info_ != NULL);
   }
 
@@ -136,7 +167,24 @@ class DecodableAmNnetParallel: public DecodableInterface {
   virtual BaseFloat LogLikelihood(int32 frame, int32 transition_id) {
     if (feats_) Compute(); // this function sets feats_ to NULL.
     return log_probs_(frame,
-                      trans_model_.TransitionIdToPdf(transition_id));
+                      trans_model_.TransitionIdToPdfFast(transition_id));
+  }
+
+  // This copies the row for this frame to the CPU once, rather than
+  // accessing log_probs_ (which may be on the GPU) once per index.
+  virtual void LogLikelihoods(int32 frame,
+                              const std::vector<int32> &transition_ids,
+                              std::vector<BaseFloat> *log_likes) {
+    if (feats_) Compute();
+    if (frame != cached_frame_) {
+      frame_log_probs_.Resize(log_probs_.NumCols(), kUndefined);
+      log_probs_.Row(frame).CopyToVec(&frame_log_probs_);
+      cached_frame_ = frame;
+    }
+    log_likes->resize(transition_ids.size());
+    for (size_t i = 0; i < transition_ids.size(); i++)
+      (*log_likes)[i] =
+          frame_log_probs_(trans_model_.TransitionIdToPdfFast(transition_ids[i]));
   }
 
   int32 NumFrames() {
@@ -164,12 +212,201 @@ class DecodableAmNnetParallel: public DecodableInterface {
   const CuVector<BaseFloat> *spk_info_;
   bool pad_input_;
   BaseFloat prob_scale_;
+  int32 cached_frame_;  // frame whose log-probs are in frame_log_probs_.
+  Vector<BaseFloat> frame_log_probs_;
   KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableAmNnetParallel);
 };
 
 
 
 
+/// This version of DecodableAmNnet is for rescoring lattices, where we only
+/// need the likelihoods of the few pdfs per frame that appear in the lattice.
+/// The caller says in advance which (frame, pdf-id) pairs it will ask for (see
+/// CompactLatticeFramePdfs() in lat/lattice-functions.h).  We still have to do
+/// the whole neural net computation, since the softmax at the output needs all
+/// of its inputs; but we take the log and divide by the prior only for the
+/// requested pairs, and only those are copied from the GPU, rather than the
+/// whole #frames by #pdfs matrix.  It is an error to ask for a likelihood that
+/// was not requested.
+class DecodableAmNnetSparse: public DecodableInterface {
+ public:
+  DecodableAmNnetSparse(const TransitionModel &trans_model,
+                        const AmNnet &am_nnet,
+                        const CuMatrixBase<BaseFloat> &feats,
+                        const CuVectorBase<BaseFloat> &spk_info,
+                        const std::vector<std::pair<int32, int32> > &frame_pdfs,
+                        bool pad_input = true,
+                        BaseFloat prob_scale = 1.0):
+      trans_model_(trans_model) {
+    CuMatrix<BaseFloat> probs(feats.NumRows(), trans_model.NumPdfs());
+    // the following function is declared in nnet-compute.h
+    NnetComputation(am_nnet.GetNnet(), feats, spk_info, pad_input, &probs);
+    num_frames_ = probs.NumRows();
+    KALDI_ASSERT(am_nnet.Priors().Dim() == trans_model.NumPdfs() &&
+                 "Priors in neural network not set up.");
+
+    // frame_pdfs is sorted (so frame-major); we store the pdfs for frame t in
+    // pdfs_[frame_begin_[t] ... frame_begin_[t+1] - 1].  Pairs with frames
+    // past the end are ignored; RescoreCompactLattice() will notice the
+    // mismatch in length.
+    std::vector<Int32Pair> indices;
+    indices.reserve(frame_pdfs.size());
+    frame_begin_.resize(num_frames_ + 1, 0);
+    for (size_t i = 0; i < frame_pdfs.size(); i++) {
+      int32 t = frame_pdfs[i].first, pdf = frame_pdfs[i].second;
+      KALDI_ASSERT(t >= 0 && pdf >= 0 && pdf < trans_model.NumPdfs());
+      KALDI_ASSERT(i == 0 || frame_pdfs[i - 1] < frame_pdfs[i]);
+      if (t >= num_frames_) break;
+      Int32Pair index;
+      index.first = t;
+      index.second = pdf;
+      indices.push_back(index);
+      pdfs_.push_back(pdf);
+      frame_begin_[t + 1]++;
+    }
+    for (int32 t = 0; t < num_frames_; t++)
+      frame_begin_[t + 1] += frame_begin_[t];
+
+    probs.Lookup(indices, &log_probs_);
+    const VectorBase<BaseFloat> &priors = am_nnet.Priors();
+    for (size_t i = 0; i < log_probs_.size(); i++) {
+      BaseFloat prob = std::max(log_probs_[i], static_cast<BaseFloat>(1.0e-20));
+      // divide by the prior, and apply the probability scale.
+      log_probs_[i] = prob_scale * (Log(prob) - Log(priors(pdfs_[i])));
+    }
+  }
+
+  virtual BaseFloat LogLikelihood(int32 frame, int32 transition_id) {
+    KALDI_ASSERT(frame >= 0 && frame < num_frames_);
+    int32 pdf = trans_model_.TransitionIdToPdfFast(transition_id);
+    std::vector<int32>::const_iterator
+        begin = pdfs_.begin() + frame_begin_[frame],
+        end = pdfs_.begin() + frame_begin_[frame + 1],
+        iter = std::lower_bound(begin, end, pdf);
+    if (iter == end || *iter != pdf)
+      KALDI_ERR << "Likelihood of pdf " << pdf << " on frame " << frame
+                << " was not requested.";
+    return log_probs_[iter - pdfs_.begin()];
+  }
+
+  int32 NumFrames() { return num_frames_; }
+  
+  // Indices are one-based!  This is for compatibility with OpenFst.
+  virtual int32 NumIndices() { return trans_model_.NumTransitionIds(); }
+  
+  virtual bool IsLastFrame(int32 frame) {
+    KALDI_ASSERT(frame < NumFrames());
+    return (frame == NumFrames() - 1);
+  }
+
+ protected:
+  const TransitionModel &trans_model_;
+  int32 num_frames_;
+  std::vector<int32> frame_begin_;  // indexed by frame, plus one at the end.
+  std::vector<int32> pdfs_;  // the requested pdfs, sorted within each frame.
+  std::vector<BaseFloat> log_probs_;  // scaled log-likelihoods, as pdfs_.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableAmNnetSparse);
+};
+
+
+/// This class holds the model-dependent things that DecodableAmNnetPruned
+/// needs; create it once per model, not once per utterance.  The model must
+/// end with an AffineComponent (or a child class of it) followed by a
+/// SoftmaxComponent.  If normalizer_rank > 0, we also store a rank
+/// "normalizer_rank" approximation of the final affine layer (from its SVD),
+/// which is used to estimate the softmax normalizer on each frame.
+class DecodableAmNnetPrunedInfo {
+ public:
+  DecodableAmNnetPrunedInfo(const AmNnet &am_nnet, int32 normalizer_rank = 0);
+
+  /// The neural net without its final affine and softmax components.
+  const Nnet &HiddenNnet() const { return hidden_nnet_; }
+  int32 NumPdfs() const { return final_linear_.NumRows(); }
+  int32 NormalizerRank() const { return normalizer_in_.NumRows(); }
+
+ private:
+  friend class DecodableAmNnetPruned;
+  Nnet hidden_nnet_;
+  Matrix<BaseFloat> final_linear_;  // #pdfs by hidden-dim.
+  Vector<BaseFloat> final_bias_;
+  Vector<BaseFloat> log_priors_;
+  // The approximation to final_linear_ is normalizer_out_ * normalizer_in_,
+  // of dimensions #pdfs by rank and rank by hidden-dim.
+  CuMatrix<BaseFloat> normalizer_in_;
+  CuMatrix<BaseFloat> normalizer_out_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableAmNnetPrunedInfo);
+};
+
+/// This version of DecodableAmNnet is for decoding with models that have many
+/// pdfs, where the final affine layer is a large part of the computation.  We
+/// run the neural net up to the input of that layer for the whole utterance,
+/// and compute the output only for the pdfs that the decoder asks for (it
+/// asks for all the pdfs it needs on a frame in one call to LogLikelihoods()),
+/// caching them for the current frame.
+///
+/// The softmax normalizer would need the output for all pdfs.  If
+/// info.NormalizerRank() == 0 we leave it out; the log-likelihoods then differ
+/// from those of DecodableAmNnet by a constant on each frame, which changes
+/// neither the best path nor the beam pruning nor the lattice, only the total
+/// likelihood and the absolute acoustic costs.  Otherwise we estimate it from
+/// the low-rank approximation of the final layer, which costs about
+/// rank / hidden-dim of the full computation.
+class DecodableAmNnetPruned: public DecodableInterface {
+ public:
+  DecodableAmNnetPruned(const TransitionModel &trans_model,
+                        const DecodableAmNnetPrunedInfo &info,
+                        const CuMatrixBase<BaseFloat> &feats,
+                        const CuVectorBase<BaseFloat> &spk_info,
+                        bool pad_input = true,
+                        BaseFloat prob_scale = 1.0);
+
+  virtual BaseFloat LogLikelihood(int32 frame, int32 transition_id) {
+    return PdfLogLikelihood(frame,
+                            trans_model_.TransitionIdToPdfFast(transition_id));
+  }
+
+  virtual void LogLikelihoods(int32 frame,
+                              const std::vector<int32> &transition_ids,
+                              std::vector<BaseFloat> *log_likes) {
+    log_likes->resize(transition_ids.size());
+    for (size_t i = 0; i < transition_ids.size(); i++)
+      (*log_likes)[i] = PdfLogLikelihood(
+          frame, trans_model_.TransitionIdToPdfFast(transition_ids[i]));
+  }
+
+  /// The scaled log-likelihood of pdf "pdf" on frame "frame".
+  inline BaseFloat PdfLogLikelihood(int32 frame, int32 pdf) {
+    if (pdf_frame_[pdf] != frame) {
+      pdf_log_like_[pdf] = ComputePdfLogLikelihood(frame, pdf);
+      pdf_frame_[pdf] = frame;
+    }
+    return pdf_log_like_[pdf];
+  }
+
+  int32 NumFrames() { return hidden_.NumRows(); }
+
+  // Indices are one-based!  This is for compatibility with OpenFst.
+  virtual int32 NumIndices() { return trans_model_.NumTransitionIds(); }
+
+  virtual bool IsLastFrame(int32 frame) {
+    KALDI_ASSERT(frame < NumFrames());
+    return (frame == NumFrames() - 1);
+  }
+
+ protected:
+  BaseFloat ComputePdfLogLikelihood(int32 frame, int32 pdf) const;
+
+  const TransitionModel &trans_model_;
+  const DecodableAmNnetPrunedInfo &info_;
+  BaseFloat prob_scale_;
+  Matrix<BaseFloat> hidden_;  // input to the final affine layer, per frame.
+  Vector<BaseFloat> log_normalizer_;  // per frame; zero if not estimated.
+  std::vector<BaseFloat> pdf_log_like_;  // cached log-likelihood per pdf...
+  std::vector<int32> pdf_frame_;  // ... and the frame it is for, or -1.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableAmNnetPruned);
+};
+
   
 } // namespace nnet2
 } // namespace kaldi
@@ -651,6 +651,35 @@ void UnitTestFixedAffineComponent() {
   }
 }
 
+void UnitTestQuantizedAffineComponent() {
+  int32 input_dim = 5 + rand() % 40, output_dim = 5 + rand() % 10,
+      num_rows = 1 + rand() % 20;
+  AffineComponent affine;
+  affine.Init(0.01, input_dim, output_dim, 0.1, 1.0);
+  QuantizedAffineComponent component(affine);
+  KALDI_ASSERT(component.InputDim() == input_dim &&
+               component.OutputDim() == output_dim);
+
+  CuMatrix<BaseFloat> input(num_rows, input_dim), output, ref_output;
+  input.SetRandn();
+  affine.Propagate(input, 1, &ref_output);
+  component.Propagate(input, 1, &output);
+  // The error is a small fraction of the size of the output.
+  KALDI_ASSERT(output.ApproxEqual(ref_output, 0.05));
+
+  // Check that it can be written and read back.
+  bool binary = (rand() % 2 == 0);
+  Output ko("tmpf", binary);
+  component.Write(ko.Stream(), binary);
+  ko.Close();
+  bool binary_in;
+  Input ki("tmpf", &binary_in);
+  Component *component2 = Component::ReadNew(ki.Stream(), binary_in);
+  CuMatrix<BaseFloat> output2;
+  component2->Propagate(input, 1, &output2);
+  KALDI_ASSERT(output2.ApproxEqual(output, 0.05));
+  delete component2;
+}
 
 
 void UnitTestParsing() {
@@ -827,6 +856,7 @@ int main() {
       UnitTestDropoutComponent();
       UnitTestAdditiveNoiseComponent();
       UnitTestParsing();
+      UnitTestQuantizedAffineComponent();
       if (loop == 0)
         KALDI_LOG << "Tests without GPU use succeeded.\n";
       else
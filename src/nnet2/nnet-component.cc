@@ -25,6 +25,8 @@
 #include "nnet2/nnet-precondition-online.h"
 #include "util/text-utils.h"
 #include "util/kaldi-io.h"
+#include "util/stl-utils.h"
+#include "cudamatrix/cu-math.h"
 
 namespace kaldi {
 namespace nnet2 {
@@ -96,6 +98,8 @@ Component* Component::NewComponentOfType(const std::string &component_type) {
     ans = new FixedLinearComponent();
   } else if (component_type == "FixedAffineComponent") {
     ans = new FixedAffineComponent();
+  } else if (component_type == "QuantizedAffineComponent") {
+    ans = new QuantizedAffineComponent();
   } else if (component_type == "SpliceComponent") {
     ans = new SpliceComponent();
   } else if (component_type == "SpliceMaxComponent") {
@@ -525,13 +529,7 @@ void MaxoutComponent::Propagate(const CuMatrixBase<BaseFloat> &in,
                                 int32 num_chunks,
                                 CuMatrix<BaseFloat> *out) const {
   out->Resize(in.NumRows(), output_dim_, kUndefined);
-  int32 group_size = input_dim_ / output_dim_;
-  for (MatrixIndexT j = 0; j < output_dim_; j++) {
-    CuSubMatrix<BaseFloat> pool(out->ColRange(j, 1));
-    pool.Set(-1e20);
-    for (MatrixIndexT i = 0; i < group_size; i++)
-      pool.Max(in.ColRange(j * group_size + i, 1));
-  }
+  out->GroupMax(in);
 }
 
 void MaxoutComponent::Backprop(const CuMatrixBase<BaseFloat> &in_value,
@@ -540,23 +538,10 @@ void MaxoutComponent::Backprop(const CuMatrixBase<BaseFloat> &in_value,
                                int32, // num_chunks
                                Component *to_update, // to_update
                                CuMatrix<BaseFloat> *in_deriv) const {
-  int32 group_size = input_dim_ / output_dim_;
-  in_deriv->Resize(in_value.NumRows(), in_value.NumCols(), kSetZero);
-  for (MatrixIndexT j = 0; j < output_dim_; j++) {
-    CuSubMatrix<BaseFloat> out_j(out_value.ColRange(j, 1));
-    for (MatrixIndexT i = 0; i < group_size; i++) {
-        CuSubMatrix<BaseFloat> in_i(in_value.ColRange(j * group_size + i, 1));
-        CuSubMatrix<BaseFloat> in_deriv_i(in_deriv->ColRange(j * group_size + i, 1));
-        CuMatrix<BaseFloat> out_deriv_j(out_deriv.ColRange(j, 1));
-
-        // Only the pool-inputs with 'max-values' are used to back-propagate into,
-        // the rest of derivatives is zeroed-out by a mask.
-        CuMatrix<BaseFloat> mask;
-        in_i.EqualElementMask(out_j, &mask);
-        out_deriv_j.MulElements(mask);
-        in_deriv_i.AddMat(1.0, out_deriv_j); 
-    }
-  }
+  in_deriv->Resize(in_value.NumRows(), in_value.NumCols(), kUndefined);
+  // Only the pool-inputs with 'max-values' are back-propagated into; the
+  // rest of the derivatives are zero.
+  in_deriv->DiffGroupMax(in_value, out_value, out_deriv);
 }
 
 void MaxoutComponent::Read(std::istream &is, bool binary) {
@@ -621,9 +606,8 @@ void PnormComponent::Backprop(const CuMatrixBase<BaseFloat> &in_value,
                               int32, // num_chunks
                               Component *to_update, // to_update
                               CuMatrix<BaseFloat> *in_deriv) const {
-  in_deriv->Resize(in_value.NumRows(), in_value.NumCols(), kSetZero);
-  in_deriv->GroupPnormDeriv(in_value, out_value, p_);
-  in_deriv->MulRowsGroupMat(out_deriv); 
+  in_deriv->Resize(in_value.NumRows(), in_value.NumCols(), kUndefined);
+  in_deriv->DiffGroupPnorm(in_value, out_value, out_deriv, p_);
 }
 
 void PnormComponent::Read(std::istream &is, bool binary) {
@@ -866,7 +850,8 @@ void ScaleComponent::Backprop(const CuMatrixBase<BaseFloat> &, // in_value
 
   in_deriv->Resize(out_deriv.NumRows(), out_deriv.NumCols(),
                    kUndefined);
-  in_deriv->CopyFromMat(out_deriv);
+  if (in_deriv != &out_deriv)  // else we're working in place.
+    in_deriv->CopyFromMat(out_deriv);
   in_deriv->Scale(scale_);
 }  
 
@@ -1222,24 +1207,21 @@ void AffineComponent::LimitRank(int32 d,
   KALDI_ASSERT(d <= InputDim());
 
   // We'll limit the rank of just the linear part, keeping the bias vector full.
-  Matrix<BaseFloat> M (linear_params_);
-  int32 rows = M.NumRows(), cols = M.NumCols(), rc_min = std::min(rows, cols);
-  Vector<BaseFloat> s(rc_min);
-  Matrix<BaseFloat> U(rows, rc_min), Vt(rc_min, cols);
-  // Do the destructive svd M = U diag(s) V^T.  It actually outputs the transpose of V.
-  M.DestructiveSvd(&s, &U, &Vt);
-  SortSvd(&s, &U, &Vt); // Sort the singular values from largest to smallest.
-  BaseFloat old_svd_sum = s.Sum();
-  U.Resize(rows, d, kCopyData);
-  s.Resize(d, kCopyData);
-  Vt.Resize(d, cols, kCopyData);
-  BaseFloat new_svd_sum = s.Sum();
+  int32 rows = linear_params_.NumRows(), cols = linear_params_.NumCols(),
+      rc_min = std::min(rows, cols);
+  Vector<BaseFloat> s(d);
+  CuMatrix<BaseFloat> U(rows, d), Vt(d, cols);
+  // If d is much less than rc_min the randomized SVD is much faster than a
+  // full one, and close to exact; otherwise make it exact.
+  int32 oversample = ((d + 10) * 4 <= rc_min ? 10 : rc_min);
+  cu::RandomizedSvd(linear_params_, &s, &U, &Vt, oversample);
   KALDI_LOG << "Reduced rank from "
-            << rc_min <<  " to " << d << ", SVD sum reduced from "
-            << old_svd_sum << " to " << new_svd_sum;
+            << rc_min <<  " to " << d << ", Frobenius norm of parameters "
+            << "reduced from " << linear_params_.FrobeniusNorm() << " to "
+            << s.Norm(2.0);
 
   // U.MulColsVec(s); // U <-- U diag(s)
-  Vt.MulRowsVec(s); // Vt <-- diag(s) Vt.
+  Vt.MulRowsVec(CuVector<BaseFloat>(s)); // Vt <-- diag(s) Vt.
 
   *a = dynamic_cast<AffineComponent*>(this->Copy());
   *b = dynamic_cast<AffineComponent*>(this->Copy());
@@ -2416,6 +2398,33 @@ Component* AffinePreconInputComponent::Copy() const {
   return ans;
 }
 
+// Sets *blocks to the num_blocks equal row blocks (if by_rows) or column
+// blocks of "mat"; the caller must delete them.
+static void SplitIntoBlocks(const CuMatrixBase<BaseFloat> &mat,
+                            int32 num_blocks, bool by_rows,
+                            std::vector<CuSubMatrix<BaseFloat>*> *blocks) {
+  int32 block_dim = (by_rows ? mat.NumRows() : mat.NumCols()) / num_blocks;
+  blocks->resize(num_blocks);
+  for (int32 b = 0; b < num_blocks; b++)
+    (*blocks)[b] = (by_rows ?
+                    new CuSubMatrix<BaseFloat>(mat.RowRange(b * block_dim,
+                                                            block_dim)) :
+                    new CuSubMatrix<BaseFloat>(mat.ColRange(b * block_dim,
+                                                            block_dim)));
+}
+
+// Converts the output of SplitIntoBlocks() to the argument types of
+// AddMatMatBatched().
+static std::vector<CuMatrixBase<BaseFloat>*> ToMatrixBase(
+    const std::vector<CuSubMatrix<BaseFloat>*> &blocks) {
+  return std::vector<CuMatrixBase<BaseFloat>*>(blocks.begin(), blocks.end());
+}
+static std::vector<const CuMatrixBase<BaseFloat>*> ToConstMatrixBase(
+    const std::vector<CuSubMatrix<BaseFloat>*> &blocks) {
+  return std::vector<const CuMatrixBase<BaseFloat>*>(blocks.begin(),
+                                                     blocks.end());
+}
+
 void BlockAffineComponent::SetZero(bool treat_as_gradient) {
   if (treat_as_gradient) {
     SetLearningRate(1.0);
@@ -2487,17 +2496,19 @@ void BlockAffineComponent::Propagate(const CuMatrixBase<BaseFloat> &in,
 
   out->CopyRowsFromVec(bias_params_); // copies bias_params_ to each row
   // of *out.
-  
-  for (int32 b = 0; b < num_blocks_; b++) {
-    CuSubMatrix<BaseFloat> in_block(in, 0, num_frames,
-                                  b * input_block_dim, input_block_dim),
-        out_block(*out, 0, num_frames,
-                  b * output_block_dim, output_block_dim),
-        param_block(linear_params_,
-                    b * output_block_dim, output_block_dim,
-                    0, input_block_dim);
-    out_block.AddMatMat(1.0, in_block, kNoTrans, param_block, kTrans, 1.0);
-  }
+
+  // The blocks are multiplied as one batch.
+  std::vector<CuSubMatrix<BaseFloat>*> in_blocks, out_blocks, param_blocks;
+  SplitIntoBlocks(in, num_blocks_, false, &in_blocks);
+  SplitIntoBlocks(*out, num_blocks_, false, &out_blocks);
+  SplitIntoBlocks(linear_params_, num_blocks_, true, &param_blocks);
+  KALDI_ASSERT(num_frames == in.NumRows());
+  AddMatMatBatched<BaseFloat>(1.0, ToMatrixBase(out_blocks),
+                              ToConstMatrixBase(in_blocks), kNoTrans,
+                              ToConstMatrixBase(param_blocks), kTrans, 1.0);
+  DeletePointers(&in_blocks);
+  DeletePointers(&out_blocks);
+  DeletePointers(&param_blocks);
 }
 
 void BlockAffineComponent::UpdateSimple(
@@ -2508,19 +2519,21 @@ void BlockAffineComponent::UpdateSimple(
       num_frames = in_value.NumRows();
 
   bias_params_.AddRowSumMat(learning_rate_, out_deriv, 1.0);
-  for (int32 b = 0; b < num_blocks_; b++) {
-    CuSubMatrix<BaseFloat> in_value_block(in_value, 0, num_frames,
-                                        b * input_block_dim,
-                                        input_block_dim),
-        out_deriv_block(out_deriv, 0, num_frames,
-                        b * output_block_dim, output_block_dim),
-        param_block(linear_params_,
-                    b * output_block_dim, output_block_dim,
-                    0, input_block_dim);
-    // Update the parameters.
-    param_block.AddMatMat(learning_rate_, out_deriv_block, kTrans,
-                          in_value_block, kNoTrans, 1.0);
-  }
+  KALDI_ASSERT(in_value.NumCols() == input_block_dim * num_blocks_ &&
+               out_deriv.NumCols() == output_block_dim * num_blocks_ &&
+               out_deriv.NumRows() == num_frames);
+  // Update the parameters, all the blocks as one batch.
+  std::vector<CuSubMatrix<BaseFloat>*> in_value_blocks, out_deriv_blocks,
+      param_blocks;
+  SplitIntoBlocks(in_value, num_blocks_, false, &in_value_blocks);
+  SplitIntoBlocks(out_deriv, num_blocks_, false, &out_deriv_blocks);
+  SplitIntoBlocks(linear_params_, num_blocks_, true, &param_blocks);
+  AddMatMatBatched(learning_rate_, ToMatrixBase(param_blocks),
+                   ToConstMatrixBase(out_deriv_blocks), kTrans,
+                   ToConstMatrixBase(in_value_blocks), kNoTrans, 1.0f);
+  DeletePointers(&in_value_blocks);
+  DeletePointers(&out_deriv_blocks);
+  DeletePointers(&param_blocks);
 }
 
 void BlockAffineComponent::Backprop(
@@ -2540,22 +2553,20 @@ void BlockAffineComponent::Backprop(
   KALDI_ASSERT(in_value.NumCols() == input_block_dim * num_blocks_);
   KALDI_ASSERT(out_deriv.NumCols() == output_block_dim * num_blocks_);
 
-  for (int32 b = 0; b < num_blocks_; b++) {
-    CuSubMatrix<BaseFloat> in_value_block(in_value, 0, num_frames,
-                                        b * input_block_dim,
-                                        input_block_dim),
-        in_deriv_block(*in_deriv, 0, num_frames,
-                       b * input_block_dim, input_block_dim),
-        out_deriv_block(out_deriv, 0, num_frames,
-                        b * output_block_dim, output_block_dim),
-        param_block(linear_params_,
-                    b * output_block_dim, output_block_dim,
-                    0, input_block_dim);
-
-    // Propagate the derivative back to the input.
-    in_deriv_block.AddMatMat(1.0, out_deriv_block, kNoTrans,
-                             param_block, kNoTrans, 0.0);
-  }
+  KALDI_ASSERT(out_deriv.NumRows() == num_frames);
+
+  // Propagate the derivative back to the input, all the blocks as one batch.
+  std::vector<CuSubMatrix<BaseFloat>*> in_deriv_blocks, out_deriv_blocks,
+      param_blocks;
+  SplitIntoBlocks(*in_deriv, num_blocks_, false, &in_deriv_blocks);
+  SplitIntoBlocks(out_deriv, num_blocks_, false, &out_deriv_blocks);
+  SplitIntoBlocks(linear_params_, num_blocks_, true, &param_blocks);
+  AddMatMatBatched<BaseFloat>(1.0, ToMatrixBase(in_deriv_blocks),
+                              ToConstMatrixBase(out_deriv_blocks), kNoTrans,
+                              ToConstMatrixBase(param_blocks), kNoTrans, 0.0);
+  DeletePointers(&in_deriv_blocks);
+  DeletePointers(&out_deriv_blocks);
+  DeletePointers(&param_blocks);
   if (to_update != NULL)
     to_update->Update(in_value, out_deriv);
 }
@@ -3027,25 +3038,35 @@ void MixtureProbComponent::Propagate(const CuMatrixBase<BaseFloat> &in,
                                      int32, // num_chunks
                                      CuMatrix<BaseFloat> *out) const {
   KALDI_ASSERT(in.NumCols() == InputDim());
-  out->Resize(in.NumRows(), OutputDim());
+  // The blocks cover all of *out, so it need not be zeroed.
+  out->Resize(in.NumRows(), OutputDim(), kUndefined);
   
   int32 num_frames = in.NumRows(),
       input_offset = 0,
       output_offset = 0;
 
+  // The blocks are multiplied as one batch.
+  std::vector<CuSubMatrix<BaseFloat>*> in_blocks(params_.size()),
+      out_blocks(params_.size());
+  std::vector<const CuMatrixBase<BaseFloat>*> param_blocks(params_.size());
   for (size_t i = 0; i < params_.size(); i++) {
     int32 this_input_dim = params_[i].NumCols(), // input dim of this block.
          this_output_dim = params_[i].NumRows();
     KALDI_ASSERT(this_input_dim > 0 && this_output_dim > 0);
-    CuSubMatrix<BaseFloat> in_block(in, 0, num_frames,
-                                  input_offset, this_input_dim),
-        out_block(*out, 0, num_frames, output_offset, this_output_dim);
-    const CuMatrix<BaseFloat> &param_block(params_[i]);
-    out_block.AddMatMat(1.0, in_block, kNoTrans, param_block, kTrans, 0.0);
+    in_blocks[i] = new CuSubMatrix<BaseFloat>(in, 0, num_frames,
+                                              input_offset, this_input_dim);
+    out_blocks[i] = new CuSubMatrix<BaseFloat>(*out, 0, num_frames,
+                                               output_offset, this_output_dim);
+    param_blocks[i] = &(params_[i]);
     input_offset += this_input_dim;
     output_offset += this_output_dim;   
   }
   KALDI_ASSERT(input_offset == InputDim() && output_offset == OutputDim());
+  AddMatMatBatched<BaseFloat>(1.0, ToMatrixBase(out_blocks),
+                              ToConstMatrixBase(in_blocks), kNoTrans,
+                              param_blocks, kTrans, 0.0);
+  DeletePointers(&in_blocks);
+  DeletePointers(&out_blocks);
 }
 
 void MixtureProbComponent::Backprop(const CuMatrixBase<BaseFloat> &in_value,
@@ -3228,7 +3249,7 @@ void SumGroupComponent::Backprop(const CuMatrixBase<BaseFloat> &, // in_value,
                                  int32 num_chunks,
                                  Component *to_update,
                                  CuMatrix<BaseFloat> *in_deriv) const {
-  in_deriv->Resize(out_deriv.NumRows(), InputDim());
+  in_deriv->Resize(out_deriv.NumRows(), InputDim(), kUndefined);
   in_deriv->CopyCols(out_deriv, reverse_indexes_);
 }
 
@@ -4018,6 +4039,90 @@ void FixedAffineComponent::Read(std::istream &is, bool binary) {
 
 
 
+QuantizedAffineComponent::QuantizedAffineComponent(
+    const AffineComponent &other) {
+  // LinearParams() and BiasParams() are not const.
+  AffineComponent &other_nonconst = const_cast<AffineComponent&>(other);
+  Matrix<BaseFloat> linear_params(other_nonconst.LinearParams());
+  linear_params_.CopyFromMat(linear_params);
+  bias_params_ = other_nonconst.BiasParams();
+}
+
+void QuantizedAffineComponent::InitFromString(std::string args) {
+  KALDI_ERR << "QuantizedAffineComponent cannot be initialized from a "
+            << "string; quantize a trained model instead (e.g. "
+            << "nnet-am-copy --quantize=true)";
+}
+
+std::string QuantizedAffineComponent::Info() const {
+  std::stringstream stream;
+  Matrix<BaseFloat> linear_params(linear_params_.NumRows(),
+                                  linear_params_.NumCols(), kUndefined);
+  linear_params_.CopyToMat(&linear_params);
+  BaseFloat linear_params_size =
+      static_cast<BaseFloat>(linear_params.NumRows())
+      * static_cast<BaseFloat>(linear_params.NumCols()),
+      linear_params_stddev =
+      std::sqrt(TraceMatMat(linear_params, linear_params, kTrans) /
+                linear_params_size),
+      bias_params_stddev = std::sqrt(VecVec(bias_params_, bias_params_) /
+                                     bias_params_.Dim());
+  stream << Component::Info() << ", linear-params-stddev="
+         << linear_params_stddev << ", bias-params-stddev="
+         << bias_params_stddev;
+  return stream.str();
+}
+
+void QuantizedAffineComponent::Propagate(const CuMatrixBase<BaseFloat> &in,
+                                         int32 num_chunks,
+                                         CuMatrix<BaseFloat> *out) const {
+  // The multiplication is always done on the CPU (if a GPU is in use, this
+  // involves copying the data).
+  Matrix<BaseFloat> in_cpu(in.NumRows(), in.NumCols(), kUndefined),
+      out_cpu(in.NumRows(), OutputDim(), kUndefined);
+  in.CopyToMat(&in_cpu);
+  linear_params_.AddMatMatTrans(static_cast<BaseFloat>(1.0), in_cpu,
+                                static_cast<BaseFloat>(0.0), &out_cpu);
+  out->Resize(in.NumRows(), OutputDim(), kUndefined);
+  out->CopyFromMat(out_cpu);
+  out->AddVecToRows(1.0, bias_params_);
+}
+
+void QuantizedAffineComponent::Backprop(const CuMatrixBase<BaseFloat> &,
+                                        const CuMatrixBase<BaseFloat> &,
+                                        const CuMatrixBase<BaseFloat> &,
+                                        int32, Component *,
+                                        CuMatrix<BaseFloat> *) const {
+  KALDI_ERR << "Backprop is not supported for QuantizedAffineComponent "
+            << "(quantized models are for inference only).";
+}
+
+Component* QuantizedAffineComponent::Copy() const {
+  QuantizedAffineComponent *ans = new QuantizedAffineComponent();
+  ans->linear_params_ = linear_params_;
+  ans->bias_params_ = bias_params_;
+  return ans;
+}
+
+void QuantizedAffineComponent::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<QuantizedAffineComponent>");
+  WriteToken(os, binary, "<LinearParams>");
+  linear_params_.Write(os, binary);
+  WriteToken(os, binary, "<BiasParams>");
+  bias_params_.Write(os, binary);
+  WriteToken(os, binary, "</QuantizedAffineComponent>");
+}
+
+void QuantizedAffineComponent::Read(std::istream &is, bool binary) {
+  ExpectOneOrTwoTokens(is, binary, "<QuantizedAffineComponent>",
+                       "<LinearParams>");
+  linear_params_.Read(is, binary);
+  ExpectToken(is, binary, "<BiasParams>");
+  bias_params_.Read(is, binary);
+  ExpectToken(is, binary, "</QuantizedAffineComponent>");
+}
+
+
 std::string DropoutComponent::Info() const {
   std::stringstream stream;
   stream << Component::Info() << ", dropout_proportion = "
@@ -4111,7 +4216,8 @@ void DropoutComponent::Backprop(const CuMatrixBase<BaseFloat> &in_value,
                                 Component *, // to_update
                                 CuMatrix<BaseFloat> *in_deriv) const {
   KALDI_ASSERT(SameDim(in_value, out_value) && SameDim(in_value, out_deriv));
-  in_deriv->Resize(out_deriv.NumRows(), out_deriv.NumCols());
+  // kUndefined, since we may be working in place.
+  in_deriv->Resize(out_deriv.NumRows(), out_deriv.NumCols(), kUndefined);
   in_deriv->AddMatMatDivMat(out_deriv, out_value, in_value);
 }
 
@@ -108,6 +108,8 @@ class Component {
   // the "in_value" to Backprop may be a dummy variable.
   virtual bool BackpropNeedsOutput() const { return true; } // if this returns false,
   // the "out_value" to Backprop may be a dummy variable.
+  virtual bool BackpropInPlace() const { return false; } // if this returns
+  // true, "in_deriv" to Backprop may be the same object as "out_deriv".
   
   /// Read component from stream
   static Component* ReadNew(std::istream &is, bool binary);
@@ -524,6 +526,7 @@ class ScaleComponent: public Component {
   virtual Component* Copy() const { return new ScaleComponent(*this); }
   virtual bool BackpropNeedsInput() const { return false; }
   virtual bool BackpropNeedsOutput() const { return false; }
+  virtual bool BackpropInPlace() const { return true; }
   virtual void Propagate(const CuMatrixBase<BaseFloat> &in,
                          int32 num_chunks,
                          CuMatrix<BaseFloat> *out) const; 
@@ -642,8 +645,8 @@ class AffineComponent: public UpdatableComponent {
   // This new function is used when mixing up:
   virtual void SetParams(const VectorBase<BaseFloat> &bias,
                          const MatrixBase<BaseFloat> &linear);
-  const CuVector<BaseFloat> &BiasParams() { return bias_params_; }
-  const CuMatrix<BaseFloat> &LinearParams() { return linear_params_; }
+  const CuVector<BaseFloat> &BiasParams() const { return bias_params_; }
+  const CuMatrix<BaseFloat> &LinearParams() const { return linear_params_; }
 
   virtual int32 GetParameterDim() const;
   virtual void Vectorize(VectorBase<BaseFloat> *params) const;
@@ -1539,6 +1542,47 @@ class FixedAffineComponent: public Component {
 };
 
 
+/// QuantizedAffineComponent is an affine transform whose weights are stored
+/// in 8 bits per element (see class QuantizedMatrix), for faster inference on
+/// CPU; it is created from an AffineComponent by Nnet::Quantize() (see
+/// nnet-am-copy --quantize), and cannot be trained.  The input is quantized
+/// row by row on the fly.  When a GPU is in use, the data is copied to the
+/// CPU for the multiplication, so this is not useful on GPU.
+class QuantizedAffineComponent: public Component {
+ public:
+  QuantizedAffineComponent() { }
+  explicit QuantizedAffineComponent(const AffineComponent &other);
+  virtual std::string Type() const { return "QuantizedAffineComponent"; }
+  virtual std::string Info() const;
+
+  // There is nothing to initialize from a string; use Nnet::Quantize().
+  virtual void InitFromString(std::string args);
+
+  virtual int32 InputDim() const { return linear_params_.NumCols(); }
+  virtual int32 OutputDim() const { return linear_params_.NumRows(); }
+  virtual void Propagate(const CuMatrixBase<BaseFloat> &in,
+                         int32 num_chunks,
+                         CuMatrix<BaseFloat> *out) const;
+  // Backprop is not supported (it dies).
+  virtual void Backprop(const CuMatrixBase<BaseFloat> &in_value,
+                        const CuMatrixBase<BaseFloat> &out_value,
+                        const CuMatrixBase<BaseFloat> &out_deriv,
+                        int32 num_chunks,
+                        Component *to_update,
+                        CuMatrix<BaseFloat> *in_deriv) const;
+  virtual bool BackpropNeedsInput() const { return false; }
+  virtual bool BackpropNeedsOutput() const { return false; }
+  virtual Component* Copy() const;
+  virtual void Read(std::istream &is, bool binary);
+  virtual void Write(std::ostream &os, bool binary) const;
+ protected:
+  QuantizedMatrix linear_params_;
+  CuVector<BaseFloat> bias_params_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(QuantizedAffineComponent);
+};
+
+
 /// This Component, if present, randomly zeroes half of
 /// the inputs and multiplies the other half by two.
 /// Typically you would use this in training but not in
@@ -1571,6 +1615,7 @@ class DropoutComponent: public RandomComponent {
   void SetDropoutScale(BaseFloat scale) { dropout_scale_ = scale; }
   virtual bool BackpropNeedsInput() const { return true; }
   virtual bool BackpropNeedsOutput() const { return true; }  
+  virtual bool BackpropInPlace() const { return true; }
   virtual Component* Copy() const;
   virtual void Propagate(const CuMatrixBase<BaseFloat> &in,
                          int32 num_chunks,
@@ -17,6 +17,7 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <deque>
 #include "nnet2/nnet-compute-discriminative-parallel.h"
 #include "hmm/posterior.h"
@@ -216,6 +217,86 @@ void NnetDiscriminativeUpdateParallel(
 }
 
 
+/* This struct holds an example that is in the pipeline of
+   NnetDiscriminativeUpdatePipelined(), and its updater.  The static function
+   Run() is run in a thread of MultiThreadPool to do the lattice
+   computation. */
+struct DiscriminativePipelineTask {
+  DiscriminativePipelineTask(const AmNnet &am_nnet,
+                             const TransitionModel &tmodel,
+                             const NnetDiscriminativeUpdateOptions &opts,
+                             const DiscriminativeNnetExample &eg_in,
+                             Nnet *nnet_to_update):
+      eg(eg_in), updater(am_nnet, tmodel, opts, eg, nnet_to_update, &stats) { }
+
+  static void *Run(void *task_in) {
+    DiscriminativePipelineTask *task =
+        static_cast<DiscriminativePipelineTask*>(task_in);
+    task->updater.LatticeForwardBackward();
+    task->done.Signal();
+    return NULL;
+  }
+
+  DiscriminativeNnetExample eg;  // must be declared before "updater", which
+                                 // holds a reference to it.
+  NnetDiscriminativeStats stats;
+  NnetDiscriminativeUpdater updater;
+  Semaphore done;  // signaled when the lattice computation has finished.
+};
+
+
+void NnetDiscriminativeUpdatePipelined(
+    const AmNnet &am_nnet,
+    const TransitionModel &tmodel,
+    const NnetDiscriminativeUpdateOptions &opts,
+    int32 num_threads,
+    SequentialDiscriminativeNnetExampleReader *example_reader,
+    Nnet *nnet_to_update,
+    NnetDiscriminativeStats *stats) {
+  if (opts.cuda_lattice)
+    KALDI_ERR << "--cuda-lattice=true cannot be used with pipelined training.";
+  num_threads = std::max<int32>(num_threads, 1);
+
+  std::deque<DiscriminativePipelineTask*> pending;
+  ThreadGroup group;
+  bool examples_done = false;
+  while (true) {
+    if (!examples_done) {
+      if (example_reader->Done()) {
+        examples_done = true;
+      } else {
+        DiscriminativePipelineTask *task = new DiscriminativePipelineTask(
+            am_nnet, tmodel, opts, example_reader->Value(), nnet_to_update);
+        example_reader->Next();
+        task->updater.Propagate();
+        task->updater.LookupLikelihoods();
+        MultiThreadPool::Instantiate().Run(DiscriminativePipelineTask::Run,
+                                           task, &group);
+        pending.push_back(task);
+      }
+    }
+    if (pending.empty()) break;
+    // Finish the oldest example if its lattice computation is done; if there
+    // are too many in the pipeline, or no more examples to read, wait for it.
+    DiscriminativePipelineTask *task = pending.front();
+    if (examples_done ||
+        static_cast<int32>(pending.size()) > num_threads) {
+      task->done.Wait();
+    } else if (!task->done.TryWait()) {
+      continue;
+    }
+    pending.pop_front();
+    task->updater.ComputeOutputDeriv();
+    if (nnet_to_update != NULL)
+      task->updater.Backprop();
+    stats->Add(task->stats);
+    delete task;
+  }
+  group.Wait();
+  stats->Print(opts.criterion);
+}
+
+
 
 } // namespace nnet2
 } // namespace kaldi
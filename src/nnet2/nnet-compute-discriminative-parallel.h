@@ -42,6 +42,26 @@ void NnetDiscriminativeUpdateParallel(
     Nnet *nnet_to_update,
     NnetDiscriminativeStats *stats);
 
+/* This version is for a GPU-based setup (although it works without a GPU).
+   It pipelines the computation: the calling thread does the neural-net
+   propagation and backprop (i.e. all the work on the GPU), while up to
+   num_threads other threads do the lattice forward-backward for the examples
+   that have been propagated.  So the GPU propagates example N+1 while the
+   lattice computation for example N is done on the CPU.  The updates are
+   applied in the same order as the examples are read.  Note that this means
+   that each example is propagated with a model that does not yet include the
+   updates from up to num_threads previous examples, which is harmless in SGD.
+   This cannot be used with opts.cuda_lattice == true.
+*/
+void NnetDiscriminativeUpdatePipelined(
+    const AmNnet &am_nnet,
+    const TransitionModel &tmodel,
+    const NnetDiscriminativeUpdateOptions &opts,
+    int32 num_threads,
+    SequentialDiscriminativeNnetExampleReader *example_reader,
+    Nnet *nnet_to_update,
+    NnetDiscriminativeStats *stats);
+
 
 } // namespace nnet2
 } // namespace kaldi
@@ -20,84 +20,11 @@
 #include "nnet2/nnet-compute-discriminative.h"
 #include "hmm/posterior.h"
 #include "lat/lattice-functions.h"
+#include "lat/cu-lattice-functions.h"
 
 namespace kaldi {
 namespace nnet2 {
 
-/*
-  This class does the forward and possibly backward computation for (typically)
-  a whole utterance of contiguous features.  You'll instantiate one of
-  these classes each time you want to do this computation.
-*/
-class NnetDiscriminativeUpdater {
- public:
-
-  NnetDiscriminativeUpdater(const AmNnet &am_nnet,
-                            const TransitionModel &tmodel,
-                            const NnetDiscriminativeUpdateOptions &opts,
-                            const DiscriminativeNnetExample &eg,
-                            Nnet *nnet_to_update,
-                            NnetDiscriminativeStats *stats);
-
-  void Update() {
-    Propagate();
-    LatticeComputations();
-    if (nnet_to_update_ != NULL)
-      Backprop();
-  }
-  
-  /// The forward-through-the-layers part of the computation.
-  void Propagate();  
-
-  /// Does the parts between Propagate() and Backprop(), that
-  /// involve forward-backward over the lattice.
-  void LatticeComputations();
-  
-  void Backprop();
-
-  /// Assuming the lattice already has the correct scores in
-  /// it, this function does the MPE or MMI forward-backward
-  /// and puts the resulting discriminative posteriors (which
-  /// may have positive or negative weight) into "post".
-  /// It returns, for MPFE/SMBR, the objective function, or
-  /// for MMI, the negative of the denominator-lattice log-likelihood.
-  double GetDiscriminativePosteriors(Posterior *post);
-  
-  SubMatrix<BaseFloat> GetInputFeatures() const;
-  
-  CuMatrixBase<BaseFloat> &GetOutput() { return forward_data_.back(); }
-
-  static inline Int32Pair MakePair(int32 first, int32 second) {
-    Int32Pair ans;
-    ans.first = first;
-    ans.second = second;
-    return ans;
-  }
-  
- private:
-  typedef LatticeArc Arc;
-  typedef Arc::StateId StateId;
-
-  
-  const AmNnet &am_nnet_;
-  const TransitionModel &tmodel_;
-  const NnetDiscriminativeUpdateOptions &opts_;
-  const DiscriminativeNnetExample &eg_;
-  Nnet *nnet_to_update_; // will equal am_nnet_.GetNnet(), in SGD case, or
-                         // another Nnet, in gradient-computation case, or
-                         // NULL if we just need the objective function.
-  NnetDiscriminativeStats *stats_; // the objective function, etc.
-  
-  // forward_data_[i] is the input of the i'th component and (if i > 0)
-  // the output of the i-1'th component.
-  std::vector<CuMatrix<BaseFloat> > forward_data_; 
-  Lattice lat_; // we convert the CompactLattice in the eg, into Lattice form.
-  CuMatrix<BaseFloat> backward_data_;
-  std::vector<int32> silence_phones_; // derived from opts_.silence_phones_str
-};
-
-
-
 NnetDiscriminativeUpdater::NnetDiscriminativeUpdater(
     const AmNnet &am_nnet,
     const TransitionModel &tmodel,
@@ -176,6 +103,12 @@ void NnetDiscriminativeUpdater::Propagate() {
 
 
 void NnetDiscriminativeUpdater::LatticeComputations() {
+  LookupLikelihoods();
+  LatticeForwardBackward();
+  ComputeOutputDeriv();
+}
+
+void NnetDiscriminativeUpdater::LookupLikelihoods() {
   ConvertLattice(eg_.den_lat, &lat_); // convert to Lattice.
   TopSort(&lat_); // Topologically sort (required by forward-backward algorithms)
 
@@ -234,7 +167,7 @@ void NnetDiscriminativeUpdater::LatticeComputations() {
     }
   }
 
-  std::vector<BaseFloat> answers;
+  std::vector<BaseFloat> &answers(answers_);
   posteriors.Lookup(requested_indexes, &answers);
 
   int32 num_floored = 0;
@@ -258,8 +191,11 @@ void NnetDiscriminativeUpdater::LatticeComputations() {
   if (num_floored > 0) {
     KALDI_WARN << "Floored " << num_floored << " probabilities from nnet.";
   }
-  
-  index = 0;
+}
+
+void NnetDiscriminativeUpdater::LatticeForwardBackward() {
+  const std::vector<BaseFloat> &answers(answers_);
+  size_t index = 0;
   
   if (opts_.criterion == "mmi") {
     double tot_num_like = 0.0;
@@ -269,6 +205,7 @@ void NnetDiscriminativeUpdater::LatticeComputations() {
   }
 
   // Now put the (scaled) acoustic log-likelihoods in the lattice.
+  StateId num_states = lat_.NumStates();
   for (StateId s = 0; s < num_states; s++) {
     for (fst::MutableArcIterator<Lattice> aiter(&lat_, s);
          !aiter.Done(); aiter.Next()) {
@@ -286,6 +223,18 @@ void NnetDiscriminativeUpdater::LatticeComputations() {
     }
   }
   
+  if (opts_.cuda_lattice) {
+    // Compute the posteriors without copying them between the GPU and the
+    // CPU.
+    stats_->tot_den_objf += eg_.weight *
+        GetDiscriminativePosteriorsCuda(&cu_post_);
+    cu_post_.Scale(eg_.weight);
+    CuMatrix<BaseFloat> num_post(cu_post_);
+    num_post.ApplyFloor(0.0);
+    stats_->tot_num_count += num_post.Sum();
+    return;
+  }
+
   // Get the MPE or MMI posteriors.
   Posterior post;
   stats_->tot_den_objf += eg_.weight * GetDiscriminativePosteriors(&post);
@@ -293,7 +242,8 @@ void NnetDiscriminativeUpdater::LatticeComputations() {
   ScalePosterior(eg_.weight, &post);
 
   double tot_num_post = 0.0, tot_den_post = 0.0;
-  std::vector<MatrixElement<BaseFloat> > sv_labels;
+  std::vector<MatrixElement<BaseFloat> > &sv_labels(sv_labels_);
+  sv_labels.clear();
   sv_labels.reserve(answers.size());
   for (int32 t = 0; t < post.size(); t++) {
     for (int32 i = 0; i < post[t].size(); i++) {
@@ -306,14 +256,26 @@ void NnetDiscriminativeUpdater::LatticeComputations() {
     }
   }
   stats_->tot_num_count += tot_num_post;
+}
+
+void NnetDiscriminativeUpdater::ComputeOutputDeriv() {
   int32 num_components = am_nnet_.GetNnet().NumComponents();
   const CuMatrix<BaseFloat> &output(forward_data_[num_components]);
+  if (opts_.cuda_lattice) {
+    // The derivative w.r.t. the output is post / output, as in
+    // CompObjfAndDeriv().
+    backward_data_.Resize(output.NumRows(), output.NumCols(), kUndefined);
+    backward_data_.CopyFromMat(output);
+    backward_data_.InvertElements();
+    backward_data_.MulElements(cu_post_);
+    return;
+  }
   backward_data_.Resize(output.NumRows(), output.NumCols()); // zeroes it.
   
   { // We don't actually need tot_objf and tot_weight; we have already
     // computed the objective function.
     BaseFloat tot_objf, tot_weight;
-    backward_data_.CompObjfAndDeriv(sv_labels, output, &tot_objf, &tot_weight);
+    backward_data_.CompObjfAndDeriv(sv_labels_, output, &tot_objf, &tot_weight);
     // Now backward_data_ will contan the derivative at the output.
     // Our work here is done..
   }
@@ -340,6 +302,20 @@ double NnetDiscriminativeUpdater::GetDiscriminativePosteriors(Posterior *post) {
   }
 }
 
+double NnetDiscriminativeUpdater::GetDiscriminativePosteriorsCuda(
+    CuMatrix<BaseFloat> *post) {
+  if (opts_.criterion == "mpfe" || opts_.criterion == "smbr") {
+    return LatticeForwardBackwardMpeVariantsCuda(tmodel_, silence_phones_,
+                                                 lat_, eg_.num_ali,
+                                                 opts_.criterion,
+                                                 post) * eg_.weight;
+  } else {
+    KALDI_ASSERT(opts_.criterion == "mmi");
+    return LatticeForwardBackwardMmiCuda(tmodel_, lat_, eg_.num_ali,
+                                         opts_.drop_frames, post);
+  }
+}
+
 
 
 void NnetDiscriminativeUpdater::Backprop() {
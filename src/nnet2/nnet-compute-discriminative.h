@@ -23,6 +23,8 @@
 #include "nnet2/am-nnet.h"
 #include "nnet2/nnet-example.h"
 #include "hmm/transition-model.h"
+#include "hmm/posterior.h"
+#include "lat/kaldi-lattice.h"
 
 namespace kaldi {
 namespace nnet2 {
@@ -41,9 +43,12 @@ struct NnetDiscriminativeUpdateOptions {
 
   std::string silence_phones_str; // colon-separated list of integer ids of silence phones,
                                   // for MPE/SMBR only.
+  bool cuda_lattice; // if true, do the lattice forward-backward with the
+                     // functions in ../lat/cu-lattice-functions.h.
 
   NnetDiscriminativeUpdateOptions(): criterion("smbr"), acoustic_scale(0.1),
-                                     drop_frames(false), boost(0.0) { }
+                                     drop_frames(false), boost(0.0),
+                                     cuda_lattice(false) { }
   
   void Register(OptionsItf *po) {
     po->Register("criterion", &criterion, "Criterion, 'mmi'|'mpfe'|'smbr', "
@@ -57,7 +62,9 @@ struct NnetDiscriminativeUpdateOptions {
     po->Register("silence-phones", &silence_phones_str,
                  "For MPFE or SMBR, colon-separated list of integer ids of "
                  "silence phones, e.g. 1:2:3");
-    
+    po->Register("cuda-lattice", &cuda_lattice, "If true, do the lattice "
+                 "forward-backward on the GPU (if we are using one), and "
+                 "compute the derivatives there too.");
   }
 };
 
@@ -77,6 +84,109 @@ struct NnetDiscriminativeStats {
   void Add(const NnetDiscriminativeStats &other);
 };
 
+/*
+  This class does the forward and possibly backward computation for (typically)
+  a whole utterance of contiguous features.  You'll instantiate one of
+  these classes each time you want to do this computation.
+*/
+class NnetDiscriminativeUpdater {
+ public:
+
+  NnetDiscriminativeUpdater(const AmNnet &am_nnet,
+                            const TransitionModel &tmodel,
+                            const NnetDiscriminativeUpdateOptions &opts,
+                            const DiscriminativeNnetExample &eg,
+                            Nnet *nnet_to_update,
+                            NnetDiscriminativeStats *stats);
+
+  void Update() {
+    Propagate();
+    LatticeComputations();
+    if (nnet_to_update_ != NULL)
+      Backprop();
+  }
+  
+  /// The forward-through-the-layers part of the computation.
+  void Propagate();  
+
+  /// Does the parts between Propagate() and Backprop(), that
+  /// involve forward-backward over the lattice.  This just calls
+  /// LookupLikelihoods(), LatticeForwardBackward() and ComputeOutputDeriv().
+  void LatticeComputations();
+
+  /// The first part of LatticeComputations(): prepares the lattice and looks
+  /// up the nnet outputs that we need for it.  This uses the nnet output, so
+  /// it may involve the GPU.
+  void LookupLikelihoods();
+
+  /// The second part of LatticeComputations(): puts the acoustic scores in the
+  /// lattice, and does the forward-backward.  Unless opts.cuda_lattice ==
+  /// true this does not touch the GPU, so it may be called in a different
+  /// thread from the rest of the computation (see
+  /// NnetDiscriminativeUpdatePipelined()).
+  void LatticeForwardBackward();
+
+  /// The last part of LatticeComputations(): computes the derivative w.r.t.
+  /// the nnet output, from the posteriors.
+  void ComputeOutputDeriv();
+  
+  void Backprop();
+
+  /// Assuming the lattice already has the correct scores in
+  /// it, this function does the MPE or MMI forward-backward
+  /// and puts the resulting discriminative posteriors (which
+  /// may have positive or negative weight) into "post".
+  /// It returns, for MPFE/SMBR, the objective function, or
+  /// for MMI, the negative of the denominator-lattice log-likelihood.
+  double GetDiscriminativePosteriors(Posterior *post);
+
+  /// As GetDiscriminativePosteriors(), but using the functions in
+  /// ../lat/cu-lattice-functions.h; outputs the posteriors as a
+  /// (frame, pdf-id) matrix.
+  double GetDiscriminativePosteriorsCuda(CuMatrix<BaseFloat> *post);
+  
+  SubMatrix<BaseFloat> GetInputFeatures() const;
+  
+  CuMatrixBase<BaseFloat> &GetOutput() { return forward_data_.back(); }
+
+  static inline Int32Pair MakePair(int32 first, int32 second) {
+    Int32Pair ans;
+    ans.first = first;
+    ans.second = second;
+    return ans;
+  }
+  
+ private:
+  typedef LatticeArc Arc;
+  typedef Arc::StateId StateId;
+
+  
+  const AmNnet &am_nnet_;
+  const TransitionModel &tmodel_;
+  const NnetDiscriminativeUpdateOptions &opts_;
+  const DiscriminativeNnetExample &eg_;
+  Nnet *nnet_to_update_; // will equal am_nnet_.GetNnet(), in SGD case, or
+                         // another Nnet, in gradient-computation case, or
+                         // NULL if we just need the objective function.
+  NnetDiscriminativeStats *stats_; // the objective function, etc.
+  
+  // forward_data_[i] is the input of the i'th component and (if i > 0)
+  // the output of the i-1'th component.
+  std::vector<CuMatrix<BaseFloat> > forward_data_; 
+  Lattice lat_; // we convert the CompactLattice in the eg, into Lattice form.
+  // The values looked up from the nnet output in LookupLikelihoods(), in the
+  // order: numerator alignment (if MMI), then the lattice arcs.
+  std::vector<BaseFloat> answers_;
+  // The discriminative posteriors from LatticeForwardBackward(), as
+  // (frame, pdf-id, weight); if opts_.cuda_lattice == true they are in
+  // cu_post_ instead.
+  std::vector<MatrixElement<BaseFloat> > sv_labels_;
+  CuMatrix<BaseFloat> cu_post_;
+  CuMatrix<BaseFloat> backward_data_;
+  std::vector<int32> silence_phones_; // derived from opts_.silence_phones_str
+};
+
+
 /** Does the neural net computation, lattice forward-backward, and backprop,
     for either the MMI, MPFE or SMBR objective functions.
     If nnet_to_update == &(am_nnet.GetNnet()), then this does stochastic
@@ -19,6 +19,7 @@
 
 #include "nnet2/nnet-compute.h"
 #include "hmm/posterior.h"
+#include "util/kaldi-profile.h"
 
 namespace kaldi {
 namespace nnet2 {
@@ -39,8 +40,11 @@ class NnetComputer {
                bool pad, 
                Nnet *nnet_to_update = NULL);
   
-  /// The forward-through-the-layers part of the computation.
-  void Propagate();
+  /// The forward-through-the-layers part of the computation.  If
+  /// frame_subsampling_factor > 1, only every frame_subsampling_factor'th row
+  /// is propagated after the last component that needs context (see
+  /// NnetComputationSubsampled()).
+  void Propagate(int32 frame_subsampling_factor = 1);
   
   void Backprop(CuMatrix<BaseFloat> *tmp_deriv);
                 
@@ -94,14 +98,47 @@ NnetComputer::NnetComputer(const Nnet &nnet,
 }
 
 
+// Keeps rows 0, k, 2k, ... of *mat, where k = frame_subsampling_factor.
+static void SubsampleRows(int32 frame_subsampling_factor,
+                          CuMatrix<BaseFloat> *mat) {
+  int32 k = frame_subsampling_factor,
+      num_rows = (mat->NumRows() + k - 1) / k;
+  std::vector<MatrixIndexT> indices(num_rows);
+  for (int32 r = 0; r < num_rows; r++)
+    indices[r] = r * k;
+  CuMatrix<BaseFloat> subsampled(num_rows, mat->NumCols(), kUndefined);
+  subsampled.CopyRows(*mat, indices);
+  mat->Swap(&subsampled);
+}
+
 /// This is the forward part of the computation.
-void NnetComputer::Propagate() {
+void NnetComputer::Propagate(int32 frame_subsampling_factor) {
+  KALDI_PROFILE_SCOPE("NnetComputer::Propagate");
+  KALDI_ASSERT(frame_subsampling_factor >= 1);
+  // The components from first_framewise on don't need any context, so they
+  // only have to see the frames we output.
+  int32 first_framewise = nnet_.NumComponents();
+  while (first_framewise > 0 &&
+         nnet_.GetComponent(first_framewise - 1).LeftContext() == 0 &&
+         nnet_.GetComponent(first_framewise - 1).RightContext() == 0)
+    first_framewise--;
+  if (frame_subsampling_factor > 1) {
+    // Subsampling would make the stored activations unusable for backprop.
+    KALDI_ASSERT(nnet_to_update_ == NULL);
+    if (first_framewise == 0)
+      SubsampleRows(frame_subsampling_factor, &(forward_data_[0]));
+  }
   for (int32 c = 0; c < nnet_.NumComponents(); c++) {
     const Component &component = nnet_.GetComponent(c);
     CuMatrix<BaseFloat> &input = forward_data_[c],
                      &output = forward_data_[c+1];
         
-    component.Propagate(input, 1, &output);
+    {
+      KALDI_PROFILE_SCOPE_DYNAMIC(
+          component.Type() + "::Propagate",
+          "in=" + ProfileDims(input.NumRows(), input.NumCols()));
+      component.Propagate(input, 1, &output);
+    }
     const Component *prev_component = (c == 0 ? NULL : &(nnet_.GetComponent(c-1)));
     bool will_do_backprop = (nnet_to_update_ != NULL),
          keep_last_output = will_do_backprop &&
@@ -109,6 +146,8 @@ void NnetComputer::Propagate() {
                               component.BackpropNeedsInput());
     if (!keep_last_output)
       forward_data_[c].Resize(0, 0); // We won't need this data; save memory.
+    if (frame_subsampling_factor > 1 && c + 1 == first_framewise)
+      SubsampleRows(frame_subsampling_factor, &output);
   }
 }
 
@@ -143,6 +182,7 @@ BaseFloat NnetComputer::ComputeLastLayerDeriv(const Posterior &pdf_post,
 
 
 void NnetComputer::Backprop(CuMatrix<BaseFloat> *tmp_deriv) {
+  KALDI_PROFILE_SCOPE("NnetComputer::Backprop");
   KALDI_ASSERT(nnet_to_update_ != NULL); // Or why do backprop?
   // If later this reasoning changes, we can change this
   // statement and add logic to make component_to_update, below,
@@ -156,6 +196,10 @@ void NnetComputer::Backprop(CuMatrix<BaseFloat> *tmp_deriv) {
                             &output = forward_data_[c+1],
                       &output_deriv = *tmp_deriv;
     CuMatrix<BaseFloat> input_deriv;
+    KALDI_PROFILE_SCOPE_DYNAMIC(
+        component.Type() + "::Backprop",
+        "out_deriv=" + ProfileDims(output_deriv.NumRows(),
+                                   output_deriv.NumCols()));
     component.Backprop(input, output, output_deriv, num_chunks,
                        component_to_update, &input_deriv);
     *tmp_deriv = input_deriv;
@@ -172,6 +216,149 @@ void NnetComputation(const Nnet &nnet,
   output->CopyFromMat(nnet_computer.GetOutput());
 }
 
+void NnetComputationSubsampled(const Nnet &nnet,
+                               const CuMatrixBase<BaseFloat> &input,
+                               const CuVectorBase<BaseFloat> &spk_info,
+                               bool pad_input,
+                               int32 frame_subsampling_factor,
+                               CuMatrix<BaseFloat> *output) {
+  NnetComputer nnet_computer(nnet, input, spk_info, pad_input, NULL);
+  nnet_computer.Propagate(frame_subsampling_factor);
+  output->Resize(nnet_computer.GetOutput().NumRows(),
+                 nnet_computer.GetOutput().NumCols(), kUndefined);
+  output->CopyFromMat(nnet_computer.GetOutput());
+}
+
+NnetChunkComputer::NnetChunkComputer(const Nnet &nnet,
+                                     const CuVectorBase<BaseFloat> &spk_info):
+    nnet_(nnet), spk_info_(spk_info), num_frames_input_(0),
+    num_frames_output_(0), finished_(false),
+    saved_context_(nnet.NumComponents()) { }
+
+void NnetChunkComputer::Compute(const CuMatrixBase<BaseFloat> &input,
+                                bool is_last_chunk,
+                                CuMatrix<BaseFloat> *output) {
+  KALDI_ASSERT(!finished_ && "Compute() called after the last chunk.");
+  finished_ = is_last_chunk;
+  int32 num_frames = input.NumRows(),
+      feature_dim = (num_frames > 0 ? input.NumCols() : last_frame_.Dim()),
+      spk_dim = spk_info_.Dim(),
+      tot_dim = feature_dim + spk_dim;
+  // We pad at the start of the utterance with copies of the first frame, and
+  // at the end with copies of the last frame, as NnetComputation() does.
+  int32 left_context = (num_frames_input_ == 0 && num_frames > 0 ?
+                        nnet_.LeftContext() : 0),
+      right_context = (is_last_chunk && num_frames_input_ + num_frames > 0 ?
+                       nnet_.RightContext() : 0),
+      num_rows = left_context + num_frames + right_context;
+  if (num_frames > 0) {
+    KALDI_ASSERT(tot_dim == nnet_.InputDim());
+    last_frame_ = input.Row(num_frames - 1);
+  }
+  num_frames_input_ += num_frames;
+  output->Resize(0, 0);
+  if (num_rows == 0) return;
+
+  CuMatrix<BaseFloat> cur(num_rows, tot_dim, kUndefined), next;
+  if (num_frames > 0)
+    cur.Range(left_context, num_frames, 0, feature_dim).CopyFromMat(input);
+  for (int32 i = 0; i < left_context; i++)
+    cur.Row(i).Range(0, feature_dim).CopyFromVec(input.Row(0));
+  for (int32 i = 0; i < right_context; i++)
+    cur.Row(num_rows - i - 1).Range(0, feature_dim).CopyFromVec(last_frame_);
+  if (spk_dim != 0)
+    cur.Range(0, num_rows, feature_dim, spk_dim).CopyRowsFromVec(spk_info_);
+
+  for (int32 c = 0; c < nnet_.NumComponents(); c++) {
+    const Component &component = nnet_.GetComponent(c);
+    int32 context = component.LeftContext() + component.RightContext();
+    if (context > 0) {
+      // Put the end of the previous input of this component in front, and
+      // keep the end of this input for the next chunk.
+      CuMatrix<BaseFloat> &saved = saved_context_[c];
+      if (saved.NumRows() > 0) {
+        CuMatrix<BaseFloat> joined(saved.NumRows() + cur.NumRows(),
+                                   cur.NumCols(), kUndefined);
+        joined.RowRange(0, saved.NumRows()).CopyFromMat(saved);
+        joined.RowRange(saved.NumRows(), cur.NumRows()).CopyFromMat(cur);
+        cur.Swap(&joined);
+      }
+      int32 num_keep = std::min(context, cur.NumRows());
+      CuMatrix<BaseFloat> new_saved(cur.RowRange(cur.NumRows() - num_keep,
+                                                 num_keep));
+      saved.Swap(&new_saved);
+      if (cur.NumRows() <= context)
+        return;  // Not enough frames yet to output anything.
+    }
+    component.Propagate(cur, 1, &next);
+    cur.Swap(&next);
+  }
+  num_frames_output_ += cur.NumRows();
+  output->Swap(&cur);
+}
+
+void NnetComputationBatched(
+    const Nnet &nnet,
+    const std::vector<const CuMatrixBase<BaseFloat>*> &feats,
+    const std::vector<const CuVectorBase<BaseFloat>*> &spk_info,
+    std::vector<CuMatrix<BaseFloat> > *outputs) {
+  KALDI_ASSERT(feats.size() == spk_info.size() && !feats.empty());
+  int32 num_utts = feats.size(),
+      left_context = nnet.LeftContext(),
+      right_context = nnet.RightContext(),
+      feature_dim = feats[0]->NumCols(),
+      spk_dim = (spk_info[0] != NULL ? spk_info[0]->Dim() : 0),
+      tot_dim = feature_dim + spk_dim;
+  KALDI_ASSERT(tot_dim == nnet.InputDim());
+
+  // offsets[i] is the row of the big input matrix where the padded features
+  // of utterance i start; this is also the row of the output where its
+  // outputs start.
+  std::vector<int32> offsets(num_utts + 1);
+  offsets[0] = 0;
+  for (int32 i = 0; i < num_utts; i++) {
+    KALDI_ASSERT(feats[i]->NumRows() > 0 &&
+                 feats[i]->NumCols() == feature_dim);
+    offsets[i + 1] = offsets[i] + left_context + feats[i]->NumRows() +
+        right_context;
+  }
+
+  CuMatrix<BaseFloat> input(offsets[num_utts], tot_dim, kUndefined);
+  for (int32 i = 0; i < num_utts; i++) {
+    const CuMatrixBase<BaseFloat> &this_feats = *(feats[i]);
+    int32 num_frames = this_feats.NumRows(), offset = offsets[i],
+        num_rows = offsets[i + 1] - offset;
+    CuSubMatrix<BaseFloat> this_input(input, offset, num_rows, 0, tot_dim);
+    this_input.Range(left_context, num_frames,
+                     0, feature_dim).CopyFromMat(this_feats);
+    for (int32 j = 0; j < left_context; j++)
+      this_input.Row(j).Range(0, feature_dim).CopyFromVec(this_feats.Row(0));
+    for (int32 j = 0; j < right_context; j++)
+      this_input.Row(num_rows - j - 1).Range(0, feature_dim).
+          CopyFromVec(this_feats.Row(num_frames - 1));
+    if (spk_dim != 0) {
+      KALDI_ASSERT(spk_info[i] != NULL && spk_info[i]->Dim() == spk_dim);
+      this_input.Range(0, num_rows, feature_dim,
+                       spk_dim).CopyRowsFromVec(*(spk_info[i]));
+    }
+  }
+
+  CuMatrix<BaseFloat> output;
+  for (int32 c = 0; c < nnet.NumComponents(); c++) {
+    nnet.GetComponent(c).Propagate(input, 1, &output);
+    input.Swap(&output);
+  }
+  // now "input" contains the output of the last layer.
+  KALDI_ASSERT(input.NumRows() ==
+               offsets[num_utts] - left_context - right_context);
+  outputs->resize(num_utts);
+  for (int32 i = 0; i < num_utts; i++) {
+    (*outputs)[i].Resize(feats[i]->NumRows(), input.NumCols(), kUndefined);
+    (*outputs)[i].CopyFromMat(input.RowRange(offsets[i],
+                                             feats[i]->NumRows()));
+  }
+}
+
 BaseFloat NnetGradientComputation(const Nnet &nnet,
                                   const CuMatrixBase<BaseFloat> &input,
                                   const CuVectorBase<BaseFloat> &spk_info,
@@ -47,6 +47,83 @@ void NnetComputation(const Nnet &nnet,
                      bool pad_input,
                      CuMatrixBase<BaseFloat> *output); // posteriors.
 
+/**
+  This is as NnetComputation(), but the output is only evaluated on every
+  "frame_subsampling_factor"'th frame (frames 0, k, 2k, ... of the output of
+  NnetComputation()).  The components up to and including the last one that
+  needs context (typically the SpliceComponent) still see every frame, but
+  the ones after it, which are frame-by-frame, only process the frames we
+  keep, so most of the computation is divided by the subsampling factor.
+  "output" is resized to (T + k - 1) / k rows, where T is the number of rows
+  NnetComputation() would output.
+*/
+void NnetComputationSubsampled(const Nnet &nnet,
+                               const CuMatrixBase<BaseFloat> &input,
+                               const CuVectorBase<BaseFloat> &spk_info,
+                               bool pad_input,
+                               int32 frame_subsampling_factor,
+                               CuMatrix<BaseFloat> *output);
+
+/**
+  NnetChunkComputer does the same computation as NnetComputation() with
+  pad_input == true, but for features that arrive in chunks, as in online
+  decoding.  Rather than recomputing the left context of each chunk, it keeps,
+  for each component that needs context (e.g. SpliceComponent), the last
+  LeftContext() + RightContext() rows of that component's input from the
+  previous chunks, so every frame goes through each layer only once.  The
+  outputs of successive calls to Compute(), appended together, equal the
+  output of NnetComputation() on the whole utterance.
+*/
+class NnetChunkComputer {
+ public:
+  /// "spk_info" may be empty, if the network has no speaker input.
+  NnetChunkComputer(const Nnet &nnet,
+                    const CuVectorBase<BaseFloat> &spk_info);
+
+  /// Propagates the next chunk of features.  "output" is set to the outputs
+  /// for the frames whose right context is now available (it may have zero
+  /// rows).  For the last chunk, set is_last_chunk = true; the remaining
+  /// frames are then output too, with the last frame repeated as right
+  /// context, and no more chunks may be given.
+  void Compute(const CuMatrixBase<BaseFloat> &input,
+               bool is_last_chunk,
+               CuMatrix<BaseFloat> *output);
+
+  /// Total number of frames output so far.
+  int32 NumFramesOutput() const { return num_frames_output_; }
+
+ private:
+  const Nnet &nnet_;
+  CuVector<BaseFloat> spk_info_;
+  int32 num_frames_input_;
+  int32 num_frames_output_;
+  bool finished_;
+  /// The last input frame so far, used as right context at the end.
+  CuVector<BaseFloat> last_frame_;
+  /// saved_context_[c] holds the last rows of the input of component c,
+  /// which the next chunk needs as left context (empty for components
+  /// without context).
+  std::vector<CuMatrix<BaseFloat> > saved_context_;
+};
+
+/**
+  This is as NnetComputation() with pad_input == true, but it does the
+  computation for a number of utterances at once.  The padded features of all
+  the utterances are placed one after the other in a single matrix, so the
+  neural net sees one large matrix rather than many small ones, which is much
+  more efficient on a GPU.  This works because all the components only look at
+  a finite window of frames, so the outputs that straddle two utterances can
+  simply be discarded.  "spk_info" must be the same size as "feats" (each
+  entry may be NULL, meaning no speaker information, but then all must be
+  NULL).  "outputs" will be resized to the number of utterances, and
+  (*outputs)[i] will have feats[i]->NumRows() rows.
+*/
+void NnetComputationBatched(
+    const Nnet &nnet,
+    const std::vector<const CuMatrixBase<BaseFloat>*> &feats,
+    const std::vector<const CuVectorBase<BaseFloat>*> &spk_info,
+    std::vector<CuMatrix<BaseFloat> > *outputs);
+
 /** Does the neural net computation and backprop, given input and labels.
     Note: if pad_input==true the number of rows of input should be the
     same as the number of labels, and if false, you should omit
@@ -66,6 +66,78 @@ void NnetExample::Read(std::istream &is, bool binary) {
   ExpectToken(is, binary, "</NnetExample>");
 }
 
+void NnetExample::Swap(NnetExample *other) {
+  labels.swap(other->labels);
+  input_frames.Swap(&(other->input_frames));
+  std::swap(left_context, other->left_context);
+  spk_info.Swap(&(other->spk_info));
+}
+
+void NnetChunkExample::GetFrameExamples(std::vector<NnetExample> *egs) const {
+  int32 num_frames = labels.size(),
+      right_context = input_frames.NumRows() - left_context - num_frames,
+      window_size = left_context + 1 + right_context;
+  KALDI_ASSERT(left_context >= 0 && right_context >= 0);
+  Matrix<BaseFloat> feats(input_frames.NumRows(), input_frames.NumCols(),
+                          kUndefined);
+  input_frames.CopyToMat(&feats);
+  size_t offset = egs->size();
+  egs->resize(offset + num_frames);
+  for (int32 t = 0; t < num_frames; t++) {
+    NnetExample &eg = (*egs)[offset + t];
+    eg.labels = labels[t];
+    eg.input_frames = feats.RowRange(t, window_size);
+    eg.left_context = left_context;
+    eg.spk_info = spk_info;
+  }
+}
+
+void NnetChunkExample::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<NnetChunkExample>");
+  WriteToken(os, binary, "<Labels>");
+  int32 num_frames = labels.size();
+  WriteBasicType(os, binary, num_frames);
+  for (int32 t = 0; t < num_frames; t++) {
+    int32 size = labels[t].size();
+    WriteBasicType(os, binary, size);
+    for (int32 i = 0; i < size; i++) {
+      WriteBasicType(os, binary, labels[t][i].first);
+      WriteBasicType(os, binary, labels[t][i].second);
+    }
+  }
+  WriteToken(os, binary, "<InputFrames>");
+  input_frames.Write(os, binary);
+  WriteToken(os, binary, "<LeftContext>");
+  WriteBasicType(os, binary, left_context);
+  WriteToken(os, binary, "<SpkInfo>");
+  spk_info.Write(os, binary);
+  WriteToken(os, binary, "</NnetChunkExample>");
+}
+
+void NnetChunkExample::Read(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<NnetChunkExample>");
+  ExpectToken(is, binary, "<Labels>");
+  int32 num_frames;
+  ReadBasicType(is, binary, &num_frames);
+  labels.resize(num_frames);
+  for (int32 t = 0; t < num_frames; t++) {
+    int32 size;
+    ReadBasicType(is, binary, &size);
+    labels[t].resize(size);
+    for (int32 i = 0; i < size; i++) {
+      ReadBasicType(is, binary, &(labels[t][i].first));
+      ReadBasicType(is, binary, &(labels[t][i].second));
+    }
+  }
+  ExpectToken(is, binary, "<InputFrames>");
+  input_frames.Read(is, binary);
+  ExpectToken(is, binary, "<LeftContext>");
+  ReadBasicType(is, binary, &left_context);
+  ExpectToken(is, binary, "<SpkInfo>");
+  spk_info.Read(is, binary);
+  ExpectToken(is, binary, "</NnetChunkExample>");
+}
+
 
 void DiscriminativeNnetExample::Write(std::ostream &os,
                                               bool binary) const {
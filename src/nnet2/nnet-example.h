@@ -56,6 +56,10 @@ struct NnetExample {
   
   void Write(std::ostream &os, bool binary) const;
   void Read(std::istream &is, bool binary);
+
+  /// Exchanges the contents with "other" without copying the data; used to
+  /// take examples out of a SequentialNnetExampleReader.
+  void Swap(NnetExample *other);
 };
 
 
@@ -64,6 +68,89 @@ typedef SequentialTableReader<KaldiObjectHolder<NnetExample > > SequentialNnetEx
 typedef RandomAccessTableReader<KaldiObjectHolder<NnetExample > > RandomAccessNnetExampleReader;
 
 
+// NnetChunkExample is a compact form of the NnetExamples for a range of
+// consecutive frames of one utterance.  Instead of each frame having its own
+// copy of the features of its context window, the features of the whole range
+// (plus the context at its edges) are stored once, which saves a factor of
+// about (left_context + 1 + right_context) in storage.  The frame-by-frame
+// examples are sliced out at training time, see GetFrameExamples().
+struct NnetChunkExample {
+  /// The label(s) for each frame of the chunk, as in NnetExample.
+  std::vector<std::vector<std::pair<int32, BaseFloat> > > labels;
+
+  /// The input data, with NumRows() == left_context + labels.size() +
+  /// (right context).
+  CompressedMatrix input_frames;
+
+  /// The number of frames of left context.
+  int32 left_context;
+
+  /// The speaker-specific input, if any, or an empty vector.
+  Vector<BaseFloat> spk_info;
+
+  /// Appends to "egs" one NnetExample for each frame of the chunk, with the
+  /// same left and right context as the chunk.
+  void GetFrameExamples(std::vector<NnetExample> *egs) const;
+
+  void Write(std::ostream &os, bool binary) const;
+  void Read(std::istream &is, bool binary);
+};
+
+typedef TableWriter<KaldiObjectHolder<NnetChunkExample > > NnetChunkExampleWriter;
+typedef SequentialTableReader<KaldiObjectHolder<NnetChunkExample > > SequentialNnetChunkExampleReader;
+
+
+// Writes examples (NnetExample or NnetChunkExample) to a table with keys 0, 1,
+// 2, ...; if buffer_size > 0, they go through a buffer of that size that
+// randomizes their order, as in nnet-shuffle-egs --buffer-size.  Flush()
+// (or the destructor) writes out what is left in the buffer.
+template<class Example>
+class ShufflingExampleWriter {
+ public:
+  ShufflingExampleWriter(const std::string &wspecifier, int32 buffer_size):
+      writer_(wspecifier), buffer_(buffer_size, NULL), num_written_(0) { }
+
+  void Write(const Example &eg) {
+    if (buffer_.empty()) {
+      WriteExample(eg);
+      return;
+    }
+    int32 index = RandInt(0, buffer_.size() - 1);
+    if (buffer_[index] == NULL) {
+      buffer_[index] = new Example(eg);
+    } else {
+      WriteExample(*(buffer_[index]));
+      *(buffer_[index]) = eg;
+    }
+  }
+
+  /// Writes out what is left in the buffer.
+  void Flush() {
+    for (size_t i = 0; i < buffer_.size(); i++) {
+      if (buffer_[i] != NULL) {
+        WriteExample(*(buffer_[i]));
+        delete buffer_[i];
+        buffer_[i] = NULL;
+      }
+    }
+  }
+
+  int64 NumWritten() const { return num_written_; }
+
+  ~ShufflingExampleWriter() { Flush(); }
+
+ private:
+  void WriteExample(const Example &eg) {
+    std::ostringstream os;
+    os << (num_written_++);
+    writer_.Write(os.str(), eg);
+  }
+  TableWriter<KaldiObjectHolder<Example> > writer_;
+  std::vector<Example*> buffer_;
+  int64 num_written_;
+};
+
+
 /**
    This struct is used to store the information we need for discriminative training
    (MMI or MPE).  Each example corresponds to one chunk of a file (for better randomization
@@ -17,11 +17,26 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
 #include "nnet2/nnet-lbfgs.h"
+#include "nnet2/nnet-param-server.h"
 
 namespace kaldi {
 namespace nnet2 {
 
+// The messages between the coordinator and the workers.  A worker starts with
+// kLbfgsHelloMessage and its parameter dimension, and the coordinator replies
+// with its own.  Then the coordinator sends kLbfgsParamsMessage followed by
+// the parameters, and the worker replies with its total objective function
+// and number of examples (as doubles) and its gradient; or it sends
+// kLbfgsDoneMessage.
+static const int32 kLbfgsHelloMessage = 0x6e6e6c62,  // also serves as a check.
+    kLbfgsParamsMessage = 1,
+    kLbfgsDoneMessage = 2;
+
 
 Nnet *GetPreconditioner(const Nnet &nnet) {
   Nnet *ans = new Nnet(nnet);
@@ -120,8 +135,54 @@ void NnetLbfgsTrainer::CopyParamsOrGradientToNnet(const VectorBase<BaseFloat> &p
   } 
 }
 
+void NnetLbfgsTrainer::AcceptWorkers() {
+  if (config_.num_workers <= 0) return;
+  int32 dim = nnet_->GetParameterDim(),
+      server_socket = SocketListen(config_.port, config_.num_workers);
+  KALDI_LOG << "Waiting for " << config_.num_workers << " workers on port "
+            << config_.port;
+  while (static_cast<int32>(worker_sockets_.size()) < config_.num_workers) {
+    int32 socket = accept(server_socket, NULL, NULL);
+    if (socket < 0) {
+      if (errno == EINTR) continue;
+      KALDI_ERR << "Error accepting connection: " << strerror(errno);
+    }
+    int32 code, worker_dim;
+    if (!SocketRecvFull(socket, &code, sizeof(code)) ||
+        code != kLbfgsHelloMessage ||
+        !SocketRecvFull(socket, &worker_dim, sizeof(worker_dim)) ||
+        !SocketSendFull(socket, &dim, sizeof(dim))) {
+      KALDI_WARN << "Bad connection from worker; ignoring it.";
+      close(socket);
+      continue;
+    }
+    if (worker_dim != dim)
+      KALDI_ERR << "Worker has nnet with " << worker_dim << " parameters, "
+                << "expected " << dim;
+    worker_sockets_.push_back(socket);
+  }
+  close(server_socket);
+  KALDI_LOG << "All " << config_.num_workers << " workers connected.";
+}
+
+void NnetLbfgsTrainer::ReleaseWorkers() {
+  for (size_t i = 0; i < worker_sockets_.size(); i++) {
+    if (!SocketSendFull(worker_sockets_[i], &kLbfgsDoneMessage,
+                        sizeof(kLbfgsDoneMessage)))
+      KALDI_WARN << "Error finishing connection to worker.";
+    close(worker_sockets_[i]);
+  }
+  worker_sockets_.clear();
+}
+
 void NnetLbfgsTrainer::Train(Nnet *nnet_in) {
+  if (egs_.empty() && config_.num_workers <= 0)
+    KALDI_ERR << "No examples to train on.";
+  if (egs_.empty() && config_.precondition_config.do_precondition)
+    KALDI_ERR << "Preconditioning needs examples in this process (it is "
+              << "estimated from our examples only).";
   Initialize(nnet_in);
+  AcceptWorkers();
 
   BaseFloat initial_objf;
   for (int32 iter = 0; iter < config_.lbfgs_num_iters; iter++) {
@@ -143,6 +204,7 @@ void NnetLbfgsTrainer::Train(Nnet *nnet_in) {
             << " objective function improved from " << initial_objf << " to "
             << cur_objf;
   CopyParamsOrGradientToNnet(params_, nnet_in);
+  ReleaseWorkers();
 }
 
 BaseFloat NnetLbfgsTrainer::GetObjfAndGradient(
@@ -152,18 +214,99 @@ BaseFloat NnetLbfgsTrainer::GetObjfAndGradient(
   CopyParamsOrGradientToNnet(cur_value, &nnet);
   bool is_gradient = true;
   nnet_gradient.SetZero(is_gradient);
-  BaseFloat objf = ComputeNnetGradient(nnet, egs_, config_.minibatch_size,
-                                       &nnet_gradient);
+
+  // Send the parameters to the workers first, so they compute their part of
+  // the gradient while we compute ours.
+  int32 dim = nnet.GetParameterDim();
+  Vector<BaseFloat> params(dim);
+  if (!worker_sockets_.empty())
+    nnet.Vectorize(&params);
+  for (size_t i = 0; i < worker_sockets_.size(); i++)
+    if (!SocketSendFull(worker_sockets_[i], &kLbfgsParamsMessage,
+                        sizeof(kLbfgsParamsMessage)) ||
+        !SocketSendVector(worker_sockets_[i], params))
+      KALDI_ERR << "Lost connection to worker " << i;
+
+  double tot_objf = 0.0, tot_egs = egs_.size();
+  if (!egs_.empty())
+    tot_objf = egs_.size() * ComputeNnetGradient(nnet, egs_,
+                                                 config_.minibatch_size,
+                                                 &nnet_gradient);
+  if (!worker_sockets_.empty()) {
+    Vector<BaseFloat> tot_gradient(dim), worker_gradient(dim);
+    nnet_gradient.Vectorize(&tot_gradient);
+    for (size_t i = 0; i < worker_sockets_.size(); i++) {
+      double worker_objf, worker_egs;
+      if (!SocketRecvFull(worker_sockets_[i], &worker_objf,
+                          sizeof(worker_objf)) ||
+          !SocketRecvFull(worker_sockets_[i], &worker_egs,
+                          sizeof(worker_egs)) ||
+          !SocketRecvVector(worker_sockets_[i], &worker_gradient))
+        KALDI_ERR << "Lost connection to worker " << i;
+      tot_objf += worker_objf;
+      tot_egs += worker_egs;
+      tot_gradient.AddVec(1.0, worker_gradient);
+    }
+    nnet_gradient.UnVectorize(tot_gradient);
+  }
+  KALDI_ASSERT(tot_egs > 0);
   CopyParamsOrGradientFromNnet(nnet_gradient, gradient);
-  gradient->Scale(1.0 / egs_.size());
-  return objf;
+  gradient->Scale(1.0 / tot_egs);
+  return tot_objf / tot_egs;
 }
 
 NnetLbfgsTrainer::~NnetLbfgsTrainer() {
+  for (size_t i = 0; i < worker_sockets_.size(); i++)
+    close(worker_sockets_[i]);
   delete nnet_precondition_;
   delete lbfgs_;
 }
 
+void ServeNnetLbfgsGradients(const std::string &coordinator,
+                             int32 minibatch_size,
+                             const std::vector<NnetExample> &egs,
+                             Nnet *nnet) {
+  int32 socket = SocketConnect(coordinator),
+      dim = nnet->GetParameterDim(), coordinator_dim;
+  if (!SocketSendFull(socket, &kLbfgsHelloMessage,
+                      sizeof(kLbfgsHelloMessage)) ||
+      !SocketSendFull(socket, &dim, sizeof(dim)) ||
+      !SocketRecvFull(socket, &coordinator_dim, sizeof(coordinator_dim)))
+    KALDI_ERR << "Coordinator " << coordinator << " closed the connection "
+              << "(mismatched nnet?)";
+  KALDI_ASSERT(coordinator_dim == dim);
+  KALDI_LOG << "Connected to coordinator " << coordinator;
+
+  Vector<BaseFloat> params(dim), gradient(dim);
+  Nnet nnet_gradient(*nnet);
+  int32 num_evals = 0;
+  while (true) {
+    int32 code;
+    if (!SocketRecvFull(socket, &code, sizeof(code)))
+      KALDI_ERR << "Lost connection to coordinator.";
+    if (code == kLbfgsDoneMessage) break;
+    if (code != kLbfgsParamsMessage || !SocketRecvVector(socket, &params))
+      KALDI_ERR << "Bad message from coordinator.";
+    nnet->UnVectorize(params);
+    double tot_objf = 0.0, num_egs = egs.size();
+    if (!egs.empty()) {
+      tot_objf = egs.size() * ComputeNnetGradient(*nnet, egs, minibatch_size,
+                                                  &nnet_gradient);
+      nnet_gradient.Vectorize(&gradient);
+    } else {
+      gradient.SetZero();
+    }
+    if (!SocketSendFull(socket, &tot_objf, sizeof(tot_objf)) ||
+        !SocketSendFull(socket, &num_egs, sizeof(num_egs)) ||
+        !SocketSendVector(socket, gradient))
+      KALDI_ERR << "Lost connection to coordinator.";
+    num_evals++;
+  }
+  close(socket);
+  KALDI_LOG << "Coordinator finished, after " << num_evals
+            << " function evaluations.";
+}
+
 
 } // namespace nnet2
 } // namespace kaldi
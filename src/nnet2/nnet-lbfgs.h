@@ -34,9 +34,12 @@ struct NnetLbfgsTrainerConfig {
   int32 lbfgs_dim; // Number of steps to keep in L-BFGS.
   int32 lbfgs_num_iters; // more precisely, the number of function evaluations.
   BaseFloat initial_impr;
+  int32 num_workers;
+  int32 port;
 
   NnetLbfgsTrainerConfig(): minibatch_size(1024), lbfgs_dim(10),
-                            lbfgs_num_iters(20), initial_impr(0.1) { }
+                            lbfgs_num_iters(20), initial_impr(0.1),
+                            num_workers(0), port(5124) { }
 
   void Register(OptionsItf *po) {
     precondition_config.Register(po);
@@ -48,12 +51,29 @@ struct NnetLbfgsTrainerConfig {
                  "in L-BFGS");
     po->Register("initial-impr", &initial_impr, "Improvement in objective "
                  "function per frame to aim for on initial iteration.");
+    po->Register("num-workers", &num_workers, "If > 0, wait for this many "
+                 "worker processes (nnet-train-lbfgs --coordinator=host:port) "
+                 "to connect, and compute the objective function and gradient "
+                 "over their examples as well as ours.");
+    po->Register("port", &port, "TCP port to listen on for the workers, if "
+                 "--num-workers > 0.");
   };
 };
 
+/*
+  NnetLbfgsTrainer does L-BFGS on the examples given to it with AddExample().
+  If config.num_workers > 0, the objective function and gradient are also
+  summed over the examples of that many worker processes (each running
+  ServeNnetLbfgsGradients(), e.g. on another machine): for each function
+  evaluation we send them the parameters, and they send back their objective
+  function and gradient.  The L-BFGS state stays here.  The preconditioning
+  information (if used) is estimated from our own examples only.  The protocol
+  uses the native byte order and float format.
+*/
 class NnetLbfgsTrainer {
  public:
-  NnetLbfgsTrainer(const NnetLbfgsTrainerConfig &config): config_(config) { }
+  NnetLbfgsTrainer(const NnetLbfgsTrainerConfig &config):
+      nnet_(NULL), nnet_precondition_(NULL), lbfgs_(NULL), config_(config) { }
 
   void AddExample(const NnetExample &eg) { egs_.push_back(eg); }
   
@@ -63,6 +83,12 @@ class NnetLbfgsTrainer {
  private:
   void Initialize(Nnet *nnet);
 
+  // Waits for config_.num_workers workers to connect.
+  void AcceptWorkers();
+
+  // Tells the workers we are done, and closes the connections.
+  void ReleaseWorkers();
+
   void CopyParamsOrGradientFromNnet(const Nnet &nnet,
                                     VectorBase<BaseFloat> *params);
   void CopyParamsOrGradientToNnet(const VectorBase<BaseFloat> &params,
@@ -79,8 +105,20 @@ class NnetLbfgsTrainer {
   BaseFloat initial_objf_;
   const NnetLbfgsTrainerConfig &config_;
   std::vector<NnetExample> egs_;  
+  std::vector<int32> worker_sockets_;
 };
 
+/// This is run by each worker process of a distributed L-BFGS training (see
+/// NnetLbfgsTrainer): it connects to the coordinator at "coordinator" (of the
+/// form host:port) and, until the coordinator has finished, computes the
+/// objective function and gradient on "egs" for the parameters the
+/// coordinator sends it.  "nnet" must have the same structure as the
+/// coordinator's nnet; its parameters are overwritten.
+void ServeNnetLbfgsGradients(const std::string &coordinator,
+                             int32 minibatch_size,
+                             const std::vector<NnetExample> &egs,
+                             Nnet *nnet);
+
 
 /** This function takes a neural net, and returns a neural net with the same
     structure, but with parameters set to zero (to represent a gradient), with
@@ -25,33 +25,48 @@ namespace nnet2 {
 
 class LimitRankClass {
  public:
+  // If opts.factorize is true, the factored components (if any) are
+  // output to *factored, which is owned by the caller.
   LimitRankClass(const NnetLimitRankOpts &opts,
                  int32 c,
-                 Nnet *nnet): opts_(opts), c_(c), nnet_(nnet) { }
+                 Nnet *nnet,
+                 std::pair<AffineComponent*, AffineComponent*> *factored):
+      opts_(opts), c_(c), nnet_(nnet), factored_(factored) { }
   void operator () () {
     AffineComponent *ac = dynamic_cast<AffineComponent*>(
         &(nnet_->GetComponent(c_)));
     KALDI_ASSERT(ac != NULL);
 
+    if (opts_.factorize) {
+      int32 rows = ac->OutputDim(), cols = ac->InputDim(),
+          d = GetRetainedDim(rows, cols);
+      if (static_cast<int64>(rows + cols) * d <
+          static_cast<int64>(rows) * cols) {
+        KALDI_LOG << "Factorizing component " << c_ << " of dimension "
+                  << rows << " x " << cols << " into " << d << " x " << cols
+                  << " and " << rows << " x " << d;
+        ac->LimitRank(d, &(factored_->first), &(factored_->second));
+        return;
+      }
+      KALDI_LOG << "Not factorizing component " << c_ << " of dimension "
+                << rows << " x " << cols << " since at rank " << d
+                << " it would not get smaller; limiting its rank instead.";
+    }
     // We'll limit the rank of just the linear part, keeping the bias vector full.
     Matrix<BaseFloat> M (ac->LinearParams());
-    int32 rows = M.NumRows(), cols = M.NumCols(), rc_min = std::min(rows, cols);
-    Vector<BaseFloat> s(rc_min);
-    Matrix<BaseFloat> U(rows, rc_min), Vt(rc_min, cols);
-    // Do the destructive svd M = U diag(s) V^T.  It actually outputs the transpose of V.
-    M.DestructiveSvd(&s, &U, &Vt);
-    SortSvd(&s, &U, &Vt); // Sort the singular values from largest to smallest.
-
-    int32 d = GetRetainedDim(rows, cols);
-    BaseFloat old_svd_sum = s.Sum();
-    U.Resize(rows, d, kCopyData);
-    s.Resize(d, kCopyData);
-    Vt.Resize(d, cols, kCopyData);
-    BaseFloat new_svd_sum = s.Sum();
+    int32 rows = M.NumRows(), cols = M.NumCols(), rc_min = std::min(rows, cols),
+        d = GetRetainedDim(rows, cols);
+    Vector<BaseFloat> s(d);
+    Matrix<BaseFloat> U(rows, d), Vt(d, cols);
+    // Get the top d singular values and vectors, M ~= U diag(s) Vt.  If d is
+    // much less than rc_min the randomized SVD is much faster than a full one,
+    // and close to exact; otherwise make it exact.
+    int32 oversample = ((d + 10) * 4 <= rc_min ? 10 : rc_min);
+    RandomizedSvd(M, &s, &U, &Vt, oversample);
     KALDI_LOG << "For component " << c_ << " of dimension " << rows
               << " x " << cols << ", reduced rank from "
-              << rc_min <<  " to " << d << ", SVD sum reduced from "
-              << old_svd_sum << " to " << new_svd_sum;
+              << rc_min <<  " to " << d << ", Frobenius norm reduced from "
+              << M.FrobeniusNorm() << " to " << s.Norm(2.0);
     Vt.MulRowsVec(s); // Vt <-- diag(s) Vt.
     M.AddMatMat(1.0, U, kNoTrans, Vt, kNoTrans, 0.0); // Reconstruct with reduced
     // rank.
@@ -93,18 +108,36 @@ class LimitRankClass {
   const NnetLimitRankOpts &opts_;
   int32 c_;
   Nnet *nnet_;
+  std::pair<AffineComponent*, AffineComponent*> *factored_;
 };
 
 
 void LimitRankParallel(const NnetLimitRankOpts &opts,
                             Nnet *nnet) {
-  TaskSequencerConfig task_config;
-  task_config.num_threads = opts.num_threads;
-  TaskSequencer<LimitRankClass> tc(task_config);
+  std::vector<std::pair<AffineComponent*, AffineComponent*> > factored(
+      nnet->NumComponents(),
+      std::pair<AffineComponent*, AffineComponent*>(NULL, NULL));
+  {
+    TaskSequencerConfig task_config;
+    task_config.num_threads = opts.num_threads;
+    TaskSequencer<LimitRankClass> tc(task_config);
+    for (int32 c = 0; c < nnet->NumComponents(); c++) {
+      if (dynamic_cast<AffineComponent*>(&(nnet->GetComponent(c))) != NULL)
+        tc.Run(new LimitRankClass(opts, c, nnet, &(factored[c])));
+    }
+  }  // the destructor of "tc" waits for the tasks to finish.
+  if (!opts.factorize) return;
+
+  std::vector<Component*> components;
   for (int32 c = 0; c < nnet->NumComponents(); c++) {
-    if (dynamic_cast<AffineComponent*>(&(nnet->GetComponent(c))) != NULL)
-      tc.Run(new LimitRankClass(opts, c, nnet));
+    if (factored[c].first != NULL) {
+      components.push_back(factored[c].first);
+      components.push_back(factored[c].second);
+    } else {
+      components.push_back(nnet->GetComponent(c).Copy());
+    }
   }
+  nnet->Init(&components);
 }
 
 
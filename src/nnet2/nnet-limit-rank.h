@@ -32,8 +32,10 @@ namespace nnet2 {
 struct NnetLimitRankOpts {
   int32 num_threads;
   BaseFloat parameter_proportion;
+  bool factorize;
   
-  NnetLimitRankOpts(): num_threads(1), parameter_proportion(0.75) { }
+  NnetLimitRankOpts(): num_threads(1), parameter_proportion(0.75),
+                       factorize(false) { }
 
   void Register(OptionsItf *po) {
     po->Register("num-threads", &num_threads, "Number of threads used for "
@@ -41,6 +43,11 @@ struct NnetLimitRankOpts {
                  "#layers.");
     po->Register("parameter-proportion", &parameter_proportion, "Proportion of "
                  "dimension of each transform to limit the rank to.");
+    po->Register("factorize", &factorize, "If true, replace each affine "
+                 "component whose rank is reduced by a pair of affine components "
+                 "of that inner dimension, where this means fewer parameters, "
+                 "so that the network is actually faster (this needs "
+                 "parameter-proportion below about 0.5 for square matrices).");
   }  
 };
 
@@ -49,6 +56,9 @@ struct NnetLimitRankOpts {
 /// neural net, by zeroing out the smallest singular values.  The number of
 /// singular values to zero out is determined on a layer by layer basis, using
 /// "parameter_proportion" to set the proportion of parameters to remove.
+/// If opts.factorize is true, each such transform is instead replaced by two
+/// AffineComponents (as in AffineComponent::LimitRank()) wherever the pair
+/// has fewer parameters than the original.
 void LimitRankParallel(const NnetLimitRankOpts &opts,
                        Nnet *nnet);
 
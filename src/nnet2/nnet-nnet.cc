@@ -438,6 +438,22 @@ void Nnet::RemovePreconditioning() {
   Check();
 }
 
+void Nnet::Quantize() {
+  int32 num_quantized = 0;
+  for (size_t i = 0; i < components_.size(); i++) {
+    AffineComponent *ac = dynamic_cast<AffineComponent*>(components_[i]);
+    if (ac != NULL) {
+      QuantizedAffineComponent *qac = new QuantizedAffineComponent(*ac);
+      delete components_[i];
+      components_[i] = qac;
+      num_quantized++;
+    }
+  }
+  SetIndexes();
+  Check();
+  KALDI_LOG << "Quantized " << num_quantized << " affine components.";
+}
+
 void Nnet::AddNnet(const VectorBase<BaseFloat> &scale_params,
                    const Nnet &other) {
   KALDI_ASSERT(scale_params.Dim() == this->NumUpdatableComponents());
@@ -631,6 +647,148 @@ void Nnet::Collapse(bool match_updatableness) {
   KALDI_LOG << "Collapsed " << num_collapsed << " components.";
 }
 
+// Returns true if the component computes an affine function of each
+// frame of its input, so that OptimizeForInference() can fold it.
+static bool IsAffineFunction(const Component &c) {
+  return (dynamic_cast<const AffineComponent*>(&c) != NULL ||
+          dynamic_cast<const FixedAffineComponent*>(&c) != NULL ||
+          dynamic_cast<const FixedLinearComponent*>(&c) != NULL ||
+          dynamic_cast<const BlockAffineComponent*>(&c) != NULL ||
+          dynamic_cast<const ScaleComponent*>(&c) != NULL ||
+          dynamic_cast<const PermuteComponent*>(&c) != NULL ||
+          dynamic_cast<const DctComponent*>(&c) != NULL);
+}
+
+// Outputs the parameters of a component for which IsAffineFunction() is true,
+// so that the component computes linear * x + bias; also outputs an estimate
+// of the number of multiply-adds it does per frame.  Components other than
+// AffineComponent are probed by propagating the zero vector and the unit
+// vectors through them, which is cheap for the kinds of component involved.
+static void GetAffineParams(const Component &c,
+                            CuMatrix<BaseFloat> *linear,
+                            CuVector<BaseFloat> *bias,
+                            double *cost) {
+  const AffineComponent *ac = dynamic_cast<const AffineComponent*>(&c);
+  if (ac != NULL) {
+    *linear = ac->LinearParams();
+    *bias = ac->BiasParams();
+    *cost = static_cast<double>(linear->NumRows()) * linear->NumCols();
+    return;
+  }
+  int32 input_dim = c.InputDim();
+  CuMatrix<BaseFloat> input(input_dim + 1, input_dim), output;
+  // Row zero of "input" is zero; row i + 1 is the i'th unit vector.
+  CuSubMatrix<BaseFloat>(input, 1, input_dim, 0, input_dim).AddToDiag(1.0);
+  c.Propagate(input, 1, &output);
+  bias->Resize(output.NumCols(), kUndefined);
+  bias->CopyFromVec(output.Row(0));
+  linear->Resize(output.NumCols(), input_dim, kUndefined);
+  linear->CopyFromMat(CuSubMatrix<BaseFloat>(output, 1, input_dim,
+                                             0, output.NumCols()), kTrans);
+  linear->AddVecToCols(-1.0, *bias);
+  if (dynamic_cast<const FixedAffineComponent*>(&c) != NULL ||
+      dynamic_cast<const FixedLinearComponent*>(&c) != NULL) {
+    *cost = static_cast<double>(linear->NumRows()) * linear->NumCols();
+  } else {  // Count the nonzero elements, e.g. the blocks of a DctComponent.
+    Matrix<BaseFloat> linear_cpu(*linear);
+    double num_nonzero = 0.0;
+    for (int32 i = 0; i < linear_cpu.NumRows(); i++)
+      for (int32 j = 0; j < linear_cpu.NumCols(); j++)
+        if (linear_cpu(i, j) != 0.0) num_nonzero++;
+    *cost = std::max(num_nonzero, static_cast<double>(input_dim));
+  }
+}
+
+void Nnet::OptimizeForInference() {
+  int32 input_dim = InputDim(), num_folded = 0, num_removed = 0;
+  std::vector<Component*> components;
+  // "pending" is the sequence of affine components we are currently folding
+  // together, and pending_linear, pending_bias and pending_cost describe
+  // the function it computes.
+  std::vector<Component*> pending;
+  CuMatrix<BaseFloat> pending_linear;
+  CuVector<BaseFloat> pending_bias;
+  double pending_cost = 0.0;
+
+  for (size_t i = 0; i <= components_.size(); i++) {
+    Component *c = (i < components_.size() ? components_[i] : NULL);
+    CuMatrix<BaseFloat> linear;
+    CuVector<BaseFloat> bias;
+    double cost = 0.0;
+    bool is_affine = (c != NULL && IsAffineFunction(*c));
+    if (is_affine) {
+      GetAffineParams(*c, &linear, &bias, &cost);
+      if (!pending.empty()) {
+        double folded_cost = static_cast<double>(linear.NumRows()) *
+            pending_linear.NumCols();
+        if (folded_cost <= pending_cost + cost) {
+          CuMatrix<BaseFloat> folded_linear(linear.NumRows(),
+                                            pending_linear.NumCols());
+          folded_linear.AddMatMat(1.0, linear, kNoTrans,
+                                  pending_linear, kNoTrans, 0.0);
+          bias.AddMatVec(1.0, linear, kNoTrans, pending_bias, 1.0);
+          pending_linear.Swap(&folded_linear);
+          pending_bias = bias;
+          pending_cost = folded_cost;
+          pending.push_back(c);
+          continue;
+        }
+      }
+    }
+    if (!pending.empty()) {  // Output what we have folded so far.
+      if (pending_linear.NumRows() == pending_linear.NumCols() &&
+          pending_linear.IsUnit(0.0) &&
+          VecVec(pending_bias, pending_bias) == 0.0) {
+        num_removed += pending.size();
+      } else if (pending.size() == 1) {
+        components.push_back(pending[0]);
+        pending.clear();
+      } else {
+        const AffineComponent *ac = NULL;
+        for (size_t j = 0; j < pending.size() && ac == NULL; j++)
+          ac = dynamic_cast<const AffineComponent*>(pending[j]);
+        if (ac != NULL) {
+          AffineComponent *new_ac = dynamic_cast<AffineComponent*>(ac->Copy());
+          new_ac->SetParams(Vector<BaseFloat>(pending_bias),
+                            Matrix<BaseFloat>(pending_linear));
+          components.push_back(new_ac);
+        } else {
+          int32 input_dim = pending_linear.NumCols();
+          CuMatrix<BaseFloat> mat(pending_linear.NumRows(), input_dim + 1);
+          mat.ColRange(0, input_dim).CopyFromMat(pending_linear);
+          mat.CopyColFromVec(pending_bias, input_dim);
+          FixedAffineComponent *fac = new FixedAffineComponent();
+          fac->Init(mat);
+          components.push_back(fac);
+        }
+        num_folded += pending.size();
+      }
+      DeletePointers(&pending);
+      pending.clear();
+    }
+    if (is_affine) {
+      pending.push_back(c);
+      pending_linear.Swap(&linear);
+      pending_bias = bias;
+      pending_cost = cost;
+    } else if (c != NULL) {
+      components.push_back(c);
+    }
+  }
+  if (components.empty()) {
+    // Everything was the identity; keep a single ScaleComponent so the
+    // network still has the right dimension.
+    components.push_back(new ScaleComponent(input_dim, 1.0));
+  }
+  components_ = components;
+  SetIndexes();
+  Check();
+  KALDI_LOG << "Folded " << num_folded << " affine components into fewer "
+            << "components and removed " << num_removed << " that computed "
+            << "the identity; the network now has " << components_.size()
+            << " components.";
+}
+
 } // namespace nnet2
 } // namespace kaldi
 
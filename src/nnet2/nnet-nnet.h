@@ -114,6 +114,11 @@ class Nnet {
   /// Replace any components of type AffineComponentPreconditioned with
   /// components of type AffineComponent.
   void RemovePreconditioning();
+
+  /// Replace any components of type AffineComponent (or types derived from
+  /// it) with components of type QuantizedAffineComponent, which are faster
+  /// for inference on CPU.  The resulting network cannot be trained.
+  void Quantize();
   
   /// For each updatatable component, adds to it
   /// the corresponding element of "other" times the
@@ -161,6 +166,17 @@ class Nnet {
   /// work for all pairs of such layers.  It currently only works where
   /// one of each pair is an AffineComponent.
   void Collapse(bool match_updatableness);
+
+  /// Prepares the network for test-time use: components that compute an
+  /// affine function of their input (AffineComponent and its child classes,
+  /// FixedAffineComponent, FixedLinearComponent, BlockAffineComponent,
+  /// ScaleComponent, PermuteComponent and DctComponent) are folded together
+  /// wherever this does not increase the number of multiply-adds per frame,
+  /// and any that compute the identity (e.g. a ScaleComponent with scale 1)
+  /// are removed.  A folded component is a copy of the first AffineComponent
+  /// in the sequence with the new parameters, or a FixedAffineComponent if
+  /// there was no AffineComponent.  The output is unchanged up to roundoff.
+  void OptimizeForInference();
   
 
   /// Sets the index_ values of the components.
@@ -0,0 +1,102 @@
+// nnet2/nnet-param-server-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <unistd.h>
+#include "nnet2/nnet-param-server.h"
+#include "thread/kaldi-thread.h"
+
+namespace kaldi {
+namespace nnet2 {
+
+static void *RunServer(void *server_in) {
+  NnetParamServer *server = static_cast<NnetParamServer*>(server_in);
+  server->Serve(2);
+  return NULL;
+}
+
+void UnitTestNnetParamServer() {
+  int32 input_dim = 5 + rand() % 10, output_dim = 5 + rand() % 10;
+  std::vector<Component*> components;
+  AffineComponent *affine = new AffineComponent();
+  affine->Init(0.01, input_dim, output_dim, 0.1, 1.0);
+  components.push_back(affine);
+  components.push_back(new SigmoidComponent(output_dim));
+  Nnet server_nnet;
+  server_nnet.Init(&components);
+  int32 dim = server_nnet.GetParameterDim();
+  Vector<BaseFloat> initial_params(dim);
+  server_nnet.Vectorize(&initial_params);
+
+  NnetParamServerConfig config;
+  config.port = 20000 + rand() % 20000;
+  config.delta_scale = 0.5;
+  NnetParamServer server(config, &server_nnet);
+  ThreadGroup group;
+  MultiThreadPool::Instantiate().Run(RunServer, &server, &group);
+  sleep(1);  // Give the server time to start listening.
+
+  std::ostringstream os;
+  os << "localhost:" << config.port;
+  // Two workers, starting from a differently initialized nnet; they should
+  // get the server's parameters.
+  Nnet nnet1(server_nnet), nnet2(server_nnet);
+  nnet1.SetZero(false);
+  nnet2.SetZero(false);
+  NnetParamClient client1, client2;
+  client1.Connect(os.str(), &nnet1);
+  client2.Connect(os.str(), &nnet2);
+  Vector<BaseFloat> params(dim), delta1(dim), delta2(dim);
+  nnet1.Vectorize(&params);
+  AssertEqual(params, initial_params);
+
+  delta1.SetRandn();
+  delta2.SetRandn();
+  params.AddVec(1.0, delta1);
+  nnet1.UnVectorize(params);
+  client1.Sync(&nnet1);
+  nnet2.Vectorize(&params);
+  params.AddVec(1.0, delta2);
+  nnet2.UnVectorize(params);
+  client2.Sync(&nnet2);
+  client1.Disconnect();
+  client2.Disconnect();
+  group.Wait();
+
+  // The master parameters have both changes, scaled by 0.5; the second
+  // worker's parameters are the same, as it synced last.
+  Vector<BaseFloat> expected(initial_params);
+  expected.AddVec(0.5, delta1);
+  expected.AddVec(0.5, delta2);
+  server_nnet.Vectorize(&params);
+  AssertEqual(params, expected);
+  nnet2.Vectorize(&params);
+  AssertEqual(params, expected);
+}
+
+} // namespace nnet2
+} // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  using namespace kaldi::nnet2;
+  UnitTestNnetParamServer();
+  KALDI_LOG << "Parameter server test succeeded.";
+  return 0;
+}
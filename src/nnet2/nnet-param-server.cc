@@ -0,0 +1,252 @@
+// nnet2/nnet-param-server.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#include "nnet2/nnet-param-server.h"
+#include "thread/kaldi-thread.h"
+#include "util/text-utils.h"
+
+namespace kaldi {
+namespace nnet2 {
+
+// The messages a worker sends.  Each is an int32 code, followed (for
+// kDeltaMessage) by the parameter change.  The server's reply to kHello and
+// kDeltaMessage is the master parameters (preceded, for kHello, by their
+// dimension).
+static const int32 kHelloMessage = 0x6e6e7073,  // also serves as a check.
+    kDeltaMessage = 1,
+    kDoneMessage = 2;
+
+
+NnetParamServer::NnetParamServer(const NnetParamServerConfig &config,
+                                 Nnet *nnet):
+    config_(config), nnet_(nnet), params_(nnet->GetParameterDim()),
+    num_deltas_(0) {
+  nnet_->Vectorize(&params_);
+}
+
+void NnetParamServer::Serve(int32 num_workers) {
+  KALDI_ASSERT(num_workers > 0);
+  int32 server_socket = SocketListen(config_.port, num_workers);
+  KALDI_LOG << "Parameter server listening on port " << config_.port
+            << " for " << num_workers << " workers.";
+
+  ThreadGroup group;
+  std::vector<WorkerInfo> infos(num_workers);
+  for (int32 i = 0; i < num_workers; i++) {
+    int32 socket = accept(server_socket, NULL, NULL);
+    if (socket < 0) {
+      if (errno == EINTR) { i--; continue; }
+      KALDI_ERR << "Error accepting connection: " << strerror(errno);
+    }
+    infos[i].server = this;
+    infos[i].socket = socket;
+    MultiThreadPool::Instantiate().Run(ServeWorker, &(infos[i]), &group);
+  }
+  close(server_socket);
+  group.Wait();
+  nnet_->UnVectorize(params_);
+  KALDI_LOG << "All workers finished; received " << num_deltas_
+            << " parameter updates.";
+}
+
+void *NnetParamServer::ServeWorker(void *info_in) {
+  WorkerInfo *info = static_cast<WorkerInfo*>(info_in);
+  if (!info->server->ServeWorkerInternal(info->socket))
+    KALDI_WARN << "Connection to worker failed; dropping it.";
+  close(info->socket);
+  return NULL;
+}
+
+bool NnetParamServer::ServeWorkerInternal(int32 socket) {
+  int32 dim = params_.Dim();
+  Vector<BaseFloat> delta(dim), params(dim);
+  while (true) {
+    int32 code;
+    if (!SocketRecvFull(socket, &code, sizeof(code)))
+      return false;
+    if (code == kDoneMessage) {
+      return true;
+    } else if (code == kHelloMessage) {
+      int32 worker_dim;
+      if (!SocketRecvFull(socket, &worker_dim, sizeof(worker_dim)))
+        return false;
+      if (worker_dim != dim) {
+        KALDI_WARN << "Worker has nnet with " << worker_dim << " parameters, "
+                   << "expected " << dim;
+        return false;
+      }
+    } else if (code == kDeltaMessage) {
+      if (!SocketRecvVector(socket, &delta))
+        return false;
+      mutex_.Lock();
+      params_.AddVec(config_.delta_scale, delta);
+      num_deltas_++;
+      params.CopyFromVec(params_);
+      mutex_.Unlock();
+      if (!SocketSendVector(socket, params))
+        return false;
+      continue;
+    } else {
+      KALDI_WARN << "Unexpected message code " << code << " from worker.";
+      return false;
+    }
+    // Reply to kHelloMessage.
+    mutex_.Lock();
+    params.CopyFromVec(params_);
+    mutex_.Unlock();
+    if (!SocketSendFull(socket, &dim, sizeof(dim)) ||
+        !SocketSendVector(socket, params))
+      return false;
+  }
+}
+
+NnetParamServer::~NnetParamServer() { }
+
+
+NnetParamClient::NnetParamClient(): socket_(-1) { }
+
+void NnetParamClient::Connect(const std::string &server, Nnet *nnet) {
+  KALDI_ASSERT(socket_ == -1);
+  socket_ = SocketConnect(server);
+  int32 dim = nnet->GetParameterDim(), server_dim;
+  if (!SocketSendFull(socket_, &kHelloMessage, sizeof(kHelloMessage)) ||
+      !SocketSendFull(socket_, &dim, sizeof(dim)) ||
+      !SocketRecvFull(socket_, &server_dim, sizeof(server_dim)))
+    KALDI_ERR << "Parameter server " << server << " closed the connection "
+              << "(mismatched nnet?)";
+  KALDI_ASSERT(server_dim == dim);
+  params_.Resize(dim);
+  ReceiveParams(nnet);
+  KALDI_LOG << "Connected to parameter server " << server;
+}
+
+void NnetParamClient::ReceiveParams(Nnet *nnet) {
+  if (!SocketRecvVector(socket_, &params_))
+    KALDI_ERR << "Lost connection to parameter server.";
+  nnet->UnVectorize(params_);
+}
+
+void NnetParamClient::Sync(Nnet *nnet) {
+  KALDI_ASSERT(socket_ != -1);
+  Vector<BaseFloat> delta(params_.Dim());
+  nnet->Vectorize(&delta);
+  delta.AddVec(-1.0, params_);
+  if (!SocketSendFull(socket_, &kDeltaMessage, sizeof(kDeltaMessage)) ||
+      !SocketSendVector(socket_, delta))
+    KALDI_ERR << "Lost connection to parameter server.";
+  ReceiveParams(nnet);
+}
+
+void NnetParamClient::Disconnect() {
+  if (socket_ == -1) return;
+  if (!SocketSendFull(socket_, &kDoneMessage, sizeof(kDoneMessage)))
+    KALDI_WARN << "Error disconnecting from parameter server.";
+  close(socket_);
+  socket_ = -1;
+}
+
+NnetParamClient::~NnetParamClient() {
+  if (socket_ != -1) close(socket_);
+}
+
+
+bool SocketSendFull(int32 socket, const void *buf, size_t len) {
+  const char *data = static_cast<const char*>(buf);
+  while (len > 0) {
+    ssize_t ret = send(socket, data, len, 0);
+    if (ret < 0 && errno == EINTR) continue;
+    if (ret <= 0) return false;
+    data += ret;
+    len -= ret;
+  }
+  return true;
+}
+
+bool SocketRecvFull(int32 socket, void *buf, size_t len) {
+  char *data = static_cast<char*>(buf);
+  while (len > 0) {
+    ssize_t ret = recv(socket, data, len, 0);
+    if (ret < 0 && errno == EINTR) continue;
+    if (ret <= 0) return false;
+    data += ret;
+    len -= ret;
+  }
+  return true;
+}
+
+bool SocketSendVector(int32 socket, const VectorBase<BaseFloat> &vec) {
+  return SocketSendFull(socket, vec.Data(), vec.Dim() * sizeof(BaseFloat));
+}
+
+bool SocketRecvVector(int32 socket, VectorBase<BaseFloat> *vec) {
+  return SocketRecvFull(socket, vec->Data(), vec->Dim() * sizeof(BaseFloat));
+}
+
+int32 SocketListen(int32 port, int32 backlog) {
+  int32 server_socket = socket(AF_INET, SOCK_STREAM, 0);
+  if (server_socket < 0)
+    KALDI_ERR << "Could not create socket: " << strerror(errno);
+  int32 flag = 1;
+  setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  if (bind(server_socket, reinterpret_cast<sockaddr*>(&addr),
+           sizeof(addr)) < 0 || listen(server_socket, backlog) < 0)
+    KALDI_ERR << "Could not listen on port " << port << ": "
+              << strerror(errno);
+  return server_socket;
+}
+
+int32 SocketConnect(const std::string &server) {
+  size_t pos = server.rfind(':');
+  int32 port;
+  if (pos == std::string::npos ||
+      !ConvertStringToInteger(server.substr(pos + 1), &port))
+    KALDI_ERR << "Invalid server " << server << ", expected host:port";
+  std::string host = server.substr(0, pos);
+  hostent *hp = gethostbyname(host.c_str());
+  if (hp == NULL)
+    KALDI_ERR << "Could not resolve host " << host;
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  memcpy(&(addr.sin_addr), hp->h_addr, hp->h_length);
+  addr.sin_port = htons(port);
+  int32 ans = socket(AF_INET, SOCK_STREAM, 0);
+  if (ans < 0 || connect(ans, reinterpret_cast<sockaddr*>(&addr),
+                         sizeof(addr)) < 0)
+    KALDI_ERR << "Could not connect to " << server << ": " << strerror(errno);
+  return ans;
+}
+
+
+} // namespace nnet2
+} // namespace kaldi
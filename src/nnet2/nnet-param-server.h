@@ -0,0 +1,146 @@
+// nnet2/nnet-param-server.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_NNET2_NNET_PARAM_SERVER_H_
+#define KALDI_NNET2_NNET_PARAM_SERVER_H_
+
+#include <string>
+#include "nnet2/nnet-nnet.h"
+#include "thread/kaldi-mutex.h"
+#include "itf/options-itf.h"
+
+namespace kaldi {
+namespace nnet2 {
+
+/*
+  This header provides a simple parameter server, for asynchronous training of
+  an nnet by several workers (typically nnet-train-simple processes on
+  different machines), which communicate with it over TCP.  The server holds
+  the master copy of the parameters of the updatable components (as given by
+  Nnet::Vectorize()).  When a worker connects, it gets the current master
+  parameters.  Periodically (see NnetParamClient::Sync()) each worker sends
+  the change in its parameters since it last got them, which the server adds
+  (times delta_scale) to the master parameters; the worker then continues from
+  the new master parameters.  This replaces the cycle of training a model on
+  each machine, averaging them with nnet-am-average and restarting.
+
+  The protocol uses the native byte order and float format, so the machines
+  must agree on these.
+*/
+
+struct NnetParamServerConfig {
+  int32 port;
+  BaseFloat delta_scale;
+
+  NnetParamServerConfig(): port(5123), delta_scale(1.0) { }
+
+  void Register(OptionsItf *po) {
+    po->Register("port", &port, "TCP port the parameter server listens on.");
+    po->Register("delta-scale", &delta_scale, "Scale on the parameter changes "
+                 "sent by the workers, when adding them to the master "
+                 "parameters (e.g. 1/num-workers for averaging).");
+  }
+};
+
+
+class NnetParamServer {
+ public:
+  /// "nnet" gives the initial master parameters, and at the end of Serve()
+  /// it is set to the final ones.  We don't take ownership of it.
+  NnetParamServer(const NnetParamServerConfig &config, Nnet *nnet);
+
+  /// Accepts connections until "num_workers" workers have connected, serving
+  /// each in its own thread, and returns when all of them have disconnected.
+  /// Dies on error in setting up the socket; a worker whose connection fails
+  /// is dropped with a warning.
+  void Serve(int32 num_workers);
+
+  ~NnetParamServer();
+ private:
+  struct WorkerInfo {
+    NnetParamServer *server;
+    int32 socket;
+  };
+  static void *ServeWorker(void *info_in);
+  // Returns false if the connection failed.
+  bool ServeWorkerInternal(int32 socket);
+
+  NnetParamServerConfig config_;
+  Nnet *nnet_;
+  Vector<BaseFloat> params_;  // The master parameters, protected by mutex_.
+  Mutex mutex_;
+  int64 num_deltas_;  // The number of parameter changes received.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(NnetParamServer);
+};
+
+
+class NnetParamClient {
+ public:
+  NnetParamClient();
+
+  /// Connects to the server at "server", of the form host:port, and sets the
+  /// parameters of "nnet" to the master parameters.  Dies on failure.
+  void Connect(const std::string &server, Nnet *nnet);
+
+  /// Sends the change in the parameters of "nnet" since they were last set
+  /// from the server, and sets them to the new master parameters.
+  void Sync(Nnet *nnet);
+
+  /// Tells the server we are finished, and closes the connection.
+  void Disconnect();
+
+  ~NnetParamClient();
+ private:
+  // Receives the master parameters and sets "nnet" to them.
+  void ReceiveParams(Nnet *nnet);
+
+  int32 socket_;
+  Vector<BaseFloat> params_;  // The parameters as we last received them.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(NnetParamClient);
+};
+
+
+// The following socket utilities are also used by the distributed L-BFGS
+// code in nnet-lbfgs.cc.
+
+/// Sends exactly "len" bytes; returns false on failure.
+bool SocketSendFull(int32 socket, const void *buf, size_t len);
+
+/// Receives exactly "len" bytes; returns false on failure or if the other
+/// side closed the connection.
+bool SocketRecvFull(int32 socket, void *buf, size_t len);
+
+/// Sends or receives the data of a vector (its dimension must be known to
+/// both sides).
+bool SocketSendVector(int32 socket, const VectorBase<BaseFloat> &vec);
+bool SocketRecvVector(int32 socket, VectorBase<BaseFloat> *vec);
+
+/// Returns a socket listening on "port" (on all interfaces).  Dies on error.
+int32 SocketListen(int32 port, int32 backlog);
+
+/// Returns a socket connected to "server", of the form host:port.  Dies on
+/// error.
+int32 SocketConnect(const std::string &server);
+
+
+} // namespace nnet2
+} // namespace kaldi
+
+#endif // KALDI_NNET2_NNET_PARAM_SERVER_H_
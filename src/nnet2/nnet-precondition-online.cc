@@ -22,6 +22,18 @@
 namespace kaldi {
 namespace nnet2 {
 
+// Sets *C_inv to the inverse of the Cholesky factor of S.  The matrices here
+// are only of the dimension of the preconditioner rank, so we use the batched
+// small-matrix Cholesky (a single kernel launch on the GPU) rather than
+// CuTpMatrix::Cholesky(), which does the factorization on the CPU; this way
+// the whole update stays on the device.  Throws if S is not positive definite.
+static void InvCholesky(const CuSpMatrix<BaseFloat> &S,
+                        CuTpMatrix<BaseFloat> *C_inv) {
+  std::vector<const CuSpMatrix<BaseFloat>*> A(1, &S);
+  std::vector<CuTpMatrix<BaseFloat>*> L(1, C_inv);
+  CuCholeskyBatch(A, L);
+  C_inv->Invert();
+}
 
 static void CheckOrthogonal(CuMatrixBase<BaseFloat> *N,
                             bool quiet = false,
@@ -53,8 +65,7 @@ static void CheckOrthogonal(CuMatrixBase<BaseFloat> *N,
       }
     }
     CuTpMatrix<BaseFloat> Cinv(R);
-    Cinv.Cholesky(S);
-    Cinv.Invert();
+    InvCholesky(S, &Cinv);
     CuMatrix<BaseFloat> N_copy(*N);
     N->AddTpMat(1.0, Cinv, kNoTrans, N_copy, kNoTrans, 0.0);
     CheckOrthogonal(N, quiet, recurse_count + 1); // Check that it worked.
@@ -121,7 +132,9 @@ void PreconditionDirectionsOnline(BaseFloat eta,
                                                  // of F_i later.
   CuSpMatrix<BaseFloat> F_i_inv(F_i_sp);
   F_i_inv.AddToDiag(epsilon * t_f / R + delta); // Ensure it will be invertible.  
-  F_i_inv.Invert();
+  // Invert on the device with the batched small-matrix code (F_i is only
+  // R x R); CuSpMatrix::Invert() would go via the CPU.
+  CuInvertPosDefBatch(std::vector<CuSpMatrix<BaseFloat>*>(1, &F_i_inv));
   CuSpMatrix<BaseFloat> &temp(F_i_inv);
   temp.Scale(beta_i);
   temp.AddToDiag(-1.0);
@@ -153,8 +166,7 @@ void PreconditionDirectionsOnline(BaseFloat eta,
   CuMatrix<BaseFloat> &P_i(O_i); // re-use that matrix for P_i.
   CuMatrixBase<BaseFloat> &N_i1(*N); // N_{i+1}
   try {
-    C_i_inv.Cholesky(Y_i);
-    C_i_inv.Invert();
+    InvCholesky(Y_i, &C_i_inv);
     P_i.AddMat(eta_i, N_i);
     N_i1.AddTpMat(1.0, C_i_inv, kNoTrans, P_i, kNoTrans, 0.0);
   } catch (...) {
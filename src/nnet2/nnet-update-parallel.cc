@@ -20,16 +20,38 @@
 #include "nnet2/nnet-update-parallel.h"
 #include "nnet2/nnet-update.h"
 #include "thread/kaldi-thread.h"
-#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-semaphore.h"
+#include <sched.h>
 #include <numeric>
 
 namespace kaldi {
 namespace nnet2 {
 
-/** This struct stores neural net training examples to be used in
-    multi-threaded training.  */
+/** This class passes minibatches of examples from the thread that reads them
+    to the threads that train on them, in multi-threaded training.  The
+    reading thread also formats the input of each minibatch as a matrix (see
+    FormatNnetInput()), so the training threads only do the neural-net
+    computation.
+
+    It is a bounded lock-free queue: a ring of slots, each with a sequence
+    number that says whether it is waiting to be filled or to be emptied on
+    the current pass around the ring (this is the well-known design for a
+    multi-producer, multi-consumer bounded queue due to D. Vyukov).  A thread
+    claims a slot by incrementing enqueue_pos_ or dequeue_pos_ with an atomic
+    compare-and-swap, so threads never block each other except when the ring
+    is full or empty.  A thread that finds the ring full (or empty) first
+    spins on sched_yield() for a few tries, since the wait is usually short;
+    if it is still full (or empty) it registers itself as waiting and sleeps
+    on a semaphore, which the thread that frees (or fills) a slot signals.  So
+    idle training threads do not take CPU time from the reading thread, which
+    formats the input.
+*/
 class ExamplesRepository {
  public:
+  /// "nnet" is only needed to format the input; "num_slots" is the size of
+  /// the ring, which is rounded up to a power of two.
+  ExamplesRepository(const Nnet &nnet, int32 num_slots);
+
   /// The following function is called by the code that reads in the examples,
   /// with a batch of examples.  [It will empty the vector "examples").
   void AcceptExamples(std::vector<NnetExample> *examples);
@@ -39,52 +61,189 @@ class ExamplesRepository {
   void ExamplesDone();
   
   /// This function is called by the code that does the training.  It gets the
-  /// training examples, and if they are available, puts them in "examples" and
-  /// returns true.  It returns false when there are no examples left and
-  /// ExamplesDone() has been called.
-  bool ProvideExamples(std::vector<NnetExample> *examples);
+  /// training examples, and if they are available, puts them in "examples",
+  /// and their formatted input in "examples_formatted", and returns true.  It
+  /// returns false when there are no examples left and ExamplesDone() has been
+  /// called.
+  bool ProvideExamples(std::vector<NnetExample> *examples,
+                       Matrix<BaseFloat> *examples_formatted);
   
-  ExamplesRepository(): empty_semaphore_(1), done_(false) { }
  private:
-  Semaphore full_semaphore_;
-  Semaphore empty_semaphore_;
+  struct Slot {
+    // sequence == position: the slot is free, to be filled by the
+    // AcceptExamples() call that claims "position"; sequence == position + 1:
+    // it is full, to be emptied by the ProvideExamples() call that claims
+    // "position".
+    volatile size_t sequence;
+    std::vector<NnetExample> examples;
+    Matrix<BaseFloat> examples_formatted;
+  };
+
+  // Tries to claim the slot at the front of the queue; returns NULL if the
+  // queue is empty.
+  Slot *TryDequeue();
 
-  std::vector<NnetExample> examples_;
-  bool done_;
+  // If any thread is registered in *num_waiting, unregisters one and returns
+  // true; the caller must then signal the semaphore that thread sleeps on.
+  // A waiting thread also calls this to unregister itself if it finds it
+  // need not sleep after all; if it returns false, another thread has
+  // already unregistered it and is about to signal, so it must Wait().
+  static bool ClaimWaiter(volatile int32 *num_waiting);
+
+  // The number of times a thread calls sched_yield() while the queue is
+  // full or empty, before it sleeps on a semaphore.
+  static const int32 kNumSpins = 16;
+
+  const Nnet &nnet_;
+  std::vector<Slot> slots_;
+  size_t mask_;  // slots_.size() - 1.
+  volatile size_t enqueue_pos_;
+  volatile size_t dequeue_pos_;
+  volatile bool done_;
+  // The number of threads sleeping, or about to sleep, in ProvideExamples()
+  // because the queue is empty, and the semaphore they sleep on.
+  volatile int32 num_waiting_consumers_;
+  Semaphore consumer_semaphore_;
+  // The same for AcceptExamples() when the queue is full.
+  volatile int32 num_waiting_producers_;
+  Semaphore producer_semaphore_;
   KALDI_DISALLOW_COPY_AND_ASSIGN(ExamplesRepository);
 };
 
 
+ExamplesRepository::ExamplesRepository(const Nnet &nnet, int32 num_slots):
+    nnet_(nnet), enqueue_pos_(0), dequeue_pos_(0), done_(false),
+    num_waiting_consumers_(0), num_waiting_producers_(0) {
+  size_t size = 2;
+  while (size < static_cast<size_t>(num_slots)) size *= 2;
+  slots_.resize(size);
+  mask_ = size - 1;
+  for (size_t i = 0; i < size; i++)
+    slots_[i].sequence = i;
+}
+
 void ExamplesRepository::AcceptExamples(
     std::vector<NnetExample> *examples) {
   KALDI_ASSERT(!examples->empty());
-  empty_semaphore_.Wait();
-  KALDI_ASSERT(examples_.empty());
-  examples_.swap(*examples);
-  full_semaphore_.Signal();
+  // Format the input before claiming a slot, so the slot is not held while we
+  // do this.
+  Matrix<BaseFloat> examples_formatted;
+  FormatNnetInput(nnet_, *examples, &examples_formatted);
+  Slot *slot;
+  size_t pos = enqueue_pos_;
+  int32 num_tries = 0;
+  while (true) {
+    slot = &(slots_[pos & mask_]);
+    __sync_synchronize();
+    ssize_t diff = static_cast<ssize_t>(slot->sequence) -
+        static_cast<ssize_t>(pos);
+    if (diff == 0) {  // The slot is free: try to claim it.
+      if (__sync_bool_compare_and_swap(&enqueue_pos_, pos, pos + 1))
+        break;
+    } else if (diff < 0) {  // The queue is full.
+      if (num_tries++ < kNumSpins) {
+        sched_yield();
+      } else {
+        // Register before looking at the slot again (both are full
+        // barriers), so that a ProvideExamples() call that frees it either
+        // is seen here or sees us registered and signals.
+        __sync_fetch_and_add(&num_waiting_producers_, 1);
+        if (static_cast<ssize_t>(slot->sequence) -
+            static_cast<ssize_t>(pos) < 0 ||
+            !ClaimWaiter(&num_waiting_producers_))
+          producer_semaphore_.Wait();
+        num_tries = 0;
+      }
+    }
+    pos = enqueue_pos_;
+  }
+  slot->examples.swap(*examples);
+  slot->examples_formatted.Swap(&examples_formatted);
+  __sync_synchronize();  // The data must be visible before the sequence.
+  slot->sequence = pos + 1;
+  __sync_synchronize();
+  if (ClaimWaiter(&num_waiting_consumers_))
+    consumer_semaphore_.Signal();
 }
 
 void ExamplesRepository::ExamplesDone() {
-  empty_semaphore_.Wait();
-  KALDI_ASSERT(examples_.empty());
+  __sync_synchronize();
   done_ = true;
-  full_semaphore_.Signal();
+  __sync_synchronize();
+  // Wake all the sleeping training threads, so they see done_.
+  while (ClaimWaiter(&num_waiting_consumers_))
+    consumer_semaphore_.Signal();
+}
+
+bool ExamplesRepository::ClaimWaiter(volatile int32 *num_waiting) {
+  int32 n;
+  while ((n = *num_waiting) > 0)
+    if (__sync_bool_compare_and_swap(num_waiting, n, n - 1))
+      return true;
+  return false;
+}
+
+ExamplesRepository::Slot *ExamplesRepository::TryDequeue() {
+  size_t pos = dequeue_pos_;
+  while (true) {
+    Slot *slot = &(slots_[pos & mask_]);
+    __sync_synchronize();
+    ssize_t diff = static_cast<ssize_t>(slot->sequence) -
+        static_cast<ssize_t>(pos + 1);
+    if (diff == 0) {  // The slot is full: try to claim it.
+      if (__sync_bool_compare_and_swap(&dequeue_pos_, pos, pos + 1))
+        return slot;
+    } else if (diff < 0) {  // The queue is empty.
+      return NULL;
+    }
+    pos = dequeue_pos_;
+  }
 }
 
 bool ExamplesRepository::ProvideExamples(
-    std::vector<NnetExample> *examples) {
-  full_semaphore_.Wait();
-  if (done_) {
-    KALDI_ASSERT(examples_.empty());
-    full_semaphore_.Signal(); // Increment the semaphore so
-    // the call by the next thread will not block.
-    return false; // no examples to return-- all finished.
-  } else {
-    KALDI_ASSERT(!examples_.empty() && examples->empty());
-    examples->swap(examples_);
-    empty_semaphore_.Signal();
-    return true;
+    std::vector<NnetExample> *examples,
+    Matrix<BaseFloat> *examples_formatted) {
+  KALDI_ASSERT(examples->empty());
+  Slot *slot;
+  int32 num_tries = 0;
+  while ((slot = TryDequeue()) == NULL) {
+    if (done_) {
+      // ExamplesDone() is called after the last AcceptExamples(), so if the
+      // queue is still empty now there is nothing more to come.
+      __sync_synchronize();
+      if ((slot = TryDequeue()) == NULL)
+        return false;
+      break;
+    }
+    if (num_tries++ < kNumSpins) {
+      sched_yield();
+    } else {
+      // Register before looking at the queue and done_ again (both are full
+      // barriers), so that an AcceptExamples() or ExamplesDone() call either
+      // is seen here or sees us registered and signals.
+      __sync_fetch_and_add(&num_waiting_consumers_, 1);
+      if ((slot = TryDequeue()) != NULL || done_) {
+        if (!ClaimWaiter(&num_waiting_consumers_))
+          consumer_semaphore_.Wait();  // Take the signal meant for us.
+        if (slot != NULL)
+          break;
+      } else {
+        consumer_semaphore_.Wait();
+      }
+      num_tries = 0;
+    }
   }
+  __sync_synchronize();
+  size_t pos = slot->sequence - 1;
+  examples->swap(slot->examples);
+  examples_formatted->Swap(&(slot->examples_formatted));
+  __sync_synchronize();  // We must be done with the data before the slot is
+                         // freed.
+  slot->sequence = pos + mask_ + 1;
+  __sync_synchronize();
+  if (ClaimWaiter(&num_waiting_producers_))
+    producer_semaphore_.Signal();
+  return true;
 }
 
 
@@ -98,15 +257,18 @@ class DoBackpropParallelClass: public MultiThreadable {
                           double *tot_weight_ptr,
                           double *log_prob_ptr,
                           Nnet *nnet_to_update,
-                          bool store_separate_gradients):
+                          bool store_separate_gradients,
+                          double *tot_accuracy_ptr = NULL):
       nnet_(nnet), repository_(repository),
       nnet_to_update_(nnet_to_update),
       nnet_to_update_orig_(nnet_to_update),
       store_separate_gradients_(store_separate_gradients),
       tot_weight_ptr_(tot_weight_ptr),
       log_prob_ptr_(log_prob_ptr),
+      tot_accuracy_ptr_(tot_accuracy_ptr),
       tot_weight_(0.0),
-      log_prob_(0.0) { }
+      log_prob_(0.0),
+      tot_accuracy_(0.0) { }
   
   // The following constructor is called multiple times within
   // the RunMultiThreaded template function.
@@ -118,8 +280,10 @@ class DoBackpropParallelClass: public MultiThreadable {
       store_separate_gradients_(other.store_separate_gradients_),
       tot_weight_ptr_(other.tot_weight_ptr_),
       log_prob_ptr_(other.log_prob_ptr_),
+      tot_accuracy_ptr_(other.tot_accuracy_ptr_),
       tot_weight_(0),
-      log_prob_(0.0) {
+      log_prob_(0.0),
+      tot_accuracy_(0.0) {
     if (store_separate_gradients_) {
       // To ensure correctness, we work on separate copies of the gradient
       // object, which we'll sum at the end.  This is used for exact gradient
@@ -140,21 +304,32 @@ class DoBackpropParallelClass: public MultiThreadable {
   // This does the main function of the class.
   void operator () () {
     std::vector<NnetExample> examples;
-    while (repository_->ProvideExamples(&examples)) {
-      // This is a function call to a function defined in
-      // nnet-update.h
+    Matrix<BaseFloat> examples_formatted;
+    // Each thread keeps its own matrices between minibatches, so they are
+    // not reallocated each time.  With nnet_to_update_ == NULL it just
+    // computes the objective function.
+    NnetUpdater updater(nnet_, nnet_to_update_, true);
+    while (repository_->ProvideExamples(&examples, &examples_formatted)) {
       double tot_loglike;
-      if (nnet_to_update_ != NULL) 
-        tot_loglike = DoBackprop(nnet_, examples, nnet_to_update_);
-      else
-        tot_loglike = ComputeNnetObjf(nnet_, examples);
+      try {
+        tot_loglike = updater.ComputeForMinibatch(examples,
+                                                  &examples_formatted);
+      } catch (...) {
+        KALDI_LOG << "Error doing backprop, nnet info is: " << nnet_.Info();
+        throw;
+      }
       tot_weight_ += TotalNnetTrainingWeight(examples);
       log_prob_ += tot_loglike;
+      if (tot_accuracy_ptr_ != NULL)
+        tot_accuracy_ += updater.ComputeTotAccuracy(examples);
       KALDI_VLOG(4) << "Thread " << thread_id_ << " saw "
                     << tot_weight_ << " frames so far (weighted); likelihood "
                     << "per frame so far is " << (log_prob_ / tot_weight_);
       examples.clear();
     }    
+    KALDI_VLOG(1) << "Thread " << thread_id_ << ": peak memory used by the "
+                  << "forward and backward computation was "
+                  << (updater.PeakWorkspaceBytes() / 1.0e+06) << " MB.";
   }
   
   ~DoBackpropParallelClass() {
@@ -168,6 +343,8 @@ class DoBackpropParallelClass: public MultiThreadable {
     }
     *log_prob_ptr_ += log_prob_;
     *tot_weight_ptr_ += tot_weight_;
+    if (tot_accuracy_ptr_ != NULL)
+      *tot_accuracy_ptr_ += tot_accuracy_;
   }
  private:
   const Nnet &nnet_;
@@ -177,8 +354,10 @@ class DoBackpropParallelClass: public MultiThreadable {
   bool store_separate_gradients_;
   double *tot_weight_ptr_;
   double *log_prob_ptr_;
+  double *tot_accuracy_ptr_;  // may be NULL.
   double tot_weight_;
   double log_prob_; // log-like times num frames.
+  double tot_accuracy_;
 };
 
 
@@ -187,17 +366,24 @@ double DoBackpropSingleThreaded(const Nnet &nnet,
                                 int32 minibatch_size,
                                 SequentialNnetExampleReader *examples_reader,
                                 double *tot_weight_out,
-                                Nnet *nnet_to_update) {
+                                Nnet *nnet_to_update,
+                                double *tot_accuracy) {
   double ans = 0.0, tot_weight = 0.0;
   KALDI_ASSERT(minibatch_size > 0);
+  if (tot_accuracy != NULL)
+    *tot_accuracy = 0.0;
+  NnetUpdater updater(nnet, nnet_to_update, true);
+  std::vector<NnetExample> egs;
+  egs.reserve(minibatch_size);
   while (!examples_reader->Done()) {
-    std::vector<NnetExample> egs;
-    egs.reserve(minibatch_size);
-    while (egs.size() < minibatch_size && examples_reader->Done()) {
+    egs.clear();
+    while (egs.size() < minibatch_size && !examples_reader->Done()) {
       egs.push_back(examples_reader->Value());
       examples_reader->Next();
     }
-    ans += DoBackprop(nnet, egs, nnet_to_update);
+    ans += updater.ComputeForMinibatch(egs);
+    if (tot_accuracy != NULL)
+      *tot_accuracy += updater.ComputeTotAccuracy(egs);
     tot_weight += TotalNnetTrainingWeight(egs);
   }
   *tot_weight_out = tot_weight;
@@ -210,20 +396,23 @@ double DoBackpropParallel(const Nnet &nnet,
                           int32 minibatch_size,
                           SequentialNnetExampleReader *examples_reader,
                           double *tot_weight,
-                          Nnet *nnet_to_update) {
+                          Nnet *nnet_to_update,
+                          double *tot_accuracy) {
 #if HAVE_CUDA == 1
   // Our GPU code won't work with multithreading; we do this
   // to enable it to work with this code in the single-threaded
   // case.
   if (CuDevice::Instantiate().Enabled())
     return DoBackpropSingleThreaded(nnet, minibatch_size, examples_reader,
-                                    tot_weight, nnet_to_update);
+                                    tot_weight, nnet_to_update, tot_accuracy);
 #endif
   
-  ExamplesRepository repository; // handles parallel programming issues regarding
-  // the "examples" of data.
+  ExamplesRepository repository(nnet, 2 * g_num_threads); // handles
+  // parallel programming issues regarding the "examples" of data.
   double tot_log_prob = 0.0;
   *tot_weight = 0.0;
+  if (tot_accuracy != NULL)
+    *tot_accuracy = 0.0;
 
   // This function assumes you want the exact gradient, if
   // nnet_to_update != &nnet.
@@ -231,7 +420,7 @@ double DoBackpropParallel(const Nnet &nnet,
   
   DoBackpropParallelClass c(nnet, &repository, tot_weight,
                             &tot_log_prob, nnet_to_update,
-                            store_separate_gradients);
+                            store_separate_gradients, tot_accuracy);
 
   {
     // The initialization of the following class spawns the threads that
@@ -288,8 +477,8 @@ double DoBackpropParallel(const Nnet &nnet,
     return DoBackpropSingleThreaded(nnet, minibatch_size, egs, 
                                     tot_weight, nnet_to_update);
 
-  ExamplesRepository repository; // handles parallel programming issues regarding
-  // the "examples" of data.
+  ExamplesRepository repository(nnet, 2 * num_threads); // handles parallel
+  // programming issues regarding the "examples" of data.
   double tot_log_prob = 0.0;
   *tot_weight = 0;
   const bool store_separate_gradients = (nnet_to_update != &nnet);
@@ -326,6 +515,156 @@ double DoBackpropParallel(const Nnet &nnet,
   return tot_log_prob;
 }
 
+
+NnetValidationComputer::NnetValidationComputer(
+    const Nnet &nnet,
+    const std::vector<NnetExample> &examples,
+    int32 minibatch_size) {
+  KALDI_ASSERT(minibatch_size > 0);
+  num_fixed_ = 0;
+  while (num_fixed_ < nnet.NumComponents() &&
+         dynamic_cast<const UpdatableComponent*>(
+             &(nnet.GetComponent(num_fixed_))) == NULL)
+    num_fixed_++;
+  fixed_components_ = FixedComponentsString(nnet);
+  tot_weight_ = TotalNnetTrainingWeight(examples);
+
+  int32 num_egs = examples.size();
+  minibatches_.resize((num_egs + minibatch_size - 1) / minibatch_size);
+  for (size_t b = 0; b < minibatches_.size(); b++) {
+    Minibatch &minibatch = minibatches_[b];
+    int32 offset = b * minibatch_size,
+        num_chunks = std::min(minibatch_size, num_egs - offset);
+    std::vector<NnetExample> data(examples.begin() + offset,
+                                  examples.begin() + offset + num_chunks);
+    minibatch.num_chunks = num_chunks;
+    for (int32 m = 0; m < num_chunks; m++) {
+      for (size_t i = 0; i < data[m].labels.size(); i++) {
+        MatrixElement<BaseFloat>
+            tmp = {m, data[m].labels[i].first, data[m].labels[i].second};
+        minibatch.labels.push_back(tmp);
+      }
+    }
+    Matrix<BaseFloat> input;
+    FormatNnetInput(nnet, data, &input);
+    minibatch.data.Swap(&input); // Copy to GPU, if being used.
+    for (int32 c = 0; c < num_fixed_; c++) {
+      CuMatrix<BaseFloat> output;
+      nnet.GetComponent(c).Propagate(minibatch.data, num_chunks, &output);
+      minibatch.data.Swap(&output);
+    }
+  }
+  KALDI_VLOG(2) << "Cached the output of the first " << num_fixed_
+                << " components for " << num_egs << " examples in "
+                << minibatches_.size() << " minibatches.";
+}
+
+std::string NnetValidationComputer::FixedComponentsString(
+    const Nnet &nnet) const {
+  std::ostringstream os;
+  for (int32 c = 0; c < num_fixed_; c++)
+    nnet.GetComponent(c).Write(os, true);
+  return os.str();
+}
+
+double NnetValidationComputer::ComputeForMinibatch(const Nnet &nnet,
+                                                   int32 b,
+                                                   Nnet *gradient) const {
+  const Minibatch &minibatch = minibatches_[b];
+  int32 num_components = nnet.NumComponents(),
+      num_chunks = minibatch.num_chunks;
+  // forward_data[c - num_fixed_] is the output of component c.
+  std::vector<CuMatrix<BaseFloat> > forward_data(num_components - num_fixed_);
+  for (int32 c = num_fixed_; c < num_components; c++) {
+    const CuMatrixBase<BaseFloat> &input = (c == num_fixed_ ? minibatch.data :
+                                            forward_data[c - num_fixed_ - 1]);
+    nnet.GetComponent(c).Propagate(input, num_chunks,
+                                   &(forward_data[c - num_fixed_]));
+  }
+  const CuMatrix<BaseFloat> &output = (num_components == num_fixed_ ?
+                                       minibatch.data : forward_data.back());
+  CuMatrix<BaseFloat> deriv(num_chunks, nnet.OutputDim());
+  KALDI_ASSERT(SameDim(output, deriv));
+  BaseFloat tot_objf, tot_weight;
+  deriv.CompObjfAndDeriv(minibatch.labels, output, &tot_objf, &tot_weight);
+  if (gradient == NULL)
+    return tot_objf;
+  for (int32 c = num_components - 1; c >= num_fixed_; c--) {
+    const CuMatrixBase<BaseFloat> &input = (c == num_fixed_ ? minibatch.data :
+                                            forward_data[c - num_fixed_ - 1]);
+    CuMatrix<BaseFloat> input_deriv(input.NumRows(), input.NumCols());
+    nnet.GetComponent(c).Backprop(input, forward_data[c - num_fixed_], deriv,
+                                  num_chunks, &(gradient->GetComponent(c)),
+                                  &input_deriv);
+    input_deriv.Swap(&deriv);
+  }
+  return tot_objf;
+}
+
+/** This class is used by NnetValidationComputer::Compute() to divide the
+    minibatches among threads; like DoBackpropParallelClass, each copy of it
+    sums the gradient separately, and they are added up in the destructors. */
+class NnetValidationClass: public MultiThreadable {
+ public:
+  NnetValidationClass(const NnetValidationComputer &computer,
+                      const Nnet &nnet,
+                      double *tot_objf_ptr,
+                      Nnet *gradient):
+      computer_(computer), nnet_(nnet), tot_objf_ptr_(tot_objf_ptr),
+      tot_objf_(0.0), gradient_ptr_(gradient), gradient_(NULL) { }
+
+  NnetValidationClass(const NnetValidationClass &other):
+      computer_(other.computer_), nnet_(other.nnet_),
+      tot_objf_ptr_(other.tot_objf_ptr_), tot_objf_(0.0),
+      gradient_ptr_(other.gradient_ptr_), gradient_(NULL) {
+    if (gradient_ptr_ != NULL) {
+      gradient_ = new Nnet(*gradient_ptr_);
+      gradient_->SetZero(true);
+    }
+  }
+
+  void operator () () {
+    for (int32 b = thread_id_; b < computer_.NumMinibatches();
+         b += num_threads_)
+      tot_objf_ += computer_.ComputeForMinibatch(nnet_, b, gradient_);
+  }
+
+  ~NnetValidationClass() {
+    *tot_objf_ptr_ += tot_objf_;
+    if (gradient_ != NULL) {
+      gradient_ptr_->AddNnet(1.0, *gradient_);
+      delete gradient_;
+    }
+  }
+ private:
+  const NnetValidationComputer &computer_;
+  const Nnet &nnet_;
+  double *tot_objf_ptr_;
+  double tot_objf_;
+  Nnet *gradient_ptr_;
+  Nnet *gradient_; // Gradient for this thread.
+};
+
+double NnetValidationComputer::Compute(const Nnet &nnet,
+                                       int32 num_threads,
+                                       Nnet *gradient) const {
+  if (num_fixed_ > 0 && FixedComponentsString(nnet) != fixed_components_)
+    KALDI_ERR << "NnetValidationComputer: the neural net does not start with "
+              << "the same fixed components as the one we were initialized with.";
+  if (gradient != NULL)
+    gradient->SetZero(true);
+  double tot_objf = 0.0;
+  if (num_threads <= 1) { // support GPUs: special case for 1 thread.
+    for (int32 b = 0; b < NumMinibatches(); b++)
+      tot_objf += ComputeForMinibatch(nnet, b, gradient);
+  } else {
+    NnetValidationClass c(*this, nnet, &tot_objf, gradient);
+    // The threads are joined, and their gradients summed, in the destructor.
+    MultiThreader<NnetValidationClass> m(num_threads, c);
+  }
+  return tot_objf;
+}
+
   
 } // namespace nnet2
 } // namespace kaldi
@@ -44,12 +44,14 @@ namespace nnet2 {
 /// something like Hogwild; otherwise it assumes we're computing a
 /// gradient and it sums up the gradients.
 /// The return value is the total log-prob summed over the #frames. It also
-/// outputs the #frames into "num_frames".
+/// outputs the #frames into "num_frames".  If "tot_accuracy" is not NULL, it
+/// outputs the weighted number of correctly classified frames into it.
 double DoBackpropParallel(const Nnet &nnet,
                           int32 minibatch_size,
                           SequentialNnetExampleReader *example_reader,
                           double *tot_weight,
-                          Nnet *nnet_to_update);
+                          Nnet *nnet_to_update,
+                          double *tot_accuracy = NULL);
 
 
 /// This version of DoBackpropParallel takes a vector of examples, and will
@@ -78,6 +80,80 @@ inline double ComputeNnetObjfParallel(
                             examples, num_frames, NULL);
 }
 
+/// This version reads the examples from "example_reader" and uses
+/// g_num_threads threads (one, if we are using a GPU).  It returns the total
+/// weighted objective function, and outputs the total weight and the
+/// weighted number of correctly classified frames.
+inline double ComputeNnetObjfParallel(
+    const Nnet &nnet,
+    int32 minibatch_size,
+    SequentialNnetExampleReader *example_reader,
+    double *tot_weight,
+    double *tot_accuracy) {
+  return DoBackpropParallel(nnet, minibatch_size, example_reader,
+                            tot_weight, NULL, tot_accuracy);
+}
+
+
+/**
+   NnetValidationComputer computes the objective function, and optionally the
+   gradient, of many neural nets on the same set of examples, as we do when
+   optimizing the weights with which we combine models on a validation set.
+   The examples are split into minibatches and formatted only once, in the
+   constructor, and are then propagated through the leading components of the
+   network that have no parameters (typically the SpliceComponent and the
+   FixedAffineComponent with the LDA transform).  The nets it is used with
+   must all have the same such components, so their outputs are the same for
+   all of them; we keep them (on the GPU, if one is being used), and every
+   evaluation starts from the first updatable component.
+*/
+class NnetValidationComputer {
+ public:
+  /// Only the leading non-updatable components of "nnet" are used here; the
+  /// nets given to Compute() must have the same ones.
+  NnetValidationComputer(const Nnet &nnet,
+                         const std::vector<NnetExample> &examples,
+                         int32 minibatch_size);
+
+  /// Computes the objective function of "nnet" on the examples and, if
+  /// "gradient" is not NULL, the gradient (like ComputeNnetGradient(), it sets
+  /// *gradient to zero first).  Returns the *total* weighted objective
+  /// function.  The minibatches are divided among "num_threads" threads; if
+  /// you are using a GPU, use one thread.
+  double Compute(const Nnet &nnet,
+                 int32 num_threads,
+                 Nnet *gradient) const;
+
+  /// Does the computation of Compute() for minibatch "b" only, adding to
+  /// "gradient" if it is not NULL.
+  double ComputeForMinibatch(const Nnet &nnet,
+                             int32 b,
+                             Nnet *gradient) const;
+
+  int32 NumMinibatches() const { return minibatches_.size(); }
+
+  /// The total weight of the examples (typically the number of frames).
+  double TotalWeight() const { return tot_weight_; }
+
+ private:
+  struct Minibatch {
+    int32 num_chunks;
+    // The output of the leading non-updatable components.
+    CuMatrix<BaseFloat> data;
+    std::vector<MatrixElement<BaseFloat> > labels;
+  };
+
+  // Returns the first num_fixed_ components of "nnet", written out.
+  std::string FixedComponentsString(const Nnet &nnet) const;
+
+  int32 num_fixed_; // The number of components before the first updatable
+                    // one.
+  std::string fixed_components_; // Used to check that the nets we are given
+                                 // start with the same components.
+  std::vector<Minibatch> minibatches_;
+  double tot_weight_;
+};
+
 
 
 
@@ -19,6 +19,9 @@
 // limitations under the License.
 
 #include "nnet2/nnet-update.h"
+#include "util/kaldi-profile.h"
+#include "thread/kaldi-thread.h"
+#include "cudamatrix/cu-device.h"
 
 namespace kaldi {
 namespace nnet2 {
@@ -26,15 +29,48 @@ namespace nnet2 {
 
 
 NnetUpdater::NnetUpdater(const Nnet &nnet,
-                         Nnet *nnet_to_update):
-    nnet_(nnet), nnet_to_update_(nnet_to_update) {
+                         Nnet *nnet_to_update,
+                         bool keep_workspace,
+                         int32 num_format_threads):
+    nnet_(nnet), nnet_to_update_(nnet_to_update), num_chunks_(0),
+    keep_workspace_(keep_workspace), num_format_threads_(num_format_threads),
+    peak_workspace_bytes_(0) {
 }
  
 
 double NnetUpdater::ComputeForMinibatch(
     const std::vector<NnetExample> &data) {
   FormatInput(data);
+  return PropagateAndBackprop(data);
+}
+
+double NnetUpdater::ComputeForMinibatch(
+    const std::vector<NnetExample> &data,
+    Matrix<BaseFloat> *formatted_data) {
+  KALDI_ASSERT(data.size() > 0);
+  num_chunks_ = data.size();
+  forward_data_.resize(nnet_.NumComponents() + 1);
+  if (keep_workspace_) {
+    // Copy into the existing matrix, so we don't reallocate it.
+    forward_data_[0].Resize(formatted_data->NumRows(),
+                            formatted_data->NumCols(), kUndefined);
+    forward_data_[0].CopyFromMat(*formatted_data);
+  } else {
+    forward_data_[0].Swap(formatted_data); // Copy to GPU, if being used.
+  }
+  return PropagateAndBackprop(data);
+}
+
+double NnetUpdater::PropagateAndBackprop(const std::vector<NnetExample> &data) {
   Propagate();
+  if (keep_workspace_) {
+    backward_data_.resize(nnet_.NumComponents() + 1);
+    double ans = ComputeObjfAndDeriv(data,
+                                     &(backward_data_[nnet_.NumComponents()]));
+    if (nnet_to_update_ != NULL)
+      BackpropWithWorkspace(data);
+    return ans;
+  }
   CuMatrix<BaseFloat> tmp_deriv;
   double ans = ComputeObjfAndDeriv(data, &tmp_deriv);
   if (nnet_to_update_ != NULL)
@@ -49,6 +85,32 @@ void NnetUpdater::GetOutput(CuMatrix<BaseFloat> *output) {
   *output = forward_data_[num_components];
 }
 
+void NnetUpdater::AddOutputSum(CuVector<BaseFloat> *output_sum) const {
+  int32 num_components = nnet_.NumComponents();
+  KALDI_ASSERT(forward_data_.size() == num_components + 1);
+  const CuMatrix<BaseFloat> &output(forward_data_[num_components]);
+  if (output_sum->Dim() == 0) output_sum->Resize(output.NumCols());
+  output_sum->AddRowSumMat(1.0, output);
+}
+
+double NnetUpdater::ComputeTotAccuracy(
+    const std::vector<NnetExample> &data) const {
+  int32 num_components = nnet_.NumComponents();
+  KALDI_ASSERT(forward_data_.size() == num_components + 1);
+  const CuMatrix<BaseFloat> &output(forward_data_[num_components]);
+  KALDI_ASSERT(output.NumRows() == static_cast<int32>(data.size()));
+  CuArray<int32> best_pdf(output.NumRows());
+  output.FindRowMaxId(&best_pdf);
+  std::vector<int32> best_pdf_cpu;
+  best_pdf.CopyToVec(&best_pdf_cpu);
+  double tot_accuracy = 0.0;
+  for (size_t m = 0; m < data.size(); m++)
+    for (size_t i = 0; i < data[m].labels.size(); i++)
+      if (data[m].labels[i].first == best_pdf_cpu[m])
+        tot_accuracy += data[m].labels[i].second;
+  return tot_accuracy;
+}
+
 void NnetUpdater::Propagate() {
   static int32 num_times_printed = 0;
         
@@ -59,7 +121,12 @@ void NnetUpdater::Propagate() {
     CuMatrix<BaseFloat> &output = forward_data_[c+1];
     // Note: the Propagate function will automatically resize the
     // output.
-    component.Propagate(input, num_chunks_, &output);
+    {
+      KALDI_PROFILE_SCOPE_DYNAMIC(
+          component.Type() + "::Propagate",
+          "in=" + ProfileDims(input.NumRows(), input.NumCols()));
+      component.Propagate(input, num_chunks_, &output);
+    }
     // If we won't need the output of the previous layer for
     // backprop, delete it to save memory.
     bool need_last_output =
@@ -72,8 +139,9 @@ void NnetUpdater::Propagate() {
                     (forward_data_[c].NumRows() * forward_data_[c].NumCols()));
       num_times_printed++;
     }
-    if (!need_last_output)
+    if (!need_last_output && !keep_workspace_)
       forward_data_[c].Resize(0, 0); // We won't need this data.
+    UpdatePeakWorkspace();
   }
 }
 
@@ -106,6 +174,12 @@ double NnetUpdater::ComputeObjfAndDeriv(
 
 void NnetUpdater::Backprop(const std::vector<NnetExample> &data,
                            CuMatrix<BaseFloat> *deriv) {
+  if (keep_workspace_) {
+    backward_data_.resize(nnet_.NumComponents() + 1);
+    backward_data_.back().Swap(deriv);
+    BackpropWithWorkspace(data);
+    return;
+  }
   int32 num_chunks = data.size();
   // We assume ComputeObjfAndDeriv has already been called.
   for (int32 c = nnet_.NumComponents() - 1; c >= 0; c--) {
@@ -117,54 +191,145 @@ void NnetUpdater::Backprop(const std::vector<NnetExample> &data,
     CuMatrix<BaseFloat> input_deriv(input.NumRows(), input.NumCols());
     const CuMatrix<BaseFloat> &output_deriv(*deriv);
 
-    component.Backprop(input, output, output_deriv, num_chunks,
-                       component_to_update, &input_deriv);
+    {
+      KALDI_PROFILE_SCOPE_DYNAMIC(
+          component.Type() + "::Backprop",
+          "out_deriv=" + ProfileDims(output_deriv.NumRows(),
+                                     output_deriv.NumCols()));
+      component.Backprop(input, output, output_deriv, num_chunks,
+                         component_to_update, &input_deriv);
+    }
+    UpdatePeakWorkspace((deriv->NumRows() * deriv->NumCols() +
+                         input_deriv.NumRows() * input_deriv.NumCols()) *
+                        sizeof(BaseFloat));
     input_deriv.Swap(deriv);
   }
 }
 
+void NnetUpdater::BackpropWithWorkspace(const std::vector<NnetExample> &data) {
+  int32 num_chunks = data.size();
+  // We assume ComputeObjfAndDeriv has already been called.
+  for (int32 c = nnet_.NumComponents() - 1; c >= 0; c--) {
+    const Component &component = nnet_.GetComponent(c);
+    Component *component_to_update = (nnet_to_update_ == NULL ? NULL :
+                                      &(nnet_to_update_->GetComponent(c)));
+    const CuMatrix<BaseFloat> &input = forward_data_[c],
+        &output = forward_data_[c+1];
+    KALDI_PROFILE_SCOPE_DYNAMIC(
+        component.Type() + "::Backprop",
+        "out_deriv=" + ProfileDims(backward_data_[c+1].NumRows(),
+                                   backward_data_[c+1].NumCols()));
+    if (component.BackpropInPlace()) {
+      // The derivative is computed in place; we then move it to
+      // backward_data_[c], which has the same dimension.
+      component.Backprop(input, output, backward_data_[c+1], num_chunks,
+                         component_to_update, &(backward_data_[c+1]));
+      backward_data_[c].Swap(&(backward_data_[c+1]));
+    } else {
+      component.Backprop(input, output, backward_data_[c+1], num_chunks,
+                         component_to_update, &(backward_data_[c]));
+    }
+  }
+  UpdatePeakWorkspace();
+}
+
+void NnetUpdater::UpdatePeakWorkspace(size_t extra_bytes) {
+  size_t bytes = 0;
+  for (size_t i = 0; i < forward_data_.size(); i++)
+    bytes += forward_data_[i].NumRows() * forward_data_[i].NumCols();
+  for (size_t i = 0; i < backward_data_.size(); i++)
+    bytes += backward_data_[i].NumRows() * backward_data_[i].NumCols();
+  bytes = bytes * sizeof(BaseFloat) + extra_bytes;
+  peak_workspace_bytes_ = std::max(peak_workspace_bytes_, bytes);
+}
+
 
 void NnetUpdater::FormatInput(const std::vector<NnetExample> &data) {
+  num_chunks_ = data.size();
+  forward_data_.resize(nnet_.NumComponents() + 1);
+  // First format as a single matrix on the CPU, so we can copy to
+  // GPU with a single copy command.
+  FormatNnetInput(nnet_, data, &formatted_input_, num_format_threads_);
+#if HAVE_CUDA == 1
+  // The uploader's page-locked buffers are only worth allocating if this
+  // object is used for many minibatches.
+  if (keep_workspace_ && CuDevice::Instantiate().Enabled()) {
+    uploader_.Upload(formatted_input_, &(forward_data_[0]));
+    return;
+  }
+#endif
+  // Without a GPU, just swap; formatted_input_ gets the previous input
+  // matrix, which will normally have the right size next time.
+  forward_data_[0].Swap(&formatted_input_);
+}
+
+void NnetUpdater::CopyInput(int32 num_chunks,
+                            const CuMatrixBase<BaseFloat> &input) {
+  num_chunks_ = num_chunks;
+  forward_data_.resize(nnet_.NumComponents() + 1);
+  forward_data_[0].Resize(input.NumRows(), input.NumCols(), kUndefined);
+  forward_data_[0].CopyFromMat(input);
+}
+
+// This class is used with RunParallelFor() in FormatNnetInput(); it formats
+// the input of a range of examples.
+class FormatNnetInputClass {
+ public:
+  FormatNnetInputClass(const std::vector<NnetExample> &data,
+                       int32 num_splice, int32 ignore_frames,
+                       Matrix<BaseFloat> *input_mat):
+      data_(&data), num_splice_(num_splice), ignore_frames_(ignore_frames),
+      input_mat_(input_mat) { }
+  void operator () (int32 begin, int32 end) {
+    int32 feat_dim = (*data_)[0].input_frames.NumCols(),
+        spk_dim = (*data_)[0].spk_info.Dim();
+    for (int32 chunk = begin; chunk < end; chunk++) {
+      SubMatrix<BaseFloat> dest(*input_mat_,
+                                chunk * num_splice_, num_splice_,
+                                0, feat_dim);
+      // Uncompress just the frames we need, straight into place.
+      (*data_)[chunk].input_frames.CopyToMat(ignore_frames_, 0, &dest);
+      if (spk_dim != 0) {
+        SubMatrix<BaseFloat> spk_dest(*input_mat_,
+                                      chunk * num_splice_, num_splice_,
+                                      feat_dim, spk_dim);
+        spk_dest.CopyRowsFromVec((*data_)[chunk].spk_info);
+      }
+    }
+  }
+ private:
+  const std::vector<NnetExample> *data_;
+  int32 num_splice_;
+  int32 ignore_frames_;
+  Matrix<BaseFloat> *input_mat_;
+};
+
+void FormatNnetInput(const Nnet &nnet,
+                     const std::vector<NnetExample> &data,
+                     Matrix<BaseFloat> *input_mat,
+                     int32 num_threads) {
   KALDI_ASSERT(data.size() > 0);
-  int32 num_splice = nnet_.LeftContext() + 1 + nnet_.RightContext();
+  int32 num_splice = nnet.LeftContext() + 1 + nnet.RightContext();
   KALDI_ASSERT(data[0].input_frames.NumRows() >= num_splice);
   
   int32 feat_dim = data[0].input_frames.NumCols(),
          spk_dim = data[0].spk_info.Dim(),
          tot_dim = feat_dim + spk_dim; // we append these at the neural net
                                        // input... note, spk_dim might be 0.
-  KALDI_ASSERT(tot_dim == nnet_.InputDim());
-  KALDI_ASSERT(data[0].left_context >= nnet_.LeftContext());
-  int32 ignore_frames = data[0].left_context - nnet_.LeftContext(); // If
+  KALDI_ASSERT(tot_dim == nnet.InputDim());
+  KALDI_ASSERT(data[0].left_context >= nnet.LeftContext());
+  int32 ignore_frames = data[0].left_context - nnet.LeftContext(); // If
   // the NnetExample has more left-context than we need, ignore some.
   // this may happen in settings where we increase the amount of context during
   // training, e.g. by adding layers that require more context.
-  num_chunks_ = data.size();
+  int32 num_chunks = data.size();
   
-  forward_data_.resize(nnet_.NumComponents() + 1);
+  if (input_mat->NumRows() != num_splice * num_chunks ||
+      input_mat->NumCols() != tot_dim)
+    input_mat->Resize(num_splice * num_chunks, tot_dim, kUndefined);
 
-  // First copy to a single matrix on the CPU, so we can copy to
-  // GPU with a single copy command.
-  Matrix<BaseFloat> temp_forward_data(num_splice * num_chunks_,
-                                      tot_dim);
-  
-  for (int32 chunk = 0; chunk < num_chunks_; chunk++) {
-    SubMatrix<BaseFloat> dest(temp_forward_data,
-                              chunk * num_splice, num_splice,
-                              0, feat_dim);
-
-    Matrix<BaseFloat> full_src(data[chunk].input_frames);
-    SubMatrix<BaseFloat> src(full_src, ignore_frames, num_splice, 0, feat_dim);
-                             
-    dest.CopyFromMat(src);
-    if (spk_dim != 0) {
-      SubMatrix<BaseFloat> spk_dest(temp_forward_data,
-                                    chunk * num_splice, num_splice,
-                                    feat_dim, spk_dim);
-      spk_dest.CopyRowsFromVec(data[chunk].spk_info);
-    }
-  }
-  forward_data_[0].Swap(&temp_forward_data); // Copy to GPU, if being used.
+  FormatNnetInputClass c(data, num_splice, ignore_frames, input_mat);
+  RunParallelFor(0, num_chunks, c, num_threads);
 }
 
 BaseFloat TotalNnetTrainingWeight(const std::vector<NnetExample> &egs) {
@@ -196,6 +361,19 @@ double DoBackprop(const Nnet &nnet,
   }
 }
 
+double DoBackprop(const Nnet &nnet,
+                  const std::vector<NnetExample> &examples,
+                  Matrix<BaseFloat> *examples_formatted,
+                  Nnet *nnet_to_update) {
+  try {
+    NnetUpdater updater(nnet, nnet_to_update);
+    return updater.ComputeForMinibatch(examples, examples_formatted);
+  } catch (...) {
+    KALDI_LOG << "Error doing backprop, nnet info is: " << nnet.Info();
+    throw;
+  }
+}
+
 double ComputeNnetGradient(
     const Nnet &nnet,
     const std::vector<NnetExample> &validation_set,
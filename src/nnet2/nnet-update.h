@@ -24,6 +24,7 @@
 #include "nnet2/nnet-nnet.h"
 #include "nnet2/nnet-example.h"
 #include "util/table-types.h"
+#include "cudamatrix/cu-matrix-uploader.h"
 
 
 namespace kaldi {
@@ -44,6 +45,10 @@ namespace nnet2 {
 // define it in the header file becaused it's needed by the ensemble training.
 // But in normal cases its functionality should be used by calling DoBackprop(),
 // and by ComputeNnetObjf()
+// An NnetUpdater may be used for many minibatches; if keep_workspace == true,
+// the matrices for the forward and backward passes are kept between
+// minibatches so that they are not reallocated each time (this uses more
+// memory, since nothing is freed during the computation).
 class NnetEnsembleTrainer;
 class NnetUpdater {
  public:
@@ -51,23 +56,60 @@ class NnetUpdater {
   // be identical.  They'll be different if we're accumulating the gradient
   // for a held-out set and don't want to update the model.  Note: nnet_to_update
   // may be NULL if you don't want do do backprop.
+  // num_format_threads is the number of threads FormatInput() uses to
+  // uncompress the examples (see FormatNnetInput()).
   NnetUpdater(const Nnet &nnet,
-              Nnet *nnet_to_update);
+              Nnet *nnet_to_update,
+              bool keep_workspace = false,
+              int32 num_format_threads = 1);
   
   double ComputeForMinibatch(const std::vector<NnetExample> &data);
   // returns average objective function over this minibatch.
+
+  /// This version takes the input already formatted by FormatNnetInput(); it
+  /// swaps it into our workspace, so "formatted_data" is emptied (unless
+  /// keep_workspace == true, in which case it is copied).
+  double ComputeForMinibatch(const std::vector<NnetExample> &data,
+                             Matrix<BaseFloat> *formatted_data);
   
   void GetOutput(CuMatrix<BaseFloat> *output);
+
+  /// Adds the output of the nnet for the last minibatch, summed over the
+  /// examples, to *output_sum (resizing it if empty); call this after
+  /// ComputeForMinibatch().  The sum stays on the device.
+  void AddOutputSum(CuVector<BaseFloat> *output_sum) const;
+
+  /// Returns the weighted number of labels in "data" that equal the
+  /// most likely output of the nnet (i.e. the number of correctly
+  /// classified frames); call this after ComputeForMinibatch(data).
+  double ComputeTotAccuracy(const std::vector<NnetExample> &data) const;
+
+  /// Returns the largest number of bytes that the forward and backward
+  /// matrices have occupied at any one time so far (not counting padding
+  /// on the GPU).  Useful for choosing the minibatch size.
+  size_t PeakWorkspaceBytes() const { return peak_workspace_bytes_; }
  protected:
 
   /// takes the input and formats as a single matrix, in forward_data_[0].
+  /// With a GPU and keep_workspace_ == true, the matrix is formatted in
+  /// formatted_input_ and copied to the device asynchronously by uploader_,
+  /// so the copy overlaps with whatever the GPU is still doing for the
+  /// previous minibatch.
   void FormatInput(const std::vector<NnetExample> &data);
+
+  /// Copies "input", already formatted by FormatNnetInput(), into
+  /// forward_data_[0]; num_chunks is the number of examples.
+  void CopyInput(int32 num_chunks, const CuMatrixBase<BaseFloat> &input);
   
   // Possibly splices input together from forward_data_[component].
   //   MatrixBase<BaseFloat> &GetSplicedInput(int32 component, Matrix<BaseFloat> *temp_matrix);
 
   void Propagate();
 
+  /// Does Propagate(), ComputeObjfAndDeriv() and (if nnet_to_update_ != NULL)
+  /// the backprop, once forward_data_[0] is set up; returns the objf.
+  double PropagateAndBackprop(const std::vector<NnetExample> &data);
+
   /// Computes objective function and derivative at output layer.
   double ComputeObjfAndDeriv(const std::vector<NnetExample> &data,
                              CuMatrix<BaseFloat> *deriv) const;
@@ -79,15 +121,36 @@ class NnetUpdater {
   void Backprop(const std::vector<NnetExample> &data,
                 CuMatrix<BaseFloat> *deriv);
 
+  /// Backprop using backward_data_[NumComponents()] as the derivative at the
+  /// output; used when keep_workspace_ == true.
+  void BackpropWithWorkspace(const std::vector<NnetExample> &data);
+
+  /// Updates peak_workspace_bytes_ from the current sizes of forward_data_
+  /// and backward_data_, plus "extra_bytes" for other temporaries.
+  void UpdatePeakWorkspace(size_t extra_bytes = 0);
+
   friend class NnetEnsembleTrainer;
  private:
   const Nnet &nnet_;
   Nnet *nnet_to_update_;
   int32 num_chunks_; // same as the minibatch size.
+  bool keep_workspace_;
+  int32 num_format_threads_;
+
+  // The input formatted on the host, kept between minibatches so that it is
+  // not reallocated each time.
+  Matrix<BaseFloat> formatted_input_;
+  CuMatrixUploader<BaseFloat> uploader_;
   
   std::vector<CuMatrix<BaseFloat> > forward_data_; // The forward data
   // for the outputs of each of the components.
 
+  // The derivatives w.r.t. the input of each component (the last one is the
+  // derivative w.r.t. the output of the nnet); only used if keep_workspace_.
+  std::vector<CuMatrix<BaseFloat> > backward_data_;
+
+  size_t peak_workspace_bytes_;
+
   // These weights are one per parameter; they equal to the "weight"
   // member variables in the NnetExample structures.  These
   // will typically be about one on average.
@@ -106,6 +169,28 @@ double DoBackprop(const Nnet &nnet,
                   const std::vector<NnetExample> &examples,
                   Nnet *nnet_to_update);
 
+/// This version of DoBackprop takes the input to the network already formatted
+/// by FormatNnetInput(), so that the formatting can be done elsewhere (e.g. in
+/// another thread).  "examples_formatted" will be emptied.
+double DoBackprop(const Nnet &nnet,
+                  const std::vector<NnetExample> &examples,
+                  Matrix<BaseFloat> *examples_formatted,
+                  Nnet *nnet_to_update);
+
+/// Formats the input of the examples "data" as the single matrix that is the
+/// input to the first component of "nnet": num_splice rows for each example,
+/// where num_splice = nnet.LeftContext() + 1 + nnet.RightContext(), with the
+/// speaker information (if any) appended to each row.  Each example's
+/// (possibly compressed) frames are uncompressed straight into place; with
+/// num_threads > 1, the examples are divided among that many threads, which
+/// is worthwhile for big minibatches of compressed examples with a lot of
+/// context.  If *input_mat already has the right size it is not
+/// reallocated.
+void FormatNnetInput(const Nnet &nnet,
+                     const std::vector<NnetExample> &data,
+                     Matrix<BaseFloat> *input_mat,
+                     int32 num_threads = 1);
+
 /// Returns the total weight summed over all the examples... just a simple
 /// utility function.
 BaseFloat TotalNnetTrainingWeight(const std::vector<NnetExample> &egs);
@@ -19,6 +19,8 @@
 // limitations under the License.
 
 #include "nnet2/train-nnet-ensemble.h"
+#include "thread/kaldi-thread.h"
+#include "util/stl-utils.h"
 #include <numeric> // for std::accumulate
 
 namespace kaldi {
@@ -39,6 +41,12 @@ NnetEnsembleTrainer::NnetEnsembleTrainer(
   num_phases_ = 0;
   bool first_time = true;
   BeginNewPhase(first_time);
+  // The updaters keep their matrices from one minibatch to the next.
+  for (size_t i = 0; i < nnet_ensemble_.size(); i++)
+    updater_ensemble_.push_back(new NnetUpdater(*(nnet_ensemble_[i]),
+                                                nnet_ensemble_[i], true));
+  post_mat_.resize(nnet_ensemble_.size());
+  log_prob_.resize(nnet_ensemble_.size());
 }
 
 void NnetEnsembleTrainer::TrainOnExample(const NnetExample &value) {
@@ -47,56 +55,101 @@ void NnetEnsembleTrainer::TrainOnExample(const NnetExample &value) {
     TrainOneMinibatch();
 }
 
+void NnetEnsembleTrainer::ProcessNnets(int32 thread_id, int32 num_threads,
+                                       bool backprop) {
+  for (size_t i = thread_id; i < nnet_ensemble_.size(); i += num_threads) {
+    NnetUpdater *updater = updater_ensemble_[i];
+    if (!backprop) {
+      updater->CopyInput(buffer_.size(), input_);
+      updater->Propagate();
+      // posterior matrix, storing output of one net.
+      updater->GetOutput(&(post_mat_[i]));
+    } else {
+      CuMatrix<BaseFloat> tmp_deriv(post_mat_[i]);
+      post_mat_[i].ApplyLog();
+      std::vector<BaseFloat> log_post_correct;
+      post_mat_[i].Lookup(sv_labels_ind_, &log_post_correct);
+      log_prob_[i] = std::accumulate(log_post_correct.begin(),
+                                     log_post_correct.end(),
+                                     static_cast<BaseFloat>(0));
+      tmp_deriv.InvertElements();
+      tmp_deriv.MulElements(post_avg_);
+      updater->Backprop(buffer_, &tmp_deriv);
+    }
+  }
+}
+
+void *NnetEnsembleTrainer::RunThreadTask(void *task_in) {
+  ThreadTask *task = static_cast<ThreadTask*>(task_in);
+  task->trainer->ProcessNnets(task->thread_id, task->num_threads,
+                              task->backprop);
+  return NULL;
+}
+
+void NnetEnsembleTrainer::ProcessAllNnets(bool backprop) {
+  int32 num_threads = std::min<int32>(config_.num_threads,
+                                      nnet_ensemble_.size());
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled())
+    num_threads = 1;  // Our GPU code won't work with multithreading.
+#endif
+  if (num_threads <= 1) {
+    ProcessNnets(0, 1, backprop);
+    return;
+  }
+  std::vector<ThreadTask> tasks(num_threads);
+  ThreadGroup group;
+  for (int32 t = 0; t < num_threads; t++) {
+    tasks[t].trainer = this;
+    tasks[t].thread_id = t;
+    tasks[t].num_threads = num_threads;
+    tasks[t].backprop = backprop;
+    MultiThreadPool::Instantiate().Run(RunThreadTask, &(tasks[t]), &group);
+  }
+  group.Wait();
+}
+
 void NnetEnsembleTrainer::TrainOneMinibatch() {
   KALDI_ASSERT(!buffer_.empty());
   
+  // Format the input once, and copy it to the GPU once, for all the nets.
+  {
+    Matrix<BaseFloat> input;
+    FormatNnetInput(*(nnet_ensemble_[0]), buffer_, &input);
+    input_.Resize(input.NumRows(), input.NumCols(), kUndefined);
+    input_.CopyFromMat(input);
+  }
+  ProcessAllNnets(false);
+
   int32 num_states = nnet_ensemble_[0]->GetComponent(nnet_ensemble_[0]->NumComponents() - 1).OutputDim();
   // average of posteriors matrix, storing averaged outputs of net ensemble.
-  CuMatrix<BaseFloat> post_avg(buffer_.size(), num_states);
-  updater_ensemble_.reserve(nnet_ensemble_.size());
-  std::vector<CuMatrix<BaseFloat> > post_mat;
-  post_mat.resize(nnet_ensemble_.size());
-  for (int32 i = 0; i < nnet_ensemble_.size(); i++) {
-    updater_ensemble_.push_back(new NnetUpdater(*(nnet_ensemble_[i]), nnet_ensemble_[i]));
-    updater_ensemble_[i]->FormatInput(buffer_);
-    updater_ensemble_[i]->Propagate();
-    // posterior matrix, storing output of one net.
-    updater_ensemble_[i]->GetOutput(&post_mat[i]);
-    CuVector<BaseFloat> row_sum(post_mat[i].NumRows());
-    post_avg.AddMat(1.0, post_mat[i]);
-  }
+  post_avg_.Resize(buffer_.size(), num_states);
+  for (size_t i = 0; i < nnet_ensemble_.size(); i++)
+    post_avg_.AddMat(1.0, post_mat_[i]);
 
   // calculate the interpolated posterios as new supervision labels, and also 
   // collect the indices of the original supervision labels for later use (calc. objf.).
   std::vector<MatrixElement<BaseFloat> > sv_labels;
-  std::vector<Int32Pair > sv_labels_ind;
   sv_labels.reserve(buffer_.size()); // We must have at least this many labels.
-  sv_labels_ind.reserve(buffer_.size()); // We must have at least this many labels.
+  sv_labels_ind_.clear();
+  sv_labels_ind_.reserve(buffer_.size()); // We must have at least this many labels.
   for (int32 m = 0; m < buffer_.size(); m++) {
     for (size_t i = 0; i < buffer_[m].labels.size(); i++) {
       MatrixElement<BaseFloat> 
          tmp = {m, buffer_[m].labels[i].first, buffer_[m].labels[i].second};
       sv_labels.push_back(tmp);
-      sv_labels_ind.push_back(MakePair(m, buffer_[m].labels[i].first));
+      sv_labels_ind_.push_back(MakePair(m, buffer_[m].labels[i].first));
     }
   }
-  post_avg.Scale(1.0 / nnet_ensemble_.size());
-  post_avg.Scale(beta_);
-  post_avg.AddElements(1.0, sv_labels);
+  post_avg_.Scale(1.0 / nnet_ensemble_.size());
+  post_avg_.Scale(beta_);
+  post_avg_.AddElements(1.0, sv_labels);
 
   // calculate the deriv, do backprop, and calculate the objf.
-  for (int32 i = 0; i < nnet_ensemble_.size(); i++) {  
-    CuMatrix<BaseFloat> tmp_deriv(post_mat[i]);
-    post_mat[i].ApplyLog();
-    std::vector<BaseFloat> log_post_correct;
-    post_mat[i].Lookup(sv_labels_ind, &log_post_correct);
-    BaseFloat log_prob_this_net = std::accumulate(log_post_correct.begin(), log_post_correct.end(), static_cast<BaseFloat>(0));
-    
-    avg_logprob_this_phase_ += log_prob_this_net;
-    tmp_deriv.InvertElements();
-    tmp_deriv.MulElements(post_avg);
-    updater_ensemble_[i]->Backprop(buffer_, &tmp_deriv);
-  }
+  ProcessAllNnets(true);
+  for (size_t i = 0; i < nnet_ensemble_.size(); i++)
+    avg_logprob_this_phase_ += log_prob_[i];
+
   count_this_phase_ += buffer_.size();
   buffer_.clear();
   minibatches_seen_this_phase_++;
@@ -129,6 +182,7 @@ NnetEnsembleTrainer::~NnetEnsembleTrainer() {
       BeginNewPhase(first_time);
     }
   }
+  DeletePointers(&updater_ensemble_);
 }
 
 
@@ -33,10 +33,12 @@ struct NnetEnsembleTrainerConfig {
   int32 minibatch_size;
   int32 minibatches_per_phase;
   double beta;
+  int32 num_threads;
 
   NnetEnsembleTrainerConfig(): minibatch_size(500),
                              minibatches_per_phase(50),
-                             beta(0.5) { }
+                             beta(0.5),
+                             num_threads(1) { }
   
   void Register (OptionsItf *po) {
     po->Register("minibatch-size", &minibatch_size,
@@ -47,6 +49,9 @@ struct NnetEnsembleTrainerConfig {
     po->Register("beta", &beta, 
                  "weight of the second term in the objf, which is the cross-entropy "
                  "between the output posteriors and the averaged posteriors from other nets.");
+    po->Register("num-threads", &num_threads,
+                 "Number of threads with which to train the nets of the "
+                 "ensemble in parallel (ignored if we are using a GPU).");
   }  
 };
 
@@ -60,6 +65,10 @@ struct NnetEnsembleTrainerConfig {
 // net's output posteriors and the averaged posteriors of 
 // the whole nnet ensemble. We also calculate the derivs and 
 // then call Backprop() to update each net separately.
+// The input of each minibatch is formatted (and copied to the GPU, if we are
+// using one) only once for all the nets.  On the CPU, the nets' forward and
+// backward passes can be run in parallel with --num-threads; the only
+// synchronization between them is the averaging of the posteriors.
 
 class NnetEnsembleTrainer {
  public:
@@ -75,6 +84,22 @@ class NnetEnsembleTrainer {
   KALDI_DISALLOW_COPY_AND_ASSIGN(NnetEnsembleTrainer);
   
   void TrainOneMinibatch();
+
+  // Does the forward pass of the nets numbered thread_id, thread_id +
+  // num_threads, and so on; or, if "backprop" is true, the backward pass.
+  void ProcessNnets(int32 thread_id, int32 num_threads, bool backprop);
+
+  // Calls ProcessNnets() for all the nets, in parallel if config_.num_threads
+  // > 1 and we are not using a GPU.
+  void ProcessAllNnets(bool backprop);
+
+  struct ThreadTask {
+    NnetEnsembleTrainer *trainer;
+    int32 thread_id;
+    int32 num_threads;
+    bool backprop;
+  };
+  static void *RunThreadTask(void *task);
   
   // The following function is called by TrainOneMinibatch()
   // when we enter a new phase.
@@ -91,6 +116,13 @@ class NnetEnsembleTrainer {
   int32 minibatches_seen_this_phase_;
   std::vector<NnetExample> buffer_; 
 
+  // Temporaries for TrainOneMinibatch().
+  CuMatrix<BaseFloat> input_;  // The formatted input, shared by all the nets.
+  std::vector<CuMatrix<BaseFloat> > post_mat_;  // The output of each net.
+  CuMatrix<BaseFloat> post_avg_;  // The interpolated average posteriors.
+  std::vector<Int32Pair> sv_labels_ind_;  // (frame, label) of each label.
+  std::vector<double> log_prob_;  // Log-prob of the labels, for each net.
+
   // ratio of the supervision, when interpolating the supervision with the averaged posteriors. 
   double beta_;
   double avg_logprob_this_phase_; // Needed for accumulating train log-prob on each phase.
@@ -25,8 +25,10 @@ namespace nnet2 {
 
 NnetSimpleTrainer::NnetSimpleTrainer(
     const NnetSimpleTrainerConfig &config,
-    Nnet *nnet):
-    config_(config), nnet_(nnet) {
+    Nnet *nnet,
+    Vector<double> *output_sum):
+    config_(config), nnet_(nnet), updater_(*nnet, nnet, true, config.num_format_threads),
+    output_sum_(output_sum) {
   num_phases_ = 0;
   bool first_time = true;
   BeginNewPhase(first_time);
@@ -40,10 +42,14 @@ void NnetSimpleTrainer::TrainOnExample(const NnetExample &value) {
 
 void NnetSimpleTrainer::TrainOneMinibatch() {
   KALDI_ASSERT(!buffer_.empty());
-  // The following function is declared in nnet-update.h.
-  logprob_this_phase_ += DoBackprop(*nnet_,
-                                    buffer_,
-                                    nnet_);
+  try {
+    logprob_this_phase_ += updater_.ComputeForMinibatch(buffer_);
+    if (output_sum_ != NULL)
+      updater_.AddOutputSum(&device_output_sum_);
+  } catch (...) {
+    KALDI_LOG << "Error doing backprop, nnet info is: " << nnet_->Info();
+    throw;
+  }
   count_this_phase_ += buffer_.size();
   buffer_.clear();
   minibatches_seen_this_phase_++;
@@ -62,6 +68,15 @@ void NnetSimpleTrainer::BeginNewPhase(bool first_time) {
   count_this_phase_ = 0.0;
   minibatches_seen_this_phase_ = 0;
   num_phases_++;
+  FlushOutputSum();
+}
+
+void NnetSimpleTrainer::FlushOutputSum() {
+  if (output_sum_ == NULL || device_output_sum_.Dim() == 0) return;
+  Vector<double> sum(device_output_sum_);
+  if (output_sum_->Dim() == 0) output_sum_->Resize(sum.Dim());
+  output_sum_->AddVec(1.0, sum);
+  device_output_sum_.SetZero();
 }
 
 
@@ -75,6 +90,10 @@ NnetSimpleTrainer::~NnetSimpleTrainer() {
       BeginNewPhase(first_time);
     }
   }
+  FlushOutputSum();
+  KALDI_VLOG(1) << "Peak memory used by the forward and backward computation "
+                << "was " << (updater_.PeakWorkspaceBytes() / 1.0e+06)
+                << " MB.";
 }
 
 
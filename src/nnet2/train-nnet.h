@@ -31,9 +31,11 @@ namespace nnet2 {
 struct NnetSimpleTrainerConfig {
   int32 minibatch_size;
   int32 minibatches_per_phase;
+  int32 num_format_threads;
   
   NnetSimpleTrainerConfig(): minibatch_size(500),
-                             minibatches_per_phase(50) { }
+                             minibatches_per_phase(50),
+                             num_format_threads(1) { }
   
   void Register (OptionsItf *po) {
     po->Register("minibatch-size", &minibatch_size,
@@ -41,6 +43,9 @@ struct NnetSimpleTrainerConfig {
     po->Register("minibatches-per-phase", &minibatches_per_phase,
                  "Number of minibatches to wait before printing training-set "
                  "objective.");
+    po->Register("num-format-threads", &num_format_threads,
+                 "Number of threads used to uncompress each minibatch of "
+                 "examples before it is copied to the GPU.");
   }  
 };
 
@@ -53,8 +58,14 @@ struct NnetSimpleTrainerConfig {
 // "TrainOnExample()".
 class NnetSimpleTrainer {
  public:
+  /// If "output_sum" is not NULL, the outputs of the nnet on the training
+  /// examples (the posteriors of the pdfs), as computed in the forward pass of
+  /// training, are summed over the examples and added to it, at the latest in
+  /// the destructor.  This gives the priors for decoding (see
+  /// nnet-adjust-priors) without another pass over the data.
   NnetSimpleTrainer(const NnetSimpleTrainerConfig &config,
-                    Nnet *nnet);
+                    Nnet *nnet,
+                    Vector<double> *output_sum = NULL);
   
   /// TrainOnExample will take the example and add it to a buffer;
   /// if we've reached the minibatch size it will do the training.
@@ -69,12 +80,18 @@ class NnetSimpleTrainer {
   // The following function is called by TrainOneMinibatch()
   // when we enter a new phase.
   void BeginNewPhase(bool first_time);
+
+  // Adds device_output_sum_ to *output_sum_ and zeroes it.
+  void FlushOutputSum();
   
   // Things we were given in the initializer:
   NnetSimpleTrainerConfig config_;
 
   Nnet *nnet_; // the nnet we're training.
 
+  // Does the computation; it keeps its matrices between minibatches.
+  NnetUpdater updater_;
+
   // State information:
   int32 num_phases_;
   int32 minibatches_seen_this_phase_;
@@ -82,6 +99,12 @@ class NnetSimpleTrainer {
 
   double logprob_this_phase_; // Needed for accumulating train log-prob on each phase.
   double count_this_phase_; // count corresponding to the above.
+
+  Vector<double> *output_sum_;  // may be NULL.
+  // The sum of the outputs since the last FlushOutputSum(), kept on the device
+  // and added to *output_sum_ once per phase (in double precision, so the
+  // total stays accurate).
+  CuVector<BaseFloat> device_output_sum_;
 };
 
 
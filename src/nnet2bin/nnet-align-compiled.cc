@@ -28,6 +28,7 @@
 #include "decoder/training-graph-compiler.h"
 #include "nnet2/decodable-am-nnet.h"
 #include "lat/kaldi-lattice.h"
+#include "thread/kaldi-task-sequence.h"
 
 int main(int argc, char *argv[]) {
   try {
@@ -45,40 +46,35 @@ int main(int argc, char *argv[]) {
         " nnet-align-compiled 1.mdl ark:graphs.fsts scp:train.scp ark:1.ali\n"
         "or:\n"
         " compile-train-graphs tree 1.mdl lex.fst ark:train.tra b, ark:- | \\\n"
-        "   nnet-align-compiled 1.mdl ark:- scp:train.scp t, ark:1.ali\n";
+        "   nnet-align-compiled 1.mdl ark:- scp:train.scp t, ark:1.ali\n"
+        "With --num-threads=N, the decoding is done in N threads (the neural\n"
+        "net is still computed in the main thread).\n";
 
     ParseOptions po(usage);
     std::string use_gpu = "yes";
-    BaseFloat beam = 200.0;
-    BaseFloat retry_beam = 0.0;
+    AlignConfig align_config;
     BaseFloat acoustic_scale = 1.0;
-    BaseFloat transition_scale = 1.0;
-    BaseFloat self_loop_scale = 1.0;
-
-    po.Register("beam", &beam, "Decoding beam");
-    po.Register("retry-beam", &retry_beam,
-                "Decoding beam for second try at alignment");
-    po.Register("transition-scale", &transition_scale,
-                "Transition-probability scale [relative to acoustics]");
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
+
+    align_config.Register(&po);
     po.Register("acoustic-scale", &acoustic_scale,
                 "Scaling factor for acoustic likelihoods");
-    po.Register("self-loop-scale", &self_loop_scale,
-                "Scale of self-loop versus non-self-loop "
-                "log probs [relative to acoustics]");
     po.Register("use-gpu", &use_gpu,
                 "yes|no|optional, only has effect if compiled with CUDA");     
+    sequencer_config.Register(&po);
     po.Read(argc, argv);
 
     if (po.NumArgs() < 4 || po.NumArgs() > 5) {
       po.PrintUsage();
       exit(1);
     }
-    if (retry_beam != 0 && retry_beam <= beam)
-      KALDI_WARN << "Beams do not make sense: beam " << beam
-                 << ", retry-beam " << retry_beam;
+    if (align_config.retry_beam != 0 &&
+        align_config.retry_beam <= align_config.beam)
+      KALDI_WARN << "Beams do not make sense: beam " << align_config.beam
+                 << ", retry-beam " << align_config.retry_beam;
     
     FasterDecoderOptions decode_opts;
-    decode_opts.beam = beam;  // Don't set the other options.
+    decode_opts.beam = align_config.beam;  // Don't set the other options.
 
 #if HAVE_CUDA==1
     CuDevice::Instantiate().SelectGpuId(use_gpu);
@@ -91,8 +87,8 @@ int main(int argc, char *argv[]) {
         scores_wspecifier = po.GetOptArg(5);
 
 
-    int num_success = 0, num_no_feat = 0, num_other_error = 0;
-    BaseFloat tot_like = 0.0;
+    int num_success = 0, num_no_feat = 0, num_other_error = 0, num_retry = 0;
+    double tot_like = 0.0;
     kaldi::int64 frame_count = 0;
 
     {
@@ -110,90 +106,55 @@ int main(int argc, char *argv[]) {
       Int32VectorWriter alignment_writer(alignment_wspecifier);
       BaseFloatWriter scores_writer(scores_wspecifier);
 
-      for (; !fst_reader.Done(); fst_reader.Next()) {
-        std::string key = fst_reader.Key();
-        if (!feature_reader.HasKey(key)) {
-          num_no_feat++;
-          KALDI_WARN << "No features for utterance " << key;
-        } else {
+      // The decoders are reused from one utterance to the next.
+      FasterDecoderPool decoder_pool(decode_opts);
+      {
+        TaskSequencer<AlignUtteranceClass> sequencer(sequencer_config);
+        for (; !fst_reader.Done(); fst_reader.Next()) {
+          std::string key = fst_reader.Key();
+          if (!feature_reader.HasKey(key)) {
+            num_no_feat++;
+            KALDI_WARN << "No features for utterance " << key;
+            continue;
+          }
           const CuMatrix<BaseFloat> &features = feature_reader.Value(key);
-          VectorFst<StdArc> decode_fst(fst_reader.Value());
-          fst_reader.FreeCurrent();  // this stops copy-on-write of the fst
-          // by deleting the fst inside the reader, since we're about to mutate
-          // the fst by adding transition probs.
-
           if (features.NumRows() == 0) {
             KALDI_WARN << "Zero-length utterance: " << key;
             num_other_error++;
             continue;
           }
-          if (decode_fst.Start() == fst::kNoStateId) {
+          VectorFst<StdArc> *decode_fst =
+              new VectorFst<StdArc>(fst_reader.Value());
+          fst_reader.FreeCurrent();  // this stops copy-on-write of the fst
+          // by deleting the fst inside the reader, since we're about to mutate
+          // the fst by adding transition probs.
+          if (decode_fst->Start() == fst::kNoStateId) {
             KALDI_WARN << "Empty decoding graph for " << key;
             num_other_error++;
+            delete decode_fst;
             continue;
           }
 
-          {  // Add transition-probs to the FST.
-            std::vector<int32> disambig_syms;  // empty.
-            AddTransitionProbs(trans_model, disambig_syms,
-                               transition_scale, self_loop_scale,
-                               &decode_fst);
-          }
-
-          // SimpleDecoder decoder(decode_fst, beam);
-          FasterDecoder decoder(decode_fst, decode_opts);
-          // makes it a bit faster: 37 sec -> 26 sec on 1000 RM utterances @ beam 200.
-
+          // The neural net is computed here, in the main thread (which is
+          // the one that may use the GPU); only the decoding is done in the
+          // threads.
           CuVector<BaseFloat> empty_spk_info; // TODO: add support for speaker vectors.
           bool pad_input = true;
-          DecodableAmNnet nnet_decodable(trans_model, am_nnet, features, empty_spk_info,
-                                         pad_input, acoustic_scale);
-          decoder.Decode(&nnet_decodable);
-
-          VectorFst<LatticeArc> decoded;  // linear FST.
-          bool ans = decoder.ReachedFinal() // consider only final states.
-              && decoder.GetBestPath(&decoded);  
-          if (!ans && retry_beam != 0.0) {
-            KALDI_WARN << "Retrying utterance " << key << " with beam " << retry_beam;
-            decode_opts.beam = retry_beam;
-            decoder.SetOptions(decode_opts);
-            decoder.Decode(&nnet_decodable);
-            ans = decoder.ReachedFinal() // consider only final states.
-                && decoder.GetBestPath(&decoded);  
-            decode_opts.beam = beam;
-            decoder.SetOptions(decode_opts);
-          }
-          if (ans) {
-            std::vector<int32> alignment;
-            std::vector<int32> words;
-            LatticeWeight weight;
-            frame_count += features.NumRows();
-
-            GetLinearSymbolSequence(decoded, &alignment, &words, &weight);
-            BaseFloat like = -(weight.Value1()+weight.Value2()) / acoustic_scale;
-            tot_like += like;
-            if (scores_writer.IsOpen())
-              scores_writer.Write(key, -(weight.Value1()+weight.Value2()));
-            alignment_writer.Write(key, alignment);
-            num_success ++;
-            KALDI_VLOG(2) << "Log-like per frame for utterance " << key 
-                          << " is " << (like / features.NumRows()) << " over "
-                          << features.NumRows() << " frames.";
-            if (num_success % 50  == 0) {
-              KALDI_LOG << "Processed " << num_success << " utterances, "
-                        << "log-like per frame for " << key << " is "
-                        << (like / features.NumRows()) << " over "
-                        << features.NumRows() << " frames.";
-            }
-          } else {
-            KALDI_WARN << "Did not successfully decode file " << key << ", len = "
-                       << (features.NumRows());
-            num_other_error++;
-          }
+          DecodableAmNnet *nnet_decodable = new DecodableAmNnet(
+              trans_model, am_nnet, features, empty_spk_info, pad_input,
+              acoustic_scale);
+          AlignUtteranceClass *task = new AlignUtteranceClass(
+              trans_model, align_config, acoustic_scale, &decoder_pool, key,
+              decode_fst, nnet_decodable, features.NumRows(),
+              &alignment_writer, &scores_writer, &tot_like, &frame_count,
+              &num_success, &num_other_error, &num_retry);
+          sequencer.Run(task);  // takes ownership of "task".
         }
-      }
+      }  // the sequencer's destructor waits for the tasks to finish.
       KALDI_LOG << "Overall log-likelihood per frame is " << (tot_like/frame_count)
                 << " over " << frame_count<< " frames.";
+      KALDI_LOG << "Retried " << num_retry << " out of "
+                << (num_success + num_other_error) << " utterances.";
       KALDI_LOG << "Done " << num_success << ", could not find features for "
                 << num_no_feat << ", other errors on " << num_other_error;
     }
@@ -47,6 +47,7 @@ int main(int argc, char *argv[]) {
     BaseFloat dropout_scale = -1.0;
     bool remove_preconditioning = false;
     bool collapse = false;
+    bool quantize = false;
     bool match_updatableness = true;
     BaseFloat learning_rate_factor = 1.0, learning_rate = -1;
     std::string learning_rates = "";
@@ -83,6 +84,9 @@ int main(int argc, char *argv[]) {
                 "and FixedAffineComponents to compactify model");
     po.Register("match-updatableness", &match_updatableness, "Only relevant if "
                 "collapse=true; set this to false to collapse mixed types.");
+    po.Register("quantize", &quantize, "If true, convert the affine components "
+                "to 8-bit QuantizedAffineComponents, for faster decoding on "
+                "CPU (done after --collapse; the result cannot be trained)");
 
     po.Read(argc, argv);
     
@@ -154,6 +158,8 @@ int main(int argc, char *argv[]) {
     if (remove_preconditioning) am_nnet.GetNnet().RemovePreconditioning();
 
     if (collapse) am_nnet.GetNnet().Collapse(match_updatableness);
+
+    if (quantize) am_nnet.GetNnet().Quantize();
     
     if (stats_from != "") {
       // Copy the stats associated with the layers descending from
@@ -34,11 +34,15 @@ int main(int argc, char *argv[]) {
     const char *usage =
         "Copy a (cpu-based) neural net and its associated transition model,\n"
         "but modify it to reduce the effective parameter count by limiting\n"
-        "the rank of weight matrices.\n"
+        "the rank of weight matrices.  With --factorize=true, each reduced\n"
+        "matrix is stored as a product of two smaller ones, which makes the\n"
+        "network faster to evaluate.\n"
         "\n"
         "Usage:  nnet-am-limit-rank [options] <nnet-in> <nnet-out>\n"
         "e.g.:\n"
-        " nnet-am-limit-rank 1.mdl 1_limited.mdl\n";
+        " nnet-am-limit-rank 1.mdl 1_limited.mdl\n"
+        " nnet-am-limit-rank --factorize=true --parameter-proportion=0.3 "
+        "final.mdl final_lr.mdl\n";
     
 
     bool binary_write = true;
@@ -0,0 +1,89 @@
+// nnet2bin/nnet-am-optimize.cc
+
+// Copyright 2026  agent
+// (based on nnet2bin/nnet-am-mixup.cc; see that file for its authors)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "hmm/transition-model.h"
+#include "nnet2/am-nnet.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet2;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Prepare a neural net (and its associated transition model) for decoding:\n"
+        "remove dropout components, fold sequences of affine and linear\n"
+        "components (AffineComponent, FixedAffineComponent, DctComponent,\n"
+        "ScaleComponent, PermuteComponent, etc.) together where this does not\n"
+        "increase the computation, and remove components that compute the\n"
+        "identity.  The output is the same as before, up to roundoff.\n"
+        "\n"
+        "Usage:  nnet-am-optimize [options] <nnet-in> <nnet-out>\n"
+        "e.g.:\n"
+        " nnet-am-optimize final.mdl final_opt.mdl\n";
+
+    bool binary_write = true;
+    bool remove_dropout = true;
+
+    ParseOptions po(usage);
+    po.Register("binary", &binary_write, "Write output in binary mode");
+    po.Register("remove-dropout", &remove_dropout, "If true, remove any "
+                "dropout and additive-noise components first");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string nnet_rxfilename = po.GetArg(1),
+        nnet_wxfilename = po.GetArg(2);
+
+    TransitionModel trans_model;
+    AmNnet am_nnet;
+    {
+      bool binary;
+      Input ki(nnet_rxfilename, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_nnet.Read(ki.Stream(), binary);
+    }
+
+    int32 num_components = am_nnet.GetNnet().NumComponents();
+    if (remove_dropout) am_nnet.GetNnet().RemoveDropout();
+    am_nnet.GetNnet().OptimizeForInference();
+
+    {
+      Output ko(nnet_wxfilename, binary_write);
+      trans_model.Write(ko.Stream(), binary_write);
+      am_nnet.Write(ko.Stream(), binary_write);
+    }
+    KALDI_LOG << "Optimized neural net from " << nnet_rxfilename
+              << " (" << num_components << " components) and wrote it to "
+              << nnet_wxfilename << " (" << am_nnet.GetNnet().NumComponents()
+              << " components)";
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
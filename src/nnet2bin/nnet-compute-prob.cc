@@ -23,6 +23,8 @@
 #include "nnet2/nnet-randomize.h"
 #include "nnet2/train-nnet.h"
 #include "nnet2/am-nnet.h"
+#include "nnet2/nnet-update-parallel.h"
+#include "thread/kaldi-thread.h"
 
 
 int main(int argc, char *argv[]) {
@@ -42,7 +44,19 @@ int main(int argc, char *argv[]) {
         "Usage:  nnet-compute-prob [options] <model-in> <training-examples-in>\n"
         "e.g.: nnet-compute-prob 1.nnet ark:valid.egs\n";
     
+    int32 minibatch_size = 1024;
+    bool compute_accuracy = true;
+    std::string use_gpu = "no";
+
     ParseOptions po(usage);
+    po.Register("minibatch-size", &minibatch_size, "Number of examples to "
+                "process together.");
+    po.Register("num-threads", &g_num_threads, "Number of threads to use "
+                "(ignored if we are using a GPU).");
+    po.Register("compute-accuracy", &compute_accuracy, "If true, also print "
+                "the frame accuracy to the standard error.");
+    po.Register("use-gpu", &use_gpu, "yes|no|optional, only has effect if "
+                "compiled with CUDA");
 
     po.Read(argc, argv);
     
@@ -50,6 +64,10 @@ int main(int argc, char *argv[]) {
       po.PrintUsage();
       exit(1);
     }
+
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().SelectGpuId(use_gpu);
+#endif
     
     std::string nnet_rxfilename = po.GetArg(1),
         examples_rspecifier = po.GetArg(2);
@@ -64,31 +82,22 @@ int main(int argc, char *argv[]) {
     }
 
 
-    std::vector<NnetExample> examples;
-    double tot_like = 0;
-    int64 num_examples = 0;
+    double tot_weight = 0.0, tot_accuracy = 0.0;
     SequentialNnetExampleReader example_reader(examples_rspecifier);
-    for (; !example_reader.Done(); example_reader.Next(), num_examples++) {
-      if (examples.size() == 1000) {
-        tot_like += ComputeNnetObjf(am_nnet.GetNnet(), examples);
-        examples.clear();
-      }
-      examples.push_back(example_reader.Value());
-      if (num_examples % 5000 == 0 && num_examples > 0)
-        KALDI_LOG << "Saw " << num_examples << " examples, average "
-                  << "probability is " << (tot_like / num_examples) << " with "
-                  << "total weight " << num_examples;
-    }
-    if (!examples.empty()) {
-      tot_like += ComputeNnetObjf(am_nnet.GetNnet(), examples);
-    }
+    double tot_like = ComputeNnetObjfParallel(
+        am_nnet.GetNnet(), minibatch_size, &example_reader, &tot_weight,
+        (compute_accuracy ? &tot_accuracy : NULL));
 
-    KALDI_LOG << "Saw " << num_examples << " examples, average "
-              << "probability is " << (tot_like / num_examples) << " with "
-              << "total weight " << num_examples;
+    KALDI_LOG << "Saw " << tot_weight << " examples (weighted), average "
+              << "probability is " << (tot_like / tot_weight);
+    if (compute_accuracy)
+      KALDI_LOG << "Frame accuracy is " << (tot_accuracy / tot_weight);
     
-    std::cout << (tot_like / num_examples) << "\n";
-    return (num_examples == 0 ? 1 : 0);
+    std::cout << (tot_like / tot_weight) << "\n";
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().PrintProfile();
+#endif
+    return (tot_weight == 0.0 ? 1 : 0);
   } catch(const std::exception &e) {
     std::cerr << e.what() << '\n';
     return -1;
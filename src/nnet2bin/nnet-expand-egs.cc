@@ -0,0 +1,88 @@
+// nnet2bin/nnet-expand-egs.cc
+
+// Copyright 2026  agent
+// (based on nnet2bin/nnet-subset-egs.cc; see that file for its authors)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "nnet2/nnet-example.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet2;
+    typedef kaldi::int32 int32;
+    typedef kaldi::int64 int64;
+
+    const char *usage =
+        "Expand chunks of frames (as written by nnet-get-egs "
+        "--frames-per-chunk)\n"
+        "into frame-by-frame examples for neural network training, "
+        "optionally\n"
+        "randomizing their order with a buffer.  This is intended to be used in\n"
+        "a pipe at training time, so the examples on disk can be the compact\n"
+        "chunks.\n"
+        "\n"
+        "Usage:  nnet-expand-egs [options] <chunk-egs-rspecifier> <egs-wspecifier>\n"
+        "\n"
+        "e.g.:\n"
+        "nnet-train-simple 1.mdl \"ark:nnet-expand-egs --buffer-size=100000 "
+        "ark:egs.1.ark ark:- |\" 2.mdl\n";
+    
+    int32 srand_seed = 0;
+    int32 buffer_size = 0;
+    ParseOptions po(usage);
+    po.Register("srand", &srand_seed, "Seed for random number generator ");
+    po.Register("buffer-size", &buffer_size, "If >0, size of a buffer we use "
+                "to randomize the order of the frame-by-frame examples (as "
+                "in nnet-shuffle-egs --buffer-size).");
+    
+    po.Read(argc, argv);
+
+    srand(srand_seed);
+    
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+    KALDI_ASSERT(buffer_size >= 0);
+
+    std::string chunks_rspecifier = po.GetArg(1),
+        examples_wspecifier = po.GetArg(2);
+
+    int64 num_chunks = 0;
+    SequentialNnetChunkExampleReader chunk_reader(chunks_rspecifier);
+    ShufflingExampleWriter<NnetExample> example_writer(examples_wspecifier,
+                                                       buffer_size);
+    std::vector<NnetExample> egs;
+    for (; !chunk_reader.Done(); chunk_reader.Next(), num_chunks++) {
+      egs.clear();
+      chunk_reader.Value().GetFrameExamples(&egs);
+      for (size_t i = 0; i < egs.size(); i++)
+        example_writer.Write(egs[i]);
+    }
+    example_writer.Flush();
+
+    KALDI_LOG << "Expanded " << num_chunks << " chunks into "
+              << example_writer.NumWritten() << " examples.";
+    return (num_chunks == 0 ? 1 : 0);
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
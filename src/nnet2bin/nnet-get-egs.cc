@@ -21,6 +21,7 @@
 #include "util/common-utils.h"
 #include "hmm/transition-model.h"
 #include "nnet2/nnet-randomize.h"
+#include "thread/kaldi-task-sequence.h"
 
 namespace kaldi {
 namespace nnet2 {
@@ -42,45 +43,102 @@ int32 GetCount(double expected_count) {
   return ans;
 }
 
-static void ProcessFile(const MatrixBase<BaseFloat> &feats,
-                        const Posterior &pdf_post,
-                        const Vector<BaseFloat> &spk_info,
-                        int32 left_context,
-                        int32 right_context,
-                        BaseFloat keep_proportion,
-                        int64 *num_frames_written,
-                        NnetExampleWriter *example_writer) {
-  KALDI_ASSERT(feats.NumRows() == static_cast<int32>(pdf_post.size()));
-  NnetExample eg;
-  Matrix<BaseFloat> input_frames(left_context + 1 + right_context,
-                                 feats.NumCols());
-  eg.left_context = left_context;
-  eg.spk_info = spk_info;
-  for (int32 i = 0; i < feats.NumRows(); i++) {
-    int32 count = GetCount(keep_proportion); // number of times
-    // we'll write this out (1 by default).
-    if (count > 0) {
-      // Set up "input_frames".
-      for (int32 j = -left_context; j <= right_context; j++) {
-        int32 j2 = j + i;
-        if (j2 < 0) j2 = 0;
-        if (j2 >= feats.NumRows()) j2 = feats.NumRows() - 1;
-        SubVector<BaseFloat> src(feats, j2), dest(input_frames,
-                                                  j + left_context);
-        dest.CopyFromVec(src);
+// Gets the examples of one utterance.  The examples are created (and their
+// features compressed, which is the slow part) by operator (), which
+// TaskSequencer runs in parallel for different utterances; the destructor
+// writes them, in the order of the utterances.
+class ExampleGetter {
+ public:
+  // "counts" says how many times to write out each example: there is one
+  // count per frame if frames_per_chunk == 0, else one per chunk.  Exactly
+  // one of the writers is used.
+  ExampleGetter(const Matrix<BaseFloat> &feats,
+                const Posterior &pdf_post,
+                const Vector<BaseFloat> &spk_info,
+                int32 left_context,
+                int32 right_context,
+                int32 frames_per_chunk,
+                const std::vector<int32> &counts,
+                ShufflingExampleWriter<NnetExample> *example_writer,
+                ShufflingExampleWriter<NnetChunkExample> *chunk_writer):
+      feats_(feats), pdf_post_(pdf_post), spk_info_(spk_info),
+      left_context_(left_context), right_context_(right_context),
+      frames_per_chunk_(frames_per_chunk), counts_(counts),
+      example_writer_(example_writer), chunk_writer_(chunk_writer) {
+    KALDI_ASSERT(feats.NumRows() == static_cast<int32>(pdf_post.size()));
+  }
+
+  void operator () () {
+    if (frames_per_chunk_ == 0) {
+      int32 num_frames = feats_.NumRows();
+      NnetExample eg;
+      eg.left_context = left_context_;
+      eg.spk_info = spk_info_;
+      for (int32 i = 0; i < num_frames; i++) {
+        if (counts_[i] == 0) continue;
+        Matrix<BaseFloat> input_frames;
+        GetInputFrames(i, 1, &input_frames);
+        eg.labels = pdf_post_[i];
+        eg.input_frames = input_frames;
+        egs_.push_back(eg);
+      }
+    } else {
+      int32 num_chunks = counts_.size();
+      NnetChunkExample eg;
+      eg.left_context = left_context_;
+      eg.spk_info = spk_info_;
+      for (int32 c = 0; c < num_chunks; c++) {
+        if (counts_[c] == 0) continue;
+        int32 start = c * frames_per_chunk_,
+            num_frames = std::min(frames_per_chunk_,
+                                  feats_.NumRows() - start);
+        Matrix<BaseFloat> input_frames;
+        GetInputFrames(start, num_frames, &input_frames);
+        eg.labels.assign(pdf_post_.begin() + start,
+                         pdf_post_.begin() + start + num_frames);
+        eg.input_frames = input_frames;
+        chunk_egs_.push_back(eg);
       }
-      eg.labels = pdf_post[i];
-      eg.input_frames = input_frames;
-      std::ostringstream os;
-      os << ((*num_frames_written)++);
-      std::string key = os.str(); // key in the archive is the number of the
-      // example.
-
-      for (int32 c = 0; c < count; c++)
-        example_writer->Write(key, eg);
     }
   }
-}
+
+  ~ExampleGetter() {
+    for (size_t i = 0, j = 0; i < counts_.size(); i++) {
+      if (counts_[i] == 0) continue;
+      for (int32 c = 0; c < counts_[i]; c++) {
+        if (frames_per_chunk_ == 0) example_writer_->Write(egs_[j]);
+        else chunk_writer_->Write(chunk_egs_[j]);
+      }
+      j++;
+    }
+  }
+
+ private:
+  // Sets "input_frames" to the features of frames [start, start + num_frames)
+  // with their left and right context, repeating the first and last frames
+  // at the edges of the utterance.
+  void GetInputFrames(int32 start, int32 num_frames,
+                      Matrix<BaseFloat> *input_frames) const {
+    input_frames->Resize(left_context_ + num_frames + right_context_,
+                         feats_.NumCols(), kUndefined);
+    for (int32 j = 0; j < input_frames->NumRows(); j++) {
+      int32 j2 = start + j - left_context_;
+      if (j2 < 0) j2 = 0;
+      if (j2 >= feats_.NumRows()) j2 = feats_.NumRows() - 1;
+      input_frames->Row(j).CopyFromVec(feats_.Row(j2));
+    }
+  }
+
+  Matrix<BaseFloat> feats_;
+  Posterior pdf_post_;
+  Vector<BaseFloat> spk_info_;
+  int32 left_context_, right_context_, frames_per_chunk_;
+  std::vector<int32> counts_;
+  ShufflingExampleWriter<NnetExample> *example_writer_;
+  ShufflingExampleWriter<NnetChunkExample> *chunk_writer_;
+  std::vector<NnetExample> egs_;
+  std::vector<NnetChunkExample> chunk_egs_;
+};
 
 
 } // namespace nnet2
@@ -100,7 +158,9 @@ int main(int argc, char *argv[]) {
         "different subsets, do nnet-copy-egs with --random=true, but\n"
         "note that this does not randomize the order of frames.\n"
         "Also see nnet-randomize-frames, which uses more memory but also\n"
-        "randomizes the order\n"
+        "randomizes the order; or use the --buffer-size option.\n"
+        "With --frames-per-chunk, it writes chunks of consecutive frames\n"
+        "that store each frame's features only once (see nnet-expand-egs).\n"
         "\n"
         "Usage:  nnet-get-egs [options] <features-rspecifier> "
         "<pdf-post-rspecifier> <training-examples-out>\n"
@@ -115,7 +175,10 @@ int main(int argc, char *argv[]) {
     
     int32 left_context = 0, right_context = 0;
     int32 srand_seed = 0;
+    int32 frames_per_chunk = 0;
+    int32 buffer_size = 0;
     BaseFloat keep_proportion = 1.0;
+    TaskSequencerConfig task_config;
     
     std::string spk_vecs_rspecifier, utt2spk_rspecifier;
     
@@ -130,9 +193,18 @@ int main(int argc, char *argv[]) {
     po.Register("keep-proportion", &keep_proportion, "If <1.0, this program will "
                 "randomly keep this proportion of the input samples.  If >1.0, it will "
                 "in expectation copy a sample this many times.  It will copy it a number "
-                "of times equal to floor(keep-proportion) or ceil(keep-proportion).");
+                "of times equal to floor(keep-proportion) or ceil(keep-proportion).  "
+                "With --frames-per-chunk, this applies to whole chunks.");
     po.Register("srand", &srand_seed, "Seed for random number generator "
-                "(only relevant if --keep-proportion != 1.0)");
+                "(only relevant if --keep-proportion != 1.0 or --buffer-size > 0)");
+    po.Register("frames-per-chunk", &frames_per_chunk, "If >0, write examples "
+                "of this many consecutive frames (the last chunk of an utterance "
+                "may be shorter) that store each frame's features only once; "
+                "use nnet-expand-egs to turn them into frame-by-frame examples.");
+    po.Register("buffer-size", &buffer_size, "If >0, randomize the order of "
+                "the output examples using a buffer of this size, as "
+                "nnet-shuffle-egs --buffer-size does.");
+    task_config.Register(&po);
     
     po.Read(argc, argv);
 
@@ -142,6 +214,7 @@ int main(int argc, char *argv[]) {
       po.PrintUsage();
       exit(1);
     }
+    KALDI_ASSERT(frames_per_chunk >= 0 && buffer_size >= 0);
 
     std::string feature_rspecifier = po.GetArg(1),
         pdf_post_rspecifier = po.GetArg(2),
@@ -152,55 +225,90 @@ int main(int argc, char *argv[]) {
     RandomAccessPosteriorReader pdf_post_reader(pdf_post_rspecifier);
     RandomAccessBaseFloatVectorReaderMapped vecs_reader(
         spk_vecs_rspecifier, utt2spk_rspecifier);
-    NnetExampleWriter example_writer(examples_wspecifier);
+    // Only one of these two is used.
+    ShufflingExampleWriter<NnetExample> *example_writer = NULL;
+    ShufflingExampleWriter<NnetChunkExample> *chunk_writer = NULL;
+    if (frames_per_chunk == 0)
+      example_writer = new ShufflingExampleWriter<NnetExample>(
+          examples_wspecifier, buffer_size);
+    else
+      chunk_writer = new ShufflingExampleWriter<NnetChunkExample>(
+          examples_wspecifier, buffer_size);
     
     int32 num_done = 0, num_err = 0;
     int32 spk_dim = -1;
     int64 num_frames_written = 0;
-    
-    for (; !feat_reader.Done(); feat_reader.Next()) {
-      std::string key = feat_reader.Key();
-      const Matrix<BaseFloat> &feats = feat_reader.Value();
-      if (!pdf_post_reader.HasKey(key)) {
-        KALDI_WARN << "No pdf-level posterior for key " << key;
-        num_err++;
-      } else {
-        const Posterior &pdf_post = pdf_post_reader.Value(key);
-        if (pdf_post.size() != feats.NumRows()) {
-          KALDI_WARN << "Posterior has wrong size " << pdf_post.size()
-                     << " versus " << feats.NumRows();
+
+    {
+      TaskSequencer<ExampleGetter> sequencer(task_config);
+      for (; !feat_reader.Done(); feat_reader.Next()) {
+        std::string key = feat_reader.Key();
+        const Matrix<BaseFloat> &feats = feat_reader.Value();
+        if (!pdf_post_reader.HasKey(key)) {
+          KALDI_WARN << "No pdf-level posterior for key " << key;
           num_err++;
-          continue;
-        }
-        Vector<BaseFloat> spk_info;
-        
-        if (spk_vecs_rspecifier != "") {
-          if (!vecs_reader.HasKey(key)) {
-            KALDI_WARN << "No speaker vector for key " << key;
+        } else {
+          const Posterior &pdf_post = pdf_post_reader.Value(key);
+          if (pdf_post.size() != feats.NumRows()) {
+            KALDI_WARN << "Posterior has wrong size " << pdf_post.size()
+                       << " versus " << feats.NumRows();
             num_err++;
             continue;
-          } else {
-            spk_info = vecs_reader.Value(key);
           }
-          if (spk_dim == -1) spk_dim = spk_info.Dim();
-          else if (spk_info.Dim() != spk_dim) {
-            KALDI_WARN << "Invalid dimension of speaker vector, "
-                << spk_info.Dim() << " (expected "
-                << spk_dim << " ).";
-            num_err++;
-            continue;
+          Vector<BaseFloat> spk_info;
+        
+          if (spk_vecs_rspecifier != "") {
+            if (!vecs_reader.HasKey(key)) {
+              KALDI_WARN << "No speaker vector for key " << key;
+              num_err++;
+              continue;
+            } else {
+              spk_info = vecs_reader.Value(key);
+            }
+            if (spk_dim == -1) spk_dim = spk_info.Dim();
+            else if (spk_info.Dim() != spk_dim) {
+              KALDI_WARN << "Invalid dimension of speaker vector, "
+                  << spk_info.Dim() << " (expected "
+                  << spk_dim << " ).";
+              num_err++;
+              continue;
+            }
+          }
+          // The random choices are made here, so they don't depend on the
+          // order in which the threads run.
+          int32 num_counts = (frames_per_chunk == 0 ? feats.NumRows() :
+              (feats.NumRows() + frames_per_chunk - 1) / frames_per_chunk);
+          std::vector<int32> counts(num_counts);
+          for (int32 i = 0; i < num_counts; i++) {
+            counts[i] = GetCount(keep_proportion);
+            if (counts[i] > 0)
+              num_frames_written += (frames_per_chunk == 0 ? 1 :
+                  std::min(frames_per_chunk,
+                           feats.NumRows() - i * frames_per_chunk));
           }
+          sequencer.Run(new ExampleGetter(feats, pdf_post, spk_info,
+                                          left_context, right_context,
+                                          frames_per_chunk, counts,
+                                          example_writer, chunk_writer));
+          num_done++;
         }
-        ProcessFile(feats, pdf_post, spk_info,
-                    left_context, right_context, keep_proportion,
-                    &num_frames_written, &example_writer);
-        num_done++;
       }
+    } // the sequencer waits for the last utterances here.
+    int64 num_egs_written;
+    if (example_writer != NULL) {
+      example_writer->Flush();
+      num_egs_written = example_writer->NumWritten();
+    } else {
+      chunk_writer->Flush();
+      num_egs_written = chunk_writer->NumWritten();
     }
+    delete example_writer;
+    delete chunk_writer;
 
     KALDI_LOG << "Finished generating examples, "
               << "successfully processed " << num_done
-              << " feature files, wrote " << num_frames_written << " examples, "
+              << " feature files, wrote " << num_egs_written << " examples "
+              << "of " << num_frames_written << " distinct frames, "
               << num_err << " files had errors.";
     return (num_done == 0 ? 1 : 0);
   } catch(const std::exception &e) {
@@ -26,9 +26,143 @@
 #include "fstext/fstext-lib.h"
 #include "decoder/lattice-faster-decoder.h"
 #include "nnet2/decodable-am-nnet.h"
+#include "decoder/decodable-matrix.h"
 #include "util/timer.h"
 #include "thread/kaldi-task-sequence.h"
 
+namespace kaldi {
+namespace nnet2 {
+
+/// This class is used when --batch-frames > 0.  It collects utterances until
+/// it has about that many frames, then does the neural net computation for all
+/// of them at once in the calling thread (see NnetComputationBatched()), and
+/// passes the resulting log-likelihoods to the TaskSequencer for decoding.
+/// Doing the computation for many utterances at once keeps the GPU busy, while
+/// the decoding still runs in parallel in the worker threads.
+class NnetBatchComputer {
+ public:
+  NnetBatchComputer(const TransitionModel &trans_model,
+                    const AmNnet &am_nnet,
+                    int32 batch_frames,
+                    BaseFloat acoustic_scale,
+                    bool determinize,
+                    bool allow_partial,
+                    const fst::SymbolTable *word_syms,
+                    Int32VectorWriter *alignments_writer,
+                    Int32VectorWriter *words_writer,
+                    CompactLatticeWriter *compact_lattice_writer,
+                    LatticeWriter *lattice_writer,
+                    double *like_sum, int64 *frame_sum,
+                    int32 *num_done, int32 *num_err,
+                    TaskSequencer<DecodeUtteranceLatticeFasterClass> *sequencer):
+      trans_model_(trans_model), am_nnet_(am_nnet),
+      batch_frames_(batch_frames), acoustic_scale_(acoustic_scale),
+      determinize_(determinize), allow_partial_(allow_partial),
+      word_syms_(word_syms), alignments_writer_(alignments_writer),
+      words_writer_(words_writer),
+      compact_lattice_writer_(compact_lattice_writer),
+      lattice_writer_(lattice_writer), like_sum_(like_sum),
+      frame_sum_(frame_sum), num_done_(num_done), num_err_(num_err),
+      sequencer_(sequencer), num_pending_frames_(0),
+      log_priors_(am_nnet.Priors()) {
+    KALDI_ASSERT(batch_frames > 0);
+    KALDI_ASSERT(log_priors_.Dim() == trans_model.NumPdfs() &&
+                 "Priors in neural network not set up.");
+    log_priors_.ApplyLog();
+  }
+
+  /// Takes ownership of "decoder".
+  void AddUtterance(const std::string &utt,
+                    const Matrix<BaseFloat> &features,
+                    const Vector<BaseFloat> &spk_info,
+                    LatticeFasterDecoder *decoder) {
+    PendingUtterance pending;
+    pending.utt = utt;
+    pending.feats = new CuMatrix<BaseFloat>(features);
+    pending.spk_info = new CuVector<BaseFloat>(spk_info);
+    pending.decoder = decoder;
+    pending_.push_back(pending);
+    num_pending_frames_ += features.NumRows();
+    if (num_pending_frames_ >= batch_frames_)
+      Flush();
+  }
+
+  /// Does the computation for any remaining utterances.  Must be called
+  /// before TaskSequencer::Wait().
+  void Flush() {
+    if (pending_.empty()) return;
+    std::vector<const CuMatrixBase<BaseFloat>*> feats(pending_.size());
+    std::vector<const CuVectorBase<BaseFloat>*> spk_info(pending_.size());
+    bool have_spk_info = (pending_[0].spk_info->Dim() != 0);
+    for (size_t i = 0; i < pending_.size(); i++) {
+      feats[i] = pending_[i].feats;
+      spk_info[i] = (have_spk_info ? pending_[i].spk_info : NULL);
+    }
+    std::vector<CuMatrix<BaseFloat> > log_probs;
+    NnetComputationBatched(am_nnet_.GetNnet(), feats, spk_info, &log_probs);
+
+    for (size_t i = 0; i < pending_.size(); i++) {
+      // As in DecodableAmNnetParallel::Compute().
+      CuMatrix<BaseFloat> &this_log_probs = log_probs[i];
+      this_log_probs.ApplyFloor(1.0e-20);  // Avoid log of zero.
+      this_log_probs.ApplyLog();
+      this_log_probs.AddVecToRows(-1.0, log_priors_);  // divide by prior.
+      this_log_probs.Scale(acoustic_scale_);
+      // The decodable object takes ownership of the matrix.
+      int32 num_frames = this_log_probs.NumRows();
+      DecodableMatrixScaledMapped *decodable = new DecodableMatrixScaledMapped(
+          trans_model_, 1.0, new Matrix<BaseFloat>(this_log_probs));
+      this_log_probs.Resize(0, 0);
+      delete pending_[i].feats;
+      delete pending_[i].spk_info;
+
+      DecodeUtteranceLatticeFasterClass *task =
+          new DecodeUtteranceLatticeFasterClass(
+              pending_[i].decoder, decodable, // takes ownership of these two.
+              trans_model_, word_syms_, pending_[i].utt, acoustic_scale_,
+              determinize_, allow_partial_, alignments_writer_, words_writer_,
+              compact_lattice_writer_, lattice_writer_,
+              like_sum_, frame_sum_, num_done_, num_err_, NULL);
+      sequencer_->Run(task, num_frames); // takes ownership of "task".
+    }
+    pending_.clear();
+    num_pending_frames_ = 0;
+  }
+
+  ~NnetBatchComputer() { KALDI_ASSERT(pending_.empty()); }
+ private:
+  struct PendingUtterance {
+    std::string utt;
+    CuMatrix<BaseFloat> *feats;
+    CuVector<BaseFloat> *spk_info;
+    LatticeFasterDecoder *decoder;
+  };
+
+  const TransitionModel &trans_model_;
+  const AmNnet &am_nnet_;
+  int32 batch_frames_;
+  BaseFloat acoustic_scale_;
+  bool determinize_;
+  bool allow_partial_;
+  const fst::SymbolTable *word_syms_;
+  Int32VectorWriter *alignments_writer_;
+  Int32VectorWriter *words_writer_;
+  CompactLatticeWriter *compact_lattice_writer_;
+  LatticeWriter *lattice_writer_;
+  double *like_sum_;
+  int64 *frame_sum_;
+  int32 *num_done_;
+  int32 *num_err_;
+  TaskSequencer<DecodeUtteranceLatticeFasterClass> *sequencer_;
+
+  std::vector<PendingUtterance> pending_;
+  int32 num_pending_frames_;
+  CuVector<BaseFloat> log_priors_;
+};
+
+}  // namespace nnet2
+}  // namespace kaldi
+
 
 int main(int argc, char *argv[]) {
   try {
@@ -37,6 +171,7 @@ int main(int argc, char *argv[]) {
     typedef kaldi::int32 int32;
     using fst::SymbolTable;
     using fst::VectorFst;
+    using fst::Fst;
     using fst::StdArc;
 
     const char *usage =
@@ -47,6 +182,7 @@ int main(int argc, char *argv[]) {
     Timer timer;
     bool allow_partial = false;
     BaseFloat acoustic_scale = 0.1;
+    int32 batch_frames = 0;
     LatticeFasterDecoderConfig config;
     TaskSequencerConfig sequencer_config; // has --num-threads option
     std::string spkvecs_rspecifier, utt2spk_rspecifier;
@@ -61,6 +197,11 @@ int main(int argc, char *argv[]) {
                 "only needed if the neural net was trained this way.");
     po.Register("utt2spk", &utt2spk_rspecifier, "Rspecifier for map from utterance to speaker; only relevant "
                 "in conjunction with the --spk-vecs option.");
+    po.Register("batch-frames", &batch_frames, "If >0, do the neural net "
+                "computation in the main thread for batches of utterances "
+                "with about this many frames in total, which is much more "
+                "efficient on a GPU; decoding is still done by the worker "
+                "threads.  E.g. 10000.");
     
     po.Read(argc, argv);
     
@@ -69,6 +210,10 @@ int main(int argc, char *argv[]) {
       exit(1);
     }
 
+    // With many decoding threads, queue log messages rather than having the
+    // threads wait for stderr.
+    if (sequencer_config.num_threads > 1) SetLogAsync(true);
+
     std::string model_in_filename = po.GetArg(1),
         fst_in_str = po.GetArg(2),
         feature_rspecifier = po.GetArg(3),
@@ -113,11 +258,23 @@ int main(int argc, char *argv[]) {
     double tot_like = 0.0;
     kaldi::int64 frame_count = 0;
     int num_done = 0, num_err = 0;
-    VectorFst<StdArc> *decode_fst = NULL;
+    NnetBatchComputer *batch_computer = NULL;
+    if (batch_frames > 0)
+      batch_computer = new NnetBatchComputer(
+          trans_model, am_nnet, batch_frames, acoustic_scale, determinize,
+          allow_partial, word_syms, &alignment_writer, &words_writer,
+          &compact_lattice_writer, &lattice_writer, &tot_like, &frame_count,
+          &num_done, &num_err, &sequencer);
+    Fst<StdArc> *decode_fst = NULL;
+    NumaReplicated<Fst<StdArc> > *graph = NULL;
     if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) {
       SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
 
-      decode_fst = fst::ReadFstKaldi(fst_in_str);
+      decode_fst = fst::ReadDecodingGraph(fst_in_str);
+      // With --numa-policy, each NUMA node gets its own copy of the graph.
+      graph = new NumaReplicated<Fst<StdArc> >(*decode_fst,
+                                               g_numa_policy != "none",
+                                               fst::CopyDecodingGraph);
 
       {
     
@@ -139,6 +296,13 @@ int main(int argc, char *argv[]) {
               continue;
             }
           }
+          if (batch_computer != NULL) {
+            LatticeFasterDecoder *decoder =
+                new LatticeFasterDecoder(*decode_fst, config);
+            batch_computer->AddUtterance(utt, features, spk_info, decoder);
+            continue;
+          }
+
           bool pad_input = true;
           DecodableAmNnetParallel *nnet_decodable = new DecodableAmNnetParallel(
               trans_model, am_nnet,
@@ -146,19 +310,20 @@ int main(int argc, char *argv[]) {
               new CuVector<BaseFloat>(spk_info),
               pad_input, acoustic_scale);
 
-          LatticeFasterDecoder *decoder = new LatticeFasterDecoder(*decode_fst,
-                                                                   config);
-
+          // The decoder is created by the task, in the decoding thread.
           DecodeUtteranceLatticeFasterClass *task =
               new DecodeUtteranceLatticeFasterClass(
-                  decoder, nnet_decodable, // takes ownership of these two.
+                  NULL, nnet_decodable, // takes ownership of nnet_decodable.
                   trans_model, word_syms, utt, acoustic_scale, determinize,
                   allow_partial, &alignment_writer, &words_writer,
                   &compact_lattice_writer, &lattice_writer,
-                  &tot_like, &frame_count, &num_done, &num_err, NULL);
+                  &tot_like, &frame_count, &num_done, &num_err, NULL,
+                  graph, &config);
               
-          sequencer.Run(task); // takes ownership of "task",
-                               // and will delete it when done.
+          // The number of frames is the cost, for --task-lookahead.
+          sequencer.Run(task, features.NumRows()); // takes ownership of
+                                                   // "task", and will delete
+                                                   // it when done.
         }
       }
     } else { // We have different FSTs for different utterances.
@@ -190,9 +355,14 @@ int main(int argc, char *argv[]) {
           } else {
             KALDI_WARN << "Cannot find speaker vector for " << utt
                        << " (skipping this utterance).";
+            delete decoder;
             continue;
           }
         }
+        if (batch_computer != NULL) {
+          batch_computer->AddUtterance(utt, features, spk_info, decoder);
+          continue;
+        }
         bool pad_input = true;
         DecodableAmNnetParallel *nnet_decodable = new DecodableAmNnetParallel(
             trans_model, am_nnet,
@@ -208,12 +378,18 @@ int main(int argc, char *argv[]) {
                 &compact_lattice_writer, &lattice_writer,
                 &tot_like, &frame_count, &num_done, &num_err, NULL);
 
-        sequencer.Run(task); // takes ownership of "task",
-                             // and will delete it when done.
+        sequencer.Run(task, features.NumRows()); // takes ownership of
+                                                 // "task", and will delete
+                                                 // it when done.
       }
     }
+    if (batch_computer != NULL) {
+      batch_computer->Flush();
+      delete batch_computer;
+    }
     sequencer.Wait(); // Waits for all tasks to be done.
-    if (decode_fst != NULL) delete decode_fst;   
+    delete graph;
+    if (decode_fst != NULL) delete decode_fst;      
     
     double elapsed = timer.Elapsed();
     KALDI_LOG << "Time taken "<< elapsed
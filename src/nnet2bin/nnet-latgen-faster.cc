@@ -37,6 +37,7 @@ int main(int argc, char *argv[]) {
     typedef kaldi::int32 int32;
     using fst::SymbolTable;
     using fst::VectorFst;
+    using fst::Fst;
     using fst::StdArc;
 
     const char *usage =
@@ -47,6 +48,9 @@ int main(int argc, char *argv[]) {
     Timer timer;
     bool allow_partial = false;
     BaseFloat acoustic_scale = 0.1;
+    int32 frame_subsampling_factor = 1;
+    bool pruned_output = false;
+    int32 normalizer_rank = 0;
     LatticeFasterDecoderConfig config;
     std::string spkvecs_rspecifier, utt2spk_rspecifier;
     
@@ -59,6 +63,18 @@ int main(int argc, char *argv[]) {
                 "only needed if the neural net was trained this way.");
     po.Register("utt2spk", &utt2spk_rspecifier, "Rspecifier for map from utterance to speaker; only relevant "
                 "in conjunction with the --spk-vecs option.");
+    po.Register("frame-subsampling-factor", &frame_subsampling_factor,
+                "If >1, evaluate the neural net only on every n'th frame and "
+                "reuse its output for the frames in between (faster, but "
+                "less accurate).");
+    po.Register("pruned-output", &pruned_output, "If true, compute the output "
+                "of the final affine layer only for the pdfs the decoder needs "
+                "(see DecodableAmNnetPruned); faster for models with many pdfs. "
+                "The log-likelihoods are then not normalized unless "
+                "--normalizer-rank > 0, which does not affect the search.");
+    po.Register("normalizer-rank", &normalizer_rank, "With --pruned-output, if "
+                ">0, estimate the softmax normalizer using this rank of "
+                "approximation to the final layer.");
     
     po.Read(argc, argv);
     
@@ -83,6 +99,14 @@ int main(int argc, char *argv[]) {
       am_nnet.Read(ki.Stream(), binary);
     }
 
+    DecodableAmNnetPrunedInfo *pruned_info = NULL;
+    if (pruned_output) {
+      if (frame_subsampling_factor != 1)
+        KALDI_ERR << "--pruned-output does not support "
+                  << "--frame-subsampling-factor";
+      pruned_info = new DecodableAmNnetPrunedInfo(am_nnet, normalizer_rank);
+    }
+
     bool determinize = config.determinize_lattice;
     CompactLatticeWriter compact_lattice_writer;
     LatticeWriter lattice_writer;
@@ -115,7 +139,7 @@ int main(int argc, char *argv[]) {
       SequentialBaseFloatCuMatrixReader feature_reader(feature_rspecifier);
       
       // Input FST is just one FST, not a table of FSTs.
-      VectorFst<StdArc> *decode_fst = fst::ReadFstKaldi(fst_in_str);
+      Fst<StdArc> *decode_fst = fst::ReadDecodingGraph(fst_in_str);
 
       {
         LatticeFasterDecoder decoder(*decode_fst, config);
@@ -139,18 +163,23 @@ int main(int argc, char *argv[]) {
             }
           }
           bool pad_input = true;
-          DecodableAmNnet nnet_decodable(trans_model,
-                                         am_nnet,
-                                         features,
-                                         spk_info,
-                                         pad_input,
-                                         acoustic_scale);
+          DecodableInterface *nnet_decodable;
+          if (pruned_info != NULL)
+            nnet_decodable = new DecodableAmNnetPruned(
+                trans_model, *pruned_info, features, spk_info, pad_input,
+                acoustic_scale);
+          else
+            nnet_decodable = new DecodableAmNnet(
+                trans_model, am_nnet, features, spk_info, pad_input,
+                acoustic_scale, frame_subsampling_factor);
           double like;
-          if (DecodeUtteranceLatticeFaster(
-                  decoder, nnet_decodable, trans_model, word_syms, utt,
-                  acoustic_scale, determinize, allow_partial, &alignment_writer,
-                  &words_writer, &compact_lattice_writer, &lattice_writer,
-                  &like)) {
+          bool ans = DecodeUtteranceLatticeFaster(
+              decoder, *nnet_decodable, trans_model, word_syms, utt,
+              acoustic_scale, determinize, allow_partial, &alignment_writer,
+              &words_writer, &compact_lattice_writer, &lattice_writer,
+              &like);
+          delete nnet_decodable;
+          if (ans) {
             tot_like += like;
             frame_count += features.NumRows();
             num_success++;
@@ -189,18 +218,23 @@ int main(int argc, char *argv[]) {
           }
         }
         bool pad_input = true;
-        DecodableAmNnet nnet_decodable(trans_model,
-                                       am_nnet,
-                                       features,
-                                       spk_info,
-                                       pad_input,
-                                       acoustic_scale);
+        DecodableInterface *nnet_decodable;
+        if (pruned_info != NULL)
+          nnet_decodable = new DecodableAmNnetPruned(
+              trans_model, *pruned_info, features, spk_info, pad_input,
+              acoustic_scale);
+        else
+          nnet_decodable = new DecodableAmNnet(
+              trans_model, am_nnet, features, spk_info, pad_input,
+              acoustic_scale, frame_subsampling_factor);
         double like;
-        if (DecodeUtteranceLatticeFaster(
-                decoder, nnet_decodable, trans_model, word_syms, utt,
-                acoustic_scale, determinize, allow_partial, &alignment_writer,
-                &words_writer, &compact_lattice_writer, &lattice_writer,
-                &like)) {
+        bool ans = DecodeUtteranceLatticeFaster(
+            decoder, *nnet_decodable, trans_model, word_syms, utt,
+            acoustic_scale, determinize, allow_partial, &alignment_writer,
+            &words_writer, &compact_lattice_writer, &lattice_writer,
+            &like);
+        delete nnet_decodable;
+        if (ans) {
           tot_like += like;
           frame_count += features.NumRows();
           num_success++;
@@ -218,6 +252,7 @@ int main(int argc, char *argv[]) {
               << frame_count<<" frames.";
 
     if (word_syms) delete word_syms;
+    delete pruned_info;
     if (num_success != 0) return 0;
     else return 1;
   } catch(const std::exception &e) {
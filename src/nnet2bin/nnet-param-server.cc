@@ -0,0 +1,94 @@
+// nnet2bin/nnet-param-server.cc
+
+// Copyright 2026  agent
+// (based on nnet2bin/nnet-train-discriminative-parallel.cc; see that file for its authors)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "hmm/transition-model.h"
+#include "nnet2/am-nnet.h"
+#include "nnet2/nnet-param-server.h"
+
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet2;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Run a parameter server for asynchronous training of a neural network\n"
+        "by several workers, which are nnet-train-simple processes (possibly\n"
+        "on other machines) run with --param-server=<this-host>:<port>.  The\n"
+        "workers start from the parameters of <model-in>, and periodically send\n"
+        "their parameter changes, which are added to the master parameters.\n"
+        "When all <num-workers> workers have finished, the final model is\n"
+        "written to <model-out>.\n"
+        "\n"
+        "Usage:  nnet-param-server [options] <num-workers> <model-in> <model-out>\n"
+        "\n"
+        "e.g.:\n"
+        "nnet-param-server --port=5123 --delta-scale=0.25 4 1.mdl 2.mdl\n";
+
+    bool binary_write = true;
+    NnetParamServerConfig server_config;
+
+    ParseOptions po(usage);
+    po.Register("binary", &binary_write, "Write output in binary mode");
+    server_config.Register(&po);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 3) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    int32 num_workers;
+    std::string nnet_rxfilename = po.GetArg(2),
+        nnet_wxfilename = po.GetArg(3);
+    if (!ConvertStringToInteger(po.GetArg(1), &num_workers) || num_workers <= 0)
+      KALDI_ERR << "Invalid number of workers " << po.GetArg(1);
+
+    TransitionModel trans_model;
+    AmNnet am_nnet;
+    {
+      bool binary_read;
+      Input ki(nnet_rxfilename, &binary_read);
+      trans_model.Read(ki.Stream(), binary_read);
+      am_nnet.Read(ki.Stream(), binary_read);
+    }
+
+    {
+      NnetParamServer server(server_config, &(am_nnet.GetNnet()));
+      server.Serve(num_workers);
+    }
+
+    {
+      Output ko(nnet_wxfilename, binary_write);
+      trans_model.Write(ko.Stream(), binary_write);
+      am_nnet.Write(ko.Stream(), binary_write);
+    }
+    KALDI_LOG << "Wrote model to " << nnet_wxfilename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
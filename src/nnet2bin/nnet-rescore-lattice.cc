@@ -0,0 +1,143 @@
+// nnet2bin/nnet-rescore-lattice.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "hmm/transition-model.h"
+#include "fstext/fstext-lib.h"
+#include "lat/kaldi-lattice.h"
+#include "lat/lattice-functions.h"
+#include "nnet2/decodable-am-nnet.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet2;
+    typedef kaldi::int32 int32;
+    typedef kaldi::int64 int64;
+
+    const char *usage =
+        "Replace the acoustic scores on a lattice using a neural net model.\n"
+        "By default only the likelihoods that appear in the lattice are\n"
+        "computed and copied from the GPU (see --sparse).\n"
+        "Usage: nnet-rescore-lattice [options] <model-in> <lattice-rspecifier> "
+        "<feature-rspecifier> <lattice-wspecifier>\n"
+        " e.g.: nnet-rescore-lattice 1.mdl ark:1.lats scp:trn.scp ark:2.lats\n";
+
+    kaldi::BaseFloat old_acoustic_scale = 0.0;
+    bool sparse = true;
+    std::string use_gpu = "yes";
+    kaldi::ParseOptions po(usage);
+    po.Register("old-acoustic-scale", &old_acoustic_scale,
+                "Add in the scores in the input lattices with this scale, rather "
+                "than discarding them.");
+    po.Register("sparse", &sparse, "If true, work out the (frame, pdf-id) "
+                "pairs that appear in each lattice and compute only those "
+                "likelihoods; if false, compute all of them.");
+    po.Register("use-gpu", &use_gpu,
+                "yes|no|optional, only has effect if compiled with CUDA");
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 4) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().SelectGpuId(use_gpu);
+#endif
+
+    std::string model_filename = po.GetArg(1),
+        lats_rspecifier = po.GetArg(2),
+        feature_rspecifier = po.GetArg(3),
+        lats_wspecifier = po.GetArg(4);
+
+    TransitionModel trans_model;
+    AmNnet am_nnet;
+    {
+      bool binary;
+      Input ki(model_filename, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_nnet.Read(ki.Stream(), binary);
+    }
+
+    RandomAccessBaseFloatCuMatrixReader feature_reader(feature_rspecifier);
+    SequentialCompactLatticeReader compact_lattice_reader(lats_rspecifier);
+    CompactLatticeWriter compact_lattice_writer(lats_wspecifier);
+
+    int32 num_done = 0, num_err = 0;
+    int64 num_frames = 0, num_likes = 0;
+    for (; !compact_lattice_reader.Done(); compact_lattice_reader.Next()) {
+      std::string key = compact_lattice_reader.Key();
+      if (!feature_reader.HasKey(key)) {
+        KALDI_WARN << "No feature found for utterance " << key << ". Skipping";
+        num_err++;
+        continue;
+      }
+
+      CompactLattice clat = compact_lattice_reader.Value();
+      compact_lattice_reader.FreeCurrent();
+      if (old_acoustic_scale != 1.0)
+        fst::ScaleLattice(fst::AcousticLatticeScale(old_acoustic_scale), &clat);
+
+      const CuMatrix<BaseFloat> &feats = feature_reader.Value(key);
+      CuVector<BaseFloat> empty_spk_info;
+      bool ans;
+      if (sparse) {
+        // CompactLatticeFramePdfs() needs the lattice to be topologically
+        // sorted; RescoreCompactLattice() would sort it anyway.
+        if (clat.Properties(fst::kTopSorted, true) == 0 &&
+            !fst::TopSort(&clat)) {
+          KALDI_WARN << "Cycles detected in lattice for utterance " << key;
+          num_err++;
+          continue;
+        }
+        std::vector<std::pair<int32, int32> > frame_pdfs;
+        CompactLatticeFramePdfs(trans_model, clat, &frame_pdfs);
+        num_likes += frame_pdfs.size();
+        DecodableAmNnetSparse nnet_decodable(trans_model, am_nnet, feats,
+                                             empty_spk_info, frame_pdfs);
+        ans = RescoreCompactLattice(&nnet_decodable, &clat);
+      } else {
+        DecodableAmNnet nnet_decodable(trans_model, am_nnet, feats,
+                                       empty_spk_info);
+        ans = RescoreCompactLattice(&nnet_decodable, &clat);
+      }
+      if (ans) {
+        compact_lattice_writer.Write(key, clat);
+        num_done++;
+        num_frames += feats.NumRows();
+      } else num_err++;
+    }
+
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().PrintProfile();
+#endif
+    KALDI_LOG << "Done " << num_done << " lattices with errors on "
+              << num_err << ", #frames is " << num_frames;
+    if (sparse && num_frames > 0)
+      KALDI_LOG << "Computed an average of "
+                << (num_likes / static_cast<BaseFloat>(num_frames))
+                << " likelihoods per frame, out of " << trans_model.NumPdfs();
+    return (num_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -33,6 +33,8 @@ int main(int argc, char *argv[]) {
         "Copy examples (typically single frames) for neural network training,\n"
         "from the input to output, but randomly shuffle the order.  This program will keep\n"
         "all of the examples in memory at once, so don't give it too many.\n"
+        "(For an archive on disk, the training programs can instead read it\n"
+        "in a random order directly, using the rspecifier ark,shuffle:egs.ark).\n"
         "\n"
         "Usage:  nnet-shuffle-egs [options] <egs-rspecifier> <egs-wspecifier>\n"
         "\n"
@@ -67,8 +69,10 @@ int main(int argc, char *argv[]) {
       // Putting in an extra level of indirection here to avoid excessive
       // computation and memory demands when we have to resize the vector.
     
-      for (; !example_reader.Done(); example_reader.Next())
-        egs.push_back(new NnetExample(example_reader.Value()));
+      for (; !example_reader.Done(); example_reader.Next()) {
+        egs.push_back(new NnetExample());
+        egs.back()->Swap(&example_reader.Value());
+      }
       
       std::random_shuffle(egs.begin(), egs.end());
     } else {
@@ -77,12 +81,13 @@ int main(int argc, char *argv[]) {
       for (; !example_reader.Done(); example_reader.Next()) {
         int32 index = RandInt(0, buffer_size - 1);
         if (egs[index] == NULL) {
-          egs[index] = new NnetExample(example_reader.Value());
+          egs[index] = new NnetExample();
+          egs[index]->Swap(&example_reader.Value());
         } else {
           std::ostringstream ostr;
           ostr << num_done;
           example_writer.Write(ostr.str(), *(egs[index]));
-          *(egs[index]) = example_reader.Value();
+          egs[index]->Swap(&example_reader.Value());
           num_done++;
         }
       }      
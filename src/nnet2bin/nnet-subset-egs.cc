@@ -66,12 +66,13 @@ int main(int argc, char *argv[]) {
     int64 num_read = 0;
     for (; !example_reader.Done(); example_reader.Next()) {
       num_read++;
-      if (num_read <= n)
-        egs.push_back(example_reader.Value());
-      else {
+      if (num_read <= n) {
+        egs.resize(egs.size() + 1);
+        egs.back().Swap(&example_reader.Value());
+      } else {
         BaseFloat keep_prob = n / static_cast<BaseFloat>(num_read);
         if (WithProb(keep_prob)) { // With probability "keep_prob"
-          egs[RandInt(0, n-1)] = example_reader.Value();
+          egs[RandInt(0, n-1)].Swap(&example_reader.Value());
         }
       }
     }
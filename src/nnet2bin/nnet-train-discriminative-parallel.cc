@@ -36,8 +36,9 @@ int main(int argc, char *argv[]) {
         "Train the neural network parameters with a discriminative objective\n"
         "function (MMI, SMBR or MPFE).  This uses training examples prepared with\n"
         "nnet-get-egs-discriminative\n"
-        "This version uses multiple threads (but no GPU)"
-        "\n"
+        "This version uses multiple threads (but no GPU), unless --pipelined=true,\n"
+        "in which case the neural net computation is done in one thread (on the GPU\n"
+        "if --use-gpu=yes) and the lattice computation in --num-threads others.\n"
         "Usage:  nnet-train-discriminative-parallel [options] <model-in> <training-examples-in> <model-out>\n"
         "e.g.:\n"
         "nnet-train-discriminative-parallel --num-threads=8 1.nnet ark:1.degs 2.nnet\n";
@@ -45,11 +46,17 @@ int main(int argc, char *argv[]) {
     bool binary_write = true;
     std::string use_gpu = "yes";
     int32 num_threads = 1;
+    bool pipelined = false;
     NnetDiscriminativeUpdateOptions update_opts;
     
     ParseOptions po(usage);
     po.Register("binary", &binary_write, "Write output in binary mode");
     po.Register("num-threads", &num_threads, "Number of threads to use");
+    po.Register("pipelined", &pipelined, "If true, pipeline the computation "
+                "so the neural net computation for one example overlaps with "
+                "the lattice computation for previous ones.");
+    po.Register("use-gpu", &use_gpu, "yes|no|optional, only has effect if "
+                "compiled with CUDA and --pipelined=true");
     update_opts.Register(&po);
     
     po.Read(argc, argv);
@@ -59,6 +66,11 @@ int main(int argc, char *argv[]) {
       exit(1);
     }
     
+#if HAVE_CUDA==1
+    if (pipelined)
+      CuDevice::Instantiate().SelectGpuId(use_gpu);
+#endif
+
     std::string nnet_rxfilename = po.GetArg(1),
         examples_rspecifier = po.GetArg(2),
         nnet_wxfilename = po.GetArg(3);
@@ -77,9 +89,16 @@ int main(int argc, char *argv[]) {
     SequentialDiscriminativeNnetExampleReader example_reader(
         examples_rspecifier);
 
-    NnetDiscriminativeUpdateParallel(am_nnet, trans_model,
-                                     update_opts, num_threads, &example_reader,
-                                     &(am_nnet.GetNnet()), &stats);
+    if (pipelined)
+      NnetDiscriminativeUpdatePipelined(am_nnet, trans_model,
+                                        update_opts, num_threads,
+                                        &example_reader,
+                                        &(am_nnet.GetNnet()), &stats);
+    else
+      NnetDiscriminativeUpdateParallel(am_nnet, trans_model,
+                                       update_opts, num_threads,
+                                       &example_reader,
+                                       &(am_nnet.GetNnet()), &stats);
     {
       Output ko(nnet_wxfilename, binary_write);
       trans_model.Write(ko.Stream(), binary_write);
@@ -36,31 +36,39 @@ int main(int argc, char *argv[]) {
         "Train the neural network parameters using L-BFGS on a subset of data\n"
         "\n"
         "Usage:  nnet-train-lbfgs [options] <model-in> <training-examples-in> <model-out>\n"
+        "   or:  nnet-train-lbfgs --coordinator=<host:port> [options] <model-in> "
+        "<training-examples-in>\n"
+        "The second form is a worker of a distributed training (see --num-workers):\n"
+        "it computes the gradient on its examples for the coordinator.\n"
         "\n"
         "e.g.:\n"
         "nnet-randomize-frames [args] | nnet-train-lbfgs 1.nnet ark:- 2.nnet\n";
     
     bool binary_write = true;
     bool zero_stats = true;
+    std::string coordinator;
     NnetLbfgsTrainerConfig train_config;
     
     ParseOptions po(usage);
     po.Register("binary", &binary_write, "Write output in binary mode");
     po.Register("zero-stats", &zero_stats, "If true, zero occupation "
                 "counts stored with the neural net (only affects mixing up).");
+    po.Register("coordinator", &coordinator, "If set (host:port), act as a "
+                "worker for the nnet-train-lbfgs --num-workers process at "
+                "this address.");
 
     train_config.Register(&po);
     
     po.Read(argc, argv);
     
-    if (po.NumArgs() != 3) {
+    if (po.NumArgs() != (coordinator.empty() ? 3 : 2)) {
       po.PrintUsage();
       exit(1);
     }
     
     std::string nnet_rxfilename = po.GetArg(1),
         examples_rspecifier = po.GetArg(2),
-        nnet_wxfilename = po.GetArg(3);
+        nnet_wxfilename = (coordinator.empty() ? po.GetArg(3) : "");
 
 
     TransitionModel trans_model;
@@ -72,6 +80,16 @@ int main(int argc, char *argv[]) {
       am_nnet.Read(ki.Stream(), binary_read);
     }
 
+    if (!coordinator.empty()) {
+      std::vector<NnetExample> egs;
+      SequentialNnetExampleReader example_reader(examples_rspecifier);
+      for (; !example_reader.Done(); example_reader.Next())
+        egs.push_back(example_reader.Value());
+      ServeNnetLbfgsGradients(coordinator, train_config.minibatch_size, egs,
+                              &(am_nnet.GetNnet()));
+      return 0;
+    }
+
     if (zero_stats) am_nnet.GetNnet().ZeroStats();
 
     NnetLbfgsTrainer trainer(train_config);
@@ -93,7 +111,7 @@ int main(int argc, char *argv[]) {
     KALDI_LOG << "Finished training, processed " << num_examples
               << " training examples.  Wrote model to "
               << nnet_wxfilename;
-    return (num_examples == 0 ? 1 : 0);
+    return (num_examples == 0 && train_config.num_workers == 0 ? 1 : 0);
   } catch(const std::exception &e) {
     std::cerr << e.what() << '\n';
     return -1;
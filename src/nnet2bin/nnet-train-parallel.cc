@@ -23,6 +23,7 @@
 #include "nnet2/nnet-randomize.h"
 #include "nnet2/nnet-update-parallel.h"
 #include "nnet2/am-nnet.h"
+#include "thread/kaldi-numa.h"
 
 
 int main(int argc, char *argv[]) {
@@ -59,6 +60,9 @@ int main(int argc, char *argv[]) {
                 "implementation of BLAS, the actual number of threads may be larger.]");
     po.Register("minibatch-size", &minibatch_size, "Number of examples to use for "
                 "each minibatch during training.");
+    po.Register("numa-policy", &g_numa_policy, "Placement of the training "
+                "threads on NUMA nodes: none|spread|compact.  (The model is "
+                "shared and updated by all threads, so it is not replicated.)");
     
     po.Read(argc, argv);
     srand(srand_seed);
@@ -23,6 +23,7 @@
 #include "nnet2/nnet-randomize.h"
 #include "nnet2/train-nnet.h"
 #include "nnet2/am-nnet.h"
+#include "nnet2/nnet-param-server.h"
 
 
 int main(int argc, char *argv[]) {
@@ -42,13 +43,22 @@ int main(int argc, char *argv[]) {
         "Usage:  nnet-train-simple [options] <model-in> <training-examples-in> <model-out>\n"
         "\n"
         "e.g.:\n"
-        "nnet-randomize-frames [args] | nnet-train-simple 1.nnet ark:- 2.nnet\n";
+        "nnet-randomize-frames [args] | nnet-train-simple 1.nnet ark:- 2.nnet\n"
+        "or, to read the examples from an archive in a random order without\n"
+        "a separate shuffling pass (the order depends on --srand):\n"
+        "nnet-train-simple --srand=3 1.nnet ark,shuffle:egs.1.ark 2.nnet\n"
+        "With --write-output-sum, also writes the nnet outputs (posteriors) as\n"
+        "computed during training, summed over the examples, for use with\n"
+        "nnet-adjust-priors (after summing over jobs with vector-sum).\n";
     
     bool binary_write = true;
     bool zero_stats = true;
     int32 srand_seed = 0;
     std::string use_gpu = "yes";
     NnetSimpleTrainerConfig train_config;
+    std::string param_server;
+    int32 sync_interval = 1000;
+    std::string output_sum_wxfilename;
     
     ParseOptions po(usage);
     po.Register("binary", &binary_write, "Write output in binary mode");
@@ -59,6 +69,15 @@ int main(int argc, char *argv[]) {
                 "with l2-penalty != 0.0");
     po.Register("use-gpu", &use_gpu, "yes|no|optional, only has effect if compiled with CUDA"); 
     
+    po.Register("param-server", &param_server, "If set (host:port), train "
+                "as a worker of nnet-param-server: start from its parameters, "
+                "and exchange parameter changes with it periodically.");
+    po.Register("sync-interval", &sync_interval, "With --param-server, the "
+                "number of training examples between exchanges of parameters "
+                "with the server.");
+    po.Register("write-output-sum", &output_sum_wxfilename, "If set, write "
+                "to here the sum over the training examples of the nnet "
+                "output, as computed in training (for estimating priors).");
     train_config.Register(&po);
     
     po.Read(argc, argv);
@@ -90,16 +109,31 @@ int main(int argc, char *argv[]) {
       }
 
       if (zero_stats) am_nnet.GetNnet().ZeroStats();
+
+      NnetParamClient client;
+      if (param_server != "")
+        client.Connect(param_server, &(am_nnet.GetNnet()));
     
+      Vector<double> output_sum;
       { // want to make sure this object deinitializes before
         // we write the model, as it does something in the destructor.
         NnetSimpleTrainer trainer(train_config,
-                                  &(am_nnet.GetNnet()));
+                                  &(am_nnet.GetNnet()),
+                                  (output_sum_wxfilename != "" ?
+                                   &output_sum : NULL));
       
         SequentialNnetExampleReader example_reader(examples_rspecifier);
 
-        for (; !example_reader.Done(); example_reader.Next(), num_examples++)
+        for (; !example_reader.Done(); example_reader.Next(), num_examples++) {
           trainer.TrainOnExample(example_reader.Value());  // It all happens here!
+          if (param_server != "" && (num_examples + 1) % sync_interval == 0)
+            client.Sync(&(am_nnet.GetNnet()));
+        }
+      }
+
+      if (param_server != "") {
+        client.Sync(&(am_nnet.GetNnet()));
+        client.Disconnect();
       }
     
       {
@@ -107,6 +141,12 @@ int main(int argc, char *argv[]) {
         trans_model.Write(ko.Stream(), binary_write);
         am_nnet.Write(ko.Stream(), binary_write);
       }
+      if (output_sum_wxfilename != "") {
+        if (output_sum.Dim() == 0)  // no examples.
+          output_sum.Resize(am_nnet.GetNnet().OutputDim());
+        WriteKaldiObject(Vector<BaseFloat>(output_sum), output_sum_wxfilename,
+                         binary_write);
+      }
     }
 #if HAVE_CUDA==1
     CuDevice::Instantiate().PrintProfile();
@@ -20,6 +20,7 @@
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "nnet/nnet-nnet.h"
+#include "nnet/nnet-quantized-affine-transform.h"
 
 int main(int argc, char *argv[]) {
   try {
@@ -37,11 +38,13 @@ int main(int argc, char *argv[]) {
     bool binary_write = true;
     int32 remove_first_layers = 0;
     int32 remove_last_layers = 0;
+    bool quantize = false;
     
     ParseOptions po(usage);
     po.Register("binary", &binary_write, "Write output in binary mode");
     po.Register("remove-first-layers", &remove_first_layers, "Remove N first layers (Components) from the MLP");
     po.Register("remove-last-layers", &remove_last_layers, "Remove N last layers (Components) from the MLP");
+    po.Register("quantize", &quantize, "Convert <AffineTransform> components to 8-bit <QuantizedAffineTransform>, for faster forwarding on CPU (the result cannot be trained)");
 
     po.Read(argc, argv);
 
@@ -75,6 +78,17 @@ int main(int argc, char *argv[]) {
       }
     }
 
+    // optionally quantize the affine transforms
+    if (quantize) {
+      for (int32 c = 0; c < nnet.NumComponents(); c++) {
+        if (nnet.GetComponent(c).GetType() == Component::kAffineTransform) {
+          AffineTransform &affine =
+              dynamic_cast<AffineTransform&>(nnet.GetComponent(c));
+          nnet.SetComponent(c, new QuantizedAffineTransform(affine));
+        }
+      }
+    }
+
     // store the network
     {
       Output ko(model_out_filename, binary_write);
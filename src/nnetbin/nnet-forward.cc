@@ -25,6 +25,110 @@
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "util/timer.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+/// Does the forward pass for one or more utterances, to be run by a
+/// TaskSequencer: operator () does the computation, and the destructor
+/// writes the output.  If the task has several utterances, the outputs of
+/// the feature transform are concatenated and go through "nnet" in a single
+/// forward pass, which needs nnet.IsFrameLocal().
+class NnetForwardTask {
+ public:
+  NnetForwardTask(Nnet *nnet_transf, Nnet *nnet, PdfPrior *pdf_prior,
+                  bool apply_log, BaseFloatMatrixWriter *writer,
+                  RowCompressedMatrixWriter *compressed_writer):
+      nnet_transf_(nnet_transf), nnet_(nnet), pdf_prior_(pdf_prior),
+      apply_log_(apply_log), writer_(writer),
+      compressed_writer_(compressed_writer), num_frames_(0) { }
+
+  /// Takes the contents of "feats", leaving it empty.
+  void AddUtterance(const std::string &key, Matrix<BaseFloat> *feats) {
+    keys_.push_back(key);
+    feats_.resize(feats_.size() + 1);
+    feats_.back().Swap(feats);
+    num_frames_ += feats_.back().NumRows();
+  }
+
+  int32 NumUtterances() const { return keys_.size(); }
+  int32 NumFrames() const { return num_frames_; }
+
+  void operator () () {
+    // The feature transform may splice frames, so it is applied to each
+    // utterance separately.
+    std::vector<CuMatrix<BaseFloat> > feats_transf(feats_.size());
+    std::vector<int32> num_rows(feats_.size());
+    int32 tot_rows = 0;
+    for (size_t i = 0; i < feats_.size(); i++) {
+      CuMatrix<BaseFloat> feats(feats_[i]);
+      feats_[i].Resize(0, 0);
+      nnet_transf_->Feedforward(feats, &(feats_transf[i]));
+      num_rows[i] = feats_transf[i].NumRows();
+      tot_rows += num_rows[i];
+    }
+    CuMatrix<BaseFloat> nnet_out;
+    if (feats_transf.size() == 1) {
+      nnet_->Feedforward(feats_transf[0], &nnet_out);
+    } else {
+      CuMatrix<BaseFloat> nnet_in(tot_rows, feats_transf[0].NumCols(),
+                                  kUndefined);
+      for (int32 i = 0, row = 0; i < static_cast<int32>(feats_transf.size());
+           i++) {
+        nnet_in.RowRange(row, num_rows[i]).CopyFromMat(feats_transf[i]);
+        row += num_rows[i];
+      }
+      feats_transf.clear();
+      nnet_->Feedforward(nnet_in, &nnet_out);
+    }
+    // convert posteriors to log-posteriors
+    if (apply_log_) nnet_out.ApplyLog();
+    // subtract log-priors from log-posteriors to get quasi-likelihoods
+    if (pdf_prior_ != NULL) pdf_prior_->SubtractOnLogpost(&nnet_out);
+
+    // download from GPU, and split into utterances.
+    out_.resize(feats_.size());
+    KALDI_ASSERT(nnet_out.NumRows() == tot_rows);
+    for (int32 i = 0, row = 0; i < static_cast<int32>(out_.size()); i++) {
+      out_[i].Resize(num_rows[i], nnet_out.NumCols(), kUndefined);
+      nnet_out.RowRange(row, num_rows[i]).CopyToMat(&(out_[i]));
+      row += num_rows[i];
+      // check for NaN/inf
+      for (int32 r = 0; r < out_[i].NumRows(); r++) {
+        for (int32 c = 0; c < out_[i].NumCols(); c++) {
+          BaseFloat val = out_[i](r, c);
+          if (val != val) KALDI_ERR << "NaN in NNet output of : " << keys_[i];
+          if (val == std::numeric_limits<BaseFloat>::infinity())
+            KALDI_ERR << "inf in NNet coutput of : " << keys_[i];
+        }
+      }
+    }
+  }
+
+  ~NnetForwardTask() {
+    for (size_t i = 0; i < out_.size(); i++) {
+      if (compressed_writer_ != NULL)
+        compressed_writer_->Write(keys_[i], RowCompressedMatrix(out_[i]));
+      else
+        writer_->Write(keys_[i], out_[i]);
+    }
+  }
+ private:
+  Nnet *nnet_transf_;
+  Nnet *nnet_;
+  PdfPrior *pdf_prior_;  // NULL if not subtracting log-priors.
+  bool apply_log_;
+  BaseFloatMatrixWriter *writer_;
+  RowCompressedMatrixWriter *compressed_writer_;  // used instead, if non-NULL.
+  std::vector<std::string> keys_;
+  std::vector<Matrix<BaseFloat> > feats_;
+  std::vector<Matrix<BaseFloat> > out_;
+  int32 num_frames_;
+};
+
+}  // namespace nnet1
+}  // namespace kaldi
 
 
 int main(int argc, char *argv[]) {
@@ -51,6 +155,15 @@ int main(int argc, char *argv[]) {
     bool apply_log = false;
     po.Register("apply-log", &apply_log, "Transform MLP output to logscale");
 
+    bool compress = false;
+    po.Register("compress", &compress, "If true, write the output in row-compressed form (about 1 byte per element; lossy), for use with e.g. latgen-faster-mapped --compressed-loglikes=true");
+
+    int32 batch_frames = 0;
+    po.Register("batch-frames", &batch_frames, "If > 0, put consecutive utterances together in one forward pass through the nnet, up to about this many frames (the feature transform is still applied per utterance).  Ignored if the nnet has components that look across frames, e.g. <Splice> or <SentenceAveragingComponent>");
+
+    bool pipeline = false;
+    po.Register("pipeline", &pipeline, "If true, do the forward pass in a separate thread, so that reading the next utterances and writing the output overlap with it");
+
     std::string use_gpu="no";
     po.Register("use-gpu", &use_gpu, "yes|no|optional, only has effect if compiled with CUDA"); 
 
@@ -103,14 +216,29 @@ int main(int argc, char *argv[]) {
     }
 
 
+    if (batch_frames > 0 && !nnet.IsFrameLocal()) {
+      KALDI_WARN << "Nnet " << model_filename << " has components that look "
+                 << "across frames; ignoring --batch-frames=" << batch_frames;
+      batch_frames = 0;
+    }
+
     kaldi::int64 tot_t = 0;
 
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
-    BaseFloatMatrixWriter feature_writer(feature_wspecifier);
-
-    CuMatrix<BaseFloat> feats, feats_transf, nnet_out;
-    Matrix<BaseFloat> nnet_out_host;
+    BaseFloatMatrixWriter feature_writer;
+    RowCompressedMatrixWriter compressed_writer;
+    if (compress) compressed_writer.Open(feature_wspecifier);
+    else feature_writer.Open(feature_wspecifier);
 
+    // Only one task computes at a time, as they share the nnets; the others
+    // are being read or written.
+    TaskSequencerConfig sequencer_config;
+    sequencer_config.num_threads = 1;
+    sequencer_config.num_threads_total = 3;
+    TaskSequencer<NnetForwardTask> sequencer(sequencer_config);
+    bool subtract_prior = (prior_opts.class_frame_counts != "" &&
+                           (no_softmax || apply_log));
+    NnetForwardTask *task = NULL;
 
     Timer time;
     double time_now = 0;
@@ -118,54 +246,23 @@ int main(int argc, char *argv[]) {
     // iterate over all feature files
     for (; !feature_reader.Done(); feature_reader.Next()) {
       // read
-      const Matrix<BaseFloat> &mat = feature_reader.Value();
+      std::string key = feature_reader.Key();
+      Matrix<BaseFloat> mat(feature_reader.Value());
+      feature_reader.FreeCurrent();
       KALDI_VLOG(2) << "Processing utterance " << num_done+1 
-                    << ", " << feature_reader.Key() 
+                    << ", " << key 
                     << ", " << mat.NumRows() << "frm";
 
       //check for NaN/inf
       for (int32 r = 0; r<mat.NumRows(); r++) {
         for (int32 c = 0; c<mat.NumCols(); c++) {
           BaseFloat val = mat(r,c);
-          if (val != val) KALDI_ERR << "NaN in features of : " << feature_reader.Key();
-          if (val == std::numeric_limits<BaseFloat>::infinity())
-            KALDI_ERR << "inf in features of : " << feature_reader.Key();
-        }
-      }
-
-      // push it to gpu
-      feats = mat;
-      // fwd-pass
-      nnet_transf.Feedforward(feats, &feats_transf);
-      nnet.Feedforward(feats_transf, &nnet_out);
-      
-      // convert posteriors to log-posteriors
-      if (apply_log) {
-        nnet_out.ApplyLog();
-      }
-     
-      // subtract log-priors from log-posteriors to get quasi-likelihoods
-      if (prior_opts.class_frame_counts != "" && (no_softmax || apply_log)) {
-        pdf_prior.SubtractOnLogpost(&nnet_out);
-      }
-     
-      //download from GPU
-      nnet_out_host.Resize(nnet_out.NumRows(), nnet_out.NumCols());
-      nnet_out.CopyToMat(&nnet_out_host);
-
-      //check for NaN/inf
-      for (int32 r = 0; r < nnet_out_host.NumRows(); r++) {
-        for (int32 c = 0; c < nnet_out_host.NumCols(); c++) {
-          BaseFloat val = nnet_out_host(r,c);
-          if (val != val) KALDI_ERR << "NaN in NNet output of : " << feature_reader.Key();
+          if (val != val) KALDI_ERR << "NaN in features of : " << key;
           if (val == std::numeric_limits<BaseFloat>::infinity())
-            KALDI_ERR << "inf in NNet coutput of : " << feature_reader.Key();
+            KALDI_ERR << "inf in features of : " << key;
         }
       }
 
-      // write
-      feature_writer.Write(feature_reader.Key(), nnet_out_host);
-
       // progress log
       if (num_done % 100 == 0) {
         time_now = time.Elapsed();
@@ -175,7 +272,25 @@ int main(int argc, char *argv[]) {
       }
       num_done++;
       tot_t += mat.NumRows();
+
+      if (task != NULL &&
+          task->NumFrames() + mat.NumRows() > batch_frames) {
+        if (pipeline) sequencer.Run(task);
+        else { (*task)(); delete task; }
+        task = NULL;
+      }
+      if (task == NULL)
+        task = new NnetForwardTask(&nnet_transf, &nnet,
+                                   (subtract_prior ? &pdf_prior : NULL),
+                                   apply_log, &feature_writer,
+                                   (compress ? &compressed_writer : NULL));
+      task->AddUtterance(key, &mat);
+    }
+    if (task != NULL) {
+      if (pipeline) sequencer.Run(task);
+      else { (*task)(); delete task; }
     }
+    sequencer.Wait();
     
     // final message
     KALDI_LOG << "Done " << num_done << " files" 
@@ -40,8 +40,9 @@ int main(int argc, char *argv[]) {
     int32 n_kl_states = 0;
     po.Register("binary", &binary, "Write output in binary mode");
     po.Register("nkl-states", &n_kl_states, "Number of states in Kl-HMM");
+    std::string use_gpu="no";
+    po.Register("use-gpu", &use_gpu, "yes|no|optional, only has effect if compiled with CUDA"); 
 
-    
     po.Read(argc, argv);
 
     if (po.NumArgs() != 3) {
@@ -57,6 +58,10 @@ int main(int argc, char *argv[]) {
     using namespace kaldi::nnet1;
     typedef kaldi::int32 int32;
 
+#if HAVE_CUDA==1
+    CuDevice::Instantiate().SelectGpuId(use_gpu);
+#endif
+
     kaldi::int64 total_frames = 0;
 
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
@@ -64,6 +69,7 @@ int main(int argc, char *argv[]) {
     int32 posterior_dim = feature_reader.Value().NumCols();
     KlHmm kl_hmm(posterior_dim,n_kl_states);
 
+    CuMatrix<BaseFloat> cu_mat;
     int32 num_done = 0, num_no_alignment = 0, num_other_error = 0;
     for (; !feature_reader.Done(); feature_reader.Next()) {
       std::string utt = feature_reader.Key();
@@ -81,8 +87,10 @@ int main(int argc, char *argv[]) {
           continue;
         }
 
-        // Accumulate the statistics
-        kl_hmm.Accumulate(mat, alignment);  
+        // Accumulate the statistics (on the GPU, if there is one)
+        cu_mat.Resize(mat.NumRows(), mat.NumCols(), kUndefined);
+        cu_mat.CopyFromMat(mat);
+        kl_hmm.Accumulate(cu_mat, alignment);
         // log
 	KALDI_VLOG(2) << "utt " << utt << ", frames " << alignment.size();
         total_frames += mat.NumRows();
@@ -100,6 +108,12 @@ int main(int argc, char *argv[]) {
       kl_hmm.WriteData(out.Stream(), binary);
     }
 
+#if HAVE_CUDA==1
+    if (kaldi::g_kaldi_verbose_level >= 1) {
+      CuDevice::Instantiate().PrintProfile();
+    }
+#endif
+
     return 0;
   } catch(const std::exception &e) {
     std::cerr << e.what();
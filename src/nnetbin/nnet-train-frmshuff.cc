@@ -19,10 +19,112 @@
 #include "nnet/nnet-nnet.h"
 #include "nnet/nnet-loss.h"
 #include "nnet/nnet-randomizer.h"
+#include "nnet/nnet-pdf-prior.h"
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
 #include "util/timer.h"
 #include "cudamatrix/cu-device.h"
+#include "cudamatrix/cu-matrix-uploader.h"
+#include "thread/kaldi-thread.h"
+#include "thread/kaldi-mutex.h"
+
+namespace kaldi {
+namespace nnet1 {
+
+// A copy of one minibatch from the randomizers, for multi-threaded training.
+struct Minibatch {
+  CuMatrix<BaseFloat> feats;
+  Posterior targets;
+  Vector<BaseFloat> weights;
+};
+
+// This class is used with --num-threads > 1: thread t trains the nnet
+// (*nnets)[t] on minibatches t, t + num-threads, t + 2 * num-threads, ...  of
+// "minibatches".  The objective function is evaluated (and the outputs are
+// added to "prior_acc", if not NULL) while holding "mutex", so that the
+// statistics are accumulated in a single object.
+// (*nnets)[t] is copied from "initial_nnet" by thread t itself the first time,
+// so that with "pin_threads" (thread t always runs on the same CPU) its memory
+// is on the NUMA node of that CPU.
+class MinibatchTrainer: public MultiThreadable {
+ public:
+  MinibatchTrainer(const std::vector<Minibatch> &minibatches,
+                   const std::string &objective_function, bool crossvalidate,
+                   const Nnet &initial_nnet, bool pin_threads,
+                   std::vector<Nnet> *nnets, Xent *xent, Mse *mse,
+                   PdfPriorAccumulator *prior_acc, Mutex *mutex):
+      minibatches_(minibatches), objective_function_(objective_function),
+      crossvalidate_(crossvalidate), initial_nnet_(initial_nnet),
+      pin_threads_(pin_threads), nnets_(nnets), xent_(xent), mse_(mse),
+      prior_acc_(prior_acc), mutex_(mutex) { }
+
+  void operator () () {
+    if (pin_threads_ && !PinThreadToCpu(thread_id_))
+      KALDI_WARN << "Could not pin thread " << thread_id_ << " to a CPU.";
+    Nnet &nnet = (*nnets_)[thread_id_];
+    if (nnet.NumComponents() == 0) nnet = initial_nnet_;
+    CuMatrix<BaseFloat> nnet_out, obj_diff;
+    for (size_t i = thread_id_; i < minibatches_.size(); i += num_threads_) {
+      const Minibatch &minibatch = minibatches_[i];
+      nnet.Propagate(minibatch.feats, &nnet_out);
+      mutex_->Lock();
+      if (objective_function_ == "xent") {
+        xent_->Eval(nnet_out, minibatch.targets, &obj_diff);
+      } else {
+        mse_->Eval(nnet_out, minibatch.targets, &obj_diff);
+      }
+      if (prior_acc_ != NULL) prior_acc_->Accumulate(nnet_out);
+      mutex_->Unlock();
+      if (!crossvalidate_) {
+        obj_diff.MulRowsVec(CuVector<BaseFloat>(minibatch.weights));
+        nnet.Backpropagate(obj_diff, NULL);
+      }
+    }
+    if (pin_threads_) UnpinThread();
+  }
+
+ private:
+  const std::vector<Minibatch> &minibatches_;
+  std::string objective_function_;
+  bool crossvalidate_;
+  const Nnet &initial_nnet_;
+  bool pin_threads_;
+  std::vector<Nnet> *nnets_;
+  Xent *xent_;
+  Mse *mse_;
+  PdfPriorAccumulator *prior_acc_;
+  Mutex *mutex_;
+};
+
+// Trains the copies of the nnet in "nnets" on the minibatches in parallel (see
+// MinibatchTrainer), and then sets each of them to their average.
+void TrainAndAverage(const std::vector<Minibatch> &minibatches,
+                     const std::string &objective_function, bool crossvalidate,
+                     const Nnet &initial_nnet, bool pin_threads,
+                     std::vector<Nnet> *nnets, Xent *xent, Mse *mse,
+                     PdfPriorAccumulator *prior_acc) {
+  Mutex mutex;
+  int32 num_threads = nnets->size();
+  {  // The destructor of "m" waits for the threads.
+    MinibatchTrainer trainer(minibatches, objective_function, crossvalidate,
+                             initial_nnet, pin_threads, nnets, xent, mse,
+                             prior_acc, &mutex);
+    MultiThreader<MinibatchTrainer> m(num_threads, trainer);
+  }
+  if (crossvalidate) return;
+  Vector<BaseFloat> average, weights;
+  (*nnets)[0].GetWeights(&average);
+  for (int32 i = 1; i < num_threads; i++) {
+    (*nnets)[i].GetWeights(&weights);
+    average.AddVec(1.0, weights);
+  }
+  average.Scale(1.0 / num_threads);
+  for (int32 i = 0; i < num_threads; i++)
+    (*nnets)[i].SetWeights(average);
+}
+
+}  // namespace nnet1
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   using namespace kaldi;
@@ -62,8 +164,17 @@ int main(int argc, char *argv[]) {
     std::string frame_weights;
     po.Register("frame-weights", &frame_weights, "Per-frame weights to scale gradients (frame selection/weighting).");
 
+    std::string class_frame_counts_wxfilename;
+    po.Register("write-class-frame-counts", &class_frame_counts_wxfilename, "If set, write to here the sum over the frames of the nnet outputs (pdf posteriors) computed in the forward passes, usable as --class-frame-counts in nnet-forward; with --cross-validate they come from the final model on the held-out data, so no separate pass with analyze-counts is needed");
+
     std::string use_gpu="yes";
     po.Register("use-gpu", &use_gpu, "yes|no|optional, only has effect if compiled with CUDA"); 
+
+    int32 num_threads = 1, average_interval = 20;
+    po.Register("num-threads", &num_threads, "Number of threads for data-parallel training on CPU; each thread trains its own copy of the nnet on a share of the minibatches, and the copies are averaged periodically (requires --use-gpu=no, and only AffineTransform as the updatable components)");
+    po.Register("average-interval", &average_interval, "With --num-threads > 1, the number of minibatches each thread processes between averagings of the nnets");
+    bool pin_threads = false;
+    po.Register("pin-threads", &pin_threads, "With --num-threads > 1, pin each training thread to its own CPU, keeping the memory of its copy of the nnet on the CPU's NUMA node (use when the machine is not shared with other jobs)");
     
     po.Read(argc, argv);
 
@@ -100,6 +211,21 @@ int main(int argc, char *argv[]) {
     nnet.Read(model_filename);
     nnet.SetTrainOptions(trn_opts);
 
+    KALDI_ASSERT(num_threads >= 1 && average_interval >= 1);
+    // The copies of the nnet for multi-threaded training, made by the threads
+    // on first use; the first is copied to "nnet" at the end.
+    std::vector<Nnet> nnet_copies;
+    std::vector<Minibatch> minibatches;
+    if (num_threads > 1) {
+#if HAVE_CUDA==1
+      if (CuDevice::Instantiate().Enabled())
+        KALDI_ERR << "--num-threads > 1 is not supported when using a GPU.";
+#endif
+      if (objective_function != "xent" && objective_function != "mse")
+        KALDI_ERR << "Unknown objective function code : " << objective_function;
+      nnet_copies.resize(num_threads);
+    }
+
     kaldi::int64 total_frames = 0;
 
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
@@ -116,8 +242,14 @@ int main(int argc, char *argv[]) {
 
     Xent xent;
     Mse mse;
+    PdfPriorAccumulator prior_acc;
+    PdfPriorAccumulator *prior_acc_ptr =
+        (class_frame_counts_wxfilename != "" ? &prior_acc : NULL);
     
-    CuMatrix<BaseFloat> feats_transf, nnet_out, obj_diff;
+    CuMatrix<BaseFloat> feats, feats_transf, nnet_out, obj_diff;
+    // Uploads the features asynchronously (if using a GPU), so the host can
+    // go on reading the next utterance during the copy.
+    CuMatrixUploader<BaseFloat> uploader;
 
     Timer time;
     KALDI_LOG << (crossvalidate?"CROSS-VALIDATION":"TRAINING") << " STARTED";
@@ -174,7 +306,8 @@ int main(int argc, char *argv[]) {
           }
         }
         // apply optional feature transform
-        nnet_transf.Feedforward(CuMatrix<BaseFloat>(mat), &feats_transf);
+        uploader.Upload(mat, &feats);
+        nnet_transf.Feedforward(feats, &feats_transf);
 
         // pass data to randomizers
         KALDI_ASSERT(feats_transf.NumRows() == targets.size());
@@ -212,8 +345,26 @@ int main(int argc, char *argv[]) {
         const Posterior& nnet_tgt = targets_randomizer.Value();
         const Vector<BaseFloat>& frm_weights = weights_randomizer.Value();
 
+        if (num_threads > 1) {
+          // collect the minibatches, and process them in parallel
+          minibatches.resize(minibatches.size() + 1);
+          minibatches.back().feats = nnet_in;
+          minibatches.back().targets = nnet_tgt;
+          minibatches.back().weights = frm_weights;
+          total_frames += nnet_in.NumRows();
+          if (minibatches.size() ==
+              static_cast<size_t>(num_threads * average_interval)) {
+            TrainAndAverage(minibatches, objective_function, crossvalidate,
+                            nnet, pin_threads, &nnet_copies, &xent, &mse,
+                            prior_acc_ptr);
+            minibatches.clear();
+          }
+          continue;
+        }
+
         // forward pass
         nnet.Propagate(nnet_in, &nnet_out);
+        if (prior_acc_ptr != NULL) prior_acc.Accumulate(nnet_out);
 
         // evaluate objective function we've chosen
         if (objective_function == "xent") {
@@ -257,6 +408,15 @@ int main(int argc, char *argv[]) {
       }
     }
     
+    if (num_threads > 1) {
+      if (!minibatches.empty())
+        TrainAndAverage(minibatches, objective_function, crossvalidate,
+                        nnet, pin_threads, &nnet_copies, &xent, &mse,
+                        prior_acc_ptr);
+      if (nnet_copies[0].NumComponents() > 0)  // if any training was done
+        nnet = nnet_copies[0];
+    }
+    
     // after last minibatch : show what happens in network 
     if (kaldi::g_kaldi_verbose_level >= 1) { // vlog-1
       KALDI_VLOG(1) << "### After " << total_frames << " frames,";
@@ -270,6 +430,7 @@ int main(int argc, char *argv[]) {
     if (!crossvalidate) {
       nnet.Write(target_model_filename, binary);
     }
+    if (prior_acc_ptr != NULL) prior_acc.Write(class_frame_counts_wxfilename);
 
     KALDI_LOG << "Done " << num_done << " files, " << num_no_tgt_mat
               << " with no tgt_mats, " << num_other_error
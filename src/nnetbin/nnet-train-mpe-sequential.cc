@@ -34,8 +34,11 @@
 #include "nnet/nnet-nnet.h"
 #include "nnet/nnet-pdf-prior.h"
 #include "util/timer.h"
+#include "thread/kaldi-thread.h"
 #include "cudamatrix/cu-device.h"
 
+#include <algorithm>
+
 
 namespace kaldi {
 namespace nnet1 {
@@ -76,6 +79,167 @@ void LatticeAcousticRescore(const Matrix<BaseFloat> &log_like,
   }
 }
 
+/// The inputs of one utterance of sequence training: the features, the
+/// reference alignment and the denominator lattice, the lattice already
+/// scaled by --old-acoustic-scale, topologically sorted and with its state
+/// times computed.
+struct SequenceExample {
+  std::string utt;
+  Matrix<BaseFloat> feats;
+  std::vector<int32> ali;
+  Lattice den_lat;
+  std::vector<int32> state_times;
+
+  void Swap(SequenceExample *other) {
+    utt.swap(other->utt);
+    feats.Swap(&other->feats);
+    ali.swap(other->ali);
+    std::swap(den_lat, other->den_lat);  // VectorFst copies are shallow.
+    state_times.swap(other->state_times);
+  }
+};
+
+/// Reads the utterances and prepares their lattices, skipping (with a
+/// warning) the ones that cannot be used.  If "prefetch" is true, the next
+/// utterance is read and prepared in a background thread while the caller
+/// trains on the current one; this does not change the result.
+class SequenceExampleReader {
+ public:
+  SequenceExampleReader(const std::string &feature_rspecifier,
+                        const std::string &den_lat_rspecifier,
+                        const std::string &ali_rspecifier,
+                        BaseFloat old_acoustic_scale, int32 max_frames,
+                        bool prefetch):
+      feature_reader_(feature_rspecifier),
+      den_lat_reader_(den_lat_rspecifier), ali_reader_(ali_rspecifier),
+      old_acoustic_scale_(old_acoustic_scale), max_frames_(max_frames),
+      prefetch_(prefetch), have_next_(false), num_no_ali_(0),
+      num_no_den_lat_(0), num_other_error_(0) {
+    StartReading();
+  }
+
+  /// Gets the next usable utterance; returns false when there are no more.
+  bool Next(SequenceExample *ex) {
+    group_.Wait();
+    if (error_ != "")
+      KALDI_ERR << error_;
+    if (!have_next_) return false;
+    ex->Swap(&next_);
+    StartReading();
+    return true;
+  }
+
+  ~SequenceExampleReader() { group_.Wait(); }
+
+  int32 NumNoAli() const { return num_no_ali_; }
+  int32 NumNoDenLat() const { return num_no_den_lat_; }
+  int32 NumOtherError() const { return num_other_error_; }
+
+ private:
+  void StartReading() {
+    if (prefetch_)
+      MultiThreadPool::Instantiate().Run(Run, this, &group_);
+    else
+      Run(this);
+  }
+
+  static void *Run(void *this_in) {
+    SequenceExampleReader *reader =
+        static_cast<SequenceExampleReader*>(this_in);
+    try {
+      reader->ReadNext();
+    } catch (const std::exception &e) {
+      // Rethrown by Next(), in the calling thread.
+      reader->have_next_ = false;
+      reader->error_ = e.what();
+    }
+    return NULL;
+  }
+
+  void ReadNext() {
+    have_next_ = false;
+    for (; !feature_reader_.Done(); feature_reader_.Next()) {
+      std::string utt = feature_reader_.Key();
+      if (!den_lat_reader_.HasKey(utt)) {
+        KALDI_WARN << "Utterance " << utt << ": found no lattice.";
+        num_no_den_lat_++;
+        continue;
+      }
+      if (!ali_reader_.HasKey(utt)) {
+        KALDI_WARN << "Utterance " << utt << ": found no reference alignment.";
+        num_no_ali_++;
+        continue;
+      }
+      const Matrix<BaseFloat> &mat = feature_reader_.Value();
+      const std::vector<int32> &ali = ali_reader_.Value(utt);
+      // check for temporal length of the alignment
+      if (static_cast<MatrixIndexT>(ali.size()) != mat.NumRows()) {
+        KALDI_WARN << "Numerator alignment has wrong length "
+                   << ali.size() << " vs. "<< mat.NumRows();
+        num_other_error_++;
+        continue;
+      }
+      if (mat.NumRows() > max_frames_) {
+        KALDI_WARN << "Utterance " << utt << ": Skipped because it has "
+                   << mat.NumRows() << " frames, which is more than "
+                   << max_frames_ << ".";
+        num_other_error_++;
+        continue;
+      }
+      // get the denominator lattice, preprocess
+      // (a deep copy: a shallow one would share its reference count with the
+      // reader's copy, which this thread may free while the caller
+      // modifies the lattice.)
+      const fst::Fst<LatticeArc> &lat_in = den_lat_reader_.Value(utt);
+      Lattice &den_lat = next_.den_lat;
+      den_lat = Lattice(lat_in);
+      if (den_lat.Start() == -1) {
+        KALDI_WARN << "Empty lattice for utt " << utt;
+        num_other_error_++;
+        continue;
+      }
+      if (old_acoustic_scale_ != 1.0) {
+        fst::ScaleLattice(fst::AcousticLatticeScale(old_acoustic_scale_),
+                          &den_lat);
+      }
+      // optional sort it topologically
+      kaldi::uint64 props = den_lat.Properties(fst::kFstProperties, false);
+      if (!(props & fst::kTopSorted)) {
+        if (fst::TopSort(&den_lat) == false)
+          KALDI_ERR << "Cycles detected in lattice.";
+      }
+      // get the lattice length and times of states
+      int32 max_time = kaldi::LatticeStateTimes(den_lat, &next_.state_times);
+      // check for temporal length of denominator lattices
+      if (max_time != mat.NumRows()) {
+        KALDI_WARN << "Denominator lattice has wrong length "
+                   << max_time << " vs. " << mat.NumRows();
+        num_other_error_++;
+        continue;
+      }
+      next_.utt = utt;
+      next_.feats = mat;
+      next_.ali = ali;
+      have_next_ = true;
+      feature_reader_.Next();
+      return;
+    }
+  }
+
+  SequentialBaseFloatMatrixReader feature_reader_;
+  RandomAccessLatticeReader den_lat_reader_;
+  RandomAccessInt32VectorReader ali_reader_;
+  BaseFloat old_acoustic_scale_;
+  int32 max_frames_;
+  bool prefetch_;
+
+  ThreadGroup group_;  // for the background reading.
+  SequenceExample next_;
+  bool have_next_;
+  std::string error_;
+  int32 num_no_ali_, num_no_den_lat_, num_other_error_;
+};
+
 }  // namespace nnet1
 }  // namespace kaldi
 
@@ -129,6 +293,11 @@ int main(int argc, char *argv[]) {
     po.Register("do-smbr", &do_smbr, "Use state-level accuracies instead of "
                 "phone accuracies.");
 
+    bool prefetch = true;
+    po.Register("prefetch", &prefetch, "If true, read the next utterance and "
+                "prepare its lattice in a background thread, while training on "
+                "the current one");
+
     std::string use_gpu="yes";
     po.Register("use-gpu", &use_gpu, "yes|no|optional, only has effect if compiled with CUDA");
      
@@ -185,9 +354,9 @@ int main(int argc, char *argv[]) {
     TransitionModel trans_model;
     ReadKaldiObject(transition_model_filename, &trans_model);
 
-    SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
-    RandomAccessLatticeReader den_lat_reader(den_lat_rspecifier);
-    RandomAccessInt32VectorReader ref_ali_reader(ref_ali_rspecifier);
+    SequenceExampleReader example_reader(feature_rspecifier, den_lat_rspecifier,
+                                         ref_ali_rspecifier, old_acoustic_scale,
+                                         max_frames, prefetch);
 
     CuMatrix<BaseFloat> feats, feats_transf, nnet_out, nnet_diff;
     Matrix<BaseFloat> nnet_out_h, nnet_diff_h;
@@ -196,69 +365,21 @@ int main(int argc, char *argv[]) {
     double time_now = 0;
     KALDI_LOG << "TRAINING STARTED";
 
-    int32 num_done = 0, num_no_ref_ali = 0, num_no_den_lat = 0,
-      num_other_error = 0;
+    int32 num_done = 0;
 
     kaldi::int64 total_frames = 0;
     double total_frame_acc = 0.0, utt_frame_acc;
 
     // do per-utterance processing
-    for (; !feature_reader.Done(); feature_reader.Next()) {
-      std::string utt = feature_reader.Key();
-      if (!den_lat_reader.HasKey(utt)) {
-        KALDI_WARN << "Utterance " << utt << ": found no lattice.";
-        num_no_den_lat++;
-        continue;
-      }
-      if (!ref_ali_reader.HasKey(utt)) {
-        KALDI_WARN << "Utterance " << utt << ": found no reference alignment.";
-        num_no_ref_ali++;
-        continue;
-      }
-
-      // 1) get the features, numerator alignment
-      const Matrix<BaseFloat> &mat = feature_reader.Value();
-      const std::vector<int32> &ref_ali = ref_ali_reader.Value(utt);
-      // check for temporal length of numerator alignments
-      if (static_cast<MatrixIndexT>(ref_ali.size()) != mat.NumRows()) {
-        KALDI_WARN << "Numerator alignment has wrong length "
-                   << ref_ali.size() << " vs. "<< mat.NumRows();
-        num_other_error++;
-        continue;
-      }
-      if (mat.NumRows() > max_frames) {
-	KALDI_WARN << "Utterance " << utt << ": Skipped because it has " << mat.NumRows() << 
-	  " frames, which is more than " << max_frames << ".";
-	num_other_error++;
-	continue;
-      }
-      // 2) get the denominator lattice, preprocess
-      Lattice den_lat = den_lat_reader.Value(utt);
-      if (den_lat.Start() == -1) {
-        KALDI_WARN << "Empty lattice for utt " << utt;
-        num_other_error++;
-        continue;
-      }
-      if (old_acoustic_scale != 1.0) {
-        fst::ScaleLattice(fst::AcousticLatticeScale(old_acoustic_scale),
-                          &den_lat);
-      }
-      // optional sort it topologically
-      kaldi::uint64 props = den_lat.Properties(fst::kFstProperties, false);
-      if (!(props & fst::kTopSorted)) {
-        if (fst::TopSort(&den_lat) == false)
-          KALDI_ERR << "Cycles detected in lattice.";
-      }
-      // get the lattice length and times of states
-      vector<int32> state_times;
-      int32 max_time = kaldi::LatticeStateTimes(den_lat, &state_times);
-      // check for temporal length of denominator lattices
-      if (max_time != mat.NumRows()) {
-        KALDI_WARN << "Denominator lattice has wrong length "
-                   << max_time << " vs. " << mat.NumRows();
-        num_other_error++;
-        continue;
-      }
+    SequenceExample ex;
+    while (example_reader.Next(&ex)) {
+      // 1) the features, reference alignment and the preprocessed
+      // denominator lattice, from the example reader
+      const std::string &utt = ex.utt;
+      const Matrix<BaseFloat> &mat = ex.feats;
+      const std::vector<int32> &ref_ali = ex.ali;
+      Lattice &den_lat = ex.den_lat;
+      const std::vector<int32> &state_times = ex.state_times;
 
       // get actual dims for this utt and nnet
       int32 num_frames = mat.NumRows(),
@@ -349,9 +470,9 @@ int main(int argc, char *argv[]) {
               << (total_frames/time_now) << " frames per second.";
 
     KALDI_LOG << "Done " << num_done << " files, "
-              << num_no_ref_ali << " with no reference alignments, "
-              << num_no_den_lat << " with no lattices, "
-              << num_other_error << " with other errors.";
+              << example_reader.NumNoAli() << " with no reference alignments, "
+              << example_reader.NumNoDenLat() << " with no lattices, "
+              << example_reader.NumOtherError() << " with other errors.";
 
     KALDI_LOG << "Overall average frame-accuracy is "
               << (total_frame_acc/total_frames) << " over " << total_frames
@@ -36,7 +36,8 @@ int main(int argc, char *argv[]) {
   try {
     const char *usage =
         "Train RBM by Contrastive Divergence alg. with 1 step of "
-        "Markov Chain Monte-Carlo.\n"
+        "Markov Chain Monte-Carlo\n"
+        "(or --cd-k steps, optionally persistent: --persistent-cd=true).\n"
         "The tool can perform several iterations (--num-iters) "
         "or it can subsample the training dataset (--drop-data)\n"
         "Usage:  rbm-train-cd1-frmshuff [options] <model-in> <feature-rspecifier> <model-out>\n"
@@ -62,6 +63,9 @@ int main(int argc, char *argv[]) {
     std::string feature_transform;
     po.Register("feature-transform", &feature_transform, "Feature transform in Nnet format");
 
+    RbmCdOptions cd_opts;
+    cd_opts.Register(&po);
+
     NnetDataRandomizerOptions rnd_opts;
     rnd_opts.minibatch_size = 100;
     rnd_opts.Register(&po);
@@ -129,12 +133,10 @@ int main(int argc, char *argv[]) {
     RandomizerMask randomizer_mask(rnd_opts);
     MatrixRandomizer feature_randomizer(rnd_opts);
 
-    CuRand<BaseFloat> cu_rand; // parallel random number generator
+    RbmCdTrainer cd_trainer(cd_opts, &rbm);
     Mse mse;
     
-    CuMatrix<BaseFloat> feats, feats_transf, 
-                        pos_hid, pos_hid_aux, 
-                        neg_vis, neg_hid;
+    CuMatrix<BaseFloat> feats, feats_transf;
     CuMatrix<BaseFloat> dummy_mse_mat;
 
     Timer time;
@@ -199,33 +201,12 @@ int main(int argc, char *argv[]) {
       for( ; !feature_randomizer.Done(); feature_randomizer.Next()) {
         // get block of feature/target pairs
         const CuMatrix<BaseFloat>& pos_vis = feature_randomizer.Value();
-        // get the dims 
-        int32 num_frames = pos_vis.NumRows(),
-              dim_hid = rbm.OutputDim();
+        int32 num_frames = pos_vis.NumRows();
        
-        // TRAIN with CD1
-        // forward pass
-        rbm.Propagate(pos_vis, &pos_hid);
-
-        // alter the hidden values, so we can generate negative example
-        if (rbm.HidType() == Rbm::Bernoulli) {
-          pos_hid_aux.Resize(num_frames, dim_hid);
-          cu_rand.BinarizeProbs(pos_hid, &pos_hid_aux);
-        } else {
-          // assume HidType Rbm::GAUSSIAN
-          pos_hid_aux.Resize(num_frames, dim_hid);
-          pos_hid_aux.CopyFromMat(pos_hid);
-          cu_rand.AddGaussNoise(&pos_hid_aux);
-        }
-
-        // reconstruct pass
-        rbm.Reconstruct(pos_hid_aux, &neg_vis);
-        // propagate negative examples
-        rbm.Propagate(neg_vis, &neg_hid);
-        // update step
-        rbm.RbmUpdate(pos_vis, pos_hid, neg_vis, neg_hid);
+        // TRAIN with CD-k
+        cd_trainer.Train(pos_vis);
         // evaluate mean square error
-        mse.Eval(neg_vis, pos_vis, &dummy_mse_mat);
+        mse.Eval(cd_trainer.Reconstruction(), pos_vis, &dummy_mse_mat);
 
         total_frames += num_frames;
 
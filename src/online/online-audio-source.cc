@@ -24,7 +24,6 @@
 #include <cmath>
 #include <vector>
 
-#include "util/timer.h"
 #include "online-audio-source.h"
 
 namespace kaldi {
@@ -45,21 +44,13 @@ OnlinePaSource::OnlinePaSource(const uint32 timeout,
                                const uint32 rb_size,
                                const uint32 report_interval)
     : timeout_(timeout), timed_out_(false),
-      sample_rate_(sample_rate), pa_started_(false),
+      sample_rate_(sample_rate),
+      ring_(std::max<uint32>(std::min<uint32>(rb_size, 1 << 30) /
+                             sizeof(SampleType), 1)),
+      last_timestamp_(-1.0), pa_started_(false),
       report_interval_(report_interval), nread_calls_(0),
       noverflows_(0), samples_lost_(0) {
   using namespace std;
-  int32 rb_bits = static_cast<int32>(ceil(log(rb_size) / log(2)));
-  if (rb_bits > 30) // ok, this limit is somewhat arbitrary
-    throw invalid_argument("PortAudio ring buffer too large!");
-  rb_size_ = 1 << rb_bits;
-  ring_buffer_ = new char[rb_size_];
-  ring_buffer_size_t rbs = PaUtil_InitializeRingBuffer(
-                               &pa_ringbuf_, sizeof(SampleType),
-                               rb_size_ / sizeof(SampleType), ring_buffer_);
-  if (rbs != 0)
-    throw runtime_error("Unexpected PortAudio ring buffer init error");
-
   PaError paerr = Pa_Initialize();
   if (paerr != paNoError)
     throw runtime_error("PortAudio initialization error");
@@ -80,8 +71,6 @@ OnlinePaSource::~OnlinePaSource() {
     Pa_CloseStream(pa_stream_);
     Pa_Terminate();
   }
-  if (ring_buffer_ != 0)
-    delete [] ring_buffer_;
 }
 
 
@@ -92,41 +81,37 @@ bool OnlinePaSource::Read(Vector<BaseFloat> *data) {
       throw std::runtime_error("Error while trying to open PortAudio stream");
     pa_started_ = true;
   }
-  Timer timer;
   if (report_interval_ != 0
       && (++nread_calls_ % report_interval_) == 0
       && noverflows_ > 0) {
-      KALDI_VLOG(1) << noverflows_ << " PortAudio ring buffer overflows detected "
+      KALDI_VLOG(1) << noverflows_ << " ring buffer overflows detected "
                     << "and " << samples_lost_ << " sample(s) were lost";
       samples_lost_ = noverflows_ = 0;
   }
-  uint32 nsamples_req = data->Dim(); // samples to request
+  int32 nsamples_req = data->Dim(); // samples to request
   timed_out_ = false;
-  while (true) {
-    ring_buffer_size_t nsamples = PaUtil_GetRingBufferReadAvailable(&pa_ringbuf_);
-    if (nsamples >= nsamples_req)
-      break;
-    if (timeout_ > 0) {
-      int32 elapsed = static_cast<int32>(timer.Elapsed() * 1000);
-      if (elapsed > timeout_) {
-        nsamples_req = nsamples;
-        timed_out_ = true;
-        KALDI_VLOG(2) << "OnlinePaSource::Read() timeout";
-        break;
-      }
-    }
-    Pa_Sleep(2);
+  // Sleeps until the callback has written enough samples (no polling).
+  int32 nsamples = ring_.Wait(nsamples_req, static_cast<int32>(timeout_));
+  if (nsamples < nsamples_req) {
+    nsamples_req = nsamples;
+    timed_out_ = true;
+    KALDI_VLOG(2) << "OnlinePaSource::Read() timeout";
   }
-  std::vector<int16> buf(nsamples_req);
-  rbs_t nsamples_rcv = PaUtil_ReadRingBuffer(&pa_ringbuf_, buf.data(), nsamples_req);
-  if (nsamples_rcv != nsamples_req) {
-    KALDI_WARN << "Requested: " << nsamples_req
-               << "; Received: " << nsamples_rcv << " samples";
-    // This would be a PortAudio error.
+  // Convert the samples straight from the ring buffer.
+  data->Resize(nsamples_req);
+  int32 nsamples_rcv = 0;
+  last_timestamp_ = -1.0;
+  OnlineSampleChunk chunk;
+  while (nsamples_rcv < nsamples_req &&
+         ring_.PeekChunk(nsamples_req - nsamples_rcv, &chunk)) {
+    if (nsamples_rcv == 0)
+      last_timestamp_ = chunk.timestamp;
+    for (int32 i = 0; i < chunk.num_samples; ++i)
+      (*data)(nsamples_rcv + i) = static_cast<BaseFloat>(chunk.data[i]);
+    ring_.Consume(chunk.num_samples);
+    nsamples_rcv += chunk.num_samples;
   }
-  data->Resize(nsamples_rcv);
-  for (int i = 0; i < nsamples_rcv; ++i)
-    (*data)(i) = static_cast<BaseFloat>(buf[i]);
+  KALDI_ASSERT(nsamples_rcv == nsamples_req);
 
   return (nsamples_rcv != 0);
   // NOTE (Dan): I'm pretty sure this return value is not right, it could be
@@ -135,16 +120,24 @@ bool OnlinePaSource::Read(Vector<BaseFloat> *data) {
 }
 
 
-// Accepts the data and writes it to the ring buffer
+// Accepts the data and writes it to the ring buffer, with the time the first
+// sample was captured.  This doesn't block, unless Read() is waiting and we
+// have to wake it up.
 int OnlinePaSource::Callback(const void *input, void *output,
-                             ring_buffer_size_t frame_count,
+                             long unsigned frame_count,
                              const PaStreamCallbackTimeInfo *time_info,
                              PaStreamCallbackFlags status_flags) {
+  double timestamp = OnlineSampleRing::Now();
+  // PortAudio tells us how long ago the first sample was captured.
+  if (time_info != NULL && time_info->inputBufferAdcTime > 0.0 &&
+      time_info->currentTime >= time_info->inputBufferAdcTime)
+    timestamp -= time_info->currentTime - time_info->inputBufferAdcTime;
   if (report_interval_ != 0) {
-    if (frame_count > PaUtil_GetRingBufferWriteAvailable(&pa_ringbuf_))
+    if (frame_count > static_cast<long unsigned>(ring_.WriteAvailable()))
       ++noverflows_;
   }
-  rbs_t written = PaUtil_WriteRingBuffer(&pa_ringbuf_, input, frame_count);
+  int32 written = ring_.Write(static_cast<const SampleType*>(input),
+                              frame_count, timestamp);
   samples_lost_ += frame_count - written;
   return paContinue;
 }
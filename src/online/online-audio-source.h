@@ -24,9 +24,9 @@
 #define KALDI_ONLINE_ONLINE_AUDIO_SOURCE_H_
 
 #include <portaudio.h>
-#include <pa_ringbuffer.h>
 
 #include "matrix/kaldi-vector.h"
+#include "online/online-sample-ring.h"
 
 namespace kaldi {
 
@@ -52,16 +52,23 @@ class OnlineAudioSourceItf {
   //       returning data-- by that time, it will return as much data as it has.
   virtual bool Read(Vector<BaseFloat> *data) = 0;
 
+  // Returns the time at which the first sample returned by the last call to
+  // Read() was captured, on the clock of OnlineSampleRing::Now(), or a
+  // negative value if the source does not know it.  The difference from
+  // OnlineSampleRing::Now() when a result is output is the latency.
+  virtual double LastReadTimestamp() const { return -1.0; }
+
   virtual ~OnlineAudioSourceItf() { }
 };
 
 
 // OnlineAudioSourceItf implementation using PortAudio to read samples in real-time
-// from a sound card/microphone.
+// from a sound card/microphone.  The PortAudio callback puts the samples in an
+// OnlineSampleRing, with the time they were captured, and Read() sleeps until
+// there are enough of them.
 class OnlinePaSource : public OnlineAudioSourceItf {
  public:
   typedef int16 SampleType; // hardcoded 16-bit audio
-  typedef ring_buffer_size_t rbs_t;
 
   // PortAudio is initialized here, so it may throw an exception on error
   // "timeout": if > 0, and the acquisition takes more than this number of
@@ -69,9 +76,9 @@ class OnlinePaSource : public OnlineAudioSourceItf {
   //            If no data was received until timeout expired, Compute() returns
   //            false (assumes sensible timeout).
   // "sample_rate": the input rate to request from PortAudio
-  // "rb_size": requested size of PA's ring buffer - will be round up to
-  //           power of 2
-  // "report_interval": if not 0, PA ring buffer overflow will be reported
+  // "rb_size": requested size of the ring buffer in bytes - will be rounded
+  //           up to a power of 2
+  // "report_interval": if not 0, ring buffer overflows will be reported
   //                    at every ovfw_msg_interval-th call to Read().
   //                    Putting 0 into this argument disables the reporting.
   OnlinePaSource(const uint32 timeout,
@@ -82,6 +89,8 @@ class OnlinePaSource : public OnlineAudioSourceItf {
   // Implementation of the OnlineAudioSourceItf
   bool Read(Vector<BaseFloat> *data);
 
+  double LastReadTimestamp() const { return last_timestamp_; }
+
   // Making friends with the callback so it will be able to access a private
   // member function to delegate the processing
   friend int PaCallback(const void *input, void *output,
@@ -99,7 +108,7 @@ class OnlinePaSource : public OnlineAudioSourceItf {
  private:
   // The real PortAudio callback delegates to this one
   int Callback(const void *input, void *output,
-               ring_buffer_size_t frame_count,
+               long unsigned frame_count,
                const PaStreamCallbackTimeInfo *time_info,
                PaStreamCallbackFlags status_flags);
 
@@ -108,15 +117,14 @@ class OnlinePaSource : public OnlineAudioSourceItf {
   bool timed_out_; // True if the last call to Read() failed to obtain the requested
                    // number of samples, because of timeout
   uint32 sample_rate_; // the sampling rate of the input audio
-  int32 rb_size_;
-  char *ring_buffer_; // points to the actual buffer used by PA to store samples
-  PaUtilRingBuffer pa_ringbuf_; // a data structure used to wrap the ring buffer
+  OnlineSampleRing ring_; // the samples from the callback, not yet read
+  double last_timestamp_; // capture time of the first sample of the last Read()
   PaStream *pa_stream_;
   bool pa_started_; // becomes "true" after "pa_stream_" is started
-  uint32 report_interval_; // interval (in Read() calls) to report PA rb overflows
+  uint32 report_interval_; // interval (in Read() calls) to report rb overflows
   uint32 nread_calls_; // number of Read() calls so far
   uint32 noverflows_; // number of the ringbuf overflows since the last report
-  uint32 samples_lost_; // samples lost, due to PA ring buffer overflow
+  uint32 samples_lost_; // samples lost, due to ring buffer overflow
   KALDI_DISALLOW_COPY_AND_ASSIGN(OnlinePaSource);
 };
 
@@ -20,16 +20,101 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <errno.h>
+#include <sys/time.h>
 #include "online/online-decodable.h"
 
 namespace kaldi {
 
+OnlineBatchScorer::OnlineBatchScorer(const StackedAmDiagGmm &stacked,
+                                     BaseFloat max_wait_ms):
+    stacked_(stacked), max_wait_ms_(max_wait_ms), num_clients_(0),
+    batch_(new Batch(stacked)) {
+  if (pthread_mutex_init(&mutex_, NULL) != 0 ||
+      pthread_cond_init(&cond_, NULL) != 0)
+    KALDI_ERR << "Cannot initialize pthreads mutex or condition variable.";
+}
+
+OnlineBatchScorer::~OnlineBatchScorer() {
+  KALDI_ASSERT(batch_->num_pending == 0);
+  delete batch_;
+  pthread_mutex_destroy(&mutex_);
+  pthread_cond_destroy(&cond_);
+}
+
+void OnlineBatchScorer::AddClient() {
+  pthread_mutex_lock(&mutex_);
+  num_clients_++;
+  pthread_mutex_unlock(&mutex_);
+}
+
+void OnlineBatchScorer::RemoveClient() {
+  pthread_mutex_lock(&mutex_);
+  KALDI_ASSERT(num_clients_ > 0);
+  num_clients_--;
+  // If all the remaining clients are waiting, nobody would complete the batch
+  // until the time-out.
+  if (batch_->num_pending != 0 && batch_->num_pending >= num_clients_)
+    ComputeBatch();
+  pthread_mutex_unlock(&mutex_);
+}
+
+void OnlineBatchScorer::ComputeBatch() {
+  Batch *batch = batch_;
+  batch_ = new Batch(stacked_);  // New requests go to the next batch.
+  pthread_mutex_unlock(&mutex_);
+  try {
+    batch->scorer.Compute();
+  } catch (const std::exception &e) {
+    // The requests see the error in Score(); we must not throw here, or the
+    // other threads of the batch would wait forever.
+    KALDI_WARN << "Error computing batched likelihoods: " << e.what();
+    batch->failed = true;
+  }
+  pthread_mutex_lock(&mutex_);
+  batch->done = true;
+  pthread_cond_broadcast(&cond_);
+}
+
+void OnlineBatchScorer::Score(const VectorBase<BaseFloat> &feats,
+                              const std::vector<int32> &pdf_ids,
+                              std::vector<BaseFloat> *log_likes) {
+  pthread_mutex_lock(&mutex_);
+  Batch *batch = batch_;
+  int32 r = batch->scorer.AddRequest(feats, pdf_ids);
+  batch->num_pending++;
+  if (r == 0) {  // Set the time-out of the batch.
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    int64 usec = now.tv_usec + static_cast<int64>(max_wait_ms_ * 1000.0);
+    batch->deadline.tv_sec = now.tv_sec + usec / 1000000;
+    batch->deadline.tv_nsec = (usec % 1000000) * 1000;
+  }
+  if (batch->num_pending >= num_clients_)
+    ComputeBatch();
+  while (!batch->done) {
+    if (batch_ != batch) {  // Another thread is computing it.
+      pthread_cond_wait(&cond_, &mutex_);
+    } else if (pthread_cond_timedwait(&cond_, &mutex_, &batch->deadline) ==
+               ETIMEDOUT && batch_ == batch) {
+      ComputeBatch();
+    }
+  }
+  bool failed = batch->failed;
+  if (!failed)
+    *log_likes = batch->scorer.LogLikes(r);
+  if (--batch->num_pending == 0) delete batch;
+  pthread_mutex_unlock(&mutex_);
+  if (failed)
+    KALDI_ERR << "Batched likelihood computation failed.";
+}
+
 OnlineDecodableDiagGmmScaled::OnlineDecodableDiagGmmScaled(
     const AmDiagGmm &am, const TransitionModel &trans_model,
     const BaseFloat scale, OnlineFeatureMatrix *input_feats):  
       features_(input_feats), ac_model_(am),
       ac_scale_(scale), trans_model_(trans_model),
-      feat_dim_(input_feats->Dim()), cur_frame_(-1) {
+      feat_dim_(input_feats->Dim()), cur_frame_(-1), batch_scorer_(NULL) {
   if (!input_feats->IsValidFrame(0)) {
     // It's not safe to throw from a constructor, so please check
     // this condition yourself before reaching this point in the code.
@@ -62,9 +147,121 @@ BaseFloat OnlineDecodableDiagGmmScaled::LogLikelihood(int32 frame, int32 index)
   return ans;
 }
 
+void OnlineDecodableDiagGmmScaled::LogLikelihoods(
+    int32 frame, const std::vector<int32> &indices,
+    std::vector<BaseFloat> *log_likes) {
+  if (batch_scorer_ == NULL) {
+    DecodableInterface::LogLikelihoods(frame, indices, log_likes);
+    return;
+  }
+  if (frame != cur_frame_)
+    CacheFrame(frame);
+  // Find the pdfs we don't have yet, without repeats; they are marked in the
+  // cache before they are computed.
+  batch_pdfs_.clear();
+  for (size_t i = 0; i < indices.size(); i++) {
+    int32 pdf_id = trans_model_.TransitionIdToPdf(indices[i]);
+    if (cache_[pdf_id].first != frame) {
+      cache_[pdf_id].first = frame;
+      batch_pdfs_.push_back(pdf_id);
+    }
+  }
+  if (!batch_pdfs_.empty()) {
+    try {
+      batch_scorer_->Score(cur_feats_, batch_pdfs_, &batch_log_likes_);
+    } catch (...) {
+      for (size_t i = 0; i < batch_pdfs_.size(); i++)
+        cache_[batch_pdfs_[i]].first = -1;  // They were not computed.
+      throw;
+    }
+    for (size_t i = 0; i < batch_pdfs_.size(); i++)
+      cache_[batch_pdfs_[i]].second = batch_log_likes_[i] * ac_scale_;
+  }
+  log_likes->resize(indices.size());
+  for (size_t i = 0; i < indices.size(); i++)
+    (*log_likes)[i] =
+        cache_[trans_model_.TransitionIdToPdf(indices[i])].second;
+}
 
 bool OnlineDecodableDiagGmmScaled::IsLastFrame(int32 frame) {
   return !features_->IsValidFrame(frame+1);
 }
 
+OnlineDecodableAmNnetScaled::OnlineDecodableAmNnetScaled(
+    const nnet2::AmNnet &am_nnet, const TransitionModel &trans_model,
+    const OnlineDecodableNnetOptions &opts, const BaseFloat scale,
+    OnlineFeatureMatrix *input_feats):
+    features_(input_feats), am_nnet_(am_nnet), trans_model_(trans_model),
+    opts_(opts), ac_scale_(scale), log_priors_(am_nnet.Priors()),
+    computer_(am_nnet.GetNnet(), CuVector<BaseFloat>()),
+    pending_feats_(std::max<int32>(opts.chunk_size, 1), input_feats->Dim()),
+    num_pending_(0), num_frames_read_(0), input_finished_(false),
+    computer_finished_(false), log_probs_offset_(0) {
+  KALDI_ASSERT(opts.chunk_size > 0);
+  if (!input_feats->IsValidFrame(0)) {
+    // It's not safe to throw from a constructor, so please check
+    // this condition yourself before reaching this point in the code.
+    KALDI_ERR << "Attempt to initialize decodable object with empty "
+              << "input: please check this before the initializer!";
+  }
+  KALDI_ASSERT(log_priors_.Dim() == trans_model.NumPdfs() &&
+               "Priors in neural network not set up.");
+  log_priors_.ApplyLog();
+}
+
+bool OnlineDecodableAmNnetScaled::ReadFrame() {
+  if (input_finished_) return false;
+  if (!features_->IsValidFrame(num_frames_read_)) {
+    input_finished_ = true;
+    return false;
+  }
+  if (num_pending_ == pending_feats_.NumRows())
+    pending_feats_.Resize(2 * num_pending_, pending_feats_.NumCols(),
+                          kCopyData);
+  pending_feats_.Row(num_pending_).CopyFromVec(
+      features_->GetFrame(num_frames_read_));
+  num_pending_++;
+  num_frames_read_++;
+  return true;
+}
+
+void OnlineDecodableAmNnetScaled::ComputeForFrame(int32 frame) {
+  KALDI_ASSERT(frame >= log_probs_offset_ &&
+               "Requesting a frame that has already been discarded.");
+  while (frame >= computer_.NumFramesOutput()) {
+    if (computer_finished_)
+      KALDI_ERR << "Request for invalid frame (you need to check IsLastFrame, "
+                << "or, for frame zero, check that the input is valid.";
+    while (num_pending_ < opts_.chunk_size && ReadFrame());
+    CuMatrix<BaseFloat> chunk, output;
+    if (num_pending_ > 0)
+      chunk = pending_feats_.RowRange(0, num_pending_);
+    num_pending_ = 0;
+    computer_.Compute(chunk, input_finished_, &output);
+    computer_finished_ = input_finished_;
+    if (output.NumRows() == 0) continue;
+    output.ApplyFloor(1.0e-20); // Avoid log of zero which leads to NaN.
+    output.ApplyLog();
+    output.AddVecToRows(-1.0, log_priors_); // divide by the prior.
+    output.Scale(ac_scale_);
+    log_probs_offset_ = computer_.NumFramesOutput() - output.NumRows();
+    log_probs_.Swap(&output);
+  }
+}
+
+BaseFloat OnlineDecodableAmNnetScaled::LogLikelihood(int32 frame,
+                                                     int32 index) {
+  if (frame >= log_probs_offset_ + log_probs_.NumRows())
+    ComputeForFrame(frame);
+  KALDI_ASSERT(frame >= log_probs_offset_);
+  return log_probs_(frame - log_probs_offset_,
+                    trans_model_.TransitionIdToPdf(index));
+}
+
+bool OnlineDecodableAmNnetScaled::IsLastFrame(int32 frame) {
+  // There is one output frame per input frame.
+  while (num_frames_read_ <= frame + 1 && ReadFrame());
+  return input_finished_ && frame + 1 >= num_frames_read_;
+}
+
 } // namespace kaldi
@@ -24,12 +24,64 @@
 #ifndef KALDI_ONLINE_ONLINE_DECODABLE_H_
 #define KALDI_ONLINE_ONLINE_DECODABLE_H_
 
+#include <pthread.h>
+#include <vector>
+
 #include "online-feat-input.h"
 #include "gmm/decodable-am-diag-gmm.h"
+#include "nnet2/am-nnet.h"
+#include "nnet2/nnet-compute.h"
 
 namespace kaldi {
 
+// OnlineBatchScorer lets decodable objects in different threads (e.g. the
+// streams of online-audio-server-multi-decode-faster) have the pdf
+// log-likelihoods of their current frames computed together, with
+// StackedAmDiagGmmBatchScorer, so the parameters of a pdf that several
+// streams need are read once for all of them.  A thread that calls Score()
+// adds its request to the current batch and waits until the batch has a
+// request from each client (see AddClient()), or until max_wait_ms has passed
+// since the batch was started; then one of the threads computes the batch.
+// The clients are the threads that are decoding at the moment; a client that
+// is waiting for audio will not score anything, which is why there is a
+// time-out.
+class OnlineBatchScorer {
+ public:
+  OnlineBatchScorer(const StackedAmDiagGmm &stacked, BaseFloat max_wait_ms);
+  ~OnlineBatchScorer();
+
+  /// Call these before and after a thread decodes (some frames of) a stream.
+  void AddClient();
+  void RemoveClient();
+
+  /// Sets "log_likes" to the log-likelihoods of "pdf_ids" (which may contain
+  /// repeats) on the features "feats"; blocks until the batch is computed.
+  void Score(const VectorBase<BaseFloat> &feats,
+             const std::vector<int32> &pdf_ids,
+             std::vector<BaseFloat> *log_likes);
 
+ private:
+  struct Batch {
+    explicit Batch(const StackedAmDiagGmm &stacked):
+        scorer(stacked), done(false), failed(false), num_pending(0) { }
+    StackedAmDiagGmmBatchScorer scorer;
+    struct timespec deadline;  // when the batch is computed anyway.
+    bool done;
+    bool failed;  // if Compute() threw.
+    int32 num_pending;  // requests whose output has not yet been collected.
+  };
+  // Called with mutex_ locked; starts a new batch and computes the old one,
+  // temporarily unlocking.  It does not throw.
+  void ComputeBatch();
+
+  const StackedAmDiagGmm &stacked_;
+  BaseFloat max_wait_ms_;
+  int32 num_clients_;
+  Batch *batch_;  // The batch that new requests go to.
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;  // signaled when a batch has been computed.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineBatchScorer);
+};
 
 // A decodable, taking input from an OnlineFeatureInput object on-demand
 class OnlineDecodableDiagGmmScaled : public DecodableInterface {
@@ -42,6 +94,15 @@ class OnlineDecodableDiagGmmScaled : public DecodableInterface {
   
   /// Returns the log likelihood, which will be negated in the decoder.
   virtual BaseFloat LogLikelihood(int32 frame, int32 index);
+
+  /// If SetBatchScorer() was called, this computes the pdfs that are not
+  /// cached with the batch scorer; otherwise it calls LogLikelihood().
+  virtual void LogLikelihoods(int32 frame, const std::vector<int32> &indices,
+                              std::vector<BaseFloat> *log_likes);
+
+  /// Makes LogLikelihoods() use a batch scorer shared with other streams;
+  /// it does not take ownership.
+  void SetBatchScorer(OnlineBatchScorer *scorer) { batch_scorer_ = scorer; }
   
   virtual bool IsLastFrame(int32 frame);
   
@@ -59,10 +120,76 @@ class OnlineDecodableDiagGmmScaled : public DecodableInterface {
   Vector<BaseFloat> cur_feats_;
   int32 cur_frame_;
   std::vector<std::pair<int32, BaseFloat> > cache_;
+  OnlineBatchScorer *batch_scorer_;  // Not owned; may be NULL.
+  std::vector<int32> batch_pdfs_;  // Temporaries for LogLikelihoods().
+  std::vector<BaseFloat> batch_log_likes_;
 
   KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineDecodableDiagGmmScaled);
 };
 
+struct OnlineDecodableNnetOptions {
+  int32 chunk_size; // number of frames given to the network at a time.
+  OnlineDecodableNnetOptions(): chunk_size(16) { }
+  void Register(OptionsItf *po) {
+    po->Register("chunk-size", &chunk_size,
+                 "Number of frames for which the neural net is evaluated at "
+                 "a time.  Smaller values give lower latency, larger values "
+                 "are more efficient (especially on GPU).");
+  }
+};
+
+// A decodable for nnet2 neural-net models, taking input from an
+// OnlineFeatureMatrix object on-demand.  The network is evaluated on chunks of
+// opts.chunk_size frames (with nnet2::NnetChunkComputer, so the left context
+// is not recomputed for each chunk); the log-likelihoods of a frame are
+// available once the network's right context (Nnet::RightContext()) after
+// the end of its chunk has been read, or the input has ended.  The outputs
+// are divided by the priors, as in nnet2::DecodableAmNnet.
+class OnlineDecodableAmNnetScaled : public DecodableInterface {
+ public:
+  OnlineDecodableAmNnetScaled(const nnet2::AmNnet &am_nnet,
+                              const TransitionModel &trans_model,
+                              const OnlineDecodableNnetOptions &opts,
+                              const BaseFloat scale,
+                              OnlineFeatureMatrix *input_feats);
+
+  /// Returns the scaled log-likelihood, which will be negated in the decoder.
+  virtual BaseFloat LogLikelihood(int32 frame, int32 index);
+
+  virtual bool IsLastFrame(int32 frame);
+
+  /// Indices are one-based!  This is for compatibility with OpenFst.
+  virtual int32 NumIndices() { return trans_model_.NumTransitionIds(); }
+
+ private:
+  // Reads the next frame of features into pending_feats_; returns false if
+  // the input has ended.
+  bool ReadFrame();
+  // Evaluates the network on chunks of input until "frame" is computed.
+  void ComputeForFrame(int32 frame);
+
+  OnlineFeatureMatrix *features_;
+  const nnet2::AmNnet &am_nnet_;
+  const TransitionModel &trans_model_;
+  OnlineDecodableNnetOptions opts_;
+  BaseFloat ac_scale_;
+  CuVector<BaseFloat> log_priors_;
+  nnet2::NnetChunkComputer computer_;
+  // Features read, but not yet given to the network: the first
+  // num_pending_ rows of pending_feats_.
+  Matrix<BaseFloat> pending_feats_;
+  int32 num_pending_;
+  int32 num_frames_read_;
+  bool input_finished_;
+  bool computer_finished_; // true once the last chunk was given to computer_.
+  // The scaled log-likelihoods of the most recently computed chunk, for the
+  // frames starting from log_probs_offset_.
+  Matrix<BaseFloat> log_probs_;
+  int32 log_probs_offset_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineDecodableAmNnetScaled);
+};
+
 } // namespace kaldi
 
 #endif // KALDI_ONLINE_ONLINE_DECODABLE_H_
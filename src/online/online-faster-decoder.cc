@@ -20,6 +20,9 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <limits>
+
 #include "util/timer.h"
 #include "online-faster-decoder.h"
 #include "fstext/fstext-utils.h"
@@ -29,13 +32,15 @@ namespace kaldi {
 
 void OnlineFasterDecoder::ResetDecoder(bool full) {
   ClearToks(toks_.Clear());
-  StateId start_state = fst_.Start();
+  StateId start_state = fst_->Start();
   KALDI_ASSERT(start_state != fst::kNoStateId);
   Arc dummy_arc(0, 0, Weight::One(), start_state);
   Token *dummy_token = new Token(dummy_arc, NULL);
   toks_.Insert(start_state, dummy_token);
   prev_immortal_tok_ = immortal_tok_ = dummy_token;
   utt_frames_ = 0;
+  speech_frames_ = 0;
+  trailing_sil_frames_ = 0;
   if (full)
     frame_ = 0;
 }
@@ -49,7 +54,7 @@ OnlineFasterDecoder::MakeLattice(const Token *start,
   if (start == NULL) return;
   bool is_final = false;
   Weight this_weight = Times(start->weight_,
-                             fst_.Final(start->arc_.nextstate));
+                             fst_->Final(start->arc_.nextstate));
   if (this_weight != Weight::Zero())
     is_final = true;
   std::vector<LatticeArc> arcs_reverse;  // arcs in reverse order.
@@ -64,7 +69,7 @@ OnlineFasterDecoder::MakeLattice(const Token *start,
                      tok->arc_.nextstate);
     arcs_reverse.push_back(l_arc);
   }
-  if(arcs_reverse.back().nextstate == fst_.Start()) {
+  if(arcs_reverse.back().nextstate == fst_->Start()) {
     arcs_reverse.pop_back();  // that was a "fake" token... gives no info.
   }
   StateId cur_state = out_fst->AddState();
@@ -76,7 +81,7 @@ OnlineFasterDecoder::MakeLattice(const Token *start,
     cur_state = arc.nextstate;
   }
   if (is_final) {
-    Weight final_weight = fst_.Final(start->arc_.nextstate);
+    Weight final_weight = fst_->Final(start->arc_.nextstate);
     out_fst->SetFinal(cur_state, LatticeWeight(final_weight.Value(), 0.0));
   } else {
     out_fst->SetFinal(cur_state, LatticeWeight::One());
@@ -85,11 +90,11 @@ OnlineFasterDecoder::MakeLattice(const Token *start,
 }
 
 
-void OnlineFasterDecoder::UpdateImmortalToken() {
+OnlineFasterDecoder::Token *OnlineFasterDecoder::FindImmortalToken() {
   std::tr1::unordered_set<Token*> emitting;
   for (Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
     Token* tok = e->val;
-    while (tok->arc_.ilabel == 0) //deal with non-emitting ones ...
+    while (tok != NULL && tok->arc_.ilabel == 0) //deal with non-emitting ones ...
       tok = tok->prev_;
     if (tok != NULL)
       emitting.insert(tok);
@@ -115,14 +120,86 @@ void OnlineFasterDecoder::UpdateImmortalToken() {
     } // for
     emitting = prev_emitting;
   } // while
+  return the_one;
+}
+
+
+void OnlineFasterDecoder::UpdateImmortalToken() {
+  Token *the_one = FindImmortalToken();
   if (the_one != NULL) {
     prev_immortal_tok_ = immortal_tok_;
     immortal_tok_ = the_one;
-    return;
   }
 }
 
 
+void OnlineFasterDecoder::GetPartialResult(std::vector<int32> *words,
+                                           int32 *num_stable) {
+  words->clear();
+  *num_stable = 0;
+  Token *best_tok = NULL;
+  for (Elem *e = toks_.GetList(); e != NULL; e = e->tail)
+    if (best_tok == NULL || *best_tok < *(e->val))
+      best_tok = e->val;
+  Token *stable_tok = FindImmortalToken();
+  if (stable_tok == NULL)
+    stable_tok = immortal_tok_;
+  int32 num_unstable = -1;
+  for (Token *tok = best_tok; tok != NULL; tok = tok->prev_) {
+    if (tok == stable_tok)
+      num_unstable = words->size();
+    if (tok->arc_.olabel != 0)
+      words->push_back(tok->arc_.olabel);
+  }
+  std::reverse(words->begin(), words->end());
+  if (num_unstable >= 0)
+    *num_stable = words->size() - num_unstable;
+}
+
+
+BaseFloat OnlineFasterDecoder::SilencePosterior() {
+  double best_cost = std::numeric_limits<double>::infinity();
+  for (Elem *e = toks_.GetList(); e != NULL; e = e->tail)
+    best_cost = std::min(best_cost,
+                         static_cast<double>(e->val->weight_.Value()));
+  double tot = 0.0, sil = 0.0;
+  for (Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
+    Token *tok = e->val;
+    double post = exp(best_cost - tok->weight_.Value());
+    while (tok != NULL && tok->arc_.ilabel == 0)  // the last emitting arc.
+      tok = tok->prev_;
+    if (tok == NULL) continue;
+    tot += post;
+    int32 phone = trans_model_.TransitionIdToPhone(tok->arc_.ilabel);
+    if (silence_set_.count(phone) != 0)
+      sil += post;
+  }
+  return (tot > 0.0 ? sil / tot : 1.0);
+}
+
+
+OnlineFasterDecoder::EndpointType OnlineFasterDecoder::CheckEndpoint() {
+  if (opts_.endpoint_trailing_sil > 0 || opts_.endpoint_no_speech > 0) {
+    if (SilencePosterior() >= opts_.sil_posterior) {
+      trailing_sil_frames_++;
+    } else {
+      speech_frames_++;
+      trailing_sil_frames_ = 0;
+    }
+    if (opts_.endpoint_trailing_sil > 0 && speech_frames_ > 0 &&
+        trailing_sil_frames_ >= opts_.endpoint_trailing_sil)
+      return kEndpointTrailingSil;
+    if (opts_.endpoint_no_speech > 0 && speech_frames_ == 0 &&
+        utt_frames_ + 1 >= opts_.endpoint_no_speech)
+      return kEndpointNoSpeech;
+  }
+  if (opts_.endpoint_max_utt_len > 0 &&
+      utt_frames_ + 1 >= opts_.endpoint_max_utt_len)
+    return kEndpointMaxUttLen;
+  return kNoEndpoint;
+}
+
+
 bool
 OnlineFasterDecoder::PartialTraceback(fst::MutableFst<LatticeArc> *out_fst) {
   UpdateImmortalToken();
@@ -144,7 +221,7 @@ OnlineFasterDecoder::FinishTraceBack(fst::MutableFst<LatticeArc> *out_fst) {
   } else {
     Weight best_weight = Weight::Zero();
     for (Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
-      Weight this_weight = Times(e->val->weight_, fst_.Final(e->key));
+      Weight this_weight = Times(e->val->weight_, fst_->Final(e->key));
       if (this_weight != Weight::Zero() &&
           this_weight.Value() < best_weight.Value()) {
         best_weight = this_weight;
@@ -170,7 +247,7 @@ OnlineFasterDecoder::TracebackNFrames(int32 nframes,
 
   bool is_final = false;
   Weight this_weight = Times(best_tok->weight_,
-                             fst_.Final(best_tok->arc_.nextstate));
+                             fst_->Final(best_tok->arc_.nextstate));
   if (this_weight != Weight::Zero())
     is_final = true;
   std::vector<LatticeArc> arcs_reverse;  // arcs in reverse order.
@@ -187,7 +264,7 @@ OnlineFasterDecoder::TracebackNFrames(int32 nframes,
                      tok->arc_.nextstate);
     arcs_reverse.push_back(larc);
   }
-  if(arcs_reverse.back().nextstate == fst_.Start())
+  if(arcs_reverse.back().nextstate == fst_->Start())
     arcs_reverse.pop_back();  // that was a "fake" token... gives no info.
   StateId cur_state = out_fst->AddState();
   out_fst->SetStart(cur_state);
@@ -198,7 +275,7 @@ OnlineFasterDecoder::TracebackNFrames(int32 nframes,
     cur_state = arc.nextstate;
   }
   if (is_final) {
-    Weight final_weight = fst_.Final(best_tok->arc_.nextstate);
+    Weight final_weight = fst_->Final(best_tok->arc_.nextstate);
     out_fst->SetFinal(cur_state, LatticeWeight(final_weight.Value(), 0.0));
   } else {
     out_fst->SetFinal(cur_state, LatticeWeight::One());
@@ -207,6 +284,128 @@ OnlineFasterDecoder::TracebackNFrames(int32 nframes,
 }
 
 
+void OnlineFasterDecoder::WriteState(std::ostream &os, bool binary) const {
+  // Number the tokens on the tracebacks of the active tokens so that each
+  // token comes after its predecessor; the others can't be reached.
+  std::tr1::unordered_map<const Token*, int32> index;
+  std::vector<const Token*> tokens, path;
+  for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
+    for (const Token *tok = e->val; tok != NULL && index.count(tok) == 0;
+         tok = tok->prev_)
+      path.push_back(tok);
+    for (; !path.empty(); path.pop_back()) {
+      index[path.back()] = tokens.size();
+      tokens.push_back(path.back());
+    }
+  }
+  WriteToken(os, binary, "<OnlineFasterDecoder>");
+  WriteBasicType(os, binary, static_cast<int32>(state_));
+  WriteBasicType(os, binary, frame_);
+  WriteBasicType(os, binary, utt_frames_);
+  WriteBasicType(os, binary, speech_frames_);
+  WriteBasicType(os, binary, trailing_sil_frames_);
+  WriteBasicType(os, binary, static_cast<int32>(endpoint_type_));
+  WriteBasicType(os, binary, effective_beam_);
+  WriteToken(os, binary, "<Tokens>");
+  WriteBasicType(os, binary, static_cast<int32>(tokens.size()));
+  for (size_t i = 0; i < tokens.size(); i++) {
+    const Token *tok = tokens[i];
+    WriteBasicType(os, binary, static_cast<int32>(tok->arc_.ilabel));
+    WriteBasicType(os, binary, static_cast<int32>(tok->arc_.olabel));
+    WriteBasicType(os, binary, tok->arc_.weight.Value());
+    WriteBasicType(os, binary, static_cast<int32>(tok->arc_.nextstate));
+    WriteBasicType(os, binary,
+                   tok->prev_ == NULL ? -1 : index[tok->prev_]);
+    WriteBasicType(os, binary, tok->weight_.Value());
+  }
+  WriteToken(os, binary, "<Active>");
+  int32 num_active = 0;
+  for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail)
+    num_active++;
+  WriteBasicType(os, binary, num_active);
+  for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
+    WriteBasicType(os, binary, static_cast<int32>(e->key));
+    WriteBasicType(os, binary, index[e->val]);
+  }
+  // The immortal tokens are ancestors of the active ones, unless decoding
+  // failed and there are none.
+  WriteToken(os, binary, "<Immortal>");
+  WriteBasicType(os, binary, (index.count(immortal_tok_) != 0 ?
+                              index[immortal_tok_] : -1));
+  WriteBasicType(os, binary, (index.count(prev_immortal_tok_) != 0 ?
+                              index[prev_immortal_tok_] : -1));
+  WriteToken(os, binary, "</OnlineFasterDecoder>");
+}
+
+
+void OnlineFasterDecoder::ReadState(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<OnlineFasterDecoder>");
+  int32 state, endpoint_type;
+  ReadBasicType(is, binary, &state);
+  ReadBasicType(is, binary, &frame_);
+  ReadBasicType(is, binary, &utt_frames_);
+  ReadBasicType(is, binary, &speech_frames_);
+  ReadBasicType(is, binary, &trailing_sil_frames_);
+  ReadBasicType(is, binary, &endpoint_type);
+  ReadBasicType(is, binary, &effective_beam_);
+  state_ = static_cast<DecodeState>(state);
+  endpoint_type_ = static_cast<EndpointType>(endpoint_type);
+
+  ClearToks(toks_.Clear());
+  ExpectToken(is, binary, "<Tokens>");
+  int32 num_tokens;
+  ReadBasicType(is, binary, &num_tokens);
+  KALDI_ASSERT(num_tokens >= 0);
+  std::vector<Token*> tokens(num_tokens);
+  for (int32 i = 0; i < num_tokens; i++) {
+    int32 ilabel, olabel, nextstate, prev;
+    BaseFloat graph_cost, cost;
+    ReadBasicType(is, binary, &ilabel);
+    ReadBasicType(is, binary, &olabel);
+    ReadBasicType(is, binary, &graph_cost);
+    ReadBasicType(is, binary, &nextstate);
+    ReadBasicType(is, binary, &prev);
+    ReadBasicType(is, binary, &cost);
+    if (prev < -1 || prev >= i)
+      KALDI_ERR << "Invalid decoder state: token " << i
+                << " has predecessor " << prev;
+    tokens[i] = new Token(Arc(ilabel, olabel, Weight(graph_cost), nextstate),
+                          prev == -1 ? NULL : tokens[prev]);
+    tokens[i]->weight_ = Weight(cost);
+    // The constructor counts a reference from toks_; the tokens that are in
+    // it get that back below.
+    tokens[i]->ref_count_--;
+  }
+  ExpectToken(is, binary, "<Active>");
+  int32 num_active;
+  ReadBasicType(is, binary, &num_active);
+  for (int32 i = 0; i < num_active; i++) {
+    int32 key, t;
+    ReadBasicType(is, binary, &key);
+    ReadBasicType(is, binary, &t);
+    if (t < 0 || t >= num_tokens)
+      KALDI_ERR << "Invalid decoder state: active token " << t;
+    toks_.Insert(key, tokens[t]);
+    tokens[t]->ref_count_++;
+  }
+  for (int32 i = 0; i < num_tokens; i++)
+    if (tokens[i]->ref_count_ == 0)
+      KALDI_ERR << "Invalid decoder state: token " << i
+                << " is not an ancestor of an active token.";
+  ExpectToken(is, binary, "<Immortal>");
+  int32 immortal, prev_immortal;
+  ReadBasicType(is, binary, &immortal);
+  ReadBasicType(is, binary, &prev_immortal);
+  if (immortal < -1 || immortal >= num_tokens ||
+      prev_immortal < -1 || prev_immortal >= num_tokens)
+    KALDI_ERR << "Invalid decoder state: immortal tokens " << immortal
+              << ", " << prev_immortal;
+  immortal_tok_ = (immortal == -1 ? NULL : tokens[immortal]);
+  prev_immortal_tok_ = (prev_immortal == -1 ? NULL : tokens[prev_immortal]);
+  ExpectToken(is, binary, "</OnlineFasterDecoder>");
+}
+
+
 bool OnlineFasterDecoder::EndOfUtterance() {
   fst::VectorFst<LatticeArc> trace;
   int32 sil_frm = opts_.inter_utt_sil / (1 + utt_frames_ / opts_.max_utt_len_);
@@ -236,7 +435,9 @@ OnlineFasterDecoder::Decode(DecodableInterface *decodable) {
   Timer timer;
   double64 tstart = timer.Elapsed(), tstart_batch = tstart;
   BaseFloat factor = -1;
-  for (; !decodable->IsLastFrame(frame_ - 1) && batch_frame < opts_.batch_size;
+  EndpointType endpoint = kNoEndpoint;
+  for (; !decodable->IsLastFrame(frame_ - 1) && batch_frame < opts_.batch_size
+           && endpoint == kNoEndpoint;
        ++frame_, ++utt_frames_, ++batch_frame) {
     if (batch_frame != 0 && (batch_frame % opts_.update_interval) == 0) {
       // adjust the beam if needed
@@ -262,12 +463,23 @@ OnlineFasterDecoder::Decode(DecodableInterface *decodable) {
           << " xRT";
     BaseFloat weight_cutoff = ProcessEmitting(decodable, frame_);
     ProcessNonemitting(weight_cutoff);
+    endpoint = CheckEndpoint();
   }
-  if (batch_frame == opts_.batch_size && !decodable->IsLastFrame(frame_ - 1)) {
-    if (EndOfUtterance())
+  if (decodable->IsLastFrame(frame_ - 1)) {
+    state_ = kEndFeats;
+  } else if (endpoint != kNoEndpoint) {
+    state_ = kEndUtt;
+    endpoint_type_ = endpoint;
+    KALDI_VLOG(2) << "Endpoint (rule " << endpoint << ") after "
+                  << utt_frames_ << " frames, " << speech_frames_
+                  << " of them speech.";
+  } else if (batch_frame == opts_.batch_size) {
+    if (EndOfUtterance()) {
       state_ = kEndUtt;
-    else
+      endpoint_type_ = kEndpointInterUttSil;
+    } else {
       state_ = kEndBatch;
+    }
   } else {
     state_ = kEndFeats;
   }
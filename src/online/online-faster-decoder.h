@@ -24,8 +24,10 @@
 #define KALDI_ONLINE_ONLINE_FASTER_DECODER_H_
 
 #ifdef _MSC_VER
+#include <unordered_map>
 #include <unordered_set>
 #else
+#include <tr1/unordered_map>
 #include <tr1/unordered_set>
 #endif
 using std::tr1::unordered_set;
@@ -47,12 +49,21 @@ struct OnlineFasterDecoderOpts : public FasterDecoderOptions {
   int32 update_interval; // beam update period in # of frames
   BaseFloat beam_update; // rate of adjustment of the beam
   BaseFloat max_beam_update; // maximum rate of beam adjustment
+  // The following endpointing rules are checked after every frame, so they
+  // can end an utterance in the middle of a batch; zero disables a rule.
+  BaseFloat sil_posterior; // a frame is silence if the posterior of the
+                           // silence phones, over the active tokens, is >= this
+  int32 endpoint_trailing_sil; // # silence frames after speech that end an utt.
+  int32 endpoint_max_utt_len; // # frames after which an utterance always ends
+  int32 endpoint_no_speech; // # frames without speech after which we end
 
   OnlineFasterDecoderOpts() :
     rt_min(.7), rt_max(.75), batch_size(27),
     inter_utt_sil(50), max_utt_len_(1500),
     update_interval(3), beam_update(.01),
-    max_beam_update(0.05) {}
+    max_beam_update(0.05), sil_posterior(0.9),
+    endpoint_trailing_sil(0), endpoint_max_utt_len(0),
+    endpoint_no_speech(0) {}
 
   void Register(OptionsItf *po, bool full) {
     FasterDecoderOptions::Register(po, full);
@@ -69,6 +80,18 @@ struct OnlineFasterDecoderOpts : public FasterDecoderOptions {
     po->Register("max-utt-length", &max_utt_len_,
                  "If the utterance becomes longer than this number of frames, "
                  "shorter silence is acceptable as an utterance separator");
+    po->Register("sil-posterior", &sil_posterior,
+                 "A frame counts as silence for --endpoint-trailing-sil and "
+                 "--endpoint-no-speech if the posterior of the silence "
+                 "phones among the active tokens is at least this");
+    po->Register("endpoint-trailing-sil", &endpoint_trailing_sil,
+                 "If >0, end the utterance after this many consecutive "
+                 "silence frames following speech (checked every frame)");
+    po->Register("endpoint-max-utt-length", &endpoint_max_utt_len,
+                 "If >0, always end the utterance after this many frames");
+    po->Register("endpoint-no-speech", &endpoint_no_speech,
+                 "If >0, end the utterance if there has been no speech for "
+                 "this many frames since it started (e.g. to discard noise)");
   }
 };
 
@@ -81,6 +104,15 @@ class OnlineFasterDecoder : public FasterDecoder {
     kEndBatch = 4 // End of batch - end of utterance not reached yet
   };
 
+  // The rule that caused the last kEndUtt (see OnlineFasterDecoderOpts).
+  enum EndpointType {
+    kNoEndpoint = 0,
+    kEndpointInterUttSil, // --inter-utt-sil, checked at the end of a batch
+    kEndpointTrailingSil, // --endpoint-trailing-sil
+    kEndpointMaxUttLen, // --endpoint-max-utt-length
+    kEndpointNoSpeech // --endpoint-no-speech
+  };
+
   // "sil_phones" - the IDs of all silence phones
   OnlineFasterDecoder(const fst::Fst<fst::StdArc> &fst,
                       const OnlineFasterDecoderOpts &opts,
@@ -89,7 +121,8 @@ class OnlineFasterDecoder : public FasterDecoder {
       : FasterDecoder(fst, opts), opts_(opts),
         silence_set_(sil_phones), trans_model_(trans_model),
         max_beam_(opts.beam), effective_beam_(FasterDecoder::config_.beam),
-        state_(kEndFeats), frame_(0), utt_frames_(0) {}
+        state_(kEndFeats), frame_(0), utt_frames_(0), speech_frames_(0),
+        trailing_sil_frames_(0), endpoint_type_(kNoEndpoint) {}
 
   DecodeState Decode(DecodableInterface *decodable);
   
@@ -102,11 +135,35 @@ class OnlineFasterDecoder : public FasterDecoder {
   // of an utterance in order to get the last chunk of the hypothesis
   void FinishTraceBack(fst::MutableFst<LatticeArc> *fst_out);
 
+  // Sets "words" to the output symbols on the best path of the current
+  // utterance so far.  The first "num_stable" of them are on the traceback
+  // from the immortal token, so they will not change as decoding goes on;
+  // the rest may.  Unlike PartialTraceback(), this does not change the state
+  // of the decoder, so it can be called at any time to show partial results.
+  void GetPartialResult(std::vector<int32> *words, int32 *num_stable);
+
   // Returns "true" if the best current hypothesis ends with long enough silence
   bool EndOfUtterance();
 
   int32 frame() { return frame_; }
 
+  // The number of frames of the current utterance decoded so far.
+  int32 utt_frames() const { return utt_frames_; }
+
+  // Returns the rule that ended the last utterance, after Decode() returned
+  // kEndUtt.
+  EndpointType endpoint_type() const { return endpoint_type_; }
+
+  // Writes the state of the search between calls to Decode(): the active
+  // tokens with their tracebacks, the immortal tokens, the frame counters and
+  // the adjusted beam.  ReadState() restores it into a decoder with the same
+  // graph and options, which then carries on as this one would have, e.g.
+  // after a long streaming session is moved to another server; the features
+  // are saved separately with OnlineFeatureMatrix::WriteState().
+  void WriteState(std::ostream &os, bool binary) const;
+
+  void ReadState(std::istream &is, bool binary);
+
  private:
   void ResetDecoder(bool full);
 
@@ -119,9 +176,21 @@ class OnlineFasterDecoder : public FasterDecoder {
                    const Token *end,
                    fst::MutableFst<LatticeArc> *out_fst) const;
 
-  // Searches for the last token, ancestor of all currently active tokens
+  // Returns the last token that is an ancestor of all currently active
+  // tokens, or NULL if it cannot be found.
+  Token *FindImmortalToken();
+
+  // Updates immortal_tok_ and prev_immortal_tok_ with FindImmortalToken()
   void UpdateImmortalToken();
 
+  // Returns the posterior of the silence phones on the current frame, among
+  // the active tokens
+  BaseFloat SilencePosterior();
+
+  // Called after each frame: updates speech_frames_ and trailing_sil_frames_
+  // and returns the endpointing rule that fires, if any
+  EndpointType CheckEndpoint();
+
   const OnlineFasterDecoderOpts opts_;
   const ConstIntegerSet<int32> silence_set_; // silence phones IDs
   const TransitionModel &trans_model_; // needed for trans-id -> phone conversion
@@ -130,6 +199,9 @@ class OnlineFasterDecoder : public FasterDecoder {
   DecodeState state_; // the current state of the decoder
   int32 frame_; // the next frame to be processed
   int32 utt_frames_; // # frames processed from the current utterance
+  int32 speech_frames_; // # non-silence frames in the current utterance
+  int32 trailing_sil_frames_; // # silence frames since the last speech frame
+  EndpointType endpoint_type_; // the rule that ended the last utterance
   Token *immortal_tok_;      // "immortal" token means it's an ancestor of ...
   Token *prev_immortal_tok_; // ... all currently active tokens
   KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineFasterDecoder);
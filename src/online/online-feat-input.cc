@@ -32,6 +32,16 @@ namespace kaldi {
 // This function prevents those initial non-productive calls, which
 // may otherwise confuse decoder code into thinking there is
 // a problem with the stream (too many timeouts), and cause it to fail.
+void OnlineFeatInputItf::WriteState(std::ostream &os, bool binary) const {
+  KALDI_ERR << "Saving the state is not supported by this type of "
+            << "feature input.";
+}
+
+void OnlineFeatInputItf::ReadState(std::istream &is, bool binary) {
+  KALDI_ERR << "Restoring the state is not supported by this type of "
+            << "feature input.";
+}
+
 bool OnlineCmnInput::Compute(Matrix<BaseFloat> *output) {
   
   int32 orig_nr = output->NumRows(), orig_nc = output->NumCols();
@@ -106,6 +116,35 @@ bool OnlineCmnInput::ComputeInternal(Matrix<BaseFloat> *output) {
   return more_data;
 }
 
+void OnlineCmnInput::WriteState(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<OnlineCmnInput>");
+  WriteBasicType(os, binary, t_in_);
+  WriteBasicType(os, binary, t_out_);
+  history_.Write(os, binary);
+  sum_.Write(os, binary);
+  WriteToken(os, binary, "</OnlineCmnInput>");
+  input_->WriteState(os, binary);
+}
+
+void OnlineCmnInput::ReadState(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<OnlineCmnInput>");
+  ReadBasicType(is, binary, &t_in_);
+  ReadBasicType(is, binary, &t_out_);
+  Matrix<BaseFloat> history;
+  history.Read(is, binary);
+  if (history.NumRows() != history_.NumRows() ||
+      history.NumCols() != history_.NumCols())
+    KALDI_ERR << "CMN state does not match the configuration: history is "
+              << history.NumRows() << " x " << history.NumCols()
+              << ", expected " << history_.NumRows() << " x "
+              << history_.NumCols();
+  history_.Swap(&history);
+  sum_.Read(is, binary);
+  KALDI_ASSERT(sum_.Dim() == Dim());
+  ExpectToken(is, binary, "</OnlineCmnInput>");
+  input_->ReadState(is, binary);
+}
+
 void OnlineCmnInput::AcceptFrame(const VectorBase<BaseFloat> &input) {
   KALDI_ASSERT(t_in_ <= t_out_ + cmn_window_);
   history_.Row(t_in_ % (cmn_window_ + 1)).CopyFromVec(input);
@@ -147,8 +186,56 @@ void OnlineCmnInput::OutputFrame(VectorBase<BaseFloat> *output) {
   t_out_++;
 }
 
+bool OnlineCmvnInput::Compute(Matrix<BaseFloat> *output) {
+  KALDI_ASSERT(output->NumRows() > 0 && output->NumCols() == Dim());
+  int32 num_requested = output->NumRows();
+  Matrix<BaseFloat> input;
+  bool ans;
+  int32 num_output;
+  do {
+    // We ask for more input if what we got produced no output (e.g. at the
+    // start, while the first window is filling up), as in OnlineCmnInput.
+    input.Resize(num_requested, Dim());
+    ans = input_->Compute(&input);
+    // The frames must be taken as soon as they are ready, so like
+    // OnlineCmnInput, we may output more frames than were requested.
+    int32 max_output = cmn_.NumFramesAccepted() - cmn_.NumFramesOutput() +
+        input.NumRows();
+    output->Resize(max_output, max_output == 0 ? 0 : Dim());
+    num_output = 0;
+    for (int32 t = 0; t <= input.NumRows(); t++) {
+      if (t < input.NumRows()) cmn_.AcceptFrame(input.Row(t));
+      else if (!ans) cmn_.InputFinished();
+      while (cmn_.NextFrameReady()) {
+        SubVector<BaseFloat> frame(*output, num_output++);
+        cmn_.GetNextFrame(&frame);
+      }
+    }
+  } while (ans && num_output == 0 && input.NumRows() != 0);
+  if (num_output == 0)
+    output->Resize(0, 0);
+  else
+    output->Resize(num_output, Dim(), kCopyData);
+  return ans;
+}
+
 #if !defined(_MSC_VER)
 
+void OnlineCmvnInput::WriteState(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<OnlineCmvnInput>");
+  cmn_.WriteState(os, binary);
+  WriteToken(os, binary, "</OnlineCmvnInput>");
+  input_->WriteState(os, binary);
+}
+
+void OnlineCmvnInput::ReadState(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<OnlineCmvnInput>");
+  cmn_.ReadState(is, binary);
+  ExpectToken(is, binary, "</OnlineCmvnInput>");
+  input_->ReadState(is, binary);
+}
+
+
 OnlineUdpInput::OnlineUdpInput(int32 port, int32 feature_dim):
     feature_dim_(feature_dim) {
   server_addr_.sin_family = AF_INET; // IPv4
@@ -188,12 +275,71 @@ bool OnlineUdpInput::Compute(Matrix<BaseFloat> *output) {
 #endif
 
 
+void OnlineFrameBuffer::Reserve(int32 num_frames) {
+  if (num_frames > data_.NumRows()) {
+    // Grow geometrically so that this happens only a few times.
+    int32 new_rows = std::max(num_frames, 2 * data_.NumRows());
+    data_.Resize(new_rows, dim_, kCopyData);
+  }
+}
+
+void OnlineFrameBuffer::Append(const MatrixBase<BaseFloat> &frames) {
+  int32 num_new = frames.NumRows();
+  if (num_new == 0) return;
+  KALDI_ASSERT(frames.NumCols() == dim_);
+  Reserve(num_frames_ + num_new);
+  data_.Range(num_frames_, num_new, 0, dim_).CopyFromMat(frames);
+  num_frames_ += num_new;
+}
+
+void OnlineFrameBuffer::AppendCopies(const VectorBase<BaseFloat> &frame,
+                                     int32 count) {
+  if (count == 0) return;
+  Reserve(num_frames_ + count);
+  for (int32 i = 0; i < count; i++)
+    data_.Row(num_frames_ + i).CopyFromVec(frame);
+  num_frames_ += count;
+}
+
+void OnlineFrameBuffer::KeepLast(int32 num_keep) {
+  num_keep = std::min(num_keep, num_frames_);
+  int32 shift = num_frames_ - num_keep;
+  if (shift != 0) {
+    // Going forwards, no row is overwritten before it has been copied.
+    for (int32 i = 0; i < num_keep; i++)
+      data_.Row(i).CopyFromVec(data_.Row(i + shift));
+  }
+  num_frames_ = num_keep;
+}
+
+
+void OnlineFrameBuffer::Write(std::ostream &os, bool binary) const {
+  if (num_frames_ == 0)
+    Matrix<BaseFloat>().Write(os, binary);
+  else
+    data_.Range(0, num_frames_, 0, dim_).Write(os, binary);
+}
+
+void OnlineFrameBuffer::Read(std::istream &is, bool binary) {
+  Matrix<BaseFloat> frames;
+  frames.Read(is, binary);
+  num_frames_ = 0;
+  if (frames.NumRows() != 0) {
+    if (frames.NumCols() != dim_)
+      KALDI_ERR << "Buffered frames have dimension " << frames.NumCols()
+                << ", expected " << dim_;
+    Append(frames);
+  }
+}
+
+
 OnlineLdaInput::OnlineLdaInput(OnlineFeatInputItf *input,
                                const Matrix<BaseFloat> &transform,
                                int32 left_context,
                                int32 right_context):
     input_(input), input_dim_(input->Dim()),
-    left_context_(left_context), right_context_(right_context) {
+    left_context_(left_context), right_context_(right_context),
+    frames_(input->Dim()) {
 
   int32 tot_context = left_context + 1 + right_context;
   if (transform.NumCols() == input_dim_ * tot_context) {
@@ -210,52 +356,6 @@ OnlineLdaInput::OnlineLdaInput(OnlineFeatInputItf *input,
   }
 }
 
-// static
-void OnlineLdaInput::SpliceFrames(const MatrixBase<BaseFloat> &input1,
-                                  const MatrixBase<BaseFloat> &input2,
-                                  const MatrixBase<BaseFloat> &input3,
-                                  int32 context_window,
-                                  Matrix<BaseFloat> *output) {
-  KALDI_ASSERT(context_window > 0);
-  const int32 size1 = input1.NumRows(), size2 = input2.NumRows(),
-      size3 = input3.NumRows();
-  int32 num_frames_in = size1 + size2 + size3,
-      num_frames_out = num_frames_in - (context_window - 1),
-      dim = std::max(input1.NumCols(), std::max(input2.NumCols(), input3.NumCols()));
-  // do std::max in case one or more of the input matrices is empty.
-  
-  if (num_frames_out <= 0) {
-    output->Resize(0, 0);
-    return;
-  }
-  output->Resize(num_frames_out, dim * context_window);
-  for (int32 t_out = 0; t_out < num_frames_out; t_out++) {
-    for (int32 pos = 0; pos < context_window; pos++) {
-      int32 t_in = t_out + pos;
-      SubVector<BaseFloat> vec_out(output->Row(t_out), pos * dim, dim);
-      if (t_in < size1)
-        vec_out.CopyFromVec(input1.Row(t_in));
-      else if (t_in < size1 + size2)
-        vec_out.CopyFromVec(input2.Row(t_in - size1));
-      else
-        vec_out.CopyFromVec(input3.Row(t_in - size1 - size2));
-    }
-  }
-}
-
-void OnlineLdaInput::TransformToOutput(const MatrixBase<BaseFloat> &spliced_feats,
-                                       Matrix<BaseFloat> *output) {
-  if (spliced_feats.NumRows() == 0) {
-    output->Resize(0, 0);
-  } else {
-    output->Resize(spliced_feats.NumRows(), linear_transform_.NumRows());
-    output->AddMatMat(1.0, spliced_feats, kNoTrans,
-                      linear_transform_, kTrans, 0.0);
-    if (offset_.Dim() != 0)
-      output->AddVecToRows(1.0, offset_);
-  }
-}
-
 bool OnlineLdaInput::Compute(Matrix<BaseFloat> *output) {
   KALDI_ASSERT(output->NumRows() > 0 &&
                output->NumCols() == linear_transform_.NumRows());
@@ -263,7 +363,8 @@ bool OnlineLdaInput::Compute(Matrix<BaseFloat> *output) {
   // which makes no sense.
 
   // We request the same number of frames of data that we were requested.
-  Matrix<BaseFloat> input(output->NumRows(), input_dim_);
+  Matrix<BaseFloat> &input = input_buffer_;
+  input.Resize(output->NumRows(), input_dim_, kUndefined);
   bool ans = input_->Compute(&input);
   // If we got no input (timed out) and we're not at the end, we return
   // empty output.
@@ -273,7 +374,7 @@ bool OnlineLdaInput::Compute(Matrix<BaseFloat> *output) {
     return ans;
   } else if (input.NumRows() == 0 && !ans) {
     // The end of the input stream, but no input this time.
-    if (remainder_.NumRows() == 0) {
+    if (frames_.NumFrames() == 0) {
       output->Resize(0, 0);
       return ans;
     }
@@ -281,55 +382,56 @@ bool OnlineLdaInput::Compute(Matrix<BaseFloat> *output) {
 
   // If this is the first segment of the utterance, we put in the
   // initial duplicates of the first frame, numbered "left_context".
-  if (remainder_.NumRows() == 0 && input.NumRows() != 0 && left_context_ != 0) {
-    remainder_.Resize(left_context_, input_dim_);
-    for (int32 i = 0; i < left_context_; i++)
-      remainder_.Row(i).CopyFromVec(input.Row(0));
-  }
+  if (frames_.NumFrames() == 0 && input.NumRows() != 0)
+    frames_.AppendCopies(input.Row(0), left_context_);
+  frames_.Append(input);
 
   // If this is the last segment, we put in the final duplicates of the
   // last frame, numbered "right_context".
-  Matrix<BaseFloat> tail;
   if (!ans && right_context_ > 0) {
-    tail.Resize(right_context_, input_dim_);
-    for (int32 i = 0; i < right_context_; i++) {
-      if (input.NumRows() > 0)
-        tail.Row(i).CopyFromVec(input.Row(input.NumRows() - 1));
-      else
-        tail.Row(i).CopyFromVec(remainder_.Row(remainder_.NumRows() - 1));
+    Vector<BaseFloat> last_frame(frames_.Frame(frames_.NumFrames() - 1));
+    frames_.AppendCopies(last_frame, right_context_);
+  }
+
+  int32 context_window = left_context_ + 1 + right_context_,
+      num_frames_out = frames_.NumFrames() - (context_window - 1);
+  if (num_frames_out <= 0) {
+    output->Resize(0, 0);
+  } else {
+    // Output frame t is the transform times the spliced input frames
+    // t ... t + context_window - 1, i.e. the sum over positions "pos" of
+    // the block of the transform for "pos" times input frame t + pos.
+    output->Resize(num_frames_out, linear_transform_.NumRows(), kUndefined);
+    if (offset_.Dim() != 0) output->CopyRowsFromVec(offset_);
+    else output->SetZero();
+    SubMatrix<BaseFloat> frames(frames_.Frames());
+    for (int32 pos = 0; pos < context_window; pos++) {
+      SubMatrix<BaseFloat> block(linear_transform_, 0,
+                                 linear_transform_.NumRows(),
+                                 pos * input_dim_, input_dim_);
+      output->AddMatMat(1.0, frames.Range(pos, num_frames_out, 0, input_dim_),
+                        kNoTrans, block, kTrans, 1.0);
     }
   }
-  
-  Matrix<BaseFloat> spliced_feats;
-  int32 context_window = left_context_ + 1 + right_context_;
-  // The next line is a call to a member function.
-  SpliceFrames(remainder_, input, tail, context_window, &spliced_feats);
-  TransformToOutput(spliced_feats, output);
-  ComputeNextRemainder(input);
+  // The remainder that we propagate to the next call is the last
+  // context_window - 1 frames, if available.
+  frames_.KeepLast(context_window - 1);
   return ans; 
 }
 
-void OnlineLdaInput::ComputeNextRemainder(const MatrixBase<BaseFloat> &input) {
-  // The size of the remainder that we propagate to the next frame is
-  // context_window - 1, if available.
-  int32 context_window = left_context_ + 1 + right_context_;
-  int32 next_remainder_len = std::min(context_window - 1,
-                                      remainder_.NumRows() + input.NumRows());
-  if (next_remainder_len == 0) {
-    remainder_.Resize(0, 0);
-    return;
-  }
-  Matrix<BaseFloat> next_remainder(next_remainder_len, input_dim_);
-  int32 rsize = remainder_.NumRows(), isize = input.NumRows();
-  for (int32 i = 0; i < next_remainder_len; i++) {
-    SubVector<BaseFloat> dest(next_remainder, i);
-    int32 t = (rsize + isize) - next_remainder_len + i;
-    // Here, t is an offset into a numbering of the frames where we first have
-    // the old "remainder" frames, then the regular frames.
-    if (t < rsize) dest.CopyFromVec(remainder_.Row(t));
-    else dest.CopyFromVec(input.Row(t - rsize));
-  }
-  remainder_ = next_remainder;
+
+void OnlineLdaInput::WriteState(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<OnlineLdaInput>");
+  frames_.Write(os, binary);
+  WriteToken(os, binary, "</OnlineLdaInput>");
+  input_->WriteState(os, binary);
+}
+
+void OnlineLdaInput::ReadState(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<OnlineLdaInput>");
+  frames_.Read(is, binary);
+  ExpectToken(is, binary, "</OnlineLdaInput>");
+  input_->ReadState(is, binary);
 }
 
 
@@ -340,7 +442,7 @@ bool OnlineCacheInput::Compute(Matrix<BaseFloat> *output) {
   return ans;
 }
 
-void OnlineCacheInput::GetCachedData(Matrix<BaseFloat> *output) {
+void OnlineCacheInput::GetCachedData(Matrix<BaseFloat> *output) const {
   int32 num_frames = 0, dim = 0;
   for (size_t i = 0; i < data_.size(); i++) {
     num_frames += data_[i]->NumRows();
@@ -356,6 +458,26 @@ void OnlineCacheInput::GetCachedData(Matrix<BaseFloat> *output) {
   KALDI_ASSERT(frame_offset == num_frames);
 }
 
+void OnlineCacheInput::WriteState(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<OnlineCacheInput>");
+  Matrix<BaseFloat> data;
+  GetCachedData(&data);
+  data.Write(os, binary);
+  WriteToken(os, binary, "</OnlineCacheInput>");
+  input_->WriteState(os, binary);
+}
+
+void OnlineCacheInput::ReadState(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<OnlineCacheInput>");
+  Deallocate();
+  Matrix<BaseFloat> *data = new Matrix<BaseFloat>();
+  data->Read(is, binary);
+  if (data->NumRows() != 0) data_.push_back(data);
+  else delete data;
+  ExpectToken(is, binary, "</OnlineCacheInput>");
+  input_->ReadState(is, binary);
+}
+
 void OnlineCacheInput::Deallocate() {
   for (size_t i = 0; i < data_.size(); i++) delete data_[i];
   data_.clear();
@@ -364,61 +486,10 @@ void OnlineCacheInput::Deallocate() {
 
 OnlineDeltaInput::OnlineDeltaInput(const DeltaFeaturesOptions &delta_opts,
                                    OnlineFeatInputItf *input):
-    input_(input), opts_(delta_opts), input_dim_(input_->Dim()) { }
+    input_(input), opts_(delta_opts), input_dim_(input_->Dim()),
+    delta_(delta_opts), frames_(input_->Dim()) { }
 
 
-// static
-void OnlineDeltaInput::AppendFrames(const MatrixBase<BaseFloat> &input1,
-                                    const MatrixBase<BaseFloat> &input2,
-                                    const MatrixBase<BaseFloat> &input3,
-                                    Matrix<BaseFloat> *output) {
-  const int32 size1 = input1.NumRows(), size2 = input2.NumRows(),
-      size3 = input3.NumRows(), size_out = size1 + size2 + size3;
-  if (size_out == 0) {
-    output->Resize(0, 0);
-    return;
-  }
-  // do std::max in case one or more of the input matrices is empty.  
-  int32 dim = std::max(input1.NumCols(),
-                       std::max(input2.NumCols(), input3.NumCols()));
-
-  output->Resize(size_out, dim);
-  if (size1 != 0)
-    output->Range(0, size1, 0, dim).CopyFromMat(input1);
-  if (size2 != 0)
-    output->Range(size1, size2, 0, dim).CopyFromMat(input2);
-  if (size3 != 0)
-    output->Range(size1 + size2, size3, 0, dim).CopyFromMat(input3);
-}
-
-void OnlineDeltaInput::DeltaComputation(const MatrixBase<BaseFloat> &input,
-                                        Matrix<BaseFloat> *output,
-                                        Matrix<BaseFloat> *remainder) const {
-  int32 input_rows = input.NumRows(),
-      output_rows = std::max(0, input_rows - Context() * 2),
-      remainder_rows = std::min(input_rows, Context() * 2),
-      input_dim = input_dim_,
-      output_dim = Dim();
-  if (remainder_rows > 0) {
-    remainder->Resize(remainder_rows, input_dim);
-    remainder->CopyFromMat(input.Range(input_rows - remainder_rows,
-                                       remainder_rows, 0, input_dim));
-  } else {
-    remainder->Resize(0, 0);
-  }
-  if (output_rows > 0) {
-    output->Resize(output_rows, output_dim);
-    DeltaFeatures delta(opts_);
-    for (int32 output_frame = 0; output_frame < output_rows; output_frame++) {
-      int32 input_frame = output_frame + Context();
-      SubVector<BaseFloat> output_row(*output, output_frame);
-      delta.Process(input, input_frame, &output_row);
-    }
-  } else {
-    output->Resize(0, 0);
-  }
-}                                     
-
 bool OnlineDeltaInput::Compute(Matrix<BaseFloat> *output) {
   KALDI_ASSERT(output->NumRows() > 0 &&
                output->NumCols() == Dim());
@@ -426,7 +497,8 @@ bool OnlineDeltaInput::Compute(Matrix<BaseFloat> *output) {
   // which makes no sense.
 
   // We request the same number of frames of data that we were requested.
-  Matrix<BaseFloat> input(output->NumRows(), input_dim_);
+  Matrix<BaseFloat> &input = input_buffer_;
+  input.Resize(output->NumRows(), input_dim_, kUndefined);
   bool ans = input_->Compute(&input);
 
   // If we got no input (timed out) and we're not at the end, we return
@@ -436,7 +508,7 @@ bool OnlineDeltaInput::Compute(Matrix<BaseFloat> *output) {
     return ans;
   } else if (input.NumRows() == 0 && !ans) {
     // The end of the input stream, but no input this time.
-    if (remainder_.NumRows() == 0) {
+    if (frames_.NumFrames() == 0) {
       output->Resize(0, 0);
       return ans;
     }
@@ -444,31 +516,142 @@ bool OnlineDeltaInput::Compute(Matrix<BaseFloat> *output) {
 
   // If this is the first segment of the utterance, we put in the
   // initial duplicates of the first frame, numbered "Context()"
-  if (remainder_.NumRows() == 0 && input.NumRows() != 0 && Context() != 0) {
-    remainder_.Resize(Context(), input_dim_);
-    for (int32 i = 0; i < Context(); i++)
-      remainder_.Row(i).CopyFromVec(input.Row(0));
-  }
+  if (frames_.NumFrames() == 0 && input.NumRows() != 0)
+    frames_.AppendCopies(input.Row(0), Context());
+  frames_.Append(input);
 
   // If this is the last segment, we put in the final duplicates of the
   // last frame, numbered "Context()".
-  Matrix<BaseFloat> tail;
   if (!ans && Context() > 0) {
-    tail.Resize(Context(), input_dim_);
-    for (int32 i = 0; i < Context(); i++) {
-      if (input.NumRows() > 0)
-        tail.Row(i).CopyFromVec(input.Row(input.NumRows() - 1));
-      else
-        tail.Row(i).CopyFromVec(remainder_.Row(remainder_.NumRows() - 1));
+    Vector<BaseFloat> last_frame(frames_.Frame(frames_.NumFrames() - 1));
+    frames_.AppendCopies(last_frame, Context());
+  }
+
+  int32 num_frames = frames_.NumFrames(),
+      output_rows = std::max(0, num_frames - Context() * 2);
+  if (output_rows > 0) {
+    output->Resize(output_rows, Dim(), kUndefined);
+    SubMatrix<BaseFloat> frames(frames_.Frames());
+    for (int32 output_frame = 0; output_frame < output_rows; output_frame++) {
+      int32 input_frame = output_frame + Context();
+      SubVector<BaseFloat> output_row(*output, output_frame);
+      delta_.Process(frames, input_frame, &output_row);
     }
+  } else {
+    output->Resize(0, 0);
   }
-  
-  Matrix<BaseFloat> appended_feats;
-  AppendFrames(remainder_, input, tail, &appended_feats);
-  DeltaComputation(appended_feats, output, &remainder_);
+  // The frames kept for the next call are the last Context() * 2.
+  frames_.KeepLast(Context() * 2);
   return ans; 
 }
 
+void OnlineDeltaInput::WriteState(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<OnlineDeltaInput>");
+  frames_.Write(os, binary);
+  WriteToken(os, binary, "</OnlineDeltaInput>");
+  input_->WriteState(os, binary);
+}
+
+void OnlineDeltaInput::ReadState(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<OnlineDeltaInput>");
+  frames_.Read(is, binary);
+  ExpectToken(is, binary, "</OnlineDeltaInput>");
+  input_->ReadState(is, binary);
+}
+
+bool OnlineVadInput::Compute(Matrix<BaseFloat> *output) {
+  KALDI_ASSERT(output->NumRows() > 0 && output->NumCols() == Dim());
+  int32 num_requested = output->NumRows();
+  Matrix<BaseFloat> input;
+  bool ans;
+  int32 num_output;
+  do {
+    // As in OnlineCmvnInput, we ask for more input if we have no output yet;
+    // here that includes the case where all the new frames were unvoiced.
+    input.Resize(num_requested, Dim());
+    ans = input_->Compute(&input);
+    // pending_.Frame(0) is frame number "first_frame" of the input.
+    int32 first_frame = vad_.NumFramesOutput();
+    pending_.Append(input);
+    for (int32 t = 0; t < input.NumRows(); t++)
+      vad_.AcceptFrame(input.Row(t));
+    if (!ans) vad_.InputFinished();
+    output->Resize(pending_.NumFrames(),
+                   pending_.NumFrames() == 0 ? 0 : Dim());
+    num_output = 0;
+    while (vad_.NextFrameReady()) {
+      int32 t = vad_.NumFramesOutput() - first_frame;
+      if (vad_.GetNextFrame())
+        output->Row(num_output++).CopyFromVec(pending_.Frame(t));
+      else
+        num_dropped_++;
+    }
+    pending_.KeepLast(vad_.NumFramesAccepted() - vad_.NumFramesOutput());
+  } while (ans && num_output == 0 && input.NumRows() != 0);
+  if (num_output == 0)
+    output->Resize(0, 0);
+  else
+    output->Resize(num_output, Dim(), kCopyData);
+  return ans;
+}
+
+
+OnlineBasisFmllrInput::OnlineBasisFmllrInput(OnlineFeatInputItf *input,
+                                             const DiagGmm &gmm,
+                                             const BasisFmllrEstimate &basis,
+                                             const BasisFmllrOptions &opts,
+                                             int32 update_period):
+    input_(input), gmm_(gmm), estimate_(basis, opts),
+    update_period_(update_period), frames_since_update_(0) {
+  KALDI_ASSERT(update_period > 0 && gmm.Dim() == input->Dim());
+}
+
+void OnlineBasisFmllrInput::Reset() {
+  estimate_.Reset();
+  frames_since_update_ = 0;
+}
+
+bool OnlineBasisFmllrInput::Compute(Matrix<BaseFloat> *output) {
+  KALDI_ASSERT(output->NumRows() > 0 && output->NumCols() == Dim());
+  bool ans = input_->Compute(output);
+  Vector<BaseFloat> posteriors(gmm_.NumGauss()),
+      raw_frame(Dim());
+  for (int32 t = 0; t < output->NumRows(); t++) {
+    SubVector<BaseFloat> frame(*output, t);
+    raw_frame.CopyFromVec(frame);
+    ApplyAffineTransform(estimate_.Transform(), &frame);
+    gmm_.ComponentPosteriors(frame, &posteriors);
+    estimate_.AccumulateFromPosteriors(gmm_, raw_frame, posteriors);
+    if (++frames_since_update_ == update_period_) {
+      estimate_.Update();
+      frames_since_update_ = 0;
+    }
+  }
+  return ans;
+}
+
+
+OnlinePitchInput::OnlinePitchInput(OnlineAudioSourceItf *au_src,
+                                   const PitchExtractionOptions &opts,
+                                   int32 max_latency)
+    : source_(au_src), extractor_(opts, max_latency),
+      frame_shift_(static_cast<int32>(opts.samp_freq * 0.001 *
+                                      opts.frame_shift_ms)) { }
+
+bool OnlinePitchInput::Compute(Matrix<BaseFloat> *output) {
+  MatrixIndexT nvec = output->NumRows(); // the number of output vectors
+  if (nvec <= 0) {
+    KALDI_WARN << "No feature vectors requested?!";
+    return true;
+  }
+  Vector<BaseFloat> read_samples(nvec * frame_shift_);
+  bool ans = source_->Read(&read_samples);
+  extractor_.AcceptWaveform(read_samples);
+  if (!ans)
+    extractor_.InputFinished();
+  extractor_.GetFrames(output);
+  return ans;
+}
 
 
 void OnlineFeatureMatrix::GetNextFeatures() {
@@ -516,6 +699,27 @@ void OnlineFeatureMatrix::GetNextFeatures() {
 }
 
 
+void OnlineFeatureMatrix::WriteState(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<OnlineFeatureMatrix>");
+  WriteBasicType(os, binary, feat_offset_);
+  WriteBasicType(os, binary, finished_);
+  feat_matrix_.Write(os, binary);
+  WriteToken(os, binary, "</OnlineFeatureMatrix>");
+  input_->WriteState(os, binary);
+}
+
+void OnlineFeatureMatrix::ReadState(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<OnlineFeatureMatrix>");
+  ReadBasicType(is, binary, &feat_offset_);
+  ReadBasicType(is, binary, &finished_);
+  feat_matrix_.Read(is, binary);
+  if (feat_matrix_.NumRows() != 0 && feat_matrix_.NumCols() != feat_dim_)
+    KALDI_ERR << "Feature matrix has dimension " << feat_matrix_.NumCols()
+              << ", expected " << feat_dim_;
+  ExpectToken(is, binary, "</OnlineFeatureMatrix>");
+  input_->ReadState(is, binary);
+}
+
 bool OnlineFeatureMatrix::IsValidFrame (int32 frame) {
    KALDI_ASSERT(frame >= feat_offset_ &&
                "You are attempting to get expired frames.");
@@ -31,6 +31,10 @@
 
 #include "online-audio-source.h"
 #include "feat/feature-functions.h"
+#include "feat/pitch-functions.h"
+#include "gmm/diag-gmm.h"
+#include "ivector/voice-activity-detection.h"
+#include "transform/basis-fmllr-diag-gmm.h"
 
 namespace kaldi {
 
@@ -69,6 +73,17 @@ class OnlineFeatInputItf {
   virtual bool Compute(Matrix<BaseFloat> *output) = 0;
 
   virtual int32 Dim() const = 0; // Return the output dimension of these features.
+
+  // WriteState() writes the state of this stage and of the stages it reads
+  // from (buffered frames, CMN stats and so on, but not the configuration),
+  // and ReadState() restores it into a pipeline that was built in the same way,
+  // e.g. in another process that is to carry on decoding a long stream.
+  // Stages that read audio don't write the audio source; the new pipeline
+  // should be given a source that continues where the old one stopped.  The
+  // default implementations die, for the stages that don't support this.
+  virtual void WriteState(std::ostream &os, bool binary) const;
+
+  virtual void ReadState(std::istream &is, bool binary);
   
   virtual ~OnlineFeatInputItf() {}
 };
@@ -93,6 +108,10 @@ class OnlineCmnInput: public OnlineFeatInputItf {
 
   virtual int32 Dim() const { return input_->Dim(); }
 
+  virtual void WriteState(std::ostream &os, bool binary) const;
+
+  virtual void ReadState(std::istream &is, bool binary);
+
  private:
   virtual bool ComputeInternal(Matrix<BaseFloat> *output);
 
@@ -126,6 +145,40 @@ class OnlineCmnInput: public OnlineFeatInputItf {
 };
 
 
+// Sliding-window cepstral mean (and optionally variance) normalization, using
+// the same computation as apply-cmvn-sliding (see OnlineSlidingWindowCmn in
+// ../feat/feature-functions.h), so the per-frame cost does not depend on the
+// window length.  Unlike OnlineCmnInput this supports variance normalization,
+// centered windows and global stats as a prior.  If opts.center == true, the
+// latency is about half the window.
+class OnlineCmvnInput: public OnlineFeatInputItf {
+ public:
+  OnlineCmvnInput(OnlineFeatInputItf *input,
+                  const SlidingWindowCmnOptions &opts)
+      : input_(input), cmn_(opts, input->Dim()) { }
+
+  // See OnlineSlidingWindowCmn::SetGlobalStats().  Call this before Compute().
+  void SetGlobalStats(const MatrixBase<double> &global_stats,
+                      int32 global_frames) {
+    cmn_.SetGlobalStats(global_stats, global_frames);
+  }
+
+  virtual bool Compute(Matrix<BaseFloat> *output);
+
+  virtual int32 Dim() const { return input_->Dim(); }
+
+  virtual void WriteState(std::ostream &os, bool binary) const;
+
+  virtual void ReadState(std::istream &is, bool binary);
+
+ private:
+  OnlineFeatInputItf *input_; // underlying (unnormalized) feature source
+  OnlineSlidingWindowCmn cmn_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineCmvnInput);
+};
+
+
 class OnlineCacheInput : public OnlineFeatInputItf {
  public:
   OnlineCacheInput(OnlineFeatInputItf *input): input_(input) { }
@@ -135,11 +188,16 @@ class OnlineCacheInput : public OnlineFeatInputItf {
   // GetCachedData() will return the entire input up to the current time.
   virtual bool Compute(Matrix<BaseFloat> *output);
 
-  void GetCachedData(Matrix<BaseFloat> *output);
+  void GetCachedData(Matrix<BaseFloat> *output) const;
   
   int32 Dim() const { return input_->Dim(); }
   
   void Deallocate();
+
+  // The cached data is written as well.
+  virtual void WriteState(std::ostream &os, bool binary) const;
+
+  virtual void ReadState(std::istream &is, bool binary);
     
   virtual ~OnlineCacheInput() { Deallocate(); }
   
@@ -182,6 +240,52 @@ class OnlineUdpInput : public OnlineFeatInputItf {
 // Splices the input features and applies a transformation matrix.
 // Note: the transformation matrix will usually be a linear transformation
 // [output-dim x input-dim] but we accept an affine transformation too.
+// This is a helper class for the stages that need context frames (OnlineLdaInput
+// and OnlineDeltaInput).  It holds a sequence of frames whose storage is reused
+// from one call to Compute() to the next, so in the normal case there is no
+// allocation and each frame is copied once when it arrives.
+class OnlineFrameBuffer {
+ public:
+  explicit OnlineFrameBuffer(int32 dim): dim_(dim), num_frames_(0) { }
+
+  int32 NumFrames() const { return num_frames_; }
+
+  // Appends the rows of "frames".
+  void Append(const MatrixBase<BaseFloat> &frames);
+
+  // Appends "count" copies of "frame".
+  void AppendCopies(const VectorBase<BaseFloat> &frame, int32 count);
+
+  // Returns frame t, for 0 <= t < NumFrames().
+  SubVector<BaseFloat> Frame(int32 t) {
+    KALDI_ASSERT(t >= 0 && t < num_frames_);
+    return data_.Row(t);
+  }
+
+  // Returns the frames as a matrix (which is only valid until the next
+  // change); NumFrames() must not be zero.
+  SubMatrix<BaseFloat> Frames() {
+    return data_.Range(0, num_frames_, 0, dim_);
+  }
+
+  // Discards all but the last "num_keep" frames (or all of them, if there are
+  // fewer), which are moved to the start.
+  void KeepLast(int32 num_keep);
+
+  // Writes and reads the frames (as a matrix); Read() replaces the contents.
+  void Write(std::ostream &os, bool binary) const;
+  void Read(std::istream &is, bool binary);
+
+ private:
+  // Makes sure there is space for "num_frames" frames, keeping the data.
+  void Reserve(int32 num_frames);
+
+  int32 dim_;
+  Matrix<BaseFloat> data_; // The frames are the first num_frames_ rows.
+  int32 num_frames_;
+};
+
+
 class OnlineLdaInput: public OnlineFeatInputItf {
  public:
   OnlineLdaInput(OnlineFeatInputItf *input,
@@ -193,33 +297,24 @@ class OnlineLdaInput: public OnlineFeatInputItf {
 
   virtual int32 Dim() const { return linear_transform_.NumRows(); }
 
+  virtual void WriteState(std::ostream &os, bool binary) const;
+
+  virtual void ReadState(std::istream &is, bool binary);
+
  private:
-  // The static function SpliceFeats splices together the features and
-  // puts them together in a matrix, so that each row of "output" contains
-  // a contiguous window of size "context_window" of input frames.  The dimension
-  // of "output" will be feats.NumRows() - context_window + 1 by
-  // feats.NumCols() * context_window.  The input features are
-  // treated as if the frames of input1, input2 and input3 have been appended
-  // together before applying the main operation.
-  static void SpliceFrames(const MatrixBase<BaseFloat> &input1,
-                           const MatrixBase<BaseFloat> &input2,
-                           const MatrixBase<BaseFloat> &input3,
-                           int32 context_window,
-                           Matrix<BaseFloat> *output);
-
-  void TransformToOutput(const MatrixBase<BaseFloat> &spliced_feats,
-                         Matrix<BaseFloat> *output);
-  void ComputeNextRemainder(const MatrixBase<BaseFloat> &input);
-  
   OnlineFeatInputItf *input_; // underlying/inferior input object
   const int32 input_dim_; // dimension of the feature vectors before xform
   const int32 left_context_;
   const int32 right_context_;
   Matrix<BaseFloat> linear_transform_; // transform matrix (linear part only)
   Vector<BaseFloat> offset_; // Offset, if present; else empty.
-  Matrix<BaseFloat> remainder_; // The last few frames of the input, that may
-  // be needed for context purposes.
-  
+  Matrix<BaseFloat> input_buffer_; // Holds the input of each call; kept so that
+                                   // it is not reallocated each time.
+  OnlineFrameBuffer frames_; // The frames that are needed for context: the
+  // last few frames of the previous input (the "remainder"), followed by the
+  // new input.  We never splice the frames; instead we multiply each
+  // (shifted) range of frames by the corresponding block of the transform.
+
   KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineLdaInput);
 };
 
@@ -236,35 +331,55 @@ class OnlineDeltaInput: public OnlineFeatInputItf {
   virtual bool Compute(Matrix<BaseFloat> *output);
 
   virtual int32 Dim() const { return input_dim_ * (opts_.order + 1); }
+
+  virtual void WriteState(std::ostream &os, bool binary) const;
+
+  virtual void ReadState(std::istream &is, bool binary);
   
  private:
-  // The static function AppendFrames appends together the three input matrices,
-  // some of which may be empty.
-  static void AppendFrames(const MatrixBase<BaseFloat> &input1,
-                           const MatrixBase<BaseFloat> &input2,
-                           const MatrixBase<BaseFloat> &input3,
-                           Matrix<BaseFloat> *output);
-
   // Context() is the number of frames on each side of a given frame,
   // that we need for context.
   int32 Context() const { return opts_.order * opts_.window; }
   
-  // Does the delta computation.  Here, "output" will be resized to dimension
-  // (input.NumRows() - Context() * 2) by (input.NumCols() * opts_.order)
-  // "remainder" will be the last Context() rows of "input".
-  void DeltaComputation(const MatrixBase<BaseFloat> &input,
-                        Matrix<BaseFloat> *output,
-                        Matrix<BaseFloat> *remainder) const;
-  
   OnlineFeatInputItf *input_; // underlying/inferior input object
   DeltaFeaturesOptions opts_;
   const int32 input_dim_;
-  Matrix<BaseFloat> remainder_; // The last few frames of the input, that may
-  // be needed for context purposes.
+  DeltaFeatures delta_;
+  Matrix<BaseFloat> input_buffer_; // Holds the input of each call; kept so that
+                                   // it is not reallocated each time.
+  OnlineFrameBuffer frames_; // The last few frames of the previous input, that
+  // may be needed for context purposes, followed by the new input.
   
   KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineDeltaInput);
 };
 
+// Energy-based voice activity detection: passes on only the frames that
+// OnlineVadEnergy (see ../ivector/voice-activity-detection.h) judges voiced,
+// so that the stages after it and the decoder do no work on silence.  The
+// first element of the input must be a log-energy (e.g. MFCC with energy or
+// C0), so this normally comes straight after the feature extraction.  The
+// latency is opts.vad_frames_context frames.
+class OnlineVadInput: public OnlineFeatInputItf {
+ public:
+  OnlineVadInput(OnlineFeatInputItf *input, const VadEnergyOptions &opts)
+      : input_(input), vad_(opts), pending_(input->Dim()), num_dropped_(0) { }
+
+  virtual bool Compute(Matrix<BaseFloat> *output);
+
+  virtual int32 Dim() const { return input_->Dim(); }
+
+  // Returns the number of frames judged unvoiced so far.
+  int32 NumFramesDropped() const { return num_dropped_; }
+
+ private:
+  OnlineFeatInputItf *input_; // underlying feature source
+  OnlineVadEnergy vad_;
+  OnlineFrameBuffer pending_; // The frames that vad_ has not yet decided on.
+  int32 num_dropped_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineVadInput);
+};
+
 // Implementation, that is meant to be used to read samples from an
 // OnlineAudioSource and to extract MFCC/PLP features in the usual way
 template <class E>
@@ -281,6 +396,11 @@ class OnlineFeInput : public OnlineFeatInputItf {
   
   virtual bool Compute(Matrix<BaseFloat> *output);
 
+  // Only the samples left over from the last call are written.
+  virtual void WriteState(std::ostream &os, bool binary) const;
+
+  virtual void ReadState(std::istream &is, bool binary);
+
  private:
   OnlineAudioSourceItf *source_; // audio source
   E *extractor_; // the actual feature extractor used
@@ -299,6 +419,20 @@ OnlineFeInput<E>::OnlineFeInput(OnlineAudioSourceItf *au_src, E *fe,
     : source_(au_src), extractor_(fe),
       frame_size_(frame_size), frame_shift_(frame_shift) {}
 
+template<class E>
+void OnlineFeInput<E>::WriteState(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<OnlineFeInput>");
+  wave_remainder_.Write(os, binary);
+  WriteToken(os, binary, "</OnlineFeInput>");
+}
+
+template<class E>
+void OnlineFeInput<E>::ReadState(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<OnlineFeInput>");
+  wave_remainder_.Read(is, binary);
+  ExpectToken(is, binary, "</OnlineFeInput>");
+}
+
 template<class E> bool
 OnlineFeInput<E>::Compute(Matrix<BaseFloat> *output) {
   MatrixIndexT nvec = output->NumRows(); // the number of output vectors
@@ -329,6 +463,73 @@ OnlineFeInput<E>::Compute(Matrix<BaseFloat> *output) {
   return ans;
 }
 
+// Reads samples from an OnlineAudioSource and computes the (pov, pitch)
+// features of ../feat/pitch-functions.h.  Each frame is output once
+// "max_latency" further frames have been computed (or at the end of the
+// stream), so unlike the utterance-level pitch extraction the latency is
+// bounded; see class OnlinePitchExtractor.
+class OnlinePitchInput : public OnlineFeatInputItf {
+ public:
+  // "au_src" - OnlineAudioSourceItf object
+  // "opts" - the pitch extraction options
+  // "max_latency" - the number of frames of lookahead in the Viterbi traceback
+  OnlinePitchInput(OnlineAudioSourceItf *au_src,
+                   const PitchExtractionOptions &opts,
+                   int32 max_latency);
+
+  virtual int32 Dim() const { return extractor_.Dim(); }
+
+  virtual bool Compute(Matrix<BaseFloat> *output);
+
+ private:
+  OnlineAudioSourceItf *source_; // audio source
+  OnlinePitchExtractor extractor_;
+  const int32 frame_shift_; // feature frame width in audio samples
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlinePitchInput);
+};
+
+// Applies basis fMLLR (see ../transform/basis-fmllr-diag-gmm.h), estimated
+// on the fly without supervision: the stats use the posteriors of the
+// Gaussians of "gmm" (e.g. a UBM, in the space of the output features) on the
+// transformed features.  The transform is re-estimated every "update_period"
+// frames, starting from the previous one (see class
+// BasisFmllrIncrementalEstimate); each frame is output with the transform
+// that was current when it was read.
+class OnlineBasisFmllrInput: public OnlineFeatInputItf {
+ public:
+  // "input" - the underlying (untransformed) feature source
+  // "gmm" - the GMM used to get the posteriors
+  // "basis" - the fMLLR basis
+  // "opts" - options for each update; num_iters can be small, because of the
+  //          warm start.
+  // "update_period" - the number of frames between updates
+  OnlineBasisFmllrInput(OnlineFeatInputItf *input,
+                        const DiagGmm &gmm,
+                        const BasisFmllrEstimate &basis,
+                        const BasisFmllrOptions &opts,
+                        int32 update_period);
+
+  virtual bool Compute(Matrix<BaseFloat> *output);
+
+  virtual int32 Dim() const { return input_->Dim(); }
+
+  // The current transform.
+  const Matrix<BaseFloat> &Transform() const { return estimate_.Transform(); }
+
+  // Call this when a new speaker starts.
+  void Reset();
+
+ private:
+  OnlineFeatInputItf *input_; // underlying/inferior input object
+  const DiagGmm &gmm_;
+  BasisFmllrIncrementalEstimate estimate_;
+  const int32 update_period_;
+  int32 frames_since_update_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineBasisFmllrInput);
+};
+
 struct OnlineFeatureMatrixOptions {
   int32 batch_size; // number of frames to request each time.
   int32 num_tries; // number of tries of getting no output and timing out,
@@ -364,6 +565,12 @@ class OnlineFeatureMatrix {
   SubVector<BaseFloat> GetFrame(int32 frame);
 
   bool Good(); // returns true if we have at least one frame.
+
+  // Writes and reads the frames held here and then the state of the input
+  // pipeline (see OnlineFeatInputItf::WriteState()), so that decoding can
+  // carry on from the same frame in another process.
+  void WriteState(std::ostream &os, bool binary) const;
+  void ReadState(std::istream &is, bool binary);
  private:
   void GetNextFeatures(); // called when we need more features.  Guarantees
   // to get at least one more frame, or set finished_ = true.
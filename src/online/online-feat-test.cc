@@ -61,6 +61,15 @@ class OnlineMatrixInput : public OnlineFeatInputItf {
     else return true;
   }
 
+  // Like an audio source, the features themselves are not written.
+  virtual void WriteState(std::ostream &os, bool binary) const {
+    WriteBasicType(os, binary, position_);
+  }
+
+  virtual void ReadState(std::istream &is, bool binary) {
+    ReadBasicType(is, binary, &position_);
+  }
+
  private:
   int32 position_;
   Matrix<BaseFloat> feats_;
@@ -165,6 +174,102 @@ void TestOnlineLdaInput() {
 }
 
 
+void TestOnlineCmvnInput() {
+  int32 dim = 2 + rand() % 5; // dimension of features.
+  int32 num_frames = 100 + rand() % 100;
+  SlidingWindowCmnOptions opts;
+  opts.center = (rand() % 2 == 0);
+  opts.normalize_variance = (rand() % 2 == 0);
+  opts.cmn_window = 5 + rand() % 50;
+  opts.min_window = 1 + rand() % opts.cmn_window;
+
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+
+  OnlineMatrixInput matrix_input(input_feats);
+  OnlineCmvnInput cmvn_input(&matrix_input, opts);
+
+  Matrix<BaseFloat> output_feats1;
+  GetOutput(&cmvn_input, &output_feats1);
+  Matrix<BaseFloat> output_feats2(num_frames, dim);
+  SlidingWindowCmn(opts, input_feats, &output_feats2);
+  AssertEqual(output_feats1, output_feats2);
+}
+
+// With no mean term in the threshold, OnlineVadInput should output exactly
+// the frames that ComputeVadEnergy() judges voiced.
+void TestOnlineVadInput() {
+  int32 dim = 2 + rand() % 5; // dimension of features.
+  int32 num_frames = 100 + rand() % 100;
+  VadEnergyOptions opts;
+  opts.vad_energy_threshold = 0.5 * RandGauss();
+  opts.vad_energy_mean_scale = 0.0;
+  opts.vad_frames_context = rand() % 6;
+
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+
+  OnlineMatrixInput matrix_input(input_feats);
+  OnlineVadInput vad_input(&matrix_input, opts);
+
+  Matrix<BaseFloat> output_feats1;
+  GetOutput(&vad_input, &output_feats1);
+  Vector<BaseFloat> voiced;
+  ComputeVadEnergy(opts, input_feats, &voiced);
+  int32 num_voiced = static_cast<int32>(voiced.Sum() + 0.5);
+  KALDI_ASSERT(vad_input.NumFramesDropped() == num_frames - num_voiced);
+  Matrix<BaseFloat> output_feats2;
+  if (num_voiced != 0) output_feats2.Resize(num_voiced, dim);
+  for (int32 t = 0, i = 0; t < num_frames; t++)
+    if (voiced(t) != 0.0)
+      output_feats2.Row(i++).CopyFromVec(input_feats.Row(t));
+  AssertEqual(output_feats1, output_feats2);
+}
+
+void TestOnlineBasisFmllrInput() {
+  int32 dim = 2 + rand() % 5, num_gauss = 1 + rand() % 5;
+  int32 num_frames = 100 + rand() % 100, update_period = 10 + rand() % 20;
+
+  DiagGmm gmm(num_gauss, dim);
+  Matrix<BaseFloat> means(num_gauss, dim), inv_vars(num_gauss, dim);
+  means.SetRandn();
+  inv_vars.Set(1.0);
+  Vector<BaseFloat> weights(num_gauss);
+  weights.Set(1.0 / num_gauss);
+  gmm.SetWeights(weights);
+  gmm.SetInvVarsAndMeans(inv_vars, means);
+  gmm.ComputeGconsts();
+
+  BasisFmllrEstimate basis(dim);
+  int32 num_basis = dim * (dim + 1);
+  basis.fmllr_basis_.resize(num_basis);
+  for (int32 n = 0; n < num_basis; n++) {
+    basis.fmllr_basis_[n].Resize(dim, dim + 1);
+    basis.fmllr_basis_[n].SetRandn();
+    basis.fmllr_basis_[n].Scale(0.1);
+  }
+  BasisFmllrOptions opts;
+  opts.min_count = 0.0;
+
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+
+  OnlineMatrixInput matrix_input(input_feats);
+  OnlineBasisFmllrInput fmllr_input(&matrix_input, gmm, basis, opts,
+                                    update_period);
+  Matrix<BaseFloat> output_feats;
+  GetOutput(&fmllr_input, &output_feats);
+  KALDI_ASSERT(output_feats.NumRows() == num_frames);
+
+  // Until the first update, the transform is the unit one.
+  SubMatrix<BaseFloat> first_output(output_feats, 0, update_period, 0, dim),
+      first_input(input_feats, 0, update_period, 0, dim);
+  KALDI_ASSERT(first_output.ApproxEqual(first_input));
+
+  fmllr_input.Reset();
+  KALDI_ASSERT(fmllr_input.Transform().IsUnit());
+}
+
 void TestOnlineDeltaInput() {
   int32 dim = 2 + rand() % 5; // dimension of features.
   int32 num_frames = 100 + rand() % 100;
@@ -244,6 +349,74 @@ void TestOnlineCmnInput() { // We're also testing OnlineCacheInput here.
 
 
 
+// Reads part of the output of a CMVN + deltas + LDA pipeline, writes its
+// state, and checks that a new pipeline that reads the state gives the same
+// frames from there on as one that was not interrupted.
+void TestOnlineFeatCheckpoint() {
+  int32 dim = 2 + rand() % 5; // dimension of features.
+  int32 num_frames = 100 + rand() % 100;
+  SlidingWindowCmnOptions cmvn_opts;
+  cmvn_opts.normalize_variance = (rand() % 2 == 0);
+  cmvn_opts.cmn_window = 5 + rand() % 50;
+  cmvn_opts.min_window = 1 + rand() % cmvn_opts.cmn_window;
+  DeltaFeaturesOptions delta_opts;
+  delta_opts.order = 1 + rand() % 2;
+  int32 delta_dim = dim * (1 + delta_opts.order),
+      left_context = rand() % 3, right_context = rand() % 3;
+  Matrix<BaseFloat> transform(1 + rand() % delta_dim,
+                              delta_dim * (left_context + 1 + right_context));
+  transform.SetRandn();
+  OnlineFeatureMatrixOptions opts;
+  opts.num_tries = 100;
+
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+
+  Matrix<BaseFloat> ref_feats(num_frames, transform.NumRows());
+  {
+    OnlineMatrixInput matrix_input(input_feats);
+    OnlineCmvnInput cmvn_input(&matrix_input, cmvn_opts);
+    OnlineDeltaInput delta_input(delta_opts, &cmvn_input);
+    OnlineLdaInput lda_input(&delta_input, transform, left_context,
+                             right_context);
+    OnlineFeatureMatrix feature_matrix(opts, &lda_input);
+    for (int32 frame = 0; frame < num_frames; frame++) {
+      KALDI_ASSERT(feature_matrix.IsValidFrame(frame));
+      ref_feats.Row(frame).CopyFromVec(feature_matrix.GetFrame(frame));
+    }
+    KALDI_ASSERT(!feature_matrix.IsValidFrame(num_frames));
+  }
+
+  int32 checkpoint_frame = rand() % num_frames;
+  bool binary = (rand() % 2 == 0);
+  std::ostringstream os;
+  {
+    OnlineMatrixInput matrix_input(input_feats);
+    OnlineCmvnInput cmvn_input(&matrix_input, cmvn_opts);
+    OnlineDeltaInput delta_input(delta_opts, &cmvn_input);
+    OnlineLdaInput lda_input(&delta_input, transform, left_context,
+                             right_context);
+    OnlineFeatureMatrix feature_matrix(opts, &lda_input);
+    for (int32 frame = 0; frame < checkpoint_frame; frame++)
+      KALDI_ASSERT(feature_matrix.IsValidFrame(frame));
+    feature_matrix.WriteState(os, binary);
+  }
+  std::istringstream is(os.str());
+  OnlineMatrixInput matrix_input(input_feats);
+  OnlineCmvnInput cmvn_input(&matrix_input, cmvn_opts);
+  OnlineDeltaInput delta_input(delta_opts, &cmvn_input);
+  OnlineLdaInput lda_input(&delta_input, transform, left_context,
+                           right_context);
+  OnlineFeatureMatrix feature_matrix(opts, &lda_input);
+  feature_matrix.ReadState(is, binary);
+  for (int32 frame = checkpoint_frame; frame < num_frames; frame++) {
+    KALDI_ASSERT(feature_matrix.IsValidFrame(frame));
+    KALDI_ASSERT(feature_matrix.GetFrame(frame).ApproxEqual(
+        ref_feats.Row(frame)));
+  }
+  KALDI_ASSERT(!feature_matrix.IsValidFrame(num_frames));
+}
+
 }  // end namespace kaldi
 
 int main() {
@@ -253,7 +426,11 @@ int main() {
     TestOnlineFeatureMatrix();
     TestOnlineLdaInput();
     TestOnlineDeltaInput();
+    TestOnlineBasisFmllrInput();
     TestOnlineCmnInput(); // also tests cache input.
+    TestOnlineCmvnInput();
+    TestOnlineVadInput();
+    TestOnlineFeatCheckpoint();
     // I have not tested the delta input yet.
   }
   std::cout << "Test OK.\n";
@@ -0,0 +1,144 @@
+// online/online-sample-ring-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "online/online-sample-ring.h"
+
+namespace kaldi {
+
+// Writes and reads in one thread, checking the samples, the offsets, the
+// timestamps and what happens when the buffer is full.
+void TestOnlineSampleRingSingleThread() {
+  int32 capacity = 1 + rand() % 100;
+  OnlineSampleRing ring(capacity, 1 + rand() % 4);
+  int32 real_capacity = ring.WriteAvailable();
+  KALDI_ASSERT(real_capacity >= capacity && real_capacity < 2 * capacity &&
+               ring.ReadAvailable() == 0);
+  int16 next_write = 0, next_read = 0;
+  double last_timestamp = -1.0;
+  for (int32 iter = 0; iter < 200; iter++) {
+    if (rand() % 2 == 0) {
+      std::vector<int16> samples(rand() % (2 * real_capacity));
+      for (size_t i = 0; i < samples.size(); i++)
+        samples[i] = next_write + i;
+      int32 space = ring.WriteAvailable(),
+          n = ring.Write(samples.empty() ? NULL : &(samples[0]),
+                         samples.size(), iter);
+      KALDI_ASSERT(n == std::min<int32>(space, samples.size()));
+      next_write += n;
+    } else {
+      OnlineSampleChunk chunk;
+      int32 max_samples = 1 + rand() % real_capacity;
+      int64 offset = ring.NumConsumed();
+      if (!ring.PeekChunk(max_samples, &chunk)) {
+        KALDI_ASSERT(ring.ReadAvailable() == 0);
+        continue;
+      }
+      KALDI_ASSERT(chunk.num_samples > 0 && chunk.num_samples <= max_samples &&
+                   chunk.offset == offset);
+      for (int32 i = 0; i < chunk.num_samples; i++)
+        KALDI_ASSERT(chunk.data[i] == static_cast<int16>(next_read + i));
+      // Each sample gets the timestamp of the Write() that it was in, or of
+      // an earlier one if we ran out of room for timestamps.
+      KALDI_ASSERT(chunk.timestamp >= last_timestamp &&
+                   chunk.timestamp <= iter);
+      last_timestamp = chunk.timestamp;
+      int32 n = rand() % (chunk.num_samples + 1);
+      ring.Consume(n);
+      next_read += n;
+    }
+    KALDI_ASSERT(ring.ReadAvailable() ==
+                 static_cast<int16>(next_write - next_read) &&
+                 ring.ReadAvailable() + ring.WriteAvailable() == real_capacity);
+  }
+  // Nothing to wait for: it times out.
+  int32 available = ring.ReadAvailable();
+  KALDI_ASSERT(ring.Wait(available + 1, 1) == available);
+  ring.SetFinished();
+  KALDI_ASSERT(ring.IsFinished() && ring.Wait(available + 1, 0) == available);
+}
+
+struct WriterArgs {
+  OnlineSampleRing *ring;
+  int32 num_samples;
+};
+
+void *WriteSamples(void *arg) {
+  WriterArgs *args = static_cast<WriterArgs*>(arg);
+  std::vector<int16> samples(100);
+  int32 num_written = 0;
+  while (num_written < args->num_samples) {
+    int32 n = std::min<int32>(1 + rand() % samples.size(),
+                              args->num_samples - num_written);
+    for (int32 i = 0; i < n; i++)
+      samples[i] = num_written + i;
+    // We don't want to lose samples here, so write what fits and wait for
+    // room for the rest.
+    int32 m = 0;
+    while ((m += args->ring->Write(&(samples[m]), n - m,
+                                   OnlineSampleRing::Now())) < n)
+      usleep(100);
+    num_written += n;
+    if (rand() % 10 == 0) usleep(rand() % 1000);
+  }
+  args->ring->SetFinished();
+  return NULL;
+}
+
+// One thread writes, and this one waits for and reads the samples.
+void TestOnlineSampleRingTwoThreads() {
+  OnlineSampleRing ring(256);
+  WriterArgs args;
+  args.ring = &ring;
+  args.num_samples = 20000 + rand() % 1000;
+  pthread_t writer;
+  KALDI_ASSERT(pthread_create(&writer, NULL, WriteSamples, &args) == 0);
+  int16 next_read = 0;
+  double last_timestamp = -1.0;
+  while (true) {
+    int32 wanted = 1 + rand() % 256,
+        available = ring.Wait(wanted, 0);
+    KALDI_ASSERT(available >= wanted || ring.IsFinished());
+    if (available == 0) break;
+    OnlineSampleChunk chunk;
+    KALDI_ASSERT(ring.PeekChunk(wanted, &chunk));
+    for (int32 i = 0; i < chunk.num_samples; i++)
+      KALDI_ASSERT(chunk.data[i] == static_cast<int16>(next_read + i));
+    KALDI_ASSERT(chunk.timestamp >= last_timestamp &&
+                 chunk.timestamp <= OnlineSampleRing::Now());
+    last_timestamp = chunk.timestamp;
+    ring.Consume(chunk.num_samples);
+    next_read += chunk.num_samples;
+  }
+  pthread_join(writer, NULL);
+  KALDI_ASSERT(ring.NumConsumed() == args.num_samples);
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 100; i++)
+    TestOnlineSampleRingSingleThread();
+  for (int32 i = 0; i < 5; i++)
+    TestOnlineSampleRingTwoThreads();
+  KALDI_LOG << "Success.";
+}
@@ -0,0 +1,188 @@
+// online/online-sample-ring.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <errno.h>
+#include <sys/time.h>
+#include <time.h>
+#include <algorithm>
+#include <cstring>
+
+#include "online/online-sample-ring.h"
+
+namespace kaldi {
+
+static uint32 RoundUpToPowerOfTwo(int32 n) {
+  KALDI_ASSERT(n > 0 && n <= (1 << 30));
+  uint32 ans = 1;
+  while (ans < static_cast<uint32>(n)) ans <<= 1;
+  return ans;
+}
+
+OnlineSampleRing::OnlineSampleRing(int32 capacity, int32 max_timestamps):
+    buffer_(RoundUpToPowerOfTwo(capacity)), mask_(buffer_.size() - 1),
+    write_pos_(0), read_pos_(0),
+    timestamps_(RoundUpToPowerOfTwo(max_timestamps)),
+    timestamps_write_(0), timestamps_read_(0), num_consumed_(0),
+    finished_(0), waiting_(0), wait_pos_(0) {
+  if (pthread_mutex_init(&mutex_, NULL) != 0 ||
+      pthread_cond_init(&cond_, NULL) != 0)
+    KALDI_ERR << "Cannot initialize pthreads mutex or condition variable.";
+}
+
+OnlineSampleRing::~OnlineSampleRing() {
+  pthread_mutex_destroy(&mutex_);
+  pthread_cond_destroy(&cond_);
+}
+
+double OnlineSampleRing::Now() {
+#if defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+    return ts.tv_sec + 1.0e-09 * ts.tv_nsec;
+#endif
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + 1.0e-06 * tv.tv_usec;
+}
+
+int32 OnlineSampleRing::WriteAvailable() const {
+  return buffer_.size() - (write_pos_ - read_pos_);
+}
+
+int32 OnlineSampleRing::ReadAvailable() const {
+  return write_pos_ - read_pos_;
+}
+
+int32 OnlineSampleRing::Write(const int16 *samples, int32 num_samples,
+                              double timestamp) {
+  uint32 pos = write_pos_;
+  int32 n = std::min(num_samples, WriteAvailable());
+  if (n <= 0) return 0;
+  // Copy in at most two pieces, as the space may wrap around.
+  uint32 index = pos & mask_;
+  int32 n1 = std::min<int32>(n, buffer_.size() - index);
+  memcpy(&(buffer_[index]), samples, n1 * sizeof(int16));
+  if (n1 < n)
+    memcpy(&(buffer_[0]), samples + n1, (n - n1) * sizeof(int16));
+  if (timestamp >= 0.0) {
+    uint32 t = timestamps_write_;
+    if (t - timestamps_read_ < timestamps_.size()) {
+      Timestamp &ts = timestamps_[t & (timestamps_.size() - 1)];
+      ts.pos = pos;
+      ts.time = timestamp;
+      __sync_synchronize();
+      timestamps_write_ = t + 1;
+    }  // else the samples will get the timestamp of an earlier Write().
+  }
+  // The samples (and the timestamp) must be in place before the reader can
+  // see the new position.
+  __sync_synchronize();
+  write_pos_ = pos + n;
+  // This makes sure the reader sees the new position if it starts waiting
+  // after we read waiting_ (see Wait()).
+  __sync_synchronize();
+  if (waiting_ && static_cast<int32>(write_pos_ - wait_pos_) >= 0) {
+    pthread_mutex_lock(&mutex_);
+    pthread_cond_signal(&cond_);
+    pthread_mutex_unlock(&mutex_);
+  }
+  return n;
+}
+
+void OnlineSampleRing::SetFinished() {
+  __sync_synchronize();
+  finished_ = 1;
+  pthread_mutex_lock(&mutex_);
+  pthread_cond_signal(&cond_);
+  pthread_mutex_unlock(&mutex_);
+}
+
+int32 OnlineSampleRing::Wait(int32 num_samples, int32 timeout_ms) {
+  int32 available = ReadAvailable();
+  if (available >= num_samples || finished_) return available;
+  struct timespec deadline;
+  if (timeout_ms > 0) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    int64 nsec = now.tv_usec * 1000 + static_cast<int64>(timeout_ms) * 1000000;
+    deadline.tv_sec = now.tv_sec + nsec / 1000000000;
+    deadline.tv_nsec = nsec % 1000000000;
+  }
+  pthread_mutex_lock(&mutex_);
+  wait_pos_ = read_pos_ + num_samples;
+  waiting_ = 1;
+  // Either the writer sees waiting_ and signals (it needs the mutex to do so,
+  // so it can't signal before we wait), or we see its new position here.
+  __sync_synchronize();
+  while (ReadAvailable() < num_samples && !finished_) {
+    if (timeout_ms > 0) {
+      if (pthread_cond_timedwait(&cond_, &mutex_, &deadline) == ETIMEDOUT)
+        break;
+    } else {
+      pthread_cond_wait(&cond_, &mutex_);
+    }
+  }
+  waiting_ = 0;
+  pthread_mutex_unlock(&mutex_);
+  return ReadAvailable();
+}
+
+double OnlineSampleRing::TimestampOf(uint32 pos) {
+  uint32 t = timestamps_read_, end = timestamps_write_;
+  __sync_synchronize();
+  uint32 mask = timestamps_.size() - 1;
+  // Skip to the last timestamp at or before "pos".
+  while (end - t >= 2 &&
+         static_cast<int32>(timestamps_[(t + 1) & mask].pos - pos) <= 0)
+    t++;
+  double ans = -1.0;
+  if (end - t >= 1 &&
+      static_cast<int32>(timestamps_[t & mask].pos - pos) <= 0)
+    ans = timestamps_[t & mask].time;
+  if (t != timestamps_read_) {
+    __sync_synchronize();
+    timestamps_read_ = t;
+  }
+  return ans;
+}
+
+bool OnlineSampleRing::PeekChunk(int32 max_samples,
+                                 OnlineSampleChunk *chunk) {
+  int32 available = ReadAvailable();
+  __sync_synchronize();  // Read the samples after the position.
+  uint32 pos = read_pos_, index = pos & mask_;
+  int32 n = std::min<int32>(std::min(available, max_samples),
+                            buffer_.size() - index);
+  if (n <= 0) return false;
+  chunk->data = &(buffer_[index]);
+  chunk->num_samples = n;
+  chunk->offset = num_consumed_;
+  chunk->timestamp = TimestampOf(pos);
+  return true;
+}
+
+void OnlineSampleRing::Consume(int32 num_samples) {
+  KALDI_ASSERT(num_samples >= 0 && num_samples <= ReadAvailable());
+  // We must be done reading the samples before the writer can overwrite them.
+  __sync_synchronize();
+  read_pos_ += num_samples;
+  num_consumed_ += num_samples;
+}
+
+}  // namespace kaldi
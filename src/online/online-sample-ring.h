@@ -0,0 +1,149 @@
+// online/online-sample-ring.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_ONLINE_ONLINE_SAMPLE_RING_H_
+#define KALDI_ONLINE_ONLINE_SAMPLE_RING_H_
+
+#include <pthread.h>
+#include <vector>
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// A contiguous run of samples in an OnlineSampleRing, as returned by
+/// OnlineSampleRing::PeekChunk().
+struct OnlineSampleChunk {
+  const int16 *data;  // Points into the ring buffer; valid until the samples
+                      // are consumed.
+  int32 num_samples;
+  int64 offset;  // Index of data[0] in the stream (the number of samples
+                 // consumed before it).
+  double timestamp;  // Time at which data[0] was captured, on the clock of
+                     // OnlineSampleRing::Now(), or negative if not known.
+};
+
+/// OnlineSampleRing is a ring buffer of 16-bit audio samples with one writer
+/// (e.g. the PortAudio callback, or a thread reading a socket) and one reader
+/// (the decoder), which may be different threads.  Writing and reading take
+/// no locks: the writer only moves the write position and the reader only
+/// the read position.  The reader can wait for samples without polling; the
+/// writer only touches the mutex when the reader is actually waiting and
+/// enough samples have arrived, so the writer (which may be a real-time audio
+/// callback) normally never blocks.
+///
+/// Each Write() can carry the time at which its first sample was captured,
+/// and the reader gets the capture time of the first sample of each chunk it
+/// reads, so that the online decoders can measure their latency.  If samples
+/// are written faster than they are read, the ones that don't fit are
+/// dropped (Write() returns how many were written).
+class OnlineSampleRing {
+ public:
+  /// "capacity" is rounded up to a power of two.  "max_timestamps" is the
+  /// maximum number of Write() timestamps held at a time; if more writes are
+  /// waiting to be read than this, the later ones are taken to have the
+  /// timestamp of the earlier ones, which overestimates the latency.
+  explicit OnlineSampleRing(int32 capacity, int32 max_timestamps = 1024);
+
+  ~OnlineSampleRing();
+
+  // The writer's functions.
+
+  /// Appends up to "num_samples" samples, as many as there is room for, and
+  /// returns the number appended.  If "timestamp" is not negative, it is the
+  /// time (as from Now()) at which samples[0] was captured.
+  int32 Write(const int16 *samples, int32 num_samples, double timestamp);
+
+  /// Returns the number of samples that Write() could append now.
+  int32 WriteAvailable() const;
+
+  /// Says that nothing more will be written; wakes up the reader.
+  void SetFinished();
+
+  // The reader's functions.
+
+  /// Returns the number of samples that can be read now.
+  int32 ReadAvailable() const;
+
+  /// Returns true if SetFinished() has been called (there may still be
+  /// samples to read).
+  bool IsFinished() const { return finished_ != 0; }
+
+  /// Waits until at least "num_samples" samples can be read, or the writer has
+  /// finished, or "timeout_ms" milliseconds have passed (if timeout_ms > 0);
+  /// returns ReadAvailable().  "num_samples" may be more than the capacity,
+  /// but then only the writer finishing or the timeout will end the wait.
+  int32 Wait(int32 num_samples, int32 timeout_ms);
+
+  /// Gives the next readable samples, at most "max_samples" of them, without
+  /// copying them.  The chunk is contiguous, so it may be shorter than what is
+  /// available when the data wraps around the end of the buffer.  Returns
+  /// false if there is nothing to read.  The samples stay in the buffer until
+  /// Consume() is called.
+  bool PeekChunk(int32 max_samples, OnlineSampleChunk *chunk);
+
+  /// Removes the first "num_samples" readable samples from the buffer.
+  void Consume(int32 num_samples);
+
+  /// Returns the number of samples consumed so far.
+  int64 NumConsumed() const { return num_consumed_; }
+
+  /// The clock that the timestamps are on: seconds from an arbitrary point,
+  /// from a clock that does not jump when the system time is changed.
+  static double Now();
+
+ private:
+  struct Timestamp {
+    uint32 pos;  // The write position of the first sample it applies to.
+    double time;
+  };
+
+  // Returns the timestamp of the sample at read position "pos" (and forgets
+  // the timestamps of the samples before it).
+  double TimestampOf(uint32 pos);
+
+  std::vector<int16> buffer_;
+  uint32 mask_;  // buffer_.size() - 1.
+  // The positions increase without limit (modulo 2^32); the index in buffer_
+  // is pos & mask_, and the number of readable samples is write_pos_ -
+  // read_pos_.  write_pos_ is only changed by the writer, read_pos_ only by
+  // the reader.
+  volatile uint32 write_pos_;
+  volatile uint32 read_pos_;
+
+  // The timestamps, in a ring of their own, written and read in the same way.
+  std::vector<Timestamp> timestamps_;
+  volatile uint32 timestamps_write_;
+  volatile uint32 timestamps_read_;
+
+  int64 num_consumed_;  // Only used by the reader.
+
+  volatile int32 finished_;
+  // Nonzero while the reader is waiting, for write_pos_ to reach wait_pos_.
+  volatile int32 waiting_;
+  volatile uint32 wait_pos_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineSampleRing);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_ONLINE_ONLINE_SAMPLE_RING_H_
@@ -26,21 +26,21 @@ namespace kaldi {
 
 typedef kaldi::int32 int32;
 
+// The most we read from the socket at once, in bytes.  Read() only reads
+// from the socket when the ring buffer is empty, so this must be no more than
+// twice its size.
+static const int32 kTcpReceiveSize = 16384;
+
 OnlineTcpVectorSource::OnlineTcpVectorSource(int32 socket)
     : socket_desc(socket),
       connected(true),
-      pack_size(512),
-      frame_size(512),
-      last_pack_size(0),
-      last_pack_rem(0),
+      ring(kTcpReceiveSize),
+      pack_rem(-1),
+      last_timestamp(-1.0),
       samples_processed(0) {
-  pack = new char[pack_size];
-  frame = new char[frame_size];
 }
 
 OnlineTcpVectorSource::~OnlineTcpVectorSource() {
-  delete[] pack;
-  delete[] frame;
 }
 
 size_t OnlineTcpVectorSource::SamplesProcessed() {
@@ -50,106 +50,177 @@ void OnlineTcpVectorSource::ResetSamples() {
   samples_processed = 0;
 }
 
-bool OnlineTcpVectorSource::ReadFull(char* buf, int32 len) {
-  int32 to_read = len;
-  int32 has_read = 0;
-  int32 ret;
-
-  while (to_read > 0) {
-    ret = read(socket_desc, buf + has_read, to_read);
-    if (ret <= 0) {
-      connected = false;
-      return false;
+bool OnlineTcpVectorSource::ReceiveData() {
+  size_t old_size = bytes.size();
+  bytes.resize(old_size + kTcpReceiveSize);
+  int32 ret = read(socket_desc, &(bytes[old_size]), kTcpReceiveSize);
+  if (ret <= 0) {
+    bytes.resize(old_size);
+    connected = false;
+    return false;
+  }
+  bytes.resize(old_size + ret);
+  double timestamp = OnlineSampleRing::Now();
+
+  size_t pos = 0;
+  while (true) {
+    if (pack_rem < 0) {  // We need the 4-byte packet header.
+      if (bytes.size() - pos < 4) break;
+      int32 size;
+      memcpy(&size, &(bytes[pos]), 4);
+      pos += 4;
+      if (size % 2 != 0 || size < 0)
+        KALDI_ERR << "TCPVectorSource: Pack size must be even!";
+      pack_rem = size;
+    } else {
+      // Take the whole samples of the packet that we have.
+      int32 num_bytes = std::min<size_t>(pack_rem, bytes.size() - pos);
+      num_bytes -= num_bytes % 2;
+      if (num_bytes == 0 && pack_rem != 0) break;
+      if (num_bytes != 0) {
+        samples.resize(num_bytes / 2);
+        memcpy(&(samples[0]), &(bytes[pos]), num_bytes);
+        int32 n = ring.Write(&(samples[0]), samples.size(), timestamp);
+        KALDI_ASSERT(n == static_cast<int32>(samples.size()));
+      }
+      pos += num_bytes;
+      pack_rem -= num_bytes;
+      if (pack_rem == 0) pack_rem = -1;
     }
-    to_read -= ret;
-    has_read += ret;
   }
-
+  bytes.erase(bytes.begin(), bytes.begin() + pos);
   return true;
 }
 
-int OnlineTcpVectorSource::GetNextPack() {
-  int32 size = 0;
-  if (!ReadFull((char*) &size, 4))
-    return 0;
-
-  if (size % 2 != 0) {
-    KALDI_ERR<<"TCPVectorSource: Pack size must be even!";
-    return 0;
-  }
-
-  if (pack_size < size) {
-    pack_size = size;
-    delete[] pack;
-    pack = new char[pack_size];
+bool OnlineTcpVectorSource::Read(Vector<BaseFloat> *data) {
+  int32 n_elem = data->Dim(), n_read = 0;
+  last_timestamp = -1.0;
+  OnlineSampleChunk chunk;
+  while (n_read < n_elem) {
+    if (!ring.PeekChunk(n_elem - n_read, &chunk)) {
+      // The ring buffer is empty.
+      if (!connected || !ReceiveData())
+        break;
+      continue;
+    }
+    if (n_read == 0)
+      last_timestamp = chunk.timestamp;
+    for (int32 i = 0; i < chunk.num_samples; i++)
+      (*data)(n_read + i) = chunk.data[i];
+    ring.Consume(chunk.num_samples);
+    n_read += chunk.num_samples;
   }
 
-  if (!ReadFull(pack, size))
-    return 0;
+  samples_processed += n_read;
 
-  return size;
+  if (n_read < n_elem)  // The end of the stream.
+    data->Resize(n_read, kCopyData);
+  return (n_read == n_elem);
 }
 
-int OnlineTcpVectorSource::FillFrame(int32 get_size) {
-  int32 frame_offset = 0;
-  if (last_pack_rem > 0) {
-    int pack_offset = last_pack_size - last_pack_rem;
-    int size = last_pack_rem < get_size ? last_pack_rem : get_size;
-
-    memcpy(frame, pack + pack_offset, size);
-
-    last_pack_rem -= size;
-    get_size -= size;
-    frame_offset += size;
-  }
-
-  while (get_size > 0) {
-    int32 ret = GetNextPack();
+bool OnlineTcpVectorSource::IsConnected() {
+  return connected;
+}
 
-    if (ret == 0)
-      return frame_offset;
 
-    int32 size = ret < get_size ? ret : get_size;
+OnlineTcpBufferedSource::OnlineTcpBufferedSource()
+    : pack_rem_(-1), samples_offset_(0), finished_(false),
+      samples_processed_(0) {
+  if (pthread_mutex_init(&mutex_, NULL) != 0 ||
+      pthread_cond_init(&cond_, NULL) != 0)
+    KALDI_ERR << "Cannot initialize pthreads mutex or condition variable.";
+}
 
-    memcpy(frame + frame_offset, pack, size);
+OnlineTcpBufferedSource::~OnlineTcpBufferedSource() {
+  pthread_mutex_destroy(&mutex_);
+  pthread_cond_destroy(&cond_);
+}
 
-    last_pack_size = ret;
-    last_pack_rem = last_pack_size - size;
-    get_size -= size;
-    frame_offset += size;
+void OnlineTcpBufferedSource::ParseData() {
+  size_t pos = 0;
+  while (true) {
+    if (pack_rem_ < 0) {  // We need the 4-byte packet header.
+      if (bytes_.size() - pos < 4) break;
+      int32 size;
+      memcpy(&size, &(bytes_[pos]), 4);
+      pos += 4;
+      if (size % 2 != 0 || size < 0)
+        KALDI_ERR << "TCPBufferedSource: Pack size must be even!";
+      pack_rem_ = size;
+    } else {
+      // Take the whole samples of the packet that we have.
+      int32 num_bytes = std::min<size_t>(pack_rem_, bytes_.size() - pos);
+      num_bytes -= num_bytes % 2;
+      if (num_bytes == 0 && pack_rem_ != 0) break;
+      size_t old_size = samples_.size();
+      samples_.resize(old_size + num_bytes / 2);
+      if (num_bytes != 0)
+        memcpy(&(samples_[old_size]), &(bytes_[pos]), num_bytes);
+      pos += num_bytes;
+      pack_rem_ -= num_bytes;
+      if (pack_rem_ == 0) pack_rem_ = -1;
+    }
   }
-
-  return frame_offset;
+  bytes_.erase(bytes_.begin(), bytes_.begin() + pos);
 }
 
-bool OnlineTcpVectorSource::Read(Vector<BaseFloat> *data) {
-  if (!connected)
-    return false;
-
-  int32 n_elem = static_cast<uint32>(data->Dim());
-
-  int32 n_bytes = n_elem * 2;
+void OnlineTcpBufferedSource::AcceptData(const char *data, int32 num_bytes) {
+  pthread_mutex_lock(&mutex_);
+  KALDI_ASSERT(!finished_);
+  bytes_.insert(bytes_.end(), data, data + num_bytes);
+  ParseData();
+  pthread_cond_signal(&cond_);
+  pthread_mutex_unlock(&mutex_);
+}
 
-  if (frame_size < n_bytes) {
-    frame_size = n_bytes;
-    delete[] frame;
-    frame = new char[frame_size];
-  }
+void OnlineTcpBufferedSource::InputFinished() {
+  pthread_mutex_lock(&mutex_);
+  finished_ = true;
+  pthread_cond_signal(&cond_);
+  pthread_mutex_unlock(&mutex_);
+}
 
-  int32 b_read = FillFrame(n_bytes);
-  int32 n_read = b_read / 2;
+int32 OnlineTcpBufferedSource::NumSamplesAvailable() {
+  pthread_mutex_lock(&mutex_);
+  int32 ans = samples_.size() - samples_offset_;
+  pthread_mutex_unlock(&mutex_);
+  return ans;
+}
 
-  short* s_frame = (short*) frame;
-  for (int32 i = 0; i < n_read; i++)
-    (*data)(i) = s_frame[i];
+bool OnlineTcpBufferedSource::IsFinished() {
+  pthread_mutex_lock(&mutex_);
+  bool ans = finished_;
+  pthread_mutex_unlock(&mutex_);
+  return ans;
+}
 
-  samples_processed += n_read;
+size_t OnlineTcpBufferedSource::SamplesProcessed() {
+  return samples_processed_;
+}
 
-  return (n_read == n_elem);
+void OnlineTcpBufferedSource::ResetSamples() {
+  samples_processed_ = 0;
 }
 
-bool OnlineTcpVectorSource::IsConnected() {
-  return connected;
+bool OnlineTcpBufferedSource::Read(Vector<BaseFloat> *data) {
+  size_t n_elem = data->Dim();
+  pthread_mutex_lock(&mutex_);
+  while (!finished_ && samples_.size() - samples_offset_ < n_elem)
+    pthread_cond_wait(&cond_, &mutex_);
+  size_t n_read = std::min(n_elem, samples_.size() - samples_offset_);
+  for (size_t i = 0; i < n_read; i++)
+    (*data)(i) = samples_[samples_offset_ + i];
+  samples_offset_ += n_read;
+  if (samples_offset_ * 2 > samples_.size()) {
+    // Discard the samples that have been read, from time to time.
+    samples_.erase(samples_.begin(), samples_.begin() + samples_offset_);
+    samples_offset_ = 0;
+  }
+  pthread_mutex_unlock(&mutex_);
+  if (n_read < n_elem)  // The end of the stream.
+    data->Resize(n_read, kCopyData);
+  samples_processed_ += n_read;
+  return (n_read == n_elem);
 }
 
 }  // namespace kaldi
@@ -22,12 +22,17 @@
 
 #if !defined(_MSC_VER)
 
+#include <pthread.h>
+#include <vector>
+
 #include "online-audio-source.h"
 #include "matrix/kaldi-vector.h"
 
 namespace kaldi {
 /*
  * This class implements a VectorSource that reads audio data in a special format from a socket descriptor.
+ * It reads as much as the socket has (rather than one packet at a time), and keeps the samples it has not
+ * returned yet in an OnlineSampleRing, with the time they were received.
  *
  * The documentation and "interface" for this class is given in online-audio-source.h
  */
@@ -39,6 +44,8 @@ class OnlineTcpVectorSource : public OnlineAudioSourceItf {
   // Implementation of the OnlineAudioSourceItf
   bool Read(Vector<BaseFloat> *data);
 
+  double LastReadTimestamp() const { return last_timestamp; }
+
   //returns if the socket is still connected
   bool IsConnected();
 
@@ -50,25 +57,75 @@ class OnlineTcpVectorSource : public OnlineAudioSourceItf {
  private:
   int32 socket_desc;
   bool connected;
-  char* pack;
-  int32 pack_size;
-  char* frame;
-  int32 frame_size;
 
-  int32 last_pack_size, last_pack_rem;
+  OnlineSampleRing ring;  // received samples that have not been read yet
+  std::vector<char> bytes;  // received bytes not yet parsed
+  std::vector<short> samples;  // used in ReceiveData()
+  int32 pack_rem;  // bytes left in the current packet, or -1 if we are
+                   // waiting for a packet header
+  double last_timestamp;
 
   size_t samples_processed;
 
-  //runs the built-in "read" method as many times as needed to fill "buf" with "len" bytes
-  bool ReadFull(char* buf, int32 len);
-  //gets the next packet of bytes and returns its size
-  int32 GetNextPack();
-  //runs "getNextPack" enough times to fill the frame with "size" bytes
-  int32 FillFrame(int32 size);
+  //runs the built-in "read" method once, which waits for data, and moves the whole samples
+  //received to the ring buffer; returns false if the connection has closed
+  bool ReceiveData();
 
   KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineTcpVectorSource);
 };
 
+/*
+ * This class is an audio source for servers that read the sockets themselves
+ * (e.g. with epoll, to handle many connections in one thread).  The bytes read
+ * from the socket, in the same format as OnlineTcpVectorSource reads, are
+ * given to AcceptData() by the reading thread, and Read() can be called from a
+ * different thread.  Read() waits until it has all the samples requested, or
+ * until InputFinished() has been called.
+ */
+class OnlineTcpBufferedSource : public OnlineAudioSourceItf {
+ public:
+  OnlineTcpBufferedSource();
+  ~OnlineTcpBufferedSource();
+
+  // Implementation of the OnlineAudioSourceItf
+  bool Read(Vector<BaseFloat> *data);
+
+  // Adds some bytes read from the socket; they need not be whole packets.
+  void AcceptData(const char *data, int32 num_bytes);
+
+  // Call this when the connection has been closed.
+  void InputFinished();
+
+  // Returns the number of samples that have been received but not yet read.
+  int32 NumSamplesAvailable();
+
+  // Returns true if InputFinished() has been called.
+  bool IsFinished();
+
+  //returns the number of samples read since the last reset
+  size_t SamplesProcessed();
+  //resets the number of samples
+  void ResetSamples();
+
+ private:
+  // Moves whole samples from the current packet to samples_; called with the
+  // mutex locked.
+  void ParseData();
+
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;  // signaled when samples are added, or at the end.
+
+  std::vector<char> bytes_;  // Received bytes not yet parsed.
+  int32 pack_rem_;  // Bytes left in the current packet, or -1 if we are
+                    // waiting for a packet header.
+  std::vector<short> samples_;  // Samples not yet read, from
+  size_t samples_offset_;       // samples_[samples_offset_] onwards.
+  bool finished_;
+  size_t samples_processed_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineTcpBufferedSource);
+};
+
 }  // namespace kaldi
 
 #endif // !defined(_MSC_VER)
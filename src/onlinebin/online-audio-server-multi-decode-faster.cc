@@ -0,0 +1,583 @@
+// onlinebin/online-audio-server-multi-decode-faster.cc
+
+// Copyright 2026  agent
+// (based on onlinebin/online-audio-server-decode-faster.cc; see that file for its authors)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "feat/feature-mfcc.h"
+#include "online/online-tcp-source.h"
+#include "online/online-feat-input.h"
+#include "online/online-decodable.h"
+#include "online/online-faster-decoder.h"
+#include "online/onlinebin-util.h"
+#include "lat/word-align-lattice.h"
+#include "lat/lattice-functions.h"
+#include "lat/sausages.h"
+#include "lat/determinize-lattice-pruned.h"
+#include "thread/kaldi-thread.h"
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-semaphore.h"
+#include "base/timer.h"
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+#include <deque>
+#include <map>
+
+namespace kaldi {
+
+// The things that all the streams share; these are only read after startup,
+// so no locking is needed.
+struct SharedDecodingModel {
+  const TransitionModel *trans_model;
+  const AmDiagGmm *am_gmm;
+  OnlineBatchScorer *batch_scorer;  // NULL if we don't batch the scoring.
+  const fst::Fst<fst::StdArc> *decode_fst;
+  const fst::SymbolTable *word_syms;
+  const WordBoundaryInfo *word_boundary_info;
+  const Matrix<BaseFloat> *lda_transform;  // Empty if we use deltas.
+  std::vector<int32> silence_phones;
+  OnlineFasterDecoderOpts decoder_opts;
+  OnlineFeatureMatrixOptions feature_reading_opts;
+  MfccOptions mfcc_opts;
+  BaseFloat acoustic_scale;
+  int32 cmn_window;
+  int32 min_cmn_window;
+  int32 left_context;
+  int32 right_context;
+  BaseFloat frame_shift;
+};
+
+// write a line of text to socket
+bool WriteLine(int32 socket, std::string line) {
+  line = line + "\n";
+  const char *p = line.c_str();
+  int32 to_write = line.size(), wrote = 0;
+  while (to_write > 0) {
+    int32 ret = write(socket, p + wrote, to_write);
+    if (ret <= 0)
+      return false;
+    to_write -= ret;
+    wrote += ret;
+  }
+  return true;
+}
+
+// The state of one connection: its audio buffer, feature pipeline and decoder.
+// DecodeChunk() is only called by one worker thread at a time (see
+// StreamScheduler); AcceptData() of the source is called by the thread that
+// reads the sockets.
+class DecodingStream {
+ public:
+  DecodingStream(const SharedDecodingModel &model, int32 socket):
+      model_(model), socket_(socket), mfcc_(model.mfcc_opts),
+      fe_input_(&source_, &mfcc_,
+                model.mfcc_opts.frame_opts.frame_length_ms * (16000 / 1000),
+                model.mfcc_opts.frame_opts.frame_shift_ms * (16000 / 1000)),
+      cmn_input_(&fe_input_, model.cmn_window, model.min_cmn_window),
+      feat_transform_(NULL), feature_matrix_(NULL), decodable_(NULL),
+      decoder_(NULL), decoder_offset_(0), finished_(false) {
+    // we always assume 16 kHz Fs on input.
+    if (model.lda_transform->NumRows() != 0) {
+      feat_transform_ = new OnlineLdaInput(&cmn_input_, *model.lda_transform,
+                                           model.left_context,
+                                           model.right_context);
+    } else {
+      DeltaFeaturesOptions opts;
+      opts.order = 2;  // up to delta-delta derivative features.
+      feat_transform_ = new OnlineDeltaInput(opts, &cmn_input_);
+    }
+    // feature_reading_opts contains number of retries, batch size.
+    feature_matrix_ = new OnlineFeatureMatrix(model_.feature_reading_opts,
+                                              feat_transform_);
+    decodable_ = new OnlineDecodableDiagGmmScaled(*model_.am_gmm,
+                                                  *model_.trans_model,
+                                                  model_.acoustic_scale,
+                                                  feature_matrix_);
+    if (model_.batch_scorer != NULL)
+      decodable_->SetBatchScorer(model_.batch_scorer);
+    decoder_ = new OnlineFasterDecoder(*model_.decode_fst, model_.decoder_opts,
+                                       model_.silence_phones,
+                                       *model_.trans_model);
+  }
+
+  ~DecodingStream() {
+    delete decoder_;
+    delete decodable_;
+    delete feature_matrix_;
+    delete feat_transform_;
+    close(socket_);
+  }
+
+  OnlineTcpBufferedSource &Source() { return source_; }
+
+  // Returns true if DecodeChunk() can be called without (much) waiting for
+  // audio: if we have "min_samples" samples or the input has finished.
+  bool ReadyToDecode(int32 min_samples) {
+    return !finished_ && (source_.NumSamplesAvailable() >= min_samples ||
+                          source_.IsFinished());
+  }
+
+  // Decodes one batch of frames and sends the results to the client.  If
+  // there is an error, it closes the connection and we stop decoding.
+  void DecodeChunk();
+
+  // Returns true once all the input has been decoded (or there was an error).
+  bool Finished() const { return finished_; }
+
+ private:
+  void DecodeChunkInternal();
+  void SendResult();
+
+  const SharedDecodingModel &model_;
+  int32 socket_;
+  OnlineTcpBufferedSource source_;
+  Mfcc mfcc_;
+  OnlineFeInput<Mfcc> fe_input_;
+  OnlineCmnInput cmn_input_;
+  OnlineFeatInputItf *feat_transform_;
+  OnlineFeatureMatrix *feature_matrix_;
+  OnlineDecodableDiagGmmScaled *decodable_;
+  OnlineFasterDecoder *decoder_;
+  int32 decoder_offset_;
+  Timer timer_;
+  bool finished_;
+};
+
+void DecodingStream::SendResult() {
+  fst::VectorFst<LatticeArc> out_fst;
+  Lattice out_lat;
+  CompactLattice det_lat, aligned_lat;
+  DeterminizeLatticePrunedOptions det_opts;
+  det_opts.max_mem = 50000000;
+  det_opts.max_loop = 0;
+
+  decoder_->FinishTraceBack(&out_fst);
+  decoder_->GetBestPath(&out_fst);
+  ConvertLattice(out_fst, &out_lat);
+  Invert(&out_lat);
+  DeterminizeLatticePruned(out_lat, 10.0f, &det_lat, det_opts);
+  WordAlignLattice(det_lat, *model_.trans_model, *model_.word_boundary_info,
+                   0, &aligned_lat);
+  MinimumBayesRisk mbr(aligned_lat, true);
+  const std::vector<BaseFloat> &conf = mbr.GetOneBestConfidences();
+  const std::vector<int32> &word_ids = mbr.GetOneBest();
+  const std::vector<std::pair<BaseFloat, BaseFloat> > &times =
+      mbr.GetOneBestTimes();
+
+  // count number of non-sil words
+  int32 words_num = 0;
+  for (size_t i = 0; i < word_ids.size(); i++)
+    if (word_ids[i] != 0)
+      words_num++;
+  if (words_num == 0) return;
+
+  float dur = timer_.Elapsed();
+  float input_dur = source_.SamplesProcessed() / 16000.0;
+  timer_.Reset();
+  source_.ResetSamples();
+
+  std::stringstream sstr;
+  sstr << "RESULT:NUM=" << words_num << ",FORMAT=WSEC,RECO-DUR=" << dur
+       << ",INPUT-DUR=" << input_dur;
+  WriteLine(socket_, sstr.str());
+  for (size_t i = 0; i < word_ids.size(); i++) {
+    if (word_ids[i] == 0)
+      continue;  // skip silences...
+    std::string word = model_.word_syms->Find(word_ids[i]);
+    if (word.empty())
+      word = "???";
+    std::stringstream wstr;
+    wstr << word << ","
+         << (model_.frame_shift * (times[i].first + decoder_offset_)) << ","
+         << (model_.frame_shift * (times[i].second + decoder_offset_)) << ","
+         << conf[i];
+    WriteLine(socket_, wstr.str());
+  }
+}
+
+void DecodingStream::DecodeChunk() {
+  KALDI_ASSERT(!finished_);
+  try {
+    DecodeChunkInternal();
+  } catch (const std::exception &e) {
+    KALDI_WARN << "Error decoding, closing the connection: " << e.what();
+    finished_ = true;
+    // This makes the reading thread see the end of the connection; the
+    // stream is deleted after that.
+    shutdown(socket_, SHUT_RDWR);
+  }
+}
+
+void DecodingStream::DecodeChunkInternal() {
+  OnlineFasterDecoder::DecodeState dstate = decoder_->Decode(decodable_);
+  if (dstate & (OnlineFasterDecoder::kEndFeats |
+                OnlineFasterDecoder::kEndUtt)) {
+    SendResult();
+    if (dstate == OnlineFasterDecoder::kEndFeats) {
+      WriteLine(socket_, "RESULT:DONE");
+      finished_ = true;
+      return;
+    }
+    decoder_offset_ = decoder_->frame();
+  } else {
+    fst::VectorFst<LatticeArc> out_fst;
+    std::vector<int32> word_ids;
+    if (decoder_->PartialTraceback(&out_fst)) {
+      fst::GetLinearSymbolSequence(out_fst, static_cast<std::vector<int32> *>(0),
+                                   &word_ids,
+                                   static_cast<LatticeArc::Weight*>(0));
+      for (size_t i = 0; i < word_ids.size(); i++)
+        if (word_ids[i] != 0)
+          WriteLine(socket_, "PARTIAL:" + model_.word_syms->Find(word_ids[i]));
+    }
+  }
+}
+
+
+// This keeps the queue of streams that have enough audio to decode a chunk.
+// A stream is in the queue at most once, and is decoded by at most one worker
+// at a time, so the per-stream state needs no locking of its own.
+class StreamScheduler {
+ public:
+  explicit StreamScheduler(int32 chunk_samples):
+      chunk_samples_(chunk_samples) { }
+
+  // Called by the reading thread after a stream gets data.
+  void StreamUpdated(DecodingStream *stream) {
+    mutex_.Lock();
+    MaybeQueue(stream);
+    mutex_.Unlock();
+  }
+
+  // Called by the reading thread when the connection of a stream has closed;
+  // after this the stream belongs to us.  In the normal case the rest of its
+  // audio is decoded and then it is deleted.
+  void StreamClosed(DecodingStream *stream) {
+    mutex_.Lock();
+    stream->Source().InputFinished();
+    if (busy_.count(stream) == 0) {
+      if (stream->Finished()) delete stream;
+      else MaybeQueue(stream);
+    }
+    mutex_.Unlock();
+  }
+
+  // Called by the workers: waits for a stream to decode.
+  DecodingStream *GetStream() {
+    ready_.Wait();
+    mutex_.Lock();
+    DecodingStream *stream = queue_.front();
+    queue_.pop_front();
+    busy_[stream] = true;
+    mutex_.Unlock();
+    return stream;
+  }
+
+  // Called by the workers after DecodeChunk().  Deletes the stream if it is
+  // finished and its connection has closed (so the reading thread has
+  // forgotten it).
+  void StreamDone(DecodingStream *stream) {
+    mutex_.Lock();
+    busy_.erase(stream);
+    if (stream->Finished()) {
+      if (stream->Source().IsFinished()) delete stream;
+    } else {
+      MaybeQueue(stream);
+    }
+    mutex_.Unlock();
+  }
+
+ private:
+  // Called with mutex_ locked.
+  void MaybeQueue(DecodingStream *stream) {
+    if (busy_.count(stream) != 0) return;  // Queued or being decoded.
+    if (stream->ReadyToDecode(chunk_samples_)) {
+      busy_[stream] = true;
+      queue_.push_back(stream);
+      ready_.Signal();
+    }
+  }
+
+  int32 chunk_samples_;
+  Mutex mutex_;
+  Semaphore ready_;  // Counts the streams in queue_.
+  std::deque<DecodingStream*> queue_;
+  std::map<DecodingStream*, bool> busy_;  // Streams that are queued or
+                                          // being decoded.
+};
+
+
+// While a worker decodes a chunk it is a client of the batch scorer (if any),
+// so the frames of the streams being decoded at the same time are scored
+// together.
+class DecodeWorker : public MultiThreadable {
+ public:
+  DecodeWorker(StreamScheduler *scheduler, OnlineBatchScorer *batch_scorer):
+      scheduler_(scheduler), batch_scorer_(batch_scorer) { }
+  void operator() () {
+    while (true) {
+      DecodingStream *stream = scheduler_->GetStream();
+      if (batch_scorer_ != NULL) batch_scorer_->AddClient();
+      stream->DecodeChunk();
+      if (batch_scorer_ != NULL) batch_scorer_->RemoveClient();
+      scheduler_->StreamDone(stream);
+    }
+  }
+ private:
+  StreamScheduler *scheduler_;
+  OnlineBatchScorer *batch_scorer_;
+};
+
+// Must be a constant, because of the EPOLL API.
+const int32 kMaxEvents = 64;
+
+} // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Starts a TCP server that receives RAW audio and outputs aligned words,\n"
+        "like online-audio-server-decode-faster, but decoding many connections\n"
+        "at the same time on a fixed number of threads, which share the model\n"
+        "and the decoding graph.  The sockets are read with epoll in the main\n"
+        "thread, and a connection's decoder gets a chunk of work whenever it\n"
+        "has received --chunk-length seconds of new audio.\n"
+        "A sample client can be found in: onlinebin/online-audio-client\n\n"
+        "Usage: ./online-audio-server-multi-decode-faster [options] model-in "
+        "fst-in word-symbol-table silence-phones word_boundary_file tcp-port "
+        "[lda-matrix-in]\n\n"
+        "example: online-audio-server-multi-decode-faster --num-threads=8 "
+        "--rt-min=0.5 --rt-max=3.0 --max-active=6000\n"
+        "--beam=72.0 --acoustic-scale=0.0769 final.mdl graph/HCLG.fst "
+        "graph/words.txt '1:2:3:4:5'\n"
+        "graph/word_boundary_phones.txt 5010 final.mat\n\n";
+
+    ParseOptions po(usage);
+    SharedDecodingModel model;
+    model.acoustic_scale = 0.1;
+    model.cmn_window = 600;
+    model.min_cmn_window = 100;  // adds 1 second latency, only at utterance start.
+    model.right_context = 4;
+    model.left_context = 4;
+    model.frame_shift = 0.01;
+    int32 num_threads = 4;
+    BaseFloat chunk_length = 0.3;
+    bool batch_scoring = true;
+    BaseFloat batch_max_wait = 2.0;
+
+    model.decoder_opts.Register(&po, true);
+    model.feature_reading_opts.Register(&po);
+
+    po.Register("left-context", &model.left_context,
+                "Number of frames of left context");
+    po.Register("right-context", &model.right_context,
+                "Number of frames of right context");
+    po.Register("acoustic-scale", &model.acoustic_scale,
+                "Scaling factor for acoustic likelihoods");
+    po.Register("cmn-window", &model.cmn_window,
+                "Number of feat. vectors used in the running average CMN "
+                "calculation");
+    po.Register("min-cmn-window", &model.min_cmn_window,
+                "Minumum CMN window used at start of decoding (adds "
+                "latency only at start)");
+    po.Register("frame-shift", &model.frame_shift,
+                "Time in seconds between frames.");
+    po.Register("num-threads", &num_threads, "Number of decoding threads; "
+                "connections are multiplexed over them.");
+    po.Register("batch-scoring", &batch_scoring, "If true, the acoustic "
+                "likelihoods of the connections that are being decoded at "
+                "the same time are computed together, which reads each "
+                "Gaussian once for all of them (only if --num-threads > 1).");
+    po.Register("batch-max-wait", &batch_max_wait, "With --batch-scoring, "
+                "the longest time in milliseconds a frame waits for the "
+                "frames of other connections before it is scored anyway.");
+    po.Register("chunk-length", &chunk_length, "Seconds of new audio a "
+                "connection must have before it is scheduled for decoding; "
+                "it should cover a decoder batch (--batch-size frames) plus "
+                "the feature context, or threads may wait for audio.");
+
+    WordBoundaryInfoNewOpts opts;
+    opts.Register(&po);
+
+    po.Read(argc, argv);
+    if (po.NumArgs() < 6 || po.NumArgs() > 7) {
+      po.PrintUsage();
+      return 1;
+    }
+    if (num_threads < 1)
+      KALDI_ERR << "--num-threads must be at least 1";
+
+    std::string model_rspecifier = po.GetArg(1),
+        fst_rspecifier = po.GetArg(2),
+        word_syms_filename = po.GetArg(3),
+        silence_phones_str = po.GetArg(4),
+        word_boundary_file = po.GetArg(5),
+        lda_mat_rspecifier = po.GetOptArg(7);
+    int32 port = strtol(po.GetArg(6).c_str(), 0, 10);
+
+    if (!SplitStringToIntegers(silence_phones_str, ":", false,
+                               &model.silence_phones))
+      KALDI_ERR << "Invalid silence-phones string " << silence_phones_str;
+    if (model.silence_phones.empty())
+      KALDI_ERR << "No silence phones given!";
+
+    Matrix<BaseFloat> lda_transform;
+    if (lda_mat_rspecifier != "")
+      ReadKaldiObject(lda_mat_rspecifier, &lda_transform);
+    model.lda_transform = &lda_transform;
+
+    TransitionModel trans_model;
+    AmDiagGmm am_gmm;
+    {
+      bool binary;
+      Input ki(model_rspecifier, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_gmm.Read(ki.Stream(), binary);
+    }
+    model.trans_model = &trans_model;
+    model.am_gmm = &am_gmm;
+    StackedAmDiagGmm *stacked = NULL;
+    model.batch_scorer = NULL;
+    if (batch_scoring && num_threads > 1) {
+      stacked = new StackedAmDiagGmm(am_gmm);
+      model.batch_scorer = new OnlineBatchScorer(*stacked, batch_max_wait);
+    }
+
+    fst::SymbolTable *word_syms = NULL;
+    if (!(word_syms = fst::SymbolTable::ReadText(word_syms_filename)))
+      KALDI_ERR << "Could not read symbol table from file "
+                << word_syms_filename;
+    model.word_syms = word_syms;
+
+    WordBoundaryInfo info(opts, word_boundary_file);
+    model.word_boundary_info = &info;
+
+    fst::Fst<fst::StdArc> *decode_fst = ReadDecodeGraph(fst_rspecifier);
+    model.decode_fst = decode_fst;
+
+    // We are not properly registering/exposing MFCC and frame extraction
+    // options, because there are parts of the online decoding code, where some
+    // of these options are hardwired(ToDo: we should fix this at some point)
+    model.mfcc_opts.use_energy = false;
+    model.mfcc_opts.frame_opts.frame_length_ms = 25;
+    model.mfcc_opts.frame_opts.frame_shift_ms = 10;
+
+    int32 window_size = model.right_context + model.left_context + 1;
+    model.decoder_opts.batch_size = std::max(model.decoder_opts.batch_size,
+                                             window_size);
+
+    struct sockaddr_in h_addr;
+    h_addr.sin_addr.s_addr = INADDR_ANY;
+    h_addr.sin_port = htons(port);
+    h_addr.sin_family = AF_INET;
+    int32 server_desc = socket(AF_INET, SOCK_STREAM, 0);
+    if (server_desc == -1)
+      KALDI_ERR << "Cannot create TCP socket!";
+    if (bind(server_desc, (struct sockaddr*) &h_addr, sizeof(h_addr)) == -1)
+      KALDI_ERR << "Cannot bind to port: " << port << " (is it taken?)";
+    if (listen(server_desc, SOMAXCONN) == -1)
+      KALDI_ERR << "Cannot listen on port!";
+
+    int32 epoll_desc = epoll_create(kMaxEvents);
+    if (epoll_desc == -1)
+      KALDI_ERR << "epoll_create() call failed!";
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = server_desc;
+    if (epoll_ctl(epoll_desc, EPOLL_CTL_ADD, server_desc, &event) == -1)
+      KALDI_ERR << "epoll_ctl() call failed!";
+
+    StreamScheduler scheduler(static_cast<int32>(chunk_length * 16000));
+    // The workers run until the program is killed.
+    MultiThreader<DecodeWorker> workers(
+        num_threads, DecodeWorker(&scheduler, model.batch_scorer));
+
+    std::cout << "TcpServer: Listening on port: " << port << std::endl;
+
+    // Maps from socket to stream, for the connections that are open.  After a
+    // connection closes, the stream belongs to the scheduler, which deletes it
+    // when the remaining audio has been decoded.
+    std::map<int32, DecodingStream*> streams;
+    std::vector<char> buffer(65536);
+    struct epoll_event events[kMaxEvents];
+    while (true) {
+      int32 num_events = epoll_wait(epoll_desc, events, kMaxEvents, -1);
+      if (num_events == -1) {
+        if (errno == EINTR) continue;
+        KALDI_ERR << "epoll_wait() call failed!";
+      }
+      for (int32 i = 0; i < num_events; i++) {
+        int32 desc = events[i].data.fd;
+        if (desc == server_desc) {
+          int32 client_desc = accept(server_desc, NULL, NULL);
+          if (client_desc == -1) {
+            KALDI_WARN << "accept() call failed";
+            continue;
+          }
+          event.events = EPOLLIN;
+          event.data.fd = client_desc;
+          if (epoll_ctl(epoll_desc, EPOLL_CTL_ADD, client_desc, &event) == -1) {
+            KALDI_WARN << "epoll_ctl() call failed";
+            close(client_desc);
+            continue;
+          }
+          streams[client_desc] = new DecodingStream(model, client_desc);
+          KALDI_VLOG(1) << "Accepted connection; " << streams.size()
+                        << " connections are open.";
+          continue;
+        }
+        std::map<int32, DecodingStream*>::iterator iter = streams.find(desc);
+        KALDI_ASSERT(iter != streams.end());
+        DecodingStream *stream = iter->second;
+        // We don't make the sockets non-blocking, because the workers write
+        // the results to them with blocking writes.
+        ssize_t ret = recv(desc, &(buffer[0]), buffer.size(), MSG_DONTWAIT);
+        if (ret > 0) {
+          stream->Source().AcceptData(&(buffer[0]), ret);
+          scheduler.StreamUpdated(stream);
+        } else if (ret == 0 || (errno != EAGAIN && errno != EWOULDBLOCK &&
+                                errno != EINTR)) {
+          // The client disconnected (or the connection failed).
+          epoll_ctl(epoll_desc, EPOLL_CTL_DEL, desc, NULL);
+          streams.erase(iter);
+          scheduler.StreamClosed(stream);
+          KALDI_VLOG(1) << "Client disconnected; " << streams.size()
+                        << " connections are open.";
+        }
+      }
+    }
+    delete model.batch_scorer;
+    delete stacked;
+    delete word_syms;
+    delete decode_fst;
+    return 0;
+  } catch(const std::exception& e) {
+    std::cerr << e.what();
+    return -1;
+  }
+} // main()
@@ -160,6 +160,10 @@ int main(int argc, char *argv[]) {
     bool partial_res = false;
     while (1) {
       OnlineFasterDecoder::DecodeState dstate = decoder.Decode(&decodable);
+      double timestamp = au_src.LastReadTimestamp();
+      if (timestamp >= 0.0)
+        KALDI_VLOG(2) << "Latency: " << (OnlineSampleRing::Now() - timestamp)
+                      << " seconds since the start of the last audio read.";
       if (dstate & (decoder.kEndFeats | decoder.kEndUtt)) {
         std::vector<int32> word_ids;
         decoder.FinishTraceBack(&out_fst);
@@ -61,11 +61,14 @@ int main(int argc, char *argv[]) {
       min_cmn_window = 100; // adds 1 second latency, only at utterance start.
     int32 channel = -1;
     int32 right_context = 4, left_context = 4;
+    bool apply_vad = false;
 
     OnlineFasterDecoderOpts decoder_opts;
     decoder_opts.Register(&po, true);
     OnlineFeatureMatrixOptions feature_reading_opts;
     feature_reading_opts.Register(&po);
+    VadEnergyOptions vad_opts;
+    vad_opts.Register(&po);
     
     po.Register("left-context", &left_context, "Number of frames of left context");
     po.Register("right-context", &right_context, "Number of frames of right context");
@@ -78,6 +81,10 @@ int main(int argc, char *argv[]) {
                 "latency only at start)");
     po.Register("channel", &channel,
         "Channel to extract (-1 -> expect mono, 0 -> left, 1 -> right)");
+    po.Register("apply-vad", &apply_vad, "If true, frames judged unvoiced by "
+                "energy-based voice activity detection (see the --vad-* "
+                "options) are dropped before CMN and decoding.  The frame "
+                "numbers in the output keys then count only voiced frames.");
     po.Read(argc, argv);
     if (po.NumArgs() != 7 && po.NumArgs() != 8) {
       po.PrintUsage();
@@ -169,7 +176,10 @@ int main(int argc, char *argv[]) {
       FeInput fe_input(&au_src, &mfcc,
                        frame_length*(wav_data.SampFreq()/1000),
                        frame_shift*(wav_data.SampFreq()/1000));
-      OnlineCmnInput cmn_input(&fe_input, cmn_window, min_cmn_window);
+      OnlineVadInput vad_input(&fe_input, vad_opts);
+      OnlineFeatInputItf *cmn_source = &fe_input;
+      if (apply_vad) cmn_source = &vad_input;
+      OnlineCmnInput cmn_input(cmn_source, cmn_window, min_cmn_window);
       OnlineFeatInputItf *feat_transform = 0;
       if (lda_mat_rspecifier != "") {
         feat_transform = new OnlineLdaInput(
@@ -228,6 +238,9 @@ int main(int argc, char *argv[]) {
           }
         }
       }
+      if (apply_vad)
+        KALDI_LOG << "Dropped " << vad_input.NumFramesDropped()
+                  << " unvoiced frames of " << wav_key;
       if (feat_transform) delete feat_transform;
     }
     if (word_syms) delete word_syms;
@@ -256,6 +256,66 @@ void TestSgmm2PreXform(const AmSgmm2 &sgmm) {
   KALDI_ASSERT(res_vec.IsZero(1.0e-6));
 }
 
+// Tests that the matrix version of GaussianSelection() gives the same output
+// as the per-frame version.
+void TestSgmm2GaussianSelection(const AmSgmm2 &sgmm) {
+  int32 dim = sgmm.FeatureDim(), num_gauss = sgmm.NumGauss(),
+      num_frames = kaldi::RandInt(1, 20);
+  kaldi::Sgmm2GselectConfig config;
+  config.full_gmm_nbest = 1;
+  config.diag_gmm_nbest = std::max(2, num_gauss - 1);
+  kaldi::Matrix<BaseFloat> feats(num_frames, dim);
+  feats.SetRandn();
+  std::vector<std::vector<int32> > gselect;
+  BaseFloat tot_like = sgmm.GaussianSelection(config, feats, &gselect),
+      tot_like2 = 0.0;
+  KALDI_ASSERT(gselect.size() == static_cast<size_t>(num_frames));
+  for (int32 t = 0; t < num_frames; t++) {
+    std::vector<int32> this_gselect;
+    tot_like2 += sgmm.GaussianSelection(config, feats.Row(t), &this_gselect);
+    KALDI_ASSERT(gselect[t].size() == this_gselect.size());
+  }
+  kaldi::AssertEqual(tot_like, tot_like2, 1e-4);
+}
+
+// Tests that precomputing the per-speaker normalizers, and writing and reading
+// the per-speaker derived variables, do not change the likelihoods.
+void TestSgmm2PerSpkVars(const AmSgmm2 &sgmm) {
+  using namespace kaldi;
+  KALDI_ASSERT(sgmm.SpkSpaceDim() > 0 && sgmm.HasSpeakerDependentWeights());
+  Vector<BaseFloat> v_s(sgmm.SpkSpaceDim()), feat(sgmm.FeatureDim());
+  v_s.SetRandn();
+  feat.SetRandn();
+  Sgmm2PerSpkDerivedVars spk_vars, spk_vars_precomputed;
+  spk_vars.SetSpeakerVector(v_s);
+  sgmm.ComputePerSpkDerivedVars(&spk_vars);
+  spk_vars_precomputed.SetSpeakerVector(v_s);
+  sgmm.ComputePerSpkDerivedVars(&spk_vars_precomputed);
+  sgmm.ComputePerSpkNormalizers(&spk_vars_precomputed);
+
+  bool binary = (RandInt(0, 1) == 0);
+  std::ostringstream os;
+  spk_vars_precomputed.Write(os, binary);
+  Sgmm2PerSpkDerivedVars spk_vars_read;
+  std::istringstream is(os.str());
+  spk_vars_read.Read(is, binary);
+
+  Sgmm2GselectConfig config;
+  config.full_gmm_nbest = std::min(config.full_gmm_nbest, sgmm.NumGauss());
+  std::vector<int32> gselect;
+  sgmm.GaussianSelection(config, feat, &gselect);
+  Sgmm2PerFrameDerivedVars per_frame;
+  sgmm.ComputePerFrameVars(feat, gselect, spk_vars, &per_frame);
+  for (int32 pdf = 0; pdf < sgmm.NumPdfs(); pdf++) {
+    Sgmm2LikelihoodCache cache(sgmm.NumGroups(), sgmm.NumPdfs()),
+        cache_read(sgmm.NumGroups(), sgmm.NumPdfs());
+    BaseFloat loglike = sgmm.LogLikelihood(per_frame, pdf, &cache, &spk_vars),
+        loglike_read = sgmm.LogLikelihood(per_frame, pdf, &cache_read,
+                                          &spk_vars_read);
+    AssertEqual(loglike, loglike_read, 1.0e-04);
+  }
+}
+
 void UnitTestSgmm2() {
   size_t dim = 1 + kaldi::RandInt(0, 9);  // random dimension of the gmm
   size_t num_comp = 1 + kaldi::RandInt(0, 9);  // random number of mixtures
@@ -273,6 +333,13 @@ void UnitTestSgmm2() {
   TestSgmm2Substates(sgmm);
   TestSgmm2IncreaseDim(sgmm);
   TestSgmm2PreXform(sgmm);
+  TestSgmm2GaussianSelection(sgmm);
+
+  AmSgmm2 spk_sgmm;
+  spk_sgmm.InitializeFromFullGmm(full_gmm, pdf2group, dim+1,
+                                 kaldi::RandInt(1, dim), true, 0.9);
+  spk_sgmm.ComputeDerivedVars();
+  TestSgmm2PerSpkVars(spk_sgmm);
 }
 
 int main() {
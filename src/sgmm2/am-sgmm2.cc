@@ -1389,6 +1389,59 @@ void AmSgmm2::ComputePerSpkDerivedVars(Sgmm2PerSpkDerivedVars *vars) const {
   }
 }
 
+void AmSgmm2::ComputePerSpkNormalizers(Sgmm2PerSpkDerivedVars *vars) const {
+  if (vars->log_d_jms.empty()) return;  // no speaker-dependent weights.
+  KALDI_ASSERT(static_cast<int32>(vars->log_d_jms.size()) == NumGroups() &&
+               static_cast<int32>(w_jmi_.size()) == NumGroups() &&
+               "You need to call ComputeWeights().");
+  for (int32 j1 = 0; j1 < NumGroups(); j1++) {
+    Vector<BaseFloat> &log_d = vars->log_d_jms[j1];
+    if (log_d.Dim() == 0) {  // as in ComponentLogLikes().
+      log_d.Resize(NumSubstatesForGroup(j1));
+      log_d.AddMatVec(1.0, w_jmi_[j1], kNoTrans, vars->b_is, 0.0);
+      log_d.ApplyLog();
+    }
+  }
+}
+
+void Sgmm2PerSpkDerivedVars::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<Sgmm2PerSpkDerivedVars>");
+  WriteToken(os, binary, "<v_s>");
+  v_s.Write(os, binary);
+  WriteToken(os, binary, "<o_s>");
+  o_s.Write(os, binary);
+  WriteToken(os, binary, "<b_is>");
+  b_is.Write(os, binary);
+  WriteToken(os, binary, "<log_b_is>");
+  log_b_is.Write(os, binary);
+  WriteToken(os, binary, "<log_d_jms>");
+  int32 num_groups = log_d_jms.size();
+  WriteBasicType(os, binary, num_groups);
+  for (int32 j1 = 0; j1 < num_groups; j1++)
+    log_d_jms[j1].Write(os, binary);
+  WriteToken(os, binary, "</Sgmm2PerSpkDerivedVars>");
+}
+
+void Sgmm2PerSpkDerivedVars::Read(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<Sgmm2PerSpkDerivedVars>");
+  ExpectToken(is, binary, "<v_s>");
+  v_s.Read(is, binary);
+  ExpectToken(is, binary, "<o_s>");
+  o_s.Read(is, binary);
+  ExpectToken(is, binary, "<b_is>");
+  b_is.Read(is, binary);
+  ExpectToken(is, binary, "<log_b_is>");
+  log_b_is.Read(is, binary);
+  ExpectToken(is, binary, "<log_d_jms>");
+  int32 num_groups;
+  ReadBasicType(is, binary, &num_groups);
+  KALDI_ASSERT(num_groups >= 0);
+  log_d_jms.resize(num_groups);
+  for (int32 j1 = 0; j1 < num_groups; j1++)
+    log_d_jms[j1].Read(is, binary);
+  ExpectToken(is, binary, "</Sgmm2PerSpkDerivedVars>");
+}
+
 BaseFloat AmSgmm2::GaussianSelection(const Sgmm2GselectConfig &config,
                                     const VectorBase<BaseFloat> &data,
                                     std::vector<int32> *gselect) const {
@@ -1399,40 +1452,96 @@ BaseFloat AmSgmm2::GaussianSelection(const Sgmm2GselectConfig &config,
                config.full_gmm_nbest < config.diag_gmm_nbest);
   int32 num_gauss = diag_ubm_.NumGauss();
 
-  std::vector< std::pair<BaseFloat, int32> > pruned_pairs;
-  if (config.diag_gmm_nbest < num_gauss) {    Vector<BaseFloat> loglikes(num_gauss);
-    diag_ubm_.LogLikelihoods(data, &loglikes);
-    Vector<BaseFloat> loglikes_copy(loglikes);
-    BaseFloat *ptr = loglikes_copy.Data();
-    std::nth_element(ptr, ptr+num_gauss-config.diag_gmm_nbest, ptr+num_gauss);
-    BaseFloat thresh = ptr[num_gauss-config.diag_gmm_nbest];
-    for (int32 g = 0; g < num_gauss; g++)
-      if (loglikes(g) >= thresh)  // met threshold for diagonal phase.
-        pruned_pairs.push_back(
-            std::make_pair(full_ubm_.ComponentLogLikelihood(data, g), g));
-  } else {
+  if (config.diag_gmm_nbest < num_gauss) {
     Vector<BaseFloat> loglikes(num_gauss);
-    full_ubm_.LogLikelihoods(data, &loglikes);
-    for (int32 g = 0; g < num_gauss; g++)
-      pruned_pairs.push_back(std::make_pair(loglikes(g), g));
-  }
-  KALDI_ASSERT(!pruned_pairs.empty());
-  if (pruned_pairs.size() > static_cast<size_t>(config.full_gmm_nbest)) {
-    std::nth_element(pruned_pairs.begin(),
-                     pruned_pairs.end() - config.full_gmm_nbest,
-                     pruned_pairs.end());
-    pruned_pairs.erase(pruned_pairs.begin(),
-                       pruned_pairs.end() - config.full_gmm_nbest);
-  }
-  Vector<BaseFloat> loglikes_tmp(pruned_pairs.size());  // for return value.
+    diag_ubm_.LogLikelihoods(data, &loglikes);
+    return GaussianSelectionFromDiag(config, data, loglikes, gselect);
+  }
+  std::vector< std::pair<BaseFloat, int32> > pruned_pairs;
+  Vector<BaseFloat> loglikes(num_gauss);
+  full_ubm_.LogLikelihoods(data, &loglikes);
+  for (int32 g = 0; g < num_gauss; g++)
+    pruned_pairs.push_back(std::make_pair(loglikes(g), g));
+  return GaussianSelectionFinal(config, &pruned_pairs, gselect);
+}
+
+BaseFloat AmSgmm2::GaussianSelection(
+    const Sgmm2GselectConfig &config,
+    const MatrixBase<BaseFloat> &data,
+    std::vector<std::vector<int32> > *gselect) const {
+  KALDI_ASSERT(diag_ubm_.NumGauss() != 0 &&
+               diag_ubm_.NumGauss() == full_ubm_.NumGauss() &&
+               diag_ubm_.Dim() == data.NumCols());
+  KALDI_ASSERT(config.diag_gmm_nbest > 0 && config.full_gmm_nbest > 0 &&
+               config.full_gmm_nbest < config.diag_gmm_nbest);
+  int32 num_frames = data.NumRows(), num_gauss = diag_ubm_.NumGauss();
+  gselect->resize(num_frames);
+  double ans = 0.0;
+  if (config.diag_gmm_nbest >= num_gauss) {
+    // No diagonal pre-selection; everything is done per frame anyway.
+    for (int32 t = 0; t < num_frames; t++)
+      ans += GaussianSelection(config, data.Row(t), &((*gselect)[t]));
+    return ans;
+  }
+  // The diagonal stage is done as a matrix multiplication for a block of
+  // frames at a time; we don't devote more than about 10Mb to the
+  // log-likelihoods.
+  int32 max_mem = 10000000,
+      block_size = std::max<int32>(1, max_mem / (num_gauss * sizeof(BaseFloat)));
+  Matrix<BaseFloat> diag_loglikes;
+  for (int32 start = 0; start < num_frames; start += block_size) {
+    int32 this_num_frames = std::min(block_size, num_frames - start);
+    SubMatrix<BaseFloat> data_block(data, start, this_num_frames,
+                                    0, data.NumCols());
+    diag_ubm_.LogLikelihoods(data_block, &diag_loglikes);
+    for (int32 t = 0; t < this_num_frames; t++)
+      ans += GaussianSelectionFromDiag(config, data.Row(start + t),
+                                       diag_loglikes.Row(t),
+                                       &((*gselect)[start + t]));
+  }
+  return ans;
+}
+
+BaseFloat AmSgmm2::GaussianSelectionFromDiag(
+    const Sgmm2GselectConfig &config,
+    const VectorBase<BaseFloat> &data,
+    const VectorBase<BaseFloat> &diag_loglikes,
+    std::vector<int32> *gselect) const {
+  int32 num_gauss = diag_ubm_.NumGauss();
+  Vector<BaseFloat> loglikes_copy(diag_loglikes);
+  BaseFloat *ptr = loglikes_copy.Data();
+  std::nth_element(ptr, ptr+num_gauss-config.diag_gmm_nbest, ptr+num_gauss);
+  BaseFloat thresh = ptr[num_gauss-config.diag_gmm_nbest];
+  std::vector< std::pair<BaseFloat, int32> > pruned_pairs;
+  pruned_pairs.reserve(config.diag_gmm_nbest);
+  for (int32 g = 0; g < num_gauss; g++)
+    if (diag_loglikes(g) >= thresh)  // met threshold for diagonal phase.
+      pruned_pairs.push_back(
+          std::make_pair(full_ubm_.ComponentLogLikelihood(data, g), g));
+  return GaussianSelectionFinal(config, &pruned_pairs, gselect);
+}
+
+BaseFloat AmSgmm2::GaussianSelectionFinal(
+    const Sgmm2GselectConfig &config,
+    std::vector< std::pair<BaseFloat, int32> > *pruned_pairs,
+    std::vector<int32> *gselect) const {
+  KALDI_ASSERT(!pruned_pairs->empty());
+  if (pruned_pairs->size() > static_cast<size_t>(config.full_gmm_nbest)) {
+    std::nth_element(pruned_pairs->begin(),
+                     pruned_pairs->end() - config.full_gmm_nbest,
+                     pruned_pairs->end());
+    pruned_pairs->erase(pruned_pairs->begin(),
+                        pruned_pairs->end() - config.full_gmm_nbest);
+  }
+  Vector<BaseFloat> loglikes_tmp(pruned_pairs->size());  // for return value.
   KALDI_ASSERT(gselect != NULL);
-  gselect->resize(pruned_pairs.size());
+  gselect->resize(pruned_pairs->size());
   // Make sure pruned Gaussians appear from best to worst.
-  std::sort(pruned_pairs.begin(), pruned_pairs.end(),
+  std::sort(pruned_pairs->begin(), pruned_pairs->end(),
             std::greater< std::pair<BaseFloat, int32> >());
-  for (size_t i = 0; i < pruned_pairs.size(); i++) {
-    loglikes_tmp(i) = pruned_pairs[i].first;
-    (*gselect)[i] = pruned_pairs[i].second;
+  for (size_t i = 0; i < pruned_pairs->size(); i++) {
+    loglikes_tmp(i) = (*pruned_pairs)[i].first;
+    (*gselect)[i] = (*pruned_pairs)[i].second;
   }
   return loglikes_tmp.LogSumExp();
 }
@@ -181,9 +181,15 @@ class Sgmm2PerSpkDerivedVars {
     v_s.Resize(v_s_in.Dim());
     v_s.CopyFromVec(v_s_in);
   }    
+
+  /// Write and Read allow the derived variables to be precomputed (see
+  /// sgmm2-comp-spk-vars) and stored in archives.
+  void Write(std::ostream &os, bool binary) const;
+  void Read(std::istream &is, bool binary);
  protected:
   friend class AmSgmm2;
   friend class MleAmSgmm2Accs;
+  friend class FmllrSgmm2Accs;
   Vector<BaseFloat> v_s;  ///< Speaker adaptation vector v_^{(s)}. Dim is [T]
   Matrix<BaseFloat> o_s;  ///< Per-speaker offsets o_{i}. Dimension is [I][D]
   Vector<BaseFloat> b_is; /// < [SSGMM]: Eq. (22) in techreport, b_i^{(s)} = \exp(\u_i^T \v^{(s)})
@@ -272,6 +278,13 @@ class AmSgmm2 {
   BaseFloat GaussianSelection(const Sgmm2GselectConfig &config,
                               const VectorBase<BaseFloat> &data,
                               std::vector<int32> *gselect) const;
+
+  /// This version does the Gaussian selection for all the frames (rows) of
+  /// "data"; it is faster because the diagonal-covariance stage is done as a
+  /// matrix multiplication.  Returns the total log-likelihood over frames.
+  BaseFloat GaussianSelection(const Sgmm2GselectConfig &config,
+                              const MatrixBase<BaseFloat> &data,
+                              std::vector<std::vector<int32> > *gselect) const;
   
   /// This needs to be called with each new frame of data, prior to accumulation
   /// or likelihood evaluation: it computes various pre-computed quantities.
@@ -284,6 +297,14 @@ class AmSgmm2 {
   /// Computes the per-speaker derived vars; assumes vars->v_s is already
   /// set up.
   void ComputePerSpkDerivedVars(Sgmm2PerSpkDerivedVars *vars) const;
+
+  /// [SSGMM] Computes all the per-speaker normalizers d_{jm}^{(s)}, which are
+  /// otherwise computed the first time each group j1 is used; call this after
+  /// ComputePerSpkDerivedVars().  It is worth doing if "vars" will be used for
+  /// several utterances, and afterwards "vars" is not changed by the
+  /// likelihood computation.  Does nothing if the model does not have
+  /// speaker-dependent weights.
+  void ComputePerSpkNormalizers(Sgmm2PerSpkDerivedVars *vars) const;
   
   /// This does a likelihood computation for a given state using the
   /// pre-selected Gaussian components (in per_frame_vars).  If the
@@ -462,6 +483,21 @@ class AmSgmm2 {
                              const SpMatrix<BaseFloat> &sqrt_H_sm,
                              int32 j1, int32 M);
       
+  /// Called from GaussianSelection(); does the full-covariance stage for one
+  /// frame given the diagonal-covariance log-likelihoods of all Gaussians.
+  BaseFloat GaussianSelectionFromDiag(const Sgmm2GselectConfig &config,
+                                      const VectorBase<BaseFloat> &data,
+                                      const VectorBase<BaseFloat> &diag_loglikes,
+                                      std::vector<int32> *gselect) const;
+
+  /// Called from GaussianSelection(); keeps the best config.full_gmm_nbest of
+  /// the (log-likelihood, index) pairs, and outputs them sorted from best to
+  /// worst.  Returns their total log-likelihood.
+  BaseFloat GaussianSelectionFinal(
+      const Sgmm2GselectConfig &config,
+      std::vector< std::pair<BaseFloat, int32> > *pruned_pairs,
+      std::vector<int32> *gselect) const;
+
   /// Compute a subset of normalizers; used in multi-threaded implementation.
   void ComputeNormalizersInternal(int32 num_threads, int32 thread,
                                   int32 *entropy_count, double *entropy_sum);
@@ -503,8 +539,10 @@ class AmSgmm2 {
   friend class MleAmSgmm2Accs;
   friend class MleAmSgmm2Updater;
   friend class MleSgmm2SpeakerAccs;
+  friend class FmllrSgmm2Accs;
   friend class AmSgmm2Functions;  // misc functions that need access.
   friend class Sgmm2Feature;
+  friend class AmSgmm2BatchedParams;
 };
 
 template<typename Real>
@@ -580,6 +618,11 @@ typedef RandomAccessTableReader<Sgmm2GauPostHolder> RandomAccessSgmm2GauPostRead
 typedef SequentialTableReader<Sgmm2GauPostHolder> SequentialSgmm2GauPostReader;
 typedef TableWriter<Sgmm2GauPostHolder> Sgmm2GauPostWriter;
 
+typedef KaldiObjectHolder<Sgmm2PerSpkDerivedVars> Sgmm2PerSpkDerivedVarsHolder;
+typedef RandomAccessTableReader<Sgmm2PerSpkDerivedVarsHolder>
+    RandomAccessSgmm2PerSpkDerivedVarsReader;
+typedef TableWriter<Sgmm2PerSpkDerivedVarsHolder> Sgmm2PerSpkDerivedVarsWriter;
+
 }  // namespace kaldi
 
 
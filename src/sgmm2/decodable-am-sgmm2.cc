@@ -50,5 +50,164 @@ BaseFloat DecodableAmSgmm2::LogLikelihoodForPdf(int32 frame, int32 pdf_id) {
                              log_prune_);  
 }
 
+AmSgmm2BatchedParams::AmSgmm2BatchedParams(const AmSgmm2 &sgmm):
+    sgmm_(sgmm) {
+  int32 num_groups = sgmm.NumGroups(), num_gauss = sgmm.NumGauss(),
+      phn_dim = sgmm.PhoneSpaceDim();
+  group_offsets_.resize(num_groups + 1);
+  group_offsets_[0] = 0;
+  for (int32 j1 = 0; j1 < num_groups; j1++)
+    group_offsets_[j1 + 1] = group_offsets_[j1] +
+        sgmm.NumSubstatesForGroup(j1);
+  int32 num_substates = group_offsets_[num_groups];
+
+  Matrix<BaseFloat> v(num_substates, phn_dim, kUndefined),
+      n(num_substates, num_gauss, kUndefined);
+  for (int32 j1 = 0; j1 < num_groups; j1++) {
+    int32 offset = group_offsets_[j1],
+        group_substates = sgmm.NumSubstatesForGroup(j1);
+    v.Range(offset, group_substates, 0, phn_dim).CopyFromMat(sgmm.v_[j1]);
+    n.Range(offset, group_substates, 0, num_gauss).CopyFromMat(sgmm.n_[j1],
+                                                               kTrans);
+  }
+  v_.Resize(num_substates, phn_dim, kUndefined);
+  v_.CopyFromMat(v);
+  n_.Resize(num_substates, num_gauss, kUndefined);
+  n_.CopyFromMat(n);
+}
+
+void DecodableAmSgmm2Batched::Init() {
+  int32 num_substates = params_.NumSubstates();
+  if (!spk_->Empty() && sgmm_.HasSpeakerDependentWeights()) {
+    // [SSGMM] the term - log d_{jm}^{(s)} of the likelihood function.
+    Vector<BaseFloat> log_d(num_substates, kUndefined);
+    for (int32 j1 = 0; j1 < sgmm_.NumGroups(); j1++) {
+      for (int32 m = 0; m < sgmm_.NumSubstatesForGroup(j1); m++) {
+        BaseFloat d_jms = sgmm_.GetDjms(j1, m, spk_);
+        KALDI_ASSERT(d_jms > 0.0 && "Speaker vars not set up for SSGMM.");
+        log_d(params_.GroupOffset(j1) + m) = log(d_jms);
+      }
+    }
+    log_d_.Resize(num_substates, kUndefined);
+    log_d_.CopyFromVec(log_d);
+  }
+  substate_loglikes_.Resize(num_substates, kUndefined);
+  pdf_loglikes_.Resize(sgmm_.NumPdfs(), kUndefined);
+  pdf_frame_.resize(sgmm_.NumPdfs(), -1);
+}
+
+void DecodableAmSgmm2Batched::ComputeSubstateLogLikes() {
+  const std::vector<int32> &gselect = per_frame_vars_.gselect;
+  const CuMatrix<BaseFloat> &v = params_.v_;
+  int32 num_gselect = gselect.size(), num_substates = v.NumRows();
+  CuMatrix<BaseFloat> zti(num_gselect, v.NumCols(), kUndefined);
+  zti.CopyFromMat(per_frame_vars_.zti);
+  CuVector<BaseFloat> nti(per_frame_vars_.nti);
+
+  // Eq.(37) of the techreport, log p(x(t), m, i|j), for all j and m; the
+  // rows are indexed by (j, m) and the columns by the gselect index.
+  loglikes_.Resize(num_substates, num_gselect, kUndefined);
+  loglikes_.CopyCols(params_.n_, gselect);  // n_{jmi}
+  loglikes_.AddMatMat(1.0, v, kNoTrans, zti, kTrans, 1.0);  // z_i(t)^T v_{jm}
+  loglikes_.AddVecToRows(1.0, nti);  // n_i(t)
+  if (log_d_.Dim() != 0)
+    loglikes_.AddVecToCols(-1.0, log_d_);
+
+  // Now the log-sum-exp of each row, as sum_i p_i (x_i - log p_i) where p is
+  // the softmax of the row; this equals the log-sum-exp because
+  // x_i - log p_i is the same for every i.  Flooring p_i inside the log
+  // avoids 0 * -inf for elements that underflow, at negligible cost in
+  // accuracy.
+  post_.Resize(num_substates, num_gselect, kUndefined);
+  post_.ApplySoftMaxPerRow(loglikes_);
+  CuMatrix<BaseFloat> log_post(post_);
+  log_post.ApplyFloor(1.0e-20);
+  log_post.ApplyLog();
+  loglikes_.AddMat(-1.0, log_post);
+  loglikes_.MulElements(post_);
+  CuVector<BaseFloat> substate_loglikes(num_substates);
+  substate_loglikes.AddColSumMat(1.0, loglikes_, 0.0);
+  substate_loglikes.CopyToVec(&substate_loglikes_);
+}
+
+BaseFloat DecodableAmSgmm2Batched::LogLikelihoodForPdf(int32 frame,
+                                                       int32 pdf_id) {
+  if (frame != cur_frame_) {
+    cur_frame_ = frame;
+    SubVector<BaseFloat> data(*feature_matrix_, frame);
+    sgmm_.ComputePerFrameVars(data, (*gselect_)[frame], *spk_,
+                              &per_frame_vars_);
+    ComputeSubstateLogLikes();
+  }
+  if (pdf_frame_[pdf_id] == frame)
+    return pdf_loglikes_(pdf_id);
+
+  int32 j1 = sgmm_.Pdf2Group(pdf_id);
+  const Vector<BaseFloat> &c = params_.SubstateWeights(pdf_id);
+  SubVector<BaseFloat> loglikes(substate_loglikes_, params_.GroupOffset(j1),
+                                c.Dim());
+  BaseFloat max = loglikes.Max(), tot = 0.0;
+  for (int32 m = 0; m < c.Dim(); m++)
+    tot += c(m) * exp(loglikes(m) - max);
+  BaseFloat log_like = max + log(tot);
+  KALDI_ASSERT(log_like == log_like && log_like - log_like == 0); // check
+  // that it's not NaN or infinity.
+  pdf_frame_[pdf_id] = frame;
+  pdf_loglikes_(pdf_id) = log_like;
+  return log_like;
+}
+
+Sgmm2PerSpkDerivedVarsCache::Sgmm2PerSpkDerivedVarsCache(
+    const AmSgmm2 &am_sgmm, const std::string &spkvecs_rspecifier,
+    const std::string &spk_vars_rspecifier,
+    const std::string &utt2spk_rspecifier): am_sgmm_(am_sgmm),
+                                            have_cur_spk_(false) {
+  if (spkvecs_rspecifier != "" && spk_vars_rspecifier != "")
+    KALDI_ERR << "You cannot supply both speaker vectors and precomputed "
+              << "speaker-dependent variables.";
+  if (utt2spk_rspecifier != "" && !utt2spk_reader_.Open(utt2spk_rspecifier))
+    KALDI_ERR << "Error opening utt2spk map " << utt2spk_rspecifier;
+  if (spkvecs_rspecifier != "" && !spkvecs_reader_.Open(spkvecs_rspecifier))
+    KALDI_ERR << "Error opening speaker vectors " << spkvecs_rspecifier;
+  if (spk_vars_rspecifier != "" && !spk_vars_reader_.Open(spk_vars_rspecifier))
+    KALDI_ERR << "Error opening speaker-dependent variables "
+              << spk_vars_rspecifier;
+}
+
+Sgmm2PerSpkDerivedVars *Sgmm2PerSpkDerivedVarsCache::Value(
+    const std::string &utt) {
+  KALDI_ASSERT(IsOpen());
+  std::string spk = utt;
+  if (utt2spk_reader_.IsOpen()) {
+    if (!utt2spk_reader_.HasKey(utt)) {
+      KALDI_WARN << "No speaker given for utterance " << utt;
+      return NULL;
+    }
+    spk = utt2spk_reader_.Value(utt);
+  }
+  if (have_cur_spk_ && spk == cur_spk_)
+    return &cur_vars_;
+  have_cur_spk_ = false;
+  if (spk_vars_reader_.IsOpen()) {
+    if (!spk_vars_reader_.HasKey(spk)) {
+      KALDI_WARN << "Cannot find speaker-dependent variables for " << spk;
+      return NULL;
+    }
+    cur_vars_ = spk_vars_reader_.Value(spk);
+  } else {
+    if (!spkvecs_reader_.HasKey(spk)) {
+      KALDI_WARN << "Cannot find speaker vector for " << spk;
+      return NULL;
+    }
+    cur_vars_.SetSpeakerVector(spkvecs_reader_.Value(spk));
+    am_sgmm_.ComputePerSpkDerivedVars(&cur_vars_);
+  }
+  // Precomputed variables should already have these, in which case this
+  // does nothing.
+  am_sgmm_.ComputePerSpkNormalizers(&cur_vars_);
+  cur_spk_ = spk;
+  have_cur_spk_ = true;
+  return &cur_vars_;
+}
 
 }  // namespace kaldi
@@ -27,6 +27,8 @@
 #include "sgmm2/am-sgmm2.h"
 #include "hmm/transition-model.h"
 #include "itf/decodable-itf.h"
+#include "cudamatrix/cu-matrix.h"
+#include "cudamatrix/cu-vector.h"
 
 namespace kaldi {
 
@@ -132,6 +134,143 @@ class DecodableAmSgmm2Scaled : public DecodableAmSgmm2 {
   KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableAmSgmm2Scaled);
 };
 
+/// AmSgmm2BatchedParams holds copies of the parameters of an AmSgmm2 in the
+/// layout that DecodableAmSgmm2Batched uses, as CuMatrix so that they are on
+/// the GPU if one is in use.  Create it once per model, not per utterance.
+class AmSgmm2BatchedParams {
+ public:
+  /// Does not take ownership of "sgmm", which must outlive this object.
+  explicit AmSgmm2BatchedParams(const AmSgmm2 &sgmm);
+
+  const AmSgmm2 &Sgmm() const { return sgmm_; }
+
+  int32 NumSubstates() const { return v_.NumRows(); }
+
+  /// The index of the first sub-state of group j1 in the stacked quantities.
+  int32 GroupOffset(int32 j1) const { return group_offsets_[j1]; }
+
+  /// The sub-state weights c_{jm} of pdf j2.
+  const Vector<BaseFloat> &SubstateWeights(int32 j2) const {
+    return sgmm_.c_[j2];
+  }
+
+ private:
+  friend class DecodableAmSgmm2Batched;
+
+  const AmSgmm2 &sgmm_;
+  // The state vectors v_{jm} of all the groups, stacked: [total-substates][S].
+  CuMatrix<BaseFloat> v_;
+  // The normalizers n_{jmi} of all the groups, transposed relative to
+  // AmSgmm2::n_ and stacked: [total-substates][I].
+  CuMatrix<BaseFloat> n_;
+  // group_offsets_[j1] is the index of the first sub-state of group j1.
+  std::vector<int32> group_offsets_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(AmSgmm2BatchedParams);
+};
+
+
+/// DecodableAmSgmm2Batched computes the same (scaled) likelihoods as
+/// DecodableAmSgmm2Scaled, but instead of computing the sub-state likelihoods
+/// one group at a time as they are requested, on each new frame it computes,
+/// for all the sub-states of all the groups at once, the terms
+/// n_{jmi} + z_i(t)^T v_{jm} for the Gaussian-selected i, and then their
+/// log-sum over i.  This is done with CuMatrix operations, so if a GPU is in
+/// use (see CuDevice::SelectGpuId()) the bulk of the computation is done
+/// there; only the final combination with the sub-state weights of each pdf
+/// is done on the CPU, as the pdfs are requested.  This pays off because
+/// with SGMMs the decoder visits a large fraction of the pdfs on each frame.
+/// The speaker vectors should not change while this object exists.
+class DecodableAmSgmm2Batched : public DecodableAmSgmm2Scaled {
+ public:
+  DecodableAmSgmm2Batched(const AmSgmm2BatchedParams &params,
+                          const TransitionModel &tm,
+                          const Matrix<BaseFloat> &feats,
+                          const std::vector<std::vector<int32> > &gselect,
+                          BaseFloat log_prune,
+                          BaseFloat scale,
+                          Sgmm2PerSpkDerivedVars *spk)
+      : DecodableAmSgmm2Scaled(params.Sgmm(), tm, feats, gselect, log_prune,
+                               scale, spk), params_(params) { Init(); }
+
+  /// This version of the constructor takes ownership of the pointers
+  /// "feats", "gselect" and "spk", and will delete them in its
+  /// destructor.
+  DecodableAmSgmm2Batched(const AmSgmm2BatchedParams &params,
+                          const TransitionModel &tm,
+                          const Matrix<BaseFloat> *feats,
+                          const std::vector<std::vector<int32> > *gselect,
+                          Sgmm2PerSpkDerivedVars *spk,
+                          BaseFloat log_prune,
+                          BaseFloat scale)
+      : DecodableAmSgmm2Scaled(params.Sgmm(), tm, feats, gselect, spk,
+                               log_prune, scale), params_(params) { Init(); }
+
+ protected:
+  virtual BaseFloat LogLikelihoodForPdf(int32 frame, int32 pdf_id);
+
+ private:
+  // Sets up the speaker-dependent quantities and the caches.
+  void Init();
+
+  // Computes substate_loglikes_ for the current frame.
+  void ComputeSubstateLogLikes();
+
+  const AmSgmm2BatchedParams &params_;
+  // [SSGMM] log d_{jm}^{(s)}, or empty if not applicable.  [total-substates]
+  CuVector<BaseFloat> log_d_;
+
+  // Temporaries for the current frame, indexed [total-substates][gselect].
+  CuMatrix<BaseFloat> loglikes_, post_;
+  // The log-likelihood of the current frame given each sub-state (summed
+  // over the selected Gaussians).
+  Vector<BaseFloat> substate_loglikes_;
+  // Cache of the pdf log-likelihoods for frame cur_frame_: pdf_loglikes_(j2)
+  // is valid if pdf_frame_[j2] == cur_frame_.
+  Vector<BaseFloat> pdf_loglikes_;
+  std::vector<int32> pdf_frame_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableAmSgmm2Batched);
+};
+
+/// Sgmm2PerSpkDerivedVarsCache supplies the per-speaker derived variables for
+/// each utterance to be decoded.  They are computed from the speaker vector
+/// (or read, if precomputed by sgmm2-comp-spk-vars) once per speaker and
+/// reused for as long as consecutive utterances have the same speaker, which
+/// is the case when the utterances are sorted by speaker.  With
+/// speaker-dependent weights this avoids recomputing the normalizers
+/// d_{jm}^{(s)} for every utterance.
+class Sgmm2PerSpkDerivedVarsCache {
+ public:
+  /// At most one of "spkvecs_rspecifier" and "spk_vars_rspecifier" may be
+  /// nonempty.  If "utt2spk_rspecifier" is nonempty those tables are indexed
+  /// by speaker, otherwise by utterance.
+  Sgmm2PerSpkDerivedVarsCache(const AmSgmm2 &am_sgmm,
+                              const std::string &spkvecs_rspecifier,
+                              const std::string &spk_vars_rspecifier,
+                              const std::string &utt2spk_rspecifier);
+
+  /// Returns false if neither speaker vectors nor derived variables were
+  /// given, i.e. decoding is speaker independent.
+  bool IsOpen() const {
+    return spkvecs_reader_.IsOpen() || spk_vars_reader_.IsOpen();
+  }
+
+  /// Returns the derived variables for utterance "utt", or NULL (with a
+  /// warning) if they are not available.  The pointer is valid until the
+  /// next call; the variables are fully computed, so decoding does not
+  /// change them.
+  Sgmm2PerSpkDerivedVars *Value(const std::string &utt);
+
+ private:
+  const AmSgmm2 &am_sgmm_;
+  RandomAccessTokenReader utt2spk_reader_;
+  RandomAccessBaseFloatVectorReader spkvecs_reader_;
+  RandomAccessSgmm2PerSpkDerivedVarsReader spk_vars_reader_;
+  bool have_cur_spk_;
+  std::string cur_spk_;
+  Sgmm2PerSpkDerivedVars cur_vars_;  // the derived variables for cur_spk_.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(Sgmm2PerSpkDerivedVarsCache);
+};
 
 }  // namespace kaldi
 
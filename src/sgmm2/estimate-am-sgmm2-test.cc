@@ -23,6 +23,7 @@
 #include "sgmm2/am-sgmm2.h"
 #include "sgmm2/estimate-am-sgmm2.h"
 #include "util/kaldi-io.h"
+#include "thread/kaldi-thread.h"
 
 using kaldi::AmSgmm2;
 using kaldi::MleAmSgmm2Accs;
@@ -118,6 +119,93 @@ void TestSgmm2AccsIO(const AmSgmm2 &sgmm,
   delete sgmm3;
 }
 
+// Tests that stats accumulated in two parts and combined with Add() give the
+// same update as stats accumulated all at once.
+void TestSgmm2AccsAdd(const AmSgmm2 &sgmm,
+                      const kaldi::Matrix<BaseFloat> &feats) {
+  using namespace kaldi;
+  kaldi::SgmmUpdateFlagsType flags = kaldi::kSgmmAll & ~kSgmmSpeakerWeightProjections;
+  kaldi::Sgmm2PerFrameDerivedVars frame_vars;
+  kaldi::Sgmm2PerSpkDerivedVars empty;
+  frame_vars.Resize(sgmm.NumGauss(), sgmm.FeatureDim(),
+                    sgmm.PhoneSpaceDim());
+  kaldi::Sgmm2GselectConfig sgmm_config;
+  sgmm_config.full_gmm_nbest = std::min(sgmm_config.full_gmm_nbest,
+                                        sgmm.NumGauss());
+  // No random pruning, as it would make the two sets of stats differ.
+  MleAmSgmm2Accs accs(sgmm, flags, true, 0.0), accs1(sgmm, flags, true, 0.0),
+      accs2(sgmm, flags, true, 0.0);
+  int32 split = RandInt(0, feats.NumRows());
+  for (int32 i = 0; i < feats.NumRows(); i++) {
+    std::vector<int32> gselect;
+    sgmm.GaussianSelection(sgmm_config, feats.Row(i), &gselect);
+    sgmm.ComputePerFrameVars(feats.Row(i), gselect, empty, &frame_vars);
+    accs.Accumulate(sgmm, frame_vars, 0, 1.0, &empty);
+    (i < split ? accs1 : accs2).Accumulate(sgmm, frame_vars, 0, 1.0, &empty);
+  }
+  accs.CommitStatsForSpk(sgmm, empty);
+  accs1.CommitStatsForSpk(sgmm, empty);
+  accs2.CommitStatsForSpk(sgmm, empty);
+  accs1.Add(accs2);
+
+  kaldi::MleAmSgmm2Options update_opts;
+  kaldi::MleAmSgmm2Updater updater(update_opts);
+  AmSgmm2 sgmm_a, sgmm_b;
+  sgmm_a.CopyFromSgmm2(sgmm, false, false);
+  updater.Update(accs, &sgmm_a, flags);
+  sgmm_a.ComputeDerivedVars();
+  sgmm_b.CopyFromSgmm2(sgmm, false, false);
+  updater.Update(accs1, &sgmm_b, flags);
+  sgmm_b.ComputeDerivedVars();
+
+  std::vector<int32> gselect;
+  sgmm_a.GaussianSelection(sgmm_config, feats.Row(0), &gselect);
+  sgmm_a.ComputePerFrameVars(feats.Row(0), gselect, empty, &frame_vars);
+  Sgmm2LikelihoodCache like_cache_a(sgmm_a.NumGroups(), sgmm_a.NumPdfs());
+  BaseFloat loglike_a = sgmm_a.LogLikelihood(frame_vars, 0, &like_cache_a,
+                                             &empty);
+  sgmm_b.ComputePerFrameVars(feats.Row(0), gselect, empty, &frame_vars);
+  Sgmm2LikelihoodCache like_cache_b(sgmm_b.NumGroups(), sgmm_b.NumPdfs());
+  BaseFloat loglike_b = sgmm_b.LogLikelihood(frame_vars, 0, &like_cache_b,
+                                             &empty);
+  kaldi::AssertEqual(loglike_a, loglike_b, 1e-4);
+}
+
+// Tests that MleSgmm2SpeakerAccs::AccumulateForUtterance(), which uses several
+// threads, gives the same speaker vector as accumulating frame by frame.
+void TestSgmm2SpeakerAccsThreaded(const AmSgmm2 &sgmm,
+                                  const kaldi::Matrix<BaseFloat> &feats) {
+  using namespace kaldi;
+  int32 num_frames = feats.NumRows();
+  Sgmm2PerSpkDerivedVars empty;
+  Sgmm2PerFrameDerivedVars frame_vars;
+  Sgmm2GselectConfig sgmm_config;
+  sgmm_config.full_gmm_nbest = std::min(sgmm_config.full_gmm_nbest,
+                                        sgmm.NumGauss());
+  std::vector<std::vector<int32> > gselect(num_frames);
+  std::vector<std::vector<std::pair<int32, BaseFloat> > > pdf_post(num_frames);
+  // No random pruning, as it would make the two sets of stats differ.
+  MleSgmm2SpeakerAccs accs(sgmm, 0.0), accs2(sgmm, 0.0);
+  for (int32 t = 0; t < num_frames; t++) {
+    sgmm.GaussianSelection(sgmm_config, feats.Row(t), &gselect[t]);
+    pdf_post[t].push_back(std::make_pair(0, 1.0));
+    sgmm.ComputePerFrameVars(feats.Row(t), gselect[t], empty, &frame_vars);
+    accs.Accumulate(sgmm, frame_vars, 0, 1.0, &empty);
+  }
+  int32 num_threads_bak = g_num_threads;
+  g_num_threads = 3;
+  accs2.AccumulateForUtterance(sgmm, feats, gselect, pdf_post, &empty);
+  g_num_threads = num_threads_bak;
+
+  Vector<BaseFloat> v_s, v_s2;
+  BaseFloat impr, impr2, count, count2;
+  accs.Update(sgmm, 0.0, &v_s, &impr, &count);
+  accs2.Update(sgmm, 0.0, &v_s2, &impr2, &count2);
+  AssertEqual(count, count2, 1.0e-04);
+  AssertEqual(impr, impr2, 1.0e-03);
+  KALDI_ASSERT(v_s.ApproxEqual(v_s2, 1.0e-03));
+}
+
 void UnitTestEstimateSgmm2() {
   int32 dim = 1 + kaldi::RandInt(0, 9);  // random dimension of the gmm
   int32 num_comp = 2 + kaldi::RandInt(0, 9);  // random mixture size
@@ -152,6 +240,8 @@ void UnitTestEstimateSgmm2() {
   }
   sgmm.ComputeDerivedVars();
   TestSgmm2AccsIO(sgmm, feats);
+  TestSgmm2AccsAdd(sgmm, feats);
+  TestSgmm2SpeakerAccsThreaded(sgmm, feats);
 }
 
 int main() {
@@ -601,6 +601,38 @@ void MleAmSgmm2Accs::CommitStatsForSpk(const AmSgmm2 &model,
   a_s_.SetZero();
 }
 
+void MleAmSgmm2Accs::Add(const MleAmSgmm2Accs &other) {
+  KALDI_ASSERT(num_gaussians_ == other.num_gaussians_ &&
+               num_groups_ == other.num_groups_ &&
+               num_pdfs_ == other.num_pdfs_ &&
+               feature_dim_ == other.feature_dim_ &&
+               Y_.size() == other.Y_.size() && Z_.size() == other.Z_.size() &&
+               R_.size() == other.R_.size() && S_.size() == other.S_.size() &&
+               y_.size() == other.y_.size() &&
+               gamma_.size() == other.gamma_.size() &&
+               a_.size() == other.a_.size() && U_.size() == other.U_.size() &&
+               gamma_c_.size() == other.gamma_c_.size() &&
+               t_.NumRows() == other.t_.NumRows());
+  // gamma_s_ and a_s_ are per-speaker temporaries; they should have been
+  // committed.
+  KALDI_ASSERT((other.gamma_s_.Dim() == 0 || other.gamma_s_.IsZero()) &&
+               (other.a_s_.Dim() == 0 || other.a_s_.IsZero()));
+  for (size_t i = 0; i < Y_.size(); i++) Y_[i].AddMat(1.0, other.Y_[i]);
+  for (size_t i = 0; i < Z_.size(); i++) Z_[i].AddMat(1.0, other.Z_[i]);
+  for (size_t i = 0; i < R_.size(); i++) R_[i].AddSp(1.0, other.R_[i]);
+  for (size_t i = 0; i < S_.size(); i++) S_[i].AddSp(1.0, other.S_[i]);
+  for (size_t j1 = 0; j1 < y_.size(); j1++) y_[j1].AddMat(1.0, other.y_[j1]);
+  for (size_t j1 = 0; j1 < gamma_.size(); j1++)
+    gamma_[j1].AddMat(1.0, other.gamma_[j1]);
+  for (size_t j1 = 0; j1 < a_.size(); j1++) a_[j1].AddMat(1.0, other.a_[j1]);
+  for (size_t j2 = 0; j2 < gamma_c_.size(); j2++)
+    gamma_c_[j2].AddVec(1.0, other.gamma_c_[j2]);
+  if (t_.NumRows() != 0) t_.AddMat(1.0, other.t_);
+  for (size_t i = 0; i < U_.size(); i++) U_[i].AddSp(1.0, other.U_[i]);
+  total_frames_ += other.total_frames_;
+  total_like_ += other.total_like_;
+}
+
 void MleAmSgmm2Accs::GetStateOccupancies(Vector<BaseFloat> *occs) const {
   int32 J2 = gamma_c_.size();
   occs->Resize(J2);
@@ -1720,16 +1752,40 @@ MleSgmm2SpeakerAccs::MleSgmm2SpeakerAccs(const AmSgmm2 &model,
 
   gamma_s_.Resize(model.NumGauss());
   y_s_.Resize(model.SpkSpaceDim());
+  sum_x_.Resize(model.NumGauss(), model.FeatureDim());
+  sum_v_.Resize(model.NumGauss(), model.PhoneSpaceDim());
   if (model.HasSpeakerDependentWeights())
     a_s_.Resize(model.NumGauss());
 }
 
+MleSgmm2SpeakerAccs::MleSgmm2SpeakerAccs(const MleSgmm2SpeakerAccs &other,
+                                         bool stats_only)
+    : y_s_(other.y_s_.Dim()),
+      sum_x_(other.sum_x_.NumRows(), other.sum_x_.NumCols()),
+      sum_v_(other.sum_v_.NumRows(), other.sum_v_.NumCols()),
+      gamma_s_(other.gamma_s_.Dim()), a_s_(other.a_s_.Dim()),
+      rand_prune_(other.rand_prune_) {
+  KALDI_ASSERT(stats_only);
+}
+
 void MleSgmm2SpeakerAccs::Clear() {
   y_s_.SetZero();
+  sum_x_.SetZero();
+  sum_v_.SetZero();
   gamma_s_.SetZero();
   if (a_s_.Dim() != 0) a_s_.SetZero();
 }
 
+void MleSgmm2SpeakerAccs::AddStats(const MleSgmm2SpeakerAccs &other) {
+  KALDI_ASSERT(SameDim(sum_x_, other.sum_x_) &&
+               SameDim(sum_v_, other.sum_v_) &&
+               a_s_.Dim() == other.a_s_.Dim());
+  sum_x_.AddMat(1.0, other.sum_x_);
+  sum_v_.AddMat(1.0, other.sum_v_);
+  gamma_s_.AddVec(1.0, other.gamma_s_);
+  if (a_s_.Dim() != 0) a_s_.AddVec(1.0, other.a_s_);
+}
+
 BaseFloat
 MleSgmm2SpeakerAccs::Accumulate(const AmSgmm2 &model,
                                const Sgmm2PerFrameDerivedVars &frame_vars,
@@ -1752,50 +1808,154 @@ MleSgmm2SpeakerAccs::AccumulateFromPosteriors(const AmSgmm2 &model,
                                              int32 j2,
                                              Sgmm2PerSpkDerivedVars *spk_vars) {
   double tot_count = 0.0;
-  int32 feature_dim = model.FeatureDim(),
-      spk_space_dim = model.SpkSpaceDim();
-  KALDI_ASSERT(spk_space_dim != 0);
+  KALDI_ASSERT(model.SpkSpaceDim() != 0);
   const vector<int32> &gselect = frame_vars.gselect;
 
-  // Intermediate variables
-  Vector<double> xt_jmi(feature_dim), mu_jmi(feature_dim),
-      zt_jmi(spk_space_dim);
   int32 num_substates = model.NumSubstatesForPdf(j2),
       j1 = model.Pdf2Group(j2);
   bool have_spk_dep_weights = (a_s_.Dim() != 0);
 
-  for (int32 m = 0; m < num_substates; m++) {
-    BaseFloat gammat_jm = 0.0;
-    for (int32 ki = 0; ki < static_cast<int32>(gselect.size()); ki++) {
-      int32 i = gselect[ki];
+  // Intermediate variables
+  Vector<BaseFloat> gammat_jm(num_substates), gammat_jmi(num_substates),
+      v_sum(model.PhoneSpaceDim());
+
+  for (int32 ki = 0; ki < static_cast<int32>(gselect.size()); ki++) {
+    int32 i = gselect[ki];
+    BaseFloat gammat_ji = 0.0;
+    for (int32 m = 0; m < num_substates; m++) {
       // Eq. (39): gamma_{jmi}(t) = p (j, m, i|t)
-      BaseFloat gammat_jmi = RandPrune(posteriors(ki, m), rand_prune_);
-      if (gammat_jmi != 0.0) {
-        gammat_jm += gammat_jmi;
-        tot_count += gammat_jmi;
-        model.GetSubstateMean(j1, m, i, &mu_jmi);
-        xt_jmi.CopyFromVec(frame_vars.xt);
-        xt_jmi.AddVec(-1.0, mu_jmi);
-        // Eq. (48): z{jmi}(t) = N_{i}^{T} \Sigma_{i}^{-1} x_{jmi}(t)
-        zt_jmi.AddMatVec(1.0, NtransSigmaInv_[i], kNoTrans, xt_jmi, 0.0);
-        // Eq. (49): \gamma_{i}^{(s)} = \sum_{t\in\Tau(s), j, m} gamma_{jmi}
-        gamma_s_(i) += gammat_jmi;
-        // Eq. (50): y^{(s)} = \sum_{t, j, m, i} gamma_{jmi}(t) z_{jmi}(t)
-        y_s_.AddVec(gammat_jmi, zt_jmi);
-      }
+      gammat_jmi(m) = RandPrune(posteriors(ki, m), rand_prune_);
+      gammat_ji += gammat_jmi(m);
+    }
+    if (gammat_ji != 0.0) {
+      gammat_jm.AddVec(1.0, gammat_jmi);
+      tot_count += gammat_ji;
+      for (int32 m = 0; m < num_substates; m++)
+        gammat_jmi(m) /= gammat_ji;
+      // Eq. (49): \gamma_{i}^{(s)} = \sum_{t\in\Tau(s), j, m} gamma_{jmi}
+      gamma_s_(i) += gammat_ji;
+      // Stats for Eqs. (48) and (50); see ComputeY().
+      sum_x_.Row(i).AddVec(gammat_ji, frame_vars.xt);
+      // (gammat_jmi is normalized so that this does not underflow when the
+      // posteriors are tiny.)
+      v_sum.AddMatVec(1.0, model.v_[j1], kTrans, gammat_jmi, 0.0);
+      sum_v_.Row(i).AddVec(gammat_ji, v_sum);
     }
-    if (have_spk_dep_weights) {
-      KALDI_ASSERT(!model.w_jmi_.empty());
+  }
+  if (have_spk_dep_weights) {
+    KALDI_ASSERT(!model.w_jmi_.empty());
+    for (int32 m = 0; m < num_substates; m++) {
       BaseFloat d_jms = model.GetDjms(j1, m, spk_vars);
       if (d_jms == -1.0) d_jms = 1.0; // Explanation: d_jms is set to -1 when we didn't have
       // speaker vectors in training.  We treat this the same as the speaker vector being
       // zero, and d_jms becomes 1 in this case.
-      a_s_.AddVec(gammat_jm/d_jms, model.w_jmi_[j1].Row(m));
+      a_s_.AddVec(gammat_jm(m)/d_jms, model.w_jmi_[j1].Row(m));
     }
   }
   return tot_count;
 }
 
+// Accumulates speaker-vector statistics for a range of frames of an
+// utterance, for MleSgmm2SpeakerAccs::AccumulateForUtterance().  Each copy
+// accumulates into its own statistics, which the destructor adds to the
+// original accumulators.
+class AccumulateSpeakerStatsClass: public MultiThreadable {
+ public:
+  AccumulateSpeakerStatsClass(
+      const AmSgmm2 &model,
+      const MatrixBase<BaseFloat> &feats,
+      const std::vector<std::vector<int32> > &gselect,
+      const std::vector<std::vector<std::pair<int32, BaseFloat> > > &pdf_post,
+      Sgmm2PerSpkDerivedVars *spk_vars,
+      MleSgmm2SpeakerAccs *accs,
+      double *tot_like):
+      model_(model), feats_(feats), gselect_(gselect), pdf_post_(pdf_post),
+      spk_vars_(spk_vars), dest_accs_(accs), accs_(NULL),
+      tot_like_ptr_(tot_like), tot_like_(0.0) { }
+  AccumulateSpeakerStatsClass(const AccumulateSpeakerStatsClass &other):
+      model_(other.model_), feats_(other.feats_), gselect_(other.gselect_),
+      pdf_post_(other.pdf_post_), spk_vars_(other.spk_vars_),
+      dest_accs_(other.dest_accs_),
+      accs_(new MleSgmm2SpeakerAccs(*other.dest_accs_, true)),
+      tot_like_ptr_(other.tot_like_ptr_), tot_like_(0.0) { }
+  void operator () () {
+    int32 num_frames = feats_.NumRows(),
+        block_size = (num_frames + num_threads_ - 1) / num_threads_,
+        block_start = block_size * thread_id_,
+        block_end = std::min(num_frames, block_start + block_size);
+    Sgmm2PerFrameDerivedVars per_frame_vars;
+    for (int32 t = block_start; t < block_end; t++) {
+      model_.ComputePerFrameVars(feats_.Row(t), gselect_[t], *spk_vars_,
+                                 &per_frame_vars);
+      for (size_t j = 0; j < pdf_post_[t].size(); j++) {
+        int32 pdf_id = pdf_post_[t][j].first;
+        BaseFloat weight = pdf_post_[t][j].second;
+        tot_like_ += weight * accs_->Accumulate(model_, per_frame_vars, pdf_id,
+                                                weight, spk_vars_);
+      }
+    }
+  }
+  ~AccumulateSpeakerStatsClass() {
+    if (accs_ != NULL) {
+      dest_accs_->AddStats(*accs_);
+      *tot_like_ptr_ += tot_like_;
+      delete accs_;
+    }
+  }
+ private:
+  const AmSgmm2 &model_;
+  const MatrixBase<BaseFloat> &feats_;
+  const std::vector<std::vector<int32> > &gselect_;
+  const std::vector<std::vector<std::pair<int32, BaseFloat> > > &pdf_post_;
+  Sgmm2PerSpkDerivedVars *spk_vars_;  // not changed, see
+                                      // AccumulateForUtterance().
+  MleSgmm2SpeakerAccs *dest_accs_;
+  MleSgmm2SpeakerAccs *accs_;  // NULL for the object we copy the others from.
+  double *tot_like_ptr_;
+  double tot_like_;
+};
+
+BaseFloat MleSgmm2SpeakerAccs::AccumulateForUtterance(
+    const AmSgmm2 &model,
+    const MatrixBase<BaseFloat> &feats,
+    const std::vector<std::vector<int32> > &gselect,
+    const std::vector<std::vector<std::pair<int32, BaseFloat> > > &pdf_post,
+    Sgmm2PerSpkDerivedVars *spk_vars) {
+  KALDI_ASSERT(gselect.size() == static_cast<size_t>(feats.NumRows()) &&
+               pdf_post.size() == static_cast<size_t>(feats.NumRows()));
+  // After this, the likelihood computation does not need to change spk_vars,
+  // so the threads can share it.
+  model.ComputePerSpkNormalizers(spk_vars);
+  // Don't use more threads than are worthwhile for a short utterance: each
+  // thread's statistics have to be added up at the end.
+  const int32 kMinFramesPerThread = 50;
+  int32 num_threads = std::max<int32>(
+      1, std::min<int32>(g_num_threads, feats.NumRows() / kMinFramesPerThread));
+  double tot_like = 0.0;
+  AccumulateSpeakerStatsClass c(model, feats, gselect, pdf_post, spk_vars,
+                                this, &tot_like);
+  {
+    MultiThreader<AccumulateSpeakerStatsClass> m(num_threads, c);
+  }
+  return tot_like;
+}
+
+void MleSgmm2SpeakerAccs::ComputeY(const AmSgmm2 &model) {
+  // Eq. (48): z_{jmi}(t) = N_{i}^{T} \Sigma_{i}^{-1} (x(t) - M_i v_{jm}), so
+  // Eq. (50) is y^{(s)} = \sum_i N_{i}^{T} \Sigma_{i}^{-1}
+  //   (\sum_{t,j,m} gamma_{jmi}(t) x(t) - M_i \sum_{t,j,m} gamma_{jmi}(t) v_{jm}).
+  int32 num_gauss = gamma_s_.Dim();
+  y_s_.SetZero();
+  Vector<double> x_i(model.FeatureDim());
+  for (int32 i = 0; i < num_gauss; i++) {
+    if (gamma_s_(i) == 0.0) continue;
+    x_i.CopyFromVec(sum_x_.Row(i));
+    x_i.AddMatVec(-1.0, Matrix<double>(model.M_[i]), kNoTrans, sum_v_.Row(i),
+                  1.0);
+    y_s_.AddMatVec(1.0, NtransSigmaInv_[i], kNoTrans, x_i, 1.0);
+  }
+}
+
 void MleSgmm2SpeakerAccs::Update(const AmSgmm2 &model,
                                 BaseFloat min_count,
                                 Vector<BaseFloat> *v_s,
@@ -1809,6 +1969,7 @@ void MleSgmm2SpeakerAccs::Update(const AmSgmm2 &model,
     if (count_out) *count_out = 0.0;
     return;
   }
+  ComputeY(model);
   if (a_s_.Dim() == 0) // No speaker-dependent weights...
     UpdateNoU(v_s, objf_impr_out, count_out);
   else
@@ -174,6 +174,12 @@ class MleAmSgmm2Accs {
   /// speaker's data.
   void CommitStatsForSpk(const AmSgmm2 &model,
                          const Sgmm2PerSpkDerivedVars &spk_vars);
+
+  /// Adds the stats in "other", which must have the same dimensions and the
+  /// same accumulators present, to these stats.  "other" must not have any
+  /// uncommitted per-speaker stats (call CommitStatsForSpk() first).  This is
+  /// used to combine stats accumulated in separate threads.
+  void Add(const MleAmSgmm2Accs &other);
   
   /// Accessors
   void GetStateOccupancies(Vector<BaseFloat> *occs) const;
@@ -382,7 +388,23 @@ class MleSgmm2SpeakerAccs {
                                      const Matrix<BaseFloat> &posteriors,
                                      int32 pdf_index,
                                      Sgmm2PerSpkDerivedVars *spk_vars);
-  
+
+  /// Accumulates statistics for a whole utterance, using up to g_num_threads
+  /// threads (each of which takes a range of frames).  "pdf_post" gives, for
+  /// each frame, the posteriors of pdfs (not transition-ids; see
+  /// ConvertPosteriorToPdfs()).  Calls AmSgmm2::ComputePerSpkNormalizers() on
+  /// "spk_vars" first, so that the threads do not modify it.  Returns the
+  /// total log-likelihood, weighted by the posteriors.
+  BaseFloat AccumulateForUtterance(
+      const AmSgmm2 &model,
+      const MatrixBase<BaseFloat> &feats,
+      const std::vector<std::vector<int32> > &gselect,
+      const std::vector<std::vector<std::pair<int32, BaseFloat> > > &pdf_post,
+      Sgmm2PerSpkDerivedVars *spk_vars);
+
+  /// Adds the statistics of "other", which must be for the same model.
+  void AddStats(const MleSgmm2SpeakerAccs &other);
+
   /// Update speaker vector.  If v_s was empty, will assume it started as zero
   /// and will resize it to the speaker-subspace size.
   void Update(const AmSgmm2 &model,
@@ -402,11 +424,26 @@ class MleSgmm2SpeakerAccs {
                    Vector<BaseFloat> *v_s,
                    BaseFloat *objf_impr_out,
                    BaseFloat *count_out);
-  
-  
+
+  // Used by AccumulateForUtterance(): initializes the statistics to zero,
+  // with the same dimensions as in "other", but does not set up H_spk_ and
+  // NtransSigmaInv_, which are only needed by Update().
+  MleSgmm2SpeakerAccs(const MleSgmm2SpeakerAccs &other, bool stats_only);
+  friend class AccumulateSpeakerStatsClass;
+
+  // Computes y_s_ from sum_x_ and sum_v_.
+  void ComputeY(const AmSgmm2 &model);
+
   /// Statistics for speaker adaptation (vectors), stored per-speaker.
-  /// Per-speaker stats for vectors, y^{(s)}. Dimension [T].
+  /// Per-speaker stats for vectors, y^{(s)}. Dimension [T].  Computed from
+  /// sum_x_ and sum_v_ in Update().
   Vector<double> y_s_;
+  /// \sum_{t, j, m} gamma_{jmi}(t) x(t), dimension is [I][D], and
+  /// \sum_{t, j, m} gamma_{jmi}(t) v_{jm}, dimension is [I][S].  Since
+  /// Eq. (50) is linear in x(t) - M_i v_{jm}, y^{(s)} can be computed from
+  /// these, which is much cheaper than computing z_{jmi}(t) on each frame.
+  Matrix<double> sum_x_;
+  Matrix<double> sum_v_;
   /// gamma_{i}^{(s)}.  Per-speaker counts for each Gaussian. Dimension is [I]
   Vector<double> gamma_s_;
   /// a_i^{(s)}.  For SSGMM.
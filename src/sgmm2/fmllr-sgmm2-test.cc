@@ -24,6 +24,7 @@
 #include "sgmm2/am-sgmm2.h"
 #include "sgmm2/fmllr-sgmm2.h"
 #include "util/kaldi-io.h"
+#include "thread/kaldi-thread.h"
 
 using kaldi::AmSgmm2;
 using kaldi::int32;
@@ -191,6 +192,67 @@ void TestSgmm2FmllrSubspace(const AmSgmm2 &sgmm,
   KALDI_LOG << "Test Subspace end.";
 }
 
+// Tests that AccumulateForUtterance(), which uses several threads, gives the
+// same statistics as accumulating frame by frame, and checks the K statistics
+// against a direct computation from the sub-state means.
+void TestSgmm2FmllrAccumulateForUtterance(const AmSgmm2 &sgmm,
+                                          const kaldi::Matrix<BaseFloat> &feats) {
+  using namespace kaldi;
+  int32 dim = sgmm.FeatureDim(), num_frames = feats.NumRows();
+  Sgmm2PerSpkDerivedVars spk_vars;
+  Vector<BaseFloat> v_s(sgmm.SpkSpaceDim());
+  v_s.SetRandn();
+  spk_vars.SetSpeakerVector(v_s);
+  sgmm.ComputePerSpkDerivedVars(&spk_vars);
+
+  Sgmm2GselectConfig sgmm_config;
+  sgmm_config.full_gmm_nbest = std::min(sgmm_config.full_gmm_nbest,
+                                        sgmm.NumGauss());
+  std::vector<std::vector<int32> > gselect(num_frames);
+  std::vector<std::vector<std::pair<int32, BaseFloat> > > pdf_post(num_frames);
+  FmllrSgmm2Accs accs;
+  accs.Init(dim, sgmm.NumGauss());
+  Matrix<double> K(dim, dim + 1);
+  double beta = 0.0;
+  Sgmm2PerFrameDerivedVars frame_vars;
+  for (int32 t = 0; t < num_frames; t++) {
+    sgmm.GaussianSelection(sgmm_config, feats.Row(t), &gselect[t]);
+    BaseFloat weight = 0.5 + RandUniform();
+    pdf_post[t].push_back(std::make_pair(0, weight));
+    sgmm.ComputePerFrameVars(feats.Row(t), gselect[t], spk_vars, &frame_vars);
+    accs.Accumulate(sgmm, feats.Row(t), frame_vars, 0, weight, &spk_vars);
+
+    Matrix<BaseFloat> posteriors;
+    sgmm.ComponentPosteriors(frame_vars, 0, &spk_vars, &posteriors);
+    posteriors.Scale(weight);
+    Vector<double> extended_data(dim + 1), var_scaled_mean(dim);
+    extended_data.Range(0, dim).CopyFromVec(feats.Row(t));
+    extended_data(dim) = 1.0;
+    for (int32 ki = 0; ki < static_cast<int32>(gselect[t].size()); ki++) {
+      for (int32 m = 0; m < posteriors.NumCols(); m++) {
+        sgmm.GetVarScaledSubstateSpeakerMean(0, m, gselect[t][ki], spk_vars,
+                                             &var_scaled_mean);
+        K.AddVecVec(posteriors(ki, m), var_scaled_mean, extended_data);
+        beta += posteriors(ki, m);
+      }
+    }
+  }
+  AssertEqual(accs.stats().beta_, beta, 1.0e-03);
+  KALDI_ASSERT(K.ApproxEqual(accs.stats().K_, 1.0e-03));
+
+  int32 num_threads_bak = g_num_threads;
+  g_num_threads = 3;
+  FmllrSgmm2Accs accs2;
+  accs2.Init(dim, sgmm.NumGauss());
+  accs2.AccumulateForUtterance(sgmm, feats, feats, gselect, pdf_post,
+                               &spk_vars);
+  g_num_threads = num_threads_bak;
+  AssertEqual(accs.stats().beta_, accs2.stats().beta_, 1.0e-04);
+  KALDI_ASSERT(accs.stats().K_.ApproxEqual(accs2.stats().K_, 1.0e-04));
+  for (int32 i = 0; i < sgmm.NumGauss(); i++)
+    KALDI_ASSERT(accs.stats().G_[i].ApproxEqual(accs2.stats().G_[i], 1.0e-04));
+}
+
 void TestSgmm2Fmllr() {
   // srand(time(NULL));
   int32 dim = 1 + kaldi::RandInt(0, 9);  // random dimension of the gmm
@@ -203,7 +265,7 @@ void TestSgmm2Fmllr() {
   std::vector<int32> pdf2group;
   pdf2group.push_back(0);
   sgmm.InitializeFromFullGmm(full_gmm, pdf2group, dim+1, dim, true, 0.9);
-  sgmm.ComputeNormalizers();
+  sgmm.ComputeDerivedVars();  // normalizers, and weights for the SSGMM.
 
   kaldi::Matrix<BaseFloat> feats;
 
@@ -226,6 +288,7 @@ void TestSgmm2Fmllr() {
   }
   TestSgmm2FmllrAccsIO(sgmm, feats);
   TestSgmm2FmllrSubspace(sgmm, feats);
+  TestSgmm2FmllrAccumulateForUtterance(sgmm, feats);
 }
 
 int main() {
@@ -25,6 +25,7 @@ using std::vector;
 
 #include "sgmm2/fmllr-sgmm2.h"
 #include "util/parse-options.h"
+#include "thread/kaldi-thread.h"
 
 namespace kaldi {
 
@@ -180,28 +181,136 @@ void FmllrSgmm2Accs::AccumulateFromPosteriors(
   extended_data(dim_) = 1.0;
   SpMatrix<double> scatter(dim_+1, kSetZero);
   scatter.AddVec2(1.0, extended_data);
-  int32 j1 = model.Pdf2Group(j2);
+  int32 j1 = model.Pdf2Group(j2),
+      num_substates = model.NumSubstatesForGroup(j1);
+  bool have_spk_vec = (spk.v_s.Dim() != 0);
+  Vector<BaseFloat> gammat_jmi(num_substates), v_sum(model.PhoneSpaceDim()),
+      mean(dim_), scaled_mean(dim_);
   for (int32 ki = 0, ki_max = gselect.size(); ki < ki_max; ki++) {
     int32 i = gselect[ki];
 
-    for (int32 m = 0; m < model.NumSubstatesForGroup(j1); m++) {
-      // posterior gamma_{jkmi}(t)                             eq.(39)
-      BaseFloat gammat_jmi = posteriors(ki, m);
-
-      // Accumulate statistics for non-zero gaussian posterior
-      if (gammat_jmi > 0.0) {
-        stats_.beta_ += gammat_jmi;
-        model.GetVarScaledSubstateSpeakerMean(j1, m, i, spk,
-                                              &var_scaled_mean);
-        // Eq. (52): K += \gamma_{jmi} \Sigma_{i}^{-1} \mu_{jmi}^{(s)} x^{+T}
-        stats_.K_.AddVecVec(gammat_jmi, var_scaled_mean, extended_data);
-        // Eq. (53): G_{i} += \gamma_{jmi} x^{+} x^{+T}
-        stats_.G_[i].AddSp(gammat_jmi, scatter);
-      }  // non-zero posteriors
-    }  // loop over substates
+    // posteriors gamma_{jkmi}(t)                             eq.(39)
+    BaseFloat gammat_ji = 0.0;
+    for (int32 m = 0; m < num_substates; m++) {
+      gammat_jmi(m) = std::max<BaseFloat>(posteriors(ki, m), 0.0);
+      gammat_ji += gammat_jmi(m);
+    }
+    // Accumulate statistics for non-zero gaussian posterior
+    if (gammat_ji > 0.0) {
+      stats_.beta_ += gammat_ji;
+      // \sum_m \gamma_{jmi} \mu_{jmi}^{(s)}
+      //   = \gamma_{ji} (M_i \sum_m (\gamma_{jmi} / \gamma_{ji}) v_{jm} + o_i^{(s)});
+      // this does the sum over sub-states before multiplying by M_i.  (The
+      // posteriors are normalized so the float computations don't underflow
+      // when they are tiny.)
+      for (int32 m = 0; m < num_substates; m++)
+        gammat_jmi(m) /= gammat_ji;
+      v_sum.AddMatVec(1.0, model.v_[j1], kTrans, gammat_jmi, 0.0);
+      mean.AddMatVec(1.0, model.M_[i], kNoTrans, v_sum, 0.0);
+      if (have_spk_vec)
+        mean.AddVec(1.0, spk.o_s.Row(i));
+      scaled_mean.AddSpVec(1.0, model.SigmaInv_[i], mean, 0.0);
+      var_scaled_mean.CopyFromVec(scaled_mean);
+      // Eq. (52): K += \gamma_{jmi} \Sigma_{i}^{-1} \mu_{jmi}^{(s)} x^{+T}
+      stats_.K_.AddVecVec(gammat_ji, var_scaled_mean, extended_data);
+      // Eq. (53): G_{i} += \gamma_{jmi} x^{+} x^{+T}
+      stats_.G_[i].AddSp(gammat_ji, scatter);
+    }  // non-zero posteriors
   }  // loop over selected Gaussians
 }
 
+// Accumulates fMLLR statistics for a range of frames of an utterance, for
+// FmllrSgmm2Accs::AccumulateForUtterance().  Each copy accumulates into its
+// own statistics, which the destructor adds to the original accumulators.
+class AccumulateFmllrStatsClass: public MultiThreadable {
+ public:
+  AccumulateFmllrStatsClass(
+      const AmSgmm2 &model,
+      const MatrixBase<BaseFloat> &feats,
+      const MatrixBase<BaseFloat> &transformed_feats,
+      const std::vector<std::vector<int32> > &gselect,
+      const std::vector<std::vector<std::pair<int32, BaseFloat> > > &pdf_post,
+      Sgmm2PerSpkDerivedVars *spk,
+      FmllrSgmm2Accs *accs,
+      double *tot_like):
+      model_(model), feats_(feats), transformed_feats_(transformed_feats),
+      gselect_(gselect), pdf_post_(pdf_post), spk_(spk), dest_accs_(accs),
+      accs_(NULL), tot_like_ptr_(tot_like), tot_like_(0.0) { }
+  AccumulateFmllrStatsClass(const AccumulateFmllrStatsClass &other):
+      model_(other.model_), feats_(other.feats_),
+      transformed_feats_(other.transformed_feats_), gselect_(other.gselect_),
+      pdf_post_(other.pdf_post_), spk_(other.spk_),
+      dest_accs_(other.dest_accs_), accs_(new FmllrSgmm2Accs()),
+      tot_like_ptr_(other.tot_like_ptr_), tot_like_(0.0) {
+    accs_->Init(model_.FeatureDim(), model_.NumGauss());
+  }
+  void operator () () {
+    int32 num_frames = feats_.NumRows(),
+        block_size = (num_frames + num_threads_ - 1) / num_threads_,
+        block_start = block_size * thread_id_,
+        block_end = std::min(num_frames, block_start + block_size);
+    Sgmm2PerFrameDerivedVars per_frame_vars;
+    Matrix<BaseFloat> posteriors;
+    for (int32 t = block_start; t < block_end; t++) {
+      // The per-frame vars are only used for computing the posteriors.
+      model_.ComputePerFrameVars(transformed_feats_.Row(t), gselect_[t], *spk_,
+                                 &per_frame_vars);
+      for (size_t j = 0; j < pdf_post_[t].size(); j++) {
+        int32 pdf_id = pdf_post_[t][j].first;
+        BaseFloat weight = pdf_post_[t][j].second;
+        tot_like_ += weight * model_.ComponentPosteriors(per_frame_vars, pdf_id,
+                                                         spk_, &posteriors);
+        posteriors.Scale(weight);
+        accs_->AccumulateFromPosteriors(model_, *spk_, feats_.Row(t),
+                                        gselect_[t], posteriors, pdf_id);
+      }
+    }
+  }
+  ~AccumulateFmllrStatsClass() {
+    if (accs_ != NULL) {
+      dest_accs_->Add(*accs_);
+      *tot_like_ptr_ += tot_like_;
+      delete accs_;
+    }
+  }
+ private:
+  const AmSgmm2 &model_;
+  const MatrixBase<BaseFloat> &feats_;
+  const MatrixBase<BaseFloat> &transformed_feats_;
+  const std::vector<std::vector<int32> > &gselect_;
+  const std::vector<std::vector<std::pair<int32, BaseFloat> > > &pdf_post_;
+  Sgmm2PerSpkDerivedVars *spk_;  // not changed, see AccumulateForUtterance().
+  FmllrSgmm2Accs *dest_accs_;
+  FmllrSgmm2Accs *accs_;  // NULL for the object we copy the others from.
+  double *tot_like_ptr_;
+  double tot_like_;
+};
+
+BaseFloat FmllrSgmm2Accs::AccumulateForUtterance(
+    const AmSgmm2 &model,
+    const MatrixBase<BaseFloat> &feats,
+    const MatrixBase<BaseFloat> &transformed_feats,
+    const std::vector<std::vector<int32> > &gselect,
+    const std::vector<std::vector<std::pair<int32, BaseFloat> > > &pdf_post,
+    Sgmm2PerSpkDerivedVars *spk) {
+  KALDI_ASSERT(SameDim(feats, transformed_feats) &&
+               gselect.size() == static_cast<size_t>(feats.NumRows()) &&
+               pdf_post.size() == static_cast<size_t>(feats.NumRows()));
+  model.ComputePerSpkNormalizers(spk);
+  // Each thread has its own copy of the statistics, which are of size
+  // I (D+1)^2 / 2, so only use as many threads as the utterance is worth.
+  const int32 kMinFramesPerThread = 50;
+  int32 num_threads = std::max<int32>(
+      1, std::min<int32>(g_num_threads, feats.NumRows() / kMinFramesPerThread));
+  double tot_like = 0.0;
+  AccumulateFmllrStatsClass c(model, feats, transformed_feats, gselect,
+                              pdf_post, spk, this, &tot_like);
+  {
+    MultiThreader<AccumulateFmllrStatsClass> m(num_threads, c);
+  }
+  return tot_like;
+}
+
 void FmllrSgmm2Accs::AccumulateForFmllrSubspace(const AmSgmm2 &sgmm,
     const Sgmm2FmllrGlobalParams &globals, SpMatrix<double> *grad_scatter) {
   if (stats_.beta_ <= 0.0) {
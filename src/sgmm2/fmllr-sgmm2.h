@@ -149,6 +149,26 @@ class FmllrSgmm2Accs {
                                 const Matrix<BaseFloat> &posteriors,
                                 int32 state_index);
 
+  /// Accumulates statistics for a whole utterance, using up to g_num_threads
+  /// threads (each of which takes a range of frames).  "feats" are the
+  /// features the transform is to be estimated for; the Gaussian posteriors
+  /// are computed with "transformed_feats" (which may be the same, or already
+  /// transformed by a previous estimate).  "pdf_post" gives, for each frame,
+  /// the posteriors of pdfs (see ConvertPosteriorToPdfs()).  Calls
+  /// AmSgmm2::ComputePerSpkNormalizers() on "spk" first, so that the threads
+  /// do not modify it.  Returns the total log-likelihood, weighted by the
+  /// posteriors.
+  BaseFloat AccumulateForUtterance(
+      const AmSgmm2 &sgmm,
+      const MatrixBase<BaseFloat> &feats,
+      const MatrixBase<BaseFloat> &transformed_feats,
+      const std::vector<std::vector<int32> > &gselect,
+      const std::vector<std::vector<std::pair<int32, BaseFloat> > > &pdf_post,
+      Sgmm2PerSpkDerivedVars *spk);
+
+  /// Adds the statistics of "other", which must have the same dimensions.
+  void Add(const FmllrSgmm2Accs &other) { stats_.Add(other.stats_); }
+
   void AccumulateForFmllrSubspace(const AmSgmm2 &sgmm,
                                   const Sgmm2FmllrGlobalParams &fmllr_globals,
                                   SpMatrix<double> *grad_scatter);
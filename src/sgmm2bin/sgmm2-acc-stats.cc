@@ -26,6 +26,164 @@
 #include "hmm/transition-model.h"
 #include "sgmm2/estimate-am-sgmm2.h"
 #include "hmm/posterior.h"
+#include "thread/kaldi-task-sequence.h"
+#include "thread/kaldi-mutex.h"
+
+namespace kaldi {
+
+// This class holds one set of accumulators (SGMM and transition stats) for
+// each thread, so that the threads can accumulate without locking; a task
+// takes a set from the pool while it runs and gives it back afterwards.  At
+// most one set per thread is ever in use at a time, so none are waited for.
+// The first set is the caller's own stats (not owned here); the others are
+// added to it by Combine().
+class Sgmm2AccsPool {
+ public:
+  Sgmm2AccsPool(const AmSgmm2 &am_sgmm, const TransitionModel &trans_model,
+                SgmmUpdateFlagsType acc_flags, bool have_spk_vecs,
+                BaseFloat rand_prune, int32 num_sets,
+                MleAmSgmm2Accs *sgmm_accs, Vector<double> *transition_accs) {
+    KALDI_ASSERT(num_sets > 0);
+    sgmm_accs_.push_back(sgmm_accs);
+    transition_accs_.push_back(transition_accs);
+    for (int32 i = 1; i < num_sets; i++) {
+      sgmm_accs_.push_back(new MleAmSgmm2Accs(am_sgmm, acc_flags,
+                                              have_spk_vecs, rand_prune));
+      transition_accs_.push_back(new Vector<double>());
+      trans_model.InitStats(transition_accs_.back());
+    }
+    for (int32 i = num_sets - 1; i >= 0; i--)
+      free_.push_back(i);
+  }
+
+  // Returns the index of a free set of accumulators.
+  int32 Get() {
+    mutex_.Lock();
+    KALDI_ASSERT(!free_.empty());
+    int32 ans = free_.back();
+    free_.pop_back();
+    mutex_.Unlock();
+    return ans;
+  }
+
+  void Release(int32 i) {
+    mutex_.Lock();
+    free_.push_back(i);
+    mutex_.Unlock();
+  }
+
+  MleAmSgmm2Accs *SgmmAccs(int32 i) { return sgmm_accs_[i]; }
+
+  Vector<double> *TransitionAccs(int32 i) { return transition_accs_[i]; }
+
+  // Adds all the stats into the first set (the caller's) and frees the
+  // others.  Call this when all the tasks have finished.
+  void Combine() {
+    for (size_t i = 1; i < sgmm_accs_.size(); i++) {
+      sgmm_accs_[0]->Add(*(sgmm_accs_[i]));
+      transition_accs_[0]->AddVec(1.0, *(transition_accs_[i]));
+      delete sgmm_accs_[i];
+      delete transition_accs_[i];
+    }
+    sgmm_accs_.resize(1);
+    transition_accs_.resize(1);
+  }
+
+  ~Sgmm2AccsPool() { Combine(); }
+
+ private:
+  std::vector<MleAmSgmm2Accs*> sgmm_accs_;
+  std::vector<Vector<double>*> transition_accs_;
+  std::vector<int32> free_;
+  Mutex mutex_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(Sgmm2AccsPool);
+};
+
+// This class accumulates the stats for one utterance, so that utterances can
+// be processed in parallel.  The per-speaker stats are committed at the end
+// of each utterance rather than of each speaker, which gives the same stats
+// because they are linear in the data for a fixed speaker vector.
+class Sgmm2AccStatsTask {
+ public:
+  Sgmm2AccStatsTask(const AmSgmm2 &am_sgmm,
+                    const TransitionModel &trans_model,
+                    const std::string &utt,
+                    const Matrix<BaseFloat> &features,
+                    const Posterior &posterior,
+                    const std::vector<std::vector<int32> > &gselect,
+                    const Sgmm2PerSpkDerivedVars &spk_vars,
+                    Sgmm2AccsPool *pool,
+                    double *tot_like, double *tot_t, int32 *num_done):
+      am_sgmm_(am_sgmm), trans_model_(trans_model), utt_(utt),
+      features_(features), posterior_(posterior), gselect_(gselect),
+      spk_vars_(spk_vars), pool_(pool), tot_like_(tot_like), tot_t_(tot_t),
+      num_done_(num_done), tot_like_this_file_(0.0), tot_weight_(0.0) { }
+
+  void operator () () {
+    int32 set = pool_->Get();
+    MleAmSgmm2Accs *sgmm_accs = pool_->SgmmAccs(set);
+    Vector<double> *transition_accs = pool_->TransitionAccs(set);
+
+    Sgmm2PerFrameDerivedVars per_frame_vars;
+    Posterior pdf_posterior;
+    ConvertPosteriorToPdfs(trans_model_, posterior_, &pdf_posterior);
+    for (size_t i = 0; i < posterior_.size(); i++) {
+      am_sgmm_.ComputePerFrameVars(features_.Row(i), gselect_[i], spk_vars_,
+                                   &per_frame_vars);
+      // Accumulates for SGMM.
+      for (size_t j = 0; j < pdf_posterior[i].size(); j++) {
+        int32 pdf_id = pdf_posterior[i][j].first;
+        BaseFloat weight = pdf_posterior[i][j].second;
+        tot_like_this_file_ += sgmm_accs->Accumulate(am_sgmm_, per_frame_vars,
+                                                     pdf_id, weight, &spk_vars_)
+            * weight;
+        tot_weight_ += weight;
+      }
+
+      // Accumulates for transitions.
+      for (size_t j = 0; j < posterior_[i].size(); j++) {
+        int32 tid = posterior_[i][j].first;
+        BaseFloat weight = posterior_[i][j].second;
+        trans_model_.Accumulate(weight, tid, transition_accs);
+      }
+    }
+    sgmm_accs->CommitStatsForSpk(am_sgmm_, spk_vars_);
+    pool_->Release(set);
+  }
+
+  ~Sgmm2AccStatsTask() {
+    // The destructors run sequentially, in the order the utterances were read.
+    KALDI_VLOG(2) << "Average like for this file is "
+                  << (tot_like_this_file_/tot_weight_) << " over "
+                  << tot_weight_ <<" frames.";
+    *tot_like_ += tot_like_this_file_;
+    *tot_t_ += tot_weight_;
+    (*num_done_)++;
+    if (*num_done_ % 50 == 0) {
+      KALDI_LOG << "Processed " << *num_done_ << " utterances; for utterance "
+                << utt_ << " avg. like is "
+                << (tot_like_this_file_/tot_weight_)
+                << " over " << tot_weight_ <<" frames.";
+    }
+  }
+
+ private:
+  const AmSgmm2 &am_sgmm_;
+  const TransitionModel &trans_model_;
+  std::string utt_;
+  Matrix<BaseFloat> features_;  // Copies, not references, since they come
+  Posterior posterior_;         // from Tables and the references we get are
+  std::vector<std::vector<int32> > gselect_;  // not valid long-term.
+  Sgmm2PerSpkDerivedVars spk_vars_;  // a copy, as Accumulate() modifies it.
+  Sgmm2AccsPool *pool_;
+  double *tot_like_;
+  double *tot_t_;
+  int32 *num_done_;
+  double tot_like_this_file_;
+  double tot_weight_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   using namespace kaldi;
@@ -35,9 +193,12 @@ int main(int argc, char *argv[]) {
         "Usage: sgmm2-acc-stats [options] <model-in> <feature-rspecifier> "
         "<posteriors-rspecifier> <stats-out>\n"
         "e.g.: sgmm2-acc-stats --gselect=ark:gselect.ark 1.mdl 1.ali scp:train.scp 'ark:ali-to-post 1.ali ark:-|' 1.acc\n"
-        "(note: gselect option is mandatory)\n";
+        "(note: gselect option is mandatory)\n"
+        "With --num-threads=N, utterances are processed in parallel; this uses\n"
+        "N copies of the stats, so N times the memory for accumulators.\n";
         
     ParseOptions po(usage);
+    TaskSequencerConfig sequencer_opts;
     bool binary = true;
     std::string gselect_rspecifier, spkvecs_rspecifier, utt2spk_rspecifier;
     std::string update_flags_str = "vMNwcSt";
@@ -51,6 +212,7 @@ int main(int argc, char *argv[]) {
     po.Register("rand-prune", &rand_prune, "Pruning threshold for posteriors");
     po.Register("update-flags", &update_flags_str, "Which SGMM parameters to accumulate "
                 "stats for: subset of vMNwcS.");
+    sequencer_opts.Register(&po);
 
     po.Read(argc, argv);
 
@@ -105,101 +267,72 @@ int main(int argc, char *argv[]) {
       double tot_like = 0.0;
       double tot_t = 0;
 
-      kaldi::Sgmm2PerFrameDerivedVars per_frame_vars;
       std::string cur_spk;
       Sgmm2PerSpkDerivedVars spk_vars;
-              
-      for (; !feature_reader.Done(); feature_reader.Next()) {
-        std::string utt = feature_reader.Key();
-        std::string spk = utt;
-        if (!utt2spk_rspecifier.empty()) {
-          if (!utt2spk_map.HasKey(utt)) {
-            KALDI_WARN << "utt2spk map does not have value for " << utt
-                       << ", ignoring this utterance.";
-            continue;
-          } else { spk = utt2spk_map.Value(utt); }
-        }
 
-        if (spk != cur_spk && cur_spk != "")
-          sgmm_accs.CommitStatsForSpk(am_sgmm, spk_vars);        
-        
-        if (spk != cur_spk || spk_vars.Empty()) {
-          spk_vars.Clear();
-          if (spkvecs_reader.IsOpen()) {
-            if (spkvecs_reader.HasKey(utt)) {
-              spk_vars.SetSpeakerVector(spkvecs_reader.Value(utt));
-              am_sgmm.ComputePerSpkDerivedVars(&spk_vars);
-            } else {
-              KALDI_WARN << "Cannot find speaker vector for " << utt;
-              num_err++;
+      {
+        Sgmm2AccsPool pool(am_sgmm, trans_model, acc_flags,
+                           (spkvecs_rspecifier != ""), rand_prune,
+                           sequencer_opts.num_threads, &sgmm_accs,
+                           &transition_accs);
+        // The sequencer is destroyed before the pool, so all the tasks have
+        // finished when the pool's destructor combines the stats.
+        TaskSequencer<Sgmm2AccStatsTask> sequencer(sequencer_opts);
+
+        for (; !feature_reader.Done(); feature_reader.Next()) {
+          std::string utt = feature_reader.Key();
+          std::string spk = utt;
+          if (!utt2spk_rspecifier.empty()) {
+            if (!utt2spk_map.HasKey(utt)) {
+              KALDI_WARN << "utt2spk map does not have value for " << utt
+                         << ", ignoring this utterance.";
               continue;
-            }
-          } // else spk_vars is "empty"
-        }
-        
-        cur_spk = spk;
-        
-        const Matrix<BaseFloat> &features = feature_reader.Value();
-        if (!posteriors_reader.HasKey(utt) ||
-            posteriors_reader.Value(utt).size() != features.NumRows()) {
-          KALDI_WARN << "No posterior info available for utterance "
-                     << utt << " (or wrong size)";
-          num_err++;
-          continue;
-        }
-        const Posterior &posterior = posteriors_reader.Value(utt);
-      
-        if (!gselect_reader.HasKey(utt)
-            && gselect_reader.Value(utt).size() != features.NumRows()) {
-          KALDI_WARN << "No Gaussian-selection info available for utterance "
-                     << utt << " (or wrong size)";
-          num_err++;
-        }
-        const std::vector<std::vector<int32> > &gselect =
-            gselect_reader.Value(utt);
+            } else { spk = utt2spk_map.Value(utt); }
+          }
 
-        num_done++;
-      
-        BaseFloat tot_like_this_file = 0.0, tot_weight = 0.0;
-
-        Posterior pdf_posterior;
-        ConvertPosteriorToPdfs(trans_model, posterior, &pdf_posterior);
-        for (size_t i = 0; i < posterior.size(); i++) {
-          am_sgmm.ComputePerFrameVars(features.Row(i), gselect[i], spk_vars,
-                                      &per_frame_vars);
-          // Accumulates for SGMM.
-          for (size_t j = 0; j < pdf_posterior[i].size(); j++) {
-            int32 pdf_id = pdf_posterior[i][j].first;
-            BaseFloat weight = pdf_posterior[i][j].second;
-            tot_like_this_file += sgmm_accs.Accumulate(am_sgmm, per_frame_vars,
-                                                       pdf_id, weight, &spk_vars)
-                * weight;
-            tot_weight += weight;
+          if (spk != cur_spk || spk_vars.Empty()) {
+            spk_vars.Clear();
+            if (spkvecs_reader.IsOpen()) {
+              if (spkvecs_reader.HasKey(utt)) {
+                spk_vars.SetSpeakerVector(spkvecs_reader.Value(utt));
+                am_sgmm.ComputePerSpkDerivedVars(&spk_vars);
+              } else {
+                KALDI_WARN << "Cannot find speaker vector for " << utt;
+                num_err++;
+                continue;
+              }
+            } // else spk_vars is "empty"
           }
 
-          // Accumulates for transitions.
-          for (size_t j = 0; j < posterior[i].size(); j++) {
-            int32 tid = posterior[i][j].first;
-            BaseFloat weight = posterior[i][j].second;
-            trans_model.Accumulate(weight, tid, &transition_accs);
+          cur_spk = spk;
+
+          const Matrix<BaseFloat> &features = feature_reader.Value();
+          if (!posteriors_reader.HasKey(utt) ||
+              posteriors_reader.Value(utt).size() != features.NumRows()) {
+            KALDI_WARN << "No posterior info available for utterance "
+                       << utt << " (or wrong size)";
+            num_err++;
+            continue;
           }
-        }
-        
-        KALDI_VLOG(2) << "Average like for this file is "
-                      << (tot_like_this_file/tot_weight) << " over "
-                      << tot_weight <<" frames.";
-        tot_like += tot_like_this_file;
-        tot_t += tot_weight;
-        if (num_done % 50 == 0) {
-          KALDI_LOG << "Processed " << num_done << " utterances; for utterance "
-                    << utt << " avg. like is "
-                    << (tot_like_this_file/tot_weight)
-                    << " over " << tot_weight <<" frames.";
+          const Posterior &posterior = posteriors_reader.Value(utt);
+
+          if (!gselect_reader.HasKey(utt) ||
+              gselect_reader.Value(utt).size() != features.NumRows()) {
+            KALDI_WARN << "No Gaussian-selection info available for utterance "
+                       << utt << " (or wrong size)";
+            num_err++;
+            continue;
+          }
+          const std::vector<std::vector<int32> > &gselect =
+              gselect_reader.Value(utt);
+
+          sequencer.Run(new Sgmm2AccStatsTask(am_sgmm, trans_model, utt,
+                                              features, posterior, gselect,
+                                              spk_vars, &pool, &tot_like,
+                                              &tot_t, &num_done));
         }
       }
-      sgmm_accs.CommitStatsForSpk(am_sgmm, spk_vars); // commit stats for
-      // last speaker.
-      
+
       KALDI_LOG << "Overall like per frame (Gaussian only) = "
                 << (tot_like/tot_t) << " over " << tot_t << " frames.";
 
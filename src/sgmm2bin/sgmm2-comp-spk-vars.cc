@@ -0,0 +1,76 @@
+// sgmm2bin/sgmm2-comp-spk-vars.cc
+
+// Copyright 2026  agent
+// (based on sgmm2bin/sgmm2-copy.cc; see that file for its authors)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "hmm/transition-model.h"
+#include "sgmm2/am-sgmm2.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+    const char *usage =
+        "Compute the per-speaker derived variables of an SGMM (including, for\n"
+        "models with speaker-dependent weights, the normalizers d_{jm}^{(s)})\n"
+        "from speaker vectors, so that decoding jobs can read them with the\n"
+        "--spk-vars option rather than recomputing them.\n"
+        "Usage: sgmm2-comp-spk-vars [options] <model-in> <spkvecs-rspecifier> "
+        "<spk-vars-wspecifier>\n"
+        "e.g.: sgmm2-comp-spk-vars final.mdl ark:spk_vecs ark:spk_vars.ark\n";
+
+    ParseOptions po(usage);
+    po.Read(argc, argv);
+    if (po.NumArgs() != 3) {
+      po.PrintUsage();
+      exit(1);
+    }
+    std::string model_rxfilename = po.GetArg(1),
+        spkvecs_rspecifier = po.GetArg(2),
+        spk_vars_wspecifier = po.GetArg(3);
+
+    AmSgmm2 am_sgmm;
+    {
+      bool binary;
+      Input ki(model_rxfilename, &binary);
+      TransitionModel trans_model;
+      trans_model.Read(ki.Stream(), binary);
+      am_sgmm.Read(ki.Stream(), binary);
+    }
+
+    SequentialBaseFloatVectorReader spkvecs_reader(spkvecs_rspecifier);
+    Sgmm2PerSpkDerivedVarsWriter spk_vars_writer(spk_vars_wspecifier);
+
+    int32 num_done = 0;
+    for (; !spkvecs_reader.Done(); spkvecs_reader.Next()) {
+      Sgmm2PerSpkDerivedVars spk_vars;
+      spk_vars.SetSpeakerVector(spkvecs_reader.Value());
+      am_sgmm.ComputePerSpkDerivedVars(&spk_vars);
+      am_sgmm.ComputePerSpkNormalizers(&spk_vars);
+      spk_vars_writer.Write(spkvecs_reader.Key(), spk_vars);
+      num_done++;
+    }
+    KALDI_LOG << "Computed derived variables for " << num_done << " speakers.";
+    return (num_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
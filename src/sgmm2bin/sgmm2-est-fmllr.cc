@@ -29,6 +29,7 @@ using std::vector;
 #include "sgmm2/fmllr-sgmm2.h"
 #include "hmm/transition-model.h"
 #include "hmm/posterior.h"
+#include "thread/kaldi-thread.h"
 
 namespace kaldi {
 
@@ -41,27 +42,12 @@ void AccumulateForUtterance(const Matrix<BaseFloat> &feats,
                             BaseFloat logdet,
                             Sgmm2PerSpkDerivedVars *spk_vars,
                             FmllrSgmm2Accs *spk_stats) {
-  kaldi::Sgmm2PerFrameDerivedVars per_frame_vars;
-
   Posterior pdf_post;
   ConvertPosteriorToPdfs(trans_model, post, &pdf_post);
-  for (size_t t = 0; t < post.size(); t++) {
-    // per-frame vars only used for computing posteriors... use the
-    // transformed feats for this, if available.
-    am_sgmm.ComputePerFrameVars(transformed_feats.Row(t), gselect[t],
-                                *spk_vars, &per_frame_vars);
-    
-
-    for (size_t j = 0; j < pdf_post[t].size(); j++) {
-      int32 pdf_id = pdf_post[t][j].first;
-      Matrix<BaseFloat> posteriors;
-      am_sgmm.ComponentPosteriors(per_frame_vars, pdf_id,
-                                  spk_vars, &posteriors);
-      posteriors.Scale(pdf_post[t][j].second);
-      spk_stats->AccumulateFromPosteriors(am_sgmm, *spk_vars, feats.Row(t),
-                                          gselect[t], posteriors, pdf_id);
-    }
-  }
+  // The posteriors are computed from the transformed feats, if available;
+  // uses g_num_threads threads.
+  spk_stats->AccumulateForUtterance(am_sgmm, feats, transformed_feats,
+                                    gselect, pdf_post, spk_vars);
 }
 
 }  // end namespace kaldi
@@ -94,6 +80,9 @@ int main(int argc, char *argv[]) {
                 "Initial FMLLR transform per speaker (rspecifier)");
     po.Register("gselect", &gselect_rspecifier,
                 "Precomputed Gaussian indices (rspecifier)");
+    g_num_threads = 1;  // Unless the user asks for more.
+    po.Register("num-threads", &g_num_threads, "Number of threads to use in "
+                "accumulating the statistics of each utterance");
     fmllr_opts.Register(&po);
 
     po.Read(argc, argv);
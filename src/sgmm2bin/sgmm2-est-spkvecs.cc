@@ -30,6 +30,7 @@ using std::vector;
 #include "sgmm2/estimate-am-sgmm2.h"
 #include "hmm/transition-model.h"
 #include "hmm/posterior.h"
+#include "thread/kaldi-thread.h"
 
 namespace kaldi {
 
@@ -40,21 +41,12 @@ void AccumulateForUtterance(const Matrix<BaseFloat> &feats,
                             const vector< vector<int32> > &gselect,
                             Sgmm2PerSpkDerivedVars *spk_vars,
                             MleSgmm2SpeakerAccs *spk_stats) {
-  kaldi::Sgmm2PerFrameDerivedVars per_frame_vars;
-
   KALDI_ASSERT(gselect.size() == feats.NumRows());
   Posterior pdf_post;
   ConvertPosteriorToPdfs(trans_model, post, &pdf_post);
-  for (size_t i = 0; i < post.size(); i++) {
-    am_sgmm.ComputePerFrameVars(feats.Row(i), gselect[i],
-                                *spk_vars, &per_frame_vars);
-    
-    for (size_t j = 0; j < pdf_post[i].size(); j++) {
-      int32 pdf_id = pdf_post[i][j].first;
-      spk_stats->Accumulate(am_sgmm, per_frame_vars, pdf_id,
-                            pdf_post[i][j].second, spk_vars);
-    }
-  }
+  // Uses g_num_threads threads.
+  spk_stats->AccumulateForUtterance(am_sgmm, feats, gselect, pdf_post,
+                                    spk_vars);
 }
 
 }  // end namespace kaldi
@@ -84,6 +76,9 @@ int main(int argc, char *argv[]) {
         "Minimum count needed to estimate speaker vectors");
     po.Register("rand-prune", &rand_prune, "Pruning threshold for posteriors");
     po.Register("spk-vecs", &spkvecs_rspecifier, "Speaker vectors to use during aligment (rspecifier)");
+    g_num_threads = 1;  // Unless the user asks for more.
+    po.Register("num-threads", &g_num_threads, "Number of threads to use in "
+                "accumulating the statistics of each utterance");
     po.Read(argc, argv);
 
     if (po.NumArgs() != 4) {
@@ -76,10 +76,10 @@ int main(int argc, char *argv[]) {
       int32 tot_t_this_file = 0; double tot_like_this_file = 0;
       std::string utt = feature_reader.Key();
       const Matrix<BaseFloat> &mat = feature_reader.Value();
-      std::vector<std::vector<int32> > gselect_vec(mat.NumRows());
+      std::vector<std::vector<int32> > gselect_vec;
       tot_t_this_file += mat.NumRows();
-      for (int32 i = 0; i < mat.NumRows(); i++)
-        tot_like_this_file += am_sgmm.GaussianSelection(sgmm_opts, mat.Row(i), &(gselect_vec[i]));
+      tot_like_this_file = am_sgmm.GaussianSelection(sgmm_opts, mat,
+                                                     &gselect_vec);
 
       gselect_writer.Write(utt, gselect_vec);
       if (num_done % 10 == 0)
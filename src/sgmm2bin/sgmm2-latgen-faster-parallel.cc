@@ -42,7 +42,7 @@ void ProcessUtterance(const AmSgmm2 &am_sgmm,
                       double acoustic_scale,
                       const Matrix<BaseFloat> &features,
                       RandomAccessInt32VectorVectorReader &gselect_reader,
-                      RandomAccessBaseFloatVectorReaderMapped &spkvecs_reader,
+                      Sgmm2PerSpkDerivedVarsCache &spk_vars_cache,
                       const fst::SymbolTable *word_syms,
                       const std::string &utt,
                       bool determinize,
@@ -52,6 +52,10 @@ void ProcessUtterance(const AmSgmm2 &am_sgmm,
                       CompactLatticeWriter *compact_lattice_writer,
                       LatticeWriter *lattice_writer,
                       LatticeFasterDecoder *decoder, // Takes ownership of this.
+                      // If decoder is NULL, it is created in the decoding
+                      // thread from these.
+                      const NumaReplicated<fst::Fst<fst::StdArc> > *graph,
+                      const LatticeFasterDecoderConfig *decoder_opts,
                       double *like_sum,
                       int64 *frame_sum,
                       int32 *num_done,
@@ -60,18 +64,19 @@ void ProcessUtterance(const AmSgmm2 &am_sgmm,
   using fst::VectorFst;
   using std::vector;
 
-  Sgmm2PerSpkDerivedVars *spk_vars = new Sgmm2PerSpkDerivedVars; // decodable
-  // will take ownership.
-  if (spkvecs_reader.IsOpen()) {
-    if (spkvecs_reader.HasKey(utt)) {
-      spk_vars->SetSpeakerVector(spkvecs_reader.Value(utt));
-      am_sgmm.ComputePerSpkDerivedVars(spk_vars);
-    } else {
-      KALDI_WARN << "Cannot find speaker vector for " << utt << ", not decoding this utterance";
-      delete spk_vars;
+  Sgmm2PerSpkDerivedVars *spk_vars = NULL;  // decodable will take ownership.
+  if (spk_vars_cache.IsOpen()) {
+    const Sgmm2PerSpkDerivedVars *cached_vars = spk_vars_cache.Value(utt);
+    if (cached_vars == NULL) {
+      KALDI_WARN << "Not decoding utterance " << utt;
       (*num_err)++;
       return;
     }
+    // Each decoding task gets its own copy, as tasks may run concurrently;
+    // copying is much cheaper than recomputing the normalizers.
+    spk_vars = new Sgmm2PerSpkDerivedVars(*cached_vars);
+  } else {
+    spk_vars = new Sgmm2PerSpkDerivedVars;
   }
   if (!gselect_reader.HasKey(utt) ||
       gselect_reader.Value(utt).size() != features.NumRows()) {
@@ -97,7 +102,7 @@ void ProcessUtterance(const AmSgmm2 &am_sgmm,
           decoder, sgmm_decodable, trans_model, word_syms, utt, acoustic_scale,
           determinize, allow_partial, alignments_writer, words_writer,
           compact_lattice_writer, lattice_writer, like_sum, frame_sum, num_done,
-          num_err, NULL);
+          num_err, NULL, graph, decoder_opts);
 
   sequencer->Run(task); // takes ownership.
 }
@@ -122,7 +127,7 @@ int main(int argc, char *argv[]) {
     bool allow_partial = false;
     BaseFloat log_prune = 5.0;
     string word_syms_filename, gselect_rspecifier, spkvecs_rspecifier,
-        utt2spk_rspecifier;
+        spk_vars_rspecifier, utt2spk_rspecifier;
 
     LatticeFasterDecoderConfig decoder_opts;
     TaskSequencerConfig sequencer_config; // has --num-threads option
@@ -141,6 +146,9 @@ int main(int argc, char *argv[]) {
                 "rspecifier for precomputed per-frame Gaussian indices.");
     po.Register("spk-vecs", &spkvecs_rspecifier,
                 "rspecifier for speaker vectors");
+    po.Register("spk-vars", &spk_vars_rspecifier,
+                "rspecifier for per-speaker derived variables, as written by "
+                "sgmm2-comp-spk-vars (alternative to --spk-vecs)");
     po.Register("utt2spk", &utt2spk_rspecifier,
                 "rspecifier for utterance to speaker map");
     po.Read(argc, argv);
@@ -150,6 +158,10 @@ int main(int argc, char *argv[]) {
       exit(1);
     }
 
+    // With many decoding threads, queue log messages rather than having the
+    // threads wait for stderr.
+    if (sequencer_config.num_threads > 1) SetLogAsync(true);
+
     if (gselect_rspecifier == "")
       KALDI_ERR << "--gselect option is required.";
 
@@ -165,6 +177,7 @@ int main(int argc, char *argv[]) {
     int num_done = 0, num_err = 0;
     Timer timer;
     VectorFst<StdArc> *decode_fst = NULL;
+    NumaReplicated<fst::Fst<StdArc> > *graph = NULL;
     fst::SymbolTable *word_syms = NULL;
     
     TaskSequencer<DecodeUtteranceLatticeFasterClass> sequencer(
@@ -196,8 +209,9 @@ int main(int argc, char *argv[]) {
                   << word_syms_filename;
 
     RandomAccessInt32VectorVectorReader gselect_reader(gselect_rspecifier);
-    RandomAccessBaseFloatVectorReaderMapped spkvecs_reader(spkvecs_rspecifier,
-                                                           utt2spk_rspecifier);
+    Sgmm2PerSpkDerivedVarsCache spk_vars_cache(am_sgmm, spkvecs_rspecifier,
+                                               spk_vars_rspecifier,
+                                               utt2spk_rspecifier);
         
     if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) { // a single FST.
       SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
@@ -207,6 +221,10 @@ int main(int argc, char *argv[]) {
       // large process: the page-table entries are duplicated, which requires a
       // lot of virtual memory.
       decode_fst = fst::ReadFstKaldi(fst_in_str);
+      // With --numa-policy, each NUMA node gets its own copy of the graph.
+      graph = new NumaReplicated<fst::Fst<StdArc> >(*decode_fst,
+                                                    g_numa_policy != "none",
+                                                    fst::CopyDecodingGraph);
       timer.Reset(); // exclude graph loading time.
       
       {
@@ -219,15 +237,13 @@ int main(int argc, char *argv[]) {
             continue;
           }
 
-          // ProcessUtterance will take ownership of this.
-          LatticeFasterDecoder *decoder = new LatticeFasterDecoder(
-              *decode_fst, decoder_opts);
-
+          // The decoder is created in the decoding thread.
           ProcessUtterance(am_sgmm, trans_model, log_prune, acoustic_scale,
-                           features, gselect_reader, spkvecs_reader, word_syms,
+                           features, gselect_reader, spk_vars_cache, word_syms,
                            utt, determinize, allow_partial,
                            &alignment_writer, &words_writer, &compact_lattice_writer,
-                           &lattice_writer, decoder, &tot_like, &frame_count,
+                           &lattice_writer, NULL, graph, &decoder_opts,
+                           &tot_like, &frame_count,
                            &num_done, &num_err, &sequencer);
         }
       }
@@ -258,15 +274,16 @@ int main(int argc, char *argv[]) {
 
         // ProcessUtterance takes ownership of "decoder".
         ProcessUtterance(am_sgmm, trans_model, log_prune, acoustic_scale,
-                         features, gselect_reader, spkvecs_reader, word_syms,
+                         features, gselect_reader, spk_vars_cache, word_syms,
                          utt, determinize, allow_partial,
                          &alignment_writer, &words_writer, &compact_lattice_writer,
-                         &lattice_writer, decoder, &tot_like, &frame_count,
-                         &num_done, &num_err, &sequencer);
+                         &lattice_writer, decoder, NULL, NULL, &tot_like,
+                         &frame_count, &num_done, &num_err, &sequencer);
       }
     }
     sequencer.Wait(); // Wait till all tasks are done.
     
+    delete graph;
     if (decode_fst) delete decode_fst; 
     if (word_syms) delete word_syms;
     
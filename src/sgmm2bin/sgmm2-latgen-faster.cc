@@ -30,19 +30,22 @@ using std::string;
 #include "decoder/lattice-faster-decoder.h"
 #include "sgmm2/decodable-am-sgmm2.h"
 #include "util/timer.h"
+#include "cudamatrix/cu-device.h"
 
 namespace kaldi {
 
 // the reference arguments at the beginning are not const as the style guide
 // requires, but are best viewed as inputs.
+// If "batched_params" is non-NULL we use DecodableAmSgmm2Batched.
 bool ProcessUtterance(LatticeFasterDecoder &decoder,
                       const AmSgmm2 &am_sgmm,
+                      const AmSgmm2BatchedParams *batched_params,
                       const TransitionModel &trans_model,
                       double log_prune,
                       double acoustic_scale,
                       const Matrix<BaseFloat> &features,
                       RandomAccessInt32VectorVectorReader &gselect_reader,
-                      RandomAccessBaseFloatVectorReaderMapped &spkvecs_reader,
+                      Sgmm2PerSpkDerivedVarsCache &spk_vars_cache,
                       const fst::SymbolTable *word_syms,
                       const std::string &utt,
                       bool determinize,
@@ -54,13 +57,12 @@ bool ProcessUtterance(LatticeFasterDecoder &decoder,
                       double *like_ptr) { // puts utterance's like in like_ptr on success.
   using fst::VectorFst;
 
-  Sgmm2PerSpkDerivedVars spk_vars;
-  if (spkvecs_reader.IsOpen()) {
-    if (spkvecs_reader.HasKey(utt)) {
-      spk_vars.SetSpeakerVector(spkvecs_reader.Value(utt));
-      am_sgmm.ComputePerSpkDerivedVars(&spk_vars);
-    } else {
-      KALDI_WARN << "Cannot find speaker vector for " << utt << ", not decoding this utterance";
+  Sgmm2PerSpkDerivedVars empty_spk_vars, *spk_vars = &empty_spk_vars;
+  if (spk_vars_cache.IsOpen()) {
+    // The same object is returned for consecutive utterances of a speaker.
+    spk_vars = spk_vars_cache.Value(utt);
+    if (spk_vars == NULL) {
+      KALDI_WARN << "Not decoding utterance " << utt;
       return false; // We could use zero, but probably the user would want to know about this
       // (this would normally be a script error or some kind of failure).
     }
@@ -74,8 +76,18 @@ bool ProcessUtterance(LatticeFasterDecoder &decoder,
   const std::vector<std::vector<int32> > &gselect =
       gselect_reader.Value(utt);
   
+  if (batched_params != NULL) {
+    DecodableAmSgmm2Batched sgmm_decodable(*batched_params, trans_model,
+                                           features, gselect, log_prune,
+                                           acoustic_scale, spk_vars);
+    return DecodeUtteranceLatticeFaster(
+        decoder, sgmm_decodable, trans_model, word_syms, utt, acoustic_scale,
+        determinize, allow_partial, alignments_writer, words_writer,
+        compact_lattice_writer, lattice_writer, like_ptr);
+  }
+
   DecodableAmSgmm2Scaled sgmm_decodable(am_sgmm, trans_model, features, gselect,
-                                        log_prune, acoustic_scale, &spk_vars);
+                                        log_prune, acoustic_scale, spk_vars);
 
   return DecodeUtteranceLatticeFaster(
       decoder, sgmm_decodable, trans_model, word_syms, utt, acoustic_scale,
@@ -100,9 +112,11 @@ int main(int argc, char *argv[]) {
     ParseOptions po(usage);
     BaseFloat acoustic_scale = 0.1;
     bool allow_partial = false;
+    bool batched = false;
+    std::string use_gpu = "no";
     BaseFloat log_prune = 5.0;
     string word_syms_filename, gselect_rspecifier, spkvecs_rspecifier,
-        utt2spk_rspecifier;
+        spk_vars_rspecifier, utt2spk_rspecifier;
 
     LatticeFasterDecoderConfig decoder_opts;
     decoder_opts.Register(&po);    
@@ -119,8 +133,16 @@ int main(int argc, char *argv[]) {
                 "rspecifier for precomputed per-frame Gaussian indices.");
     po.Register("spk-vecs", &spkvecs_rspecifier,
                 "rspecifier for speaker vectors");
+    po.Register("spk-vars", &spk_vars_rspecifier,
+                "rspecifier for per-speaker derived variables, as written by "
+                "sgmm2-comp-spk-vars (alternative to --spk-vecs)");
     po.Register("utt2spk", &utt2spk_rspecifier,
                 "rspecifier for utterance to speaker map");
+    po.Register("batched", &batched, "If true, compute the likelihoods of all "
+                "the sub-states at once on each frame, using the GPU if "
+                "one is selected with --use-gpu");
+    po.Register("use-gpu", &use_gpu, "yes|no|optional, only has effect if "
+                "compiled with CUDA and --batched=true");
     po.Read(argc, argv);
 
     if (po.NumArgs() < 4 || po.NumArgs() > 6) {
@@ -146,6 +168,13 @@ int main(int argc, char *argv[]) {
       trans_model.Read(ki.Stream(), binary);
       am_sgmm.Read(ki.Stream(), binary);
     }
+#if HAVE_CUDA==1
+    if (batched)
+      CuDevice::Instantiate().SelectGpuId(use_gpu);
+#endif
+    AmSgmm2BatchedParams *batched_params = NULL;
+    if (batched)
+      batched_params = new AmSgmm2BatchedParams(am_sgmm);
 
     CompactLatticeWriter compact_lattice_writer;
     LatticeWriter lattice_writer;
@@ -166,8 +195,9 @@ int main(int argc, char *argv[]) {
                    << word_syms_filename;
 
     RandomAccessInt32VectorVectorReader gselect_reader(gselect_rspecifier);
-    RandomAccessBaseFloatVectorReaderMapped spkvecs_reader(spkvecs_rspecifier,
-                                                           utt2spk_rspecifier);
+    Sgmm2PerSpkDerivedVarsCache spk_vars_cache(am_sgmm, spkvecs_rspecifier,
+                                               spk_vars_rspecifier,
+                                               utt2spk_rspecifier);
 
     BaseFloat tot_like = 0.0;
     kaldi::int64 frame_count = 0;
@@ -199,8 +229,9 @@ int main(int argc, char *argv[]) {
             continue;
           }
           double like;
-          if (ProcessUtterance(decoder, am_sgmm, trans_model, log_prune, acoustic_scale,
-                               features, gselect_reader, spkvecs_reader, word_syms,
+          if (ProcessUtterance(decoder, am_sgmm, batched_params, trans_model,
+                               log_prune, acoustic_scale,
+                               features, gselect_reader, spk_vars_cache, word_syms,
                                utt, determinize, allow_partial,
                                &alignment_writer, &words_writer, &compact_lattice_writer,
                                &lattice_writer, &like)) {
@@ -234,8 +265,9 @@ int main(int argc, char *argv[]) {
         LatticeFasterDecoder decoder(fst_reader.Value(), decoder_opts);
         double like;
 
-        if (ProcessUtterance(decoder, am_sgmm, trans_model, log_prune, acoustic_scale,
-                             features, gselect_reader, spkvecs_reader, word_syms,
+        if (ProcessUtterance(decoder, am_sgmm, batched_params, trans_model,
+                             log_prune, acoustic_scale,
+                             features, gselect_reader, spk_vars_cache, word_syms,
                              utt, determinize, allow_partial,
                              &alignment_writer, &words_writer, &compact_lattice_writer,
                              &lattice_writer, &like)) {
@@ -258,6 +290,7 @@ int main(int argc, char *argv[]) {
               << " over " << frame_count << " frames.";
 
     if (word_syms) delete word_syms;
+    delete batched_params;
     return (num_success != 0 ? 0 : 1);
   } catch(const std::exception &e) {
     std::cerr << e.what();
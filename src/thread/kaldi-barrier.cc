@@ -21,10 +21,74 @@
 #include <pthread.h>
 #include "base/kaldi-error.h"
 #include "thread/kaldi-barrier.h"
+#include "thread/kaldi-futex.h"
 
 
 namespace kaldi {
 
+#ifdef __linux__
+
+Barrier::Barrier(int32 threshold)
+    : threshold_(threshold), counter_(threshold), cycle_(0) { }
+
+
+Barrier::~Barrier() {
+  if (counter_ != threshold_)
+    KALDI_ERR << "Cannot destroy barrier with waiting thread(s)";
+}
+
+
+void Barrier::SetThreshold(int32 thr) {
+  if (counter_ != threshold_) {
+    KALDI_ERR << "Cannot set threshold, while some thread(s) are waiting";
+  }
+  threshold_ = thr; counter_ = thr;
+}
+
+
+/**
+ * Wait for all the threads to reach a barrier.  The last thread to arrive
+ * resets the counter and then advances the cycle count, which releases the
+ * others; they spin on cycle_ for a while and then sleep on it.  Because the
+ * counter is reset first, a released thread may call Wait() again at once.
+ * The last incoming thread returns -1, the others 0.
+ */
+int32 Barrier::Wait() {
+  if (threshold_ == 0)
+    KALDI_ERR << "Cannot wait when ``threshold'' value was not set";
+
+  // memorize which cycle we're in; this is read before we decrement the
+  // counter (which is a full memory barrier), so it is the current cycle.
+  int32 cycle = cycle_ & kFutexValueMask;
+
+  if (__sync_sub_and_fetch(&counter_, 1) == 0) {  // This is the last thread.
+    counter_ = threshold_;
+    int32 c;
+    do {
+      c = cycle_;
+    } while (!__sync_bool_compare_and_swap(&cycle_, c,
+                                           (c + 1) & kFutexValueMask));
+    if (c & kFutexWaitersBit)
+      FutexWakeAll(&cycle_);  // See Semaphore::Signal().
+    return -1;
+  }
+
+  for (int32 i = 0; i < FutexSpinCount(); i++) {
+    if ((cycle_ & kFutexValueMask) != cycle) return 0;
+    CpuRelax();
+  }
+  while (true) {
+    int32 c = cycle_;
+    if ((c & kFutexValueMask) != cycle) return 0;
+    if (c & kFutexWaitersBit)
+      FutexWait(&cycle_, c);
+    else
+      __sync_bool_compare_and_swap(&cycle_, c, c | kFutexWaitersBit);
+  }
+}
+
+#else  // Not Linux: use a pthread mutex and condition variable.
+
 
 
 Barrier::Barrier(int32 threshold)
@@ -136,4 +200,6 @@ int32 Barrier::Wait() {
 }
 
 
+#endif  // __linux__
+
 } // namespace kaldi
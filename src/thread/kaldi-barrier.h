@@ -23,6 +23,7 @@
 
 
 #include <pthread.h>
+#include "base/kaldi-types.h"
 
 
 namespace kaldi {
@@ -31,6 +32,9 @@ namespace kaldi {
  * The Barrier class
  * A barrier causes a group of threads to wait until 
  * all the threads reach the "barrier".
+ * On Linux the waiting threads spin briefly and then sleep on a futex
+ * (as in class Semaphore); elsewhere a pthread mutex and condition
+ * variable are used.
  */
 class Barrier {
  public:
@@ -41,12 +45,16 @@ class Barrier {
   int32 Wait(); ///< last thread returns -1, the others 0
 
  private:
+#ifndef __linux__
   pthread_mutex_t     mutex_;     ///< Mutex which control access to barrier 
   pthread_cond_t      cv_;        ///< Conditional variable to make barrier wait
+#endif
 
   int32                 threshold_; ///< size of thread-group
-  int32                 counter_;   ///< number of threads we wait for
-  int32                 cycle_;     ///< cycle flag to keep synchronized
+  volatile int32        counter_;   ///< number of threads we wait for
+  volatile int32        cycle_;     ///< cycle flag to keep synchronized
+                                    ///< (on Linux, a cycle count and a
+                                    ///< waiters bit; see kaldi-futex.h)
 
 };
 
@@ -0,0 +1,95 @@
+// thread/kaldi-futex.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_THREAD_KALDI_FUTEX_H_
+#define KALDI_THREAD_KALDI_FUTEX_H_ 1
+
+// Helpers for the Linux implementations of Semaphore and Barrier; this header
+// is only for use inside thread/.
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "base/kaldi-error.h"
+
+namespace kaldi {
+
+/// Returns the number of times a waiting thread checks its condition, with a
+/// CpuRelax() in between, before it goes to sleep in the kernel.  This is a
+/// few microseconds, which covers the typical hand-off between threads in
+/// TaskSequencer without burning much CPU when the wait is long.  With only
+/// one CPU the thread we are waiting for cannot run while we spin, so we
+/// don't spin at all.
+inline int32 FutexSpinCount() {
+  static const int32 spin_count =
+      (sysconf(_SC_NPROCESSORS_ONLN) > 1 ? 100 : 0);
+  return spin_count;
+}
+
+/// Tells the CPU we are in a spin-wait loop.
+inline void CpuRelax() {
+#if defined(__i386__) || defined(__x86_64__)
+  __asm__ __volatile__("pause" ::: "memory");
+#else
+  __sync_synchronize();
+#endif
+}
+
+/// Sleeps until woken by FutexWake() on the same address, unless *addr is no
+/// longer equal to "value" (the check and the sleep are atomic), in which case
+/// it returns at once.  It may also return spuriously, so callers must check
+/// their condition in a loop.
+inline void FutexWait(volatile int32 *addr, int32 value) {
+  if (syscall(SYS_futex, const_cast<int32*>(addr), FUTEX_WAIT_PRIVATE, value,
+              NULL, NULL, 0) != 0 && errno != EAGAIN && errno != EINTR)
+    KALDI_ERR << "Error on futex wait";
+}
+
+/// Wakes all threads sleeping in FutexWait() on "addr".  Errors are ignored:
+/// the callers wake after they have released the waiters, at which point a
+/// waiter may already have destroyed the object, and waking on a stale
+/// address is harmless.
+inline void FutexWakeAll(volatile int32 *addr) {
+  syscall(SYS_futex, const_cast<int32*>(addr), FUTEX_WAKE_PRIVATE,
+          0x7fffffff, NULL, NULL, 0);
+}
+
+/// Wakes at most one thread sleeping in FutexWait() on "addr"; errors are
+/// ignored, as for FutexWakeAll().
+inline void FutexWakeOne(volatile int32 *addr) {
+  syscall(SYS_futex, const_cast<int32*>(addr), FUTEX_WAKE_PRIVATE,
+          1, NULL, NULL, 0);
+}
+
+/// Semaphore and Barrier keep a count in the low 30 bits of their futex word
+/// and set this bit when a thread may be sleeping on it, so that the thread
+/// that releases the waiters can tell, from the same atomic operation, whether
+/// it needs to make the system call.
+static const int32 kFutexWaitersBit = 0x40000000;
+static const int32 kFutexValueMask = kFutexWaitersBit - 1;
+
+}  // namespace kaldi
+
+#endif  // __linux__
+
+#endif  // KALDI_THREAD_KALDI_FUTEX_H_
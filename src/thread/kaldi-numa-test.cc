@@ -0,0 +1,76 @@
+// thread/kaldi-numa-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "thread/kaldi-numa.h"
+#include "thread/kaldi-thread.h"
+
+namespace kaldi {
+
+// Each job checks that it sees the same contents through NumaReplicated.
+class NumaReplicatedTestClass {
+ public:
+  NumaReplicatedTestClass(const NumaReplicated<std::vector<int32> > &shared,
+                          const std::vector<int32> &ref, int32 *num_errs):
+      shared_(&shared), ref_(&ref), num_errs_(num_errs) { }
+  void operator() (int32 begin, int32 end) {
+    for (int32 i = begin; i < end; i++) {
+      KALDI_ASSERT(NumaCurrentNode() >= 0 && NumaCurrentNode() < NumaNumNodes());
+      if (shared_->Get() != *ref_) __sync_fetch_and_add(num_errs_, 1);
+    }
+  }
+ private:
+  const NumaReplicated<std::vector<int32> > *shared_;
+  const std::vector<int32> *ref_;
+  int32 *num_errs_;
+};
+
+void TestNuma() {
+  KALDI_ASSERT(NumaNumNodes() >= 1);
+  KALDI_ASSERT(NumaCurrentNode() >= 0 && NumaCurrentNode() < NumaNumNodes());
+  KALDI_LOG << "Number of NUMA nodes is " << NumaNumNodes();
+
+  std::vector<int32> data(1000);
+  for (size_t i = 0; i < data.size(); i++) data[i] = rand();
+  g_numa_policy = "spread";  // Threads created from now on are pinned.
+  {
+    NumaReplicated<std::vector<int32> > shared(data);
+    int32 num_errs = 0;
+    RunParallelFor(0, 1000, NumaReplicatedTestClass(shared, data, &num_errs),
+                   4);
+    KALDI_ASSERT(num_errs == 0);
+  }
+  g_numa_policy = "compact";
+  for (int32 i = 0; i < 4; i++) {
+    NumaPlaceThread(i);
+    KALDI_ASSERT(NumaCurrentNode() >= 0 && NumaCurrentNode() < NumaNumNodes());
+  }
+  UnpinThread();
+  g_numa_policy = "none";
+  KALDI_ASSERT(!NumaPlaceThread(0));
+}
+
+}  // end namespace kaldi.
+
+int main() {
+  using namespace kaldi;
+  TestNuma();
+  std::cout << "Test OK.\n";
+}
@@ -0,0 +1,188 @@
+// thread/kaldi-numa.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "thread/kaldi-numa.h"
+#include "thread/kaldi-thread.h"
+
+namespace kaldi {
+
+std::string g_numa_policy = "none";
+
+#ifdef __linux__
+
+namespace {
+
+// The NUMA topology, as far as it concerns the CPUs this process may run on.
+struct NumaTopology {
+  // node_cpus[n] is the list of CPUs on node n, where the nodes are numbered
+  // densely from 0 in the order of the kernel's numbering, leaving out the
+  // nodes with none of our CPUs.
+  std::vector<std::vector<int32> > node_cpus;
+  // cpu_node[c] is the node of CPU c, or -1 if CPU c is not one of ours.
+  std::vector<int32> cpu_node;
+};
+
+NumaTopology topology;
+pthread_once_t topology_once = PTHREAD_ONCE_INIT;
+
+// Parses a list of integers like "0-3,8,10-11", as in the files in sysfs.
+// Returns false on error.
+bool ParseSysfsList(const std::string &str, std::vector<int32> *out) {
+  out->clear();
+  std::istringstream is(str);
+  std::string range;
+  while (std::getline(is, range, ',')) {
+    if (range.empty() || range == "\n") continue;
+    int32 begin, end;
+    char dash;
+    std::istringstream rs(range);
+    if (!(rs >> begin)) return false;
+    if (rs >> dash) {
+      if (dash != '-' || !(rs >> end) || end < begin) return false;
+    } else {
+      end = begin;
+    }
+    for (int32 i = begin; i <= end; i++)
+      out->push_back(i);
+  }
+  return true;
+}
+
+bool ReadSysfsList(const std::string &filename, std::vector<int32> *out) {
+  std::ifstream is(filename.c_str());
+  std::string line;
+  return (is && std::getline(is, line) && ParseSysfsList(line, out));
+}
+
+void InitTopology() {
+  cpu_set_t process_cpus;
+  if (sched_getaffinity(0, sizeof(process_cpus), &process_cpus) != 0) {
+    KALDI_WARN << "Could not get the CPU affinity of the process: "
+               << strerror(errno);
+    CPU_ZERO(&process_cpus);
+  }
+  topology.cpu_node.resize(CPU_SETSIZE, -1);
+  std::vector<int32> nodes, cpus;
+  if (ReadSysfsList("/sys/devices/system/node/online", &nodes)) {
+    for (size_t i = 0; i < nodes.size(); i++) {
+      std::ostringstream filename;
+      filename << "/sys/devices/system/node/node" << nodes[i] << "/cpulist";
+      if (!ReadSysfsList(filename.str(), &cpus)) continue;
+      std::vector<int32> our_cpus;
+      for (size_t j = 0; j < cpus.size(); j++)
+        if (cpus[j] < CPU_SETSIZE && CPU_ISSET(cpus[j], &process_cpus) &&
+            topology.cpu_node[cpus[j]] == -1)
+          our_cpus.push_back(cpus[j]);
+      if (our_cpus.empty()) continue;
+      int32 n = topology.node_cpus.size();
+      for (size_t j = 0; j < our_cpus.size(); j++)
+        topology.cpu_node[our_cpus[j]] = n;
+      topology.node_cpus.push_back(our_cpus);
+    }
+  }
+  // Any of our CPUs the kernel didn't put on a node (or all of them, if there
+  // is no NUMA information) go on the first node.
+  for (int32 c = 0; c < CPU_SETSIZE; c++) {
+    if (CPU_ISSET(c, &process_cpus) && topology.cpu_node[c] == -1) {
+      if (topology.node_cpus.empty())
+        topology.node_cpus.resize(1);
+      topology.node_cpus[0].push_back(c);
+      topology.cpu_node[c] = 0;
+    }
+  }
+  if (topology.node_cpus.empty())
+    topology.node_cpus.resize(1);  // No CPUs known; there is still one node.
+  KALDI_VLOG(2) << "Found " << topology.node_cpus.size() << " NUMA node(s).";
+}
+
+const NumaTopology &GetTopology() {
+  pthread_once(&topology_once, InitTopology);
+  return topology;
+}
+
+}  // namespace
+
+int32 NumaNumNodes() {
+  return GetTopology().node_cpus.size();
+}
+
+int32 NumaCurrentNode() {
+  const NumaTopology &topo = GetTopology();
+  int32 cpu = sched_getcpu();
+  if (cpu < 0 || cpu >= static_cast<int32>(topo.cpu_node.size()) ||
+      topo.cpu_node[cpu] == -1)
+    return 0;
+  return topo.cpu_node[cpu];
+}
+
+bool NumaPlaceThread(int32 i) {
+  if (g_numa_policy == "none") return false;
+  const NumaTopology &topo = GetTopology();
+  int32 num_nodes = topo.node_cpus.size(), cpu = -1;
+  if (g_numa_policy == "spread") {
+    const std::vector<int32> &cpus = topo.node_cpus[i % num_nodes];
+    if (!cpus.empty()) cpu = cpus[(i / num_nodes) % cpus.size()];
+  } else if (g_numa_policy == "compact") {
+    int32 num_cpus = 0;
+    for (int32 n = 0; n < num_nodes; n++)
+      num_cpus += topo.node_cpus[n].size();
+    if (num_cpus > 0) {
+      int32 j = i % num_cpus;
+      for (int32 n = 0; cpu == -1; n++) {
+        int32 size = topo.node_cpus[n].size();
+        if (j < size) cpu = topo.node_cpus[n][j];
+        else j -= size;
+      }
+    }
+  } else {
+    KALDI_ERR << "Invalid --numa-policy option \"" << g_numa_policy
+              << "\": expected none, spread or compact.";
+  }
+  if (cpu == -1) return false;
+  // PinThreadToCpu() numbers our CPUs in increasing order.
+  int32 index = 0;
+  for (int32 c = 0; c < cpu; c++)
+    if (topo.cpu_node[c] != -1) index++;
+  return PinThreadToCpu(index);
+}
+
+#else  // Not Linux: a single node, and no pinning.
+
+int32 NumaNumNodes() { return 1; }
+
+int32 NumaCurrentNode() { return 0; }
+
+bool NumaPlaceThread(int32 i) {
+  if (g_numa_policy != "none" && g_numa_policy != "spread" &&
+      g_numa_policy != "compact")
+    KALDI_ERR << "Invalid --numa-policy option \"" << g_numa_policy
+              << "\": expected none, spread or compact.";
+  return false;
+}
+
+#endif  // __linux__
+
+}  // namespace kaldi
@@ -0,0 +1,148 @@
+// thread/kaldi-numa.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_THREAD_KALDI_NUMA_H_
+#define KALDI_THREAD_KALDI_NUMA_H_ 1
+
+#include <string>
+#include <vector>
+#include "base/kaldi-common.h"
+#include "thread/kaldi-mutex.h"
+
+// This header is for programs that run on machines with several NUMA nodes
+// (sockets), where memory is attached to a node and is slower to access from
+// the CPUs of the other nodes.  Linux places a page on the node of the thread
+// that first writes to it, so the threads of a program that is not careful end
+// up using a lot of memory on the node where the main thread happened to run.
+//
+// Setting g_numa_policy (with --numa-policy, in the programs that register it)
+// makes the threads of MultiThreadPool, which run the jobs of MultiThreader,
+// RunParallelFor() and TaskSequencer, be each pinned to one CPU, so the memory
+// they allocate and first write to (e.g. the state of a decoder created inside
+// a task) stays local to them.  Read-only data that all the threads use, like
+// decoding graphs, can additionally be replicated once per node with class
+// NumaReplicated.
+//
+// The topology is read from /sys/devices/system/node, so there is no
+// dependency on libnuma.  On other platforms, or if the information is not
+// there, everything behaves as if there were a single node.
+
+namespace kaldi {
+
+/// The thread placement policy: "none" (the default: threads are not pinned),
+/// "spread" (the i'th thread of the pool goes on node i % num-nodes, so the
+/// threads use the memory bandwidth of all the nodes), or "compact" (the
+/// threads fill up the CPUs of the first node before going to the next one,
+/// which is better when there are few threads).  Only the CPUs in the
+/// process's affinity mask are used.  Programs that use it should register it
+/// as something like:
+/// po.Register("numa-policy", &g_numa_policy, "NUMA thread placement: "
+///             "none|spread|compact");
+extern std::string g_numa_policy;
+
+/// Returns the number of NUMA nodes that have CPUs this process may run on
+/// (at least 1).
+int32 NumaNumNodes();
+
+/// Returns the node that the calling thread is currently running on, as an
+/// index from 0 to NumaNumNodes() - 1.  Unless the thread is pinned this may
+/// change at any time, so it is only a hint.
+int32 NumaCurrentNode();
+
+/// Pins the calling thread according to g_numa_policy, as the i'th thread of
+/// a group, using PinThreadToCpu(); does nothing if the policy is "none".  Dies if g_numa_policy is
+/// not a valid value.  MultiThreadPool calls this for each thread it creates.
+/// Returns true if the thread was pinned.
+bool NumaPlaceThread(int32 i);
+
+
+/// NumaReplicated holds a read-only object that many threads use, and gives
+/// each thread a copy on its own NUMA node: the first time Get() is called on
+/// a node other than the one the object was created on, it copies the object
+/// (in the calling thread, so the copy's memory is on that node) and keeps
+/// the copy until it is destroyed.  If there is one node, or "replicate" is
+/// false, Get() just returns the original object.  This is only useful when
+/// the threads are pinned (see g_numa_policy), since otherwise they may move
+/// between nodes.
+///
+/// The copy is made by the function "copy", which by default uses the copy
+/// constructor; it must make a deep copy (note that the copy constructors of
+/// OpenFst classes don't), and may return NULL to mean that the object should
+/// not be copied, in which case the original is used on that node.
+template<class T>
+class NumaReplicated {
+ public:
+  typedef T *(*CopyFunction)(const T &);
+
+  /// "original" must exist for as long as this object does.  The original is
+  /// taken to be on the node of the thread that calls this, which should be
+  /// the one that read or created it.
+  explicit NumaReplicated(const T &original, bool replicate = true,
+                          CopyFunction copy = DefaultCopy):
+      original_(original), copy_(copy),
+      original_node_(NumaCurrentNode()) {
+    if (replicate && NumaNumNodes() > 1)
+      replicas_.resize(NumaNumNodes(), NULL);
+  }
+
+  /// Returns the copy of the object for the node the calling thread is on.
+  const T &Get() const {
+    if (replicas_.empty()) return original_;
+    int32 node = NumaCurrentNode();
+    if (node == original_node_) return original_;
+    const T *replica = replicas_[node];
+    if (replica == NULL) {
+      mutex_.Lock();
+      if ((replica = replicas_[node]) == NULL) {
+        T *copy = copy_(original_);
+        replica = (copy != NULL ? copy : &original_);
+        // The copy must be complete before other threads can see it.
+        __sync_synchronize();
+        replicas_[node] = replica;
+        KALDI_VLOG(2) << (copy != NULL ? "Made" : "Not making")
+                      << " a copy of shared data for NUMA node " << node;
+      }
+      mutex_.Unlock();
+    }
+    return *replica;
+  }
+
+  ~NumaReplicated() {
+    for (size_t i = 0; i < replicas_.size(); i++)
+      if (replicas_[i] != &original_) delete replicas_[i];
+  }
+
+ private:
+  static T *DefaultCopy(const T &t) { return new T(t); }
+
+  const T &original_;
+  CopyFunction copy_;
+  int32 original_node_;
+  // The copy for each node, NULL where not yet made; empty if we don't
+  // replicate.  (Entries may point to original_.)
+  mutable std::vector<const T*> replicas_;
+  mutable Mutex mutex_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(NumaReplicated);
+};
+
+
+}  // namespace kaldi
+
+#endif  // KALDI_THREAD_KALDI_NUMA_H_
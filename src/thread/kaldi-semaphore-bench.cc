@@ -0,0 +1,229 @@
+// thread/kaldi-semaphore-bench.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+#include <sstream>
+#include "util/kaldi-bench.h"
+#include "thread/kaldi-barrier.h"
+#include "thread/kaldi-semaphore.h"
+
+namespace kaldi {
+
+// The mutex and condition-variable semaphore that class Semaphore used to be,
+// as a baseline.
+class CondSemaphore {
+ public:
+  CondSemaphore(): counter_(0) {
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&cond_, NULL);
+  }
+  ~CondSemaphore() {
+    pthread_mutex_destroy(&mutex_);
+    pthread_cond_destroy(&cond_);
+  }
+  void Wait() {
+    pthread_mutex_lock(&mutex_);
+    while (counter_ <= 0)
+      pthread_cond_wait(&cond_, &mutex_);
+    counter_--;
+    pthread_mutex_unlock(&mutex_);
+  }
+  void Signal() {
+    pthread_mutex_lock(&mutex_);
+    counter_++;
+    pthread_cond_signal(&cond_);
+    pthread_mutex_unlock(&mutex_);
+  }
+ private:
+  int32 counter_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;
+};
+
+// Two threads pass a token back and forth through two semaphores; the time
+// per call is for num_round_trips round trips, i.e. twice that many hand-offs.
+template<class S>
+class SemaphorePingPongBench {
+ public:
+  explicit SemaphorePingPongBench(int32 num_round_trips):
+      num_round_trips_(num_round_trips), stop_(false) {
+    if (pthread_create(&thread_, NULL, Partner, this) != 0)
+      KALDI_ERR << "Error creating thread";
+  }
+  ~SemaphorePingPongBench() {
+    stop_ = true;
+    ping_.Signal();
+    pthread_join(thread_, NULL);
+  }
+  void operator() () {
+    for (int32 i = 0; i < num_round_trips_; i++) {
+      ping_.Signal();
+      pong_.Wait();
+    }
+  }
+ private:
+  static void *Partner(void *arg) {
+    SemaphorePingPongBench *me = static_cast<SemaphorePingPongBench*>(arg);
+    while (true) {
+      me->ping_.Wait();
+      if (me->stop_) return NULL;
+      me->pong_.Signal();
+    }
+  }
+  int32 num_round_trips_;
+  volatile bool stop_;
+  S ping_, pong_;
+  pthread_t thread_;
+};
+
+// num_waiters threads wait on one semaphore, which this thread signals
+// num_items times per call; the call returns when they have taken every item.
+// When the waiters are asleep, each Signal() should wake only one of them.
+template<class S>
+class SemaphoreManyWaitersBench {
+ public:
+  SemaphoreManyWaitersBench(int32 num_waiters, int32 num_items):
+      num_items_(num_items), stop_(false), threads_(num_waiters) {
+    for (size_t i = 0; i < threads_.size(); i++)
+      if (pthread_create(&(threads_[i]), NULL, Waiter, this) != 0)
+        KALDI_ERR << "Error creating thread";
+  }
+  ~SemaphoreManyWaitersBench() {
+    stop_ = true;
+    for (size_t i = 0; i < threads_.size(); i++)
+      items_.Signal();
+    for (size_t i = 0; i < threads_.size(); i++)
+      pthread_join(threads_[i], NULL);
+  }
+  void operator() () {
+    for (int32 i = 0; i < num_items_; i++)
+      items_.Signal();
+    for (int32 i = 0; i < num_items_; i++)
+      done_.Wait();
+  }
+ private:
+  static void *Waiter(void *arg) {
+    SemaphoreManyWaitersBench *me =
+        static_cast<SemaphoreManyWaitersBench*>(arg);
+    while (true) {
+      me->items_.Wait();
+      if (me->stop_) return NULL;
+      me->done_.Signal();
+    }
+  }
+  int32 num_items_;
+  volatile bool stop_;
+  S items_, done_;
+  std::vector<pthread_t> threads_;
+};
+
+// num_threads threads (including this one) go through a Barrier together
+// num_cycles times per call.
+class BarrierBench {
+ public:
+  BarrierBench(int32 num_threads, int32 num_cycles):
+      barrier_(num_threads), num_cycles_(num_cycles), stop_(false),
+      threads_(num_threads - 1) {
+    for (size_t i = 0; i < threads_.size(); i++)
+      if (pthread_create(&(threads_[i]), NULL, Partner, this) != 0)
+        KALDI_ERR << "Error creating thread";
+  }
+  ~BarrierBench() {
+    stop_ = true;
+    barrier_.Wait();
+    for (size_t i = 0; i < threads_.size(); i++)
+      pthread_join(threads_[i], NULL);
+  }
+  void operator() () {
+    // The partners don't know where the calls start and end, so the first
+    // Wait() of each call (which reads stop_) is part of the loop.
+    for (int32 i = 0; i < num_cycles_; i++) {
+      barrier_.Wait();
+      barrier_.Wait();
+    }
+  }
+ private:
+  static void *Partner(void *arg) {
+    BarrierBench *me = static_cast<BarrierBench*>(arg);
+    while (true) {
+      me->barrier_.Wait();
+      if (me->stop_) return NULL;
+      me->barrier_.Wait();
+    }
+  }
+  Barrier barrier_;
+  int32 num_cycles_;
+  volatile bool stop_;
+  std::vector<pthread_t> threads_;
+};
+
+void SemaphoreBenchmarks() {
+  int32 num_round_trips = 1000;
+  std::ostringstream params;
+  params << "round_trips=" << num_round_trips;
+  {
+    SemaphorePingPongBench<Semaphore> bench(num_round_trips);
+    PrintBenchmarkResult("Semaphore ping-pong", params.str(),
+                         TimeBenchmark(bench), 2.0 * num_round_trips,
+                         "handoffs");
+  }
+  {
+    SemaphorePingPongBench<CondSemaphore> bench(num_round_trips);
+    PrintBenchmarkResult("Semaphore ping-pong (mutex+condvar baseline)",
+                         params.str(), TimeBenchmark(bench),
+                         2.0 * num_round_trips, "handoffs");
+  }
+}
+
+void SemaphoreManyWaitersBenchmarks(int32 num_waiters) {
+  int32 num_items = 1000;
+  std::ostringstream params;
+  params << "waiters=" << num_waiters << " items=" << num_items;
+  {
+    SemaphoreManyWaitersBench<Semaphore> bench(num_waiters, num_items);
+    PrintBenchmarkResult("Semaphore, many waiters", params.str(),
+                         TimeBenchmark(bench), num_items, "items");
+  }
+  {
+    SemaphoreManyWaitersBench<CondSemaphore> bench(num_waiters, num_items);
+    PrintBenchmarkResult("Semaphore, many waiters (mutex+condvar baseline)",
+                         params.str(), TimeBenchmark(bench), num_items,
+                         "items");
+  }
+}
+
+void BarrierBenchmarks(int32 num_threads) {
+  int32 num_cycles = 1000;
+  std::ostringstream params;
+  params << "threads=" << num_threads << " cycles=" << num_cycles;
+  BarrierBench bench(num_threads, num_cycles);
+  PrintBenchmarkResult("Barrier::Wait", params.str(), TimeBenchmark(bench),
+                       2.0 * num_cycles, "barriers");
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  SemaphoreBenchmarks();
+  SemaphoreManyWaitersBenchmarks(16);
+  BarrierBenchmarks(2);
+  BarrierBenchmarks(4);
+  return 0;
+}
@@ -0,0 +1,159 @@
+// thread/kaldi-semaphore-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <pthread.h>
+#include <unistd.h>
+#include "base/kaldi-common.h"
+#include "thread/kaldi-barrier.h"
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-semaphore.h"
+
+namespace kaldi {
+
+// Producers signal "items" num_items times each, consumers wait on it the same
+// number of times in total; the waits must all go through, and no more.
+struct SemaphoreTestInfo {
+  Semaphore items;
+  int32 num_items;
+  Mutex mutex;
+  int32 num_consumed;
+};
+
+void *SemaphoreTestProducer(void *arg) {
+  SemaphoreTestInfo *info = static_cast<SemaphoreTestInfo*>(arg);
+  for (int32 i = 0; i < info->num_items; i++) {
+    info->items.Signal();
+    if (i % 100 == 0) usleep(100);  // Make the consumers sleep sometimes.
+  }
+  return NULL;
+}
+
+void *SemaphoreTestConsumer(void *arg) {
+  SemaphoreTestInfo *info = static_cast<SemaphoreTestInfo*>(arg);
+  for (int32 i = 0; i < info->num_items; i++) {
+    if (i % 2 == 0 || !info->items.TryWait())
+      info->items.Wait();
+    info->mutex.Lock();
+    info->num_consumed++;
+    info->mutex.Unlock();
+  }
+  return NULL;
+}
+
+void TestSemaphore() {
+  int32 num_threads = 4;
+  SemaphoreTestInfo info;
+  info.num_items = 10000;
+  info.num_consumed = 0;
+  std::vector<pthread_t> threads(2 * num_threads);
+  for (int32 i = 0; i < 2 * num_threads; i++)
+    KALDI_ASSERT(pthread_create(&(threads[i]), NULL,
+                                (i % 2 == 0 ? SemaphoreTestProducer :
+                                 SemaphoreTestConsumer), &info) == 0);
+  for (int32 i = 0; i < 2 * num_threads; i++)
+    KALDI_ASSERT(pthread_join(threads[i], NULL) == 0);
+  KALDI_ASSERT(info.num_consumed == num_threads * info.num_items);
+  KALDI_ASSERT(info.items.GetValue() == 0 && !info.items.TryWait());
+  info.items.Signal();
+  KALDI_ASSERT(info.items.GetValue() == 1 && info.items.TryWait());
+}
+
+// Many consumers sleep on the semaphore while one producer signals it, so that
+// Signal() often has to wake one waiter of several and leave the rest asleep.
+void TestSemaphoreManyWaiters() {
+  int32 num_consumers = 8;
+  SemaphoreTestInfo info;
+  info.num_items = 1000;
+  info.num_consumed = 0;
+  std::vector<pthread_t> threads(num_consumers);
+  for (int32 i = 0; i < num_consumers; i++)
+    KALDI_ASSERT(pthread_create(&(threads[i]), NULL, SemaphoreTestConsumer,
+                                &info) == 0);
+  for (int32 i = 0; i < num_consumers * info.num_items; i++) {
+    info.items.Signal();
+    if (i % 50 == 0) usleep(200);  // Let the consumers go to sleep.
+  }
+  for (int32 i = 0; i < num_consumers; i++)
+    KALDI_ASSERT(pthread_join(threads[i], NULL) == 0);
+  KALDI_ASSERT(info.num_consumed == num_consumers * info.num_items);
+  KALDI_ASSERT(info.items.GetValue() == 0);
+}
+
+
+// Each thread increments its own counter, then waits on the barrier and checks
+// that all the counters have reached the same value.
+struct BarrierTestInfo {
+  Barrier barrier;
+  int32 num_threads;
+  int32 num_cycles;
+  std::vector<int32> counts;
+  std::vector<int32> num_last;  // times each thread returned -1.
+  int32 next_id;
+  Mutex mutex;
+};
+
+void *BarrierTestThread(void *arg) {
+  BarrierTestInfo *info = static_cast<BarrierTestInfo*>(arg);
+  info->mutex.Lock();
+  int32 id = info->next_id++;
+  info->mutex.Unlock();
+  for (int32 c = 0; c < info->num_cycles; c++) {
+    if (c % 100 == id) usleep(100);  // Make the others sleep sometimes.
+    __sync_fetch_and_add(&(info->counts[id]), 1);
+    if (info->barrier.Wait() == -1) info->num_last[id]++;
+    for (int32 i = 0; i < info->num_threads; i++)
+      KALDI_ASSERT(info->counts[i] >= c + 1);
+    // Nobody may start the next cycle until everyone has checked this one.
+    info->barrier.Wait();
+  }
+  return NULL;
+}
+
+void TestBarrier() {
+  BarrierTestInfo info;
+  info.num_threads = 4;
+  info.num_cycles = 2000;
+  info.counts.resize(info.num_threads, 0);
+  info.num_last.resize(info.num_threads, 0);
+  info.next_id = 0;
+  info.barrier.SetThreshold(info.num_threads);
+  std::vector<pthread_t> threads(info.num_threads);
+  for (int32 i = 0; i < info.num_threads; i++)
+    KALDI_ASSERT(pthread_create(&(threads[i]), NULL, BarrierTestThread,
+                                &info) == 0);
+  for (int32 i = 0; i < info.num_threads; i++)
+    KALDI_ASSERT(pthread_join(threads[i], NULL) == 0);
+  int32 tot_last = 0;
+  for (int32 i = 0; i < info.num_threads; i++) {
+    KALDI_ASSERT(info.counts[i] == info.num_cycles);
+    tot_last += info.num_last[i];
+  }
+  KALDI_ASSERT(tot_last == info.num_cycles);
+}
+
+}  // end namespace kaldi.
+
+int main() {
+  using namespace kaldi;
+  TestSemaphore();
+  TestSemaphoreManyWaiters();
+  TestBarrier();
+  std::cout << "Test OK.\n";
+}
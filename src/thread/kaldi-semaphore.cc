@@ -21,10 +21,83 @@
 
 #include "base/kaldi-error.h"
 #include "thread/kaldi-semaphore.h"
+#include "thread/kaldi-futex.h"
 
 namespace kaldi {
 
-  
+#ifdef __linux__
+
+Semaphore::Semaphore(int32 initValue): counter_(initValue), waiters_(0) {
+  if (initValue < 0 || initValue > kFutexValueMask)
+    KALDI_ERR << "Invalid initial value for semaphore: " << initValue;
+}
+
+
+Semaphore::~Semaphore() { }
+
+
+bool Semaphore::TryWait() {
+  int32 c;
+  while (((c = counter_) & kFutexValueMask) > 0) {
+    if (__sync_bool_compare_and_swap(&counter_, c, c - 1))
+      return true;
+  }
+  return false;
+}
+
+
+void Semaphore::Wait() {
+  for (int32 i = 0; i < FutexSpinCount(); i++) {
+    if (TryWait()) return;
+    CpuRelax();
+  }
+  // We are counted in waiters_ before we can set the waiters bit or sleep, so
+  // Signal() sees us when it decides whether to leave the bit set.
+  __sync_fetch_and_add(&waiters_, 1);
+  while (true) {
+    int32 c = counter_;
+    if ((c & kFutexValueMask) > 0) {
+      if (__sync_bool_compare_and_swap(&counter_, c, c - 1))
+        break;
+    } else if (c & kFutexWaitersBit) {
+      // Sleep unless counter_ has changed, as it will have if anything was
+      // signaled since we read it.
+      FutexWait(&counter_, c);
+    } else {
+      __sync_bool_compare_and_swap(&counter_, c, c | kFutexWaitersBit);
+    }
+  }
+  __sync_fetch_and_sub(&waiters_, 1);
+}
+
+
+void Semaphore::Signal() {
+  int32 c, waiters, new_c;
+  do {
+    c = counter_;
+    waiters = waiters_;
+    if ((c & kFutexValueMask) == kFutexValueMask)
+      KALDI_ERR << "Semaphore overflow";
+    new_c = (c & kFutexValueMask) + 1;
+    // Only one waiter can take the count, so we wake just one; the bit stays
+    // set if others are still waiting, so the next Signal() wakes another.
+    if (waiters > 1) new_c |= (c & kFutexWaitersBit);
+  } while (!__sync_bool_compare_and_swap(&counter_, c, new_c));
+  // We must not touch *this after the compare-and-swap, since a woken thread
+  // may have destroyed it; the wake calls only pass the address to the
+  // kernel.  waiters_ was read before the compare-and-swap and may be out of
+  // date; if it said there was at most one waiter we have cleared the bit, so
+  // we wake all sleepers in case there are more (normally there is just one).
+  if (c & kFutexWaitersBit) {
+    if (waiters > 1)
+      FutexWakeOne(&counter_);
+    else
+      FutexWakeAll(&counter_);
+  }
+}
+
+#else  // Not Linux: use a pthread mutex and condition variable.
+
 Semaphore::Semaphore(int32 initValue) {
   counter_ = initValue;
   if(0 != pthread_mutex_init(&mutex_, NULL)) {
@@ -92,4 +165,6 @@ void Semaphore::Signal() {
 }
 
 
+#endif  // __linux__
+
 } // namespace kaldi
@@ -22,9 +22,17 @@
 #define KALDI_THREAD_KALDI_SEMAPHORE_H_ 1
 
 #include <pthread.h>
+#include "base/kaldi-types.h"
 
 namespace kaldi {
-  
+
+/**
+ * A counting semaphore.  On Linux it is implemented directly on a futex: the
+ * counter is changed with atomic operations, so Signal() and an uncontended
+ * Wait() never enter the kernel, and Wait() spins briefly before it sleeps,
+ * since in the task queues that use this class the wait is often short.
+ * Elsewhere it uses a pthread mutex and condition variable.
+ */
 class Semaphore {
  public:
   Semaphore(int32 initValue = 0); 
@@ -39,15 +47,22 @@ class Semaphore {
    * zero means no resources, the Wait() will block
    */ 
   int32 GetValue() {
-    return counter_; 
+    return counter_ & 0x3fffffff;  // See kFutexValueMask in kaldi-futex.h.
   }
 
  private:
-  int32 counter_; ///< the semaphore counter, 0 means block on Wait() 
-  
+  /// the semaphore counter, 0 means block on Wait().  On Linux the bit
+  /// above the counter is set while threads may be sleeping in Wait().
+  volatile int32 counter_;
+
+#ifdef __linux__
+  /// The number of threads in the sleeping part of Wait().  Signal() reads it
+  /// to decide whether the waiters bit must stay set after it wakes one.
+  volatile int32 waiters_;
+#else
   pthread_mutex_t mutex_;
   pthread_cond_t cond_;
-
+#endif
 };
 
 
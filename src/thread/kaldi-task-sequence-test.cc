@@ -66,11 +66,116 @@ void TestTaskSequencer() {
     KALDI_ASSERT(task_output[i] == i);
 }
 
+class MyCostlyTaskClass { // records the order in which the tasks were run.
+ public:
+  MyCostlyTaskClass(int32 i, std::vector<int32> *run_order,
+                    std::vector<int32> *output):
+      i_(i), run_order_(run_order), output_(output) { }
+  void operator() () { run_order_->push_back(i_); }
+  ~MyCostlyTaskClass() { output_->push_back(i_); }
+ private:
+  int32 i_;
+  std::vector<int32> *run_order_;
+  std::vector<int32> *output_;
+};
+
+void TestTaskSequencerLookahead() {
+  TaskSequencerConfig config;
+  config.num_threads = 1 + rand() % 5;
+  config.lookahead = rand() % 30;
+  if (rand() % 2 == 1 )
+    config.num_threads_total = config.num_threads + rand() % config.num_threads;
+  int32 num_tasks = rand() % 100;
+  // With one thread, and enough total threads that no task has to be started
+  // early, the tasks in the lookahead window are run in order of decreasing
+  // cost.
+  bool check_run_order = (config.num_threads == 1 && rand() % 2 == 0);
+  if (check_run_order) {
+    config.lookahead = num_tasks;
+    config.num_threads_total = num_tasks + 1;
+  }
+  std::vector<int32> costs(num_tasks), run_order, output;
+  for (int32 i = 0; i < num_tasks; i++)
+    costs[i] = rand() % 10;
+  {
+    TaskSequencer<MyCostlyTaskClass> sequencer(config);
+    for (int32 i = 0; i < num_tasks; i++)
+      sequencer.Run(new MyCostlyTaskClass(i, &run_order, &output), costs[i]);
+  }
+  KALDI_ASSERT(output.size() == static_cast<size_t>(num_tasks) &&
+               run_order.size() == static_cast<size_t>(num_tasks));
+  for (int32 i = 0; i < num_tasks; i++)
+    KALDI_ASSERT(output[i] == i);
+  if (check_run_order) {
+    for (int32 i = 0; i + 1 < num_tasks; i++) {
+      int32 a = run_order[i], b = run_order[i + 1];
+      KALDI_ASSERT(costs[a] > costs[b] || (costs[a] == costs[b] && a < b));
+    }
+  }
+}
+
+// Stands in for a sequential table reader of int32.
+class MyReader {
+ public:
+  MyReader(int32 num_items): i_(0), num_items_(num_items) { }
+  bool Done() const { return i_ >= num_items_; }
+  void Next() { i_++; }
+  std::string Key() const {
+    std::ostringstream os;
+    os << "utt" << i_;
+    return os.str();
+  }
+  const int32 &Value() const { return i_; }
+  void FreeCurrent() { }
+ private:
+  int32 i_;
+  int32 num_items_;
+};
+
+class MyWorker { // squares its input, and keeps the results in order.
+ public:
+  typedef int32 Input;
+  typedef int32 Result;
+  bool Process(const std::string &key, int32 *input, int32 *result) const {
+    int32 spin = 1000000 * rand() % 100;
+    for (int32 i = 0; i < spin; i++);
+    *result = *input * *input;
+    return (*input % 3 != 0);
+  }
+  void Write(const std::string &key, bool ok, const int32 &result) {
+    keys.push_back(key);
+    results.push_back(ok ? result : -1);
+  }
+  std::vector<std::string> keys;
+  std::vector<int32> results;
+};
+
+void TestRunTableTasks() {
+  TaskSequencerConfig config;
+  config.num_threads = 1 + rand() % 20;
+  int32 num_items = rand() % 100;
+  MyReader reader(num_items);
+  MyWorker worker;
+  int64 num_read = RunTableTasks(config, &reader, &worker);
+  KALDI_ASSERT(num_read == num_items &&
+               worker.results.size() == static_cast<size_t>(num_items));
+  for (int32 i = 0; i < num_items; i++) {
+    std::ostringstream os;
+    os << "utt" << i;
+    KALDI_ASSERT(worker.keys[i] == os.str() &&
+                 worker.results[i] == (i % 3 != 0 ? i * i : -1));
+  }
+}
+
 }  // end namespace kaldi.
 
 int main() {
   using namespace kaldi;
   for (int32 i = 0; i < 1000; i++)
     TestTaskSequencer();
+  for (int32 i = 0; i < 1000; i++)
+    TestTaskSequencerLookahead();
+  for (int32 i = 0; i < 100; i++)
+    TestRunTableTasks();
 }
 
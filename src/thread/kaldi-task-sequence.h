@@ -21,7 +21,10 @@
 #define KALDI_THREAD_KALDI_TASK_SEQUENCE_H_ 1
 
 #include <pthread.h>
+#include <string>
+#include <vector>
 #include "thread/kaldi-thread.h"
+#include "thread/kaldi-numa.h"
 #include "itf/options-itf.h"
 #include "thread/kaldi-semaphore.h"
 
@@ -46,21 +49,29 @@ namespace kaldi {
    does some kind of output).  We have a templated class TaskSequencer<C> which
    is responsible for running the jobs in parallel.  It has a function Run()
    that will accept a new object of class C; this will block until a thread is
-   free, at which time it will spawn a thread that starts running the operator
-   () of the class.  When classes are finished running, the objects will be
+   free, at which time it will start running the operator () of the class in a
+   thread of the thread pool (see MultiThreadPool in kaldi-thread.h).  When classes are finished running, the objects will be
    deleted.  Class TaskSequencer guarantees that the destructors will be called
    sequentially (not in parallel) and in the same order the objects were given
    to the Run() function, so that it is safe for the destructor to have side
    effects such as outputting data.
 
    Note: the destructor of TaskSequencer will wait for any remaining jobs that
-   are still running and will call the destructors.   
+   are still running and will call the destructors.
+
+   If the jobs are of very different sizes, running them in input order can
+   leave one thread working on a long job at the end while the others are idle.
+   If config.lookahead > 0 and Run() is given an estimate of the cost of each
+   job (e.g. its number of frames), up to "lookahead" jobs are buffered and the
+   most costly of them is started first.  The order of the destructors is not
+   affected.
  */
 
 struct TaskSequencerConfig {
   int32 num_threads;
   int32 num_threads_total;
-  TaskSequencerConfig(): num_threads(1), num_threads_total(0)  { }
+  int32 lookahead;
+  TaskSequencerConfig(): num_threads(1), num_threads_total(0), lookahead(0) { }
   void Register(OptionsItf *po) {
     po->Register("num-threads", &num_threads, "Number of actively processing "
                  "threads to run in parallel");
@@ -69,6 +80,18 @@ struct TaskSequencerConfig {
                  "to produce their output.  Controls memory use.  If <= 0, "
                  "defaults to --num-threads plus 20.  Otherwise, must "
                  "be >= num-threads.");
+    po->Register("task-lookahead", &lookahead, "If > 0, the number of tasks "
+                 "(e.g. utterances) to read ahead so that the most costly of "
+                 "them (e.g. the longest) can be started first; the output "
+                 "order is unchanged.  Buffered tasks are not counted in "
+                 "--num-threads-total.");
+    // This sets a global variable (see kaldi-numa.h), since the threads
+    // belong to MultiThreadPool; it is registered here so that all the
+    // programs that use TaskSequencer have it.
+    po->Register("numa-policy", &g_numa_policy, "If \"spread\" or "
+                 "\"compact\", pin the threads to CPUs, spread over the NUMA "
+                 "nodes or filling one node at a time, so the memory each "
+                 "thread allocates is local to it.  \"none\" to not pin them.");
   }
 };
 
@@ -82,104 +105,122 @@ class TaskSequencer {
       threads_avail_(config.num_threads),
       tot_threads_avail_(config.num_threads_total > 0 ? config.num_threads_total :
                          config.num_threads + 20),
-      thread_list_(NULL) {
+      num_threads_total_(config.num_threads_total > 0 ?
+                         config.num_threads_total : config.num_threads + 20),
+      lookahead_(config.lookahead), num_queued_(0), num_started_(0),
+      num_finished_(0) {
     KALDI_ASSERT((config.num_threads_total <= 0 ||
                   config.num_threads_total >= config.num_threads) &&
                  "num-threads-total, if specified, must be >= num-threads");
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&cond_, NULL);
   }
 
   /// This function takes ownership of the pointer "c", and will delete it
-  /// in the same sequence as Run was called on the jobs.
-  void Run(C *c) {
-    threads_avail_.Wait(); // wait till we have a thread for computation free.
-    tot_threads_avail_.Wait(); // this ensures we don't have too many threads
-    // waiting on I/O, and consume too much memory.
-    
-    // put the new RunTaskArgsList object at head of the singly
-    // linked list thread_list_.
-    thread_list_ = new RunTaskArgsList(this, c, thread_list_);
-    int32 ret;
-    if ((ret=pthread_create(&(thread_list_->thread),
-                            NULL, // default attributes
-                            TaskSequencer<C>::RunTask,
-                            static_cast<void*>(thread_list_)))) {
-      const char *c = strerror(ret);
-      KALDI_ERR << "Error creating thread, errno was: " << (c ? c : "[NULL]");
-    }
+  /// in the same sequence as Run was called on the jobs.  "cost" is an
+  /// estimate of how long the job will take (e.g. its number of frames); it
+  /// only matters if config.lookahead > 0.
+  void Run(C *c, double cost = 0.0) {
+    PendingTask task;
+    task.c = c;
+    task.index = num_queued_++;
+    task.cost = cost;
+    pending_.push_back(task);
+    if (static_cast<int32>(pending_.size()) > lookahead_)
+      StartNextTask();
   }
 
   void Wait() { // You call this at the end if it's more convenient
     // than waiting for the destructor.  It waits for all tasks to finish.
-    if (thread_list_ != NULL) {
-      int ret = pthread_join(thread_list_->thread, NULL);
-      if (ret != 0) {
-        const char *c = strerror(ret);
-        KALDI_ERR << "Error joining thread, errno was: " << (c ? c : "[NULL]");
-      }
-      KALDI_ASSERT(thread_list_->tail == NULL); // thread would not
-      // have exited without setting tail to NULL.
-      delete thread_list_;
-      thread_list_ = NULL;
-    }
+    while (!pending_.empty())
+      StartNextTask();
+    group_.Wait();
   }
-  
-  /// The destructor waits for the last thread to exit.
+
+  /// The destructor waits for the last task to finish.
   ~TaskSequencer() {
-    Wait();      
+    Wait();
+    pthread_cond_destroy(&cond_);
+    pthread_mutex_destroy(&mutex_);
   }
  private:
-  struct RunTaskArgsList {
+  struct PendingTask {
+    C *c;
+    int64 index;  // The sequence number of this task.
+    double cost;
+  };
+
+  // Starts one of the tasks in pending_, once there is a thread free.
+  void StartNextTask() {
+    threads_avail_.Wait(); // wait till we have a thread for computation free.
+    tot_threads_avail_.Wait(); // this ensures we don't have too many threads
+    // waiting on I/O, and consume too much memory.
+
+    // Normally we start the most costly task.  But if this task takes the
+    // last of the num_threads_total_ slots we start the earliest one
+    // (pending_ is in input order), because all the other tasks may be
+    // waiting for it before they can be deleted and free their slots.
+    pthread_mutex_lock(&mutex_);
+    int64 num_alive = num_started_ - num_finished_;
+    pthread_mutex_unlock(&mutex_);
+    size_t best = 0;
+    if (num_alive + 1 < num_threads_total_) {
+      for (size_t i = 1; i < pending_.size(); i++)
+        if (pending_[i].cost > pending_[best].cost) best = i;
+    }
+    RunTaskArgs *args = new RunTaskArgs(this, pending_[best].c,
+                                        pending_[best].index);
+    pending_.erase(pending_.begin() + best);
+    num_started_++;
+    // The job runs in a thread of the process-wide thread pool (see
+    // kaldi-thread.h), which is faster than creating a thread for each job.
+    MultiThreadPool::Instantiate().Run(TaskSequencer<C>::RunTask,
+                                       static_cast<void*>(args), &group_);
+  }
+
+  struct RunTaskArgs {
     TaskSequencer *me; // Think of this as a "this" pointer.
-    C *c; // Clist element of the task we're expected
-    pthread_t thread;
-    RunTaskArgsList *tail;
-    RunTaskArgsList(TaskSequencer *me, C *c, RunTaskArgsList *tail):
-        me(me), c(c), tail(tail) {}
+    C *c; // The task we're expected to run.
+    int64 index; // The sequence number of this task.
+    RunTaskArgs(TaskSequencer *me, C *c, int64 index):
+        me(me), c(c), index(index) {}
   };
-  // This static function gets run in the threads that we create.
+  // This static function gets run in the threads of the thread pool.
   static void* RunTask(void *input) {
-    RunTaskArgsList *args = static_cast<RunTaskArgsList*>(input);
-    
+    RunTaskArgs *args = static_cast<RunTaskArgs*>(input);
+    TaskSequencer *me = args->me;
+
     // (1) run the job.
     (*(args->c))(); // call operator () on args->c, which does the computation.
-    args->me->threads_avail_.Signal(); // Signal that the compute-intensive
+    me->threads_avail_.Signal(); // Signal that the compute-intensive
     // part of the thread is done (we want to run no more than
     // config_.num_threads of these.)
-    
+
     // (2) we want to destroy the object "c" now, by deleting it.  But for
     //     correct sequencing (this is the whole point of this class, it
     //     is intended to ensure the output of the program is in correct order),
-    //     we first wait till the previous thread, whose details will be in "tail",
-    //     is finished.
-    if (args->tail != NULL) {
-      int ret = pthread_join(args->tail->thread, NULL);
-      if (ret != 0) {
-        const char *c = strerror(ret);
-        KALDI_ERR << "Error joining thread, errno was: " << (c ? c : "[NULL]");
-      }
-    }
+    //     we first wait till all the objects given to Run() before this one
+    //     have been deleted.
+    pthread_mutex_lock(&(me->mutex_));
+    while (me->num_finished_ != args->index)
+      pthread_cond_wait(&(me->cond_), &(me->mutex_));
+    pthread_mutex_unlock(&(me->mutex_));
 
     delete args->c; // delete the object "c".  This may cause some output,
     // e.g. to a stream.  We don't need to worry about concurrent access to
-    // the output stream, because each thread waits for the previous thread
-    // to be done, before doing this.  So there is no risk of concurrent
-    // access.
-    args->c = NULL;
-    
-    if (args->tail != NULL) {
-      KALDI_ASSERT(args->tail->tail == NULL); // Because we already
-      // did pthread_join on args->tail->thread, which means that
-      // thread was done, and before it exited, it would have
-      // deleted and set to NULL its tail (which is the next line of code).
-      delete args->tail;
-      args->tail = NULL;
-    }
-    // At this point we are exiting from the thread.  Signal the
-    // "tot_threads_avail_" semaphore which is used to limit the total number of threads that are alive, including
-    // not onlhy those that are in active computation in c->operator (), but those
-    // that are waiting on I/O or other threads.
-    args->me->tot_threads_avail_.Signal();
-    // .. and exit the thread, by returning. 
+    // the output stream, because only one task at a time can get here.
+
+    pthread_mutex_lock(&(me->mutex_));
+    me->num_finished_++;
+    pthread_cond_broadcast(&(me->cond_));
+    pthread_mutex_unlock(&(me->mutex_));
+
+    // Signal the "tot_threads_avail_" semaphore which is used to limit the
+    // total number of tasks that are alive, including not only those that are
+    // in active computation in c->operator (), but those that are waiting on
+    // I/O or other tasks.
+    me->tot_threads_avail_.Signal();
+    delete args;
     return NULL;
   }
 
@@ -188,10 +229,79 @@ class TaskSequencer {
 
   Semaphore tot_threads_avail_; // We use this semaphore to ensure we don't
   // consume too much memory...
-  RunTaskArgsList *thread_list_; 
-  
+
+  int32 num_threads_total_;
+  int32 lookahead_;
+  // Tasks given to Run() but not yet started, in input order; there are at
+  // most lookahead_ of these between calls to Run().
+  std::vector<PendingTask> pending_;
+
+  ThreadGroup group_;  // The tasks we gave to the thread pool.
+  int64 num_queued_;  // Number of times Run() was called.
+  int64 num_started_;  // Number of tasks given to the thread pool.
+
+  // The following are for sequencing the deletion of the tasks.
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;  // Signaled when num_finished_ increases.
+  int64 num_finished_;  // Number of tasks that have been deleted.
 };
 
+/**
+   RunTableTasks() is a driver for the common case of a program that reads a
+   table (e.g. an archive of lattices) in sequence, does something to each
+   object independently, and writes the results in input order.  The
+   per-utterance work is described by a "worker" class W, which must have:
+
+     typedef ... Input;   // the type read, e.g. CompactLattice.
+     typedef ... Result;  // the result of processing one utterance.
+     // Does the work.  Called from several threads at once, so it must not
+     // modify shared state.  May modify "input".  Returns false on error.
+     bool Process(const std::string &key, Input *input, Result *result) const;
+     // Writes the result and updates any statistics.  Called in input order,
+     // one at a time, so it needs no locking.
+     void Write(const std::string &key, bool ok, const Result &result);
+
+   Each object is copied out of the reader and the reader's copy is freed
+   (FreeCurrent()) before the object is handed to a thread, so types like
+   Lattice whose copies share data are not shared between threads.
+ */
+template<class W>
+class TableTask {
+ public:
+  TableTask(W *worker, const std::string &key,
+            const typename W::Input &input):
+      worker_(worker), key_(key), input_(input), ok_(false) { }
+
+  void operator () () { ok_ = worker_->Process(key_, &input_, &result_); }
+
+  ~TableTask() { worker_->Write(key_, ok_, result_); }
+
+ private:
+  W *worker_;
+  std::string key_;
+  typename W::Input input_;
+  typename W::Result result_;
+  bool ok_;
+};
+
+/// Runs worker->Process() on each object from "reader" (a sequential table
+/// reader whose value type is W::Input) using config.num_threads threads, and
+/// calls worker->Write() for each in input order.  Returns the number of
+/// objects read.  See TableTask for the requirements on W.
+template<class W, class R>
+int64 RunTableTasks(const TaskSequencerConfig &config, R *reader, W *worker) {
+  int64 num_read = 0;
+  TaskSequencer<TableTask<W> > sequencer(config);
+  for (; !reader->Done(); reader->Next(), num_read++) {
+    TableTask<W> *task = new TableTask<W>(worker, reader->Key(),
+                                          reader->Value());
+    reader->FreeCurrent();
+    sequencer.Run(task);
+  }
+  sequencer.Wait();
+  return num_read;
+}
+
 } // namespace kaldi
 
 #endif  // KALDI_THREAD_KALDI_TASK_SEQUENCE_H_
@@ -81,10 +81,66 @@ void TestThreads() {
 }
 
 
+class MyParallelForClass {  // Sums up the integers in a range.
+ public:
+  MyParallelForClass(int64 *tot): tot_(tot), private_counter_(0) { }
+  void operator() (int32 begin, int32 end) {
+    for (int32 j = begin; j < end; j++)
+      private_counter_ += j;
+  }
+  ~MyParallelForClass() {
+    *tot_ += private_counter_;
+  }
+ private:
+  int64 *tot_;
+  int64 private_counter_;
+};
+
+void TestParallelFor() {
+  for (int32 i = 0; i < 20; i++) {
+    int32 begin = rand() % 100, end = begin + rand() % 1000,
+        num_blocks = 1 + rand() % 10;
+    int64 tot = 0;
+    {
+      MyParallelForClass c(&tot);
+      RunParallelFor(begin, end, c, num_blocks);
+    }
+    int64 expected = 0;
+    for (int32 j = begin; j < end; j++) expected += j;
+    KALDI_ASSERT(tot == expected);
+  }
+}
+
+void TestThreadPoolReuse() {
+  g_num_threads = 4;
+  int32 num_threads_before = MultiThreadPool::Instantiate().NumThreads();
+  for (int32 i = 0; i < 100; i++) {
+    int32 max_to_count = 1000, tot = 0;
+    MyThreadClass c(max_to_count, &tot);
+    RunMultiThreaded(c);
+    KALDI_ASSERT(tot == (1000*(1000-1))/2);
+  }
+  // The threads should have been reused, not created anew each time.
+  KALDI_ASSERT(MultiThreadPool::Instantiate().NumThreads() <=
+               std::max(num_threads_before, g_num_threads));
+}
+
+void TestPinThreadToCpu() {
+  // this may not be supported, but must not fail.
+  bool pinned = PinThreadToCpu(rand() % 100);
+  KALDI_LOG << "Thread " << (pinned ? "was" : "could not be") << " pinned.";
+  UnpinThread();
+  TestParallelFor();  // all still works.
+}
+
 }  // end namespace kaldi.
 
 int main() {
   using namespace kaldi;
   TestThreads();
+  TestParallelFor();
+  TestThreadPoolReuse();
+  TestPinThreadToCpu();
+  std::cout << "Test OK.\n";
 }
 
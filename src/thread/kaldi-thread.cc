@@ -18,8 +18,14 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstring>
+#ifdef __linux__
+#include <sched.h>
+#endif
 #include "base/kaldi-common.h"
 #include "thread/kaldi-thread.h"
+#include "thread/kaldi-numa.h"
+#include "matrix/blas-threads.h"
 
 namespace kaldi {
 int32 g_num_threads = 8;  // Initialize this global variable.
@@ -29,5 +35,163 @@ MultiThreadable::~MultiThreadable() {
 }
 
 
+MultiThreadPool &MultiThreadPool::Instantiate() {
+  // The pool is never destroyed: its threads just wait for jobs until the
+  // program exits.  (Joining them at exit could hang if the program exits on
+  // an error while some job is blocked.)  Note: the first call should be made
+  // from a single thread, as in C++98 the initialization of function-level
+  // statics is not guaranteed to be thread-safe.
+  static MultiThreadPool *pool = new MultiThreadPool();
+  return *pool;
+}
+
+MultiThreadPool::MultiThreadPool(): num_idle_(0), num_threads_(0),
+                                    num_started_(0) {
+  if (pthread_mutex_init(&mutex_, NULL) != 0)
+    KALDI_ERR << "Cannot initialize pthread mutex";
+  if (pthread_cond_init(&cond_, NULL) != 0)
+    KALDI_ERR << "Cannot initialize pthread conditional variable";
+}
+
+void MultiThreadPool::Run(void *(*func)(void*), void *arg,
+                          ThreadGroup *group) {
+  KALDI_ASSERT(group != NULL);
+  group->JobAdded();
+  Job job;
+  job.func = func;
+  job.arg = arg;
+  job.group = group;
+  pthread_mutex_lock(&mutex_);
+  jobs_.push_back(job);
+  if (static_cast<int32>(jobs_.size()) > num_idle_) {
+    // Not enough idle threads to start all the waiting jobs straight away, so
+    // add a thread to the pool.
+    pthread_t thread;
+    int32 ret;
+    if ((ret = pthread_create(&thread, NULL, WorkerLoop, this)) != 0) {
+      pthread_mutex_unlock(&mutex_);
+      const char *c = strerror(ret);
+      KALDI_ERR << "Error creating thread, errno was: " << (c ? c : "[NULL]");
+    }
+    pthread_detach(thread);
+    num_threads_++;
+    KALDI_VLOG(3) << "Thread pool now has " << num_threads_ << " threads.";
+  } else {
+    pthread_cond_signal(&cond_);
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+int32 MultiThreadPool::NumThreads() {
+  pthread_mutex_lock(&mutex_);
+  int32 ans = num_threads_;
+  pthread_mutex_unlock(&mutex_);
+  return ans;
+}
+
+void *MultiThreadPool::WorkerLoop(void *pool_in) {
+  MultiThreadPool *pool = static_cast<MultiThreadPool*>(pool_in);
+  pthread_mutex_lock(&(pool->mutex_));
+  // The thread keeps its place (see g_numa_policy in kaldi-numa.h) for all the
+  // jobs it runs.
+  NumaPlaceThread(pool->num_started_++);
+  pool->num_idle_++;
+  while (true) {
+    while (pool->jobs_.empty())
+      pthread_cond_wait(&(pool->cond_), &(pool->mutex_));
+    Job job = pool->jobs_.front();
+    pool->jobs_.pop_front();
+    pool->num_idle_--;
+    pthread_mutex_unlock(&(pool->mutex_));
+    {
+      // The jobs are run in parallel, so BLAS itself should not use several
+      // threads; see blas-threads.h.
+      BlasNumThreadsScope blas_threads(1);
+      (*(job.func))(job.arg);
+    }
+    // We count ourselves as idle before telling the group the job is done, or
+    // a caller that waits for the group and then runs more jobs would find
+    // no idle thread and create a new one.
+    pthread_mutex_lock(&(pool->mutex_));
+    pool->num_idle_++;
+    pthread_mutex_unlock(&(pool->mutex_));
+    job.group->JobDone();
+    pthread_mutex_lock(&(pool->mutex_));
+  }
+  return NULL;  // Not reached.
+}
+
+
+ThreadGroup::ThreadGroup(): num_pending_(0) {
+  if (pthread_mutex_init(&mutex_, NULL) != 0)
+    KALDI_ERR << "Cannot initialize pthread mutex";
+  if (pthread_cond_init(&cond_, NULL) != 0)
+    KALDI_ERR << "Cannot initialize pthread conditional variable";
+}
+
+ThreadGroup::~ThreadGroup() {
+  KALDI_ASSERT(num_pending_ == 0 &&
+               "ThreadGroup destroyed while jobs are running.");
+  pthread_cond_destroy(&cond_);
+  pthread_mutex_destroy(&mutex_);
+}
+
+void ThreadGroup::JobAdded() {
+  pthread_mutex_lock(&mutex_);
+  num_pending_++;
+  pthread_mutex_unlock(&mutex_);
+}
+
+void ThreadGroup::JobDone() {
+  pthread_mutex_lock(&mutex_);
+  num_pending_--;
+  if (num_pending_ == 0)
+    pthread_cond_broadcast(&cond_);
+  pthread_mutex_unlock(&mutex_);
+}
+
+void ThreadGroup::Wait() {
+  pthread_mutex_lock(&mutex_);
+  while (num_pending_ > 0)
+    pthread_cond_wait(&cond_, &mutex_);
+  pthread_mutex_unlock(&mutex_);
+}
+
+
+#ifdef __linux__
+static pthread_once_t process_cpus_once = PTHREAD_ONCE_INIT;
+static cpu_set_t process_cpus;
+static std::vector<int32> process_cpu_list;
+
+static void InitProcessCpus() {
+  if (sched_getaffinity(0, sizeof(process_cpus), &process_cpus) != 0) {
+    KALDI_WARN << "Could not get the CPU affinity of the process: "
+               << strerror(errno);
+    return;
+  }
+  for (int32 c = 0; c < CPU_SETSIZE; c++)
+    if (CPU_ISSET(c, &process_cpus)) process_cpu_list.push_back(c);
+}
+
+bool PinThreadToCpu(int32 i) {
+  pthread_once(&process_cpus_once, InitProcessCpus);
+  if (process_cpu_list.empty()) return false;
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(process_cpu_list[i % process_cpu_list.size()], &cpus);
+  return (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0);
+}
+
+void UnpinThread() {
+  pthread_once(&process_cpus_once, InitProcessCpus);
+  if (!process_cpu_list.empty())
+    pthread_setaffinity_np(pthread_self(), sizeof(process_cpus),
+                           &process_cpus);
+}
+#else
+bool PinThreadToCpu(int32 i) { return false; }
+
+void UnpinThread() { }
+#endif
 
 }  // end namespace kaldi
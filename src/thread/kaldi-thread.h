@@ -28,6 +28,9 @@
 #endif
 
 #include <pthread.h>
+#include <deque>
+#include <vector>
+#include "base/kaldi-common.h"
 #include "thread/kaldi-barrier.h"
 // This header provides a convenient mechanism for parallelization.  The idea is
 // that you have some range of integers, e.g. A ... B-1 (with B > A), and some
@@ -43,19 +46,22 @@
 
 // Description of MultiThreadPool and its usage:
 //
-// Usage of the RunMultiThreadedPersistent is the same as the usage of
-// RunMultiThreaded, except that the object provided ust inherit MultiThreadable
-// and it's run method isn't called, but operator() is called directly instead.
-// Member variables num_threads_ and thread_id_ must NOT be redefined in the
-// classes used, as they are called when using MultiThreadable*
-//
-// MultiThreadPool is a singleton class, it's instance is obtained using
-// MultiThreadPool::Instantiate(). First instantiation initializes the thread
-// pool using g_num_threads threads, each of those threads runs infinite loop in
-// ThreadWorker::run(). When RunMultiThreadedPersistent(c) is called, each
-// ThreadWorker is given a pointer to a copy of c and calls c() in it's thread.
-// After doing this, it Waits on barrier to sync with all the threads and the
-// main one, then Waits again until it receives another job.
+// MultiThreadPool is a process-wide pool of threads that MultiThreader,
+// RunParallelFor() and TaskSequencer (see kaldi-task-sequence.h) all run their
+// jobs on, so that code which calls them repeatedly (e.g. once per iteration
+// of some update) doesn't pay the cost of creating and joining threads each
+// time.  Its instance is obtained using MultiThreadPool::Instantiate().  Jobs
+// are given to it with Run(), together with a ThreadGroup object which the
+// caller can Wait() on for its jobs to finish.  A job is always started
+// straight away: if no thread in the pool is idle, a new one is created, so
+// jobs may safely block waiting for each other or for the calling thread (as
+// the threads in nnet2/nnet-update-parallel.cc do).  The number of threads in
+// the pool is therefore the largest number of jobs that were ever running at
+// once.
+// The jobs are run with the BLAS library limited to one thread (see
+// BlasNumThreadsScope in matrix/blas-threads.h), so the cores are not
+// oversubscribed.  The threads are pinned to CPUs if g_numa_policy is set (see
+// kaldi-numa.h).
 
 namespace kaldi {
 
@@ -66,6 +72,63 @@ extern int32 g_num_threads;  // Maximum number of threads (for programs that
 // should register it with their ParseOptions, as something like:
 // po.Register("num-threads", &g_num_threads, "Number of threads to use.");
 
+class ThreadGroup;
+
+class MultiThreadPool {
+ public:
+  /// Returns the process-wide instance, creating it the first time.
+  static MultiThreadPool &Instantiate();
+
+  /// Runs func(arg) in a thread of the pool.  This returns immediately; call
+  /// group->Wait() to wait for all the jobs run with "group" to finish.  The
+  /// signature of "func" is the one pthread_create() takes (its return value is
+  /// ignored), so the static run() functions of MultiThreadable classes can be
+  /// used directly.
+  void Run(void *(*func)(void*), void *arg, ThreadGroup *group);
+
+  /// Returns the number of threads in the pool.
+  int32 NumThreads();
+ private:
+  MultiThreadPool();
+  static void *WorkerLoop(void *pool_in);
+
+  struct Job {
+    void *(*func)(void*);
+    void *arg;
+    ThreadGroup *group;
+  };
+
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;  // signaled when a job is added.
+  std::deque<Job> jobs_;  // Jobs not yet started.
+  int32 num_idle_;  // Number of threads waiting (or about to wait) for a job.
+  int32 num_threads_;
+  int32 num_started_;  // Number of threads that have started running; the
+                       // index of each thread, for NumaPlaceThread().
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MultiThreadPool);
+};
+
+/// A ThreadGroup keeps track of a set of jobs given to MultiThreadPool::Run(),
+/// so you can wait for them to finish.  It must not be destroyed while any of
+/// its jobs are unfinished.
+class ThreadGroup {
+ public:
+  ThreadGroup();
+  /// Waits until all the jobs run with this group have finished.
+  void Wait();
+  ~ThreadGroup();
+ private:
+  friend class MultiThreadPool;
+  void JobAdded();
+  void JobDone();
+
+  int32 num_pending_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ThreadGroup);
+};
+
+
 class MultiThreadable {
   // To create function that does part of the job, create class that inherits
   // this one, reimplements operator() and does part of the job based on
@@ -121,46 +184,34 @@ class ExampleClass: public MultiThreadable {
 };
 
 
+// The constructor starts num_threads copies of c_in running in the threads of
+// MultiThreadPool, and the destructor waits for them to finish (and then
+// destroys the copies).
 template<class C>
 class MultiThreader {
  public:
   MultiThreader(int32 num_threads,
                 const C &c_in):
-    threads_(new pthread_t[std::max<int32>(1, num_threads)]),
     cvec_(std::max<int32>(1, num_threads), c_in) {
     if (num_threads == 0) {
       // This is a special case with num_threads == 0, which behaves like with
-      // num_threads == 1 but without creating extra threads.  This can be
+      // num_threads == 1 but without using extra threads.  This can be
       // useful in GPU computations where threads cannot be used.
-      KALDI_PTHREAD_PTR(threads_[0]) = 0;
       cvec_[0].thread_id_ = 0;
       cvec_[0].num_threads_ = 1;
       (cvec_[0])();
     } else {
-      pthread_attr_t pthread_attr;
-      pthread_attr_init(&pthread_attr);
+      MultiThreadPool &pool = MultiThreadPool::Instantiate();
       for (int32 thread = 0; thread < num_threads; thread++) {
         cvec_[thread].thread_id_ = thread;
         cvec_[thread].num_threads_ = num_threads;
-        int32 ret;
-        if ((ret=pthread_create(&(threads_[thread]),
-                                &pthread_attr, C::run, &(cvec_[thread])))) {
-          const char *c = strerror(ret);
-          if (c == NULL) { c = "[NULL]"; }
-          KALDI_ERR << "Error creating thread, errno was: " << c;
-        }
+        pool.Run(C::run, &(cvec_[thread]), &group_);
       }
     }
   }
-  ~MultiThreader() {
-    for (size_t thread = 0; thread < cvec_.size(); thread++)
-      if (KALDI_PTHREAD_PTR(threads_[thread]) != 0)
-        if (pthread_join(threads_[thread], NULL))
-          KALDI_ERR << "Error rejoining thread.";
-    delete [] threads_;
-  }
+  ~MultiThreader() { group_.Wait(); }
  private:
-  pthread_t *threads_;
+  ThreadGroup group_;
   std::vector<C> cvec_;
 };
 
@@ -173,6 +224,69 @@ template<class C> void RunMultiThreaded(const C &c_in) {
 }
 
 
+/// RunParallelFor() partitions the range of integers begin ... end-1 into
+/// num_blocks blocks of about equal size (fewer if the range is smaller), and
+/// for each block calls operator () (int32 block_begin, int32 block_end) on
+/// its own copy of c_in, in the threads of MultiThreadPool.  It returns when
+/// all of them have finished and the copies have been destroyed (so, as for
+/// RunMultiThreaded, the destructor may be used to sum up results).
+template<class C>
+class ParallelForRunner {
+ public:
+  ParallelForRunner(int32 begin, int32 end, int32 num_blocks, const C &c_in) {
+    KALDI_ASSERT(end >= begin);
+    num_blocks = std::max<int32>(1, std::min(num_blocks, end - begin));
+    int32 block_size = (end - begin + num_blocks - 1) / num_blocks;
+    if (block_size > 0)  // Don't have any empty blocks.
+      num_blocks = (end - begin + block_size - 1) / block_size;
+    cvec_.assign(num_blocks, c_in);
+    args_.resize(num_blocks);
+    for (int32 b = 0; b < num_blocks; b++) {
+      args_[b].c = &(cvec_[b]);
+      args_[b].begin = begin + b * block_size;
+      args_[b].end = std::min(end, args_[b].begin + block_size);
+    }
+    if (num_blocks == 1) {
+      Run(&(args_[0]));
+    } else {
+      MultiThreadPool &pool = MultiThreadPool::Instantiate();
+      for (int32 b = 0; b < num_blocks; b++)
+        pool.Run(Run, &(args_[b]), &group_);
+    }
+  }
+  ~ParallelForRunner() { group_.Wait(); }
+ private:
+  struct Args {
+    C *c;
+    int32 begin;
+    int32 end;
+  };
+  static void *Run(void *args_in) {
+    Args *args = static_cast<Args*>(args_in);
+    (*(args->c))(args->begin, args->end);
+    return NULL;
+  }
+  ThreadGroup group_;
+  std::vector<C> cvec_;
+  std::vector<Args> args_;
+};
+
+template<class C> void RunParallelFor(int32 begin, int32 end, const C &c_in,
+                                      int32 num_blocks = g_num_threads) {
+  ParallelForRunner<C> runner(begin, end, num_blocks, c_in);
+}
+
+/// Restricts the calling thread to one CPU: the (i % n)'th of the n CPUs the
+/// process may run on (as given by its affinity mask when this is first
+/// called).  Memory pages are placed on the NUMA node of the thread that
+/// first writes to them, so the data a pinned thread initializes stays local
+/// to it.  Returns false if this is not supported on the platform.
+bool PinThreadToCpu(int32 i);
+
+/// Lets the calling thread run on all the CPUs of the process again, after
+/// PinThreadToCpu().
+void UnpinThread();
+
 
 } // namespace kaldi
 #endif  // KALDI_THREAD_KALDI_THREAD_H_
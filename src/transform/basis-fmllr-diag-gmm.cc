@@ -250,7 +250,7 @@ double BasisFmllrEstimate::ComputeTransform(
     const AffineXformStats &spk_stats,
     Matrix<BaseFloat> *out_xform,
     Vector<BaseFloat> *coefficient,
-    BasisFmllrOptions options) {
+    BasisFmllrOptions options) const {
   KALDI_ASSERT(dim_ == spk_stats.dim_);
   if (spk_stats.beta_ < options.min_count) {
     KALDI_WARN << "Not updating fMLLR since count is below min-count: "
@@ -339,6 +339,36 @@ double BasisFmllrEstimate::ComputeTransform(
 }
 
 
+BasisFmllrIncrementalEstimate::BasisFmllrIncrementalEstimate(
+    const BasisFmllrEstimate &basis, const BasisFmllrOptions &opts):
+    basis_(basis), opts_(opts), stats_(basis.dim_) {
+  KALDI_ASSERT(basis.dim_ > 0 && !basis.fmllr_basis_.empty());
+  Reset();
+}
+
+void BasisFmllrIncrementalEstimate::Reset() {
+  stats_.Init(basis_.dim_);
+  xform_.Resize(basis_.dim_, basis_.dim_ + 1);
+  xform_.SetUnit();
+  coefficients_.Resize(0);
+}
+
+double BasisFmllrIncrementalEstimate::Update() {
+  stats_.CommitFrameStats();
+  if (stats_.beta_ < opts_.min_count)
+    return 0.0;  // Don't call ComputeTransform(), which would warn.
+  // ComputeTransform() starts from xform_ and gives the coefficients of the
+  // change from it.
+  Vector<BaseFloat> delta_coefficients;
+  double impr = basis_.ComputeTransform(stats_, &xform_, &delta_coefficients,
+                                        opts_);
+  if (delta_coefficients.Dim() > coefficients_.Dim())
+    coefficients_.Resize(delta_coefficients.Dim(), kCopyData);
+  coefficients_.Range(0, delta_coefficients.Dim()).AddVec(1.0,
+                                                          delta_coefficients);
+  return impr;
+}
+
 double CalBasisFmllrStepSize(const AffineXformStats &spk_stats,
                              const Matrix<double> &delta,
                              const Matrix<double> &A,
@@ -29,6 +29,7 @@
 #include "gmm/mle-full-gmm.h"
 #include "gmm/mle-am-diag-gmm.h"
 #include "transform/transform-common.h"
+#include "transform/fmllr-diag-gmm.h"
 #include "util/kaldi-table.h"
 #include "util/kaldi-holder.h"
 
@@ -137,14 +138,16 @@ class BasisFmllrEstimate {
   /// explicitly. Finally, it returns objective function improvement over
   /// all the iterations.
   /// See section 5.3 of the paper for more details.
+  /// If *out_xform is nonzero on entry, the optimization starts from it, and
+  /// "coefficients" are those of the change from it.
   double ComputeTransform(const AffineXformStats &spk_stats,
                           Matrix<BaseFloat> *out_xform,
                           Vector<BaseFloat> *coefficients,
-                          BasisFmllrOptions options);
+                          BasisFmllrOptions options) const;
 
   /// Basis matrices. Dim is [T] [D] [D+1]
   /// T is the number of bases
-  vector< Matrix<BaseFloat> > fmllr_basis_;
+  std::vector< Matrix<BaseFloat> > fmllr_basis_;
   /// Feature dimension
   int32 dim_;
   /// Number of bases D*(D+1)
@@ -152,6 +155,57 @@ class BasisFmllrEstimate {
 
 };
 
+/** \class BasisFmllrIncrementalEstimate
+ *  Basis fMLLR for online adaptation: it keeps the running fMLLR stats of one
+ *  speaker, and each call to Update() re-estimates the transform from them,
+ *  starting from the previous transform.  Since the stats have a fixed size
+ *  and --num-iters is applied per update, each update has bounded cost;
+ *  because of the warm start, a few iterations per update are normally
+ *  enough.
+ */
+class BasisFmllrIncrementalEstimate {
+ public:
+  /// Keeps a reference to "basis", which must have been read or estimated.
+  BasisFmllrIncrementalEstimate(const BasisFmllrEstimate &basis,
+                                const BasisFmllrOptions &opts);
+
+  /// Accumulates stats for a frame "data" (before the transform), given the
+  /// GMM posteriors for it (which would normally be computed on the
+  /// transformed data).
+  void AccumulateFromPosteriors(const DiagGmm &gmm,
+                                const VectorBase<BaseFloat> &data,
+                                const VectorBase<BaseFloat> &posteriors) {
+    stats_.AccumulateFromPosteriors(gmm, data, posteriors);
+  }
+
+  /// Re-estimates the transform from all the stats so far; returns the
+  /// objective-function improvement of this update.  Does nothing (and returns
+  /// 0) while the count is below --fmllr-min-count.
+  double Update();
+
+  /// The current transform, of dimension dim x (dim + 1); it is [ I ; 0 ]
+  /// until the first successful update.
+  const Matrix<BaseFloat> &Transform() const { return xform_; }
+
+  /// The coefficients of the current transform on the basis, i.e.
+  /// Transform() = [ I ; 0 ] + \sum_n Coefficients()(n) fmllr_basis_[n].
+  const Vector<BaseFloat> &Coefficients() const { return coefficients_; }
+
+  /// The count of the stats so far.
+  double Count() const { return stats_.beta_; }
+
+  /// Starts again with a new speaker.
+  void Reset();
+
+ private:
+  const BasisFmllrEstimate &basis_;
+  BasisFmllrOptions opts_;
+  FmllrDiagGmmAccs stats_;
+  Matrix<BaseFloat> xform_;
+  Vector<BaseFloat> coefficients_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(BasisFmllrIncrementalEstimate);
+};
+
 
 /// This function takes the step direction (delta) of fMLLR matrix as argument,
 /// and optimize step size using Newton's method. This is an iterative method,
@@ -88,103 +88,15 @@ BaseFloat DecodableAmDiagGmmRegtreeFmllr::LogLikelihoodZeroBased(int32 frame,
   return log_sum;
 }
 
-DecodableAmDiagGmmRegtreeMllr::~DecodableAmDiagGmmRegtreeMllr() {
-  DeletePointers(&xformed_mean_invvars_);
-  DeletePointers(&xformed_gconsts_);
-}
-
-
-void DecodableAmDiagGmmRegtreeMllr::InitCache() {
-  if (xformed_mean_invvars_.size() != 0)
-    DeletePointers(&xformed_mean_invvars_);
-  if (xformed_gconsts_.size() != 0)
-    DeletePointers(&xformed_gconsts_);
-  int32 num_pdfs = acoustic_model_.NumPdfs();
-  xformed_mean_invvars_.resize(num_pdfs);
-  xformed_gconsts_.resize(num_pdfs);
-  is_cached_.resize(num_pdfs, false);
-  ResetLogLikeCache();
-}
-
-
-// This is almost the same code as DiagGmm::ComputeGconsts, except that
-// means are used instead of means * inv(vars). This saves some computation.
-static void ComputeGconsts(const VectorBase<BaseFloat> &weights,
-                           const MatrixBase<BaseFloat> &means,
-                           const MatrixBase<BaseFloat> &inv_vars,
-                           VectorBase<BaseFloat> *gconsts_out) {
-  int32 num_gauss = weights.Dim();
-  int32 dim = means.NumCols();
-  KALDI_ASSERT(means.NumRows() == num_gauss
-      && inv_vars.NumRows() == num_gauss && inv_vars.NumCols() == dim);
-  KALDI_ASSERT(gconsts_out->Dim() == num_gauss);
-
-  BaseFloat offset = -0.5 * M_LOG_2PI * dim;  // constant term in gconst.
-  int32 num_bad = 0;
-
-  for (int32 gauss = 0; gauss < num_gauss; gauss++) {
-    KALDI_ASSERT(weights(gauss) >= 0);  // Cannot have negative weights.
-    BaseFloat gc = log(weights(gauss)) + offset;  // May be -inf if weights == 0
-    for (int32 d = 0; d < dim; d++) {
-      gc += 0.5 * log(inv_vars(gauss, d)) - 0.5 * means(gauss, d)
-        * means(gauss, d) * inv_vars(gauss, d);  // diff from DiagGmm version.
-    }
-
-    if (KALDI_ISNAN(gc)) {  // negative infinity is OK but NaN is not acceptable
-      KALDI_ERR << "At component "  << gauss
-                << ", not a number in gconst computation";
-    }
-    if (KALDI_ISINF(gc)) {
-      num_bad++;
-      // If positive infinity, make it negative infinity.
-      // Want to make sure the answer becomes -inf in the end, not NaN.
-      if (gc > 0) gc = -gc;
-    }
-    (*gconsts_out)(gauss) = gc;
-  }
-  if (num_bad > 0)
-    KALDI_WARN << num_bad << " unusable components found while computing "
-               << "gconsts.";
-}
-
-
-const Matrix<BaseFloat>& DecodableAmDiagGmmRegtreeMllr::GetXformedMeanInvVars(
-    int32 state) {
-  if (is_cached_[state]) {  // found in cache
-    KALDI_ASSERT(xformed_mean_invvars_[state] != NULL);
-    KALDI_VLOG(3) << "For PDF index " << state << ": transformed means "
-                  << "found in cache.";
-    return *xformed_mean_invvars_[state];
-  } else {  // transform the means and cache them
-    KALDI_ASSERT(xformed_mean_invvars_[state] == NULL);
-    KALDI_VLOG(3) << "For PDF index " << state << ": transforming means.";
-    int32 num_gauss = acoustic_model_.GetPdf(state).NumGauss(),
-        dim = acoustic_model_.Dim();
-    const Vector<BaseFloat> &weights = acoustic_model_.GetPdf(state).weights();
-    const Matrix<BaseFloat> &invvars = acoustic_model_.GetPdf(state).inv_vars();
-    xformed_mean_invvars_[state] = new Matrix<BaseFloat>(num_gauss, dim);
-    mllr_xform_.GetTransformedMeans(regtree_, acoustic_model_, state,
-                                    xformed_mean_invvars_[state]);
-    xformed_gconsts_[state] = new Vector<BaseFloat>(num_gauss);
-    // At this point, the transformed means haven't been multiplied with
-    // the inv vars, and they are used to compute gconsts first.
-    ComputeGconsts(weights, *xformed_mean_invvars_[state], invvars,
-                   xformed_gconsts_[state]);
-    // Finally, multiply the transformed means with the inv vars.
-    xformed_mean_invvars_[state]->MulElements(invvars);
-    is_cached_[state] = true;
-    return *xformed_mean_invvars_[state];
-  }
-}
-
-const Vector<BaseFloat>& DecodableAmDiagGmmRegtreeMllr::GetXformedGconsts(
-    int32 state) {
-  if (!is_cached_[state]) {
-    KALDI_ERR << "GConsts not cached for state: " << state << ". Must call "
-              << "GetXformedMeanInvVars() first.";
-  }
-  KALDI_ASSERT(xformed_gconsts_[state] != NULL);
-  return *xformed_gconsts_[state];
+void DecodableAmDiagGmmRegtreeFmllr::LogLikelihoods(
+    int32 frame, const std::vector<int32> &tids,
+    std::vector<BaseFloat> *log_likes) {
+  pdf_ids_.resize(tids.size());
+  for (size_t i = 0; i < tids.size(); i++)
+    pdf_ids_[i] = trans_model_.TransitionIdToPdfFast(tids[i]);
+  LogLikelihoodsZeroBased(frame, pdf_ids_, log_likes);
+  for (size_t i = 0; i < log_likes->size(); i++)
+    (*log_likes)[i] *= scale_;
 }
 
 BaseFloat DecodableAmDiagGmmRegtreeMllr::LogLikelihoodZeroBased(int32 frame,
@@ -212,8 +124,9 @@ BaseFloat DecodableAmDiagGmmRegtreeMllr::LogLikelihoodZeroBased(int32 frame,
     previous_frame_ = frame;
   }
 
-  const Matrix<BaseFloat> &means_invvars = GetXformedMeanInvVars(state);
-  const Vector<BaseFloat> &gconsts = GetXformedGconsts(state);
+  const Matrix<BaseFloat> &means_invvars =
+      means_cache_->GetXformedMeanInvVars(state);
+  const Vector<BaseFloat> &gconsts = means_cache_->GetXformedGconsts(state);
 
   Vector<BaseFloat> loglikes(gconsts);  // need to recreate for each pdf
   // loglikes +=  means * inv(vars) * data.
@@ -231,4 +144,15 @@ BaseFloat DecodableAmDiagGmmRegtreeMllr::LogLikelihoodZeroBased(int32 frame,
   return log_sum;
 }
 
+void DecodableAmDiagGmmRegtreeMllr::LogLikelihoods(
+    int32 frame, const std::vector<int32> &tids,
+    std::vector<BaseFloat> *log_likes) {
+  pdf_ids_.resize(tids.size());
+  for (size_t i = 0; i < tids.size(); i++)
+    pdf_ids_[i] = trans_model_.TransitionIdToPdfFast(tids[i]);
+  LogLikelihoodsZeroBased(frame, pdf_ids_, log_likes);
+  for (size_t i = 0; i < log_likes->size(); i++)
+    (*log_likes)[i] *= scale_;
+}
+
 }  // namespace kaldi
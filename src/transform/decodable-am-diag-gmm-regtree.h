@@ -54,6 +54,9 @@ class DecodableAmDiagGmmRegtreeFmllr: public DecodableAmDiagGmmUnmapped {
                                          trans_model_.TransitionIdToPdf(tid));
   }
 
+  virtual void LogLikelihoods(int32 frame, const std::vector<int32> &tids,
+                              std::vector<BaseFloat> *log_likes);
+
   virtual int32 NumFrames() { return feature_matrix_.NumRows(); }
 
   // Indices are one-based!  This is for compatibility with OpenFst.
@@ -87,9 +90,30 @@ class DecodableAmDiagGmmRegtreeMllr: public DecodableAmDiagGmmUnmapped {
                                 BaseFloat scale,
                                 BaseFloat log_sum_exp_prune = -1.0):
       DecodableAmDiagGmmUnmapped(am, feats, log_sum_exp_prune),
-      trans_model_(tm), scale_(scale), mllr_xform_(mllr_xform),
-      regtree_(regtree), data_squared_(feats.NumCols()) { InitCache(); }
-  ~DecodableAmDiagGmmRegtreeMllr();
+      trans_model_(tm), scale_(scale),
+      means_cache_(new RegtreeMllrMeansCache(am, regtree)),
+      owns_means_cache_(true), data_squared_(feats.NumCols()) {
+    means_cache_->SetTransform(mllr_xform);
+  }
+
+  /// This constructor uses the transformed means in "means_cache", to which
+  /// the transform must already have been given with SetTransform().  The
+  /// means computed while decoding stay in "means_cache", for reuse by the
+  /// decodables of later utterances.  "means_cache" is not owned by this
+  /// object.
+  DecodableAmDiagGmmRegtreeMllr(const AmDiagGmm &am,
+                                const TransitionModel &tm,
+                                const Matrix<BaseFloat> &feats,
+                                RegtreeMllrMeansCache *means_cache,
+                                BaseFloat scale,
+                                BaseFloat log_sum_exp_prune = -1.0):
+      DecodableAmDiagGmmUnmapped(am, feats, log_sum_exp_prune),
+      trans_model_(tm), scale_(scale), means_cache_(means_cache),
+      owns_means_cache_(false), data_squared_(feats.NumCols()) { }
+
+  ~DecodableAmDiagGmmRegtreeMllr() {
+    if (owns_means_cache_) delete means_cache_;
+  }
 
   // Note, frames are numbered from zero but transition-ids (tid) from one.
   virtual BaseFloat LogLikelihood(int32 frame, int32 tid) {
@@ -97,6 +121,9 @@ class DecodableAmDiagGmmRegtreeMllr: public DecodableAmDiagGmmUnmapped {
                                          trans_model_.TransitionIdToPdf(tid));
   }
 
+  virtual void LogLikelihoods(int32 frame, const std::vector<int32> &tids,
+                              std::vector<BaseFloat> *log_likes);
+
   virtual int32 NumFrames() { return feature_matrix_.NumRows(); }
 
   // Indices are one-based!  This is for compatibility with OpenFst.
@@ -108,28 +135,13 @@ class DecodableAmDiagGmmRegtreeMllr: public DecodableAmDiagGmmUnmapped {
   virtual BaseFloat LogLikelihoodZeroBased(int32 frame, int32 state_index);
 
  private:
-  /// Initializes the mean & gconst caches
-  void InitCache();
-  /// Get the transformed means times inverse variances for a given pdf, and
-  /// cache them. The 'state_index' is 0-based.
-  const Matrix<BaseFloat>& GetXformedMeanInvVars(int32 state_index);
-  /// Get the cached (while computing transformed means) gconsts for
-  /// likelihood calculation. The 'state_index' is 0-based.
-  const Vector<BaseFloat>& GetXformedGconsts(int32 state_index);
-
   const TransitionModel &trans_model_;  // for transition-id to pdf mapping
   BaseFloat scale_;
-  const RegtreeMllrDiagGmm &mllr_xform_;
-  const RegressionTree &regtree_;
-  // we want it public to have access to the pdf ids
-
-  /// Cache of transformed means time inverse variances for each state.
-  std::vector< Matrix<BaseFloat>* > xformed_mean_invvars_;
-  /// Cache of transformed gconsts for each state.
-  std::vector< Vector<BaseFloat>* > xformed_gconsts_;
-  /// Boolean variable per state to indicate whether the transformed means for
-  /// that state are cached.
-  std::vector<bool> is_cached_;
+
+  /// Cache of transformed means times inverse variances, and gconsts, for
+  /// each state.
+  RegtreeMllrMeansCache *means_cache_;
+  bool owns_means_cache_;
 
   Vector<BaseFloat> data_squared_;  ///< Cached for fast likelihood calculation
 
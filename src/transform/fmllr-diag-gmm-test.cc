@@ -222,6 +222,36 @@ void UnitTestFmllrDiagGmmOffset() {
   // mean that something is wrong.
 }
 
+// Checks that the buffered accumulation of the G_ stats gives the same
+// answer as adding the outer product of each frame directly.
+void UnitTestFmllrDiagGmmFrameBuffer() {
+  DiagGmm gmm;
+  InitRandomGmm(&gmm);
+  int32 dim = gmm.Dim(), npoints = 1 + rand() % 200;
+  FmllrDiagGmmAccs stats(dim);
+  std::vector<SpMatrix<double> > G(dim);
+  for (int32 d = 0; d < dim; d++) G[d].Resize(dim + 1);
+  for (int32 i = 0; i < npoints; i++) {
+    Vector<BaseFloat> x(dim);
+    gmm.Generate(&x);
+    BaseFloat weight = 0.5 + RandUniform();
+    stats.AccumulateForGmm(gmm, x, weight);
+    Vector<BaseFloat> post(gmm.NumGauss());
+    gmm.ComponentPosteriors(x, &post);
+    post.Scale(weight);
+    Vector<BaseFloat> b(dim);
+    b.AddMatVec(1.0, gmm.inv_vars(), kTrans, post, 0.0);
+    Vector<double> xplus(dim + 1);
+    xplus.Range(0, dim).CopyFromVec(x);
+    xplus(dim) = 1.0;
+    for (int32 d = 0; d < dim; d++)
+      G[d].AddVec2(static_cast<double>(b(d)), xplus);
+  }
+  stats.CommitFrameStats();
+  for (int32 d = 0; d < dim; d++)
+    KALDI_ASSERT(G[d].ApproxEqual(stats.G_[d], 1.0e-04));
+}
+
 }  // namespace kaldi ends here
 
 int main() {
@@ -229,6 +259,7 @@ int main() {
     kaldi::UnitTestFmllrDiagGmmOffset();
     kaldi::UnitTestFmllrDiagGmmDiagonal();
     kaldi::UnitTestFmllrDiagGmm();
+    kaldi::UnitTestFmllrDiagGmmFrameBuffer();
   }
   std::cout << "Test OK.\n";
 }
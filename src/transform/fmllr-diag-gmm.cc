@@ -27,6 +27,9 @@ using std::vector;
 
 namespace kaldi {
 
+// Number of frames FmllrDiagGmmAccs buffers before adding them to G_.
+static const int32 kFmllrFrameBufferSize = 64;
+
 void FmllrDiagGmmAccs:: AccumulateFromPosteriors(
     const DiagGmm &pdf,
     const VectorBase<BaseFloat> &data,
@@ -66,7 +69,7 @@ void FmllrDiagGmmAccs:: AccumulateFromPosteriorsPreselect(
 
 FmllrDiagGmmAccs::FmllrDiagGmmAccs(const DiagGmm &gmm,
                                    const AccumFullGmm &fgmm_accs):
-    single_frame_stats_(gmm.Dim()), opts_(FmllrOptions()) {
+    single_frame_stats_(gmm.Dim()), num_pending_(0), opts_(FmllrOptions()) {
   KALDI_ASSERT(gmm.NumGauss() == fgmm_accs.NumGauss()
                && gmm.Dim() == fgmm_accs.Dim());
   Init(gmm.Dim());
@@ -133,7 +136,7 @@ void FmllrDiagGmmAccs::Update(const FmllrOptions &opts,
                               BaseFloat *objf_impr,
                               BaseFloat *count) {
   KALDI_ASSERT(fmllr_mat != NULL);
-  CommitSingleFrameStats();
+  CommitFrameStats();
   if (fmllr_mat->IsZero())
     KALDI_ERR << "You must initialize the fMLLR matrix to a non-singular value "
         "(so we can report objective function changes); e.g. call SetUnit()";
@@ -574,12 +577,15 @@ void FmllrDiagGmmAccs::CommitSingleFrameStats() {
 
 
   if (opts_.update_type == "full") {
-    SpMatrix<double> scatter(dim+1);
-    scatter.AddVec2(1.0, xplus);
-    
-    KALDI_ASSERT(static_cast<size_t>(dim) == this->G_.size());
-    for (int32 i = 0; i < dim; i++)
-      this->G_[i].AddSp(stats.b(i), scatter);
+    // Buffer the frame; see CommitPendingFrames().
+    if (pending_xplus_.NumRows() == 0) {
+      pending_xplus_.Resize(kFmllrFrameBufferSize, dim + 1);
+      pending_b_.Resize(kFmllrFrameBufferSize, dim);
+    }
+    pending_xplus_.Row(num_pending_).CopyFromVec(xplus);
+    pending_b_.Row(num_pending_).CopyFromVec(stats.b);
+    if (++num_pending_ == kFmllrFrameBufferSize)
+      CommitPendingFrames();
   } else {
     // We only need some elements of these stats, so just update those elements.
     for (int32 i = 0; i < dim; i++) {
@@ -594,6 +600,32 @@ void FmllrDiagGmmAccs::CommitSingleFrameStats() {
   stats.a.SetZero();
   stats.b.SetZero();
 }
+
+void FmllrDiagGmmAccs::CommitPendingFrames() {
+  if (num_pending_ == 0) return;
+  int32 dim = Dim();
+  KALDI_ASSERT(static_cast<size_t>(dim) == this->G_.size());
+  // G_i += \sum_t b_t(i) xplus_t xplus_t^T, i.e. X^T diag(b(i)) X where the
+  // rows of X are the buffered xplus_t.  Only the lower triangle is needed.
+  SubMatrix<double> xplus(pending_xplus_, 0, num_pending_, 0, dim + 1);
+  Matrix<double> scaled_xplus(num_pending_, dim + 1), scatter(dim + 1, dim + 1);
+  Vector<double> b(num_pending_);
+  SpMatrix<double> scatter_sp(dim + 1);
+  for (int32 i = 0; i < dim; i++) {
+    b.CopyColFromMat(pending_b_.RowRange(0, num_pending_), i);
+    scaled_xplus.CopyFromMat(xplus);
+    scaled_xplus.MulRowsVec(b);
+    scatter.AddMatMat(1.0, scaled_xplus, kTrans, xplus, kNoTrans, 0.0);
+    scatter_sp.CopyFromMat(scatter, kTakeLower);
+    this->G_[i].AddSp(1.0, scatter_sp);
+  }
+  num_pending_ = 0;
+}
+
+void FmllrDiagGmmAccs::CommitFrameStats() {
+  CommitSingleFrameStats();
+  CommitPendingFrames();
+}
     
 
 
@@ -64,12 +64,13 @@ class FmllrDiagGmmAccs: public AffineXformStats {
   // stats that are accumulated, to the parts we'll need in the
   // update.
   FmllrDiagGmmAccs(const FmllrOptions &opts = FmllrOptions()):
-      opts_(opts) { }
+      num_pending_(0), opts_(opts) { }
   explicit FmllrDiagGmmAccs(const FmllrDiagGmmAccs &other):
       AffineXformStats(other), single_frame_stats_(other.single_frame_stats_),
-      opts_(other.opts_) {}
+      pending_xplus_(other.pending_xplus_), pending_b_(other.pending_b_),
+      num_pending_(other.num_pending_), opts_(other.opts_) {}
   explicit FmllrDiagGmmAccs(int32 dim, const FmllrOptions &opts = FmllrOptions()):
-      opts_(opts) { Init(dim); }
+      num_pending_(0), opts_(opts) { Init(dim); }
   
   // The following initializer gives us an efficient way to
   // compute these stats from full-cov Gaussian statistics
@@ -80,6 +81,7 @@ class FmllrDiagGmmAccs: public AffineXformStats {
   
   void Init(size_t dim) {
     AffineXformStats::Init(dim, dim); single_frame_stats_.Init(dim);
+    num_pending_ = 0;
   }
 
   /// Accumulate stats for a single GMM in the model; returns log likelihood.
@@ -114,6 +116,12 @@ class FmllrDiagGmmAccs: public AffineXformStats {
               BaseFloat *objf_impr,
               BaseFloat *count);
 
+  /// Adds all the frames accumulated so far to the stats beta_, K_ and G_;
+  /// some of them are buffered, so that G_ can be updated for many frames at
+  /// once.  Update() calls this; you have to call it yourself if you use the
+  /// stats in any other way.
+  void CommitFrameStats();
+
   // Note: we allow copy and assignment for this class.
 
  private:
@@ -141,7 +149,18 @@ class FmllrDiagGmmAccs: public AffineXformStats {
   // data in single_frame_stats_, returns true if it's different.
 
   SingleFrameStats single_frame_stats_;
-  
+
+  // Adds the frames in pending_xplus_ and pending_b_ to G_.
+  void CommitPendingFrames();
+
+  // For "full" updates, the committed frames are buffered here (in the first
+  // num_pending_ rows) and added to G_ by CommitPendingFrames(), which does
+  // one matrix multiplication per row of G_ for all of them instead of an
+  // outer product per frame.
+  Matrix<double> pending_xplus_;  // feature vectors with 1 appended.
+  Matrix<double> pending_b_;  // the "b" vectors of SingleFrameStats.
+  int32 num_pending_;
+
   // We only use the opts_ variable for its "update_type" data member,
   // which limits what parts of the G matrix we accumulate.
   FmllrOptions opts_;
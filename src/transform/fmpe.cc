@@ -168,35 +168,13 @@ void Fmpe::ApplyC(MatrixBase<BaseFloat> *feat_out, bool reverse) const {
   }
 }
 
-// Constructs the high-dim features and applies the main projection matrix
-// projT_.  This projects from dimension ngauss*(dim+1) to dim*ncontexts.  Note:
-// because the input vector of size ngauss*(dim+1) is sparse in a blocky way
-// (i.e. each frame only has a couple of nonzero posteriors), we deal with
-// sub-matrices of the projection matrix projT_.  We actually further optimize
-// the code by taking all frames in a file that had nonzero posteriors for a
-// particular Gaussian, and forming a matrix out of the corresponding
-// high-dimensional features; we can then use a matrix-matrix multiply rather
-// than using vector-matrix operations.
-
-void Fmpe::ApplyProjection(const MatrixBase<BaseFloat> &feat_in,
-                           const std::vector<std::vector<int32> > &gselect,
-                           MatrixBase<BaseFloat> *intermed_feat) const {
-  int32 dim = FeatDim(), ncontexts = NumContexts();  
-  
+void Fmpe::ComputePosteriors(
+    const MatrixBase<BaseFloat> &feat_in,
+    const std::vector<std::vector<int32> > &gselect,
+    std::vector<std::pair<std::pair<int32, int32>, BaseFloat> > *all_posts)
+    const {
   Vector<BaseFloat> post; // will be posteriors of selected Gaussians.
-  Vector<BaseFloat> input_chunk(dim+1); // will be a segment of
-  // the high-dimensional features.
-
-  // "all_posts" is a vector of ((gauss-index, time-index), gaussian
-  // posterior).
-  // We'll compute the posterior information, sort it, and then
-  // go through it in sorted order, which maintains memory locality
-  // when accessing the projection matrix.
-  // Note: if we really cared we could make this use level-3 BLAS
-  // (matrix-matrix multiply), but we'd need to have a temporary
-  // matrix for the output and input.
-  std::vector<std::pair<std::pair<int32, int32>, BaseFloat> > all_posts;
-  
+  all_posts->clear();
   for (int32 t = 0; t < feat_in.NumRows(); t++) {
     SubVector<BaseFloat> this_feat(feat_in, t);
     gmm_.LogLikelihoodsPreselect(this_feat, gselect[t], &post);
@@ -205,93 +183,94 @@ void Fmpe::ApplyProjection(const MatrixBase<BaseFloat> &feat_in,
     post.ApplySoftMax(); // Now they are posteriors (which sum to one).
     for (int32 i = 0; i < post.Dim(); i++) {
       int32 gauss = gselect[t][i];
-      all_posts.push_back(std::make_pair(std::make_pair(gauss, t), post(i)));
+      all_posts->push_back(std::make_pair(std::make_pair(gauss, t), post(i)));
     }
   }
-  std::sort(all_posts.begin(), all_posts.end());
-  
-  bool optimize = true;
-
-  if (!optimize) { // Why do we keep this un-optimized code around?
-    // For clarity, so you can see what's going on, and for easier
-    // comparision with ApplyProjectionReverse which is similar to this
-    // un-optimized segment.  Both un-optimized and optimized versions
-    // should give identical transforms (up to tiny roundoff differences).
-    for (size_t i = 0; i < all_posts.size(); i++) {
-      int32 gauss = all_posts[i].first.first, t = all_posts[i].first.second;
-      SubVector<BaseFloat> this_feat(feat_in, t);
+  std::sort(all_posts->begin(), all_posts->end());
+}
+
+void Fmpe::ComputeInputChunks(
+    const MatrixBase<BaseFloat> &feat_in,
+    const std::pair<std::pair<int32, int32>, BaseFloat> *posts,
+    MatrixBase<BaseFloat> *input_chunks) const {
+  int32 dim = FeatDim(), gauss = posts[0].first.first;
+  SubVector<BaseFloat> this_stddev(stddevs_, gauss),
+      this_mean_invvar(gmm_.means_invvars(), gauss);
+  for (int32 j = 0; j < input_chunks->NumRows(); j++) {
+    int32 t = posts[j].first.second;
+    SubVector<BaseFloat> this_feat(feat_in, t);
+    SubVector<BaseFloat> this_input_chunk(*input_chunks, j);
+    BaseFloat this_post = posts[j].second;
+    // The next line is equivalent to setting the chunk to
+    // -this_post * the gaussian mean / (gaussian stddev).  Note: we use
+    // the fact that mean * inv_var *  stddev == mean / stddev.
+    this_input_chunk.Range(0, dim).AddVecVec(-this_post, this_mean_invvar,
+                                             this_stddev, 0.0);
+    // The next line is equivalent to adding this_post * (feat / gaussian
+    // stddev), so now it contains this_post * (feat - mean) / stddev, which
+    // is our "normalized" feature offset.
+    this_input_chunk.Range(0, dim).AddVecDivVec(this_post, this_feat,
+                                                this_stddev, 1.0);
+    // The last element of the chunk is the posterior itself (between 0 and
+    // 1).
+    this_input_chunk(dim) = this_post * config_.post_scale;
+  }
+}
+
+// Constructs the high-dim features and applies the main projection matrix
+// projT_.  This projects from dimension ngauss*(dim+1) to dim*ncontexts.  Note:
+// because the input vector of size ngauss*(dim+1) is sparse in a blocky way
+// (i.e. each frame only has a couple of nonzero posteriors), we deal with
+// sub-matrices of the projection matrix projT_.  We take all frames in a file
+// that had nonzero posteriors for a particular Gaussian, and form a matrix out
+// of the corresponding high-dimensional features; we can then use a
+// matrix-matrix multiply rather than using vector-matrix operations.
+// In effect this is a sparse-matrix times dense-matrix product, with the
+// sparse matrix (the high-dim features) stored by Gaussian.
+
+void Fmpe::ApplyProjection(const MatrixBase<BaseFloat> &feat_in,
+                           const std::vector<std::vector<int32> > &gselect,
+                           MatrixBase<BaseFloat> *intermed_feat) const {
+  int32 dim = FeatDim(), ncontexts = NumContexts();
+
+  // "all_posts" is a vector of ((gauss-index, time-index), gaussian
+  // posterior), sorted; going through it in sorted order maintains memory
+  // locality when accessing the projection matrix.
+  std::vector<std::pair<std::pair<int32, int32>, BaseFloat> > all_posts;
+  ComputePosteriors(feat_in, gselect, &all_posts);
+
+  size_t i = 0;
+  // We process the "posts" vector in chunks, where each chunk corresponds to
+  // the same Gaussian index (but different times).
+  while (i < all_posts.size()) {
+    int32 gauss = all_posts[i].first.first;
+    SubMatrix<BaseFloat> this_projT_chunk(projT_, gauss*(dim+1), dim+1,
+                                          0, dim*ncontexts);
+    int32 batch_size; // number of posteriors with same Gaussian..
+    for (batch_size = 0;
+         batch_size+i < static_cast<int32>(all_posts.size()) &&
+             all_posts[batch_size+i].first.first == gauss;
+         batch_size++); // empty loop body.
+    Matrix<BaseFloat> input_chunks(batch_size, dim+1, kUndefined);
+    Matrix<BaseFloat> intermed_temp(batch_size, dim*ncontexts, kUndefined);
+    ComputeInputChunks(feat_in, &(all_posts[i]), &input_chunks);
+    // The next line is where most of the computation will happen,
+    // during the feature computation phase.  We have rearranged
+    // stuff so it's a matrix-matrix operation, for greater
+    // efficiency (when using optimized libraries like ATLAS).
+    intermed_temp.AddMatMat(1.0, input_chunks, kNoTrans,
+                            this_projT_chunk, kNoTrans, 0.0);
+    for (int32 j = 0; j < batch_size; j++) { // add data from
+      // intermed_temp to the output "intermed_feat"
+      int32 t = all_posts[i+j].first.second;
       SubVector<BaseFloat> this_intermed_feat(*intermed_feat, t);
-      BaseFloat this_post = all_posts[i].second;
-      SubVector<BaseFloat> this_stddev(stddevs_, gauss);
-
-      // The next line is equivalent to setting input_chunk to
-      // -this_post * the gaussian mean / (gaussian stddev).  Note: we use
-      // the fact that mean * inv_var *  stddev == mean / stddev.
-      input_chunk.Range(0, dim).AddVecVec(-this_post, gmm_.means_invvars().Row(gauss),
-                                          this_stddev, 0.0);
-      // The next line is equivalent to adding (feat / gaussian stddev) to
-      // input_chunk, so now it contains (feat - mean) / stddev, which is
-      // our "normalized" feature offset.
-      input_chunk.Range(0, dim).AddVecDivVec(this_post, this_feat, this_stddev,
-                                             1.0);
-      // The last element of this input_chunk is the posterior itself
-      // (between 0 and 1).
-      input_chunk(dim) = this_post * config_.post_scale;
-
-      // this_intermed_feat += [appropriate chjunk of projT_] * input_chunk.
-      this_intermed_feat.AddMatVec(1.0, projT_.Range(gauss*(dim+1), dim+1,
-                                                     0, dim*ncontexts),
-                                   kTrans, input_chunk, 1.0);
-    }
-  } else {
-    size_t i = 0;
-    // We process the "posts" vector in chunks, where each chunk corresponds to
-    // the same Gaussian index (but different times).
-    while (i < all_posts.size()) {
-      int32 gauss = all_posts[i].first.first;
-      SubVector<BaseFloat> this_stddev(stddevs_, gauss),
-          this_mean_invvar(gmm_.means_invvars(), gauss);
-      SubMatrix<BaseFloat> this_projT_chunk(projT_, gauss*(dim+1), dim+1,
-                                            0, dim*ncontexts);
-      int32 batch_size; // number of posteriors with same Gaussian..
-      for (batch_size = 0;
-           batch_size+i < static_cast<int32>(all_posts.size()) &&
-               all_posts[batch_size+i].first.first == gauss;
-           batch_size++); // empty loop body.
-      Matrix<BaseFloat> input_chunks(batch_size, dim+1);
-      Matrix<BaseFloat> intermed_temp(batch_size, dim*ncontexts);
-      for (int32 j = 0; j < batch_size; j++) { // set up "input_chunks".
-        // To understand this code, first examine code and comments in "non-optimized"
-        // code chunk above (the other branch of the if/else statement).
-        int32 t = all_posts[i+j].first.second;
-        SubVector<BaseFloat> this_feat(feat_in, t);
-        SubVector<BaseFloat> this_input_chunk(input_chunks, j);
-        BaseFloat this_post = all_posts[i+j].second;
-        this_input_chunk.Range(0, dim).AddVecVec(-this_post,
-                                                 this_mean_invvar,
-                                                 this_stddev, 0.0);
-        this_input_chunk.Range(0, dim).AddVecDivVec(this_post, this_feat,
-                                                    this_stddev, 1.0);
-        this_input_chunk(dim) = this_post * config_.post_scale;
-      }
-      // The next line is where most of the computation will happen,
-      // during the feature computation phase.  We have rearranged
-      // stuff so it's a matrix-matrix operation, for greater
-      // efficiency (when using optimized libraries like ATLAS).
-      intermed_temp.AddMatMat(1.0, input_chunks, kNoTrans,
-                              this_projT_chunk, kNoTrans, 0.0);
-      for (int32 j = 0; j < batch_size; j++) { // add data from
-        // intermed_temp to the output "intermed_feat"
-        int32 t = all_posts[i+j].first.second;
-        SubVector<BaseFloat> this_intermed_feat(*intermed_feat, t);
-        SubVector<BaseFloat> this_intermed_temp(intermed_temp, j);
-        // this_intermed_feat += this_intermed_temp.
-        this_intermed_feat.AddVec(1.0, this_intermed_temp);
-      }
-      i += batch_size;
+      SubVector<BaseFloat> this_intermed_temp(intermed_temp, j);
+      // this_intermed_feat += this_intermed_temp.
+      this_intermed_feat.AddVec(1.0, this_intermed_temp);
     }
+    i += batch_size;
   }
-}      
+}
 
 
 
@@ -303,68 +282,61 @@ void Fmpe::ApplyProjectionReverse(const MatrixBase<BaseFloat> &feat_in,
                                   const MatrixBase<BaseFloat> &intermed_feat_deriv,
                                   MatrixBase<BaseFloat> *proj_deriv_plus,
                                   MatrixBase<BaseFloat> *proj_deriv_minus) const {
-  int32 dim = FeatDim(), ncontexts = NumContexts();  
-  
-  Vector<BaseFloat> post; // will be posteriors of selected Gaussians.
-  Vector<BaseFloat> input_chunk(dim+1); // will be a segment of
-  // the high-dimensional features.
+  int32 dim = FeatDim(), ncontexts = NumContexts();
 
-  // "all_posts" is a vector of ((gauss-index, time-index), gaussian
-  // posterior).
-  // We'll compute the posterior information, sort it, and then
-  // go through it in sorted order, which maintains memory locality
-  // when accessing the projection matrix.
   std::vector<std::pair<std::pair<int32, int32>, BaseFloat> > all_posts;
-  
-  for (int32 t = 0; t < feat_in.NumRows(); t++) {
-    SubVector<BaseFloat> this_feat(feat_in, t);
-    gmm_.LogLikelihoodsPreselect(this_feat, gselect[t], &post);
-    // At this point, post will contain log-likes of the selected
-    // Gaussians.
-    post.ApplySoftMax(); // Now they are posteriors (which sum to one).
-    for (int32 i = 0; i < post.Dim(); i++) {
-      // The next few lines (where we set up "input_chunk") are identical
-      // to ApplyProjection.
-      int32 gauss = gselect[t][i];
-      all_posts.push_back(std::make_pair(std::make_pair(gauss, t), post(i)));
+  ComputePosteriors(feat_in, gselect, &all_posts);
+
+  // If not for accumulating the + and - parts separately, for each
+  // posterior we would be doing something like:
+  // proj_deriv_.Range(0, dim*ncontexts, gauss*(dim+1), dim+1).AddVecVec(
+  //                    1.0, this_intermed_feat_deriv, input_chunk);
+  // To get the positive and negative parts of each of these rank-one
+  // matrices x y^T, note that if x = x+ - x- and y = y+ - y-, where x+, x-,
+  // y+ and y- are nonnegative and do not both have nonzeros in the same
+  // place, the positive part is x+ y+^T + x- y-^T and (minus) the negative
+  // part is x+ y-^T + x- y+^T.  Then, as in ApplyProjection, we process all
+  // the posteriors for the same Gaussian together, using matrix-matrix
+  // multiplies.
+  size_t i = 0;
+  while (i < all_posts.size()) {
+    int32 gauss = all_posts[i].first.first;
+    int32 batch_size; // number of posteriors with same Gaussian..
+    for (batch_size = 0;
+         batch_size+i < static_cast<int32>(all_posts.size()) &&
+             all_posts[batch_size+i].first.first == gauss;
+         batch_size++); // empty loop body.
+    Matrix<BaseFloat> input_plus(batch_size, dim+1, kUndefined),
+        input_minus(batch_size, dim+1, kUndefined),
+        deriv_plus(batch_size, dim*ncontexts, kUndefined),
+        deriv_minus(batch_size, dim*ncontexts, kUndefined);
+    ComputeInputChunks(feat_in, &(all_posts[i]), &input_plus);
+    input_minus.CopyFromMat(input_plus);
+    input_minus.Scale(-1.0);
+    input_plus.ApplyFloor(0.0);
+    input_minus.ApplyFloor(0.0);
+    for (int32 j = 0; j < batch_size; j++) {
+      int32 t = all_posts[i+j].first.second;
+      deriv_plus.Row(j).CopyFromVec(intermed_feat_deriv.Row(t));
     }
-  }
-  std::sort(all_posts.begin(), all_posts.end());
-  for (size_t i = 0; i < all_posts.size(); i++) {
-    int32 gauss = all_posts[i].first.first, t = all_posts[i].first.second;
-    BaseFloat this_post = all_posts[i].second;
-    SubVector<BaseFloat> this_feat(feat_in, t);    
-    SubVector<BaseFloat> this_intermed_feat_deriv(intermed_feat_deriv, t);
-    SubVector<BaseFloat> this_stddev(stddevs_, gauss);
-    input_chunk.Range(0, dim).AddVecVec(-this_post, gmm_.means_invvars().Row(gauss),
-                                        this_stddev, 0.0);
-    input_chunk.Range(0, dim).AddVecDivVec(this_post, this_feat, this_stddev,
-                                           1.0);
-    input_chunk(dim) = this_post * config_.post_scale;
-
-    // If not for accumulating the + and - parts separately, we would be
-    // doing something like:
-    // proj_deriv_.Range(0, dim*ncontexts, gauss*(dim+1), dim+1).AddVecVec(
-    //                    1.0, this_intermed_feat_deriv, input_chunk);
-
-
-    SubMatrix<BaseFloat> plus_chunk(*proj_deriv_plus, 
+    deriv_minus.CopyFromMat(deriv_plus);
+    deriv_minus.Scale(-1.0);
+    deriv_plus.ApplyFloor(0.0);
+    deriv_minus.ApplyFloor(0.0);
+
+    SubMatrix<BaseFloat> plus_chunk(*proj_deriv_plus,
                                     gauss*(dim+1), dim+1,
                                     0, dim*ncontexts),
-        minus_chunk(*proj_deriv_minus, 
+        minus_chunk(*proj_deriv_minus,
                     gauss*(dim+1), dim+1,
                     0, dim*ncontexts);
-          
-    // This next function takes the rank-one matrix
-    //  (input_chunk * this_intermed_deriv'), and adds the positive
-    // part to proj_deriv_plus, and minus the negative part to
-    // proj_deriv_minus.
-    AddOuterProductPlusMinus(static_cast<BaseFloat>(1.0),
-                             input_chunk,
-                             this_intermed_feat_deriv,
-                             &plus_chunk, &minus_chunk);
+    plus_chunk.AddMatMat(1.0, input_plus, kTrans, deriv_plus, kNoTrans, 1.0);
+    plus_chunk.AddMatMat(1.0, input_minus, kTrans, deriv_minus, kNoTrans, 1.0);
+    minus_chunk.AddMatMat(1.0, input_plus, kTrans, deriv_minus, kNoTrans, 1.0);
+    minus_chunk.AddMatMat(1.0, input_minus, kTrans, deriv_plus, kNoTrans, 1.0);
+    i += batch_size;
   }
-}      
+}
 
 void Fmpe::ComputeFeatures(const MatrixBase<BaseFloat> &feat_in,
                            const std::vector<std::vector<int32> > &gselect,
@@ -185,6 +185,22 @@ class Fmpe {
   void ComputeC(); // Computes the Cholesky factor C, from the GMM.
   void ComputeStddevs();
 
+  // Computes the posteriors of the Gaussians in "gselect" for each frame,
+  // and outputs them as ((gauss-index, time-index), posterior), sorted.
+  void ComputePosteriors(
+      const MatrixBase<BaseFloat> &feat_in,
+      const std::vector<std::vector<int32> > &gselect,
+      std::vector<std::pair<std::pair<int32, int32>, BaseFloat> > *all_posts)
+      const;
+
+  // Sets the rows of "input_chunks" to the parts of the high-dim features for
+  // posts[0] .. posts[input_chunks->NumRows() - 1], which must all be for the
+  // same Gaussian; each has dimension FeatDim() + 1.
+  void ComputeInputChunks(
+      const MatrixBase<BaseFloat> &feat_in,
+      const std::pair<std::pair<int32, int32>, BaseFloat> *posts,
+      MatrixBase<BaseFloat> *input_chunks) const;
+
   // Constructs the high-dim features and applies the main projection matrix proj_.
   void ApplyProjection(const MatrixBase<BaseFloat> &feat_in,
                        const std::vector<std::vector<int32> > &gselect,
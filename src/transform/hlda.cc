@@ -139,6 +139,21 @@ AccumulateFromPosteriors(int32 pdf_id,
                          const DiagGmm &gmm,
                          const VectorBase<BaseFloat> &data,
                          const VectorBase<BaseFloat> &posteriors) {
+  Vector<double> weights(S_.size());
+  if (!AccumulateOccsAndMeans(pdf_id, gmm, data, posteriors, &weights))
+    return;
+  Vector<double> data_dbl(data);
+  for (size_t i = 0; i < S_.size(); i++)
+    S_[i].AddVec2(weights(i), data_dbl);
+}
+
+bool
+HldaAccsDiagGmm::
+AccumulateOccsAndMeans(int32 pdf_id,
+                       const DiagGmm &gmm,
+                       const VectorBase<BaseFloat> &data,
+                       const VectorBase<BaseFloat> &posteriors,
+                       Vector<double> *weights) {
   Vector<double> data_dbl(data);
   KALDI_ASSERT(static_cast<size_t>(pdf_id) < occs_.size()
                && occs_[pdf_id].Dim() == posteriors.Dim());
@@ -166,7 +181,7 @@ AccumulateFromPosteriors(int32 pdf_id,
     Vector<double> posteriors_dbl(posteriors);
     occs_[pdf_id].AddVec(1.0, posteriors_dbl);
     mean_accs_[pdf_id].AddVecVec(1.0, posteriors_dbl, data_dbl);
-    if (RandUniform() > speedup_) return;  // continue with probability "speedup".
+    if (RandUniform() > speedup_) return false;  // continue with probability "speedup".
 
     for (int32 i = 0; i < posteriors.Dim(); i++) {
       if (posteriors(i) > 1.0e-05) {
@@ -181,11 +196,71 @@ AccumulateFromPosteriors(int32 pdf_id,
     }
 
   }
-  if (tot_occ != 0.0) {
-    for (int32 i = 0; i < model_dim; i++)
-      S_[i].AddVec2(tot_occ_times_inv_var(i), data_dbl);
-    S_[model_dim].AddVec2(tot_occ, data_dbl);
+  if (tot_occ == 0.0) return false;
+  weights->Range(0, model_dim).CopyFromVec(tot_occ_times_inv_var);
+  (*weights)(model_dim) = tot_occ;
+  return true;
+}
+
+void HldaAccsDiagGmm::AddOuterProducts(
+    const MatrixBase<double> &weights,
+    const MatrixBase<double> &outer_products) {
+  int32 num_mats = S_.size(), packed_dim = outer_products.NumCols();
+  KALDI_ASSERT(weights.NumCols() == num_mats &&
+               weights.NumRows() == outer_products.NumRows());
+  Matrix<double> sums(num_mats, packed_dim);
+  sums.AddMatMat(1.0, weights, kTrans, outer_products, kNoTrans, 0.0);
+  for (int32 i = 0; i < num_mats; i++) {
+    KALDI_ASSERT(S_[i].SizeInBytes() == packed_dim * sizeof(double));
+    SubVector<double> packed(S_[i].Data(), packed_dim);
+    packed.AddVec(1.0, sums.Row(i));
+  }
+}
+
+BaseFloat HldaAccsDiagGmm::AccumulateFromPdfPosteriors(
+    const AmDiagGmm &am_gmm,
+    const MatrixBase<BaseFloat> &feats,
+    const MatrixBase<BaseFloat> &transformed_feats,
+    const std::vector<std::vector<std::pair<int32, BaseFloat> > > &pdf_post) {
+  KALDI_ASSERT(static_cast<size_t>(feats.NumRows()) == pdf_post.size() &&
+               transformed_feats.NumRows() == feats.NumRows());
+  int32 feat_dim = feats.NumCols(), packed_dim = (feat_dim * (feat_dim + 1)) / 2,
+      batch_size = 256, n = 0;
+  // Row n of "weights" and "outer_products" are the weights and the packed
+  // outer product of the data, for the n'th buffered frame.
+  Matrix<double> weights(batch_size, S_.size()),
+      outer_products(batch_size, packed_dim);
+  Vector<BaseFloat> posteriors;
+  Vector<double> this_weights(S_.size());
+  double tot_like = 0.0;
+  for (size_t t = 0; t < pdf_post.size(); t++) {
+    for (size_t j = 0; j < pdf_post[t].size(); j++) {
+      int32 pdf_id = pdf_post[t][j].first;
+      BaseFloat weight = pdf_post[t][j].second;
+      const DiagGmm &gmm = am_gmm.GetPdf(pdf_id);
+      tot_like += weight * gmm.ComponentPosteriors(transformed_feats.Row(t),
+                                                   &posteriors);
+      posteriors.Scale(weight);
+      if (!AccumulateOccsAndMeans(pdf_id, gmm, feats.Row(t), posteriors,
+                                  &this_weights))
+        continue;
+      weights.Row(n).CopyFromVec(this_weights);
+      // The packed (lower-triangular, row-major) layout of SpMatrix.
+      double *packed = outer_products.RowData(n);
+      const BaseFloat *x = feats.RowData(t);
+      for (int32 a = 0; a < feat_dim; a++)
+        for (int32 b = 0; b <= a; b++)
+          *(packed++) = static_cast<double>(x[a]) * x[b];
+      if (++n == batch_size) {
+        AddOuterProducts(weights, outer_products);
+        n = 0;
+      }
+    }
   }
+  if (n > 0)
+    AddOuterProducts(SubMatrix<double>(weights, 0, n, 0, S_.size()),
+                     SubMatrix<double>(outer_products, 0, n, 0, packed_dim));
+  return tot_like;
 }
 
 
@@ -90,8 +90,36 @@ class HldaAccsDiagGmm {
                                 const VectorBase<BaseFloat> &data,
                                 const VectorBase<BaseFloat> &posteriors);
 
+  /// Accumulates for a whole utterance: pdf_post[t] is a list of (pdf-id,
+  /// weight) pairs for row t of "feats".  The Gaussian posteriors are computed
+  /// from "transformed_feats" (the features with the current transform
+  /// applied), and the stats from "feats".  This is equivalent to calling
+  /// AccumulateFromPosteriors() for each pair, but faster, as the updates of
+  /// the S matrices are done in batches of frames as matrix-matrix products.
+  /// Returns the sum of the GMM log-likelihoods times the weights.
+  BaseFloat AccumulateFromPdfPosteriors(
+      const AmDiagGmm &am_gmm,
+      const MatrixBase<BaseFloat> &feats,
+      const MatrixBase<BaseFloat> &transformed_feats,
+      const std::vector<std::vector<std::pair<int32, BaseFloat> > > &pdf_post);
 
  private:
+  // Does the part of AccumulateFromPosteriors() other than the update of S_.
+  // The update of S_ is S_[i] += (*weights)(i) data data^T; this function
+  // outputs "weights", of dimension S_.size(), and returns false if they are
+  // all zero.
+  bool AccumulateOccsAndMeans(int32 pdf_id,
+                              const DiagGmm &gmm,
+                              const VectorBase<BaseFloat> &data,
+                              const VectorBase<BaseFloat> &posteriors,
+                              Vector<double> *weights);
+
+  // Does S_[i] += sum_r weights(r, i) data_r data_r^T, where row r of
+  // "outer_products" is data_r data_r^T in packed form; this is one
+  // matrix-matrix product.
+  void AddOuterProducts(const MatrixBase<double> &weights,
+                        const MatrixBase<double> &outer_products);
+
   std::vector<SpMatrix<double> > S_;  // the S matrices: [model-dim+1] matrices of size (feat-dim) x (feat-dim)
   // are used to construct the G matrices.
   std::vector<Vector<double> > occs_;  // occupancies for the Gaussians. [num-pdfs][gauss]
@@ -196,6 +196,25 @@ UnitTestEstimateLda() {
     KALDI_ASSERT(tmp_mat(i - 1, i - 1) >= tmp_mat(i, i));
   }
 
+  // The batched version of Accumulate() should give the same transform; give
+  // each frame its class twice, with weights adding up to one.
+  {
+    std::vector<std::vector<std::pair<int32, BaseFloat> > > class_weights(
+        counter);
+    for (size_t i = 0; i < counter; i++) {
+      BaseFloat w = RandUniform();
+      class_weights[i].push_back(std::make_pair(feats_class[i], w));
+      class_weights[i].push_back(std::make_pair(feats_class[i], 1.0f - w));
+    }
+    LdaEstimate lda_est2;
+    lda_est2.Init(num_class, dim);
+    lda_est2.Accumulate(feats, class_weights);
+    opts.remove_offset = false;
+    Matrix<BaseFloat> lda_mat_bf2;
+    lda_est2.Estimate(opts, &lda_mat_bf2);
+    AssertEqual(lda_mat_bf, lda_mat_bf2, 1.0e-03);
+  }
+
   // test I/O
   test_io(lda_est, false);
   test_io(lda_est, true);
@@ -54,6 +54,35 @@ void LdaEstimate::Accumulate(const VectorBase<BaseFloat> &data,
   total_second_acc_.AddVec2(weight, data_d);
 }
 
+void LdaEstimate::Accumulate(
+    const MatrixBase<BaseFloat> &feats,
+    const std::vector<std::vector<std::pair<int32, BaseFloat> > > &class_weights) {
+  KALDI_ASSERT(feats.NumCols() == Dim() &&
+               static_cast<size_t>(feats.NumRows()) == class_weights.size());
+  Matrix<double> feats_d(feats);
+  Vector<double> frame_weights(feats.NumRows());
+  for (int32 t = 0; t < feats.NumRows(); t++) {
+    SubVector<double> feat(feats_d, t);
+    for (size_t j = 0; j < class_weights[t].size(); j++) {
+      int32 class_id = class_weights[t][j].first;
+      double weight = class_weights[t][j].second;
+      KALDI_ASSERT(class_id >= 0 && class_id < NumClasses());
+      zero_acc_(class_id) += weight;
+      first_acc_.Row(class_id).AddVec(weight, feat);
+      frame_weights(t) += weight;
+    }
+  }
+  if (frame_weights.Min() >= 0.0) {
+    // Scale each row by the square root of its weight, so we can use a plain
+    // symmetric rank-k update (SYRK).
+    frame_weights.ApplyPow(0.5);
+    feats_d.MulRowsVec(frame_weights);
+    total_second_acc_.AddMat2(1.0, feats_d, kTrans, 1.0);
+  } else {
+    total_second_acc_.AddMat2Vec(1.0, feats_d, kTrans, frame_weights, 1.0);
+  }
+}
+
 void LdaEstimate::GetStats(SpMatrix<double> *total_covar,
                            SpMatrix<double> *between_covar,
                            Vector<double> *total_mean,
@@ -72,6 +72,15 @@ class LdaEstimate {
   /// Accumulates data
   void Accumulate(const VectorBase<BaseFloat> &data, int32 class_id, BaseFloat weight = 1.0);
 
+  /// Accumulates a whole utterance: class_weights[t] is a list of (class-id,
+  /// weight) pairs for row t of "feats".  This is equivalent to calling
+  /// Accumulate() for each pair, but faster, as the second-order statistics
+  /// are accumulated with one symmetric rank-k update rather than one rank-one
+  /// update per frame.
+  void Accumulate(
+      const MatrixBase<BaseFloat> &feats,
+      const std::vector<std::vector<std::pair<int32, BaseFloat> > > &class_weights);
+
   /// Estimates the LDA transform matrix m.  If Mfull != NULL, it also outputs
   /// the full matrix (without dimensionality reduction), which is useful for
   /// some purposes.  If opts.remove_offset == true, it will output both matrices
@@ -17,6 +17,8 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <map>
+
 #include "transform/mllt.h"
 #include "util/const-integer-set.h"
 
@@ -91,15 +93,18 @@ void MlltAccs::Update(double beta,
   }
 
   double tot_objf_impr = 0.0;
+  Vector<double> cofactor(dim), row_change(dim), row_change_Minv(dim);
   for (int32 p = 0; p < num_iters; p++) {
+    // We keep Minv up to date as the rows change, with the Sherman-Morrison
+    // formula; re-inverting once per iteration stops roundoff building up.
+    Minv.CopyFromMat(M);
+    Minv.Invert();
     for (int32 i = 0; i < dim; i++) {  // for each row
       SubVector<double> row(M, i);
       // work out cofactor (actually cofactor times a constant which
-      // doesn't affect anything):
-      Minv.CopyFromMat(M);
-      Minv.Invert();
-      Minv.Transpose();
-      SubVector<double> cofactor(Minv, i);
+      // doesn't affect anything): it's column i of M^{-1}.
+      cofactor.CopyColFromMat(Minv, i);
+      row_change.CopyFromVec(row);
       // Objf is: beta log(|row . cofactor|) -0.5 row^T G[i] row
       // optimized by (c.f. Mark Gales's techreport "semitied covariance matrices
       // for hidden markov models, eq.  (22)),
@@ -115,6 +120,13 @@ void MlltAccs::Update(double beta,
       if (objf_after < objf_before - fabs(objf_before)*0.00001)
         KALDI_ERR << "Objective decrease in MLLT update.";
       tot_objf_impr += objf_after - objf_before;
+      // M has changed by e_i d^T, with d = row_change; so M^{-1} changes by
+      // -(M^{-1} e_i) (d^T M^{-1}) / (1 + d^T M^{-1} e_i).
+      row_change.Scale(-1.0);
+      row_change.AddVec(1.0, row);
+      row_change_Minv.AddMatVec(1.0, Minv, kTrans, row_change, 0.0);
+      Minv.AddVecVec(-1.0 / (1.0 + row_change_Minv(i)), cofactor,
+                     row_change_Minv);
     }
     if (p < 10 || p % 10 == 0)
       KALDI_LOG << "MLLT objective improvement per frame by " << p
@@ -188,7 +200,75 @@ BaseFloat MlltAccs::AccumulateFromGmmPreselect(
   return loglike;
 }
 
+BaseFloat MlltAccs::AccumulateFromPdfPosteriors(
+    const AmDiagGmm &am_gmm,
+    const MatrixBase<BaseFloat> &feats,
+    const std::vector<std::vector<std::pair<int32, BaseFloat> > > &pdf_post) {
+  int32 dim = Dim();
+  KALDI_ASSERT(feats.NumCols() == dim &&
+               static_cast<size_t>(feats.NumRows()) == pdf_post.size());
+  KALDI_ASSERT(rand_prune_ >= 0.0);
+  // Group the frames by pdf: pdf-id -> list of (frame, weight).
+  std::map<int32, std::vector<std::pair<int32, BaseFloat> > > pdf_to_frames;
+  for (size_t t = 0; t < pdf_post.size(); t++)
+    for (size_t j = 0; j < pdf_post[t].size(); j++)
+      pdf_to_frames[pdf_post[t][j].first].push_back(
+          std::make_pair(static_cast<int32>(t), pdf_post[t][j].second));
 
+  double tot_like = 0.0;
+  SpMatrix<double> scatter(dim);
+  std::map<int32, std::vector<std::pair<int32, BaseFloat> > >::const_iterator
+      iter = pdf_to_frames.begin(), end = pdf_to_frames.end();
+  for (; iter != end; ++iter) {
+    const DiagGmm &gmm = am_gmm.GetPdf(iter->first);
+    KALDI_ASSERT(gmm.Dim() == dim);
+    const std::vector<std::pair<int32, BaseFloat> > &frames = iter->second;
+    int32 num_frames = frames.size(), num_gauss = gmm.NumGauss();
+    Matrix<BaseFloat> posteriors(num_frames, num_gauss);
+    Vector<BaseFloat> this_post(num_gauss);
+    for (int32 r = 0; r < num_frames; r++) {
+      BaseFloat weight = frames[r].second;
+      tot_like += weight * gmm.ComponentPosteriors(feats.Row(frames[r].first),
+                                                   &this_post);
+      posteriors.Row(r).AddVec(weight, this_post);
+    }
+    Matrix<double> offsets(num_frames, dim);
+    Vector<double> mean(dim), post(num_frames);
+    for (int32 i = 0; i < num_gauss; i++) {  // for each mixcomp..
+      // Put the offsets from the mean, for the frames with nonzero (pruned)
+      // posterior, in the first "n" rows of "offsets".
+      int32 n = 0;
+      for (int32 r = 0; r < num_frames; r++) {
+        BaseFloat p = RandPrune(posteriors(r, i), rand_prune_);
+        if (p == 0.0) continue;
+        post(n) = p;
+        offsets.Row(n).CopyFromVec(feats.Row(frames[r].first));
+        n++;
+      }
+      if (n == 0) continue;
+      mean.CopyFromVec(gmm.means_invvars().Row(i));
+      SubVector<BaseFloat> inv_var(gmm.inv_vars(), i);
+      Vector<double> inv_var_dbl(inv_var);
+      mean.DivElements(inv_var_dbl);
+      SubMatrix<double> these_offsets(offsets, 0, n, 0, dim);
+      SubVector<double> these_post(post, 0, n);
+      these_offsets.AddVecToRows(-1.0, mean);
+      beta_ += these_post.Sum();
+      if (these_post.Min() >= 0.0) {
+        // Scale the rows by the square root of the posteriors, so we can use
+        // a plain symmetric rank-k update (SYRK).
+        these_post.ApplyPow(0.5);
+        these_offsets.MulRowsVec(these_post);
+        scatter.AddMat2(1.0, these_offsets, kTrans, 0.0);
+      } else {
+        scatter.AddMat2Vec(1.0, these_offsets, kTrans, these_post, 0.0);
+      }
+      for (int32 j = 0; j < dim; j++)
+        G_[j].AddSp(inv_var(j), scatter);
+    }
+  }
+  return tot_like;
+}
 
 
 } // namespace kaldi
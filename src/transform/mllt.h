@@ -95,6 +95,17 @@ class MlltAccs {
                                        const VectorBase<BaseFloat> &data,
                                        BaseFloat weight);  // e.g. weight = 1.0
 
+  /// Accumulates for a whole utterance: pdf_post[t] is a list of (pdf-id,
+  /// weight) pairs for row t of "feats".  This is equivalent to calling
+  /// AccumulateFromGmm(am_gmm.GetPdf(pdf_id), feats.Row(t), weight) for each
+  /// pair, but much faster: the frames are grouped by pdf, the scatter of each
+  /// Gaussian over its frames is done with one symmetric rank-k update, and
+  /// only then added to the Dim() matrices G_.  Returns the sum of the GMM
+  /// log-likelihoods times the weights.
+  BaseFloat AccumulateFromPdfPosteriors(
+      const AmDiagGmm &am_gmm,
+      const MatrixBase<BaseFloat> &feats,
+      const std::vector<std::vector<std::pair<int32, BaseFloat> > > &pdf_post);
   
   // premultiplies the means of the model by M.  typically called
   // after update.
@@ -143,6 +143,76 @@ void TestXformMean(const kaldi::AmDiagGmm &am_gmm,
 }
 
 
+// Checks that RegtreeMllrMeansCache gives the same means as
+// GetTransformedMeans(), and that changing the transform of some baseclasses
+// only discards the pdfs that have Gaussians in them.
+void UnitTestRegtreeMllrMeansCache() {
+  int32 dim = 1 + kaldi::RandInt(1, 9), num_pdfs = 1 + kaldi::RandInt(1, 9);
+  kaldi::AmDiagGmm am_gmm;
+  for (int32 pdf = 0; pdf < num_pdfs; pdf++) {
+    kaldi::DiagGmm gmm;
+    ut::InitRandDiagGmm(dim, 1 + kaldi::RandInt(0, 5), &gmm);
+    am_gmm.AddPdf(gmm);
+  }
+  kaldi::RegressionTree regtree;
+  std::vector<int32> sil_indices;
+  kaldi::Vector<BaseFloat> state_occs(num_pdfs);
+  state_occs.Set(100.0);
+  regtree.BuildTree(state_occs, sil_indices, am_gmm, 1 + kaldi::RandInt(0, 5));
+  int32 num_bclass = regtree.NumBaseclasses();
+
+  kaldi::RegtreeMllrDiagGmm mllr;
+  mllr.Init(num_bclass, dim);
+  std::vector<int32> bclass2xforms(num_bclass);
+  for (int32 b = 0; b < num_bclass; b++) {
+    bclass2xforms[b] = (kaldi::RandInt(0, 3) == 0 ? -1 : b);
+    kaldi::Matrix<BaseFloat> xform(dim, dim + 1);
+    xform.SetRandn();
+    mllr.SetParameters(xform, b);
+  }
+  mllr.set_bclass2xforms(bclass2xforms);
+
+  kaldi::RegtreeMllrMeansCache cache(am_gmm, regtree);
+  cache.SetTransform(mllr);
+  for (int32 iter = 0; iter < 3; iter++) {
+    for (int32 pdf = 0; pdf < num_pdfs; pdf++) {
+      const kaldi::DiagGmm &gmm = am_gmm.GetPdf(pdf);
+      kaldi::Matrix<BaseFloat> means(gmm.NumGauss(), dim);
+      mllr.GetTransformedMeans(regtree, am_gmm, pdf, &means);
+      kaldi::DiagGmm xformed_gmm;
+      xformed_gmm.CopyFromDiagGmm(gmm);
+      xformed_gmm.SetInvVarsAndMeans(gmm.inv_vars(), means);
+      xformed_gmm.ComputeGconsts();
+      KALDI_ASSERT(cache.GetXformedMeanInvVars(pdf).ApproxEqual(
+          xformed_gmm.means_invvars(), 1.0e-05));
+      KALDI_ASSERT(cache.GetXformedGconsts(pdf).ApproxEqual(
+          xformed_gmm.gconsts(), 1.0e-05));
+    }
+    // Setting the same transform again keeps everything.
+    KALDI_ASSERT(cache.SetTransform(mllr) == 0);
+
+    // Change the transform of one baseclass.
+    int32 b = kaldi::RandInt(0, num_bclass - 1);
+    std::vector<bool> pdf_changed(num_pdfs, false);
+    const std::vector<std::pair<int32, int32> > &bclass =
+        regtree.GetBaseclass(b);
+    for (size_t i = 0; i < bclass.size(); i++)
+      pdf_changed[bclass[i].first] = true;
+    if (bclass2xforms[b] == -1) {
+      bclass2xforms[b] = b;
+    } else if (kaldi::RandInt(0, 1) == 0) {
+      bclass2xforms[b] = -1;
+    } else {
+      kaldi::Matrix<BaseFloat> xform(dim, dim + 1);
+      xform.SetRandn();
+      mllr.SetParameters(xform, b);
+    }
+    mllr.set_bclass2xforms(bclass2xforms);
+    KALDI_ASSERT(cache.SetTransform(mllr) ==
+                 std::count(pdf_changed.begin(), pdf_changed.end(), true));
+  }
+}
+
 void UnitTestRegtreeMllrDiagGmm() {
   size_t dim = 1 + kaldi::RandInt(1, 9);  // random dimension of the gmm
   size_t num_comp = 1 + kaldi::RandInt(0, 5);  // random number of mixtures
@@ -184,8 +254,10 @@ void UnitTestRegtreeMllrDiagGmm() {
 
 int main() {
   kaldi::g_kaldi_verbose_level = 5;
-  for (int i = 0; i <= 10; i++)
+  for (int i = 0; i <= 10; i++) {
     UnitTestRegtreeMllrDiagGmm();
+    UnitTestRegtreeMllrMeansCache();
+  }
   std::cout << "Test OK.\n";
 }
 
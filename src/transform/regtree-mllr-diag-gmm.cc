@@ -111,6 +111,141 @@ void RegtreeMllrDiagGmm::GetTransformedMeans(const RegressionTree &regtree,
 }
 
 
+RegtreeMllrMeansCache::RegtreeMllrMeansCache(const AmDiagGmm &am,
+                                             const RegressionTree &regtree)
+    : am_(am), regtree_(regtree),
+      bclass_xforms_(regtree.NumBaseclasses()),
+      xformed_mean_invvars_(am.NumPdfs(), NULL),
+      xformed_gconsts_(am.NumPdfs(), NULL) { }
+
+RegtreeMllrMeansCache::~RegtreeMllrMeansCache() {
+  DeletePointers(&xformed_mean_invvars_);
+  DeletePointers(&xformed_gconsts_);
+}
+
+int32 RegtreeMllrMeansCache::SetTransform(const RegtreeMllrDiagGmm &mllr) {
+  const vector<int32> &bclass2xforms = mllr.bclass2xforms();
+  const vector< Matrix<BaseFloat> > &xforms = mllr.xform_matrices();
+  KALDI_ASSERT(static_cast<int32>(bclass2xforms.size()) ==
+               regtree_.NumBaseclasses());
+  int32 num_discarded = 0;
+  for (int32 bclass_index = 0, num_bclasses = regtree_.NumBaseclasses();
+       bclass_index < num_bclasses; ++bclass_index) {
+    int32 xform_index = bclass2xforms[bclass_index];
+    Matrix<BaseFloat> &cur_xform = bclass_xforms_[bclass_index];
+    if (xform_index > -1) {
+      KALDI_ASSERT(xform_index < static_cast<int32>(xforms.size()));
+      const Matrix<BaseFloat> &new_xform = xforms[xform_index];
+      if (cur_xform.NumRows() == new_xform.NumRows() &&
+          cur_xform.NumCols() == new_xform.NumCols() &&
+          cur_xform.Equal(new_xform))
+        continue;
+      cur_xform = new_xform;
+    } else {  // untransformed.
+      if (cur_xform.NumRows() == 0) continue;
+      cur_xform.Resize(0, 0);
+    }
+    const vector< pair<int32, int32> > &bclass =
+        regtree_.GetBaseclass(bclass_index);
+    for (vector< pair<int32, int32> >::const_iterator itr = bclass.begin(),
+        end = bclass.end(); itr != end; ++itr) {
+      int32 pdf_index = itr->first;
+      if (xformed_mean_invvars_[pdf_index] != NULL) {
+        delete xformed_mean_invvars_[pdf_index];
+        delete xformed_gconsts_[pdf_index];
+        xformed_mean_invvars_[pdf_index] = NULL;
+        xformed_gconsts_[pdf_index] = NULL;
+        num_discarded++;
+      }
+    }
+  }
+  return num_discarded;
+}
+
+// This is almost the same code as DiagGmm::ComputeGconsts, except that
+// means are used instead of means * inv(vars). This saves some computation.
+static void ComputeGconsts(const VectorBase<BaseFloat> &weights,
+                           const MatrixBase<BaseFloat> &means,
+                           const MatrixBase<BaseFloat> &inv_vars,
+                           VectorBase<BaseFloat> *gconsts_out) {
+  int32 num_gauss = weights.Dim();
+  int32 dim = means.NumCols();
+  KALDI_ASSERT(means.NumRows() == num_gauss
+      && inv_vars.NumRows() == num_gauss && inv_vars.NumCols() == dim);
+  KALDI_ASSERT(gconsts_out->Dim() == num_gauss);
+
+  BaseFloat offset = -0.5 * M_LOG_2PI * dim;  // constant term in gconst.
+  int32 num_bad = 0;
+
+  for (int32 gauss = 0; gauss < num_gauss; gauss++) {
+    KALDI_ASSERT(weights(gauss) >= 0);  // Cannot have negative weights.
+    BaseFloat gc = log(weights(gauss)) + offset;  // May be -inf if weights == 0
+    for (int32 d = 0; d < dim; d++) {
+      gc += 0.5 * log(inv_vars(gauss, d)) - 0.5 * means(gauss, d)
+        * means(gauss, d) * inv_vars(gauss, d);  // diff from DiagGmm version.
+    }
+
+    if (KALDI_ISNAN(gc)) {  // negative infinity is OK but NaN is not acceptable
+      KALDI_ERR << "At component "  << gauss
+                << ", not a number in gconst computation";
+    }
+    if (KALDI_ISINF(gc)) {
+      num_bad++;
+      // If positive infinity, make it negative infinity.
+      // Want to make sure the answer becomes -inf in the end, not NaN.
+      if (gc > 0) gc = -gc;
+    }
+    (*gconsts_out)(gauss) = gc;
+  }
+  if (num_bad > 0)
+    KALDI_WARN << num_bad << " unusable components found while computing "
+               << "gconsts.";
+}
+
+void RegtreeMllrMeansCache::ComputeForPdf(int32 pdf_index) {
+  KALDI_VLOG(3) << "For PDF index " << pdf_index << ": transforming means.";
+  const DiagGmm &pdf = am_.GetPdf(pdf_index);
+  int32 num_gauss = pdf.NumGauss(), dim = am_.Dim();
+  Matrix<BaseFloat> *means = new Matrix<BaseFloat>(num_gauss, dim);
+  Vector<BaseFloat> extended_mean(dim+1);
+  extended_mean(dim) = 1.0;
+  for (int32 gauss_index = 0; gauss_index < num_gauss; gauss_index++) {
+    const Matrix<BaseFloat> &xform = bclass_xforms_[
+        regtree_.Gauss2BaseclassId(pdf_index, gauss_index)];
+    SubVector<BaseFloat> out_row(means->Row(gauss_index));
+    if (xform.NumRows() != 0) {
+      SubVector<BaseFloat> tmp_mean(extended_mean.Range(0, dim));
+      am_.GetGaussianMean(pdf_index, gauss_index, &tmp_mean);
+      out_row.AddMatVec(1.0, xform, kNoTrans, extended_mean, 0.0);
+    } else {  // Copy untransformed mean
+      am_.GetGaussianMean(pdf_index, gauss_index, &out_row);
+    }
+  }
+  Vector<BaseFloat> *gconsts = new Vector<BaseFloat>(num_gauss);
+  // At this point, the transformed means haven't been multiplied with
+  // the inv vars, and they are used to compute gconsts first.
+  ComputeGconsts(pdf.weights(), *means, pdf.inv_vars(), gconsts);
+  // Finally, multiply the transformed means with the inv vars.
+  means->MulElements(pdf.inv_vars());
+  xformed_mean_invvars_[pdf_index] = means;
+  xformed_gconsts_[pdf_index] = gconsts;
+}
+
+const Matrix<BaseFloat>& RegtreeMllrMeansCache::GetXformedMeanInvVars(
+    int32 pdf_index) {
+  if (xformed_mean_invvars_[pdf_index] == NULL)
+    ComputeForPdf(pdf_index);
+  return *xformed_mean_invvars_[pdf_index];
+}
+
+const Vector<BaseFloat>& RegtreeMllrMeansCache::GetXformedGconsts(
+    int32 pdf_index) {
+  if (xformed_gconsts_[pdf_index] == NULL)
+    ComputeForPdf(pdf_index);
+  return *xformed_gconsts_[pdf_index];
+}
+
+
 void RegtreeMllrDiagGmm::Write(std::ostream &out, bool binary) const {
   WriteToken(out, binary, "<MLLRXFORM>");
   WriteToken(out, binary, "<NUMXFORMS>");
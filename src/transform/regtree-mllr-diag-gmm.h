@@ -75,9 +75,10 @@ class RegtreeMllrDiagGmm {
   void set_bclass2xforms(const std::vector<int32> &in) { bclass2xforms_ = in; }
 
   /// Accessors
-  const std::vector< Matrix<BaseFloat> > xform_matrices() const {
+  const std::vector< Matrix<BaseFloat> > &xform_matrices() const {
     return xform_matrices_;
   }
+  const std::vector<int32> &bclass2xforms() const { return bclass2xforms_; }
 
  private:
   /// Transform matrices: size() = num_xforms_
@@ -96,6 +97,44 @@ inline void RegtreeMllrDiagGmm::SetParameters(const MatrixBase<BaseFloat> &mat,
   xform_matrices_[regclass].CopyFromMat(mat, kNoTrans);
 }
 
+/// Caches, for each pdf, the MLLR-transformed means times the inverse
+/// variances and the corresponding gconsts, as needed for computing
+/// likelihoods; they are computed when first asked for.  The cache can be kept
+/// across utterances (e.g. the utterances of a speaker, or when the transform
+/// is re-estimated after each utterance): when the transform is changed with
+/// SetTransform(), only the pdfs that have Gaussians in a baseclass whose
+/// transform changed are recomputed.
+class RegtreeMllrMeansCache {
+ public:
+  /// "am" and "regtree" must not be changed while this object exists.  The
+  /// model starts out untransformed.
+  RegtreeMllrMeansCache(const AmDiagGmm &am, const RegressionTree &regtree);
+  ~RegtreeMllrMeansCache();
+
+  /// Sets the transform to use; "mllr" is copied, so it need not exist
+  /// afterwards.  Returns the number of pdfs whose cached values were
+  /// discarded because their transform changed.
+  int32 SetTransform(const RegtreeMllrDiagGmm &mllr);
+
+  /// Get the transformed means times inverse variances for a given pdf.
+  const Matrix<BaseFloat> &GetXformedMeanInvVars(int32 pdf_index);
+  /// Get the gconsts that go with the transformed means.
+  const Vector<BaseFloat> &GetXformedGconsts(int32 pdf_index);
+
+ private:
+  void ComputeForPdf(int32 pdf_index);
+
+  const AmDiagGmm &am_;
+  const RegressionTree &regtree_;
+  /// The transform for each baseclass; empty if its means are untransformed.
+  std::vector< Matrix<BaseFloat> > bclass_xforms_;
+  /// Per pdf, the cached values; NULL if not computed yet.
+  std::vector< Matrix<BaseFloat>* > xformed_mean_invvars_;
+  std::vector< Vector<BaseFloat>* > xformed_gconsts_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(RegtreeMllrMeansCache);
+};
+
 /** Class for computing the maximum-likelihood estimates of the parameters of
  *  an acoustic model that uses diagonal Gaussian mixture models as emission
  *  densities.
@@ -21,6 +21,7 @@
 #include "util/kaldi-io.h"
 #include "tree/build-tree-utils.h"
 #include "tree/clusterable-classes.h"
+#include "thread/kaldi-thread.h"
 
 
 namespace kaldi {
@@ -816,6 +817,22 @@ void TestSplitDecisionTree() {
         KALDI_ASSERT(fabs(impr - impr_check) < 0.1);
       }
 
+      {  // The tree should not depend on the number of threads.
+        int32 num_threads = g_num_threads, num_leaves2 = 0;
+        g_num_threads = 1;
+        EventMap *trivial_tree2 = TrivialTree(&num_leaves2);
+        EventMap *split_tree2 = SplitDecisionTree(*trivial_tree2, stats, qo,
+                                                  thresh, max_leaves,
+                                                  &num_leaves2, NULL, NULL);
+        g_num_threads = num_threads;
+        std::ostringstream os1, os2;
+        split_tree->Write(os1, false);
+        split_tree2->Write(os2, false);
+        KALDI_ASSERT(num_leaves2 == num_leaves && os1.str() == os2.str());
+        delete trivial_tree2;
+        delete split_tree2;
+      }
+
 
       std::cout << "After splitting, num_leaves = " << num_leaves << '\n';
 
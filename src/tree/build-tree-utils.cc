@@ -17,10 +17,14 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <iterator>
 #include <set>
 #include <queue>
 #include "util/stl-utils.h"
 #include "tree/build-tree-utils.h"
+#include "thread/kaldi-thread.h"
+#include "thread/kaldi-mutex.h"
 
 
 
@@ -292,50 +296,131 @@ BaseFloat ObjfGivenMap(const BuildTreeStatsType &stats_in, const EventMap &e) {
   return ans;
 }
 
+/*
+  QuestionSumPlan says, for the initial questions of a key, in which order to
+  compute the summed stats of their "yes" sets so that each can start from the
+  sum of an earlier question that is a subset of it.  The questions normally
+  come from a hierarchical clustering (see cluster-phones), so most questions are
+  the union of two smaller ones and each sum then needs only one Add().
+*/
+struct QuestionSumPlan {
+  std::vector<int32> order;  // question indexes, smallest questions first.
+  // base[i] is the index of a question that is a subset of question i and
+  // whose sum is computed before it, or -1.
+  std::vector<int32> base;
+  // extra[i] is the values in question i that are not in question base[i].
+  std::vector<std::vector<EventValueType> > extra;
+};
+
+static void ComputeQuestionSumPlan(
+    const std::vector<std::vector<EventValueType> > &questions,
+    QuestionSumPlan *plan) {
+  int32 num_questions = questions.size();
+  std::vector<std::pair<size_t, int32> > sizes(num_questions);
+  for (int32 i = 0; i < num_questions; i++)
+    sizes[i] = std::make_pair(questions[i].size(), i);
+  std::sort(sizes.begin(), sizes.end());
+  plan->order.resize(num_questions);
+  plan->base.assign(num_questions, -1);
+  plan->extra.resize(num_questions);
+  for (int32 j = 0; j < num_questions; j++) {
+    int32 i = sizes[j].second;
+    plan->order[j] = i;
+    const std::vector<EventValueType> &q = questions[i];  // sorted.
+    // Look for the largest earlier question that is a subset of this one.
+    for (int32 k = j - 1; k >= 0; k--) {
+      const std::vector<EventValueType> &r = questions[sizes[k].second];
+      if (std::includes(q.begin(), q.end(), r.begin(), r.end())) {
+        plan->base[i] = sizes[k].second;
+        break;
+      }
+    }
+    if (plan->base[i] == -1) {
+      plan->extra[i] = q;
+    } else {
+      const std::vector<EventValueType> &r = questions[plan->base[i]];
+      std::set_difference(q.begin(), q.end(), r.begin(), r.end(),
+                          std::back_inserter(plan->extra[i]));
+    }
+  }
+}
+
 // This function computes the best initial split of these stats [with this key].
-// Returns best objf change (>=0).
+// Returns best objf change (>=0).  "plan_in" is the QuestionSumPlan for the
+// initial questions of this key, or NULL (in which case it is computed here).
 BaseFloat ComputeInitialSplit(const std::vector<Clusterable*> &summed_stats,
                               const Questions &q_opts, EventKeyType key,
+                              const QuestionSumPlan *plan_in,
                               std::vector<EventValueType> *yes_set) {
   KALDI_ASSERT(yes_set != NULL);
   yes_set->clear();
   const QuestionsForKey &key_opts = q_opts.GetQuestionsOf(key);
 
-  // "total" needed for optimization in AddToClustersOptimized,
-  // and also used to work otu total objf.
+  // "total" is used to get the stats of the "no" side of each split, and to
+  // work out the total objf.
   Clusterable *total = SumClusterable(summed_stats);
   if (total == NULL) return 0.0;  // because there were no stats or non-NULL stats.
   BaseFloat unsplit_objf = total->Objf();
+  int32 num_present = 0;  // number of values with stats.
+  for (size_t v = 0; v < summed_stats.size(); v++)
+    if (summed_stats[v] != NULL) num_present++;
 
   const std::vector<std::vector<EventValueType> > &questions_of_this_key = key_opts.initial_questions;
-
-  int32 best_idx = -1;
-  BaseFloat best_objf_change = 0;
-
-  for (size_t i = 0; i < questions_of_this_key.size(); i++) {
-    const std::vector<EventValueType> &yes_set = questions_of_this_key[i];
-    std::vector<int32> assignments(summed_stats.size(), 0);  // 0 is index of "no".
-    std::vector<Clusterable*> clusters(2);  // no and yes clusters.
-    for (std::vector<EventValueType>::const_iterator iter = yes_set.begin(); iter != yes_set.end(); iter++) {
-      KALDI_ASSERT(*iter>=0);
-      if (*iter < (EventValueType)assignments.size()) assignments[*iter] = 1;
+  int32 num_questions = questions_of_this_key.size();
+  QuestionSumPlan local_plan;
+  if (plan_in == NULL)
+    ComputeQuestionSumPlan(questions_of_this_key, &local_plan);
+  const QuestionSumPlan &plan = (plan_in != NULL ? *plan_in : local_plan);
+  KALDI_ASSERT(static_cast<int32>(plan.order.size()) == num_questions);
+
+  // yes_sums[i] is the sum of the stats in the "yes" set of question i (NULL if
+  // none were present), and yes_counts[i] the number of values with stats.
+  std::vector<Clusterable*> yes_sums(num_questions, NULL);
+  std::vector<int32> yes_counts(num_questions, 0);
+  std::vector<BaseFloat> objf_changes(num_questions, 0.0);
+
+  for (int32 j = 0; j < num_questions; j++) {
+    int32 i = plan.order[j], base = plan.base[i];
+    Clusterable *sum = NULL;
+    int32 count = 0;
+    if (base != -1) {
+      if (yes_sums[base] != NULL) sum = yes_sums[base]->Copy();
+      count = yes_counts[base];
+    }
+    const std::vector<EventValueType> &extra = plan.extra[i];
+    for (size_t k = 0; k < extra.size(); k++) {
+      EventValueType v = extra[k];
+      KALDI_ASSERT(v >= 0);
+      if (v < static_cast<EventValueType>(summed_stats.size()) &&
+          summed_stats[v] != NULL) {
+        if (sum == NULL) sum = summed_stats[v]->Copy();
+        else sum->Add(*(summed_stats[v]));
+        count++;
+      }
     }
-    kaldi::AddToClustersOptimized(summed_stats, assignments, *total, &clusters);
-    BaseFloat this_objf = SumClusterableObjf(clusters);
+    yes_sums[i] = sum;
+    yes_counts[i] = count;
+    if (count == 0 || count == num_present)
+      continue;  // Not a split; the objf change is zero.
 
+    BaseFloat this_objf = sum->Objf() + total->ObjfMinus(*sum);
     if (this_objf < unsplit_objf- 0.001*std::abs(unsplit_objf)) {  // got worse; should never happen.
       // of course small differences can be caused by roundoff.
       KALDI_WARN << "Objective function got worse when building tree: "<< this_objf << " < " << unsplit_objf;
       KALDI_ASSERT(!(this_objf < unsplit_objf - 0.01*(200 + std::abs(unsplit_objf))));  // do assert on more stringent check.
     }
+    objf_changes[i] = this_objf - unsplit_objf;
+  }
 
-    BaseFloat this_objf_change = this_objf - unsplit_objf;
-    if (this_objf_change > best_objf_change) {
-      best_objf_change = this_objf_change;
+  int32 best_idx = -1;
+  BaseFloat best_objf_change = 0;
+  for (int32 i = 0; i < num_questions; i++) {
+    if (objf_changes[i] > best_objf_change) {
+      best_objf_change = objf_changes[i];
       best_idx = i;
     }
-    DeletePointers(&clusters);
   }
+  DeletePointers(&yes_sums);
   delete total;
   if (best_idx != -1)
     *yes_set = questions_of_this_key[best_idx];
@@ -345,10 +430,13 @@ BaseFloat ComputeInitialSplit(const std::vector<Clusterable*> &summed_stats,
 
 // returns best delta-objf.
 // If key does not exist, returns 0 and sets yes_set_out to empty.
-BaseFloat FindBestSplitForKey(const BuildTreeStatsType &stats,
-                              const Questions &q_opts,
-                              EventKeyType key,
-                              std::vector<EventValueType> *yes_set_out) {
+// "plan" is the QuestionSumPlan for the initial questions of this key, or NULL
+// if the caller does not have it.
+static BaseFloat FindBestSplitForKey(const BuildTreeStatsType &stats,
+                                     const Questions &q_opts,
+                                     EventKeyType key,
+                                     const QuestionSumPlan *plan,
+                                     std::vector<EventValueType> *yes_set_out) {
   if (stats.size()<=1) return 0.0;  // cannot split if only zero or one instance of stats.
   if (!PossibleValues(key, stats, NULL)) {
     yes_set_out->clear();
@@ -363,7 +451,7 @@ BaseFloat FindBestSplitForKey(const BuildTreeStatsType &stats,
 
   std::vector<EventValueType> yes_set;
   BaseFloat improvement = ComputeInitialSplit(summed_stats,
-                                               q_opts, key, &yes_set);
+                                               q_opts, key, plan, &yes_set);
   // find best basic question.
 
   std::vector<int32> assignments(summed_stats.size(), 0);  // assigns to "no" (0) by default.
@@ -420,8 +508,48 @@ BaseFloat FindBestSplitForKey(const BuildTreeStatsType &stats,
   return improvement; // objective-function improvement.
 }
 
+BaseFloat FindBestSplitForKey(const BuildTreeStatsType &stats,
+                              const Questions &q_opts,
+                              EventKeyType key,
+                              std::vector<EventValueType> *yes_set_out) {
+  return FindBestSplitForKey(stats, q_opts, key, NULL, yes_set_out);
+}
+
 
 
+/*
+  SplitSearchInfo contains the things needed when finding the best split of a
+  node that are the same for all nodes: the keys that have questions, and the
+  QuestionSumPlan for each.
+*/
+struct SplitSearchInfo {
+  explicit SplitSearchInfo(const Questions &q_opts_in): q_opts(q_opts_in) {
+    std::vector<EventKeyType> all_keys;
+    q_opts.GetKeysWithQuestions(&all_keys);
+    if (all_keys.size() == 0) {
+      KALDI_WARN << "SplitDecisionTree(), no keys available to split on (maybe no key covered all of your events, or there was a problem with your questions configuration?)";
+    }
+    for (size_t i = 0; i < all_keys.size(); i++)
+      if (q_opts.HasQuestionsForKey(all_keys[i]))
+        keys.push_back(all_keys[i]);
+    plans.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); i++)
+      ComputeQuestionSumPlan(q_opts.GetQuestionsOf(keys[i]).initial_questions,
+                             &(plans[i]));
+  }
+  const Questions &q_opts;
+  std::vector<EventKeyType> keys;
+  std::vector<QuestionSumPlan> plans;
+};
+
+class DecisionTreeSplitter;
+
+// Finds the best split of each of "splitters", which must be leaves; the work
+// is done in parallel (using up to g_num_threads threads) over the splitters
+// and the keys.
+static void FindBestSplits(const SplitSearchInfo &info,
+                           const std::vector<DecisionTreeSplitter*> &splitters);
+
 /*
   DecisionTreeBuilder is a class used in SplitDecisionTree
 */
@@ -444,15 +572,24 @@ class DecisionTreeSplitter {
       best_split_impr_ = std::max(yes_->BestSplit(), no_->BestSplit());  // may have changed.
     }
   }
+  // Note: the best split is not found until FindBestSplits() is called.
   DecisionTreeSplitter(EventAnswerType leaf, const BuildTreeStatsType &stats,
-                      const Questions &q_opts): q_opts_(q_opts), yes_(NULL), no_(NULL), leaf_(leaf), stats_(stats) {
-    // not, this must work when stats is empty too. [just gives zero improvement, non-splittable].
-    FindBestSplit();
-  }
+                       const SplitSearchInfo &info):
+      info_(info), best_split_impr_(0.0), yes_(NULL), no_(NULL), leaf_(leaf),
+      stats_(stats), key_(0) { }
   ~DecisionTreeSplitter() {
     if (yes_) delete yes_;
     if (no_) delete no_;
   }
+  const BuildTreeStatsType &Stats() const { return stats_; }
+  // Called from FindBestSplits().  Note: this must work when stats is empty
+  // too [gives zero improvement, non-splittable].
+  void SetBestSplit(BaseFloat impr, EventKeyType key,
+                    const std::vector<EventValueType> &yes_set) {
+    best_split_impr_ = impr;
+    key_ = key;
+    yes_set_ = yes_set;
+  }
  private:
   void DoSplitInternal(int32 *next_leaf) {
     // Does the split; applicable only to leaf nodes.
@@ -481,38 +618,18 @@ class DecisionTreeSplitter {
       delete yes_clust; delete no_clust;
     }
 #endif
-    yes_ = new DecisionTreeSplitter(yes_leaf, yes_stats, q_opts_);
-    no_ = new DecisionTreeSplitter(no_leaf, no_stats, q_opts_);
+    yes_ = new DecisionTreeSplitter(yes_leaf, yes_stats, info_);
+    no_ = new DecisionTreeSplitter(no_leaf, no_stats, info_);
+    std::vector<DecisionTreeSplitter*> children(2);
+    children[0] = yes_;
+    children[1] = no_;
+    FindBestSplits(info_, children);
     best_split_impr_ = std::max(yes_->BestSplit(), no_->BestSplit());
     stats_.clear();  // note: pointers in stats_ were not owned here.
   }
-  void FindBestSplit() {
-    // This sets best_split_impr_, key_ and yes_set_.
-    // May just pick best question, or may iterate a bit (depends on
-    // q_opts; see FindBestSplitForKey for details)
-    std::vector<EventKeyType> all_keys;
-    q_opts_.GetKeysWithQuestions(&all_keys);
-    if (all_keys.size() == 0) {
-      KALDI_WARN << "DecisionTreeSplitter::FindBestSplit(), no keys available to split on (maybe no key covered all of your events, or there was a problem with your questions configuration?)";
-    }
-    best_split_impr_ = 0;
-    for (size_t i = 0; i < all_keys.size(); i++) {
-      if (q_opts_.HasQuestionsForKey(all_keys[i])) {
-        std::vector<EventValueType> temp_yes_set;
-        BaseFloat split_improvement = FindBestSplitForKey(stats_, q_opts_, all_keys[i], &temp_yes_set);
-        if (split_improvement > best_split_impr_) {
-          best_split_impr_ = split_improvement;
-          yes_set_ = temp_yes_set;
-          key_ = all_keys[i];
-        }
-      }
-    }
-  }
-
-
 
   // Data members... Always used:
-  const Questions &q_opts_;
+  const SplitSearchInfo &info_;
   BaseFloat best_split_impr_;
 
   // If already split:
@@ -529,6 +646,77 @@ class DecisionTreeSplitter {
 
 };
 
+
+// This class is used by FindBestSplits() to find the best split for pairs
+// (splitter, key) in parallel: each thread takes the next pair that is not yet
+// done, which keeps the threads busy although the pairs take very different
+// amounts of time.
+class FindBestSplitsClass {
+ public:
+  FindBestSplitsClass(const SplitSearchInfo &info,
+                      const std::vector<DecisionTreeSplitter*> &splitters,
+                      std::vector<BaseFloat> *imprs,
+                      std::vector<std::vector<EventValueType> > *yes_sets,
+                      int32 *next_task, Mutex *mutex):
+      info_(&info), splitters_(&splitters), imprs_(imprs), yes_sets_(yes_sets),
+      next_task_(next_task), mutex_(mutex) { }
+
+  void operator () (int32 block_begin, int32 block_end) {
+    int32 num_keys = info_->keys.size(),
+        num_tasks = splitters_->size() * num_keys;
+    while (true) {
+      mutex_->Lock();
+      int32 task = (*next_task_)++;
+      mutex_->Unlock();
+      if (task >= num_tasks) break;
+      int32 s = task / num_keys, k = task % num_keys;
+      (*imprs_)[task] = FindBestSplitForKey((*splitters_)[s]->Stats(),
+                                            info_->q_opts, info_->keys[k],
+                                            &(info_->plans[k]),
+                                            &((*yes_sets_)[task]));
+    }
+  }
+ private:
+  const SplitSearchInfo *info_;
+  const std::vector<DecisionTreeSplitter*> *splitters_;
+  std::vector<BaseFloat> *imprs_;
+  std::vector<std::vector<EventValueType> > *yes_sets_;
+  int32 *next_task_;
+  Mutex *mutex_;
+};
+
+static void FindBestSplits(const SplitSearchInfo &info,
+                           const std::vector<DecisionTreeSplitter*> &splitters) {
+  int32 num_keys = info.keys.size(),
+      num_tasks = splitters.size() * num_keys;
+  std::vector<BaseFloat> imprs(num_tasks, 0.0);
+  std::vector<std::vector<EventValueType> > yes_sets(num_tasks);
+  int32 next_task = 0;
+  Mutex mutex;
+  FindBestSplitsClass c(info, splitters, &imprs, &yes_sets, &next_task, &mutex);
+  int32 num_threads = std::min(g_num_threads, num_tasks);
+  // The range is just the thread indexes; the threads share out the tasks.
+  RunParallelFor(0, std::max(num_threads, 1), c, num_threads);
+
+  // Take the best key for each splitter, in the same order as the serial
+  // version so that ties are resolved the same way.
+  for (size_t s = 0; s < splitters.size(); s++) {
+    int32 best_task = -1;
+    BaseFloat best_impr = 0.0;
+    for (int32 k = 0; k < num_keys; k++) {
+      int32 task = s * num_keys + k;
+      if (imprs[task] > best_impr) {
+        best_impr = imprs[task];
+        best_task = task;
+      }
+    }
+    if (best_task != -1)
+      splitters[s]->SetBestSplit(best_impr, info.keys[best_task % num_keys],
+                                 yes_sets[best_task]);
+  }
+}
+
+
 EventMap *SplitDecisionTree(const EventMap &input_map,
                             const BuildTreeStatsType &stats,
                             Questions &q_opts,
@@ -541,6 +729,7 @@ EventMap *SplitDecisionTree(const EventMap &input_map,
   int32 num_empty_leaves = 0;
   BaseFloat like_impr = 0.0;
   BaseFloat smallest_split_change = 1.0e+20;
+  SplitSearchInfo info(q_opts);
   std::vector<DecisionTreeSplitter*> builders;
   {  // set up "builders" [one for each current leaf].  This array is never extended.
     // the structures generated during splitting remain as trees at each array location.
@@ -551,8 +740,9 @@ EventMap *SplitDecisionTree(const EventMap &input_map,
     for (size_t i = 0;i < split_stats.size();i++) {
       EventAnswerType leaf = static_cast<EventAnswerType>(i);
       if (split_stats[i].size() == 0) num_empty_leaves++;
-      builders[i] = new DecisionTreeSplitter(leaf, split_stats[i], q_opts);
+      builders[i] = new DecisionTreeSplitter(leaf, split_stats[i], info);
     }
+    FindBestSplits(info, builders);
   }
 
   {  // Do the splitting.
@@ -20,6 +20,7 @@
 #include "tree/cluster-utils.h"
 #include "tree/clusterable-classes.h"
 #include "util/stl-utils.h"
+#include "thread/kaldi-thread.h"
 
 namespace kaldi {
 static void TestClusterUtils() {  // just some very basic tests of the GaussClusterable class.
@@ -83,6 +84,26 @@ static void TestDistance() {
 } // end namespace kaldi
 
 
+static void TestGaussObjfPlus() {
+  // GaussClusterable overrides ObjfPlus, ObjfMinus and Distance; check
+  // them against the generic versions that work on a copy.
+  int32 dim = 1 + rand() % 10;
+  GaussClusterable a(dim, 0.1), b(dim, 0.1);
+  for (int32 i = 0; i < 20; i++) {
+    Vector<BaseFloat> vec(dim);
+    vec.SetRandn();
+    a.AddStats(vec, 0.5 * (rand() % 3));
+    vec.SetRandn();
+    b.AddStats(vec);
+  }
+  Clusterable *sum = a.Copy();
+  sum->Add(b);
+  AssertEqual(a.ObjfPlus(b), sum->Objf(), 1.0e-04);
+  AssertEqual(sum->ObjfMinus(b), a.Objf(), 1.0e-04);
+  AssertEqual(a.Distance(b), a.Objf() + b.Objf() - sum->Objf(), 1.0e-04);
+  delete sum;
+}
+
 static void TestSumObjfAndSumNormalizer() {
   ScalarClusterable a(1.0), b(2.5);
   AssertEqual(a.Objf(), 0.0);
@@ -244,6 +265,33 @@ static void TestClusterBottomUp() {
 }
 
 
+static void TestClusterBottomUpThreaded() {
+  // There are enough points here that the distances are computed in
+  // several threads; the result should not depend on the number of threads.
+  int32 dim = 3, num_points = 200;
+  std::vector<Clusterable*> points;
+  for (int32 i = 0; i < num_points; i++) {
+    GaussClusterable *gc = new GaussClusterable(dim, 0.01);
+    for (int32 j = 0; j < 5; j++) {
+      Vector<BaseFloat> vec(dim);
+      vec.SetRandn();
+      vec.Add(i % 7);
+      gc->AddStats(vec);
+    }
+    points.push_back(gc);
+  }
+  int32 num_threads_saved = g_num_threads;
+  std::vector<int32> assignments1, assignments4;
+  g_num_threads = 1;
+  BaseFloat ans1 = ClusterBottomUp(points, 1.0e+10, 10, NULL, &assignments1);
+  g_num_threads = 4;
+  BaseFloat ans4 = ClusterBottomUp(points, 1.0e+10, 10, NULL, &assignments4);
+  g_num_threads = num_threads_saved;
+  AssertEqual(ans1, ans4);
+  KALDI_ASSERT(assignments1 == assignments4);
+  DeletePointers(&points);
+}
+
 static void TestRefineClusters() {
   for (size_t n = 0;n < 4;n++) {
     // Test it by creating a random clustering and verifying that it does not make it worse, and
@@ -447,6 +495,7 @@ int main() {
   TestObjfPlus();
   TestObjfMinus();
   TestDistance();
+  TestGaussObjfPlus();
   TestSumObjfAndSumNormalizer();
   TestSum();
   TestEnsureClusterableVectorNotNull();
@@ -455,6 +504,7 @@ int main() {
   TestTreeCluster();
   TestClusterKMeans();
   TestClusterBottomUp();
+  TestClusterBottomUpThreaded();
   TestRefineClusters();
 
   for (size_t i = 0;i < 2;i++)
@@ -25,6 +25,7 @@ using std::vector;
 
 #include "base/kaldi-math.h"
 #include "util/stl-utils.h"
+#include "thread/kaldi-thread.h"
 #include "tree/cluster-utils.h"
 
 namespace kaldi {
@@ -190,6 +191,60 @@ void AddToClustersOptimized(const std::vector<Clusterable*> &stats,
 // Bottom-up clustering routines
 // ============================================================================
 
+// Below this many distance computations we do not bother with threads.
+static const int32 kMinDistancesPerThread = 500;
+
+/// ClusterDistanceComputer fills in the triangular distance array used by
+/// BottomUpClusterer, dist_vec[(i * (i - 1)) / 2 + j] for j < i, in up to
+/// g_num_threads threads.  If "cluster" is -1 it computes the distances
+/// between all pairs of clusters; otherwise only the distances between
+/// "cluster" and each of "others".  The Clusterable objects are only accessed
+/// through const methods.
+class ClusterDistanceComputer: public MultiThreadable {
+ public:
+  ClusterDistanceComputer(const std::vector<Clusterable*> &clusters,
+                          int32 cluster,
+                          const std::vector<int32> &others,
+                          std::vector<BaseFloat> *dist_vec):
+      clusters_(clusters), cluster_(cluster), others_(others),
+      dist_vec_(dist_vec) { }
+
+  void operator() () {
+    if (cluster_ == -1) {
+      // Row i has i entries, so interleaving the rows balances the work.
+      int32 num_clusters = clusters_.size();
+      for (int32 i = thread_id_; i < num_clusters; i += num_threads_)
+        for (int32 j = 0; j < i; j++)
+          (*dist_vec_)[(i * (i - 1)) / 2 + j] =
+              clusters_[i]->Distance(*(clusters_[j]));
+    } else {
+      int32 num_others = others_.size();
+      for (int32 n = thread_id_; n < num_others; n += num_threads_) {
+        int32 i = std::max(cluster_, others_[n]),
+            j = std::min(cluster_, others_[n]);
+        (*dist_vec_)[(i * (i - 1)) / 2 + j] =
+            clusters_[i]->Distance(*(clusters_[j]));
+      }
+    }
+  }
+
+  /// Does the computation, in parallel if it is large enough to benefit.
+  void Run(int64 num_distances) {
+    if (g_num_threads > 1 && num_distances >= 2 * kMinDistancesPerThread) {
+      RunMultiThreaded(*this);
+    } else {
+      thread_id_ = 0;
+      num_threads_ = 1;
+      (*this)();
+    }
+  }
+ private:
+  const std::vector<Clusterable*> &clusters_;
+  int32 cluster_;
+  const std::vector<int32> &others_;
+  std::vector<BaseFloat> *dist_vec_;
+};
+
 class BottomUpClusterer {
  public:
   BottomUpClusterer(const std::vector<Clusterable*> &points,
@@ -220,6 +275,8 @@ class BottomUpClusterer {
   /// Reconstructs the priority queue from the distances.
   void ReconstructQueue();
 
+  /// Adds the pair to the queue if its distance (which must already be in
+  /// dist_vec_) is small enough.
   void SetDistance(int32 i, int32 j);
   BaseFloat& Distance(int32 i, int32 j) {
     KALDI_ASSERT(i < npoints_ && j < i);
@@ -323,10 +380,12 @@ void BottomUpClusterer::InitializeAssignments() {
 }
 
 void BottomUpClusterer::SetInitialDistances() {
+  std::vector<int32> no_others;
+  ClusterDistanceComputer computer(*clusters_, -1, no_others, &dist_vec_);
+  computer.Run(dist_vec_.size());
   for (int32 i = 0; i < npoints_; i++) {
     for (int32 j = 0; j < i; j++) {
-      BaseFloat dist = (*clusters_)[i]->Distance(*((*clusters_)[j]));
-      dist_vec_[(i * (i - 1)) / 2 + j] = dist;
+      BaseFloat dist = dist_vec_[(i * (i - 1)) / 2 + j];
       if (dist <= max_merge_thresh_)
         queue_.push(std::make_pair(dist, std::make_pair(static_cast<uint_smaller>(i),
             static_cast<uint_smaller>(j))));
@@ -355,13 +414,19 @@ void BottomUpClusterer::MergeClusters(int32 i, int32 j) {
   ans_ -= dist_vec_[(i * (i - 1)) / 2 + j];
   nclusters_--;
   // Now update "distances".
-  for (int32 k = 0; k < npoints_; k++) {
-    if (k != i && (*clusters_)[k] != NULL) {
-      if (k < i)
-        SetDistance(i, k);  // SetDistance requires k < i.
-      else
-        SetDistance(k, i);
-    }
+  std::vector<int32> others;
+  others.reserve(nclusters_);
+  for (int32 k = 0; k < npoints_; k++)
+    if (k != i && (*clusters_)[k] != NULL)
+      others.push_back(k);
+  ClusterDistanceComputer computer(*clusters_, i, others, &dist_vec_);
+  computer.Run(others.size());
+  for (size_t n = 0; n < others.size(); n++) {
+    int32 k = others[n];
+    if (k < i)
+      SetDistance(i, k);  // SetDistance requires k < i.
+    else
+      SetDistance(k, i);
   }
 }
 
@@ -389,8 +454,8 @@ void BottomUpClusterer::ReconstructQueue() {
 void BottomUpClusterer::SetDistance(int32 i, int32 j) {
   KALDI_ASSERT(i < npoints_ && j < i && (*clusters_)[i] != NULL
          && (*clusters_)[j] != NULL);
-  BaseFloat dist = (*clusters_)[i]->Distance(*((*clusters_)[j]));
-  dist_vec_[(i * (i - 1)) / 2 + j] = dist;  // set the distance in the array.
+  // the distance has already been set in the array, by MergeClusters().
+  BaseFloat dist = dist_vec_[(i * (i - 1)) / 2 + j];
   if (dist < max_merge_thresh_) {
     queue_.push(std::make_pair(dist, std::make_pair(static_cast<uint_smaller>(i),
         static_cast<uint_smaller>(j))));
@@ -735,14 +800,11 @@ class RefineClusterer {
 
     for (int32 clust = 0;clust < num_clust_;clust++) {
       if (clust != my_clust) {
-        Clusterable *tmp = (*clusters_)[clust]->Copy();
-        tmp->Add(*point_cl);
         BaseFloat other_clust_objf = clust_objf_[clust];
-        BaseFloat other_clust_plus_me_objf = (*clusters_)[clust]->ObjfPlus(* (points_[point]));
+        BaseFloat other_clust_plus_me_objf = (*clusters_)[clust]->ObjfPlus(*point_cl);
 
         BaseFloat distance = other_clust_objf-other_clust_plus_me_objf;  // negated delta-objf, with only "varying" terms.
         distances.push_back(std::make_pair(distance, (LocalInt)clust));
-        delete tmp;
       }
     }
     if ((cfg_.top_n-1-1) >= 0) {
@@ -768,10 +830,32 @@ class RefineClusterer {
     info.objf = (*clusters_)[my_clust]->ObjfMinus(*(points_[point]));
     my_clust_index_[point] = cfg_.top_n-1;
   }
+  // InitPoint() only writes the entries of info_ and my_clust_index_ for its
+  // own point, so different points can be initialized in parallel.
+  class InitPointsClass: public MultiThreadable {
+   public:
+    InitPointsClass(RefineClusterer *clusterer): clusterer_(clusterer) { }
+    void operator() () {
+      for (int32 p = thread_id_; p < clusterer_->num_points_; p += num_threads_)
+        clusterer_->InitPoint(p);
+    }
+   private:
+    RefineClusterer *clusterer_;
+  };
+  friend class InitPointsClass;
+
   void InitPoints() {
     // finds, for each point, the closest cfg_.top_n clusters (including its own cluster).
     // this may be the most time-consuming step of the algorithm.
-    for (int32 p = 0;p < num_points_;p++) InitPoint(p);
+    InitPointsClass c(this);
+    if (g_num_threads > 1 && static_cast<int64>(num_points_) * num_clust_ >=
+        2 * kMinDistancesPerThread) {
+      RunMultiThreaded(c);
+    } else {
+      c.thread_id_ = 0;
+      c.num_threads_ = 1;
+      c();
+    }
   }
   void Iterate() {
     int32 iter, num_iters = cfg_.num_iters;
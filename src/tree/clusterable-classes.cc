@@ -191,29 +191,77 @@ void GaussClusterable::Read(std::istream &is, bool binary) {
 }
 
 BaseFloat GaussClusterable::Objf() const {
-  if (count_ <= 0.0) {
-    if (count_ < -0.1) {
-      KALDI_WARN << "GaussClusterable::Objf(), count is negative " << count_;
+  return ObjfOfSum(NULL, 0.0);
+}
+
+BaseFloat GaussClusterable::ObjfPlus(const Clusterable &other_in) const {
+  KALDI_ASSERT(other_in.Type() == "gauss");
+  return ObjfOfSum(static_cast<const GaussClusterable*>(&other_in), 1.0);
+}
+
+BaseFloat GaussClusterable::ObjfMinus(const Clusterable &other_in) const {
+  KALDI_ASSERT(other_in.Type() == "gauss");
+  return ObjfOfSum(static_cast<const GaussClusterable*>(&other_in), -1.0);
+}
+
+BaseFloat GaussClusterable::Distance(const Clusterable &other_in) const {
+  KALDI_ASSERT(other_in.Type() == "gauss");
+  const GaussClusterable *other =
+      static_cast<const GaussClusterable*>(&other_in);
+  BaseFloat objf_sum = ObjfOfSum(other, 1.0),
+      ans = Objf() + other->Objf() - objf_sum;
+  if (ans < 0) {  // as in Clusterable::Distance().
+    if (std::fabs(ans) > 0.01 * (1.0 + std::fabs(objf_sum))) {
+      KALDI_WARN << "Negative number returned (badly defined Clusterable "
+                 << "class?): ans= " << ans;
+    }
+    ans = 0;
+  }
+  return ans;
+}
+
+BaseFloat GaussClusterable::ObjfOfSum(const GaussClusterable *other,
+                                      double scale) const {
+  double count = count_;
+  if (other != NULL) {
+    KALDI_ASSERT(other->stats_.NumCols() == stats_.NumCols());
+    count += scale * other->count_;
+  }
+  if (count <= 0.0) {
+    if (count < -0.1) {
+      KALDI_WARN << "GaussClusterable::Objf(), count is negative " << count;
     }
     return 0.0;
   } else {
-    size_t dim = stats_.NumCols();
-    Vector<double> vars(dim);
-    double objf_per_frame = 0.0;
-    for (size_t d = 0; d < dim; d++) {
-      double mean(stats_(0, d) / count_), var = stats_(1, d) / count_ - mean
+    int32 dim = stats_.NumCols();
+    const double *x = stats_.RowData(0), *x2 = stats_.RowData(1),
+        *other_x = (other != NULL ? other->stats_.RowData(0) : NULL),
+        *other_x2 = (other != NULL ? other->stats_.RowData(1) : NULL);
+    double objf_per_frame = 0.0, sum_log = 0.0, prod = 1.0;
+    for (int32 d = 0; d < dim; d++) {
+      double this_x = x[d], this_x2 = x2[d];
+      if (other != NULL) {
+        this_x += scale * other_x[d];
+        this_x2 += scale * other_x2[d];
+      }
+      double mean = this_x / count, var = this_x2 / count - mean
           * mean, floored_var = std::max(var, var_floor_);
-      vars(d) = floored_var;
       objf_per_frame += -0.5 * var / floored_var;
+      // Accumulate the log-determinant as VectorBase::SumLog() does, with
+      // one log per few dimensions rather than one per dimension.
+      prod *= floored_var;
+      if (prod < 1.0e-10 || prod > 1.0e+10) {
+        sum_log += Log(prod);
+        prod = 1.0;
+      }
     }
-    objf_per_frame += -0.5 * (vars.SumLog() + M_LOG_2PI * dim);
+    if (prod != 1.0) sum_log += Log(prod);
+    objf_per_frame += -0.5 * (sum_log + M_LOG_2PI * dim);
     if (KALDI_ISNAN(objf_per_frame)) {
       KALDI_WARN << "GaussClusterable::Objf(), objf is NaN\n";
       return 0.0;
     }
-    // KALDI_VLOG(2) << "count = " << count_ << ", objf_per_frame = "<< objf_per_frame
-    //   << ", returning " << (objf_per_frame*count_) << ", floor = " << var_floor_;
-    return objf_per_frame * count_;
+    return objf_per_frame * count;
   }
 }
 
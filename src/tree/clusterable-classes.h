@@ -86,6 +86,11 @@ class GaussClusterable: public Clusterable {
   virtual void Scale(BaseFloat f);
   virtual void Write(std::ostream &os, bool binary) const;
   virtual Clusterable *ReadNew(std::istream &is, bool binary) const;
+  // The following three are overridden for speed: they work directly on the
+  // stats without making a copy.
+  virtual BaseFloat ObjfPlus(const Clusterable &other) const;
+  virtual BaseFloat ObjfMinus(const Clusterable &other) const;
+  virtual BaseFloat Distance(const Clusterable &other) const;
   virtual ~GaussClusterable() {}
 
   BaseFloat count() const { return count_; }
@@ -98,6 +103,9 @@ class GaussClusterable: public Clusterable {
   double var_floor_;  // should be common for all objects created.
 
   void Read(std::istream &is, bool binary);
+  // Returns the objective function of these stats plus "scale" times the
+  // stats of "other" (or of just these stats, if other == NULL).
+  BaseFloat ObjfOfSum(const GaussClusterable *other, double scale) const;
 };
 
 /// @} end of "addtogroup clustering_group"
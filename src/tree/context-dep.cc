@@ -27,6 +27,25 @@ bool ContextDependency::Compute(const std::vector<int32> &phoneseq,
                                  int32 pdf_class,
                                  int32 *pdf_id) const {
   KALDI_ASSERT(static_cast<int32>(phoneseq.size()) == N_);
+  KALDI_ASSERT(pdf_id != NULL);
+  KALDI_COMPILE_TIME_ASSERT(kPdfClass == -1);  // the keys are -1, 0, ... N_-1.
+  if (flat_to_pdf_.IsValid()) {
+    // The keys are consecutive, so we can look the values up directly.
+    const int32 kBufSize = 16;  // enough for any sane context width.
+    EventValueType buf[kBufSize];
+    std::vector<EventValueType> vec;
+    EventValueType *values = buf;
+    if (N_ + 1 > kBufSize) {
+      vec.resize(N_ + 1);
+      values = &(vec[0]);
+    }
+    values[0] = pdf_class;
+    for (int32 i = 0; i < N_; i++) {
+      values[i + 1] = phoneseq[i];
+      KALDI_ASSERT(static_cast<EventAnswerType>(phoneseq[i]) != -1);  // >=0 ?
+    }
+    return flat_to_pdf_.MapDense(kPdfClass, N_ + 1, values, pdf_id);
+  }
   EventType  event_vec;
   event_vec.reserve(N_+1);
   event_vec.push_back(std::make_pair
@@ -38,7 +57,6 @@ bool ContextDependency::Compute(const std::vector<int32> &phoneseq,
                         (static_cast<EventKeyType>(i), static_cast<EventValueType>(phoneseq[i])));
     KALDI_ASSERT(static_cast<EventAnswerType>(phoneseq[i]) != -1);  // >=0 ?
   }
-  KALDI_ASSERT(pdf_id != NULL);
   return to_pdf_->Map(event_vec, pdf_id);
 }
 
@@ -172,6 +190,8 @@ void ContextDependency::Read (std::istream &is, bool binary) {
   }
   ExpectToken(is, binary, "EndContextDependency");
   to_pdf_ = to_pdf;
+  if (to_pdf_ != NULL) flat_to_pdf_.Init(*to_pdf_);
+  else flat_to_pdf_ = FlatEventMap();
 }
 
 void ContextDependency::GetPdfInfo(const std::vector<int32> &phones,
@@ -87,7 +87,9 @@ class ContextDependency: public ContextDependencyInterface {
   // Constructor takes ownership of pointers.
   ContextDependency(int32 N, int32 P,
                     EventMap *to_pdf):
-      N_(N), P_(P), to_pdf_(to_pdf) { }
+      N_(N), P_(P), to_pdf_(to_pdf) {
+    if (to_pdf_ != NULL) flat_to_pdf_.Init(*to_pdf_);
+  }
   void Write (std::ostream &os, bool binary) const;
 
   ~ContextDependency() { if (to_pdf_ != NULL) delete to_pdf_; }
@@ -107,6 +109,8 @@ class ContextDependency: public ContextDependencyInterface {
   int32 N_;  //
   int32 P_;
   EventMap *to_pdf_;  // owned here.
+  // Compiled copy of *to_pdf_, used by Compute() if valid.
+  FlatEventMap flat_to_pdf_;
 
   KALDI_DISALLOW_COPY_AND_ASSIGN(ContextDependency);
 };
@@ -308,6 +308,45 @@ void TestEventMapMapValues() {
 
 
 
+void TestFlatEventMap() {
+  for (size_t p = 0; p < 20; p++) {
+    // Consecutive keys starting from a possibly negative one, so we can test
+    // MapDense() too.
+    EventKeyType first_key = (rand() % 3) - 2;
+    int32 num_keys = 1 + (rand() % 5);
+    std::vector<EventKeyType> keys;
+    for (int32 i = 0; i < num_keys; i++) keys.push_back(first_key + i);
+    EventMap *em = RandomEventMap(keys);
+    FlatEventMap flat;
+    KALDI_ASSERT(flat.Init(*em) && flat.IsValid());
+    for (size_t q = 0; q < 20; q++) {
+      // Values a little outside [0, kMaxVal) and the odd missing key, to
+      // exercise the failure paths.
+      std::vector<EventValueType> values(num_keys);
+      EventType event;
+      for (int32 i = 0; i < num_keys; i++) {
+        values[i] = (rand() % (kMaxVal + 2)) - 1;
+        if (rand() % 10 != 0)
+          event.push_back(std::make_pair(keys[i], values[i]));
+      }
+      EventAnswerType ans, flat_ans;
+      bool ret = em->Map(event, &ans), flat_ret = flat.Map(event, &flat_ans);
+      KALDI_ASSERT(ret == flat_ret);
+      if (ret) { KALDI_ASSERT(ans == flat_ans); }
+      else { KALDI_ASSERT(flat_ans == -1); }
+
+      EventType full_event;
+      for (int32 i = 0; i < num_keys; i++)
+        full_event.push_back(std::make_pair(keys[i], values[i]));
+      ret = em->Map(full_event, &ans);
+      flat_ret = flat.MapDense(first_key, num_keys, &(values[0]), &flat_ans);
+      KALDI_ASSERT(ret == flat_ret);
+      if (ret) KALDI_ASSERT(ans == flat_ans);
+    }
+    delete em;
+  }
+}
+
 } // end namespace kaldi
 
 
@@ -323,5 +362,6 @@ int main() {
     TestEventMap();
     TestEventMapPrune();
     TestEventMapMapValues();
+    TestFlatEventMap();
   }
 }
@@ -489,4 +489,147 @@ bool GetTreeStructure(const EventMap &map,
 
 
 
+bool FlatEventMap::Init(const EventMap &emap) {
+  nodes_.clear();
+  children_.clear();
+  bits_.clear();
+  if (AddNode(emap) == -1) {
+    nodes_.clear();
+    children_.clear();
+    bits_.clear();
+    return false;
+  }
+  return true;
+}
+
+int32 FlatEventMap::AddNode(const EventMap &emap) {
+  int32 index = nodes_.size();
+  nodes_.resize(index + 1);
+  Node node;
+  node.key = 0;
+  node.offset = 0;
+  node.size = 0;
+  node.lowest = 0;
+  node.yes = -1;
+  node.no = -1;
+  if (const ConstantEventMap *c =
+      dynamic_cast<const ConstantEventMap*>(&emap)) {
+    node.type = kConstantNode;
+    node.offset = c->answer_;
+  } else if (const TableEventMap *t =
+             dynamic_cast<const TableEventMap*>(&emap)) {
+    node.type = kTableNode;
+    node.key = t->key_;
+    node.size = t->table_.size();
+    node.offset = children_.size();
+    // Reserve the children first so they are contiguous; the recursion
+    // appends the grandchildren after them.
+    children_.resize(children_.size() + node.size, -1);
+    for (int32 i = 0; i < node.size; i++) {
+      if (t->table_[i] != NULL) {
+        int32 child = AddNode(*(t->table_[i]));
+        if (child == -1) return -1;
+        children_[node.offset + i] = child;
+      }
+    }
+  } else if (const SplitEventMap *s =
+             dynamic_cast<const SplitEventMap*>(&emap)) {
+    node.type = kSplitNode;
+    node.key = s->key_;
+    const ConstIntegerSet<EventValueType> &yes_set = s->yes_set_;
+    if (!yes_set.empty()) {
+      node.lowest = *(yes_set.begin());
+      node.size = *(yes_set.end() - 1) - node.lowest + 1;
+    }
+    node.offset = bits_.size();
+    bits_.resize(bits_.size() + (node.size + 31) / 32, 0);
+    for (ConstIntegerSet<EventValueType>::iterator iter = yes_set.begin();
+         iter != yes_set.end(); ++iter) {
+      int32 i = *iter - node.lowest;
+      bits_[node.offset + i / 32] |= (static_cast<uint32>(1) << (i % 32));
+    }
+    node.yes = AddNode(*(s->yes_));
+    if (node.yes == -1) return -1;
+    node.no = AddNode(*(s->no_));
+    if (node.no == -1) return -1;
+  } else {
+    KALDI_WARN << "FlatEventMap: unknown EventMap type, not flattening.";
+    return -1;
+  }
+  nodes_[index] = node;
+  return index;
+}
+
+template<class LookupType>
+inline bool FlatEventMap::MapInternal(const LookupType &value_of,
+                                      EventAnswerType *ans) const {
+  *ans = -1;
+  if (nodes_.empty()) return false;
+  const Node *nodes = &(nodes_[0]);
+  const int32 *children = (children_.empty() ? NULL : &(children_[0]));
+  const uint32 *bits = (bits_.empty() ? NULL : &(bits_[0]));
+  const Node *node = nodes;
+  while (true) {
+    if (node->type == kConstantNode) {
+      *ans = node->offset;
+      return true;
+    }
+    EventValueType value;
+    if (!value_of(node->key, &value)) return false;
+    if (node->type == kTableNode) {
+      if (value < 0 || value >= node->size) return false;
+      int32 child = children[node->offset + value];
+      if (child == -1) return false;
+      node = nodes + child;
+    } else {  // kSplitNode.
+      // unsigned comparison also rejects value < node->lowest.
+      uint32 i = static_cast<uint32>(value - node->lowest);
+      bool yes = (i < static_cast<uint32>(node->size) &&
+                  (bits[node->offset + i / 32] >> (i % 32)) & 1);
+      node = nodes + (yes ? node->yes : node->no);
+    }
+  }
+}
+
+namespace {
+// Function objects used by FlatEventMap::Map() and MapDense().
+class SparseLookup {
+ public:
+  explicit SparseLookup(const EventType &event): event_(event) { }
+  inline bool operator () (EventKeyType key, EventValueType *value) const {
+    return EventMap::Lookup(event_, key, value);
+  }
+ private:
+  const EventType &event_;
+};
+
+class DenseLookup {
+ public:
+  DenseLookup(EventKeyType first_key, int32 num_keys,
+              const EventValueType *values):
+      first_key_(first_key), num_keys_(num_keys), values_(values) { }
+  inline bool operator () (EventKeyType key, EventValueType *value) const {
+    uint32 i = static_cast<uint32>(key - first_key_);
+    if (i >= static_cast<uint32>(num_keys_)) return false;
+    *value = values_[i];
+    return true;
+  }
+ private:
+  EventKeyType first_key_;
+  int32 num_keys_;
+  const EventValueType *values_;
+};
+}  // end anonymous namespace
+
+bool FlatEventMap::Map(const EventType &event, EventAnswerType *ans) const {
+  return MapInternal(SparseLookup(event), ans);
+}
+
+bool FlatEventMap::MapDense(EventKeyType first_key, int32 num_keys,
+                            const EventValueType *values,
+                            EventAnswerType *ans) const {
+  return MapInternal(DenseLookup(first_key, num_keys, values), ans);
+}
+
+
 } // end namespace kaldi
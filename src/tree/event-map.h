@@ -163,6 +163,8 @@ class EventMap {
 };
 
 
+class FlatEventMap;  // forward declaration; see below.
+
 class ConstantEventMap: public EventMap {
  public:
   virtual bool Map(const EventType &event, EventAnswerType *ans) const {
@@ -200,6 +202,7 @@ class ConstantEventMap: public EventMap {
   static ConstantEventMap *Read(std::istream &is, bool binary);
  private:
   EventAnswerType answer_;
+  friend class FlatEventMap;
   KALDI_DISALLOW_COPY_AND_ASSIGN(ConstantEventMap);
 };
 
@@ -260,6 +263,7 @@ class TableEventMap: public EventMap {
  private:
   EventKeyType key_;
   std::vector<EventMap*> table_;
+  friend class FlatEventMap;
   KALDI_DISALLOW_COPY_AND_ASSIGN(TableEventMap);
 };
 
@@ -337,9 +341,75 @@ class SplitEventMap: public EventMap {  // A decision tree [non-leaf] node.
   ConstIntegerSet<EventValueType> yes_set_;  // more efficient Map function.
   EventMap *yes_;  // owned here.
   EventMap *no_;  // owned here.
+  friend class FlatEventMap;
   SplitEventMap &operator = (const SplitEventMap &other);  // Disallow.
 };
 
+
+/**
+   FlatEventMap is a read-only, "compiled" form of an EventMap that is built
+   from a tree of ConstantEventMap, TableEventMap and SplitEventMap objects.
+   All the nodes live in one contiguous array, the children of table nodes in
+   a second array and the yes-sets of split nodes as bitmaps in a third, so a
+   lookup is a simple loop with no virtual function calls.  Its Map()
+   functions give the same answers as EventMap::Map() on the original map
+   (except that Map() on a failed lookup always sets *ans to -1).
+
+   It does not own or refer to the EventMap it was built from.  If that map
+   contains EventMap types it does not know about, IsValid() returns false and
+   the user should use the original map instead.
+ */
+class FlatEventMap {
+ public:
+  FlatEventMap() { }
+
+  /// Builds the flat form of "emap"; any existing contents are discarded.
+  /// Returns false (and leaves the object empty) if "emap" contains EventMap
+  /// types other than the three above.
+  bool Init(const EventMap &emap);
+
+  bool IsValid() const { return !nodes_.empty(); }
+
+  /// Equivalent to EventMap::Map() on the map we were initialized with.
+  bool Map(const EventType &event, EventAnswerType *ans) const;
+
+  /// A faster version of Map() for events whose keys are exactly
+  /// first_key, first_key + 1, ... first_key + num_keys - 1; values[i] is the
+  /// value of key first_key + i.  This is the form ContextDependency uses.
+  bool MapDense(EventKeyType first_key, int32 num_keys,
+                const EventValueType *values, EventAnswerType *ans) const;
+
+ private:
+  enum NodeType { kConstantNode = 0, kTableNode = 1, kSplitNode = 2 };
+  struct Node {
+    int32 type;  // a NodeType.
+    EventKeyType key;  // key queried at this node; unused for constant nodes.
+    // constant nodes: the answer.  table nodes: index of the first child in
+    // children_.  split nodes: index of the first word of the yes-set in bits_.
+    int32 offset;
+    // table nodes: the table size.  split nodes: the yes-set bitmap covers
+    // values [lowest, lowest + size).
+    int32 size;
+    EventValueType lowest;  // split nodes only.
+    int32 yes;  // split nodes only: index of the "yes" child in nodes_.
+    int32 no;  // split nodes only: index of the "no" child in nodes_.
+  };
+
+  // Appends the node for "emap" (and, recursively, its children) and returns
+  // its index in nodes_, or -1 if "emap" is of an unknown type.
+  int32 AddNode(const EventMap &emap);
+
+  // Follows the tree from the root; "value_of" is a function object whose
+  // operator () (key, &value) returns false if the key is not present.
+  template<class LookupType>
+  inline bool MapInternal(const LookupType &value_of,
+                          EventAnswerType *ans) const;
+
+  std::vector<Node> nodes_;  // nodes_[0] is the root, if nonempty.
+  std::vector<int32> children_;  // indexes into nodes_, or -1 for NULL.
+  std::vector<uint32> bits_;  // bitmaps of yes-sets.
+};
+
 /**
    This function gets the tree structure of the EventMap "map" in a convenient form.
    If "map" corresponds to a tree structure (not necessarily binary) with leaves
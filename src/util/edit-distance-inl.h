@@ -19,6 +19,8 @@
 
 #ifndef KALDI_UTIL_EDIT_DISTANCE_INL_H_
 #define KALDI_UTIL_EDIT_DISTANCE_INL_H_
+#include <cstdlib>
+#include <map>
 #include "util/stl-utils.h"
 
 
@@ -27,41 +29,79 @@ namespace kaldi {
 template<class T>
 int32 LevenshteinEditDistance(const std::vector<T> &a,
                               const std::vector<T> &b) {
-  // Algorithm:
-  //  write A and B for the sequences, with elements a_0 ..
-  //  let |A| = M and |B| = N be the lengths, and have
-  //  elements a_0 ... a_{M-1} and b_0 ... b_{N-1}.
-  //  We are computing the recursion
-  //     E(m, n) = min(  E(m-1, n-1) + (1-delta(a_{m-1}, b_{n-1})),
-  //                    E(m-1, n),
-  //                    E(m, n-1) ).
-  //  where E(m, n) is defined for m = 0..M and n = 0..N and out-of-
-  //  bounds quantities are considered to be infinity (i.e. the
-  //  recursion does not visit them).
-
-  // We do this computation using a vector e of size N+1.
-  // The outer iterations range over m = 0..M.
-
-  int M = a.size(), N = b.size();
-  std::vector<int32> e(N+1);
-  std::vector<int32> e_tmp(N+1);
-  // initialize e.
-  for (size_t i = 0; i < e.size(); i++)
-    e[i] = i;
-  for (int32 m = 1; m <= M; m++) {
-    // computing E(m, .) from E(m-1, .)
-    // handle special case n = 0:
-    e_tmp[0] = e[0] + 1;
-
-    for (int32 n = 1; n <= N; n++) {
-      int32 term1 = e[n-1] + (a[m-1] == b[n-1] ? 0 : 1);
-      int32 term2 = e[n] + 1;
-      int32 term3 = e_tmp[n-1] + 1;
-      e_tmp[n] = std::min(term1, std::min(term2, term3));
+  // We use the bit-parallel algorithm of Myers (1999), in the form given by
+  // Hyyro (2001) for the edit distance between whole sequences.  Write P for
+  // the shorter sequence ("pattern"), with M elements, and T for the other,
+  // with N elements, and D(i, j) for the edit distance between the first i
+  // elements of P and the first j of T.  Instead of the column D(., j) we
+  // keep the vertical differences D(i, j) - D(i-1, j), which are -1, 0 or 1,
+  // as two bit-vectors of length M: pv (+1) and mv (-1).  For each element
+  // of T, the next column is computed with a few bitwise operations and an
+  // addition on these; with M up to 64 they are single machine words, else
+  // vectors of words with the carries propagated.  This takes O(N * M / 64)
+  // time, instead of O(N * M).
+  const std::vector<T> &p = (a.size() <= b.size() ? a : b),
+      &t = (a.size() <= b.size() ? b : a);
+  int32 M = p.size(), N = t.size();
+  if (M == 0) return N;
+  int32 num_words = (M + 63) / 64;
+
+  // peq[r * num_words ...] is the bit-vector of the positions in P of the
+  // r'th distinct element of P; element_to_row maps elements to r.
+  std::map<T, int32> element_to_row;
+  std::vector<uint64> peq;
+  for (int32 i = 0; i < M; i++) {
+    typename std::map<T, int32>::iterator iter = element_to_row.find(p[i]);
+    int32 row;
+    if (iter == element_to_row.end()) {
+      row = element_to_row.size();
+      element_to_row[p[i]] = row;
+      peq.resize(peq.size() + num_words, 0);
+    } else {
+      row = iter->second;
     }
-    e = e_tmp;
+    peq[row * num_words + i / 64] |= static_cast<uint64>(1) << (i % 64);
   }
-  return e.back();
+  std::vector<uint64> zeros(num_words, 0),
+      pv(num_words, ~static_cast<uint64>(0)),  // D(i, 0) = i.
+      mv(num_words, 0);
+  // The bits above M in the last word are never looked at, and cannot affect
+  // the lower ones (carries and shifts only go upwards).
+  uint64 last_bit = static_cast<uint64>(1) << ((M - 1) % 64);
+  int32 score = M;  // D(M, j).
+  for (int32 j = 0; j < N; j++) {
+    typename std::map<T, int32>::const_iterator iter =
+        element_to_row.find(t[j]);
+    const uint64 *eq = (iter == element_to_row.end() ? &(zeros[0]) :
+                        &(peq[iter->second * num_words]));
+    // The horizontal differences D(0, j+1) - D(0, j) are 1, which are shifted
+    // in at the bottom.
+    uint64 add_carry = 0, ph_carry = 1, mh_carry = 0;
+    for (int32 w = 0; w < num_words; w++) {
+      uint64 e = eq[w], pvw = pv[w], mvw = mv[w];
+      uint64 xv = e | mvw;
+      uint64 x = e & pvw, sum = x + pvw;
+      uint64 carry = (sum < x ? 1 : 0);
+      sum += add_carry;
+      if (sum < add_carry) carry = 1;
+      add_carry = carry;
+      uint64 xh = (sum ^ pvw) | e;
+      uint64 ph = mvw | ~(xh | pvw);  // horizontal differences of +1 ...
+      uint64 mh = pvw & xh;  // ... and of -1.
+      if (w == num_words - 1) {
+        if (ph & last_bit) score++;
+        else if (mh & last_bit) score--;
+      }
+      uint64 ph_out = ph >> 63, mh_out = mh >> 63;
+      ph = (ph << 1) | ph_carry;
+      mh = (mh << 1) | mh_carry;
+      ph_carry = ph_out;
+      mh_carry = mh_out;
+      pv[w] = mh | ~(xv | ph);
+      mv[w] = ph & xv;
+    }
+  }
+  return score;
 }
 //
 struct error_stats{
@@ -75,53 +115,70 @@ struct error_stats{
 
 template<class T>
 int32 LevenshteinEditDistance(const std::vector<T> &ref,
-						      const std::vector<T> &hyp,
-						      int32 *ins, int32 *del, int32 *sub) {
+                              const std::vector<T> &hyp,
+                              int32 *ins, int32 *del, int32 *sub) {
+  // We first get the edit distance d with the fast version above.  The cells
+  // (ref_index, hyp_index) with a cost of at most d, which are all those that
+  // can be on the best path, have |ref_index - hyp_index| <= d, so we only
+  // compute the cells in that band; the others are treated as infinity.  The
+  // result, including the choice between equally good paths, is the same as
+  // if we computed all the cells.
+  const int32 kInf = std::numeric_limits<int32>::max() / 2;
+  int32 d = LevenshteinEditDistance(ref, hyp);
+  int32 R = ref.size(), H = hyp.size();
+  error_stats inf_stats;
+  inf_stats.ins_num = inf_stats.del_num = inf_stats.sub_num = 0;
+  inf_stats.total_cost = kInf;
   // temp sequence to remember error type and stats.
-  std::vector<error_stats> e(ref.size()+1);
-  std::vector<error_stats> cur_e(ref.size()+1);
+  std::vector<error_stats> e(R + 1, inf_stats);
+  std::vector<error_stats> cur_e(R + 1, inf_stats);
   // initialize the first hypothesis aligned to the reference at each
   // position:[hyp_index =0][ref_index]
-  for (size_t i =0; i < e.size(); i ++) {
-	e[i].ins_num = 0;
+  for (int32 i = 0; i <= std::min(R, d); i++) {
+    e[i].ins_num = 0;
     e[i].sub_num = 0;
-	e[i].del_num = i;
+    e[i].del_num = i;
     e[i].total_cost = i;
   }
 
- // for other alignments
- for (size_t hyp_index = 1; hyp_index <= hyp.size(); hyp_index ++) {
-   cur_e[0] = e[0];
-   cur_e[0].ins_num ++;
-   cur_e[0].total_cost ++;
-   for (size_t ref_index = 1; ref_index <= ref.size(); ref_index ++) {
-
-     int32 ins_err = e[ref_index].total_cost + 1;
-	 int32 del_err = cur_e[ref_index-1].total_cost + 1;
-     int32 sub_err = e[ref_index-1].total_cost;
- 	 if (hyp[hyp_index-1] != ref[ref_index-1])
-       sub_err ++;
-
-     if (sub_err < ins_err && sub_err < del_err) {
-	    cur_e[ref_index] =e[ref_index-1];
+  // for other alignments
+  for (int32 hyp_index = 1; hyp_index <= H; hyp_index++) {
+    int32 begin = std::max(1, hyp_index - d),
+        end = std::min(R, hyp_index + d);
+    if (hyp_index <= d) {
+      cur_e[0] = e[0];
+      cur_e[0].ins_num++;
+      cur_e[0].total_cost++;
+    } else {
+      cur_e[begin - 1] = inf_stats;  // it may be left from two rows ago.
+    }
+    for (int32 ref_index = begin; ref_index <= end; ref_index++) {
+      int32 ins_err = e[ref_index].total_cost + 1;
+      int32 del_err = cur_e[ref_index-1].total_cost + 1;
+      int32 sub_err = e[ref_index-1].total_cost;
+      if (hyp[hyp_index-1] != ref[ref_index-1])
+        sub_err++;
+
+      if (sub_err < ins_err && sub_err < del_err) {
+        cur_e[ref_index] = e[ref_index-1];
         if (hyp[hyp_index-1] != ref[ref_index-1])
-          cur_e[ref_index].sub_num ++;   // substitution error should be increased
-		cur_e[ref_index].total_cost = sub_err;
-     }else if (del_err < ins_err ) {
+          cur_e[ref_index].sub_num++;  // substitution error should be increased
+        cur_e[ref_index].total_cost = sub_err;
+      } else if (del_err < ins_err) {
         cur_e[ref_index] = cur_e[ref_index-1];
         cur_e[ref_index].total_cost = del_err;
-        cur_e[ref_index].del_num ++;    // deletion number is increased.
-     }else{
+        cur_e[ref_index].del_num++;  // deletion number is increased.
+      } else {
         cur_e[ref_index] = e[ref_index];
         cur_e[ref_index].total_cost = ins_err;
-		cur_e[ref_index].ins_num ++;    // insertion number is increased.
-     }
-   }
-   e = cur_e;  // alternate for the next recursion.
- }
-  size_t ref_index = e.size()-1;
-  *ins = e[ref_index].ins_num, *del = e[ref_index].del_num, *sub = e[ref_index].sub_num;
-  return e[ref_index].total_cost;
+        cur_e[ref_index].ins_num++;  // insertion number is increased.
+      }
+    }
+    e.swap(cur_e);  // alternate for the next recursion.
+  }
+  KALDI_ASSERT(e[R].total_cost == d);
+  *ins = e[R].ins_num, *del = e[R].del_num, *sub = e[R].sub_num;
+  return e[R].total_cost;
 }
 
 template<class T>
@@ -136,32 +193,37 @@ int32 LevenshteinAlignment(const std::vector<T> &a,
     for (size_t i = 0; i < b.size(); i++) KALDI_ASSERT(b[i] != eps_symbol);
   }
   output->clear();
-  // This is very memory-inefficiently implemented using a vector of vectors.
-  size_t M = a.size(), N = b.size();
-  size_t m, n;
-  std::vector<std::vector<int32> > e(M+1);
-  for (m = 0; m <=M; m++) e[m].resize(N+1);
-  for (n = 0; n <= N; n++)
-    e[0][n]  = n;
+  // As in the version of LevenshteinEditDistance() that outputs the numbers
+  // of errors, we only need the costs e(m, n) for |m - n| <= d, where d is
+  // the edit distance; they are stored in a matrix with 2d+1 columns, with
+  // e(m, n) in row m, column n - m + d.  The others are treated as infinity.
+  const int32 kInf = std::numeric_limits<int32>::max() / 2;
+  int32 M = a.size(), N = b.size(), m, n;
+  int32 d = LevenshteinEditDistance(a, b), width = 2 * d + 1;
+  std::vector<int32> e(static_cast<size_t>(M + 1) * width, kInf);
+#define KALDI_EDIT_COST(m, n) \
+  (std::abs((n) - (m)) > d ? kInf : e[(m) * width + (n) - (m) + d])
+  for (n = 0; n <= std::min(N, d); n++)
+    e[n + d] = n;
   for (m = 1; m <= M; m++) {
-    e[m][0] = e[m-1][0] + 1;
-    for (n = 1; n <= N; n++) {
-      int32 sub_or_ok = e[m-1][n-1] + (a[m-1] == b[n-1] ? 0 : 1);
-      int32 del = e[m-1][n] + 1;  // assumes a == ref, b == hyp.
-      int32 ins = e[m][n-1] + 1;
-      e[m][n] = std::min(sub_or_ok, std::min(del, ins));
+    if (m <= d) e[m * width - m + d] = m;  // e(m, 0) = m.
+    for (n = std::max(1, m - d); n <= std::min(N, m + d); n++) {
+      int32 sub_or_ok = KALDI_EDIT_COST(m-1, n-1) + (a[m-1] == b[n-1] ? 0 : 1);
+      int32 del = KALDI_EDIT_COST(m-1, n) + 1;  // assumes a == ref, b == hyp.
+      int32 ins = KALDI_EDIT_COST(m, n-1) + 1;
+      e[m * width + n - m + d] = std::min(sub_or_ok, std::min(del, ins));
     }
   }
   // get time-reversed output first: trace back.
   m = M; n = N;
   while (m != 0 || n != 0) {
-    size_t last_m, last_n;
+    int32 last_m, last_n;
     if (m == 0) { last_m = m; last_n = n-1; }
     else if (n == 0) { last_m = m-1; last_n = n; }
     else {
-      int32 sub_or_ok = e[m-1][n-1] + (a[m-1] == b[n-1] ? 0 : 1);
-      int32 del = e[m-1][n] + 1;  // assumes a == ref, b == hyp.
-      int32 ins = e[m][n-1] + 1;
+      int32 sub_or_ok = KALDI_EDIT_COST(m-1, n-1) + (a[m-1] == b[n-1] ? 0 : 1);
+      int32 del = KALDI_EDIT_COST(m-1, n) + 1;  // assumes a == ref, b == hyp.
+      int32 ins = KALDI_EDIT_COST(m, n-1) + 1;
       if (sub_or_ok <= std::min(del, ins)) {  // choose sub_or_ok if all else equal.
         last_m = m-1; last_n = n-1;
       } else {
@@ -179,11 +241,12 @@ int32 LevenshteinAlignment(const std::vector<T> &a,
     m = last_m;
     n = last_n;
   }
+#undef KALDI_EDIT_COST
   ReverseVector(output);
-  return e[M][N];
+  KALDI_ASSERT(e[M * width + N - M + d] == d);
+  return d;
 }
 
-
 }  // end namespace kaldi
 
 #endif // KALDI_UTIL_EDIT_DISTANCE_INL_H_
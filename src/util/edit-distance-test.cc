@@ -251,6 +251,116 @@ void TestLevenshteinAlignment() {
   }
 }
 
+// Simple implementations computing all the cells, for comparison with the
+// ones in edit-distance-inl.h, which compute only some of them; the choice
+// between equally good paths is made in the same way.
+int32 ReferenceEditDistance(const std::vector<int32> &ref,
+                            const std::vector<int32> &hyp,
+                            int32 *ins, int32 *del, int32 *sub) {
+  int32 R = ref.size(), H = hyp.size();
+  // stats[r] is (cost, ins, del, sub) for the current row.
+  std::vector<std::vector<int32> > prev(R + 1, std::vector<int32>(4, 0)), cur;
+  for (int32 r = 0; r <= R; r++) prev[r][0] = prev[r][2] = r;
+  for (int32 h = 1; h <= H; h++) {
+    cur = prev;
+    cur[0][0]++;
+    cur[0][1]++;
+    for (int32 r = 1; r <= R; r++) {
+      bool same = (hyp[h-1] == ref[r-1]);
+      int32 ins_err = prev[r][0] + 1, del_err = cur[r-1][0] + 1,
+          sub_err = prev[r-1][0] + (same ? 0 : 1);
+      if (sub_err < ins_err && sub_err < del_err) {
+        cur[r] = prev[r-1];
+        cur[r][0] = sub_err;
+        if (!same) cur[r][3]++;
+      } else if (del_err < ins_err) {
+        cur[r] = cur[r-1];
+        cur[r][0] = del_err;
+        cur[r][2]++;
+      } else {
+        cur[r] = prev[r];
+        cur[r][0] = ins_err;
+        cur[r][1]++;
+      }
+    }
+    prev = cur;
+  }
+  *ins = prev[R][1];
+  *del = prev[R][2];
+  *sub = prev[R][3];
+  return prev[R][0];
+}
+
+int32 ReferenceAlignment(const std::vector<int32> &a,
+                         const std::vector<int32> &b, int32 eps_symbol,
+                         std::vector<std::pair<int32, int32> > *output) {
+  int32 M = a.size(), N = b.size();
+  std::vector<std::vector<int32> > e(M + 1, std::vector<int32>(N + 1));
+  for (int32 n = 0; n <= N; n++) e[0][n] = n;
+  for (int32 m = 1; m <= M; m++) {
+    e[m][0] = m;
+    for (int32 n = 1; n <= N; n++)
+      e[m][n] = std::min(e[m-1][n-1] + (a[m-1] == b[n-1] ? 0 : 1),
+                         std::min(e[m-1][n], e[m][n-1]) + 1);
+  }
+  output->clear();
+  int32 m = M, n = N;
+  while (m != 0 || n != 0) {
+    int32 last_m = m - 1, last_n = n - 1;
+    if (m == 0) {
+      last_m = m;
+    } else if (n == 0) {
+      last_n = n;
+    } else {
+      int32 sub_or_ok = e[m-1][n-1] + (a[m-1] == b[n-1] ? 0 : 1),
+          del = e[m-1][n] + 1, ins = e[m][n-1] + 1;
+      if (sub_or_ok > std::min(del, ins)) {
+        if (del <= ins) last_n = n;
+        else last_m = m;
+      }
+    }
+    output->push_back(std::make_pair(last_m == m ? eps_symbol : a[last_m],
+                                     last_n == n ? eps_symbol : b[last_n]));
+    m = last_m;
+    n = last_n;
+  }
+  std::reverse(output->begin(), output->end());
+  return e[M][N];
+}
+
+// Tests with longer sequences (the bit-parallel code uses more than one word
+// for more than 64 elements), both similar and very different ones.
+void TestEditDistanceLong() {
+  for (int32 i = 0; i < 200; i++) {
+    int32 ref_len = rand() % 200, vocab_size = 1 + rand() % 20;
+    std::vector<int32> ref(ref_len), hyp;
+    for (int32 j = 0; j < ref_len; j++) ref[j] = rand() % vocab_size;
+    if (i % 2 == 0) {  // a few errors.
+      for (int32 j = 0; j < ref_len; j++) {
+        int32 r = rand() % 10;
+        if (r == 0) continue;
+        hyp.push_back(r == 1 ? rand() % vocab_size : ref[j]);
+        if (r == 2) hyp.push_back(rand() % vocab_size);
+      }
+    } else {
+      hyp.resize(rand() % 200);
+      for (size_t j = 0; j < hyp.size(); j++) hyp[j] = rand() % vocab_size;
+    }
+    int32 ins, del, sub, ins2, del2, sub2;
+    int32 cost = ReferenceEditDistance(ref, hyp, &ins, &del, &sub);
+    KALDI_ASSERT(LevenshteinEditDistance(ref, hyp) == cost);
+    KALDI_ASSERT(LevenshteinEditDistance(hyp, ref) == cost);
+    KALDI_ASSERT(LevenshteinEditDistance(ref, hyp, &ins2, &del2, &sub2) ==
+                 cost);
+    KALDI_ASSERT(ins == ins2 && del == del2 && sub == sub2);
+
+    std::vector<std::pair<int32, int32> > ali, ali2;
+    KALDI_ASSERT(ReferenceAlignment(ref, hyp, -1, &ali) == cost);
+    KALDI_ASSERT(LevenshteinAlignment(ref, hyp, -1, &ali2) == cost);
+    KALDI_ASSERT(ali == ali2);
+  }
+}
+
 } // end namespace kaldi
 
 int main() {
@@ -260,6 +370,7 @@ int main() {
   TestEditDistance2();
   TestEditDistance2String();
   TestLevenshteinAlignment();
+  TestEditDistanceLong();
   std::cout << "Test OK\n";
 }
 
@@ -29,7 +29,9 @@
 
 namespace kaldi {
 
-// Compute the edit-distance between two strings.
+// Compute the edit-distance between two strings.  This uses a bit-parallel
+// algorithm, taking time proportional to |a| * |b| / 64; T must have
+// operator <.
 template<class T>
 int32 LevenshteinEditDistance(const std::vector<T> &a,
                               const std::vector<T> &b);
@@ -38,6 +40,8 @@ int32 LevenshteinEditDistance(const std::vector<T> &a,
 // edit distance calculation with conventional method.
 // note: noise word must be filtered out from the hypothesis and reference sequence
 // before the following procedure conducted.
+// Only the cells of the dynamic programming table within the edit distance
+// of the diagonal are computed, so this is fast when the error rate is low.
 template<class T>
 int32 LevenshteinEditDistance(const std::vector<T> &ref,
                               const std::vector<T> &hyp,
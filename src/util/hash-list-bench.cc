@@ -0,0 +1,150 @@
+// util/hash-list-bench.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include "util/hash-list.h"
+#include "util/kaldi-bench.h"
+#include "util/open-hash-list.h"
+
+namespace kaldi {
+
+struct DummyToken {
+  float cost;
+  int32 num_refs;
+};
+
+// A hash function for making a random-looking but deterministic graph.
+inline uint32 Mix(uint32 a, uint32 b) {
+  uint32 h = a * 2654435761U + b * 40503U;
+  h ^= h >> 15;
+  h *= 2246822519U;
+  h ^= h >> 13;
+  return h;
+}
+
+// This simulates the way the decoders use the token map: on each frame we
+// take the list of tokens from the previous frame, and for each of them we
+// look up and possibly insert the successor states in a large graph; then we
+// delete the previous frame's Elems.  Each state has three successors, two of
+// them nearby (as is typical of real decoding graphs) and one anywhere, and
+// successors are "pruned" at random so that the number of active states stays
+// around num_active.  Everything is deterministic and independent of the order
+// of the list, so both versions should do exactly the same work; we return the
+// total number of tokens created, as a check.
+template<class HashType>
+size_t SimulateDecoding(int32 num_states, int32 num_active, int32 num_frames,
+                        HashType *hash, std::vector<DummyToken> *tokens) {
+  typedef typename HashType::Elem Elem;
+  size_t tot_toks = 0, num_toks = 0;
+  hash->SetSize(2 * num_active);
+  for (int32 i = 0; i < num_active; i++) {
+    int32 s = Mix(i, 0) % num_states;
+    if (hash->Find(s) == NULL) {
+      hash->Insert(s, &((*tokens)[num_toks % tokens->size()]));
+      num_toks++;
+    }
+  }
+  for (int32 f = 0; f < num_frames; f++) {
+    // keep each successor with this probability (times 2^16).
+    uint32 keep = std::min<uint32>(65536, (65536.0 * num_active) /
+                                   (3.0 * num_toks));
+    Elem *last = hash->Clear(), *tail;
+    hash->SetSize(2 * num_active);
+    num_toks = 0;
+    for (Elem *e = last; e != NULL; e = tail) {
+      int32 s = e->key;
+      for (int32 a = 0; a < 3; a++) {
+        int32 range = (a == 2 ? num_states : 100),
+            next_state = (s + 1 + Mix(s, a) % range) % num_states;
+        if ((Mix(next_state, f) & 65535) >= keep) continue;  // pruned.
+        Elem *found = hash->Find(next_state);
+        if (found == NULL) {
+          hash->Insert(next_state, &((*tokens)[num_toks % tokens->size()]));
+          num_toks++;
+        } else {
+          found->val->cost += 1.0;
+        }
+      }
+      tail = e->tail;
+      hash->Delete(e);
+    }
+    if (num_toks == 0) break;
+    tot_toks += num_toks;
+  }
+  Elem *last = hash->Clear(), *tail;
+  for (Elem *e = last; e != NULL; e = tail) {
+    tail = e->tail;
+    hash->Delete(e);
+  }
+  return tot_toks;
+}
+
+// Runs SimulateDecoding() once per call; the number of tokens created is
+// checked against that of the other hash type.
+template<class HashType>
+class HashListBench {
+ public:
+  HashListBench(int32 num_states, int32 num_active, int32 num_frames):
+      num_states_(num_states), num_active_(num_active),
+      num_frames_(num_frames), tokens_(num_active), tot_toks_(0) { }
+  void operator() () {
+    tot_toks_ = SimulateDecoding(num_states_, num_active_, num_frames_,
+                                 &hash_, &tokens_);
+  }
+  size_t TotToks() const { return tot_toks_; }
+ private:
+  int32 num_states_, num_active_, num_frames_;
+  HashType hash_;
+  std::vector<DummyToken> tokens_;
+  size_t tot_toks_;
+};
+
+void HashListBenchmarks(int32 num_states, int32 num_active) {
+  int32 num_frames = 3000000 / (num_active * 3) + 1;
+  std::ostringstream params;
+  params << "num_states=" << num_states << " num_active=" << num_active
+         << " num_frames=" << num_frames;
+  HashListBench<HashList<int32, DummyToken*> > bench1(num_states, num_active,
+                                                     num_frames);
+  double time1 = TimeBenchmark(bench1, 3, 0.0);
+  PrintBenchmarkResult("HashList", params.str(), time1,
+                       bench1.TotToks(), "tokens");
+  HashListBench<OpenHashList<int32, DummyToken*> > bench2(num_states,
+                                                         num_active,
+                                                         num_frames);
+  double time2 = TimeBenchmark(bench2, 3, 0.0);
+  PrintBenchmarkResult("OpenHashList", params.str(), time2,
+                       bench2.TotToks(), "tokens");
+  KALDI_ASSERT(bench1.TotToks() == bench2.TotToks());
+}
+
+} // end namespace kaldi
+
+
+int main() {
+  using namespace kaldi;
+  HashListBenchmarks(100000, 1000);
+  HashListBenchmarks(1000000, 10000);
+  HashListBenchmarks(10000000, 50000);
+  HashListBenchmarks(10000000, 200000);
+  return 0;
+}
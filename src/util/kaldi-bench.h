@@ -0,0 +1,96 @@
+// util/kaldi-bench.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_KALDI_BENCH_H_
+#define KALDI_UTIL_KALDI_BENCH_H_
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "base/kaldi-common.h"
+#include "util/timer.h"
+
+namespace kaldi {
+
+// This file contains the helpers used by the benchmark programs (the
+// *-bench.cc files, which are listed as BENCHFILES in the Makefiles and are
+// built and run by "make bench").  Each benchmark prints one line of JSON per
+// result to the standard output, e.g.
+// {"benchmark": "DiagGmm::LogLikelihoods", "params": "dim=40 num_gauss=1000",
+//  "seconds": 2.1e-05, "rate": 3.8e+09, "unit": "flops"}
+// where "seconds" is the time per call and "rate" is the work per second, so
+// the results of different versions can be compared by a script.  To make the
+// results reproducible, benchmarks should use fixed sizes and fixed random
+// seeds.
+
+/// Times calls to f(), where "f" is a functor; returns the time per call in
+/// seconds.  We do one call to warm up, then "num_runs" runs each of which
+/// calls f() for at least min_seconds / num_runs seconds, and return the
+/// fastest run's time per call (the fastest is the least affected by other
+/// things happening on the machine).
+template<class F>
+double TimeBenchmark(F &f, int32 num_runs = 5, double min_seconds = 0.5) {
+  KALDI_ASSERT(num_runs > 0);
+  f();
+  double best = -1.0;
+  for (int32 r = 0; r < num_runs; r++) {
+    Timer timer;
+    int32 num_calls = 0;
+    double elapsed;
+    do {
+      f();
+      num_calls++;
+    } while ((elapsed = timer.Elapsed()) < min_seconds / num_runs);
+    double per_call = elapsed / num_calls;
+    if (best < 0.0 || per_call < best) best = per_call;
+  }
+  return best;
+}
+
+inline std::string BenchmarkJsonEscape(const std::string &str) {
+  std::string ans;
+  for (size_t i = 0; i < str.size(); i++) {
+    if (str[i] == '"' || str[i] == '\\') ans += '\\';
+    ans += str[i];
+  }
+  return ans;
+}
+
+/// Prints a result as a line of JSON (see above).  "work" is the amount of
+/// work done per call, in units of "unit" (e.g. flops, bytes or frames); if
+/// "unit" is empty, no rate is printed.
+inline void PrintBenchmarkResult(const std::string &name,
+                                 const std::string &params,
+                                 double seconds,
+                                 double work = 0.0,
+                                 const std::string &unit = "") {
+  std::ostringstream os;
+  os << "{\"benchmark\": \"" << BenchmarkJsonEscape(name)
+     << "\", \"params\": \"" << BenchmarkJsonEscape(params)
+     << "\", \"seconds\": " << seconds;
+  if (!unit.empty())
+    os << ", \"rate\": " << (seconds > 0.0 ? work / seconds : 0.0)
+       << ", \"unit\": \"" << BenchmarkJsonEscape(unit) << "\"";
+  os << "}\n";
+  std::cout << os.str() << std::flush;
+}
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_KALDI_BENCH_H_
@@ -93,6 +93,11 @@ template<class KaldiType> class KaldiObjectHolder {
     return *t_;
   }
 
+  T &Value() {
+    if (!t_) KALDI_ERR << "KaldiObjectHolder::Value() called wrongly.";
+    return *t_;
+  }
+
   ~KaldiObjectHolder() { if (t_) delete t_; }
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(KaldiObjectHolder);
@@ -175,6 +180,10 @@ template<class BasicType> class BasicHolder {
     return t_;
   }
 
+  T &Value() {
+    return t_;
+  }
+
   ~BasicHolder() { }
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(BasicHolder);
@@ -280,6 +289,7 @@ template<class BasicType> class BasicVectorHolder {
   static bool IsReadInBinary() { return true; }
 
   const T &Value() const {  return t_; }
+  T &Value() {  return t_; }
 
   ~BasicVectorHolder() { }
  private:
@@ -412,6 +422,7 @@ template<class BasicType> class BasicVectorVectorHolder {
   static bool IsReadInBinary() { return true; }
 
   const T &Value() const {  return t_; }
+  T &Value() {  return t_; }
 
   ~BasicVectorVectorHolder() { }
  private:
@@ -546,6 +557,7 @@ template<class BasicType> class BasicPairVectorHolder {
   static bool IsReadInBinary() { return true; }
 
   const T &Value() const {  return t_; }
+  T &Value() {  return t_; }
 
   ~BasicPairVectorHolder() { }
  private:
@@ -594,6 +606,7 @@ class TokenHolder {
   static bool IsReadInBinary() { return false; }
 
   const T &Value() const { return t_; }
+  T &Value() { return t_; }
 
   ~TokenHolder() { }
  private:
@@ -646,6 +659,7 @@ class TokenVectorHolder {
   static bool IsReadInBinary() { return false; }
 
   const T &Value() const { return t_; }
+  T &Value() { return t_; }
 
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(TokenVectorHolder);
@@ -684,6 +698,7 @@ class HtkMatrixHolder {
   static bool IsReadInBinary() { return true; }
 
   const T &Value() const { return t_; }
+  T &Value() { return t_; }
 
 
   // No destructor.
@@ -784,6 +799,7 @@ template<int kFeatDim> class SphinxMatrixHolder {
   static bool IsReadInBinary() { return true; }
 
   const T &Value() const { return feats_; }
+  T &Value() { return feats_; }
 
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(SphinxMatrixHolder);
@@ -123,6 +123,12 @@ template<class SomeType> class GenericHolder {
   /// true (so OK to throw exception if no object was read).
   const T &Value() const { return t_; } // if t is a pointer, would return *t_;
 
+  /// The non-const version of Value(), used by SequentialTableReader::Value()
+  /// so that the program can Swap() the object out instead of copying it.
+  /// After that, the holder need not hold a valid object; Read() or Clear()
+  /// will be called before Value() is called again.
+  T &Value() { return t_; }
+
   /// The Clear() function doesn't have to do anything.  Its purpose is to
   /// allow the object to free resources if they're no longer needed.
   void Clear() { }
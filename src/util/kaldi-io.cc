@@ -23,6 +23,7 @@
 #include <errno.h>
 
 #include "util/kaldi-pipebuf.h"
+#include "util/kaldi-lz4.h"
 namespace kaldi {
 
 #ifndef _MSC_VER // on VS, we don't need this type.
@@ -181,6 +182,51 @@ class FileOutputImpl: public OutputImplBase {
   std::ofstream os_;
 };
 
+class Lz4FileOutputImpl: public OutputImplBase {
+ public:
+  Lz4FileOutputImpl(): buf_(NULL), os_(NULL) { }
+
+  virtual bool Open(const std::string &filename, bool binary) {
+    if (os_ != NULL) KALDI_ERR << "Lz4FileOutputImpl::Open(), "
+                               << "open called on already open file.";
+    filename_ = filename;
+    // The compressed file is binary, whatever the mode of its contents.
+    file_os_.open(filename_.c_str(), std::ios_base::out|std::ios_base::binary);
+    if (!file_os_.is_open()) return false;
+    buf_ = new Lz4OutputBuf(&file_os_);
+    os_ = new std::ostream(buf_);
+    return file_os_.good();
+  }
+
+  virtual std::ostream &Stream() {
+    if (os_ == NULL)
+      KALDI_ERR << "Lz4FileOutputImpl::Stream(), file is not open.";
+    return *os_;
+  }
+
+  virtual bool Close() {
+    if (os_ == NULL)
+      KALDI_ERR << "Lz4FileOutputImpl::Close(), file is not open.";
+    bool ok = !os_->fail();
+    ok = buf_->Finish() && ok;
+    delete os_;
+    os_ = NULL;
+    delete buf_;
+    buf_ = NULL;
+    file_os_.close();
+    return ok && !file_os_.fail();
+  }
+  virtual ~Lz4FileOutputImpl() {
+    if (os_ != NULL && !Close())
+      KALDI_ERR << "Error closing output file " << filename_;
+  }
+ private:
+  std::string filename_;
+  std::ofstream file_os_;  // the compressed file.
+  Lz4OutputBuf *buf_;
+  std::ostream *os_;  // the stream that writes through buf_.
+};
+
 class StandardOutputImpl: public OutputImplBase {
  public:
   StandardOutputImpl(): is_open_(false) { }
@@ -351,6 +397,48 @@ class FileInputImpl: public InputImplBase {
 };
 
 
+class Lz4FileInputImpl: public InputImplBase {
+ public:
+  Lz4FileInputImpl(): buf_(NULL), is_(NULL) { }
+
+  virtual bool Open(const std::string &filename, bool binary) {
+    if (is_ != NULL) KALDI_ERR << "Lz4FileInputImpl::Open(), "
+                               << "open called on already open file.";
+    file_is_.open(filename.c_str(), std::ios_base::in|std::ios_base::binary);
+    if (!file_is_.is_open()) return false;
+    buf_ = new Lz4InputBuf(&file_is_);
+    is_ = new std::istream(buf_);
+    return buf_->Init();
+  }
+
+  virtual std::istream &Stream() {
+    if (is_ == NULL)
+      KALDI_ERR << "Lz4FileInputImpl::Stream(), file is not open.";
+    return *is_;
+  }
+
+  virtual void Close() {
+    if (is_ == NULL)
+      KALDI_ERR << "Lz4FileInputImpl::Close(), file is not open.";
+    delete is_;
+    is_ = NULL;
+    delete buf_;
+    buf_ = NULL;
+    file_is_.close();
+  }
+
+  virtual InputType MyType() { return kFileInput; }
+
+  virtual ~Lz4FileInputImpl() {
+    if (is_ != NULL) Close();
+  }
+ private:
+  std::ifstream file_is_;  // the compressed file.
+  Lz4InputBuf *buf_;
+  std::istream *is_;  // the stream that reads through buf_.
+};
+
+
 class StandardInputImpl: public InputImplBase {
  public:
   StandardInputImpl(): is_open_(false) { }
@@ -486,6 +574,8 @@ class OffsetFileInputImpl: public InputImplBase {
   // This class is a bit more complicated than the
 
  public:
+  OffsetFileInputImpl(): binary_(false), lz4_buf_(NULL), lz4_is_(NULL) { }
+
   // splits a filename like /my/file:123 into /my/file and the
   // number 123.  Crashes if not this format.
   static void SplitFilename(const std::string &rxfilename,
@@ -505,22 +595,24 @@ class OffsetFileInputImpl: public InputImplBase {
   }
 
   bool Seek(size_t offset) {
-    size_t cur_pos = is_.tellg();
+    std::istream &is = MyStream();
+    size_t cur_pos = is.tellg();
     if (cur_pos == offset) return true;
     else if (cur_pos<offset && cur_pos+100 > offset) {
       // We're close enough that it may be faster to just
       // read that data, rather than seek.
       for (size_t i = cur_pos; i < offset; i++)
-        is_.get();
-      return (is_.tellg() == std::streampos(offset));
+        is.get();
+      return (is.tellg() == std::streampos(offset));
     }
-    // Try to actually seek.
-    is_.seekg(offset, std::ios_base::beg);
-    if (is_.fail()) {  // failbit or badbit is set [error happened]
-      is_.close();
+    // Try to actually seek.  For compressed files the offset is in the
+    // uncompressed data, and Lz4InputBuf finds the block it is in.
+    is.seekg(offset, std::ios_base::beg);
+    if (is.fail()) {  // failbit or badbit is set [error happened]
+      CloseFile();
       return false;  // failure.
     } else {
-      is_.clear();  // Clear any failure bits (e.g. eof).
+      is.clear();  // Clear any failure bits (e.g. eof).
       return true;  // success.
     }
   }
@@ -537,23 +629,20 @@ class OffsetFileInputImpl: public InputImplBase {
       size_t offset;
       SplitFilename(rxfilename, &tmp_filename, &offset);
       if (tmp_filename == filename_ && binary == binary_) {  // Just seek
-        is_.clear();  // clear fail bit, etc.
+        MyStream().clear();  // clear fail bit, etc.
         return Seek(offset);
       } else {
-        is_.close();  // don't bother checking error status of is_.
+        CloseFile();  // don't bother checking error status of is_.
         filename_ = tmp_filename;
-        is_.open(filename_.c_str(), binary ? std::ios_base::in|std::ios_base::binary
-                 : std::ios_base::in);
-        if (!is_.is_open()) return false;
+        binary_ = binary;
+        if (!OpenFile()) return false;
         else return Seek(offset);
       }
     } else {
       size_t offset;
       SplitFilename(rxfilename, &filename_, &offset);
       binary_ = binary;
-      is_.open(filename_.c_str(), binary ? std::ios_base::in|std::ios_base::binary
-               : std::ios_base::in);
-      if (!is_.is_open()) return false;
+      if (!OpenFile()) return false;
       else return Seek(offset);
     }
   }
@@ -561,13 +650,13 @@ class OffsetFileInputImpl: public InputImplBase {
   virtual std::istream &Stream() {
     if (!is_.is_open()) KALDI_ERR << "FileInputImpl::Stream(), file is not open.";
     // I believe this error can only arise from coding error.
-    return is_;
+    return MyStream();
   }
 
   virtual void Close() {
     if (!is_.is_open()) KALDI_ERR << "FileInputImpl::Close(), file is not open.";
     // I believe this error can only arise from coding error.
-    is_.close();
+    CloseFile();
     // Don't check status.
   }
 
@@ -576,11 +665,44 @@ class OffsetFileInputImpl: public InputImplBase {
   virtual ~OffsetFileInputImpl() {
     // Stream will automatically be closed, and we don't care about
     // whether it fails.
+    CloseFile();
   }
  private:
+  // Opens filename_, and if it is compressed, the decompressing stream.
+  bool OpenFile() {
+    bool lz4 = IsLz4Filename(filename_);
+    is_.open(filename_.c_str(), binary_ || lz4 ?
+             std::ios_base::in|std::ios_base::binary : std::ios_base::in);
+    if (!is_.is_open()) return false;
+    if (lz4) {
+      lz4_buf_ = new Lz4InputBuf(&is_);
+      lz4_is_ = new std::istream(lz4_buf_);
+      if (!lz4_buf_->Init()) {
+        CloseFile();
+        return false;
+      }
+    }
+    return true;
+  }
+  void CloseFile() {
+    delete lz4_is_;
+    lz4_is_ = NULL;
+    delete lz4_buf_;
+    lz4_buf_ = NULL;
+    if (is_.is_open()) is_.close();
+  }
+  std::istream &MyStream() {
+    if (lz4_is_ != NULL) return *lz4_is_;
+    else return is_;
+  }
+
   std::string filename_;  // the actual filename
   bool binary_;  // true if was opened in binary mode.
   std::ifstream is_;
+  // For compressed files (see IsLz4Filename()), the stream that decompresses
+  // is_; NULL otherwise.
+  Lz4InputBuf *lz4_buf_;
+  std::istream *lz4_is_;
 };
 
 
@@ -640,7 +762,8 @@ bool Output::Open(const std::string &wxfn, bool binary, bool header) {
   KALDI_ASSERT(impl_ == NULL);
 
   if (type ==  kFileOutput) {
-    impl_ = new FileOutputImpl();
+    if (IsLz4Filename(wxfn)) impl_ = new Lz4FileOutputImpl();
+    else impl_ = new FileOutputImpl();
   } else if (type == kStandardOutput) {
     impl_ = new StandardOutputImpl();
   } else if (type == kPipeOutput) {
@@ -707,7 +830,8 @@ bool Input::OpenInternal(const std::string &rxfilename,
     }
   }
   if (type ==  kFileInput) {
-    impl_ = new FileInputImpl();
+    if (IsLz4Filename(rxfilename)) impl_ = new Lz4FileInputImpl();
+    else impl_ = new FileInputImpl();
   } else if (type == kStandardInput) {
     impl_ = new StandardInputImpl();
   } else if (type == kPipeInput) {
@@ -739,5 +863,47 @@ std::istream &Input::Stream() {
 }
 
 
+std::istream *InputCache::Open(const std::string &rxfilename, bool text_mode) {
+  Input *input;
+  if (ClassifyRxfilename(rxfilename) != kOffsetFileInput) {
+    input = &other_;
+  } else {
+    std::string filename(rxfilename, 0, rxfilename.find_last_of(':'));
+    std::list<std::pair<std::string, Input*> >::iterator iter = files_.begin();
+    for (; iter != files_.end(); ++iter)
+      if (iter->first == filename) break;
+    if (iter != files_.end()) {  // Move it to the front.
+      files_.splice(files_.begin(), files_, iter);
+    } else {
+      if (static_cast<int32>(files_.size()) >= max_open_ && !files_.empty()) {
+        delete files_.back().second;
+        files_.pop_back();
+      }
+      files_.push_front(std::make_pair(filename, new Input()));
+    }
+    input = files_.front().second;
+  }
+  // For an offset into a file that is already open, this just seeks.
+  bool ans = (text_mode ? input->OpenTextMode(rxfilename) :
+              input->Open(rxfilename, NULL));
+  if (!ans) {
+    if (input != &other_) {  // Don't keep failed Inputs.
+      delete files_.front().second;
+      files_.pop_front();
+    }
+    return NULL;
+  }
+  return &(input->Stream());
+}
+
+void InputCache::Close() {
+  for (std::list<std::pair<std::string, Input*> >::iterator iter =
+           files_.begin(); iter != files_.end(); ++iter)
+    delete iter->second;
+  files_.clear();
+  if (other_.IsOpen()) other_.Close();
+}
+
+
 
 }  // end namespace kaldi
@@ -21,7 +21,9 @@
 
 #include <cctype>  // For isspace.
 #include <limits>
+#include <list>
 #include <string>
+#include <utility>
 #include "base/kaldi-common.h"
 #ifdef _MSC_VER
 # include <fcntl.h>
@@ -68,6 +70,11 @@ class InputImplBase;  // Forward decl; defined in a .cc file
 //   [these are created by the Table and TableWriter classes; I may also write
 //    a program that creates them for arbitrary files]
 //
+// Filenames ending in ".lz4" (for both reading and writing, and with offsets,
+// as in "/mnt/blah/data/1.ark.lz4:24871") are read and written as
+// LZ4-compressed files; see kaldi-lz4.h.  Offsets into such files are
+// positions in the uncompressed data.
+//
 
 
 // Typical usage:
@@ -227,6 +234,36 @@ class Input {
   KALDI_DISALLOW_COPY_AND_ASSIGN(Input);
 };
 
+/// InputCache keeps a number of files open, for reading from rxfilenames that
+/// are offsets into a few files, as in scp files that point into several
+/// archives: reading "a.ark:1234", then "b.ark:52", then "a.ark:9012" opens
+/// a.ark only once and seeks within it (where an Input object would reopen
+/// it).  Other kinds of rxfilename are opened as by Input.  It is not
+/// thread-safe.
+class InputCache {
+ public:
+  /// "max_open" is the maximum number of files kept open; the least recently
+  /// used one is closed when we need to open another.
+  explicit InputCache(int32 max_open = 16): max_open_(max_open) { }
+
+  /// Opens "rxfilename" as Input::Open(rxfilename, NULL) would (or
+  /// Input::OpenTextMode() if text_mode == true), and returns the stream, or
+  /// NULL on failure.  The stream is only valid until the next call to
+  /// Open() or Close().
+  std::istream *Open(const std::string &rxfilename, bool text_mode = false);
+
+  /// Closes all the files.
+  void Close();
+
+  ~InputCache() { Close(); }
+ private:
+  // The open files, most recently used first, as (filename, Input).
+  std::list<std::pair<std::string, Input*> > files_;
+  Input other_;  // For rxfilenames that are not offsets into files.
+  int32 max_open_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(InputCache);
+};
+
 template <class C> inline void ReadKaldiObject(const std::string &filename,
                                                C *c) {
   bool binary_in;
@@ -0,0 +1,176 @@
+// util/kaldi-lz4-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include "base/io-funcs.h"
+#include "base/kaldi-math.h"
+#include "util/kaldi-lz4.h"
+#include "util/kaldi-io.h"
+#include "util/kaldi-table.h"
+#include "util/kaldi-holder.h"
+#include "util/table-types.h"
+#ifndef _MSC_VER
+#include <unistd.h>
+#endif
+
+namespace kaldi {
+
+// Random data of the given size; "alphabet" controls how compressible it is,
+// and with probability 1/2 we also copy earlier stretches, as in real data.
+static std::string RandData(size_t size, int32 alphabet) {
+  std::string ans;
+  while (ans.size() < size) {
+    if (ans.size() > 10 && rand() % 2 == 0) {
+      size_t start = rand() % ans.size(), len = 1 + rand() % 300;
+      for (size_t i = 0; i < len; i++)  // may overlap the part we're adding.
+        ans.push_back(ans[start + i]);
+    } else {
+      ans.push_back('a' + rand() % alphabet);
+    }
+  }
+  ans.resize(size);
+  return ans;
+}
+
+void UnitTestXxHash32() {
+  KALDI_ASSERT(XxHash32("", 0, 0) == 0x02CC5D05u);
+  KALDI_ASSERT(XxHash32("abc", 3, 0) == 0x32D153FFu);
+  // The header checksums of well-known LZ4 frame descriptors.
+  unsigned char desc1[2] = { 0x64, 0x40 }, desc2[2] = { 0x60, 0x40 };
+  KALDI_ASSERT(((XxHash32(desc1, 2, 0) >> 8) & 0xFF) == 0xA7);
+  KALDI_ASSERT(((XxHash32(desc2, 2, 0) >> 8) & 0xFF) == 0x82);
+}
+
+void UnitTestLz4Block() {
+  for (int32 i = 0; i < 200; i++) {
+    size_t size = (i < 20 ? i : rand() % 70000);
+    int32 alphabet = 1 + rand() % 256;
+    std::string data = RandData(size, alphabet);
+    std::vector<char> compressed(Lz4CompressBound(size));
+    size_t compressed_size = Lz4CompressBlock(data.data(), size,
+                                              &(compressed[0]));
+    KALDI_ASSERT(compressed_size <= compressed.size());
+    std::vector<char> decompressed(size + 1);
+    size_t decompressed_size;
+    KALDI_ASSERT(Lz4DecompressBlock(&(compressed[0]), compressed_size,
+                                    &(decompressed[0]), size + 1,
+                                    &decompressed_size));
+    KALDI_ASSERT(decompressed_size == size &&
+                 std::string(&(decompressed[0]), size) == data);
+    if (alphabet == 1 && size > 1000)
+      KALDI_ASSERT(compressed_size < size / 100);
+    if (size > 0) {
+      // It must refuse to write past the end of the output.
+      KALDI_ASSERT(!Lz4DecompressBlock(&(compressed[0]), compressed_size,
+                                       &(decompressed[0]), size - 1,
+                                       &decompressed_size));
+    }
+  }
+}
+
+void UnitTestLz4Stream() {
+  for (int32 i = 0; i < 10; i++) {
+    size_t size = rand() % 300000;
+    std::string data = RandData(size, 1 + rand() % 20);
+    std::ostringstream compressed_os;
+    {
+      Lz4OutputBuf buf(&compressed_os);
+      std::ostream os(&buf);
+      os.write(data.data(), size / 2);
+      KALDI_ASSERT(os.tellp() == std::streampos(size / 2));
+      os.write(data.data() + size / 2, size - size / 2);
+      KALDI_ASSERT(buf.Finish());
+    }
+    std::istringstream compressed_is(compressed_os.str());
+    Lz4InputBuf buf(&compressed_is);
+    KALDI_ASSERT(buf.Init());
+    std::istream is(&buf);
+    std::string data2((std::istreambuf_iterator<char>(is)),
+                      std::istreambuf_iterator<char>());
+    KALDI_ASSERT(data == data2);
+    for (int32 j = 0; j < 20 && size > 0; j++) {
+      size_t offset = rand() % size;
+      is.clear();
+      is.seekg(offset);
+      KALDI_ASSERT(is.good() && is.tellg() == std::streampos(offset));
+      char c;
+      is.get(c);
+      KALDI_ASSERT(c == data[offset]);
+    }
+  }
+}
+
+void UnitTestLz4Archive() {
+  // Writes a compressed archive and scp, and reads them back both in order
+  // and by the offsets in the scp file.
+  std::vector<std::string> keys;
+  std::vector<std::vector<int32> > values;
+  for (int32 i = 0; i < 200; i++) {
+    std::ostringstream key;
+    key << "key" << i;
+    keys.push_back(key.str());
+    std::vector<int32> value(rand() % 2000);
+    for (size_t j = 0; j < value.size(); j++)
+      value[j] = rand() % 50;
+    values.push_back(value);
+  }
+  bool binary = (rand() % 2 == 0);
+  {
+    Int32VectorWriter writer(binary ? "ark,scp:tmpf.ark.lz4,tmpf.scp" :
+                             "ark,scp,t:tmpf.ark.lz4,tmpf.scp");
+    for (size_t i = 0; i < keys.size(); i++)
+      writer.Write(keys[i], values[i]);
+  }
+  SequentialInt32VectorReader sequential_reader("ark:tmpf.ark.lz4");
+  for (size_t i = 0; i < keys.size(); i++, sequential_reader.Next()) {
+    KALDI_ASSERT(!sequential_reader.Done() &&
+                 sequential_reader.Key() == keys[i] &&
+                 sequential_reader.Value() == values[i]);
+  }
+  KALDI_ASSERT(sequential_reader.Done());
+  RandomAccessInt32VectorReader random_reader("scp:tmpf.scp");
+  for (int32 i = 0; i < 100; i++) {
+    int32 k = rand() % keys.size();
+    KALDI_ASSERT(random_reader.Value(keys[k]) == values[k]);
+  }
+  unlink("tmpf.ark.lz4");
+  unlink("tmpf.scp");
+}
+
+void UnitTestIsLz4Filename() {
+  KALDI_ASSERT(IsLz4Filename("a.lz4"));
+  KALDI_ASSERT(IsLz4Filename("/a/b.ark.lz4:1234"));
+  KALDI_ASSERT(!IsLz4Filename("a.lz4:"));
+  KALDI_ASSERT(!IsLz4Filename("a.ark"));
+  KALDI_ASSERT(!IsLz4Filename("a.ark:1234"));
+  KALDI_ASSERT(!IsLz4Filename("lz4"));
+}
+
+}  // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestXxHash32();
+  UnitTestLz4Block();
+  UnitTestLz4Stream();
+  UnitTestLz4Archive();
+  UnitTestIsLz4Filename();
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -0,0 +1,468 @@
+// util/kaldi-lz4.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+#include "util/kaldi-lz4.h"
+
+namespace kaldi {
+
+// Constants of the LZ4 formats; see the format descriptions at
+// https://github.com/lz4/lz4/tree/dev/doc
+static const uint32 kLz4Magic = 0x184D2204;
+static const int32 kLz4MinMatch = 4;
+// The last match must start at least this many bytes before the end of the
+// block, and the last this-many bytes must be literals.
+static const int32 kLz4MatchFromEnd = 12, kLz4LastLiterals = 5;
+static const int32 kLz4MaxOffset = 65535;
+static const int32 kLz4HashLog = 12;
+static const uint32 kLz4UncompressedBit = 0x80000000u;
+// The block size we write: 64KB, which is code 4 in the frame header.
+static const size_t kLz4WriteBlockSize = 1 << 16;
+static const unsigned char kLz4WriteBlockCode = 4;
+
+static inline uint32 ReadLe32(const unsigned char *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32>(p[3]) << 24);
+}
+
+static inline void WriteLe32(uint32 i, unsigned char *p) {
+  p[0] = i & 0xFF;
+  p[1] = (i >> 8) & 0xFF;
+  p[2] = (i >> 16) & 0xFF;
+  p[3] = (i >> 24) & 0xFF;
+}
+
+static inline uint32 Read32(const unsigned char *p) {
+  uint32 ans;
+  memcpy(&ans, p, sizeof(ans));
+  return ans;
+}
+
+static inline uint32 Lz4Hash(uint32 sequence) {
+  return (sequence * 2654435761u) >> (32 - kLz4HashLog);
+}
+
+// Writes a length that is 15 or more as the LZ4 format's continuation bytes.
+static inline unsigned char *WriteLength(size_t len, unsigned char *op) {
+  for (; len >= 255; len -= 255)
+    *(op++) = 255;
+  *(op++) = static_cast<unsigned char>(len);
+  return op;
+}
+
+size_t Lz4CompressBlock(const char *src, size_t size, char *dest) {
+  const unsigned char *base = reinterpret_cast<const unsigned char*>(src),
+      *ip = base, *anchor = base, *iend = base + size;
+  unsigned char *op = reinterpret_cast<unsigned char*>(dest);
+
+  if (size > static_cast<size_t>(kLz4MatchFromEnd)) {
+    // hash_table[h] is the position of the last 4-byte sequence with hash h.
+    // Position zero doubles as "none", which is harmless as a match at
+    // position zero is checked anyway.
+    std::vector<uint32> hash_table(1 << kLz4HashLog, 0);
+    const unsigned char *match_start_limit = iend - kLz4MatchFromEnd,
+        *match_end_limit = iend - kLz4LastLiterals;
+    // As in the reference implementation, we skip ahead faster the longer we
+    // go without finding a match, which makes incompressible data fast.
+    int32 search_count = 0;
+    while (ip <= match_start_limit) {
+      uint32 sequence = Read32(ip), h = Lz4Hash(sequence);
+      const unsigned char *ref = base + hash_table[h];
+      hash_table[h] = ip - base;
+      if (ref >= ip || ip - ref > kLz4MaxOffset || Read32(ref) != sequence) {
+        ip += 1 + (search_count++ >> 6);
+        continue;
+      }
+      search_count = 0;
+      while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+        ip--;
+        ref--;
+      }
+      const unsigned char *match_end = ip + kLz4MinMatch;
+      while (match_end < match_end_limit &&
+             *match_end == ref[match_end - ip])
+        match_end++;
+
+      size_t literal_len = ip - anchor,
+          match_len = match_end - ip - kLz4MinMatch,
+          offset = ip - ref;
+      unsigned char *token = op++;
+      if (literal_len >= 15) {
+        *token = 15 << 4;
+        op = WriteLength(literal_len - 15, op);
+      } else {
+        *token = literal_len << 4;
+      }
+      memcpy(op, anchor, literal_len);
+      op += literal_len;
+      *(op++) = offset & 0xFF;
+      *(op++) = offset >> 8;
+      if (match_len >= 15) {
+        *token |= 15;
+        op = WriteLength(match_len - 15, op);
+      } else {
+        *token |= match_len;
+      }
+      ip = anchor = match_end;
+      // Add a position inside the match to the table, which helps with runs.
+      if (ip <= match_start_limit)
+        hash_table[Lz4Hash(Read32(ip - 2))] = ip - 2 - base;
+    }
+  }
+  // The last sequence has only literals.
+  size_t literal_len = iend - anchor;
+  if (literal_len >= 15) {
+    *(op++) = 15 << 4;
+    op = WriteLength(literal_len - 15, op);
+  } else {
+    *(op++) = literal_len << 4;
+  }
+  memcpy(op, anchor, literal_len);
+  op += literal_len;
+  return op - reinterpret_cast<unsigned char*>(dest);
+}
+
+// Reads a length's continuation bytes; returns false if we hit the end.
+static inline bool ReadLength(const unsigned char **ip,
+                              const unsigned char *iend, size_t *len) {
+  unsigned char b;
+  do {
+    if (*ip >= iend) return false;
+    b = *((*ip)++);
+    *len += b;
+  } while (b == 255);
+  return true;
+}
+
+bool Lz4DecompressBlock(const char *src, size_t src_size,
+                        char *dest, size_t dest_capacity, size_t *dest_size) {
+  const unsigned char *ip = reinterpret_cast<const unsigned char*>(src),
+      *iend = ip + src_size;
+  char *op = dest, *oend = dest + dest_capacity;
+  while (true) {
+    if (ip >= iend) return false;
+    unsigned char token = *(ip++);
+    size_t literal_len = token >> 4;
+    if (literal_len == 15 && !ReadLength(&ip, iend, &literal_len))
+      return false;
+    if (literal_len > static_cast<size_t>(iend - ip) ||
+        literal_len > static_cast<size_t>(oend - op))
+      return false;
+    memcpy(op, ip, literal_len);
+    ip += literal_len;
+    op += literal_len;
+    if (ip == iend) break;  // The last sequence has no match.
+
+    if (iend - ip < 2) return false;
+    size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > static_cast<size_t>(op - dest)) return false;
+    size_t match_len = token & 15;
+    if (match_len == 15 && !ReadLength(&ip, iend, &match_len))
+      return false;
+    match_len += kLz4MinMatch;
+    if (match_len > static_cast<size_t>(oend - op)) return false;
+    const char *match = op - offset;
+    if (offset >= match_len) {
+      memcpy(op, match, match_len);
+      op += match_len;
+    } else {  // Overlapping copy, e.g. a run.
+      for (size_t i = 0; i < match_len; i++)
+        *(op++) = *(match++);
+    }
+  }
+  *dest_size = op - dest;
+  return true;
+}
+
+static inline uint32 RotateLeft(uint32 x, int32 r) {
+  return (x << r) | (x >> (32 - r));
+}
+
+uint32 XxHash32(const void *data, size_t size, uint32 seed) {
+  const uint32 p1 = 2654435761u, p2 = 2246822519u, p3 = 3266489917u,
+      p4 = 668265263u, p5 = 374761393u;
+  const unsigned char *p = static_cast<const unsigned char*>(data),
+      *end = p + size;
+  uint32 h;
+  if (size >= 16) {
+    uint32 v1 = seed + p1 + p2, v2 = seed + p2, v3 = seed, v4 = seed - p1;
+    const unsigned char *limit = end - 16;
+    do {
+      v1 = RotateLeft(v1 + ReadLe32(p) * p2, 13) * p1;
+      v2 = RotateLeft(v2 + ReadLe32(p + 4) * p2, 13) * p1;
+      v3 = RotateLeft(v3 + ReadLe32(p + 8) * p2, 13) * p1;
+      v4 = RotateLeft(v4 + ReadLe32(p + 12) * p2, 13) * p1;
+      p += 16;
+    } while (p <= limit);
+    h = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) +
+        RotateLeft(v4, 18);
+  } else {
+    h = seed + p5;
+  }
+  h += static_cast<uint32>(size);
+  for (; p + 4 <= end; p += 4)
+    h = RotateLeft(h + ReadLe32(p) * p3, 17) * p4;
+  for (; p < end; p++)
+    h = RotateLeft(h + (*p) * p5, 11) * p1;
+  h ^= h >> 15;
+  h *= p2;
+  h ^= h >> 13;
+  h *= p3;
+  h ^= h >> 16;
+  return h;
+}
+
+bool IsLz4Filename(const std::string &filename) {
+  size_t end = filename.size();
+  // Remove any offset, as in foo.ark.lz4:1234.
+  size_t pos = filename.find_last_not_of("0123456789");
+  if (pos != std::string::npos && pos + 1 < end && filename[pos] == ':')
+    end = pos;
+  return end >= 4 && filename.compare(end - 4, 4, ".lz4") == 0;
+}
+
+
+Lz4OutputBuf::Lz4OutputBuf(std::ostream *os):
+    os_(os), buf_(kLz4WriteBlockSize),
+    compressed_(Lz4CompressBound(kLz4WriteBlockSize)), pos_(0),
+    finished_(false) {
+  setp(&(buf_[0]), &(buf_[0]) + buf_.size());
+  // The header: magic number; FLG byte (version 01, independent blocks, no
+  // checksums or content size); BD byte (the block size); and the header
+  // checksum, which is the second byte of the xxHash of FLG and BD.
+  unsigned char header[7];
+  WriteLe32(kLz4Magic, header);
+  header[4] = 0x60;
+  header[5] = kLz4WriteBlockCode << 4;
+  header[6] = (XxHash32(header + 4, 2, 0) >> 8) & 0xFF;
+  os_->write(reinterpret_cast<char*>(header), sizeof(header));
+}
+
+bool Lz4OutputBuf::WriteBlock() {
+  size_t size = pptr() - pbase();
+  if (size == 0) return true;
+  size_t compressed_size = Lz4CompressBlock(pbase(), size, &(compressed_[0]));
+  unsigned char block_header[4];
+  if (compressed_size < size) {
+    WriteLe32(compressed_size, block_header);
+    os_->write(reinterpret_cast<char*>(block_header), 4);
+    os_->write(&(compressed_[0]), compressed_size);
+  } else {  // Incompressible: store as-is.
+    WriteLe32(size | kLz4UncompressedBit, block_header);
+    os_->write(reinterpret_cast<char*>(block_header), 4);
+    os_->write(pbase(), size);
+  }
+  pos_ += size;
+  setp(&(buf_[0]), &(buf_[0]) + buf_.size());
+  return os_->good();
+}
+
+Lz4OutputBuf::int_type Lz4OutputBuf::overflow(int_type c) {
+  if (finished_ || !WriteBlock()) return traits_type::eof();
+  if (!traits_type::eq_int_type(c, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+  }
+  return traits_type::not_eof(c);
+}
+
+Lz4OutputBuf::pos_type Lz4OutputBuf::seekoff(off_type off,
+                                             std::ios_base::seekdir dir,
+                                             std::ios_base::openmode which) {
+  // We only support finding the current position, as tellp() does.
+  if (off != 0 || dir != std::ios_base::cur || !(which & std::ios_base::out))
+    return pos_type(off_type(-1));
+  return pos_type(pos_ + (pptr() - pbase()));
+}
+
+bool Lz4OutputBuf::Finish() {
+  if (finished_) return os_->good();
+  finished_ = true;
+  if (!WriteBlock()) return false;
+  unsigned char end_mark[4] = { 0, 0, 0, 0 };
+  os_->write(reinterpret_cast<char*>(end_mark), 4);
+  os_->flush();
+  return os_->good();
+}
+
+
+Lz4InputBuf::Lz4InputBuf(std::istream *is):
+    is_(is), block_size_(0), block_checksum_(false), cur_block_(-1),
+    num_blocks_(-1), irregular_(false) { }
+
+bool Lz4InputBuf::Init() {
+  unsigned char header[15];  // the largest possible frame header.
+  is_->read(reinterpret_cast<char*>(header), 7);
+  if (is_->gcount() != 7 || ReadLe32(header) != kLz4Magic) {
+    KALDI_WARN << "Not an LZ4 file (or not an LZ4 frame).";
+    return false;
+  }
+  unsigned char flags = header[4], bd = header[5];
+  bool content_size = (flags & 0x08) != 0, dict_id = (flags & 0x01) != 0;
+  if ((flags >> 6) != 1) {
+    KALDI_WARN << "Unsupported LZ4 frame version " << (flags >> 6);
+    return false;
+  }
+  if ((flags & 0x20) == 0 || dict_id) {
+    KALDI_WARN << "LZ4 frames with linked blocks or dictionaries are not "
+               << "supported (compress with lz4 --no-frame-crc -BI or "
+               << "write from Kaldi)";
+    return false;
+  }
+  block_checksum_ = (flags & 0x10) != 0;
+  int32 block_code = (bd >> 4) & 7;
+  if (block_code < 4) {
+    KALDI_WARN << "Invalid LZ4 block size code " << block_code;
+    return false;
+  }
+  block_size_ = static_cast<size_t>(1) << (8 + 2 * block_code);
+  // The descriptor is FLG, BD, and possibly the content size, followed by the
+  // header checksum; we have already read 3 bytes of it.
+  size_t descriptor_size = 2 + (content_size ? 8 : 0);
+  if (content_size) {
+    is_->read(reinterpret_cast<char*>(header) + 7, 8);
+    if (is_->gcount() != 8) return false;
+  }
+  if (((XxHash32(header + 4, descriptor_size, 0) >> 8) & 0xFF) !=
+      header[4 + descriptor_size]) {
+    KALDI_WARN << "LZ4 frame header checksum mismatch.";
+    return false;
+  }
+  buf_.resize(block_size_);
+  compressed_.resize(block_size_);
+  block_pos_.push_back(is_->tellg());
+  setg(&(buf_[0]), &(buf_[0]), &(buf_[0]));
+  return true;
+}
+
+bool Lz4InputBuf::ReadBlock(int64 b) {
+  KALDI_ASSERT(b < static_cast<int64>(block_pos_.size()));
+  unsigned char block_header[4];
+  is_->read(reinterpret_cast<char*>(block_header), 4);
+  if (is_->gcount() != 4) {
+    KALDI_WARN << "Truncated LZ4 file.";
+    return false;
+  }
+  uint32 size = ReadLe32(block_header);
+  if (size == 0) {  // The end-mark.
+    num_blocks_ = b;
+    return false;
+  }
+  if (cur_block_ + 1 == b && cur_block_ >= 0 &&
+      egptr() - eback() != static_cast<std::ptrdiff_t>(block_size_))
+    irregular_ = true;  // The previous block was short but not the last.
+  bool compressed = (size & kLz4UncompressedBit) == 0;
+  size &= ~kLz4UncompressedBit;
+  if (size > block_size_) {
+    KALDI_WARN << "Corrupt LZ4 file: block size " << size;
+    return false;
+  }
+  char *data = (compressed ? &(compressed_[0]) : &(buf_[0]));
+  is_->read(data, size);
+  if (static_cast<size_t>(is_->gcount()) != size) {
+    KALDI_WARN << "Truncated LZ4 file.";
+    return false;
+  }
+  if (block_checksum_) is_->ignore(4);
+  size_t decompressed_size = size;
+  if (compressed &&
+      !Lz4DecompressBlock(data, size, &(buf_[0]), block_size_,
+                          &decompressed_size)) {
+    KALDI_WARN << "Corrupt LZ4 file: error decompressing block " << b;
+    return false;
+  }
+  if (b + 1 == static_cast<int64>(block_pos_.size()))
+    block_pos_.push_back(is_->tellg());
+  cur_block_ = b;
+  setg(&(buf_[0]), &(buf_[0]), &(buf_[0]) + decompressed_size);
+  return true;
+}
+
+Lz4InputBuf::int_type Lz4InputBuf::underflow() {
+  if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+  // After ReadBlock(b), is_ is at the header of block b + 1.
+  if (num_blocks_ >= 0 && cur_block_ + 1 >= num_blocks_)
+    return traits_type::eof();
+  // On failure this leaves the get area as it was, so tellg() still works.
+  if (!ReadBlock(cur_block_ + 1)) return traits_type::eof();
+  if (gptr() == egptr()) return traits_type::eof();
+  return traits_type::to_int_type(*gptr());
+}
+
+bool Lz4InputBuf::IndexBlock(int64 b) {
+  while (static_cast<int64>(block_pos_.size()) <= b) {
+    if (num_blocks_ >= 0) return false;
+    is_->clear();
+    is_->seekg(block_pos_.back());
+    unsigned char block_header[4];
+    is_->read(reinterpret_cast<char*>(block_header), 4);
+    if (is_->gcount() != 4) return false;
+    uint32 size = ReadLe32(block_header) & ~kLz4UncompressedBit;
+    if (size == 0) {
+      num_blocks_ = block_pos_.size() - 1;
+      return false;
+    }
+    is_->seekg(size + (block_checksum_ ? 4 : 0), std::ios_base::cur);
+    if (is_->fail()) return false;
+    block_pos_.push_back(is_->tellg());
+  }
+  return true;
+}
+
+Lz4InputBuf::pos_type Lz4InputBuf::seekpos(pos_type pos,
+                                           std::ios_base::openmode which) {
+  const pos_type failure = pos_type(off_type(-1));
+  int64 offset = static_cast<int64>(off_type(pos));
+  if (!(which & std::ios_base::in) || offset < 0 || block_size_ == 0)
+    return failure;
+  if (irregular_) {
+    KALDI_WARN << "Cannot seek in LZ4 file that has short blocks before the "
+               << "last one.";
+    return failure;
+  }
+  int64 b = offset / block_size_;
+  size_t offset_in_block = offset - b * block_size_;
+  if (b != cur_block_) {
+    if (!IndexBlock(b)) return failure;
+    is_->clear();
+    is_->seekg(block_pos_[b]);
+    if (is_->fail() || !ReadBlock(b)) return failure;
+  }
+  if (offset_in_block > static_cast<size_t>(egptr() - eback()))
+    return failure;
+  setg(eback(), eback() + offset_in_block, egptr());
+  return pos;
+}
+
+Lz4InputBuf::pos_type Lz4InputBuf::seekoff(off_type off,
+                                           std::ios_base::seekdir dir,
+                                           std::ios_base::openmode which) {
+  int64 cur_pos = (cur_block_ < 0 ? 0 : cur_block_ * block_size_) +
+      (gptr() - eback());
+  if (dir == std::ios_base::cur) {
+    if (off == 0) return pos_type(cur_pos);  // as for tellg().
+    return seekpos(pos_type(cur_pos + off), which);
+  } else if (dir == std::ios_base::beg) {
+    return seekpos(pos_type(off), which);
+  } else {
+    return pos_type(off_type(-1));  // seeking from the end is not supported.
+  }
+}
+
+}  // end namespace kaldi
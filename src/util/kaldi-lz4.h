@@ -0,0 +1,152 @@
+// util/kaldi-lz4.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_KALDI_LZ4_H_
+#define KALDI_UTIL_KALDI_LZ4_H_
+
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// \addtogroup io_group
+/// @{
+
+// This file contains a self-contained implementation of the LZ4 compression
+// format (the block format, and the frame format that the "lz4" command-line
+// tool reads and writes), and stream buffers that read and write it.  It is
+// used by the Input and Output classes in kaldi-io.h for files whose names end
+// in ".lz4", so that archives can be written compressed, e.g.
+// "ark,scp:foo.ark.lz4,foo.scp".  LZ4 is chosen because it decompresses at
+// well over 1GB/s, so reading compressed archives is usually faster than
+// reading uncompressed ones from disk or network filesystems.
+//
+// The frames we write have independent blocks of 64KB (uncompressed), and no
+// checksums.  Positions in the stream (as returned by tellp() and tellg(), and
+// as written to scp files) are positions in the uncompressed data; seeking to
+// one only requires decompressing the block that contains it, since the
+// position of each block in the file is found by reading the block headers.
+
+/// Returns the largest size that Lz4CompressBlock() can output for input of
+/// size "size".
+inline size_t Lz4CompressBound(size_t size) { return size + size / 255 + 16; }
+
+/// Compresses "size" bytes from "src" in the LZ4 block format, and returns the
+/// compressed size; "dest" must have space for Lz4CompressBound(size) bytes.
+size_t Lz4CompressBlock(const char *src, size_t size, char *dest);
+
+/// Decompresses an LZ4 block of "src_size" bytes into "dest", which has space
+/// for "dest_capacity" bytes.  Returns false if the data is corrupt or would
+/// not fit, otherwise sets "dest_size" to the decompressed size.
+bool Lz4DecompressBlock(const char *src, size_t src_size,
+                        char *dest, size_t dest_capacity, size_t *dest_size);
+
+/// The 32-bit xxHash of the data, which the LZ4 frame format uses as its
+/// checksum.
+uint32 XxHash32(const void *data, size_t size, uint32 seed);
+
+/// Returns true if the filename (or wxfilename or rxfilename, possibly with
+/// an offset, as in "foo.ark.lz4:1234") refers to an LZ4-compressed file,
+/// i.e. if it ends in ".lz4".
+bool IsLz4Filename(const std::string &filename);
+
+
+/// A stream buffer that writes an LZ4 frame to an underlying stream.  The
+/// frame is only complete once Finish() has been called.  Data is compressed a
+/// block at a time, so sync() (e.g. from std::flush) does not write anything
+/// to the underlying stream.  tellp() on an ostream that uses this buffer
+/// returns the position in the uncompressed data.
+class Lz4OutputBuf: public std::streambuf {
+ public:
+  /// Writes the frame header to "os", which must outlive this object.
+  explicit Lz4OutputBuf(std::ostream *os);
+
+  /// Writes the last block and the end-mark.  Returns false on error.
+  bool Finish();
+
+ protected:
+  virtual int_type overflow(int_type c);
+  virtual int sync() { return 0; }
+  virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                           std::ios_base::openmode which);
+
+ private:
+  bool WriteBlock();  // compresses and writes the buffered data.
+
+  std::ostream *os_;
+  std::vector<char> buf_;  // uncompressed data of the current block.
+  std::vector<char> compressed_;
+  int64 pos_;  // position in the uncompressed data at the start of buf_.
+  bool finished_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(Lz4OutputBuf);
+};
+
+
+/// A stream buffer that reads an LZ4 frame from an underlying stream, and
+/// supports seeking (to positions in the uncompressed data) if the underlying
+/// stream does.  Seeking relies on every block except the last being of the
+/// maximum size, which is true for the frames we write and for those written
+/// by the "lz4" tool.  Frames with linked blocks or dictionaries are not
+/// supported, and checksums are not verified.
+class Lz4InputBuf: public std::streambuf {
+ public:
+  /// "is" must outlive this object.  Call Init() before use.
+  explicit Lz4InputBuf(std::istream *is);
+
+  /// Reads the frame header; returns false (with a warning) if it is not a
+  /// supported LZ4 frame.
+  bool Init();
+
+ protected:
+  virtual int_type underflow();
+  virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                           std::ios_base::openmode which);
+  virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+
+ private:
+  // Reads block "b", whose header must be at the current position of is_, and
+  // makes it the current buffer.  Returns false at the end of the frame or on
+  // error.
+  bool ReadBlock(int64 b);
+  // Makes sure block_pos_ has an entry for block "b" by reading block headers;
+  // returns false if the frame has fewer blocks.
+  bool IndexBlock(int64 b);
+
+  std::istream *is_;
+  size_t block_size_;  // the maximum block size, from the frame header.
+  bool block_checksum_;  // true if each block is followed by a checksum.
+  std::vector<char> buf_;  // uncompressed data of the current block.
+  std::vector<char> compressed_;
+  int64 cur_block_;  // the block in buf_, or -1.
+  // block_pos_[b] is the position in is_ of the header of block b, for the
+  // blocks we have seen so far.
+  std::vector<std::streampos> block_pos_;
+  int64 num_blocks_;  // number of blocks if we have seen the end, else -1.
+  bool irregular_;  // true if a block other than the last was short.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(Lz4InputBuf);
+};
+
+/// @}
+
+}  // end namespace kaldi
+
+#endif  // KALDI_UTIL_KALDI_LZ4_H_
@@ -0,0 +1,183 @@
+// util/kaldi-mmap.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/kaldi-mmap.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <errno.h>
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace kaldi {
+
+bool MappedFile::Open(const std::string &filename) {
+  Close();
+#ifdef _MSC_VER
+  KALDI_WARN << "Memory-mapping files is not supported on this platform.";
+  return false;
+#else
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    KALDI_WARN << "Could not open file " << filename << " for mapping: "
+               << strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    KALDI_WARN << "Could not map " << filename << ": not a regular file.";
+    close(fd);
+    return false;
+  }
+  if (st.st_size == 0) {
+    KALDI_WARN << "Could not map " << filename << ": file is empty.";
+    close(fd);
+    return false;
+  }
+  void *ptr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);  // The mapping stays valid after the file is closed.
+  if (ptr == MAP_FAILED) {
+    KALDI_WARN << "Could not map " << filename << ": " << strerror(errno);
+    return false;
+  }
+  data_ = static_cast<char*>(ptr);
+  size_ = st.st_size;
+  mtime_ = st.st_mtime;
+  return true;
+#endif
+}
+
+void MappedFile::Close() {
+#ifndef _MSC_VER
+  if (data_ != NULL)
+    munmap(data_, size_);
+#endif
+  data_ = NULL;
+  size_ = 0;
+  mtime_ = 0;
+}
+
+
+MemoryStreambuf::MemoryStreambuf(const char *begin, size_t size):
+    begin_(const_cast<char*>(begin)), end_(const_cast<char*>(begin) + size) {
+  // std::streambuf wants non-const pointers, but as we never define
+  // overflow() or pbackfail(), the data will never be written to.
+  setg(begin_, begin_, end_);
+}
+
+void MemoryStreambuf::SetPosition(size_t pos) {
+  KALDI_ASSERT(pos <= static_cast<size_t>(end_ - begin_));
+  setg(begin_, begin_ + pos, end_);
+}
+
+MemoryStreambuf::pos_type MemoryStreambuf::seekoff(
+    off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  off_type base;
+  if (dir == std::ios_base::beg) base = 0;
+  else if (dir == std::ios_base::cur) base = gptr() - begin_;
+  else base = end_ - begin_;
+  return seekpos(pos_type(base + off), which);
+}
+
+MemoryStreambuf::pos_type MemoryStreambuf::seekpos(
+    pos_type pos, std::ios_base::openmode which) {
+  off_type p = pos;
+  if (!(which & std::ios_base::in) || p < 0 || p > end_ - begin_)
+    return pos_type(off_type(-1));
+  setg(begin_, begin_ + p, end_);
+  return pos;
+}
+
+
+static const char *kArchiveIndexHeader = "KALDI_ARCHIVE_INDEX";
+
+bool ReadArchiveIndex(const std::string &index_filename,
+                      size_t archive_size,
+                      int64 archive_mtime,
+                      ArchiveIndex *index) {
+  index->clear();
+  std::ifstream is(index_filename.c_str());
+  if (!is.good()) return false;
+  std::string header;
+  size_t size;
+  int64 mtime;
+  is >> header >> size >> mtime;
+  if (is.fail() || header != kArchiveIndexHeader)
+    return false;
+  if (size != archive_size || mtime != archive_mtime) {
+    KALDI_VLOG(1) << "Index " << index_filename << " is out of date, "
+                  << "ignoring it.";
+    return false;
+  }
+  std::string key;
+  size_t offset;
+  while (is >> key >> offset) {
+    if (offset >= archive_size ||
+        (!index->empty() && !(index->back().first < key))) {
+      KALDI_WARN << "Invalid archive index " << index_filename
+                 << ", ignoring it.";
+      index->clear();
+      return false;
+    }
+    index->push_back(std::make_pair(key, offset));
+  }
+  if (!is.eof()) {
+    KALDI_WARN << "Error reading archive index " << index_filename
+               << ", ignoring it.";
+    index->clear();
+    return false;
+  }
+  return true;
+}
+
+bool WriteArchiveIndex(const std::string &index_filename,
+                       size_t archive_size,
+                       int64 archive_mtime,
+                       const ArchiveIndex &index) {
+  std::ostringstream tmp_name;
+  tmp_name << index_filename << ".tmp";
+#ifndef _MSC_VER
+  tmp_name << '.' << getpid();
+#endif
+  {
+    std::ofstream os(tmp_name.str().c_str());
+    if (!os.good()) return false;
+    os << kArchiveIndexHeader << ' ' << archive_size << ' ' << archive_mtime
+       << '\n';
+    for (size_t i = 0; i < index.size(); i++)
+      os << index[i].first << ' ' << index[i].second << '\n';
+    os.close();
+    if (os.fail()) {
+      std::remove(tmp_name.str().c_str());
+      return false;
+    }
+  }
+  if (std::rename(tmp_name.str().c_str(), index_filename.c_str()) != 0) {
+    std::remove(tmp_name.str().c_str());
+    return false;
+  }
+  return true;
+}
+
+}  // end namespace kaldi
@@ -0,0 +1,112 @@
+// util/kaldi-mmap.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_UTIL_KALDI_MMAP_H_
+#define KALDI_UTIL_KALDI_MMAP_H_
+
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+#include "base/kaldi-common.h"
+
+/* This header contains the lower-level code used by the "mmap" rspecifier
+   option (e.g. "ark,mmap:feats.ark"); see RandomAccessTableReaderMmapArchiveImpl
+   in kaldi-table-inl.h.  The archive is mapped into memory, and an index from
+   key to file offset is kept in a sidecar file (the archive name plus ".idx"),
+   so that opening the archive does not require reading it, and looking up a
+   key is a binary search followed by parsing the object directly from the
+   mapped pages.
+*/
+
+namespace kaldi {
+
+/// MappedFile maps a whole file read-only into memory.  This is only supported
+/// on POSIX systems; on other systems Open() will always fail.
+class MappedFile {
+ public:
+  MappedFile(): data_(NULL), size_(0), mtime_(0) { }
+
+  /// Returns true on success; on failure prints a warning.
+  bool Open(const std::string &filename);
+
+  void Close();
+
+  bool IsOpen() const { return (data_ != NULL); }
+
+  const char *Data() const { return data_; }
+
+  size_t Size() const { return size_; }
+
+  /// Modification time of the file, in seconds since the epoch.
+  int64 ModificationTime() const { return mtime_; }
+
+  ~MappedFile() { Close(); }
+ private:
+  char *data_;
+  size_t size_;
+  int64 mtime_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+
+/// A read-only stream buffer over a range of memory, so we can use an
+/// ordinary std::istream to read objects from a MappedFile without copying the
+/// data.  Positions (e.g. as returned by tellg()) are relative to "begin".
+class MemoryStreambuf: public std::streambuf {
+ public:
+  MemoryStreambuf(const char *begin, size_t size);
+
+  /// Sets the current read position.
+  void SetPosition(size_t pos);
+ protected:
+  virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                           std::ios_base::openmode which);
+  virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+ private:
+  char *begin_;
+  char *end_;
+};
+
+
+/// The index of an archive is a vector of (key, offset) pairs, sorted on the
+/// key, where the offset is the position in the archive of the start of the
+/// object (just after "key ").
+typedef std::vector<std::pair<std::string, size_t> > ArchiveIndex;
+
+/// Reads an index as written by WriteArchiveIndex().  Returns false (without
+/// printing a warning) if the file does not exist or is not a valid index for
+/// an archive with this size and modification time.
+bool ReadArchiveIndex(const std::string &index_filename,
+                      size_t archive_size,
+                      int64 archive_mtime,
+                      ArchiveIndex *index);
+
+/// Writes the index to "index_filename"; this is done via a temporary file
+/// and rename(), so processes reading the same archive in parallel will never
+/// see a partly written index.  Returns false on failure.
+bool WriteArchiveIndex(const std::string &index_filename,
+                       size_t archive_size,
+                       int64 archive_mtime,
+                       const ArchiveIndex &index);
+
+}  // end namespace kaldi
+
+#endif  // KALDI_UTIL_KALDI_MMAP_H_
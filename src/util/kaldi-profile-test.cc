@@ -0,0 +1,134 @@
+// util/kaldi-profile-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+#include <sstream>
+#include "util/kaldi-profile.h"
+
+namespace kaldi {
+
+static void Inner() {
+  KALDI_PROFILE_SCOPE("Inner");
+  KALDI_PROFILE_COUNT("inner-count", 2);
+}
+
+static void Outer() {
+  KALDI_PROFILE_SCOPE("Outer");
+  for (int32 i = 0; i < 3; i++)
+    Inner();
+}
+
+static void *RunThread(void *arg) {
+  for (int32 i = 0; i < 10; i++)
+    Outer();
+  return NULL;
+}
+
+void UnitTestProfileDisabled() {
+  // Nothing is accumulated before profiling is switched on.
+  Outer();
+  int64 count;
+  double seconds;
+  KALDI_ASSERT(Profiler::GetStats("Outer", &count, &seconds) && count == 0);
+  KALDI_ASSERT(!Profiler::GetStats("no-such-region", &count, &seconds));
+}
+
+void UnitTestProfileThreads() {
+  Profiler::Enable("");
+  Outer();
+  const int32 num_threads = 4;
+  pthread_t threads[num_threads];
+  for (int32 i = 0; i < num_threads; i++)
+    KALDI_ASSERT(pthread_create(&threads[i], NULL, RunThread, NULL) == 0);
+  for (int32 i = 0; i < num_threads; i++)
+    pthread_join(threads[i], NULL);
+  int64 outer_count, inner_count, counter;
+  double outer_seconds, inner_seconds, counter_seconds;
+  KALDI_ASSERT(Profiler::GetStats("Outer", &outer_count, &outer_seconds));
+  KALDI_ASSERT(Profiler::GetStats("Inner", &inner_count, &inner_seconds));
+  KALDI_ASSERT(Profiler::GetStats("inner-count", &counter, &counter_seconds));
+  KALDI_ASSERT(outer_count == 1 + 10 * num_threads);
+  KALDI_ASSERT(inner_count == 3 * outer_count && counter == 2 * inner_count);
+  KALDI_ASSERT(inner_seconds >= 0.0 && counter_seconds == 0.0);
+
+  std::ostringstream table, json;
+  Profiler::PrintSummary(false, table);
+  Profiler::PrintSummary(true, json);
+  KALDI_LOG << "Profile:\n" << table.str();
+  KALDI_ASSERT(table.str().find("Outer") != std::string::npos);
+  KALDI_ASSERT(json.str().find("{ \"name\": \"Inner\", \"calls\": 123,")
+               != std::string::npos);
+  KALDI_ASSERT(json.str().find("{ \"name\": \"inner-count\", \"count\": 246 }")
+               != std::string::npos);
+  KALDI_ASSERT(json.str().find("\"peak_rss_kb\": ") != std::string::npos);
+}
+
+void UnitTestProfileTrace() {
+  Profiler::EnableTrace("");
+  Outer();
+  pthread_t thread;
+  KALDI_ASSERT(pthread_create(&thread, NULL, RunThread, NULL) == 0);
+  pthread_join(thread, NULL);
+  for (int32 i = 0; i < 2; i++) {
+    std::ostringstream name;
+    name << "Dynamic" << i;
+    KALDI_PROFILE_SCOPE_DYNAMIC(name.str(), "rows=10");
+  }
+  int32 track = Profiler::TrackId("GPU \"0\"");
+  KALDI_ASSERT(Profiler::TrackId("GPU \"0\"") == track);
+  double now = Profiler::Now();
+  Profiler::AddTraceEvent(Profiler::RegionId("kernel"), now - 1.0e-03, now,
+                          "", track);
+
+  std::ostringstream os;
+  Profiler::PrintTrace(os);
+  std::string trace = os.str();
+  KALDI_LOG << "Trace is " << trace.size() << " bytes.";
+  // One "Outer" event from this thread and 10 from the other one.
+  int32 num_outer = 0;
+  for (size_t pos = trace.find("\"Outer\""); pos != std::string::npos;
+       pos = trace.find("\"Outer\"", pos + 1))
+    num_outer++;
+  KALDI_ASSERT(num_outer == 11);
+  KALDI_ASSERT(trace.find("{\"name\": \"Dynamic1\", \"ph\": \"X\"") !=
+               std::string::npos);
+  KALDI_ASSERT(trace.find("\"args\": {\"info\": \"rows=10\"}") !=
+               std::string::npos);
+  KALDI_ASSERT(trace.find("\"args\": {\"name\": \"GPU \\\"0\\\"\"}") !=
+               std::string::npos);
+  std::ostringstream kernel;
+  kernel << "{\"name\": \"kernel\", \"ph\": \"X\"";
+  size_t pos = trace.find(kernel.str());
+  KALDI_ASSERT(pos != std::string::npos);
+  std::ostringstream kernel_track;
+  kernel_track << "\"pid\": 1, \"tid\": " << track << "}";
+  KALDI_ASSERT(trace.find(kernel_track.str(), pos) != std::string::npos);
+  KALDI_ASSERT(trace.find("\"events_dropped\": 0}") != std::string::npos);
+}
+
+}  // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestProfileDisabled();
+  UnitTestProfileThreads();
+  UnitTestProfileTrace();
+  std::cout << "Test OK.\n";
+  return 0;
+}
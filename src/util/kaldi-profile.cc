@@ -0,0 +1,448 @@
+// util/kaldi-profile.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+#include <vector>
+#include "util/kaldi-profile.h"
+#if defined(_MSC_VER) || defined(MINGW)
+#include "base/kaldi-utils.h"
+#else
+#include <sys/resource.h>
+#include <sys/time.h>
+#endif
+
+namespace kaldi {
+
+bool Profiler::enabled_ = false;
+bool Profiler::trace_enabled_ = false;
+
+namespace {
+
+struct RegionStats {
+  int64 count;
+  double seconds;
+  RegionStats(): count(0), seconds(0.0) { }
+};
+
+typedef std::vector<RegionStats> ThreadStats;
+
+// All of the following are protected by g_mutex, except that each thread
+// modifies the elements of its own ThreadStats without locking (it only
+// needs the lock to resize it).
+pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+std::vector<std::string> g_names;
+std::vector<bool> g_timed;
+std::map<std::string, int32> g_name_to_id;
+ThreadStats g_totals;  // Statistics of threads that have exited.
+std::set<ThreadStats*> g_live_threads;
+std::string g_output;
+double g_start_time = 0.0;
+
+pthread_once_t g_key_once = PTHREAD_ONCE_INIT;
+pthread_key_t g_key;
+
+// Called when a thread that has statistics exits.
+void MergeThreadStats(void *ptr) {
+  ThreadStats *stats = static_cast<ThreadStats*>(ptr);
+  pthread_mutex_lock(&g_mutex);
+  if (g_totals.size() < stats->size())
+    g_totals.resize(stats->size());
+  for (size_t i = 0; i < stats->size(); i++) {
+    g_totals[i].count += (*stats)[i].count;
+    g_totals[i].seconds += (*stats)[i].seconds;
+  }
+  g_live_threads.erase(stats);
+  pthread_mutex_unlock(&g_mutex);
+  delete stats;
+}
+
+void CreateKey() {
+  if (pthread_key_create(&g_key, MergeThreadStats) != 0)
+    KALDI_ERR << "Could not create thread-specific key for profiling";
+}
+
+// Returns the current thread's statistics, with space for at least
+// "num_regions" regions.
+ThreadStats *GetThreadStats(size_t num_regions) {
+  pthread_once(&g_key_once, CreateKey);
+  ThreadStats *stats = static_cast<ThreadStats*>(pthread_getspecific(g_key));
+  if (stats == NULL || stats->size() < num_regions) {
+    pthread_mutex_lock(&g_mutex);
+    if (stats == NULL) {
+      stats = new ThreadStats();
+      g_live_threads.insert(stats);
+      pthread_setspecific(g_key, stats);
+    }
+    stats->resize(std::max(num_regions, g_names.size()));
+    pthread_mutex_unlock(&g_mutex);
+  }
+  return stats;
+}
+
+// Sums the statistics of exited and running threads; requires g_mutex.
+void GetTotals(ThreadStats *totals) {
+  *totals = g_totals;
+  totals->resize(g_names.size());
+  for (std::set<ThreadStats*>::const_iterator iter = g_live_threads.begin();
+       iter != g_live_threads.end(); ++iter) {
+    const ThreadStats &stats = **iter;
+    for (size_t i = 0; i < stats.size(); i++) {
+      (*totals)[i].count += stats[i].count;
+      (*totals)[i].seconds += stats[i].seconds;
+    }
+  }
+}
+
+// An event in the timeline.  "row" is the thread's number (>= 0) or, for
+// events on a track, -1 - (track id).
+struct TraceEvent {
+  int32 id;
+  int32 row;
+  double start;
+  double end;
+  std::string args;
+  TraceEvent(int32 id, int32 row, double start, double end,
+             const std::string &args):
+      id(id), row(row), start(start), end(end), args(args) { }
+};
+
+// The timeline events recorded by one thread.  The mutex is only contended
+// when the trace is being written out.
+struct TraceBuffer {
+  int32 thread_number;
+  std::vector<TraceEvent> events;
+  int64 num_dropped;  // events not recorded because of kMaxEventsPerThread.
+  pthread_mutex_t mutex;
+};
+
+// We stop recording a thread's events after this many, so that a long run
+// does not use up all the memory; PrintTrace() says how many were dropped.
+const size_t kMaxEventsPerThread = 2000000;
+
+// The following are protected by g_mutex, except as noted for TraceBuffer.
+std::vector<std::string> g_track_names;
+std::vector<TraceEvent> g_exited_events;  // Events of threads that exited.
+std::set<TraceBuffer*> g_live_buffers;
+int32 g_num_threads_traced = 0;
+int64 g_num_events_dropped = 0;
+std::string g_trace_output;
+
+pthread_once_t g_trace_key_once = PTHREAD_ONCE_INIT;
+pthread_key_t g_trace_key;
+
+// Called when a thread that has a trace buffer exits.
+void MergeTraceBuffer(void *ptr) {
+  TraceBuffer *buffer = static_cast<TraceBuffer*>(ptr);
+  pthread_mutex_lock(&g_mutex);
+  g_exited_events.insert(g_exited_events.end(), buffer->events.begin(),
+                         buffer->events.end());
+  g_num_events_dropped += buffer->num_dropped;
+  g_live_buffers.erase(buffer);
+  pthread_mutex_unlock(&g_mutex);
+  pthread_mutex_destroy(&buffer->mutex);
+  delete buffer;
+}
+
+void CreateTraceKey() {
+  if (pthread_key_create(&g_trace_key, MergeTraceBuffer) != 0)
+    KALDI_ERR << "Could not create thread-specific key for profiling";
+}
+
+TraceBuffer *GetTraceBuffer() {
+  pthread_once(&g_trace_key_once, CreateTraceKey);
+  TraceBuffer *buffer = static_cast<TraceBuffer*>(
+      pthread_getspecific(g_trace_key));
+  if (buffer == NULL) {
+    buffer = new TraceBuffer();
+    buffer->num_dropped = 0;
+    pthread_mutex_init(&buffer->mutex, NULL);
+    pthread_mutex_lock(&g_mutex);
+    buffer->thread_number = g_num_threads_traced++;
+    g_live_buffers.insert(buffer);
+    pthread_mutex_unlock(&g_mutex);
+    pthread_setspecific(g_trace_key, buffer);
+  }
+  return buffer;
+}
+
+void PrintTraceAtExit() {
+  if (g_trace_output.empty()) return;
+  std::ofstream os(g_trace_output.c_str());
+  Profiler::PrintTrace(os);
+  if (!os.good())
+    KALDI_WARN << "Error writing profiling trace to " << g_trace_output;
+}
+
+// Sorts regions by decreasing time, then decreasing count, then name.
+struct RegionCompare {
+  RegionCompare(const ThreadStats &totals): totals_(totals) { }
+  bool operator() (int32 a, int32 b) const {
+    if (totals_[a].seconds != totals_[b].seconds)
+      return totals_[a].seconds > totals_[b].seconds;
+    if (totals_[a].count != totals_[b].count)
+      return totals_[a].count > totals_[b].count;
+    return g_names[a] < g_names[b];
+  }
+  const ThreadStats &totals_;
+};
+
+std::string JsonEscape(const std::string &str) {
+  std::string ans;
+  for (size_t i = 0; i < str.size(); i++) {
+    if (str[i] == '"' || str[i] == '\\') ans += '\\';
+    ans += str[i];
+  }
+  return ans;
+}
+
+void PrintSummaryAtExit() {
+  if (g_output == "log") {
+    std::ostringstream os;
+    Profiler::PrintSummary(false, os);
+    KALDI_LOG << "Profile:\n" << os.str();
+  } else if (!g_output.empty()) {
+    std::ofstream os(g_output.c_str());
+    Profiler::PrintSummary(true, os);
+    if (!os.good())
+      KALDI_WARN << "Error writing profile to " << g_output;
+  }
+}
+
+}  // end anonymous namespace
+
+
+int32 Profiler::RegionId(const char *name, bool timed) {
+  pthread_mutex_lock(&g_mutex);
+  std::map<std::string, int32>::iterator iter = g_name_to_id.find(name);
+  int32 ans;
+  if (iter != g_name_to_id.end()) {
+    ans = iter->second;
+  } else {
+    ans = g_names.size();
+    g_names.push_back(name);
+    g_timed.push_back(timed);
+    g_name_to_id[name] = ans;
+  }
+  pthread_mutex_unlock(&g_mutex);
+  return ans;
+}
+
+void Profiler::Enable(const std::string &output) {
+  pthread_mutex_lock(&g_mutex);
+  bool first_time = (g_start_time == 0.0);
+  if (first_time) g_start_time = Now();
+  g_output = output;
+  pthread_mutex_unlock(&g_mutex);
+  if (first_time) atexit(PrintSummaryAtExit);
+  enabled_ = true;
+}
+
+void Profiler::EnableTrace(const std::string &filename) {
+  if (!enabled_) Enable("");
+  pthread_mutex_lock(&g_mutex);
+  bool first_time = !trace_enabled_;
+  g_trace_output = filename;
+  pthread_mutex_unlock(&g_mutex);
+  if (first_time) atexit(PrintTraceAtExit);
+  trace_enabled_ = true;
+}
+
+int32 Profiler::TrackId(const std::string &name) {
+  pthread_mutex_lock(&g_mutex);
+  int32 ans = std::find(g_track_names.begin(), g_track_names.end(), name) -
+      g_track_names.begin();
+  if (ans == static_cast<int32>(g_track_names.size()))
+    g_track_names.push_back(name);
+  pthread_mutex_unlock(&g_mutex);
+  return ans;
+}
+
+void Profiler::AddTraceEvent(int32 id, double start, double end,
+                             const std::string &args, int32 track) {
+  if (!trace_enabled_) return;
+  TraceBuffer *buffer = GetTraceBuffer();
+  pthread_mutex_lock(&buffer->mutex);
+  if (buffer->events.size() < kMaxEventsPerThread) {
+    int32 row = (track == -1 ? buffer->thread_number : -1 - track);
+    buffer->events.push_back(TraceEvent(id, row, start, end, args));
+  } else {
+    buffer->num_dropped++;
+  }
+  pthread_mutex_unlock(&buffer->mutex);
+}
+
+void Profiler::PrintTrace(std::ostream &os) {
+  pthread_mutex_lock(&g_mutex);
+  std::vector<TraceEvent> events(g_exited_events);
+  int64 num_dropped = g_num_events_dropped;
+  for (std::set<TraceBuffer*>::const_iterator iter = g_live_buffers.begin();
+       iter != g_live_buffers.end(); ++iter) {
+    pthread_mutex_lock(&(*iter)->mutex);
+    events.insert(events.end(), (*iter)->events.begin(),
+                  (*iter)->events.end());
+    num_dropped += (*iter)->num_dropped;
+    pthread_mutex_unlock(&(*iter)->mutex);
+  }
+  // Times are in microseconds from when profiling was switched on.  Threads
+  // are shown as process 0 and tracks as process 1.
+  os << "{\"traceEvents\": [\n";
+  os << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, "
+     << "\"tid\": 0, \"args\": {\"name\": \"threads\"}},\n"
+     << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, "
+     << "\"tid\": 0, \"args\": {\"name\": \"tracks\"}}";
+  for (size_t i = 0; i < g_track_names.size(); i++)
+    os << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+       << "\"tid\": " << i << ", \"args\": {\"name\": \""
+       << JsonEscape(g_track_names[i]) << "\"}}";
+  os << std::fixed << std::setprecision(3);
+  for (size_t i = 0; i < events.size(); i++) {
+    const TraceEvent &e = events[i];
+    os << ",\n{\"name\": \"" << JsonEscape(g_names[e.id])
+       << "\", \"ph\": \"X\", \"ts\": "
+       << 1.0e+06 * (e.start - g_start_time) << ", \"dur\": "
+       << 1.0e+06 * (e.end - e.start) << ", \"pid\": "
+       << (e.row >= 0 ? 0 : 1) << ", \"tid\": "
+       << (e.row >= 0 ? e.row : -1 - e.row);
+    if (!e.args.empty())
+      os << ", \"args\": {\"info\": \"" << JsonEscape(e.args) << "\"}";
+    os << "}";
+  }
+  os << "\n],\n\"otherData\": {\"events_dropped\": " << num_dropped
+     << "}}\n";
+  pthread_mutex_unlock(&g_mutex);
+}
+
+void Profiler::Add(int32 id, int64 count, double seconds) {
+  ThreadStats *stats = GetThreadStats(id + 1);
+  (*stats)[id].count += count;
+  (*stats)[id].seconds += seconds;
+}
+
+double Profiler::Now() {
+#if defined(_MSC_VER) || defined(MINGW)
+  LARGE_INTEGER now, freq;
+  QueryPerformanceCounter(&now);
+  if (QueryPerformanceFrequency(&freq) == 0) return 0.0;
+  return static_cast<double>(now.QuadPart) / static_cast<double>(freq.QuadPart);
+#else
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec + now.tv_usec * 1.0e-06;
+#endif
+}
+
+// Returns the peak resident set size of the process so far, in kilobytes, or
+// -1 if we can't find it out.
+static int64 PeakRssKb() {
+#if defined(_MSC_VER) || defined(MINGW)
+  return -1;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;  // In bytes on Darwin.
+#else
+  return usage.ru_maxrss;
+#endif
+#endif
+}
+
+void Profiler::PrintSummary(bool json, std::ostream &os) {
+  pthread_mutex_lock(&g_mutex);
+  ThreadStats totals;
+  GetTotals(&totals);
+  double elapsed = (g_start_time == 0.0 ? 0.0 : Now() - g_start_time);
+  std::vector<int32> regions, counters;
+  for (size_t i = 0; i < totals.size(); i++) {
+    if (totals[i].count == 0) continue;
+    if (g_timed[i]) regions.push_back(i);
+    else counters.push_back(i);
+  }
+  std::sort(regions.begin(), regions.end(), RegionCompare(totals));
+  std::sort(counters.begin(), counters.end(), RegionCompare(totals));
+  if (json) {
+    os << "{\n  \"elapsed\": " << elapsed << ",\n  \"peak_rss_kb\": "
+       << PeakRssKb() << ",\n  \"regions\": [";
+    for (size_t i = 0; i < regions.size(); i++) {
+      const RegionStats &s = totals[regions[i]];
+      os << (i == 0 ? "\n" : ",\n") << "    { \"name\": \""
+         << JsonEscape(g_names[regions[i]]) << "\", \"calls\": " << s.count
+         << ", \"seconds\": " << s.seconds << " }";
+    }
+    os << "\n  ],\n  \"counters\": [";
+    for (size_t i = 0; i < counters.size(); i++) {
+      os << (i == 0 ? "\n" : ",\n") << "    { \"name\": \""
+         << JsonEscape(g_names[counters[i]]) << "\", \"count\": "
+         << totals[counters[i]].count << " }";
+    }
+    os << "\n  ]\n}\n";
+  } else {
+    os << "Elapsed time " << elapsed << " seconds, peak RSS " << PeakRssKb()
+       << " kB.\n";
+    if (!regions.empty())
+      os << std::setw(12) << "seconds" << std::setw(8) << "%"
+         << std::setw(12) << "calls" << std::setw(12) << "us/call"
+         << "  region\n";
+    for (size_t i = 0; i < regions.size(); i++) {
+      const RegionStats &s = totals[regions[i]];
+      os << std::setw(12) << std::fixed << std::setprecision(3) << s.seconds
+         << std::setw(8) << std::setprecision(1)
+         << (elapsed > 0.0 ? 100.0 * s.seconds / elapsed : 0.0)
+         << std::setw(12) << s.count << std::setw(12) << std::setprecision(2)
+         << (1.0e+06 * s.seconds / s.count) << "  " << g_names[regions[i]]
+         << '\n';
+    }
+    if (!counters.empty())
+      os << std::setw(12) << "count" << "  counter\n";
+    for (size_t i = 0; i < counters.size(); i++)
+      os << std::setw(12) << totals[counters[i]].count << "  "
+         << g_names[counters[i]] << '\n';
+  }
+  pthread_mutex_unlock(&g_mutex);
+}
+
+std::string ProfileDims(int32 rows, int32 cols) {
+  std::ostringstream os;
+  os << rows << 'x' << cols;
+  return os.str();
+}
+
+bool Profiler::GetStats(const std::string &name, int64 *count,
+                        double *seconds) {
+  pthread_mutex_lock(&g_mutex);
+  std::map<std::string, int32>::iterator iter = g_name_to_id.find(name);
+  bool ans = (iter != g_name_to_id.end());
+  if (ans) {
+    ThreadStats totals;
+    GetTotals(&totals);
+    *count = totals[iter->second].count;
+    *seconds = totals[iter->second].seconds;
+  }
+  pthread_mutex_unlock(&g_mutex);
+  return ans;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,183 @@
+// util/kaldi-profile.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_KALDI_PROFILE_H_
+#define KALDI_UTIL_KALDI_PROFILE_H_
+
+#include <ostream>
+#include <string>
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+// This file contains a lightweight facility for finding out where the time
+// goes in a program: named regions whose calls and elapsed time are
+// accumulated, and named counters.  It is switched on by the standard option
+// --profile, which all programs that use ParseOptions accept; e.g.
+// --profile=log prints a summary table to the log when the program exits, and
+// --profile=foo.json writes the summary to foo.json in JSON format.  When it is
+// not switched on, a region costs one test of a global flag.
+//
+// Example of usage:
+//   void LatticeFasterDecoder::ProcessNonemitting(BaseFloat cutoff) {
+//     KALDI_PROFILE_SCOPE("LatticeFasterDecoder::ProcessNonemitting");
+//     ...
+//     KALDI_PROFILE_COUNT("LatticeFasterDecoder::arcs", num_arcs);
+//   }
+//
+// The statistics are kept per thread, so there is no locking in the common
+// case; each thread's statistics are added to the totals when it exits.  Time
+// spent in a region includes time spent in any regions nested inside it.
+//
+// The standard option --profile-trace=foo.json also records a timeline of
+// every call to a region, per thread, and writes it to foo.json at exit in the
+// Chrome trace-event format (open it in chrome://tracing).  Code can add
+// events on other rows of the timeline (tracks), e.g. for the work done on a
+// GPU; see Profiler::AddTraceEvent().
+
+class Profiler {
+ public:
+  /// Returns the integer id for the region or counter with this name,
+  /// registering it if it is new.  This locks a mutex, so it's normally called
+  /// only once per call site (the macros below store it in a static
+  /// variable).  "timed" is true for regions and false for counters.
+  static int32 RegionId(const char *name, bool timed = true);
+
+  /// True if profiling has been switched on.
+  static inline bool Enabled() { return enabled_; }
+
+  /// Switches on profiling.  If "output" is "log" the summary is printed with
+  /// KALDI_LOG when the program exits; otherwise it is the filename to which
+  /// the summary is written in JSON format.  If "output" is empty we switch it
+  /// on but print nothing at exit (this is for testing).
+  static void Enable(const std::string &output);
+
+  /// True if the timeline is being recorded.
+  static inline bool TraceEnabled() { return trace_enabled_; }
+
+  /// Switches on recording of the timeline (and profiling, as Enable("") if
+  /// it was not on), which is written to "filename" in Chrome trace-event
+  /// format when the program exits.  If "filename" is empty it is not written
+  /// (this is for testing).
+  static void EnableTrace(const std::string &filename);
+
+  /// Returns the id of the track (row of the timeline) with this name,
+  /// registering it if it is new.  Tracks are for events that do not belong to
+  /// the thread that records them, e.g. work done on a GPU.
+  static int32 TrackId(const std::string &name);
+
+  /// Adds an event for region "id" from time "start" to time "end" (as
+  /// returned by Now()) to the timeline, on track "track", or on the current
+  /// thread's row if track == -1.  "args" is shown with the event; it is
+  /// meant for things like matrix dimensions.  Does nothing unless
+  /// TraceEnabled().  This does not change the summary statistics.
+  static void AddTraceEvent(int32 id, double start, double end,
+                            const std::string &args = "", int32 track = -1);
+
+  /// Writes the timeline recorded so far in Chrome trace-event format.
+  static void PrintTrace(std::ostream &os);
+
+  /// Adds "count" and "seconds" to the statistics of region "id" for the
+  /// current thread.
+  static void Add(int32 id, int64 count, double seconds);
+
+  /// Returns the current time in seconds, from an arbitrary origin.
+  static double Now();
+
+  /// Writes the summary of all threads' statistics so far, as a table sorted
+  /// by time (and then by count), or in JSON format.  The summary also gives
+  /// the elapsed time since profiling was switched on and the peak resident
+  /// set size of the process.  The statistics of other
+  /// threads that are still running may be slightly out of date.
+  static void PrintSummary(bool json, std::ostream &os);
+
+  /// Gets the totals so far for the region or counter with this name; returns
+  /// false if there is no such name.  Mostly for testing.
+  static bool GetStats(const std::string &name, int64 *count, double *seconds);
+
+ private:
+  static bool enabled_;
+  static bool trace_enabled_;
+};
+
+/// ProfileScope is the object that KALDI_PROFILE_SCOPE declares; it adds the
+/// time between its construction and destruction to region "id".
+class ProfileScope {
+ public:
+  explicit ProfileScope(int32 id):
+      id_(id), start_(Profiler::Enabled() ? Profiler::Now() : -1.0) { }
+  /// This version also attaches "args" to the event in the timeline.
+  ProfileScope(int32 id, const std::string &args):
+      id_(id), start_(Profiler::Enabled() ? Profiler::Now() : -1.0),
+      args_(args) { }
+  ~ProfileScope() {
+    if (start_ >= 0.0) {
+      double end = Profiler::Now();
+      Profiler::Add(id_, 1, end - start_);
+      if (Profiler::TraceEnabled())
+        Profiler::AddTraceEvent(id_, start_, end, args_);
+    }
+  }
+ private:
+  int32 id_;
+  double start_;
+  std::string args_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ProfileScope);
+};
+
+#define KALDI_PROFILE_JOIN_(a, b) a##b
+#define KALDI_PROFILE_JOIN(a, b) KALDI_PROFILE_JOIN_(a, b)
+
+/// Times the rest of the enclosing scope as region "name", which must be a
+/// string literal (or at least the same string each time).
+#define KALDI_PROFILE_SCOPE(name)                                             \
+  static const ::kaldi::int32 KALDI_PROFILE_JOIN(kaldi_profile_id_, __LINE__) \
+      = ::kaldi::Profiler::RegionId(name);                                    \
+  ::kaldi::ProfileScope KALDI_PROFILE_JOIN(kaldi_profile_scope_, __LINE__)(   \
+      KALDI_PROFILE_JOIN(kaldi_profile_id_, __LINE__))
+
+/// Returns a string such as "256x1024", e.g. for the "args" of
+/// KALDI_PROFILE_SCOPE_DYNAMIC.
+std::string ProfileDims(int32 rows, int32 cols);
+
+/// Like KALDI_PROFILE_SCOPE, but "name" is a std::string expression that may
+/// differ between calls (e.g. a component's type), and "args" (also a
+/// std::string expression) is attached to the event in the timeline.  They
+/// are only evaluated when profiling (respectively, the timeline) is on, but
+/// the name is then looked up on each call, so this is slower than
+/// KALDI_PROFILE_SCOPE.
+#define KALDI_PROFILE_SCOPE_DYNAMIC(name, args)                               \
+  ::kaldi::ProfileScope KALDI_PROFILE_JOIN(kaldi_profile_scope_, __LINE__)(   \
+      ::kaldi::Profiler::Enabled() ?                                          \
+      ::kaldi::Profiler::RegionId(std::string(name).c_str()) : -1,            \
+      ::kaldi::Profiler::TraceEnabled() ? std::string(args) : std::string())
+
+/// Adds "n" to the counter "name".
+#define KALDI_PROFILE_COUNT(name, n)                                         \
+  do {                                                                       \
+    if (::kaldi::Profiler::Enabled()) {                                      \
+      static const ::kaldi::int32 kaldi_profile_id =                         \
+          ::kaldi::Profiler::RegionId(name, false);                          \
+      ::kaldi::Profiler::Add(kaldi_profile_id, (n), 0.0);                    \
+    }                                                                        \
+  } while (0)
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_KALDI_PROFILE_H_
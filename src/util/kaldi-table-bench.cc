@@ -0,0 +1,118 @@
+// util/kaldi-table-bench.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//  http://www.apache.org/licenses/LICENSE-2.0
+
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdlib>
+#include <sstream>
+#include "util/kaldi-bench.h"
+#include "util/kaldi-table.h"
+#include "util/kaldi-holder.h"
+#include "util/table-types.h"
+#ifndef _MSC_VER
+#include <unistd.h>
+#endif
+
+namespace kaldi {
+
+// Measures the throughput of writing and reading archives of int32 vectors
+// (the table code doesn't depend on the type, and this keeps the util/
+// directory free of a dependency on matrix/).
+
+struct TableWriteBench {
+  TableWriteBench(const std::string &wspecifier,
+                  const std::vector<std::vector<int32> > &values):
+      wspecifier_(wspecifier), values_(values) { }
+  void operator() () {
+    Int32VectorWriter writer(wspecifier_);
+    for (size_t i = 0; i < values_.size(); i++) {
+      std::ostringstream key;
+      key << "utt" << i;
+      writer.Write(key.str(), values_[i]);
+    }
+  }
+  std::string wspecifier_;
+  const std::vector<std::vector<int32> > &values_;
+};
+
+struct TableSequentialReadBench {
+  explicit TableSequentialReadBench(const std::string &rspecifier):
+      rspecifier_(rspecifier), checksum_(0) { }
+  void operator() () {
+    SequentialInt32VectorReader reader(rspecifier_);
+    for (; !reader.Done(); reader.Next())
+      checksum_ += reader.Value().size();
+  }
+  std::string rspecifier_;
+  size_t checksum_;
+};
+
+struct TableRandomReadBench {
+  TableRandomReadBench(const std::string &rspecifier, int32 num_keys):
+      rspecifier_(rspecifier), num_keys_(num_keys), checksum_(0) { }
+  void operator() () {
+    RandomAccessInt32VectorReader reader(rspecifier_);
+    srand(0);
+    for (int32 i = 0; i < num_keys_; i++) {
+      std::ostringstream key;
+      key << "utt" << (rand() % num_keys_);
+      checksum_ += reader.Value(key.str()).size();
+    }
+  }
+  std::string rspecifier_;
+  int32 num_keys_;
+  size_t checksum_;
+};
+
+void TableBench(int32 num_utts, int32 utt_size, bool binary) {
+  std::vector<std::vector<int32> > values(num_utts);
+  for (int32 i = 0; i < num_utts; i++) {
+    values[i].resize(utt_size);
+    for (int32 j = 0; j < utt_size; j++)
+      values[i][j] = rand() % 1000;
+  }
+  std::ostringstream params;
+  params << "num_utts=" << num_utts << " utt_size=" << utt_size
+         << " binary=" << (binary ? "true" : "false");
+  double num_bytes = num_utts * (utt_size * 4.0);
+  std::string opt = (binary ? "" : ",t");
+
+  TableWriteBench write_bench("ark,scp" + opt + ":tmpb.ark,tmpb.scp", values);
+  PrintBenchmarkResult("TableWriter::Write", params.str(),
+                       TimeBenchmark(write_bench), num_bytes, "bytes");
+
+  TableSequentialReadBench read_bench("ark:tmpb.ark");
+  PrintBenchmarkResult("SequentialTableReader", params.str(),
+                       TimeBenchmark(read_bench), num_bytes, "bytes");
+
+  TableRandomReadBench random_bench("scp:tmpb.scp", num_utts);
+  PrintBenchmarkResult("RandomAccessTableReader(scp)", params.str(),
+                       TimeBenchmark(random_bench), num_bytes, "bytes");
+  unlink("tmpb.ark");
+  unlink("tmpb.scp");
+}
+
+}  // end namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  srand(0);
+  TableBench(1000, 100, true);
+  TableBench(100, 100000, true);
+  TableBench(100, 10000, false);
+  return 0;
+}
@@ -23,9 +23,15 @@
 #define KALDI_UTIL_KALDI_TABLE_INL_H_
 
 #include <algorithm>
+#include <deque>
+#include <map>
+#include <pthread.h>
 #include "util/kaldi-io.h"
+#include "util/kaldi-lz4.h"
+#include "util/kaldi-profile.h"
 #include "util/text-utils.h"
 #include "util/stl-utils.h" // for StringHasher.
+#include "util/kaldi-mmap.h"
 
 
 namespace kaldi {
@@ -41,7 +47,7 @@ template<class Holder> class SequentialTableReaderImplBase {
   virtual bool Done() const = 0;
   virtual bool IsOpen() const = 0;
   virtual std::string Key() = 0;
-  virtual const T &Value() = 0;
+  virtual T &Value() = 0;
   virtual void FreeCurrent() = 0;
   virtual void Next() = 0;
   virtual bool Close() = 0;
@@ -131,7 +137,7 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
     }
     return key_;
   }
-  const T &Value() {
+  T &Value() {
     StateType orig_state = state_;
     if (state_ == kHaveScpLine) LoadCurrent();  // Takes
     // state_ to kLoadSucceeded or kLoadFailed.
@@ -183,8 +189,7 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
     // they're open.
     if (script_input_.IsOpen())
       script_input_.Close();
-    if (data_input_.IsOpen())
-      data_input_.Close();
+    data_input_.Close();
     if (state_ == kLoadSucceeded)
       holder_.Clear();
     if (!this->IsOpen())
@@ -214,18 +219,17 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
     // Attempts to load object whose rxfilename is on the current scp line.
     if (state_ != kHaveScpLine)
       KALDI_ERR << "TableReader: LoadCurrent() called at the wrong time.";
-    bool ans;
-    // note, NULL means it doesn't read the binary-mode header
-    if (Holder::IsReadInBinary()) ans = data_input_.Open(data_rxfilename_, NULL);
-    else ans = data_input_.OpenTextMode(data_rxfilename_);
-    if (!ans) {
+    // This doesn't read the binary-mode header.
+    std::istream *is = data_input_.Open(data_rxfilename_,
+                                        !Holder::IsReadInBinary());
+    if (is == NULL) {
       // May want to make this warning a VLOG at some point
       KALDI_WARN << "TableReader: failed to open file "
                  << PrintableRxfilename(data_rxfilename_);
       state_ = kLoadFailed;
       return false;
     } else {
-      if (holder_.Read(data_input_.Stream())) {
+      if (holder_.Read(*is)) {
         state_ = kLoadSucceeded;
         return true;
       } else {  // holder_ will not contain data.
@@ -261,15 +265,14 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
       state_ = kEof;  // nothing more in the scp file.
       // Might as well close the input streams as don't need them.
       script_input_.Close();
-      if (data_input_.IsOpen())
-        data_input_.Close();
+      data_input_.Close();
     }
   }
 
 
   Input script_input_;  // Input object for the .scp file
-  Input data_input_;   // Input object for the entries in
-  // the script file.
+  InputCache data_input_;  // For the entries in the script file; keeps the
+  // archives they point into open.
   Holder holder_;  // Holds the object.
   bool binary_;  // Binary-mode archive.
   std::string key_;
@@ -431,7 +434,7 @@ template<class Holder>  class SequentialTableReaderArchiveImpl:
     }
     return key_;
   }
-  const T &Value() {
+  T &Value() {
     switch (state_) {
       case kHaveObject:
         break;  // only valid case.
@@ -501,6 +504,519 @@ template<class Holder>  class SequentialTableReaderArchiveImpl:
   } state_;
 };
 
+// This is the implementation for SequentialTableReader when the "bg"
+// (background) option is given, e.g. "ark,bg:feats.ark" or
+// "scp,bg:feats.scp".  A background thread reads the archive or the files
+// listed in the script, and calls Holder::Read(), keeping up to
+// kMaxQueued objects ready for the calling thread, so the I/O and parsing
+// overlap with whatever the program does with the objects.  The objects are
+// read into separately allocated Holders so that they can be handed over
+// without copying.  The behavior is otherwise the same as for the archive and
+// script implementations above, except that with a script in non-permissive
+// mode the objects are read even if Value() is not called.
+template<class Holder>  class SequentialTableReaderBackgroundImpl:
+      public SequentialTableReaderImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  SequentialTableReaderBackgroundImpl(): is_open_(false), holder_(NULL),
+                                         freed_(false), done_(false) {
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&cond_, NULL);
+  }
+
+  virtual bool Open(const std::string &rspecifier) {
+    if (is_open_) {
+      if (!Close())  // call Close() yourself to suppress this exception.
+        KALDI_ERR << "TableReader::Open, error closing previous input.";
+    }
+    rs_type_ = ClassifyRspecifier(rspecifier, &rxfilename_, &opts_);
+    KALDI_ASSERT(rs_type_ == kArchiveRspecifier ||
+                 rs_type_ == kScriptRspecifier);
+    bool ans;
+    if (rs_type_ == kArchiveRspecifier) {
+      // NULL means don't expect binary-mode header
+      if (Holder::IsReadInBinary())
+        ans = input_.Open(rxfilename_, NULL);
+      else
+        ans = input_.OpenTextMode(rxfilename_);
+    } else {
+      bool binary;
+      ans = input_.Open(rxfilename_, &binary);
+      if (ans && binary) {
+        KALDI_WARN << "Script file appears to be binary: "
+                   << PrintableRxfilename(rxfilename_);
+        input_.Close();
+        return false;
+      }
+    }
+    if (!ans) {
+      KALDI_WARN << "TableReader: failed to open stream "
+                 << PrintableRxfilename(rxfilename_);
+      return false;
+    }
+    producer_done_ = false;
+    producer_error_ = false;
+    stop_ = false;
+    done_ = false;
+    int32 ret;
+    if ((ret = pthread_create(&thread_, NULL, Run, this)) != 0)
+      KALDI_ERR << "TableReader: failed to create thread, error code " << ret;
+    is_open_ = true;
+    Next();
+    if (done_ && producer_error_) {
+      KALDI_WARN << "TableReader: error beginning to read table (wrong "
+                 << "filename?): " << PrintableRxfilename(rxfilename_);
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  virtual bool IsOpen() const { return is_open_; }
+
+  virtual bool Done() const {
+    if (!is_open_)
+      KALDI_ERR << "Done() called on TableReader object at the wrong time.";
+    return done_;
+  }
+
+  virtual std::string Key() {
+    if (!is_open_ || done_)
+      KALDI_ERR << "Key() called on TableReader object at the wrong time.";
+    return key_;
+  }
+
+  virtual T &Value() {
+    if (!is_open_ || done_)
+      KALDI_ERR << "Value() called on TableReader object at the wrong time.";
+    if (freed_)
+      KALDI_ERR << "TableReader: you called Value() after FreeCurrent().";
+    if (holder_ == NULL)  // Only happens reading scripts.
+      KALDI_ERR << "TableReader: failed to load object for key " << key_
+                << " (to suppress this error, add the permissive "
+                << "(p, ) option to the rspecifier.";
+    return holder_->Value();
+  }
+
+  virtual void FreeCurrent() {
+    if (is_open_ && !done_ && !freed_) {
+      delete holder_;
+      holder_ = NULL;
+      freed_ = true;
+    } else {
+      KALDI_WARN << "TableReader: FreeCurrent called at the wrong time.";
+    }
+  }
+
+  virtual void Next() {
+    if (!is_open_ || done_)
+      KALDI_ERR << "TableReader: Next() called wrongly.";
+    delete holder_;
+    holder_ = NULL;
+    freed_ = false;
+    pthread_mutex_lock(&mutex_);
+    while (queue_.empty() && !producer_done_)
+      pthread_cond_wait(&cond_, &mutex_);
+    if (queue_.empty()) {
+      done_ = true;
+    } else {
+      key_ = queue_.front().first;
+      holder_ = queue_.front().second;
+      queue_.pop_front();
+      pthread_cond_signal(&cond_);  // The producer may be waiting for space.
+    }
+    pthread_mutex_unlock(&mutex_);
+  }
+
+  virtual bool Close() {
+    if (!is_open_)
+      KALDI_ERR << "Close() called on TableReader twice or otherwise wrongly.";
+    pthread_mutex_lock(&mutex_);
+    stop_ = true;
+    pthread_cond_signal(&cond_);
+    pthread_mutex_unlock(&mutex_);
+    if (pthread_join(thread_, NULL) != 0)
+      KALDI_ERR << "TableReader: error joining thread.";
+    for (size_t i = 0; i < queue_.size(); i++)
+      delete queue_[i].second;
+    queue_.clear();
+    delete holder_;
+    holder_ = NULL;
+    if (input_.IsOpen())
+      input_.Close();
+    is_open_ = false;
+    if (producer_error_) {
+      if (opts_.permissive) {
+        KALDI_WARN << "Error detected closing TableReader for "
+                   << PrintableRxfilename(rxfilename_) << " but ignoring "
+                   << "it as permissive mode specified.";
+        return true;
+      } else {
+        return false;  // User should detect the error.
+      }
+    }
+    return true;
+  }
+
+  virtual ~SequentialTableReaderBackgroundImpl() {
+    if (is_open_ && !Close())
+      KALDI_ERR << "TableReader: reading table failed: "
+                << PrintableRxfilename(rxfilename_);
+    // If you don't want this exception to be thrown you can
+    // call Close() and check the status.
+    pthread_cond_destroy(&cond_);
+    pthread_mutex_destroy(&mutex_);
+  }
+ private:
+  static const size_t kMaxQueued = 4;
+
+  static void *Run(void *this_in) {
+    SequentialTableReaderBackgroundImpl<Holder> *reader =
+        static_cast<SequentialTableReaderBackgroundImpl<Holder>*>(this_in);
+    bool ok;
+    try {
+      if (reader->rs_type_ == kArchiveRspecifier)
+        ok = reader->ReadArchive();
+      else
+        ok = reader->ReadScript();
+    } catch (...) {
+      ok = false;
+    }
+    pthread_mutex_lock(&(reader->mutex_));
+    reader->producer_done_ = true;
+    reader->producer_error_ = !ok;
+    pthread_cond_signal(&(reader->cond_));
+    pthread_mutex_unlock(&(reader->mutex_));
+    return NULL;
+  }
+
+  // Called from the background thread; gives the object to the calling thread,
+  // waiting if the queue is full.  Returns false (and deletes the holder) if
+  // Close() has been called.
+  bool Push(const std::string &key, Holder *holder) {
+    pthread_mutex_lock(&mutex_);
+    while (queue_.size() >= kMaxQueued && !stop_)
+      pthread_cond_wait(&cond_, &mutex_);
+    bool ans = !stop_;
+    if (ans) {
+      queue_.push_back(std::make_pair(key, holder));
+      pthread_cond_signal(&cond_);
+    } else {
+      delete holder;
+    }
+    pthread_mutex_unlock(&mutex_);
+    return ans;
+  }
+
+  // Called from the background thread.  Returns false on error.
+  bool ReadArchive() {
+    std::istream &is = input_.Stream();
+    std::string key;
+    while (true) {
+      is >> key;  // This eats up any leading whitespace and gets the string.
+      if (is.eof()) return true;
+      if (is.fail()) {
+        KALDI_WARN << "Error reading archive "
+                   << PrintableRxfilename(rxfilename_);
+        return false;
+      }
+      int c;
+      if ((c = is.peek()) != ' ' && c != '\t' && c != '\n') {
+        KALDI_WARN << "Invalid archive file format: expected space after key "
+                   << key << ", got character "
+                   << CharToString(static_cast<char>(is.peek()))
+                   << ", reading " << PrintableRxfilename(rxfilename_);
+        return false;
+      }
+      if (c != '\n') is.get();  // Consume the space or tab.
+      Holder *holder = new Holder;
+      if (!holder->Read(is)) {
+        delete holder;
+        KALDI_WARN << "Object read failed, reading archive "
+                   << PrintableRxfilename(rxfilename_);
+        return false;
+      }
+      if (!Push(key, holder)) return true;
+    }
+  }
+
+  // Called from the background thread.  Returns false on error.
+  bool ReadScript() {
+    std::string line, key, data_rxfilename;
+    InputCache data_input;
+    while (getline(input_.Stream(), line)) {
+      SplitStringOnFirstSpace(line, &key, &data_rxfilename);
+      if (key.empty() || data_rxfilename.empty()) {
+        KALDI_WARN << "Invalid line in script file "
+                   << PrintableRxfilename(rxfilename_) << ": " << line;
+        return false;
+      }
+      // This doesn't read the binary-mode header.
+      std::istream *is = data_input.Open(data_rxfilename,
+                                         !Holder::IsReadInBinary());
+      Holder *holder = NULL;
+      if (is != NULL) {
+        holder = new Holder;
+        if (!holder->Read(*is)) {
+          delete holder;
+          holder = NULL;
+        }
+      }
+      if (holder == NULL) {
+        KALDI_WARN << "TableReader: failed to load object from "
+                   << PrintableRxfilename(data_rxfilename);
+        if (opts_.permissive) continue;  // Treat as if the key were absent.
+      }
+      if (!Push(key, holder)) return true;
+    }
+    return true;
+  }
+
+  // The following are only accessed by the calling thread, or before the
+  // background thread starts.
+  bool is_open_;
+  RspecifierType rs_type_;
+  std::string rxfilename_;
+  RspecifierOptions opts_;
+  std::string key_;
+  Holder *holder_;  // The current object; NULL if freed, or if it could not
+                    // be read from a script.
+  bool freed_;  // True if the user called FreeCurrent().
+  bool done_;
+
+  // input_ is only accessed by the background thread while it is running.
+  Input input_;
+  pthread_t thread_;
+
+  // The following are protected by mutex_; cond_ is signaled when they change.
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;
+  std::deque<std::pair<std::string, Holder*> > queue_;
+  bool producer_done_;
+  bool producer_error_;
+  bool stop_;
+};
+
+// Sets up "index" for the archive "archive_rxfilename", which has been
+// memory-mapped as "file".  The index is read from the file <archive>.idx if
+// that is present and up to date; otherwise we build it by reading through the
+// archive (the objects are read, since this is the only robust way to find
+// where they end, but are not kept), and try to write it out for next time.
+// Returns false on error, unless "permissive", in which case the objects
+// before the error are kept in the index.
+template<class Holder>
+bool GetArchiveIndex(const std::string &archive_rxfilename,
+                     const MappedFile &file, bool permissive,
+                     ArchiveIndex *index) {
+  std::string index_filename = archive_rxfilename + ".idx";
+  if (ReadArchiveIndex(index_filename, file.Size(), file.ModificationTime(),
+                       index))
+    return true;
+  KALDI_VLOG(1) << "Building index for archive "
+                << PrintableRxfilename(archive_rxfilename);
+  index->clear();
+  MemoryStreambuf buf(file.Data(), file.Size());
+  std::istream is(&buf);
+  Holder holder;
+  std::string key;
+  bool error = false;
+  while (is >> key) {  // This eats up any leading whitespace.
+    int c;
+    if ((c = is.peek()) != ' ' && c != '\t' && c != '\n') {
+      KALDI_WARN << "Invalid archive file format: expected space after key "
+                 << key << ", got character "
+                 << CharToString(static_cast<char>(is.peek()))
+                 << ", reading " << PrintableRxfilename(archive_rxfilename);
+      error = true;
+      break;
+    }
+    if (c != '\n') is.get();  // Consume the space or tab.
+    size_t offset = static_cast<size_t>(is.tellg());
+    if (!holder.Read(is)) {
+      KALDI_WARN << "Object read failed, reading archive "
+                 << PrintableRxfilename(archive_rxfilename);
+      error = true;
+      break;
+    }
+    holder.Clear();
+    index->push_back(std::make_pair(key, offset));
+  }
+  if (!error && !is.eof()) {
+    KALDI_WARN << "Error reading archive "
+               << PrintableRxfilename(archive_rxfilename);
+    error = true;
+  }
+  if (error) {
+    if (!permissive) return false;
+    KALDI_WARN << "Indexing only the first " << index->size()
+               << " objects, since permissive mode.";
+  }
+  // Sorting on (key, offset) means that for a repeated key, the first
+  // occurrence in the archive comes first.
+  std::sort(index->begin(), index->end());
+  size_t num_kept = 0;
+  for (size_t i = 0; i < index->size(); i++) {
+    if (num_kept != 0 && (*index)[num_kept - 1].first == (*index)[i].first) {
+      KALDI_WARN << "Duplicate key " << (*index)[i].first << " in archive "
+                 << PrintableRxfilename(archive_rxfilename)
+                 << ", using the first one.";
+    } else {
+      (*index)[num_kept++] = (*index)[i];
+    }
+  }
+  index->resize(num_kept);
+  // We don't write out an index of an archive that we could not read to the
+  // end, since it would be taken as complete next time.
+  if (!error && !WriteArchiveIndex(index_filename, file.Size(),
+                                   file.ModificationTime(), *index))
+    KALDI_VLOG(1) << "Could not write archive index " << index_filename;
+  return true;
+}
+
+
+// This is the implementation for SequentialTableReader when the "shuffle"
+// option is given, e.g. "ark,shuffle:egs.1.ark", and the archive is an
+// ordinary file.  The archive is memory-mapped and indexed as for
+// RandomAccessTableReaderMmapArchiveImpl, and the objects are returned in a
+// random order, each one being read straight from the mapped pages when it is
+// asked for, so only the index and the current object are held in memory.
+// So that the reads stay fairly localized rather than going all over the file,
+// the archive is divided into blocks of kBlockSize consecutive objects, the
+// order of the blocks is randomized, and then the objects are randomized
+// within each run of kBlockSize * kBlocksPerWindow objects in the new order.
+// The randomization uses rand(), so the program should call srand() before
+// opening the reader to get a different order on each iteration.  A key that
+// is repeated in the archive is only returned once.
+template<class Holder>  class SequentialTableReaderShuffledArchiveImpl:
+      public SequentialTableReaderImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  SequentialTableReaderShuffledArchiveImpl(): pos_(0), have_object_(false) { }
+
+  virtual bool Open(const std::string &rspecifier) {
+    if (file_.IsOpen()) {
+      if (!Close())  // call Close() yourself to suppress this exception.
+        KALDI_ERR << "TableReader::Open, error closing previous input.";
+    }
+    RspecifierType rs = ClassifyRspecifier(rspecifier, &archive_rxfilename_,
+                                           &opts_);
+    KALDI_ASSERT(rs == kArchiveRspecifier &&
+                 ClassifyRxfilename(archive_rxfilename_) == kFileInput);
+    if (!file_.Open(archive_rxfilename_)) {
+      KALDI_WARN << "TableReader: failed to map archive "
+                 << PrintableRxfilename(archive_rxfilename_);
+      return false;
+    }
+    if (!GetArchiveIndex<Holder>(archive_rxfilename_, file_, opts_.permissive,
+                                 &index_)) {
+      file_.Close();
+      index_.clear();
+      return false;
+    }
+    Shuffle();
+    pos_ = 0;
+    return true;
+  }
+
+  virtual bool Done() const {
+    KALDI_ASSERT(file_.IsOpen());
+    return (pos_ >= order_.size());
+  }
+
+  virtual bool IsOpen() const { return file_.IsOpen(); }
+
+  virtual std::string Key() {
+    KALDI_ASSERT(file_.IsOpen() && pos_ < order_.size());
+    return index_[order_[pos_]].first;
+  }
+
+  virtual T &Value() {
+    KALDI_ASSERT(file_.IsOpen() && pos_ < order_.size());
+    if (!have_object_) {
+      const std::pair<std::string, size_t> &entry = index_[order_[pos_]];
+      MemoryStreambuf buf(file_.Data(), file_.Size());
+      buf.SetPosition(entry.second);
+      std::istream is(&buf);
+      if (!holder_.Read(is))
+        KALDI_ERR << "TableReader: failed to read object for key "
+                  << entry.first << " from archive "
+                  << PrintableRxfilename(archive_rxfilename_);
+      have_object_ = true;
+    }
+    return holder_.Value();
+  }
+
+  virtual void FreeCurrent() {
+    if (have_object_) {
+      holder_.Clear();
+      have_object_ = false;
+    }
+  }
+
+  virtual void Next() {
+    KALDI_ASSERT(file_.IsOpen() && pos_ < order_.size());
+    FreeCurrent();
+    pos_++;
+  }
+
+  virtual bool Close() {
+    if (!file_.IsOpen())
+      KALDI_ERR << "Close() called on TableReader twice or otherwise wrongly.";
+    FreeCurrent();
+    file_.Close();
+    index_.clear();
+    order_.clear();
+    pos_ = 0;
+    return true;
+  }
+
+  virtual ~SequentialTableReaderShuffledArchiveImpl() {
+    if (file_.IsOpen()) Close();
+  }
+ private:
+  static const size_t kBlockSize = 64;
+  static const size_t kBlocksPerWindow = 16;
+
+  // Sets up order_, the order in which we return the elements of index_.
+  void Shuffle() {
+    size_t n = index_.size();
+    // The index is sorted on key; first get the archive order.
+    std::vector<std::pair<size_t, size_t> > by_offset(n);
+    for (size_t i = 0; i < n; i++)
+      by_offset[i] = std::make_pair(index_[i].second, i);
+    std::sort(by_offset.begin(), by_offset.end());
+    size_t num_blocks = (n + kBlockSize - 1) / kBlockSize;
+    std::vector<size_t> blocks(num_blocks);
+    for (size_t b = 0; b < num_blocks; b++) blocks[b] = b;
+    std::random_shuffle(blocks.begin(), blocks.end());
+    order_.clear();
+    order_.reserve(n);
+    for (size_t b = 0; b < num_blocks; b++) {
+      size_t begin = blocks[b] * kBlockSize,
+          end = std::min(begin + kBlockSize, n);
+      for (size_t i = begin; i < end; i++)
+        order_.push_back(by_offset[i].second);
+    }
+    size_t window = kBlockSize * kBlocksPerWindow;
+    for (size_t begin = 0; begin < n; begin += window)
+      std::random_shuffle(order_.begin() + begin,
+                          order_.begin() + std::min(begin + window, n));
+  }
+
+  MappedFile file_;
+  ArchiveIndex index_;
+  std::string archive_rxfilename_;
+  RspecifierOptions opts_;
+
+  std::vector<size_t> order_;  // indexes into index_, in the order we return
+                               // the objects.
+  size_t pos_;  // our position in order_.
+  Holder holder_;
+  bool have_object_;  // true if holder_ contains the object at pos_.
+};
+
 
 template<class Holder>
 SequentialTableReader<Holder>::SequentialTableReader(const std::string &rspecifier): impl_(NULL) {
@@ -515,13 +1031,29 @@ bool SequentialTableReader<Holder>::Open(const std::string &rspecifier) {
       KALDI_ERR << "SequentialTableReader<Holder>::Open(), could not close previously open object.";
   // now impl_ will be NULL.
 
-  RspecifierType wt = ClassifyRspecifier(rspecifier, NULL, NULL);
+  RspecifierOptions opts;
+  std::string rxfilename;
+  RspecifierType wt = ClassifyRspecifier(rspecifier, &rxfilename, &opts);
   switch (wt) {
     case kArchiveRspecifier:
-      impl_ = new SequentialTableReaderArchiveImpl<Holder>();
+      if (opts.shuffle && (ClassifyRxfilename(rxfilename) != kFileInput ||
+                           IsLz4Filename(rxfilename)))
+        KALDI_WARN << "SequentialTableReader: ignoring the shuffle option "
+                   << "since the archive is not an ordinary file: "
+                   << rspecifier;
+      if (opts.shuffle && ClassifyRxfilename(rxfilename) == kFileInput &&
+          !IsLz4Filename(rxfilename))
+        impl_ = new SequentialTableReaderShuffledArchiveImpl<Holder>();
+      else if (opts.background)
+        impl_ = new SequentialTableReaderBackgroundImpl<Holder>();
+      else
+        impl_ = new SequentialTableReaderArchiveImpl<Holder>();
       break;
     case kScriptRspecifier:
-      impl_ = new SequentialTableReaderScriptImpl<Holder>();
+      if (opts.background)
+        impl_ = new SequentialTableReaderBackgroundImpl<Holder>();
+      else
+        impl_ = new SequentialTableReaderScriptImpl<Holder>();
       break;
     case kNoRspecifier: default:
       KALDI_WARN << "Invalid rspecifier " << rspecifier;
@@ -568,8 +1100,9 @@ void SequentialTableReader<Holder>::FreeCurrent() {
 
 
 template<class Holder>
-const typename SequentialTableReader<Holder>::T &
+typename SequentialTableReader<Holder>::T &
 SequentialTableReader<Holder>::Value() {
+  KALDI_PROFILE_SCOPE("SequentialTableReader::Value");
   CheckImpl();
   return impl_->Value();  // This may throw (if LoadCurrent() returned false you are safe.).
 }
@@ -577,6 +1110,7 @@ SequentialTableReader<Holder>::Value() {
 
 template<class Holder>
 void SequentialTableReader<Holder>::Next() {
+  KALDI_PROFILE_SCOPE("SequentialTableReader::Next");
   CheckImpl();
   impl_->Next();
 }
@@ -652,6 +1186,7 @@ class TableWriterArchiveImpl: public TableWriterImplBase<Holder> {
     KALDI_ASSERT(ws == kArchiveWspecifier);  // or wrongly called.
 
     if (output_.Open(archive_wxfilename_, opts_.binary, false)) {  // false means no binary header.
+      SetAlignedWrite(output_.Stream(), opts_.align);
       state_ = kOpen;
       return true;
     } else {
@@ -952,6 +1487,7 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
       state_ = kUninitialized;
       return false;
     }
+    SetAlignedWrite(archive_output_.Stream(), opts_.align);
     state_ = kOpen;
     return true;
   }
@@ -1089,6 +1625,254 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
 };
 
 
+// This is the implementation of TableWriter when the "bg" (background)
+// option is given for an archive, e.g. "ark,bg:1.lats" or
+// "ark,scp,bg:1.ark,1.scp".  Write() serializes the object into memory with
+// Holder::Write() and queues it, and a background thread writes the queued
+// data to the archive and the lines to the script file, so the calling thread
+// does not wait for the filesystem.  Write() only waits if more than
+// kMaxQueuedBytes are queued.  The output, including the offsets in the
+// script file, is identical to that of TableWriterArchiveImpl and
+// TableWriterBothImpl; but write errors are reported by a later Write() or
+// by Close(), rather than by the Write() of the object concerned.
+template<class Holder>
+class TableWriterBackgroundImpl: public TableWriterImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  TableWriterBackgroundImpl(): is_open_(false) {
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&cond_, NULL);
+  }
+
+  virtual bool Open(const std::string &wspecifier) {
+    if (is_open_ && !Close())  // throw because this error may not have been
+      // previously detected by the user.
+      KALDI_ERR << "TableWriter: opening stream, error closing previously "
+                << "open stream.";
+    wspecifier_ = wspecifier;
+    WspecifierType ws = ClassifyWspecifier(wspecifier, &archive_wxfilename_,
+                                           &script_wxfilename_, &opts_);
+    KALDI_ASSERT(ws == kArchiveWspecifier || ws == kBothWspecifier);
+    if (ws == kBothWspecifier &&
+        ClassifyWxfilename(archive_wxfilename_) != kFileOutput)
+      KALDI_WARN << "When writing to both archive and script, the script file "
+          "will generally not be interpreted correctly unless the archive is "
+          "an actual file: wspecifier = " << wspecifier;
+    // false means no binary header.
+    if (!archive_output_.Open(archive_wxfilename_, opts_.binary, false))
+      return false;
+    if (ws == kBothWspecifier &&
+        !script_output_.Open(script_wxfilename_, false, false)) {
+      archive_output_.Close();  // Don't care about status: error anyway.
+      return false;
+    }
+    queued_bytes_ = 0;
+    archive_pos_ = 0;
+    busy_ = false;
+    stop_ = false;
+    error_ = false;
+    int32 ret;
+    if ((ret = pthread_create(&thread_, NULL, Run, this)) != 0)
+      KALDI_ERR << "TableWriter: failed to create thread, error code " << ret;
+    is_open_ = true;
+    return true;
+  }
+
+  virtual bool IsOpen() const { return is_open_; }
+
+  virtual bool Write(const std::string &key, const T &value) {
+    if (!is_open_)
+      KALDI_ERR << "TableWriter: Write called on invalid stream";
+    if (!IsToken(key))  // e.g. empty string or has spaces...
+      KALDI_ERR << "TableWriter: using invalid key " << key;
+    std::ostringstream os;
+    // The object will go after "key ", at archive_pos_ if the archive
+    // started empty.
+    if (opts_.align)
+      SetAlignedWrite(os, true, archive_pos_ + key.size() + 1);
+    if (!Holder::Write(os, opts_.binary, value)) {
+      KALDI_WARN << "TableWriter: failed to write object for key " << key
+                 << " to " << PrintableWxfilename(archive_wxfilename_);
+      pthread_mutex_lock(&mutex_);
+      error_ = true;
+      pthread_mutex_unlock(&mutex_);
+      return false;
+    }
+    std::string data = os.str();
+    archive_pos_ += key.size() + 1 + data.size();
+    pthread_mutex_lock(&mutex_);
+    while (queued_bytes_ > kMaxQueuedBytes && !error_)
+      pthread_cond_wait(&cond_, &mutex_);
+    bool ans = !error_;
+    if (ans) {
+      queue_.push_back(std::make_pair(key, std::string()));
+      queue_.back().second.swap(data);
+      queued_bytes_ += queue_.back().second.size();
+      pthread_cond_broadcast(&cond_);
+    }
+    pthread_mutex_unlock(&mutex_);
+    if (!ans) {
+      KALDI_WARN << "TableWriter: write failure (possibly for an earlier "
+                 << "object) to " << wspecifier_;
+      return false;
+    }
+    if (opts_.flush)
+      Flush();
+    return true;
+  }
+
+  // Waits until everything queued has been written, then flushes the
+  // streams.
+  virtual void Flush() {
+    if (!is_open_) {
+      KALDI_WARN << "TableWriter: Flush called on not-open writer.";
+      return;
+    }
+    pthread_mutex_lock(&mutex_);
+    while ((!queue_.empty() || busy_) && !error_)
+      pthread_cond_wait(&cond_, &mutex_);
+    // The background thread is now idle until we queue something, so we can
+    // use the streams.
+    if (!error_) {
+      archive_output_.Stream().flush();  // Don't check error status.
+      if (script_output_.IsOpen())
+        script_output_.Stream().flush();
+    }
+    pthread_mutex_unlock(&mutex_);
+  }
+
+  virtual bool Close() {
+    if (!is_open_)
+      KALDI_ERR << "TableWriter: Close called on a stream that was not open.";
+    pthread_mutex_lock(&mutex_);
+    stop_ = true;
+    pthread_cond_broadcast(&cond_);
+    pthread_mutex_unlock(&mutex_);
+    // The background thread writes whatever is queued before it finishes.
+    if (pthread_join(thread_, NULL) != 0)
+      KALDI_ERR << "TableWriter: error joining thread.";
+    queue_.clear();
+    is_open_ = false;
+    bool ans = !error_;
+    if (!archive_output_.Close()) ans = false;
+    if (script_output_.IsOpen() && !script_output_.Close()) ans = false;
+    if (!ans)
+      KALDI_WARN << "TableWriter: error writing or closing " << wspecifier_;
+    return ans;
+  }
+
+  // May throw on write error if Close() was not called.
+  virtual ~TableWriterBackgroundImpl() {
+    if (is_open_ && !Close())
+      KALDI_ERR << "At TableWriter destructor: Write failed or stream close "
+                << "failed: " << wspecifier_;
+    pthread_cond_destroy(&cond_);
+    pthread_mutex_destroy(&mutex_);
+  }
+
+ private:
+  static const size_t kMaxQueuedBytes = 16 << 20;
+
+  static void *Run(void *this_in) {
+    TableWriterBackgroundImpl<Holder> *writer =
+        static_cast<TableWriterBackgroundImpl<Holder>*>(this_in);
+    try {
+      writer->WriteQueued();
+    } catch (...) {
+      pthread_mutex_lock(&(writer->mutex_));
+      writer->error_ = true;
+      writer->busy_ = false;
+      pthread_cond_broadcast(&(writer->cond_));
+      pthread_mutex_unlock(&(writer->mutex_));
+    }
+    return NULL;
+  }
+
+  // Called from the background thread; writes the queued objects until
+  // Close() is called and the queue is empty, or there is an error.
+  void WriteQueued() {
+    std::pair<std::string, std::string> item;
+    pthread_mutex_lock(&mutex_);
+    while (true) {
+      while (queue_.empty() && !stop_)
+        pthread_cond_wait(&cond_, &mutex_);
+      if (queue_.empty() || error_) break;
+      item.first.swap(queue_.front().first);
+      item.second.swap(queue_.front().second);
+      queue_.pop_front();
+      busy_ = true;
+      pthread_mutex_unlock(&mutex_);
+      bool ok = WriteItem(item.first, item.second);
+      pthread_mutex_lock(&mutex_);
+      queued_bytes_ -= item.second.size();
+      busy_ = false;
+      if (!ok) error_ = true;
+      pthread_cond_broadcast(&cond_);
+    }
+    pthread_mutex_unlock(&mutex_);
+  }
+
+  // Called from the background thread; does what TableWriterArchiveImpl or
+  // TableWriterBothImpl would do, with the already-serialized object.
+  bool WriteItem(const std::string &key, const std::string &data) {
+    std::ostream &archive_os = archive_output_.Stream();
+    archive_os << key << ' ';
+    if (script_output_.IsOpen()) {
+      // Write to the script file first, as TableWriterBothImpl does.
+      std::ostringstream ss;
+      ss << ':' << archive_os.tellp();
+      if (ss.str() == ":-1") {
+        KALDI_WARN << "TableWriter: could not get position in archive "
+                   << PrintableWxfilename(archive_wxfilename_);
+        return false;
+      }
+      std::ostream &script_os = script_output_.Stream();
+      script_os << key << ' ' << archive_wxfilename_ << ss.str() << '\n';
+      if (script_os.fail()) {
+        KALDI_WARN << "TableWriter: write failure to script file detected: "
+                   << PrintableWxfilename(script_wxfilename_);
+        return false;
+      }
+    }
+    archive_os.write(data.data(), data.size());
+    if (archive_os.fail()) {
+      KALDI_WARN << "TableWriter: write failure to archive file detected: "
+                 << PrintableWxfilename(archive_wxfilename_);
+      return false;
+    }
+    return true;
+  }
+
+  // The following are only accessed by the calling thread, or before the
+  // background thread starts.
+  bool is_open_;
+  WspecifierOptions opts_;
+  std::string wspecifier_;
+  std::string archive_wxfilename_;
+  std::string script_wxfilename_;
+  pthread_t thread_;
+  // The position in the archive at which the next queued object will be
+  // written (counting from where we started), for the "align" option.
+  int64 archive_pos_;
+
+  // The outputs are only accessed by the background thread while it is
+  // running, except in Flush() while it is idle.
+  Output archive_output_;
+  Output script_output_;  // not open if there is no script file.
+
+  // The following are protected by mutex_; cond_ is broadcast when they
+  // change.
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;
+  std::deque<std::pair<std::string, std::string> > queue_;  // (key, data)
+  size_t queued_bytes_;  // total size of the data in queue_ and being written.
+  bool busy_;  // true while the background thread is writing an object.
+  bool stop_;  // set by Close().
+  bool error_;
+};
+
+
 template<class Holder>
 TableWriter<Holder>::TableWriter(const std::string &wspecifier): impl_(NULL) {
   if (wspecifier != "" && !Open(wspecifier)) {
@@ -1111,15 +1895,25 @@ bool TableWriter<Holder>::Open(const std::string &wspecifier) {
       KALDI_ERR << "TableWriter::Open, failed to close previously open writer.";
   }
   KALDI_ASSERT(impl_ == NULL);
-  WspecifierType wtype = ClassifyWspecifier(wspecifier, NULL, NULL, NULL);
+  WspecifierOptions opts;
+  WspecifierType wtype = ClassifyWspecifier(wspecifier, NULL, NULL, &opts);
   switch (wtype) {
     case kBothWspecifier:
-      impl_ = new TableWriterBothImpl<Holder>();
+      if (opts.background)
+        impl_ = new TableWriterBackgroundImpl<Holder>();
+      else
+        impl_ = new TableWriterBothImpl<Holder>();
       break;
     case kArchiveWspecifier:
-      impl_ = new TableWriterArchiveImpl<Holder>();
+      if (opts.background)
+        impl_ = new TableWriterBackgroundImpl<Holder>();
+      else
+        impl_ = new TableWriterArchiveImpl<Holder>();
       break;
     case kScriptWspecifier:
+      if (opts.background)
+        KALDI_WARN << "TableWriter: ignoring the bg option, which only "
+                   << "applies to archives: " << wspecifier;
       impl_ = new TableWriterScriptImpl<Holder>();
       break;
     case kNoWspecifier: default:
@@ -1137,6 +1931,7 @@ bool TableWriter<Holder>::Open(const std::string &wspecifier) {
 template<class Holder>
 void TableWriter<Holder>::Write(const std::string &key,
                                 const T &value) const {
+  KALDI_PROFILE_SCOPE("TableWriter::Write");
   CheckImpl();
   if (!impl_->Write(key, value))
     KALDI_ERR << "Error in TableWriter::Write";
@@ -1222,7 +2017,12 @@ class RandomAccessTableReaderScriptImpl:
  public:
   typedef typename Holder::T T;
 
-  RandomAccessTableReaderScriptImpl(): last_found_(0), state_(kUninitialized) {}
+  RandomAccessTableReaderScriptImpl(): holder_(new Holder), last_found_(0),
+                                       state_(kUninitialized),
+                                       thread_running_(false) {
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&cond_, NULL);
+  }
 
   virtual bool Open(const std::string &rspecifier) {
     switch (state_) {
@@ -1264,6 +2064,17 @@ class RandomAccessTableReaderScriptImpl:
       }
     }
     state_ = kNotHaveObject;
+    if (opts_.background) {
+      window_begin_ = window_end_ = 0;
+      last_request_ = static_cast<size_t>(-1);
+      loading_ = static_cast<size_t>(-1);
+      stop_ = false;
+      int32 ret;
+      if ((ret = pthread_create(&thread_, NULL, Run, this)) != 0)
+        KALDI_ERR << "RandomAccessTableReader: failed to create thread, "
+                  << "error code " << ret;
+      thread_running_ = true;
+    }
     return true;
   }
 
@@ -1275,7 +2086,9 @@ class RandomAccessTableReaderScriptImpl:
   virtual bool Close() {
     if (!IsOpen())
       KALDI_ERR << "Close() called on RandomAccessTableReader that was not open.";
-    holder_.Clear();
+    StopThread();
+    holder_->Clear();
+    input_.Close();
     state_ = kUninitialized;
     last_found_ = 0;
     script_.clear();
@@ -1315,17 +2128,21 @@ class RandomAccessTableReaderScriptImpl:
     if (state_ == kHaveObject) {
       state_ = kGaveObject;
       if (opts_.once) MakeTombstone(key);  // make sure that future lookups fail.
-      return holder_.Value();
+      return holder_->Value();
     } else {  // state_ == kGaveObject
       if (opts_.once)
         KALDI_ERR << "Value called twice for the same key\n";
-      return holder_.Value();
+      return holder_->Value();
     }
   }
 
   virtual ~RandomAccessTableReaderScriptImpl() {
+    StopThread();
     if (state_ == kHaveObject || state_ == kGaveObject)
-      holder_.Clear();
+      holder_->Clear();
+    delete holder_;
+    pthread_cond_destroy(&cond_);
+    pthread_mutex_destroy(&mutex_);
   }
 
  private:
@@ -1355,14 +2172,27 @@ class RandomAccessTableReaderScriptImpl:
       if (!preload)
         return true;  // we have the key.
       else {  // preload specified, so we have to pre-load the object before returning true.
-        if (!input_.Open(script_[key_pos].second)) {
+        if (thread_running_) {
+          Holder *holder = TakePrefetched(key_pos);
+          if (holder != NULL) {
+            delete holder_;
+            holder_ = holder;
+            state_ = kHaveObject;
+            current_key_ = key;
+            return true;
+          }
+          // else read it here, which will print the appropriate warnings
+          // if it fails.
+        }
+        std::istream *is = input_.Open(script_[key_pos].second);
+        if (is == NULL) {
           KALDI_WARN << "RandomAccessTableReader: error opening stream " << PrintableRxfilename(script_[key_pos].second);
           return false;
         } else {
           // Make sure holder empty.
           if (state_ == kHaveObject || state_ == kGaveObject)
-            holder_.Clear();
-          if (holder_.Read(input_.Stream())) {
+            holder_->Clear();
+          if (holder_->Read(*is)) {
             state_ = kHaveObject;
             current_key_ = key;
             return true;
@@ -1380,8 +2210,114 @@ class RandomAccessTableReaderScriptImpl:
     size_t offset;
     if (!LookupKey(key, &offset))
       KALDI_ERR << "RandomAccessTableReader object in inconsistent state.";
-    else
-      script_[offset].second = "";
+    // The background thread reads script_ while holding the mutex.
+    if (thread_running_) pthread_mutex_lock(&mutex_);
+    script_[offset].second = "";
+    if (thread_running_) pthread_mutex_unlock(&mutex_);
+  }
+
+  // The following functions are for the "bg" option, with which a background
+  // thread reads the objects for the next few entries of the script while
+  // the keys are being requested in order.
+
+  static const size_t kMaxPrefetch = 4;
+
+  // Called from the calling thread when the object at "pos" in script_ is
+  // requested.  Returns the object if the background thread has read it
+  // (waiting if it is reading it now), or NULL if it has not or failed to.
+  // Also updates the range of entries the background thread should read.
+  Holder *TakePrefetched(size_t pos) {
+    pthread_mutex_lock(&mutex_);
+    while (loading_ == pos)
+      pthread_cond_wait(&cond_, &mutex_);
+    Holder *ans = NULL;
+    typename std::map<size_t, Holder*>::iterator iter = prefetched_.find(pos);
+    if (iter != prefetched_.end()) {
+      ans = iter->second;
+      prefetched_.erase(iter);
+    }
+    // We only read ahead if the keys are being requested in order, so that
+    // random access does not read objects that will not be used.
+    bool in_order = (pos == last_request_ + 1);
+    last_request_ = pos;
+    window_begin_ = pos + 1;
+    window_end_ = (in_order ? std::min(pos + 1 + kMaxPrefetch, script_.size())
+                   : pos + 1);
+    for (iter = prefetched_.begin(); iter != prefetched_.end(); ) {
+      if (iter->first < window_begin_ || iter->first >= window_end_) {
+        delete iter->second;
+        prefetched_.erase(iter++);
+      } else {
+        ++iter;
+      }
+    }
+    pthread_cond_broadcast(&cond_);
+    pthread_mutex_unlock(&mutex_);
+    return ans;
+  }
+
+  static void *Run(void *this_in) {
+    static_cast<RandomAccessTableReaderScriptImpl<Holder>*>(this_in)->
+        Prefetch();
+    return NULL;
+  }
+
+  // Called from the background thread; reads the objects in the range
+  // [window_begin_, window_end_) of script_ until StopThread() is called.
+  void Prefetch() {
+    InputCache input;  // input_ belongs to the calling thread.
+    pthread_mutex_lock(&mutex_);
+    while (!stop_) {
+      size_t pos = window_begin_;
+      while (pos < window_end_ && prefetched_.count(pos) != 0)
+        pos++;
+      if (pos >= window_end_) {
+        pthread_cond_wait(&cond_, &mutex_);
+        continue;
+      }
+      std::string rxfilename = script_[pos].second;  // "" if tombstone.
+      loading_ = pos;
+      pthread_mutex_unlock(&mutex_);
+      Holder *holder = NULL;
+      try {
+        std::istream *is = (rxfilename.empty() ? NULL :
+                            input.Open(rxfilename));
+        if (is != NULL) {
+          holder = new Holder;
+          if (!holder->Read(*is)) {
+            delete holder;
+            holder = NULL;
+          }
+        }
+      } catch (...) {
+        delete holder;
+        holder = NULL;
+      }
+      pthread_mutex_lock(&mutex_);
+      loading_ = static_cast<size_t>(-1);
+      // A NULL holder means the calling thread will read it itself.
+      if (pos >= window_begin_ && pos < window_end_)
+        prefetched_[pos] = holder;
+      else
+        delete holder;
+      pthread_cond_broadcast(&cond_);
+    }
+    pthread_mutex_unlock(&mutex_);
+  }
+
+  void StopThread() {
+    if (!thread_running_) return;
+    pthread_mutex_lock(&mutex_);
+    stop_ = true;
+    pthread_cond_broadcast(&cond_);
+    pthread_mutex_unlock(&mutex_);
+    if (pthread_join(thread_, NULL) != 0)
+      KALDI_ERR << "RandomAccessTableReader: error joining thread.";
+    thread_running_ = false;
+    for (typename std::map<size_t, Holder*>::iterator iter =
+             prefetched_.begin(); iter != prefetched_.end(); ++iter)
+      delete iter->second;
+    prefetched_.clear();
   }
   bool LookupKey(const std::string &key, size_t *script_offset) {
     // First, an optimization: if we're going consecutively, this will
@@ -1412,14 +2348,15 @@ class RandomAccessTableReaderScriptImpl:
   }
 
 
-  Input input_;  // Use the same input_ object for reading each file, in case
-  // the scp specifies offsets in an archive (so we can keep the same file open).
+  InputCache input_;  // Keeps open the archives that the scp specifies
+  // offsets into, so we can seek in them rather than reopening them.
   RspecifierOptions opts_;
   std::string rspecifier_;  // rspecifier used to open it; used in debug messages
   std::string script_rxfilename_;  // filename of script.
 
   std::string current_key_;  // Key of object in holder_
-  Holder holder_;
+  Holder *holder_;  // A pointer so that we can take objects read by the
+  // background thread without copying.
 
   // the script_ variable contains pairs of (key, filename), sorted using
   // std::sort.  This can be used with binary_search to look up filenames for
@@ -1444,6 +2381,21 @@ class RandomAccessTableReaderScriptImpl:
     // it once.
   } state_;
 
+  // The following are for the "bg" option.
+  bool thread_running_;
+  pthread_t thread_;
+  // The following are protected by mutex_; cond_ is broadcast when they
+  // change.
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;
+  // Objects the background thread has read, indexed by position in script_;
+  // NULL if it failed.
+  std::map<size_t, Holder*> prefetched_;
+  // The range of positions in script_ the background thread should read.
+  size_t window_begin_, window_end_;
+  size_t last_request_;  // The position last requested by the caller.
+  size_t loading_;  // The position being read, or -1.
+  bool stop_;
 };
 
 
@@ -2054,6 +3006,110 @@ template<class Holder>  class RandomAccessTableReaderUnsortedArchiveImpl:
 
 
 
+// RandomAccessTableReaderMmapArchiveImpl is the implementation used when the
+// "mmap" option is given, e.g. "ark,mmap:feats.ark", and the archive is an
+// ordinary file.  The archive is memory-mapped, and keys are looked up in an
+// index of (key, offset) pairs which we read from the file <archive>.idx if it
+// is present and up to date; otherwise we build it by scanning the archive
+// once, and try to write it out for next time.  Only the object most recently
+// asked for is kept in memory, so the memory used does not grow with the size
+// of the archive, and HasKey() and Value() take O(log n) time, regardless of
+// the order in which they are called; the "s", "cs" and "o" options are not
+// needed.
+template<class Holder>  class RandomAccessTableReaderMmapArchiveImpl:
+      public RandomAccessTableReaderImplBase<Holder> {
+ public:
+  typedef typename Holder::T T;
+
+  RandomAccessTableReaderMmapArchiveImpl(): have_object_(false) { }
+
+  virtual bool Open(const std::string &rspecifier) {
+    if (file_.IsOpen()) {
+      if (!Close())  // call Close() yourself to suppress this exception.
+        KALDI_ERR << "TableReader::Open, error closing previous input.";
+    }
+    RspecifierType rs = ClassifyRspecifier(rspecifier, &archive_rxfilename_,
+                                           &opts_);
+    KALDI_ASSERT(rs == kArchiveRspecifier &&
+                 ClassifyRxfilename(archive_rxfilename_) == kFileInput);
+    if (!file_.Open(archive_rxfilename_)) {
+      KALDI_WARN << "TableReader: failed to map archive "
+                 << PrintableRxfilename(archive_rxfilename_);
+      return false;
+    }
+    if (!GetArchiveIndex<Holder>(archive_rxfilename_, file_, opts_.permissive,
+                                 &index_)) {
+      file_.Close();
+      index_.clear();
+      return false;
+    }
+    return true;
+  }
+
+  virtual bool HasKey(const std::string &key) {
+    return (FindKey(key) != NULL);
+  }
+
+  virtual const T &Value(const std::string &key) {
+    if (have_object_ && key == cur_key_)
+      return holder_.Value();
+    const size_t *offset = FindKey(key);
+    if (offset == NULL)
+      KALDI_ERR << "Value() called but no such key " << key
+                << " in archive " << PrintableRxfilename(archive_rxfilename_);
+    if (have_object_) {
+      holder_.Clear();
+      have_object_ = false;
+    }
+    // Read the object straight from the mapped pages.
+    MemoryStreambuf buf(file_.Data(), file_.Size());
+    buf.SetPosition(*offset);
+    std::istream is(&buf);
+    if (!holder_.Read(is))
+      KALDI_ERR << "TableReader: failed to read object for key " << key
+                << " from archive " << PrintableRxfilename(archive_rxfilename_);
+    have_object_ = true;
+    cur_key_ = key;
+    return holder_.Value();
+  }
+
+  virtual bool Close() {
+    if (!file_.IsOpen())
+      KALDI_ERR << "Close() called on TableReader twice or otherwise wrongly.";
+    if (have_object_) {
+      holder_.Clear();
+      have_object_ = false;
+    }
+    file_.Close();
+    index_.clear();
+    return true;
+  }
+
+  virtual ~RandomAccessTableReaderMmapArchiveImpl() {
+    if (file_.IsOpen()) Close();
+  }
+ private:
+  // Returns a pointer to the offset of the object with this key, or NULL if
+  // there is no such key.
+  const size_t *FindKey(const std::string &key) const {
+    ArchiveIndex::const_iterator iter =
+        std::lower_bound(index_.begin(), index_.end(),
+                         std::make_pair(key, static_cast<size_t>(0)));
+    if (iter == index_.end() || iter->first != key) return NULL;
+    else return &(iter->second);
+  }
+
+  MappedFile file_;
+  ArchiveIndex index_;
+  std::string archive_rxfilename_;
+  RspecifierOptions opts_;
+
+  std::string cur_key_;  // key of the object in holder_, if have_object_.
+  Holder holder_;
+  bool have_object_;
+};
+
+
 
 template<class Holder>
 RandomAccessTableReader<Holder>::RandomAccessTableReader(const std::string &rspecifier):
@@ -2068,13 +3124,22 @@ bool RandomAccessTableReader<Holder>::Open(const std::string &rspecifier) {
   if (IsOpen())
     KALDI_ERR << "RandomAccessTableReader::Open(): already open.";
   RspecifierOptions opts;
-  RspecifierType rs = ClassifyRspecifier(rspecifier, NULL, &opts);
+  std::string rxfilename;
+  RspecifierType rs = ClassifyRspecifier(rspecifier, &rxfilename, &opts);
   switch (rs) {
     case kScriptRspecifier:
       impl_ = new RandomAccessTableReaderScriptImpl<Holder>();
       break;
     case kArchiveRspecifier:
-      if (opts.sorted) {
+      if (opts.mmap && (ClassifyRxfilename(rxfilename) != kFileInput ||
+                        IsLz4Filename(rxfilename)))
+        KALDI_WARN << "RandomAccessTableReader: ignoring the mmap option "
+                   << "since the archive is not an ordinary file: "
+                   << rspecifier;
+      if (opts.mmap && ClassifyRxfilename(rxfilename) == kFileInput &&
+          !IsLz4Filename(rxfilename)) {
+        impl_ = new RandomAccessTableReaderMmapArchiveImpl<Holder>();
+      } else if (opts.sorted) {
         if (opts.called_sorted) // "doubly" sorted case.
           impl_ = new RandomAccessTableReaderDSortedArchiveImpl<Holder>();
         else
@@ -2108,7 +3173,8 @@ bool RandomAccessTableReader<Holder>::HasKey(const std::string &key) {
 template<class Holder>
 const typename RandomAccessTableReader<Holder>::T&
 RandomAccessTableReader<Holder>::Value(const std::string &key) {
-  CheckImpl();  
+  KALDI_PROFILE_SCOPE("RandomAccessTableReader::Value");
+  CheckImpl();
   return impl_->Value(key);
 }
 
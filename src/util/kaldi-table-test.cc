@@ -120,6 +120,13 @@ void UnitTestClassifyWspecifier() {
     KALDI_ASSERT(ans == kBothWspecifier && ark == "a b" && scp == "c,d" && opts.binary == false);
   }
 
+  {
+    std::string a = "ark,scp,bg:a,b";
+    std::string ark = "x", scp = "y"; WspecifierOptions opts;
+    WspecifierType ans = ClassifyWspecifier(a, &ark, &scp, &opts);
+    KALDI_ASSERT(ans == kBothWspecifier && ark == "a" && scp == "b" && opts.background);
+  }
+
   {
     std::string a = "";
     std::string ark = "x", scp = "y"; WspecifierOptions opts;
@@ -172,6 +179,32 @@ void UnitTestClassifyWspecifier() {
 
 void UnitTestClassifyRspecifier() {
 
+  {
+    std::string a = "ark,mmap:foo.ark";
+    std::string fname = "x";
+    RspecifierOptions opts;
+    RspecifierType ans = ClassifyRspecifier(a, &fname, &opts);
+    KALDI_ASSERT(ans == kArchiveRspecifier && fname == "foo.ark" && opts.mmap);
+  }
+
+  {
+    std::string a = "scp,bg:foo.scp";
+    std::string fname = "x";
+    RspecifierOptions opts;
+    RspecifierType ans = ClassifyRspecifier(a, &fname, &opts);
+    KALDI_ASSERT(ans == kScriptRspecifier && fname == "foo.scp" &&
+                 opts.background);
+  }
+
+  {
+    std::string a = "ark,shuffle:foo.ark";
+    std::string fname = "x";
+    RspecifierOptions opts;
+    RspecifierType ans = ClassifyRspecifier(a, &fname, &opts);
+    KALDI_ASSERT(ans == kArchiveRspecifier && fname == "foo.ark" &&
+                 opts.shuffle && !opts.mmap);
+  }
+
   {
     std::string a = "ark:foo|";
     std::string fname = "x";
@@ -668,6 +701,211 @@ void UnitTestTableSequentialDoubleMatrixBoth(bool binary, bool read_scp) {
 }
 
 
+// Reading in a background thread.
+void UnitTestTableSequentialBackground(bool binary, bool read_scp) {
+  int32 sz = rand() % 20;
+  std::vector<std::string> k;
+  std::vector<Vector<BaseFloat> > v(sz);
+  for (int32 i = 0; i < sz; i++) {
+    k.push_back(CharToString('a' + static_cast<char>(i)));
+    v[i].Resize(rand() % 5);
+    v[i].SetRandn();
+  }
+  BaseFloatVectorWriter bw(binary ? "b,ark,scp:tmpf,tmpf.scp" :
+                           "t,ark,scp:tmpf,tmpf.scp");
+  for (int32 i = 0; i < sz; i++)
+    bw.Write(k[i], v[i]);
+  KALDI_ASSERT(bw.Close());
+
+  std::string rspecifier = (read_scp ? "scp,bg:tmpf.scp" : "ark,bg:tmpf");
+  {
+    SequentialBaseFloatVectorReader sbr(rspecifier);
+    int32 i = 0;
+    for (; !sbr.Done(); sbr.Next(), i++) {
+      KALDI_ASSERT(i < sz && sbr.Key() == k[i]);
+      KALDI_ASSERT(sbr.Value().ApproxEqual(v[i], binary ? 1.0e-10 : 0.01));
+      if (rand() % 2 == 0) sbr.FreeCurrent();
+    }
+    KALDI_ASSERT(i == sz);
+    KALDI_ASSERT(sbr.Close());
+  }
+  {
+    // Stop early, while the background thread may be waiting for us.
+    SequentialBaseFloatVectorReader sbr(rspecifier);
+    for (int32 i = 0; i < 2 && !sbr.Done(); sbr.Next(), i++)
+      KALDI_ASSERT(sbr.Key() == k[i]);
+    KALDI_ASSERT(sbr.Close());
+  }
+  {
+    SequentialBaseFloatVectorReader sbr;
+    KALDI_ASSERT(!sbr.Open("ark,bg:tmpf.nonexistent"));
+  }
+}
+
+// Reads a whole file into a string.
+static std::string ReadFileContents(const std::string &filename) {
+  Input ki(filename);
+  std::ostringstream os;
+  os << ki.Stream().rdbuf();
+  return os.str();
+}
+
+void UnitTestTableWriterBackground(bool binary, bool both) {
+  int32 sz = rand() % 200;
+  std::vector<std::string> k;
+  std::vector<Vector<BaseFloat> > v(sz);
+  for (int32 i = 0; i < sz; i++) {
+    std::ostringstream os;
+    os << "key" << i;
+    k.push_back(os.str());
+    v[i].Resize(rand() % 1000);
+    v[i].SetRandn();
+  }
+  // The output of the "bg" writer must be identical to the normal one.
+  std::string opts = (binary ? "b," : "t,"),
+      normal = (both ? opts + "ark,scp:tmpf,tmpf.scp" : opts + "ark:tmpf"),
+      bg = (both ? opts + "ark,scp,bg:tmpf.bg,tmpf.bg.scp" :
+            opts + "ark,bg:tmpf.bg");
+  BaseFloatVectorWriter writer(normal), bg_writer(bg);
+  for (int32 i = 0; i < sz; i++) {
+    writer.Write(k[i], v[i]);
+    bg_writer.Write(k[i], v[i]);
+    if (i == sz / 2) bg_writer.Flush();
+  }
+  KALDI_ASSERT(writer.Close() && bg_writer.Close());
+  KALDI_ASSERT(ReadFileContents("tmpf") == ReadFileContents("tmpf.bg"));
+  if (both) {
+    std::string scp = ReadFileContents("tmpf.scp"),
+        bg_scp = ReadFileContents("tmpf.bg.scp");
+    // The lines differ only in the archive name.
+    for (size_t pos; (pos = scp.find("tmpf:")) != std::string::npos; )
+      scp.replace(pos, 5, "tmpf.bg:");
+    KALDI_ASSERT(scp == bg_scp);
+    RandomAccessBaseFloatVectorReader reader("scp:tmpf.bg.scp");
+    for (int32 i = 0; i < sz; i++)
+      KALDI_ASSERT(reader.Value(k[i]).ApproxEqual(v[i],
+                                                  binary ? 1.0e-10 : 0.01));
+  }
+  {
+    BaseFloatVectorWriter bad_writer;
+    KALDI_ASSERT(!bad_writer.Open("ark,bg:/nonexistent/dir/tmpf"));
+  }
+}
+
+// Tests the "align" wspecifier option: the data of each matrix must start at
+// a multiple of kBinaryAlignment bytes in the archive, with and without "bg",
+// and the matrices must read back correctly.
+void UnitTestTableWriterAligned() {
+  int32 sz = rand() % 20;
+  std::vector<std::string> k;
+  std::vector<Matrix<BaseFloat> > v(sz);
+  for (int32 i = 0; i < sz; i++) {
+    std::ostringstream os;
+    os << "key" << i;
+    k.push_back(os.str());
+    if (rand() % 5 != 0)  // else leave it empty.
+      v[i].Resize(1 + rand() % 10, 1 + rand() % 50);
+    v[i].SetRandn();
+  }
+  BaseFloatMatrixWriter writer("ark,scp,align:tmpf,tmpf.scp"),
+      bg_writer("ark,scp,align,bg:tmpf.bg,tmpf.bg.scp");
+  for (int32 i = 0; i < sz; i++) {
+    writer.Write(k[i], v[i]);
+    bg_writer.Write(k[i], v[i]);
+  }
+  KALDI_ASSERT(writer.Close() && bg_writer.Close());
+  std::string archive = ReadFileContents("tmpf");
+  KALDI_ASSERT(archive == ReadFileContents("tmpf.bg"));
+
+  std::vector<std::pair<std::string, std::string> > script;
+  KALDI_ASSERT(ReadScriptFile("tmpf.scp", true, &script) &&
+               static_cast<int32>(script.size()) == sz);
+  for (int32 i = 0; i < sz; i++) {
+    size_t offset = atol(script[i].second.c_str() +
+                         script[i].second.find(':') + 1);
+    // The object is: the binary header "\0B", the token "FA " or "DA ", the
+    // rows, columns and stride (5 bytes each), and the padding count.
+    KALDI_ASSERT(archive.compare(offset, 2, std::string("\0B", 2)) == 0 &&
+                 archive.compare(offset + 2, 3,
+                                 sizeof(BaseFloat) == 4 ? "FA " : "DA ") == 0);
+    int32 padding;
+    memcpy(&padding, archive.data() + offset + 21, sizeof(padding));
+    KALDI_ASSERT((offset + 25 + padding) % kBinaryAlignment == 0);
+  }
+  RandomAccessBaseFloatMatrixReader reader("scp:tmpf.bg.scp");
+  SequentialBaseFloatMatrixReader seq_reader("ark:tmpf");
+  for (int32 i = 0; i < sz; i++, seq_reader.Next()) {
+    KALDI_ASSERT(reader.Value(k[i]).ApproxEqual(v[i], 1.0e-10));
+    KALDI_ASSERT(!seq_reader.Done() && seq_reader.Key() == k[i] &&
+                 seq_reader.Value().ApproxEqual(v[i], 1.0e-10));
+  }
+  KALDI_ASSERT(seq_reader.Done());
+}
+
+// Tests reading an scp whose entries alternate between several archives,
+// which exercises InputCache and the "bg" option for random access.
+void UnitTestTableRandomScriptInterleaved(bool binary, bool background) {
+  int32 sz = rand() % 50, num_archives = 1 + rand() % 3;
+  std::vector<std::string> k;
+  std::vector<Vector<BaseFloat> > v(sz);
+  std::ostringstream scp;
+  {
+    std::vector<BaseFloatVectorWriter*> writers;
+    for (int32 a = 0; a < num_archives; a++) {
+      std::ostringstream os;
+      os << (binary ? "b" : "t") << ",ark,scp:tmpf." << a << ",tmpf.scp." << a;
+      writers.push_back(new BaseFloatVectorWriter(os.str()));
+    }
+    for (int32 i = 0; i < sz; i++) {
+      std::ostringstream os;
+      os << "key" << (1000 + i);  // so they are sorted.
+      k.push_back(os.str());
+      v[i].Resize(rand() % 10);
+      v[i].SetRandn();
+      writers[i % num_archives]->Write(k[i], v[i]);
+    }
+    for (int32 a = 0; a < num_archives; a++)
+      delete writers[a];
+  }
+  {
+    // Combine the scp files in key order, so the archives alternate.
+    std::vector<std::vector<std::pair<std::string, std::string> > > scps(
+        num_archives);
+    for (int32 a = 0; a < num_archives; a++) {
+      std::ostringstream os;
+      os << "tmpf.scp." << a;
+      KALDI_ASSERT(ReadScriptFile(os.str(), true, &(scps[a])));
+    }
+    Output ko("tmpf.scp", false);
+    for (int32 i = 0; i < sz; i++) {
+      const std::pair<std::string, std::string> &pr =
+          scps[i % num_archives][i / num_archives];
+      KALDI_ASSERT(pr.first == k[i]);
+      ko.Stream() << pr.first << ' ' << pr.second << '\n';
+    }
+  }
+  std::string rspecifier = (background ? "scp,bg:tmpf.scp" : "scp:tmpf.scp");
+  RandomAccessBaseFloatVectorReader reader(rspecifier);
+  // In order, then at random.
+  for (int32 i = 0; i < sz; i++)
+    KALDI_ASSERT(reader.Value(k[i]).ApproxEqual(v[i], binary ? 1.0e-10 : 0.01));
+  for (int32 j = 0; j < sz; j++) {
+    int32 i = rand() % sz;
+    KALDI_ASSERT(reader.HasKey(k[i]) &&
+                 reader.Value(k[i]).ApproxEqual(v[i], binary ? 1.0e-10 : 0.01));
+  }
+  KALDI_ASSERT(!reader.HasKey("nosuchkey"));
+  KALDI_ASSERT(reader.Close());
+
+  SequentialBaseFloatVectorReader sreader(background ? "scp,bg:tmpf.scp" :
+                                          "scp:tmpf.scp");
+  int32 i = 0;
+  for (; !sreader.Done(); sreader.Next(), i++)
+    KALDI_ASSERT(sreader.Key() == k[i] &&
+                 sreader.Value().ApproxEqual(v[i], binary ? 1.0e-10 : 0.01));
+  KALDI_ASSERT(i == sz);
+}
+
 // Writing as both and reading as archive.
 void UnitTestTableSequentialBaseFloatVectorBoth(bool binary, bool read_scp) {
   int32 sz = rand() % 10;
@@ -870,6 +1108,91 @@ void UnitTestTableRandomBothDoubleMatrix(bool binary, bool read_scp,
 }
 
 
+void UnitTestTableRandomMmapDoubleMatrix(bool binary) {
+  int32 sz = rand() % 10;
+  std::vector<std::string> k;
+  std::vector<Matrix<double> > v;
+  for (int32 i = 0; i < sz; i++) {
+    k.push_back(CharToString('a' + static_cast<char>(i)));
+    if (i%2 == 0) k.back() = k.back() +  CharToString('a' + i);
+    v.resize(v.size()+1);
+    v.back().Resize(1 + rand()%3, 1 + rand()%3);
+    for (int32 j = 0; j < v.back().NumRows(); j++)
+      for (int32 k = 0; k < v.back().NumCols(); k++)
+        v.back()(j, k) =  (rand() % 100);
+  }
+  RandomizeVector(&k);
+
+  DoubleMatrixWriter bw(binary ? "b,ark:tmpf" : "t,ark:tmpf");
+  for (int32 i = 0; i < sz; i++)
+    bw.Write(k[i], v[i]);
+  KALDI_ASSERT(bw.Close());
+  unlink("tmpf.idx");  // make sure we don't use an old index.
+
+  // The first time we build the index and write it out; the second time we
+  // read it.
+  for (int32 pass = 0; pass < 2; pass++) {
+    RandomAccessDoubleMatrixReader sbr;
+    if (sz == 0) {
+      // we can't map an empty file.
+      KALDI_ASSERT(!sbr.Open("ark,mmap:tmpf"));
+      return;
+    }
+    KALDI_ASSERT(sbr.Open("ark,mmap:tmpf"));
+    KALDI_ASSERT(!sbr.HasKey("z"));
+    for (int32 i = 0; i < 10; i++) {
+      int32 n = rand() % sz;
+      KALDI_ASSERT(sbr.HasKey(k[n]));
+      KALDI_ASSERT(v[n].ApproxEqual(sbr.Value(k[n]),
+                                    binary ? 1.0e-10 : 0.01));
+    }
+    KALDI_ASSERT(sbr.Close());
+  }
+  std::ifstream is("tmpf.idx");
+  KALDI_ASSERT(is.good());
+}
+
+
+// Reading an archive in a random order with the "shuffle" option.
+void UnitTestTableSequentialShuffled(bool binary) {
+  int32 sz = 1 + rand() % 2000;
+  std::vector<std::string> k;
+  std::vector<Vector<BaseFloat> > v(sz);
+  for (int32 i = 0; i < sz; i++) {
+    std::ostringstream os;
+    os << "utt" << i;
+    k.push_back(os.str());
+    v[i].Resize(rand() % 5);
+    v[i].SetRandn();
+  }
+  BaseFloatVectorWriter bw(binary ? "b,ark:tmpf" : "t,ark:tmpf");
+  for (int32 i = 0; i < sz; i++)
+    bw.Write(k[i], v[i]);
+  KALDI_ASSERT(bw.Close());
+  unlink("tmpf.idx");  // make sure we don't use an old index.
+
+  for (int32 pass = 0; pass < 2; pass++) {
+    std::vector<bool> seen(sz, false);
+    SequentialBaseFloatVectorReader sbr("ark,shuffle:tmpf");
+    int32 num_read = 0;
+    for (; !sbr.Done(); sbr.Next(), num_read++) {
+      int32 i = atoi(sbr.Key().c_str() + 3);
+      KALDI_ASSERT(i >= 0 && i < sz && k[i] == sbr.Key() && !seen[i]);
+      seen[i] = true;
+      if (rand() % 3 == 0) continue;  // sometimes skip reading the object.
+      KALDI_ASSERT(sbr.Value().ApproxEqual(v[i], binary ? 1.0e-10 : 0.01));
+      if (rand() % 2 == 0) sbr.FreeCurrent();
+    }
+    KALDI_ASSERT(num_read == sz);
+    KALDI_ASSERT(sbr.Close());
+  }
+  {
+    SequentialBaseFloatVectorReader sbr;
+    KALDI_ASSERT(!sbr.Open("ark,shuffle:tmpf.nonexistent"));
+  }
+}
+
+
 
 }  // end namespace kaldi.
 
@@ -892,6 +1215,9 @@ int main() {
       UnitTestTableSequentialInt32PairVectorBoth(b, c);
       UnitTestTableSequentialInt32VectorVectorBoth(b, c);
       UnitTestTableSequentialBaseFloatVectorBoth(b, c);
+      UnitTestTableSequentialBackground(b, c);
+      UnitTestTableWriterBackground(b, c);
+      UnitTestTableRandomScriptInterleaved(b, c);
       for (int k = 0; k < 2; k++) {
         bool d = (k == 0);
         for (int l = 0; l < 2; l++) {
@@ -904,6 +1230,9 @@ int main() {
         }
       }
     }
+    UnitTestTableRandomMmapDoubleMatrix(b);
+    UnitTestTableSequentialShuffled(b);
+    UnitTestTableWriterAligned();
   }
   std::cout << "Test OK.\n";
   return 0;
@@ -173,6 +173,14 @@ WspecifierType ClassifyWspecifier(const std::string &wspecifier,
       if (opts) opts->binary = false;
     } else if (!strcmp(c, "p")) {
       if (opts) opts->permissive = true;
+    } else if (!strcmp(c, "bg")) {
+      if (opts) opts->background = true;
+    } else if (!strcmp(c, "nbg")) {
+      if (opts) opts->background = false;
+    } else if (!strcmp(c, "align")) {
+      if (opts) opts->align = true;
+    } else if (!strcmp(c, "nalign")) {
+      if (opts) opts->align = false;
     } else if (!strcmp(c, "ark")) {
       if (ws == kNoWspecifier) ws = kArchiveWspecifier;
       else return kNoWspecifier;  // We do not allow "scp, ark", only "ark, scp".
@@ -219,7 +227,8 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
   // We also allow the meaningless prefixes b, and t,
   // plus the options o (once), no (not-once),
   // s (sorted) and ns (not-sorted), p (permissive)
-  // and np (not-permissive).
+  // and np (not-permissive), mmap and nmmap, bg and nbg, shuffle and
+  // nshuffle.
   // so the following would be valid:
   //
   // f, o, b, np, ark:rxfilename  ->  kArchiveRspecifier
@@ -276,6 +285,18 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
       if (opts) opts->called_sorted = true;
     } else if (!strcmp(c, "ncs")) {
       if (opts) opts->called_sorted = false;
+    } else if (!strcmp(c, "mmap")) {
+      if (opts) opts->mmap = true;
+    } else if (!strcmp(c, "nmmap")) {
+      if (opts) opts->mmap = false;
+    } else if (!strcmp(c, "bg")) {
+      if (opts) opts->background = true;
+    } else if (!strcmp(c, "nbg")) {
+      if (opts) opts->background = false;
+    } else if (!strcmp(c, "shuffle")) {
+      if (opts) opts->shuffle = true;
+    } else if (!strcmp(c, "nshuffle")) {
+      if (opts) opts->shuffle = false;
     } else if (!strcmp(c, "ark")) {
       if (rs == kNoRspecifier) rs = kArchiveRspecifier;
       else return kNoRspecifier;  // Repeated or combined ark and scp options invalid.
@@ -71,11 +71,27 @@ typedef std::vector<std::string> KeyList;
 //     missing scp entries, i.e. won't write anything for those files but will
 //     return success status).
 //
+//  bg means "background", for archives only (ark or ark,scp): Write()
+//     serializes the object into memory and a separate thread writes it to
+//     the archive (and the scp file), so the program does not wait for slow
+//     filesystems such as NFS.  The output is identical to that without
+//     "bg", but write errors are only reported by a later Write() or by
+//     Close().  Flush() and Close() wait for everything to be written.
+//
+//  align means that, in binary archives, matrices are written in an aligned
+//     format (see MatrixBase::WriteAligned()) whose data starts at a multiple
+//     of 64 bytes in the archive, with each row padded to 64 bytes, so that
+//     a program that maps the archive into memory (see the "mmap" rspecifier
+//     option) can use it in place.  The archive is a little larger; all
+//     readers of matrices can read it.  The archive should be an ordinary
+//     file, since the alignment is worked out from the position in it.
+//
 //  So the following are valid wspecifiers:
 //  ark,b,f:foo
 //  "ark,b,b:| gzip -c > foo"
 //  "ark,scp,t,nf:foo.ark,|gzip -c > foo.scp.gz"
 //  ark,b:-
+//  ark,scp,bg:1.lats,1.scp
 //
 //  The meanings of rxfilename and wxfilename are as described in
 //  kaldi-stream.h (they are filenames but include pipes, stdin/stdout
@@ -113,7 +129,10 @@ struct WspecifierOptions {
   bool binary;
   bool flush;
   bool permissive; // will ignore absent scp entries.
-  WspecifierOptions(): binary(true), flush(false), permissive(false) { }
+  bool background;  // If "bg", archives are written in a separate thread.
+  bool align;  // If "align", matrices in binary archives have aligned data.
+  WspecifierOptions(): binary(true), flush(false), permissive(false),
+                       background(false), align(false) { }
 };
 
 // ClassifyWspecifier returns the type of the wspecifier string,
@@ -173,6 +192,24 @@ bool WriteScriptFile(std::ostream &os,
 //   p   means "permissive", and causes it to skip over keys whose corresponding
 //       scp-file entries cannot be read. [and to ignore errors in archives and
 //       script files, and just consider the "good" entries].
+//   mmap  means that the archive (which must be an ordinary file, not a pipe
+//       or a compressed ".lz4" file)
+//       should be memory-mapped and read using an index of keys to file
+//       offsets, kept in a file with ".idx" appended to the archive name, and
+//       created the first time it is needed.  This only affects
+//       RandomAccessTableReader, for which it means that we do not have to read
+//       the archive at startup or keep its objects in memory.
+//   bg  means "background": SequentialTableReader will read the objects in a
+//       separate thread, a few objects ahead of the program, so that reading
+//       overlaps with computation.  RandomAccessTableReader with a script file
+//       does the same while the keys are requested in the order of the
+//       (sorted) script file.
+//   shuffle  only affects SequentialTableReader, and requires an archive that
+//       is an ordinary file: the archive is memory-mapped and indexed as for
+//       "mmap", and the objects are returned in a random order (which depends
+//       on srand()), so a separate shuffling pass is not needed.  The order
+//       is randomized at the level of blocks of consecutive objects, so reads
+//       from the file stay fairly localized.
 //       We allow the negation of the options above, as in no, ns, np,
 //       but these aren't currently very useful (just equivalent to omitting the
 //       corresponding option).
@@ -198,9 +235,17 @@ struct  RspecifierOptions {
   // For archive files it will suppress errors getting thrown if the archive
   
   // is corrupted and can't be read to the end.
+  bool mmap;  // If "mmap", RandomAccessTableReader memory-maps the archive and
+  // uses an index file rather than reading the archive into memory.
+  bool background;  // If "bg", SequentialTableReader (and
+  // RandomAccessTableReader with a script file) reads ahead in a background
+  // thread.
+  bool shuffle;  // If "shuffle", SequentialTableReader returns the objects of
+  // a memory-mapped archive in a random order.
 
   RspecifierOptions(): once(false), sorted(false),
-                       called_sorted(false), permissive(false) { }
+                       called_sorted(false), permissive(false), mmap(false),
+                       background(false), shuffle(false) { }
 };
 
 enum RspecifierType  {
@@ -312,7 +357,11 @@ class SequentialTableReader {
   // key does not even exist, if the corresponding file cannot be
   // read.]  You probably wouldn't want to catch this exception;
   // the user can just specify the p option in the rspecifier.
-  const T &Value();
+  // The reference is non-const so that you can Swap() the object out,
+  // rather than copying it, if you want to keep it or modify it: e.g.
+  // Matrix<BaseFloat> feats; feats.Swap(&reader.Value());
+  // Until Next() is called, Value() then returns whatever you swapped in.
+  T &Value();
 
   // Next goes to the next key.  It will not throw; any error will
   // result in Done() returning true, and then the destructor will
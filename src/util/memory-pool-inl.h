@@ -0,0 +1,106 @@
+// util/memory-pool-inl.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_UTIL_MEMORY_POOL_INL_H_
+#define KALDI_UTIL_MEMORY_POOL_INL_H_
+
+// Do not include this file directly.  It is included by memory-pool.h
+
+
+namespace kaldi {
+
+template<class T> MemoryPool<T>::MemoryPool(size_t block_size):
+    freed_head_(NULL), cur_block_(0), cur_pos_(0), block_size_(block_size) {
+  KALDI_ASSERT(block_size > 0);
+}
+
+template<class T>
+inline void *MemoryPool<T>::Allocate() {
+  Slot *ans;
+  if (freed_head_ != NULL) {
+    ans = freed_head_;
+    freed_head_ = freed_head_->next;
+  } else {
+    if (cur_block_ == allocated_.size() || cur_pos_ == block_size_) {
+      // the current block is used up; move on to the next one, getting it
+      // from the system if we have never allocated it.
+      if (cur_block_ < allocated_.size()) cur_block_++;
+      if (cur_block_ == allocated_.size()) {
+        allocated_.push_back(new Slot[block_size_]);
+        stats_.num_blocks++;
+        stats_.num_allocated += block_size_;
+      }
+      cur_pos_ = 0;
+    }
+    ans = allocated_[cur_block_] + cur_pos_;
+    cur_pos_++;
+  }
+  stats_.num_calls++;
+  if (++stats_.num_in_use > stats_.max_in_use)
+    stats_.max_in_use = stats_.num_in_use;
+  return static_cast<void*>(ans);
+}
+
+template<class T>
+inline void MemoryPool<T>::Free(T *t) {
+  KALDI_PARANOID_ASSERT(stats_.num_in_use > 0);
+  Slot *s = reinterpret_cast<Slot*>(t);
+  s->next = freed_head_;
+  freed_head_ = s;
+  stats_.num_in_use--;
+}
+
+template<class T>
+void MemoryPool<T>::FreeAll() {
+  // We don't need to visit the objects; we just start carving up the blocks
+  // again from the beginning.
+  freed_head_ = NULL;
+  cur_block_ = 0;
+  cur_pos_ = 0;
+  stats_.num_in_use = 0;
+}
+
+template<class T>
+void MemoryPool<T>::Release() {
+  for (size_t i = 0; i < allocated_.size(); i++)
+    delete [] allocated_[i];
+  allocated_.clear();
+  FreeAll();
+  stats_.num_blocks = 0;
+  stats_.num_allocated = 0;
+}
+
+template<class T>
+void MemoryPool<T>::SetBlockSize(size_t block_size) {
+  KALDI_ASSERT(block_size > 0);
+  Release();
+  block_size_ = block_size;
+}
+
+template<class T>
+void MemoryPool<T>::ResetStats() {
+  stats_.max_in_use = stats_.num_in_use;
+  stats_.num_calls = 0;
+}
+
+
+} // end namespace kaldi
+
+#endif
@@ -0,0 +1,92 @@
+// util/memory-pool-test.cc
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "util/memory-pool.h"
+#include <set>
+#include <cstdlib>
+#include <iostream>
+
+namespace kaldi {
+
+struct TestPoolObject {
+  float cost;
+  int32 label;
+  TestPoolObject *next;
+  TestPoolObject(float cost, int32 label, TestPoolObject *next):
+      cost(cost), label(label), next(next) { }
+};
+
+void TestMemoryPool() {
+  size_t block_size = 1 + rand() % 20;
+  MemoryPool<TestPoolObject> pool(block_size);
+
+  for (int32 iter = 0; iter < 5; iter++) {
+    std::vector<TestPoolObject*> live;
+    for (int32 i = 0; i < 200; i++) {
+      if (!live.empty() && rand() % 3 == 0) {
+        size_t j = rand() % live.size();
+        // check the contents have not been overwritten.
+        KALDI_ASSERT(live[j]->label == static_cast<int32>(
+            live[j]->cost));
+        pool.Free(live[j]);
+        live[j] = live.back();
+        live.pop_back();
+      } else {
+        TestPoolObject *obj = new (pool.Allocate()) TestPoolObject(i, i, NULL);
+        live.push_back(obj);
+      }
+      KALDI_ASSERT(pool.NumInUse() == live.size());
+    }
+    // all live objects must be distinct.
+    std::set<TestPoolObject*> s(live.begin(), live.end());
+    KALDI_ASSERT(s.size() == live.size());
+    for (size_t j = 0; j < live.size(); j++)
+      KALDI_ASSERT(live[j]->label == static_cast<int32>(live[j]->cost));
+
+    const MemoryPoolStats &stats = pool.GetStats();
+    KALDI_ASSERT(stats.num_allocated == stats.num_blocks * block_size);
+    KALDI_ASSERT(stats.max_in_use <= stats.num_allocated);
+    KALDI_ASSERT(stats.max_in_use >= live.size());
+    size_t num_blocks = stats.num_blocks;
+
+    pool.FreeAll();
+    KALDI_ASSERT(pool.NumInUse() == 0);
+    // after FreeAll(), the same number of objects should fit into the
+    // same memory.
+    for (size_t j = 0; j < live.size(); j++)
+      pool.Allocate();
+    KALDI_ASSERT(pool.GetStats().num_blocks == num_blocks);
+    pool.FreeAll();
+  }
+  pool.Release();
+  KALDI_ASSERT(pool.GetStats().num_blocks == 0);
+}
+
+
+} // end namespace kaldi
+
+
+
+int main() {
+  using namespace kaldi;
+  for (size_t i = 0; i < 10; i++)
+    TestMemoryPool();
+  std::cout << "Test OK.\n";
+}
@@ -0,0 +1,116 @@
+// util/memory-pool.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_UTIL_MEMORY_POOL_H_
+#define KALDI_UTIL_MEMORY_POOL_H_
+#include <vector>
+#include <new>
+#include "base/kaldi-common.h"
+
+
+/* This header provides a simple slab allocator for small, fixed-size objects
+   that are allocated and freed very frequently, such as the Tokens and
+   ForwardLinks in the lattice decoders.  It is in the same spirit as the block
+   allocation that HashList does internally for its Elems (see hash-list.h):
+   memory is obtained from the system in large blocks, freed objects go on a
+   free list for reuse, and FreeAll() returns every object to the pool in one
+   operation without touching the objects individually.  Because each decoder
+   owns its own pools, there is no locking and no contention on the global
+   allocator when many decoders run in parallel threads.
+
+   The pool only manages memory: Allocate() returns uninitialized storage that
+   the user should construct with placement new, e.g.
+     Token *tok = new (token_pool.Allocate()) Token(cost, 0.0, NULL, NULL);
+   and Free() does not call the destructor.  It is therefore only suitable for
+   types with trivial destructors.
+
+   See memory-pool-test.cc for an example of how to use this object.
+*/
+
+
+namespace kaldi {
+
+/// Statistics on the usage of a MemoryPool; see MemoryPool::GetStats().
+struct MemoryPoolStats {
+  size_t num_blocks;  ///< Number of blocks obtained from the system.
+  size_t num_allocated;  ///< Capacity in objects (num_blocks * block size).
+  size_t num_in_use;  ///< Objects currently handed out to the user.
+  size_t max_in_use;  ///< Highest value num_in_use has reached.
+  size_t num_calls;  ///< Total number of calls to Allocate().
+  MemoryPoolStats(): num_blocks(0), num_allocated(0), num_in_use(0),
+                     max_in_use(0), num_calls(0) { }
+};
+
+template<class T> class MemoryPool {
+ public:
+  /// The block size is the number of objects we get from the system at a time.
+  explicit MemoryPool(size_t block_size = 1024);
+
+  /// Returns uninitialized storage for one object of type T.
+  inline void *Allocate();
+
+  /// Returns one object to the pool.  The destructor is not called.
+  inline void Free(T *t);
+
+  /// Returns all objects to the pool at once, keeping the memory for reuse.
+  /// Any pointers previously returned by Allocate() become invalid.
+  void FreeAll();
+
+  /// Returns all memory to the system.  Like FreeAll(), invalidates all
+  /// pointers previously returned by Allocate().
+  void Release();
+
+  /// Changes the block size; calls Release() first, so this invalidates any
+  /// pointers previously returned by Allocate().
+  void SetBlockSize(size_t block_size);
+
+  size_t NumInUse() const { return stats_.num_in_use; }
+
+  const MemoryPoolStats &GetStats() const { return stats_; }
+
+  /// Resets max_in_use and num_calls; does not affect the memory.
+  void ResetStats();
+
+  ~MemoryPool() { Release(); }
+ private:
+  // A Slot is either a free-list entry or the storage for one T.  The double
+  // is there to ensure the alignment is suitable for any reasonable T.
+  union Slot {
+    Slot *next;
+    double align;
+    char data[sizeof(T)];
+  };
+
+  Slot *freed_head_;  // head of list of freed slots [ready for allocation].
+  size_t cur_block_;  // index into allocated_ of block we are carving up.
+  size_t cur_pos_;  // position of next never-used slot in allocated_[cur_block_].
+  size_t block_size_;
+  std::vector<Slot*> allocated_;  // list of allocated blocks.
+  MemoryPoolStats stats_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MemoryPool);
+};
+
+
+} // end namespace kaldi
+
+#include "util/memory-pool-inl.h"
+
+#endif
@@ -0,0 +1,169 @@
+// util/open-hash-list-inl.h
+
+// Copyright 2026  agent
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_UTIL_OPEN_HASH_LIST_INL_H_
+#define KALDI_UTIL_OPEN_HASH_LIST_INL_H_
+
+// Do not include this file directly.  It is included by open-hash-list.h
+
+
+namespace kaldi {
+
+template<class I, class T> OpenHashList<I, T>::OpenHashList():
+    list_head_(NULL), list_tail_(NULL), mask_(0), freed_head_(NULL) {
+  Resize(16);
+}
+
+template<class I, class T> void OpenHashList<I, T>::Resize(size_t num_slots) {
+  size_t size = 16;
+  while (size < num_slots) size *= 2;
+  Slot empty;
+  empty.key = I();
+  empty.elem = NULL;
+  slots_.clear();
+  slots_.resize(size, empty);
+  mask_ = size - 1;
+}
+
+template<class I, class T> void OpenHashList<I, T>::SetSize(size_t size) {
+  KALDI_ASSERT(list_head_ == NULL && used_slots_.empty());  // make sure empty.
+  if (2 * size > slots_.size())
+    Resize(2 * size);
+}
+
+template<class I, class T>
+typename OpenHashList<I, T>::Elem* OpenHashList<I, T>::Clear() {
+  // We only visit the slots that are occupied, so this takes time
+  // proportional to the number of elements, not the size of the table.
+  for (size_t i = 0; i < used_slots_.size(); i++)
+    slots_[used_slots_[i]].elem = NULL;
+  used_slots_.clear();
+  Elem *ans = list_head_;
+  list_head_ = list_tail_ = NULL;
+  return ans;
+}
+
+template<class I, class T>
+inline void OpenHashList<I, T>::Delete(Elem *e) {
+  e->tail = freed_head_;
+  freed_head_ = e;
+}
+
+template<class I, class T>
+inline typename OpenHashList<I, T>::Elem* OpenHashList<I, T>::New() {
+  if (freed_head_) {
+    Elem *ans = freed_head_;
+    freed_head_ = freed_head_->tail;
+    return ans;
+  } else {
+    Elem *tmp = new Elem[allocate_block_size_];
+    for (size_t i = 0; i+1 < allocate_block_size_; i++)
+      tmp[i].tail = tmp+i+1;
+    tmp[allocate_block_size_-1].tail = NULL;
+    freed_head_ = tmp;
+    allocated_.push_back(tmp);
+    return this->New();
+  }
+}
+
+template<class I, class T>
+inline typename OpenHashList<I, T>::Slot* OpenHashList<I, T>::FindSlot(I key) {
+  size_t index = Hash(key);
+  while (true) {
+    Slot *slot = &(slots_[index]);
+    if (slot->elem == NULL || slot->key == key) return slot;
+    index = (index + 1) & mask_;
+  }
+}
+
+template<class I, class T>
+inline typename OpenHashList<I, T>::Elem* OpenHashList<I, T>::Find(I key) {
+  return FindSlot(key)->elem;
+}
+
+template<class I, class T>
+inline void OpenHashList<I, T>::Insert(I key, T val) {
+  if (2 * (used_slots_.size() + 1) > slots_.size())
+    Grow();
+  Slot *slot = FindSlot(key);
+  Elem *elem = New();
+  elem->key = key;
+  elem->val = val;
+  elem->tail = NULL;
+  if (list_tail_ == NULL) list_head_ = elem;
+  else list_tail_->tail = elem;
+  list_tail_ = elem;
+  if (slot->elem == NULL) {
+    slot->key = key;
+    slot->elem = elem;
+    used_slots_.push_back(slot - &(slots_[0]));
+  }
+  // else the key was already present, and the user has broken the
+  // contract; Find() will find the first one that was added.
+}
+
+template<class I, class T>
+inline void OpenHashList<I, T>::InsertMore(I key, T val) {
+  Elem *e = FindSlot(key)->elem;
+  KALDI_ASSERT(e != NULL);  // we assume there is already one element
+  while (e->tail != NULL && e->tail->key == key)
+    e = e->tail;
+  Elem *elem = New();
+  elem->key = key;
+  elem->val = val;
+  elem->tail = e->tail;
+  e->tail = elem;
+  if (list_tail_ == e) list_tail_ = elem;
+}
+
+template<class I, class T> void OpenHashList<I, T>::Grow() {
+  Resize(2 * slots_.size());
+  used_slots_.clear();
+  for (Elem *e = list_head_; e != NULL; e = e->tail) {
+    Slot *slot = FindSlot(e->key);
+    if (slot->elem == NULL) {
+      slot->key = e->key;
+      slot->elem = e;
+      used_slots_.push_back(slot - &(slots_[0]));
+    }
+  }
+}
+
+template<class I, class T>
+OpenHashList<I, T>::~OpenHashList() {
+  // First test whether we had any memory leak, i.e. things for which the user
+  // did not call Delete().
+  size_t num_in_list = 0, num_allocated = 0;
+  for (Elem *e = freed_head_; e != NULL; e = e->tail)
+    num_in_list++;
+  for (size_t i = 0; i < allocated_.size(); i++) {
+    num_allocated += allocate_block_size_;
+    delete[] allocated_[i];
+  }
+  if (num_in_list != num_allocated) {
+    KALDI_WARN << "Possible memory leak: " << num_in_list
+               << " != " << num_allocated;
+  }
+}
+
+
+} // end namespace kaldi
+
+#endif
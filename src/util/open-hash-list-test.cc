@@ -0,0 +1,147 @@
+// util/open-hash-list-test.cc
+
+// Copyright 2026  agent
+// (based on util/hash-list-test.cc; see that file for its authors)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "util/open-hash-list.h"
+#include <map> // for baseline.
+#include <cstdlib>
+#include <iostream>
+
+namespace kaldi {
+
+template<class Int, class T> void TestOpenHashList() {
+  typedef typename OpenHashList<Int, T>::Elem Elem;
+
+  OpenHashList<Int, T> hash;
+  hash.SetSize(200);  // must be called before use.
+  std::map<Int, T> m1;
+  for (size_t j = 0; j < 50; j++) {
+    Int key = rand() % 200;
+    T val = rand() % 50;
+    m1[key] = val;
+    Elem *e = hash.Find(key);
+    if (e) e->val = val;
+    else  hash.Insert(key, val);
+  }
+
+
+  std::map<Int, T> m2;
+
+  for (int i = 0; i < 100; i++) {
+
+    m2.clear();
+    for (typename std::map<Int, T>::const_iterator iter = m1.begin();
+        iter != m1.end();
+        iter++) {
+      m2[iter->first + 1] = iter->second;
+    }
+    std::swap(m1, m2);
+
+    Elem *h = hash.Clear(), *tmp;
+
+    hash.SetSize(100 + rand() % 100);  // note, SetSize is relatively cheap operation as long
+    // as we are not increasing the size more than it's ever previously been increased to.
+
+    for (; h != NULL; h = tmp) {
+      hash.Insert(h->key + 1, h->val);
+      tmp = h->tail;
+      hash.Delete(h);  // think of this like calling delete.
+    }
+
+    // Now make sure h and m2 are the same.
+    Elem *list = hash.GetList();
+    size_t count = 0;
+    for (; list != NULL; list = list->tail, count++) {
+      KALDI_ASSERT(m1[list->key] == list->val);
+    }
+
+    for (size_t j = 0; j < 10; j++) {
+      Int key = rand() % 200;
+      bool found_m1 = (m1.find(key) != m1.end());
+      if (found_m1) m1[key];
+      Elem *e = hash.Find(key);
+      KALDI_ASSERT( (e != NULL) == found_m1 );
+      if (found_m1)
+        KALDI_ASSERT(m1[key] == e->val);
+    }
+
+    KALDI_ASSERT(m1.size() == count);
+  }
+  Elem *h = hash.Clear(), *tmp;
+  for (; h != NULL; h = tmp) {
+    tmp = h->tail;
+    hash.Delete(h);
+  }
+}
+
+
+// Tests InsertMore(), and a table that has to grow.
+void TestOpenHashListInsertMore() {
+  typedef OpenHashList<int32, int32>::Elem Elem;
+  OpenHashList<int32, int32> hash;
+  hash.SetSize(10);
+  std::map<int32, int32> counts;
+  for (int32 i = 0; i < 1000; i++) {
+    int32 key = rand() % 500;
+    if (hash.Find(key) == NULL) hash.Insert(key, i);
+    else hash.InsertMore(key, i);
+    counts[key]++;
+  }
+  // Elements with the same key must be adjacent and in the order they were
+  // added, and Find() must return the first.
+  std::map<int32, int32> counts2;
+  int32 prev_key = -1, prev_val = -1;
+  for (Elem *e = hash.GetList(); e != NULL; e = e->tail) {
+    if (e->key == prev_key) {
+      KALDI_ASSERT(e->val > prev_val);
+    } else {
+      KALDI_ASSERT(counts2.count(e->key) == 0);
+      KALDI_ASSERT(hash.Find(e->key) == e);
+    }
+    counts2[e->key]++;
+    prev_key = e->key;
+    prev_val = e->val;
+  }
+  KALDI_ASSERT(counts == counts2);
+  Elem *h = hash.Clear(), *tmp;
+  for (; h != NULL; h = tmp) {
+    tmp = h->tail;
+    hash.Delete(h);
+  }
+  KALDI_ASSERT(hash.GetList() == NULL && hash.Find(0) == NULL);
+}
+
+} // end namespace kaldi
+
+
+
+int main() {
+  using namespace kaldi;
+  for (size_t i = 0;i < 3;i++) {
+    TestOpenHashList<int, unsigned int>();
+    TestOpenHashList<unsigned int, int>();
+    TestOpenHashList<short int, long int>();
+    TestOpenHashList<short unsigned int, long int>();
+    TestOpenHashList<char, unsigned char>();
+    TestOpenHashList<unsigned char, int>();
+    TestOpenHashListInsertMore();
+  }
+  std::cout << "Test OK.\n";
+}
@@ -0,0 +1,140 @@
+// util/open-hash-list.h
+
+// Copyright 2026  agent
+// (based on util/hash-list.h; see that file for its authors)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_UTIL_OPEN_HASH_LIST_H_
+#define KALDI_UTIL_OPEN_HASH_LIST_H_
+#include <vector>
+#include "base/kaldi-common.h"
+
+
+/* This header provides OpenHashList, which has exactly the same interface as
+   HashList (see hash-list.h) and can be used in its place in the decoders, but
+   is implemented differently.  HashList keeps, for each bucket, a pointer into
+   the list of Elems, so a Find() has to follow pointers from the bucket into
+   the Elems (and along the list, for buckets with more than one key).  Here,
+   the hash is a flat array of (key, Elem*) slots with linear probing, so a
+   Find() usually looks at just one or two adjacent slots and only touches the
+   Elem it returns.  The list is kept in insertion order, which in the decoders
+   means the Elems for one frame were mostly allocated one after another and
+   are close together in memory.
+
+   The table size is rounded up to a power of two.  If more than half the
+   slots get used, the table grows (this doesn't invalidate any Elems).
+
+   See open-hash-list-test.cc for a test, and hash-list-bench.cc for a
+   comparison with HashList.
+*/
+
+
+namespace kaldi {
+
+template<class I, class T> class OpenHashList {
+ public:
+  struct Elem {
+    I key;
+    T val;
+    Elem *tail;
+  };
+
+  OpenHashList();
+
+  /// Clears the hash and gives the head of the current list to the user;
+  /// ownership is transferred to the user (the user must call Delete()
+  /// for each element in the list, at his/her leisure).
+  Elem *Clear();
+
+  /// Gives the head of the current list to the user.  Ownership retained in the
+  /// class.
+  Elem *GetList() { return list_head_; }
+
+  /// Const version of GetList().
+  const Elem *GetList() const { return list_head_; }
+
+  /// Think of this like delete().  It is to be called for each Elem in turn
+  /// after you "obtained ownership" by doing Clear().
+  inline void Delete(Elem *e);
+
+  /// Allocates an Elem; think of it as the opposite of Delete().
+  inline Elem *New();
+
+  /// Returns the first Elem with this key, or NULL if not present.
+  inline Elem *Find(I key);
+
+  /// Inserts a new element; the user asserts it is not already present.
+  inline void Insert(I key, T val);
+
+  /// Inserts another element with the same key as one that is present; all
+  /// elements with the same key follow each other in the list, and Find()
+  /// returns the first of them.
+  inline void InsertMore(I key, T val);
+
+  /// Tells the object how many hash slots to allocate (it will use at least
+  /// twice this many); must be called while the hash is empty.
+  void SetSize(size_t sz);
+
+  /// Returns the current number of hash slots.
+  inline size_t Size() { return slots_.size(); }
+
+  ~OpenHashList();
+ private:
+  struct Slot {
+    I key;
+    Elem *elem;  // First Elem with this key; NULL if the slot is empty.
+  };
+
+  inline size_t Hash(I key) const {
+    // Fibonacci hashing; the high bits of the product are well mixed, even for
+    // the small consecutive integers that state-ids typically are.
+    return static_cast<size_t>(
+        (static_cast<uint64>(key) * 11400714819323198485ULL) >> 32) & mask_;
+  }
+
+  // Returns the slot for this key: either the one that holds it, or the empty
+  // slot where it would go.
+  inline Slot *FindSlot(I key);
+
+  // Doubles the number of slots and re-inserts the current keys.
+  void Grow();
+
+  void Resize(size_t num_slots);
+
+  Elem *list_head_;  // head of currently stored list.
+  Elem *list_tail_;  // tail of currently stored list.
+
+  std::vector<Slot> slots_;
+  size_t mask_;  // slots_.size() - 1.
+  std::vector<size_t> used_slots_;  // indexes of the occupied slots.
+
+  Elem *freed_head_;  // head of list of currently freed elements.
+
+  std::vector<Elem*> allocated_;  // list of allocated blocks.
+
+  static const size_t allocate_block_size_ = 1024;  // Number of Elems to
+  // allocate in one block.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OpenHashList);
+};
+
+
+} // end namespace kaldi
+
+#include "util/open-hash-list-inl.h"
+
+#endif
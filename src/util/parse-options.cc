@@ -31,6 +31,9 @@
 
 #include "util/parse-options.h"
 #include "util/text-utils.h"
+#include "util/kaldi-profile.h"
+#include "matrix/matrix-allocator.h"
+#include "matrix/blas-threads.h"
 #include "base/kaldi-common.h"
 
 namespace kaldi {
@@ -297,6 +300,17 @@ std::string ParseOptions::Escape(const std::string &str) {
 
 
 
+// Registered with atexit() by ParseOptions::Read() if --matrix-pool=true.
+static void LogMatrixPoolStats() {
+  MatrixPoolStats stats;
+  GetMatrixPoolStats(&stats);
+  KALDI_VLOG(1) << "Matrix pool: " << stats.num_allocations
+                << " allocations, of which " << stats.num_reused
+                << " reused memory from the pool and " << stats.num_system
+                << " went to the system; " << stats.bytes_cached
+                << " bytes are cached at exit.";
+}
+
 int ParseOptions::Read(int argc, const char *const argv[]) {
   argc_ = argc;
   argv_ = argv;
@@ -375,6 +389,18 @@ int ParseOptions::Read(int argc, const char *const argv[]) {
     }
   }
 
+  if (!profile_.empty())
+    Profiler::Enable(profile_);
+  if (!profile_trace_.empty())
+    Profiler::EnableTrace(profile_trace_);
+  if (matrix_pool_ && !MatrixPoolEnabled()) {
+    SetMatrixPoolEnabled(true);
+    atexit(LogMatrixPoolStats);
+  }
+  if (blas_num_threads_ > 0 && !SetBlasNumThreads(blas_num_threads_))
+    KALDI_WARN << "Cannot set the number of threads of the BLAS library ("
+               << BlasLibraryName() << "); ignoring --blas-num-threads";
+
   if (print_args_) {  // if the user did not suppress this with --print-args = false....
     std::ostringstream strm;
     for (int j = 0; j < argc; j++)
@@ -36,8 +36,9 @@ namespace kaldi {
 class ParseOptions : public OptionsItf {
  public:
   explicit ParseOptions(const char *usage) :
-    print_args_(true), help_(false), usage_(usage), argc_(0), argv_(NULL),
-    prefix_(""), other_parser_(NULL) {
+    print_args_(true), help_(false), matrix_pool_(false),
+    blas_num_threads_(-1), usage_(usage),
+    argc_(0), argv_(NULL), prefix_(""), other_parser_(NULL) {
 #ifndef _MSC_VER  // This is just a convenient place to set the stderr to line
     setlinebuf(stderr);  // buffering mode, since it's called at program start.
 #endif  // This helps ensure different programs' output is not mixed up.
@@ -47,6 +48,28 @@ class ParseOptions : public OptionsItf {
     RegisterStandard("help", &help_, "Print out usage message");
     RegisterStandard("verbose", &g_kaldi_verbose_level,
                      "Verbose level (higher->more logging)");
+    RegisterStandard("profile", &profile_,
+                     "If set, time the instrumented regions of code and print "
+                     "a summary at exit: \"log\" to print it to the log, or "
+                     "a filename to write it in JSON format");
+    RegisterStandard("profile-trace", &profile_trace_,
+                     "If set, also record a timeline of the instrumented "
+                     "regions and write it to this file at exit, in Chrome "
+                     "trace-event format (for chrome://tracing)");
+    RegisterStandard("matrix-pool", &matrix_pool_,
+                     "If true, keep the memory of freed matrices and vectors "
+                     "in per-thread pools for reuse (helps programs that "
+                     "create many temporaries); with --verbose=1, prints "
+                     "usage statistics at exit");
+    RegisterStandard("fast-math", &g_kaldi_fast_math,
+                     "If true, use faster approximations (with errors of "
+                     "around 1e-6) in LogAdd() and in the LogSumExp() and "
+                     "ApplySoftMax() functions of single-precision vectors "
+                     "and matrices");
+    RegisterStandard("blas-num-threads", &blas_num_threads_,
+                     "If >0, the number of threads the BLAS library may use "
+                     "(multi-threaded parts of programs always use one BLAS "
+                     "thread per thread); if <=0, the library's default");
   }
 
   /**
@@ -66,8 +89,9 @@ class ParseOptions : public OptionsItf {
     instead of just --frame-shift=10.0
    */
   ParseOptions(const std::string &prefix, ParseOptions *other) :
-    print_args_(false), help_(false), usage_(""), argc_(0), argv_(NULL),
-    prefix_(prefix), other_parser_(other) {}
+    print_args_(false), help_(false), matrix_pool_(false),
+    blas_num_threads_(-1), usage_(""),
+    argc_(0), argv_(NULL), prefix_(prefix), other_parser_(other) {}
 
   ~ParseOptions() {}
 
@@ -219,6 +243,10 @@ class ParseOptions : public OptionsItf {
   bool print_args_;     ///< variable for the implicit --print-args parameter
   bool help_;           ///< variable for the implicit --help parameter
   std::string config_;  ///< variable for the implicit --config parameter
+  std::string profile_;  ///< variable for the implicit --profile parameter
+  std::string profile_trace_;  ///< for the implicit --profile-trace parameter
+  bool matrix_pool_;  ///< variable for the implicit --matrix-pool parameter
+  int32 blas_num_threads_;  ///< for the implicit --blas-num-threads parameter
   std::vector<std::string> positional_args_;
   const char *usage_;
   int argc_;
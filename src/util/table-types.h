@@ -45,6 +45,10 @@ typedef RandomAccessTableReaderMapped<KaldiObjectHolder<Matrix<double> > >  Rand
 
 typedef TableWriter<KaldiObjectHolder<CompressedMatrix> >  CompressedMatrixWriter;
 
+typedef TableWriter<KaldiObjectHolder<RowCompressedMatrix> >  RowCompressedMatrixWriter;
+typedef SequentialTableReader<KaldiObjectHolder<RowCompressedMatrix> >  SequentialRowCompressedMatrixReader;
+typedef RandomAccessTableReader<KaldiObjectHolder<RowCompressedMatrix> >  RandomAccessRowCompressedMatrixReader;
+
 typedef TableWriter<KaldiObjectHolder<Vector<BaseFloat> > >  BaseFloatVectorWriter;
 typedef SequentialTableReader<KaldiObjectHolder<Vector<BaseFloat> > >  SequentialBaseFloatVectorReader;
 typedef RandomAccessTableReader<KaldiObjectHolder<Vector<BaseFloat> > >  RandomAccessBaseFloatVectorReader;
@@ -324,6 +324,90 @@ void CompensateDiagGaussian(const Vector<double> &mu_h,
   }
 }
 
+/*
+ * Compensate a set of Gaussians together: the same as CompensateDiagGaussian
+ * for each row of means and vars, but the mismatch function is computed for
+ * all the Gaussians with matrix-matrix products.  Also, as only the diagonal
+ * of Jx diag(var) Jx^T is needed, it is computed as (Jx .* Jx) var, which is
+ * a matrix-vector product instead of a matrix-matrix one.
+ */
+void CompensateDiagGaussians(const Vector<double> &mu_h,
+                             const Vector<double> &mu_z,
+                             const Vector<double> &var_z,
+                             int32 num_cepstral,
+                             int32 num_fbank,
+                             const Matrix<double> &dct_mat,
+                             const Matrix<double> &inv_dct_mat,
+                             Matrix<double> &means,
+                             Matrix<double> &vars,
+                             int32 offset,
+                             std::vector<Matrix<double> > &Jx,
+                             std::vector<Matrix<double> > &Jz) {
+  int32 num_gauss = means.NumRows();
+  KALDI_ASSERT(vars.NumRows() == num_gauss &&
+               offset + num_gauss <= static_cast<int32>(Jx.size()) &&
+               offset + num_gauss <= static_cast<int32>(Jz.size()));
+  if (num_gauss == 0) return;
+  SubVector<double> mu_h_s(mu_h, 0, num_cepstral), mu_z_s(mu_z, 0,
+                                                          num_cepstral);
+
+  // One row per Gaussian: mu_n - mu_x - mu_h
+  Matrix<double> mu_y_s(means.Range(0, num_gauss, 0, num_cepstral));
+  mu_y_s.Scale(-1.0);
+  mu_y_s.AddVecToRows(1.0, mu_z_s);
+  mu_y_s.AddVecToRows(-1.0, mu_h_s);
+  Matrix<double> tmp_fbank(num_gauss, num_fbank);
+  tmp_fbank.AddMatMat(1.0, mu_y_s, kNoTrans, inv_dct_mat, kTrans, 0.0);  // C_inv * (mu_n - mu_x - mu_h)
+  tmp_fbank.ApplyExp();  // exp( C_inv * (mu_n - mu_x - mu_h) )
+  tmp_fbank.Add(1.0);  // 1 + exp( C_inv * (mu_n - mu_x - mu_h) )
+  Matrix<double> tmp_inv(tmp_fbank);  // keep a version
+  tmp_fbank.ApplyLog();  // log ( 1 + exp( C_inv * (mu_n - mu_x - mu_h) ) )
+  tmp_inv.InvertElements();  // 1.0 / ( 1 + exp( C_inv * (mu_n - mu_x - mu_h) ) )
+
+  // new static means: mu_x + mu_h + C * log ( 1 + exp( C_inv * (mu_n - mu_x - mu_h) ) )
+  SubMatrix<double> mu_s(means, 0, num_gauss, 0, num_cepstral);
+  mu_s.AddVecToRows(1.0, mu_h_s);
+  mu_s.AddMatMat(1.0, tmp_fbank, kNoTrans, dct_mat, kTrans, 1.0);
+
+  Matrix<double> tmp_dct(num_cepstral, num_fbank, kUndefined),
+      jx_sq(num_cepstral, num_cepstral, kUndefined),
+      jz_sq(num_cepstral, num_cepstral, kUndefined);
+  Vector<double> tmp_vec(num_cepstral, kUndefined);
+  for (int32 g = 0; g < num_gauss; ++g) {
+    Matrix<double> &this_Jx = Jx[offset + g], &this_Jz = Jz[offset + g];
+    // compute J
+    tmp_dct.CopyFromMat(dct_mat);
+    tmp_dct.MulColsVec(tmp_inv.Row(g));
+    this_Jx.Resize(num_cepstral, num_cepstral, kUndefined);
+    this_Jx.AddMatMat(1.0, tmp_dct, kNoTrans, inv_dct_mat, kNoTrans, 0.0);
+
+    // compute I_J
+    this_Jz = this_Jx;
+    for (int32 ii = 0; ii < num_cepstral; ++ii)
+      this_Jz(ii, ii) = 1.0 - this_Jz(ii, ii);
+
+    // dynamic means
+    for (int32 ii = 1; ii < 3; ++ii) {
+      SubVector<double> mu_dyn(means.Row(g), ii * num_cepstral, num_cepstral);
+      tmp_vec.CopyFromVec(mu_dyn);
+      mu_dyn.AddMatVec(1.0, this_Jx, kNoTrans, tmp_vec, 0.0);
+    }
+
+    // variances: diag(Jx diag(x_var) Jx^T + Jz diag(n_var) Jz^T)
+    jx_sq.CopyFromMat(this_Jx);
+    jx_sq.MulElements(this_Jx);
+    jz_sq.CopyFromMat(this_Jz);
+    jz_sq.MulElements(this_Jz);
+    for (int32 ii = 0; ii < 3; ++ii) {
+      SubVector<double> x_var(vars.Row(g), ii * num_cepstral, num_cepstral);
+      SubVector<double> n_var(var_z, ii * num_cepstral, num_cepstral);
+      tmp_vec.CopyFromVec(x_var);
+      x_var.AddMatVec(1.0, jx_sq, kNoTrans, tmp_vec, 0.0);
+      x_var.AddMatVec(1.0, jz_sq, kNoTrans, n_var, 1.0);
+    }
+  }
+}
+
 /*
  * Do the compensation using the current noise model parameters for a diagonal GMM.
  * Also keep the statistics of the Jx, and Jz for next iteration of noise estimation.
@@ -347,19 +431,8 @@ void CompensateDiagGmm(const Vector<double> &mu_h,
 // iterate all the Gaussians
   DiagGmmNormal ngmm(noise_gmm);
 
-  int32 num_gauss = noise_gmm.NumGauss();
-  for (int32 g = 0; g < num_gauss; ++g) {
-
-    //KALDI_LOG << "pdf_id: " << pdf << ", gauss_id: " << g;
-
-    Vector<double> cur_mean(ngmm.means_.Row(g));
-    Vector<double> cur_var(ngmm.vars_.Row(g));
-    CompensateDiagGaussian(mu_h, mu_z, var_z, num_cepstral, num_fbank, dct_mat,
-                           inv_dct_mat,
-                           cur_mean, cur_var, Jx[g], Jz[g]);
-    ngmm.means_.CopyRowFromVec(cur_mean, g);
-    ngmm.vars_.CopyRowFromVec(cur_var, g);
-  }
+  CompensateDiagGaussians(mu_h, mu_z, var_z, num_cepstral, num_fbank, dct_mat,
+                          inv_dct_mat, ngmm.means_, ngmm.vars_, 0, Jx, Jz);
 
   ngmm.CopyToDiagGmm(&noise_gmm);
   noise_gmm.ComputeGconsts();
@@ -394,20 +467,10 @@ void CompensateModel(const Vector<double> &mu_h,
     DiagGmm *gmm = &(noise_am_gmm.GetPdf(pdf));
     DiagGmmNormal ngmm(*gmm);
 
-    int32 num_gauss = gmm->NumGauss();
-    for (int32 g = 0; g < num_gauss; ++g, ++tot_gauss_id) {
-
-      //KALDI_LOG << "pdf_id: " << pdf << ", gauss_id: " << g;
-
-      Vector<double> cur_mean(ngmm.means_.Row(g));
-      Vector<double> cur_var(ngmm.vars_.Row(g));
-      CompensateDiagGaussian(mu_h, mu_z, var_z, num_cepstral, num_fbank,
-                             dct_mat, inv_dct_mat, cur_mean, cur_var,
-                             Jx[tot_gauss_id],
-                             Jz[tot_gauss_id]);
-      ngmm.means_.CopyRowFromVec(cur_mean, g);
-      ngmm.vars_.CopyRowFromVec(cur_var, g);
-    }
+    CompensateDiagGaussians(mu_h, mu_z, var_z, num_cepstral, num_fbank,
+                            dct_mat, inv_dct_mat, ngmm.means_, ngmm.vars_,
+                            tot_gauss_id, Jx, Jz);
+    tot_gauss_id += gmm->NumGauss();
 
     ngmm.CopyToDiagGmm(gmm);
     gmm->ComputeGconsts();
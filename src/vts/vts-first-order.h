@@ -97,6 +97,27 @@ void CompensateDiagGaussian(const Vector<double> &mu_h,
                             Matrix<double> &Jx,
                             Matrix<double> &Jz);
 
+/*
+ * Compensate a set of Diagonal Gaussians, as CompensateDiagGaussian does for
+ * each of them, but faster.
+ *
+ * means and vars have one row per Gaussian, with the clean values to be
+ * compensated; Jx[offset + g] and Jz[offset + g] are set for row g.
+ *
+ */
+void CompensateDiagGaussians(const Vector<double> &mu_h,
+                             const Vector<double> &mu_z,
+                             const Vector<double> &var_z,
+                             int32 num_cepstral,
+                             int32 num_fbank,
+                             const Matrix<double> &dct_mat,
+                             const Matrix<double> &inv_dct_mat,
+                             Matrix<double> &means,
+                             Matrix<double> &vars,
+                             int32 offset,
+                             std::vector<Matrix<double> > &Jx,
+                             std::vector<Matrix<double> > &Jz);
+
 /*
  * Compensate a Diagonal Gaussian Mixture model.
  *
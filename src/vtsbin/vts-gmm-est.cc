@@ -12,6 +12,7 @@
 #include "tree/context-dep.h"
 #include "hmm/transition-model.h"
 #include "vts/vts-accum-am-diag-gmm.h"
+#include "thread/kaldi-thread.h"
 
 int main(int argc, char *argv[]) {
   try {
@@ -34,6 +35,7 @@ int main(int argc, char *argv[]) {
     BaseFloat min_count = 20.0;
     std::string update_flags_str = "mvwt";
     std::string occs_out_filename;
+    int32 num_threads = 1;
 
     ParseOptions po(usage);
     po.Register("binary", &binary_write, "Write output in binary mode");
@@ -51,10 +53,13 @@ int main(int argc, char *argv[]) {
                 "means by standard deviation times this factor.");
     po.Register("write-occs", &occs_out_filename, "File to write state "
                 "occupancies to.");
+    po.Register("num-threads", &num_threads, "Number of threads used to "
+                "split and merge the GMMs of the pdfs in parallel.");
     tcfg.Register(&po);
     gmm_opts.Register(&po);
 
     po.Read(argc, argv);
+    g_num_threads = num_threads;
 
     if (po.NumArgs() != 3) {
       po.PrintUsage();